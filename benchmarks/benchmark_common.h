@@ -0,0 +1,99 @@
+/**
+ * @file
+ * @brief Shared helpers of the microbenchmarks
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef ALLPIX_BENCHMARK_COMMON_H
+#define ALLPIX_BENCHMARK_COMMON_H
+
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <Math/Point3D.h>
+
+#include "core/config/ConfigReader.hpp"
+#include "core/geometry/DetectorModel.hpp"
+#include "tools/units.h"
+
+namespace allpix::benchmarks {
+    /**
+     * @brief Register the framework units once, required before parsing quantities with units
+     */
+    inline void initialize_units() {
+        static const bool units_registered = []() {
+            register_units();
+            return true;
+        }();
+        (void)units_registered;
+    }
+
+    /**
+     * @brief Get a detector model of one of the supported geometries, shared by all benchmarks
+     * @param geometry Geometry of the model, either pixel, hexagonal or radial_strip
+     * @return Detector model loaded from the models shipped with the framework
+     */
+    inline std::shared_ptr<DetectorModel> get_model(const std::string& geometry) {
+        initialize_units();
+
+        static std::map<std::string, std::shared_ptr<DetectorModel>> models;
+        auto model = models.find(geometry);
+        if(model != models.end()) {
+            return model->second;
+        }
+
+        // Hexagonal pixels are derived from the Timepix model, as no hexagonal model is shipped
+        std::filesystem::path path = ALLPIX_BENCHMARK_MODELS;
+        path /= (geometry == "radial_strip" ? "atlas_itk_r0.conf" : "timepix.conf");
+        std::ifstream file(path);
+        std::stringstream content;
+        if(geometry == "hexagonal") {
+            content << "geometry = \"hexagonal\"\npixel_type = \"hexagon_pointy\"\n";
+            for(std::string line; std::getline(file, line);) {
+                if(line.rfind("geometry", 0) != 0) {
+                    content << line << "\n";
+                }
+            }
+        } else {
+            content << file.rdbuf();
+        }
+
+        ConfigReader reader(content, path);
+        return models.emplace(geometry, DetectorModel::factory(geometry, reader)).first->second;
+    }
+
+    /**
+     * @brief Generate positions distributed uniformly in the sensor of a detector model
+     * @param model Detector model to generate the positions for
+     * @param count Number of positions
+     * @return Positions in local coordinates
+     */
+    inline std::vector<ROOT::Math::XYZPoint> random_positions(const DetectorModel& model, size_t count) {
+        std::mt19937_64 engine(1);
+        auto center = model.getSensorCenter();
+        auto size = model.getSensorSize();
+        std::uniform_real_distribution<double> x(center.x() - size.x() / 2, center.x() + size.x() / 2);
+        std::uniform_real_distribution<double> y(center.y() - size.y() / 2, center.y() + size.y() / 2);
+        std::uniform_real_distribution<double> z(center.z() - size.z() / 2, center.z() + size.z() / 2);
+
+        std::vector<ROOT::Math::XYZPoint> positions;
+        positions.reserve(count);
+        for(size_t i = 0; i < count; ++i) {
+            positions.emplace_back(x(engine), y(engine), z(engine));
+        }
+        return positions;
+    }
+} // namespace allpix::benchmarks
+
+#endif /* ALLPIX_BENCHMARK_COMMON_H */
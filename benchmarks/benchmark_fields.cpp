@@ -0,0 +1,89 @@
+/**
+ * @file
+ * @brief Microbenchmarks of the lookup of detector fields
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <magic_enum/magic_enum.hpp>
+
+#include <Math/Vector3D.h>
+
+#include "benchmark_common.h"
+#include "core/geometry/DetectorField.hpp"
+#include "core/utils/unit.h"
+
+using namespace allpix;
+
+namespace {
+    /**
+     * @brief Look up the electric field of a grid with a given mapping at random positions in the sensor
+     */
+    void field_get(benchmark::State& state, FieldMapping mapping, FieldInterpolation interpolation) {
+        auto model = benchmarks::get_model("pixel");
+        auto pitch = model->getPixelSize();
+        auto thickness = model->getSensorSize().z();
+
+        // Extent of the grid covering the part of the pixel or the sensor defined by the mapping
+        std::array<double, 3> size{pitch.x(), pitch.y(), thickness};
+        auto name = std::string(magic_enum::enum_name(mapping));
+        if(mapping == FieldMapping::SENSOR) {
+            size = {model->getSensorSize().x(), model->getSensorSize().y(), thickness};
+        } else {
+            if(name.find("HALF_LEFT") != std::string::npos || name.find("HALF_RIGHT") != std::string::npos ||
+               name.find("QUADRANT") != std::string::npos) {
+                size[0] /= 2;
+            }
+            if(name.find("HALF_TOP") != std::string::npos || name.find("HALF_BOTTOM") != std::string::npos ||
+               name.find("QUADRANT") != std::string::npos) {
+                size[1] /= 2;
+            }
+        }
+
+        // Smoothly varying field on a grid of typical size
+        std::array<size_t, 3> bins{50, 50, 100};
+        auto values = std::make_shared<std::vector<double>>(3 * bins[0] * bins[1] * bins[2]);
+        for(size_t i = 0; i < values->size(); ++i) {
+            (*values)[i] = static_cast<double>(i % 97) * Units::get(1.0, "kV/cm");
+        }
+
+        DetectorField<ROOT::Math::XYZVector> field(model);
+        auto center_z = model->getSensorCenter().z();
+        field.setGrid(SharedArray<double>(values),
+                      bins,
+                      size,
+                      mapping,
+                      {{1.0, 1.0}},
+                      {{0.0, 0.0}},
+                      {center_z - thickness / 2, center_z + thickness / 2},
+                      interpolation);
+
+        auto positions = benchmarks::random_positions(*model, 4096);
+        size_t n = 0;
+        for(auto _ : state) {
+            benchmark::DoNotOptimize(field.get(positions[n++ % positions.size()]));
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    const bool registered = []() {
+        for(auto mapping : magic_enum::enum_values<FieldMapping>()) {
+            for(auto interpolation : magic_enum::enum_values<FieldInterpolation>()) {
+                auto name = "DetectorField::get/" + std::string(magic_enum::enum_name(mapping)) + "/" +
+                            std::string(magic_enum::enum_name(interpolation));
+                benchmark::RegisterBenchmark(name.c_str(), field_get, mapping, interpolation);
+            }
+        }
+        return true;
+    }();
+} // namespace
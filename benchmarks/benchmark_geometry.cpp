@@ -0,0 +1,69 @@
+/**
+ * @file
+ * @brief Microbenchmarks of the pixel lookups of the detector models
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "benchmark_common.h"
+#include "objects/Pixel.hpp"
+
+using namespace allpix;
+
+namespace {
+    /**
+     * @brief Find the pixel index of random positions in the sensor
+     */
+    void model_get_pixel_index(benchmark::State& state, const std::string& geometry) {
+        auto model = benchmarks::get_model(geometry);
+        auto positions = benchmarks::random_positions(*model, 4096);
+        size_t n = 0;
+        for(auto _ : state) {
+            benchmark::DoNotOptimize(model->getPixelIndex(positions[n++ % positions.size()]));
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    /**
+     * @brief Find the neighbors of pixels for the distance given by the benchmark argument
+     */
+    void model_get_neighbors(benchmark::State& state, const std::string& geometry) {
+        auto model = benchmarks::get_model(geometry);
+        auto distance = static_cast<size_t>(state.range(0));
+
+        // Pixels of random positions, excluding positions outside of the pixel matrix
+        std::vector<Pixel::Index> pixels;
+        for(const auto& position : benchmarks::random_positions(*model, 4096)) {
+            auto [x, y] = model->getPixelIndex(position);
+            if(model->isWithinMatrix(x, y)) {
+                pixels.emplace_back(x, y);
+            }
+        }
+
+        size_t n = 0;
+        for(auto _ : state) {
+            benchmark::DoNotOptimize(model->getNeighbors(pixels[n++ % pixels.size()], distance));
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    const bool registered = []() {
+        for(const std::string geometry : {"pixel", "hexagonal", "radial_strip"}) {
+            benchmark::RegisterBenchmark(
+                ("DetectorModel::getPixelIndex/" + geometry).c_str(), model_get_pixel_index, geometry);
+            benchmark::RegisterBenchmark(("DetectorModel::getNeighbors/" + geometry).c_str(), model_get_neighbors, geometry)
+                ->Arg(1)
+                ->Arg(2);
+        }
+        return true;
+    }();
+} // namespace
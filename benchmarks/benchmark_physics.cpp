@@ -0,0 +1,171 @@
+/**
+ * @file
+ * @brief Microbenchmarks of the mobility models, of the tabulated powers and of the approximated transcendental functions
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "benchmark_common.h"
+#include "core/config/Configuration.hpp"
+#include "core/utils/unit.h"
+#include "objects/SensorCharge.hpp"
+#include "physics/Mobility.hpp"
+#include "tools/fast_math.h"
+#include "tools/tabulated_pow.h"
+
+using namespace allpix;
+
+namespace {
+    /**
+     * @brief Electric field magnitudes and doping concentrations within the typical range of silicon sensors
+     */
+    struct Arguments {
+        std::vector<double> efield;
+        std::vector<double> doping;
+    };
+
+    Arguments random_arguments() {
+        benchmarks::initialize_units();
+        std::mt19937_64 engine(1);
+        std::uniform_real_distribution<double> efield(0, Units::get(100.0, "kV/cm"));
+        std::uniform_real_distribution<double> log_doping(12, 18);
+        Arguments arguments;
+        for(size_t i = 0; i < 4096; ++i) {
+            arguments.efield.push_back(efield(engine));
+            arguments.doping.push_back(Units::get(std::pow(10, log_doping(engine)), "/cm/cm/cm"));
+        }
+        return arguments;
+    }
+
+    /**
+     * @brief Evaluate a mobility model for electrons at random fields and doping concentrations
+     */
+    void mobility(benchmark::State& state, const std::string& model, bool tabulate) {
+        auto arguments = random_arguments();
+        Configuration config;
+        config.set<std::string>("mobility_model", model);
+        config.set<double>("temperature", 293.15);
+        config.set<double>("mobility_electron", Units::get(1400.0, "cm*cm/V/s"));
+        config.set<double>("mobility_hole", Units::get(450.0, "cm*cm/V/s"));
+        config.set<bool>("tabulate_mobility", tabulate);
+        Mobility mobility(config, SensorMaterial::SILICON, true);
+
+        size_t n = 0;
+        for(auto _ : state) {
+            auto i = n++ % arguments.efield.size();
+            benchmark::DoNotOptimize(mobility(CarrierType::ELECTRON, arguments.efield[i], arguments.doping[i]));
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    /**
+     * @brief Baseline of the tabulated powers
+     */
+    void std_pow(benchmark::State& state) {
+        auto arguments = random_arguments();
+        size_t n = 0;
+        for(auto _ : state) {
+            benchmark::DoNotOptimize(std::pow(arguments.efield[n++ % arguments.efield.size()], 1.11));
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    /**
+     * @brief Interpolate the power from tables of different sizes
+     */
+    template <size_t S> void tabulated_pow(benchmark::State& state) {
+        auto arguments = random_arguments();
+        TabulatedPow<S> table(0, Units::get(100.0, "kV/cm"), 1.11);
+        size_t n = 0;
+        for(auto _ : state) {
+            benchmark::DoNotOptimize(table(arguments.efield[n++ % arguments.efield.size()]));
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    /**
+     * @brief Evaluate an approximated function and report its maximum relative deviation from the standard library
+     */
+    template <typename Function, typename Reference>
+    void approximation(benchmark::State& state, Function function, Reference reference, const std::vector<double>& input) {
+        double max_deviation = 0;
+        for(auto x : input) {
+            auto expected = reference(x);
+            max_deviation = std::max(max_deviation, std::fabs(function(x) - expected) / std::fabs(expected));
+        }
+
+        size_t n = 0;
+        for(auto _ : state) {
+            benchmark::DoNotOptimize(function(input[n++ % input.size()]));
+        }
+        state.SetItemsProcessed(state.iterations());
+        state.counters["max_rel_error"] = max_deviation;
+    }
+
+    /**
+     * @brief Arguments of the exponentials, logarithms and powers spanning the range used by the physics models
+     */
+    std::vector<double> random_values(double min, double max) {
+        std::mt19937_64 engine(1);
+        std::uniform_real_distribution<double> distribution(min, max);
+        std::vector<double> values;
+        for(size_t i = 0; i < 4096; ++i) {
+            values.push_back(distribution(engine));
+        }
+        return values;
+    }
+
+    const bool registered = []() {
+        for(const std::string model : {"jacoboni",
+                                       "canali",
+                                       "canali_fast",
+                                       "hamburg",
+                                       "hamburg_highfield",
+                                       "masetti",
+                                       "masetti_canali",
+                                       "arora",
+                                       "ruch_kino",
+                                       "quay",
+                                       "levinshtein",
+                                       "constant"}) {
+            benchmark::RegisterBenchmark(("Mobility/" + model).c_str(), mobility, model, false);
+            benchmark::RegisterBenchmark(("Mobility/" + model + "/tabulated").c_str(), mobility, model, true);
+        }
+        benchmark::RegisterBenchmark("std::pow", std_pow);
+        benchmark::RegisterBenchmark("TabulatedPow/100", tabulated_pow<100>);
+        benchmark::RegisterBenchmark("TabulatedPow/1000", tabulated_pow<1000>);
+        benchmark::RegisterBenchmark("TabulatedPow/10000", tabulated_pow<10000>);
+
+        auto exponents = random_values(-50, 50);
+        auto arguments = random_values(1e-6, 1e6);
+        auto std_exp = [](double x) { return std::exp(x); };
+        auto std_log = [](double x) { return std::log(x); };
+        auto std_pow_fixed = [](double x) { return std::pow(x, 1.11); };
+        benchmark::RegisterBenchmark("std::exp",
+                                     [=](benchmark::State& state) { approximation(state, std_exp, std_exp, exponents); });
+        benchmark::RegisterBenchmark("fast_math::exp", [=](benchmark::State& state) {
+            approximation(state, fast_math::exp_approx, std_exp, exponents);
+        });
+        benchmark::RegisterBenchmark("std::log",
+                                     [=](benchmark::State& state) { approximation(state, std_log, std_log, arguments); });
+        benchmark::RegisterBenchmark("fast_math::log", [=](benchmark::State& state) {
+            approximation(state, fast_math::log_approx, std_log, arguments);
+        });
+        benchmark::RegisterBenchmark("fast_math::pow", [=](benchmark::State& state) {
+            approximation(state, [](double x) { return fast_math::pow_approx(x, 1.11); }, std_pow_fixed, arguments);
+        });
+        return true;
+    }();
+} // namespace
@@ -0,0 +1,44 @@
+/**
+ * @file
+ * @brief Microbenchmarks of the accumulation of induced charge in pulses
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "objects/Pulse.hpp"
+
+using namespace allpix;
+
+namespace {
+    /**
+     * @brief Add charge at random times to a pulse, with the number of charges per pulse given by the benchmark argument
+     */
+    void pulse_add_charge(benchmark::State& state) {
+        std::mt19937_64 engine(1);
+        std::uniform_real_distribution<double> time(0, 20.);
+        std::vector<double> times(static_cast<size_t>(state.range(0)));
+        for(auto& t : times) {
+            t = time(engine);
+        }
+
+        for(auto _ : state) {
+            Pulse pulse(0.01);
+            for(auto t : times) {
+                pulse.addCharge(1., t);
+            }
+            benchmark::DoNotOptimize(pulse.data());
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+} // namespace
+
+BENCHMARK(pulse_add_charge)->Name("Pulse::addCharge")->Arg(100)->Arg(10000);
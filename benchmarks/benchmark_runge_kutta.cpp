@@ -0,0 +1,52 @@
+/**
+ * @file
+ * @brief Microbenchmarks of the Runge-Kutta integration of the charge carrier motion
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <Eigen/Core>
+#include <benchmark/benchmark.h>
+
+#include "tools/runge_kutta.h"
+
+using namespace allpix;
+
+namespace {
+    /**
+     * @brief Velocity of a carrier in a field pointing along z with a lateral gradient
+     */
+    Eigen::Vector3d velocity(double, const Eigen::Vector3d& position) {
+        return {0.01 * position.y(), -0.01 * position.x(), 1. + 0.1 * position.z()};
+    }
+
+    /**
+     * @brief Integration with the tableau given at runtime
+     */
+    void runge_kutta_step(benchmark::State& state) {
+        auto runge_kutta = make_runge_kutta(tableau::RK5, velocity, 0.01, Eigen::Vector3d(0.1, 0.2, 0.));
+        for(auto _ : state) {
+            benchmark::DoNotOptimize(runge_kutta.step());
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    /**
+     * @brief Integration with the tableau known at compile time
+     */
+    template <class Tableau> void static_runge_kutta_step(benchmark::State& state) {
+        auto runge_kutta = make_runge_kutta(Tableau{}, velocity, 0.01, Eigen::Vector3d(0.1, 0.2, 0.));
+        for(auto _ : state) {
+            benchmark::DoNotOptimize(runge_kutta.step());
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+} // namespace
+
+BENCHMARK(runge_kutta_step)->Name("RungeKutta::step/RK5");
+BENCHMARK(static_runge_kutta_step<tableau::StaticRK5>)->Name("StaticRungeKutta::step/RK5");
+BENCHMARK(static_runge_kutta_step<tableau::StaticDOPRI5>)->Name("StaticRungeKutta::step/DOPRI5");
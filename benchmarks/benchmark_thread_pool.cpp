@@ -0,0 +1,53 @@
+/**
+ * @file
+ * @brief Microbenchmarks of the overhead of the thread pool
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "core/module/ThreadPool.hpp"
+
+using namespace allpix;
+
+namespace {
+    /**
+     * @brief Submit an empty task and wait for its result, with the number of workers given by the benchmark argument
+     */
+    void thread_pool_submit(benchmark::State& state) {
+        auto threads = static_cast<unsigned int>(state.range(0));
+        ThreadPool::registerThreadCount(threads);
+        ThreadPool pool(threads, 128);
+        for(auto _ : state) {
+            pool.submit([]() { return 1; }).get();
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    /**
+     * @brief Submit empty tasks without tracking their results and wait for the pool, with the number of workers given by
+     * the benchmark argument
+     */
+    void thread_pool_submit_detached(benchmark::State& state) {
+        auto threads = static_cast<unsigned int>(state.range(0));
+        ThreadPool::registerThreadCount(threads);
+        ThreadPool pool(threads, 128);
+        constexpr int tasks = 64;
+        for(auto _ : state) {
+            for(int i = 0; i < tasks; ++i) {
+                pool.submitDetached([]() {});
+            }
+            pool.wait();
+        }
+        pool.checkException();
+        state.SetItemsProcessed(state.iterations() * tasks);
+    }
+} // namespace
+
+BENCHMARK(thread_pool_submit)->Name("ThreadPool::submit")->Arg(1)->Arg(4)->UseRealTime();
+BENCHMARK(thread_pool_submit_detached)->Name("ThreadPool::submitDetached")->Arg(1)->Arg(4)->UseRealTime();
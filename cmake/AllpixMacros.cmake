@@ -51,8 +51,13 @@ MACRO(_allpix_module_define_common name)
 Create the header or provide the alternative class name as first argument")
     ENDIF()
 
-    # Define the library
-    ADD_LIBRARY(${${name}} SHARED "")
+    # Define the library, linked into the executable instead of loaded at runtime if all modules are built statically
+    IF(ALLPIX_STATIC_MODULES AND NOT ALLPIX_MODULE_EXTERNAL)
+        ADD_LIBRARY(${${name}} STATIC "")
+        TARGET_COMPILE_DEFINITIONS(${${name}} PRIVATE ALLPIX_MODULE_STATIC)
+    ELSE()
+        ADD_LIBRARY(${${name}} SHARED "")
+    ENDIF()
 
     # Add the current directory as include directory
     TARGET_INCLUDE_DIRECTORIES(${${name}} PRIVATE ${CMAKE_CURRENT_SOURCE_DIR})
@@ -87,12 +92,22 @@ Create the header or provide the alternative class name as first argument")
     ENDIF()
 ENDMACRO()
 
+# Save the module for the table of modules linked statically into the executable (NOTE: see exec folder)
+MACRO(_allpix_module_register_static unique)
+    IF(ALLPIX_STATIC_MODULES AND NOT ALLPIX_MODULE_EXTERNAL)
+        SET(_ALLPIX_STATIC_MODULES
+            ${_ALLPIX_STATIC_MODULES} "${_allpix_module_dir}:${_allpix_module_class}:${unique}"
+            CACHE INTERNAL "Statically linked modules")
+    ENDIF()
+ENDMACRO()
+
 # Put this at the start of every unique module
 MACRO(ALLPIX_UNIQUE_MODULE name)
     _ALLPIX_MODULE_DEFINE_COMMON(${name} ${ARGN})
 
     # Set the unique flag to true
     TARGET_COMPILE_DEFINITIONS(${${name}} PRIVATE ALLPIX_MODULE_UNIQUE=1)
+    _ALLPIX_MODULE_REGISTER_STATIC(1)
 ENDMACRO()
 
 # Put this at the start of every detector module
@@ -101,6 +116,7 @@ MACRO(ALLPIX_DETECTOR_MODULE name)
 
     # Set the unique flag to false
     TARGET_COMPILE_DEFINITIONS(${${name}} PRIVATE ALLPIX_MODULE_UNIQUE=0)
+    _ALLPIX_MODULE_REGISTER_STATIC(0)
 ENDMACRO()
 
 # Add sources to the module
@@ -237,12 +253,16 @@ FUNCTION(add_allpix_test)
 
     # Parse configuration file for pass/fail conditions:
     FILE(STRINGS ${TEST_FILE} PASS_LST_ REGEX "#PASS ")
+    FILE(STRINGS ${TEST_FILE} PASSREGEX_LST_ REGEX "#PASSREGEX ")
     FILE(STRINGS ${TEST_FILE} FAIL_LST_ REGEX "#FAIL ")
 
     # Check for number of pass or fail conditions - we should have at least one of them
     LIST(LENGTH PASS_LST_ listcount_pass)
+    LIST(LENGTH PASSREGEX_LST_ listcount_passregex)
     LIST(LENGTH FAIL_LST_ listcount_fail)
-    IF(listcount_pass EQUAL 0 AND listcount_fail EQUAL 0)
+    IF(listcount_pass EQUAL 0
+       AND listcount_passregex EQUAL 0
+       AND listcount_fail EQUAL 0)
         MESSAGE(FATAL_ERROR "Neither PASS nor FAIL defined for test \"${TEST_NAME}\"")
     ENDIF()
 
@@ -255,6 +275,14 @@ FUNCTION(add_allpix_test)
                 APPEND
                 PROPERTY PASS_REGULAR_EXPRESSION "${pass}")
         ENDFOREACH()
+        # Regular expressions are added as they are:
+        FOREACH(pass ${PASSREGEX_LST_})
+            STRING(REPLACE "#PASSREGEX " "" pass "${pass}")
+            SET_PROPERTY(
+                TEST ${TEST_NAME}
+                APPEND
+                PROPERTY PASS_REGULAR_EXPRESSION "${pass}")
+        ENDFOREACH()
     ENDIF()
     FOREACH(fail ${FAIL_LST_})
         ESCAPE_REGEX("${fail}" fail)
@@ -0,0 +1,179 @@
+#!/usr/bin/python3
+
+# SPDX-FileCopyrightText: 2024 CERN and the Allpix Squared authors
+# SPDX-License-Identifier: MIT
+
+# Search the fastest settings of the propagation parameters which reproduce the observables of a high-precision reference
+# simulation within a given tolerance. All simulations use the same events, selected via a fixed random seed, and only the
+# parameters of the propagation module are changed between them.
+
+import argparse
+import json
+import os
+import os.path as path
+import subprocess
+import sys
+import tempfile
+
+# Candidate values of the tuned parameters, ordered from the most precise to the fastest setting. The first value of every
+# parameter is used for the reference simulation.
+CANDIDATES = [
+    ("charge_per_step", ["1", "2", "5", "10", "20", "50", "100"]),
+    ("spatial_precision", ["0.1nm", "0.25nm", "0.5nm", "1nm", "2nm", "5nm"]),
+    ("timestep_max", ["0.1ns", "0.25ns", "0.5ns", "1ns"]),
+    ("max_charge_groups", ["10000", "1000", "300", "100"]),
+]
+
+OBSERVABLES = ["collected_charge", "pixel_hits", "hit_time"]
+
+parser = argparse.ArgumentParser(description="Tune the precision parameters of a propagation module")
+parser.add_argument("-c", metavar="config", required=True, help="configuration file of the simulation to tune")
+parser.add_argument("-d", metavar="detector", required=True, help="detector whose pixel hits are compared")
+parser.add_argument("-m", metavar="module", default="GenericPropagation", help="propagation module to tune")
+parser.add_argument("-n", metavar="events", type=int, default=100, help="number of events simulated per setting")
+parser.add_argument("-t", metavar="tolerance", type=float, default=0.02,
+                    help="maximum relative deviation of every observable from the reference")
+parser.add_argument("-s", metavar="seed", type=int, default=1, help="random seed used for all simulations")
+parser.add_argument("-l", metavar="libAllpixObjects", required=False,
+                    help="specify path to the libAllpixObjects library (generally in allpix-squared/lib/)")
+parser.add_argument("--allpix", default="allpix", help="allpix executable to run the simulations with")
+parser.add_argument("-v", "--verbose", help="print the output of the simulations", action="store_true")
+args = parser.parse_args()
+
+import ROOT
+from ROOT import gSystem
+
+if args.l is not None:
+    lib_file_name = args.l
+elif path.isfile(path.join(path.sep, "opt", "allpix-squared", "lib", "libAllpixObjects.so")):
+    lib_file_name = path.join(path.sep, "opt", "allpix-squared", "lib", "libAllpixObjects.so")
+else:
+    print("WARNING: No Allpix Objects Library found, exiting (Use -l to manually set location of libraries)")
+    sys.exit(1)
+if not path.isfile(lib_file_name):
+    print("WARNING: " + lib_file_name + " does not exist, exiting")
+    sys.exit(1)
+gSystem.Load(lib_file_name)
+
+config_file = path.abspath(args.c)
+config_dir = path.dirname(config_file)
+with open(config_file) as f:
+    config_text = f.read()
+
+work_dir = tempfile.mkdtemp(prefix="apsq_tuning_")
+
+# Store the pixel hits of all simulations via the ROOTObjectWriter of the configuration or an added one. Its object selection
+# is dropped from the copy of the configuration, and the pixel hits are selected on the command line instead. The copy is
+# placed next to the original configuration such that relative paths are resolved in the same way.
+tuning_lines, in_writer = [], False
+for line in config_text.splitlines():
+    section = line.strip()
+    if section.startswith("["):
+        in_writer = (section.split("#")[0].strip() == "[ROOTObjectWriter]")
+    elif in_writer and section.split("=")[0].strip() in ("include", "exclude"):
+        continue
+    tuning_lines.append(line)
+if "[ROOTObjectWriter]" not in config_text:
+    tuning_lines += ["", "[ROOTObjectWriter]"]
+handle, tuning_config = tempfile.mkstemp(suffix=".conf", prefix=".tuning_", dir=config_dir)
+with os.fdopen(handle, "w") as f:
+    f.write("\n".join(tuning_lines) + "\n")
+
+
+def simulate(settings, label):
+    """Run the simulation with the given propagation parameters, returning the module time and the observables"""
+    report = path.join(work_dir, label + ".json")
+    command = [args.allpix, "-c", tuning_config,
+               "-o", "number_of_events=" + str(args.n),
+               "-o", "random_seed=" + str(args.s),
+               "-o", "output_directory=" + work_dir,
+               "-o", "performance_report=" + report,
+               "-o", "ROOTObjectWriter.file_name=" + label,
+               "-o", "ROOTObjectWriter.include=PixelHit"]
+    for key, value in settings.items():
+        command += ["-o", args.m + "." + key + "=" + value]
+
+    result = subprocess.run(command, stdout=(None if args.verbose else subprocess.DEVNULL), stderr=subprocess.STDOUT)
+    if result.returncode != 0:
+        print("ERROR: simulation with " + describe(settings) + " failed, exiting")
+        sys.exit(1)
+
+    # Sum the execution time of all instantiations of the propagation module
+    with open(report) as f:
+        modules = json.load(f)["modules"]
+    time = sum(value for name, value in modules.items() if name.split(":")[0] == args.m)
+
+    return time, observables(path.join(work_dir, label + ".root"))
+
+
+def observables(root_file_name):
+    """Calculate the mean collected charge, number of pixel hits and hit time per event of the detector"""
+    root_file = ROOT.TFile(root_file_name)
+    pixel_hit_tree = root_file.Get("PixelHit")
+    if not pixel_hit_tree or not pixel_hit_tree.GetBranch(args.d):
+        print("ERROR: no pixel hits stored for detector " + args.d + ", exiting")
+        sys.exit(1)
+
+    charge, hits, time, events = 0., 0, 0., 0
+    for iev in range(pixel_hit_tree.GetEntries()):
+        pixel_hit_tree.GetEntry(iev)
+        pixel_hits = getattr(pixel_hit_tree, args.d)
+        if pixel_hits.size() == 0:
+            continue
+        events += 1
+        hits += pixel_hits.size()
+        for pixel_hit in pixel_hits:
+            charge += pixel_hit.getSignal()
+            time += pixel_hit.getLocalTime()
+    root_file.Close()
+
+    if events == 0:
+        return {observable: 0. for observable in OBSERVABLES}
+    return {"collected_charge": charge / events,
+            "pixel_hits": float(hits) / events,
+            "hit_time": (time / hits if hits > 0 else 0.)}
+
+
+def deviations(values, reference):
+    """Relative deviations of all observables from the reference"""
+    return {key: (abs(values[key] - reference[key]) / abs(reference[key]) if reference[key] != 0 else abs(values[key]))
+            for key in OBSERVABLES}
+
+
+def describe(settings):
+    return ", ".join(key + " = " + value for key, value in settings.items())
+
+
+try:
+    # Simulate the reference with the most precise setting of all parameters
+    best = {key: values[0] for key, values in CANDIDATES}
+    print("Simulating reference with " + describe(best))
+    reference_time, reference = simulate(best, "reference")
+    print("Reference took {0:.3f}s in {1}: ".format(reference_time, args.m) +
+          ", ".join("{0} = {1:.4g}".format(key, reference[key]) for key in OBSERVABLES))
+
+    # Relax one parameter after the other as long as the observables stay within the tolerance, keeping the best values
+    # found for the parameters relaxed before. The observables are assumed to degrade monotonically along the candidates.
+    best_time = reference_time
+    run = 0
+    for key, values in CANDIDATES:
+        for value in values[1:]:
+            settings = dict(best, **{key: value})
+            run += 1
+            time, result = simulate(settings, "setting_" + str(run))
+            deviation = deviations(result, reference)
+            accepted = all(dev <= args.t for dev in deviation.values())
+            print("{0:<20} {1:>8}: {2:.3f}s, max. deviation {3:.2%}{4}".format(
+                key, value, time, max(deviation.values()), "" if accepted else " - rejected"))
+            if not accepted:
+                break
+            if time < best_time:
+                best[key] = value
+                best_time = time
+
+    print("\nRecommended settings for " + args.m + ":")
+    for key, value in best.items():
+        print("  " + key + " = " + value)
+    print("Expected speedup of the propagation w.r.t. the reference: {0:.1f}x".format(reference_time / max(best_time, 1e-9)))
+finally:
+    os.remove(tuning_config)
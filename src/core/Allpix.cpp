@@ -11,14 +11,28 @@
 
 #include "Allpix.hpp"
 
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
 #include <chrono>
 #include <climits>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <iomanip>
+#include <map>
 #include <memory>
+#include <sstream>
 #include <stdexcept>
+#include <string>
 #include <thread>
 #include <utility>
+#include <vector>
 
 #include <TROOT.h>
 #include <TRandom.h>
@@ -95,6 +109,16 @@ Allpix::Allpix(std::string config_file_name,
         Log::addStream(log_file_);
     }
 
+    // Write the log messages from a dedicated thread if requested
+    if(global_config.get<bool>("log_asynchronous", false)) {
+        Log::setAsynchronous(true);
+        LOG(TRACE) << "Writing log messages asynchronously";
+    }
+    if(!Log::isCompiled(Log::getReportingLevel())) {
+        LOG(WARNING) << "Log level " << log_level_string
+                     << " requested but messages more verbose than INFO have been removed at compile time";
+    }
+
     // Wait for the first detailed messages until level and format are properly set
     LOG(TRACE) << "Global log level is set to " << log_level_string;
     LOG(TRACE) << "Global log format is set to " << log_format_string;
@@ -117,6 +141,208 @@ void Allpix::load() {
     LOG(STATUS) << "Welcome to Allpix^2 " << ALLPIX_PROJECT_VERSION;
     global_config.set<std::string>("version", ALLPIX_PROJECT_VERSION, true);
 
+    // Restrict the run to the events of one shard of the full run if requested
+    auto shard_count = global_config.get<uint64_t>("shard_count", 1);
+    auto shard_index = global_config.get<uint64_t>("shard_index", 0);
+    if(shard_count == 0) {
+        throw InvalidValueError(global_config, "shard_count", "number of shards should be larger than zero");
+    }
+    if(shard_index >= shard_count) {
+        throw InvalidValueError(global_config, "shard_index", "shard index should be smaller than the number of shards");
+    }
+    if(shard_count > 1) {
+        // All shards need to derive the event seeds from the same seeder
+        if(!global_config.has("random_seed")) {
+            throw InvalidCombinationError(
+                global_config, {"shard_count", "random_seed"}, "sharded runs require a fixed random seed");
+        }
+
+        // Distribute the remainder of events over the first shards
+        auto total_events = global_config.get<uint64_t>("number_of_events", 1);
+        auto shard_events = total_events / shard_count + (shard_index < total_events % shard_count ? 1 : 0);
+        auto first_event =
+            shard_index * (total_events / shard_count) + std::min(shard_index, total_events % shard_count);
+
+        // Skip the events of all previous shards, such that event numbers and seeds match the full run
+        auto skip_events = global_config.get<uint64_t>("skip_events", 0) + first_event;
+        global_config.set<uint64_t>("skip_events", skip_events);
+        global_config.set<uint64_t>("number_of_events", shard_events);
+        global_config.set<uint64_t>("shard_total_events", total_events, true);
+        LOG(STATUS) << "Running shard " << shard_index << " of " << shard_count << " with events " << (skip_events + 1)
+                    << " to " << (skip_events + shard_events) << " of " << total_events;
+    }
+
+    // Cached stage outputs can only be reused for events identical to the ones they were simulated for
+    if(global_config.has("stage_cache")) {
+        if(!global_config.has("random_seed")) {
+            throw InvalidCombinationError(
+                global_config, {"stage_cache", "random_seed"}, "caching of stage outputs requires a fixed random seed");
+        }
+        if(global_config.has("scan_parameters")) {
+            throw InvalidCombinationError(global_config,
+                                          {"stage_cache", "scan_parameters"},
+                                          "caching of stage outputs cannot be combined with parameter scans");
+        }
+        if(global_config.get<bool>("resume", false)) {
+            throw InvalidCombinationError(
+                global_config, {"stage_cache", "resume"}, "caching of stage outputs cannot be combined with resumed runs");
+        }
+    }
+
+    // Cost estimates only process a sample of the events and extrapolate to the configured number of events
+    if(global_config.has("estimate_events")) {
+        auto sample_events = global_config.get<uint64_t>("estimate_events");
+        if(sample_events == 0) {
+            throw InvalidValueError(global_config, "estimate_events", "number of sample events should be larger than zero");
+        }
+        for(const auto* key : {"scan_parameters", "server_socket", "benchmark_workers"}) {
+            if(global_config.has(key)) {
+                throw InvalidCombinationError(global_config,
+                                              {"estimate_events", key},
+                                              "cost estimates cannot be combined with repeated event loops");
+            }
+        }
+        if(global_config.get<bool>("resume", false)) {
+            throw InvalidCombinationError(
+                global_config, {"estimate_events", "resume"}, "cost estimates cannot be combined with resumed runs");
+        }
+        global_config.setDefault<std::string>("estimate_file", "estimate");
+        global_config.set<uint64_t>("_estimate_number_of_events", global_config.get<uint64_t>("number_of_events", 1));
+        global_config.set<uint64_t>("number_of_events", sample_events);
+        LOG(STATUS) << "Estimating the cost of " << global_config.get<uint64_t>("_estimate_number_of_events")
+                    << " events from a sample of " << sample_events << " events";
+    }
+
+    // Get output directory
+    std::string directory = gSystem->pwd();
+    directory += "/output";
+    if(global_config.has("output_directory")) {
+        // Use config specified one if available
+        directory = global_config.getPath("output_directory");
+    }
+    // Separate the output of every shard
+    if(shard_count > 1) {
+        directory += "/shard_" + std::to_string(shard_index);
+    }
+
+    // Checkpoints are stored in the output directory, outside of the directory of a resumed run
+    auto checkpoint_path =
+        std::filesystem::path(directory) / global_config.get<std::string>("checkpoint_file", "checkpoint");
+    checkpoint_path.replace_extension("txt");
+    global_config.set<std::string>("checkpoint_file", checkpoint_path.string(), true);
+
+    // Continue an interrupted run after the last event of its checkpoint
+    if(global_config.get<bool>("resume", false)) {
+        std::ifstream checkpoint_file(checkpoint_path);
+        if(!checkpoint_file.good()) {
+            throw InvalidValueError(global_config, "resume", "cannot read checkpoint file " + checkpoint_path.string());
+        }
+
+        std::map<std::string, std::string> checkpoint;
+        std::string line;
+        while(std::getline(checkpoint_file, line)) {
+            auto separator = line.find('=');
+            if(separator != std::string::npos) {
+                checkpoint[allpix::trim(line.substr(0, separator))] = allpix::trim(line.substr(separator + 1));
+            }
+        }
+        if(checkpoint.count("random_seed") == 0 || checkpoint.count("completed_event") == 0 ||
+           checkpoint.count("last_event") == 0) {
+            throw InvalidValueError(global_config, "resume", "incomplete checkpoint file " + checkpoint_path.string());
+        }
+
+        // Event seeds can only be reproduced with the seed of the interrupted run
+        auto checkpoint_seed = allpix::from_string<uint64_t>(checkpoint["random_seed"]);
+        if(global_config.has("random_seed") && global_config.get<uint64_t>("random_seed") != checkpoint_seed) {
+            throw InvalidValueError(global_config, "random_seed", "random seed differs from checkpoint of interrupted run");
+        }
+        global_config.set<uint64_t>("random_seed", checkpoint_seed);
+        if(checkpoint.count("random_engine") != 0) {
+            global_config.set<std::string>("random_engine", checkpoint["random_engine"]);
+        }
+
+        auto completed_event = allpix::from_string<uint64_t>(checkpoint["completed_event"]);
+        auto last_event = allpix::from_string<uint64_t>(checkpoint["last_event"]);
+        global_config.set<uint64_t>("skip_events", completed_event);
+        global_config.set<uint64_t>("number_of_events", last_event - std::min(completed_event, last_event));
+        LOG(STATUS) << "Resuming interrupted run after event " << completed_event << " of " << last_event;
+
+        // Keep the output of the interrupted run
+        directory += "/resume_" + std::to_string(completed_event);
+    }
+
+    // Parameter scans, the server mode and benchmarks run the event loop several times with reconfigured modules
+    std::initializer_list<std::string> repeated_keys = {"scan_parameters", "server_socket", "benchmark_workers"};
+    if(global_config.count(repeated_keys) > 1) {
+        throw InvalidCombinationError(
+            global_config, repeated_keys, "parameter scans, the server mode and benchmarks cannot be combined");
+    }
+    for(const auto& key : repeated_keys) {
+        if(!global_config.has(key)) {
+            continue;
+        }
+        if(global_config.get<bool>("resume", false)) {
+            throw InvalidCombinationError(global_config, {key, "resume"}, "repeated event loops cannot be resumed");
+        }
+        if(global_config.get<uint64_t>("checkpoint_interval", 0) > 0) {
+            throw InvalidCombinationError(
+                global_config, {key, "checkpoint_interval"}, "repeated event loops do not support checkpoints");
+        }
+        if(global_config.get<bool>("performance_plots", false)) {
+            throw InvalidCombinationError(
+                global_config, {key, "performance_plots"}, "repeated event loops do not support performance plots");
+        }
+        for(const auto* report_key : {"performance_report", "performance_baseline"}) {
+            if(global_config.has(report_key)) {
+                throw InvalidCombinationError(
+                    global_config, {key, report_key}, "repeated event loops do not support performance reports");
+            }
+        }
+    }
+
+    // Benchmarks initialize the modules for the largest number of workers of the sweep
+    if(global_config.has("benchmark_workers")) {
+        auto workers = global_config.get<unsigned int>("benchmark_workers");
+        if(workers < 1) {
+            throw InvalidValueError(global_config, "benchmark_workers", "number of workers should be larger than zero");
+        }
+        global_config.set<bool>("multithreading", true);
+        global_config.set<unsigned int>("workers", workers);
+    }
+
+    // Expand the parameter scan into the module options of all its points, varying the last parameter fastest
+    if(global_config.has("scan_parameters")) {
+        scan_points_.emplace_back();
+        for(const auto& parameter : global_config.getMatrix<std::string>("scan_parameters")) {
+            if(parameter.size() < 2 || parameter.front().find('.') == std::string::npos) {
+                throw InvalidValueError(global_config,
+                                        "scan_parameters",
+                                        "every parameter should list a key of the form Module.key followed by its values");
+            }
+            std::vector<std::vector<std::string>> points;
+            for(const auto& point : scan_points_) {
+                for(auto value = std::next(parameter.begin()); value != parameter.end(); ++value) {
+                    points.push_back(point);
+                    points.back().push_back(parameter.front() + "=" + *value);
+                }
+            }
+            scan_points_ = std::move(points);
+        }
+        LOG(STATUS) << "Scanning " << global_config.getMatrix<std::string>("scan_parameters").size()
+                    << " parameters in " << scan_points_.size() << " points";
+
+        // The first point is configured when loading the modules
+        conf_mgr_->loadModuleOptions(scan_points_.front());
+    }
+
+    // Select the pseudo-random number engine for all generators
+    auto random_engine =
+        global_config.get<RandomNumberGenerator::Engine>("random_engine", RandomNumberGenerator::Engine::MT19937_64);
+    RandomNumberGenerator::setDefaultEngine(random_engine);
+    seeder_modules_.setEngine(random_engine);
+    seeder_core_.setEngine(random_engine);
+    LOG(STATUS) << "Using " << allpix::to_string(random_engine) << " pseudo-random number engine";
+
     uint64_t seed = 0;
     if(global_config.has("random_seed")) {
         // Use provided random seed
@@ -149,14 +375,6 @@ void Allpix::load() {
         global_config.set<uint64_t>("random_seed_core", seed + 1, true);
     }
 
-    // Get output directory
-    std::string directory = gSystem->pwd();
-    directory += "/output";
-    if(global_config.has("output_directory")) {
-        // Use config specified one if available
-        directory = global_config.getPath("output_directory");
-    }
-
     // Use existing output directory if it exists
     bool create_output_dir = true;
     if(std::filesystem::is_directory(directory)) {
@@ -180,6 +398,22 @@ void Allpix::load() {
         LOG(ERROR) << "Cannot create output directory " << directory << ": " << e.what()
                    << ". Using current directory instead.";
     }
+    output_directory_ = gSystem->pwd();
+
+    // List the options of all scan points and write the output of every point to its own subdirectory
+    if(!scan_points_.empty()) {
+        std::ofstream scan_file(std::filesystem::path(output_directory_) / "scan.txt");
+        for(size_t point = 0; point < scan_points_.size(); ++point) {
+            scan_file << "scan_" << point << ":";
+            for(const auto& option : scan_points_[point]) {
+                scan_file << " " << option;
+            }
+            scan_file << std::endl;
+        }
+        enter_subdirectory("scan_0");
+    } else if(global_config.has("benchmark_workers")) {
+        enter_subdirectory("warmup");
+    }
 
     // Enable relevant multithreading safety in ROOT
     // Required for spawned threads, even with a single worker
@@ -217,7 +451,32 @@ void Allpix::initialize() {
  * Runs every modules Module::run() method linearly for the number of events
  */
 void Allpix::run() {
-    if(!terminate_) {
+    if(!terminate_ && !scan_points_.empty()) {
+        LOG(TRACE) << "Running parameter scan";
+        Configuration& global_config = conf_mgr_->getGlobalConfiguration();
+        auto number_of_events = global_config.get<uint64_t>("number_of_events", 1);
+        uint64_t finished_events = 0;
+        for(size_t point = 0; point < scan_points_.size() && !terminate_; ++point) {
+            if(point > 0) {
+                enter_subdirectory("scan_" + std::to_string(point));
+                mod_mgr_->reconfigure(scan_points_[point]);
+            }
+
+            std::string options;
+            for(const auto& option : scan_points_[point]) {
+                options += " " + option;
+            }
+            LOG(STATUS) << "Running scan point " << (point + 1) << " of " << scan_points_.size() << ":" << options;
+
+            // Every point processes the same events with the same seeds
+            finished_events += run_events(number_of_events);
+        }
+        global_config.set<uint64_t>("number_of_events", finished_events);
+    } else if(!terminate_ && conf_mgr_->getGlobalConfiguration().has("server_socket")) {
+        serve();
+    } else if(!terminate_ && conf_mgr_->getGlobalConfiguration().has("benchmark_workers")) {
+        benchmark();
+    } else if(!terminate_) {
         LOG(TRACE) << "Running Allpix";
         mod_mgr_->run(seeder_modules_);
 
@@ -227,6 +486,227 @@ void Allpix::run() {
         LOG(INFO) << "Skip running modules because termination is requested";
     }
 }
+
+/**
+ * The module seeder is reset to the configured seed, such that repeated event loops process the same events
+ */
+uint64_t Allpix::run_events(uint64_t number_of_events) {
+    Configuration& global_config = conf_mgr_->getGlobalConfiguration();
+    seeder_modules_.seed(global_config.get<uint64_t>("random_seed"));
+    global_config.set<uint64_t>("number_of_events", number_of_events);
+    mod_mgr_->run(seeder_modules_);
+    has_run_ = true;
+    return global_config.get<uint64_t>("number_of_events");
+}
+
+/**
+ * All module instantiations are initialized once for the largest number of workers. After the warm-up events, the event
+ * loop is repeated for a number of workers doubling from one up to the largest number, writing the output of every loop to
+ * the subdirectory workers_<n> of the output directory. The parallel efficiency compares the throughput to the one of a
+ * single worker multiplied by the number of workers.
+ */
+void Allpix::benchmark() {
+    Configuration& global_config = conf_mgr_->getGlobalConfiguration();
+    if(!global_config.get<bool>("multithreading")) {
+        throw RuntimeError("Benchmarks require all modules of the configuration to support multithreading");
+    }
+    auto max_workers = global_config.get<unsigned int>("benchmark_workers");
+    auto number_of_events = global_config.get<uint64_t>("number_of_events", 1);
+    auto warmup_events = global_config.get<uint64_t>("benchmark_warmup_events", 10);
+
+    // Warm up lazily initialized module state, caches and the memory allocator of all workers
+    uint64_t finished_events = 0;
+    if(warmup_events > 0) {
+        LOG(STATUS) << "Running " << warmup_events << " warm-up events on " << max_workers << " workers";
+        finished_events += run_events(warmup_events);
+    }
+
+    std::vector<unsigned int> sweep;
+    for(unsigned int workers = 1; workers < max_workers; workers *= 2) {
+        sweep.push_back(workers);
+    }
+    sweep.push_back(max_workers);
+
+    std::vector<ModuleManager::RunStatistics> results;
+    for(auto workers : sweep) {
+        if(terminate_) {
+            break;
+        }
+        enter_subdirectory("workers_" + std::to_string(workers));
+        mod_mgr_->reconfigure({});
+        mod_mgr_->setWorkers(workers);
+
+        LOG(STATUS) << "Running benchmark with " << workers << " workers";
+        finished_events += run_events(number_of_events);
+        results.push_back(mod_mgr_->getRunStatistics());
+    }
+    global_config.set<uint64_t>("number_of_events", finished_events);
+    if(results.empty()) {
+        return;
+    }
+
+    // Summarize the sweep, the time waiting for the event sequence is given per event
+    auto throughput = [](const ModuleManager::RunStatistics& statistics) {
+        return static_cast<double>(statistics.events) / std::max(1e-9, static_cast<double>(statistics.run_time) * 1e-9);
+    };
+    std::stringstream summary;
+    summary << "Benchmark results:" << std::endl
+            << std::setw(8) << "workers" << std::setw(14) << "events/s" << std::setw(12) << "efficiency" << std::setw(16)
+            << "sequence wait" << std::setw(20) << "buffer fill (max)";
+    for(size_t i = 0; i < results.size(); ++i) {
+        const auto& statistics = results[i];
+        auto efficiency = throughput(statistics) / (throughput(results.front()) * sweep[i]);
+        auto sequence_wait = static_cast<double>(statistics.sequence_wait_time) /
+                             static_cast<double>(std::max(uint64_t(1), statistics.events));
+        std::stringstream buffer_fill;
+        buffer_fill << std::fixed << std::setprecision(1) << statistics.mean_buffer_fill << " ("
+                    << statistics.max_buffer_fill << "/" << statistics.buffer_size << ")";
+        summary << std::endl
+                << std::setw(8) << sweep[i] << std::setw(14) << std::fixed << std::setprecision(1) << throughput(statistics)
+                << std::setw(11) << std::setprecision(0) << 100 * efficiency << "%" << std::setw(16)
+                << Units::display(sequence_wait, {"s", "ms", "us"}) << std::setw(20) << buffer_fill.str();
+    }
+    LOG(STATUS) << summary.str();
+
+    // Recommend a buffer holding the peak fill level of the largest number of workers with margin, more if it was full
+    const auto& last = results.back();
+    auto workers = sweep[results.size() - 1];
+    size_t buffer_per_worker = 1;
+    while(static_cast<double>(buffer_per_worker * workers) < 1.5 * static_cast<double>(last.max_buffer_fill)) {
+        buffer_per_worker *= 2;
+    }
+    if(last.max_buffer_fill >= last.buffer_size) {
+        buffer_per_worker = std::max(buffer_per_worker, 2 * last.buffer_size / workers);
+    }
+    LOG(STATUS) << "Recommended buffer_per_worker = " << buffer_per_worker << " for " << workers << " workers";
+}
+
+/**
+ * Requests are read line by line from the clients connected to a local socket, one client at a time. A request
+ * "run <events> [Module.key=value ...]" applies the module options on top of the configuration of the previous requests,
+ * recreates the changed module instantiations and processes the events, writing the output to the subdirectory
+ * request_<n> of the output directory. Every request is answered by a single line, "ok <events> <directory>" or
+ * "error <message>". The request "quit" stops the server.
+ */
+void Allpix::serve() {
+    Configuration& global_config = conf_mgr_->getGlobalConfiguration();
+    auto socket_path = global_config.getPath("server_socket");
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if(socket_path.string().size() >= sizeof(address.sun_path)) {
+        throw InvalidValueError(global_config, "server_socket", "path of the socket is too long");
+    }
+    std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+    // Replace a stale socket of a previous server
+    std::filesystem::remove(socket_path);
+    auto server = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if(server < 0 || ::bind(server, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || // NOLINT
+       ::listen(server, 1) != 0) {
+        if(server >= 0) {
+            ::close(server);
+        }
+        throw RuntimeError("Cannot listen on server socket " + socket_path.string() + ": " + std::strerror(errno));
+    }
+    LOG(STATUS) << "Serving requests on socket " << socket_path;
+    has_run_ = true;
+
+    // Wait for data on a descriptor, returning false if the termination is requested before
+    auto wait_for = [this](int descriptor) {
+        pollfd poll_descriptor{descriptor, POLLIN, 0};
+        while(!terminate_) {
+            if(::poll(&poll_descriptor, 1, 200) > 0) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    uint64_t finished_events = 0;
+    size_t request = 0;
+    bool quit = false;
+    while(!quit && wait_for(server)) {
+        auto client = ::accept(server, nullptr, nullptr);
+        if(client < 0) {
+            continue;
+        }
+        LOG(DEBUG) << "Accepted client on server socket";
+
+        auto reply = [client](const std::string& message) {
+            auto line = message + "\n";
+            for(size_t sent = 0; sent < line.size();) {
+                auto count = ::send(client, line.data() + sent, line.size() - sent, MSG_NOSIGNAL);
+                if(count <= 0) {
+                    break;
+                }
+                sent += static_cast<size_t>(count);
+            }
+        };
+
+        std::string buffer;
+        std::array<char, 4096> data{};
+        while(!quit && wait_for(client)) {
+            auto count = ::recv(client, data.data(), data.size(), 0);
+            if(count <= 0) {
+                break;
+            }
+            buffer.append(data.data(), static_cast<size_t>(count));
+
+            for(auto newline = buffer.find('\n'); !quit && newline != std::string::npos; newline = buffer.find('\n')) {
+                std::istringstream line(buffer.substr(0, newline));
+                buffer.erase(0, newline + 1);
+
+                std::string command;
+                line >> command;
+                if(command.empty()) {
+                    continue;
+                }
+                if(command == "quit") {
+                    reply("ok");
+                    quit = true;
+                    continue;
+                }
+
+                uint64_t number_of_events = 0;
+                if(command != "run" || !(line >> number_of_events)) {
+                    reply("error expected \"run <events> [options]\" or \"quit\"");
+                    continue;
+                }
+                std::vector<std::string> options;
+                for(std::string option; line >> option;) {
+                    options.push_back(option);
+                }
+
+                // Configuration errors of a request are reported to the client, the previous modules are already finalized
+                // and the server thus stops after the reply
+                auto directory = "request_" + std::to_string(request++);
+                LOG(STATUS) << "Running request " << directory << " with " << number_of_events << " events";
+                try {
+                    enter_subdirectory(directory);
+                    mod_mgr_->reconfigure(options);
+                    auto events = run_events(number_of_events);
+                    finished_events += events;
+                    reply("ok " + std::to_string(events) + " " + output_directory_ + "/" + directory);
+                } catch(std::exception& e) {
+                    std::string message = e.what();
+                    std::replace(message.begin(), message.end(), '\n', ' ');
+                    reply("error " + message);
+                    ::close(client);
+                    ::close(server);
+                    throw;
+                }
+            }
+        }
+        ::close(client);
+    }
+
+    ::close(server);
+    std::filesystem::remove(socket_path);
+    global_config.set<uint64_t>("number_of_events", finished_events);
+    LOG(STATUS) << "Stopped serving requests after " << request << " requests";
+}
+
 /**
  * Runs all modules Module::finalize() method linearly for every module
  */
@@ -248,6 +728,17 @@ void Allpix::terminate() {
     mod_mgr_->terminate();
 }
 
+/**
+ * The points of a parameter scan and the requests of the server mode are written to subdirectories of the output directory
+ * of the run
+ */
+void Allpix::enter_subdirectory(const std::string& name) {
+    auto directory = std::filesystem::path(output_directory_) / name;
+    LOG(DEBUG) << "Creating output directory " << directory;
+    std::filesystem::create_directories(directory);
+    gSystem->ChangeDirectory(directory.c_str());
+}
+
 /**
  * This style is inspired by the CLICdp plot style
  */
@@ -18,9 +18,11 @@
 #define ALLPIX_ALLPIX_H
 
 #include <atomic>
+#include <cstdint>
 #include <fstream>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "config/ConfigManager.hpp"
 #include "geometry/GeometryManager.hpp"
@@ -62,6 +64,10 @@ namespace allpix {
         /**
          * @brief Run all modules for the number of events (run)
          * @warning Should be called after the \ref Allpix::initialize "init function"
+         *
+         * For parameter scans, the event loop is run for every point of the scan. In server mode, the event loop is run for
+         * every request received on the server socket, keeping all unchanged module instantiations initialized. Benchmarks
+         * run the event loop for an increasing number of workers.
          */
         void run();
 
@@ -82,10 +88,37 @@ namespace allpix {
          */
         void set_style();
 
+        /**
+         * @brief Create a subdirectory of the output directory and change to it
+         * @param name Name of the subdirectory
+         */
+        void enter_subdirectory(const std::string& name);
+
+        /**
+         * @brief Run the event loop for a number of events, starting from the configured seed
+         * @param number_of_events Number of events to process
+         * @return Number of events finished
+         */
+        uint64_t run_events(uint64_t number_of_events);
+
+        /**
+         * @brief Serve run requests on the configured local socket until a client requests to stop the server
+         */
+        void serve();
+
+        /**
+         * @brief Run the configured events for an increasing number of workers and report the parallel performance
+         */
+        void benchmark();
+
         // Indicate the framework should terminate
         std::atomic<bool> terminate_;
         std::atomic<bool> has_run_;
 
+        // Output directory of the run and module options of all points of a parameter scan
+        std::string output_directory_;
+        std::vector<std::vector<std::string>> scan_points_;
+
         // Log file if specified
         std::ofstream log_file_;
 
@@ -190,10 +190,11 @@ bool ConfigReader::hasConfiguration(std::string name) const {
 
 unsigned int ConfigReader::countConfigurations(std::string name) const {
     std::transform(name.begin(), name.end(), name.begin(), ::tolower);
-    if(!hasConfiguration(name)) {
+    auto iter = conf_map_.find(name);
+    if(iter == conf_map_.end()) {
         return 0;
     }
-    return static_cast<unsigned int>(conf_map_.at(name).size());
+    return static_cast<unsigned int>(iter->second.size());
 }
 
 /**
@@ -224,12 +225,14 @@ Configuration ConfigReader::getHeaderConfiguration() const {
 
 std::vector<Configuration> ConfigReader::getConfigurations(std::string name) const {
     std::transform(name.begin(), name.end(), name.begin(), ::tolower);
-    if(!hasConfiguration(name)) {
+    auto conf_iter = conf_map_.find(name);
+    if(conf_iter == conf_map_.end()) {
         return {};
     }
 
     std::vector<Configuration> result;
-    for(const auto& iter : conf_map_.at(name)) {
+    result.reserve(conf_iter->second.size());
+    for(const auto& iter : conf_iter->second) {
         result.push_back(*iter);
     }
     return result;
@@ -17,6 +17,7 @@
 #include <list>
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "Configuration.hpp"
@@ -123,7 +124,7 @@ namespace allpix {
          */
         void copy_init_map();
 
-        std::map<std::string, std::vector<std::list<Configuration>::iterator>> conf_map_;
+        std::unordered_map<std::string, std::vector<std::list<Configuration>::iterator>> conf_map_;
         std::list<Configuration> conf_array_;
     };
 } // namespace allpix
@@ -13,7 +13,9 @@
 
 #include <cassert>
 #include <filesystem>
+#include <mutex>
 #include <ostream>
+#include <set>
 #include <stdexcept>
 #include <string>
 
@@ -22,6 +24,8 @@
 
 using namespace allpix;
 
+thread_local bool Configuration::report_access_ = false;
+
 Configuration::AccessMarker::AccessMarker(const Configuration::AccessMarker& rhs) {
     for(const auto& [key, value] : rhs.markers_) {
         registerMarker(key);
@@ -63,7 +67,7 @@ unsigned int Configuration::count(std::initializer_list<std::string> keys) const
 std::string Configuration::getText(const std::string& key) const {
     try {
         // NOTE: returning literally including ""
-        used_keys_.markUsed(key);
+        mark_used(key);
         return config_.at(key);
     } catch(std::out_of_range& e) {
         throw MissingKeyError(key, getName());
@@ -210,6 +214,21 @@ std::vector<std::string> Configuration::getUnusedKeys() const {
     return result;
 }
 
+/**
+ * Every key is only reported once per configuration section to limit the output, the module and event of the access are
+ * part of the log message prefix.
+ */
+void Configuration::report_access(const std::string& key) const {
+    static std::mutex reported_mutex;
+    static std::set<std::pair<std::string, std::string>> reported;
+
+    std::lock_guard<std::mutex> lock{reported_mutex};
+    if(reported.emplace(getName(), key).second) {
+        LOG(WARNING) << "Key \"" << key << "\" of section [" << getName() << "] accessed during the event loop, "
+                     << "consider reading its value during initialization";
+    }
+}
+
 /**
  * String is recursively parsed for all pair of [ and ] brackets. All parts between single or double quotation marks are
  * skipped.
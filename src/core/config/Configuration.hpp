@@ -19,6 +19,7 @@
 #include <stdexcept>
 #include <string>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "core/config/exceptions.h"
@@ -28,6 +29,56 @@ namespace allpix {
 
     template <typename T> using Matrix = std::vector<std::vector<T>>;
 
+    /**
+     * @brief Typed handle to a configuration parameter whose value has been converted once
+     *
+     * The handle is obtained via \ref Configuration::getParameter, typically in the constructor or the initialize method of
+     * a module. Reading its value afterwards neither requires a lookup of the key nor a conversion of the string, and can
+     * thus be used in the run method of a module.
+     */
+    template <typename T> class ConfigParameter {
+    public:
+        /**
+         * @brief Construct an empty handle to be assigned later
+         */
+        ConfigParameter() = default;
+
+        /**
+         * @brief Construct a handle holding the value of a key
+         * @param key Key of the parameter
+         * @param value Converted value of the parameter
+         * @param defined Whether the key was defined in the configuration or the default value is used
+         */
+        ConfigParameter(std::string key, T value, bool defined)
+            : key_(std::move(key)), value_(std::move(value)), defined_(defined) {}
+
+        /**
+         * @brief Get the value of the parameter
+         * @return Reference to the value
+         */
+        const T& get() const { return value_; }
+        const T& operator*() const { return value_; }
+        const T* operator->() const { return &value_; }
+        operator const T&() const { return value_; } // NOLINT
+
+        /**
+         * @brief Get the key of the parameter
+         * @return Name of the key
+         */
+        const std::string& key() const { return key_; }
+
+        /**
+         * @brief Check if the key was defined in the configuration
+         * @return False if the default value is used, true otherwise
+         */
+        bool isDefined() const { return defined_; }
+
+    private:
+        std::string key_;
+        T value_{};
+        bool defined_{false};
+    };
+
     /**
      * @brief Generic configuration object storing keys
      *
@@ -141,6 +192,22 @@ namespace allpix {
          */
         template <typename T> T get(const std::string& key, const T& def) const;
 
+        /**
+         * @brief Get a handle holding the value of a key converted to the requested type
+         * @param key Key to get value of
+         * @return Handle to the value of the key
+         * @note Converts the value once, such that the handle can be read in the event loop without any overhead
+         */
+        template <typename T> ConfigParameter<T> getParameter(const std::string& key) const;
+        /**
+         * @brief Get a handle holding the value of a key converted to the requested type or a default value
+         * @param key Key to get value of
+         * @param def Default value to use if key is not defined
+         * @return Handle to the value of the key or to the default value if the key does not exists
+         * @note Converts the value once, such that the handle can be read in the event loop without any overhead
+         */
+        template <typename T> ConfigParameter<T> getParameter(const std::string& key, const T& def) const;
+
         /**
          * @brief Get values for a key containing an array
          * @param key Key to get values of
@@ -319,7 +386,29 @@ namespace allpix {
          */
         std::vector<std::string> getUnusedKeys() const;
 
+        /**
+         * @brief Enable or disable the reporting of key accesses for the calling thread
+         * @param report Whether to log a warning the first time a key of a configuration is accessed
+         *
+         * Used by the framework to find configuration accesses in the event loop, which should be replaced by values read
+         * once during initialization, e.g. via \ref getParameter.
+         */
+        static void setAccessReporting(bool report) { report_access_ = report; }
+
     private:
+        /**
+         * @brief Mark key as used and report the access if requested
+         * @param key Key which is accessed
+         */
+        void mark_used(const std::string& key) const {
+            used_keys_.markUsed(key);
+            if(report_access_) {
+                report_access(key);
+            }
+        }
+        void report_access(const std::string& key) const;
+        static thread_local bool report_access_;
+
         /**
          * @brief Make relative paths absolute from this configuration file
          * @param path Path to make absolute (if it is not already absolute)
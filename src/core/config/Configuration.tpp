@@ -18,7 +18,7 @@ namespace allpix {
     template <typename T> T Configuration::get(const std::string& key) const {
         try {
             auto node = parse_value(config_.at(key));
-            used_keys_.markUsed(key);
+            mark_used(key);
             try {
                 return allpix::from_string<T>(node->value);
             } catch(std::invalid_argument& e) {
@@ -43,6 +43,25 @@ namespace allpix {
         return def;
     }
 
+    /**
+     * @throws MissingKeyError If the requested key is not defined
+     * @throws InvalidKeyError If the conversion to the requested type did not succeed
+     * @throws InvalidKeyError If an overflow happened while converting the key
+     */
+    template <typename T> ConfigParameter<T> Configuration::getParameter(const std::string& key) const {
+        return {key, get<T>(key), true};
+    }
+    /**
+     * @throws InvalidKeyError If the conversion to the requested type did not succeed
+     * @throws InvalidKeyError If an overflow happened while converting the key
+     */
+    template <typename T> ConfigParameter<T> Configuration::getParameter(const std::string& key, const T& def) const {
+        if(has(key)) {
+            return {key, get<T>(key), true};
+        }
+        return {key, def, false};
+    }
+
     /**
      * @throws MissingKeyError If the requested key is not defined
      * @throws InvalidKeyError If the conversion to the requested type did not succeed
@@ -51,7 +70,7 @@ namespace allpix {
     template <typename T> std::vector<T> Configuration::getArray(const std::string& key) const {
         try {
             std::string str = config_.at(key);
-            used_keys_.markUsed(key);
+            mark_used(key);
 
             std::vector<T> array;
             auto node = parse_value(std::move(str));
@@ -90,7 +109,7 @@ namespace allpix {
     template <typename T> Matrix<T> Configuration::getMatrix(const std::string& key) const {
         try {
             std::string str = config_.at(key);
-            used_keys_.markUsed(key);
+            mark_used(key);
 
             Matrix<T> matrix;
             auto node = parse_value(std::move(str));
@@ -9,16 +9,19 @@
  * SPDX-License-Identifier: MIT
  */
 
+#include <algorithm>
 #include <memory>
 #include <stdexcept>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <Math/Rotation3D.h>
 #include <Math/Translation3D.h>
 
 #include "Detector.hpp"
 #include "core/module/exceptions.h"
+#include "tools/liang_barsky.h"
 
 using namespace allpix;
 
@@ -88,6 +91,16 @@ ROOT::Math::XYZPoint Detector::getGlobalPosition(const ROOT::Math::XYZPoint& loc
     return transform_(local_pos);
 }
 
+/**
+ * The line is transformed into the frame of the sensor box, which is centered at the sensor center of the model
+ */
+std::optional<std::pair<double, double>> Detector::getSensorIntersection(const ROOT::Math::XYZPoint& global_pos,
+                                                                         const ROOT::Math::XYZVector& global_dir) const {
+    auto position = getLocalPosition(global_pos) - static_cast<ROOT::Math::XYZVector>(model_->getSensorCenter());
+    auto direction = orientation_.Inverse()(global_dir);
+    return LiangBarsky::intersectionDistances(direction, position, model_->getSensorSize());
+}
+
 /**
  * The pixel has internal information about the size and location specific for this detector
  */
@@ -114,27 +127,91 @@ Pixel Detector::getPixel(const Pixel::Index& index) const {
  * stage). Outside of the sensor the electric field is strictly zero by definition.
  */
 ROOT::Math::XYZVector Detector::getElectricField(const ROOT::Math::XYZPoint& local_pos) const {
+    if(combined_field_.isValid()) {
+        return getElectricFieldAndDoping(local_pos).field;
+    }
     return electric_field_.get(local_pos);
 }
 
+void Detector::getElectricField(
+    const double* x, const double* y, const double* z, size_t count, const std::array<double*, 3>& field) const {
+    if(combined_field_.isValid()) {
+        // Look up the combined grid in blocks, discarding the doping concentration
+        std::array<double, combined_block_size_> concentration{};
+        for(size_t first = 0; first < count; first += combined_block_size_) {
+            auto block = std::min(combined_block_size_, count - first);
+            getElectricFieldAndDoping(x + first,
+                                      y + first,
+                                      z + first,
+                                      block,
+                                      {field[0] + first, field[1] + first, field[2] + first},
+                                      concentration.data());
+        }
+        return;
+    }
+    electric_field_.get(x, y, z, count, field);
+}
+
 /**
  * @throws std::invalid_argument If the electric field dimensions are incorrect or the thickness domain is outside the sensor
  */
-void Detector::setElectricFieldGrid(const std::shared_ptr<std::vector<double>>& field,
+template <typename V>
+void Detector::setElectricFieldGrid(const SharedArray<V>& field,
                                     std::array<size_t, 3> bins,
                                     std::array<double, 3> size,
                                     FieldMapping mapping,
                                     std::array<double, 2> scales,
                                     std::array<double, 2> offset,
-                                    std::pair<double, double> thickness_domain) {
+                                    std::pair<double, double> thickness_domain,
+                                    FieldInterpolation interpolation) {
     check_field_match(size, mapping, scales, thickness_domain);
-    electric_field_.setGrid(field, bins, size, mapping, scales, offset, thickness_domain);
+    electric_field_.setGrid(field, bins, size, mapping, scales, offset, thickness_domain, interpolation);
+    combined_field_ = {};
 }
 
+// Instantiate for double as well as single precision storage of the field
+template void Detector::setElectricFieldGrid<double>(const SharedArray<double>&,
+                                                     std::array<size_t, 3>,
+                                                     std::array<double, 3>,
+                                                     FieldMapping,
+                                                     std::array<double, 2>,
+                                                     std::array<double, 2>,
+                                                     std::pair<double, double>,
+                                                     FieldInterpolation);
+template void Detector::setElectricFieldGrid<float>(const SharedArray<float>&,
+                                                    std::array<size_t, 3>,
+                                                    std::array<double, 3>,
+                                                    FieldMapping,
+                                                    std::array<double, 2>,
+                                                    std::array<double, 2>,
+                                                    std::pair<double, double>,
+                                                    FieldInterpolation);
+
 void Detector::setElectricFieldFunction(FieldFunction<ROOT::Math::XYZVector> function,
                                         std::pair<double, double> thickness_domain,
                                         FieldType type) {
     electric_field_.setFunction(std::move(function), thickness_domain, type);
+    combined_field_ = {};
+}
+
+void Detector::tabulateElectricField(std::array<size_t, 3> bins) {
+    electric_field_.tabulate(bins, {model_->getPixelSize().x(), model_->getPixelSize().y()});
+    combined_field_ = {};
+}
+
+size_t Detector::makeElectricFieldAdaptive(double tolerance) {
+    combined_field_ = {};
+    return electric_field_.makeAdaptive(tolerance);
+}
+
+size_t Detector::makeElectricFieldTiled() {
+    combined_field_ = {};
+    return electric_field_.makeTiled();
+}
+
+bool Detector::useHugePagesForElectricField() {
+    combined_field_ = {};
+    return electric_field_.useHugePages();
 }
 
 /**
@@ -149,27 +226,80 @@ double Detector::getWeightingPotential(const ROOT::Math::XYZPoint& local_pos, co
     return weighting_potential_.getRelativeTo(local_pos, ref, true);
 }
 
+void Detector::getWeightingPotential(const double* x,
+                                     const double* y,
+                                     const double* z,
+                                     size_t count,
+                                     const Pixel::Index& reference,
+                                     double* potential) const {
+    auto ref = static_cast<ROOT::Math::XYPoint>(model_->getPixelCenter(reference.x(), reference.y()));
+    weighting_potential_.getRelativeTo(x, y, z, count, ref, {{potential}}, true);
+}
+
+void Detector::getWeightingPotential(const ROOT::Math::XYZPoint& local_pos,
+                                     const Pixel::Index* references,
+                                     size_t count,
+                                     double* potential) const {
+    // Keep the memory of the pixel centers between calls from the same thread
+    static thread_local std::vector<ROOT::Math::XYPoint> refs;
+    refs.resize(count);
+    for(size_t i = 0; i < count; ++i) {
+        refs[i] = static_cast<ROOT::Math::XYPoint>(model_->getPixelCenter(references[i].x(), references[i].y()));
+    }
+    weighting_potential_.getRelativeTo(local_pos, refs.data(), count, {{potential}}, true);
+}
+
 /**
  * @throws std::invalid_argument If the weighting potential dimensions are incorrect or the thickness domain is outside the
  * sensor
  */
-void Detector::setWeightingPotentialGrid(const std::shared_ptr<std::vector<double>>& potential,
+template <typename V>
+void Detector::setWeightingPotentialGrid(const SharedArray<V>& potential,
                                          std::array<size_t, 3> bins,
                                          std::array<double, 3> size,
                                          FieldMapping mapping,
                                          std::array<double, 2> scales,
                                          std::array<double, 2> offset,
-                                         std::pair<double, double> thickness_domain) {
+                                         std::pair<double, double> thickness_domain,
+                                         FieldInterpolation interpolation) {
     check_field_match(size, mapping, scales, thickness_domain);
-    weighting_potential_.setGrid(potential, bins, size, mapping, scales, offset, thickness_domain);
+    weighting_potential_.setGrid(potential, bins, size, mapping, scales, offset, thickness_domain, interpolation);
 }
 
+// Instantiate for double as well as single precision storage of the field
+template void Detector::setWeightingPotentialGrid<double>(const SharedArray<double>&,
+                                                          std::array<size_t, 3>,
+                                                          std::array<double, 3>,
+                                                          FieldMapping,
+                                                          std::array<double, 2>,
+                                                          std::array<double, 2>,
+                                                          std::pair<double, double>,
+                                                          FieldInterpolation);
+template void Detector::setWeightingPotentialGrid<float>(const SharedArray<float>&,
+                                                         std::array<size_t, 3>,
+                                                         std::array<double, 3>,
+                                                         FieldMapping,
+                                                         std::array<double, 2>,
+                                                         std::array<double, 2>,
+                                                         std::pair<double, double>,
+                                                         FieldInterpolation);
+
 void Detector::setWeightingPotentialFunction(FieldFunction<double> function,
                                              std::pair<double, double> thickness_domain,
                                              FieldType type) {
     weighting_potential_.setFunction(std::move(function), thickness_domain, type);
 }
 
+void Detector::tabulateWeightingPotential(std::array<size_t, 3> bins, std::array<double, 2> size) {
+    weighting_potential_.tabulate(bins, size);
+}
+
+size_t Detector::makeWeightingPotentialAdaptive(double tolerance) { return weighting_potential_.makeAdaptive(tolerance); }
+
+size_t Detector::makeWeightingPotentialTiled() { return weighting_potential_.makeTiled(); }
+
+bool Detector::useHugePagesForWeightingPotential() { return weighting_potential_.useHugePages(); }
+
 // TODO Currently the magnetic field in the detector is fixed to the field vector at it's center position. Change in case a
 // field gradient is needed inside the sensor.
 void Detector::setMagneticField(ROOT::Math::XYZVector b_field) {
@@ -182,37 +312,158 @@ void Detector::setMagneticField(ROOT::Math::XYZVector b_field) {
  */
 ROOT::Math::XYZVector Detector::getMagneticField(const ROOT::Math::XYZPoint&) const { return magnetic_field_; }
 
+void Detector::getMagneticField(
+    const double*, const double*, const double*, size_t count, const std::array<double*, 3>& field) const {
+    std::fill_n(field[0], count, magnetic_field_.x());
+    std::fill_n(field[1], count, magnetic_field_.y());
+    std::fill_n(field[2], count, magnetic_field_.z());
+}
+
+void Detector::replicateFields(unsigned int node, FieldGridCopies& copies) {
+    electric_field_.replicate(node, copies);
+    weighting_potential_.replicate(node, copies);
+    doping_profile_.replicate(node, copies);
+    combined_field_.replicate(node, copies);
+}
+
 /**
  * The doping profile is replicated for all pixels and uses flipping at each boundary (side effects are not modeled in this
  * stage). Outside of the sensor the doping profile is strictly zero by definition.
  */
 double Detector::getDopingConcentration(const ROOT::Math::XYZPoint& pos) const {
+    if(combined_field_.isValid()) {
+        return combined_field_.get(pos, true).doping;
+    }
     // Extrapolate doping profile if outside defined field:
     return doping_profile_.get(pos, true);
 }
 
+void Detector::getDopingConcentration(
+    const double* x, const double* y, const double* z, size_t count, double* concentration) const {
+    if(combined_field_.isValid()) {
+        // Look up the combined grid in blocks, discarding the electric field
+        std::array<double, combined_block_size_> field_x{}, field_y{}, field_z{};
+        for(size_t first = 0; first < count; first += combined_block_size_) {
+            auto block = std::min(combined_block_size_, count - first);
+            combined_field_.get(x + first,
+                                y + first,
+                                z + first,
+                                block,
+                                {field_x.data(), field_y.data(), field_z.data(), concentration + first},
+                                true);
+        }
+        return;
+    }
+    doping_profile_.get(x, y, z, count, {{concentration}}, true);
+}
+
 /**
  * @throws std::invalid_argument If the doping profile dimensions are incorrect
  *
  * The doping profile is stored as a large flat array. If the sizes are denoted as respectively X_SIZE, Y_ SIZE and Z_SIZE,
  * each position (x, y, z) has one index, calculated as x*Y_SIZE*Z_SIZE+y*Z_SIZE+z
  */
-void Detector::setDopingProfileGrid(std::shared_ptr<std::vector<double>> field,
+template <typename V>
+void Detector::setDopingProfileGrid(SharedArray<V> field,
                                     std::array<size_t, 3> bins,
                                     std::array<double, 3> size,
                                     FieldMapping mapping,
                                     std::array<double, 2> scales,
                                     std::array<double, 2> offset,
-                                    std::pair<double, double> thickness_domain) {
+                                    std::pair<double, double> thickness_domain,
+                                    FieldInterpolation interpolation) {
     check_field_match(size, mapping, scales, thickness_domain);
-    doping_profile_.setGrid(std::move(field), bins, size, mapping, scales, offset, thickness_domain);
+    doping_profile_.setGrid(std::move(field), bins, size, mapping, scales, offset, thickness_domain, interpolation);
+    combined_field_ = {};
 }
 
+// Instantiate for double as well as single precision storage of the field
+template void Detector::setDopingProfileGrid<double>(SharedArray<double>,
+                                                     std::array<size_t, 3>,
+                                                     std::array<double, 3>,
+                                                     FieldMapping,
+                                                     std::array<double, 2>,
+                                                     std::array<double, 2>,
+                                                     std::pair<double, double>,
+                                                     FieldInterpolation);
+template void Detector::setDopingProfileGrid<float>(SharedArray<float>,
+                                                    std::array<size_t, 3>,
+                                                    std::array<double, 3>,
+                                                    FieldMapping,
+                                                    std::array<double, 2>,
+                                                    std::array<double, 2>,
+                                                    std::pair<double, double>,
+                                                    FieldInterpolation);
+
 void Detector::setDopingProfileFunction(FieldFunction<double> function, FieldType type) {
     doping_profile_.setFunction(std::move(function),
                                 {model_->getSensorCenter().z() - model_->getSensorSize().z() / 2,
                                  model_->getSensorCenter().z() + model_->getSensorSize().z() / 2},
                                 type);
+    combined_field_ = {};
+}
+
+/**
+ * @throws std::invalid_argument If a field grid is not mapped to the pixel cell or the binning is invalid
+ *
+ * Both fields are evaluated relative to the center of their pixel cell at the centers of all cells of the combined grid,
+ * which spans one pixel cell and the full sensor thickness. The electric field is zero outside of its thickness domain, the
+ * doping profile is extrapolated as for its regular lookups.
+ */
+void Detector::combineElectricFieldAndDoping(std::array<size_t, 3> bins) {
+    if((electric_field_.getType() == FieldType::GRID && electric_field_.getMapping() == FieldMapping::SENSOR) ||
+       (doping_profile_.getType() == FieldType::GRID && doping_profile_.getMapping() == FieldMapping::SENSOR)) {
+        throw std::invalid_argument("combining fields requires fields mapped to the pixel cell");
+    }
+
+    DetectorField<FieldAndDoping, 4> combined(model_);
+    combined.setFunction(
+        [this](const ROOT::Math::XYZPoint& pos) {
+            return FieldAndDoping(electric_field_.getRelativeTo(pos, {0, 0}),
+                                  doping_profile_.getRelativeTo(pos, {0, 0}, true));
+        },
+        {model_->getSensorCenter().z() - model_->getSensorSize().z() / 2,
+         model_->getSensorCenter().z() + model_->getSensorSize().z() / 2});
+    combined.tabulate(bins, {model_->getPixelSize().x(), model_->getPixelSize().y()});
+    combined_field_ = std::move(combined);
+}
+
+FieldAndDoping Detector::getElectricFieldAndDoping(const ROOT::Math::XYZPoint& local_pos) const {
+    if(!combined_field_.isValid()) {
+        return {getElectricField(local_pos), getDopingConcentration(local_pos)};
+    }
+
+    // The doping profile is extrapolated, while the electric field vanishes outside of the sensor
+    auto values = combined_field_.get(local_pos, true);
+    const auto& [z_min, z_max] = combined_field_.thickness_domain_;
+    if(local_pos.z() < z_min || z_max < local_pos.z()) {
+        values.field = {};
+    }
+    return values;
+}
+
+void Detector::getElectricFieldAndDoping(const double* x,
+                                         const double* y,
+                                         const double* z,
+                                         size_t count,
+                                         const std::array<double*, 3>& field,
+                                         double* concentration) const {
+    if(!combined_field_.isValid()) {
+        electric_field_.get(x, y, z, count, field);
+        doping_profile_.get(x, y, z, count, {{concentration}}, true);
+        return;
+    }
+
+    // The doping profile is extrapolated, while the electric field vanishes outside of the sensor
+    combined_field_.get(x, y, z, count, {field[0], field[1], field[2], concentration}, true);
+    const auto& [z_min, z_max] = combined_field_.thickness_domain_;
+    for(size_t i = 0; i < count; ++i) {
+        if(z[i] < z_min || z_max < z[i]) {
+            field[0][i] = 0;
+            field[1][i] = 0;
+            field[2][i] = 0;
+        }
+    }
 }
 
 void Detector::check_field_match(std::array<double, 3> size,
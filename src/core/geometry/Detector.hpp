@@ -16,6 +16,7 @@
 #include <functional>
 #include <map>
 #include <memory>
+#include <optional>
 #include <string>
 #include <tuple>
 #include <typeindex>
@@ -90,6 +91,16 @@ namespace allpix {
          */
         ROOT::Math::XYZPoint getGlobalPosition(const ROOT::Math::XYZPoint& local_pos) const;
 
+        /**
+         * @brief Calculate the intersection of a line in the global frame with the sensor
+         * @param global_pos A point on the line in the global frame
+         * @param global_dir Direction of the line in the global frame
+         * @return Pair of signed distances from the point to the entry and exit points along the line in units of the length
+         * of the direction, or std::nullopt if the line does not intersect with the sensor
+         */
+        std::optional<std::pair<double, double>> getSensorIntersection(const ROOT::Math::XYZPoint& global_pos,
+                                                                       const ROOT::Math::XYZVector& global_dir) const;
+
         /**
          * @brief Return a pixel object from the x- and y-index values
          * @return Pixel object
@@ -113,15 +124,34 @@ namespace allpix {
          * @return The type of the electric field
          */
         FieldType getElectricFieldType() const { return electric_field_.getType(); }
+        /**
+         * @brief Return the mapping of the electric field grid onto the pixel plane
+         * @return The mapping of the electric field
+         */
+        FieldMapping getElectricFieldMapping() const { return electric_field_.getMapping(); }
         /**
          * @brief Get the electric field in the sensor at a local position
          * @param local_pos Position in the local frame
          * @return Vector of the field at the queried point
          */
         ROOT::Math::XYZVector getElectricField(const ROOT::Math::XYZPoint& local_pos) const;
+        /**
+         * @brief Get the electric field in the sensor at multiple local positions
+         * @param x Pointer to the x coordinates of the positions in the local frame
+         * @param y Pointer to the y coordinates of the positions in the local frame
+         * @param z Pointer to the z coordinates of the positions in the local frame
+         * @param count Number of positions
+         * @param field Pointers to the storage of the x, y and z components of the field at all positions
+         */
+        void getElectricField(const double* x,
+                              const double* y,
+                              const double* z,
+                              size_t count,
+                              const std::array<double*, 3>& field) const;
 
         /**
          * @brief Set the electric field in a single pixel in the detector using a grid
+         * @tparam V Type of the stored field values, double or float for single precision storage
          * @param field Flat array of the field vectors (see detailed description)
          * @param bins The dimensions of the flat electric field array
          * @param size Size of the electric field along the three dimensions of the field map
@@ -129,14 +159,17 @@ namespace allpix {
          * @param scales Scaling factors for the field size, given in fractions of the field size in x and y
          * @param offset Offset of the field, given in fractions of the field size in x and y
          * @param thickness_domain Domain in local coordinates in the thickness direction where the field holds
+         * @param interpolation Interpolation of the field between the grid points
          */
-        void setElectricFieldGrid(const std::shared_ptr<std::vector<double>>& field,
+        template <typename V>
+        void setElectricFieldGrid(const SharedArray<V>& field,
                                   std::array<size_t, 3> bins,
                                   std::array<double, 3> size,
                                   FieldMapping mapping,
                                   std::array<double, 2> scales,
                                   std::array<double, 2> offset,
-                                  std::pair<double, double> thickness_domain);
+                                  std::pair<double, double> thickness_domain,
+                                  FieldInterpolation interpolation = FieldInterpolation::NEAREST);
         /**
          * @brief Set the electric field in a single pixel using a function
          * @param function Function used to retrieve the electric field
@@ -146,6 +179,27 @@ namespace allpix {
         void setElectricFieldFunction(FieldFunction<ROOT::Math::XYZVector> function,
                                       std::pair<double, double> thickness_domain,
                                       FieldType type = FieldType::CUSTOM);
+        /**
+         * @brief Sample the electric field function onto a grid spanning a single pixel
+         * @param bins Number of grid cells in x, y and z
+         */
+        void tabulateElectricField(std::array<size_t, 3> bins);
+        /**
+         * @brief Convert the electric field grid into a sparse hierarchical grid
+         * @param tolerance Maximum deviation from the original grid relative to the largest field component
+         * @return Number of values stored in the converted grid
+         */
+        size_t makeElectricFieldAdaptive(double tolerance);
+        /**
+         * @brief Reorder the electric field grid into bricks of neighboring cells stored contiguously
+         * @return Number of values stored in the reordered grid
+         */
+        size_t makeElectricFieldTiled();
+        /**
+         * @brief Move the electric field grid into memory backed by transparent huge pages
+         * @return True if the operating system has been advised to use huge pages, false otherwise
+         */
+        bool useHugePagesForElectricField();
 
         /**
          * @brief Returns if the detector has a doping profile in the sensor
@@ -158,15 +212,31 @@ namespace allpix {
          * @return The type of the doping profile
          */
         FieldType getDopingProfileType() const { return doping_profile_.getType(); }
+        /**
+         * @brief Return the mapping of the doping profile grid onto the pixel plane
+         * @return The mapping of the doping profile
+         */
+        FieldMapping getDopingProfileMapping() const { return doping_profile_.getMapping(); }
         /**
          * @brief Get the doping profile in the sensor at a local position
          * @param pos Position in the local frame
          * @return Value of the field at the queried point
          */
         double getDopingConcentration(const ROOT::Math::XYZPoint& local_pos) const;
+        /**
+         * @brief Get the doping profile in the sensor at multiple local positions
+         * @param x Pointer to the x coordinates of the positions in the local frame
+         * @param y Pointer to the y coordinates of the positions in the local frame
+         * @param z Pointer to the z coordinates of the positions in the local frame
+         * @param count Number of positions
+         * @param concentration Pointer to the storage of the doping concentration at all positions
+         */
+        void getDopingConcentration(const double* x, const double* y, const double* z, size_t count, double* concentration)
+            const;
 
         /**
          * @brief Set the doping profile in a single pixel in the detector using a grid
+         * @tparam V Type of the stored field values, double or float for single precision storage
          * @param field Flat array of the field (see detailed description)
          * @param bins The dimensions of the flat doping profile array
          * @param size Size of the doping profile along the three dimensions of the field map
@@ -174,14 +244,17 @@ namespace allpix {
          * @param scales Scaling factors for the field size, given in fractions of a pixel unit cell in x and y
          * @param offset Offset of the field, given in fractions of the field size in x and y
          * @param thickness_domain Domain in local coordinates in the thickness direction where the profile holds
+         * @param interpolation Interpolation of the field between the grid points
          */
-        void setDopingProfileGrid(std::shared_ptr<std::vector<double>> field,
+        template <typename V>
+        void setDopingProfileGrid(SharedArray<V> field,
                                   std::array<size_t, 3> bins,
                                   std::array<double, 3> size,
                                   FieldMapping mapping,
                                   std::array<double, 2> scales,
                                   std::array<double, 2> offset,
-                                  std::pair<double, double> thickness_domain);
+                                  std::pair<double, double> thickness_domain,
+                                  FieldInterpolation interpolation = FieldInterpolation::NEAREST);
         /**
          * @brief Set the doping profile in a single pixel using a function
          * @param function Function used to retrieve the doping profile
@@ -189,6 +262,42 @@ namespace allpix {
          */
         void setDopingProfileFunction(FieldFunction<double> function, FieldType type = FieldType::CUSTOM);
 
+        /**
+         * @brief Resample the electric field and the doping profile onto a combined grid spanning a single pixel cell
+         * @param bins Number of grid cells in x, y and z
+         * @throws std::invalid_argument If a field grid is not mapped to the pixel cell or the binning is invalid
+         *
+         * The values of both fields are stored interleaved per grid cell and all subsequent lookups of the electric field
+         * and the doping concentration are interpolated from the combined grid. Setting either field again removes the grid.
+         */
+        void combineElectricFieldAndDoping(std::array<size_t, 3> bins);
+        /**
+         * @brief Returns if the electric field and doping profile are looked up from a combined grid
+         * @return True if the fields have been combined, false otherwise
+         */
+        bool hasCombinedElectricFieldAndDoping() const { return combined_field_.isValid(); }
+        /**
+         * @brief Get the electric field and the doping concentration in the sensor at a local position
+         * @param local_pos Position in the local frame
+         * @return Field vector and doping concentration at the queried point, from a single grid lookup if combined
+         */
+        FieldAndDoping getElectricFieldAndDoping(const ROOT::Math::XYZPoint& local_pos) const;
+        /**
+         * @brief Get the electric field and the doping concentration in the sensor at multiple local positions
+         * @param x Pointer to the x coordinates of the positions in the local frame
+         * @param y Pointer to the y coordinates of the positions in the local frame
+         * @param z Pointer to the z coordinates of the positions in the local frame
+         * @param count Number of positions
+         * @param field Pointers to the storage of the x, y and z components of the field at all positions
+         * @param concentration Pointer to the storage of the doping concentration at all positions
+         */
+        void getElectricFieldAndDoping(const double* x,
+                                       const double* y,
+                                       const double* z,
+                                       size_t count,
+                                       const std::array<double*, 3>& field,
+                                       double* concentration) const;
+
         /**
          * @brief Returns if the detector has a weighting potential in the sensor
          * @return True if the detector has a weighting potential, false otherwise
@@ -208,9 +317,36 @@ namespace allpix {
          * @return Value of the potential at the queried point
          */
         double getWeightingPotential(const ROOT::Math::XYZPoint& local_pos, const Pixel::Index& reference) const;
+        /**
+         * @brief Get the weighting potential in the sensor at multiple local positions
+         * @param x Pointer to the x coordinates of the positions in the local frame
+         * @param y Pointer to the y coordinates of the positions in the local frame
+         * @param z Pointer to the z coordinates of the positions in the local frame
+         * @param count Number of positions
+         * @param reference Index of the pixel for which we want the weighting potential
+         * @param potential Pointer to the storage of the potential at all positions
+         */
+        void getWeightingPotential(const double* x,
+                                   const double* y,
+                                   const double* z,
+                                   size_t count,
+                                   const Pixel::Index& reference,
+                                   double* potential) const;
+        /**
+         * @brief Get the weighting potential of multiple pixels in the sensor at a local position
+         * @param local_pos Position in the local frame
+         * @param references Pointer to the indices of the pixels for which we want the weighting potential
+         * @param count Number of pixels
+         * @param potential Pointer to the storage of the potential of all pixels
+         */
+        void getWeightingPotential(const ROOT::Math::XYZPoint& local_pos,
+                                   const Pixel::Index* references,
+                                   size_t count,
+                                   double* potential) const;
 
         /**
          * @brief Set the weighting potential in a single pixel in the detector using a grid
+         * @tparam V Type of the stored field values, double or float for single precision storage
          * @param potential Flat array of the potential vectors (see detailed description)
          * @param bins The dimensions of the flat weighting potential array
          * @param size Size of the weighting potential along the three dimensions of the field map
@@ -218,14 +354,17 @@ namespace allpix {
          * @param scales Scaling factors for the field size, given in fractions of a pixel unit cell in x and y
          * @param offset Offset of the field, given in fractions of the field size in x and y
          * @param thickness_domain Domain in local coordinates in the thickness direction where the potential holds
+         * @param interpolation Interpolation of the field between the grid points
          */
-        void setWeightingPotentialGrid(const std::shared_ptr<std::vector<double>>& potential,
+        template <typename V>
+        void setWeightingPotentialGrid(const SharedArray<V>& potential,
                                        std::array<size_t, 3> bins,
                                        std::array<double, 3> size,
                                        FieldMapping mapping,
                                        std::array<double, 2> scales,
                                        std::array<double, 2> offset,
-                                       std::pair<double, double> thickness_domain);
+                                       std::pair<double, double> thickness_domain,
+                                       FieldInterpolation interpolation = FieldInterpolation::NEAREST);
         /**
          * @brief Set the weighting potential in a single pixel using a function
          * @param function Function used to retrieve the weighting potential
@@ -235,6 +374,28 @@ namespace allpix {
         void setWeightingPotentialFunction(FieldFunction<double> function,
                                            std::pair<double, double> thickness_domain,
                                            FieldType type = FieldType::CUSTOM);
+        /**
+         * @brief Sample the weighting potential function onto a grid centered around the reference pixel
+         * @param bins Number of grid cells in x, y and z
+         * @param size Extent of the grid in x and y, outside of which the weighting potential is zero
+         */
+        void tabulateWeightingPotential(std::array<size_t, 3> bins, std::array<double, 2> size);
+        /**
+         * @brief Convert the weighting potential grid into a sparse hierarchical grid
+         * @param tolerance Maximum deviation from the original grid relative to the largest value of the potential
+         * @return Number of values stored in the converted grid
+         */
+        size_t makeWeightingPotentialAdaptive(double tolerance);
+        /**
+         * @brief Reorder the weighting potential grid into bricks of neighboring cells stored contiguously
+         * @return Number of values stored in the reordered grid
+         */
+        size_t makeWeightingPotentialTiled();
+        /**
+         * @brief Move the weighting potential grid into memory backed by transparent huge pages
+         * @return True if the operating system has been advised to use huge pages, false otherwise
+         */
+        bool useHugePagesForWeightingPotential();
 
         /**
          * @brief Set the magnetic field in the detector
@@ -253,6 +414,27 @@ namespace allpix {
          * @return Vector of the field at the queried point
          */
         ROOT::Math::XYZVector getMagneticField(const ROOT::Math::XYZPoint& local_pos) const;
+        /**
+         * @brief Get the magnetic field in the sensor at multiple local positions
+         * @param x Pointer to the x coordinates of the positions in the local frame
+         * @param y Pointer to the y coordinates of the positions in the local frame
+         * @param z Pointer to the z coordinates of the positions in the local frame
+         * @param count Number of positions
+         * @param field Pointers to the storage of the x, y and z components of the field at all positions
+         */
+        void getMagneticField(const double* x,
+                              const double* y,
+                              const double* z,
+                              size_t count,
+                              const std::array<double*, 3>& field) const;
+
+        /**
+         * @brief Create copies of all field grids in memory local to the NUMA node of the calling thread
+         * @param node Index of the NUMA node the calling thread is pinned to
+         * @param copies Grid copies already created on this node, shared between fields and detectors using the same grid
+         * @note Called by the framework before the event processing starts, threads pinned to this node read from the copies
+         */
+        void replicateFields(unsigned int node, FieldGridCopies& copies);
 
         /**
          * @brief Get the model of this detector
@@ -313,6 +495,11 @@ namespace allpix {
 
         // Doping profile properties
         DetectorField<double, 1> doping_profile_;
+
+        // Electric field and doping profile resampled onto a common grid
+        DetectorField<FieldAndDoping, 4> combined_field_;
+        // Number of positions looked up at once from the combined grid when only one of the fields is requested
+        static constexpr size_t combined_block_size_ = 64;
     };
 
 } // namespace allpix
@@ -12,8 +12,19 @@
 #ifndef ALLPIX_DETECTOR_FIELD_H
 #define ALLPIX_DETECTOR_FIELD_H
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <cmath>
+#include <exception>
 #include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include <Math/Point2D.h>
@@ -22,6 +33,10 @@
 #include <Math/Vector3D.h>
 
 #include "DetectorModel.hpp"
+#include "PixelDetectorModel.hpp"
+#include "core/utils/huge_pages.h"
+#include "core/utils/numa.h"
+#include "core/utils/shared_array.h"
 #include "objects/Pixel.hpp"
 #include "tools/ROOT.h"
 
@@ -61,12 +76,25 @@ namespace allpix {
                 ///< mirrored at its edges.
     };
 
+    /**
+     * @brief Interpolation of field grids between the grid points
+     */
+    enum class FieldInterpolation {
+        NEAREST = 0, ///< Value of the grid cell containing the position
+        LINEAR,      ///< Trilinear interpolation between the centers of the neighboring grid cells
+    };
+
     /**
      * @brief Functor returning the field at a given position
      * @param pos Position in local coordinates at which the field should be evaluated
      */
     template <typename T = ROOT::Math::XYZVector> using FieldFunction = std::function<T(const ROOT::Math::XYZPoint& pos)>;
 
+    /**
+     * @brief Copies of field grids created on one NUMA node, indexed by the original grid of either precision
+     */
+    using FieldGridCopies = std::map<const void*, std::shared_ptr<void>>;
+
     /**
      * @brief Helper function to invert the field vector when flipping the field direction at pixel/field boundaries
      * @param field Field value, templated to support vector fields and scalar fields
@@ -88,6 +116,59 @@ namespace allpix {
      */
     template <> inline void flip_vector_components<double>(double&, bool, bool) {}
 
+    /**
+     * @brief Helper function to store the components of a field value in a flat array
+     * @param field Field value, templated to support vector fields and scalar fields
+     * @param values Pointer to the storage of the field components
+     */
+    template <typename T> void store_field_components(const T& field, double* values);
+
+    /*
+     * Vector field template specialization of helper function for storing the field components
+     */
+    template <>
+    inline void store_field_components<ROOT::Math::XYZVector>(const ROOT::Math::XYZVector& vec, double* values) {
+        values[0] = vec.x();
+        values[1] = vec.y();
+        values[2] = vec.z();
+    }
+
+    /*
+     * Scalar field template specialization of helper function for storing the field components
+     */
+    template <> inline void store_field_components<double>(const double& field, double* values) { values[0] = field; }
+
+    /**
+     * @brief Electric field and doping concentration at a position, stored interleaved per cell of a combined field grid
+     *
+     * The four values are stored as [Ex, Ey, Ez, doping] for every grid cell, such that a single lookup of the grid cell
+     * provides both quantities.
+     */
+    struct FieldAndDoping {
+        FieldAndDoping() = default;
+        FieldAndDoping(double x, double y, double z, double concentration) : field(x, y, z), doping(concentration) {}
+        FieldAndDoping(const ROOT::Math::XYZVector& vector, double concentration) : field(vector), doping(concentration) {}
+
+        ROOT::Math::XYZVector field;
+        double doping{};
+    };
+
+    /*
+     * Combined field template specialization of helper function for field flipping
+     * Only the components of the electric field are inverted, the doping concentration is a scalar
+     */
+    template <> inline void flip_vector_components<FieldAndDoping>(FieldAndDoping& values, bool x, bool y) {
+        flip_vector_components(values.field, x, y);
+    }
+
+    /*
+     * Combined field template specialization of helper function for storing the field components
+     */
+    template <> inline void store_field_components<FieldAndDoping>(const FieldAndDoping& values, double* components) {
+        store_field_components(values.field, components);
+        components[3] = values.doping;
+    }
+
     /**
      * @brief Field instance of a detector
      *
@@ -103,6 +184,12 @@ namespace allpix {
          */
         DetectorField() = default;
 
+        /**
+         * @brief Constructs a detector field for a detector model
+         * @param model The detector model the field is used for
+         */
+        explicit DetectorField(std::shared_ptr<DetectorModel> model) : model_(std::move(model)) {}
+
         /**
          * @brief Check if the field is valid and either a field grid or a field function is configured
          * @return Boolean indicating field validity
@@ -116,6 +203,13 @@ namespace allpix {
          */
         FieldType getType() const { return type_; }
 
+        /**
+         * @brief Return the mapping of the field grid onto the pixel plane
+         * @note Field functions are always evaluated relative to the pixel center
+         * @return The mapping of the field
+         */
+        FieldMapping getMapping() const { return mapping_; }
+
         /**
          * @brief Get the field value in the sensor at a position provided in local coordinates
          * @param local_pos Position in the local frame
@@ -135,23 +229,75 @@ namespace allpix {
                         const ROOT::Math::XYPoint& reference,
                         const bool extrapolate_z = false) const;
 
+        /**
+         * @brief Get the field values in the sensor at multiple positions provided in local coordinates
+         * @param x Pointer to the x coordinates of the positions in the local frame
+         * @param y Pointer to the y coordinates of the positions in the local frame
+         * @param z Pointer to the z coordinates of the positions in the local frame
+         * @param count Number of positions
+         * @param values Pointers to the storage of each of the N field components at all positions
+         * @param extrapolate_z Extrapolate the field along z when outside the defined region
+         */
+        void get(const double* x,
+                 const double* y,
+                 const double* z,
+                 const size_t count,
+                 const std::array<double*, N>& values,
+                 const bool extrapolate_z = false) const;
+
+        /**
+         * @brief Get the field values at multiple positions provided in local coordinates with respect to the reference
+         * @param x Pointer to the x coordinates of the positions in the local frame
+         * @param y Pointer to the y coordinates of the positions in the local frame
+         * @param z Pointer to the z coordinates of the positions in the local frame
+         * @param count Number of positions
+         * @param reference Reference position to calculate the field for, x and y coordinate only
+         * @param values Pointers to the storage of each of the N field components at all positions
+         * @param extrapolate_z Extrapolate the field along z when outside the defined region
+         */
+        void getRelativeTo(const double* x,
+                           const double* y,
+                           const double* z,
+                           const size_t count,
+                           const ROOT::Math::XYPoint& reference,
+                           const std::array<double*, N>& values,
+                           const bool extrapolate_z = false) const;
+
+        /**
+         * @brief Get the field values at a position provided in local coordinates with respect to multiple references
+         * @param local_pos Position in the local frame
+         * @param references Pointer to the reference positions to calculate the field for, x and y coordinate only
+         * @param count Number of reference positions
+         * @param values Pointers to the storage of each of the N field components for all reference positions
+         * @param extrapolate_z Extrapolate the field along z when outside the defined region
+         */
+        void getRelativeTo(const ROOT::Math::XYZPoint& local_pos,
+                           const ROOT::Math::XYPoint* references,
+                           const size_t count,
+                           const std::array<double*, N>& values,
+                           const bool extrapolate_z = false) const;
+
         /**
          * @brief Set the field in the detector using a grid
-         * @param field Flat array of the field
+         * @tparam V Type of the stored field values, double or float for single precision storage
+         * @param field Flat array of the field, either held in a vector or in a memory mapping
          * @param bins The bins of the flat field array
          * @param size Physical extent of the field
          * @param mapping Specification of the mapping of the field onto the pixel plane
          * @param scales Scaling factors for the field size, given in fractions of the field size in x and y
          * @param offset Offset of the field from the pixel center, given in fractions of the field size in x and y
          * @param thickness_domain Domain in local coordinates in the thickness direction where the field holds
+         * @param interpolation Interpolation of the field between the grid points
          */
-        void setGrid(std::shared_ptr<std::vector<double>> field,
+        template <typename V>
+        void setGrid(SharedArray<V> field,
                      std::array<size_t, 3> bins,
                      std::array<double, 3> size,
                      FieldMapping mapping,
                      std::array<double, 2> scales,
                      std::array<double, 2> offset,
-                     std::pair<double, double> thickness_domain);
+                     std::pair<double, double> thickness_domain,
+                     FieldInterpolation interpolation = FieldInterpolation::NEAREST);
         /**
          * @brief Set the field in the detector using a function
          * @param function Function used to calculate the field
@@ -162,6 +308,59 @@ namespace allpix {
                          std::pair<double, double> thickness_domain,
                          FieldType type = FieldType::CUSTOM);
 
+        /**
+         * @brief Sample the field function onto a grid, from which the field is interpolated in all subsequent lookups
+         * @param bins Number of grid cells in x, y and z, fields depending on z only are sampled in z only
+         * @param size Extent of the grid in x and y, centered around the reference position of the field function
+         * @note The type of the field is kept to allow for the checks in the modules requesting it. Constant fields and
+         * field grids are not sampled.
+         */
+        void tabulate(std::array<size_t, 3> bins, std::array<double, 2> size);
+
+        /**
+         * @brief Check if the field function has been sampled onto a grid
+         * @return True if the field is looked up from a sampled grid, false otherwise
+         */
+        bool isTabulated() const { return tabulated_; }
+
+        /**
+         * @brief Convert the field grid into a sparse hierarchical grid, storing fewer cells where the field varies little
+         * @param tolerance Maximum deviation of any field component from the original grid, relative to the largest
+         * absolute field component on the grid
+         * @return Number of values stored in the converted grid
+         *
+         * The grid is divided into bricks of 8x8x8 cells. Every brick is stored with the coarsest of 1, 2, 4 or 8 cells
+         * per axis for which the average of the original cells represented by each stored cell deviates by no more than
+         * the tolerance from any of them. Only field grids are converted, the conversion is reset when setting a new grid.
+         */
+        size_t makeAdaptive(double tolerance);
+
+        /**
+         * @brief Check if the field grid is stored as sparse hierarchical grid
+         * @return True if the grid has been converted by \ref makeAdaptive, false otherwise
+         */
+        bool isAdaptive() const { return !brick_levels_.empty(); }
+
+        /**
+         * @brief Reorder the field grid into bricks of 8x8x8 cells, each of which is stored contiguously
+         * @return Number of values stored in the reordered grid
+         *
+         * Neighboring cells along all axes are then located close to each other in memory. The grid is stored without loss
+         * in the layout of the sparse hierarchical grid with all bricks at the finest level, such that it is looked up
+         * transparently and reported as adaptive. Only field grids are reordered, the layout is reset when setting a new
+         * grid.
+         */
+        size_t makeTiled();
+
+        /**
+         * @brief Move the field grid into memory backed by transparent huge pages
+         * @return True if the operating system has been advised to back the grid with huge pages, false otherwise
+         *
+         * The grid, its conversions by \ref makeAdaptive or \ref makeTiled and its replicas are then allocated aligned to
+         * huge pages. Only field grids are moved, the setting is reset when setting a new grid.
+         */
+        bool useHugePages();
+
     private:
         /**
          * @brief Set the detector model this field is used for
@@ -170,11 +369,104 @@ namespace allpix {
         void set_model(const std::shared_ptr<DetectorModel>& model) { model_ = model; }
 
         /**
-         * @brief Helper function to retrieve the return type from a calculated index of the field data vector
-         * @param offset The calculated global index to start from
+         * @brief Copy the field grid into memory local to the NUMA node of the calling thread
+         * @param node Index of the NUMA node the calling thread is pinned to
+         * @param copies Copies already created on this node, to share the replica of grids shared between fields
+         * @note Not thread-safe, all replicas need to be created before the field is accessed concurrently
+         */
+        void replicate(unsigned int node, FieldGridCopies& copies);
+
+        /**
+         * @brief Get the field grid to read from on the calling thread
+         * @tparam V Type of the stored field values
+         * @return Replica of the field grid for the NUMA node of this thread if available, the original grid otherwise
+         */
+        template <typename V> const SharedArray<V>& grid() const noexcept {
+            const auto& [field, replicas] = storage<V>();
+            auto node = current_numa_node();
+            return (node < replicas.size() && replicas[node] ? replicas[node] : field);
+        }
+
+        /// @{
+        /**
+         * @brief Get the storage of the field grid and its replicas for the given type of field values
+         * @tparam V Type of the stored field values, double or float
+         * @return Pair of references to the grid and its replicas
+         */
+        template <typename V> auto storage() const noexcept {
+            static_assert(std::is_same_v<V, double> || std::is_same_v<V, float>, "field values are double or float");
+            if constexpr(std::is_same_v<V, float>) {
+                return std::tie(field_single_, replicas_single_);
+            } else {
+                return std::tie(field_, replicas_);
+            }
+        }
+        template <typename V> auto storage() noexcept {
+            static_assert(std::is_same_v<V, double> || std::is_same_v<V, float>, "field values are double or float");
+            if constexpr(std::is_same_v<V, float>) {
+                return std::tie(field_single_, replicas_single_);
+            } else {
+                return std::tie(field_, replicas_);
+            }
+        }
+        /// @}
+
+        /**
+         * @brief Copy one field grid into memory local to the NUMA node of the calling thread
+         * @tparam V Type of the stored field values
+         */
+        template <typename V> void replicate_grid(unsigned int node, FieldGridCopies& copies);
+
+        /**
+         * @brief Helper function to retrieve the return type from the field values of a grid point
+         * @param values Pointer to the first of the N values
          * @note The index sequence is expanded to the number of elements requested, depending on the template instance
          */
-        template <std::size_t... I> inline auto get_impl(size_t offset, std::index_sequence<I...>) const noexcept;
+        template <typename V, std::size_t... I>
+        static inline auto get_impl(const V* values, std::index_sequence<I...>) noexcept;
+
+        /**
+         * @brief Helper function to interpolate the field values between the centers of the neighboring grid cells
+         * @param field Pointer to the flat field grid
+         * @param x Position in x in units of grid cells, measured from the lower edge of the grid
+         * @param y Position in y in units of grid cells, measured from the lower edge of the grid
+         * @param z Position in z in units of grid cells, measured from the lower edge of the grid
+         * @return Interpolated value(s) of the field at the queried point
+         * @note Dimensions with a single bin are not interpolated, resulting in a bilinear interpolation for 2D grids
+         */
+        template <typename V>
+        T interpolate_grid(const V* field, const double x, const double y, const double z) const noexcept;
+
+        /**
+         * @brief Helper function to locate the values of a grid cell in either the regular or the sparse hierarchical grid
+         * @param field Pointer to the flat field grid
+         * @param x Index of the cell in x
+         * @param y Index of the cell in y
+         * @param z Index of the cell in z
+         * @return Pointer to the first of the N values of the cell
+         */
+        template <typename V>
+        const V* grid_cell(const V* field, const size_t x, const size_t y, const size_t z) const noexcept {
+            if(brick_levels_.empty()) {
+                return field + x * bins_[1] * bins_[2] * N + y * bins_[2] * N + z * N;
+            }
+
+            // Locate the brick and the stored cell within it, bricks at the upper grid edges may be truncated
+            auto brick = ((x >> brick_shift_) * bricks_[1] + (y >> brick_shift_)) * bricks_[2] + (z >> brick_shift_);
+            auto shift = brick_shift_ - brick_levels_[brick];
+            constexpr size_t mask = (size_t(1) << brick_shift_) - 1;
+            auto cells_y = (std::min(mask + 1, bins_[1] - (y & ~mask)) + (size_t(1) << shift) - 1) >> shift;
+            auto cells_z = (std::min(mask + 1, bins_[2] - (z & ~mask)) + (size_t(1) << shift) - 1) >> shift;
+            auto cell = (((x & mask) >> shift) * cells_y + ((y & mask) >> shift)) * cells_z + ((z & mask) >> shift);
+            return field + brick_offsets_[brick] + cell * N;
+        }
+
+        /**
+         * @brief Convert the field grid with the given type of values into a sparse hierarchical grid
+         * @param tolerance Maximum absolute deviation of any field component from the original grid
+         * @param first_level Coarsest refinement level tested for the bricks
+         */
+        template <typename V> void make_adaptive(double tolerance, size_t first_level = 0);
 
         /**
          * @brief Helper function to calculate the field index based on the distance from its center and to return the values
@@ -186,6 +478,43 @@ namespace allpix {
          */
         T get_field_from_grid(const double x, const double y, const double z, const bool extrapolate_z) const noexcept;
 
+        /**
+         * @brief Helper function to fold coordinates relative to the field origin onto the grid and to return the values
+         * @param x Distance in local-coordinate x from the field origin, including the field offset
+         * @param y Distance in local-coordinate y from the field origin, including the field offset
+         * @param z Position in local-coordinate z
+         * @param extrapolate_z Flag whether we should extrapolate
+         * @return Value(s) of the field at the queried point
+         */
+        T get_field_relative(const double x, const double y, const double z, const bool extrapolate_z) const noexcept;
+
+        // Number of positions processed at once by the lookups of multiple positions
+        static constexpr size_t block_size_ = 64;
+
+        // Bricks of the sparse hierarchical grid span 2^3 cells along each axis
+        static constexpr size_t brick_shift_ = 3;
+
+        /**
+         * @brief Coefficients to fold a coordinate relative to the field origin onto the field grid
+         *
+         * The position on the grid in units of the field size is calculated as linear * x + folded * |x| + offset, adding
+         * negative for coordinates below zero. The field is mirrored if the folded term changes the sign of the coordinate.
+         */
+        struct MappingAxis {
+            double linear{1.0};   ///< Factor of the coordinate
+            double folded{0.0};   ///< Factor of the absolute value of the coordinate
+            double offset{0.5};   ///< Offset of the field origin on the grid
+            double negative{0.0}; ///< Additional offset for negative coordinates
+        };
+
+        /**
+         * @brief Get the coefficients to fold a coordinate onto the field grid for a field mapping
+         * @param mapping Mapping of the field onto the pixel plane
+         * @param y Boolean to select the y-axis instead of the x-axis
+         * @return Coefficients for the requested axis
+         */
+        static MappingAxis mapping_axis(FieldMapping mapping, bool y) noexcept;
+
         /**
          * @brief Fast floor-to-int implementation without overflow protection as std::floor
          * @param x Double-precision floating point value
@@ -204,8 +533,10 @@ namespace allpix {
          */
         std::array<size_t, 3> bins_{};
         FieldMapping mapping_{FieldMapping::PIXEL_FULL};
+        std::array<MappingAxis, 2> mapping_axes_{};
         std::array<double, 2> normalization_{{1., 1.}};
         std::array<double, 2> offset_{{0., 0.}};
+        FieldInterpolation interpolation_{FieldInterpolation::NEAREST};
 
         /**
          * Field definition
@@ -218,11 +549,30 @@ namespace allpix {
          * component in the flat field vector can be calculated as:
          *
          *   field_i(x, y, z) =  x * Y_SIZE* Z_SIZE * N + y * Z_SIZE * + z * N + i
+         *
+         * The grid is stored with either double or single precision, only one of the two grids is set.
          */
-        std::shared_ptr<std::vector<double>> field_;
+        SharedArray<double> field_;
+        SharedArray<float> field_single_;
+        // Optional copies of the field grid, indexed by the NUMA node they have been allocated on
+        std::vector<SharedArray<double>> replicas_;
+        std::vector<SharedArray<float>> replicas_single_;
         std::pair<double, double> thickness_domain_{};
         FieldType type_{FieldType::NONE};
         FieldFunction<T> function_;
+        // Flag whether the field function has been sampled onto the field grid
+        bool tabulated_{false};
+        // Flag whether the field grid and its replicas are stored in memory backed by huge pages
+        bool huge_pages_{false};
+
+        /*
+         * Sparse hierarchical grid
+         * If converted, the field storage holds the cells of all bricks. For each brick, the offset of its cells in the
+         * storage and the refinement level are recorded, with 2^level cells stored per axis of a full brick.
+         */
+        std::array<size_t, 3> bricks_{};
+        std::vector<size_t> brick_offsets_;
+        std::vector<unsigned char> brick_levels_;
 
         /*
          * Relevant parameters from the detector model for this field
@@ -38,8 +38,9 @@ namespace allpix {
             // Constant field - return value:
             return function_({});
         } else if(type_ == FieldType::LINEAR || type_ == FieldType::CUSTOM1D) {
-            // Linear field or custom field function with z dependency only - calculate value from configured function:
-            return function_(ROOT::Math::XYZPoint(0, 0, z));
+            // Linear field or custom field function with z dependency only - calculate value from configured function or
+            // from the grid it has been sampled onto:
+            return (tabulated_ ? get_field_from_grid(0.5, 0.5, z, extrapolate_z) : function_(ROOT::Math::XYZPoint(0, 0, z)));
         } else {
 
             // For per-pixel fields, resort to getRelativeTo with current pixel as reference:
@@ -73,7 +74,7 @@ namespace allpix {
 
             T ret_val;
             // Compute using the grid or a function depending on the setting
-            if(type_ == FieldType::GRID) {
+            if(type_ == FieldType::GRID || tabulated_) {
                 ret_val = get_field_from_grid(x * normalization_[0] + 0.5, y * normalization_[1] + 0.5, z, extrapolate_z);
             } else {
                 // Calculate the field from the configured function:
@@ -109,57 +110,206 @@ namespace allpix {
         auto x = pos.x() - ref.x() + offset_[0];
         auto y = pos.y() - ref.y() + offset_[1];
 
-        T ret_val;
-        if(type_ == FieldType::GRID) {
-
-            // Do we need to flip the position vector components?
-            auto flip_x =
-                (x > 0 && (mapping_ == FieldMapping::PIXEL_QUADRANT_II || mapping_ == FieldMapping::PIXEL_QUADRANT_III ||
-                           mapping_ == FieldMapping::PIXEL_HALF_LEFT)) ||
-                (x < 0 && (mapping_ == FieldMapping::PIXEL_QUADRANT_I || mapping_ == FieldMapping::PIXEL_QUADRANT_IV ||
-                           mapping_ == FieldMapping::PIXEL_HALF_RIGHT));
-            auto flip_y =
-                (y > 0 && (mapping_ == FieldMapping::PIXEL_QUADRANT_III || mapping_ == FieldMapping::PIXEL_QUADRANT_IV ||
-                           mapping_ == FieldMapping::PIXEL_HALF_BOTTOM)) ||
-                (y < 0 && (mapping_ == FieldMapping::PIXEL_QUADRANT_I || mapping_ == FieldMapping::PIXEL_QUADRANT_II ||
-                           mapping_ == FieldMapping::PIXEL_HALF_TOP));
-
-            // Fold onto available field scale in the range [0 , 1] - flip coordinates if necessary
-            auto px = (flip_x ? -1.0 : 1.0) * x * normalization_[0];
-            auto py = (flip_y ? -1.0 : 1.0) * y * normalization_[1];
-
-            if(mapping_ == FieldMapping::PIXEL_QUADRANT_II || mapping_ == FieldMapping::PIXEL_QUADRANT_III ||
-               mapping_ == FieldMapping::PIXEL_HALF_LEFT) {
-                px += 1.0;
-            } else if(mapping_ == FieldMapping::PIXEL_FULL || mapping_ == FieldMapping::PIXEL_HALF_TOP ||
-                      mapping_ == FieldMapping::PIXEL_HALF_BOTTOM) {
-                px += 0.5;
+        if(type_ == FieldType::GRID || tabulated_) {
+            return get_field_relative(x, y, z, extrapolate_z);
+        }
+
+        // Calculate the field from the configured function:
+        return function_(ROOT::Math::XYZPoint(x, y, z));
+    }
+
+    template <typename T, size_t N>
+    T DetectorField<T, N>::get_field_relative(const double x,
+                                              const double y,
+                                              const double z,
+                                              const bool extrapolate_z) const noexcept {
+        // Fold onto available field scale in the range [0 , 1] - flip coordinates if necessary
+        const auto& [axis_x, axis_y] = mapping_axes_;
+        auto px = (axis_x.linear * x + axis_x.folded * std::fabs(x)) * normalization_[0] + axis_x.offset +
+                  (x < 0 ? axis_x.negative : 0.);
+        auto py = (axis_y.linear * y + axis_y.folded * std::fabs(y)) * normalization_[1] + axis_y.offset +
+                  (y < 0 ? axis_y.negative : 0.);
+
+        // Do we need to flip the field vector components?
+        auto flip_x = (axis_x.folded * x < 0);
+        auto flip_y = (axis_y.folded * y < 0);
+
+        auto ret_val = get_field_from_grid(px, py, z, extrapolate_z);
+
+        // Flip vector if necessary
+        flip_vector_components(ret_val, flip_x, flip_y);
+        return ret_val;
+    }
+
+    /**
+     * The positions are processed in blocks. For field grids mapped to the pixels of a rectangular pixel matrix, the pixel
+     * and the coordinates relative to its center are calculated for a full block at once without calls to the detector
+     * model, before the grid is read for every position. All other fields are evaluated position by position.
+     */
+    template <typename T, size_t N>
+    void DetectorField<T, N>::get(const double* x,
+                                  const double* y,
+                                  const double* z,
+                                  const size_t count,
+                                  const std::array<double*, N>& values,
+                                  const bool extrapolate_z) const {
+        auto store = [&](size_t i, const T& value) {
+            std::array<double, N> components{};
+            store_field_components(value, components.data());
+            for(size_t c = 0; c < N; ++c) {
+                values[c][i] = components[c];
+            }
+        };
+
+        if((type_ != FieldType::GRID && !tabulated_) || mapping_ == FieldMapping::SENSOR ||
+           model_->getPixelType() != Pixel::Type::RECTANGLE ||
+           dynamic_cast<const PixelDetectorModel*>(model_.get()) == nullptr) {
+            for(size_t i = 0; i < count; ++i) {
+                store(i, get(ROOT::Math::XYZPoint(x[i], y[i], z[i]), extrapolate_z));
+            }
+            return;
+        }
+
+        // Resolve the pixel matrix of the model once
+        const auto pitch_x = model_->getPixelSize().x();
+        const auto pitch_y = model_->getPixelSize().y();
+        const auto max_x = (model_->getNPixels().x() - 0.5) * pitch_x;
+        const auto max_y = (model_->getNPixels().y() - 0.5) * pitch_y;
+        const auto [min_z, max_z] = thickness_domain_;
+
+        std::array<double, block_size_> rel_x{}, rel_y{}, rel_z{};
+        std::array<bool, block_size_> inside{};
+        for(size_t start = 0; start < count; start += block_size_) {
+            auto size = std::min(block_size_, count - start);
+
+            // Calculate the coordinates relative to the center of the pixel containing each position
+            for(size_t j = 0; j < size; ++j) {
+                auto px = x[start + j], py = y[start + j];
+                auto pz = (extrapolate_z ? std::clamp(z[start + j], min_z, max_z) : z[start + j]);
+                inside[j] = (px >= -0.5 * pitch_x && px <= max_x && py >= -0.5 * pitch_y && py <= max_y &&
+                             pz >= min_z && pz <= max_z);
+                rel_x[j] = px - std::round(px / pitch_x) * pitch_x + offset_[0];
+                rel_y[j] = py - std::round(py / pitch_y) * pitch_y + offset_[1];
+                rel_z[j] = pz;
             }
 
-            if(mapping_ == FieldMapping::PIXEL_QUADRANT_III || mapping_ == FieldMapping::PIXEL_QUADRANT_IV ||
-               mapping_ == FieldMapping::PIXEL_HALF_BOTTOM) {
-                py += 1.0;
-            } else if(mapping_ == FieldMapping::PIXEL_FULL || mapping_ == FieldMapping::PIXEL_HALF_LEFT ||
-                      mapping_ == FieldMapping::PIXEL_HALF_RIGHT) {
-                py += 0.5;
+            // Read the field from the grid
+            for(size_t j = 0; j < size; ++j) {
+                store(start + j, inside[j] ? get_field_relative(rel_x[j], rel_y[j], rel_z[j], extrapolate_z) : T{});
             }
+        }
+    }
 
-            // Shuffle quadrants for inverted maps
-            if(mapping_ == FieldMapping::PIXEL_FULL_INVERSE) {
-                px += (x >= 0 ? 0. : 1.0);
-                py += (y >= 0 ? 0. : 1.0);
+    template <typename T, size_t N>
+    void DetectorField<T, N>::getRelativeTo(const double* x,
+                                            const double* y,
+                                            const double* z,
+                                            const size_t count,
+                                            const ROOT::Math::XYPoint& reference,
+                                            const std::array<double*, N>& values,
+                                            const bool extrapolate_z) const {
+        auto store = [&](size_t i, const T& value) {
+            std::array<double, N> components{};
+            store_field_components(value, components.data());
+            for(size_t c = 0; c < N; ++c) {
+                values[c][i] = components[c];
             }
+        };
 
-            ret_val = get_field_from_grid(px, py, z, extrapolate_z);
+        if(type_ != FieldType::GRID && !tabulated_) {
+            for(size_t i = 0; i < count; ++i) {
+                store(i, getRelativeTo(ROOT::Math::XYZPoint(x[i], y[i], z[i]), reference, extrapolate_z));
+            }
+            return;
+        }
 
-            // Flip vector if necessary
-            flip_vector_components(ret_val, flip_x, flip_y);
-        } else {
-            // Calculate the field from the configured function:
-            ret_val = function_(ROOT::Math::XYZPoint(x, y, z));
+        const auto [min_z, max_z] = thickness_domain_;
+        const auto ref_x = reference.x();
+        const auto ref_y = reference.y();
+
+        std::array<double, block_size_> rel_x{}, rel_y{}, rel_z{};
+        std::array<bool, block_size_> inside{};
+        for(size_t start = 0; start < count; start += block_size_) {
+            auto size = std::min(block_size_, count - start);
+
+            // Calculate the coordinates relative to the reference point
+            for(size_t j = 0; j < size; ++j) {
+                auto pz = (extrapolate_z ? std::clamp(z[start + j], min_z, max_z) : z[start + j]);
+                inside[j] = (pz >= min_z && pz <= max_z);
+                rel_x[j] = x[start + j] - ref_x + offset_[0];
+                rel_y[j] = y[start + j] - ref_y + offset_[1];
+                rel_z[j] = pz;
+            }
+
+            // Read the field from the grid
+            for(size_t j = 0; j < size; ++j) {
+                store(start + j, inside[j] ? get_field_relative(rel_x[j], rel_y[j], rel_z[j], extrapolate_z) : T{});
+            }
         }
+    }
 
-        return ret_val;
+    /**
+     * The depth of the position is checked once for all references, and only the coordinates relative to the references
+     * differ between the lookups in the grid. The values are identical to the ones of separate lookups per reference.
+     */
+    template <typename T, size_t N>
+    void DetectorField<T, N>::getRelativeTo(const ROOT::Math::XYZPoint& pos,
+                                            const ROOT::Math::XYPoint* references,
+                                            const size_t count,
+                                            const std::array<double*, N>& values,
+                                            const bool extrapolate_z) const {
+        auto store = [&](size_t i, const T& value) {
+            std::array<double, N> components{};
+            store_field_components(value, components.data());
+            for(size_t c = 0; c < N; ++c) {
+                values[c][i] = components[c];
+            }
+        };
+
+        if(type_ != FieldType::GRID && !tabulated_) {
+            for(size_t i = 0; i < count; ++i) {
+                store(i, getRelativeTo(pos, references[i], extrapolate_z));
+            }
+            return;
+        }
+
+        auto z = (extrapolate_z ? std::clamp(pos.z(), thickness_domain_.first, thickness_domain_.second) : pos.z());
+        auto inside = (z >= thickness_domain_.first && z <= thickness_domain_.second);
+        for(size_t i = 0; i < count; ++i) {
+            auto x = pos.x() - references[i].x() + offset_[0];
+            auto y = pos.y() - references[i].y() + offset_[1];
+            store(i, inside ? get_field_relative(x, y, z, extrapolate_z) : T{});
+        }
+    }
+
+    /**
+     * Half and quadrant mappings mirror the field at the pixel center, such that the absolute value of the coordinate is
+     * looked up on the side stored in the grid. Full mappings are shifted by half the field size to center the field on the
+     * pixel, inverse mappings shift negative coordinates by the full field size to place the pixel corner in the center.
+     * Sensor mappings are not shifted.
+     */
+    template <typename T, size_t N>
+    typename DetectorField<T, N>::MappingAxis DetectorField<T, N>::mapping_axis(FieldMapping mapping, bool y) noexcept {
+        // Fields stored for positive or negative coordinates along this axis only:
+        auto positive = (y ? (mapping == FieldMapping::PIXEL_QUADRANT_I || mapping == FieldMapping::PIXEL_QUADRANT_II ||
+                              mapping == FieldMapping::PIXEL_HALF_TOP)
+                           : (mapping == FieldMapping::PIXEL_QUADRANT_I || mapping == FieldMapping::PIXEL_QUADRANT_IV ||
+                              mapping == FieldMapping::PIXEL_HALF_RIGHT));
+        auto negative = (y ? (mapping == FieldMapping::PIXEL_QUADRANT_III || mapping == FieldMapping::PIXEL_QUADRANT_IV ||
+                              mapping == FieldMapping::PIXEL_HALF_BOTTOM)
+                           : (mapping == FieldMapping::PIXEL_QUADRANT_II || mapping == FieldMapping::PIXEL_QUADRANT_III ||
+                              mapping == FieldMapping::PIXEL_HALF_LEFT));
+
+        if(positive) {
+            return {0.0, 1.0, 0.0, 0.0};
+        } else if(negative) {
+            return {0.0, -1.0, 1.0, 0.0};
+        } else if(mapping == FieldMapping::PIXEL_FULL_INVERSE) {
+            return {1.0, 0.0, 0.0, 1.0};
+        } else if(mapping == FieldMapping::SENSOR) {
+            return {1.0, 0.0, 0.0, 0.0};
+        }
+        return {1.0, 0.0, 0.5, 0.0};
     }
 
     // Maps the field indices onto the range of -d/2 < x < d/2, where d is the scale of the field in coordinate x.
@@ -191,40 +341,99 @@ namespace allpix {
             return {};
         }
 
-        // Compute total index
-        size_t tot_ind = static_cast<size_t>(x_ind) * bins_[1] * bins_[2] * N + static_cast<size_t>(y_ind) * bins_[2] * N +
-                         static_cast<size_t>(z_ind) * N;
+        // Interpolate between the neighboring cells if requested
+        if(interpolation_ == FieldInterpolation::LINEAR) {
+            auto z_cells = static_cast<double>(bins_[2]) * (z - thickness_domain_.first) /
+                           (thickness_domain_.second - thickness_domain_.first);
+            auto x_cells = x * static_cast<double>(bins_[0]);
+            auto y_cells = y * static_cast<double>(bins_[1]);
+            return (field_single_ ? interpolate_grid(grid<float>().data(), x_cells, y_cells, z_cells)
+                                  : interpolate_grid(grid<double>().data(), x_cells, y_cells, z_cells));
+        }
 
         // Retrieve field
-        return get_impl(tot_ind, std::make_index_sequence<N>{});
+        auto x_cell = static_cast<size_t>(x_ind);
+        auto y_cell = static_cast<size_t>(y_ind);
+        auto z_cell = static_cast<size_t>(z_ind);
+        return (field_single_
+                    ? get_impl(grid_cell(grid<float>().data(), x_cell, y_cell, z_cell), std::make_index_sequence<N>{})
+                    : get_impl(grid_cell(grid<double>().data(), x_cell, y_cell, z_cell), std::make_index_sequence<N>{}));
+    }
+
+    /**
+     * The field values are known at the centers of the grid cells. The position is located between the two closest cell
+     * centers in every dimension, positions between the outermost cell centers and the grid edges take the value of the
+     * outermost cells. The values of the up to eight neighboring cells are weighted with their distance and accumulated over
+     * all N components at once, a fixed-size loop the compiler vectorizes.
+     */
+    template <typename T, size_t N>
+    template <typename V>
+    T DetectorField<T, N>::interpolate_grid(const V* field, const double x, const double y, const double z) const noexcept {
+        const std::array<double, 3> pos{{x, y, z}};
+        std::array<size_t, 3> low{}, high{};
+        std::array<double, 3> frac{};
+        for(size_t dim = 0; dim < 3; ++dim) {
+            if(bins_[dim] == 1) {
+                continue;
+            }
+            // Shift to the coordinates of the cell centers and clamp to the outermost cells
+            auto center = pos[dim] - 0.5;
+            auto index = int_floor(center);
+            auto max_index = static_cast<int>(bins_[dim]) - 1;
+            frac[dim] = center - index;
+            low[dim] = static_cast<size_t>(std::clamp(index, 0, max_index));
+            high[dim] = static_cast<size_t>(std::clamp(index + 1, 0, max_index));
+        }
+
+        std::array<double, N> values{};
+        for(size_t corner = 0; corner < 8; ++corner) {
+            auto weight = ((corner & 4U) != 0 ? frac[0] : 1. - frac[0]) * ((corner & 2U) != 0 ? frac[1] : 1. - frac[1]) *
+                          ((corner & 1U) != 0 ? frac[2] : 1. - frac[2]);
+            // Skip corners without contribution, e.g. along dimensions with a single bin
+            if(weight == 0.) {
+                continue;
+            }
+
+            const auto* cell = grid_cell(field,
+                                         ((corner & 4U) != 0 ? high[0] : low[0]),
+                                         ((corner & 2U) != 0 ? high[1] : low[1]),
+                                         ((corner & 1U) != 0 ? high[2] : low[2]));
+            for(size_t i = 0; i < N; ++i) {
+                values[i] += weight * static_cast<double>(cell[i]);
+            }
+        }
+
+        return get_impl(values.data(), std::make_index_sequence<N>{});
     }
 
     /**
      * Woohoo, template magic! Using an index_sequence to construct the templated return type with a variable number of
-     * elements from the flat field vector, e.g. 3 for a vector field and 1 for a scalar field. Using a braced-init-list
+     * elements from the field values, e.g. 3 for a vector field and 1 for a scalar field. Using a braced-init-list
      * allows to call the appropriate constructor of the return type, e.g. ROOT::Math::XYZVector or simply a double.
      */
     template <typename T, size_t N>
-    template <std::size_t... I>
-    auto DetectorField<T, N>::get_impl(size_t offset, std::index_sequence<I...>) const noexcept {
-        return T{(*field_)[offset + I]...};
+    template <typename V, std::size_t... I>
+    auto DetectorField<T, N>::get_impl(const V* values, std::index_sequence<I...>) noexcept {
+        return T{static_cast<double>(values[I])...};
     }
 
     /**
      * @throws std::invalid_argument If the field bins are incorrect or the thickness domain is outside the sensor
      */
     template <typename T, size_t N>
-    void DetectorField<T, N>::setGrid(std::shared_ptr<std::vector<double>> field, // NOLINT
+    template <typename V>
+    void DetectorField<T, N>::setGrid(SharedArray<V> field, // NOLINT
                                       std::array<size_t, 3> bins,
                                       std::array<double, 3> size,
                                       FieldMapping mapping,
                                       std::array<double, 2> scales,
                                       std::array<double, 2> offset,
-                                      std::pair<double, double> thickness_domain) {
+                                      std::pair<double, double> thickness_domain,
+                                      FieldInterpolation interpolation) {
         if(model_ == nullptr) {
             throw std::invalid_argument("field not initialized with detector model parameters");
         }
-        if(bins[0] * bins[1] * bins[2] * N != field->size()) {
+        if(bins[0] * bins[1] * bins[2] * N != field.size()) {
             throw std::invalid_argument("field does not match the given dimensions");
         }
         if(thickness_domain.first + 1e-9 < model_->getSensorCenter().z() - model_->getSensorSize().z() / 2.0 ||
@@ -235,9 +444,16 @@ namespace allpix {
             throw std::invalid_argument("end of thickness domain is before begin");
         }
 
-        field_ = std::move(field);
+        // Store the grid with the requested precision and drop any previous grid
+        field_ = {};
+        field_single_ = {};
+        replicas_.clear();
+        replicas_single_.clear();
+        std::get<0>(storage<V>()) = std::move(field);
         bins_ = bins;
         mapping_ = mapping;
+        mapping_axes_ = {{mapping_axis(mapping, false), mapping_axis(mapping, true)}};
+        interpolation_ = interpolation;
 
         // Calculate normalization of field from field size and scale factors:
         normalization_[0] = 1.0 / scales[0] / size[0];
@@ -247,6 +463,45 @@ namespace allpix {
 
         thickness_domain_ = std::move(thickness_domain);
         type_ = FieldType::GRID;
+        tabulated_ = false;
+        huge_pages_ = false;
+        bricks_ = {};
+        brick_offsets_.clear();
+        brick_levels_.clear();
+    }
+
+    /**
+     * The copy is allocated and written by the calling thread, such that its pages are placed on the NUMA node of this
+     * thread by the first-touch policy of the operating system.
+     */
+    template <typename T, size_t N>
+    void DetectorField<T, N>::replicate(unsigned int node, FieldGridCopies& copies) {
+        if(type_ != FieldType::GRID && !tabulated_) {
+            return;
+        }
+
+        if(field_single_) {
+            replicate_grid<float>(node, copies);
+        } else {
+            replicate_grid<double>(node, copies);
+        }
+    }
+
+    template <typename T, size_t N>
+    template <typename V>
+    void DetectorField<T, N>::replicate_grid(unsigned int node, FieldGridCopies& copies) {
+        auto [field, replicas] = storage<V>();
+        auto& copy = copies[field.data()];
+        if(copy == nullptr) {
+            auto advised = false;
+            copy = std::make_shared<SharedArray<V>>(
+                huge_pages_ ? copy_to_huge_pages(field, advised)
+                            : SharedArray<V>(std::make_shared<std::vector<V>>(field.begin(), field.end())));
+        }
+        if(replicas.size() <= node) {
+            replicas.resize(node + 1);
+        }
+        replicas[node] = *std::static_pointer_cast<SharedArray<V>>(copy);
     }
 
     template <typename T, size_t N>
@@ -255,5 +510,244 @@ namespace allpix {
         thickness_domain_ = std::move(thickness_domain);
         function_ = std::move(function);
         type_ = type;
+        tabulated_ = false;
+    }
+
+    /**
+     * The function is evaluated at the centers of all grid cells, distributing slices of the grid in x over all available
+     * threads. Lookups then interpolate linearly between the cell centers, which is exact for fields linear in the position.
+     * Functions are evaluated relative to the reference position, such that the grid is mapped to the full pixel.
+     */
+    template <typename T, size_t N>
+    void DetectorField<T, N>::tabulate(std::array<size_t, 3> bins, std::array<double, 2> size) {
+        if(!function_ || type_ == FieldType::CONSTANT || type_ == FieldType::GRID) {
+            return;
+        }
+        if(type_ == FieldType::LINEAR || type_ == FieldType::CUSTOM1D) {
+            bins[0] = 1;
+            bins[1] = 1;
+        }
+        if(bins[0] == 0 || bins[1] == 0 || bins[2] == 0 || size[0] <= 0 || size[1] <= 0) {
+            throw std::invalid_argument("invalid binning or size of the field grid to sample the function onto");
+        }
+
+        auto field = std::make_shared<std::vector<double>>(bins[0] * bins[1] * bins[2] * N);
+        auto thickness = thickness_domain_.second - thickness_domain_.first;
+        auto sample = [&](size_t x_ind) {
+            auto x = (static_cast<double>(x_ind) + 0.5) / static_cast<double>(bins[0]) * size[0] - size[0] / 2;
+            for(size_t y_ind = 0; y_ind < bins[1]; ++y_ind) {
+                auto y = (static_cast<double>(y_ind) + 0.5) / static_cast<double>(bins[1]) * size[1] - size[1] / 2;
+                for(size_t z_ind = 0; z_ind < bins[2]; ++z_ind) {
+                    auto z = thickness_domain_.first + (static_cast<double>(z_ind) + 0.5) /
+                                                           static_cast<double>(bins[2]) * thickness;
+                    auto index = ((x_ind * bins[1] + y_ind) * bins[2] + z_ind) * N;
+                    store_field_components(function_(ROOT::Math::XYZPoint(x, y, z)), field->data() + index);
+                }
+            }
+        };
+
+        // Distribute the slices in x over the threads
+        std::atomic<size_t> next_slice{0};
+        std::exception_ptr exception;
+        std::mutex exception_mutex;
+        auto worker = [&]() {
+            try {
+                for(auto x_ind = next_slice++; x_ind < bins[0]; x_ind = next_slice++) {
+                    sample(x_ind);
+                }
+            } catch(...) {
+                std::lock_guard<std::mutex> lock(exception_mutex);
+                exception = std::current_exception();
+                next_slice = bins[0];
+            }
+        };
+        auto threads_count = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1U), bins[0]);
+        std::vector<std::thread> threads;
+        for(size_t thread = 1; thread < threads_count; ++thread) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for(auto& thread : threads) {
+            thread.join();
+        }
+        if(exception) {
+            std::rethrow_exception(exception);
+        }
+
+        // Store the grid while keeping the type of the field function
+        auto type = type_;
+        setGrid(SharedArray<double>(field),
+                bins,
+                {size[0], size[1], thickness},
+                FieldMapping::PIXEL_FULL,
+                {{1.0, 1.0}},
+                {{0.0, 0.0}},
+                thickness_domain_,
+                FieldInterpolation::LINEAR);
+        type_ = type;
+        tabulated_ = true;
+    }
+
+    /**
+     * @throws std::invalid_argument If the tolerance is negative
+     */
+    template <typename T, size_t N> size_t DetectorField<T, N>::makeAdaptive(double tolerance) {
+        if(tolerance < 0) {
+            throw std::invalid_argument("tolerance of the sparse field grid cannot be negative");
+        }
+        if(type_ != FieldType::GRID || isAdaptive()) {
+            return (field_single_ ? field_single_.size() : field_.size());
+        }
+
+        if(field_single_) {
+            make_adaptive<float>(tolerance);
+        } else {
+            make_adaptive<double>(tolerance);
+        }
+        return (field_single_ ? field_single_.size() : field_.size());
+    }
+
+    template <typename T, size_t N> size_t DetectorField<T, N>::makeTiled() {
+        if(type_ != FieldType::GRID || isAdaptive()) {
+            return (field_single_ ? field_single_.size() : field_.size());
+        }
+
+        // Keeping all bricks at the finest level copies every cell
+        if(field_single_) {
+            make_adaptive<float>(0, brick_shift_);
+        } else {
+            make_adaptive<double>(0, brick_shift_);
+        }
+        return (field_single_ ? field_single_.size() : field_.size());
+    }
+
+    template <typename T, size_t N> bool DetectorField<T, N>::useHugePages() {
+        if(type_ != FieldType::GRID && !tabulated_) {
+            return false;
+        }
+
+        huge_pages_ = true;
+        auto advised = false;
+        auto relocate = [&](auto grid_storage) {
+            auto& [field, replicas] = grid_storage;
+            field = copy_to_huge_pages(field, advised);
+            replicas.clear();
+        };
+        if(field_single_) {
+            relocate(storage<float>());
+        } else {
+            relocate(storage<double>());
+        }
+        return advised;
+    }
+
+    /**
+     * The refinement levels are tested from the coarsest one, where a single stored cell represents the full brick. Each
+     * stored cell holds the average of the original cells it represents, rounded to the type of the field values. The finest
+     * level copies the original cells, such that bricks that cannot be coarsened are reproduced exactly.
+     */
+    template <typename T, size_t N>
+    template <typename V>
+    void DetectorField<T, N>::make_adaptive(double tolerance, size_t first_level) {
+        auto [field, replicas] = storage<V>();
+        const auto* values = field.data();
+        double max_value = 0;
+        for(const auto& value : field) {
+            max_value = std::max(max_value, std::fabs(static_cast<double>(value)));
+        }
+        auto limit = tolerance * max_value;
+
+        constexpr size_t brick_cells = size_t(1) << brick_shift_;
+        for(size_t dim = 0; dim < 3; ++dim) {
+            bricks_[dim] = (bins_[dim] + brick_cells - 1) >> brick_shift_;
+        }
+        brick_offsets_.clear();
+        brick_levels_.clear();
+        brick_offsets_.reserve(bricks_[0] * bricks_[1] * bricks_[2]);
+        brick_levels_.reserve(bricks_[0] * bricks_[1] * bricks_[2]);
+
+        auto adaptive = std::make_shared<std::vector<V>>();
+        std::vector<V> cells;
+        for(size_t bx = 0; bx < bricks_[0]; ++bx) {
+            for(size_t by = 0; by < bricks_[1]; ++by) {
+                for(size_t bz = 0; bz < bricks_[2]; ++bz) {
+                    const std::array<size_t, 3> origin{{bx << brick_shift_, by << brick_shift_, bz << brick_shift_}};
+                    std::array<size_t, 3> extent{};
+                    for(size_t dim = 0; dim < 3; ++dim) {
+                        extent[dim] = std::min(brick_cells, bins_[dim] - origin[dim]);
+                    }
+                    auto original = [&](size_t x, size_t y, size_t z) {
+                        return values + (origin[0] + x) * bins_[1] * bins_[2] * N + (origin[1] + y) * bins_[2] * N +
+                               (origin[2] + z) * N;
+                    };
+
+                    for(size_t level = first_level; level <= brick_shift_; ++level) {
+                        auto shift = brick_shift_ - level;
+                        auto span = size_t(1) << shift;
+                        std::array<size_t, 3> count{};
+                        for(size_t dim = 0; dim < 3; ++dim) {
+                            count[dim] = (extent[dim] + span - 1) >> shift;
+                        }
+
+                        // Average the original cells represented by every stored cell and check their deviation
+                        cells.assign(count[0] * count[1] * count[2] * N, V());
+                        auto accepted = true;
+                        for(size_t cx = 0; cx < count[0] && accepted; ++cx) {
+                            for(size_t cy = 0; cy < count[1] && accepted; ++cy) {
+                                for(size_t cz = 0; cz < count[2] && accepted; ++cz) {
+                                    auto* cell = cells.data() + ((cx * count[1] + cy) * count[2] + cz) * N;
+                                    auto x_end = std::min(extent[0], (cx + 1) << shift);
+                                    auto y_end = std::min(extent[1], (cy + 1) << shift);
+                                    auto z_end = std::min(extent[2], (cz + 1) << shift);
+                                    if(shift == 0) {
+                                        std::copy_n(original(cx, cy, cz), N, cell);
+                                        continue;
+                                    }
+
+                                    std::array<double, N> sum{};
+                                    for(auto x = cx << shift; x < x_end; ++x) {
+                                        for(auto y = cy << shift; y < y_end; ++y) {
+                                            for(auto z = cz << shift; z < z_end; ++z) {
+                                                for(size_t i = 0; i < N; ++i) {
+                                                    sum[i] += static_cast<double>(original(x, y, z)[i]);
+                                                }
+                                            }
+                                        }
+                                    }
+                                    auto represented = static_cast<double>(x_end - (cx << shift)) *
+                                                       static_cast<double>(y_end - (cy << shift)) *
+                                                       static_cast<double>(z_end - (cz << shift));
+                                    for(size_t i = 0; i < N; ++i) {
+                                        cell[i] = static_cast<V>(sum[i] / represented);
+                                    }
+                                    for(auto x = cx << shift; x < x_end && accepted; ++x) {
+                                        for(auto y = cy << shift; y < y_end && accepted; ++y) {
+                                            for(auto z = cz << shift; z < z_end && accepted; ++z) {
+                                                for(size_t i = 0; i < N; ++i) {
+                                                    accepted &= (std::fabs(static_cast<double>(original(x, y, z)[i]) -
+                                                                           static_cast<double>(cell[i])) <= limit);
+                                                }
+                                            }
+                                        }
+                                    }
+                                }
+                            }
+                        }
+
+                        if(accepted) {
+                            brick_offsets_.push_back(adaptive->size());
+                            brick_levels_.push_back(static_cast<unsigned char>(level));
+                            adaptive->insert(adaptive->end(), cells.begin(), cells.end());
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+
+        adaptive->shrink_to_fit();
+        auto advised = false;
+        field = (huge_pages_ ? copy_to_huge_pages(SharedArray<V>(adaptive), advised) : SharedArray<V>(adaptive));
+        replicas.clear();
     }
 } // namespace allpix
@@ -19,6 +19,10 @@
 
 #include <Math/Translation3D.h>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 using namespace allpix;
 
 std::shared_ptr<DetectorModel> DetectorModel::factory(const std::string& name, const ConfigReader& reader) {
@@ -176,6 +180,66 @@ void DetectorModel::addImplant(const Implant::Type& type,
     ROOT::Math::XYZVector full_offset(offset.x(), offset.y(), offset_z);
     implants_.push_back(
         Implant(type, shape, std::move(size), std::move(full_offset), ROOT::Math::RotationZ(orientation), config));
+    build_implant_grid();
+}
+
+/**
+ * The grid spans the union of the bounding boxes of all implants in the x-y plane, widened by a small margin to
+ * accommodate rounding in the containment test. Its number of cells grows with the number of implants, and each cell lists
+ * all implants whose bounding box overlaps with it.
+ */
+void DetectorModel::build_implant_grid() {
+    implant_grid_ = ImplantGrid();
+    if(implants_.empty()) {
+        return;
+    }
+
+    // Calculate the bounding boxes of all implants within the pixel
+    std::vector<std::array<double, 4>> boxes;
+    implant_grid_.min = {std::numeric_limits<double>::max(), std::numeric_limits<double>::max()};
+    implant_grid_.max = {std::numeric_limits<double>::lowest(), std::numeric_limits<double>::lowest()};
+    for(const auto& implant : implants_) {
+        auto cos = std::fabs(std::cos(implant.orientation_.Angle()));
+        auto sin = std::fabs(std::sin(implant.orientation_.Angle()));
+        auto margin = 1e-9 * (std::max(implant.size_.x(), implant.size_.y()) + std::fabs(implant.offset_.x()) +
+                              std::fabs(implant.offset_.y()));
+        auto half_x = (cos * implant.size_.x() + sin * implant.size_.y()) / 2 + margin;
+        auto half_y = (sin * implant.size_.x() + cos * implant.size_.y()) / 2 + margin;
+        boxes.push_back({implant.offset_.x() - half_x,
+                         implant.offset_.y() - half_y,
+                         implant.offset_.x() + half_x,
+                         implant.offset_.y() + half_y});
+        for(size_t axis = 0; axis < 2; ++axis) {
+            implant_grid_.min[axis] = std::min(implant_grid_.min[axis], boxes.back()[axis]);
+            implant_grid_.max[axis] = std::max(implant_grid_.max[axis], boxes.back()[axis + 2]);
+        }
+    }
+
+    auto bins = std::min<size_t>(64, 4 * static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(implants_.size())))));
+    for(size_t axis = 0; axis < 2; ++axis) {
+        implant_grid_.bins[axis] = bins;
+        implant_grid_.inverse_cell_size[axis] =
+            static_cast<double>(bins) / std::max(implant_grid_.max[axis] - implant_grid_.min[axis], 1e-12);
+    }
+
+    // List the overlapping implants for every cell
+    auto cell = [&](double value, size_t axis) {
+        auto index = std::floor((value - implant_grid_.min[axis]) * implant_grid_.inverse_cell_size[axis]);
+        return static_cast<size_t>(std::clamp(index, 0., static_cast<double>(implant_grid_.bins[axis] - 1)));
+    };
+    std::vector<std::vector<size_t>> candidates(bins * bins);
+    for(size_t i = 0; i < implants_.size(); ++i) {
+        for(auto x = cell(boxes[i][0], 0); x <= cell(boxes[i][2], 0); ++x) {
+            for(auto y = cell(boxes[i][1], 1); y <= cell(boxes[i][3], 1); ++y) {
+                candidates[x * bins + y].push_back(i);
+            }
+        }
+    }
+    implant_grid_.offsets.push_back(0);
+    for(const auto& list : candidates) {
+        implant_grid_.indices.insert(implant_grid_.indices.end(), list.begin(), list.end());
+        implant_grid_.offsets.push_back(implant_grid_.indices.size());
+    }
 }
 
 void DetectorModel::validate() {
@@ -330,14 +394,30 @@ std::optional<DetectorModel::Implant> DetectorModel::isWithinImplant(const ROOT:
     auto [xpixel, ypixel] = getPixelIndex(local_pos);
     auto inPixelPos = local_pos - getPixelCenter(xpixel, ypixel);
 
-    for(const auto& implant : implants_) {
-        if(implant.contains(inPixelPos)) {
-            return implant;
-        }
+    if(const auto* implant = findImplant(inPixelPos)) {
+        return *implant;
     }
     return std::nullopt;
 }
 
+const DetectorModel::Implant* DetectorModel::findImplant(const ROOT::Math::XYZVector& position) const {
+    const auto& grid = implant_grid_;
+    if(grid.offsets.empty() || !(position.x() >= grid.min[0] && position.x() <= grid.max[0] &&
+                                 position.y() >= grid.min[1] && position.y() <= grid.max[1])) {
+        return nullptr;
+    }
+
+    auto x = std::min(static_cast<size_t>((position.x() - grid.min[0]) * grid.inverse_cell_size[0]), grid.bins[0] - 1);
+    auto y = std::min(static_cast<size_t>((position.y() - grid.min[1]) * grid.inverse_cell_size[1]), grid.bins[1] - 1);
+    auto cell = x * grid.bins[1] + y;
+    for(auto i = grid.offsets[cell]; i < grid.offsets[cell + 1]; ++i) {
+        if(implants_[grid.indices[i]].contains(position)) {
+            return &implants_[grid.indices[i]];
+        }
+    }
+    return nullptr;
+}
+
 ROOT::Math::XYZPoint DetectorModel::getImplantIntercept(const Implant& implant,
                                                         const ROOT::Math::XYZPoint& outside,
                                                         const ROOT::Math::XYZPoint& inside) const {
@@ -20,6 +20,7 @@
 #include <array>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <Math/Point2D.h>
 #include <Math/Point3D.h>
@@ -59,6 +60,14 @@ namespace allpix {
         ARSENIC,
     };
 
+    /**
+     * @brief Offsets of all pixels neighboring a pixel with a maximum distance, shared by all pixels of a matrix
+     */
+    struct NeighborStencil {
+        size_t distance{};                 ///< Distance for pixels to be considered neighbors
+        std::vector<Pixel::Index> offsets; ///< Offsets of the neighbors, empty if depending on the position in the matrix
+    };
+
     /**
      * @ingroup DetectorModels
      * @brief Base of all detector models
@@ -384,6 +393,16 @@ namespace allpix {
          */
         virtual std::optional<Implant> isWithinImplant(const ROOT::Math::XYZPoint& local_pos) const;
 
+        /**
+         * @brief Returns the implant a position relative to the pixel center is in
+         * @param position Position relative to the center of the pixel
+         * @return Pointer to the implant the position is in, nullptr if it is not within any implant
+         *
+         * Only the implants overlapping the cell of a lookup grid built from the implant bounding boxes are tested, and
+         * positions outside all bounding boxes are rejected immediately.
+         */
+        const Implant* findImplant(const ROOT::Math::XYZVector& position) const;
+
         /**
          * @brief Calculate entry point of step into impant volume from one point outside the implant (before step) and one
          * point inside (after step).
@@ -471,7 +490,53 @@ namespace allpix {
          */
         virtual bool areNeighbors(const Pixel::Index& seed, const Pixel::Index& entrant, const size_t distance) const = 0;
 
+        /**
+         * @brief Return the stencil of pixels neighboring any pixel with a configurable maximum distance
+         * @param distance  Distance for pixels to be considered neighbors
+         * @return Stencil with the offsets of all neighboring pixels, including the initial pixel
+         *
+         * @note The stencil is meant to be calculated once and reused for all lookups via \ref forEachNeighbor. Models whose
+         * neighbors depend on the position in the matrix return a stencil without offsets
+         */
+        NeighborStencil getNeighborStencil(const size_t distance) const {
+            return {distance, get_neighbor_offsets(distance)};
+        }
+
+        /**
+         * @brief Call a function for all pixels neighboring the given one
+         * @param idx       Index of the pixel in question
+         * @param stencil   Stencil of the neighboring pixels obtained from \ref getNeighborStencil
+         * @param visitor   Function called with the index of every neighboring pixel, including the initial pixel
+         *
+         * @note Unlike \ref getNeighbors, no memory is allocated unless the stencil has no offsets, in which case the
+         * neighbors are obtained from \ref getNeighbors
+         */
+        template <typename F>
+        void forEachNeighbor(const Pixel::Index& idx, const NeighborStencil& stencil, F&& visitor) const {
+            if(stencil.offsets.empty()) {
+                for(const auto& pixel_index : getNeighbors(idx, stencil.distance)) {
+                    visitor(pixel_index);
+                }
+                return;
+            }
+            for(const auto& offset : stencil.offsets) {
+                auto x = idx.x() + offset.x();
+                auto y = idx.y() + offset.y();
+                if(isWithinMatrix(x, y)) {
+                    visitor(Pixel::Index(x, y));
+                }
+            }
+        }
+
     protected:
+        /**
+         * @brief Calculate the offsets of all pixels neighboring any pixel with a configurable maximum distance
+         * @param distance  Distance for pixels to be considered neighbors
+         * @return Offsets of the neighboring pixel indices, or no offsets if the neighbors depend on the position in the
+         * matrix
+         */
+        virtual std::vector<Pixel::Index> get_neighbor_offsets(const size_t) const { return {}; }
+
         /**
          * @brief Set number of pixels (replicated blocks in generic sensors)
          * @param val Number of two dimensional pixels
@@ -527,6 +592,26 @@ namespace allpix {
         std::vector<SupportLayer> support_layers_;
 
     private:
+        /**
+         * @brief Grid over the in-pixel region covered by implants, listing the implants overlapping each cell
+         *
+         * The candidates of each cell are stored in the order of the implants, such that the first implant containing a
+         * position is found in the same order as when testing all implants.
+         */
+        struct ImplantGrid {
+            std::array<double, 2> min{}, max{};
+            std::array<double, 2> inverse_cell_size{};
+            std::array<size_t, 2> bins{};
+            std::vector<size_t> offsets;
+            std::vector<size_t> indices;
+        };
+        ImplantGrid implant_grid_;
+
+        /**
+         * @brief Rebuild the lookup grid of implants from the bounding boxes of all implants
+         */
+        void build_implant_grid();
+
         ///@{
         /**
          * @brief Use default copy and move behaviour
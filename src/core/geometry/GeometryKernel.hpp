@@ -0,0 +1,256 @@
+/**
+ * @file
+ * @brief Inlined geometry queries of a detector model
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef ALLPIX_GEOMETRY_KERNEL_H
+#define ALLPIX_GEOMETRY_KERNEL_H
+
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <tuple>
+#include <typeinfo>
+#include <utility>
+
+#include <Math/Point3D.h>
+
+#include "core/geometry/DetectorModel.hpp"
+#include "core/geometry/HexagonalPixelDetectorModel.hpp"
+#include "core/geometry/PixelDetectorModel.hpp"
+#include "core/geometry/RadialStripDetectorModel.hpp"
+
+namespace allpix {
+    /**
+     * @ingroup DetectorModels
+     * @brief View on a detector model answering the geometry queries required at every step of the charge carrier motion
+     *
+     * The kernel is obtained once per module. For models of rectangular pixels, the parameters of the pixel matrix and the
+     * sensor are copied into the kernel and all queries are evaluated inline, such that the compiler can inline and
+     * vectorize them instead of calling the virtual methods of the model. The batch queries of radial strip and hexagonal
+     * models are forwarded to the non-virtual batch methods of the model, all other models are queried through their
+     * virtual methods. The queries yield identical results to the corresponding methods of the model.
+     */
+    class GeometryKernel {
+    public:
+        /**
+         * @brief Construct an empty kernel, to be assigned before use
+         */
+        GeometryKernel() = default;
+
+        /**
+         * @brief Construct the kernel for a detector model
+         * @param model Detector model to be queried
+         */
+        explicit GeometryKernel(std::shared_ptr<const DetectorModel> model) : model_(std::move(model)) {
+            // Only inline the queries of models which are known not to override them
+            inlined_ = (typeid(*model_) == typeid(PixelDetectorModel));
+            if(!inlined_) {
+                radial_strip_ = dynamic_cast<const RadialStripDetectorModel*>(model_.get());
+                hexagonal_ = dynamic_cast<const HexagonalPixelDetectorModel*>(model_.get());
+                return;
+            }
+
+            pitch_x_ = model_->getPixelSize().x();
+            pitch_y_ = model_->getPixelSize().y();
+            number_of_pixels_x_ = static_cast<int>(model_->getNPixels().x());
+            number_of_pixels_y_ = static_cast<int>(model_->getNPixels().y());
+            matrix_min_x_ = -0.5 * pitch_x_;
+            matrix_min_y_ = -0.5 * pitch_y_;
+            matrix_max_x_ = (model_->getNPixels().x() - 0.5) * pitch_x_;
+            matrix_max_y_ = (model_->getNPixels().y() - 0.5) * pitch_y_;
+
+            auto sensor_center = model_->getSensorCenter();
+            auto sensor_size = model_->getSensorSize();
+            sensor_center_x_ = sensor_center.x();
+            sensor_center_y_ = sensor_center.y();
+            sensor_center_z_ = sensor_center.z();
+            sensor_size_x_ = sensor_size.x();
+            sensor_size_y_ = sensor_size.y();
+            sensor_size_z_ = sensor_size.z();
+        }
+
+        /**
+         * @brief Check if the queries of the model are evaluated inline
+         * @return True if the model is queried without calling its virtual methods, false otherwise
+         */
+        bool isInlined() const { return inlined_; }
+
+        /**
+         * @brief Returns if a local position is within the sensitive device, see \ref DetectorModel::isWithinSensor
+         * @param local_pos Position in local coordinates of the detector model
+         * @return True if a local position is within the sensor, false otherwise
+         */
+        bool isWithinSensor(const ROOT::Math::XYZPoint& local_pos) const {
+            if(!inlined_) {
+                return model_->isWithinSensor(local_pos);
+            }
+            return within_sensor(local_pos.x(), local_pos.y(), local_pos.z());
+        }
+
+        /**
+         * @brief Returns if a pixel index is within the grid of pixels, see \ref DetectorModel::isWithinMatrix
+         * @param x X-coordinate of the pixel
+         * @param y Y-coordinate of the pixel
+         * @return True if pixel index is within matrix, false otherwise
+         */
+        bool isWithinMatrix(const int x, const int y) const {
+            if(!inlined_) {
+                return model_->isWithinMatrix(x, y);
+            }
+            return x >= 0 && x < number_of_pixels_x_ && y >= 0 && y < number_of_pixels_y_;
+        }
+
+        /**
+         * @brief Returns if a local position is within the pixel matrix, see \ref DetectorModel::isWithinMatrix
+         * @param position Position in local coordinates of the detector model
+         * @return True if a local position is within the pixel matrix, false otherwise
+         */
+        bool isWithinMatrix(const ROOT::Math::XYZPoint& position) const {
+            if(!inlined_) {
+                return model_->isWithinMatrix(position);
+            }
+            return within_matrix(position.x(), position.y());
+        }
+
+        /**
+         * @brief Returns the index of the pixel a position is in, see \ref DetectorModel::getPixelIndex
+         * @param local_pos Position in local coordinates of the detector model
+         * @return Index of the pixel, which may be outside the pixel matrix
+         */
+        std::pair<int, int> getPixelIndex(const ROOT::Math::XYZPoint& local_pos) const {
+            if(!inlined_) {
+                return model_->getPixelIndex(local_pos);
+            }
+            return {pixel_index(local_pos.x(), pitch_x_), pixel_index(local_pos.y(), pitch_y_)};
+        }
+
+        /**
+         * @brief Returns the implant a local position is in, see \ref DetectorModel::isWithinImplant
+         * @param local_pos Position in local coordinates of the detector model
+         * @return Pointer to the implant of the model the position is in, nullptr if it is not within any implant
+         *
+         * @note Unlike \ref DetectorModel::isWithinImplant, the implant is not copied
+         */
+        const DetectorModel::Implant* isWithinImplant(const ROOT::Math::XYZPoint& local_pos) const {
+            if(model_->getImplants().empty()) {
+                return nullptr;
+            }
+            if(!inlined_) {
+                auto [xpixel, ypixel] = model_->getPixelIndex(local_pos);
+                return model_->findImplant(local_pos - model_->getPixelCenter(xpixel, ypixel));
+            }
+            auto xpixel = pixel_index(local_pos.x(), pitch_x_);
+            auto ypixel = pixel_index(local_pos.y(), pitch_y_);
+            return model_->findImplant(
+                {local_pos.x() - pitch_x_ * xpixel, local_pos.y() - pitch_y_ * ypixel, local_pos.z()});
+        }
+
+        /**
+         * @brief Evaluate \ref isWithinSensor for a batch of positions given as separate coordinate arrays
+         * @param x      Local x-coordinates of the positions
+         * @param y      Local y-coordinates of the positions
+         * @param z      Local z-coordinates of the positions
+         * @param count  Number of positions
+         * @param within Storage for the result of every position
+         */
+        void isWithinSensor(const double* x, const double* y, const double* z, size_t count, bool* within) const {
+            if(radial_strip_ != nullptr) {
+                radial_strip_->isWithinSensor(x, y, z, count, within);
+                return;
+            }
+            if(!inlined_) {
+                for(size_t i = 0; i < count; ++i) {
+                    within[i] = model_->isWithinSensor({x[i], y[i], z[i]});
+                }
+                return;
+            }
+            for(size_t i = 0; i < count; ++i) {
+                within[i] = within_sensor(x[i], y[i], z[i]);
+            }
+        }
+
+        /**
+         * @brief Evaluate \ref isWithinMatrix for a batch of positions given as separate coordinate arrays
+         * @param x      Local x-coordinates of the positions
+         * @param y      Local y-coordinates of the positions
+         * @param count  Number of positions
+         * @param within Storage for the result of every position
+         */
+        void isWithinMatrix(const double* x, const double* y, size_t count, bool* within) const {
+            if(!inlined_) {
+                for(size_t i = 0; i < count; ++i) {
+                    within[i] = model_->isWithinMatrix(ROOT::Math::XYZPoint(x[i], y[i], 0));
+                }
+                return;
+            }
+            for(size_t i = 0; i < count; ++i) {
+                within[i] = within_matrix(x[i], y[i]);
+            }
+        }
+
+        /**
+         * @brief Evaluate \ref getPixelIndex for a batch of positions given as separate coordinate arrays
+         * @param x       Local x-coordinates of the positions
+         * @param y       Local y-coordinates of the positions
+         * @param count   Number of positions
+         * @param index_x Storage for the x-coordinate of the pixel index of every position
+         * @param index_y Storage for the y-coordinate of the pixel index of every position
+         */
+        void getPixelIndex(const double* x, const double* y, size_t count, int* index_x, int* index_y) const {
+            if(radial_strip_ != nullptr) {
+                radial_strip_->getPixelIndex(x, y, count, index_x, index_y);
+                return;
+            }
+            if(hexagonal_ != nullptr) {
+                hexagonal_->getPixelIndex(x, y, count, index_x, index_y);
+                return;
+            }
+            if(!inlined_) {
+                for(size_t i = 0; i < count; ++i) {
+                    std::tie(index_x[i], index_y[i]) = model_->getPixelIndex({x[i], y[i], 0});
+                }
+                return;
+            }
+            for(size_t i = 0; i < count; ++i) {
+                index_x[i] = pixel_index(x[i], pitch_x_);
+                index_y[i] = pixel_index(y[i], pitch_y_);
+            }
+        }
+
+    private:
+        static int pixel_index(double position, double pitch) { return static_cast<int>(std::lround(position / pitch)); }
+
+        bool within_sensor(double x, double y, double z) const {
+            // Combine the comparisons without short-circuiting to allow vectorization
+            return static_cast<bool>(static_cast<int>(2 * std::fabs(z - sensor_center_z_) <= sensor_size_z_) &
+                                     static_cast<int>(2 * std::fabs(y - sensor_center_y_) <= sensor_size_y_) &
+                                     static_cast<int>(2 * std::fabs(x - sensor_center_x_) <= sensor_size_x_));
+        }
+
+        bool within_matrix(double x, double y) const {
+            return static_cast<bool>(static_cast<int>(!(x < matrix_min_x_)) & static_cast<int>(!(x > matrix_max_x_)) &
+                                     static_cast<int>(!(y < matrix_min_y_)) & static_cast<int>(!(y > matrix_max_y_)));
+        }
+
+        std::shared_ptr<const DetectorModel> model_;
+        bool inlined_{};
+        // Models providing their own batch queries, if any
+        const RadialStripDetectorModel* radial_strip_{};
+        const HexagonalPixelDetectorModel* hexagonal_{};
+
+        double pitch_x_{}, pitch_y_{};
+        int number_of_pixels_x_{}, number_of_pixels_y_{};
+        double matrix_min_x_{}, matrix_min_y_{}, matrix_max_x_{}, matrix_max_y_{};
+        double sensor_center_x_{}, sensor_center_y_{}, sensor_center_z_{};
+        double sensor_size_x_{}, sensor_size_y_{}, sensor_size_z_{};
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_GEOMETRY_KERNEL_H */
@@ -9,9 +9,15 @@
  * SPDX-License-Identifier: MIT
  */
 
+#include <algorithm>
+#include <cmath>
 #include <fstream>
+#include <functional>
+#include <limits>
 #include <memory>
+#include <numeric>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 
@@ -39,7 +45,8 @@ GeometryManager::GeometryManager() : closed_{false} {}
  * Loads the geometry by looping over all defined detectors
  */
 void GeometryManager::load(ConfigManager* conf_manager, RandomNumberGenerator& seeder) {
-    // Set up a random number generator and seed it with the global seed:
+    // Set up a random number generator using the same engine and seed it with the global seed:
+    random_generator_.setEngine(seeder.getEngine());
     random_generator_.seed(seeder());
 
     // Loop over all defined detectors
@@ -52,11 +59,7 @@ void GeometryManager::load(ConfigManager* conf_manager, RandomNumberGenerator& s
         std::transform(role.begin(), role.end(), role.begin(), ::tolower);
         if(role == "passive") {
             // Check for duplicate names:
-            auto it = std::find_if(
-                passive_elements_.begin(),
-                passive_elements_.end(),
-                [name = geometry_section.getName()](const Configuration& cfg) { return name == cfg.getName(); });
-            if(it != passive_elements_.end()) {
+            if(passive_orientations_.count(geometry_section.getName()) != 0) {
                 throw PassiveElementExistsError(geometry_section.getName());
             }
 
@@ -75,6 +78,12 @@ void GeometryManager::load(ConfigManager* conf_manager, RandomNumberGenerator& s
             throw InvalidValueError(geometry_section, "role", "unknown role");
         }
 
+        // Sections with a table of instances create a detector for every row of the table
+        if(geometry_section.has("instances_file")) {
+            load_instances(geometry_section);
+            continue;
+        }
+
         LOG(DEBUG) << "Detector " << geometry_section.getName() << ":";
         // Get the position and orientation of the detector
         auto [position, orientation] = calculate_orientation(geometry_section);
@@ -238,30 +247,27 @@ void GeometryManager::addModel(std::shared_ptr<DetectorModel> model) {
     }
 
     LOG(TRACE) << "Registering new model " << model->getType();
-    if(model_names_.find(model->getType()) != model_names_.end()) {
+    if(!model_index_.emplace(model->getType(), models_.size()).second) {
         throw DetectorModelExistsError(model->getType());
     }
 
-    model_names_.insert(model->getType());
     models_.push_back(std::move(model));
 }
 
 bool GeometryManager::needsModel(const std::string& name) const {
     return nonresolved_models_.find(name) != nonresolved_models_.end();
 }
-bool GeometryManager::hasModel(const std::string& name) const { return model_names_.find(name) != model_names_.end(); }
+bool GeometryManager::hasModel(const std::string& name) const { return model_index_.find(name) != model_index_.end(); }
 
 /**
  * @throws InvalidDetectorError If a model with this name does not exist
  */
 std::shared_ptr<DetectorModel> GeometryManager::getModel(const std::string& name) const {
-    // FIXME: this is not a very nice way to implement this
-    for(const auto& model : models_) {
-        if(model->getType() == name) {
-            return model;
-        }
+    auto iter = model_index_.find(name);
+    if(iter == model_index_.end()) {
+        throw allpix::InvalidDetectorModelError(name);
     }
-    throw allpix::InvalidDetectorModelError(name);
+    return models_[iter->second];
 }
 
 /**
@@ -285,16 +291,15 @@ void GeometryManager::addDetector(std::shared_ptr<Detector> detector) {
         throw DetectorInvalidNameError(detector->getName());
     }
 
-    if(detector_names_.find(detector->getName()) != detector_names_.end()) {
+    if(!detector_index_.emplace(detector->getName(), detectors_.size()).second) {
         throw DetectorExistsError(detector->getName());
     }
 
-    detector_names_.insert(detector->getName());
     detectors_.push_back(std::move(detector));
 }
 
 bool GeometryManager::hasDetector(const std::string& name) const {
-    return detector_names_.find(name) != detector_names_.end();
+    return detector_index_.find(name) != detector_index_.end();
 }
 
 std::vector<std::shared_ptr<Detector>> GeometryManager::getDetectors() {
@@ -312,13 +317,11 @@ std::shared_ptr<Detector> GeometryManager::getDetector(const std::string& name)
         close_geometry();
     }
 
-    // FIXME: this is not a very nice way to implement this
-    for(auto& detector : detectors_) {
-        if(detector->getName() == name) {
-            return detector;
-        }
+    auto iter = detector_index_.find(name);
+    if(iter == detector_index_.end()) {
+        throw allpix::InvalidDetectorError(name);
     }
-    throw allpix::InvalidDetectorError(name);
+    return detectors_[iter->second];
 }
 
 /**
@@ -329,16 +332,89 @@ std::vector<std::shared_ptr<Detector>> GeometryManager::getDetectorsByType(const
         close_geometry();
     }
 
+    auto iter = detector_types_.find(type);
+    if(iter == detector_types_.end()) {
+        throw allpix::InvalidDetectorModelError(type);
+    }
+
     std::vector<std::shared_ptr<Detector>> result;
-    for(auto& detector : detectors_) {
-        if(detector->getType() == type) {
-            result.push_back(detector);
+    result.reserve(iter->second.size());
+    for(auto index : iter->second) {
+        result.push_back(detectors_[index]);
+    }
+    return result;
+}
+
+/**
+ * The hierarchy is traversed depth-first, skipping all nodes whose bounding box is not crossed by the segment. Detectors
+ * with the same entry distance are ordered by their exit distance and their order of definition.
+ */
+std::vector<DetectorIntersection> GeometryManager::getIntersectedDetectors(const XYZPoint& position,
+                                                                           const XYZVector& direction,
+                                                                           double min_distance,
+                                                                           double max_distance) {
+    if(!closed_) {
+        close_geometry();
+    }
+
+    std::array<double, 3> origin = {position.x(), position.y(), position.z()};
+    std::array<double, 3> step = {direction.x(), direction.y(), direction.z()};
+    auto crosses_volume = [&](const DetectorVolume& volume) {
+        auto t0 = min_distance, t1 = max_distance;
+        for(size_t axis = 0; axis < 3; ++axis) {
+            if(step[axis] == 0) {
+                if(origin[axis] < volume.min[axis] || origin[axis] > volume.max[axis]) {
+                    return false;
+                }
+                continue;
+            }
+            auto entry = (volume.min[axis] - origin[axis]) / step[axis];
+            auto exit = (volume.max[axis] - origin[axis]) / step[axis];
+            if(entry > exit) {
+                std::swap(entry, exit);
+            }
+            t0 = std::max(t0, entry);
+            t1 = std::min(t1, exit);
+            if(t0 > t1) {
+                return false;
+            }
         }
+        return true;
+    };
+
+    std::vector<std::pair<size_t, std::pair<double, double>>> hits;
+    std::vector<size_t> nodes;
+    if(!detector_volumes_.empty()) {
+        nodes.push_back(0);
     }
-    if(result.empty()) {
-        throw allpix::InvalidDetectorModelError(type);
+    while(!nodes.empty()) {
+        const auto& volume = detector_volumes_[nodes.back()];
+        nodes.pop_back();
+        if(!crosses_volume(volume)) {
+            continue;
+        }
+        if(volume.count == 0) {
+            nodes.push_back(volume.left);
+            nodes.push_back(volume.right);
+            continue;
+        }
+        for(auto i = volume.first; i < volume.first + volume.count; ++i) {
+            auto index = detector_volume_order_[i];
+            auto intersection = detectors_[index]->getSensorIntersection(position, direction);
+            if(intersection && intersection->second >= min_distance && intersection->first <= max_distance) {
+                hits.emplace_back(index, intersection.value());
+            }
+        }
     }
 
+    std::sort(hits.begin(), hits.end(), [](const auto& lhs, const auto& rhs) {
+        return std::tie(lhs.second, lhs.first) < std::tie(rhs.second, rhs.first);
+    });
+    std::vector<DetectorIntersection> result;
+    result.reserve(hits.size());
+    for(const auto& [index, distances] : hits) {
+        result.push_back({detectors_[index], distances.first, distances.second});
+    }
     return result;
 }
 
@@ -416,52 +492,212 @@ void GeometryManager::close_geometry() {
 
     // Try to resolve the missing models
     for(auto& [name, config_detectors] : nonresolved_models_) {
-        for(auto& [config, detector] : config_detectors) {
-            // Create a new model if one of the core model parameters is changed in the detector configuration
-            auto model = getModel(name);
-
-            // Get the configuration of the model
-            Configuration new_config("");
-            auto model_configs = model->getConfigurations();
-            std::vector<std::string> valid_sections = {"", "implant", "support"};
-            for(auto& conf : model_configs) {
-                auto section_name = allpix::transform(conf.getName(), ::tolower);
-                if(std::find(valid_sections.begin(), valid_sections.end(), section_name) == valid_sections.end()) {
-                    LOG(WARNING) << "Section [" << section_name << "] is not valid in sensor geometry definition.";
-                }
+        auto base_model = getModel(name);
+
+        // Get the configuration of the model
+        const auto model_configs = base_model->getConfigurations();
+        std::vector<std::string> valid_sections = {"", "implant", "support"};
+        for(const auto& conf : model_configs) {
+            auto section_name = allpix::transform(conf.getName(), ::tolower);
+            if(std::find(valid_sections.begin(), valid_sections.end(), section_name) == valid_sections.end()) {
+                LOG(WARNING) << "Section [" << section_name << "] is not valid in sensor geometry definition.";
             }
+        }
 
+        // Specialized models are shared by all detectors overwriting the same parameters with the same values
+        std::map<std::vector<std::pair<std::string, std::string>>, std::shared_ptr<DetectorModel>> specialized_models;
+        for(auto& [config, detector] : config_detectors) {
             // Add all non internal parameters to the config for a specialized model
+            std::vector<std::pair<std::string, std::string>> parameters;
             for(auto& [key, value] : config.getAll()) {
                 // Skip all internal parameters
                 if(key == "type" || key == "position" || key == "orientation_mode" || key == "orientation" ||
-                   key == "alignment_precision_position" || key == "alignment_precision_orientation" || key == "role") {
+                   key == "alignment_precision_position" || key == "alignment_precision_orientation" || key == "role" ||
+                   key == "instances_file") {
                     continue;
                 }
-                // Add the extra parameter to the new overwritten config
-                new_config.setText(key, value);
+                parameters.emplace_back(key, value);
             }
 
-            // Create new model if needed
-            if(new_config.countSettings() != 0) {
-                ConfigReader reader;
-                // Add the new configuration first to overwrite
-                reader.addConfiguration(std::move(new_config));
-                // Then add the original configuration
-                for(auto& model_config : model_configs) {
-                    reader.addConfiguration(std::move(model_config));
+            // Create a new model if one of the core model parameters is changed in the detector configuration
+            auto model = base_model;
+            if(!parameters.empty()) {
+                std::sort(parameters.begin(), parameters.end());
+                auto& specialized_model = specialized_models[parameters];
+                if(specialized_model == nullptr) {
+                    // Add the extra parameters to the new overwritten config
+                    Configuration new_config("");
+                    for(const auto& [key, value] : parameters) {
+                        new_config.setText(key, value);
+                    }
+
+                    ConfigReader reader;
+                    // Add the new configuration first to overwrite
+                    reader.addConfiguration(std::move(new_config));
+                    // Then add the original configuration
+                    for(const auto& model_config : model_configs) {
+                        reader.addConfiguration(model_config);
+                    }
+
+                    specialized_model = DetectorModel::factory(name, reader);
+                } else {
+                    LOG(TRACE) << "Reusing specialized model of type " << name << " for detector " << detector->getName();
                 }
-
-                model = DetectorModel::factory(name, reader);
+                model = specialized_model;
             }
 
             detector->set_model(std::move(model));
         }
     }
 
+    // Index the detectors by the type of their model
+    detector_types_.clear();
+    for(size_t index = 0; index < detectors_.size(); ++index) {
+        detector_types_[detectors_[index]->getType()].push_back(index);
+    }
+
+    build_detector_volumes();
+
     closed_ = true;
     LOG(TRACE) << "Closed geometry";
 }
+
+/**
+ * The bounding box of each sensor is calculated from its eight corners in global coordinates and widened by a small margin.
+ * The hierarchy is built top-down by splitting the detectors at the median of their box centers along the axis with the
+ * largest extent of the centers, until at most two detectors are left in a node.
+ */
+void GeometryManager::build_detector_volumes() {
+    detector_volumes_.clear();
+    detector_volume_order_.resize(detectors_.size());
+    std::iota(detector_volume_order_.begin(), detector_volume_order_.end(), 0);
+
+    std::vector<DetectorVolume> boxes;
+    for(auto& detector : detectors_) {
+        auto model = detector->getModel();
+        DetectorVolume box;
+        box.min.fill(std::numeric_limits<double>::max());
+        box.max.fill(std::numeric_limits<double>::lowest());
+        for(unsigned int corner = 0; corner < 8; ++corner) {
+            auto point = model->getSensorCenter();
+            point.SetX(point.x() + ((corner & 1U) != 0 ? 0.5 : -0.5) * model->getSensorSize().x());
+            point.SetY(point.y() + ((corner & 2U) != 0 ? 0.5 : -0.5) * model->getSensorSize().y());
+            point.SetZ(point.z() + ((corner & 4U) != 0 ? 0.5 : -0.5) * model->getSensorSize().z());
+            point = detector->getGlobalPosition(point);
+
+            std::array<double, 3> coordinates = {point.x(), point.y(), point.z()};
+            for(size_t axis = 0; axis < 3; ++axis) {
+                box.min[axis] = std::min(box.min[axis], coordinates[axis]);
+                box.max[axis] = std::max(box.max[axis], coordinates[axis]);
+            }
+        }
+        for(size_t axis = 0; axis < 3; ++axis) {
+            auto margin = 1e-9 * (box.max[axis] - box.min[axis] + std::fabs(box.min[axis]) + std::fabs(box.max[axis]));
+            box.min[axis] -= margin;
+            box.max[axis] += margin;
+        }
+        boxes.push_back(box);
+    }
+
+    std::function<size_t(size_t, size_t)> build = [&](size_t first, size_t count) {
+        auto node = detector_volumes_.size();
+        detector_volumes_.emplace_back();
+
+        DetectorVolume volume;
+        volume.min.fill(std::numeric_limits<double>::max());
+        volume.max.fill(std::numeric_limits<double>::lowest());
+        std::array<double, 3> center_min = volume.min, center_max = volume.max;
+        for(auto i = first; i < first + count; ++i) {
+            const auto& box = boxes[detector_volume_order_[i]];
+            for(size_t axis = 0; axis < 3; ++axis) {
+                volume.min[axis] = std::min(volume.min[axis], box.min[axis]);
+                volume.max[axis] = std::max(volume.max[axis], box.max[axis]);
+                center_min[axis] = std::min(center_min[axis], box.min[axis] + box.max[axis]);
+                center_max[axis] = std::max(center_max[axis], box.min[axis] + box.max[axis]);
+            }
+        }
+
+        if(count <= 2) {
+            volume.first = first;
+            volume.count = count;
+        } else {
+            size_t split_axis = 0;
+            for(size_t axis = 1; axis < 3; ++axis) {
+                if(center_max[axis] - center_min[axis] > center_max[split_axis] - center_min[split_axis]) {
+                    split_axis = axis;
+                }
+            }
+            auto begin = detector_volume_order_.begin() + static_cast<std::ptrdiff_t>(first);
+            std::nth_element(begin,
+                             begin + static_cast<std::ptrdiff_t>(count / 2),
+                             begin + static_cast<std::ptrdiff_t>(count),
+                             [&](size_t lhs, size_t rhs) {
+                                 return boxes[lhs].min[split_axis] + boxes[lhs].max[split_axis] <
+                                        boxes[rhs].min[split_axis] + boxes[rhs].max[split_axis];
+                             });
+            volume.left = build(first, count / 2);
+            volume.right = build(first + count / 2, count - count / 2);
+        }
+        detector_volumes_[node] = volume;
+        return node;
+    };
+    if(!detectors_.empty()) {
+        build(0, detectors_.size());
+    }
+    LOG(TRACE) << "Built bounding volume hierarchy with " << detector_volumes_.size() << " nodes for " << detectors_.size()
+               << " detectors";
+}
+/**
+ * Every non-empty line of the table, except for comments starting with a hash sign, defines a detector by its name, the
+ * three coordinates of its position and optionally the three angles of its orientation, separated by commas or whitespace.
+ * The values are interpreted like the corresponding parameters of a detector section, including their units. All other
+ * parameters of the section, such as the model type, are shared by all detectors of the table.
+ */
+void GeometryManager::load_instances(const Configuration& config) {
+    auto file_name = config.getPath("instances_file", true);
+    std::ifstream file(file_name);
+    if(!file) {
+        throw InvalidValueError(config, "instances_file", "could not open table of detector instances");
+    }
+
+    auto& unresolved = nonresolved_models_[config.get<std::string>("type")];
+    std::string line;
+    size_t line_number = 0, instances = 0;
+    while(std::getline(file, line)) {
+        line_number++;
+        auto first = line.find_first_not_of(" \t\r");
+        if(first == std::string::npos || line[first] == '#') {
+            continue;
+        }
+
+        auto columns = split<std::string>(line, " \t\r,");
+        if(columns.size() != 4 && columns.size() != 7) {
+            throw InvalidValueError(config,
+                                    "instances_file",
+                                    "line " + std::to_string(line_number) +
+                                        " should contain a name, three position and optionally three orientation values");
+        }
+
+        // Place the instance like a detector section with its position and orientation
+        Configuration instance_config(config);
+        instance_config.setText("position", columns[1] + " " + columns[2] + " " + columns[3]);
+        if(columns.size() == 7) {
+            instance_config.setText("orientation", columns[4] + " " + columns[5] + " " + columns[6]);
+        }
+
+        LOG(DEBUG) << "Detector " << columns[0] << " from table of " << config.getName() << ":";
+        auto [position, orientation] = calculate_orientation(instance_config);
+
+        // NOTE: cannot use make_shared here due to the private constructor
+        auto detector = std::shared_ptr<Detector>(new Detector(columns[0], std::move(position), orientation));
+        addDetector(detector);
+        unresolved.emplace_back(config, detector.get());
+        instances++;
+    }
+
+    LOG(DEBUG) << "Created " << instances << " detectors from table " << file_name;
+}
+
 /**
  * Calculates the position and orientation of the object from the provided configuration file
  */
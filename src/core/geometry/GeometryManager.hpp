@@ -12,11 +12,14 @@
 #ifndef ALLPIX_GEOMETRY_MANAGER_H
 #define ALLPIX_GEOMETRY_MANAGER_H
 
+#include <array>
 #include <filesystem>
+#include <limits>
 #include <memory>
 #include <regex>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <Math/Vector3D.h>
@@ -40,6 +43,15 @@ namespace allpix {
 
     using MagneticFieldFunction = std::function<ROOT::Math::XYZVector(const ROOT::Math::XYZPoint&)>;
 
+    /**
+     * @brief Intersection of a line with the sensor of a detector
+     */
+    struct DetectorIntersection {
+        std::shared_ptr<Detector> detector; ///< Detector whose sensor is intersected
+        double entry;                       ///< Signed distance to the entry point in units of the direction length
+        double exit;                        ///< Signed distance to the exit point in units of the direction length
+    };
+
     /**
      * @ingroup Managers
      * @brief Manager responsible for the global geometry
@@ -198,6 +210,23 @@ namespace allpix {
          */
         std::vector<std::shared_ptr<Detector>> getDetectorsByType(const std::string& type);
 
+        /**
+         * @brief Find all detectors whose sensor is intersected by a line segment
+         * @param position A point on the line in global coordinates
+         * @param direction Direction of the line in global coordinates
+         * @param min_distance Start of the segment as signed distance from the point in units of the direction length
+         * @param max_distance End of the segment as signed distance from the point in units of the direction length
+         * @return Intersections of the segment with the sensors, ordered by the distance of the entry point
+         *
+         * The detectors are looked up in a bounding volume hierarchy built from the sensors of all detectors when the
+         * geometry is closed, such that only the detectors close to the line are tested for an intersection.
+         */
+        std::vector<DetectorIntersection>
+        getIntersectedDetectors(const ROOT::Math::XYZPoint& position,
+                                const ROOT::Math::XYZVector& direction,
+                                double min_distance = std::numeric_limits<double>::lowest(),
+                                double max_distance = std::numeric_limits<double>::max());
+
         /**
          * @brief Set the magnetic field in the volume
          * @param function Function used to retrieve the magnetic field
@@ -279,23 +308,46 @@ namespace allpix {
          */
         std::pair<ROOT::Math::XYZPoint, ROOT::Math::Rotation3D> calculate_orientation(const Configuration& config);
 
+        /**
+         * @brief Create the detectors listed in the table of instances of a detector section
+         * @param config Configuration of the detector section with the path to the table
+         */
+        void load_instances(const Configuration& config);
+
         /**
          * @brief Close the geometry after which changes to the detector geometry cannot be made anymore
          */
         void close_geometry();
         std::atomic_bool closed_;
 
+        /**
+         * @brief Node of the bounding volume hierarchy of the detector sensors
+         */
+        struct DetectorVolume {
+            std::array<double, 3> min{}, max{};
+            size_t first{}, count{}; ///< Range of the detectors of a leaf in the volume order, no detectors for inner nodes
+            size_t left{}, right{};  ///< Child nodes of an inner node
+        };
+
+        /**
+         * @brief Build the bounding volume hierarchy from the axis-aligned bounding boxes of all detector sensors
+         */
+        void build_detector_volumes();
+        std::vector<DetectorVolume> detector_volumes_;
+        std::vector<size_t> detector_volume_order_;
+
         RandomNumberGenerator random_generator_;
 
         std::vector<ROOT::Math::XYZPoint> points_;
 
         std::vector<std::string> model_paths_;
         std::vector<std::shared_ptr<DetectorModel>> models_;
-        std::set<std::string> model_names_;
+        std::unordered_map<std::string, size_t> model_index_;
 
         std::map<std::string, std::vector<std::pair<Configuration, Detector*>>> nonresolved_models_;
         std::vector<std::shared_ptr<Detector>> detectors_;
-        std::set<std::string> detector_names_;
+        std::unordered_map<std::string, size_t> detector_index_;
+        std::unordered_map<std::string, std::vector<size_t>> detector_types_;
 
         std::list<Configuration> passive_elements_;
         std::map<std::string, std::pair<ROOT::Math::XYZPoint, ROOT::Math::Rotation3D>> passive_orientations_;
@@ -10,6 +10,9 @@
  */
 
 #include "HexagonalPixelDetectorModel.hpp"
+
+#include <algorithm>
+
 #include "core/module/exceptions.h"
 
 using namespace allpix;
@@ -26,6 +29,12 @@ HexagonalPixelDetectorModel::HexagonalPixelDetectorModel(std::string type,
         throw InvalidValueError(
             config, "pixel_type", "for this model, only pixel types 'hexagon_pointy' and 'hexagon_flat' are available");
     }
+    inv_transform_ = (pixel_type_ == Pixel::Type::HEXAGON_POINTY ? inv_transform_pointy_ : inv_transform_flat_);
+
+    // Precompute the offsets of the neighbors for the commonly used distances
+    for(size_t distance = 0; distance <= max_precomputed_distance_; distance++) {
+        neighbor_offsets_.push_back(get_neighbor_offsets(distance));
+    }
 }
 
 ROOT::Math::XYZPoint HexagonalPixelDetectorModel::getMatrixCenter() const {
@@ -56,16 +65,19 @@ ROOT::Math::XYZPoint HexagonalPixelDetectorModel::getPixelCenter(const int x, co
 }
 
 std::pair<int, int> HexagonalPixelDetectorModel::getPixelIndex(const ROOT::Math::XYZPoint& position) const {
-    auto pt = ROOT::Math::XYPoint(position.x() / pixel_size_.x() * 2, position.y() / pixel_size_.y() * 2);
-    double q = 0, r = 0;
-    if(pixel_type_ == Pixel::Type::HEXAGON_POINTY) {
-        q = inv_transform_pointy_.at(0) * pt.x() + inv_transform_pointy_.at(1) * pt.y();
-        r = inv_transform_pointy_.at(2) * pt.x() + inv_transform_pointy_.at(3) * pt.y();
-    } else {
-        q = inv_transform_flat_.at(0) * pt.x() + inv_transform_flat_.at(1) * pt.y();
-        r = inv_transform_flat_.at(2) * pt.x() + inv_transform_flat_.at(3) * pt.y();
+    std::array<int, 2> index{};
+    pixel_index(position.x(), position.y(), index.data());
+    return {index[0], index[1]};
+}
+
+void HexagonalPixelDetectorModel::getPixelIndex(
+    const double* x, const double* y, size_t count, int* index_x, int* index_y) const {
+    for(size_t i = 0; i < count; ++i) {
+        std::array<int, 2> index{};
+        pixel_index(x[i], y[i], index.data());
+        index_x[i] = index[0];
+        index_y[i] = index[1];
     }
-    return round_to_nearest_hex(q, r);
 }
 
 /*
@@ -108,16 +120,39 @@ ROOT::Math::XYZVector HexagonalPixelDetectorModel::getMatrixSize() const {
 std::set<Pixel::Index> HexagonalPixelDetectorModel::getNeighbors(const Pixel::Index& idx, const size_t distance) const {
     std::set<Pixel::Index> neighbors;
 
-    for(int x = idx.x() - static_cast<int>(distance); x <= idx.x() + static_cast<int>(distance); x++) {
-        for(int y = idx.y() - static_cast<int>(distance); y <= idx.y() + static_cast<int>(distance); y++) {
-            if(hex_distance(idx.x(), idx.y(), x, y) <= distance && isWithinMatrix(x, y)) {
-                neighbors.insert({x, y});
-            }
+    // Use the precomputed offsets where available
+    std::vector<Pixel::Index> computed_offsets;
+    if(distance > max_precomputed_distance_) {
+        computed_offsets = get_neighbor_offsets(distance);
+    }
+    const auto& offsets = (distance <= max_precomputed_distance_ ? neighbor_offsets_[distance] : computed_offsets);
+    for(const auto& offset : offsets) {
+        auto x = idx.x() + offset.x();
+        auto y = idx.y() + offset.y();
+        if(isWithinMatrix(x, y)) {
+            neighbors.insert({x, y});
         }
     }
     return neighbors;
 }
 
+/*
+ * The hexagons within the distance fulfill |dx| <= d, |dy| <= d and |dx + dy| <= d in cubic coordinates, such that the range
+ * of the row offsets can be calculated for every column offset instead of testing all offsets of the enclosing square.
+ */
+std::vector<Pixel::Index> HexagonalPixelDetectorModel::get_neighbor_offsets(const size_t distance) const {
+    std::vector<Pixel::Index> offsets;
+    auto dist = static_cast<int>(distance);
+    offsets.reserve(static_cast<size_t>(3 * dist * (dist + 1) + 1));
+
+    for(int x = -dist; x <= dist; x++) {
+        for(int y = std::max(-dist, -x - dist); y <= std::min(dist, -x + dist); y++) {
+            offsets.emplace_back(x, y);
+        }
+    }
+    return offsets;
+}
+
 bool HexagonalPixelDetectorModel::areNeighbors(const Pixel::Index& seed,
                                                const Pixel::Index& entrant,
                                                const size_t distance) const {
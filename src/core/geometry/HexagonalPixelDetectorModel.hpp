@@ -12,6 +12,11 @@
 #ifndef ALLPIX_HEXAGONAL_PIXEL_DETECTOR_H
 #define ALLPIX_HEXAGONAL_PIXEL_DETECTOR_H
 
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
 #include "PixelDetectorModel.hpp"
 
 namespace allpix {
@@ -69,6 +74,16 @@ namespace allpix {
          */
         std::pair<int, int> getPixelIndex(const ROOT::Math::XYZPoint& position) const override;
 
+        /**
+         * @brief Evaluate \ref getPixelIndex for a batch of positions given as separate coordinate arrays
+         * @param x       Local x-coordinates of the positions
+         * @param y       Local y-coordinates of the positions
+         * @param count   Number of positions
+         * @param index_x Storage for the x-coordinate of the pixel index of every position
+         * @param index_y Storage for the y-coordinate of the pixel index of every position
+         */
+        void getPixelIndex(const double* x, const double* y, size_t count, int* index_x, int* index_y) const;
+
         /**
          * @brief Returns if a set of pixel coordinates is within the grid of pixels defined for the device
          * @param x X- (or column-) coordinate to be checked
@@ -109,6 +124,14 @@ namespace allpix {
          */
         bool areNeighbors(const Pixel::Index& seed, const Pixel::Index& entrant, const size_t distance) const override;
 
+    protected:
+        /**
+         * @brief Calculate the offsets of all hexagons within the given distance
+         * @param distance  Distance for pixels to be considered neighbors
+         * @return Offsets of the neighboring pixel indices
+         */
+        std::vector<Pixel::Index> get_neighbor_offsets(const size_t distance) const override;
+
     private:
         // Transformations from axial coordinates to cartesian coordinates
         const std::array<double, 4> transform_pointy_{std::sqrt(3.0), std::sqrt(3.0) / 2.0, 0.0, 3.0 / 2.0};
@@ -118,6 +141,27 @@ namespace allpix {
         const std::array<double, 4> inv_transform_pointy_{std::sqrt(3.0) / 3.0, -1.0 / 3.0, 0.0, 2.0 / 3.0};
         const std::array<double, 4> inv_transform_flat_{2.0 / 3.0, 0.0, -1.0 / 3.0, std::sqrt(3.0) / 3.0};
 
+        // Inverse transformation of the selected hexagon orientation
+        std::array<double, 4> inv_transform_{};
+
+        // Offsets of the neighboring hexagons, precomputed up to a maximum distance and indexed by the distance
+        static constexpr size_t max_precomputed_distance_{3};
+        std::vector<std::vector<Pixel::Index>> neighbor_offsets_;
+
+        /**
+         * @brief Helper to calculate the axial index of the hexagon a local position is in
+         * @param x     Local x-coordinate of the position
+         * @param y     Local y-coordinate of the position
+         * @param index Storage for the column and row axial index of the hexagon
+         */
+        void pixel_index(double x, double y, int* index) const {
+            auto pt_x = x / pixel_size_.x() * 2;
+            auto pt_y = y / pixel_size_.y() * 2;
+            round_to_nearest_hex(inv_transform_[0] * pt_x + inv_transform_[1] * pt_y,
+                                 inv_transform_[2] * pt_x + inv_transform_[3] * pt_y,
+                                 index);
+        }
+
         /**
          * @brief Helper to calculate the center along x of a hexagon in cartesian coordinates
          * @param  x Axial column index
@@ -144,9 +188,24 @@ namespace allpix {
          * @brief Helper function to correctly round floating-point hexagonal positions to the nearest hexagon.
          * @param x  Column axial coordinate of the hexagon
          * @param y  Row axial coordinate of the hexagon
-         * @return Indices of nearest hexagon
+         * @param index Storage for the indices of nearest hexagon
+         *
+         * The component with the largest rounding error is reconstructed from the other two, selecting the components with
+         * conditional moves instead of branches
          */
-        std::pair<int, int> round_to_nearest_hex(double x, double y) const;
+        static void round_to_nearest_hex(double x, double y, int* index) {
+            auto z = -x - y;
+            auto q = std::round(x);
+            auto r = std::round(y);
+            auto s = std::round(z);
+            auto q_diff = std::fabs(q - x);
+            auto r_diff = std::fabs(r - y);
+            auto s_diff = std::fabs(s - z);
+            auto q_largest = static_cast<bool>(static_cast<int>(q_diff > r_diff) & static_cast<int>(q_diff > s_diff));
+            auto r_largest = static_cast<bool>(static_cast<int>(!q_largest) & static_cast<int>(r_diff > s_diff));
+            index[0] = static_cast<int>(q_largest ? -r - s : q);
+            index[1] = static_cast<int>(r_largest ? -q - s : r);
+        }
 
         /**
          * @brief Helper function to calculate the distance between two hexagons using Manhattan metric in cubic coordinates
@@ -129,6 +129,18 @@ std::set<Pixel::Index> PixelDetectorModel::getNeighbors(const Pixel::Index& idx,
     return neighbors;
 }
 
+std::vector<Pixel::Index> PixelDetectorModel::get_neighbor_offsets(const size_t distance) const {
+    std::vector<Pixel::Index> offsets;
+
+    for(int x = -static_cast<int>(distance); x <= static_cast<int>(distance); x++) {
+        for(int y = -static_cast<int>(distance); y <= static_cast<int>(distance); y++) {
+            offsets.emplace_back(x, y);
+        }
+    }
+
+    return offsets;
+}
+
 bool PixelDetectorModel::areNeighbors(const Pixel::Index& seed, const Pixel::Index& entrant, const size_t distance) const {
     return (static_cast<size_t>(std::abs(seed.x() - entrant.x())) <= distance &&
             static_cast<size_t>(std::abs(seed.y() - entrant.y())) <= distance);
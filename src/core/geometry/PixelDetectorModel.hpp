@@ -134,6 +134,13 @@ namespace allpix {
 
     protected:
         void validate() override;
+
+        /**
+         * @brief Calculate the offsets of all pixels within the given distance along both axes
+         * @param distance  Distance for pixels to be considered neighbors
+         * @return Offsets of the neighboring pixel indices
+         */
+        std::vector<Pixel::Index> get_neighbor_offsets(const size_t distance) const override;
     };
 } // namespace allpix
 
@@ -92,6 +92,14 @@ RadialStripDetectorModel::RadialStripDetectorModel(std::string type,
 
     // Translation vector from local coordinate center to sensor focal point
     focus_translation_ = {getCenterRadius() * sin(stereo_angle_), getCenterRadius() * (1 - cos(stereo_angle_)), 0};
+
+    // Precompute the quantities of the strip rows and the focal point used by the geometry queries
+    for(unsigned int row = 0; row < strip_rows; row++) {
+        row_half_angle_.push_back(angular_pitch_.at(row) * number_of_strips_.at(row) / 2);
+        row_center_radius_.push_back((row_radius_.at(row) + row_radius_.at(row + 1)) / 2);
+    }
+    focus_distance_ = std::sqrt(focus_translation_.mag2());
+    focus_alpha_ = std::acos(focus_distance_ / (2 * getCenterRadius()));
 }
 
 bool RadialStripDetectorModel::isWithinSensor(const ROOT::Math::XYZPoint& local_pos) const {
@@ -102,14 +110,16 @@ bool RadialStripDetectorModel::isWithinSensor(const ROOT::Math::XYZPoint& local_
        (polar_pos.r() > row_radius_.back() || polar_pos.r() < row_radius_.front())) {
         return false;
     }
-    // Find which strip row the position belongs to
-    for(unsigned int row = 0; row < getNPixels().y(); row++) {
-        if(polar_pos.r() > row_radius_.at(row) && polar_pos.r() <= row_radius_.at(row + 1)) {
-            // Check if the angular coordinate is within that strip row
-            return (std::fabs(polar_pos.phi() + stereo_angle_) <= angular_pitch_.at(row) * number_of_strips_.at(row) / 2);
-        }
+    // Find which strip row the position belongs to and check if the angular coordinate is within that strip row
+    auto row = find_row(polar_pos.r());
+    return row >= 0 && std::fabs(polar_pos.phi() + stereo_angle_) <= row_half_angle_[static_cast<unsigned int>(row)];
+}
+
+void RadialStripDetectorModel::isWithinSensor(
+    const double* x, const double* y, const double* z, size_t count, bool* within) const {
+    for(size_t i = 0; i < count; ++i) {
+        within[i] = RadialStripDetectorModel::isWithinSensor(ROOT::Math::XYZPoint(x[i], y[i], z[i]));
     }
-    return false;
 }
 
 bool RadialStripDetectorModel::isOnSensorBoundary(const ROOT::Math::XYZPoint& local_pos) const {
@@ -120,14 +130,9 @@ bool RadialStripDetectorModel::isOnSensorBoundary(const ROOT::Math::XYZPoint& lo
        (polar_pos.r() == row_radius_.back() || polar_pos.r() == row_radius_.front())) {
         return true;
     }
-    // Find which strip row the position belongs to
-    for(unsigned int row = 0; row < getNPixels().y(); row++) {
-        if(polar_pos.r() > row_radius_.at(row) && polar_pos.r() <= row_radius_.at(row + 1)) {
-            // Check if the angular coordinate is on the edge of strip row
-            return (std::fabs(polar_pos.phi() + stereo_angle_) == angular_pitch_.at(row) * number_of_strips_.at(row) / 2);
-        }
-    }
-    return false;
+    // Find which strip row the position belongs to and check if the angular coordinate is on the edge of that strip row
+    auto row = find_row(polar_pos.r());
+    return row >= 0 && std::fabs(polar_pos.phi() + stereo_angle_) == row_half_angle_[static_cast<unsigned int>(row)];
 }
 
 bool RadialStripDetectorModel::isWithinMatrix(const Pixel::Index& strip_index) const {
@@ -147,25 +152,19 @@ ROOT::Math::Polar2DPoint RadialStripDetectorModel::getPositionPolar(const ROOT::
 }
 
 ROOT::Math::XYPoint RadialStripDetectorModel::getPositionCartesian(const ROOT::Math::Polar2DPoint& polar_pos) const {
-    // Length of the translation vector from the local center to the focal point
-    auto len_foc = std::sqrt(focus_translation_.mag2());
-    // Calculate two relevant angles needed for the transformation of the angular component to be measured from the local
-    // coordinate center instead of the strip focal point
-    auto alpha = std::acos(len_foc / (2 * getCenterRadius()));
-    auto gamma = asin(len_foc * sin(alpha + polar_pos.phi() + stereo_angle_) / polar_pos.r());
+    // Calculate the angle needed for the transformation of the angular component to be measured from the local coordinate
+    // center instead of the strip focal point, using the precomputed distance to the focal point and its angle
+    auto gamma = asin(focus_distance_ * sin(focus_alpha_ + polar_pos.phi() + stereo_angle_) / polar_pos.r());
     // Transform the angle
-    auto phi = 2 * alpha + gamma + polar_pos.phi() + stereo_angle_ - ROOT::Math::Pi();
+    auto phi = 2 * focus_alpha_ + gamma + polar_pos.phi() + stereo_angle_ - ROOT::Math::Pi();
 
     return {polar_pos.r() * sin(phi), polar_pos.r() * cos(phi)};
 }
 
 ROOT::Math::XYZPoint RadialStripDetectorModel::getPixelCenter(int x, int y) const {
-    // Calculate the radial coordinate of the strip center
-    auto local_r = (row_radius_.at(static_cast<unsigned int>(y)) + row_radius_.at(static_cast<unsigned int>(y + 1))) / 2;
-    // Calculate the angular coordinate of the strip center
-    auto local_phi =
-        -angular_pitch_.at(static_cast<unsigned int>(y)) * number_of_strips_.at(static_cast<unsigned int>(y)) / 2 +
-        (x + 0.5) * angular_pitch_.at(static_cast<unsigned int>(y)) - stereo_angle_;
+    // Calculate the radial and the angular coordinate of the strip center
+    auto local_r = row_center_radius_.at(static_cast<unsigned int>(y));
+    auto local_phi = strip_center_phi(x, static_cast<unsigned int>(y));
 
     // Convert strip center position to cartesian coordinates
     auto center = getPositionCartesian(ROOT::Math::Polar2DPoint(local_r, local_phi));
@@ -180,30 +179,32 @@ std::pair<int, int> RadialStripDetectorModel::getPixelIndex(const ROOT::Math::XY
     // Convert local position to polar coordinates
     auto polar_pos = getPositionPolar(position);
 
-    // Get row index
-    int strip_y{};
-    for(unsigned int row = 0; row < getNPixels().y(); row++) {
-        // Find the correct strip row by comparing to inner and outer row radii
-        if(polar_pos.r() > row_radius_.at(row) && polar_pos.r() <= row_radius_.at(row + 1)) {
-            strip_y = static_cast<int>(row);
-            break;
-        }
-    }
-    // Get the strip pitch in the correct strip row
-    auto pitch = angular_pitch_.at(static_cast<unsigned int>(strip_y));
+    // Get row index from the inner and outer row radii, positions outside of all rows are assigned to the first row
+    auto strip_y = std::max(find_row(polar_pos.r()), 0);
     // Calculate the strip x-index
-    auto strip_x = static_cast<int>(std::floor(
-        (polar_pos.phi() + stereo_angle_ + pitch * number_of_strips_.at(static_cast<unsigned int>(strip_y)) / 2) / pitch));
+    auto strip_x = strip_index(polar_pos.phi(), static_cast<unsigned int>(strip_y));
 
     return {strip_x, strip_y};
 }
 
+void RadialStripDetectorModel::getPixelIndex(
+    const double* x, const double* y, size_t count, int* index_x, int* index_y) const {
+    for(size_t i = 0; i < count; ++i) {
+        // Polar coordinates as in getPositionPolar, with the angle measured from the strip focal point
+        auto r = std::sqrt(x[i] * x[i] + y[i] * y[i]);
+        auto phi = std::atan2(x[i] - focus_translation_.x(), y[i] - focus_translation_.y());
+        index_y[i] = std::max(find_row(r), 0);
+        index_x[i] = strip_index(phi, static_cast<unsigned int>(index_y[i]));
+    }
+}
+
 std::set<Pixel::Index> RadialStripDetectorModel::getNeighbors(const Pixel::Index& idx, const size_t distance) const {
     // Vector to hold the neighbor indices
     std::vector<Pixel::Index> neighbors;
 
-    // Position of the global seed in polar coordinates
-    auto seed_pol = getPositionPolar(getPixelCenter(idx.x(), idx.y()));
+    // Angular coordinate of the center of the global seed, the row seeds are located at the same angle in the center of
+    // their strip row such that their strip index follows directly from it
+    auto seed_phi = strip_center_phi(idx.x(), static_cast<unsigned int>(idx.y()));
 
     // Iterate over eligible strip rows
     for(int y = static_cast<int>(-distance); y <= static_cast<int>(distance); y++) {
@@ -212,21 +213,9 @@ std::set<Pixel::Index> RadialStripDetectorModel::getNeighbors(const Pixel::Index
             continue;
         }
 
-        // Set starting position of a row seed to the global seed position
-        auto row_seed_r = seed_pol.r();
-
-        // Move row seed position to the center of a requested row
-        for(unsigned int shift_y = 1; shift_y <= std::labs(y); shift_y++) {
-            // Add or subtract position based on whether given row is below or above global seed
-            row_seed_r += (y < 0) ? -strip_length_.at(static_cast<unsigned int>(idx.y()) - shift_y + 1) / 2 -
-                                        strip_length_.at(static_cast<unsigned int>(idx.y()) - shift_y) / 2
-                                  : strip_length_.at(static_cast<unsigned int>(idx.y()) + shift_y - 1) / 2 +
-                                        strip_length_.at(static_cast<unsigned int>(idx.y()) + shift_y) / 2;
-        }
-
-        // Get cartesian position and pixel indices of the row seed
-        auto row_seed = getPositionCartesian({row_seed_r, seed_pol.phi()});
-        auto [row_seed_x, row_seed_y] = getPixelIndex({row_seed.x(), row_seed.y(), 0});
+        // Get the strip index of the row seed
+        auto row_seed_y = idx.y() + y;
+        auto row_seed_x = strip_index(seed_phi, static_cast<unsigned int>(row_seed_y));
 
         // Iterate over potential neighbors of the row seed
         for(int j = static_cast<int>(-distance); j <= static_cast<int>(distance); j++) {
@@ -257,23 +246,9 @@ bool RadialStripDetectorModel::areNeighbors(const Pixel::Index& seed,
         return (static_cast<size_t>(std::abs(seed.x() - entrant.x())) <= distance);
     }
 
-    // Position of the global seed in polar coordinates
-    auto seed_pol = getPositionPolar(getPixelCenter(seed.x(), seed.y()));
-
-    // Set starting position of a row seed to the global seed position
-    auto row_seed_r = seed_pol.r();
-
-    // Move row seed position to the center of the requested row
-    for(unsigned int shift_y = 0; shift_y < static_cast<unsigned int>(std::abs(dist_y)); shift_y++) {
-        row_seed_r += (dist_y < 0) ? -strip_length_.at(static_cast<unsigned int>(seed.y()) - shift_y) / 2 -
-                                         strip_length_.at(static_cast<unsigned int>(seed.y()) - shift_y - 1) / 2
-                                   : strip_length_.at(static_cast<unsigned int>(seed.y()) + shift_y) / 2 +
-                                         strip_length_.at(static_cast<unsigned int>(seed.y()) + shift_y + 1) / 2;
-    }
-
-    // Get cartesian position and pixel indices of the row seed
-    auto row_seed = getPositionCartesian({row_seed_r, seed_pol.phi()});
-    auto [row_seed_x, row_seed_y] = getPixelIndex({row_seed.x(), row_seed.y(), 0});
+    // Get the strip index of the row seed at the angular coordinate of the seed center in the row of the entrant
+    auto seed_phi = strip_center_phi(seed.x(), static_cast<unsigned int>(seed.y()));
+    auto row_seed_x = strip_index(seed_phi, static_cast<unsigned int>(entrant.y()));
 
     // Compare row seed and entrant positions
     return (static_cast<size_t>(std::abs(row_seed_x - entrant.x())) <= distance) &&
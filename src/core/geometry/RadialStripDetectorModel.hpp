@@ -12,6 +12,9 @@
 #ifndef ALLPIX_RADIAL_STRIP_DETECTOR_MODEL_H
 #define ALLPIX_RADIAL_STRIP_DETECTOR_MODEL_H
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
 #include <numeric>
 #include <string>
 #include <utility>
@@ -246,6 +249,26 @@ namespace allpix {
          */
         std::pair<int, int> getPixelIndex(const ROOT::Math::XYZPoint& position) const override;
 
+        /**
+         * @brief Evaluate \ref getPixelIndex for a batch of positions given as separate coordinate arrays
+         * @param x       Local x-coordinates of the positions
+         * @param y       Local y-coordinates of the positions
+         * @param count   Number of positions
+         * @param index_x Storage for the x-coordinate of the strip index of every position
+         * @param index_y Storage for the y-coordinate of the strip index of every position
+         */
+        void getPixelIndex(const double* x, const double* y, size_t count, int* index_x, int* index_y) const;
+
+        /**
+         * @brief Evaluate \ref isWithinSensor for a batch of positions given as separate coordinate arrays
+         * @param x      Local x-coordinates of the positions
+         * @param y      Local y-coordinates of the positions
+         * @param z      Local z-coordinates of the positions
+         * @param count  Number of positions
+         * @param within Storage for the result of every position
+         */
+        void isWithinSensor(const double* x, const double* y, const double* z, size_t count, bool* within) const;
+
         /**
          * @brief Return a set containing all pixels neighboring the given one with a configurable maximum distance
          * @param idx       Index of the pixel in question
@@ -326,6 +349,37 @@ namespace allpix {
          */
         void setStereoAngle(double val) { stereo_angle_ = val; }
 
+        /**
+         * @brief Find the strip row of a radial coordinate in the sorted table of row radii
+         * @param r Radial coordinate
+         * @return Index of the strip row or -1 if the radial coordinate is outside of all strip rows
+         */
+        int find_row(double r) const {
+            // Strip rows cover the radii from above their inner row radius up to and including their outer row radius
+            auto row = std::lower_bound(row_radius_.begin(), row_radius_.end(), r) - row_radius_.begin() - 1;
+            return (row < 0 || row >= static_cast<long>(row_half_angle_.size()) ? -1 : static_cast<int>(row));
+        }
+
+        /**
+         * @brief Calculate the strip x-index of an angular coordinate within a strip row
+         * @param phi Angular coordinate measured from the strip focal point
+         * @param row Strip row
+         * @return Strip x-index, not checked to be within the strip row
+         */
+        int strip_index(double phi, unsigned int row) const {
+            return static_cast<int>(std::floor((phi + stereo_angle_ + row_half_angle_[row]) / angular_pitch_[row]));
+        }
+
+        /**
+         * @brief Calculate the angular coordinate of the center of a strip, measured from the strip focal point
+         * @param x Strip x-index
+         * @param y Strip row
+         * @return Angular coordinate of the strip center
+         */
+        double strip_center_phi(int x, unsigned int y) const {
+            return -row_half_angle_[y] + (x + 0.5) * angular_pitch_[y] - stereo_angle_;
+        }
+
         std::vector<unsigned int> number_of_strips_{};
         std::vector<double> strip_length_{};
         std::vector<double> angular_pitch_{};
@@ -338,6 +392,13 @@ namespace allpix {
         std::vector<double> row_angle_{};
 
         ROOT::Math::XYZVector focus_translation_;
+
+        // Precomputed half angle subtended by every strip row and radius of the strip centers of every row, as well as the
+        // distance to the focal point and the corresponding angle of the transformation to cartesian coordinates
+        std::vector<double> row_half_angle_{};
+        std::vector<double> row_center_radius_{};
+        double focus_distance_{};
+        double focus_alpha_{};
     };
 } // namespace allpix
 
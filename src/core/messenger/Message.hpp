@@ -54,6 +54,19 @@ namespace allpix {
          */
         virtual std::vector<std::reference_wrapper<Object>> getObjectArray();
 
+        /**
+         * @brief Estimate the memory held by this message
+         * @return Estimated size in bytes
+         * @note Memory allocated indirectly by the contained objects is not accounted for
+         */
+        virtual size_t getMemorySize() const { return sizeof(*this); }
+
+        /**
+         * @brief Get the number of objects stored in this message
+         * @return Number of objects, zero for messages without a list of objects
+         */
+        virtual size_t getObjectCount() const { return 0; }
+
     protected:
         /**
          * @brief Construct a general message not linked to a detector
@@ -104,6 +117,18 @@ namespace allpix {
          */
         std::vector<std::reference_wrapper<Object>> getObjectArray() override;
 
+        /**
+         * @brief Estimate the memory held by this message and its data
+         * @return Estimated size in bytes
+         */
+        size_t getMemorySize() const override { return sizeof(*this) + data_.capacity() * sizeof(T); }
+
+        /**
+         * @brief Get the number of objects stored in this message
+         * @return Number of data objects
+         */
+        size_t getObjectCount() const override { return data_.size(); }
+
     private:
         /**
          * @brief Returns object array for messages containing objects
@@ -11,16 +11,20 @@
 
 #include "Messenger.hpp"
 
+#include <algorithm>
 #include <memory>
+#include <set>
 #include <stdexcept>
 #include <string>
 #include <typeindex>
+#include <vector>
 
 #include "Message.hpp"
 #include "core/module/Module.hpp"
 #include "core/utils/log.h"
 #include "core/utils/type.h"
 #include "delegates.h"
+#include "exceptions.h"
 
 using namespace allpix;
 
@@ -31,10 +35,20 @@ Messenger::~Messenger() = default;
 Messenger::~Messenger() { assert(delegate_to_iterator_.empty()); }
 #endif
 
+// Check if a delegate receives the messages of a detector, i.e. if it is one of the detectors handled by its module
+static bool handles_detector(BaseDelegate* delegate, const std::shared_ptr<const Detector>& detector) {
+    if(detector == nullptr) {
+        return false;
+    }
+    const auto& detectors = delegate->getDetectors();
+    return std::any_of(detectors.begin(), detectors.end(), [&](const auto& handled) {
+        return handled->getName() == detector->getName();
+    });
+}
+
 // Check if the detectors match for the message and the delegate and that we don't have self-dispatch
-static bool check_send(Module* source, BaseMessage* message, BaseDelegate* delegate) {
-    if(delegate->getDetector() != nullptr &&
-       (message->getDetector() == nullptr || delegate->getDetector()->getName() != message->getDetector()->getName())) {
+static bool check_send(Module* source, const std::shared_ptr<const Detector>& detector, BaseDelegate* delegate) {
+    if(delegate->getDetector() != nullptr && !handles_detector(delegate, detector)) {
         return false;
     }
     if(delegate->getUniqueName() == source->getUniqueName()) {
@@ -42,41 +56,95 @@ static bool check_send(Module* source, BaseMessage* message, BaseDelegate* deleg
     }
     return true;
 }
+static bool check_send(Module* source, BaseMessage* message, BaseDelegate* delegate) {
+    return check_send(source, message->getDetector(), delegate);
+}
 
 /**
  * Messages should be bound during construction, so this function only gives useful information outside the constructor
  */
 bool Messenger::hasReceiver(Module* source, const std::shared_ptr<BaseMessage>& message) {
-    std::lock_guard<std::mutex> lock(mutex_);
-
     const BaseMessage* inst = message.get();
-    std::type_index type_idx = typeid(*inst);
+    return has_receiver(source, typeid(*inst), message->getDetector());
+}
+
+bool Messenger::has_receiver(Module* source,
+                             const std::type_index& type_idx,
+                             const std::shared_ptr<const Detector>& detector) {
+    std::lock_guard<std::mutex> lock(mutex_);
 
     // Get the name of the output message
     auto name = source->get_configuration().get<std::string>("output");
 
-    // Check if a normal specific listener exists
-    for(auto& delegate : delegates_[type_idx][name]) {
-        if(check_send(source, message.get(), delegate.get())) {
-            return true;
-        }
+    // Check the specific and generic listeners of the message type and of the base message, as well as the listeners of
+    // unnamed messages if the output has no name
+    std::vector<std::string> ids = {name, "*"};
+    if(name.empty()) {
+        ids.emplace_back("?");
     }
-    // Check if a normal generic listener exists
-    for(auto& delegate : delegates_[type_idx]["*"]) {
-        if(check_send(source, message.get(), delegate.get())) {
-            return true;
+    for(const auto& listener_type : {type_idx, std::type_index(typeid(BaseMessage))}) {
+        const auto type_iter = delegates_.find(listener_type);
+        if(type_iter == delegates_.end()) {
+            continue;
         }
-    }
-    // Check if a base message specific listener exists
-    for(auto& delegate : delegates_[typeid(BaseMessage)][name]) {
-        if(check_send(source, message.get(), delegate.get())) {
-            return true;
+        for(const auto& id : ids) {
+            const auto id_iter = type_iter->second.find(id);
+            if(id_iter == type_iter->second.end()) {
+                continue;
+            }
+            for(const auto& delegate : id_iter->second) {
+                if(check_send(source, detector, delegate.get())) {
+                    return true;
+                }
+            }
         }
     }
-    // Check if a base message generic listener exists
-    for(auto& delegate : delegates_[typeid(BaseMessage)]["*"]) {
-        if(check_send(source, message.get(), delegate.get())) {
-            return true;
+
+    return false;
+}
+
+/**
+ * Messages can be bound to any detector if the source is a unique module, while messages from detector modules are
+ * assumed to be bound to their detector or to no detector at all. Only delegates of the message types declared by the source
+ * and filters for all messages are considered.
+ */
+bool Messenger::has_consumer(Module* source, const std::set<std::string>& ignored) {
+    const auto& outputs = source->output_types_;
+    if(outputs.empty()) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto name = source->get_configuration().get<std::string>("output");
+    std::vector<std::string> ids = {name, "*"};
+    if(name.empty()) {
+        ids.emplace_back("?");
+    }
+
+    for(const auto& [type_idx, named_delegates] : delegates_) {
+        if(type_idx != std::type_index(typeid(BaseMessage)) && outputs.find(type_idx) == outputs.end()) {
+            continue;
+        }
+        for(const auto& id : ids) {
+            const auto id_iter = named_delegates.find(id);
+            if(id_iter == named_delegates.end()) {
+                continue;
+            }
+            for(const auto& delegate : id_iter->second) {
+                auto receiver = delegate->getUniqueName();
+                if(receiver == source->getUniqueName() || ignored.find(receiver) != ignored.end()) {
+                    continue;
+                }
+                const auto& detectors = source->getDetectors();
+                if(source->getDetector() != nullptr && delegate->getDetector() != nullptr &&
+                   std::none_of(detectors.begin(), detectors.end(), [&](const auto& detector) {
+                       return handles_detector(delegate.get(), detector);
+                   })) {
+                    continue;
+                }
+                return true;
+            }
         }
     }
 
@@ -103,6 +171,10 @@ void Messenger::add_delegate(const std::type_info& message_type,
         message_name = module->get_configuration().get<std::string>("input");
     }
 
+    // Discard the frozen dispatch table, it does not know about this delegate
+    frozen_ = false;
+    frozen_delegates_.clear();
+
     // Register delegate internally
     delegates_[std::type_index(message_type)][message_name].push_back(delegate);
     auto delegate_iter = --delegates_[std::type_index(message_type)][message_name].end();
@@ -123,10 +195,79 @@ void Messenger::remove_delegate(BaseDelegate* delegate) {
     if(iter == delegate_to_iterator_.end()) {
         throw std::out_of_range("delegate not found in listeners");
     }
+
+    // Discard the frozen dispatch table, it still references this delegate
+    frozen_ = false;
+    frozen_delegates_.clear();
+
     delegates_[std::get<0>(iter->second)][std::get<1>(iter->second)].erase(std::get<2>(iter->second));
     delegate_to_iterator_.erase(iter);
 }
 
+/**
+ * Every list of delegates is split up by detector: messages without a detector are only received by delegates without a
+ * detector, while messages from a detector are received by these and the delegates bound to this very detector. The order of
+ * the delegates is preserved in every list.
+ */
+void Messenger::freeze() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    frozen_delegates_.clear();
+    for(const auto& [type_idx, named_delegates] : delegates_) {
+        for(const auto& [id, delegates] : named_delegates) {
+            if(delegates.empty()) {
+                continue;
+            }
+
+            // Add a list for all detectors with specific listeners
+            auto& receivers = frozen_delegates_[type_idx][id];
+            for(const auto& delegate : delegates) {
+                for(const auto& detector : delegate->getDetectors()) {
+                    receivers.detectors[detector->getName()];
+                }
+            }
+
+            for(const auto& delegate : delegates) {
+                FrozenDelegate frozen_delegate{delegate.get(), delegate->getUniqueName()};
+                if(delegate->getDetector() == nullptr) {
+                    receivers.generic.push_back(frozen_delegate);
+                    for(auto& [detector_name, detector_receivers] : receivers.detectors) {
+                        detector_receivers.push_back(frozen_delegate);
+                    }
+                } else {
+                    for(const auto& detector : delegate->getDetectors()) {
+                        receivers.detectors[detector->getName()].push_back(frozen_delegate);
+                    }
+                }
+            }
+        }
+    }
+
+    LOG(TRACE) << "Froze message dispatch table for " << delegate_to_iterator_.size() << " delegates";
+    frozen_ = true;
+}
+
+const std::vector<Messenger::FrozenDelegate>*
+Messenger::get_frozen_receivers(const std::type_index& type_idx, const std::string& id, const BaseMessage* message) const {
+    const auto type_iter = frozen_delegates_.find(type_idx);
+    if(type_iter == frozen_delegates_.end()) {
+        return nullptr;
+    }
+    const auto id_iter = type_iter->second.find(id);
+    if(id_iter == type_iter->second.end()) {
+        return nullptr;
+    }
+
+    const auto& receivers = id_iter->second;
+    if(message->getDetector() != nullptr) {
+        const auto detector_iter = receivers.detectors.find(message->getDetector()->getName());
+        if(detector_iter != receivers.detectors.end()) {
+            return &detector_iter->second;
+        }
+    }
+    return &receivers.generic;
+}
+
 std::vector<std::pair<std::shared_ptr<BaseMessage>, std::string>> Messenger::fetchFilteredMessages(Module* module,
                                                                                                    Event* event) {
     try {
@@ -138,6 +279,18 @@ std::vector<std::pair<std::shared_ptr<BaseMessage>, std::string>> Messenger::fet
     }
 }
 
+const std::vector<std::pair<std::shared_ptr<BaseMessage>, std::string>>&
+Messenger::fetchFilteredMessagesView(Module* module, Event* event) {
+    try {
+        auto* local_messenger = event->get_local_messenger();
+        return local_messenger->fetchFilteredMessagesView(module);
+    } catch(const std::out_of_range& e) {
+        // No messages available after filtering, return a view of an empty vector:
+        static const std::vector<std::pair<std::shared_ptr<BaseMessage>, std::string>> empty;
+        return empty;
+    }
+}
+
 LocalMessenger::LocalMessenger(Messenger& global_messenger) : global_messenger_(global_messenger) {}
 
 void LocalMessenger::dispatchMessage(Module* source, std::shared_ptr<BaseMessage> message, std::string name) { // NOLINT
@@ -146,28 +299,30 @@ void LocalMessenger::dispatchMessage(Module* source, std::shared_ptr<BaseMessage
         name = source->get_configuration().get<std::string>("output");
     }
 
+    std::lock_guard<std::mutex> lock(mutex_);
     bool send = false;
 
+    // Take ownership of the message for the rest of the event, the receivers only store references to it
+    sent_messages_.push_back(std::move(message));
+    const auto& stored_message = sent_messages_.back();
+
     // Send messages to specific listeners
-    send = dispatchMessage(source, message, name, name) || send;
+    send = dispatchMessage(source, stored_message, name, name) || send;
 
     // Send to generic listeners
-    send = dispatchMessage(source, message, name, "*") || send;
+    send = dispatchMessage(source, stored_message, name, "*") || send;
 
     // Send to listeners of unnamed messages
     if(name.empty()) {
-        send = dispatchMessage(source, message, name, "?") || send;
+        send = dispatchMessage(source, stored_message, name, "?") || send;
     }
 
     // Display a TRACE log message if the message is send to no receiver
     if(!send) {
-        const BaseMessage* inst = message.get();
+        const BaseMessage* inst = stored_message.get();
         LOG(TRACE) << "Dispatched message " << allpix::demangle(typeid(*inst).name()) << " from " << source->getUniqueName()
                    << " has no receivers!";
     }
-
-    // Save a copy of the sent message
-    sent_messages_.emplace_back(message);
 }
 
 bool LocalMessenger::dispatchMessage(Module* source,
@@ -180,6 +335,32 @@ bool LocalMessenger::dispatchMessage(Module* source,
     const BaseMessage* inst = message.get();
     std::type_index type_idx = typeid(*inst);
 
+    // Use the precompiled dispatch table if available
+    if(global_messenger_.frozen_) {
+        assert(typeid(BaseMessage) != typeid(*inst));
+        auto source_name = source->getUniqueName();
+        for(const auto& listener_type : {type_idx, std::type_index(typeid(BaseMessage))}) {
+            const auto* receivers = global_messenger_.get_frozen_receivers(listener_type, id, inst);
+            if(receivers == nullptr) {
+                continue;
+            }
+
+            for(const auto& receiver : *receivers) {
+                // Do not send messages back to their source
+                if(receiver.unique_name == source_name) {
+                    continue;
+                }
+                LOG(TRACE) << "Sending message " << allpix::demangle(type_idx.name()) << " from " << source_name << " to "
+                           << (listener_type == type_idx ? "" : "generic listener ") << receiver.unique_name;
+                auto& dest = messages_[receiver.unique_name][listener_type];
+                dest.received = true;
+                receiver.delegate->process(message, name, dest);
+                send = true;
+            }
+        }
+        return send;
+    }
+
     // Retrieve listeners for the given message type and name
     const auto msg_type_iterator = global_messenger_.delegates_.find(type_idx);
     if(msg_type_iterator != global_messenger_.delegates_.end()) {
@@ -192,6 +373,7 @@ bool LocalMessenger::dispatchMessage(Module* source,
                                << source->getUniqueName() << " to " << delegate->getUniqueName();
                     // Construct BaseMessage where message should be stored
                     auto& dest = messages_[delegate->getUniqueName()][type_idx];
+                    dest.received = true;
 
                     delegate->process(message, name, dest);
                     send = true;
@@ -211,6 +393,7 @@ bool LocalMessenger::dispatchMessage(Module* source,
                     LOG(TRACE) << "Sending message " << allpix::demangle(type_idx.name()) << " from "
                                << source->getUniqueName() << " to generic listener " << delegate->getUniqueName();
                     auto& dest = messages_[delegate->getUniqueName()][typeid(BaseMessage)];
+                    dest.received = true;
                     delegate->process(message, name, dest);
                     send = true;
                 }
@@ -223,12 +406,72 @@ bool LocalMessenger::dispatchMessage(Module* source,
 
 std::vector<std::pair<std::shared_ptr<BaseMessage>, std::string>> LocalMessenger::fetchFilteredMessages(Module* module) {
     const std::type_index type_idx = typeid(BaseMessage);
-    return messages_.at(module->getUniqueName()).at(type_idx).filter_multi;
+    std::lock_guard<std::mutex> lock(mutex_);
+    return get_received(module, type_idx).filter_multi;
+}
+
+const std::vector<std::pair<std::shared_ptr<BaseMessage>, std::string>>&
+LocalMessenger::fetchFilteredMessagesView(Module* module) {
+    const std::type_index type_idx = typeid(BaseMessage);
+    // The lock only protects the lookup, references to the stored elements stay valid when other modules are added
+    std::lock_guard<std::mutex> lock(mutex_);
+    return get_received(module, type_idx).filter_multi;
+}
+
+const std::vector<const std::shared_ptr<BaseMessage>*>&
+LocalMessenger::fetchMultiMessageView(Module* module, const std::type_index& type_idx) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return get_received(module, type_idx).multi;
+}
+
+size_t LocalMessenger::getMemorySize() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t size = 0;
+    for(const auto& message : sent_messages_) {
+        size += message->getMemorySize();
+    }
+    return size;
+}
+
+std::map<std::string, size_t> LocalMessenger::countObjects(const std::string& type_name) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<std::string, size_t> counts;
+    for(const auto& message : sent_messages_) {
+        try {
+            auto object_array = message->getObjectArray();
+            if(object_array.empty()) {
+                continue;
+            }
+            const Object& first_object = object_array[0];
+            if(allpix::demangle(typeid(first_object).name()) != type_name) {
+                continue;
+            }
+            auto detector = message->getDetector();
+            counts[detector == nullptr ? "" : detector->getName()] += object_array.size();
+        } catch(MessageWithoutObjectException&) {
+            // Messages without objects are not counted
+        }
+    }
+    return counts;
+}
+
+std::map<std::pair<std::type_index, std::string>, std::pair<size_t, size_t>> LocalMessenger::getMessageStatistics() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<std::pair<std::type_index, std::string>, std::pair<size_t, size_t>> statistics;
+    for(const auto& message : sent_messages_) {
+        const BaseMessage* inst = message.get();
+        auto detector = message->getDetector();
+        auto& entry = statistics[{std::type_index(typeid(*inst)), detector == nullptr ? "" : detector->getName()}];
+        entry.first += message->getObjectCount();
+        entry.second += message->getMemorySize();
+    }
+    return statistics;
 }
 
 bool LocalMessenger::isSatisfied(BaseDelegate* delegate) const {
     // check our records for messages for this module
     const std::string name = delegate->getUniqueName();
+    std::lock_guard<std::mutex> lock(mutex_);
     auto messages_iter = messages_.find(name);
     if(messages_iter == messages_.end()) {
         return false;
@@ -246,5 +489,33 @@ bool LocalMessenger::isSatisfied(BaseDelegate* delegate) const {
         return false;
     }
 
-    return true;
+    return iter->second.received;
+}
+
+/**
+ * The containers of all receivers are kept, such that the following event can reuse their capacity
+ */
+void LocalMessenger::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for(auto& receiver : messages_) {
+        for(auto& type_messages : receiver.second) {
+            auto& dest = type_messages.second;
+            dest.single = nullptr;
+            dest.multi.clear();
+            dest.filter_multi.clear();
+            dest.received = false;
+        }
+    }
+    sent_messages_.clear();
+}
+
+/**
+ * @throws std::out_of_range If the module has not received any message of the type in this event
+ */
+const DelegateTypes& LocalMessenger::get_received(Module* module, const std::type_index& type_idx) const {
+    const auto& dest = messages_.at(module->getUniqueName()).at(type_idx);
+    if(!dest.received) {
+        throw std::out_of_range("no message received");
+    }
+    return dest;
 }
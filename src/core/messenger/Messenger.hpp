@@ -12,11 +12,20 @@
 #ifndef ALLPIX_MESSENGER_H
 #define ALLPIX_MESSENGER_H
 
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <iterator>
 #include <list>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <set>
+#include <string>
 #include <typeindex>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "Message.hpp"
 #include "core/module/Event.hpp"
@@ -28,6 +37,79 @@ namespace allpix {
     class Event;
     class LocalMessenger;
 
+    /**
+     * @brief Non-owning view of the messages of a type received by a module in the current event
+     *
+     * The view refers to the storage of the event directly and yields references to the messages, such that iterating it
+     * neither copies the list of messages nor touches the reference counts of their shared pointers. It remains valid until
+     * the run method of the receiving module returns.
+     */
+    template <typename T> class MessageView {
+    public:
+        /**
+         * @brief Iterator over the messages, dereferencing to the message of the derived type
+         */
+        class iterator {
+        public:
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = T;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const T*;
+            using reference = const T&;
+
+            iterator() = default;
+            explicit iterator(std::vector<const std::shared_ptr<BaseMessage>*>::const_iterator iter) : iter_(iter) {}
+
+            reference operator*() const { return static_cast<const T&>(***iter_); }
+            pointer operator->() const { return static_cast<const T*>((*iter_)->get()); }
+            reference operator[](difference_type n) const { return *(*this + n); }
+
+            iterator& operator++() {
+                ++iter_;
+                return *this;
+            }
+            iterator operator++(int) { return iterator(iter_++); }
+            iterator& operator--() {
+                --iter_;
+                return *this;
+            }
+            iterator operator--(int) { return iterator(iter_--); }
+            iterator& operator+=(difference_type n) {
+                iter_ += n;
+                return *this;
+            }
+            iterator& operator-=(difference_type n) {
+                iter_ -= n;
+                return *this;
+            }
+            iterator operator+(difference_type n) const { return iterator(iter_ + n); }
+            iterator operator-(difference_type n) const { return iterator(iter_ - n); }
+            difference_type operator-(const iterator& other) const { return iter_ - other.iter_; }
+
+            bool operator==(const iterator& other) const { return iter_ == other.iter_; }
+            bool operator!=(const iterator& other) const { return iter_ != other.iter_; }
+            bool operator<(const iterator& other) const { return iter_ < other.iter_; }
+
+        private:
+            std::vector<const std::shared_ptr<BaseMessage>*>::const_iterator iter_;
+        };
+
+        /**
+         * @brief Construct a view of a list of received messages
+         * @param messages List of messages, which should all be of type T
+         */
+        explicit MessageView(const std::vector<const std::shared_ptr<BaseMessage>*>& messages) : messages_(&messages) {}
+
+        iterator begin() const { return iterator(messages_->cbegin()); }
+        iterator end() const { return iterator(messages_->cend()); }
+        size_t size() const { return messages_->size(); }
+        bool empty() const { return messages_->empty(); }
+        const T& operator[](size_t index) const { return static_cast<const T&>(**(*messages_)[index]); }
+
+    private:
+        const std::vector<const std::shared_ptr<BaseMessage>*>* messages_;
+    };
+
     /**
      * @ingroup Managers
      * @brief Manager responsible for setting up communication between modules and sending messages between them
@@ -41,6 +123,7 @@ namespace allpix {
         friend class Module;
         friend class Event;
         friend class LocalMessenger;
+        friend class ModuleManager;
 
     public:
         /**
@@ -132,6 +215,14 @@ namespace allpix {
          */
         template <typename T> std::vector<std::shared_ptr<T>> fetchMultiMessage(Module* module, Event* event);
 
+        /**
+         * @brief Fetches a view of multiple messages of specified type meant for the calling module
+         * @param module Module to fetch the messages for
+         * @param event Event to fetch the messages from
+         * @return Non-owning view of the messages, valid until the run method of the module returns
+         */
+        template <typename T> MessageView<T> fetchMultiMessageView(Module* module, Event* event);
+
         /**
          * @brief Fetches filtered messages meant for the calling module
          * @param module Module to fetch the messages for
@@ -141,6 +232,16 @@ namespace allpix {
         std::vector<std::pair<std::shared_ptr<BaseMessage>, std::string>> fetchFilteredMessages(Module* module,
                                                                                                 Event* event);
 
+        /**
+         * @brief Fetches a view of the filtered messages meant for the calling module
+         * @param module Module to fetch the messages for
+         * @param event Event to fetch the messages from
+         * @return Reference to the pairs of shared pointer to and name of message stored in the event, valid until the run
+         * method of the module returns
+         */
+        const std::vector<std::pair<std::shared_ptr<BaseMessage>, std::string>>& fetchFilteredMessagesView(Module* module,
+                                                                                                           Event* event);
+
         /**
          * @brief Check if a specific message has a receiver
          * @param source Module that will send the message
@@ -149,6 +250,23 @@ namespace allpix {
          */
         bool hasReceiver(Module* source, const std::shared_ptr<BaseMessage>& message);
 
+        /**
+         * @brief Check if a message type sent by a module has a receiver
+         * @param source Module that will send the message
+         * @param detector Detector the message will be linked to, or a nullptr for messages without detector
+         * @return True if a message of this type would have at least one receiver, false otherwise
+         *
+         * Allows modules to skip creating data which would not be consumed by any other module, without constructing an
+         * instance of the message. Receivers are bound when constructing the modules, the result is thus only valid in the
+         * initialize method of a module and afterwards.
+         */
+        template <typename T> bool hasReceiver(Module* source, const std::shared_ptr<const Detector>& detector = nullptr);
+
+        /**
+         * @brief Release all messages of the event, keeping the containers allocated for the receivers of the messages
+         */
+        void reset();
+
         /**
          * @brief Check if a delegate has received its message
          * @param delegate Delegate to check if it was satisfied
@@ -157,7 +275,33 @@ namespace allpix {
          */
         bool isSatisfied(BaseDelegate* delegate, Event* event) const;
 
+        /**
+         * @brief Compile all registered delegates into an immutable dispatch table
+         *
+         * After freezing, messages are dispatched through a flat table keyed by message type, message name and detector,
+         * without any locking or filtering of the delegates. Adding or removing a delegate discards the table again.
+         * @note Should be called after all modules have been initialized and before the event loop starts
+         */
+        void freeze();
+
     private:
+        /**
+         * @brief Check if a message type sent by a module has a receiver
+         * @param source Module that will send the message
+         * @param type_idx Type of the message
+         * @param detector Detector the message will be linked to, or a nullptr for messages without detector
+         * @return True if the message has at least one receiver, false otherwise
+         */
+        bool has_receiver(Module* source, const std::type_index& type_idx, const std::shared_ptr<const Detector>& detector);
+
+        /**
+         * @brief Check if any message sent by a module could be received by another module
+         * @param source Module that sends the messages
+         * @param ignored Unique names of the modules whose delegates should not be considered
+         * @return True if at least one delegate could receive a message of a type declared by the module, false otherwise
+         */
+        bool has_consumer(Module* source, const std::set<std::string>& ignored);
+
         /**
          * @brief Add a delegate to the listeners
          * @param message_type Type the delegate listens to
@@ -181,6 +325,31 @@ namespace allpix {
         DelegateMap delegates_;
         DelegateIteratorMap delegate_to_iterator_;
 
+        // Delegate in the frozen dispatch table together with its precomputed unique name
+        struct FrozenDelegate {
+            BaseDelegate* delegate;
+            std::string unique_name;
+        };
+        // Listeners of a message type and name, for messages without detector and for every detector with listeners
+        struct FrozenReceivers {
+            std::vector<FrozenDelegate> generic;
+            std::unordered_map<std::string, std::vector<FrozenDelegate>> detectors;
+        };
+        using FrozenDelegateMap = std::unordered_map<std::type_index, std::unordered_map<std::string, FrozenReceivers>>;
+
+        /**
+         * @brief Look up the receivers of a message in the frozen dispatch table
+         * @param type_idx Type of the listeners
+         * @param id Name identifier of the listeners
+         * @param message Message to find the receivers for
+         * @return Pointer to the list of receivers or a nullptr if there are none
+         */
+        const std::vector<FrozenDelegate>*
+        get_frozen_receivers(const std::type_index& type_idx, const std::string& id, const BaseMessage* message) const;
+
+        FrozenDelegateMap frozen_delegates_;
+        std::atomic_bool frozen_{false};
+
         mutable std::mutex mutex_;
     };
 
@@ -200,6 +369,11 @@ namespace allpix {
                              const std::string& name,
                              const std::string& id);
 
+        /**
+         * @brief Release all messages of the event, keeping the containers allocated for the receivers of the messages
+         */
+        void reset();
+
         /**
          * @brief Check if a delegate has received its message
          * @return True if satisfied, false otherwise
@@ -218,18 +392,64 @@ namespace allpix {
          */
         template <typename T> std::vector<std::shared_ptr<T>> fetchMultiMessage(Module* module);
 
+        /**
+         * @brief Fetches multiple messages of specified type meant for the calling module without copying them
+         * @return Reference to the list of messages stored for the module
+         */
+        const std::vector<const std::shared_ptr<BaseMessage>*>& fetchMultiMessageView(Module* module,
+                                                                                       const std::type_index& type_idx);
+
         /**
          * @brief Fetches filtered messages meant for the calling module
          * @return Vector of pairs containing shared pointer to and name of message
          */
         std::vector<std::pair<std::shared_ptr<BaseMessage>, std::string>> fetchFilteredMessages(Module* module);
 
+        /**
+         * @brief Fetches filtered messages meant for the calling module without copying them
+         * @return Reference to the pairs of shared pointer to and name of message stored for the module
+         */
+        const std::vector<std::pair<std::shared_ptr<BaseMessage>, std::string>>& fetchFilteredMessagesView(Module* module);
+
+        /**
+         * @brief Estimate the memory held by all messages dispatched in this event
+         * @return Estimated size in bytes
+         */
+        size_t getMemorySize() const;
+
+        /**
+         * @brief Count the objects of a type in all messages dispatched in this event
+         * @param type_name Name of the object type without namespace
+         * @return Number of objects per detector name, with an empty name for messages without detector
+         */
+        std::map<std::string, size_t> countObjects(const std::string& type_name) const;
+
+        /**
+         * @brief Summarize all messages dispatched in this event by message type and detector
+         * @return Number of objects and estimated size in bytes per message type and detector name, with an empty name for
+         * messages without detector
+         */
+        std::map<std::pair<std::type_index, std::string>, std::pair<size_t, size_t>> getMessageStatistics() const;
+
     private:
+        /**
+         * @brief Get the messages of a type received by a module in this event, requires the mutex to be locked
+         * @param module Receiving module
+         * @param type_idx Type of the messages
+         * @return Reference to the messages stored for the module
+         */
+        const DelegateTypes& get_received(Module* module, const std::type_index& type_idx) const;
+
         // The global messenger which contains the shared delegate information
         const Messenger& global_messenger_;
 
+        // Messages received by every module, referring to the dispatched messages owned by the event
         std::unordered_map<std::string, std::unordered_map<std::type_index, DelegateTypes>> messages_;
-        std::vector<std::shared_ptr<BaseMessage>> sent_messages_;
+        // All messages dispatched in this event, references to the elements stay valid when adding further messages
+        std::deque<std::shared_ptr<BaseMessage>> sent_messages_;
+
+        // Protects the messages while the module chains of different detectors are executed concurrently
+        mutable std::mutex mutex_;
     };
 } // namespace allpix
 
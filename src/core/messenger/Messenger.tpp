@@ -46,6 +46,11 @@ namespace allpix {
         add_delegate(typeid(T), receiver, std::move(delegate));
     }
 
+    template <typename T> bool Messenger::hasReceiver(Module* source, const std::shared_ptr<const Detector>& detector) {
+        static_assert(std::is_base_of<BaseMessage, T>::value, "Checked message should inherit from Message class");
+        return has_receiver(source, typeid(T), detector);
+    }
+
     template <typename T>
     void Messenger::dispatchMessage(Module* module, std::shared_ptr<T> message, Event* event, const std::string& name) {
         auto* local_messenger = event->get_local_messenger();
@@ -70,10 +75,22 @@ namespace allpix {
         }
     }
 
+    template <typename T> MessageView<T> Messenger::fetchMultiMessageView(Module* module, Event* event) {
+        static_assert(std::is_base_of<BaseMessage, T>::value, "Fetched message should inherit from Message class");
+        try {
+            auto* local_messenger = event->get_local_messenger();
+            return MessageView<T>(local_messenger->fetchMultiMessageView(module, typeid(T)));
+        } catch(const std::out_of_range& e) {
+            throw MessageNotFoundException(module->getUniqueName(), typeid(T));
+        }
+    }
+
     template <typename T> std::shared_ptr<T> LocalMessenger::fetchMessage(Module* module) {
         static_assert(std::is_base_of<BaseMessage, T>::value, "Fetched message should inherit from Message class");
         std::type_index type_idx = typeid(T);
-        return std::static_pointer_cast<T>(messages_.at(module->getUniqueName()).at(type_idx).single);
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto* message = get_received(module, type_idx).single;
+        return message == nullptr ? nullptr : std::static_pointer_cast<T>(*message);
     }
 
     template <typename T> std::vector<std::shared_ptr<T>> LocalMessenger::fetchMultiMessage(Module* module) {
@@ -82,13 +99,13 @@ namespace allpix {
         // TODO: do nothing if T == BaseMessage; there is no need to cast (optimized out)?
         std::type_index type_idx = typeid(T);
 
-        // Construct an empty vector in case no previous modules created one during dispatch
-        auto base_messages = messages_.at(module->getUniqueName()).at(type_idx).multi;
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto& base_messages = get_received(module, type_idx).multi;
 
         std::vector<std::shared_ptr<T>> derived_messages;
         derived_messages.reserve(base_messages.size());
-        for(auto& message : base_messages) {
-            derived_messages.push_back(std::static_pointer_cast<T>(message));
+        for(const auto* message : base_messages) {
+            derived_messages.push_back(std::static_pointer_cast<T>(*message));
         }
 
         return derived_messages;
@@ -21,6 +21,7 @@
 #include <memory>
 #include <typeinfo>
 #include <utility>
+#include <vector>
 
 #include "Message.hpp"
 #include "core/geometry/Detector.hpp"
@@ -33,12 +34,15 @@ namespace allpix {
      * @ingroup Delegates
      * @brief Container of the different delegate types
      *
-     * A properly implemented delegate should only touch one of these fields.
+     * A properly implemented delegate should only touch one of these fields. Bound messages are borrowed from the event,
+     * which owns all dispatched messages until it ends, such that delivering them does not modify their reference counts.
      */
     struct DelegateTypes { // NOLINT
-        std::shared_ptr<BaseMessage> single;
-        std::vector<std::shared_ptr<BaseMessage>> multi;
+        const std::shared_ptr<BaseMessage>* single{};
+        std::vector<const std::shared_ptr<BaseMessage>*> multi;
         std::vector<std::pair<std::shared_ptr<BaseMessage>, std::string>> filter_multi;
+        // Set once a message has been delivered in the current event, the containers are kept when recycling an event
+        bool received{};
     };
     /**
      * @ingroup Delegates
@@ -130,6 +134,12 @@ namespace allpix {
          */
         virtual std::shared_ptr<Detector> getDetector() const = 0;
 
+        /**
+         * @brief Get all detectors whose messages are received by a delegate
+         * @return Detectors handled by the bound object
+         */
+        virtual const std::vector<std::shared_ptr<Detector>>& getDetectors() const = 0;
+
         /**
          * @brief Get the unique identifier for the bound object
          * @return Unique identifier
@@ -138,11 +148,11 @@ namespace allpix {
 
         /**
          * @brief Process a message and forward it to its final destination
-         * @param msg Message to process
+         * @param msg Message to process, owned by the event until it ends
          * @param name Name of the message
          * @param dest Destination of the message
          */
-        virtual void process(std::shared_ptr<BaseMessage> msg, std::string name, DelegateTypes& dest) = 0;
+        virtual void process(const std::shared_ptr<BaseMessage>& msg, const std::string& name, DelegateTypes& dest) = 0;
 
     protected:
         MsgFlags flags_;
@@ -177,6 +187,14 @@ namespace allpix {
          */
         std::shared_ptr<Detector> getDetector() const override { return obj_->getDetector(); }
 
+        /**
+         * @brief Get all detectors handled by this module
+         *
+         * Returns the bound detector for detector modules, all detectors of the model for modules handling multiple
+         * detectors and no detectors for unique modules
+         */
+        const std::vector<std::shared_ptr<Detector>>& getDetectors() const override { return obj_->getDetectors(); }
+
     protected:
         T* const obj_;
     };
@@ -198,7 +216,7 @@ namespace allpix {
          * @brief Stores the received message in the delegate until the end of the event
          * @param msg Message to store
          */
-        void process(std::shared_ptr<BaseMessage> msg, std::string, DelegateTypes&) override {
+        void process(const std::shared_ptr<BaseMessage>& msg, const std::string&, DelegateTypes&) override {
             // Store the message and mark as processed
             messages_.push_back(msg);
         }
@@ -231,15 +249,16 @@ namespace allpix {
          * @warning The filter function is called directly from the delegate, no heavy processing should be done in the
          * filter function
          */
-        void process(std::shared_ptr<BaseMessage> msg, std::string, DelegateTypes& dest) override {
+        void process(const std::shared_ptr<BaseMessage>& msg, const std::string&, DelegateTypes& dest) override {
 #ifndef NDEBUG
             // The type names should have been correctly resolved earlier
             const BaseMessage* inst = msg.get();
             assert(typeid(*inst) == typeid(R));
 #endif
             // Filter the message, and store it if it should be kept
-            if((this->obj_->*filter_)(std::static_pointer_cast<R>(msg))) {
-                dest.filter_multi.emplace_back(std::static_pointer_cast<R>(msg), "");
+            auto message = std::static_pointer_cast<R>(msg);
+            if((this->obj_->*filter_)(message)) {
+                dest.filter_multi.emplace_back(std::move(message), "");
             }
         }
 
@@ -272,10 +291,10 @@ namespace allpix {
          * @warning The filter function is called directly from the delegate, no heavy processing should be done in the
          * filter function
          */
-        void process(std::shared_ptr<BaseMessage> msg, std::string name, DelegateTypes& dest) override {
+        void process(const std::shared_ptr<BaseMessage>& msg, const std::string& name, DelegateTypes& dest) override {
             // Filter the message, and store it if it should be kept
-            if((this->obj_->*filter_)(std::static_pointer_cast<BaseMessage>(msg), name)) {
-                dest.filter_multi.emplace_back(std::static_pointer_cast<BaseMessage>(msg), name);
+            if((this->obj_->*filter_)(msg, name)) {
+                dest.filter_multi.emplace_back(msg, name);
             }
         }
 
@@ -305,7 +324,7 @@ namespace allpix {
          *
          * The saved value is overwritten if the \ref MsgFlags::ALLOW_OVERWRITE "ALLOW_OVERWRITE" flag is enabled.
          */
-        void process(std::shared_ptr<BaseMessage> msg, std::string, DelegateTypes& dest) override {
+        void process(const std::shared_ptr<BaseMessage>& msg, const std::string&, DelegateTypes& dest) override {
 #ifndef NDEBUG
             // The type names should have been correctly resolved earlier
             const BaseMessage* inst = msg.get();
@@ -316,8 +335,8 @@ namespace allpix {
                 throw UnexpectedMessageException(this->obj_->getUniqueName(), typeid(R));
             }
 
-            // Save the message
-            dest.single = std::static_pointer_cast<R>(msg);
+            // Save a reference to the message
+            dest.single = &msg;
         }
     };
 
@@ -339,14 +358,14 @@ namespace allpix {
          * @param msg Message to process
          * @param dest Destination of the message
          */
-        void process(std::shared_ptr<BaseMessage> msg, std::string, DelegateTypes& dest) override {
+        void process(const std::shared_ptr<BaseMessage>& msg, const std::string&, DelegateTypes& dest) override {
 #ifndef NDEBUG
             // The type names should have been correctly resolved earlier
             const BaseMessage* inst = msg.get();
             assert(typeid(*inst) == typeid(R));
 #endif
-            // Add the message to the vector
-            dest.multi.push_back(std::static_pointer_cast<R>(msg));
+            // Add a reference to the message to the vector
+            dest.multi.push_back(&msg);
         }
     };
 } // namespace allpix
@@ -15,27 +15,90 @@
 #include <chrono>
 #include <list>
 #include <memory>
+#include <memory_resource>
+#include <random>
 #include <string>
+#include <tuple>
+#include <vector>
 
 #include "Module.hpp"
 #include "ModuleManager.hpp"
+#include "ThreadPool.hpp"
 #include "core/messenger/Messenger.hpp"
 #include "core/utils/log.h"
 
+#include "tools/ROOT.h"
+
 using namespace allpix;
 
 std::mutex Event::stats_mutex_;
+thread_local RandomNumberGenerator* Event::chain_random_engine_{nullptr};
+thread_local RandomNumberGenerator* Event::module_random_engine_{nullptr};
+thread_local uint64_t Event::task_stream_{0};
+thread_local uint64_t Event::stream_tasks_{0};
 
-Event::Event(Messenger& messenger, uint64_t event_num, uint64_t seed) : number(event_num), seed_(seed) {
+Event::Event(Messenger& messenger, uint64_t event_num, uint64_t seed) : number_(event_num), seed_(seed) {
     local_messenger_ = std::make_unique<LocalMessenger>(messenger);
 }
 
+void Event::clear() {
+    local_messenger_->reset();
+    if(memory_arena_ != nullptr) {
+        memory_arena_->release();
+    }
+    state_.str(std::string());
+    state_.clear();
+    random_engine_ = nullptr;
+    thread_pool_ = nullptr;
+    buffered_memory_ = 0;
+    time_budget_ = 0;
+    budget_recorded_ = false;
+}
+
+void Event::reset(uint64_t event_num, uint64_t seed) {
+    number_ = event_num;
+    seed_ = seed;
+    parallel_tasks_ = 0;
+}
+
 void Event::set_and_seed_random_engine(RandomNumberGenerator* random_engine) {
     random_engine_ = random_engine;
     random_engine_->seed(seed_);
 }
 
+void Event::set_task_stream(uint64_t stream) {
+    task_stream_ = stream;
+    stream_tasks_ = 0;
+}
+
+void Event::set_module_random_stream(uint64_t stream) {
+    static thread_local RandomNumberGenerator module_random_engine;
+
+    set_task_stream(stream);
+    if(stream == 0) {
+        module_random_engine_ = nullptr;
+        return;
+    }
+
+    std::seed_seq seed_sequence{static_cast<uint32_t>(seed_),
+                                static_cast<uint32_t>(seed_ >> 32),
+                                static_cast<uint32_t>(stream),
+                                static_cast<uint32_t>(stream >> 32)};
+    module_random_engine.seed(seed_sequence);
+    module_random_engine_ = &module_random_engine;
+}
+
+/**
+ * While the module chains of different detectors are executed concurrently, every chain uses its own random engine. With
+ * independent module streams, the stream of the running module takes precedence
+ */
 RandomNumberGenerator& Event::getRandomEngine() {
+    if(module_random_engine_ != nullptr) {
+        return *module_random_engine_;
+    }
+    if(chain_random_engine_ != nullptr) {
+        return *chain_random_engine_;
+    }
     if(random_engine_ == nullptr) {
         throw InvalidEventStateException("No PRNG available");
     }
@@ -57,4 +120,118 @@ void Event::restore_random_engine_state() {
     }
 }
 
+namespace {
+    using LogSettings = std::tuple<LogLevel, LogFormat, std::string, uint64_t>;
+
+    // Apply the given logging settings to the current thread and return the previous ones
+    LogSettings swap_log_settings(const LogSettings& settings) {
+        LogSettings prev{Log::getReportingLevel(), Log::getFormat(), Log::getSection(), Log::getEventNum()};
+        Log::setReportingLevel(std::get<0>(settings));
+        Log::setFormat(std::get<1>(settings));
+        Log::setSection(std::get<2>(settings));
+        Log::setEventNum(std::get<3>(settings));
+        return prev;
+    }
+} // namespace
+
+void Event::parallelFor(size_t num_tasks, const std::function<void(size_t, RandomNumberGenerator&)>& func) {
+    // Logging settings of the calling module, to be applied on the thread executing a task
+    const LogSettings log_settings{Log::getReportingLevel(), Log::getFormat(), Log::getSection(), Log::getEventNum()};
+    // Sampling of the plots of the calling module for this event
+    const auto skip_histograms = HistogramFilling::isSkipped();
+
+    // Index of the first task among all tasks of this event, or among those of the calling module if it has its own task
+    // stream. The latter does not depend on the order in which concurrent detector chains reach this point.
+    auto task_stream = task_stream_;
+    auto first_task = (task_stream != 0 ? stream_tasks_ : parallel_tasks_.fetch_add(num_tasks));
+    if(task_stream != 0) {
+        stream_tasks_ += num_tasks;
+    }
+    LOG(TRACE) << "Starting " << num_tasks << " parallel tasks from index " << first_task
+               << (task_stream != 0 ? " of the task stream of the module" : " of the event");
+
+    auto task_function = [&](size_t task) {
+        auto prev_log_settings = swap_log_settings(log_settings);
+        auto prev_skip_histograms = HistogramFilling::isSkipped();
+        HistogramFilling::setSkipped(skip_histograms);
+
+        // Derive an independent random stream for this task from the event seed and the task stream of the module, if any
+        auto stream = first_task + task;
+        std::vector<uint32_t> seeds{static_cast<uint32_t>(seed_),
+                                    static_cast<uint32_t>(seed_ >> 32),
+                                    static_cast<uint32_t>(stream),
+                                    static_cast<uint32_t>(stream >> 32)};
+        if(task_stream != 0) {
+            seeds.push_back(static_cast<uint32_t>(task_stream));
+            seeds.push_back(static_cast<uint32_t>(task_stream >> 32));
+        }
+        std::seed_seq seed_sequence(seeds.begin(), seeds.end());
+        RandomNumberGenerator random_engine;
+        random_engine.seed(seed_sequence);
+
+        try {
+            func(task, random_engine);
+        } catch(...) {
+            swap_log_settings(prev_log_settings);
+            HistogramFilling::setSkipped(prev_skip_histograms);
+            throw;
+        }
+        swap_log_settings(prev_log_settings);
+        HistogramFilling::setSkipped(prev_skip_histograms);
+    };
+
+    if(thread_pool_ == nullptr) {
+        for(size_t task = 0; task < num_tasks; ++task) {
+            task_function(task);
+        }
+    } else {
+        thread_pool_->parallelFor(num_tasks, task_function);
+    }
+}
+
+/**
+ * The memory blocks of all event arenas are drawn from a shared pool, which recycles them for subsequent events instead of
+ * returning them to the system allocator. The arena of a recycled event object has been released when the object was
+ * cleared and is reused as long as its initial size did not change.
+ */
+void Event::enable_memory_arena(size_t initial_size) {
+    static std::pmr::synchronized_pool_resource arena_blocks;
+    if(initial_size == 0) {
+        memory_arena_.reset();
+    } else if(memory_arena_ == nullptr || memory_arena_size_ != initial_size) {
+        memory_arena_ = std::make_unique<std::pmr::monotonic_buffer_resource>(initial_size, &arena_blocks);
+    }
+    memory_arena_size_ = initial_size;
+}
+
+size_t Event::getMemorySize() const { return local_messenger_->getMemorySize(); }
+
+namespace {
+    int64_t steady_time() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+} // namespace
+
+bool Event::isOverBudget() const { return time_budget_ > 0 && get_budget_time() > time_budget_; }
+
+void Event::start_budget(int64_t budget) {
+    time_budget_ = budget;
+    budget_start_.store(steady_time(), std::memory_order_relaxed);
+    budget_recorded_ = false;
+}
+
+void Event::pause_budget() { budget_pause_ = steady_time(); }
+
+void Event::resume_budget() { budget_start_.fetch_add(steady_time() - budget_pause_, std::memory_order_relaxed); }
+
+int64_t Event::get_budget_time() const { return steady_time() - budget_start_.load(std::memory_order_relaxed); }
+
+std::pmr::memory_resource* Event::getMemoryResource() {
+    if(memory_arena_ == nullptr) {
+        return std::pmr::get_default_resource();
+    }
+    return memory_arena_.get();
+}
+
 LocalMessenger* Event::get_local_messenger() const { return local_messenger_.get(); }
@@ -14,10 +14,13 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <functional>
 #include <list>
 #include <map>
 #include <memory>
+#include <memory_resource>
 #include <mutex>
+#include <utility>
 #include <vector>
 
 #include "core/utils/prng.h"
@@ -27,6 +30,7 @@ namespace allpix {
     class Messenger;
     class BaseMessage;
     class LocalMessenger;
+    class ThreadPool;
 
     /**
      * @brief Holds the data required for running an event
@@ -60,7 +64,7 @@ namespace allpix {
         /**
          * @brief Unique identifier of this event
          */
-        const uint64_t number;
+        const uint64_t& number{number_};
 
         /**
          * @brief Access the random engine of this event
@@ -80,13 +84,76 @@ namespace allpix {
          */
         uint64_t getSeed() const { return seed_; }
 
+        /**
+         * @brief Execute a number of independent tasks of this event, possibly in parallel on idle worker threads
+         * @param num_tasks Number of tasks to execute
+         * @param func Function called once for every task with the task index and a random engine for this task
+         *
+         * The random engine passed to every task is seeded deterministically from the event seed and the index of the task
+         * among all tasks of this event, such that subsequent calls hand out independent random streams. The results of a
+         * task are therefore independent of the number of worker threads and of the order in which the tasks are executed.
+         * The method returns after all tasks have finished, exceptions thrown by a task are rethrown.
+         */
+        void parallelFor(size_t num_tasks, const std::function<void(size_t, RandomNumberGenerator&)>& func);
+
+        /**
+         * @brief Access the memory resource of this event
+         * @return Pointer to the memory arena of this event if enabled, the default memory resource otherwise
+         * @warning Memory drawn from the event arena is only released when the event is destroyed, objects allocated from it
+         *          must not outlive the event. The arena is not thread-safe and must not be used from parallel tasks.
+         */
+        std::pmr::memory_resource* getMemoryResource();
+
+        /**
+         * @brief Create a shared object, allocating it from the memory resource of this event
+         * @param args Arguments passed to the constructor of the object
+         * @return Shared pointer to the constructed object
+         */
+        template <typename T, typename... Args> std::shared_ptr<T> makeShared(Args&&... args) {
+            return std::allocate_shared<T>(std::pmr::polymorphic_allocator<T>(getMemoryResource()),
+                                           std::forward<Args>(args)...);
+        }
+
+        /**
+         * @brief Estimate the memory held by the messages of this event
+         * @return Estimated size in bytes
+         */
+        size_t getMemorySize() const;
+
+        /**
+         * @brief Check whether the processing of this event exceeded the per-event time budget
+         * @return True if a time budget is configured and has been exceeded, false otherwise
+         *
+         * The processing time excludes the time the event has been buffered waiting for sequential modules. Modules can
+         * check the budget while processing expensive events to continue with a faster, coarser simulation. The results of
+         * such degraded events depend on the timing of the run and are thus not reproducible, the framework records them.
+         */
+        bool isOverBudget() const;
+
     private:
+        // Identifier of this event, only assigned again by the module manager when the event object is recycled
+        uint64_t number_;
+
         /**
          * @brief Sets the random engine and seed it to be used by this event
          * @param random_engine Pointer to RNG for this event
          */
         void set_and_seed_random_engine(RandomNumberGenerator* random_engine);
 
+        /**
+         * @brief Release all data of the event while keeping the allocated containers, e.g. before its object is recycled
+         *
+         * The messages are released before the memory arena of the event, from which they may have been allocated.
+         */
+        void clear();
+
+        /**
+         * @brief Prepare a cleared event object for another event
+         * @param event_num The unique event identifier
+         * @param seed Random generator seed for this event
+         */
+        void reset(uint64_t event_num, uint64_t seed);
+
         /**
          * @brief Store the state of the PRNG
          */
@@ -97,15 +164,53 @@ namespace allpix {
          */
         void restore_random_engine_state();
 
+        /**
+         * @brief Select the independent random stream of a module instantiation for the calling thread
+         * @param stream Identifier of the module instantiation, zero to return to the engine of the event or chain
+         *
+         * The engine of the stream is seeded from the event seed and the identifier, such that the random numbers drawn by
+         * a module, including those of its tasks started via \ref parallelFor, do not depend on any other module.
+         */
+        void set_module_random_stream(uint64_t stream);
+
+        /**
+         * @brief Number the tasks started via \ref parallelFor by the calling thread per module instantiation
+         * @param stream Identifier of the module instantiation, zero to number the tasks among all tasks of the event
+         *
+         * The random streams of the tasks are then derived from the identifier and the number of tasks the module started
+         * before in this event, such that they do not depend on the order in which concurrent modules start their tasks.
+         */
+        void set_task_stream(uint64_t stream);
+
         // The random number engine associated with this event
         RandomNumberGenerator* random_engine_{nullptr};
 
+        // Random number engine of the detector module chain executed by the current thread, overriding the event engine
+        static thread_local RandomNumberGenerator* chain_random_engine_;
+
+        // Random stream of the module executed by the current thread, overriding the event and chain engines
+        static thread_local RandomNumberGenerator* module_random_engine_;
+
+        // Task stream of the module executed by the current thread and the number of tasks it handed out via parallelFor
+        static thread_local uint64_t task_stream_;
+        static thread_local uint64_t stream_tasks_;
+
         // Seed for random number generator
         uint64_t seed_;
 
         // State of the random number generator
         std::stringstream state_;
 
+        /**
+         * @brief Enable a monotonic memory arena for all allocations drawn from the event memory resource
+         * @param initial_size Size of the first memory block of the arena in bytes, zero to disable the arena
+         */
+        void enable_memory_arena(size_t initial_size);
+
+        // Memory arena of this event, declared before all members which may hold memory allocated from it
+        std::unique_ptr<std::pmr::monotonic_buffer_resource> memory_arena_;
+        size_t memory_arena_size_{0};
+
         /**
          * @brief Returns a pointer to the event local messenger
          */
@@ -114,6 +219,45 @@ namespace allpix {
         // Local messenger used to dispatch messages in this event
         std::unique_ptr<LocalMessenger> local_messenger_;
 
+        // Thread pool used to execute tasks of this event, if any
+        ThreadPool* thread_pool_{nullptr};
+
+        // Number of tasks of this event handed out by parallelFor, used to derive distinct random streams
+        std::atomic<uint64_t> parallel_tasks_{0};
+
+        // Estimated memory held by this event while it is buffered
+        size_t buffered_memory_{0};
+
+        /**
+         * @brief Start the processing time budget of this event
+         * @param budget Budget in nanoseconds, zero to disable it
+         */
+        void start_budget(int64_t budget);
+
+        /**
+         * @brief Stop the processing time from counting while the event is buffered or handed off
+         */
+        void pause_budget();
+
+        /**
+         * @brief Continue counting the processing time after the event has been paused
+         */
+        void resume_budget();
+
+        /**
+         * @brief Get the processing time of this event counted against its budget
+         * @return Processing time in nanoseconds
+         */
+        int64_t get_budget_time() const;
+
+        // Time budget of this event and the start of its processing, shifted by the time it has been paused
+        int64_t time_budget_{0};
+        std::atomic<int64_t> budget_start_{0};
+        int64_t budget_pause_{0};
+
+        // Whether exceeding the budget has been recorded by the framework, set once for every event
+        std::atomic_bool budget_recorded_{false};
+
         // Mutex for execution time
         static std::mutex stats_mutex_;
     };
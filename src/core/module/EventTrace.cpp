@@ -0,0 +1,78 @@
+/**
+ * @file
+ * @brief Implementation of the event loop trace
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "EventTrace.hpp"
+
+#include <fstream>
+#include <iomanip>
+#include <utility>
+
+#include "ThreadPool.hpp"
+#include "core/utils/exceptions.h"
+#include "core/utils/log.h"
+
+using namespace allpix;
+
+EventTrace::EventTrace(std::filesystem::path path)
+    : path_(std::move(path)), start_(Clock::now()), buffers_(ThreadPool::threadCount()) {}
+
+std::vector<EventTrace::Record>& EventTrace::buffer() { return buffers_.at(ThreadPool::threadNum()); }
+
+void EventTrace::addSpan(const std::string& name, uint64_t event, Clock::time_point start, Clock::time_point end) {
+    buffer().push_back({name,
+                        name,
+                        event,
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(start - start_).count(),
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count(),
+                        false});
+}
+
+void EventTrace::addMarker(const std::string& name, const std::string& module, uint64_t event, Clock::time_point time) {
+    buffer().push_back(
+        {name, module, event, std::chrono::duration_cast<std::chrono::nanoseconds>(time - start_).count(), 0, true});
+}
+
+/**
+ * Timestamps and durations are written in microseconds as required by the trace event format. Every thread is assigned a
+ * name in the trace via its metadata, the main thread is listed with number zero.
+ */
+void EventTrace::write() const {
+    std::ofstream file(path_);
+    if(!file.good()) {
+        throw RuntimeError("Cannot open trace file " + path_.string());
+    }
+
+    size_t records = 0;
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    for(size_t thread = 0; thread < buffers_.size(); ++thread) {
+        if(thread > 0) {
+            file << ",";
+        }
+        file << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << thread << ",\"args\":{\"name\":\""
+             << (thread == 0 ? std::string("main") : "worker " + std::to_string(thread)) << "\"}}";
+
+        for(const auto& record : buffers_[thread]) {
+            file << ",\n{\"name\":\"" << record.name << "\",\"cat\":\"" << (record.marker ? "sequence" : "module")
+                 << "\",\"pid\":0,\"tid\":" << thread << ",\"ts\":" << static_cast<double>(record.start) / 1e3;
+            if(record.marker) {
+                file << ",\"ph\":\"i\",\"s\":\"t\"";
+            } else {
+                file << ",\"ph\":\"X\",\"dur\":" << static_cast<double>(record.duration) / 1e3;
+            }
+            file << ",\"args\":{\"event\":" << record.event << ",\"module\":\"" << record.module << "\"}}";
+            ++records;
+        }
+    }
+    file << "\n]}\n";
+
+    LOG(STATUS) << "Wrote " << records << " trace records to " << path_;
+}
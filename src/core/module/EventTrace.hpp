@@ -0,0 +1,84 @@
+/**
+ * @file
+ * @brief Recording of the event loop execution in the Chrome trace event format
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef ALLPIX_MODULE_EVENT_TRACE_H
+#define ALLPIX_MODULE_EVENT_TRACE_H
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace allpix {
+    /**
+     * @brief Collects spans and markers of the event loop and writes them as Chrome trace event JSON
+     *
+     * Records are stored in separate buffers for every thread of the \ref ThreadPool, selected via ThreadPool::threadNum(),
+     * such that recording does not require any locking. The trace can be inspected with chrome://tracing or Perfetto.
+     */
+    class EventTrace {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        /**
+         * @brief Construct the trace
+         * @param path Path of the file the trace is written to
+         * @warning Total count of threads need to be preregistered via \ref ThreadPool::registerThreadCount
+         */
+        explicit EventTrace(std::filesystem::path path);
+
+        /**
+         * @brief Record the execution of a module for an event
+         * @param name Name of the module
+         * @param event Event number
+         * @param start Start of the execution
+         * @param end End of the execution
+         */
+        void addSpan(const std::string& name, uint64_t event, Clock::time_point start, Clock::time_point end);
+
+        /**
+         * @brief Record a marker for a state change of an event
+         * @param name Name of the marker
+         * @param module Name of the module the event is waiting for
+         * @param event Event number
+         * @param time Time of the state change
+         */
+        void addMarker(const std::string& name, const std::string& module, uint64_t event, Clock::time_point time);
+
+        /**
+         * @brief Write all records to the trace file
+         * @warning Should only be called after all threads have stopped recording
+         */
+        void write() const;
+
+    private:
+        struct Record {
+            std::string name;
+            std::string module;
+            uint64_t event;
+            int64_t start;
+            int64_t duration;
+            bool marker;
+        };
+
+        /**
+         * @brief Get the buffer of records for the calling thread
+         */
+        std::vector<Record>& buffer();
+
+        std::filesystem::path path_;
+        Clock::time_point start_;
+        std::vector<std::vector<Record>> buffers_;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_MODULE_EVENT_TRACE_H */
@@ -0,0 +1,104 @@
+/**
+ * @file
+ * @brief Counters and gauges of modules exported as structured metrics
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef ALLPIX_MODULE_METRICS_H
+#define ALLPIX_MODULE_METRICS_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "ThreadPool.hpp"
+
+namespace allpix {
+    class Module;
+
+    /**
+     * @brief Monotonic counter of a module, summed over all threads only when it is read
+     *
+     * Every thread of the \ref ThreadPool adds to its own shard, selected via ThreadPool::threadNum() and aligned to a
+     * separate cache line, such that counting in the hot path of many workers does not contend for a single atomic variable.
+     * Counters are owned by their module and registered via Module::register_counter, which allocates the shards.
+     */
+    class Counter {
+        friend class Module;
+
+    public:
+        /**
+         * @brief Add to the counter
+         * @param value Value to add
+         * @warning The counter has to be registered with its module before
+         */
+        void add(uint64_t value = 1) {
+            shards_[ThreadPool::threadNum() % shards_.size()].value.fetch_add(value, std::memory_order_relaxed);
+        }
+
+        /// @{
+        /**
+         * @brief Add to the counter
+         */
+        Counter& operator++() {
+            add();
+            return *this;
+        }
+        Counter& operator+=(uint64_t value) {
+            add(value);
+            return *this;
+        }
+        /// @}
+
+        /**
+         * @brief Get the current value of the counter
+         * @return Sum of the values of all threads
+         */
+        uint64_t value() const {
+            uint64_t total = 0;
+            for(const auto& shard : shards_) {
+                total += shard.value.load(std::memory_order_relaxed);
+            }
+            return total;
+        }
+
+        /**
+         * @brief Get the name of the counter
+         */
+        const std::string& getName() const { return name_; }
+
+        /**
+         * @brief Get the description of the counted quantity
+         */
+        const std::string& getDescription() const { return description_; }
+
+    private:
+        struct alignas(64) Shard {
+            std::atomic<uint64_t> value{};
+        };
+
+        std::string name_;
+        std::string description_;
+        std::vector<Shard> shards_;
+    };
+
+    /**
+     * @brief Gauge of a module, evaluated whenever the metrics are exported
+     * @note The value function is called from the thread exporting the metrics and should thus only read thread-safe state,
+     *       for example the values of counters
+     */
+    struct Gauge {
+        std::string name;
+        std::string description;
+        std::function<double()> value;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_MODULE_METRICS_H */
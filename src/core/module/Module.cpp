@@ -25,7 +25,11 @@ using namespace allpix;
 
 Module::Module(Configuration& config) : Module(config, nullptr) {}
 Module::Module(Configuration& config, std::shared_ptr<Detector> detector)
-    : config_(config), detector_(std::move(detector)) {}
+    : config_(config), detector_(std::move(detector)) {
+    if(detector_ != nullptr) {
+        detectors_.push_back(detector_);
+    }
+}
 /**
  * @note The remove_delegate can throw in theory, but this should never happen in practice
  */
@@ -131,6 +135,7 @@ Module::createOutputFile(const std::string& pathname, const std::string& extensi
     if(delete_file) {
         std::filesystem::remove(file);
     }
+    output_files_ = true;
     return file;
 }
 
@@ -150,6 +155,32 @@ TDirectory* Module::getROOTDirectory() const {
 }
 void Module::set_ROOT_directory(TDirectory* directory) { directory_ = directory; }
 
+/**
+ * Modules are considered to have side effects if they explicitly declared them, requested output files or enabled the
+ * creation of plots via their "output_plots" parameter
+ */
+bool Module::has_side_effects() const { return side_effects_ || output_files_ || config_.get<bool>("output_plots", false); }
+
+/**
+ * The support is recorded regardless of the configuration, such that the module manager can reject the "multi_detector"
+ * parameter for modules which never called this method
+ */
+bool Module::allow_multi_detector() {
+    multi_detector_ = true;
+    return config_.get<bool>("multi_detector", false);
+}
+
+void Module::register_counter(Counter& counter, std::string name, std::string description) {
+    counter.name_ = std::move(name);
+    counter.description_ = std::move(description);
+    counter.shards_ = std::vector<Counter::Shard>(ThreadPool::threadCount());
+    counters_.push_back(&counter);
+}
+
+void Module::register_gauge(std::string name, std::string description, std::function<double()> value) {
+    gauges_.push_back({std::move(name), std::move(description), std::move(value)});
+}
+
 /**
  * @throws InvalidModuleActionException If this method is called from the constructor or destructor
  * @warning This function technically allows to write to the configurations of other modules, but this should never be done
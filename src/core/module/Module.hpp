@@ -14,14 +14,21 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <functional>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <set>
 #include <string>
+#include <thread>
+#include <typeindex>
+#include <utility>
 #include <vector>
 
 #include <TDirectory.h>
 
+#include "Metrics.hpp"
 #include "ModuleIdentifier.hpp"
 #include "core/config/ConfigManager.hpp"
 #include "core/config/Configuration.hpp"
@@ -100,6 +107,15 @@ namespace allpix {
          */
         std::shared_ptr<Detector> getDetector() const { return detector_; }
 
+        /**
+         * @brief Get all detectors handled by this module
+         * @return Detectors handled by this module, empty if this is an unique module
+         *
+         * Detector modules handle only their linked detector, unless they are instantiated once for all detectors of a model
+         * as described in \ref allow_multi_detector. The linked detector is then the first of these detectors.
+         */
+        const std::vector<std::shared_ptr<Detector>>& getDetectors() const { return detectors_; }
+
         /**
          * @brief Get the unique name of this module
          * @return Unique name
@@ -138,6 +154,12 @@ namespace allpix {
          */
         bool multithreadingEnabled() const { return multithreading_; }
 
+        /**
+         * @brief Returns if this module supports handling multiple detectors with a single instance
+         * @return True if the module called \ref allow_multi_detector, false otherwise (the default)
+         */
+        bool multiDetectorEnabled() const { return multi_detector_; }
+
         /**
          * @brief Initialize the module for each thread after the global initialization
          * @note Useful to prepare thread local objects
@@ -161,6 +183,15 @@ namespace allpix {
          */
         virtual void run(Event* event) { (void)event; }
 
+        /**
+         * @brief Persist the state of the module at a checkpoint of the run
+         * @note Called from the main thread while no event is processed, after all events up to the checkpoint finished.
+         * Modules writing output should flush it such that it reflects exactly these events.
+         *
+         * Does nothing if not overloaded.
+         */
+        virtual void checkpoint() {}
+
         /**
          * @brief Finalize the module after the event sequence for each thread
          * @note Useful to cleanup thread local objects
@@ -183,6 +214,70 @@ namespace allpix {
          */
         void allow_multithreading() { set_multithreading(true); }
 
+        /**
+         * @brief Enable the instantiation of this detector module once for all detectors of the same model
+         * @return True if this instance handles all detectors of its model, as requested by the \c multi_detector parameter
+         * @note Should be called in the constructor. If enabled, the detectors are available from \ref getDetectors after
+         *       the construction and the messages of all of them have to be bound with \ref Messenger::bindMulti
+         */
+        bool allow_multi_detector();
+
+        /**
+         * @brief Declare that this module has side effects besides dispatching messages, writing files and creating plots
+         * @note Modules with side effects are never considered unused, even if none of their messages are received
+         */
+        void declare_side_effects() { side_effects_ = true; }
+
+        /**
+         * @brief Declare a type of message dispatched by this module
+         * @tparam T Type of the message
+         * @note Should be called in the constructor for every dispatched type. Modules which do not declare any type are
+         *       assumed to not dispatch messages when searching for unused modules
+         */
+        template <typename T> void declare_output() { output_types_.emplace(typeid(T)); }
+
+        /**
+         * @brief Register a counter of this module, exported with the metrics of the framework
+         * @param counter Counter owned by this module
+         * @param name Name of the counter, unique within this module
+         * @param description Description of the counted quantity
+         * @warning Should be called in \ref initialize before anything is added to the counter, since this allocates the
+         *          shards for the number of threads registered at this point
+         */
+        void register_counter(Counter& counter, std::string name, std::string description);
+
+        /**
+         * @brief Register a gauge of this module, exported with the metrics of the framework
+         * @param name Name of the gauge, unique within this module
+         * @param description Description of the measured quantity
+         * @param value Function returning the current value of the gauge
+         */
+        void register_gauge(std::string name, std::string description, std::function<double()> value);
+
+        /**
+         * @brief Get a reusable container which keeps its capacity between the events processed by the same thread
+         * @param slot Index to distinguish multiple containers of the same type used by this module
+         * @return Reference to the cleared container of this module instantiation for the calling thread
+         * @warning The container is cleared by the next call with the same type and slot on the same thread. It should
+         *          thus only be used within the current call of the module and not be shared with the parallel tasks of
+         *          an event. Only containers keeping their capacity when cleared, such as vectors, avoid allocations.
+         * @note The containers are owned by the module and released together with it
+         */
+        template <typename T> T& scratch(size_t slot = 0) {
+            // Only the lookup of the containers of the calling thread has to be locked, they are not shared with others
+            std::unique_lock<std::mutex> lock(scratch_mutex_);
+            auto& containers = scratch_[std::this_thread::get_id()];
+            lock.unlock();
+
+            auto& container = containers[{std::type_index(typeid(T)), slot}];
+            if(container == nullptr) {
+                container = std::make_shared<T>();
+            }
+            auto& typed_container = *std::static_pointer_cast<T>(container);
+            typed_container.clear();
+            return typed_container;
+        }
+
         /**
          * @brief Get the module configuration for internal use
          * @return Configuration of the module
@@ -236,16 +331,51 @@ namespace allpix {
          */
         virtual void skip_event(uint64_t) {}
 
+        /**
+         * @brief Estimate the computational cost of an event before it is processed
+         * @return Relative cost of the event or an empty optional if the module cannot estimate it
+         * @note The estimates of all modules are summed by the module manager to start the most expensive events first
+         */
+        virtual std::optional<double> estimate_event_cost(uint64_t) const { return std::nullopt; }
+
         std::vector<std::pair<Messenger*, BaseDelegate*>> delegates_;
 
         std::shared_ptr<Detector> detector_;
 
+        /**
+         * @brief Set all detectors handled by this module for internal use
+         * @param detectors Detectors of the same model, starting with the linked detector
+         */
+        void set_detectors(std::vector<std::shared_ptr<Detector>> detectors) { detectors_ = std::move(detectors); }
+        std::vector<std::shared_ptr<Detector>> detectors_;
+        bool multi_detector_{false};
+
         /**
          * @brief Sets the multithreading flag
          */
         void set_multithreading(bool multithreading) { multithreading_ = multithreading; }
         bool multithreading_{false};
 
+        /**
+         * @brief Check if the module has side effects besides dispatching messages
+         * @return True if the module has side effects, false otherwise
+         * @warning Only valid after the module has been initialized
+         */
+        bool has_side_effects() const;
+        bool side_effects_{false};
+        bool output_files_{false};
+
+        // Message types declared to be dispatched by the module
+        std::set<std::type_index> output_types_;
+
+        // Metrics registered by the module
+        std::vector<const Counter*> counters_;
+        std::vector<Gauge> gauges_;
+
+        // Reusable containers of the threads calling this module, by their type and slot
+        std::mutex scratch_mutex_;
+        std::map<std::thread::id, std::map<std::pair<std::type_index, size_t>, std::shared_ptr<void>>> scratch_;
+
         /**
          * @brief Checks if object is instance of SequentialModule class
          */
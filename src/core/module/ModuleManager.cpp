@@ -13,27 +13,44 @@
 #include "Event.hpp"
 
 #include <dlfcn.h>
+#include <sys/resource.h>
 #include <unistd.h>
 
 #include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <cstring>
+#include <exception>
 #include <filesystem>
 #include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iterator>
 #include <limits>
+#include <numeric>
+#include <optional>
 #include <set>
+#include <sstream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
 
+#include <TKey.h>
+#include <TMemFile.h>
+#include <TParameter.h>
 #include <TROOT.h>
 #include <TSystem.h>
 
 #include "core/config/ConfigManager.hpp"
 #include "core/config/Configuration.hpp"
+#include "core/config/OptionParser.hpp"
 #include "core/config/exceptions.h"
 #include "core/geometry/GeometryManager.hpp"
 #include "core/messenger/Messenger.hpp"
 #include "core/utils/log.h"
+#include "core/utils/numa.h"
+#include "core/utils/type.h"
 
 // Common prefix for all modules
 // TODO [doc] Should be provided by the build system
@@ -47,6 +64,8 @@ using namespace allpix;
 
 ModuleManager::ModuleManager() : terminate_(false) {}
 
+ModuleManager::~ModuleManager() { stop_metrics_export(); }
+
 /**
  * Loads the modules specified in the configuration file. Each module is contained within its own library which is loaded
  * automatically. After that the required modules are created from the configuration.
@@ -64,138 +83,55 @@ void ModuleManager::load(Messenger* messenger, ConfigManager* conf_manager, Geom
     // Set default for performance plot creation:
     global_config.setDefault("performance_plots", false);
 
-    // Store the messenger
-    messenger_ = messenger;
-
-    // (Re)create the main ROOT file
-    auto path = std::filesystem::path(gSystem->pwd()) / global_config.get<std::string>("root_file", "modules");
-    path.replace_extension("root");
+    // Check the baseline for the performance comparison early to not fail only after the full run
+    if(global_config.has("performance_baseline")) {
+        global_config.getPath("performance_baseline", true);
+        auto tolerance = global_config.get<double>("performance_tolerance", 0.3);
+        if(tolerance < 0 || tolerance >= 1) {
+            throw InvalidValueError(global_config, "performance_tolerance", "tolerance should be between zero and one");
+        }
+    }
 
-    if(std::filesystem::is_regular_file(path)) {
-        if(global_config.get<bool>("deny_overwrite", false)) {
-            throw RuntimeError("Overwriting of existing main ROOT file " + path.string() + " denied");
+    // Check the format and the interval of the metrics export
+    if(global_config.has("metrics_file")) {
+        auto format = global_config.get<std::string>("metrics_format", "json");
+        if(format != "json" && format != "prometheus") {
+            throw InvalidValueError(global_config, "metrics_format", "format should be either 'json' or 'prometheus'");
+        }
+        metrics_prometheus_ = (format == "prometheus");
+        global_config.setDefault<double>("metrics_interval", Units::get(10.0, "s"));
+        if(global_config.get<double>("metrics_interval") <= 0) {
+            throw InvalidValueError(global_config, "metrics_interval", "interval should be larger than zero");
         }
-        LOG(WARNING) << "Main ROOT file " << path << " exists and will be overwritten.";
-        std::filesystem::remove(path);
     }
-    modules_file_ = std::make_unique<TFile>(path.c_str(), "RECREATE");
-    if(modules_file_->IsZombie()) {
-        throw RuntimeError("Cannot create main ROOT file " + path.string());
+
+    // Replace the modules of a cached stage by reading their outputs or store the outputs for the next run
+    if(global_config.has("stage_cache")) {
+        configure_stage_cache(global_config, configs, geo_manager);
     }
-    modules_file_->cd();
+
+    // Store the messenger and the geometry manager
+    messenger_ = messenger;
+    geo_manager_ = geo_manager;
+
+    // (Re)create the main ROOT file
+    open_modules_file();
 
     // Loop through all non-global configurations
     for(auto& config : configs) {
-        // Load library for each module. Libraries are named (by convention + CMAKE) libAllpixModule Name.suffix
-        std::string lib_name = std::string(ALLPIX_MODULE_PREFIX).append(config.getName()).append(SHARED_LIBRARY_SUFFIX);
         LOG_PROGRESS(STATUS, "LOAD_LOOP") << "Loading module " << config.getName();
 
-        void* lib = nullptr;
-        bool load_error = false;
-        dlerror();
-        if(loaded_libraries_.count(lib_name) == 0) {
-            // If library is not loaded then try to load it first from the config directories
-            if(global_config.has("library_directories")) {
-                LOG(TRACE) << "Attempting to load library from configured paths";
-                auto lib_paths = global_config.getPathArray("library_directories", true);
-                for(const auto& lib_path : lib_paths) {
-                    auto full_lib_path = lib_path;
-                    full_lib_path /= lib_name;
-                    LOG(TRACE) << "Searching in path " << full_lib_path;
-
-                    // Check if the absolute file exists and try to load if it exists
-                    std::ifstream check_file(full_lib_path);
-                    if(check_file.good()) {
-                        lib = dlopen(full_lib_path.c_str(), RTLD_NOW);
-                        if(lib != nullptr) {
-                            LOG(DEBUG) << "Found library in configuration specified directory at " << full_lib_path;
-                        } else {
-                            load_error = true;
-                        }
-                        break;
-                    }
-                }
-            }
-
-            // Otherwise try to load from the standard paths if not found already
-            if(!load_error && lib == nullptr) {
-                lib = dlopen(lib_name.c_str(), RTLD_NOW);
-
-                if(lib != nullptr) {
-                    Dl_info dl_info;
-                    dl_info.dli_fname = "";
-
-                    // workaround to get the location of the library
-                    int ret = dladdr(dlsym(lib, ALLPIX_UNIQUE_FUNCTION), &dl_info);
-                    if(ret != 0) {
-                        LOG(DEBUG) << "Found library during global search in runtime paths at " << dl_info.dli_fname;
-                    } else {
-                        LOG(WARNING)
-                            << "Found library during global search but could not deduce location, likely broken library";
-                    }
-                } else {
-                    load_error = true;
-                }
-            }
-        } else {
-            // Otherwise just fetch it from the cache
-            lib = loaded_libraries_[lib_name];
-        }
-
-        // If library did not load then throw exception
-        if(load_error) {
-            const char* lib_error = dlerror();
-
-            // Find the name of the loaded library if it exists
-            std::string lib_error_str = lib_error;
-            size_t end_pos = lib_error_str.find(':');
-            std::string problem_lib;
-            if(end_pos != std::string::npos) {
-                problem_lib = lib_error_str.substr(0, end_pos);
-            }
-
-            // FIXME is checking the error in this way portable?
-            if(lib_error != nullptr && std::strstr(lib_error, "cannot allocate memory in static TLS block") != nullptr) {
-                LOG(ERROR) << "Library could not be loaded: not enough thread local storage available" << std::endl
-                           << "Try one of below workarounds:" << std::endl
-                           << "- Rerun library with the environmental variable LD_PRELOAD='" << problem_lib << "'"
-                           << std::endl
-                           << "- Recompile the library " << problem_lib << " with tls-model=global-dynamic";
-            } else if(lib_error != nullptr && std::strstr(lib_error, "cannot open shared object file") != nullptr &&
-                      problem_lib.find(ALLPIX_MODULE_PREFIX) == std::string::npos) {
-                LOG(ERROR) << "Library could not be loaded: one of its dependencies is missing" << std::endl
-                           << "The name of the missing library is " << problem_lib << std::endl
-                           << "Please make sure the library is properly initialized and try again";
-            } else if(lib_error != nullptr && std::strstr(lib_error, "undefined symbol") != nullptr) {
-                LOG(ERROR) << "Library could not be loaded: library version does not match framework (undefined symbols)"
-                           << std::endl
-                           << "The name of the problematic library is " << problem_lib << std::endl
-                           << "Please make sure the library is compiled against the correct framework version";
+        // Find the generator of the module, either linked into the executable or in the library of the module
+        if(module_generators_.count(config.getName()) == 0) {
+            const auto* static_generator = ModuleRegistry::find(config.getName());
+            if(static_generator != nullptr) {
+                LOG(DEBUG) << "Found module linked into the executable";
+                module_generators_[config.getName()] = *static_generator;
             } else {
-                LOG(ERROR) << "Library could not be loaded: it is not available" << std::endl
-                           << " - Did you enable the library during building? " << std::endl
-                           << " - Did you spell the library name correctly (case-sensitive)? ";
-                if(lib_error != nullptr) {
-                    LOG(DEBUG) << "Detailed error: " << lib_error;
-                }
+                module_generators_[config.getName()] = load_module_library(global_config, config.getName());
             }
-
-            throw allpix::DynamicLibraryError(config.getName());
-        }
-        // Remember that this library was loaded
-        loaded_libraries_[lib_name] = lib;
-
-        // Check if this module is produced once, or once per detector
-        bool unique = true;
-        void* uniqueFunction = dlsym(loaded_libraries_[lib_name], ALLPIX_UNIQUE_FUNCTION);
-
-        // If the unique function was not found, throw an error
-        if(uniqueFunction == nullptr) {
-            LOG(ERROR) << "Module library is invalid or outdated: required interface function not found!";
-            throw allpix::DynamicLibraryError(config.getName());
-        } else {
-            unique = reinterpret_cast<bool (*)()>(uniqueFunction)(); // NOLINT
         }
+        const auto& generator = module_generators_[config.getName()];
 
         // Add the global internal parameters to the configuration
         std::string global_dir = gSystem->pwd();
@@ -207,10 +143,10 @@ void ModuleManager::load(Messenger* messenger, ConfigManager* conf_manager, Geom
 
         // Create the modules from the library depending on the module type
         std::vector<std::pair<ModuleIdentifier, Module*>> mod_list;
-        if(unique) {
-            mod_list.emplace_back(create_unique_modules(loaded_libraries_[lib_name], config, messenger, geo_manager));
+        if(generator.isUnique()) {
+            mod_list.emplace_back(create_unique_modules(generator.unique, config, messenger, geo_manager));
         } else {
-            mod_list = create_detector_modules(loaded_libraries_[lib_name], config, messenger, geo_manager);
+            mod_list = create_detector_modules(generator.detector, config, messenger, geo_manager);
         }
 
         // Loop through all created instantiations
@@ -234,6 +170,8 @@ void ModuleManager::load(Messenger* messenger, ConfigManager* conf_manager, Geom
                     conf_manager_->dropInstanceConfiguration(iter->first);
 
                     module_execution_time_.erase(iter->second->get());
+                    event_filters_.erase(iter->second->get());
+                    plot_sampling_.erase(iter->second->get());
                     iter->second = modules_.erase(iter->second);
                     iter = id_to_module_.erase(iter);
                 } else {
@@ -251,6 +189,12 @@ void ModuleManager::load(Messenger* messenger, ConfigManager* conf_manager, Geom
             // Save the identifier in the module
             mod->set_identifier(identifier);
 
+            // Read the event filter evaluated before running the module
+            read_event_filter(mod.get(), geo_manager);
+
+            // Read the sampling of the plots of the module
+            read_plot_sampling(mod.get());
+
             // Check if module can't run in parallel
             auto module_can_parallelize = mod->multithreadingEnabled();
             if(multithreading_flag_ && !module_can_parallelize) {
@@ -273,6 +217,196 @@ void ModuleManager::load(Messenger* messenger, ConfigManager* conf_manager, Geom
     LOG_PROGRESS(STATUS, "LOAD_LOOP") << "Loaded " << configs.size() << " modules";
 }
 
+/**
+ * Recycled events are cleared by the thread releasing them, such that their messages are destroyed before the object is
+ * added to the pool. The containers of the messenger and the memory blocks of the stream holding the random engine state
+ * are kept for the next event.
+ */
+std::shared_ptr<Event> ModuleManager::acquire_event(uint64_t event_num, uint64_t seed) {
+    if(!recycle_events_) {
+        return std::make_shared<Event>(*messenger_, event_num, seed);
+    }
+
+    std::unique_ptr<Event> event;
+    {
+        auto& pool = event_pools_[ThreadPool::threadNum() % event_pools_.size()];
+        std::lock_guard<std::mutex> lock{pool.mutex};
+        if(!pool.events.empty()) {
+            event = std::move(pool.events.back());
+            pool.events.pop_back();
+        }
+    }
+    if(event == nullptr) {
+        event = std::make_unique<Event>(*messenger_, event_num, seed);
+    } else {
+        event->reset(event_num, seed);
+    }
+
+    auto release = [this](Event* released) {
+        released->clear();
+        auto& pool = event_pools_[ThreadPool::threadNum() % event_pools_.size()];
+        std::lock_guard<std::mutex> lock{pool.mutex};
+        pool.events.emplace_back(released);
+    };
+    return {event.release(), release, std::pmr::polymorphic_allocator<Event>(&event_control_blocks_)};
+}
+
+void ModuleManager::open_modules_file() {
+    Configuration& global_config = conf_manager_->getGlobalConfiguration();
+    auto path = std::filesystem::path(gSystem->pwd()) / global_config.get<std::string>("root_file", "modules");
+    path.replace_extension("root");
+
+    if(std::filesystem::is_regular_file(path)) {
+        if(global_config.get<bool>("deny_overwrite", false)) {
+            throw RuntimeError("Overwriting of existing main ROOT file " + path.string() + " denied");
+        }
+        LOG(WARNING) << "Main ROOT file " << path << " exists and will be overwritten.";
+        std::filesystem::remove(path);
+    }
+    modules_file_ = std::make_unique<TFile>(path.c_str(), "RECREATE");
+    if(modules_file_->IsZombie()) {
+        throw RuntimeError("Cannot create main ROOT file " + path.string());
+    }
+    modules_file_->cd();
+}
+
+/**
+ * @throws InvalidValueError If no module section of the last module of the cached stage exists
+ *
+ * The stage comprises all module sections up to and including the last section of the module configured as
+ * stage_cache_cut. Its hash combines the framework version, the global parameters defining the simulated events, the
+ * detector configurations and their model files, and the name, file and keys of every section of the stage, in order. All
+ * files referenced by the values of the detector configurations and the sections of the stage, such as field maps, GDML
+ * files or deposition input files, are part of the hash via their path, size and time of the last modification. A file
+ * changed in place without altering both is not detected. If a cache file with this hash exists, the sections of
+ * the stage are replaced by a ROOTObjectReader reading the stored messages. Otherwise, a ROOTObjectWriter storing all
+ * messages of the stage is added after it. The file is only renamed to its final name once the run completed, such that
+ * interrupted runs are never reused.
+ */
+void ModuleManager::configure_stage_cache(Configuration& global_config,
+                                          std::list<Configuration>& configs,
+                                          GeometryManager* geo_manager) {
+    auto cut = global_config.get<std::string>("stage_cache_cut");
+    auto last = std::find_if(
+        configs.rbegin(), configs.rend(), [&cut](const Configuration& config) { return config.getName() == cut; });
+    if(last == configs.rend()) {
+        throw InvalidValueError(global_config, "stage_cache_cut", "no section of module " + cut + " is configured");
+    }
+    auto stage_end = last.base();
+
+    // FNV-1a hash of all values, with a separator not contained in the strings
+    uint64_t hash = 14695981039346656037ULL;
+    auto add = [&hash](const std::string& value) {
+        for(auto character : value) {
+            hash = (hash ^ static_cast<unsigned char>(character)) * 1099511628211ULL;
+        }
+        hash = (hash ^ 0xFFU) * 1099511628211ULL;
+    };
+
+    // Files are identified by their path, size and time of the last modification to not read large field maps
+    auto add_file = [&add](const std::filesystem::path& path) {
+        std::error_code size_error, time_error;
+        auto size = std::filesystem::file_size(path, size_error);
+        auto time = std::filesystem::last_write_time(path, time_error);
+        if(size_error || time_error) {
+            return;
+        }
+        add(path.string());
+        add(std::to_string(size));
+        add(std::to_string(time.time_since_epoch().count()));
+    };
+
+    // Add all existing files named by the values of a configuration, read from a copy to not mark the keys as used
+    auto add_referenced_files = [&add_file](Configuration config) {
+        for(const auto& key_value : config.getAll()) {
+            try {
+                for(const auto& path : config.getPathArray(key_value.first)) {
+                    std::error_code error;
+                    if(std::filesystem::is_regular_file(path, error)) {
+                        add_file(path);
+                    }
+                }
+            } catch(const ConfigurationError&) {
+                // Values which cannot be read as paths do not refer to files
+            }
+        }
+    };
+
+    add(ALLPIX_PROJECT_VERSION);
+    for(const std::string key : {"random_seed",
+                                 "random_seed_core",
+                                 "random_engine",
+                                 "module_random_streams",
+                                 "number_of_events",
+                                 "skip_events",
+                                 "shard_count",
+                                 "shard_index",
+                                 "model_paths"}) {
+        add(key);
+        add(global_config.has(key) ? global_config.getText(key) : "");
+    }
+    for(const auto& detector_config : conf_manager_->getDetectorConfigurations()) {
+        add(detector_config.getName());
+        for(const auto& [key, value] : detector_config.getAll()) {
+            add(key);
+            add(value);
+        }
+        add_referenced_files(detector_config);
+
+        // The model is read from the first model path providing it, following GeometryManager::load_models
+        if(!detector_config.has("type")) {
+            continue;
+        }
+        auto type = Configuration(detector_config).get<std::string>("type");
+        for(const auto& model_path : geo_manager->getModelsPath()) {
+            std::filesystem::path path(model_path);
+            if(std::filesystem::is_directory(path)) {
+                path /= type + ALLPIX_MODEL_SUFFIX;
+            } else if(path.stem() != type) {
+                continue;
+            }
+            if(std::filesystem::is_regular_file(path)) {
+                add_file(std::filesystem::canonical(path));
+                break;
+            }
+        }
+    }
+    for(auto iter = configs.begin(); iter != stage_end; ++iter) {
+        add(iter->getName());
+        add(iter->getFilePath().string());
+        for(const auto& [key, value] : iter->getAll()) {
+            add(key);
+            add(value);
+        }
+        add_referenced_files(*iter);
+    }
+
+    std::ostringstream file_name;
+    file_name << "stage_" << std::hex << std::setw(16) << std::setfill('0') << hash;
+    auto directory = global_config.getPath("stage_cache");
+    std::filesystem::create_directories(directory);
+    auto file = directory / (file_name.str() + ".root");
+    auto sections = std::distance(configs.begin(), stage_end);
+
+    // The identifiers of the added unique modules are extended by input and output to not collide with configured ones
+    if(std::filesystem::is_regular_file(file)) {
+        LOG(STATUS) << "Reusing cached outputs of " << sections << " module sections up to " << cut << " from " << file;
+        configs.erase(configs.begin(), stage_end);
+        Configuration reader_config("ROOTObjectReader");
+        reader_config.set<std::string>("file_name", file.string());
+        reader_config.set<std::string>("input", "stage_cache");
+        configs.push_front(std::move(reader_config));
+    } else {
+        LOG(STATUS) << "Caching outputs of " << sections << " module sections up to " << cut << " in " << file;
+        stage_cache_file_ = file;
+        stage_cache_incomplete_file_ = directory / (file_name.str() + "_incomplete.root");
+        Configuration writer_config("ROOTObjectWriter");
+        writer_config.set<std::string>("file_name", stage_cache_incomplete_file_.string());
+        writer_config.set<std::string>("output", "stage_cache");
+        configs.insert(stage_end, std::move(writer_config));
+    }
+}
+
 /**
  * Calls config_manager->addInstanceConfiguration(identifier, config) while handling ModuleIdentifierAlreadyAddedError
  */
@@ -285,10 +419,137 @@ add_instance_configuration(ConfigManager* config_manager, const ModuleIdentifier
     }
 }
 
+/**
+ * @throws DynamicLibraryError If the library of the module cannot be loaded or does not provide the interface functions
+ *
+ * The library is searched in the configured library directories first and in the standard runtime paths otherwise.
+ */
+ModuleGenerator ModuleManager::load_module_library(const Configuration& global_config, const std::string& module_name) {
+    // Load library for each module. Libraries are named (by convention + CMAKE) libAllpixModule Name.suffix
+    std::string lib_name = std::string(ALLPIX_MODULE_PREFIX).append(module_name).append(SHARED_LIBRARY_SUFFIX);
+
+    void* lib = nullptr;
+    bool load_error = false;
+    dlerror();
+
+    // Try to load the library first from the config directories
+    if(global_config.has("library_directories")) {
+        LOG(TRACE) << "Attempting to load library from configured paths";
+        auto lib_paths = global_config.getPathArray("library_directories", true);
+        for(const auto& lib_path : lib_paths) {
+            auto full_lib_path = lib_path;
+            full_lib_path /= lib_name;
+            LOG(TRACE) << "Searching in path " << full_lib_path;
+
+            // Check if the absolute file exists and try to load if it exists
+            std::ifstream check_file(full_lib_path);
+            if(check_file.good()) {
+                lib = dlopen(full_lib_path.c_str(), RTLD_NOW);
+                if(lib != nullptr) {
+                    LOG(DEBUG) << "Found library in configuration specified directory at " << full_lib_path;
+                } else {
+                    load_error = true;
+                }
+                break;
+            }
+        }
+    }
+
+    // Otherwise try to load from the standard paths if not found already
+    if(!load_error && lib == nullptr) {
+        lib = dlopen(lib_name.c_str(), RTLD_NOW);
+
+        if(lib != nullptr) {
+            Dl_info dl_info;
+            dl_info.dli_fname = "";
+
+            // workaround to get the location of the library
+            int ret = dladdr(dlsym(lib, ALLPIX_UNIQUE_FUNCTION), &dl_info);
+            if(ret != 0) {
+                LOG(DEBUG) << "Found library during global search in runtime paths at " << dl_info.dli_fname;
+            } else {
+                LOG(WARNING) << "Found library during global search but could not deduce location, likely broken library";
+            }
+        } else {
+            load_error = true;
+        }
+    }
+
+    // If library did not load then throw exception
+    if(load_error) {
+        const char* lib_error = dlerror();
+
+        // Find the name of the loaded library if it exists
+        std::string lib_error_str = lib_error;
+        size_t end_pos = lib_error_str.find(':');
+        std::string problem_lib;
+        if(end_pos != std::string::npos) {
+            problem_lib = lib_error_str.substr(0, end_pos);
+        }
+
+        // FIXME is checking the error in this way portable?
+        if(lib_error != nullptr && std::strstr(lib_error, "cannot allocate memory in static TLS block") != nullptr) {
+            LOG(ERROR) << "Library could not be loaded: not enough thread local storage available" << std::endl
+                       << "Try one of below workarounds:" << std::endl
+                       << "- Rerun library with the environmental variable LD_PRELOAD='" << problem_lib << "'"
+                       << std::endl
+                       << "- Recompile the library " << problem_lib << " with tls-model=global-dynamic";
+        } else if(lib_error != nullptr && std::strstr(lib_error, "cannot open shared object file") != nullptr &&
+                  problem_lib.find(ALLPIX_MODULE_PREFIX) == std::string::npos) {
+            LOG(ERROR) << "Library could not be loaded: one of its dependencies is missing" << std::endl
+                       << "The name of the missing library is " << problem_lib << std::endl
+                       << "Please make sure the library is properly initialized and try again";
+        } else if(lib_error != nullptr && std::strstr(lib_error, "undefined symbol") != nullptr) {
+            LOG(ERROR) << "Library could not be loaded: library version does not match framework (undefined symbols)"
+                       << std::endl
+                       << "The name of the problematic library is " << problem_lib << std::endl
+                       << "Please make sure the library is compiled against the correct framework version";
+        } else {
+            LOG(ERROR) << "Library could not be loaded: it is not available" << std::endl
+                       << " - Did you enable the library during building? " << std::endl
+                       << " - Did you spell the library name correctly (case-sensitive)? ";
+            if(lib_error != nullptr) {
+                LOG(DEBUG) << "Detailed error: " << lib_error;
+            }
+        }
+
+        throw allpix::DynamicLibraryError(module_name);
+    }
+
+    // Check if this module is produced once, or once per detector
+    bool unique = true;
+    void* uniqueFunction = dlsym(lib, ALLPIX_UNIQUE_FUNCTION);
+
+    // If the unique function was not found, throw an error
+    if(uniqueFunction == nullptr) {
+        LOG(ERROR) << "Module library is invalid or outdated: required interface function not found!";
+        throw allpix::DynamicLibraryError(module_name);
+    } else {
+        unique = reinterpret_cast<bool (*)()>(uniqueFunction)(); // NOLINT
+    }
+
+    // Get the generator function for this module
+    void* generator = dlsym(lib, ALLPIX_GENERATOR_FUNCTION);
+    // If the generator function was not found, throw an error
+    if(generator == nullptr) {
+        LOG(ERROR) << "Module library is invalid or outdated: required interface function not found!";
+        throw allpix::DynamicLibraryError(module_name);
+    }
+
+    // Convert to correct generator function
+    ModuleGenerator module_generator;
+    if(unique) {
+        module_generator.unique = reinterpret_cast<UniqueModuleGenerator>(generator); // NOLINT
+    } else {
+        module_generator.detector = reinterpret_cast<DetectorModuleGenerator>(generator); // NOLINT
+    }
+    return module_generator;
+}
+
 /**
  * For unique modules a single instance is created per section
  */
-std::pair<ModuleIdentifier, Module*> ModuleManager::create_unique_modules(void* library,
+std::pair<ModuleIdentifier, Module*> ModuleManager::create_unique_modules(UniqueModuleGenerator module_generator,
                                                                           Configuration& config,
                                                                           Messenger* messenger,
                                                                           GeometryManager* geo_manager) {
@@ -316,14 +577,6 @@ std::pair<ModuleIdentifier, Module*> ModuleManager::create_unique_modules(void*
     }
     ModuleIdentifier identifier(module_name, std::move(identifier_str), 0);
 
-    // Get the generator function for this module
-    void* generator = dlsym(library, ALLPIX_GENERATOR_FUNCTION);
-    // If the generator function was not found, throw an error
-    if(generator == nullptr) {
-        LOG(ERROR) << "Module library is invalid or outdated: required interface function not found!";
-        throw allpix::DynamicLibraryError(module_name);
-    }
-
     // Create and add module instance config
     Configuration& instance_config = add_instance_configuration(conf_manager_, identifier, config);
 
@@ -333,9 +586,6 @@ std::pair<ModuleIdentifier, Module*> ModuleManager::create_unique_modules(void*
     std::replace(path_mod_name.begin(), path_mod_name.end(), ':', '_');
     output_dir /= path_mod_name;
 
-    // Convert to correct generator function
-    auto module_generator = reinterpret_cast<Module* (*)(Configuration&, Messenger*, GeometryManager*)>(generator); // NOLINT
-
     LOG(DEBUG) << "Creating unique instantiation " << identifier.getUniqueName();
 
     // Get current time
@@ -361,15 +611,22 @@ std::pair<ModuleIdentifier, Module*> ModuleManager::create_unique_modules(void*
  * @throws InvalidModuleStateException If the module fails to forward the detector to the base class
  *
  * For detector modules multiple instantiations may be created per section. An instantiation is created for every detector if
- * no selection parameters are provided. Otherwise instantiations are created for every linked detector name and type.
+ * no selection parameters are provided. Otherwise instantiations are created for every linked detector name and type. If
+ * the module is configured to handle multiple detectors, the instantiations of all detectors sharing the same model are
+ * merged into a single instantiation handling all of them.
  */
-std::vector<std::pair<ModuleIdentifier, Module*>> ModuleManager::create_detector_modules(void* library,
-                                                                                         Configuration& config,
-                                                                                         Messenger* messenger,
-                                                                                         GeometryManager* geo_manager) {
+std::vector<std::pair<ModuleIdentifier, Module*>>
+ModuleManager::create_detector_modules(DetectorModuleGenerator module_generator,
+                                       Configuration& config,
+                                       Messenger* messenger,
+                                       GeometryManager* geo_manager) {
     const std::string& module_name = config.getName();
     LOG(DEBUG) << "Creating instantions for detector module " << module_name;
 
+    // Modules handle a single detector unless requested otherwise
+    config.setDefault<bool>("multi_detector", false);
+    auto multi_detector = config.get<bool>("multi_detector");
+
     // Create the basic identifier
     std::string identifier;
     if(!config.get<std::string>("input").empty()) {
@@ -381,17 +638,6 @@ std::vector<std::pair<ModuleIdentifier, Module*>> ModuleManager::create_detector
         identifier += config.get<std::string>("output");
     }
 
-    // Open the library and get the module generator function
-    void* generator = dlsym(library, ALLPIX_GENERATOR_FUNCTION);
-    // If the generator function was not found, throw an error
-    if(generator == nullptr) {
-        LOG(ERROR) << "Module library is invalid or outdated: required interface function not found!";
-        throw allpix::DynamicLibraryError(module_name);
-    }
-    // Convert to correct generator function
-    auto module_generator =
-        reinterpret_cast<Module* (*)(Configuration&, Messenger*, std::shared_ptr<Detector>)>(generator); // NOLINT
-
     // Handle empty type and name arrays:
     bool instances_created = false;
     std::vector<std::pair<std::shared_ptr<Detector>, ModuleIdentifier>> instantiations;
@@ -437,9 +683,49 @@ std::vector<std::pair<ModuleIdentifier, Module*>> ModuleManager::create_detector
         }
     }
 
+    // Merge the instantiations of detectors with the same model, named after the model type and with the highest priority
+    // of the merged instantiations
+    std::vector<std::vector<std::shared_ptr<Detector>>> detector_groups;
+    if(multi_detector) {
+        std::vector<std::pair<std::shared_ptr<Detector>, ModuleIdentifier>> merged_instantiations;
+        std::map<const DetectorModel*, size_t> model_groups;
+        for(auto& instance : instantiations) {
+            auto model = instance.first->getModel();
+            auto group = model_groups.find(model.get());
+            if(group == model_groups.end()) {
+                model_groups.emplace(model.get(), detector_groups.size());
+                detector_groups.push_back({instance.first});
+                merged_instantiations.emplace_back(
+                    instance.first,
+                    ModuleIdentifier(module_name, model->getType() + identifier, instance.second.getPriority()));
+                continue;
+            }
+            detector_groups[group->second].push_back(instance.first);
+            auto& merged = merged_instantiations[group->second].second;
+            if(instance.second.getPriority() < merged.getPriority()) {
+                merged = ModuleIdentifier(module_name, merged.getIdentifier(), instance.second.getPriority());
+            }
+        }
+
+        // Different models of the same type, e.g. by overriding model parameters for some detectors, are named after the
+        // first of their detectors instead
+        std::map<std::string, size_t> type_count;
+        for(const auto& instance : merged_instantiations) {
+            type_count[instance.first->getType()]++;
+        }
+        for(auto& instance : merged_instantiations) {
+            if(type_count[instance.first->getType()] > 1) {
+                instance.second = ModuleIdentifier(
+                    module_name, instance.first->getName() + identifier, instance.second.getPriority());
+            }
+        }
+        instantiations = std::move(merged_instantiations);
+    }
+
     // Construct instantiations from the list of requests
     std::vector<std::pair<ModuleIdentifier, Module*>> module_list;
-    for(auto& instance : instantiations) {
+    for(size_t i = 0; i < instantiations.size(); ++i) {
+        auto& instance = instantiations[i];
         LOG(DEBUG) << "Creating detector instantiation " << instance.second.getUniqueName();
         // Get current time
         auto start = std::chrono::steady_clock::now();
@@ -473,6 +759,16 @@ std::vector<std::pair<ModuleIdentifier, Module*>> ModuleManager::create_detector
                 " does not call the correct base Module constructor: the provided detector should be forwarded");
         }
 
+        // Hand all detectors of the model to modules handling multiple detectors
+        if(multi_detector) {
+            if(!module->multiDetectorEnabled()) {
+                throw InvalidValueError(config, "multi_detector", "module does not support handling multiple detectors");
+            }
+            LOG(DEBUG) << "Instantiation " << instance.second.getUniqueName() << " handles " << detector_groups[i].size()
+                       << " detectors";
+            module->set_detectors(std::move(detector_groups[i]));
+        }
+
         // Store the module
         module_list.emplace_back(instance.second, module);
     }
@@ -552,6 +848,21 @@ void ModuleManager::set_module_after(std::tuple<LogLevel, LogFormat, std::string
     Log::setEventNum(std::get<3>(prev));
 }
 
+/**
+ * The resident set size is reported in kilobytes on Linux and in bytes on macOS.
+ */
+static uint64_t peak_memory_usage() {
+    struct rusage usage {};
+    if(getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
 /**
  * Sets the section header and logging settings before executing the  \ref Module::initialize() function.
  */
@@ -579,15 +890,83 @@ void ModuleManager::initialize() {
                          << ") may impact simulation performance";
         }
 
+        // Execute consecutive ranges of the module chain on separate pools of workers if requested
+        main_stage_begin_ = modules_.begin();
+        worker_stages_.clear();
+        if(global_config.has("worker_stages")) {
+            configure_worker_stages(global_config);
+        }
+
         LOG(STATUS) << "Multithreading enabled, processing events in parallel on " << number_of_threads_
                     << " worker threads";
 
         // Adjust the modules buffer size according to the number of threads used
-        max_buffer_size_ = global_config.get<size_t>("buffer_per_worker", 256) * number_of_threads_;
+        buffer_per_worker_ = global_config.get<size_t>("buffer_per_worker", 256);
+        max_buffer_size_ = buffer_per_worker_ * number_of_threads_;
         if(max_buffer_size_ < number_of_threads_) {
             throw InvalidValueError(global_config, "buffer_per_worker", "buffer per worker should be larger than one");
         }
         LOG(STATUS) << "Allocating a total of " << max_buffer_size_ << " event slots for buffered modules";
+
+        // Select the strategy to distribute events to the workers
+        scheduler_ = global_config.get<ThreadPool::Scheduler>("scheduler", ThreadPool::Scheduler::CENTRAL);
+        LOG(STATUS) << "Distributing events to workers using " << allpix::to_string(scheduler_) << " scheduler";
+
+        // Buffered events can only be resumed in time by the work stealing scheduler if every worker holds two slots
+        if(scheduler_ == ThreadPool::Scheduler::WORK_STEALING && max_buffer_size_ < 2 * number_of_threads_) {
+            LOG(WARNING) << "Work stealing scheduler requires at least two buffered event slots per worker, increasing "
+                            "number of slots to "
+                         << 2 * number_of_threads_;
+            max_buffer_size_ = 2 * number_of_threads_;
+        }
+
+        // Execute the sequential modules at the end of the module chain on a dedicated thread if requested
+        if(global_config.get<bool>("writer_thread", false)) {
+            writer_begin_ = modules_.end();
+            while(writer_begin_ != modules_.begin() && (*std::prev(writer_begin_))->require_sequence()) {
+                --writer_begin_;
+            }
+            if(writer_begin_ == modules_.end()) {
+                LOG(WARNING) << "No modules requiring the event sequence at the end of the module chain, not using a "
+                                "writer thread";
+            } else if(!worker_stages_.empty() && std::distance(modules_.begin(), main_stage_begin_) >
+                                                        std::distance(modules_.begin(), writer_begin_)) {
+                throw InvalidCombinationError(global_config,
+                                              {"writer_thread", "worker_stages"},
+                                              "worker stages cannot begin within the modules executed by the writer thread");
+            } else {
+                use_writer_stage_ = true;
+                LOG(STATUS) << "Running " << std::distance(writer_begin_, modules_.end())
+                            << " modules at the end of the module chain on a dedicated writer thread";
+            }
+        }
+
+        // Pin the workers to the available processors, alternating between NUMA nodes, and replicate field grids per node
+        if(global_config.get<bool>("pin_workers", false)) {
+            auto nodes = get_numa_nodes();
+            for(size_t i = 0; !nodes.empty() && worker_cpus_.size() < number_of_threads_ + 1; ++i) {
+                for(unsigned int node = 0; node < nodes.size() && worker_cpus_.size() < number_of_threads_ + 1; ++node) {
+                    worker_cpus_.emplace_back(node, nodes[node][i % nodes[node].size()]);
+                }
+            }
+            if(worker_cpus_.empty()) {
+                LOG(WARNING) << "Processor topology not available, not pinning workers";
+            } else {
+                LOG(STATUS) << "Pinning workers to processors on " << nodes.size() << " NUMA nodes";
+            }
+
+            if(global_config.get<bool>("replicate_fields", false) && nodes.size() > 1) {
+                field_replica_nodes_ = static_cast<unsigned int>(nodes.size());
+            }
+        } else if(global_config.get<bool>("replicate_fields", false)) {
+            LOG(WARNING) << "Replicating field grids requires pinned workers, not replicating field grids";
+        }
+
+        // Limit the estimated memory held by buffered events
+        max_buffer_memory_ = global_config.get<size_t>("max_buffer_memory", 0);
+        if(max_buffer_memory_ > 0) {
+            LOG(STATUS) << "Delaying new events while buffered events hold more than " << max_buffer_memory_ << " bytes";
+        }
     } else {
         // Issue a warning in case MT was requested but we can't actually run in MT
         if(multithreading_flag_ && !can_parallelize_) {
@@ -598,12 +977,49 @@ void ModuleManager::initialize() {
         }
     }
 
+    // Collect the objects and sizes of the messages of every event if requested
+    event_statistics_ = global_config.get<bool>("event_statistics", false);
+
+    // Sample the hardware performance counters around every module call if requested and available
+    perf_counters_ = global_config.get<bool>("perf_counters", false);
+    PerfCounterValues counters{};
+    if(perf_counters_ && !read_perf_counters(counters)) {
+        LOG(WARNING) << "Hardware performance counters are not available, not sampling them" << std::endl
+                     << "Build with PERF_COUNTERS enabled and check that /proc/sys/kernel/perf_event_paranoid permits "
+                        "counting user space events";
+        perf_counters_ = false;
+    }
+
+    // Draw the random numbers of every module instantiation from its own stream instead of the engine of the event
+    module_random_streams_ = global_config.get<bool>("module_random_streams", false);
+    if(module_random_streams_) {
+        LOG(STATUS) << "Using independent random streams for every module instantiation";
+    }
+
+    // Select the initial size of the per-event memory arena
+    event_arena_size_ = global_config.get<size_t>("event_arena_size", 0);
+    if(event_arena_size_ > 0) {
+        LOG(STATUS) << "Allocating event data from per-event memory arenas of initially " << event_arena_size_ << " bytes";
+    }
+
+    // Reuse the objects of finished events including their containers for following events
+    recycle_events_ = global_config.get<bool>("recycle_events", false);
+    if(recycle_events_) {
+        LOG(STATUS) << "Recycling the objects of finished events";
+    }
+
     // Store final number of threads to the config for later reference
     global_config.set<size_t>("workers", number_of_threads_, true);
 
     // Initialize the thread pool with the number of threads
+    max_threads_ = number_of_threads_;
     if(number_of_threads_ > 0) {
-        ThreadPool::registerThreadCount(number_of_threads_);
+        ThreadPool::registerThreadCount(number_of_threads_ + (use_writer_stage_ ? 1 : 0));
+    }
+
+    // Keep the released events separately for every thread, threads registered later share the pools of the others
+    if(recycle_events_ && event_pools_.empty()) {
+        event_pools_ = std::vector<EventPool>(ThreadPool::threadCount());
     }
 
     // Book global performance histograms
@@ -620,84 +1036,413 @@ void ModuleManager::initialize() {
     LOG_PROGRESS(STATUS, "INIT_LOOP") << "Initializing " << modules_.size() << " module instantiations";
     for(auto& module : modules_) {
         LOG_PROGRESS(TRACE, "INIT_LOOP") << "Initializing " << module->get_identifier().getUniqueName();
+        prepare_module(module);
+    }
 
-        // Pass the config manager to this instance
-        module->set_config_manager(conf_manager_);
-
-        // Create main ROOT directory for this module class if it does not exists yet
-        LOG(TRACE) << "Creating and accessing ROOT directory";
-        std::string module_name = module->get_configuration().getName();
-        auto* directory = modules_file_->GetDirectory(module_name.c_str());
-        if(directory == nullptr) {
-            directory = modules_file_->mkdir(module_name.c_str());
-            if(directory == nullptr) {
-                throw RuntimeError("Cannot create or access overall ROOT directory for module " + module_name);
+    // Instantiations of the same module for different detectors are independent and can be initialized concurrently
+    auto parallel_initialization = number_of_threads_ > 1 && global_config.get<bool>("parallel_initialization", false);
+    for(auto module_iter = modules_.begin(); module_iter != modules_.end();) {
+        auto batch_end = std::next(module_iter);
+        if(parallel_initialization && (*module_iter)->getDetector() != nullptr) {
+            while(batch_end != modules_.end() && (*batch_end)->getDetector() != nullptr &&
+                  (*batch_end)->get_configuration().getName() == (*module_iter)->get_configuration().getName()) {
+                ++batch_end;
             }
         }
-        directory->cd();
 
-        // Create local directory for this instance
-        TDirectory* local_directory = nullptr;
-        if(module->get_identifier().getIdentifier().empty()) {
-            local_directory = directory;
+        auto batch_size = static_cast<size_t>(std::distance(module_iter, batch_end));
+        if(batch_size == 1) {
+            initialize_module(*module_iter);
         } else {
-            local_directory = directory->mkdir(module->get_identifier().getIdentifier().c_str());
-            if(local_directory == nullptr) {
-                throw RuntimeError("Cannot create or access local ROOT directory for module " + module->getUniqueName());
-            }
+            LOG(DEBUG) << "Initializing " << batch_size << " instantiations of "
+                       << (*module_iter)->get_configuration().getName() << " concurrently";
+            run_concurrently(std::vector<std::shared_ptr<Module>>(module_iter, batch_end),
+                             [this](const std::shared_ptr<Module>& module) { initialize_module(module); });
         }
+        module_iter = batch_end;
+    }
+    LOG_PROGRESS(STATUS, "INIT_LOOP") << "Initialized " << modules_.size() << " module instantiations";
 
-        // Change to the directory and save it in the module
-        local_directory->cd();
-        module->set_ROOT_directory(local_directory);
+    // Detect modules which do not contribute to the output of the simulation
+    find_unused_modules(global_config.get<bool>("skip_unused_modules", false));
 
-        // Get current time
-        auto start = std::chrono::steady_clock::now();
-        // Set module specific settings
-        auto old_settings = set_module_before(module->get_identifier().getUniqueName(), module->get_configuration(), "I:");
-        // Change to our ROOT directory
-        module->getROOTDirectory()->cd();
-        // Init module
-        module->initialize();
-        // Reset logging
-        set_module_after(std::move(old_settings));
-        // Update execution time
-        auto end = std::chrono::steady_clock::now();
-        module_execution_time_[module.get()] += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    // Subscriptions are complete, compile the message dispatch table for the event loop
+    messenger_->freeze();
 
-        // Book per-module performance plots
-        if(global_config.get<bool>("performance_plots")) {
-            const auto& module_identifier = module->get_identifier();
-            const auto& identifier = module_identifier.getIdentifier();
-            const auto& name = (identifier.empty() ? module->get_configuration().getName() : identifier);
-            auto title = module->get_configuration().getName() + " event processing time " +
-                         (!identifier.empty() ? "for " + identifier : "") + ";time [s];# events";
-            module_event_time_.emplace(module.get(), CreateHistogram<TH1D>(name.c_str(), title.c_str(), 1000, 0, 1));
-        }
-    }
-    LOG_PROGRESS(STATUS, "INIT_LOOP") << "Initialized " << modules_.size() << " module instantiations";
     auto end_time = std::chrono::steady_clock::now();
     initialize_time_ =
         static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time).count());
+    initialize_memory_ = peak_memory_usage();
 }
 
 /**
- * Initializes the thread pool and executes each event in parallel.
+ * The instantiations are distributed dynamically over up to the number of workers, including the calling thread. After the
+ * first exception, the remaining instantiations are skipped and the exception is rethrown once all threads finished.
  */
-void ModuleManager::run(RandomNumberGenerator& seeder) {
-    using namespace std::chrono_literals;
+void ModuleManager::run_concurrently(const std::vector<std::shared_ptr<Module>>& batch,
+                                     const std::function<void(const std::shared_ptr<Module>&)>& function) {
+    std::atomic<size_t> next_module{0};
+    std::mutex exception_mutex;
+    std::exception_ptr exception{nullptr};
+    auto run_batch = [&, log_level = Log::getReportingLevel(), log_format = Log::getFormat()]() {
+        Log::setReportingLevel(log_level);
+        Log::setFormat(log_format);
+        for(size_t n = next_module++; n < batch.size(); n = next_module++) {
+            try {
+                function(batch[n]);
+            } catch(...) {
+                // Keep the first exception and skip the remaining instantiations
+                std::lock_guard<std::mutex> lock{exception_mutex};
+                if(exception == nullptr) {
+                    exception = std::current_exception();
+                }
+                next_module = batch.size();
+            }
+        }
+    };
 
+    std::vector<std::thread> threads;
+    for(size_t n = 1; n < std::min<size_t>(batch.size(), number_of_threads_); ++n) {
+        threads.emplace_back(run_batch);
+    }
+    run_batch();
+    for(auto& thread : threads) {
+        thread.join();
+    }
+    if(exception != nullptr) {
+        std::rethrow_exception(exception);
+    }
+}
+
+void ModuleManager::prepare_module(const std::shared_ptr<Module>& module) {
     Configuration& global_config = conf_manager_->getGlobalConfiguration();
-    auto plot = global_config.get<bool>("performance_plots");
 
-    // Creates the thread pool
-    LOG(TRACE) << "Initializing thread pool with " << number_of_threads_ << " threads";
-    auto initialize_function =
-        [log_level = Log::getReportingLevel(), log_format = Log::getFormat(), modules_list = modules_]() {
+    // Pass the config manager to this instance
+    module->set_config_manager(conf_manager_);
+
+    // Create main ROOT directory for this module class if it does not exists yet
+    LOG(TRACE) << "Creating and accessing ROOT directory";
+    std::string module_name = module->get_configuration().getName();
+    auto* directory = modules_file_->GetDirectory(module_name.c_str());
+    if(directory == nullptr) {
+        directory = modules_file_->mkdir(module_name.c_str());
+        if(directory == nullptr) {
+            throw RuntimeError("Cannot create or access overall ROOT directory for module " + module_name);
+        }
+    }
+    directory->cd();
+
+    // Create local directory for this instance
+    TDirectory* local_directory = nullptr;
+    if(module->get_identifier().getIdentifier().empty()) {
+        local_directory = directory;
+    } else {
+        local_directory = directory->mkdir(module->get_identifier().getIdentifier().c_str());
+        if(local_directory == nullptr) {
+            throw RuntimeError("Cannot create or access local ROOT directory for module " + module->getUniqueName());
+        }
+    }
+
+    // Change to the directory and save it in the module
+    local_directory->cd();
+    module->set_ROOT_directory(local_directory);
+
+    // Prepare the execution time and the distribution of per-event execution times
+    module_execution_time_[module.get()];
+    module_event_time_distribution_[module.get()];
+    module_perf_counters_[module.get()];
+
+    // Book per-module performance plots
+    if(global_config.get<bool>("performance_plots")) {
+        const auto& module_identifier = module->get_identifier();
+        const auto& identifier = module_identifier.getIdentifier();
+        const auto& name = (identifier.empty() ? module->get_configuration().getName() : identifier);
+        auto title = module->get_configuration().getName() + " event processing time " +
+                     (!identifier.empty() ? "for " + identifier : "") + ";time [s];# events";
+        module_event_time_.emplace(module.get(), CreateHistogram<TH1D>(name.c_str(), title.c_str(), 1000, 0, 1));
+    }
+}
+
+void ModuleManager::initialize_module(const std::shared_ptr<Module>& module) {
+    // Get current time
+    auto start = std::chrono::steady_clock::now();
+    // Set module specific settings
+    auto old_settings = set_module_before(module->get_identifier().getUniqueName(), module->get_configuration(), "I:");
+    // Change to our ROOT directory
+    module->getROOTDirectory()->cd();
+    // Buffer the entries of the histograms created by the module if configured
+    auto sampling = plot_sampling_.find(module.get());
+    HistogramFilling::setBufferSize(sampling != plot_sampling_.end() ? sampling->second.buffer_size : 0);
+    // Init module
+    module->initialize();
+    HistogramFilling::setBufferSize(0);
+    // Reset logging
+    set_module_after(std::move(old_settings));
+    // Update execution time
+    auto end = std::chrono::steady_clock::now();
+    module_execution_time_[module.get()] += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+}
+
+void ModuleManager::read_event_filter(Module* module, GeometryManager* geo_manager) {
+    auto& config = module->get_configuration();
+    if(!config.has("filter_objects")) {
+        return;
+    }
+
+    EventFilter filter;
+    filter.object_type = config.get<std::string>("filter_objects");
+    for(const auto& detector : config.getArray<std::string>("filter_detectors", std::vector<std::string>())) {
+        if(!geo_manager->hasDetector(detector)) {
+            throw InvalidValueError(config, "filter_detectors", "detector " + detector + " is not defined");
+        }
+        filter.detectors.insert(detector);
+    }
+    filter.min_objects = config.get<size_t>("filter_min_objects", 1);
+    filter.max_objects = config.get<size_t>("filter_max_objects", std::numeric_limits<size_t>::max());
+    if(filter.max_objects < filter.min_objects) {
+        throw InvalidCombinationError(config,
+                                      {"filter_min_objects", "filter_max_objects"},
+                                      "maximum number of objects is smaller than the minimum number of objects");
+    }
+
+    LOG(DEBUG) << "Filtering events with " << filter.object_type << " objects before running "
+               << module->get_identifier().getUniqueName();
+    event_filters_[module] = std::move(filter);
+}
+
+bool ModuleManager::passes_filter(const EventFilter& filter, Event* event) {
+    auto counts = event->get_local_messenger()->countObjects(filter.object_type);
+    auto in_limits = [&](size_t count) { return count >= filter.min_objects && count <= filter.max_objects; };
+
+    if(filter.detectors.empty()) {
+        size_t total = 0;
+        for(const auto& count : counts) {
+            total += count.second;
+        }
+        return in_limits(total);
+    }
+
+    return std::any_of(filter.detectors.begin(), filter.detectors.end(), [&](const std::string& detector) {
+        auto count = counts.find(detector);
+        return in_limits(count == counts.end() ? 0 : count->second);
+    });
+}
+
+void ModuleManager::read_plot_sampling(Module* module) {
+    auto& config = module->get_configuration();
+    auto& global_config = conf_manager_->getGlobalConfiguration();
+
+    PlotSampling sampling;
+    sampling.interval =
+        config.get<uint64_t>("output_plots_sampling", global_config.get<uint64_t>("output_plots_sampling", 1));
+    if(sampling.interval == 0) {
+        throw InvalidValueError(config, "output_plots_sampling", "sampling interval of the plots should be at least one");
+    }
+    sampling.fraction = config.get<double>("output_plots_fraction", global_config.get<double>("output_plots_fraction", 1));
+    if(sampling.fraction <= 0 || sampling.fraction > 1) {
+        throw InvalidValueError(config, "output_plots_fraction", "fraction of sampled events should be in (0, 1]");
+    }
+    if(sampling.interval > 1 && sampling.fraction < 1) {
+        throw InvalidCombinationError(config,
+                                      {"output_plots_sampling", "output_plots_fraction"},
+                                      "plots can either be sampled at a fixed interval or for a random fraction of events");
+    }
+    sampling.buffer_size = config.get<int>("output_plots_buffer", global_config.get<int>("output_plots_buffer", 0));
+    if(sampling.buffer_size < 0) {
+        throw InvalidValueError(config, "output_plots_buffer", "buffer size of the plots should not be negative");
+    }
+
+    if(sampling.interval == 1 && sampling.fraction == 1 && sampling.buffer_size == 0) {
+        return;
+    }
+    LOG(DEBUG) << "Sampling plots of " << module->get_identifier().getUniqueName() << " with interval " << sampling.interval
+               << ", fraction " << sampling.fraction << " and buffer size " << sampling.buffer_size;
+    plot_sampling_[module] = sampling;
+}
+
+/**
+ * The random fraction of events is selected by the event seed, such that the selection is reproducible for a given seed
+ * and identical for all module instantiations sampling the same fraction.
+ */
+bool ModuleManager::samples_plots(const PlotSampling& sampling, const Event* event) {
+    if(sampling.interval > 1) {
+        return (event->number - 1) % sampling.interval == 0;
+    }
+    if(sampling.fraction < 1) {
+        // Mix the bits of the seed to obtain a uniform number in [0, 1)
+        auto value = event->getSeed() + 0x9e3779b97f4a7c15ull;
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+        value ^= (value >> 31);
+        return static_cast<double>(value >> 11) * 0x1.0p-53 < sampling.fraction;
+    }
+    return true;
+}
+
+/**
+ * Without any module producing output, such as in test configurations checking the log of a module, all final modules of
+ * the chain would be reported. Unused modules are therefore only searched for in this case if they should be skipped.
+ */
+void ModuleManager::find_unused_modules(bool skip) {
+    if(!skip && std::none_of(modules_.begin(), modules_.end(), [](const auto& module) {
+           return module->has_side_effects();
+       })) {
+        LOG(DEBUG) << "No module instantiation has side effects, not searching for unused modules";
+        return;
+    }
+
+    std::set<std::string> unused_names;
+    std::vector<std::shared_ptr<Module>> unused;
+    bool found = true;
+    while(found) {
+        found = false;
+        for(auto& module : modules_) {
+            if(module->delegates_.empty() || module->has_side_effects() ||
+               unused_names.find(module->getUniqueName()) != unused_names.end() ||
+               messenger_->has_consumer(module.get(), unused_names)) {
+                continue;
+            }
+            unused_names.insert(module->getUniqueName());
+            unused.push_back(module);
+            found = true;
+        }
+    }
+
+    for(auto& module : unused) {
+        if(!skip) {
+            LOG(WARNING) << "Module instantiation " << module->get_identifier().getUniqueName()
+                         << " has no side effects and none of its messages are received, consider removing it";
+            continue;
+        }
+        LOG(WARNING) << "Skipping module instantiation " << module->get_identifier().getUniqueName()
+                     << ", it has no side effects and none of its messages are received";
+
+        // Stop dispatching messages to the module
+        for(auto& delegate : module->delegates_) {
+            delegate.first->remove_delegate(delegate.second);
+        }
+        module->delegates_.clear();
+        unused_modules_.insert(module.get());
+    }
+}
+
+/**
+ * The first stage begins with the first module of the chain, every further stage with the first module matching the name or
+ * unique name given in worker_stages after the beginning of the previous stage. The last stage is executed by the main pool
+ * of workers, which also keeps track of the completed events.
+ */
+void ModuleManager::configure_worker_stages(Configuration& global_config) {
+    auto stage_names = global_config.getArray<std::string>("worker_stages");
+    auto stage_workers = global_config.getArray<unsigned int>("stage_workers");
+    if(stage_workers.size() != stage_names.size() + 1) {
+        throw InvalidCombinationError(global_config,
+                                      {"worker_stages", "stage_workers"},
+                                      "number of workers has to be given for the first stage and every worker stage");
+    }
+    if(std::find(stage_workers.begin(), stage_workers.end(), 0u) != stage_workers.end()) {
+        throw InvalidValueError(
+            global_config, "stage_workers", "number of workers of every stage should be larger than zero");
+    }
+    if(global_config.get<bool>("parallel_detector_chains", false)) {
+        throw InvalidCombinationError(global_config,
+                                      {"worker_stages", "parallel_detector_chains"},
+                                      "detector chains cannot be executed with worker stages");
+    }
+
+    std::vector<ModuleList::iterator> stage_begins{modules_.begin()};
+    for(const auto& name : stage_names) {
+        auto search_begin = (stage_begins.back() == modules_.end() ? modules_.end() : std::next(stage_begins.back()));
+        auto stage_begin = std::find_if(search_begin, modules_.end(), [&name](const auto& module) {
+            return module->get_identifier().getName() == name || module->get_identifier().getUniqueName() == name;
+        });
+        if(stage_begin == modules_.end()) {
+            throw InvalidValueError(
+                global_config, "worker_stages", "no module '" + name + "' found after the beginning of the previous stage");
+        }
+        stage_begins.push_back(stage_begin);
+    }
+
+    for(size_t i = 0; i + 1 < stage_begins.size(); ++i) {
+        worker_stages_.push_back({stage_begins[i], stage_workers[i], nullptr});
+    }
+    main_stage_begin_ = stage_begins.back();
+    main_stage_workers_ = stage_workers.back();
+
+    stage_queue_per_worker_ = global_config.get<size_t>("stage_queue_per_worker", 4);
+    if(stage_queue_per_worker_ == 0) {
+        throw InvalidValueError(global_config, "stage_queue_per_worker", "queue per worker should be larger than zero");
+    }
+
+    // The total number of workers is given by the stages
+    auto total_workers = std::accumulate(stage_workers.begin(), stage_workers.end(), 0u);
+    if(global_config.has("workers") && number_of_threads_ != total_workers) {
+        LOG(WARNING) << "Ignoring number of workers, using the total of " << total_workers << " workers of all stages";
+    }
+    number_of_threads_ = total_workers;
+
+    for(size_t i = 0; i < stage_begins.size(); ++i) {
+        LOG(STATUS) << "Executing stage " << i << " of the module chain starting at "
+                    << (*stage_begins[i])->get_identifier().getUniqueName() << " on " << stage_workers[i] << " workers";
+    }
+}
+
+void ModuleManager::wait_for_workers() {
+    for(auto& stage : worker_stages_) {
+        stage.pool->wait();
+        stage.pool->checkException();
+    }
+    thread_pool_->wait();
+}
+
+void ModuleManager::mark_complete(uint64_t n) {
+    for(auto& stage : worker_stages_) {
+        stage.pool->markComplete(n);
+    }
+    thread_pool_->markComplete(n);
+}
+
+void ModuleManager::setWorkers(unsigned int workers) {
+    if(!worker_stages_.empty()) {
+        throw RuntimeError("Number of workers cannot be changed if the module chain is executed in worker stages");
+    }
+    if(workers < 1 || workers > max_threads_) {
+        throw RuntimeError("Number of workers has to be between one and the " + std::to_string(max_threads_) +
+                           " workers available since initialization");
+    }
+    number_of_threads_ = workers;
+    max_buffer_size_ = std::max(buffer_per_worker_ * number_of_threads_,
+                                scheduler_ == ThreadPool::Scheduler::WORK_STEALING ? 2 * number_of_threads_ : size_t(1));
+}
+
+/**
+ * Initializes the thread pool and executes each event in parallel.
+ */
+void ModuleManager::run(RandomNumberGenerator& seeder) {
+    using namespace std::chrono_literals;
+
+    Configuration& global_config = conf_manager_->getGlobalConfiguration();
+    auto plot = global_config.get<bool>("performance_plots");
+
+    // Creates the thread pool
+    LOG(TRACE) << "Initializing thread pool with " << number_of_threads_ << " threads";
+    auto make_initialize_function = [log_level = Log::getReportingLevel(),
+                                     log_format = Log::getFormat(),
+                                     worker_cpus = worker_cpus_](ModuleList modules_list) {
+        return [log_level, log_format, worker_cpus, modules_list = std::move(modules_list)]() {
             // Initialize the threads to the same log level and format as the master setting
             Log::setReportingLevel(log_level);
             Log::setFormat(log_format);
 
+            // Pin the thread to its processor and select the field replicas of its NUMA node
+            if(!worker_cpus.empty()) {
+                auto [node, cpu] = worker_cpus[(ThreadPool::threadNum() - 1) % worker_cpus.size()];
+                if(pin_current_thread(cpu)) {
+                    current_numa_node() = node;
+                } else {
+                    LOG(WARNING) << "Could not pin thread " << ThreadPool::threadNum() << " to processor " << cpu;
+                }
+            }
+
             // Call per-thread initialization of each module
             for(const auto& module : modules_list) {
                 // Set module specific log settings
@@ -711,33 +1456,144 @@ void ModuleManager::run(RandomNumberGenerator& seeder) {
                 ModuleManager::set_module_after(std::move(old_settings));
             }
         };
+    };
 
     // Finalize modules for each thread
-    auto finalize_function = [modules_list = modules_]() {
-        for(const auto& module : modules_list) {
-            // Set module specific log settings
-            auto old_settings = ModuleManager::set_module_before(
-                module->get_identifier().getUniqueName(), module->get_configuration(), "T:");
+    auto make_finalize_function = [](ModuleList modules_list) {
+        return [modules_list = std::move(modules_list)]() {
+            for(const auto& module : modules_list) {
+                // Set module specific log settings
+                auto old_settings = ModuleManager::set_module_before(
+                    module->get_identifier().getUniqueName(), module->get_configuration(), "T:");
 
-            LOG(TRACE) << "Finalizing thread " << std::this_thread::get_id();
-            module->finalizeThread();
+                LOG(TRACE) << "Finalizing thread " << std::this_thread::get_id();
+                module->finalizeThread();
 
-            // Reset logging
-            ModuleManager::set_module_after(std::move(old_settings));
-        }
+                // Reset logging
+                ModuleManager::set_module_after(std::move(old_settings));
+            }
+        };
     };
 
+    // Copy the field grids on a thread pinned to each NUMA node, such that the pages of the copies are local to the node
+    if(field_replica_nodes_ > 0) {
+        auto detectors = geo_manager_->getDetectors();
+        LOG(STATUS) << "Replicating field grids of " << detectors.size() << " detectors on " << field_replica_nodes_
+                    << " NUMA nodes";
+        std::set<unsigned int> replicated_nodes;
+        for(const auto& [node, cpu] : worker_cpus_) {
+            if(!replicated_nodes.insert(node).second) {
+                continue;
+            }
+            std::exception_ptr exception_ptr{nullptr};
+            std::thread replica_thread([node = node, cpu = cpu, &detectors, &exception_ptr]() {
+                try {
+                    pin_current_thread(cpu);
+                    FieldGridCopies copies;
+                    for(const auto& detector : detectors) {
+                        detector->replicateFields(node, copies);
+                    }
+                } catch(...) {
+                    exception_ptr = std::current_exception();
+                }
+            });
+            replica_thread.join();
+            if(exception_ptr) {
+                std::rethrow_exception(exception_ptr);
+            }
+        }
+    }
+
+    // Reuse the thread numbers of the pool of a previous event loop
+    ThreadPool::releaseThreadNumbers();
+
+    // Create a pool of workers for every leading stage of the module chain, handing off events to the next stage
+    stage_entries_.clear();
+    for(size_t i = 0; i < worker_stages_.size(); ++i) {
+        auto& stage = worker_stages_[i];
+        auto stage_end = (i + 1 < worker_stages_.size() ? worker_stages_[i + 1].begin : main_stage_begin_);
+        ModuleList stage_modules(stage.begin, stage_end);
+        // Push 128 events for each worker of the first stage, limit the events waiting in the queues of later stages
+        auto queue_size = stage.workers * (i == 0 ? 128 : stage_queue_per_worker_);
+        stage.pool = std::make_unique<ThreadPool>(stage.workers,
+                                                  queue_size,
+                                                  max_buffer_size_,
+                                                  make_initialize_function(stage_modules),
+                                                  make_finalize_function(stage_modules),
+                                                  scheduler_);
+        stage_entries_.emplace(stage.begin->get(), stage.pool.get());
+    }
+
     // Push 128 events for each worker to maintain enough work
-    auto max_queue_size = number_of_threads_ * 128;
-    thread_pool_ = std::make_unique<ThreadPool>(
-        number_of_threads_, max_queue_size, max_buffer_size_, initialize_function, finalize_function);
+    ModuleList main_modules(main_stage_begin_, modules_.end());
+    auto main_workers = (worker_stages_.empty() ? number_of_threads_ : main_stage_workers_);
+    auto max_queue_size = main_workers * (worker_stages_.empty() ? 128 : stage_queue_per_worker_);
+    thread_pool_ = std::make_unique<ThreadPool>(main_workers,
+                                                max_queue_size,
+                                                max_buffer_size_,
+                                                make_initialize_function(main_modules),
+                                                make_finalize_function(main_modules),
+                                                scheduler_);
+    if(!worker_stages_.empty()) {
+        stage_entries_.emplace(main_stage_begin_->get(), thread_pool_.get());
+    }
+    // New events are submitted to the pool of the first stage
+    auto* first_pool = (worker_stages_.empty() ? thread_pool_.get() : worker_stages_.front().pool.get());
+
+    // Start the writer thread, executing events handed off by the workers in their sequence
+    if(use_writer_stage_) {
+        ModuleList writer_modules(writer_begin_, modules_.end());
+        writer_stage_ = std::make_unique<WriterStage>([this]() { return thread_pool_->minimumUncompleted(); },
+                                                      make_initialize_function(writer_modules),
+                                                      make_finalize_function(writer_modules));
+    }
+
+    // Record a trace of the event loop if requested
+    if(global_config.has("trace_file")) {
+        auto trace_path = std::filesystem::path(gSystem->pwd()) / global_config.get<std::string>("trace_file");
+        trace_path.replace_extension("json");
+        LOG(STATUS) << "Recording trace of the event loop to " << trace_path;
+        event_trace_ = std::make_unique<EventTrace>(trace_path);
+    }
+
+    // Degrade or abort events exceeding their processing time budget if requested
+    event_time_budget_ = static_cast<int64_t>(global_config.get<double>("event_time_budget", 0));
+    if(event_time_budget_ < 0) {
+        throw InvalidValueError(global_config, "event_time_budget", "time budget cannot be negative");
+    }
+    budget_action_ = global_config.get<BudgetAction>("event_budget_action", BudgetAction::DEGRADE);
+    budget_events_.clear();
+
+    // Export the metrics of the modules periodically during the run if requested
+    if(global_config.has("metrics_file")) {
+        metrics_path_ = std::filesystem::path(gSystem->pwd()) / global_config.get<std::string>("metrics_file");
+        metrics_path_.replace_extension(metrics_prometheus_ ? "prom" : "json");
+        LOG(STATUS) << "Exporting metrics of the modules to " << metrics_path_;
+
+        auto interval = std::chrono::nanoseconds(static_cast<int64_t>(global_config.get<double>("metrics_interval")));
+        metrics_stop_ = false;
+        metrics_thread_ = std::thread([this, interval]() {
+            std::unique_lock<std::mutex> lock(metrics_mutex_);
+            while(!metrics_cv_.wait_for(lock, interval, [this]() { return metrics_stop_; })) {
+                try {
+                    write_metrics();
+                } catch(const std::exception& e) {
+                    LOG(WARNING) << e.what();
+                }
+            }
+        });
+    }
 
     // Record the run stage total time
     auto start_time = std::chrono::steady_clock::now();
+    sequence_wait_time_ = 0;
+    buffer_fill_sum_ = 0;
+    buffer_fill_max_ = 0;
 
     // Push all events to the thread pool
     std::atomic<uint64_t> finished_events{0};
     std::atomic<uint64_t> aborted_events{0};
+    std::atomic<uint64_t> filtered_events{0};
     global_config.setDefault<uint64_t>("number_of_events", 1u);
     auto number_of_events = global_config.get<uint64_t>("number_of_events");
 
@@ -748,50 +1604,176 @@ void ModuleManager::run(RandomNumberGenerator& seeder) {
     // Mark the first N events as completed for the thread pool. Since events start at one, always mark zero identifier as
     // completed
     for(size_t n = 0; n <= skip_events; n++) {
-        thread_pool_->markComplete(n);
+        mark_complete(n);
+    }
+
+    // Write checkpoints to resume interrupted runs if requested
+    auto checkpoint_interval = global_config.get<uint64_t>("checkpoint_interval", 0);
+    auto last_event = number_of_events + skip_events;
+
+    // Report configuration keys accessed by modules during the event loop if requested
+    auto report_config_access = global_config.get<bool>("report_config_access", false);
+
+    // Execute the module chains of different detectors concurrently within each event if requested
+    if(global_config.get<bool>("parallel_detector_chains", false)) {
+        find_detector_chains();
+    }
+
+    // Process blocks of consecutive events in a single task to reduce the overhead for lightweight events
+    auto events_per_task = global_config.get<uint64_t>("events_per_task", 1);
+    if(events_per_task == 0) {
+        throw InvalidValueError(global_config, "events_per_task", "number of events per task should be larger than zero");
+    }
+    if(events_per_task > 1) {
+        LOG(STATUS) << "Processing " << events_per_task << " consecutive events per task";
+    }
+    std::vector<std::function<void()>> batch;
+    batch.reserve(std::min(events_per_task, number_of_events));
+
+    // Start the events with the largest estimated cost first, drawing their seeds in sequence to keep them reproducible
+    std::vector<uint64_t> event_order;
+    std::vector<uint64_t> event_seeds;
+    if(global_config.get<EventOrder>("event_order", EventOrder::SEQUENTIAL) == EventOrder::LARGEST_FIRST) {
+        if(checkpoint_interval > 0) {
+            throw InvalidCombinationError(global_config,
+                                          {"event_order", "checkpoint_interval"},
+                                          "checkpoints require the events to be processed in sequence");
+        }
+        event_order = order_events(1 + skip_events, last_event);
+        if(!event_order.empty()) {
+            event_seeds.reserve(number_of_events);
+            for(uint64_t n = 0; n < number_of_events; n++) {
+                event_seeds.push_back(seeder());
+            }
+        }
     }
 
     LOG(STATUS) << "Starting event loop";
-    for(uint64_t i = 1 + skip_events; i <= number_of_events + skip_events; i++) {
+    for(uint64_t n = 0; n < number_of_events; n++) {
+        auto i = (event_order.empty() ? n + 1 + skip_events : event_order[n]);
+
         // Check if run was aborted and stop pushing extra events to the threadpool
         if(terminate_) {
             LOG(INFO) << "Interrupting event loop after " << finished_events << " events because of request to terminate";
-            thread_pool_->destroy();
+            // Finish all submitted events to checkpoint a complete sequence of events
+            if(checkpoint_interval == 0) {
+                for(auto& stage : worker_stages_) {
+                    stage.pool->destroy();
+                }
+                thread_pool_->destroy();
+            }
             break;
         }
 
+        // Write a checkpoint after every interval of events
+        if(checkpoint_interval > 0 && i > 1 + skip_events && (i - 1 - skip_events) % checkpoint_interval == 0) {
+            write_checkpoint(global_config, i - 1, last_event);
+        }
+
         // Get a new seed for the new event
-        uint64_t seed = seeder();
+        uint64_t seed = (event_seeds.empty() ? seeder() : event_seeds[i - 1 - skip_events]);
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wstrict-overflow"
         auto event_function_with_module =
-            [this, plot, number_of_events, event_num = i, event_seed = seed, &finished_events, &aborted_events](
+            [this,
+             plot,
+             number_of_events,
+             report_config_access,
+             event_num = i,
+             event_seed = seed,
+             first_pool,
+             &finished_events,
+             &aborted_events,
+             &filtered_events](
                 std::shared_ptr<Event> event,
                 ModuleList::iterator module_iter,
                 int64_t event_time,
+                int64_t sequence_wait_start,
                 auto&& self_func) mutable -> void {
             // The RNG to be used by all events running on this thread
             static thread_local RandomNumberGenerator random_engine;
 
             // Create the event data
             if(event == nullptr) {
-                event = std::make_shared<Event>(*this->messenger_, event_num, event_seed);
+                event = acquire_event(event_num, event_seed);
+                event->thread_pool_ = first_pool;
+                event->enable_memory_arena(event_arena_size_);
                 event->set_and_seed_random_engine(&random_engine);
+                event->start_budget(event_time_budget_);
                 LOG(INFO) << "Starting event " << event_num << " with seed " << event_seed;
             } else {
                 LOG(TRACE) << "Continue with earlier event, restoring random seed";
                 event->set_and_seed_random_engine(&random_engine);
                 event->restore_random_engine_state();
+                event->resume_budget();
+                if(event->buffered_memory_ > 0) {
+                    buffered_memory_ -= event->buffered_memory_;
+                    event->buffered_memory_ = 0;
+                    buffered_memory_cv_.notify_all();
+                }
+                if(event_trace_) {
+                    event_trace_->addMarker("resume",
+                                            (*module_iter)->get_identifier().getUniqueName(),
+                                            event->number,
+                                            std::chrono::steady_clock::now());
+                }
             }
 
             while(module_iter != modules_.end()) {
+                // Hand off the event to the pool of workers executing the next stage of the module chain
+                auto stage_iter = stage_entries_.find(module_iter->get());
+                if(stage_iter != stage_entries_.end() && stage_iter->second != event->thread_pool_) {
+                    LOG(TRACE) << "Handing off event " << event->number << " to next worker stage";
+                    event->store_random_engine_state();
+                    event->pause_budget();
+                    event->thread_pool_ = stage_iter->second;
+                    [[maybe_unused]] auto submitted = stage_iter->second->submitDetached(
+                        std::bind(self_func, event, module_iter, event_time, int64_t(0), self_func));
+                    assert(submitted || !stage_iter->second->valid());
+                    return;
+                }
+
+                // Hand off the event to the writer thread and return to processing other events
+                if(writer_stage_ && module_iter == writer_begin_ && !writer_stage_->isStageThread()) {
+                    LOG(TRACE) << "Handing off event " << event->number << " to writer thread";
+                    event->store_random_engine_state();
+                    event->pause_budget();
+                    writer_stage_->push(event->number,
+                                        std::bind(self_func, event, module_iter, event_time, int64_t(0), self_func));
+                    return;
+                }
+
                 auto module = *module_iter;
 
+                // Execute a block of detector modules as concurrent chains per detector
+                auto chains_iter = detector_chains_.find(module.get());
+                if(chains_iter != detector_chains_.end()) {
+                    if(run_detector_chains(event.get(), chains_iter->second, plot, report_config_access, event_time)) {
+                        aborted_events++;
+                        break;
+                    }
+                    module_iter = chains_iter->second.end;
+                    continue;
+                }
+
                 LOG_PROGRESS(TRACE, "EVENT_LOOP")
                     << "Running event " << event->number << " [" << module->get_identifier().getUniqueName() << "]";
 
-                // Check if the module is satisfied to run
+                // End the processing of the event if it does not pass the filter of the module
+                auto filter_iter = event_filters_.find(module.get());
+                if(filter_iter != event_filters_.end() && !passes_filter(filter_iter->second, event.get())) {
+                    LOG(DEBUG) << "Event " << event->number << " does not pass the event filter of "
+                               << module->get_identifier().getUniqueName() << ", skipping remaining modules";
+                    filtered_events++;
+                    break;
+                }
+
+                // Check if the module is unused or not satisfied to run
+                if(unused_modules_.find(module.get()) != unused_modules_.end()) {
+                    ++module_iter;
+                    continue;
+                }
                 if(!module->check_delegates(this->messenger_, event.get())) {
                     LOG(TRACE) << "Not all required messages are received for " << module->get_identifier().getUniqueName()
                                << ", skipping module!";
@@ -799,8 +1781,12 @@ void ModuleManager::run(RandomNumberGenerator& seeder) {
                     continue;
                 }
 
-                // Get current time
+                // Get current time, starting at the first attempt if the event had to wait for its turn
                 auto start = std::chrono::steady_clock::now();
+                auto wall_start = std::chrono::duration_cast<std::chrono::nanoseconds>(start.time_since_epoch()).count();
+                if(sequence_wait_start != 0) {
+                    wall_start = sequence_wait_start;
+                }
 
                 // Set module specific logging settings
                 auto old_settings = ModuleManager::set_module_before(
@@ -809,11 +1795,22 @@ void ModuleManager::run(RandomNumberGenerator& seeder) {
                 // Run module
                 bool stop = false;
                 bool abort = false;
+                PerfCounterValues counters_start{};
+                bool counted = false;
+                Configuration::setAccessReporting(report_config_access);
                 try {
                     if(module->require_sequence() && event_num != thread_pool_->minimumUncompleted()) {
                         stop = true;
                     } else {
+                        auto sampling = plot_sampling_.find(module.get());
+                        HistogramFilling::setSkipped(sampling != plot_sampling_.end() &&
+                                                     !samples_plots(sampling->second, event.get()));
+                        if(module_random_streams_) {
+                            event->set_module_random_stream(module_random_stream(module.get()));
+                        }
+                        counted = perf_counters_ && read_perf_counters(counters_start);
                         module->run(event.get());
+                        check_time_budget(event.get(), module.get());
                     }
                 } catch(const MissingDependenciesException& e) {
                     stop = true;
@@ -825,6 +1822,12 @@ void ModuleManager::run(RandomNumberGenerator& seeder) {
                     LOG(WARNING) << "Request to terminate:" << std::endl << e.what();
                     this->terminate_ = true;
                 }
+                event->set_module_random_stream(0);
+                Configuration::setAccessReporting(false);
+                HistogramFilling::setSkipped(false);
+                if(counted) {
+                    add_perf_counters(module.get(), counters_start);
+                }
 
                 // Reset logging
                 ModuleManager::set_module_after(std::move(old_settings));
@@ -834,6 +1837,20 @@ void ModuleManager::run(RandomNumberGenerator& seeder) {
                 auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
                 // Note: we do not need to lock a mutex because the std::map is not altered and its values are atomic.
                 this->module_execution_time_[module.get()] += duration;
+                if(!stop) {
+                    auto wall_end = std::chrono::duration_cast<std::chrono::nanoseconds>(end.time_since_epoch()).count();
+                    this->module_event_time_distribution_[module.get()].add(wall_end - wall_start);
+                    if(sequence_wait_start != 0) {
+                        this->sequence_wait_time_ +=
+                            std::chrono::duration_cast<std::chrono::nanoseconds>(start.time_since_epoch()).count() -
+                            sequence_wait_start;
+                    }
+                    sequence_wait_start = 0;
+                }
+
+                if(event_trace_ && !stop) {
+                    event_trace_->addSpan(module->get_identifier().getUniqueName(), event->number, start, end);
+                }
 
                 if(plot) {
                     std::lock_guard<std::mutex> stat_lock{event->stats_mutex_};
@@ -853,11 +1870,28 @@ void ModuleManager::run(RandomNumberGenerator& seeder) {
                                << " was interrupted because of missing dependencies, rescheduling...";
                     // Store state of PRNG engine:
                     event->store_random_engine_state();
+                    event->pause_budget();
+                    // Account for the memory held by the buffered event:
+                    if(max_buffer_memory_ > 0 || event_statistics_) {
+                        event->buffered_memory_ = event->getMemorySize();
+                        auto memory = (buffered_memory_ += event->buffered_memory_);
+                        auto peak = buffered_memory_peak_.load(std::memory_order_relaxed);
+                        while(memory > peak &&
+                              !buffered_memory_peak_.compare_exchange_weak(peak, memory, std::memory_order_relaxed)) {
+                        }
+                    }
                     // Reschedule the event:
-                    auto event_function = std::bind(self_func, event, module_iter, event_time, self_func);
-                    auto future = thread_pool_->submit(event->number, event_function, false);
-                    assert(future.valid() || !thread_pool_->valid());
-                    auto buffered_events = thread_pool_->bufferedQueueSize();
+                    auto event_function = std::bind(self_func, event, module_iter, event_time, wall_start, self_func);
+                    if(event_trace_) {
+                        event_trace_->addMarker("buffer",
+                                                module->get_identifier().getUniqueName(),
+                                                event->number,
+                                                std::chrono::steady_clock::now());
+                    }
+                    [[maybe_unused]] auto submitted =
+                        event->thread_pool_->submitDetached(event->number, std::move(event_function));
+                    assert(submitted || !event->thread_pool_->valid());
+                    auto buffered_events = event->thread_pool_->bufferedQueueSize();
                     LOG_PROGRESS(STATUS, "EVENT_LOOP") << "Buffered " << buffered_events << ", finished " << finished_events
                                                        << " of " << number_of_events << " events";
                     return;
@@ -867,11 +1901,24 @@ void ModuleManager::run(RandomNumberGenerator& seeder) {
             }
 #pragma GCC diagnostic pop
 
+            // Record the messages of the event before its data is released
+            if(event_statistics_) {
+                record_event_statistics(event.get());
+            }
+
             // All modules finished, mark as complete
-            thread_pool_->markComplete(event->number);
+            mark_complete(event->number);
+            if(writer_stage_) {
+                writer_stage_->notify();
+            }
             LOG(INFO) << "Finished event " << event_num << " with seed " << event_seed;
 
             auto buffered_events = thread_pool_->bufferedQueueSize();
+            this->buffer_fill_sum_.fetch_add(buffered_events, std::memory_order_relaxed);
+            auto fill_max = this->buffer_fill_max_.load(std::memory_order_relaxed);
+            while(buffered_events > fill_max &&
+                  !this->buffer_fill_max_.compare_exchange_weak(fill_max, buffered_events, std::memory_order_relaxed)) {
+            }
             if(plot) {
                 this->buffer_fill_level_->Fill(static_cast<double>(buffered_events));
                 event_time_->Fill(static_cast<double>(event_time) * 1e-9);
@@ -882,22 +1929,67 @@ void ModuleManager::run(RandomNumberGenerator& seeder) {
                                                << " of " << number_of_events << " events";
         };
 
-        auto event_function =
-            std::bind(event_function_with_module, nullptr, modules_.begin(), 0, event_function_with_module);
+        batch.emplace_back(
+            std::bind(event_function_with_module, nullptr, modules_.begin(), 0, 0, event_function_with_module));
 
-        auto future = thread_pool_->submit(event_function);
-        assert(future.valid() || !thread_pool_->valid());
-        thread_pool_->checkException();
+        // Collect the events of a task, submitting the last events before a checkpoint or the end of the run
+        if(batch.size() < events_per_task && n + 1 < number_of_events &&
+           (checkpoint_interval == 0 || (i - skip_events) % checkpoint_interval != 0)) {
+            continue;
+        }
+
+        // Hold back new events while the writer thread is falling behind
+        if(writer_stage_) {
+            while(writer_stage_->size() >= max_buffer_size_ && !terminate_ && thread_pool_->valid()) {
+                writer_stage_->waitForSpace(max_buffer_size_, std::chrono::milliseconds(100));
+                writer_stage_->checkException();
+                thread_pool_->checkException();
+            }
+        }
+
+        // Hold back new events while the buffered events exceed their memory budget
+        if(max_buffer_memory_ > 0 && buffered_memory_ > max_buffer_memory_) {
+            LOG(DEBUG) << "Buffered events hold " << buffered_memory_ << " bytes, delaying event " << i;
+            std::unique_lock<std::mutex> lock{buffered_memory_mutex_};
+            while(buffered_memory_ > max_buffer_memory_ && !terminate_ && thread_pool_->valid()) {
+                buffered_memory_cv_.wait_for(lock, std::chrono::milliseconds(100));
+                thread_pool_->checkException();
+            }
+        }
+
+        [[maybe_unused]] auto submitted = first_pool->submitDetached([events = std::move(batch)]() {
+            for(const auto& event_function : events) {
+                event_function();
+            }
+        });
+        batch.clear();
+        assert(submitted || !first_pool->valid());
+        first_pool->checkException();
+        if(writer_stage_) {
+            writer_stage_->checkException();
+        }
     }
 
     LOG(TRACE) << "All events have been initialized. Waiting for thread pool to finish...";
 
     // Wait for workers to finish
-    thread_pool_->wait();
+    wait_for_workers();
 
     // Check exception for last events
     thread_pool_->checkException();
 
+    // Execute the remaining events handed off to the writer thread
+    if(writer_stage_) {
+        LOG(TRACE) << "Waiting for writer thread to finish...";
+        writer_stage_->finish();
+        writer_stage_.reset();
+    }
+
+    // Checkpoint the final state, allowing to resume an interrupted run
+    if(checkpoint_interval > 0) {
+        write_checkpoint(global_config, thread_pool_->minimumUncompleted() - 1, last_event);
+    }
+
     LOG_PROGRESS(STATUS, "EVENT_LOOP") << "Finished run of " << finished_events << " events";
     global_config.set<uint64_t>("number_of_events", finished_events);
 
@@ -905,67 +1997,910 @@ void ModuleManager::run(RandomNumberGenerator& seeder) {
         LOG(WARNING) << "Aborted " << aborted_events << " events in this run";
     }
 
+    // Record the events exceeding their time budget for the accounting and a later full reprocessing
+    if(event_time_budget_ > 0) {
+        if(!budget_events_.empty()) {
+            LOG(WARNING) << (budget_action_ == BudgetAction::ABORT ? "Aborted " : "Degraded ") << budget_events_.size()
+                         << " events exceeding the time budget of " << Units::display(event_time_budget_, {"ms", "s"});
+        }
+        global_config.set<uint64_t>("over_budget_events", budget_events_.size());
+        if(global_config.has("over_budget_events_file")) {
+            auto path = std::filesystem::path(gSystem->pwd()) / global_config.get<std::string>("over_budget_events_file");
+            write_budget_events(path);
+            LOG(STATUS) << "Wrote list of events exceeding the time budget to " << path;
+        }
+    }
+
+    // Record the number of filtered events, which are part of the finished events, for the normalization of the output
+    if(!event_filters_.empty()) {
+        LOG(STATUS) << "Filtered " << filtered_events << " of " << finished_events << " events in this run";
+        global_config.set<uint64_t>("filtered_events", filtered_events);
+    }
+
     auto end_time = std::chrono::steady_clock::now();
-    run_time_ = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time).count());
+    auto loop_time =
+        static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time).count());
+    run_time_ += loop_time;
+
+    // Summarize the event loop for repeated runs with different numbers of workers
+    run_statistics_.events = finished_events;
+    run_statistics_.run_time = loop_time;
+    run_statistics_.sequence_wait_time = sequence_wait_time_;
+    run_statistics_.mean_buffer_fill =
+        static_cast<double>(buffer_fill_sum_) / static_cast<double>(std::max(uint64_t(1), run_statistics_.events));
+    run_statistics_.max_buffer_fill = buffer_fill_max_;
+    run_statistics_.buffer_size = max_buffer_size_;
 
     LOG(TRACE) << "Destroying thread pool";
+    for(auto& stage : worker_stages_) {
+        stage.pool.reset();
+    }
+    stage_entries_.clear();
     thread_pool_.reset();
-}
-
-static std::string nanoseconds_to_time(uint64_t nanoseconds) {
-    auto duration = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::nanoseconds(nanoseconds));
+    stop_metrics_export();
 
-    std::string time_str;
-    auto hours = std::chrono::duration_cast<std::chrono::hours>(duration);
-    duration -= hours;
-    if(hours.count() > 0) {
-        time_str += std::to_string(hours.count());
-        time_str += " hours ";
-    }
-    auto minutes = std::chrono::duration_cast<std::chrono::minutes>(duration);
-    duration -= minutes;
-    if(minutes.count() > 0) {
-        time_str += std::to_string(minutes.count());
-        time_str += " minutes ";
+    // Write the trace after all workers have stopped
+    if(event_trace_) {
+        event_trace_->write();
+        event_trace_.reset();
     }
-    time_str += std::to_string(duration.count());
-    time_str += " seconds";
-
-    return time_str;
 }
 
 /**
- * Sets the section header and logging settings before executing the  \ref Module::finalize() function. Reset the logging
- * after finalization. No method will be called after finalizing the module (except the destructor).
+ * The options are applied to a copy of the configuration of every instantiation, both by module name and by unique name.
+ * Instantiations writing output are always recreated to separate the output of the scan points, since their files and
+ * plots are only written when finalizing them.
  */
-void ModuleManager::finalize() {
+void ModuleManager::reconfigure(const std::vector<std::string>& options) {
     auto start_time = std::chrono::steady_clock::now();
-    LOG_PROGRESS(TRACE, "FINALIZE_LOOP") << "Finalizing module instantiations";
-    for(auto& module : modules_) {
-        LOG_PROGRESS(TRACE, "FINALIZE_LOOP") << "Finalizing " << module->get_identifier().getUniqueName();
+    Configuration& global_config = conf_manager_->getGlobalConfiguration();
 
-        // Get current time
-        auto start = std::chrono::steady_clock::now();
+    OptionParser option_parser;
+    for(const auto& option : options) {
+        option_parser.parseOption(option);
+    }
+    auto reinitialize = global_config.getArray<std::string>("scan_reinitialize", {});
+    std::set<std::string> reinitialize_names(reinitialize.begin(), reinitialize.end());
+
+    // Find the instantiations which have to be recreated with their new configuration
+    std::vector<std::pair<ModuleList::iterator, Configuration>> recreate;
+    for(auto module_iter = modules_.begin(); module_iter != modules_.end(); ++module_iter) {
+        auto& module = *module_iter;
+        const auto& config = module->get_configuration();
+        auto new_config = config;
+        option_parser.applyOptions(config.getName(), new_config);
+        option_parser.applyOptions(module->getUniqueName(), new_config);
+
+        if(new_config.getAll() != config.getAll() || module->output_files_ ||
+           config.get<bool>("output_plots", false) || reinitialize_names.count(config.getName()) != 0 ||
+           reinitialize_names.count(module->getUniqueName()) != 0) {
+            recreate.emplace_back(module_iter, std::move(new_config));
+        }
+    }
 
-        // Set module specific log settings
-        auto old_settings = set_module_before(module->get_identifier().getUniqueName(), module->get_configuration(), "F:");
-        // Change to our ROOT directory
-        module->getROOTDirectory()->cd();
-        // Finalize module
-        module->finalize();
-        // Remove the pointer to the ROOT directory after finalizing
-        module->set_ROOT_directory(nullptr);
-        // Remove the config manager
-        module->set_config_manager(nullptr);
-        set_module_after(std::move(old_settings));
-        // Update execution time
-        auto end = std::chrono::steady_clock::now();
-        module_execution_time_[module.get()] += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    // Finalize the previous instantiations, writing their output to the file of the previous point
+    if(number_of_threads_ > 1) {
+        ThreadedHistogramBase::mergeAll(number_of_threads_);
+    }
+    for(auto& [module_iter, config] : recreate) {
+        LOG(DEBUG) << "Finalizing " << (*module_iter)->getUniqueName() << " of previous scan point";
+        finalize_module(*module_iter);
     }
 
-    // Store performance plots
-    Configuration& global_config = conf_manager_->getGlobalConfiguration();
-    if(global_config.get<bool>("performance_plots")) {
+    // Replace the main ROOT file by the one of the next point
+    modules_file_->Close();
+    open_modules_file();
+
+    for(auto& [module_iter, config] : recreate) {
+        recreate_module(module_iter, config);
+    }
+
+    // Initialize the new instantiations, all instantiations store their objects in the new file
+    for(auto& module : modules_) {
+        prepare_module(module);
+    }
+    for(auto& [module_iter, config] : recreate) {
+        initialize_module(*module_iter);
+    }
+    LOG(STATUS) << "Recreated " << recreate.size() << " of " << modules_.size()
+                << " module instantiations for next scan point";
+
+    // Detect unused instantiations and compile the message dispatch table again for the new instantiations
+    find_unused_modules(global_config.get<bool>("skip_unused_modules", false));
+    messenger_->freeze();
+
+    auto end_time = std::chrono::steady_clock::now();
+    initialize_time_ +=
+        static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time).count());
+}
+
+void ModuleManager::recreate_module(ModuleList::iterator module_iter, const Configuration& config) {
+    auto identifier = (*module_iter)->get_identifier();
+    auto detector = (*module_iter)->getDetector();
+    auto detectors = (*module_iter)->getDetectors();
+
+    // Keep the accumulated execution time of the instantiation and drop the state of the previous one
+    auto* old_module = module_iter->get();
+    auto execution_time = module_execution_time_[old_module].load();
+    module_execution_time_.erase(old_module);
+    module_event_time_.erase(old_module);
+    module_event_time_distribution_.erase(old_module);
+    module_perf_counters_.erase(old_module);
+    event_filters_.erase(old_module);
+    plot_sampling_.erase(old_module);
+    unused_modules_.erase(old_module);
+
+    // Destruct the previous instantiation before its configuration is replaced
+    auto& instance_config = (*module_iter)->get_configuration();
+    module_iter->reset();
+    instance_config = config;
+
+    // Store the output of the new instantiation relative to the current directory
+    std::filesystem::path output_dir = gSystem->pwd();
+    instance_config.set<std::string>("_global_dir", output_dir);
+    auto path_mod_name = identifier.getUniqueName();
+    std::replace(path_mod_name.begin(), path_mod_name.end(), ':', detector == nullptr ? '_' : '/');
+    output_dir /= path_mod_name;
+
+    const auto& generator = module_generators_.at(config.getName());
+
+    LOG(DEBUG) << "Recreating instantiation " << identifier.getUniqueName();
+    auto start = std::chrono::steady_clock::now();
+    auto old_settings = set_module_before(identifier.getUniqueName(), instance_config, "C:");
+    Module* module = nullptr;
+    if(detector == nullptr) {
+        module = generator.unique(instance_config, messenger_, geo_manager_);
+    } else {
+        module = generator.detector(instance_config, messenger_, detector);
+    }
+    set_module_after(std::move(old_settings));
+    auto end = std::chrono::steady_clock::now();
+    module_execution_time_[module] =
+        execution_time + std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    module_event_time_distribution_[module];
+    module_perf_counters_[module];
+
+    module->get_configuration().set<std::string>("_output_dir", output_dir);
+    module->set_identifier(identifier);
+    module->set_detectors(std::move(detectors));
+    read_event_filter(module, geo_manager_);
+    read_plot_sampling(module);
+
+    // The event loop of the previous points decided on the multithreading of all instantiations
+    if(!(multithreading_flag_ && can_parallelize_)) {
+        module->set_multithreading(false);
+    } else if(!module->multithreadingEnabled()) {
+        throw RuntimeError("Module instance " + module->getUniqueName() +
+                           " prevents multithreading with the configuration of the scan point");
+    }
+
+    module_iter->reset(module);
+}
+
+/**
+ * The chains are built from the instantiations of every detector within a block, in the order of the module list. A block
+ * is only kept if it contains instantiations for at least two detectors, otherwise there is nothing to gain from running it
+ * concurrently.
+ */
+void ModuleManager::find_detector_chains() {
+    detector_chains_.clear();
+
+    // Modules with an event filter end the processing of the full event and are thus not part of a chain, neither are
+    // modules handling multiple detectors which depend on the chains of all their detectors
+    auto is_chain_module = [this](const std::shared_ptr<Module>& module) {
+        return module->getDetector() != nullptr && module->getDetectors().size() == 1 && !module->require_sequence() &&
+               event_filters_.find(module.get()) == event_filters_.end();
+    };
+
+    for(auto module_iter = modules_.begin(); module_iter != modules_.end();) {
+        if(!is_chain_module(*module_iter)) {
+            ++module_iter;
+            continue;
+        }
+
+        // Assign the consecutive detector modules to the chain of their detector, preserving their order
+        DetectorChains block;
+        std::map<std::string, size_t> chain_index;
+        auto block_end = module_iter;
+        while(block_end != modules_.end() && is_chain_module(*block_end)) {
+            auto chain = chain_index.emplace((*block_end)->getDetector()->getName(), block.chains.size());
+            if(chain.second) {
+                block.chains.emplace_back();
+            }
+            block.chains[chain.first->second].push_back(*block_end);
+            ++block_end;
+        }
+
+        if(block.chains.size() > 1) {
+            LOG(STATUS) << "Executing " << std::distance(module_iter, block_end) << " module instantiations starting from "
+                        << (*module_iter)->get_identifier().getUniqueName() << " as " << block.chains.size()
+                        << " concurrent detector chains";
+            block.end = block_end;
+            detector_chains_.emplace(module_iter->get(), std::move(block));
+        }
+        module_iter = block_end;
+    }
+
+    // The event memory arena is not thread-safe
+    if(!detector_chains_.empty() && event_arena_size_ > 0) {
+        LOG(WARNING) << "Per-event memory arenas cannot be shared by concurrent detector chains, disabling them";
+        event_arena_size_ = 0;
+    }
+}
+
+/**
+ * The identifier is the 64-bit FNV-1a hash of the unique name of the module instantiation, which does not depend on the
+ * platform nor on the other modules of the configuration
+ */
+uint64_t ModuleManager::module_random_stream(const Module* module) {
+    uint64_t hash = 14695981039346656037ULL;
+    auto name = module->get_identifier().getUniqueName();
+    for(auto character : name) {
+        hash = (hash ^ static_cast<unsigned char>(character)) * 1099511628211ULL;
+    }
+    // Zero selects the engine of the event
+    return (hash == 0 ? 1 : hash);
+}
+
+/**
+ * The random engine of every chain is seeded from the event random engine before the chains are started. The results are
+ * therefore reproducible and independent of the number of workers, but differ from a sequential execution of the modules.
+ */
+bool ModuleManager::run_detector_chains(
+    Event* event, const DetectorChains& block, bool plot, bool report_config_access, int64_t& event_time) {
+    std::vector<uint64_t> seeds;
+    seeds.reserve(block.chains.size());
+    for(size_t chain = 0; chain < block.chains.size(); ++chain) {
+        seeds.push_back(event->getRandomNumber());
+    }
+
+    std::atomic_bool abort{false};
+    auto execute_chain = [&](size_t chain) {
+        RandomNumberGenerator random_engine;
+        random_engine.seed(seeds[chain]);
+        Event::chain_random_engine_ = &random_engine;
+
+        try {
+            for(const auto& module : block.chains[chain]) {
+                if(abort) {
+                    break;
+                }
+
+                // Check if the module is unused or not satisfied to run
+                if(unused_modules_.find(module.get()) != unused_modules_.end()) {
+                    continue;
+                }
+                if(!module->check_delegates(messenger_, event)) {
+                    LOG(TRACE) << "Not all required messages are received for "
+                               << module->get_identifier().getUniqueName() << ", skipping module!";
+                    continue;
+                }
+
+                auto start = std::chrono::steady_clock::now();
+                auto old_settings = ModuleManager::set_module_before(
+                    module->get_identifier().getUniqueName(), module->get_configuration(), "R:", event->number);
+
+                Configuration::setAccessReporting(report_config_access);
+                auto sampling = plot_sampling_.find(module.get());
+                HistogramFilling::setSkipped(sampling != plot_sampling_.end() && !samples_plots(sampling->second, event));
+                PerfCounterValues counters_start{};
+                auto counted = perf_counters_ && read_perf_counters(counters_start);
+                try {
+                    // Tasks are numbered per module, the chains reach their modules in an arbitrary order
+                    if(module_random_streams_) {
+                        event->set_module_random_stream(module_random_stream(module.get()));
+                    } else {
+                        event->set_task_stream(module_random_stream(module.get()));
+                    }
+                    module->run(event);
+                    check_time_budget(event, module.get());
+                } catch(const AbortEventException& e) {
+                    LOG(WARNING) << "Event aborted:" << std::endl << e.what();
+                    abort = true;
+                } catch(const EndOfRunException& e) {
+                    LOG(WARNING) << "Request to terminate:" << std::endl << e.what();
+                    terminate_ = true;
+                }
+                event->set_module_random_stream(0);
+                Configuration::setAccessReporting(false);
+                HistogramFilling::setSkipped(false);
+                if(counted) {
+                    add_perf_counters(module.get(), counters_start);
+                }
+
+                ModuleManager::set_module_after(std::move(old_settings));
+
+                // Update execution time
+                auto end = std::chrono::steady_clock::now();
+                auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+                module_execution_time_[module.get()] += duration;
+                module_event_time_distribution_[module.get()].add(duration);
+
+                if(event_trace_) {
+                    event_trace_->addSpan(module->get_identifier().getUniqueName(), event->number, start, end);
+                }
+
+                if(plot) {
+                    std::lock_guard<std::mutex> stat_lock{event->stats_mutex_};
+                    event_time += duration;
+                    module_event_time_[module.get()]->Fill(
+                        std::chrono::duration<double>(std::chrono::nanoseconds(duration)).count());
+                }
+            }
+        } catch(...) {
+            Event::chain_random_engine_ = nullptr;
+            throw;
+        }
+        Event::chain_random_engine_ = nullptr;
+    };
+    thread_pool_->parallelFor(block.chains.size(), execute_chain);
+
+    return abort;
+}
+
+/**
+ * Every event is recorded once, when the first module finishing after the budget has been exceeded returns. Events
+ * aborted for their budget are not finished and thus not written by any module following the one which exceeded it.
+ */
+void ModuleManager::check_time_budget(Event* event, const Module* module) {
+    if(!event->isOverBudget() || event->budget_recorded_.exchange(true)) {
+        return;
+    }
+
+    auto time = event->get_budget_time();
+    {
+        std::lock_guard<std::mutex> lock{budget_mutex_};
+        budget_events_.push_back({event->number, event->getSeed(), module->get_identifier().getUniqueName(), time});
+    }
+    if(budget_action_ == BudgetAction::ABORT) {
+        throw AbortEventException("Event " + std::to_string(event->number) + " exceeded the time budget of " +
+                                  Units::display(event_time_budget_, {"ms", "s"}) + " after " +
+                                  Units::display(time, {"ms", "s"}));
+    }
+    LOG(INFO) << "Event " << event->number << " exceeded the time budget of "
+              << Units::display(event_time_budget_, {"ms", "s"}) << " after " << Units::display(time, {"ms", "s"})
+              << ", continuing as degraded event";
+}
+
+void ModuleManager::write_budget_events(const std::filesystem::path& path) const {
+    auto events = budget_events_;
+    std::sort(events.begin(), events.end(), [](const auto& lhs, const auto& rhs) { return lhs.number < rhs.number; });
+
+    std::ofstream file(path);
+    if(!file.good()) {
+        throw RuntimeError("Cannot write list of events exceeding the time budget to " + path.string());
+    }
+    file << "# Events exceeding the time budget of " << Units::display(event_time_budget_, {"ms", "s"}) << ", "
+         << (budget_action_ == BudgetAction::ABORT ? "aborted" : "degraded") << std::endl;
+    file << "# event seed module time[ns]" << std::endl;
+    for(const auto& event : events) {
+        file << event.number << " " << event.seed << " " << event.module << " " << event.time << std::endl;
+    }
+}
+
+/**
+ * All events up to the checkpoint have to be finished and no other event may be in progress such that the state of the
+ * modules reflects exactly these events. The event loop is therefore drained before the modules are informed. The file is
+ * replaced atomically, such that an interruption while writing keeps the previous checkpoint.
+ */
+void ModuleManager::write_checkpoint(const Configuration& global_config, uint64_t completed_event, uint64_t last_event) {
+    LOG(TRACE) << "Waiting for events up to " << completed_event << " to finish for checkpoint";
+    wait_for_workers();
+    thread_pool_->checkException();
+    while(thread_pool_->minimumUncompleted() <= completed_event) {
+        if(writer_stage_) {
+            writer_stage_->checkException();
+        }
+        if(!thread_pool_->valid()) {
+            LOG(WARNING) << "Event sequence incomplete, not writing checkpoint after event " << completed_event;
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    for(auto& module : modules_) {
+        auto old_settings = set_module_before(module->get_identifier().getUniqueName(), module->get_configuration(), "C:");
+        module->checkpoint();
+        set_module_after(std::move(old_settings));
+    }
+
+    auto path = std::filesystem::path(global_config.get<std::string>("checkpoint_file"));
+    auto tmp_path = path;
+    tmp_path += ".tmp";
+    {
+        std::ofstream file(tmp_path);
+        if(!file.good()) {
+            throw RuntimeError("Cannot write checkpoint file " + tmp_path.string());
+        }
+        file << "# Checkpoint of the event loop, continue the run with the resume framework parameter" << std::endl;
+        file << "random_seed = " << global_config.get<uint64_t>("random_seed") << std::endl;
+        file << "random_engine = " << global_config.get<std::string>("random_engine", "mt19937_64") << std::endl;
+        file << "completed_event = " << completed_event << std::endl;
+        file << "last_event = " << last_event << std::endl;
+    }
+    std::filesystem::rename(tmp_path, path);
+
+    LOG(STATUS) << "Wrote checkpoint after event " << completed_event << " to " << path;
+}
+
+std::vector<uint64_t> ModuleManager::order_events(uint64_t first_event, uint64_t last_event) const {
+    if(!(multithreading_flag_ && can_parallelize_)) {
+        LOG(WARNING) << "Events can only be reordered when multithreading is enabled, processing events in sequence";
+        return {};
+    }
+
+    // Sum the costs estimated by all modules for every event
+    std::vector<std::pair<double, uint64_t>> costs;
+    costs.reserve(last_event - first_event + 1);
+    bool estimated = false;
+    for(auto event_num = first_event; event_num <= last_event; ++event_num) {
+        double cost = 0;
+        for(const auto& module : modules_) {
+            if(auto module_cost = module->estimate_event_cost(event_num)) {
+                cost += module_cost.value();
+                estimated = true;
+            }
+        }
+        costs.emplace_back(cost, event_num);
+    }
+    if(!estimated) {
+        LOG(WARNING) << "No module provides estimates of the event cost, processing events in sequence";
+        return {};
+    }
+
+    // Every worker has to be able to take a new event while the events overtaking the next one in sequence are buffered
+    auto window = costs.size();
+    if(std::any_of(modules_.begin(), modules_.end(), [](const auto& module) { return module->require_sequence(); })) {
+        window = (max_buffer_size_ > number_of_threads_ ? max_buffer_size_ - number_of_threads_ : 0);
+        if(window < 2) {
+            LOG(WARNING) << "Not enough buffered event slots to reorder events, processing events in sequence";
+            return {};
+        }
+    }
+    for(size_t begin = 0; begin < costs.size(); begin += window) {
+        auto end = costs.begin() + static_cast<std::ptrdiff_t>(std::min(begin + window, costs.size()));
+        std::stable_sort(costs.begin() + static_cast<std::ptrdiff_t>(begin), end, [](const auto& lhs, const auto& rhs) {
+            return lhs.first > rhs.first;
+        });
+    }
+    LOG(STATUS) << "Processing the events with the largest estimated cost first, within windows of "
+                << std::min(window, costs.size()) << " events";
+
+    std::vector<uint64_t> events;
+    events.reserve(costs.size());
+    for(const auto& [cost, event_num] : costs) {
+        events.push_back(event_num);
+    }
+    return events;
+}
+
+/**
+ * Only the flat documents written as performance report are supported, the value of the first occurrence of the key is
+ * returned.
+ */
+static std::optional<double> find_json_number(std::string_view json, const std::string& key) {
+    auto pos = json.find("\"" + key + "\"");
+    if(pos == std::string_view::npos) {
+        return std::nullopt;
+    }
+    pos = json.find(':', pos);
+    if(pos == std::string_view::npos) {
+        return std::nullopt;
+    }
+    std::string value_str(json.substr(pos + 1, json.find_first_of(",}", pos) - pos - 1));
+    try {
+        return std::stod(value_str);
+    } catch(std::logic_error&) {
+        return std::nullopt;
+    }
+}
+
+void ModuleManager::write_performance_report(const std::filesystem::path& path) const {
+    std::ofstream file(path);
+    if(!file.good()) {
+        throw RuntimeError("Cannot open performance report " + path.string());
+    }
+
+    auto& global_config = conf_manager_->getGlobalConfiguration();
+    auto number_of_events = global_config.get<uint64_t>("number_of_events");
+    auto run_time = static_cast<double>(Units::convert(run_time_, "s"));
+
+    file << std::setprecision(6);
+    file << "{" << std::endl;
+    file << "  \"number_of_events\": " << number_of_events << "," << std::endl;
+    file << "  \"workers\": " << number_of_threads_ << "," << std::endl;
+    file << "  \"initialization_time\": " << Units::convert(initialize_time_, "s") << "," << std::endl;
+    file << "  \"run_time\": " << run_time << "," << std::endl;
+    file << "  \"finalization_time\": " << Units::convert(finalize_time_, "s") << "," << std::endl;
+    file << "  \"events_per_second\": " << static_cast<double>(number_of_events) / std::max(run_time, 1e-9) << ","
+         << std::endl;
+    file << "  \"peak_memory\": " << peak_memory_usage() << "," << std::endl;
+    file << "  \"modules\": {";
+    for(auto module_iter = modules_.begin(); module_iter != modules_.end(); ++module_iter) {
+        file << (module_iter == modules_.begin() ? "" : ",") << std::endl;
+        file << "    \"" << (*module_iter)->getUniqueName()
+             << "\": " << Units::convert(module_execution_time_.at(module_iter->get()).load(), "s");
+    }
+    file << std::endl << "  }" << std::endl << "}" << std::endl;
+
+    LOG(STATUS) << "Wrote performance report to " << path;
+}
+
+/**
+ * The sample is processed with the configured number of workers. Times per event are scaled linearly to the requested
+ * number of events, while initialization and finalization are counted once. The memory beyond the peak resident set size
+ * after initialization is attributed to the workers, assuming that it does not grow with the number of events. The output
+ * size per event is the size of all files in the output directory divided by the number of sample events, which includes
+ * the fixed size of the metadata and thereby overestimates the size of larger outputs.
+ */
+void ModuleManager::write_cost_estimate(const std::filesystem::path& path) const {
+    auto& global_config = conf_manager_->getGlobalConfiguration();
+    auto sample_events = std::max(uint64_t(1), global_config.get<uint64_t>("number_of_events"));
+    auto requested_events = global_config.get<uint64_t>("_estimate_number_of_events");
+    auto scale = static_cast<double>(requested_events) / static_cast<double>(sample_events);
+
+    uint64_t output_size = 0;
+    std::error_code error;
+    for(const auto& entry : std::filesystem::recursive_directory_iterator(gSystem->pwd(), error)) {
+        if(entry.is_regular_file(error)) {
+            output_size += entry.file_size(error);
+        }
+    }
+    auto output_size_per_event = static_cast<double>(output_size) / static_cast<double>(sample_events);
+
+    auto workers = std::max(1u, number_of_threads_);
+    auto peak_memory = peak_memory_usage();
+    auto worker_memory = static_cast<double>(peak_memory - std::min(peak_memory, initialize_memory_)) / workers;
+    auto time_per_event = static_cast<double>(Units::convert(run_time_, "s")) / static_cast<double>(sample_events);
+    auto wall_time = static_cast<double>(Units::convert(initialize_time_ + finalize_time_, "s")) + time_per_event * scale;
+
+    std::ofstream file(path);
+    if(!file.good()) {
+        throw RuntimeError("Cannot open cost estimate " + path.string());
+    }
+    file << std::setprecision(6);
+    file << "{" << std::endl;
+    file << "  \"sample_events\": " << sample_events << "," << std::endl;
+    file << "  \"number_of_events\": " << requested_events << "," << std::endl;
+    file << "  \"workers\": " << number_of_threads_ << "," << std::endl;
+    file << "  \"initialization_time\": " << Units::convert(initialize_time_, "s") << "," << std::endl;
+    file << "  \"finalization_time\": " << Units::convert(finalize_time_, "s") << "," << std::endl;
+    file << "  \"time_per_event\": " << time_per_event << "," << std::endl;
+    file << "  \"wall_time\": " << wall_time << "," << std::endl;
+    file << "  \"initialization_memory\": " << initialize_memory_ << "," << std::endl;
+    file << "  \"memory_per_worker\": " << static_cast<uint64_t>(worker_memory) << "," << std::endl;
+    file << "  \"peak_memory\": " << peak_memory << "," << std::endl;
+    file << "  \"output_size_per_event\": " << output_size_per_event << "," << std::endl;
+    file << "  \"output_size\": " << static_cast<uint64_t>(output_size_per_event * static_cast<double>(requested_events))
+         << "," << std::endl;
+    file << "  \"modules\": {";
+    for(auto module_iter = modules_.begin(); module_iter != modules_.end(); ++module_iter) {
+        // Instantiations without finished events have no distribution of their execution times
+        auto distribution_iter = module_event_time_distribution_.find(module_iter->get());
+        auto quantile = [&](double fraction) {
+            return distribution_iter == module_event_time_distribution_.end()
+                       ? 0.
+                       : static_cast<double>(Units::convert(distribution_iter->second.quantile(fraction), "s"));
+        };
+        auto module_time = static_cast<double>(Units::convert(module_execution_time_.at(module_iter->get()).load(), "s"));
+        file << (module_iter == modules_.begin() ? "" : ",") << std::endl;
+        file << "    \"" << (*module_iter)->getUniqueName() << "\": {\"time\": " << module_time * scale
+             << ", \"time_per_event\": " << module_time / static_cast<double>(sample_events)
+             << ", \"p50\": " << quantile(0.5) << ", \"p90\": " << quantile(0.9) << ", \"p99\": " << quantile(0.99)
+             << ", \"max\": " << quantile(1.) << "}";
+    }
+    file << std::endl << "  }" << std::endl << "}" << std::endl;
+
+    LOG(STATUS) << "Estimated cost of " << requested_events << " events from a sample of " << sample_events
+                << " events:" << std::endl
+                << " wall time " << Units::display(Units::get(wall_time, "s"), "s") << std::endl
+                << " memory " << std::round(static_cast<double>(initialize_memory_) / 1e6) << " MB after initialization and "
+                << std::round(worker_memory / 1e6) << " MB per worker" << std::endl
+                << " output size " << std::round(output_size_per_event * static_cast<double>(requested_events) / 1e6)
+                << " MB";
+    LOG(STATUS) << "Wrote cost estimate to " << path;
+}
+
+/**
+ * The execution times of the module instantiations are compared per event, such that baselines with a different number of
+ * events can be used. Only the dominant module instantiations, taking at least a tenth of the summed module execution time
+ * of the baseline, are compared since the times of short running modules fluctuate strongly. Quantities missing in the
+ * baseline are not compared.
+ */
+bool ModuleManager::compare_performance_baseline(const std::filesystem::path& path, double tolerance) const {
+    std::ifstream file(path);
+    if(!file.good()) {
+        throw RuntimeError("Cannot read performance baseline " + path.string());
+    }
+    std::string baseline((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    LOG(STATUS) << "Comparing performance against baseline " << path << " with a tolerance of " << 100 * tolerance << "%";
+
+    auto& global_config = conf_manager_->getGlobalConfiguration();
+    auto number_of_events = global_config.get<double>("number_of_events");
+    bool regression = false;
+
+    auto baseline_rate = find_json_number(baseline, "events_per_second");
+    if(baseline_rate.has_value()) {
+        auto rate = number_of_events / std::max(static_cast<double>(Units::convert(run_time_, "s")), 1e-9);
+        if(rate < baseline_rate.value() * (1 - tolerance)) {
+            LOG(ERROR) << "Throughput of " << rate << " Hz is lower than the baseline of " << baseline_rate.value()
+                       << " Hz by more than the tolerance";
+            regression = true;
+        } else {
+            LOG(INFO) << "Throughput of " << rate << " Hz compared to the baseline of " << baseline_rate.value() << " Hz";
+        }
+    }
+
+    auto baseline_memory = find_json_number(baseline, "peak_memory");
+    if(baseline_memory.has_value()) {
+        auto memory = static_cast<double>(peak_memory_usage());
+        if(memory > baseline_memory.value() * (1 + tolerance)) {
+            LOG(ERROR) << "Peak memory usage of " << std::round(memory / 1e6) << " MB is higher than the baseline of "
+                       << std::round(baseline_memory.value() / 1e6) << " MB by more than the tolerance";
+            regression = true;
+        } else {
+            LOG(INFO) << "Peak memory usage of " << std::round(memory / 1e6) << " MB compared to the baseline of "
+                      << std::round(baseline_memory.value() / 1e6) << " MB";
+        }
+    }
+
+    auto modules_pos = baseline.find("\"modules\"");
+    auto baseline_events = find_json_number(baseline, "number_of_events");
+    if(modules_pos != std::string::npos && baseline_events.has_value()) {
+        auto baseline_modules = std::string_view(baseline).substr(modules_pos);
+        std::map<const Module*, double> baseline_times;
+        double baseline_total_time = 0;
+        for(const auto& module : modules_) {
+            auto baseline_time = find_json_number(baseline_modules, module->getUniqueName());
+            if(baseline_time.has_value()) {
+                baseline_times[module.get()] = baseline_time.value();
+                baseline_total_time += baseline_time.value();
+            }
+        }
+
+        for(const auto& module : modules_) {
+            auto baseline_iter = baseline_times.find(module.get());
+            if(baseline_iter == baseline_times.end()) {
+                continue;
+            }
+            auto time = static_cast<double>(module_execution_time_.at(module.get()).load()) / number_of_events;
+            auto reference = Units::get(baseline_iter->second / baseline_events.value(), "s");
+            if(baseline_iter->second >= 0.1 * baseline_total_time && time > reference * (1 + tolerance)) {
+                LOG(ERROR) << "Module " << module->getUniqueName() << " took " << Units::display(time, {"ms", "us"})
+                           << "/event, longer than the baseline of " << Units::display(reference, {"ms", "us"})
+                           << "/event by more than the tolerance";
+                regression = true;
+            } else {
+                LOG(INFO) << "Module " << module->getUniqueName() << " took " << Units::display(time, {"ms", "us"})
+                          << "/event compared to " << Units::display(reference, {"ms", "us"}) << "/event in the baseline";
+            }
+        }
+    }
+
+    if(!regression) {
+        LOG(STATUS) << "Performance is compatible with the baseline";
+    }
+    return !regression;
+}
+
+void ModuleManager::add_perf_counters(Module* module, const PerfCounterValues& start) {
+    PerfCounterValues end{};
+    if(!read_perf_counters(end)) {
+        return;
+    }
+    // Note: the map is not altered during the event loop and its values are atomic
+    auto& sums = module_perf_counters_[module];
+    sums.cycles += end.cycles - start.cycles;
+    sums.instructions += end.instructions - start.instructions;
+    sums.cache_misses += end.cache_misses - start.cache_misses;
+    sums.branch_misses += end.branch_misses - start.branch_misses;
+}
+
+void ModuleManager::record_event_statistics(Event* event) {
+    auto statistics = event->get_local_messenger()->getMessageStatistics();
+
+    std::lock_guard<std::mutex> lock(event_statistics_mutex_);
+    size_t event_memory = 0;
+    for(const auto& [key, entry] : statistics) {
+        auto& distributions = message_distributions_[key];
+        distributions.objects.add(static_cast<int64_t>(entry.first));
+        distributions.bytes.add(static_cast<int64_t>(entry.second));
+        event_memory += entry.second;
+    }
+    event_memory_distribution_.add(static_cast<int64_t>(event_memory));
+}
+
+/**
+ * The distributions of the message types only contain the events in which a message of the type was dispatched.
+ */
+void ModuleManager::report_event_statistics() const {
+    auto summarize = [](const TimeDistribution& distribution) {
+        std::stringstream st;
+        st << "p50 " << distribution.quantile(0.5) << ", p90 " << distribution.quantile(0.9) << ", p99 "
+           << distribution.quantile(0.99) << ", max " << distribution.max();
+        return st.str();
+    };
+
+    LOG(STATUS) << "Estimated message memory per event in bytes: " << summarize(event_memory_distribution_);
+    LOG(STATUS) << "Peak of " << buffer_fill_max_ << " buffered events, holding up to " << buffered_memory_peak_
+                << " bytes of messages";
+    for(const auto& [key, distributions] : message_distributions_) {
+        LOG(INFO) << " " << allpix::demangle(key.first.name())
+                  << (key.second.empty() ? std::string() : " of detector " + key.second) << " in "
+                  << distributions.objects.count() << " events";
+        LOG(INFO) << "  objects: " << summarize(distributions.objects);
+        LOG(INFO) << "  bytes: " << summarize(distributions.bytes);
+    }
+}
+
+static std::string nanoseconds_to_time(uint64_t nanoseconds) {
+    auto duration = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::nanoseconds(nanoseconds));
+
+    std::string time_str;
+    auto hours = std::chrono::duration_cast<std::chrono::hours>(duration);
+    duration -= hours;
+    if(hours.count() > 0) {
+        time_str += std::to_string(hours.count());
+        time_str += " hours ";
+    }
+    auto minutes = std::chrono::duration_cast<std::chrono::minutes>(duration);
+    duration -= minutes;
+    if(minutes.count() > 0) {
+        time_str += std::to_string(minutes.count());
+        time_str += " minutes ";
+    }
+    time_str += std::to_string(duration.count());
+    time_str += " seconds";
+
+    return time_str;
+}
+
+void ModuleManager::finalize_module(const std::shared_ptr<Module>& module) {
+    // Get current time
+    auto start = std::chrono::steady_clock::now();
+
+    // Set module specific log settings
+    auto old_settings = set_module_before(module->get_identifier().getUniqueName(), module->get_configuration(), "F:");
+    // Change to our ROOT directory
+    module->getROOTDirectory()->cd();
+    // Finalize module
+    module->finalize();
+    // Record the scale of sampled plots next to them
+    auto sampling = plot_sampling_.find(module.get());
+    if(sampling != plot_sampling_.end() && module->get_configuration().get<bool>("output_plots", false) &&
+       (sampling->second.interval > 1 || sampling->second.fraction < 1)) {
+        module->getROOTDirectory()->cd();
+        auto scale = (sampling->second.interval > 1 ? static_cast<double>(sampling->second.interval)
+                                                    : 1. / sampling->second.fraction);
+        TParameter<double>("output_plots_sampling_scale", scale).Write();
+    }
+    // Remove the pointer to the ROOT directory after finalizing
+    module->set_ROOT_directory(nullptr);
+    // Remove the config manager
+    module->set_config_manager(nullptr);
+    set_module_after(std::move(old_settings));
+    // Update execution time
+    auto end = std::chrono::steady_clock::now();
+    module_execution_time_[module.get()] += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+}
+
+/**
+ * The ROOT file of the modules cannot be written from several threads. Every instantiation writes to its own file in memory
+ * instead, whose contents are copied to the directory of the instantiation after all instantiations of the batch finished.
+ * The log messages of every instantiation are collected and written in the order of the instantiations, after the contents
+ * of its file have been copied.
+ */
+void ModuleManager::finalize_concurrently(const std::vector<std::shared_ptr<Module>>& batch) {
+    struct Output {
+        TDirectory* directory{nullptr};
+        std::unique_ptr<TMemFile> file;
+        std::vector<std::pair<std::string, std::string>> log;
+    };
+    std::map<Module*, Output> outputs;
+    for(const auto& module : batch) {
+        auto& output = outputs[module.get()];
+        output.directory = module->getROOTDirectory();
+        output.file = std::make_unique<TMemFile>((module->get_identifier().getUniqueName() + ".root").c_str(), "RECREATE");
+        output.file->SetCompressionSettings(0);
+        module->set_ROOT_directory(output.file.get());
+    }
+
+    std::exception_ptr exception{nullptr};
+    try {
+        run_concurrently(batch, [&outputs, this](const std::shared_ptr<Module>& module) {
+            auto& output = outputs.at(module.get());
+            Log::setBuffer(&output.log);
+            try {
+                finalize_module(module);
+            } catch(...) {
+                Log::setBuffer(nullptr);
+                throw;
+            }
+            Log::setBuffer(nullptr);
+        });
+    } catch(...) {
+        exception = std::current_exception();
+    }
+
+    // Copy the objects written by every instantiation, recursing into subdirectories it created
+    std::function<void(TDirectory*, TDirectory*)> copy_directory = [&](TDirectory* source, TDirectory* target) {
+        // Keys are listed with the highest cycle first, earlier cycles of an object are not copied
+        std::set<std::string> copied;
+        for(auto* object : *source->GetListOfKeys()) {
+            auto* key = static_cast<TKey*>(object);
+            if(!copied.insert(key->GetName()).second) {
+                continue;
+            }
+            if(std::string_view(key->GetClassName()) == "TDirectoryFile") {
+                auto* subdirectory = target->GetDirectory(key->GetName());
+                if(subdirectory == nullptr) {
+                    subdirectory = target->mkdir(key->GetName());
+                }
+                copy_directory(source->GetDirectory(key->GetName()), subdirectory);
+                continue;
+            }
+            std::unique_ptr<TObject> copy(key->ReadObj());
+            target->WriteTObject(copy.get(), key->GetName());
+        }
+    };
+    for(const auto& module : batch) {
+        auto& output = outputs.at(module.get());
+        copy_directory(output.file.get(), output.directory);
+        output.file->Close();
+        Log::flushBuffer(output.log);
+    }
+
+    if(exception != nullptr) {
+        std::rethrow_exception(exception);
+    }
+}
+
+/**
+ * @throws RuntimeError If the performance of the run is not compatible with the configured baseline
+ *
+ * Sets the section header and logging settings before executing the  \ref Module::finalize() function. Reset the logging
+ * after finalization. No method will be called after finalizing the module (except the destructor).
+ */
+void ModuleManager::finalize() {
+    auto start_time = std::chrono::steady_clock::now();
+
+    // Merge the thread local instances of the histograms of all modules concurrently before the modules write them
+    if(number_of_threads_ > 1) {
+        LOG(TRACE) << "Merging histograms of " << number_of_threads_ << " workers";
+        ThreadedHistogramBase::mergeAll(number_of_threads_);
+    }
+
+    LOG_PROGRESS(TRACE, "FINALIZE_LOOP") << "Finalizing module instantiations";
+    Configuration& global_config = conf_manager_->getGlobalConfiguration();
+    auto parallel_finalization = number_of_threads_ > 1 && global_config.get<bool>("parallel_finalization", false);
+    for(auto module_iter = modules_.begin(); module_iter != modules_.end();) {
+        auto batch_end = std::next(module_iter);
+        if(parallel_finalization && (*module_iter)->getDetector() != nullptr) {
+            while(batch_end != modules_.end() && (*batch_end)->getDetector() != nullptr &&
+                  (*batch_end)->get_configuration().getName() == (*module_iter)->get_configuration().getName()) {
+                ++batch_end;
+            }
+        }
+
+        if(std::next(module_iter) == batch_end) {
+            LOG_PROGRESS(TRACE, "FINALIZE_LOOP") << "Finalizing " << (*module_iter)->get_identifier().getUniqueName();
+            finalize_module(*module_iter);
+        } else {
+            LOG(DEBUG) << "Finalizing " << std::distance(module_iter, batch_end) << " instantiations of "
+                       << (*module_iter)->get_configuration().getName() << " concurrently";
+            finalize_concurrently(std::vector<std::shared_ptr<Module>>(module_iter, batch_end));
+        }
+        module_iter = batch_end;
+    }
+
+    // Make the outputs of the cached stage available to following runs once the run is complete
+    if(!stage_cache_file_.empty() && !terminate_) {
+        std::filesystem::rename(stage_cache_incomplete_file_, stage_cache_file_);
+        LOG(STATUS) << "Stored outputs of cached stage in " << stage_cache_file_;
+    }
+
+    // Store performance plots
+    if(global_config.get<bool>("performance_plots")) {
 
         auto* perf_dir = modules_file_->mkdir("performance");
         if(perf_dir == nullptr) {
@@ -1045,6 +2980,31 @@ void ModuleManager::finalize() {
     for(auto& module : modules_) {
         LOG(INFO) << " Module " << module->getUniqueName() << " took "
                   << Units::display(module_execution_time_[module.get()].load(), {"s", "ms"});
+
+        // Summarize the per-event wall time, including the time events waited for their turn in sequence
+        const auto& distribution = module_event_time_distribution_[module.get()];
+        if(distribution.count() > 0) {
+            LOG(INFO) << "  per event: p50 " << Units::display(distribution.quantile(0.5), {"s", "ms", "us"}) << ", p90 "
+                      << Units::display(distribution.quantile(0.9), {"s", "ms", "us"}) << ", p99 "
+                      << Units::display(distribution.quantile(0.99), {"s", "ms", "us"}) << ", max "
+                      << Units::display(distribution.max(), {"s", "ms", "us"});
+        }
+
+        // Summarize the hardware performance counters of the module calls
+        if(perf_counters_ && distribution.count() > 0) {
+            const auto& counters = module_perf_counters_[module.get()];
+            auto instructions = static_cast<double>(std::max(std::uint64_t(1), counters.instructions.load()));
+            LOG(INFO) << "  counters: " << std::round(static_cast<double>(counters.cycles) / distribution.count())
+                      << " cycles/event, " << std::setprecision(3)
+                      << instructions / static_cast<double>(std::max(std::uint64_t(1), counters.cycles.load()))
+                      << " instructions/cycle, " << 1000. * static_cast<double>(counters.cache_misses) / instructions
+                      << " cache misses and " << 1000. * static_cast<double>(counters.branch_misses) / instructions
+                      << " branch misses per 1000 instructions";
+        }
+    }
+
+    if(event_statistics_) {
+        report_event_statistics();
     }
 
     auto processing_time = std::round(run_time_ / std::max(uint64_t(1), global_config.get<uint64_t>("number_of_events")));
@@ -1058,6 +3018,162 @@ void ModuleManager::finalize() {
         LOG(STATUS) << "This corresponds to a processing time of \x1B[1m"
                     << Units::display(event_processing_time, {"ms", "us"}) << "/event\x1B[0m per worker";
     }
+
+    // Write the machine-readable performance summary and compare it against the baseline if requested
+    if(global_config.has("performance_report")) {
+        auto report_path = std::filesystem::path(gSystem->pwd()) / global_config.get<std::string>("performance_report");
+        report_path.replace_extension("json");
+        write_performance_report(report_path);
+    }
+    if(global_config.has("estimate_events")) {
+        auto estimate_path = std::filesystem::path(gSystem->pwd()) / global_config.get<std::string>("estimate_file");
+        estimate_path.replace_extension("json");
+        write_cost_estimate(estimate_path);
+    }
+    bool baseline_compatible = true;
+    if(global_config.has("performance_baseline")) {
+        baseline_compatible = compare_performance_baseline(global_config.getPath("performance_baseline", true),
+                                                           global_config.get<double>("performance_tolerance", 0.3));
+    }
+
+    // Export the final values of the metrics
+    if(!metrics_path_.empty()) {
+        write_metrics();
+        LOG(STATUS) << "Wrote final metrics of the modules to " << metrics_path_;
+    }
+
+    // Fail the run after all reports are written such that the regression can be inspected
+    if(!baseline_compatible) {
+        throw RuntimeError("Performance of the run is not compatible with the baseline " +
+                           global_config.getPath("performance_baseline", true).string());
+    }
+}
+
+void ModuleManager::stop_metrics_export() {
+    if(!metrics_thread_.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(metrics_mutex_);
+        metrics_stop_ = true;
+    }
+    metrics_cv_.notify_all();
+    metrics_thread_.join();
+}
+
+/**
+ * In the Prometheus format, counters are suffixed with \c _total and all metrics are prefixed with \c allpix_. The samples
+ * of all instantiations are grouped below a single description of every metric and labeled with the module name and the
+ * identifier of the instantiation. The JSON format lists the counters and gauges by the unique name of the instantiations.
+ */
+void ModuleManager::write_metrics() const {
+    auto tmp_path = metrics_path_;
+    tmp_path += ".tmp";
+    {
+        std::ofstream file(tmp_path);
+        if(!file.good()) {
+            throw RuntimeError("Cannot write metrics file " + tmp_path.string());
+        }
+        file << std::setprecision(std::numeric_limits<double>::max_digits10);
+
+        if(metrics_prometheus_) {
+            struct Metric {
+                std::string description;
+                bool counter;
+                std::vector<std::string> samples;
+            };
+            std::map<std::string, Metric> metrics;
+            auto add_sample = [&](const Module* module, std::string name, const std::string& description, bool counter) {
+                auto& metric = metrics[name];
+                metric.description = description;
+                metric.counter = counter;
+                metric.samples.push_back(name + "{module=\"" + module->get_identifier().getName() + "\",instance=\"" +
+                                         module->get_identifier().getIdentifier() + "\"}");
+                return &metric.samples.back();
+            };
+            for(const auto& module : modules_) {
+                for(const auto* counter : module->counters_) {
+                    auto* sample = add_sample(
+                        module.get(), "allpix_" + counter->getName() + "_total", counter->getDescription(), true);
+                    *sample += " " + std::to_string(counter->value());
+                }
+                for(const auto& gauge : module->gauges_) {
+                    auto* sample = add_sample(module.get(), "allpix_" + gauge.name, gauge.description, false);
+                    std::ostringstream value;
+                    value << std::setprecision(std::numeric_limits<double>::max_digits10) << gauge.value();
+                    *sample += " " + value.str();
+                }
+            }
+            for(const auto& [name, metric] : metrics) {
+                file << "# HELP " << name << " " << metric.description << std::endl;
+                file << "# TYPE " << name << " " << (metric.counter ? "counter" : "gauge") << std::endl;
+                for(const auto& sample : metric.samples) {
+                    file << sample << std::endl;
+                }
+            }
+        } else {
+            file << "{\n  \"modules\": {";
+            bool first_module = true;
+            for(const auto& module : modules_) {
+                if(module->counters_.empty() && module->gauges_.empty()) {
+                    continue;
+                }
+                file << (first_module ? "" : ",") << "\n    \"" << module->get_identifier().getUniqueName() << "\": {";
+                first_module = false;
+
+                file << "\n      \"counters\": {";
+                for(size_t i = 0; i < module->counters_.size(); ++i) {
+                    const auto* counter = module->counters_[i];
+                    file << (i > 0 ? ", " : "") << "\"" << counter->getName() << "\": " << counter->value();
+                }
+                file << "},\n      \"gauges\": {";
+                for(size_t i = 0; i < module->gauges_.size(); ++i) {
+                    const auto& gauge = module->gauges_[i];
+                    auto value = gauge.value();
+                    file << (i > 0 ? ", " : "") << "\"" << gauge.name << "\": ";
+                    if(std::isfinite(value)) {
+                        file << value;
+                    } else {
+                        file << "null";
+                    }
+                }
+                file << "}\n    }";
+            }
+            file << "\n  }\n}" << std::endl;
+        }
+    }
+    std::filesystem::rename(tmp_path, metrics_path_);
+}
+
+void ModuleManager::TimeDistribution::add(int64_t duration) {
+    duration = std::max(duration, int64_t(1));
+
+    // Find the octave and the logarithmic sub-bin within it
+    auto value = static_cast<double>(duration);
+    int exponent = 0;
+    auto mantissa = std::frexp(value, &exponent);
+    auto octave = static_cast<size_t>(exponent - 1);
+    auto sub_bin = static_cast<size_t>(std::log2(2 * mantissa) * bins_per_octave_);
+    auto bin = std::min(octave * bins_per_octave_ + std::min(sub_bin, bins_per_octave_ - 1), bins_.size() - 1);
+    bins_[bin].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+
+    auto current_max = max_.load(std::memory_order_relaxed);
+    while(duration > current_max && !max_.compare_exchange_weak(current_max, duration, std::memory_order_relaxed)) {
+    }
+}
+
+int64_t ModuleManager::TimeDistribution::quantile(double fraction) const {
+    auto target = static_cast<uint64_t>(std::ceil(fraction * static_cast<double>(count_)));
+    uint64_t sum = 0;
+    for(size_t bin = 0; bin < bins_.size(); ++bin) {
+        sum += bins_[bin].load(std::memory_order_relaxed);
+        if(sum >= std::max(target, uint64_t(1))) {
+            auto upper_edge = std::exp2(static_cast<double>(bin + 1) / bins_per_octave_);
+            return std::min(static_cast<int64_t>(std::ceil(upper_edge)), max());
+        }
+    }
+    return max();
 }
 
 /**
@@ -1065,6 +3181,11 @@ void ModuleManager::finalize() {
  */
 void ModuleManager::terminate() {
     if(!terminate_.exchange(true) && thread_pool_) {
+        for(auto& stage : worker_stages_) {
+            if(stage.pool) {
+                stage.pool->destroy();
+            }
+        }
         thread_pool_->destroy();
     }
 }
@@ -12,20 +12,35 @@
 #ifndef ALLPIX_MODULE_MANAGER_H
 #define ALLPIX_MODULE_MANAGER_H
 
+#include <array>
 #include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
 #include <list>
 #include <map>
 #include <memory>
+#include <memory_resource>
+#include <mutex>
 #include <queue>
+#include <set>
+#include <string>
+#include <thread>
+#include <typeindex>
+#include <vector>
 
 #include <TDirectory.h>
 #include <TFile.h>
 #include <TH1D.h>
 
+#include "EventTrace.hpp"
 #include "Module.hpp"
+#include "ModuleRegistry.hpp"
 #include "ThreadPool.hpp"
+#include "WriterStage.hpp"
 #include "core/config/Configuration.hpp"
 #include "core/utils/log.h"
+#include "core/utils/perf_counters.h"
 #include "tools/ROOT.h"
 
 namespace allpix {
@@ -56,9 +71,9 @@ namespace allpix {
          */
         ModuleManager();
         /**
-         * @brief Use default destructor
+         * @brief Stop the export of the metrics if it is still running
          */
-        ~ModuleManager() = default;
+        ~ModuleManager();
 
         /// @{
         /**
@@ -97,12 +112,51 @@ namespace allpix {
          */
         void run(RandomNumberGenerator& seeder);
 
+        /**
+         * @brief Prepare the modules for the next point of a parameter scan
+         * @param options Module options of the next point, in the format of the command line options
+         * @warning Should be called after the \ref ModuleManager::run "run function" of the previous point, with the output
+         * directory of the next point as current directory
+         *
+         * Module instantiations whose configuration is changed by the options, which write output or which are listed in
+         * the scan_reinitialize parameter are finalized, recreated with their new configuration and initialized again. All
+         * other instantiations keep their state, such that their initialization is only done once for the full scan.
+         */
+        void reconfigure(const std::vector<std::string>& options);
+
         /**
          * @brief Finalize all modules after the event sequence
          * @warning Should be called after the \ref ModuleManager::initialize "run function"
          */
         void finalize();
 
+        /**
+         * @brief Summary of the last event loop
+         */
+        struct RunStatistics {
+            uint64_t events{};             ///< Number of finished events
+            uint64_t run_time{};           ///< Wall time of the event loop in nanoseconds
+            uint64_t sequence_wait_time{}; ///< Time events were buffered waiting for the event sequence in nanoseconds
+            double mean_buffer_fill{};     ///< Mean number of buffered events when an event finished
+            size_t max_buffer_fill{};      ///< Maximum number of buffered events when an event finished
+            size_t buffer_size{};          ///< Number of event slots available for buffered events
+        };
+
+        /**
+         * @brief Change the number of workers used by the following event loops
+         * @param workers Number of workers, at most the number of workers used during initialization
+         * @warning Should be called after the \ref ModuleManager::initialize "init function" with multithreading enabled
+         *
+         * The number of buffered event slots is adjusted to the number of workers.
+         */
+        void setWorkers(unsigned int workers);
+
+        /**
+         * @brief Get the summary of the last event loop
+         * @return Statistics of the last call to the \ref ModuleManager::run "run function"
+         */
+        const RunStatistics& getRunStatistics() const { return run_statistics_; }
+
         /**
          * @brief Terminates as soon as the current event is finished
          * @note This method is safe to call from any signal handler
@@ -110,26 +164,98 @@ namespace allpix {
         void terminate();
 
     private:
+        /**
+         * @brief Load the dynamic library of a module and resolve its generator function
+         * @param global_config Global configuration with the directories to search for the library
+         * @param module_name Name of the module
+         * @return Generator function of the module
+         */
+        ModuleGenerator load_module_library(const Configuration& global_config, const std::string& module_name);
+
         /**
          * @brief Create unique modules
-         * @param library Void pointer to the loaded library
+         * @param module_generator Generator function of the module
          * @param config Configuration of the module
          * @param messenger Pointer to the messenger
          * @param geo_manager Pointer to the geometry manager
          * @return An unique module together with its identifier
          */
-        std::pair<ModuleIdentifier, Module*> create_unique_modules(void*, Configuration&, Messenger*, GeometryManager*);
+        std::pair<ModuleIdentifier, Module*>
+        create_unique_modules(UniqueModuleGenerator, Configuration&, Messenger*, GeometryManager*);
 
         /**
          * @brief Create detector modules
-         * @param library Void pointer to the loaded library
+         * @param module_generator Generator function of the module
          * @param config Configuration of the module
          * @param messenger Pointer to the messenger
          * @param geo_manager Pointer to the geometry manager
          * @return A list of all created detector modules and their identifiers
          */
         std::vector<std::pair<ModuleIdentifier, Module*>>
-        create_detector_modules(void*, Configuration&, Messenger*, GeometryManager*);
+        create_detector_modules(DetectorModuleGenerator, Configuration&, Messenger*, GeometryManager*);
+
+        /**
+         * @brief Replace a module instantiation by a new one with the given configuration
+         * @param module_iter Position of the instantiation in the list of modules
+         * @param config New configuration of the instantiation
+         * @warning The previous instantiation should be finalized before
+         */
+        void recreate_module(ModuleList::iterator module_iter, const Configuration& config);
+
+        /**
+         * @brief Get an event object for the next event, recycled from a finished event if enabled
+         * @param event_num The unique event identifier
+         * @param seed Random generator seed for this event
+         * @return Shared pointer to the event, returning the object to the pool of the releasing thread when it expires
+         */
+        std::shared_ptr<Event> acquire_event(uint64_t event_num, uint64_t seed);
+
+        /**
+         * @brief Create the main ROOT file in the current directory
+         */
+        void open_modules_file();
+
+        /**
+         * @brief Read the stage outputs from the cache or add a writer to fill it, depending on the configuration hash
+         * @param global_config Global configuration with the cache directory and the last module section of the stage
+         * @param configs Configurations of the module sections, modified to read or write the cached stage outputs
+         * @param geo_manager Geometry manager providing the paths of the detector models
+         */
+        void configure_stage_cache(Configuration& global_config,
+                                   std::list<Configuration>& configs,
+                                   GeometryManager* geo_manager);
+
+        /**
+         * @brief Create the ROOT directory of a module instantiation and prepare its performance accounting
+         * @param module Module instantiation to prepare
+         */
+        void prepare_module(const std::shared_ptr<Module>& module);
+
+        /**
+         * @brief Initialize a module instantiation, storing its execution time
+         * @param module Module instantiation to initialize
+         */
+        void initialize_module(const std::shared_ptr<Module>& module);
+
+        /**
+         * @brief Finalize a module instantiation, storing its execution time
+         * @param module Module instantiation to finalize
+         */
+        void finalize_module(const std::shared_ptr<Module>& module);
+
+        /**
+         * @brief Finalize a batch of module instantiations concurrently, serializing their output to the modules file
+         * @param batch Module instantiations to finalize
+         */
+        void finalize_concurrently(const std::vector<std::shared_ptr<Module>>& batch);
+
+        /**
+         * @brief Execute a function for every module instantiation of a batch concurrently on up to the number of workers
+         * @param batch Module instantiations to process
+         * @param function Function to call for every instantiation
+         */
+        void run_concurrently(const std::vector<std::shared_ptr<Module>>& batch,
+                              const std::function<void(const std::shared_ptr<Module>&)>& function);
 
         /**
          * @brief Set module specific log setting before running init/run/finalize
@@ -149,25 +275,302 @@ namespace allpix {
          */
         static void set_module_after(std::tuple<LogLevel, LogFormat, std::string, uint64_t> prev);
 
+        /**
+         * @brief Wait for all events up to the given one to finish and write a checkpoint of the run
+         * @param global_config Global configuration of the run
+         * @param completed_event Last event to be included in the checkpoint
+         * @param last_event Last event of the full run
+         */
+        void write_checkpoint(const Configuration& global_config, uint64_t completed_event, uint64_t last_event);
+
+        /**
+         * @brief Set up the pools of workers for the stages of the module chain configured via worker_stages
+         * @param global_config Global configuration of the run
+         */
+        void configure_worker_stages(Configuration& global_config);
+
+        /**
+         * @brief Wait for the workers of all stages to finish their jobs, in the order in which events pass the stages
+         */
+        void wait_for_workers();
+
+        /**
+         * @brief Mark an event as completed for the workers of all stages
+         * @param n Number of the completed event
+         */
+        void mark_complete(uint64_t n);
+
+        /**
+         * @brief Order in which the events are submitted to the workers
+         */
+        enum class EventOrder {
+            SEQUENTIAL,    ///< Events are submitted in sequence of their event numbers
+            LARGEST_FIRST, ///< Events with the largest cost estimated by the modules are submitted first
+        };
+
+        /**
+         * @brief Handling of events exceeding their processing time budget
+         */
+        enum class BudgetAction {
+            DEGRADE, ///< Events continue, modules checking the budget switch to a faster simulation
+            ABORT,   ///< Events are aborted after the module which exceeded the budget
+        };
+
+        /**
+         * @brief Record an event exceeding its time budget once, and abort it if requested
+         * @param event Event to check the budget of
+         * @param module Module executed last for the event
+         * @throws AbortEventException If the event exceeded its budget and events should be aborted
+         */
+        void check_time_budget(Event* event, const Module* module);
+
+        /**
+         * @brief Write the list of the events which exceeded their time budget
+         * @param path Path of the file to write
+         */
+        void write_budget_events(const std::filesystem::path& path) const;
+
+        /**
+         * @brief Order the events by the sum of the costs estimated by the modules, starting with the most expensive one
+         * @param first_event First event of the run
+         * @param last_event Last event of the run
+         * @return Event numbers in the order of submission, empty if the events should be processed in sequence
+         *
+         * Events overtaking others are cached by the modules requiring the event sequence. If any module requires the
+         * sequence, events are thus only reordered within consecutive windows fitting into the event buffer.
+         */
+        std::vector<uint64_t> order_events(uint64_t first_event, uint64_t last_event) const;
+
+        /**
+         * @brief Write a machine-readable summary of the throughput, memory usage and module execution times of the run
+         * @param path Path of the JSON file to write
+         */
+        void write_performance_report(const std::filesystem::path& path) const;
+
+        /**
+         * @brief Write a machine-readable estimate of the cost of the requested number of events, extrapolated from the run
+         * @param path Path of the JSON file to write
+         */
+        void write_cost_estimate(const std::filesystem::path& path) const;
+
+        /**
+         * @brief Compare the performance of the run against a baseline written previously as performance report
+         * @param path Path of the baseline performance report
+         * @param tolerance Allowed relative deviation from the baseline
+         * @return True if the performance is compatible with the baseline, false otherwise
+         *
+         * An error is logged if the throughput is lower, the peak memory usage is higher or the execution time per event of
+         * a dominant module instantiation is longer than the baseline beyond the tolerance.
+         */
+        bool compare_performance_baseline(const std::filesystem::path& path, double tolerance) const;
+
+        /**
+         * @brief Add the hardware performance counts since a previous reading to the sums of a module instantiation
+         * @param module Module instantiation executed since the previous reading
+         * @param start Counter values read on the same thread before the module was executed
+         */
+        void add_perf_counters(Module* module, const PerfCounterValues& start);
+
+        /**
+         * @brief Add the messages dispatched in an event to the distributions of the event statistics
+         * @param event Event whose modules have all been executed
+         */
+        void record_event_statistics(Event* event);
+
+        /**
+         * @brief Log the distributions of the objects and sizes of the messages of all events
+         */
+        void report_event_statistics() const;
+
+        /**
+         * @brief Write the counters and gauges of all module instantiations to the metrics file
+         *
+         * The file is written in the JSON or the Prometheus text exposition format and replaced atomically, such that it can
+         * be read by monitoring tools at any time during the run.
+         */
+        void write_metrics() const;
+
+        /**
+         * @brief Stop the thread exporting the metrics periodically during the run
+         */
+        void stop_metrics_export();
+
+        /**
+         * @brief Find the module instantiations whose messages are never received and which have no side effects
+         * @param skip True if the unused modules should be excluded from the event loop, false to only warn about them
+         *
+         * Modules receiving messages only from unused modules are unused themselves, the search is thus repeated until no
+         * further unused modules are found. Modules without any bound messages are never considered unused.
+         */
+        void find_unused_modules(bool skip);
+
+        /**
+         * @brief Condition on the objects of an event evaluated before running a module
+         */
+        struct EventFilter {
+            std::string object_type;
+            std::set<std::string> detectors;
+            size_t min_objects{};
+            size_t max_objects{};
+        };
+
+        /**
+         * @brief Read the event filter from the configuration of a module instantiation, if configured
+         * @param module Module instantiation to read the filter for
+         * @param geo_manager Pointer to the geometry manager, to check the detector names
+         */
+        void read_event_filter(Module* module, GeometryManager* geo_manager);
+
+        /**
+         * @brief Evaluate an event filter for the messages dispatched in an event so far
+         * @param filter Event filter to evaluate
+         * @param event Event to evaluate the filter for
+         * @return True if the event passes the filter, false if its processing should end
+         *
+         * Without detectors, the total number of objects in the event has to be within the limits. Otherwise, the number of
+         * objects of at least one of the detectors has to be within the limits.
+         */
+        static bool passes_filter(const EventFilter& filter, Event* event);
+
+        /**
+         * @brief Sampling and buffering of the plots filled by a module instantiation
+         */
+        struct PlotSampling {
+            uint64_t interval{1};
+            double fraction{1};
+            int buffer_size{};
+        };
+
+        /**
+         * @brief Read the sampling of the plots from the configuration of a module instantiation, if configured
+         * @param module Module instantiation to read the sampling for
+         *
+         * The settings of the module take precedence over the ones of the global configuration.
+         */
+        void read_plot_sampling(Module* module);
+
+        /**
+         * @brief Check if the plots of a module instantiation are filled for an event
+         * @param sampling Sampling of the plots of the module instantiation
+         * @param event Event to check
+         * @return True if the event is sampled for plotting
+         */
+        static bool samples_plots(const PlotSampling& sampling, const Event* event);
+
+        /**
+         * @brief Module instantiations of consecutive detector modules, split into one chain per detector
+         */
+        struct DetectorChains {
+            ModuleList::iterator end;
+            std::vector<std::vector<std::shared_ptr<Module>>> chains;
+        };
+
+        /**
+         * @brief Find the blocks of consecutive detector modules which can be executed as concurrent chains per detector
+         *
+         * Detector modules only receive messages bound to their own detector or to no detector at all, the instantiations
+         * for different detectors within a block of consecutive detector modules are therefore independent. Modules
+         * requiring the event sequence end a block.
+         */
+        void find_detector_chains();
+
+        /**
+         * @brief Get the identifier of the independent random stream of a module instantiation
+         * @param module Module instantiation
+         * @return Non-zero identifier of the random stream
+         */
+        static uint64_t module_random_stream(const Module* module);
+
+        /**
+         * @brief Execute the module chains of a block concurrently for an event
+         * @param event Event to execute the modules for
+         * @param block Block of detector module chains
+         * @param plot True if performance plots should be filled
+         * @param report_config_access True if configuration accesses should be reported
+         * @param event_time Processing time of the event, increased by the execution time of the modules
+         * @return True if the event was aborted by one of the modules, false otherwise
+         */
+        bool run_detector_chains(
+            Event* event, const DetectorChains& block, bool plot, bool report_config_access, int64_t& event_time);
+
+        /**
+         * @brief Lock-free distribution of per-event execution times, used to estimate percentiles at the end of the run
+         *
+         * Durations are counted in logarithmic bins with a relative width of about 4%, covering one nanosecond up to more
+         * than four hours. Filling is thread-safe and does not allocate, independent of the number of events. The same
+         * binning is used for the distributions of object counts and message sizes per event.
+         */
+        class TimeDistribution {
+        public:
+            /**
+             * @brief Add a duration to the distribution
+             * @param duration Duration in nanoseconds
+             */
+            void add(int64_t duration);
+
+            /**
+             * @brief Estimate a quantile of the distribution
+             * @param fraction Fraction of entries below the quantile, between zero and one
+             * @return Upper edge of the bin containing the quantile in nanoseconds
+             */
+            int64_t quantile(double fraction) const;
+
+            /**
+             * @brief Get the maximum duration added
+             * @return Maximum duration in nanoseconds
+             */
+            int64_t max() const { return max_; }
+
+            /**
+             * @brief Get the number of entries
+             * @return Number of durations added
+             */
+            uint64_t count() const { return count_; }
+
+        private:
+            static constexpr size_t bins_per_octave_ = 16;
+            static constexpr size_t octaves_ = 44;
+            std::array<std::atomic_uint64_t, bins_per_octave_ * octaves_> bins_{};
+            std::atomic_int64_t max_{0};
+            std::atomic_uint64_t count_{0};
+        };
+
         using IdentifierToModuleMap = std::map<ModuleIdentifier, ModuleList::iterator>;
 
         ModuleList modules_;
         IdentifierToModuleMap id_to_module_;
 
         ConfigManager* conf_manager_{};
+        GeometryManager* geo_manager_{};
 
         std::unique_ptr<TFile> modules_file_;
 
+        // Cache file of the stage outputs written by this run and the file written until the run is complete
+        std::filesystem::path stage_cache_file_;
+        std::filesystem::path stage_cache_incomplete_file_;
+
         // Duration in ns
         std::map<Module*, std::atomic_int64_t> module_execution_time_;
         std::map<Module*, Histogram<TH1D>> module_event_time_;
+        // Wall time per event including waiting for the event sequence
+        std::map<Module*, TimeDistribution> module_event_time_distribution_;
         Histogram<TH1D> event_time_;
         Histogram<TH1D> buffer_fill_level_;
 
         // Durations in ns
         uint64_t initialize_time_{}, run_time_{}, finalize_time_{};
 
-        std::map<std::string, void*> loaded_libraries_;
+        // Peak resident set size after initialization, for the cost estimate
+        uint64_t initialize_memory_{};
+
+        // Accounting of the waiting for the event sequence and of the buffer fill level in the current event loop
+        std::atomic_uint64_t sequence_wait_time_{};
+        std::atomic_uint64_t buffer_fill_sum_{};
+        std::atomic<size_t> buffer_fill_max_{};
+        RunStatistics run_statistics_;
+
+        // Generator functions of the loaded module types, from the executable or the module libraries
+        std::map<std::string, ModuleGenerator> module_generators_;
 
         std::atomic<bool> terminate_;
 
@@ -176,10 +579,114 @@ namespace allpix {
         // The thread pool used in the run method
         std::unique_ptr<ThreadPool> thread_pool_{nullptr};
 
+        // Optional pools of workers executing the leading stages of the module chain before main_stage_begin_
+        struct WorkerStage {
+            ModuleList::iterator begin;
+            unsigned int workers{};
+            std::unique_ptr<ThreadPool> pool{nullptr};
+        };
+        std::vector<WorkerStage> worker_stages_;
+        ModuleList::iterator main_stage_begin_;
+        unsigned int main_stage_workers_{0};
+        size_t stage_queue_per_worker_{4};
+        // Pool of workers executing the stage starting at a module, events reaching it are handed off to this pool
+        std::map<Module*, ThreadPool*> stage_entries_;
+
+        // Optional thread executing the modules requiring the sequence at the end of the chain, starting at writer_begin_
+        std::unique_ptr<WriterStage> writer_stage_{nullptr};
+        ModuleList::iterator writer_begin_;
+        bool use_writer_stage_{false};
+
+        // Optional trace of the event loop execution
+        std::unique_ptr<EventTrace> event_trace_{nullptr};
+
+        // Processing time budget of every event in nanoseconds, zero if unlimited, and the events which exceeded it
+        struct BudgetEvent {
+            uint64_t number;
+            uint64_t seed;
+            std::string module;
+            int64_t time;
+        };
+        int64_t event_time_budget_{0};
+        BudgetAction budget_action_{BudgetAction::DEGRADE};
+        std::vector<BudgetEvent> budget_events_;
+        std::mutex budget_mutex_;
+
+        // Optional periodic export of the metrics registered by the modules
+        std::filesystem::path metrics_path_;
+        bool metrics_prometheus_{false};
+        std::thread metrics_thread_;
+        std::mutex metrics_mutex_;
+        std::condition_variable metrics_cv_;
+        bool metrics_stop_{false};
+
         // User defined multithreading flags and parameters from configuration
         bool multithreading_flag_{false};
         unsigned int number_of_threads_{0};
+        unsigned int max_threads_{0};
+        size_t buffer_per_worker_{256};
         size_t max_buffer_size_{1};
+        ThreadPool::Scheduler scheduler_{ThreadPool::Scheduler::CENTRAL};
+
+        // Estimated memory held by buffered events and its limit in bytes, zero if unlimited
+        std::atomic<size_t> buffered_memory_{0};
+        size_t max_buffer_memory_{0};
+        std::mutex buffered_memory_mutex_;
+        std::condition_variable buffered_memory_cv_;
+
+        // Processors the worker threads are pinned to as pairs of NUMA node index and processor number, empty if not pinned
+        std::vector<std::pair<unsigned int, unsigned int>> worker_cpus_;
+        // Number of NUMA nodes to replicate the field grids on, zero if disabled
+        unsigned int field_replica_nodes_{0};
+
+        // Initial size of the per-event memory arena in bytes, zero if disabled
+        size_t event_arena_size_{0};
+
+        // Event objects released after their event finished, reused for following events if recycling is enabled. The
+        // released events are kept per thread, with the control blocks of their shared pointers drawn from a pool
+        struct alignas(64) EventPool {
+            std::mutex mutex;
+            std::vector<std::unique_ptr<Event>> events;
+        };
+        bool recycle_events_{false};
+        std::pmr::synchronized_pool_resource event_control_blocks_;
+        std::vector<EventPool> event_pools_;
+
+        // Whether every module instantiation draws from its own random stream, see #module_random_stream
+        bool module_random_streams_{false};
+
+        // Hardware performance counters accumulated over the events of every module instantiation
+        struct PerfCounterSums {
+            std::atomic_uint64_t cycles{0};
+            std::atomic_uint64_t instructions{0};
+            std::atomic_uint64_t cache_misses{0};
+            std::atomic_uint64_t branch_misses{0};
+        };
+        bool perf_counters_{false};
+        std::map<Module*, PerfCounterSums> module_perf_counters_;
+
+        // Distributions of the object counts and sizes of the messages per type and detector, and of the sizes per event
+        struct MessageDistributions {
+            TimeDistribution objects;
+            TimeDistribution bytes;
+        };
+        bool event_statistics_{false};
+        std::mutex event_statistics_mutex_;
+        std::map<std::pair<std::type_index, std::string>, MessageDistributions> message_distributions_;
+        TimeDistribution event_memory_distribution_;
+        std::atomic<size_t> buffered_memory_peak_{0};
+
+        // Unused module instantiations excluded from the event loop
+        std::set<Module*> unused_modules_;
+
+        // Event filters evaluated before running the module instantiations
+        std::map<Module*, EventFilter> event_filters_;
+
+        // Sampling of the plots of the module instantiations, only stored if not all events are sampled or buffered
+        std::map<Module*, PlotSampling> plot_sampling_;
+
+        // Blocks of detector module chains executed concurrently within an event, indexed by their first module
+        std::map<Module*, DetectorChains> detector_chains_;
 
         // Possibility of running loaded modules in parallel
         bool can_parallelize_{true};
@@ -0,0 +1,31 @@
+/**
+ * @file
+ * @brief Implementation of the registry of the modules linked statically into the executable
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "ModuleRegistry.hpp"
+
+using namespace allpix;
+
+const StaticModule* ModuleRegistry::modules_ = nullptr;
+size_t ModuleRegistry::count_ = 0;
+
+void ModuleRegistry::registerModules(const StaticModule* modules, size_t count) {
+    modules_ = modules;
+    count_ = count;
+}
+
+const ModuleGenerator* ModuleRegistry::find(const std::string& name) {
+    for(size_t i = 0; i < count_; ++i) {
+        if(name == modules_[i].name) {
+            return &modules_[i].generator;
+        }
+    }
+    return nullptr;
+}
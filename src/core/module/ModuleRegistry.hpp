@@ -0,0 +1,94 @@
+/**
+ * @file
+ * @brief Registry of the modules linked statically into the executable
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef ALLPIX_MODULE_REGISTRY_H
+#define ALLPIX_MODULE_REGISTRY_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace allpix {
+    class Configuration;
+    class Detector;
+    class GeometryManager;
+    class Messenger;
+    class Module;
+
+    /**
+     * @brief Function instantiating a unique module
+     */
+    using UniqueModuleGenerator = Module* (*)(Configuration&, Messenger*, GeometryManager*);
+    /**
+     * @brief Function instantiating a detector module
+     */
+    using DetectorModuleGenerator = Module* (*)(Configuration&, Messenger*, std::shared_ptr<Detector>);
+
+    /**
+     * @brief Generator function of a module type, set either for unique or for detector modules
+     */
+    struct ModuleGenerator {
+        UniqueModuleGenerator unique{nullptr};
+        DetectorModuleGenerator detector{nullptr};
+
+        /**
+         * @brief Check if the module is instantiated once or once per detector
+         * @return True if the module is unique, false otherwise
+         */
+        bool isUnique() const { return unique != nullptr; }
+    };
+
+    /**
+     * @brief Entry of the table of modules linked into the executable
+     */
+    struct StaticModule {
+        const char* name;
+        ModuleGenerator generator;
+    };
+
+    /**
+     * @brief Registry of the modules linked statically into the executable
+     *
+     * In builds with the CMake option ALLPIX_STATIC_MODULES, the executable links all selected modules and registers the
+     * table of their generator functions, generated at configuration time, before the modules are loaded. The
+     * \ref ModuleManager then instantiates these modules directly and only falls back to loading the dynamic library for
+     * modules missing from the table.
+     */
+    class ModuleRegistry {
+    public:
+        /**
+         * @brief Register the table of modules linked into the executable
+         * @param modules Pointer to the first entry of the table
+         * @param count Number of entries of the table
+         * @warning The table has to stay valid for the lifetime of the program
+         */
+        static void registerModules(const StaticModule* modules, size_t count);
+
+        /**
+         * @brief Find a module linked into the executable
+         * @param name Name of the module
+         * @return Pointer to the generator of the module, or a null pointer if the module is not linked into the executable
+         */
+        static const ModuleGenerator* find(const std::string& name);
+
+    private:
+        static const StaticModule* modules_;
+        static size_t count_;
+    };
+
+    /**
+     * @brief Register the table of all modules linked into the executable
+     * @note Only defined in builds with the CMake option ALLPIX_STATIC_MODULES, in a source file generated by the build
+     */
+    void register_static_modules();
+} // namespace allpix
+
+#endif /* ALLPIX_MODULE_REGISTRY_H */
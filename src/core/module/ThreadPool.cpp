@@ -12,12 +12,15 @@
 #include "ThreadPool.hpp"
 
 #include <cassert>
+#include <cstdint>
+#include <utility>
 
 #include "Module.hpp"
 
 using namespace allpix;
 
-std::map<std::thread::id, unsigned int> ThreadPool::thread_nums_;
+thread_local size_t ThreadPool::worker_index_{SIZE_MAX};
+thread_local unsigned int ThreadPool::thread_num_{0};
 std::atomic_uint ThreadPool::thread_cnt_{1u};
 std::atomic_uint ThreadPool::thread_total_{1u};
 
@@ -36,14 +39,22 @@ ThreadPool::ThreadPool(unsigned int num_threads,
                        unsigned int max_queue_size,
                        unsigned int max_buffered_size,
                        const std::function<void()>& worker_init_function,
-                       const std::function<void()>& worker_finalize_function)
-    : queue_(max_queue_size, max_buffered_size) {
+                       const std::function<void()>& worker_finalize_function,
+                       Scheduler scheduler) {
     assert(max_buffered_size == 0 || max_buffered_size >= num_threads);
+    // Create the queue for the requested scheduling strategy
+    if(scheduler == Scheduler::WORK_STEALING) {
+        queue_ = std::make_unique<WorkStealingQueue<Task>>(num_threads, max_queue_size, max_buffered_size);
+    } else {
+        queue_ = std::make_unique<SafeQueue<Task>>(max_queue_size, max_buffered_size);
+    }
+
     // Create threads
     try {
         for(unsigned int i = 0u; i < num_threads; ++i) {
             threads_.emplace_back(&ThreadPool::worker,
                                   this,
+                                  i,
                                   std::min(num_threads, max_buffered_size),
                                   worker_init_function,
                                   worker_finalize_function);
@@ -67,7 +78,91 @@ ThreadPool::ThreadPool(unsigned int num_threads,
 
 ThreadPool::~ThreadPool() { destroy(); }
 
-void ThreadPool::markComplete(uint64_t n) { queue_.complete(n); }
+ThreadPool::JobPool::~JobPool() {
+    while(free_ != nullptr) {
+        delete std::exchange(free_, free_->next_);
+    }
+}
+
+ThreadPool::Job* ThreadPool::JobPool::acquire() {
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if(free_ != nullptr) {
+            return std::exchange(free_, free_->next_);
+        }
+    }
+    return new Job();
+}
+
+/**
+ * The task function is destroyed before taking the lock, as it can hold the last reference to objects such as events.
+ */
+void ThreadPool::JobPool::release(Job* job) {
+    if(job->destroy_ != nullptr) {
+        job->destroy_(job->storage_);
+        job->destroy_ = nullptr;
+    }
+    std::lock_guard<std::mutex> lock{mutex_};
+    job->next_ = free_;
+    free_ = job;
+}
+
+void ThreadPool::markComplete(uint64_t n) { queue_->complete(n); }
+
+/**
+ * The state of the task group is shared with the helper jobs, such that helpers which are only picked up after all tasks
+ * have been finished can still safely access it.
+ */
+void ThreadPool::parallelFor(size_t num_tasks, const std::function<void(size_t)>& func) {
+    struct TaskGroupState {
+        std::function<void(size_t)> func;
+        size_t num_tasks{0};
+        std::atomic_size_t next_task{0};
+        std::atomic_size_t finished_tasks{0};
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::exception_ptr exception{nullptr};
+    };
+    auto state = std::make_shared<TaskGroupState>();
+    state->func = func;
+    state->num_tasks = num_tasks;
+
+    // Claim and execute tasks until none are left
+    auto execute_tasks = [](const std::shared_ptr<TaskGroupState>& group) {
+        size_t task = 0;
+        while((task = group->next_task++) < group->num_tasks) {
+            try {
+                group->func(task);
+            } catch(...) {
+                std::lock_guard<std::mutex> lock{group->mutex};
+                if(!group->exception) {
+                    group->exception = std::current_exception();
+                }
+            }
+            if(++group->finished_tasks == group->num_tasks) {
+                std::lock_guard<std::mutex> lock{group->mutex};
+                group->condition.notify_all();
+            }
+        }
+    };
+
+    // Request help from other workers, the calling thread is working on the tasks as well
+    auto num_helpers = std::min(num_tasks > 0 ? num_tasks - 1 : 0, threads_.size());
+    for(size_t i = 0; i < num_helpers; ++i) {
+        if(!submitImmediate([state, execute_tasks]() { execute_tasks(state); })) {
+            break;
+        }
+    }
+
+    // Work on the tasks and wait for the ones started by other workers
+    execute_tasks(state);
+    std::unique_lock<std::mutex> lock{state->mutex};
+    state->condition.wait(lock, [&state]() { return state->finished_tasks == state->num_tasks; });
+
+    if(state->exception) {
+        std::rethrow_exception(state->exception);
+    }
+}
 
 void ThreadPool::checkException() {
     // If exception has been thrown, destroy pool and propagate it
@@ -86,14 +181,14 @@ void ThreadPool::wait() {
 /**
  * If an exception is thrown by a module, the first exception is saved to propagate in the main thread
  */
-void ThreadPool::worker(size_t min_thread_buffer,
+void ThreadPool::worker(size_t worker_index,
+                        size_t min_thread_buffer,
                         const std::function<void()>& initialize_function,
                         const std::function<void()>& finalize_function) {
     try {
         // Register the thread
-        unsigned int thread_num = thread_cnt_++;
-        assert(thread_num < thread_total_);
-        thread_nums_[std::this_thread::get_id()] = thread_num;
+        registerThread();
+        worker_index_ = worker_index;
 
         // Initialize the worker
         if(initialize_function) {
@@ -103,11 +198,11 @@ void ThreadPool::worker(size_t min_thread_buffer,
         while(!done_) {
             Task task{nullptr};
 
-            if(queue_.pop(task, min_thread_buffer)) {
-                // Execute task
+            if(queue_->pop(task, min_thread_buffer)) {
+                // Execute task, exceptions are propagated to the pool
                 (*task)();
-                // Fetch the future to propagate exceptions
-                task->get_future().get();
+                // Release the job before the task is accounted as finished
+                task.reset();
                 // Update the run count and propagate update
                 std::unique_lock<std::mutex> lock{run_mutex_};
                 if(--run_cnt_ == 0) {
@@ -127,7 +222,7 @@ void ThreadPool::worker(size_t min_thread_buffer,
             // Save the first exception
             exception_ptr_ = std::current_exception();
             // Invalidate the queue to terminate other threads
-            queue_.invalidate();
+            queue_->invalidate();
         }
         // Propagate that the worker terminated
         run_condition_.notify_all();
@@ -138,7 +233,9 @@ void ThreadPool::destroy() {
     // Lock run mutex to synchronize with queue
     std::unique_lock<std::mutex> lock{run_mutex_};
     done_ = true;
-    queue_.invalidate();
+    if(queue_) {
+        queue_->invalidate();
+    }
     run_condition_.notify_all();
     lock.unlock();
 
@@ -154,16 +251,17 @@ void ThreadPool::destroy() {
     }
 }
 
-bool ThreadPool::valid() { return queue_.valid() && !done_; }
+bool ThreadPool::valid() { return queue_->valid() && !done_; }
 
-unsigned int ThreadPool::threadNum() {
-    auto iter = thread_nums_.find(std::this_thread::get_id());
-    if(iter != thread_nums_.end()) {
-        return iter->second;
-    }
-    return 0;
-}
+unsigned int ThreadPool::threadNum() { return thread_num_; }
 
 unsigned int ThreadPool::threadCount() { return thread_total_; }
 
 void ThreadPool::registerThreadCount(unsigned int cnt) { thread_total_ += cnt; }
+
+void ThreadPool::registerThread() {
+    thread_num_ = thread_cnt_++;
+    assert(thread_num_ < thread_total_);
+}
+
+void ThreadPool::releaseThreadNumbers() { thread_cnt_ = 1u; }
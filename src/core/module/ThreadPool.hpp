@@ -14,15 +14,20 @@
 
 #include <algorithm>
 #include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
 #include <exception>
 #include <functional>
 #include <future>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <queue>
 #include <set>
 #include <thread>
 #include <utility>
+#include <vector>
 
 namespace allpix {
     /**
@@ -30,15 +35,24 @@ namespace allpix {
      */
     class ThreadPool {
     public:
+        /**
+         * @brief Scheduling strategy used to distribute the standard jobs to the workers
+         */
+        enum class Scheduler {
+            CENTRAL,       ///< Single queue shared by all workers and guarded by one mutex
+            WORK_STEALING, ///< Per-worker queues where idle workers steal jobs from busy ones
+        };
+
         /**
          * @brief Internal thread-safe queuing system
          *
-         * It internally consists of two separate queues
+         * It internally consists of three separate queues
          * - A standard queue pushed in order of jobs to process
          * - An ordered priority queue for work that need linear processing
+         * - An unbounded immediate queue for short jobs helping to finish work which is already in progress
          *
-         * The priority queue is popped if the top of the queue can be directly processed. Otherwise work is popped from the
-         * default queue unless the priority queue size is too large.
+         * The immediate queue is always popped first. The priority queue is popped if the top of the queue can be directly
+         * processed. Otherwise work is popped from the default queue unless the priority queue size is too large.
          */
         template <typename T> class SafeQueue {
         public:
@@ -52,7 +66,17 @@ namespace allpix {
             /**
              * @brief Erases the queue and release waiting threads on destruction
              */
-            ~SafeQueue() { invalidate(); };
+            virtual ~SafeQueue() { invalidate(); };
+
+            /// @{
+            /**
+             * @brief Copying or moving the queue is not allowed
+             */
+            SafeQueue(const SafeQueue&) = delete;
+            SafeQueue& operator=(const SafeQueue&) = delete;
+            SafeQueue(SafeQueue&&) = delete;
+            SafeQueue& operator=(SafeQueue&&) = delete;
+            /// @}
 
             /**
              * @brief Get the top value from the appropriate queue
@@ -60,7 +84,7 @@ namespace allpix {
              * @param buffer_left Optional number of jobs that should be left in priority buffer without stall on push
              * @return True if a task was acquired or false if pop was exited for another reason
              */
-            bool pop(T& out, size_t buffer_left = 0);
+            virtual bool pop(T& out, size_t buffer_left = 0);
 
             /**
              * @brief Push a new value onto the standard queue, will block if queue is full
@@ -68,7 +92,13 @@ namespace allpix {
              * @param wait If the push is allowed to stall if there is no capacity
              * @return If the push was successful
              */
-            bool push(T value, bool wait = true);
+            virtual bool push(T value, bool wait = true);
+            /**
+             * @brief Push a new value onto the immediate queue, never blocks
+             * @param value Value to push to the queue
+             * @return If the push was successful
+             */
+            bool pushImmediate(T value);
             /**
              * @brief Push a new value onto the priority queue
              * @param n Ordering identifier for the priority
@@ -100,13 +130,13 @@ namespace allpix {
              * @brief Return if all related queues are empty or not
              * @return True if queues are empty, false otherwise
              */
-            bool empty() const;
+            virtual bool empty() const;
 
             /**
              * @brief Return total size of values stored in both queues
              * @return Size of of the internal queues
              */
-            size_t size() const;
+            virtual size_t size() const;
 
             /**
              * @brief Return total size of values stored in both queues
@@ -117,9 +147,27 @@ namespace allpix {
             /**
              * @brief Invalidate the queue
              */
-            void invalidate();
+            virtual void invalidate();
+
+        protected:
+            /**
+             * @brief Check if the top of the priority queue can be processed, requires the mutex to be locked
+             * @return True if the priority queue holds the currently expected identifier
+             */
+            bool priority_ready() const { return !priority_queue_.empty() && priority_queue_.top().first == current_id_; }
+
+            /**
+             * @brief Pop the top of the priority queue, requires the mutex to be locked and \ref priority_ready to be true
+             * @param out Reference where the value at the top of the priority queue will be written to
+             */
+            void take_priority(T& out);
+
+            /**
+             * @brief Pop the front of the immediate queue, requires the mutex to be locked and the queue to be non-empty
+             * @param out Reference where the value at the front of the immediate queue will be written to
+             */
+            void take_immediate(T& out);
 
-        private:
             std::atomic_bool valid_{true};
             mutable std::mutex mutex_{};
             std::queue<T> queue_;
@@ -128,12 +176,126 @@ namespace allpix {
             using PQValue = std::pair<uint64_t, T>;
             std::priority_queue<PQValue, std::vector<PQValue>, std::greater<>> priority_queue_;
             std::atomic_size_t priority_queue_size_{0};
+            std::queue<T> immediate_queue_;
+            std::atomic_size_t immediate_queue_size_{0};
             std::condition_variable push_condition_;
             std::condition_variable pop_condition_;
             const size_t max_standard_size_;
             const size_t max_priority_size_;
         };
 
+        /**
+         * @brief Internal queuing system with one standard queue per worker
+         *
+         * Standard jobs are distributed over the per-worker queues, each guarded by its own mutex. Workers take jobs from
+         * their own queue first and steal from the queues of the other workers when it runs empty. Jobs submitted from
+         * outside of the pool are distributed round-robin, jobs submitted from a worker are added to the queue of this
+         * worker. The ordered priority queue and the completion bookkeeping are shared with \ref SafeQueue, such that
+         * buffered jobs keep their semantics. The shared mutex is only taken when the priority queue holds jobs or when a
+         * worker needs to go to sleep because no work is available.
+         *
+         * As long as jobs are buffered in the priority queue, workers always take the oldest standard job from any queue.
+         * This guarantees that the job the buffered jobs are waiting for is started before the priority buffer is full.
+         */
+        template <typename T> class WorkStealingQueue : public SafeQueue<T> {
+        public:
+            /**
+             * @brief Default constructor, initializes empty queues
+             * @param num_queues Number of per-worker queues (should be equal to the number of workers)
+             * @param max_standard_size Max total size of the per-worker queues
+             * @param max_priority_size Max size of the priority queue
+             */
+            WorkStealingQueue(unsigned int num_queues, unsigned int max_standard_size, unsigned int max_priority_size);
+
+            /**
+             * @brief Erases the queues and release waiting threads on destruction
+             */
+            ~WorkStealingQueue() override { invalidate(); };
+
+            /// @{
+            /**
+             * @brief Copying or moving the queue is not allowed
+             */
+            WorkStealingQueue(const WorkStealingQueue&) = delete;
+            WorkStealingQueue& operator=(const WorkStealingQueue&) = delete;
+            WorkStealingQueue(WorkStealingQueue&&) = delete;
+            WorkStealingQueue& operator=(WorkStealingQueue&&) = delete;
+            /// @}
+
+            /**
+             * @brief Get a value from the priority queue, the own queue of the calling worker or any other worker queue
+             * @param out Reference where the acquired value will be written to
+             * @param buffer_left Optional number of jobs that should be left in priority buffer without stall on push
+             * @return True if a task was acquired or false if pop was exited for another reason
+             */
+            bool pop(T& out, size_t buffer_left = 0) override;
+
+            /**
+             * @brief Push a new value onto one of the per-worker queues, will block if all queues are full
+             * @param value Value to push to the queue
+             * @param wait If the push is allowed to stall if there is no capacity
+             * @return If the push was successful
+             */
+            bool push(T value, bool wait = true) override;
+            using SafeQueue<T>::push;
+
+            /**
+             * @brief Return if all related queues are empty or not
+             * @return True if queues are empty, false otherwise
+             */
+            bool empty() const override;
+
+            /**
+             * @brief Return total size of values stored in all queues
+             * @return Size of of the internal queues
+             */
+            size_t size() const override;
+
+            /**
+             * @brief Invalidate the queues
+             */
+            void invalidate() override;
+
+        private:
+            /**
+             * @brief Try to take a value from the given per-worker queue without blocking on an empty queue
+             * @param idx Index of the per-worker queue
+             * @param out Reference where the value will be written to
+             * @return True if a value was taken from the queue
+             */
+            bool try_take(size_t idx, T& out);
+
+            /**
+             * @brief Try to take the oldest value from all per-worker queues
+             * @param out Reference where the value will be written to
+             * @return True if a value was taken from any of the queues
+             */
+            bool try_take_oldest(T& out);
+
+            /**
+             * @brief Try to acquire a job from the immediate queue, the priority queue or any of the per-worker queues
+             * @param out Reference where the value will be written to
+             * @param buffer_left Number of jobs that should be left in priority buffer
+             * @param priority Output parameter set to true if the job was taken from the priority queue
+             * @param immediate Output parameter set to true if the job was taken from the immediate queue
+             * @return True if a job was acquired
+             */
+            bool try_pop(T& out, size_t buffer_left, bool& priority, bool& immediate);
+
+            // Per-worker queue, aligned to avoid false sharing between the workers
+            struct alignas(64) WorkerQueue {
+                std::mutex mutex;
+                std::deque<std::pair<uint64_t, T>> tasks;
+            };
+            std::vector<WorkerQueue> queues_;
+
+            std::atomic_size_t standard_size_{0};
+            std::atomic_uint64_t next_sequence_{0};
+            std::atomic_size_t next_queue_{0};
+            std::atomic_uint sleeping_pop_{0};
+            std::atomic_uint sleeping_push_{0};
+        };
+
         /**
          * @brief Construct thread pool with provided number of threads without buffered jobs
          * @param num_threads Number of threads in the pool
@@ -154,13 +316,15 @@ namespace allpix {
          * @param max_buffered_size Maximum size of the buffered job queue (should be at least number of threads)
          * @param worker_init_function Function run by all the workers to initialize
          * @param worker_finalize_function Function run by all the workers to cleanup
+         * @param scheduler Scheduling strategy for the standard jobs
          * @warning Total count of threads need to be preregistered via \ref ThreadPool::registerThreadCount
          */
         ThreadPool(unsigned int num_threads,
                    unsigned int max_queue_size,
                    unsigned int max_buffered_size,
                    const std::function<void()>& worker_init_function = nullptr,
-                   const std::function<void()>& worker_finalize_function = nullptr);
+                   const std::function<void()>& worker_finalize_function = nullptr,
+                   Scheduler scheduler = Scheduler::CENTRAL);
 
         /// @{
         /**
@@ -188,6 +352,49 @@ namespace allpix {
          */
         template <typename Func, typename... Args> auto submit(uint64_t n, Func&& func, Args&&... args);
 
+        /**
+         * @brief Submit a standard job without tracking its result. In case no workers are registered, the function will be
+         * executed immediately.
+         * @param func Function to execute by the pool
+         * @return True if the job was submitted, false if the pool has been invalidated
+         *
+         * The function is stored in a job taken from the pool of reused jobs, such that no shared state or future has to be
+         * allocated. Exceptions thrown by the function are propagated via \ref ThreadPool::checkException.
+         */
+        template <typename Func> bool submitDetached(Func&& func);
+        /**
+         * @brief Submit a priority job without tracking its result. In case no workers are registered, the function will be
+         * executed immediately.
+         * @param n Priority identifier or UINT64_MAX for non-prioritized submission
+         * @param func Function to execute by the pool
+         * @return True if the job was submitted, false if the pool has been invalidated or the buffer is full
+         *
+         * @warning This function can only be called if thread pool was initialized with buffered jobs
+         */
+        template <typename Func> bool submitDetached(uint64_t n, Func&& func);
+
+        /**
+         * @brief Submit a job which is picked up by the next available worker before any queued job
+         * @param func Function to execute by the pool
+         * @return True if the job was submitted, false if the pool has no workers or has been invalidated
+         * @note These jobs bypass the capacity limit of the queues and should only be used for short work that helps to
+         * finish an event which is already in progress, see \ref ThreadPool::parallelFor
+         */
+        template <typename Func> bool submitImmediate(Func&& func);
+
+        /**
+         * @brief Execute a number of independent tasks, using the workers of the pool to share the work
+         * @param num_tasks Number of tasks to execute
+         * @param func Function to execute for every task index between zero and the number of tasks
+         *
+         * The calling thread takes part in the execution and only returns after all tasks have finished. Tasks are claimed
+         * from a shared counter, such that tasks not taken up by other workers are executed by the calling thread itself.
+         * The caller therefore never waits for queued work and this function can safely be called from within a job running
+         * on the pool. If any task throws, the first exception is rethrown in the calling thread after all started tasks
+         * finished. Without workers, all tasks are executed sequentially by the calling thread.
+         */
+        void parallelFor(size_t num_tasks, const std::function<void(size_t)>& func);
+
         /**
          * @brief Mark identifier as completed
          * @param n Identifier that is complete
@@ -198,19 +405,19 @@ namespace allpix {
          * @brief Get the lowest ID that is not completely processed yet
          * @return n Identifier that is not yet completed
          */
-        uint64_t minimumUncompleted() const { return queue_.currentId(); }
+        uint64_t minimumUncompleted() const { return queue_->currentId(); }
 
         /**
          * @brief Return the total number of enqueued jobs
          * @return The number of enqueued jobs
          */
-        size_t queueSize() const { return queue_.size(); }
+        size_t queueSize() const { return queue_->size(); }
 
         /**
          * @brief Return the number of jobs in buffered priority queue
          * @return The number of enqueued jobs in the buffered queue
          */
-        size_t bufferedQueueSize() const { return queue_.prioritySize(); }
+        size_t bufferedQueueSize() const { return queue_->prioritySize(); }
 
         /**
          * @brief Check if any worker thread has thrown an exception
@@ -256,20 +463,105 @@ namespace allpix {
          */
         static void registerThreadCount(unsigned int cnt);
 
+        /**
+         * @brief Assign the next unique thread number to the calling thread
+         * @note Threads created by the pool register themselves, this is only required for threads created elsewhere
+         * @warning The thread needs to be preregistered via \ref ThreadPool::registerThreadCount
+         */
+        static void registerThread();
+
+        /**
+         * @brief Release all thread numbers assigned so far, such that the threads of the next pool reuse them
+         * @warning Should only be called while no threads other than the main thread hold a thread number
+         */
+        static void releaseThreadNumbers();
+
     private:
         /**
          * @brief Constantly running internal function each thread uses to acquire work items from the queue.
+         * @param worker_index        Index of this worker within the pool
          * @param min_thread_buffer   Minimum buffer size to keep available without stall on push
          * @param initialize_function Function to initialize the thread
          * @param finalize_function   Function to finalize the thread
          */
-        void worker(size_t min_thread_buffer,
+        void worker(size_t worker_index,
+                    size_t min_thread_buffer,
                     const std::function<void()>& initialize_function,
                     const std::function<void()>& finalize_function);
 
-        // The queue holds the task functions to be executed by the workers
-        using Task = std::unique_ptr<std::packaged_task<void()>>;
-        SafeQueue<Task> queue_;
+        /**
+         * @brief Job holding a task function, reused for following tasks after it has been executed
+         *
+         * Functions fitting into the storage of the job are constructed in place, larger ones are allocated separately.
+         * Released jobs are linked into the free list of the \ref JobPool they were taken from.
+         */
+        struct Job {
+            /**
+             * @brief Execute the task function of the job
+             */
+            void operator()() { invoke_(storage_); }
+
+            static constexpr size_t storage_size = 192;
+            alignas(std::max_align_t) unsigned char storage_[storage_size]{};
+            void (*invoke_)(void*){};
+            void (*destroy_)(void*){};
+            Job* next_{};
+        };
+
+        /**
+         * @brief Free list of the jobs released after their execution
+         */
+        class JobPool {
+        public:
+            JobPool() = default;
+            ~JobPool();
+
+            /// @{
+            /**
+             * @brief Copying or moving the pool is not allowed
+             */
+            JobPool(const JobPool&) = delete;
+            JobPool& operator=(const JobPool&) = delete;
+            JobPool(JobPool&&) = delete;
+            JobPool& operator=(JobPool&&) = delete;
+            /// @}
+
+            /**
+             * @brief Take a job from the free list or allocate a new one if none is available
+             * @return Job without task function
+             */
+            Job* acquire();
+
+            /**
+             * @brief Destroy the task function of a job and add the job to the free list
+             * @param job Job to release
+             */
+            void release(Job* job);
+
+        private:
+            std::mutex mutex_;
+            Job* free_{};
+        };
+
+        /**
+         * @brief Deleter returning a job to its pool
+         */
+        struct JobRelease {
+            JobPool* pool{};
+            void operator()(Job* job) const { pool->release(job); }
+        };
+
+        /**
+         * @brief Wrap a task function into a job from the pool
+         * @param func Function to execute by the job
+         * @return Handle to the job, which is released to the pool when it goes out of scope
+         */
+        template <typename Func> auto make_job(Func&& func);
+
+        // The queue holds the task functions to be executed by the workers, the pool of their jobs has to outlive it
+        using Task = std::unique_ptr<Job, JobRelease>;
+        JobPool job_pool_;
+        std::unique_ptr<SafeQueue<Task>> queue_;
         bool with_buffered_{true};
         std::function<void()> finalize_function_{};
 
@@ -283,7 +575,11 @@ namespace allpix {
         std::atomic_flag has_exception_{false};
         std::exception_ptr exception_ptr_{nullptr};
 
-        static std::map<std::thread::id, unsigned int> thread_nums_;
+        // Index of the current thread within the pool it is working for
+        static thread_local size_t worker_index_;
+
+        // Unique number of the current thread, zero for unregistered threads
+        static thread_local unsigned int thread_num_;
         static std::atomic_uint thread_cnt_;
         static std::atomic_uint thread_total_;
     };
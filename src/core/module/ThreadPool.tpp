@@ -11,6 +11,8 @@
 
 #include <cassert>
 #include <climits>
+#include <new>
+#include <type_traits>
 
 namespace allpix {
     template <typename T>
@@ -31,24 +33,25 @@ namespace allpix {
         }
 
         // Wait for one of the queues to be available
-        bool pop_priority = !priority_queue_.empty() && priority_queue_.top().first == current_id_;
+        bool pop_immediate = !immediate_queue_.empty();
+        bool pop_priority = priority_ready();
         bool pop_standard = !queue_.empty() && priority_queue_.size() + buffer_left <= max_priority_size_;
-        while(!pop_priority && !pop_standard) {
+        while(!pop_immediate && !pop_priority && !pop_standard) {
             // Wait for new item in the queue (unlocks the mutex while waiting)
             pop_condition_.wait(lock);
             if(!valid_) {
                 return false;
             }
-            pop_priority = !priority_queue_.empty() && priority_queue_.top().first == current_id_;
+            pop_immediate = !immediate_queue_.empty();
+            pop_priority = priority_ready();
             pop_standard = !queue_.empty() && priority_queue_.size() + buffer_left <= max_priority_size_;
         }
 
         // Pop the appropriate queue
-        if(pop_priority) {
-            // Priority queue is missing a pop returning a non-const reference, so need to apply a const_cast
-            out = std::move(const_cast<PQValue&>(priority_queue_.top())).second; // NOLINT
-            priority_queue_.pop();
-            priority_queue_size_--;
+        if(pop_immediate) {
+            take_immediate(out);
+        } else if(pop_priority) {
+            take_priority(out);
         } else { // pop_standard
             out = std::move(queue_.front());
             queue_.pop();
@@ -59,11 +62,40 @@ namespace allpix {
         if(pop_priority) {
             pop_condition_.notify_one();
         }
-        push_condition_.notify_one();
+        if(!pop_immediate) {
+            push_condition_.notify_one();
+        }
         return true;
     }
 #pragma GCC diagnostic pop
 
+    template <typename T> void ThreadPool::SafeQueue<T>::take_priority(T& out) {
+        // Priority queue is missing a pop returning a non-const reference, so need to apply a const_cast
+        out = std::move(const_cast<PQValue&>(priority_queue_.top())).second; // NOLINT
+        priority_queue_.pop();
+        priority_queue_size_--;
+    }
+
+    template <typename T> void ThreadPool::SafeQueue<T>::take_immediate(T& out) {
+        out = std::move(immediate_queue_.front());
+        immediate_queue_.pop();
+        immediate_queue_size_--;
+    }
+
+    template <typename T> bool ThreadPool::SafeQueue<T>::pushImmediate(T value) {
+        std::unique_lock<std::mutex> lock{mutex_};
+        if(!valid_) {
+            return false;
+        }
+
+        // Push a new element to the queue and notify possible consumer
+        immediate_queue_.push(std::move(value));
+        immediate_queue_size_++;
+        lock.unlock();
+        pop_condition_.notify_one();
+        return true;
+    }
+
     template <typename T> bool ThreadPool::SafeQueue<T>::push(T value, bool wait) {
         // Lock the mutex
         std::unique_lock<std::mutex> lock{mutex_};
@@ -127,11 +159,13 @@ namespace allpix {
             if(*iter != current_id_) {
                 return;
             }
-            iter = completed_ids_.erase(iter);
+            completed_ids_.erase(iter);
             ++current_id_;
             lock.unlock();
             pop_condition_.notify_one();
             lock.lock();
+            // Other threads might have modified the set while the mutex was released
+            iter = completed_ids_.begin();
         }
     }
 
@@ -147,12 +181,12 @@ namespace allpix {
 
     template <typename T> bool ThreadPool::SafeQueue<T>::empty() const {
         std::lock_guard<std::mutex> lock{mutex_};
-        return !valid_ || (queue_.empty() && priority_queue_.empty());
+        return !valid_ || (queue_.empty() && priority_queue_.empty() && immediate_queue_.empty());
     }
 
     template <typename T> size_t ThreadPool::SafeQueue<T>::size() const {
         std::lock_guard<std::mutex> lock{mutex_};
-        return queue_.size() + priority_queue_.size();
+        return queue_.size() + priority_queue_.size() + immediate_queue_.size();
     }
 
     template <typename T> size_t ThreadPool::SafeQueue<T>::prioritySize() const { return priority_queue_size_; }
@@ -166,12 +200,263 @@ namespace allpix {
         std::priority_queue<PQValue, std::vector<PQValue>, std::greater<>>().swap(priority_queue_);
         priority_queue_size_ = 0;
         std::queue<T>().swap(queue_);
+        std::queue<T>().swap(immediate_queue_);
+        immediate_queue_size_ = 0;
         valid_ = false;
         lock.unlock();
         push_condition_.notify_all();
         pop_condition_.notify_all();
     }
 
+    template <typename T>
+    ThreadPool::WorkStealingQueue<T>::WorkStealingQueue(unsigned int num_queues,
+                                                        unsigned int max_standard_size,
+                                                        unsigned int max_priority_size)
+        : SafeQueue<T>(max_standard_size, max_priority_size), queues_(std::max(num_queues, 1u)) {}
+
+    template <typename T> bool ThreadPool::WorkStealingQueue<T>::try_take(size_t idx, T& out) {
+        auto& queue = queues_[idx];
+        std::lock_guard<std::mutex> lock{queue.mutex};
+        if(queue.tasks.empty()) {
+            return false;
+        }
+        // Always take the oldest job, such that events are started roughly in order of submission
+        out = std::move(queue.tasks.front().second);
+        queue.tasks.pop_front();
+        standard_size_--;
+        return true;
+    }
+
+    template <typename T> bool ThreadPool::WorkStealingQueue<T>::try_take_oldest(T& out) {
+        while(standard_size_ > 0) {
+            // Find the queue holding the oldest job
+            auto oldest_idx = queues_.size();
+            uint64_t oldest_sequence = 0;
+            for(size_t idx = 0; idx < queues_.size(); ++idx) {
+                std::lock_guard<std::mutex> lock{queues_[idx].mutex};
+                if(!queues_[idx].tasks.empty() &&
+                   (oldest_idx == queues_.size() || queues_[idx].tasks.front().first < oldest_sequence)) {
+                    oldest_idx = idx;
+                    oldest_sequence = queues_[idx].tasks.front().first;
+                }
+            }
+            if(oldest_idx == queues_.size()) {
+                return false;
+            }
+
+            // Take it unless another worker was faster, search again otherwise
+            auto& queue = queues_[oldest_idx];
+            std::lock_guard<std::mutex> lock{queue.mutex};
+            if(!queue.tasks.empty() && queue.tasks.front().first == oldest_sequence) {
+                out = std::move(queue.tasks.front().second);
+                queue.tasks.pop_front();
+                standard_size_--;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template <typename T>
+    bool ThreadPool::WorkStealingQueue<T>::try_pop(T& out, size_t buffer_left, bool& priority, bool& immediate) {
+        // Only take the shared lock if the immediate or priority queue holds any job
+        if(this->immediate_queue_size_ > 0 || this->priority_queue_size_ > 0) {
+            std::lock_guard<std::mutex> lock{this->mutex_};
+            if(!this->immediate_queue_.empty()) {
+                this->take_immediate(out);
+                immediate = true;
+                return true;
+            }
+            if(this->priority_ready()) {
+                this->take_priority(out);
+                priority = true;
+                return true;
+            }
+        }
+
+        // Respect the requested space left in the priority buffer before starting new jobs
+        if(this->priority_queue_size_ + buffer_left > this->max_priority_size_ || standard_size_ == 0) {
+            return false;
+        }
+
+        // Buffered jobs might wait for the oldest job, which therefore has to be started first
+        if(this->priority_queue_size_ > 0) {
+            priority = false;
+            return try_take_oldest(out);
+        }
+
+        // Start with the own queue of the calling worker and steal from the others otherwise
+        auto own = (worker_index_ < queues_.size() ? worker_index_ : 0);
+        for(size_t i = 0; i < queues_.size(); ++i) {
+            if(try_take((own + i) % queues_.size(), out)) {
+                priority = false;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /*
+     * Only block if no job can be acquired from any queue. A worker announces that it is going to sleep before checking the
+     * queues for a last time, while pushing threads announce new jobs before checking for sleeping workers. This ensures
+     * that at least one of them observes the other and no wake-up is lost, without requiring the shared mutex on every push.
+     */
+    template <typename T> bool ThreadPool::WorkStealingQueue<T>::pop(T& out, size_t buffer_left) {
+        assert(buffer_left <= this->max_priority_size_);
+        if(!this->valid_) {
+            return false;
+        }
+
+        bool priority = false;
+        bool immediate = false;
+        bool success = try_pop(out, buffer_left, priority, immediate);
+        while(!success) {
+            std::unique_lock<std::mutex> lock{this->mutex_};
+            sleeping_pop_++;
+            this->pop_condition_.wait(lock, [&]() {
+                if(!this->valid_) {
+                    return true;
+                }
+                return !this->immediate_queue_.empty() || this->priority_ready() ||
+                       (standard_size_ > 0 && this->priority_queue_size_ + buffer_left <= this->max_priority_size_);
+            });
+            sleeping_pop_--;
+            if(!this->valid_) {
+                return false;
+            }
+            lock.unlock();
+            success = try_pop(out, buffer_left, priority, immediate);
+        }
+
+        // Notify possible pusher waiting to fill the queue
+        if(immediate) {
+            return true;
+        } else if(priority) {
+            this->pop_condition_.notify_one();
+            this->push_condition_.notify_one();
+        } else if(sleeping_push_ > 0) {
+            std::lock_guard<std::mutex> lock{this->mutex_};
+            this->push_condition_.notify_one();
+        }
+        return true;
+    }
+
+    template <typename T> bool ThreadPool::WorkStealingQueue<T>::push(T value, bool wait) {
+        // Reserve a slot in the queues, waiting until there is capacity or the queue was invalidated
+        auto reserved = standard_size_++;
+        while(reserved >= this->max_standard_size_) {
+            standard_size_--;
+            if(!wait) {
+                return false;
+            }
+            std::unique_lock<std::mutex> lock{this->mutex_};
+            sleeping_push_++;
+            this->push_condition_.wait(
+                lock, [this]() { return standard_size_ < this->max_standard_size_ || !this->valid_; });
+            sleeping_push_--;
+            if(!this->valid_) {
+                return false;
+            }
+            lock.unlock();
+            reserved = standard_size_++;
+        }
+        if(!this->valid_) {
+            standard_size_--;
+            return false;
+        }
+        auto sequence = next_sequence_++;
+
+        // Jobs from workers stay local, external jobs are distributed over all workers
+        auto idx = (worker_index_ < queues_.size() ? worker_index_ : next_queue_++ % queues_.size());
+        {
+            std::lock_guard<std::mutex> lock{queues_[idx].mutex};
+            queues_[idx].tasks.emplace_back(sequence, std::move(value));
+        }
+
+        // Wake up a sleeping worker if any
+        if(sleeping_pop_ > 0) {
+            std::lock_guard<std::mutex> lock{this->mutex_};
+            this->pop_condition_.notify_one();
+        }
+        return true;
+    }
+
+    template <typename T> bool ThreadPool::WorkStealingQueue<T>::empty() const {
+        return !this->valid_ ||
+               (standard_size_ == 0 && this->priority_queue_size_ == 0 && this->immediate_queue_size_ == 0);
+    }
+
+    template <typename T> size_t ThreadPool::WorkStealingQueue<T>::size() const {
+        return standard_size_ + this->priority_queue_size_ + this->immediate_queue_size_;
+    }
+
+    template <typename T> void ThreadPool::WorkStealingQueue<T>::invalidate() {
+        for(auto& queue : queues_) {
+            std::lock_guard<std::mutex> lock{queue.mutex};
+            std::deque<std::pair<uint64_t, T>>().swap(queue.tasks);
+        }
+        standard_size_ = 0;
+        SafeQueue<T>::invalidate();
+    }
+
+    template <typename Func> auto ThreadPool::make_job(Func&& func) {
+        using Function = std::decay_t<Func>;
+        Task job(job_pool_.acquire(), JobRelease{&job_pool_});
+        if constexpr(sizeof(Function) <= Job::storage_size && alignof(Function) <= alignof(std::max_align_t)) {
+            new(job->storage_) Function(std::forward<Func>(func));
+            job->invoke_ = [](void* storage) { (*static_cast<Function*>(storage))(); };
+            job->destroy_ = [](void* storage) { static_cast<Function*>(storage)->~Function(); };
+        } else {
+            new(job->storage_) Function*(new Function(std::forward<Func>(func)));
+            job->invoke_ = [](void* storage) { (**static_cast<Function**>(storage))(); };
+            job->destroy_ = [](void* storage) { delete *static_cast<Function**>(storage); };
+        }
+        return job;
+    }
+
+    template <typename Func> bool ThreadPool::submitImmediate(Func&& func) {
+        if(threads_.empty()) {
+            return false;
+        }
+
+        // Account for the job before pushing it, such that a fast worker cannot finish it before it is counted
+        {
+            std::unique_lock<std::mutex> lock{run_mutex_};
+            ++run_cnt_;
+        }
+        if(!queue_->pushImmediate(make_job(std::forward<Func>(func)))) {
+            std::unique_lock<std::mutex> lock{run_mutex_};
+            if(--run_cnt_ == 0) {
+                run_condition_.notify_all();
+            }
+            return false;
+        }
+        return true;
+    }
+
+    template <typename Func> bool ThreadPool::submitDetached(Func&& func) {
+        return submitDetached(UINT64_MAX, std::forward<Func>(func));
+    }
+
+    template <typename Func> bool ThreadPool::submitDetached(uint64_t n, Func&& func) {
+        assert(n == UINT64_MAX || with_buffered_);
+        if(threads_.empty()) {
+            func();
+            return true;
+        }
+
+        bool success = false;
+        if(n == UINT64_MAX) {
+            success = queue_->push(make_job(std::forward<Func>(func)), true);
+        } else {
+            success = queue_->push(n, make_job(std::forward<Func>(func)), false);
+        }
+        // Increment run count:
+        std::unique_lock<std::mutex> lock{run_mutex_};
+        ++run_cnt_;
+        return success;
+    }
+
     template <typename Func, typename... Args> auto ThreadPool::submit(Func&& func, Args&&... args) {
         return submit(UINT64_MAX, std::forward<Func>(func), std::forward<Args>(args)...);
     }
@@ -185,7 +470,7 @@ namespace allpix {
         using PackagedTask = std::packaged_task<decltype(bound_task())()>;
         PackagedTask task(bound_task);
 
-        // Get future and wrapper to add to vector
+        // Get future and wrapper to add to vector, fetching the future propagates exceptions to the worker
         auto future = task.get_future().share();
         auto task_function = [task = std::move(task), future = future]() mutable {
             task();
@@ -196,9 +481,9 @@ namespace allpix {
             task_function();
         } else {
             if(n == UINT64_MAX) {
-                success = queue_.push(std::make_unique<std::packaged_task<void()>>(std::move(task_function)), true);
+                success = queue_->push(make_job(std::move(task_function)), true);
             } else {
-                success = queue_.push(n, std::make_unique<std::packaged_task<void()>>(std::move(task_function)), false);
+                success = queue_->push(n, make_job(std::move(task_function)), false);
             }
             // Increment run count:
             std::unique_lock<std::mutex> lock{run_mutex_};
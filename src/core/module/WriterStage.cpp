@@ -0,0 +1,120 @@
+/**
+ * @file
+ * @brief Implementation of the dedicated writer stage
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "WriterStage.hpp"
+
+#include <utility>
+
+#include "ThreadPool.hpp"
+
+using namespace allpix;
+
+WriterStage::WriterStage(std::function<uint64_t()> sequence_function,
+                         const std::function<void()>& initialize_function,
+                         const std::function<void()>& finalize_function)
+    : sequence_function_(std::move(sequence_function)) {
+    thread_ = std::thread(&WriterStage::worker, this, initialize_function, finalize_function);
+}
+
+WriterStage::~WriterStage() {
+    std::unique_lock<std::mutex> lock{mutex_};
+    done_ = true;
+    jobs_.clear();
+    condition_.notify_all();
+    lock.unlock();
+
+    if(thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void WriterStage::push(uint64_t n, std::function<void()> func) {
+    std::lock_guard<std::mutex> lock{mutex_};
+    jobs_.emplace(n, std::move(func));
+    condition_.notify_one();
+}
+
+void WriterStage::notify() {
+    std::lock_guard<std::mutex> lock{mutex_};
+    condition_.notify_one();
+}
+
+void WriterStage::waitForSpace(size_t limit, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock{mutex_};
+    space_condition_.wait_for(lock, timeout, [this, limit]() { return jobs_.size() < limit || done_; });
+}
+
+size_t WriterStage::size() const {
+    std::lock_guard<std::mutex> lock{mutex_};
+    return jobs_.size();
+}
+
+void WriterStage::checkException() {
+    if(has_exception_) {
+        std::rethrow_exception(exception_ptr_);
+    }
+}
+
+/**
+ * Only the jobs continuing the sequence are executed, jobs waiting for an identifier which is never completed (for example
+ * after an interrupted run) are dropped when the stage is destroyed.
+ */
+void WriterStage::finish() {
+    std::unique_lock<std::mutex> lock{mutex_};
+    done_ = true;
+    condition_.notify_all();
+    lock.unlock();
+
+    if(thread_.joinable()) {
+        thread_.join();
+    }
+    checkException();
+}
+
+/**
+ * If a job throws an exception, it is saved to be propagated to the main thread and the stage stops executing jobs
+ */
+void WriterStage::worker(const std::function<void()>& initialize_function,
+                         const std::function<void()>& finalize_function) {
+    try {
+        ThreadPool::registerThread();
+
+        if(initialize_function) {
+            initialize_function();
+        }
+
+        auto ready = [this]() { return !jobs_.empty() && jobs_.begin()->first == sequence_function_(); };
+        while(true) {
+            std::function<void()> job;
+
+            std::unique_lock<std::mutex> lock{mutex_};
+            condition_.wait(lock, [this, &ready]() { return done_ || ready(); });
+            if(!ready()) {
+                break;
+            }
+            job = std::move(jobs_.begin()->second);
+            jobs_.erase(jobs_.begin());
+            space_condition_.notify_all();
+            lock.unlock();
+
+            job();
+        }
+
+        if(finalize_function) {
+            finalize_function();
+        }
+    } catch(...) {
+        std::lock_guard<std::mutex> lock{mutex_};
+        exception_ptr_ = std::current_exception();
+        has_exception_ = true;
+        space_condition_.notify_all();
+    }
+}
@@ -0,0 +1,124 @@
+/**
+ * @file
+ * @brief Dedicated thread executing the sequential modules at the end of the module chain in event order
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef ALLPIX_MODULE_WRITER_STAGE_H
+#define ALLPIX_MODULE_WRITER_STAGE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace allpix {
+    /**
+     * @brief Executes jobs on a single dedicated thread in the order of their identifiers
+     *
+     * Jobs handed to the stage are kept in a reorder buffer sorted by their identifier. The job with the lowest identifier
+     * is started as soon as it equals the identifier returned by the sequence function, i.e. when all jobs before it have
+     * been completed. Workers handing off their jobs therefore never wait for the stage.
+     */
+    class WriterStage {
+    public:
+        /**
+         * @brief Construct the stage and start its thread
+         * @param sequence_function   Function returning the identifier of the next job to execute
+         * @param initialize_function Function to initialize the thread
+         * @param finalize_function   Function to finalize the thread
+         * @warning The thread needs to be preregistered via \ref ThreadPool::registerThreadCount
+         */
+        WriterStage(std::function<uint64_t()> sequence_function,
+                    const std::function<void()>& initialize_function,
+                    const std::function<void()>& finalize_function);
+
+        /// @{
+        /**
+         * @brief Copying or moving the stage is not allowed
+         */
+        WriterStage(const WriterStage&) = delete;
+        WriterStage& operator=(const WriterStage&) = delete;
+        WriterStage(WriterStage&&) = delete;
+        WriterStage& operator=(WriterStage&&) = delete;
+        /// @}
+
+        /**
+         * @brief Stop the thread, dropping all jobs which could not be executed yet
+         */
+        ~WriterStage();
+
+        /**
+         * @brief Hand off a job to the stage
+         * @param n Identifier of the job
+         * @param func Function to execute on the stage thread
+         */
+        void push(uint64_t n, std::function<void()> func);
+
+        /**
+         * @brief Inform the stage that the sequence has advanced
+         * @note Should be called after every job completion to wake up the thread waiting for its next job
+         */
+        void notify();
+
+        /**
+         * @brief Wait until the number of jobs in the reorder buffer drops below a limit
+         * @param limit Maximum number of buffered jobs
+         * @param timeout Maximum duration to wait
+         */
+        void waitForSpace(size_t limit, std::chrono::milliseconds timeout);
+
+        /**
+         * @brief Return the number of jobs in the reorder buffer
+         */
+        size_t size() const;
+
+        /**
+         * @brief Check if the calling thread is the thread of this stage
+         */
+        bool isStageThread() const { return std::this_thread::get_id() == thread_.get_id(); }
+
+        /**
+         * @brief Check if a job executed by the stage has thrown an exception
+         * @throw Exception thrown by a job, if any
+         */
+        void checkException();
+
+        /**
+         * @brief Execute all remaining jobs which can be started and stop the thread
+         * @throw Exception thrown by a job, if any
+         */
+        void finish();
+
+    private:
+        /**
+         * @brief Function executed by the stage thread
+         */
+        void worker(const std::function<void()>& initialize_function, const std::function<void()>& finalize_function);
+
+        std::function<uint64_t()> sequence_function_;
+
+        std::map<uint64_t, std::function<void()>> jobs_;
+        mutable std::mutex mutex_;
+        std::condition_variable condition_;
+        std::condition_variable space_condition_;
+        bool done_{false};
+
+        std::atomic_bool has_exception_{false};
+        std::exception_ptr exception_ptr_{nullptr};
+
+        std::thread thread_;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_MODULE_WRITER_STAGE_H */
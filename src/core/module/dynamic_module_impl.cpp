@@ -7,6 +7,10 @@
  * - ALLPIX_MODULE_HEADER: name of the header defining the module
  * - ALLPIX_MODULE_UNIQUE: true if the module is unique, false otherwise
  *
+ * In builds linking the modules statically into the executable, ALLPIX_MODULE_STATIC is defined as well. The interface
+ * functions are then suffixed with the name of the module to keep them unique, and referenced from the table of modules
+ * generated by the build system instead of being resolved from the library at runtime.
+ *
  * @copyright Copyright (c) 2017-2024 CERN and the Allpix Squared authors.
  * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
  * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
@@ -27,6 +31,15 @@
 
 #include ALLPIX_MODULE_HEADER
 
+// Name of the interface functions, suffixed with the module name if all modules are linked into the same executable
+#ifdef ALLPIX_MODULE_STATIC
+#define ALLPIX_MODULE_FUNCTION_CONCAT(function, module) function##_##module
+#define ALLPIX_MODULE_FUNCTION_EXPAND(function, module) ALLPIX_MODULE_FUNCTION_CONCAT(function, module)
+#define ALLPIX_MODULE_FUNCTION(function) ALLPIX_MODULE_FUNCTION_EXPAND(function, ALLPIX_MODULE_NAME)
+#else
+#define ALLPIX_MODULE_FUNCTION(function) function
+#endif
+
 namespace allpix {
     class Messenger;
     class GeometryManager;
@@ -37,7 +50,7 @@ namespace allpix {
      *
      * Used by the ModuleManager to determine if it should instantiate a single module or modules per detector instead.
      */
-    bool allpix_module_is_unique();
+    bool ALLPIX_MODULE_FUNCTION(allpix_module_is_unique)();
 
 #if ALLPIX_MODULE_UNIQUE || defined(DOXYGEN)
     /**
@@ -50,14 +63,18 @@ namespace allpix {
      * Internal method for the dynamic loading in the ModuleManager. Forwards the supplied arguments to the constructor and
      * returns an instantiation.
      */
-    Module* allpix_module_generator(Configuration& config, Messenger* messenger, GeometryManager* geo_manager);
-    Module* allpix_module_generator(Configuration& config, Messenger* messenger, GeometryManager* geo_manager) {
+    Module* ALLPIX_MODULE_FUNCTION(allpix_module_generator)(Configuration& config,
+                                                            Messenger* messenger,
+                                                            GeometryManager* geo_manager);
+    Module* ALLPIX_MODULE_FUNCTION(allpix_module_generator)(Configuration& config,
+                                                            Messenger* messenger,
+                                                            GeometryManager* geo_manager) {
         auto module = new ALLPIX_MODULE_NAME(config, messenger, geo_manager); // NOLINT
         return static_cast<Module*>(module);
     }
 
     // Returns that is a unique module
-    bool allpix_module_is_unique() { return true; }
+    bool ALLPIX_MODULE_FUNCTION(allpix_module_is_unique)() { return true; }
 #endif
 
 #if !ALLPIX_MODULE_UNIQUE || defined(DOXYGEN)
@@ -71,15 +88,18 @@ namespace allpix {
      * Internal method for the dynamic loading in the ModuleManager. Forwards the supplied arguments to the constructor and
      * returns an instantiation
      */
-    Module* allpix_module_generator(Configuration& config, Messenger* messenger, std::shared_ptr<Detector> detector);
-    Module*
-    allpix_module_generator(Configuration& config, Messenger* messenger, std::shared_ptr<Detector> detector) { // NOLINT
-        auto module = new ALLPIX_MODULE_NAME(config, messenger, std::move(detector));                          // NOLINT
+    Module* ALLPIX_MODULE_FUNCTION(allpix_module_generator)(Configuration& config,
+                                                            Messenger* messenger,
+                                                            std::shared_ptr<Detector> detector);
+    Module* ALLPIX_MODULE_FUNCTION(allpix_module_generator)(Configuration& config,
+                                                            Messenger* messenger,
+                                                            std::shared_ptr<Detector> detector) { // NOLINT
+        auto module = new ALLPIX_MODULE_NAME(config, messenger, std::move(detector));             // NOLINT
         return static_cast<Module*>(module);
     }
 
     // Returns that is a detector module
-    bool allpix_module_is_unique() { return false; }
+    bool ALLPIX_MODULE_FUNCTION(allpix_module_is_unique)() { return false; }
 #endif
     }
 } // namespace allpix
@@ -12,18 +12,98 @@
 #ifndef ALLPIX_RANDOM_DISTRIBUTIONS_H
 #define ALLPIX_RANDOM_DISTRIBUTIONS_H
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include <boost/random/binomial_distribution.hpp>
 #include <boost/random/exponential_distribution.hpp>
 #include <boost/random/normal_distribution.hpp>
 #include <boost/random/piecewise_linear_distribution.hpp>
 #include <boost/random/poisson_distribution.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
 #include <boost/random/uniform_real_distribution.hpp>
 
 namespace allpix {
+    template <typename T> using binomial_distribution = boost::random::binomial_distribution<T>;
     template <typename T> using normal_distribution = boost::random::normal_distribution<T>;
     template <typename T> using piecewise_linear_distribution = boost::random::piecewise_linear_distribution<T>;
     template <typename T> using poisson_distribution = boost::random::poisson_distribution<T>;
+    template <typename T> using uniform_int_distribution = boost::random::uniform_int_distribution<T>;
     template <typename T> using uniform_real_distribution = boost::random::uniform_real_distribution<T>;
     template <typename T> using exponential_distribution = boost::random::exponential_distribution<T>;
+
+    /**
+     * @brief Normal distribution filling buffers of values at once
+     *
+     * The raw 64-bit numbers for a block of values are retrieved from the engine at once, using the bulk generation of the
+     * engine if available, and converted to uniform values in (0, 1] with 53 bits of precision. These are transformed into
+     * normally distributed values pairwise with the Box-Muller transform, in loops without branches which the compiler can
+     * vectorize. The values only depend on the state of the engine, such that they are reproducible for a given seed, but
+     * differ from those of \ref normal_distribution. For an odd number of values, the last value of the last pair is
+     * discarded.
+     */
+    template <typename T> class normal_batch_distribution {
+    public:
+        /**
+         * @brief Construct the distribution
+         * @param mean Mean of the distribution
+         * @param stddev Standard deviation of the distribution
+         */
+        explicit normal_batch_distribution(T mean = 0, T stddev = 1) : mean_(mean), stddev_(stddev) {}
+
+        /**
+         * @brief Fill a buffer with values drawn from the distribution
+         * @param engine Random number engine with 64-bit results
+         * @param values Storage for the values
+         * @param count Number of values to draw
+         */
+        template <typename Engine> void operator()(Engine& engine, T* values, size_t count) const {
+            static_assert(sizeof(typename Engine::result_type) == sizeof(std::uint64_t),
+                          "engine has to yield 64-bit values");
+
+            std::array<std::uint64_t, block_size_> bits{};
+            std::array<T, block_size_> normal{};
+            for(size_t first = 0; first < count; first += block_size_) {
+                auto block = std::min(block_size_, count - first);
+                auto length = block + block % 2;
+                if constexpr(has_bulk_generation<Engine>::value) {
+                    engine.generate(bits.data(), length);
+                } else {
+                    for(size_t i = 0; i < length; ++i) {
+                        bits[i] = engine();
+                    }
+                }
+
+                for(size_t i = 0; i < length / 2; ++i) {
+                    auto radius = std::sqrt(-2. * std::log(static_cast<double>((bits[2 * i] >> 11) + 1) * 0x1.0p-53));
+                    auto angle = 2. * M_PI * static_cast<double>(bits[2 * i + 1] >> 11) * 0x1.0p-53;
+                    normal[2 * i] = static_cast<T>(radius * std::cos(angle));
+                    normal[2 * i + 1] = static_cast<T>(radius * std::sin(angle));
+                }
+                for(size_t i = 0; i < block; ++i) {
+                    values[first + i] = mean_ + stddev_ * normal[i];
+                }
+            }
+        }
+
+    private:
+        template <typename Engine, typename = void> struct has_bulk_generation : std::false_type {};
+        template <typename Engine>
+        struct has_bulk_generation<
+            Engine,
+            std::void_t<decltype(std::declval<Engine&>().generate(std::declval<std::uint64_t*>(), size_t()))>>
+            : std::true_type {};
+
+        static constexpr size_t block_size_ = 256;
+
+        T mean_;
+        T stddev_;
+    };
 } // namespace allpix
 
 #endif // ALLPIX_RANDOM_DISTRIBUTIONS_H
@@ -0,0 +1,40 @@
+/**
+ * @file
+ * @brief Implementation of the huge page utilities
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "huge_pages.h"
+
+#include <cstdlib>
+#include <new>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+using namespace allpix;
+
+/**
+ * The allocation is aligned to the size of huge pages of 2 MiB used by the kernel for transparent huge pages on x86-64 and
+ * AArch64 with 4 KiB base pages, such that the full allocation can be backed by huge pages.
+ */
+std::shared_ptr<void> allpix::allocate_huge_pages(size_t bytes, bool& advised) {
+    constexpr size_t huge_page_size = size_t(2) << 20;
+    auto size = std::max<size_t>((bytes + huge_page_size - 1) / huge_page_size, 1) * huge_page_size;
+    auto* memory = std::aligned_alloc(huge_page_size, size);
+    if(memory == nullptr) {
+        throw std::bad_alloc();
+    }
+
+    advised = false;
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    advised = (madvise(memory, size, MADV_HUGEPAGE) == 0);
+#endif
+    return {memory, std::free};
+}
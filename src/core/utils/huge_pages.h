@@ -0,0 +1,48 @@
+/**
+ * @file
+ * @brief Utilities to allocate memory backed by transparent huge pages
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ *
+ * The advice to use huge pages is only given on Linux, on other platforms the memory is allocated with regular pages.
+ */
+
+#ifndef ALLPIX_HUGE_PAGES_H
+#define ALLPIX_HUGE_PAGES_H
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+
+#include "core/utils/shared_array.h"
+
+namespace allpix {
+
+    /**
+     * @brief Allocate memory aligned to huge pages and advise the kernel to back it with transparent huge pages
+     * @param bytes Size of the allocation in bytes, rounded up to a multiple of the huge page size
+     * @param advised Set to true if the kernel accepted the advice, false otherwise
+     * @return Owner of the uninitialized allocation, which is released with the last reference
+     */
+    std::shared_ptr<void> allocate_huge_pages(size_t bytes, bool& advised);
+
+    /**
+     * @brief Copy the values of an array into memory backed by transparent huge pages
+     * @param array Array to copy
+     * @param advised Set to true if the kernel accepted the advice to use huge pages, false otherwise
+     * @return Array viewing the copied values
+     * @note The copy is written by the calling thread, such that its pages are placed on the NUMA node of this thread
+     */
+    template <typename T> SharedArray<T> copy_to_huge_pages(const SharedArray<T>& array, bool& advised) {
+        auto storage = allocate_huge_pages(array.size() * sizeof(T), advised);
+        auto* values = static_cast<T*>(storage.get());
+        std::uninitialized_copy(array.begin(), array.end(), values);
+        return SharedArray<T>(std::move(storage), values, array.size());
+    }
+} // namespace allpix
+
+#endif /* ALLPIX_HUGE_PAGES_H */
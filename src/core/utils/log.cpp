@@ -13,7 +13,10 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <chrono>
+#include <cstdint>
+#include <ctime>
 #include <exception>
 #include <iomanip>
 #include <iostream>
@@ -32,6 +35,107 @@ std::string DefaultLogger::last_message_;
 // Mutex to guard output writing
 std::mutex DefaultLogger::write_mutex_;
 
+namespace {
+    /**
+     * @brief Bounded lock-free queue of formatted log messages with multiple producers and a single consumer
+     *
+     * Every slot carries a sequence number indicating whether it is free for the producer claiming the position or holds a
+     * message for the consumer, following the bounded queue design by D. Vyukov. Producers only contend on the atomic
+     * enqueue position.
+     */
+    class LogMessageQueue {
+    public:
+        explicit LogMessageQueue(size_t capacity) : slots_(capacity), mask_(capacity - 1) {
+            for(size_t i = 0; i < capacity; ++i) {
+                slots_[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        /**
+         * @brief Enqueue a message if the queue is not full
+         * @return True if the message has been enqueued, false if the queue is full
+         */
+        bool push(std::string& message, std::string& identifier) {
+            auto pos = enqueue_pos_.load(std::memory_order_relaxed);
+            while(true) {
+                auto& slot = slots_[pos & mask_];
+                auto sequence = slot.sequence.load(std::memory_order_acquire);
+                auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+                if(diff == 0) {
+                    if(enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        slot.message = std::move(message);
+                        slot.identifier = std::move(identifier);
+                        slot.sequence.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if(diff < 0) {
+                    return false;
+                } else {
+                    pos = enqueue_pos_.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        /**
+         * @brief Dequeue the oldest message if available
+         * @return True if a message has been dequeued, false if the queue is empty
+         * @warning Only a single thread may dequeue messages at a time
+         */
+        bool pop(std::string& message, std::string& identifier) {
+            auto& slot = slots_[dequeue_pos_ & mask_];
+            if(slot.sequence.load(std::memory_order_acquire) != dequeue_pos_ + 1) {
+                return false;
+            }
+            message = std::move(slot.message);
+            identifier = std::move(slot.identifier);
+            slot.sequence.store(dequeue_pos_ + mask_ + 1, std::memory_order_release);
+            ++dequeue_pos_;
+            return true;
+        }
+
+    private:
+        struct Slot {
+            std::atomic<size_t> sequence;
+            std::string message;
+            std::string identifier;
+        };
+        std::vector<Slot> slots_;
+        size_t mask_;
+
+        alignas(64) std::atomic<size_t> enqueue_pos_{0};
+        alignas(64) size_t dequeue_pos_{0};
+    };
+
+    // Capacity of the message queue, needs to be a power of two
+    constexpr size_t log_queue_capacity = 8192;
+
+    // State of the asynchronous writer
+    LogMessageQueue log_queue{log_queue_capacity};
+    std::atomic_bool log_asynchronous{false};
+    std::atomic_bool log_writer_stop{false};
+    // Number of threads which observed the asynchronous mode and might still enqueue a message
+    std::atomic_uint log_producers{0};
+
+    // Writer thread, stopped at exit if the logging has not been finished
+    struct LogWriterThread {
+        LogWriterThread() = default;
+        LogWriterThread(const LogWriterThread&) = delete;
+        LogWriterThread& operator=(const LogWriterThread&) = delete;
+        LogWriterThread(LogWriterThread&&) = delete;
+        LogWriterThread& operator=(LogWriterThread&&) = delete;
+        ~LogWriterThread() {
+            log_writer_stop = true;
+            if(thread.joinable()) {
+                thread.join();
+            }
+        }
+        std::thread thread;
+    } log_writer;
+
+    // Buffer collecting the messages of the current thread, if set
+    thread_local std::vector<std::pair<std::string, std::string>>* log_buffer{nullptr};
+} // namespace
+
 /**
  * The logger will save the number of uncaught exceptions during construction to compare that with the number of exceptions
  * during destruction later.
@@ -65,12 +169,50 @@ DefaultLogger::~DefaultLogger() {
         } while((start_pos = out.find('\n', start_pos)) != std::string::npos);
     }
 
+    // Keep the message in the buffer of the thread if requested
+    if(log_buffer != nullptr) {
+        log_buffer->emplace_back(std::move(out), identifier_);
+        return;
+    }
+
+    submit(std::move(out), std::move(identifier_));
+}
+
+void DefaultLogger::setBuffer(std::vector<std::pair<std::string, std::string>>* buffer) { log_buffer = buffer; }
+
+void DefaultLogger::flushBuffer(std::vector<std::pair<std::string, std::string>>& buffer) {
+    for(auto& [out, identifier] : buffer) {
+        submit(std::move(out), std::move(identifier));
+    }
+    buffer.clear();
+}
+
+void DefaultLogger::submit(std::string out, std::string identifier) {
+    // Hand off the message to the writer thread, waiting for space if the queue is full. The producer is announced before
+    // checking the mode, such that disabling the asynchronous mode waits for the message to be enqueued.
+    log_producers++;
+    while(log_asynchronous.load()) {
+        if(log_queue.push(out, identifier)) {
+            log_producers--;
+            return;
+        }
+        std::this_thread::yield();
+    }
+    log_producers--;
+
     // Lock the mutex to guard last identifier usage
-    std::unique_lock<std::mutex> lock(write_mutex_);
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    write(std::move(out), identifier);
+}
 
+/**
+ * Progress logs with the same identifier as the previous message overwrite its line in the streams. Terminal control
+ * characters are only written to streams supporting them.
+ */
+void DefaultLogger::write(std::string out, const std::string& identifier) {
     // Add extra spaces if necessary
     size_t extra_spaces = 0;
-    if(!identifier_.empty() && last_identifier_ == identifier_) {
+    if(!identifier.empty() && last_identifier_ == identifier) {
         // Put carriage return for process logs
         out = '\r' + out;
 
@@ -82,7 +224,7 @@ DefaultLogger::~DefaultLogger() {
         // End process log and continue normal logging
         out = '\n' + out;
     }
-    last_identifier_ = identifier_;
+    last_identifier_ = identifier;
 
     // Save last message
     last_message_ = out;
@@ -94,7 +236,7 @@ DefaultLogger::~DefaultLogger() {
     }
 
     // Add final newline if not a progress log
-    if(identifier_.empty()) {
+    if(identifier.empty()) {
         out += '\n';
     }
 
@@ -125,7 +267,6 @@ DefaultLogger::~DefaultLogger() {
         }
         (*stream).flush();
     }
-    lock.unlock();
 }
 
 /**
@@ -133,6 +274,9 @@ DefaultLogger::~DefaultLogger() {
  * @note Does not close the streams
  */
 void DefaultLogger::finish() {
+    // Write all pending messages
+    setAsynchronous(false);
+
     // Lock the mutex to guard output writing
     std::lock_guard<std::mutex> lock(write_mutex_);
 
@@ -158,6 +302,63 @@ void DefaultLogger::finish() {
     get_streams().clear();
 }
 
+/**
+ * The writer thread is started when enabling the asynchronous mode. When disabling it, threads which have already observed
+ * the asynchronous mode finish enqueuing their messages first. The writer thread then writes all messages enqueued so far
+ * before it is stopped, messages remaining in the queue afterwards are written by the calling thread.
+ */
+void DefaultLogger::setAsynchronous(bool asynchronous) {
+    if(asynchronous == log_asynchronous.load()) {
+        return;
+    }
+
+    if(asynchronous) {
+        log_writer_stop = false;
+        log_writer.thread = std::thread(&DefaultLogger::write_asynchronous);
+        log_asynchronous = true;
+        return;
+    }
+
+    log_asynchronous = false;
+    while(log_producers.load() > 0) {
+        std::this_thread::yield();
+    }
+    log_writer_stop = true;
+    if(log_writer.thread.joinable()) {
+        log_writer.thread.join();
+    }
+
+    // Write messages enqueued after the writer thread stopped
+    std::string out, identifier;
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    while(log_queue.pop(out, identifier)) {
+        write(std::move(out), identifier);
+    }
+}
+bool DefaultLogger::isAsynchronous() { return log_asynchronous.load(); }
+
+/**
+ * The writer thread backs off up to a millisecond while the queue is empty to avoid busy waiting without the need for
+ * producers to notify it.
+ */
+void DefaultLogger::write_asynchronous() {
+    std::string out, identifier;
+    auto backoff = std::chrono::microseconds(1);
+    while(true) {
+        if(log_queue.pop(out, identifier)) {
+            std::lock_guard<std::mutex> lock(write_mutex_);
+            write(std::move(out), identifier);
+            backoff = std::chrono::microseconds(1);
+            continue;
+        }
+        if(log_writer_stop.load()) {
+            break;
+        }
+        std::this_thread::sleep_for(backoff);
+        backoff = std::min(backoff * 2, std::chrono::microseconds(1000));
+    }
+}
+
 /**
  * This method is typically automatically called by the \ref LOG macro to return a stream after constructing the logger. The
  * header of the stream is added before returning the output stream.
@@ -387,8 +588,12 @@ std::string DefaultLogger::get_current_date() {
     auto now = std::chrono::system_clock::now();
     auto in_time_t = std::chrono::system_clock::to_time_t(now);
 
+    // Use the reentrant version since messages are formatted concurrently by all threads
+    std::tm local_time{};
+    localtime_r(&in_time_t, &local_time);
+
     std::stringstream ss;
-    ss << std::put_time(std::localtime(&in_time_t), "%X");
+    ss << std::put_time(&local_time, "%X");
 
     auto seconds_from_epoch = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch());
     auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch() - seconds_from_epoch).count();
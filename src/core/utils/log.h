@@ -21,6 +21,7 @@
 #include <ostream>
 #include <sstream>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace allpix {
@@ -111,9 +112,55 @@ namespace allpix {
 
         /**
          * @brief Finish the logging ensuring proper termination of all streams
+         * @note Writes all messages still pending for the asynchronous writer thread
          */
         static void finish();
 
+        /**
+         * @brief Enable or disable writing the log messages from a dedicated thread
+         * @param asynchronous True to hand off messages to the writer thread, false to write them from the calling thread
+         *
+         * In asynchronous mode, messages are formatted by the calling thread and enqueued into a lock-free ring buffer, from
+         * which a single thread writes them to the streams in order. Threads only block if the buffer is full. Disabling the
+         * asynchronous mode writes all pending messages and stops the writer thread.
+         * @warning Streams should not be added or removed while the asynchronous mode is enabled
+         */
+        static void setAsynchronous(bool asynchronous);
+        /**
+         * @brief Check if log messages are written from a dedicated thread
+         * @return True if the asynchronous mode is enabled, false otherwise
+         */
+        static bool isAsynchronous();
+
+        /**
+         * @brief Collect the log messages of the calling thread in a buffer instead of writing them
+         * @param buffer Buffer to append the formatted messages and their identifiers to, or nullptr to write them again
+         *
+         * Buffers allow to write the messages of tasks executed concurrently in the order of the tasks.
+         */
+        static void setBuffer(std::vector<std::pair<std::string, std::string>>* buffer);
+        /**
+         * @brief Write the messages collected in a buffer to the streams and clear the buffer
+         * @param buffer Buffer with the formatted messages and their identifiers
+         */
+        static void flushBuffer(std::vector<std::pair<std::string, std::string>>& buffer);
+
+        /**
+         * @brief Check if messages of a logging level are compiled into the framework
+         * @param level Logging level
+         * @return False if messages of this level are removed at compile time, true otherwise
+         *
+         * Messages more verbose than INFO are removed if the framework is compiled with ALLPIX_LOG_STRIP_DEBUG defined. The
+         * \ref LOG macros then never evaluate the content of these messages.
+         */
+        static constexpr bool isCompiled(LogLevel level) {
+#ifdef ALLPIX_LOG_STRIP_DEBUG
+            return level <= LogLevel::INFO;
+#else
+            return level <= LogLevel::PRNG;
+#endif
+        }
+
         /**
          * @brief Get the reporting level for logging
          * @return The current log level
@@ -212,6 +259,26 @@ namespace allpix {
          */
         static bool is_terminal(std::ostream& stream);
 
+        /**
+         * @brief Write a formatted message to all streams
+         * @param out Formatted message
+         * @param identifier Identifier of a process log or empty for a normal log message
+         * @warning The write mutex has to be locked by the caller
+         */
+        static void write(std::string out, const std::string& identifier);
+
+        /**
+         * @brief Write a formatted message from the calling thread or hand it off to the asynchronous writer thread
+         * @param out Formatted message
+         * @param identifier Identifier of a process log or empty for a normal log message
+         */
+        static void submit(std::string out, std::string identifier);
+
+        /**
+         * @brief Function executed by the asynchronous writer thread
+         */
+        static void write_asynchronous();
+
         // Output stream
         std::ostringstream os;
 
@@ -248,14 +315,17 @@ namespace allpix {
  * @brief Execute a block only if the reporting level is high enough
  * @param level The minimum log level
  */
-#define IFLOG(level) if(allpix::LogLevel::level <= allpix::Log::getReportingLevel() && !allpix::Log::getStreams().empty())
+#define IFLOG(level)                                                                                                        \
+    if(allpix::Log::isCompiled(allpix::LogLevel::level) && allpix::LogLevel::level <= allpix::Log::getReportingLevel() &&   \
+       !allpix::Log::getStreams().empty())
 
 /**
  * @brief Create a logging stream if the reporting level is high enough
  * @param level The log level of the stream
  */
 #define LOG(level)                                                                                                          \
-    if(allpix::LogLevel::level <= allpix::Log::getReportingLevel() && !allpix::Log::getStreams().empty())                   \
+    if(allpix::Log::isCompiled(allpix::LogLevel::level) && allpix::LogLevel::level <= allpix::Log::getReportingLevel() &&   \
+       !allpix::Log::getStreams().empty())                                                                                  \
     allpix::Log().getStream(                                                                                                \
         allpix::LogLevel::level, __FILE_NAME__, std::string(static_cast<const char*>(__func__)), __LINE__)
 
@@ -265,7 +335,8 @@ namespace allpix {
  * @param identifier Identifier for this stream to determine overwrites
  */
 #define LOG_PROGRESS(level, identifier)                                                                                     \
-    if(allpix::LogLevel::level <= allpix::Log::getReportingLevel() && !allpix::Log::getStreams().empty())                   \
+    if(allpix::Log::isCompiled(allpix::LogLevel::level) && allpix::LogLevel::level <= allpix::Log::getReportingLevel() &&   \
+       !allpix::Log::getStreams().empty())                                                                                  \
     allpix::Log().getProcessStream(                                                                                         \
         identifier, allpix::LogLevel::level, __FILE_NAME__, std::string(static_cast<const char*>(__func__)), __LINE__)
 
@@ -297,7 +368,8 @@ namespace allpix {
 #define LOG_N(level, max_log_count)                                                                                         \
     GENERATE_LOG_VAR(max_log_count);                                                                                        \
     if(GET_LOG_VARIABLE() > 0)                                                                                              \
-        if(allpix::LogLevel::level <= allpix::Log::getReportingLevel() && !allpix::Log::getStreams().empty())               \
+        if(allpix::Log::isCompiled(allpix::LogLevel::level) &&                                                              \
+           allpix::LogLevel::level <= allpix::Log::getReportingLevel() && !allpix::Log::getStreams().empty())               \
     allpix::Log().getStream(                                                                                                \
         allpix::LogLevel::level, __FILE_NAME__, std::string(static_cast<const char*>(__func__)), __LINE__)                  \
         << ((--GET_LOG_VARIABLE() == 0) ? "[further messages suppressed] " : "")
@@ -0,0 +1,91 @@
+/**
+ * @file
+ * @brief Implementation of the NUMA utilities
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "numa.h"
+
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace allpix;
+
+/**
+ * The processors of each node are parsed from the node directories of the sysfs, whose cpulist files contain
+ * comma-separated ranges such as "0-3,8-11". Processors excluded from the affinity mask of the process are skipped, as are
+ * nodes without any available processor.
+ */
+std::vector<std::vector<unsigned int>> allpix::get_numa_nodes() {
+    std::vector<std::vector<unsigned int>> nodes;
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if(sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return nodes;
+    }
+
+    std::error_code error;
+    std::map<unsigned int, std::vector<unsigned int>> node_cpus;
+    for(const auto& entry : std::filesystem::directory_iterator("/sys/devices/system/node", error)) {
+        auto name = entry.path().filename().string();
+        if(name.size() <= 4 || name.compare(0, 4, "node") != 0 ||
+           name.find_first_not_of("0123456789", 4) != std::string::npos) {
+            continue;
+        }
+
+        std::ifstream file(entry.path() / "cpulist");
+        std::string range;
+        auto& cpus = node_cpus[static_cast<unsigned int>(std::stoul(name.substr(4)))];
+        while(std::getline(file, range, ',')) {
+            std::istringstream stream(range);
+            unsigned int first = 0, last = 0;
+            char dash = 0;
+            if(!(stream >> first)) {
+                continue;
+            }
+            last = (stream >> dash >> last ? last : first);
+            for(auto cpu = first; cpu <= last; ++cpu) {
+                if(cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)) {
+                    cpus.push_back(cpu);
+                }
+            }
+        }
+    }
+
+    for(auto& [node, cpus] : node_cpus) {
+        if(!cpus.empty()) {
+            nodes.push_back(std::move(cpus));
+        }
+    }
+#endif
+    return nodes;
+}
+
+bool allpix::pin_current_thread(unsigned int cpu) {
+#ifdef __linux__
+    if(cpu >= CPU_SETSIZE) {
+        return false;
+    }
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu, &cpuset);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
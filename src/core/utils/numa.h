@@ -0,0 +1,44 @@
+/**
+ * @file
+ * @brief Utilities to query the NUMA topology and to pin threads to processors
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ *
+ * The topology is read from the sysfs of the Linux kernel, on other platforms all processors are reported unavailable.
+ */
+
+#ifndef ALLPIX_NUMA_H
+#define ALLPIX_NUMA_H
+
+#include <vector>
+
+namespace allpix {
+
+    /**
+     * @brief Get the processors available to this process, grouped by their NUMA node
+     * @return List of processor numbers for every NUMA node with available processors, empty if the topology is unknown
+     */
+    std::vector<std::vector<unsigned int>> get_numa_nodes();
+
+    /**
+     * @brief Restrict the calling thread to a single processor
+     * @param cpu Number of the processor
+     * @return True if the thread has been pinned, false otherwise
+     */
+    bool pin_current_thread(unsigned int cpu);
+
+    /**
+     * @brief Access the index of the NUMA node in \ref get_numa_nodes the calling thread is pinned to
+     * @return Reference to the index of the NUMA node of this thread, defaults to zero
+     */
+    inline unsigned int& current_numa_node() {
+        static thread_local unsigned int node = 0;
+        return node;
+    }
+} // namespace allpix
+
+#endif /* ALLPIX_NUMA_H */
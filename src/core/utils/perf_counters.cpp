@@ -0,0 +1,103 @@
+/**
+ * @file
+ * @brief Implementation of the hardware performance counter utilities
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "perf_counters.h"
+
+#if defined(ALLPIX_PERF_COUNTERS) && defined(__linux__)
+#include <array>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace allpix;
+
+#if defined(ALLPIX_PERF_COUNTERS) && defined(__linux__)
+namespace {
+    // Events of the counter group, the first one leads the group
+    constexpr std::array<std::uint64_t, 4> perf_events = {PERF_COUNT_HW_CPU_CYCLES,
+                                                          PERF_COUNT_HW_INSTRUCTIONS,
+                                                          PERF_COUNT_HW_CACHE_MISSES,
+                                                          PERF_COUNT_HW_BRANCH_MISSES};
+
+    /**
+     * @brief Counter group of a thread, closed when the thread exits
+     */
+    class ThreadCounters {
+    public:
+        ThreadCounters() {
+            for(size_t n = 0; n < perf_events.size(); ++n) {
+                perf_event_attr attr{};
+                attr.size = sizeof(attr);
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.config = perf_events[n];
+                attr.disabled = (n == 0 ? 1 : 0);
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+                attr.read_format = PERF_FORMAT_GROUP;
+                descriptors_[n] =
+                    static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, (n == 0 ? -1 : descriptors_[0]), 0));
+                if(descriptors_[n] < 0) {
+                    // Counters are not supported by the processor or not permitted by the kernel
+                    close_all();
+                    return;
+                }
+            }
+            ioctl(descriptors_[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(descriptors_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+        ThreadCounters(const ThreadCounters&) = delete;
+        ThreadCounters& operator=(const ThreadCounters&) = delete;
+        ThreadCounters(ThreadCounters&&) = delete;
+        ThreadCounters& operator=(ThreadCounters&&) = delete;
+        ~ThreadCounters() { close_all(); }
+
+        bool read(PerfCounterValues& values) const {
+            if(descriptors_[0] < 0) {
+                return false;
+            }
+            struct {
+                std::uint64_t count;
+                std::array<std::uint64_t, perf_events.size()> values;
+            } group{};
+            if(::read(descriptors_[0], &group, sizeof(group)) != static_cast<ssize_t>(sizeof(group))) {
+                return false;
+            }
+            values.cycles = group.values[0];
+            values.instructions = group.values[1];
+            values.cache_misses = group.values[2];
+            values.branch_misses = group.values[3];
+            return true;
+        }
+
+    private:
+        void close_all() {
+            for(auto& descriptor : descriptors_) {
+                if(descriptor >= 0) {
+                    close(descriptor);
+                }
+                descriptor = -1;
+            }
+        }
+
+        std::array<int, perf_events.size()> descriptors_{-1, -1, -1, -1};
+    };
+} // namespace
+
+bool allpix::read_perf_counters(PerfCounterValues& values) {
+    static thread_local ThreadCounters counters;
+    return counters.read(values);
+}
+#else
+bool allpix::read_perf_counters(PerfCounterValues&) { return false; }
+#endif
@@ -0,0 +1,43 @@
+/**
+ * @file
+ * @brief Utilities to read the hardware performance counters of the calling thread
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ *
+ * The counters are read via perf_event_open of the Linux kernel and are only compiled in if the framework is built with
+ * ALLPIX_PERF_COUNTERS, otherwise the counters are reported unavailable.
+ */
+
+#ifndef ALLPIX_PERF_COUNTERS_H
+#define ALLPIX_PERF_COUNTERS_H
+
+#include <cstdint>
+
+namespace allpix {
+
+    /**
+     * @brief Values of the hardware performance counters, counted in user space only
+     */
+    struct PerfCounterValues {
+        std::uint64_t cycles{};        ///< Processor cycles
+        std::uint64_t instructions{};  ///< Retired instructions
+        std::uint64_t cache_misses{};  ///< Misses of the last level cache
+        std::uint64_t branch_misses{}; ///< Mispredicted branches
+    };
+
+    /**
+     * @brief Read the hardware performance counters of the calling thread
+     * @param values Values to update with the current counts
+     * @return True if the counters have been read, false if they are not available
+     *
+     * The counters are opened as a group on the first call of every thread and closed when the thread exits. Since they
+     * count continuously, the counts of a code section are given by the difference of two readings on the same thread.
+     */
+    bool read_perf_counters(PerfCounterValues& values);
+} // namespace allpix
+
+#endif /* ALLPIX_PERF_COUNTERS_H */
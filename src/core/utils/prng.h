@@ -1,6 +1,6 @@
 /**
  * @file
- * @brief Provides a wrapper around the STL pseudo-random number generator Mersenne Twister
+ * @brief Provides a wrapper around the pseudo-random number engines used in the framework
  *
  * @copyright Copyright (c) 2020-2024 CERN and the Allpix Squared authors.
  * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
@@ -14,15 +14,227 @@
 
 #include "core/utils/log.h"
 
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <ostream>
 #include <random>
+#include <type_traits>
+#include <variant>
 
 namespace allpix {
 
     /**
-     * @brief Wrapper around the STL's Mersenne Twister
+     * @brief Counter-based Philox4x64-10 pseudo-random number engine
+     *
+     * Each block of four numbers is computed from the key and a 256-bit counter alone, as described in J. K. Salmon et al.,
+     * "Parallel random numbers: as easy as 1, 2, 3", SC11. Seeding only sets the key and resets the counter, and skipping
+     * an arbitrary number of values only advances the counter, both in constant time. Satisfies the requirements of a
+     * random number engine of the C++ Standard Library.
      */
-    class RandomNumberGenerator : public std::mt19937_64 {
+    class Philox4x64 {
     public:
+        using result_type = std::uint64_t;
+
+        static constexpr result_type default_seed = 20111115u;
+
+        static constexpr result_type min() { return 0; }
+        static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+        /**
+         * @brief Construct the engine with the default seed
+         */
+        Philox4x64() { seed(default_seed); }
+
+        /**
+         * @brief Construct the engine with the given seed
+         * @param value Seed used as first word of the key
+         */
+        explicit Philox4x64(result_type value) { seed(value); }
+
+        /**
+         * @brief Construct the engine from a seed sequence
+         * @param seq Seed sequence used to generate the key
+         */
+        template <typename Sseq, typename = std::enable_if_t<!std::is_convertible_v<Sseq, result_type>>>
+        explicit Philox4x64(Sseq& seq) {
+            seed(seq);
+        }
+
+        /**
+         * @brief Set the key to the given seed and reset the counter
+         * @param value Seed used as first word of the key
+         */
+        void seed(result_type value = default_seed) {
+            key_ = {value, 0};
+            counter_ = {};
+            index_ = block_size_;
+        }
+
+        /**
+         * @brief Set the key from a seed sequence and reset the counter
+         * @param seq Seed sequence used to generate the key
+         */
+        template <typename Sseq> void seed(Sseq& seq) {
+            std::array<std::uint32_t, 4> words{};
+            seq.generate(words.begin(), words.end());
+            key_ = {static_cast<result_type>(words[0]) | (static_cast<result_type>(words[1]) << 32),
+                    static_cast<result_type>(words[2]) | (static_cast<result_type>(words[3]) << 32)};
+            counter_ = {};
+            index_ = block_size_;
+        }
+
+        /**
+         * @brief Retrieve the next pseudo-random number
+         * @return 64-bit pseudo-random number
+         */
+        result_type operator()() {
+            if(index_ == block_size_) {
+                generate_block();
+            }
+            return output_[index_++];
+        }
+
+        /**
+         * @brief Advance the engine by a number of values in constant time
+         * @param z Number of values to skip
+         */
+        void discard(unsigned long long z) {
+            auto available = static_cast<unsigned long long>(block_size_ - index_);
+            if(z < available) {
+                index_ += static_cast<size_t>(z);
+                return;
+            }
+            z -= available;
+            increment_counter(z / block_size_);
+            index_ = block_size_;
+            if(z % block_size_ != 0) {
+                generate_block();
+                index_ = static_cast<size_t>(z % block_size_);
+            }
+        }
+
+        friend bool operator==(const Philox4x64& lhs, const Philox4x64& rhs) {
+            return lhs.key_ == rhs.key_ && lhs.counter_ == rhs.counter_ && lhs.index_ == rhs.index_;
+        }
+        friend bool operator!=(const Philox4x64& lhs, const Philox4x64& rhs) { return !(lhs == rhs); }
+
+        friend std::ostream& operator<<(std::ostream& os, const Philox4x64& engine) {
+            for(auto word : engine.key_) {
+                os << word << ' ';
+            }
+            for(auto word : engine.counter_) {
+                os << word << ' ';
+            }
+            return os << engine.index_;
+        }
+
+        friend std::istream& operator>>(std::istream& is, Philox4x64& engine) {
+            Philox4x64 restored;
+            for(auto& word : restored.key_) {
+                is >> word;
+            }
+            for(auto& word : restored.counter_) {
+                is >> word;
+            }
+            is >> restored.index_;
+            if(is && restored.index_ <= block_size_) {
+                // The counter points to the next block, regenerate the current one from its predecessor
+                if(restored.index_ < block_size_) {
+                    restored.decrement_counter();
+                    auto index = restored.index_;
+                    restored.generate_block();
+                    restored.index_ = index;
+                }
+                engine = restored;
+            }
+            return is;
+        }
+
+    private:
+        static constexpr size_t block_size_ = 4;
+        static constexpr size_t rounds_ = 10;
+
+        /**
+         * @brief Compute the block for the current counter and advance the counter to the next block
+         */
+        void generate_block() {
+            auto ctr = counter_;
+            auto key = key_;
+            for(size_t round = 0; round < rounds_; ++round) {
+                std::uint64_t hi0 = 0, hi1 = 0;
+                auto lo0 = mulhilo(0xD2E7470EE14C6C93, ctr[0], hi0);
+                auto lo1 = mulhilo(0xCA5A826395121157, ctr[2], hi1);
+                ctr = {hi1 ^ ctr[1] ^ key[0], lo1, hi0 ^ ctr[3] ^ key[1], lo0};
+                key[0] += 0x9E3779B97F4A7C15;
+                key[1] += 0xBB67AE8584CAA73B;
+            }
+            output_ = ctr;
+            index_ = 0;
+            increment_counter(1);
+        }
+
+        void increment_counter(unsigned long long n) {
+            counter_[0] += n;
+            // Propagate the carry to the higher words
+            size_t i = 1;
+            bool carry = (counter_[0] < n);
+            while(carry && i < counter_.size()) {
+                carry = (++counter_[i++] == 0);
+            }
+        }
+
+        void decrement_counter() {
+            // Propagate the borrow to the higher words
+            size_t i = 0;
+            bool borrow = true;
+            while(borrow && i < counter_.size()) {
+                borrow = (counter_[i++]-- == 0);
+            }
+        }
+
+        static std::uint64_t mulhilo(std::uint64_t a, std::uint64_t b, std::uint64_t& hi) {
+            __extension__ using uint128_t = unsigned __int128;
+            auto product = static_cast<uint128_t>(a) * b;
+            hi = static_cast<std::uint64_t>(product >> 64);
+            return static_cast<std::uint64_t>(product);
+        }
+
+        std::array<std::uint64_t, 2> key_{};
+        std::array<std::uint64_t, 4> counter_{};
+        std::array<std::uint64_t, 4> output_{};
+        size_t index_{block_size_};
+    };
+
+    /**
+     * @brief Wrapper around the pseudo-random number engine used by the framework
+     *
+     * By default, the 64-bit Mersenne Twister of the STL is used. Alternatively, the counter-based \ref Philox4x64 engine
+     * can be selected, which can be seeded and advanced in constant time.
+     */
+    class RandomNumberGenerator {
+    public:
+        /**
+         * @brief Available pseudo-random number engines
+         */
+        enum class Engine {
+            MT19937_64, ///< 64-bit Mersenne Twister
+            PHILOX4X64, ///< Counter-based Philox4x64-10
+        };
+
+        using result_type = std::uint64_t;
+
+        static constexpr result_type min() { return 0; }
+        static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+        /**
+         * @brief Construct a generator using the default engine
+         */
+        RandomNumberGenerator() : engine_(make_engine(default_engine_)) {}
+
         /// @{
         /**
          * @brief Disallow copy-assignment
@@ -36,22 +248,115 @@ namespace allpix {
         RandomNumberGenerator& operator=(RandomNumberGenerator&&) = delete;
 
         /**
-         * Redefine function operator to retrieve pseudo-random numbers. This allows us to log the number at retrieval.
-         * Technically we are shadowing the base class operator since it is non-virtual and explicitly call it from within.
+         * @brief Select the engine used by all generators constructed afterwards
+         * @param engine Pseudo-random number engine
+         */
+        static void setDefaultEngine(Engine engine) { default_engine_ = engine; }
+
+        /**
+         * @brief Replace the engine of this generator by a default-seeded instance of the given engine
+         * @param engine Pseudo-random number engine
+         */
+        void setEngine(Engine engine) { engine_ = make_engine(engine); }
+
+        /**
+         * @brief Get the engine used by this generator
+         */
+        Engine getEngine() const { return engine_.index() == 1 ? Engine::PHILOX4X64 : Engine::MT19937_64; }
+
+        /**
+         * @brief Seed the engine
+         * @param value Seed for the engine
+         */
+        void seed(result_type value) {
+            std::visit([value](auto& engine) { engine.seed(value); }, engine_);
+        }
+
+        /**
+         * @brief Seed the engine from a seed sequence
+         * @param seq Seed sequence
+         */
+        template <typename Sseq> void seed(Sseq& seq) {
+            std::visit([&seq](auto& engine) { engine.seed(seq); }, engine_);
+        }
+
+        /**
+         * @brief Advance the engine by a number of values, in constant time for the Philox engine
+         * @param z Number of values to skip
+         */
+        void discard(unsigned long long z) {
+            std::visit([z](auto& engine) { engine.discard(z); }, engine_);
+        }
+
+        /**
+         * Retrieve pseudo-random numbers from the selected engine. This allows us to log the number at retrieval.
          *
          * @return 64-bit pseudo-random number
          */
-        std::uint_fast64_t operator()() {
+        result_type operator()() {
             // Only copy if we want to log it
             IFLOG(PRNG) {
-                auto prn = std::mt19937_64::operator()();
+                auto prn = generate();
                 LOG(PRNG) << "Using random number " << prn;
                 return prn;
             }
             else {
-                return std::mt19937_64::operator()();
+                return generate();
+            }
+        }
+
+        /**
+         * @brief Retrieve multiple pseudo-random numbers at once, resolving the selected engine only once
+         * @param values Storage for the pseudo-random numbers
+         * @param count Number of pseudo-random numbers to retrieve
+         *
+         * The numbers are identical to the ones retrieved by the same number of calls to the function call operator.
+         */
+        void generate(result_type* values, size_t count) {
+            std::visit(
+                [values, count](auto& engine) {
+                    for(size_t i = 0; i < count; ++i) {
+                        values[i] = engine();
+                    }
+                },
+                engine_);
+            IFLOG(PRNG) {
+                for(size_t i = 0; i < count; ++i) {
+                    LOG(PRNG) << "Using random number " << values[i];
+                }
+            }
+        }
+
+        friend std::ostream& operator<<(std::ostream& os, const RandomNumberGenerator& generator) {
+            std::visit([&os](const auto& engine) { os << engine; }, generator.engine_);
+            return os;
+        }
+
+        friend std::istream& operator>>(std::istream& is, RandomNumberGenerator& generator) {
+            std::visit([&is](auto& engine) { is >> engine; }, generator.engine_);
+            return is;
+        }
+
+    private:
+        using EngineVariant = std::variant<std::mt19937_64, Philox4x64>;
+
+        static EngineVariant make_engine(Engine engine) {
+            if(engine == Engine::PHILOX4X64) {
+                return EngineVariant(std::in_place_type<Philox4x64>);
             }
+            return EngineVariant(std::in_place_type<std::mt19937_64>);
         }
+
+        result_type generate() {
+            if(auto* philox = std::get_if<Philox4x64>(&engine_)) {
+                return (*philox)();
+            }
+            return std::get<std::mt19937_64>(engine_)();
+        }
+
+        EngineVariant engine_;
+
+        static inline std::atomic<Engine> default_engine_{Engine::MT19937_64};
     };
 } // namespace allpix
 
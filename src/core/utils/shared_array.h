@@ -0,0 +1,97 @@
+/**
+ * @file
+ * @brief Read-only flat array shared between multiple owners
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef ALLPIX_SHARED_ARRAY_H
+#define ALLPIX_SHARED_ARRAY_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace allpix {
+
+    /**
+     * @brief Read-only view of a flat array of values, keeping the storage of the values alive
+     *
+     * The values are either held in a shared vector or in other storage such as a read-only memory mapping of a file. The
+     * storage is released when the last array referencing it is destroyed.
+     */
+    template <typename T> class SharedArray {
+    public:
+        using value_type = T;
+
+        /**
+         * @brief Construct an empty array
+         */
+        SharedArray() = default;
+
+        /**
+         * @brief Construct an array viewing the values of a shared vector
+         * @param vector Vector holding the values
+         */
+        SharedArray(std::shared_ptr<std::vector<T>> vector) // NOLINT
+            : size_(vector != nullptr ? vector->size() : 0) {
+            if(vector != nullptr) {
+                auto* data = vector->data();
+                data_ = std::shared_ptr<const T>(vector, data);
+            }
+        }
+
+        /**
+         * @brief Construct an array viewing values in storage held by an owner
+         * @param owner Object holding the storage of the values, released with the last array referencing it
+         * @param data Pointer to the first value
+         * @param size Number of values
+         */
+        SharedArray(std::shared_ptr<const void> owner, const T* data, size_t size)
+            : data_(owner, data), size_(size) {}
+
+        /**
+         * @brief Get pointer to the first value
+         */
+        const T* data() const noexcept { return data_.get(); }
+
+        /**
+         * @brief Get the number of values
+         */
+        size_t size() const noexcept { return size_; }
+
+        /**
+         * @brief Check if the array holds no values
+         */
+        bool empty() const noexcept { return size_ == 0; }
+
+        /**
+         * @brief Check if the array references storage
+         */
+        explicit operator bool() const noexcept { return data_ != nullptr; }
+
+        /// @{
+        /**
+         * @brief Iterators to the values of the array
+         */
+        const T* begin() const noexcept { return data(); }
+        const T* end() const noexcept { return data() + size_; }
+        /// @}
+
+        /**
+         * @brief Access a single value
+         * @param index Index of the value
+         */
+        const T& operator[](size_t index) const noexcept { return data()[index]; }
+
+    private:
+        std::shared_ptr<const T> data_;
+        size_t size_{0};
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_SHARED_ARRAY_H */
@@ -0,0 +1,145 @@
+/**
+ * @file
+ * @brief Compile-time constants and literals of the framework units
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef ALLPIX_UNIT_CONSTANTS_H
+#define ALLPIX_UNIT_CONSTANTS_H
+
+namespace allpix {
+    /**
+     * @brief Values of the framework units in the base units, available at compile time
+     *
+     * The units registered with the \ref Units system are defined by these constants, such that multiplying with a constant
+     * is equivalent to \ref Units::get with the name of the unit, but without parsing the unit string at runtime. Dividing
+     * by a constant is equivalent to \ref Units::convert. Composite units are named by their components with the powers
+     * appended and with "per" preceding the components in the denominator, for example cm2_per_V_s for "cm*cm/V/s".
+     */
+    namespace units {
+        // LENGTH
+        constexpr double nm = 1e-6;
+        constexpr double um = 1e-3;
+        constexpr double mm = 1;
+        constexpr double cm = 1e1;
+        constexpr double dm = 1e2;
+        constexpr double m = 1e3;
+        constexpr double km = 1e6;
+
+        // TIME
+        constexpr double ps = 1e-3;
+        constexpr double ns = 1;
+        constexpr double us = 1e3;
+        constexpr double ms = 1e6;
+        constexpr double s = 1e9;
+
+        // TEMPERATURE
+        constexpr double K = 1;
+
+        // ENERGY
+        constexpr double eV = 1e-6;
+        constexpr double keV = 1e-3;
+        constexpr double MeV = 1;
+        constexpr double GeV = 1e3;
+
+        // CHARGE
+        constexpr double e = 1;
+        constexpr double ke = 1e3;
+        constexpr double fC = 1 / 1.602176634e-4;
+        constexpr double C = 1 / 1.602176634e-19;
+
+        // VOLTAGE
+        // NOTE: fixed by above
+        constexpr double mV = 1e-9;
+        constexpr double V = 1e-6;
+        constexpr double kV = 1e-3;
+
+        // MAGNETIC FIELD
+        constexpr double kT = 1;
+        constexpr double T = 1e-3;
+        constexpr double mT = 1e-6;
+
+        // ANGLES
+        // NOTE: these are fake units
+        constexpr double deg = 3.14159265358979323846 / 180.0;
+        constexpr double rad = 1;
+        constexpr double mrad = 1e-3;
+
+        // FLUENCE
+        // NOTE: pseudo unit "1-MeV neutron equivalent"
+        constexpr double neq = 1;
+
+        // COMPOSITE UNITS
+        constexpr double per_K = 1 / K;
+        constexpr double per_V = 1 / V;
+        constexpr double per_ns = 1 / ns;
+        constexpr double per_cm = 1 / cm;
+        constexpr double per_cm2 = 1 / cm / cm;
+        constexpr double per_cm3 = 1 / cm / cm / cm;
+        constexpr double cm_per_s = cm / s;
+        constexpr double s_per_cm = s / cm;
+        constexpr double s_per_V = s / V;
+        constexpr double V_per_cm = V / cm;
+        constexpr double kV_per_cm = kV / cm;
+        constexpr double V_per_cm_K = V / cm / K;
+        constexpr double eV_per_K = eV / K;
+        constexpr double cm2_per_ns = cm * cm / ns;
+        constexpr double cm2_per_V_s = cm * cm / V / s;
+        constexpr double cm2_K_per_V_s = cm * cm * K / V / s;
+        constexpr double cm6_per_s = cm * cm * cm * cm * cm * cm / s;
+    } // namespace units
+
+    /**
+     * @brief Literals for values in the framework units, converted to the base units at compile time
+     *
+     * The suffixes are named like the constants in \ref units, for example 1.53e9_cm_per_s or 25_ns. The literals are only
+     * available after importing the namespace with using namespace allpix::unit_literals.
+     */
+    namespace unit_literals {
+        // Define the literal for floating point and integer values
+#define ALLPIX_UNIT_LITERAL(unit)                                                                                           \
+    constexpr double operator""##_##unit(long double value) { return static_cast<double>(value) * units::unit; }         \
+    constexpr double operator""##_##unit(unsigned long long value) { return static_cast<double>(value) * units::unit; }
+
+        ALLPIX_UNIT_LITERAL(nm)
+        ALLPIX_UNIT_LITERAL(um)
+        ALLPIX_UNIT_LITERAL(mm)
+        ALLPIX_UNIT_LITERAL(cm)
+        ALLPIX_UNIT_LITERAL(m)
+        ALLPIX_UNIT_LITERAL(ps)
+        ALLPIX_UNIT_LITERAL(ns)
+        ALLPIX_UNIT_LITERAL(us)
+        ALLPIX_UNIT_LITERAL(ms)
+        ALLPIX_UNIT_LITERAL(s)
+        ALLPIX_UNIT_LITERAL(K)
+        ALLPIX_UNIT_LITERAL(eV)
+        ALLPIX_UNIT_LITERAL(keV)
+        ALLPIX_UNIT_LITERAL(MeV)
+        ALLPIX_UNIT_LITERAL(GeV)
+        ALLPIX_UNIT_LITERAL(e)
+        ALLPIX_UNIT_LITERAL(ke)
+        ALLPIX_UNIT_LITERAL(fC)
+        ALLPIX_UNIT_LITERAL(mV)
+        ALLPIX_UNIT_LITERAL(V)
+        ALLPIX_UNIT_LITERAL(kV)
+        ALLPIX_UNIT_LITERAL(T)
+        ALLPIX_UNIT_LITERAL(mT)
+        ALLPIX_UNIT_LITERAL(deg)
+        ALLPIX_UNIT_LITERAL(mrad)
+        ALLPIX_UNIT_LITERAL(per_cm3)
+        ALLPIX_UNIT_LITERAL(cm_per_s)
+        ALLPIX_UNIT_LITERAL(V_per_cm)
+        ALLPIX_UNIT_LITERAL(kV_per_cm)
+        ALLPIX_UNIT_LITERAL(cm2_per_ns)
+        ALLPIX_UNIT_LITERAL(cm2_per_V_s)
+
+#undef ALLPIX_UNIT_LITERAL
+    } // namespace unit_literals
+} // namespace allpix
+
+#endif /* ALLPIX_UNIT_CONSTANTS_H */
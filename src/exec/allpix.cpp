@@ -26,6 +26,7 @@
 #include "core/Allpix.hpp"
 #include "core/config/ConfigManager.hpp"
 #include "core/geometry/GeometryManager.hpp"
+#include "core/module/ModuleRegistry.hpp"
 #include "core/utils/exceptions.h"
 #include "core/utils/log.h"
 
@@ -94,6 +95,11 @@ int main(int argc, const char* argv[]) {
     // Install termination handler (e.g. from "kill"). Gracefully exit, finish last event and quit
     std::signal(SIGTERM, interrupt_handler);
 
+#ifdef ALLPIX_STATIC_MODULES
+    // Register the modules linked into the executable, to be instantiated without loading their libraries
+    register_static_modules();
+#endif
+
     // If no arguments are provided, print the help:
     bool print_help = false;
     int return_code = 0;
@@ -180,6 +186,25 @@ int main(int argc, const char* argv[]) {
             } else {
                 module_options.emplace_back("workers=" + arg.substr(2));
             }
+        } else if(arg == "--resume") {
+            module_options.emplace_back("resume=true");
+        } else if(arg == "--serve" && (i + 1 < argc)) {
+            module_options.emplace_back("server_socket=" + std::string(argv[++i]));
+        } else if(arg == "--benchmark" && (i + 1 < argc)) {
+            module_options.emplace_back("benchmark_workers=" + std::string(argv[++i]));
+        } else if(arg == "--estimate" && (i + 1 < argc)) {
+            module_options.emplace_back("estimate_events=" + std::string(argv[++i]));
+        } else if(arg == "--shard" && (i + 1 < argc)) {
+            std::string shard = argv[++i];
+            auto separator = shard.find('/');
+            if(separator == std::string::npos || separator == 0 || separator + 1 == shard.size()) {
+                LOG(ERROR) << "Invalid shard \"" << shard << "\", expected <index>/<count>";
+                print_help = true;
+                return_code = 1;
+            } else {
+                module_options.emplace_back("shard_index=" + shard.substr(0, separator));
+                module_options.emplace_back("shard_count=" + shard.substr(separator + 1));
+            }
         } else if(arg == "-g" && (i + 1 < argc)) {
             detector_options.emplace_back(argv[++i]);
         } else {
@@ -204,6 +229,15 @@ int main(int argc, const char* argv[]) {
         std::cout << "  -v <level>   verbosity level, overwriting the global level" << std::endl;
         std::cout << "  -j <workers> number of worker threads, equivalent to" << std::endl;
         std::cout << "               -o multithreading=true -o workers=<workers>" << std::endl;
+        std::cout << "  --shard <i>/<n> run only shard i of n of the events, equivalent to" << std::endl;
+        std::cout << "               -o shard_index=<i> -o shard_count=<n>" << std::endl;
+        std::cout << "  --resume     continue an interrupted run from its checkpoint" << std::endl;
+        std::cout << "  --serve <socket> keep the modules initialized and serve run requests on a local" << std::endl;
+        std::cout << "               socket, equivalent to -o server_socket=<socket>" << std::endl;
+        std::cout << "  --benchmark <workers> measure the throughput for up to the given number of workers," << std::endl;
+        std::cout << "               equivalent to -o benchmark_workers=<workers>" << std::endl;
+        std::cout << "  --estimate <events> estimate the cost of the configured run from a sample of events," << std::endl;
+        std::cout << "               equivalent to -o estimate_events=<events>" << std::endl;
         std::cout << "  --version    print version information and quit" << std::endl;
         std::cout << std::endl;
         std::cout << "For more help, please see <https://cern.ch/allpix-squared>" << std::endl;
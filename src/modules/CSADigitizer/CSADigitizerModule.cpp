@@ -13,6 +13,7 @@
 
 #include "core/utils/distributions.h"
 #include "core/utils/unit.h"
+#include "core/utils/unit_constants.h"
 #include "tools/ROOT.h"
 
 #include <TFile.h>
@@ -32,6 +33,10 @@ CSADigitizerModule::CSADigitizerModule(Configuration& config, Messenger* messeng
     // Require PixelCharge message for single detector
     messenger_->bindSingle<PixelChargeMessage>(this, MsgFlags::REQUIRED);
 
+    // Declare the messages dispatched by this module
+    declare_output<PixelPulseMessage>();
+    declare_output<PixelHitMessage>();
+
     // Read model
     model_ = config_.get<DigitizerType>("model");
 
@@ -42,9 +47,13 @@ CSADigitizerModule::CSADigitizerModule(Configuration& config, Messenger* messeng
     config_.setDefault<double>("integration_time", Units::get(500, "ns"));
     config_.setDefault<double>("threshold", Units::get(10e-3, "V"));
     config_.setDefault<bool>("ignore_polarity", false);
+    config_.setDefault<bool>("multiple_hits", false);
 
     config_.setDefault<double>("sigma_noise", Units::get(1e-4, "V"));
 
+    config_.setDefault<ConvolutionMethod>("convolution", ConvolutionMethod::DIRECT);
+    config_.setDefault<double>("response_truncation", 0.);
+
     config_.setDefault<bool>("output_pulsegraphs", false);
     config_.setDefault<bool>("output_plots", config_.get<bool>("output_pulsegraphs"));
     config_.setDefault<int>("output_plots_scale", Units::get(30, "ke"));
@@ -68,6 +77,11 @@ CSADigitizerModule::CSADigitizerModule(Configuration& config, Messenger* messeng
 
     // Copy some variables from configuration to avoid lookups:
     integration_time_ = config_.get<double>("integration_time");
+    convolution_ = config_.get<ConvolutionMethod>("convolution");
+    response_truncation_ = config_.get<double>("response_truncation");
+    if(response_truncation_ < 0 || response_truncation_ >= 1) {
+        throw InvalidValueError(config_, "response_truncation", "fraction has to be between zero and one");
+    }
 
     // Time-of-Arrival
     if(config_.has("clock_bin_toa")) {
@@ -83,6 +97,36 @@ CSADigitizerModule::CSADigitizerModule(Configuration& config, Messenger* messeng
     sigmaNoise_ = config_.get<double>("sigma_noise");
     threshold_ = config_.get<double>("threshold");
     ignore_polarity_ = config.get<bool>("ignore_polarity");
+    multiple_hits_ = config_.get<bool>("multiple_hits");
+
+    // Variants of the threshold and the ToT clock evaluated on the same amplified pulses
+    if(config_.has("variant_thresholds") || config_.has("variant_clocks_tot")) {
+        auto thresholds = config_.getArray<double>("variant_thresholds", {});
+        auto clocks = config_.getArray<double>("variant_clocks_tot", {});
+        if(!clocks.empty() && !store_tot_) {
+            throw InvalidCombinationError(
+                config_, {"variant_clocks_tot", "clock_bin_tot"}, "ToT clock variants require a nominal ToT clock");
+        }
+        if(!thresholds.empty() && !clocks.empty() && thresholds.size() != clocks.size()) {
+            throw InvalidCombinationError(config_,
+                                          {"variant_thresholds", "variant_clocks_tot"},
+                                          "number of threshold and ToT clock variants has to be equal");
+        }
+        auto count = std::max(thresholds.size(), clocks.size());
+        auto names = config_.getArray<std::string>("variant_names", {});
+        if(!names.empty() && names.size() != count) {
+            throw InvalidValueError(config_, "variant_names", "a name has to be given for every variant");
+        }
+        for(size_t v = 0; v < count; ++v) {
+            variants_.push_back({(names.empty() ? "variant" + std::to_string(v) : names[v]),
+                                 (thresholds.empty() ? threshold_ : thresholds[v]),
+                                 (clocks.empty() ? clockToT_ : clocks[v])});
+            if(variants_.back().clock_tot <= 0 && store_tot_) {
+                throw InvalidValueError(config_, "variant_clocks_tot", "ToT clock has to be positive");
+            }
+        }
+        LOG(INFO) << "Digitizing " << variants_.size() << " variants of the threshold settings in addition";
+    }
 
     if(model_ == DigitizerType::SIMPLE) {
         auto tauF = config_.get<double>("feedback_time_constant");
@@ -111,7 +155,7 @@ CSADigitizerModule::CSADigitizerModule(Configuration& config, Messenger* messeng
         auto capacitance_output = config_.get<double>("amp_output_capacitance");
         auto gm = config_.get<double>("transconductance");
         auto n_wi = config_.get<double>("weak_inversion_slope");
-        auto boltzmann_kT = Units::get(8.6173333e-5, "eV/K") * config_.get<double>("temperature");
+        auto boltzmann_kT = 8.6173333e-5 * units::eV_per_K * config_.get<double>("temperature");
 
         // helper variables: transconductance and resistance in the feedback loop
         // weak inversion: gf = I/(n V_t) (e.g. Binkley "Tradeoff and Optimisation in Analog CMOS design")
@@ -223,9 +267,11 @@ void CSADigitizerModule::initialize() {
 void CSADigitizerModule::run(Event* event) {
     auto pixel_message = messenger_->fetchMessage<PixelChargeMessage>(this, event);
 
-    // Loop through all pixels with charges
+    // Loop through all pixels with charges, the hits refer to the pulses such that their storage may not be reallocated
     std::vector<PixelHit> hits;
+    std::vector<std::vector<PixelHit>> variant_hits(variants_.size());
     std::vector<PixelPulse> pulses;
+    pulses.reserve(pixel_message->getData().size());
     for(const auto& pixel_charge : pixel_message->getData()) {
         auto pixel = pixel_charge.getPixel();
         auto pixel_index = pixel.getIndex();
@@ -251,6 +297,27 @@ void CSADigitizerModule::run(Event* event) {
                     calculate_impulse_response_->Eval(timestep * static_cast<double>(itimepoint)));
             }
 
+            // Truncate the impulse response after the last sample above the requested fraction of its maximum
+            if(response_truncation_ > 0 && !impulse_response_function_.empty()) {
+                double maximum = 0;
+                for(auto sample : impulse_response_function_) {
+                    maximum = std::max(maximum, std::fabs(sample));
+                }
+                auto last = std::find_if(impulse_response_function_.rbegin(),
+                                         impulse_response_function_.rend(),
+                                         [&](auto sample) { return std::fabs(sample) > response_truncation_ * maximum; });
+                impulse_response_function_.resize(
+                    std::max<size_t>(1, static_cast<size_t>(std::distance(last, impulse_response_function_.rend()))));
+                LOG(INFO) << "Truncated impulse response after " << impulse_response_function_.size() << " samples, "
+                          << Units::display(timestep * static_cast<double>(impulse_response_function_.size()),
+                                            {"ps", "ns", "us"});
+            }
+
+            // Transform the impulse response once for all pulses
+            if(convolution_ == ConvolutionMethod::FFT) {
+                fft_convolution_ = FFTConvolution(impulse_response_function_);
+            }
+
             if(output_plots_) {
                 // Generate x-axis:
                 std::vector<double> time(impulse_response_function_.size());
@@ -276,15 +343,23 @@ void CSADigitizerModule::run(Event* event) {
                    << Units::display(timestep, {"ps", "ns"}) << ", total charge: " << Units::display(pulse.getCharge(), "e");
 
         // Convolution of the input pulse with the impulse response (size ntimepoints)
-        for(size_t k = 0; k < ntimepoints; ++k) {
-            double outsum{};
-            // Convolution: multiply pulse.at(k - i) * impulse_response_function_.at(i), when (k - i) < input length
-            // -> no point to start i at 0, start from jmin:
-            size_t jmin = (k >= pulse.size() - 1) ? k - (pulse.size() - 1) : 0;
-            for(size_t i = jmin; i <= k; ++i) {
-                outsum += pulse.at(k - i) * impulse_response_function_.at(i);
+        if(convolution_ == ConvolutionMethod::FFT) {
+            auto amplified = fft_convolution_(pulse, ntimepoints);
+            for(size_t k = 0; k < ntimepoints; ++k) {
+                amplified_pulse.addCharge(amplified[k], timestep * static_cast<double>(k));
+            }
+        } else {
+            for(size_t k = 0; k < ntimepoints; ++k) {
+                double outsum{};
+                // Convolution: multiply pulse.at(k - i) * impulse_response_function_.at(i), when (k - i) < input length
+                // -> no point to start i at 0, start from jmin, and stop at the end of the (truncated) impulse response:
+                size_t jmin = (k >= pulse.size() - 1) ? k - (pulse.size() - 1) : 0;
+                size_t jmax = std::min(k, impulse_response_function_.size() - 1);
+                for(size_t i = jmin; i <= jmax; ++i) {
+                    outsum += pulse.at(k - i) * impulse_response_function_.at(i);
+                }
+                amplified_pulse.addCharge(outsum, timestep * static_cast<double>(k));
             }
-            amplified_pulse.addCharge(outsum, timestep * static_cast<double>(k));
         }
 
         if(output_pulsegraphs_) {
@@ -318,21 +393,84 @@ void CSADigitizerModule::run(Event* event) {
         // Store amplified pulse fir dispatch
         pulses.emplace_back(pixel, amplified_pulse, &pixel_charge);
 
-        // Find threshold crossing - if any:
-        auto arrival = get_toa(timestep, amplified_pulse);
-        if(!std::get<0>(arrival)) {
-            LOG(DEBUG) << "Amplified signal never crossed threshold, continuing.";
-            continue;
+        // Find the hits of the nominal settings and of all variants in the same amplified pulse
+        digitize_hits(hits, timestep, amplified_pulse, pixel_charge, pulses.back(), {"", threshold_, clockToT_}, true);
+        for(size_t v = 0; v < variants_.size(); ++v) {
+            digitize_hits(variant_hits[v], timestep, amplified_pulse, pixel_charge, pulses.back(), variants_[v], false);
+        }
+    }
+
+    // Output summary and update statistics
+    LOG(INFO) << "Digitized " << hits.size() << " pixel hits";
+
+    if(!pulses.empty()) {
+        // Create and dispatch hit message
+        auto pulses_message = std::make_shared<PixelPulseMessage>(std::move(pulses), getDetector());
+        messenger_->dispatchMessage(this, pulses_message, event);
+    }
+
+    if(!hits.empty()) {
+        // Create and dispatch hit message
+        auto hits_message = std::make_shared<PixelHitMessage>(std::move(hits), getDetector());
+        messenger_->dispatchMessage(this, hits_message, event);
+    }
+
+    // Dispatch the hits of every variant under its own name
+    for(size_t v = 0; v < variants_.size(); ++v) {
+        LOG(DEBUG) << "Digitized " << variant_hits[v].size() << " pixel hits for variant " << variants_[v].name;
+        if(!variant_hits[v].empty()) {
+            auto hits_message = std::make_shared<PixelHitMessage>(std::move(variant_hits[v]), getDetector());
+            messenger_->dispatchMessage(this, hits_message, event, variants_[v].name);
         }
+    }
+}
+
+void CSADigitizerModule::digitize_hits(std::vector<PixelHit>& hits,
+                                       double timestep,
+                                       const Pulse& amplified_pulse,
+                                       const PixelCharge& pixel_charge,
+                                       const PixelPulse& pixel_pulse,
+                                       const Variant& variant,
+                                       bool nominal) {
+    auto pixel_index = pixel_charge.getIndex();
+
+    // Find threshold crossing - if any:
+    auto comparator = get_comparator_states(amplified_pulse, variant.threshold);
+    auto arrival = get_toa(timestep, comparator);
+    if(!std::get<0>(arrival)) {
+        LOG(DEBUG) << "Amplified signal never crossed threshold, continuing.";
+        return;
+    }
 
+    // Digitize every threshold crossing of the pulse, the pulse integral of a hit ends at the crossing of the next hit
+    size_t integral_begin = 0;
+    while(std::get<0>(arrival)) {
         // Decide whether to store ToA or arrival time:
         auto time = (store_toa_ ? static_cast<double>(std::get<1>(arrival)) : std::get<2>(arrival));
 
+        // Re-arm the comparator once the signal falls below the threshold to find the next hit if requested
+        std::pair<unsigned int, double> tot{0, integration_time_};
+        if(store_tot_ || multiple_hits_) {
+            tot = get_tot(timestep, std::get<2>(arrival), comparator, variant.clock_tot);
+        }
+        auto next_arrival = (multiple_hits_ ? get_toa(timestep, comparator, tot.second)
+                                            : std::tuple<bool, unsigned int, double>{false, 0, integration_time_});
+
         // Decide whether to store ToT or the pulse integral:
-        auto charge = (store_tot_ ? static_cast<double>(get_tot(timestep, std::get<2>(arrival), amplified_pulse))
-                                  : std::accumulate(amplified_pulse.begin(), amplified_pulse.end(), 0.0));
+        double charge = static_cast<double>(tot.first);
+        if(!store_tot_) {
+            auto integral_end = amplified_pulse.size();
+            if(std::get<0>(next_arrival)) {
+                integral_end =
+                    std::min(integral_end, static_cast<size_t>(std::floor(std::get<2>(next_arrival) / timestep)));
+            }
+            charge = std::accumulate(amplified_pulse.begin() + static_cast<std::ptrdiff_t>(integral_begin),
+                                     amplified_pulse.begin() + static_cast<std::ptrdiff_t>(integral_end),
+                                     0.0);
+            integral_begin = integral_end;
+        }
 
-        LOG(DEBUG) << "Pixel " << pixel_index << ": time "
+        LOG(DEBUG) << "Pixel " << pixel_index << (nominal ? "" : " (" + variant.name + ")") << ": time "
                    << (store_toa_ ? std::to_string(static_cast<int>(time)) + "clk"
                                   : Units::display(time, {"ps", "ns", "us"}))
                    << ", signal "
@@ -340,87 +478,84 @@ void CSADigitizerModule::run(Event* event) {
                                   : Units::display(charge, {"V*s", "mV*s"}));
 
         // Fill histograms if requested
-        if(output_plots_) {
+        if(output_plots_ && nominal) {
             h_tot->Fill(charge);
             h_toa->Fill(time);
-            h_pxq_vs_tot->Fill(inputcharge / 1e3, charge);
+            h_pxq_vs_tot->Fill(static_cast<double>(pixel_charge.getCharge()) / 1e3, charge);
         }
 
         // Add the hit to the hitmap
-        hits.emplace_back(
-            pixel, time, pixel_charge.getGlobalTime() + std::get<2>(arrival), charge, &pixel_charge, &pulses.back());
-    }
-
-    // Output summary and update statistics
-    LOG(INFO) << "Digitized " << hits.size() << " pixel hits";
-
-    if(!pulses.empty()) {
-        // Create and dispatch hit message
-        auto pulses_message = std::make_shared<PixelPulseMessage>(std::move(pulses), getDetector());
-        messenger_->dispatchMessage(this, pulses_message, event);
+        hits.emplace_back(pixel_charge.getPixel(),
+                          time,
+                          pixel_charge.getGlobalTime() + std::get<2>(arrival),
+                          charge,
+                          &pixel_charge,
+                          &pixel_pulse);
+        arrival = next_arrival;
     }
+}
 
-    if(!hits.empty()) {
-        // Create and dispatch hit message
-        auto hits_message = std::make_shared<PixelHitMessage>(std::move(hits), getDetector());
-        messenger_->dispatchMessage(this, hits_message, event);
+std::vector<signed char> CSADigitizerModule::get_comparator_states(const std::vector<double>& pulse,
+                                                                  double threshold) const {
+
+    // Compare the magnitude of the signal in the direction of the threshold polarity, without branches in the loop
+    auto reference = std::fabs(threshold);
+    auto polarity = (threshold > 0 ? 1. : -1.);
+    std::vector<signed char> comparator(pulse.size());
+    if(ignore_polarity_) {
+        std::transform(pulse.begin(), pulse.end(), comparator.begin(), [reference](double bin) {
+            auto level = std::fabs(bin);
+            return static_cast<signed char>(static_cast<int>(level > reference) - static_cast<int>(level < reference));
+        });
+    } else {
+        std::transform(pulse.begin(), pulse.end(), comparator.begin(), [reference, polarity](double bin) {
+            auto level = polarity * bin;
+            return static_cast<signed char>(static_cast<int>(level > reference) - static_cast<int>(level < reference));
+        });
     }
+    return comparator;
 }
 
-std::tuple<bool, unsigned int, double> CSADigitizerModule::get_toa(double timestep, const std::vector<double>& pulse) const {
+std::tuple<bool, unsigned int, double>
+CSADigitizerModule::get_toa(double timestep, const std::vector<signed char>& comparator, double start_time) const {
 
-    LOG(TRACE) << "Calculating time-of-arrival";
+    LOG(TRACE) << "Calculating time-of-arrival, starting at " << Units::display(start_time, {"ps", "ns", "us"});
     bool threshold_crossed = false;
-    unsigned int comparator_cycles = 0;
-    double arrival_time = 0;
-
-    // Lambda for threshold calculation:
-    auto is_above_threshold = [this](double bin) {
-        if(ignore_polarity_) {
-            return (std::fabs(bin) > std::fabs(threshold_));
-        } else {
-            return (threshold_ > 0 ? bin > threshold_ : bin < threshold_);
-        }
-    };
+    auto step = (store_toa_ ? clockToA_ : timestep);
+    auto comparator_cycles = static_cast<unsigned int>(std::ceil(start_time / step));
+    double arrival_time = step * comparator_cycles;
 
     // Find the point where the signal crosses the threshold, latch ToA
     while(arrival_time < integration_time_) {
-        auto bin = pulse.at(static_cast<size_t>(std::floor(arrival_time / timestep)));
-        if(is_above_threshold(bin)) {
+        if(comparator.at(static_cast<size_t>(std::floor(arrival_time / timestep))) > 0) {
             threshold_crossed = true;
             break;
         };
         comparator_cycles++;
-        arrival_time += (store_toa_ ? clockToA_ : timestep);
+        arrival_time += step;
     }
     return {threshold_crossed, comparator_cycles, arrival_time};
 }
 
-unsigned int CSADigitizerModule::get_tot(double timestep, double arrival_time, const std::vector<double>& pulse) const {
+std::pair<unsigned int, double> CSADigitizerModule::get_tot(double timestep,
+                                                            double arrival_time,
+                                                            const std::vector<signed char>& comparator,
+                                                            double clock_tot) const {
 
     LOG(TRACE) << "Calculating time-over-threshold, starting at " << Units::display(arrival_time, {"ps", "ns", "us"});
     unsigned int tot_clock_cycles = 0;
 
-    // Lambda for threshold calculation:
-    auto is_below_threshold = [this](double bin) {
-        if(ignore_polarity_) {
-            return (std::fabs(bin) < std::fabs(threshold_));
-        } else {
-            return (threshold_ > 0 ? bin < threshold_ : bin > threshold_);
-        }
-    };
-
     // Start calculation from the next ToT clock cycle following the threshold crossing
-    auto tot_time = clockToT_ * std::ceil(arrival_time / clockToT_);
+    auto step = (store_tot_ ? clock_tot : timestep);
+    auto tot_time = step * std::ceil(arrival_time / step);
     while(tot_time < integration_time_) {
-        auto bin = pulse.at(static_cast<size_t>(std::floor(tot_time / timestep)));
-        if(is_below_threshold(bin)) {
+        if(comparator.at(static_cast<size_t>(std::floor(tot_time / timestep))) < 0) {
             break;
         }
         tot_clock_cycles++;
-        tot_time += clockToT_;
+        tot_time += step;
     }
-    return tot_clock_cycles;
+    return {tot_clock_cycles, tot_time};
 }
 
 void CSADigitizerModule::create_output_pulsegraphs(const std::string& s_event_num,
@@ -438,8 +573,7 @@ void CSADigitizerModule::create_output_pulsegraphs(const std::string& s_event_nu
 
     // scale the y-axis values to be in mV instead of MV
     std::vector<double> pulse_in_mV(plot_pulse_vec.size());
-    std::transform(
-        plot_pulse_vec.begin(), plot_pulse_vec.end(), pulse_in_mV.begin(), [](auto& c) { return Units::convert(c, "mV"); });
+    std::transform(plot_pulse_vec.begin(), plot_pulse_vec.end(), pulse_in_mV.begin(), [](auto& c) { return c / units::mV; });
 
     std::string name = s_name + "_ev" + s_event_num + "_px" + s_pixel_index;
     auto* csa_pulse_graph = new TGraph(static_cast<int>(pulse_in_mV.size()), amptime.data(), pulse_in_mV.data());
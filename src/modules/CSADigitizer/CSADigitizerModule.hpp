@@ -14,12 +14,18 @@
 
 #include <memory>
 #include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 #include "core/config/Configuration.hpp"
 #include "core/messenger/Messenger.hpp"
 #include "core/module/Module.hpp"
 
 #include "objects/PixelCharge.hpp"
+#include "objects/PixelHit.hpp"
+#include "objects/PixelPulse.hpp"
+#include "tools/fft_convolution.h"
 
 #include <TFormula.h>
 #include <TH1D.h>
@@ -46,6 +52,14 @@ namespace allpix {
             CUSTOM, ///< Custom impulse response function using a ROOT::TFormula expression
         };
 
+        /**
+         * @brief Methods to convolve the pulses with the impulse response
+         */
+        enum class ConvolutionMethod {
+            DIRECT, ///< Direct summation over all pairs of samples
+            FFT,    ///< Overlap-add convolution using the fast Fourier transform
+        };
+
     public:
         /**
          * @brief Constructor for this detector-specific module
@@ -74,6 +88,15 @@ namespace allpix {
         // Control of module output settings
         bool output_plots_{}, output_pulsegraphs_{};
         bool store_tot_{false}, store_toa_{false}, ignore_polarity_{};
+        bool multiple_hits_{};
+
+        // Variant of the digitization settings, dispatched as named message of pixel hits
+        struct Variant {
+            std::string name;
+            double threshold{};
+            double clock_tot{};
+        };
+        std::vector<Variant> variants_;
         Messenger* messenger_;
         DigitizerType model_;
 
@@ -88,27 +111,64 @@ namespace allpix {
         std::vector<double> impulse_response_function_;
         std::once_flag first_event_flag_;
 
+        // Convolution of the pulses with the impulse response, truncated below a fraction of its maximum if requested
+        ConvolutionMethod convolution_{};
+        double response_truncation_{};
+        FFTConvolution fft_convolution_;
+
         // Output histograms
         Histogram<TH1D> h_tot{}, h_toa{};
         Histogram<TH2D> h_pxq_vs_tot{};
 
         /**
-         * @brief Calculate time of first threshold crossing
-         * @param timestep Step size of the input pulse
-         * @param pulse    Pulse after amplification and electronics noise
+         * @brief Compare all bins of the pulse with the threshold in a single pass
+         * @param pulse Pulse after amplification and electronics noise
+         * @param threshold Threshold to compare with
+         * @return State of the comparator per bin: 1 if above threshold, -1 if below threshold and 0 if equal
+         */
+        std::vector<signed char> get_comparator_states(const std::vector<double>& pulse, double threshold) const;
+
+        /**
+         * @brief Calculate time of the next threshold crossing
+         * @param timestep   Step size of the input pulse
+         * @param comparator Comparator states of the pulse after amplification and electronics noise
+         * @param start_time Time from which the comparator is sampled, starting at the next clock cycle
          * @return Tuple containing information about threshold crossing: Boolean (true if crossed), unsigned int (number
          *         of ToA clock cycles before crossing) and double (time of crossing)
          */
-        std::tuple<bool, unsigned int, double> get_toa(double timestep, const std::vector<double>& pulse) const;
+        std::tuple<bool, unsigned int, double>
+        get_toa(double timestep, const std::vector<signed char>& comparator, double start_time = 0) const;
 
         /**
          * @brief Calculate time-over-threshold
          * @param  timestep    Step size of the input pulse
          * @param arrival_time Time of crossing the threshold
-         * @param  pulse       Pulse after amplification and electronics noise
-         * @return             Number of clock cycles signal was over threshold
+         * @param  comparator  Comparator states of the pulse after amplification and electronics noise
+         * @param  clock_tot   Duration of a ToT clock cycle
+         * @return             Number of clock cycles signal was over threshold and time the signal fell below threshold
+         */
+        std::pair<unsigned int, double> get_tot(double timestep,
+                                                double arrival_time,
+                                                const std::vector<signed char>& comparator,
+                                                double clock_tot) const;
+
+        /**
+         * @brief Find all hits of the amplified pulse of a pixel for one set of digitization settings
+         * @param hits            Pixel hits to add the hits to
+         * @param timestep        Step size of the amplified pulse
+         * @param amplified_pulse Pulse after amplification and electronics noise
+         * @param pixel_charge    Pixel charge the pulse originates from
+         * @param pixel_pulse     Dispatched amplified pulse referenced by the hits
+         * @param variant         Threshold and ToT clock to digitize with
+         * @param nominal         True for the nominal settings, filling the output histograms
          */
-        unsigned int get_tot(double timestep, double arrival_time, const std::vector<double>& pulse) const;
+        void digitize_hits(std::vector<PixelHit>& hits,
+                           double timestep,
+                           const Pulse& amplified_pulse,
+                           const PixelCharge& pixel_charge,
+                           const PixelPulse& pixel_pulse,
+                           const Variant& variant,
+                           bool nominal);
 
         /**
          * @brief Create output plots of the pulses
@@ -10,8 +10,10 @@
 
 #include "CapacitiveTransferModule.hpp"
 
+#include <algorithm>
 #include <fstream>
 #include <limits>
+#include <map>
 #include <memory>
 #include <new>
 #include <stdexcept>
@@ -21,6 +23,7 @@
 #include "core/config/exceptions.h"
 #include "core/utils/log.h"
 #include "core/utils/unit.h"
+#include "core/utils/unit_constants.h"
 #include "tools/ROOT.h"
 
 #include <Eigen/Core>
@@ -48,6 +51,9 @@ CapacitiveTransferModule::CapacitiveTransferModule(Configuration& config,
 
     // Require propagated deposits for single detector
     messenger_->bindSingle<PropagatedChargeMessage>(this, MsgFlags::REQUIRED);
+
+    // Declare the messages dispatched by this module
+    declare_output<PixelChargeMessage>();
 }
 
 void CapacitiveTransferModule::initialize() {
@@ -56,6 +62,7 @@ void CapacitiveTransferModule::initialize() {
         throw InvalidCombinationError(
             config_, {"coupling_matrix", "coupling_file", "coupling_scan_file"}, "More than one coupling input defined");
     } else if(config_.has("coupling_matrix")) {
+        coupling_input_ = CouplingInput::MATRIX;
         relative_coupling_ = config_.getMatrix<double>("coupling_matrix");
         matrix_rows_ = static_cast<unsigned int>(relative_coupling_.size());
         matrix_cols_ = static_cast<unsigned int>(relative_coupling_[0].size());
@@ -87,6 +94,7 @@ void CapacitiveTransferModule::initialize() {
         LOG(STATUS) << max_col_ << "x" << max_row_ << " coupling matrix imported from config file";
 
     } else if(config_.has("coupling_file")) {
+        coupling_input_ = CouplingInput::MATRIX_FILE;
         LOG(TRACE) << "Reading cross-coupling matrix file " << config_.get<std::string>("coupling_file");
         std::ifstream input_file(config_.getPath("coupling_file", true), std::ifstream::in);
         if(!input_file.good()) {
@@ -152,6 +160,7 @@ void CapacitiveTransferModule::initialize() {
                     << config_.get<std::string>("coupling_file");
 
     } else if(config_.has("coupling_scan_file")) {
+        coupling_input_ = CouplingInput::SCAN_FILE;
         auto* root_file = new TFile(config_.getPath("coupling_scan_file", true).c_str());
         if(root_file->IsZombie()) {
             throw InvalidValueError(config_, "coupling_scan_file", "ROOT file is corrupted. Please, check it");
@@ -258,15 +267,83 @@ void CapacitiveTransferModule::initialize() {
             "Capacitive coupling was not defined. Please, check the README file for configuration options or use "
             "the SimpleTransfer module.");
     }
+
+    // Precompute the stencil of pixels receiving charge, keeping only entries with non-zero coupling
+    auto center_col = static_cast<size_t>(std::floor(matrix_cols_ / 2));
+    auto center_row = static_cast<size_t>(std::floor(matrix_rows_ / 2));
+    for(size_t row = 0; row < matrix_rows_; row++) {
+        for(size_t col = 0; col < matrix_cols_; col++) {
+            if(!cross_coupling_ && (row != center_row || col != center_col)) {
+                continue;
+            }
+
+            double ccpd_factor = 0;
+            if(coupling_input_ == CouplingInput::SCAN_FILE) {
+                // The coupling depends on the gap at the receiving pixel and is tabulated separately
+                ccpd_factor = 1;
+            } else if(coupling_input_ == CouplingInput::MATRIX_FILE) {
+                ccpd_factor = relative_coupling_[col][row];
+            } else {
+                ccpd_factor = relative_coupling_[matrix_rows_ - row - 1][col];
+            }
+
+            if(std::fabs(ccpd_factor) < std::numeric_limits<double>::epsilon()) {
+                LOG(TRACE) << "Detected zero coupling for neighbour " << col << "," << row << ", skipping";
+                continue;
+            }
+
+            coupling_stencil_.push_back({static_cast<int>(col) - static_cast<int>(center_col),
+                                         static_cast<int>(row) - static_cast<int>(center_row),
+                                         row * matrix_cols_ + col,
+                                         ccpd_factor});
+        }
+    }
+    LOG(DEBUG) << "Coupling stencil with " << coupling_stencil_.size() << " non-zero entries";
+
+    // Evaluate the capacitance scan once at the gap of every pixel for the configured tilt of the chips
+    if(coupling_input_ == CouplingInput::SCAN_FILE) {
+        auto xpixels = model_->getNPixels().x();
+        auto ypixels = model_->getNPixels().y();
+        scan_coupling_.assign(static_cast<size_t>(xpixels) * ypixels * 9, 0.);
+        for(unsigned int x = 0; x < xpixels; x++) {
+            for(unsigned int y = 0; y < ypixels; y++) {
+                auto local_x = x * model_->getPixelSize().x();
+                auto local_y = y * model_->getPixelSize().y();
+                auto pixel_gap = plane_.projection(Eigen::Vector3d(local_x, local_y, 0))[2];
+                for(const auto& entry : coupling_stencil_) {
+                    scan_coupling_[(x * static_cast<size_t>(ypixels) + y) * 9 + entry.index] =
+                        capacitances_[entry.index]->Eval(
+                            static_cast<double>(Units::convert(pixel_gap, "um")), nullptr, "S") *
+                        normalization_;
+                }
+            }
+        }
+    }
+}
+
+double CapacitiveTransferModule::scan_coupling(const Pixel::Index& pixel_index, size_t entry) const {
+    auto xpixels = static_cast<int>(model_->getNPixels().x());
+    auto ypixels = static_cast<int>(model_->getNPixels().y());
+    if(pixel_index.x() >= 0 && pixel_index.x() < xpixels && pixel_index.y() >= 0 && pixel_index.y() < ypixels) {
+        return scan_coupling_[(static_cast<size_t>(pixel_index.x()) * static_cast<size_t>(ypixels) +
+                               static_cast<size_t>(pixel_index.y())) *
+                                  9 +
+                              entry];
+    }
+
+    // Pixel indices outside of the rectangular range, as used by hexagonal pixel matrices, are evaluated directly
+    double local_x = pixel_index.x() * model_->getPixelSize().x();
+    double local_y = pixel_index.y() * model_->getPixelSize().y();
+    auto pixel_gap = plane_.projection(Eigen::Vector3d(local_x, local_y, 0))[2];
+    return capacitances_[entry]->Eval(pixel_gap / units::um, nullptr, "S") * normalization_;
 }
 
 void CapacitiveTransferModule::run(Event* event) {
     auto propagated_message = messenger_->fetchMessage<PropagatedChargeMessage>(this, event);
 
-    // Find corresponding pixels for all propagated charges
+    // Find the nearest pixels for all propagated charges within the depth range of the implants
     LOG(TRACE) << "Transferring charges to pixels";
-    unsigned int transferred_charges_count = 0;
-    std::map<Pixel::Index, std::pair<double, std::vector<const PropagatedCharge*>>> pixel_map;
+    auto& hits = scratch<std::vector<std::pair<const PropagatedCharge*, Pixel::Index>>>();
     for(const auto& propagated_charge : propagated_message->getData()) {
         auto position = propagated_charge.getLocalPosition();
         // Ignore if outside depth range of implant
@@ -280,83 +357,100 @@ void CapacitiveTransferModule::run(Event* event) {
         // Find the nearest pixel
         auto [xpixel, ypixel] = model_->getPixelIndex(position);
         LOG(DEBUG) << "Hit at pixel " << xpixel << ", " << ypixel;
+        hits.emplace_back(&propagated_charge, Pixel::Index(xpixel, ypixel));
+    }
 
-        for(size_t row = 0; row < max_row_; row++) {
-            for(size_t col = 0; col < max_col_; col++) {
-                if(!cross_coupling_) {
-                    col = static_cast<size_t>(std::floor(matrix_cols_ / 2));
-                    row = static_cast<size_t>(std::floor(matrix_rows_ / 2));
-                }
-
-                auto xcoord = xpixel + static_cast<int>(col - static_cast<size_t>(std::floor(matrix_cols_ / 2)));
-                auto ycoord = ypixel + static_cast<int>(row - static_cast<size_t>(std::floor(matrix_rows_ / 2)));
+    // Accumulate the charges in a dense buffer covering all pixels reachable from the hits, ordered like the pixel map.
+    // Widely separated hits, for which the buffer would be much larger than the number of pixels reached, use the map
+    int min_x = std::numeric_limits<int>::max(), min_y = std::numeric_limits<int>::max();
+    int max_x = std::numeric_limits<int>::min(), max_y = std::numeric_limits<int>::min();
+    for(const auto& hit : hits) {
+        for(const auto& entry : coupling_stencil_) {
+            min_x = std::min(min_x, hit.second.x() + entry.dx);
+            max_x = std::max(max_x, hit.second.x() + entry.dx);
+            min_y = std::min(min_y, hit.second.y() + entry.dy);
+            max_y = std::max(max_y, hit.second.y() + entry.dy);
+        }
+    }
+    auto width = (max_x >= min_x ? static_cast<size_t>(max_x - min_x) + 1 : 0);
+    auto height = (max_y >= min_y ? static_cast<size_t>(max_y - min_y) + 1 : 0);
+    auto dense = (width * height <= std::max<size_t>(4096, 4 * hits.size() * coupling_stencil_.size()));
+
+    auto& pixel_buffer = scratch<std::vector<PixelSum>>();
+    std::map<Pixel::Index, PixelSum> pixel_map;
+    if(dense) {
+        pixel_buffer.resize(width * height);
+    }
 
-                // Ignore if out of pixel grid
-                if(!detector_->getModel()->isWithinMatrix(xcoord, ycoord)) {
-                    LOG(DEBUG) << "Skipping set of propagated charges at " << propagated_charge.getLocalPosition()
-                               << " because their nearest pixel (" << xpixel << "," << ypixel
-                               << ") is outside the pixel matrix";
-                    continue;
-                }
+    unsigned int transferred_charges_count = 0;
+    for(const auto& [propagated_charge, pixel] : hits) {
+        for(const auto& entry : coupling_stencil_) {
+            auto xcoord = pixel.x() + entry.dx;
+            auto ycoord = pixel.y() + entry.dy;
+
+            // Ignore if out of pixel grid
+            if(!model_->isWithinMatrix(xcoord, ycoord)) {
+                LOG(DEBUG) << "Skipping set of propagated charges at " << propagated_charge->getLocalPosition()
+                           << " because their nearest pixel (" << pixel.x() << "," << pixel.y()
+                           << ") is outside the pixel matrix";
+                continue;
+            }
 
-                auto pixel_index = Pixel::Index(xcoord, ycoord);
+            auto pixel_index = Pixel::Index(xcoord, ycoord);
 
-                double ccpd_factor = 0;
-                if(config_.has("coupling_scan_file")) {
-                    double local_x = pixel_index.x() * model_->getPixelSize().x();
-                    double local_y = pixel_index.y() * model_->getPixelSize().y();
-                    auto pixel_point = Eigen::Vector3d(local_x, local_y, 0);
-                    auto pixel_projection = plane_.projection(pixel_point);
-                    auto pixel_gap = pixel_projection[2];
-
-                    ccpd_factor = capacitances_[row * 3 + col]->Eval(
-                                      static_cast<double>(Units::convert(pixel_gap, "um")), nullptr, "S") *
-                                  normalization_;
-                } else if(config_.has("coupling_file")) {
-                    ccpd_factor = relative_coupling_[col][row];
-                } else if(config_.has("coupling_matrix")) {
-                    ccpd_factor = relative_coupling_[max_row_ - row - 1][col];
-                } else {
-                    ccpd_factor = 1;
-                    LOG(ERROR) << "This shouldn't happen. Transferring 100% of detected charge";
-                }
+            auto ccpd_factor = entry.factor;
+            if(coupling_input_ == CouplingInput::SCAN_FILE) {
+                ccpd_factor = scan_coupling(pixel_index, entry.index);
 
                 // If there is no cross-coupling (factor is zero) don't create a pixel hit:
                 if(std::fabs(ccpd_factor) < std::numeric_limits<double>::epsilon()) {
                     LOG(TRACE) << "Detected zero coupling, skipping pixel hit creation";
                     continue;
                 }
-
-                // Update statistics
-                transferred_charges_count += static_cast<unsigned int>(propagated_charge.getCharge() * ccpd_factor);
-                auto neighbour_charge =
-                    static_cast<double>(propagated_charge.getSign() * propagated_charge.getCharge()) * ccpd_factor;
-
-                LOG(DEBUG) << "Set of " << propagated_charge.getCharge() * ccpd_factor << " charges brought to neighbour "
-                           << col << "," << row << " pixel " << pixel_index << "with cross-coupling of " << ccpd_factor * 100
-                           << "%";
-
-                // Add the pixel the list of hit pixels
-                pixel_map[pixel_index].first += neighbour_charge;
-                pixel_map[pixel_index].second.emplace_back(&propagated_charge);
             }
+
+            // Update statistics
+            transferred_charges_count += static_cast<unsigned int>(propagated_charge->getCharge() * ccpd_factor);
+            auto neighbour_charge =
+                static_cast<double>(propagated_charge->getSign() * propagated_charge->getCharge()) * ccpd_factor;
+
+            LOG(DEBUG) << "Set of " << propagated_charge->getCharge() * ccpd_factor << " charges brought to neighbour "
+                       << entry.dx << "," << entry.dy << " pixel " << pixel_index << "with cross-coupling of "
+                       << ccpd_factor * 100 << "%";
+
+            // Add the pixel the list of hit pixels
+            auto& sum = (dense ? pixel_buffer[static_cast<size_t>(xcoord - min_x) * height +
+                                              static_cast<size_t>(ycoord - min_y)]
+                               : pixel_map[pixel_index]);
+            sum.charge += neighbour_charge;
+            sum.propagated_charges.emplace_back(propagated_charge);
         }
     }
 
     // Create pixel charges
     LOG(TRACE) << "Combining charges at same pixel";
     std::vector<PixelCharge> pixel_charges;
-    for(auto& pixel_index_charge : pixel_map) {
-        double charge = pixel_index_charge.second.first;
-
+    auto create_pixel_charge = [&](const Pixel::Index& pixel_index, const PixelSum& sum) {
         // Get pixel object from detector
-        auto pixel = detector_->getPixel(pixel_index_charge.first.x(), pixel_index_charge.first.y());
-        pixel_charges.emplace_back(pixel, charge, pixel_index_charge.second.second);
-        LOG(DEBUG) << "Set of " << charge << " charges combined at " << pixel.getIndex();
+        auto pixel = detector_->getPixel(pixel_index.x(), pixel_index.y());
+        pixel_charges.emplace_back(pixel, sum.charge, sum.propagated_charges);
+        LOG(DEBUG) << "Set of " << sum.charge << " charges combined at " << pixel.getIndex();
+    };
+    if(dense) {
+        for(size_t i = 0; i < pixel_buffer.size(); i++) {
+            if(!pixel_buffer[i].propagated_charges.empty()) {
+                create_pixel_charge(Pixel::Index(min_x + static_cast<int>(i / height), min_y + static_cast<int>(i % height)),
+                                    pixel_buffer[i]);
+            }
+        }
+    } else {
+        for(const auto& [pixel_index, sum] : pixel_map) {
+            create_pixel_charge(pixel_index, sum);
+        }
     }
 
     // Writing summary and update statistics
-    LOG(INFO) << "Transferred " << transferred_charges_count << " charges to " << pixel_map.size() << " pixels";
+    LOG(INFO) << "Transferred " << transferred_charges_count << " charges to " << pixel_charges.size() << " pixels";
     total_transferred_charges_ += transferred_charges_count;
 
     // Dispatch message of pixel charges
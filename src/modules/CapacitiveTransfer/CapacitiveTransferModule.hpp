@@ -77,6 +77,14 @@ namespace allpix {
         // Statistical information
         std::atomic<unsigned int> total_transferred_charges_{};
 
+        // Source of the cross-coupling values
+        enum class CouplingInput {
+            MATRIX,
+            MATRIX_FILE,
+            SCAN_FILE,
+        };
+        CouplingInput coupling_input_{};
+
         // Matrix to store cross-coupling values
         std::vector<std::vector<double>> relative_coupling_;
         unsigned int matrix_rows_{};
@@ -91,6 +99,32 @@ namespace allpix {
         void getCapacitanceScan(TFile* root_file);
         std::array<TGraph*, 9> capacitances_{};
 
+        /**
+         * @brief Get the coupling to a pixel from the capacitance scan at the gap of this pixel
+         * @param pixel_index Index of the pixel receiving the charge
+         * @param entry Entry of the 3x3 coupling stencil, counted row by row
+         * @return Coupling to the pixel relative to the nominal coupling of the central pixel
+         */
+        double scan_coupling(const Pixel::Index& pixel_index, size_t entry) const;
+
+        // Entries of the coupling matrix with non-zero coupling, as offsets from the nearest pixel
+        struct CouplingEntry {
+            int dx;
+            int dy;
+            size_t index;
+            double factor;
+        };
+        std::vector<CouplingEntry> coupling_stencil_;
+
+        // Coupling from the capacitance scan for every pixel of the matrix and every entry of the 3x3 stencil
+        std::vector<double> scan_coupling_;
+
+        // Charge and history accumulated at a pixel
+        struct PixelSum {
+            double charge{};
+            std::vector<const PropagatedCharge*> propagated_charges;
+        };
+
         Eigen::Hyperplane<double, 3> plane_;
 
         Histogram<TH2D> coupling_map;
@@ -14,10 +14,12 @@
 #include <Math/RotationZYX.h>
 #include <TProcessID.h>
 
+#include <algorithm>
 #include <fstream>
 #include <string>
 #include <utility>
 
+#include "core/messenger/exceptions.h"
 #include "core/utils/log.h"
 
 using namespace allpix;
@@ -27,8 +29,19 @@ CorryvreckanWriterModule::CorryvreckanWriterModule(Configuration& config, Messen
     // Enable multithreading of this module if multithreading is enabled
     allow_multithreading();
 
-    // Require PixelHit messages for single detector
-    messenger_->bindMulti<PixelHitMessage>(this, MsgFlags::REQUIRED);
+    // Prepare the events in parallel and only fill the trees in order
+    parallel_assembly_ = config_.get<bool>("parallel_assembly", false);
+    max_buffered_events_ = config_.get<size_t>("max_buffered_events", 128);
+    if(max_buffered_events_ == 0) {
+        throw InvalidValueError(config_, "max_buffered_events", "number of buffered events should be larger than zero");
+    }
+    if(parallel_assembly_) {
+        waive_sequence_requirement();
+    }
+
+    // Require PixelHit messages for single detector, with parallel assembly the module has to run for every event to keep
+    // the order
+    messenger_->bindMulti<PixelHitMessage>(this, parallel_assembly_ ? MsgFlags::NONE : MsgFlags::REQUIRED);
 
     config_.setDefault("file_name", "corryvreckanOutput.root");
     config_.setDefault("geometry_file", "corryvreckanGeometry.conf");
@@ -80,31 +93,42 @@ void CorryvreckanWriterModule::initialize() {
 
     // Initialise the time
     time_ = 0;
+    next_event_ = getConfigManager()->getGlobalConfiguration().get<uint64_t>("skip_events", 0) + 1;
 }
 
 // Make instantiations of Corryvreckan pixels, and store these in the trees during run time
 void CorryvreckanWriterModule::run(Event* event) {
-    auto root_lock = root_process_lock();
-
-    auto pixel_messages = messenger_->fetchMultiMessage<PixelHitMessage>(this, event);
-
-    // Retrieve current object count:
-    auto object_count = TProcessID::GetObjectCount();
+    std::vector<std::shared_ptr<PixelHitMessage>> pixel_messages;
+    try {
+        pixel_messages = messenger_->fetchMultiMessage<PixelHitMessage>(this, event);
+    } catch(const MessageNotFoundException&) {
+        if(!parallel_assembly_) {
+            throw;
+        }
+        // Messages are bound optionally, events without pixel hits are skipped as without this mode
+        LOG(TRACE) << "No pixel hits received, not writing event";
+        queue_event(event->number, nullptr);
+        return;
+    }
 
     LOG(TRACE) << "Processing event " << event->number;
+    auto prepared = prepare_event(pixel_messages);
 
-    // Create and store a new Event:
-    event_ = new corryvreckan::Event(time_, time_ + 5);
-    LOG(DEBUG) << "Defining event for Corryvreckan: [" << Units::display(event_->start(), {"ns", "um"}) << ","
-               << Units::display(event_->end(), {"ns", "um"}) << "]";
-    event_tree_->Fill();
+    if(parallel_assembly_) {
+        queue_event(event->number, std::move(prepared));
+        return;
+    }
 
-    // Events start with 1, pre-filling only with empty events before:
-    auto event_id = event->number - 1;
+    auto root_lock = root_process_lock();
+    commit_event(event->number, *prepared);
+}
 
-    // Loop through all received messages
-    for(auto& message : pixel_messages) {
+std::unique_ptr<CorryvreckanWriterModule::PreparedEvent>
+CorryvreckanWriterModule::prepare_event(const std::vector<std::shared_ptr<PixelHitMessage>>& pixel_messages) {
+    auto prepared = std::make_unique<PreparedEvent>();
 
+    // Loop through all received messages
+    for(const auto& message : pixel_messages) {
         auto detector_name = message->getDetector()->getName();
 
         // Calculate coordinate system offset for MC truth storage
@@ -116,6 +140,64 @@ void CorryvreckanWriterModule::run(Event* event) {
 
         LOG(DEBUG) << "Received " << message->getData().size() << " pixel hits from detector " << detector_name;
 
+        prepared->detectors.emplace_back();
+        auto& detector = prepared->detectors.back();
+        detector.name = detector_name;
+
+        // Take the pixels of all hits from the pool at once
+        pixel_pool_.acquire(detector.pixels, message->getData().size());
+        auto corry_pixel = detector.pixels.begin();
+
+        // Fill the prepared objects, global timestamps are shifted by the event time when committing the event
+        for(const auto& apx_pixel : message->getData()) {
+            **(corry_pixel++) =
+                corryvreckan::Pixel(detector_name,
+                                    apx_pixel.getPixel().getIndex().X(),
+                                    apx_pixel.getPixel().getIndex().Y(),
+                                    static_cast<int>(apx_pixel.getSignal()),
+                                    apx_pixel.getSignal(),
+                                    (timing_global_ ? apx_pixel.getGlobalTime() : apx_pixel.getLocalTime()));
+
+            // If writing MC truth then also write out associated particle info
+            if(!output_mc_truth_) {
+                continue;
+            }
+
+            // Get all associated particles
+            auto mcp = apx_pixel.getMCParticles();
+            LOG(DEBUG) << "Received " << mcp.size() << " Monte Carlo particles from pixel hit";
+            auto mc_particle = detector.mcparticles.size();
+            mcparticle_pool_.acquire(detector.mcparticles, mcp.size());
+            for(auto& particle : mcp) {
+                *detector.mcparticles[mc_particle++] =
+                    corryvreckan::MCParticle(detector_name,
+                                             particle->getParticleID(),
+                                             particle->getLocalStartPoint() + offset,
+                                             particle->getLocalEndPoint() + offset,
+                                             (timing_global_ ? particle->getGlobalTime() : particle->getLocalTime()));
+            }
+        }
+    }
+
+    return prepared;
+}
+
+void CorryvreckanWriterModule::commit_event(uint64_t event_number, PreparedEvent& prepared) {
+    // Retrieve current object count:
+    auto object_count = TProcessID::GetObjectCount();
+
+    // Create and store a new Event:
+    event_ = new corryvreckan::Event(time_, time_ + 5);
+    LOG(DEBUG) << "Defining event for Corryvreckan: [" << Units::display(event_->start(), {"ns", "um"}) << ","
+               << Units::display(event_->end(), {"ns", "um"}) << "]";
+    event_tree_->Fill();
+
+    // Events start with 1, pre-filling only with empty events before:
+    auto event_id = event_number - 1;
+
+    for(auto& detector : prepared.detectors) {
+        const auto& detector_name = detector.name;
+
         if(write_list_px_.find(detector_name) == write_list_px_.end()) {
             write_list_px_[detector_name] = new std::vector<corryvreckan::Pixel*>();
             pixel_tree_->Bronch(detector_name.c_str(),
@@ -139,7 +221,6 @@ void CorryvreckanWriterModule::run(Event* event) {
                                      &write_list_mcp_[detector_name]);
 
             if(event_id > 0) {
-
                 LOG(DEBUG) << "Pre-filling new branch " << detector_name << " of corryvreckan::MCParticle with " << event_id
                            << " empty events";
                 auto* branch = mcparticle_tree_->GetBranch(detector_name.c_str());
@@ -149,35 +230,25 @@ void CorryvreckanWriterModule::run(Event* event) {
             }
         }
 
-        // Fill the branch vector
-        for(const auto& apx_pixel : message->getData()) {
-            auto* corry_pixel = new corryvreckan::Pixel(
-                detector_name,
-                apx_pixel.getPixel().getIndex().X(),
-                apx_pixel.getPixel().getIndex().Y(),
-                static_cast<int>(apx_pixel.getSignal()),
-                apx_pixel.getSignal(),
-                (timing_global_ ? event_->start() + apx_pixel.getGlobalTime() : apx_pixel.getLocalTime()));
-            write_list_px_[detector_name]->push_back(corry_pixel);
-
-            // If writing MC truth then also write out associated particle info
-            if(!output_mc_truth_) {
-                continue;
+        // Shift global timestamps now that the event time is known
+        if(timing_global_) {
+            for(auto* pixel : detector.pixels) {
+                pixel->setTimestamp(event_->start() + pixel->timestamp());
             }
-
-            // Get all associated particles
-            auto mcp = apx_pixel.getMCParticles();
-            LOG(DEBUG) << "Received " << mcp.size() << " Monte Carlo particles from pixel hit";
-            for(auto& particle : mcp) {
-                auto* mcParticle = new corryvreckan::MCParticle(
-                    detector_name,
-                    particle->getParticleID(),
-                    particle->getLocalStartPoint() + offset,
-                    particle->getLocalEndPoint() + offset,
-                    (timing_global_ ? event_->start() + particle->getGlobalTime() : particle->getLocalTime()));
-                write_list_mcp_[detector_name]->push_back(mcParticle);
+            for(auto* mcp : detector.mcparticles) {
+                mcp->setTimestamp(event_->start() + mcp->timestamp());
             }
         }
+
+        // Fill the branch vectors
+        auto* pixels = write_list_px_[detector_name];
+        pixels->insert(pixels->end(), detector.pixels.begin(), detector.pixels.end());
+        detector.pixels.clear();
+        if(output_mc_truth_) {
+            auto* mcparticles = write_list_mcp_[detector_name];
+            mcparticles->insert(mcparticles->end(), detector.mcparticles.begin(), detector.mcparticles.end());
+            detector.mcparticles.clear();
+        }
     }
 
     LOG(TRACE) << "Writing new objects to tree";
@@ -188,20 +259,12 @@ void CorryvreckanWriterModule::run(Event* event) {
         mcparticle_tree_->Fill();
     }
 
-    // Clear the current write lists
+    // Return the objects of the current write lists to the pools
     for(auto& index_data : write_list_px_) {
-        for(auto& pixel : (*index_data.second)) {
-            delete pixel;
-        }
-        index_data.second->clear();
+        pixel_pool_.release(*index_data.second);
     }
-
-    // Clear the current write lists
     for(auto& index_data : write_list_mcp_) {
-        for(auto& mcp : (*index_data.second)) {
-            delete mcp;
-        }
-        index_data.second->clear();
+        mcparticle_pool_.release(*index_data.second);
     }
 
     // Increment the time till the next event
@@ -214,8 +277,43 @@ void CorryvreckanWriterModule::run(Event* event) {
     TProcessID::SetObjectCount(object_count);
 }
 
+void CorryvreckanWriterModule::queue_event(uint64_t event_number, std::unique_ptr<PreparedEvent> prepared) {
+    std::lock_guard<std::mutex> lock(buffer_mutex_);
+    buffer_.emplace(event_number, std::move(prepared));
+
+    // Commit all events next in order, or the earliest buffered event if the buffer is full
+    while(!buffer_.empty() && (buffer_.begin()->first <= next_event_ || buffer_.size() > max_buffered_events_)) {
+        commit_buffered_event();
+    }
+}
+
+void CorryvreckanWriterModule::commit_buffered_event() {
+    auto event_number = buffer_.begin()->first;
+    auto prepared = std::move(buffer_.begin()->second);
+    buffer_.erase(buffer_.begin());
+
+    if(event_number > next_event_) {
+        LOG(DEBUG) << "Events " << next_event_ << " to " << (event_number - 1)
+                   << " have not been received, continuing with event " << event_number;
+    } else if(event_number < next_event_) {
+        LOG(WARNING) << "Event " << event_number << " received after the buffer of " << max_buffered_events_
+                     << " events has been exceeded, writing it out of order";
+    }
+    next_event_ = std::max(next_event_, event_number + 1);
+
+    if(prepared != nullptr) {
+        auto root_lock = root_process_lock();
+        commit_event(event_number, *prepared);
+    }
+}
+
 // Save the output trees to file
 void CorryvreckanWriterModule::finalize() {
+    // Commit the remaining buffered events
+    while(!buffer_.empty()) {
+        commit_buffered_event();
+    }
+
 
     // Finish writing to output file
     output_file_->Write();
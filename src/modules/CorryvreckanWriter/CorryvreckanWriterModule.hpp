@@ -9,7 +9,13 @@
  * SPDX-License-Identifier: MIT
  */
 
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include "core/config/Configuration.hpp"
 #include "core/geometry/GeometryManager.hpp"
@@ -31,9 +37,11 @@
 namespace allpix {
     /**
      * @ingroup Modules
-     * @brief Module to do function
+     * @brief Module to write pixel hits in the Corryvreckan format
      *
-     * More detailed explanation of module
+     * Converts the pixel hits of every event to Corryvreckan objects taken from object pools and fills them to the output
+     * trees. With parallel assembly, the objects are prepared by the worker threads in parallel and only the filling of the
+     * trees is done in order of the event numbers.
      */
 
     class CorryvreckanWriterModule : public SequentialModule {
@@ -62,6 +70,89 @@ namespace allpix {
         void finalize() override;
 
     private:
+        /**
+         * @brief Pool of Corryvreckan objects reused between events
+         *
+         * All objects are owned by the pool and handed out for the preparation of an event. They are returned to the pool
+         * after the event has been written to the trees.
+         */
+        template <typename T> class ObjectPool {
+        public:
+            /**
+             * @brief Take objects from the pool, creating new objects if the pool is exhausted
+             * @param objects List to append the objects to
+             * @param count Number of objects to take
+             */
+            void acquire(std::vector<T*>& objects, size_t count) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                while(free_.size() < count) {
+                    objects_.push_back(std::make_unique<T>());
+                    free_.push_back(objects_.back().get());
+                }
+                objects.insert(objects.end(), free_.end() - static_cast<std::ptrdiff_t>(count), free_.end());
+                free_.resize(free_.size() - count);
+            }
+
+            /**
+             * @brief Return objects to the pool
+             * @param objects List of objects to return, cleared afterwards
+             */
+            void release(std::vector<T*>& objects) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                free_.insert(free_.end(), objects.begin(), objects.end());
+                objects.clear();
+            }
+
+        private:
+            std::mutex mutex_;
+            std::vector<std::unique_ptr<T>> objects_;
+            std::vector<T*> free_;
+        };
+
+        /**
+         * @brief Corryvreckan objects of a single detector prepared for an event
+         */
+        struct PreparedDetector {
+            std::string name;
+            std::vector<corryvreckan::Pixel*> pixels;
+            std::vector<corryvreckan::MCParticle*> mcparticles;
+        };
+
+        /**
+         * @brief Corryvreckan objects prepared for an event, in the order of the received messages
+         */
+        struct PreparedEvent {
+            std::vector<PreparedDetector> detectors;
+        };
+
+        /**
+         * @brief Convert the pixel hits of an event to Corryvreckan objects
+         * @param pixel_messages Messages with the pixel hits of the event
+         * @return Prepared objects of the event, with global timestamps relative to the begin of the event
+         */
+        std::unique_ptr<PreparedEvent> prepare_event(const std::vector<std::shared_ptr<PixelHitMessage>>& pixel_messages);
+
+        /**
+         * @brief Fill the prepared objects of an event to the trees and return them to the pools
+         * @param event_number Number of the event
+         * @param prepared Prepared objects of the event
+         * @warning Requires the ROOT process lock to be held
+         */
+        void commit_event(uint64_t event_number, PreparedEvent& prepared);
+
+        /**
+         * @brief Buffer a prepared event and commit all buffered events which are next in order
+         * @param event_number Number of the event
+         * @param prepared Prepared objects of the event, or a null pointer if the event is not written
+         */
+        void queue_event(uint64_t event_number, std::unique_ptr<PreparedEvent> prepared);
+
+        /**
+         * @brief Commit the earliest buffered event
+         * @warning Requires the buffer mutex to be held
+         */
+        void commit_buffered_event();
+
         // General module members
         Messenger* messenger_;
         GeometryManager* geometryManager_;
@@ -84,5 +175,16 @@ namespace allpix {
         std::unique_ptr<TTree> mcparticle_tree_;
         std::map<std::string, std::vector<corryvreckan::Pixel*>*> write_list_px_;
         std::map<std::string, std::vector<corryvreckan::MCParticle*>*> write_list_mcp_;
+
+        // Pools of the objects written to the trees
+        ObjectPool<corryvreckan::Pixel> pixel_pool_;
+        ObjectPool<corryvreckan::MCParticle> mcparticle_pool_;
+
+        // Events prepared in parallel and buffered until they can be committed in order
+        bool parallel_assembly_{};
+        size_t max_buffered_events_{};
+        std::mutex buffer_mutex_;
+        std::map<uint64_t, std::unique_ptr<PreparedEvent>> buffer_;
+        uint64_t next_event_{};
     };
 } // namespace allpix
@@ -29,11 +29,18 @@
 using namespace allpix;
 
 thread_local std::shared_ptr<pqxx::connection> DatabaseWriterModule::conn_ = nullptr;
+thread_local std::unique_ptr<DatabaseWriterModule::RowBatch> DatabaseWriterModule::batch_ = nullptr;
+thread_local std::map<std::string, std::deque<int>> DatabaseWriterModule::reserved_row_numbers_;
+
+// Number of row numbers reserved from the sequence of a table at once in batched mode
+static constexpr int row_number_block_size = 1024;
 
 DatabaseWriterModule::DatabaseWriterModule(Configuration& config, Messenger* messenger, GeometryManager*)
     : SequentialModule(config), messenger_(messenger) {
     // Enable multithreading of this module if multithreading is enabled
     allow_multithreading();
+    // Writing to the database is not visible to the framework
+    declare_side_effects();
     // Bind to all messages with filter
     messenger_->registerFilter(this, &DatabaseWriterModule::filter);
 
@@ -57,6 +64,38 @@ DatabaseWriterModule::DatabaseWriterModule(Configuration& config, Messenger* mes
     if(!config_.get<bool>("require_sequence")) {
         waive_sequence_requirement();
     }
+
+    // Buffer the rows of multiple events to write them with COPY, optionally in a background thread
+    batch_size_ = config_.get<unsigned int>("batch_size", 0);
+    background_writing_ = config_.get<bool>("background_writing", false);
+    max_queued_batches_ = config_.get<size_t>("max_queued_batches", 16);
+    if(background_writing_ && batch_size_ == 0) {
+        throw InvalidCombinationError(
+            config_, {"background_writing", "batch_size"}, "background writing requires a batch size larger than zero");
+    }
+    if(max_queued_batches_ == 0) {
+        throw InvalidValueError(config_, "max_queued_batches", "number of queued batches should be larger than zero");
+    }
+}
+
+DatabaseWriterModule::~DatabaseWriterModule() {
+    if(writer_thread_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            stop_writer_ = true;
+        }
+        queue_condition_.notify_all();
+        writer_thread_.join();
+    }
+}
+
+std::shared_ptr<pqxx::connection> DatabaseWriterModule::connect() const {
+    auto connection = std::make_shared<pqxx::connection>("host=" + host_ + " port=" + port_ + " dbname=" + database_name_ +
+                                                         " user=" + user_ + " password=" + password_);
+    if(!connection->is_open()) {
+        throw ModuleError("Could not connect to database " + database_name_ + " at host " + host_);
+    }
+    return connection;
 }
 
 void DatabaseWriterModule::prepare_statements(const std::shared_ptr<pqxx::connection>& connection) {
@@ -100,13 +139,48 @@ void DatabaseWriterModule::prepare_statements(const std::shared_ptr<pqxx::connec
                         "hittime) VALUES ($1, $2, $3, $4, $5, $6, $7, $8, $9) RETURNING pixelHit_nr;");
 }
 
+void DatabaseWriterModule::initialize() {
+    if(!background_writing_) {
+        return;
+    }
+
+    // The background thread writes with its own connection, such that workers only block if too many batches are queued
+    auto connection = connect();
+    LOG(DEBUG) << "Starting background thread writing batches of " << batch_size_ << " events";
+    writer_thread_ = std::thread([this, connection]() {
+        try {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            while(true) {
+                queue_condition_.wait(lock, [this]() { return stop_writer_ || !queue_.empty(); });
+                if(queue_.empty()) {
+                    break;
+                }
+                auto batch = std::move(queue_.front());
+                queue_.pop_front();
+                lock.unlock();
+                queue_condition_.notify_all();
+
+                write_batch(*connection, *batch);
+
+                lock.lock();
+            }
+        } catch(...) {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            writer_error_ = std::current_exception();
+            queue_.clear();
+        }
+        queue_condition_.notify_all();
+#if PQXX_VERSION_MAJOR > 6
+        connection->close();
+#else
+        connection->disconnect();
+#endif
+    });
+}
+
 void DatabaseWriterModule::initializeThread() {
     // Establishing connection to the database
-    conn_ = std::make_shared<pqxx::connection>("host=" + host_ + " port=" + port_ + " dbname=" + database_name_ +
-                                               " user=" + user_ + " password=" + password_);
-    if(!conn_->is_open()) {
-        throw ModuleError("Could not connect to database " + database_name_ + " at host " + host_);
-    }
+    conn_ = connect();
 
     prepare_statements(conn_);
 
@@ -170,8 +244,205 @@ bool DatabaseWriterModule::filter(const std::shared_ptr<BaseMessage>& message,
     return true;
 }
 
+template <typename Row, typename... Args>
+int DatabaseWriterModule::insert(pqxx::work* transaction,
+                                 std::vector<Row>& rows,
+                                 const std::string& table,
+                                 const std::string& statement,
+                                 const Args&... values) {
+    if(transaction != nullptr) {
+        return transaction->exec_prepared1(statement, values...).front().template as<int>();
+    }
+
+    auto row_number = reserve_row_number(table);
+    rows.emplace_back(row_number, values...);
+    return row_number;
+}
+
+int DatabaseWriterModule::reserve_row_number(const std::string& table) {
+    // Reserve a block of numbers from the sequence of the table, such that rows can reference each other before writing
+    auto& row_numbers = reserved_row_numbers_[table];
+    if(row_numbers.empty()) {
+        pqxx::work transaction(*conn_);
+        auto result = transaction.exec("SELECT nextval(pg_get_serial_sequence('" + table + "', '" + table +
+                                       "_nr')) FROM generate_series(1, " + std::to_string(row_number_block_size) + ");");
+        transaction.commit();
+        for(const auto& row : result) {
+            row_numbers.push_back(row.front().as<int>());
+        }
+        LOG(TRACE) << "Reserved " << row_numbers.size() << " row numbers of table " << table;
+    }
+
+    auto row_number = row_numbers.front();
+    row_numbers.pop_front();
+    return row_number;
+}
+
+/**
+ * @brief Stream rows to a table with a single COPY
+ */
+template <typename Row>
+static void copy_rows(pqxx::work& transaction,
+                      const std::string& table,
+                      const std::vector<std::string>& columns,
+                      const std::vector<Row>& rows) {
+    if(rows.empty()) {
+        return;
+    }
+    pqxx::stream_to stream(transaction, table, columns);
+    for(const auto& row : rows) {
+        stream << row;
+    }
+    stream.complete();
+}
+
+void DatabaseWriterModule::write_batch(pqxx::connection& connection, const RowBatch& batch) {
+    pqxx::work transaction(connection);
+
+    // Tables are written in the order of their references
+    copy_rows(transaction, "event", {"event_nr", "run_nr", "eventid"}, batch.events);
+    copy_rows(transaction,
+              "mctrack",
+              {"mctrack_nr",
+               "run_nr",
+               "event_nr",
+               "detector",
+               "address",
+               "parentaddress",
+               "particleid",
+               "productionprocess",
+               "productionvolume",
+               "initialpositionx",
+               "initialpositiony",
+               "initialpositionz",
+               "finalpositionx",
+               "finalpositiony",
+               "finalpositionz",
+               "initialtime",
+               "finaltime",
+               "initialkineticenergy",
+               "finalkineticenergy"},
+              batch.mc_tracks);
+    copy_rows(transaction,
+              "mcparticle",
+              {"mcparticle_nr",
+               "run_nr",
+               "event_nr",
+               "mctrack_nr",
+               "detector",
+               "address",
+               "parentaddress",
+               "trackaddress",
+               "particleid",
+               "localstartpointx",
+               "localstartpointy",
+               "localstartpointz",
+               "localendpointx",
+               "localendpointy",
+               "localendpointz",
+               "globalstartpointx",
+               "globalstartpointy",
+               "globalstartpointz",
+               "globalendpointx",
+               "globalendpointy",
+               "globalendpointz"},
+              batch.mc_particles);
+    copy_rows(transaction,
+              "depositedcharge",
+              {"depositedcharge_nr",
+               "run_nr",
+               "event_nr",
+               "mcparticle_nr",
+               "detector",
+               "carriertype",
+               "charge",
+               "localx",
+               "localy",
+               "localz",
+               "globalx",
+               "globaly",
+               "globalz"},
+              batch.deposited_charges);
+    copy_rows(transaction,
+              "propagatedcharge",
+              {"propagatedcharge_nr",
+               "run_nr",
+               "event_nr",
+               "depositedcharge_nr",
+               "detector",
+               "carriertype",
+               "charge",
+               "localx",
+               "localy",
+               "localz",
+               "globalx",
+               "globaly",
+               "globalz"},
+              batch.propagated_charges);
+    copy_rows(transaction,
+              "pixelcharge",
+              {"pixelcharge_nr",
+               "run_nr",
+               "event_nr",
+               "propagatedcharge_nr",
+               "detector",
+               "charge",
+               "x",
+               "y",
+               "localx",
+               "localy",
+               "globalx",
+               "globaly"},
+              batch.pixel_charges);
+    copy_rows(transaction,
+              "pixelhit",
+              {"pixelhit_nr",
+               "run_nr",
+               "event_nr",
+               "mcparticle_nr",
+               "pixelcharge_nr",
+               "detector",
+               "x",
+               "y",
+               "signal",
+               "hittime"},
+              batch.pixel_hits);
+
+    transaction.commit();
+    LOG(DEBUG) << "Wrote batch of " << batch.event_count << " events to database";
+}
+
+void DatabaseWriterModule::flush_batch() {
+    if(batch_ == nullptr || batch_->event_count == 0) {
+        return;
+    }
+
+    if(!background_writing_) {
+        write_batch(*conn_, *batch_);
+        batch_->events.clear();
+        batch_->mc_tracks.clear();
+        batch_->mc_particles.clear();
+        batch_->deposited_charges.clear();
+        batch_->propagated_charges.clear();
+        batch_->pixel_charges.clear();
+        batch_->pixel_hits.clear();
+        batch_->event_count = 0;
+        return;
+    }
+
+    // Hand the batch to the background thread, waiting if it cannot keep up
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    queue_condition_.wait(lock, [this]() { return writer_error_ != nullptr || queue_.size() < max_queued_batches_; });
+    if(writer_error_ != nullptr) {
+        std::rethrow_exception(writer_error_);
+    }
+    queue_.push_back(std::move(batch_));
+    lock.unlock();
+    queue_condition_.notify_all();
+}
+
 void DatabaseWriterModule::run(Event* event) {
-    auto messages = messenger_->fetchFilteredMessages(this, event);
+    const auto& messages = messenger_->fetchFilteredMessagesView(this, event);
 
     // TO BE NOTED
     // the correct relations of objects in the database are guaranteed by the fact that sequence of dispatched messages
@@ -187,14 +458,20 @@ void DatabaseWriterModule::run(Event* event) {
 
     LOG(TRACE) << "Writing new objects to database";
     try {
-        // Open new transaction
-        pqxx::work transaction(*conn_);
-        LOG(DEBUG) << "Started new database transaction";
+        // Open new transaction, or buffer the rows in the batch of this thread
+        std::optional<pqxx::work> transaction;
+        if(batch_size_ == 0) {
+            transaction.emplace(*conn_);
+            LOG(DEBUG) << "Started new database transaction";
+        } else if(batch_ == nullptr) {
+            batch_ = std::make_unique<RowBatch>();
+        }
+        auto* work = (transaction.has_value() ? &transaction.value() : nullptr);
+        RowBatch unused_batch;
+        auto& batch = (batch_ == nullptr ? unused_batch : *batch_);
 
         // Writing entry to event table
-        auto event_row = transaction.exec_prepared1("add_event", run_nr_, event->number);
-        int event_nr = event_row.front().as<int>();
-
+        int event_nr = insert(work, batch.events, "event", "add_event", run_nr_, event->number);
         // Looping through messages
         for(auto& pair : messages) {
             auto& message = pair.first;
@@ -207,114 +484,127 @@ void DatabaseWriterModule::run(Event* event) {
                 // Writing objects to corresponding database tables
                 if(class_name == "PixelHit") {
                     auto hit = static_cast<PixelHit&>(object.get());
-                    auto hit_row = transaction.exec_prepared1("add_pixelhit",
-                                                              run_nr_,
-                                                              event_nr,
-                                                              mcparticle_nr,
-                                                              pixelcharge_nr,
-                                                              detectorName,
-                                                              hit.getIndex().X(),
-                                                              hit.getIndex().Y(),
-                                                              hit.getSignal(),
-                                                              (timing_global_ ? hit.getGlobalTime() : hit.getLocalTime()));
-                    LOG(TRACE) << "Inserted PixelHit with db id " << hit_row.front().as<int>();
+                    auto hit_nr = insert(work,
+                                         batch.pixel_hits,
+                                         "pixelhit",
+                                         "add_pixelhit",
+                                         run_nr_,
+                                         event_nr,
+                                         mcparticle_nr,
+                                         pixelcharge_nr,
+                                         detectorName,
+                                         hit.getIndex().X(),
+                                         hit.getIndex().Y(),
+                                         hit.getSignal(),
+                                         (timing_global_ ? hit.getGlobalTime() : hit.getLocalTime()));
+                    LOG(TRACE) << "Inserted PixelHit with db id " << hit_nr;
                 } else if(class_name == "PixelCharge") {
                     auto charge = static_cast<PixelCharge&>(object.get());
-                    auto charge_row = transaction.exec_prepared1("add_pixelcharge",
-                                                                 run_nr_,
-                                                                 event_nr,
-                                                                 propagatedcharge_nr,
-                                                                 detectorName,
-                                                                 charge.getCharge(),
-                                                                 charge.getIndex().X(),
-                                                                 charge.getIndex().Y(),
-                                                                 charge.getPixel().getLocalCenter().X(),
-                                                                 charge.getPixel().getLocalCenter().Y(),
-                                                                 charge.getPixel().getGlobalCenter().X(),
-                                                                 charge.getPixel().getGlobalCenter().Y());
-                    pixelcharge_nr = charge_row.front().as<int>();
+                    pixelcharge_nr = insert(work,
+                                            batch.pixel_charges,
+                                            "pixelcharge",
+                                            "add_pixelcharge",
+                                            run_nr_,
+                                            event_nr,
+                                            propagatedcharge_nr,
+                                            detectorName,
+                                            charge.getCharge(),
+                                            charge.getIndex().X(),
+                                            charge.getIndex().Y(),
+                                            charge.getPixel().getLocalCenter().X(),
+                                            charge.getPixel().getLocalCenter().Y(),
+                                            charge.getPixel().getGlobalCenter().X(),
+                                            charge.getPixel().getGlobalCenter().Y());
                     LOG(TRACE) << "Inserted PixelCharge  with db id " << pixelcharge_nr.value();
                 } else if(class_name == "PropagatedCharge") {
                     PropagatedCharge charge = static_cast<PropagatedCharge&>(object.get());
-                    auto prop_row = transaction.exec_prepared1("add_propagatedcharge",
-                                                               run_nr_,
-                                                               event_nr,
-                                                               depositedcharge_nr,
-                                                               detectorName,
-                                                               static_cast<int>(charge.getType()),
-                                                               charge.getCharge(),
-                                                               charge.getLocalPosition().X(),
-                                                               charge.getLocalPosition().Y(),
-                                                               charge.getLocalPosition().Z(),
-                                                               charge.getGlobalPosition().X(),
-                                                               charge.getGlobalPosition().Y(),
-                                                               charge.getGlobalPosition().Z());
-                    propagatedcharge_nr = prop_row.front().as<int>();
+                    propagatedcharge_nr = insert(work,
+                                                 batch.propagated_charges,
+                                                 "propagatedcharge",
+                                                 "add_propagatedcharge",
+                                                 run_nr_,
+                                                 event_nr,
+                                                 depositedcharge_nr,
+                                                 detectorName,
+                                                 static_cast<int>(charge.getType()),
+                                                 charge.getCharge(),
+                                                 charge.getLocalPosition().X(),
+                                                 charge.getLocalPosition().Y(),
+                                                 charge.getLocalPosition().Z(),
+                                                 charge.getGlobalPosition().X(),
+                                                 charge.getGlobalPosition().Y(),
+                                                 charge.getGlobalPosition().Z());
                     LOG(TRACE) << "Inserted PropagatedCharge with db id " << propagatedcharge_nr.value();
                 } else if(class_name == "MCTrack") {
                     auto track = static_cast<MCTrack&>(object.get());
-                    auto mctrack_row = transaction.exec_prepared1("add_mctrack",
-                                                                  run_nr_,
-                                                                  event_nr,
-                                                                  detectorName,
-                                                                  reinterpret_cast<uintptr_t>(&object),           // NOLINT
-                                                                  reinterpret_cast<uintptr_t>(track.getParent()), // NOLINT
-                                                                  track.getParticleID(),
-                                                                  track.getCreationProcessName(),
-                                                                  track.getOriginatingVolumeName(),
-                                                                  track.getStartPoint().X(),
-                                                                  track.getStartPoint().Y(),
-                                                                  track.getStartPoint().Z(),
-                                                                  track.getEndPoint().X(),
-                                                                  track.getEndPoint().Y(),
-                                                                  track.getEndPoint().Z(),
-                                                                  track.getGlobalStartTime(),
-                                                                  track.getGlobalEndTime(),
-                                                                  track.getKineticEnergyInitial(),
-                                                                  track.getKineticEnergyFinal());
-                    mctrack_nr = mctrack_row.front().as<int>();
+                    mctrack_nr = insert(work,
+                                        batch.mc_tracks,
+                                        "mctrack",
+                                        "add_mctrack",
+                                        run_nr_,
+                                        event_nr,
+                                        detectorName,
+                                        reinterpret_cast<uintptr_t>(&object),           // NOLINT
+                                        reinterpret_cast<uintptr_t>(track.getParent()), // NOLINT
+                                        track.getParticleID(),
+                                        track.getCreationProcessName(),
+                                        track.getOriginatingVolumeName(),
+                                        track.getStartPoint().X(),
+                                        track.getStartPoint().Y(),
+                                        track.getStartPoint().Z(),
+                                        track.getEndPoint().X(),
+                                        track.getEndPoint().Y(),
+                                        track.getEndPoint().Z(),
+                                        track.getGlobalStartTime(),
+                                        track.getGlobalEndTime(),
+                                        track.getKineticEnergyInitial(),
+                                        track.getKineticEnergyFinal());
                     LOG(TRACE) << "Inserted MCTrack with db id " << mctrack_nr.value();
                 } else if(class_name == "DepositedCharge") {
                     auto charge = static_cast<DepositedCharge&>(object.get());
-                    auto depos_row = transaction.exec_prepared1("add_depositedcharge",
-                                                                run_nr_,
-                                                                event_nr,
-                                                                mcparticle_nr,
-                                                                detectorName,
-                                                                static_cast<int>(charge.getType()),
-                                                                charge.getCharge(),
-                                                                charge.getLocalPosition().X(),
-                                                                charge.getLocalPosition().Y(),
-                                                                charge.getLocalPosition().Z(),
-                                                                charge.getGlobalPosition().X(),
-                                                                charge.getGlobalPosition().Y(),
-                                                                charge.getGlobalPosition().Z());
-                    depositedcharge_nr = depos_row.front().as<int>();
+                    depositedcharge_nr = insert(work,
+                                                batch.deposited_charges,
+                                                "depositedcharge",
+                                                "add_depositedcharge",
+                                                run_nr_,
+                                                event_nr,
+                                                mcparticle_nr,
+                                                detectorName,
+                                                static_cast<int>(charge.getType()),
+                                                charge.getCharge(),
+                                                charge.getLocalPosition().X(),
+                                                charge.getLocalPosition().Y(),
+                                                charge.getLocalPosition().Z(),
+                                                charge.getGlobalPosition().X(),
+                                                charge.getGlobalPosition().Y(),
+                                                charge.getGlobalPosition().Z());
                     LOG(TRACE) << "Inserted DepositedCharge with db id " << depositedcharge_nr.value();
                 } else if(class_name == "MCParticle") {
                     auto particle = static_cast<MCParticle&>(object.get());
-                    auto mcp_row = transaction.exec_prepared1("add_mcparticle",
-                                                              run_nr_,
-                                                              event_nr,
-                                                              mctrack_nr,
-                                                              detectorName,
-                                                              reinterpret_cast<uintptr_t>(&object),              // NOLINT
-                                                              reinterpret_cast<uintptr_t>(particle.getParent()), // NOLINT
-                                                              reinterpret_cast<uintptr_t>(particle.getTrack()),  // NOLINT
-                                                              particle.getParticleID(),
-                                                              particle.getLocalStartPoint().X(),
-                                                              particle.getLocalStartPoint().Y(),
-                                                              particle.getLocalStartPoint().Z(),
-                                                              particle.getLocalEndPoint().X(),
-                                                              particle.getLocalEndPoint().Y(),
-                                                              particle.getLocalEndPoint().Z(),
-                                                              particle.getGlobalStartPoint().X(),
-                                                              particle.getGlobalStartPoint().Y(),
-                                                              particle.getGlobalStartPoint().Z(),
-                                                              particle.getGlobalEndPoint().X(),
-                                                              particle.getGlobalEndPoint().Y(),
-                                                              particle.getGlobalEndPoint().Z());
-                    mcparticle_nr = mcp_row.front().as<int>();
+                    mcparticle_nr = insert(work,
+                                           batch.mc_particles,
+                                           "mcparticle",
+                                           "add_mcparticle",
+                                           run_nr_,
+                                           event_nr,
+                                           mctrack_nr,
+                                           detectorName,
+                                           reinterpret_cast<uintptr_t>(&object),              // NOLINT
+                                           reinterpret_cast<uintptr_t>(particle.getParent()), // NOLINT
+                                           reinterpret_cast<uintptr_t>(particle.getTrack()),  // NOLINT
+                                           particle.getParticleID(),
+                                           particle.getLocalStartPoint().X(),
+                                           particle.getLocalStartPoint().Y(),
+                                           particle.getLocalStartPoint().Z(),
+                                           particle.getLocalEndPoint().X(),
+                                           particle.getLocalEndPoint().Y(),
+                                           particle.getLocalEndPoint().Z(),
+                                           particle.getGlobalStartPoint().X(),
+                                           particle.getGlobalStartPoint().Y(),
+                                           particle.getGlobalStartPoint().Z(),
+                                           particle.getGlobalEndPoint().X(),
+                                           particle.getGlobalEndPoint().Y(),
+                                           particle.getGlobalEndPoint().Z());
                     LOG(TRACE) << "Inserted MCParticle with db id " << mcparticle_nr.value();
                 } else {
                     LOG(WARNING) << "Following object type is not yet accounted for in database output: " << class_name;
@@ -324,15 +614,26 @@ void DatabaseWriterModule::run(Event* event) {
             msg_cnt_++;
         }
 
-        // Commit transaction to database:
-        transaction.commit();
-        LOG(DEBUG) << "Database transaction completed";
+        if(transaction.has_value()) {
+            // Commit transaction to database:
+            transaction->commit();
+            LOG(DEBUG) << "Database transaction completed";
+        } else if(++batch.event_count >= batch_size_) {
+            flush_batch();
+        }
     } catch(const std::exception& e) {
         throw ModuleError("SQL error: " + std::string(e.what()));
     }
 }
 
 void DatabaseWriterModule::finalizeThread() {
+    // Write the remaining buffered rows of this thread
+    try {
+        flush_batch();
+    } catch(const std::exception& e) {
+        throw ModuleError("SQL error: " + std::string(e.what()));
+    }
+
 // Disconnecting from database
 #if PQXX_VERSION_MAJOR > 6
     conn_->close();
@@ -342,5 +643,22 @@ void DatabaseWriterModule::finalizeThread() {
 }
 
 void DatabaseWriterModule::finalize() {
+    // Wait for the background thread to write all queued batches
+    if(writer_thread_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            stop_writer_ = true;
+        }
+        queue_condition_.notify_all();
+        writer_thread_.join();
+        if(writer_error_ != nullptr) {
+            try {
+                std::rethrow_exception(writer_error_);
+            } catch(const std::exception& e) {
+                throw ModuleError("SQL error: " + std::string(e.what()));
+            }
+        }
+    }
+
     LOG(STATUS) << "Wrote " << write_cnt_ << " objects from " << msg_cnt_ << " messages to database" << std::endl;
 }
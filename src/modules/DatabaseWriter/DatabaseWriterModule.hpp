@@ -10,9 +10,19 @@
  */
 
 #include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
 #include <fstream>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
 
 #include "core/config/Configuration.hpp"
 #include "core/geometry/GeometryManager.hpp"
@@ -27,7 +37,8 @@ namespace allpix {
      * @brief Module to write object data to PostgreSQL databases
      *
      * Listens to all objects dispatched in the framework and stores a representation of every object to the specified
-     * database.
+     * database. In batched mode, the rows of multiple events are buffered and written with a single COPY per table, either
+     * by the worker threads or by a background thread with its own connection.
      */
     class DatabaseWriterModule : public SequentialModule {
     public:
@@ -39,6 +50,21 @@ namespace allpix {
          */
         DatabaseWriterModule(Configuration& config, Messenger* messenger, GeometryManager* geo_mgr);
 
+        /**
+         * @brief Stop the background writing thread if it is still running
+         */
+        ~DatabaseWriterModule() override;
+
+        /// @{
+        /**
+         * @brief Disallow copy and move
+         */
+        DatabaseWriterModule(const DatabaseWriterModule&) = delete;
+        DatabaseWriterModule& operator=(const DatabaseWriterModule&) = delete;
+        DatabaseWriterModule(DatabaseWriterModule&&) = delete;
+        DatabaseWriterModule& operator=(DatabaseWriterModule&&) = delete;
+        /// @}
+
         /**
          * @brief Receive a single message containing objects of arbitrary type
          * @param message Message dispatched in the framework
@@ -46,6 +72,11 @@ namespace allpix {
          */
         bool filter(const std::shared_ptr<BaseMessage>& message, const std::string& name) const;
 
+        /**
+         * @brief Start the background writing thread if requested
+         */
+        void initialize() override;
+
         /**
          * @brief Initialize per-thread database connections
          */
@@ -57,7 +88,7 @@ namespace allpix {
         void run(Event* event) override;
 
         /**
-         * @brief CLose database connections from each of the threads
+         * @brief Write the remaining rows buffered by the thread and close its database connection
          */
         void finalizeThread() override;
 
@@ -70,18 +101,140 @@ namespace allpix {
     private:
         Messenger* messenger_;
 
+        // Rows of the tables, starting with the number of the row, followed by the columns of the prepared statements
+        using EventRow = std::tuple<int, int, std::uint64_t>;
+        using MCTrackRow = std::tuple<int,
+                                      int,
+                                      int,
+                                      std::string,
+                                      std::uintptr_t,
+                                      std::uintptr_t,
+                                      int,
+                                      std::string,
+                                      std::string,
+                                      double,
+                                      double,
+                                      double,
+                                      double,
+                                      double,
+                                      double,
+                                      double,
+                                      double,
+                                      double,
+                                      double>;
+        using MCParticleRow = std::tuple<int,
+                                         int,
+                                         int,
+                                         std::optional<int>,
+                                         std::string,
+                                         std::uintptr_t,
+                                         std::uintptr_t,
+                                         std::uintptr_t,
+                                         int,
+                                         double,
+                                         double,
+                                         double,
+                                         double,
+                                         double,
+                                         double,
+                                         double,
+                                         double,
+                                         double,
+                                         double,
+                                         double,
+                                         double>;
+        using SensorChargeRow = std::tuple<int,
+                                           int,
+                                           int,
+                                           std::optional<int>,
+                                           std::string,
+                                           int,
+                                           unsigned int,
+                                           double,
+                                           double,
+                                           double,
+                                           double,
+                                           double,
+                                           double>;
+        using PixelChargeRow =
+            std::tuple<int, int, int, std::optional<int>, std::string, long, int, int, double, double, double, double>;
+        using PixelHitRow =
+            std::tuple<int, int, int, std::optional<int>, std::optional<int>, std::string, int, int, double, double>;
+
+        /**
+         * @brief Rows of multiple events buffered to be written together
+         */
+        struct RowBatch {
+            unsigned int event_count{};
+            std::vector<EventRow> events;
+            std::vector<MCTrackRow> mc_tracks;
+            std::vector<MCParticleRow> mc_particles;
+            std::vector<SensorChargeRow> deposited_charges;
+            std::vector<SensorChargeRow> propagated_charges;
+            std::vector<PixelChargeRow> pixel_charges;
+            std::vector<PixelHitRow> pixel_hits;
+        };
+
+        /**
+         * @brief Open a new connection to the database
+         * @return Open database connection
+         */
+        std::shared_ptr<pqxx::connection> connect() const;
+
         /**
          * @brief Submit "prepared statements" to the database connection(s)
          * @param connection  Database connection to be used
          */
         static void prepare_statements(const std::shared_ptr<pqxx::connection>& connection);
 
+        /**
+         * @brief Insert a row into a table, either directly or by buffering it in the batch of the thread
+         * @param transaction Transaction to insert the row with, or a null pointer to buffer the row
+         * @param rows Buffered rows of the table
+         * @param table Name of the table
+         * @param statement Name of the prepared statement to insert the row
+         * @param values Values of the columns of the prepared statement
+         * @return Number of the inserted row
+         */
+        template <typename Row, typename... Args>
+        int insert(pqxx::work* transaction,
+                   std::vector<Row>& rows,
+                   const std::string& table,
+                   const std::string& statement,
+                   const Args&... values);
+
+        /**
+         * @brief Reserve the number of a new row from the sequence of its table
+         * @param table Name of the table
+         * @return Reserved number of the row
+         */
+        int reserve_row_number(const std::string& table);
+
+        /**
+         * @brief Write the buffered rows of the thread, or hand them to the background thread
+         */
+        void flush_batch();
+
+        /**
+         * @brief Write a batch of rows with a single COPY per table in one transaction
+         * @param connection Database connection to write with
+         * @param batch Rows to write
+         */
+        static void write_batch(pqxx::connection& connection, const RowBatch& batch);
+
+        /**
+         * @brief Write the batches handed over by the worker threads until stopped
+         */
+        void background_writer();
+
         // Object names to include or exclude from writing
         std::set<std::string> include_;
         std::set<std::string> exclude_;
 
         // postgreSQL objects
         static thread_local std::shared_ptr<pqxx::connection> conn_;
+        static thread_local std::unique_ptr<RowBatch> batch_;
+        static thread_local std::map<std::string, std::deque<int>> reserved_row_numbers_;
         std::string host_;
         std::string port_;
         std::string database_name_;
@@ -91,6 +244,19 @@ namespace allpix {
         int run_nr_{0};
         bool timing_global_{};
 
+        // Number of events to buffer per thread before writing them, or zero to write every event immediately
+        unsigned int batch_size_{};
+
+        // Background thread writing the batches handed over by the workers, with its own connection
+        bool background_writing_{};
+        size_t max_queued_batches_{};
+        std::thread writer_thread_;
+        std::mutex queue_mutex_;
+        std::condition_variable queue_condition_;
+        std::deque<std::unique_ptr<RowBatch>> queue_;
+        bool stop_writer_{};
+        std::exception_ptr writer_error_;
+
         // Statistical information about number of objects
         std::atomic<unsigned long> write_cnt_{};
         std::atomic<unsigned long> msg_cnt_{};
@@ -32,6 +32,9 @@ DefaultDigitizerModule::DefaultDigitizerModule(Configuration& config,
     // Require PixelCharge message for single detector
     messenger_->bindSingle<PixelChargeMessage>(this, MsgFlags::REQUIRED);
 
+    // Declare the messages dispatched by this module
+    declare_output<PixelHitMessage>();
+
     if(config_.has("gain") && config_.has("gain_function")) {
         throw InvalidCombinationError(
             config_, {"gain", "gain_function"}, "Gain and Gain Function cannot be simultaneously configured.");
@@ -60,6 +63,10 @@ DefaultDigitizerModule::DefaultDigitizerModule(Configuration& config,
     config_.setDefault<double>("tdc_slope", Units::get(10, "ns"));
     config_.setDefault<bool>("allow_zero_tdc", false);
 
+    // Draw the random numbers of all pixels at once, required to share them between variants of the settings
+    auto has_variants = config_.has("variant_thresholds") || config_.has("variant_gains");
+    config_.setDefault<bool>("batch_digitization", has_variants);
+
     // Simple front-end saturation
     config_.setDefault<bool>("saturation", false);
     config_.setDefault<int>("saturation_mean", Units::get(190, "ke"));
@@ -77,9 +84,10 @@ DefaultDigitizerModule::DefaultDigitizerModule(Configuration& config,
     electronics_noise_ = config_.get<unsigned int>("electronics_noise");
 
     if(config_.has("gain_function")) {
-        gain_function_ = std::make_unique<TFormula>("gain_function", (config_.get<std::string>("gain_function")).c_str());
+        auto gain_function =
+            std::make_unique<TFormula>("gain_function", (config_.get<std::string>("gain_function")).c_str());
 
-        if(!gain_function_->IsValid()) {
+        if(!gain_function->IsValid()) {
             throw InvalidValueError(
                 config_, "gain_function", "The response function is not a valid ROOT::TFormula expression.");
         }
@@ -87,7 +95,7 @@ DefaultDigitizerModule::DefaultDigitizerModule(Configuration& config,
         auto parameters = config_.getArray<double>("gain_parameters");
 
         // check if number of parameters match up
-        if(static_cast<size_t>(gain_function_->GetNpar()) != parameters.size()) {
+        if(static_cast<size_t>(gain_function->GetNpar()) != parameters.size()) {
             throw InvalidValueError(
                 config_,
                 "gain_parameters",
@@ -95,13 +103,17 @@ DefaultDigitizerModule::DefaultDigitizerModule(Configuration& config,
         }
 
         for(size_t n = 0; n < parameters.size(); ++n) {
-            gain_function_->SetParameter(static_cast<int>(n), parameters[n]);
+            gain_function->SetParameter(static_cast<int>(n), parameters[n]);
         }
 
-        LOG(DEBUG) << "Gain response function successfully initialized with " << parameters.size() << " parameters";
+        gain_function_ = std::make_unique<CompiledFormula>(std::move(gain_function));
+        LOG(DEBUG) << "Gain response function successfully initialized with " << parameters.size() << " parameters"
+                   << (gain_function_->isCompiled() ? ", compiled to native function" : "");
     } else {
-        gain_function_ = std::make_unique<TFormula>("gain_function", "[0]*x");
-        gain_function_->SetParameter(0, config_.get<double>("gain"));
+        linear_gain_ = config_.get<double>("gain");
+        auto gain_function = std::make_unique<TFormula>("gain_function", "[0]*x");
+        gain_function->SetParameter(0, linear_gain_.value());
+        gain_function_ = std::make_unique<CompiledFormula>(std::move(gain_function));
     }
 
     saturation_ = config_.get<bool>("saturation");
@@ -122,6 +134,39 @@ DefaultDigitizerModule::DefaultDigitizerModule(Configuration& config,
     tdc_offset_ = config_.get<double>("tdc_offset");
     tdc_slope_ = config_.get<double>("tdc_slope");
     allow_zero_tdc_ = config_.get<bool>("allow_zero_tdc");
+
+    batch_digitization_ = config_.get<bool>("batch_digitization");
+
+    // Variants of the threshold and the gain digitized with the same random numbers as the nominal settings
+    if(has_variants) {
+        if(!batch_digitization_) {
+            throw InvalidCombinationError(config_,
+                                          {"batch_digitization", "variant_thresholds", "variant_gains"},
+                                          "variants require the random numbers to be drawn in batches");
+        }
+        if(config_.has("variant_gains") && !linear_gain_.has_value()) {
+            throw InvalidCombinationError(
+                config_, {"variant_gains", "gain_function"}, "gain variants can only be used with a linear gain");
+        }
+        auto thresholds = config_.getArray<unsigned int>("variant_thresholds", {});
+        auto gains = config_.getArray<double>("variant_gains", {});
+        if(!thresholds.empty() && !gains.empty() && thresholds.size() != gains.size()) {
+            throw InvalidCombinationError(config_,
+                                          {"variant_thresholds", "variant_gains"},
+                                          "number of threshold and gain variants has to be equal");
+        }
+        auto count = std::max(thresholds.size(), gains.size());
+        auto names = config_.getArray<std::string>("variant_names", {});
+        if(!names.empty() && names.size() != count) {
+            throw InvalidValueError(config_, "variant_names", "a name has to be given for every variant");
+        }
+        for(size_t v = 0; v < count; ++v) {
+            variants_.push_back({(names.empty() ? "variant" + std::to_string(v) : names[v]),
+                                 (thresholds.empty() ? threshold_ : thresholds[v]),
+                                 (gains.empty() ? linear_gain_ : std::optional<double>(gains[v]))});
+        }
+        LOG(INFO) << "Digitizing " << variants_.size() << " variants of the threshold and gain in addition";
+    }
 }
 
 void DefaultDigitizerModule::initialize() {
@@ -217,9 +262,49 @@ void DefaultDigitizerModule::initialize() {
 void DefaultDigitizerModule::run(Event* event) {
     auto pixel_message = messenger_->fetchMessage<PixelChargeMessage>(this, event);
 
+    // Draw the random numbers of all pixels in contiguous batches, one batch per smearing step
+    const auto& pixel_charges = pixel_message->getData();
+    std::vector<double> noise, saturation_values, thresholds, qdc_noise, tdc_noise, gain_input, gain_output;
+    if(batch_digitization_) {
+        auto count = pixel_charges.size();
+        auto draw = [&](std::vector<double>& values, double mean, double stddev) {
+            values.resize(count);
+            allpix::normal_batch_distribution<double> distribution(mean, stddev);
+            distribution(event->getRandomEngine(), values.data(), count);
+        };
+        draw(noise, 0, electronics_noise_);
+        if(saturation_) {
+            draw(saturation_values, saturation_mean_, saturation_width_);
+        }
+        draw(thresholds, threshold_, threshold_smearing_);
+        if(qdc_resolution_ > 0) {
+            draw(qdc_noise, 0, qdc_smearing_);
+        }
+        if(tdc_resolution_ > 0) {
+            draw(tdc_noise, 0, tdc_smearing_);
+        }
+
+        // Evaluate the gain for all pixels at once, a linear gain is applied without the formula
+        gain_input.resize(count);
+        gain_output.resize(count);
+        for(size_t i = 0; i < count; ++i) {
+            gain_input[i] = static_cast<double>(pixel_charges[i].getAbsoluteCharge()) + noise[i];
+        }
+        if(linear_gain_.has_value()) {
+            for(size_t i = 0; i < count; ++i) {
+                gain_output[i] = linear_gain_.value() * gain_input[i];
+            }
+        } else {
+            for(size_t i = 0; i < count; ++i) {
+                gain_output[i] = (*gain_function_)(gain_input[i]);
+            }
+        }
+    }
+
     // Loop through all pixels with charges
     std::vector<PixelHit> hits;
-    for(const auto& pixel_charge : pixel_message->getData()) {
+    for(size_t idx = 0; idx < pixel_charges.size(); ++idx) {
+        const auto& pixel_charge = pixel_charges[idx];
         auto pixel = pixel_charge.getPixel();
         auto pixel_index = pixel.getIndex();
         auto charge = static_cast<double>(pixel_charge.getAbsoluteCharge());
@@ -230,8 +315,12 @@ void DefaultDigitizerModule::run(Event* event) {
         }
 
         // Add electronics noise from Gaussian:
-        allpix::normal_distribution<double> el_noise(0, electronics_noise_);
-        charge += el_noise(event->getRandomEngine());
+        if(batch_digitization_) {
+            charge = gain_input[idx];
+        } else {
+            allpix::normal_distribution<double> el_noise(0, electronics_noise_);
+            charge += el_noise(event->getRandomEngine());
+        }
 
         LOG(DEBUG) << "Charge with noise: " << Units::display(charge, "e");
         if(output_plots_) {
@@ -240,7 +329,7 @@ void DefaultDigitizerModule::run(Event* event) {
 
         // Apply the gain to the charge:
         auto charge_pregain = charge;
-        charge = gain_function_->Eval(charge);
+        charge = (batch_digitization_ ? gain_output[idx] : (*gain_function_)(charge));
         LOG(DEBUG) << "Charge after amplifier (gain): " << Units::display(charge, "e");
         if(output_plots_) {
             // Calculate gain from pre- and post-charge, offset to avoid zero-division:
@@ -250,8 +339,13 @@ void DefaultDigitizerModule::run(Event* event) {
 
         // Simulate simple front-end saturation if enabled:
         if(saturation_) {
-            allpix::normal_distribution<double> saturation_smearing(saturation_mean_, saturation_width_);
-            auto saturation = saturation_smearing(event->getRandomEngine());
+            double saturation = 0;
+            if(batch_digitization_) {
+                saturation = saturation_values[idx];
+            } else {
+                allpix::normal_distribution<double> saturation_smearing(saturation_mean_, saturation_width_);
+                saturation = saturation_smearing(event->getRandomEngine());
+            }
             if(charge > saturation) {
                 LOG(DEBUG) << "Above front-end saturation, " << Units::display(charge, {"e", "ke"}) << " > "
                            << Units::display(saturation, {"e", "ke"}) << ", setting to saturation value";
@@ -264,8 +358,13 @@ void DefaultDigitizerModule::run(Event* event) {
         }
 
         // Smear the threshold, Gaussian distribution around "threshold" with width "threshold_smearing"
-        allpix::normal_distribution<double> thr_smearing(threshold_, threshold_smearing_);
-        double threshold = thr_smearing(event->getRandomEngine());
+        double threshold = 0;
+        if(batch_digitization_) {
+            threshold = thresholds[idx];
+        } else {
+            allpix::normal_distribution<double> thr_smearing(threshold_, threshold_smearing_);
+            threshold = thr_smearing(event->getRandomEngine());
+        }
         if(output_plots_) {
             h_thr->Fill(threshold / 1e3);
         }
@@ -288,17 +387,19 @@ void DefaultDigitizerModule::run(Event* event) {
             auto original_charge = charge;
 
             // Add ADC smearing:
-            allpix::normal_distribution<double> adc_smearing(0, qdc_smearing_);
-            charge += adc_smearing(event->getRandomEngine());
+            if(batch_digitization_) {
+                charge += qdc_noise[idx];
+            } else {
+                allpix::normal_distribution<double> adc_smearing(0, qdc_smearing_);
+                charge += adc_smearing(event->getRandomEngine());
+            }
             if(output_plots_) {
                 h_pxq_adc_smear->Fill(charge / 1e3);
             }
             LOG(DEBUG) << "Smeared for simulating limited QDC sensitivity: " << Units::display(charge, "e");
 
             // Convert to ADC units and precision, make sure ADC count is at least 1:
-            charge = static_cast<double>(std::clamp(static_cast<int>((qdc_offset_ + charge) / qdc_slope_),
-                                                    (allow_zero_qdc_ ? 0 : 1),
-                                                    (1 << qdc_resolution_) - 1));
+            charge = to_qdc(charge);
             LOG(DEBUG) << "Charge converted to QDC units: " << charge;
 
             if(output_plots_) {
@@ -322,16 +423,19 @@ void DefaultDigitizerModule::run(Event* event) {
         // Simulate TDC if resolution set to more than 0bit
         if(tdc_resolution_ > 0) {
             // Add TDC smearing:
-            allpix::normal_distribution<double> tdc_smearing(0, tdc_smearing_);
-            time += tdc_smearing(event->getRandomEngine());
+            if(batch_digitization_) {
+                time += tdc_noise[idx];
+            } else {
+                allpix::normal_distribution<double> tdc_smearing(0, tdc_smearing_);
+                time += tdc_smearing(event->getRandomEngine());
+            }
             if(output_plots_) {
                 h_px_tdc_smear->Fill(time);
             }
             LOG(DEBUG) << "Smeared for simulating limited TDC sensitivity: " << Units::display(time, {"ns", "ps"});
 
             // Convert to TDC units and precision, make sure TDC count is at least 1:
-            time = static_cast<double>(std::clamp(
-                static_cast<int>((tdc_offset_ + time) / tdc_slope_), (allow_zero_tdc_ ? 0 : 1), (1 << tdc_resolution_) - 1));
+            time = to_tdc(time);
             LOG(DEBUG) << "Time converted to TDC units: " << time;
 
             if(output_plots_) {
@@ -352,9 +456,54 @@ void DefaultDigitizerModule::run(Event* event) {
 
     if(!hits.empty()) {
         // Create and dispatch hit message
-        auto hits_message = std::make_shared<PixelHitMessage>(std::move(hits), getDetector());
+        auto hits_message = event->makeShared<PixelHitMessage>(std::move(hits), getDetector());
         messenger_->dispatchMessage(this, hits_message, event);
     }
+
+    // Digitize the variants of the settings with the random numbers drawn for the nominal settings
+    for(const auto& variant : variants_) {
+        std::vector<PixelHit> variant_hits;
+        for(size_t idx = 0; idx < pixel_charges.size(); ++idx) {
+            const auto& pixel_charge = pixel_charges[idx];
+            auto charge = (variant.gain.has_value() ? variant.gain.value() * gain_input[idx] : gain_output[idx]);
+            if(saturation_) {
+                charge = std::min(charge, saturation_values[idx]);
+            }
+
+            // The threshold dispersion of the pixel is the same for all variants
+            auto threshold = thresholds[idx] - static_cast<double>(threshold_) + static_cast<double>(variant.threshold);
+            if(charge < threshold) {
+                continue;
+            }
+            if(qdc_resolution_ > 0) {
+                charge = to_qdc(charge + qdc_noise[idx]);
+            }
+
+            auto time = time_of_arrival(pixel_charge, threshold);
+            auto original_time = time;
+            if(tdc_resolution_ > 0) {
+                time = to_tdc(time + tdc_noise[idx]);
+            }
+            variant_hits.emplace_back(
+                pixel_charge.getPixel(), time, pixel_charge.getGlobalTime() + original_time, charge, &pixel_charge);
+        }
+
+        LOG(DEBUG) << "Digitized " << variant_hits.size() << " pixel hits for variant " << variant.name;
+        if(!variant_hits.empty()) {
+            auto hits_message = event->makeShared<PixelHitMessage>(std::move(variant_hits), getDetector());
+            messenger_->dispatchMessage(this, hits_message, event, variant.name);
+        }
+    }
+}
+
+double DefaultDigitizerModule::to_qdc(double charge) const {
+    return static_cast<double>(std::clamp(
+        static_cast<int>((qdc_offset_ + charge) / qdc_slope_), (allow_zero_qdc_ ? 0 : 1), (1 << qdc_resolution_) - 1));
+}
+
+double DefaultDigitizerModule::to_tdc(double time) const {
+    return static_cast<double>(std::clamp(
+        static_cast<int>((tdc_offset_ + time) / tdc_slope_), (allow_zero_tdc_ ? 0 : 1), (1 << tdc_resolution_) - 1));
 }
 
 double DefaultDigitizerModule::time_of_arrival(const PixelCharge& pixel_charge, double threshold) const {
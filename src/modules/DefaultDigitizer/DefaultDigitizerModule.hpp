@@ -13,7 +13,9 @@
 #define ALLPIX_DEFAULT_DIGITIZER_MODULE_H
 
 #include <memory>
+#include <optional>
 #include <string>
+#include <vector>
 
 #include "core/config/Configuration.hpp"
 #include "core/messenger/Messenger.hpp"
@@ -23,6 +25,7 @@
 #include "objects/PixelCharge.hpp"
 
 #include "tools/ROOT.h"
+#include "tools/compiled_formula.h"
 
 #include <TFormula.h>
 #include <TH1D.h>
@@ -74,11 +77,26 @@ namespace allpix {
          */
         double time_of_arrival(const PixelCharge& pixel_charge, double threshold) const;
 
+        /**
+         * @brief Convert a charge to QDC units, making sure the QDC count is at least one unless zero is allowed
+         * @param charge Smeared charge
+         * @return QDC count
+         */
+        double to_qdc(double charge) const;
+
+        /**
+         * @brief Convert a time to TDC units, making sure the TDC count is at least one unless zero is allowed
+         * @param time Smeared time of arrival
+         * @return TDC count
+         */
+        double to_tdc(double time) const;
+
         // Configuration
         bool output_plots_{};
 
         unsigned int electronics_noise_{};
-        std::unique_ptr<TFormula> gain_function_{};
+        std::unique_ptr<CompiledFormula> gain_function_{};
+        std::optional<double> linear_gain_{};
 
         bool saturation_{};
         unsigned int saturation_mean_{}, saturation_width_{};
@@ -97,6 +115,16 @@ namespace allpix {
         double tdc_slope_{};
         bool allow_zero_tdc_{};
 
+        bool batch_digitization_{};
+
+        // Variant of the digitization settings, dispatched as named message of pixel hits
+        struct Variant {
+            std::string name;
+            unsigned int threshold{};
+            std::optional<double> gain{};
+        };
+        std::vector<Variant> variants_;
+
         // Statistics
         std::atomic<unsigned long long> total_hits_{};
 
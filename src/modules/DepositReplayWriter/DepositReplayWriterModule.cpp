@@ -0,0 +1,164 @@
+/**
+ * @file
+ * @brief Implementation of module writing deposited charges and Monte Carlo particles to compact replay files
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "DepositReplayWriterModule.hpp"
+
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "core/config/exceptions.h"
+#include "core/messenger/exceptions.h"
+#include "core/module/exceptions.h"
+#include "core/utils/log.h"
+
+using namespace allpix;
+
+namespace {
+    // Append the coordinates of a point to a column
+    void append_point(std::vector<double>& column, const ROOT::Math::XYZPoint& point) {
+        column.push_back(point.x());
+        column.push_back(point.y());
+        column.push_back(point.z());
+    }
+
+    // Get the index of a particle in a list of particles, or -1 if it is not part of the list
+    std::int32_t index_of(const MCParticle* particle, const std::vector<MCParticle>* particles) {
+        std::less<const MCParticle*> less;
+        if(particle == nullptr || particles == nullptr || less(particle, particles->data()) ||
+           !less(particle, particles->data() + particles->size())) {
+            return -1;
+        }
+        return static_cast<std::int32_t>(particle - particles->data());
+    }
+
+    // Fetch all messages of a type, events without any message of this type return an empty list
+    template <typename T>
+    std::vector<std::shared_ptr<T>> fetch_messages(Messenger* messenger, Module* module, Event* event) {
+        try {
+            return messenger->fetchMultiMessage<T>(module, event);
+        } catch(const MessageNotFoundException&) {
+            return {};
+        }
+    }
+} // namespace
+
+DepositReplayWriterModule::DepositReplayWriterModule(Configuration& config,
+                                                     Messenger* messenger,
+                                                     GeometryManager* geo_manager)
+    : Module(config), messenger_(messenger), geo_manager_(geo_manager) {
+    // Enable multithreading of this module if multithreading is enabled
+    allow_multithreading();
+
+    config_.setDefault<std::string>("file_name", "deposits");
+
+    // Events without deposits are stored as well, such that the replay reproduces the same sequence of events
+    messenger_->bindMulti<DepositedChargeMessage>(this, MsgFlags::NONE);
+    messenger_->bindMulti<MCParticleMessage>(this, MsgFlags::NONE);
+}
+
+void DepositReplayWriterModule::initialize() {
+    std::vector<std::string> detectors;
+    for(const auto& detector : geo_manager_->getDetectors()) {
+        detector_index_[detector->getName()] = static_cast<std::uint32_t>(detectors.size());
+        detectors.push_back(detector->getName());
+    }
+
+    file_name_ = createOutputFile(config_.get<std::string>("file_name"), "replay");
+    try {
+        writer_ = std::make_unique<DepositReplayWriter>(file_name_, detectors);
+    } catch(std::invalid_argument& e) {
+        throw InvalidValueError(config_, "file_name", e.what());
+    }
+}
+
+void DepositReplayWriterModule::run(Event* event) {
+    auto deposit_messages = fetch_messages<DepositedChargeMessage>(messenger_, this, event);
+    auto particle_messages = fetch_messages<MCParticleMessage>(messenger_, this, event);
+
+    // Collect the records of all detectors, with the particles first to resolve the relations of the deposits
+    std::map<std::uint32_t, DepositReplayRecord> records;
+    std::map<std::uint32_t, const std::vector<MCParticle>*> detector_particles;
+    for(const auto& message : particle_messages) {
+        auto detector = detector_index_.at(message->getDetector()->getName());
+        auto& record = records[detector];
+        record.detector = detector;
+        record.flags |= DepositReplayRecord::has_particles;
+
+        const auto& particles = message->getData();
+        detector_particles[detector] = &particles;
+        for(const auto& particle : particles) {
+            append_point(record.particle_local_start, particle.getLocalStartPoint());
+            append_point(record.particle_global_start, particle.getGlobalStartPoint());
+            append_point(record.particle_local_end, particle.getLocalEndPoint());
+            append_point(record.particle_global_end, particle.getGlobalEndPoint());
+            record.particle_id.push_back(particle.getParticleID());
+            record.particle_local_time.push_back(particle.getLocalTime());
+            record.particle_global_time.push_back(particle.getGlobalTime());
+            record.particle_total_energy.push_back(particle.getTotalEnergyStart());
+            record.particle_kinetic_energy.push_back(particle.getKineticEnergyStart());
+            record.particle_charge.push_back(particle.getTotalDepositedCharge());
+
+            // Parents in other detectors are not stored
+            record.particle_parent.push_back(index_of(particle.getParent(), &particles));
+        }
+    }
+
+    size_t deposits = 0;
+    for(const auto& message : deposit_messages) {
+        auto detector = detector_index_.at(message->getDetector()->getName());
+        auto& record = records[detector];
+        record.detector = detector;
+        record.flags |= DepositReplayRecord::has_deposits;
+
+        // Only particles of the same detector are referenced, as the messages of other detectors are independent
+        auto particles = detector_particles.find(detector);
+        const auto* detector_particle_list = (particles == detector_particles.end() ? nullptr : particles->second);
+
+        for(const auto& deposit : message->getData()) {
+            append_point(record.deposit_local_position, deposit.getLocalPosition());
+            append_point(record.deposit_global_position, deposit.getGlobalPosition());
+            record.deposit_type.push_back(static_cast<std::int8_t>(deposit.getType()));
+            record.deposit_charge.push_back(deposit.getCharge());
+            record.deposit_local_time.push_back(deposit.getLocalTime());
+            record.deposit_global_time.push_back(deposit.getGlobalTime());
+            record.deposit_particle.push_back(index_of(deposit.getMCParticle(), detector_particle_list));
+        }
+        deposits += message->getData().size();
+    }
+
+    std::vector<DepositReplayRecord> event_records;
+    event_records.reserve(records.size());
+    for(auto& record : records) {
+        event_records.push_back(std::move(record.second));
+    }
+
+    // Encode the event concurrently, only appending the block to the file is serialized
+    auto block = DepositReplayFormat::encodeEvent(event->number, event_records);
+    LOG(DEBUG) << "Encoded " << deposits << " deposits of " << event_records.size() << " detectors into "
+               << block.size() << " bytes";
+
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    try {
+        writer_->append(event->number, block);
+    } catch(std::invalid_argument& e) {
+        throw ModuleError("Could not append event to deposit replay file: " + std::string(e.what()));
+    }
+}
+
+void DepositReplayWriterModule::finalize() {
+    auto size = writer_->getSize();
+    auto events = writer_->close();
+    LOG(STATUS) << "Wrote " << events << " events with " << size << " bytes of deposits to file:" << std::endl
+                << file_name_;
+}
@@ -0,0 +1,74 @@
+/**
+ * @file
+ * @brief Definition of module writing deposited charges and Monte Carlo particles to compact replay files
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "core/config/Configuration.hpp"
+#include "core/geometry/GeometryManager.hpp"
+#include "core/messenger/Messenger.hpp"
+#include "core/module/Event.hpp"
+#include "core/module/Module.hpp"
+
+#include "objects/DepositedCharge.hpp"
+#include "objects/MCParticle.hpp"
+
+#include "tools/deposit_replay.h"
+
+namespace allpix {
+    /**
+     * @ingroup Modules
+     * @brief Module to write the deposited charges and Monte Carlo particles of all detectors to a compact replay file
+     * @note This module supports multithreading
+     *
+     * The deposited charges and Monte Carlo particles are stored column by column in independent blocks per event, which
+     * are encoded concurrently and appended to the file in the order the events finish. An index of all events written at
+     * the end of the run allows the DepositionReplay module to read the events by random access.
+     */
+    class DepositReplayWriterModule : public Module {
+    public:
+        /**
+         * @brief Constructor for this unique module
+         * @param config Configuration object for this module as retrieved from the steering file
+         * @param messenger Pointer to the messenger object to allow binding to messages on the bus
+         * @param geo_manager Pointer to the geometry manager, containing the detectors
+         */
+        DepositReplayWriterModule(Configuration& config, Messenger* messenger, GeometryManager* geo_manager);
+
+        /**
+         * @brief Create the output file and write its header
+         */
+        void initialize() override;
+
+        /**
+         * @brief Encode the deposited charges and Monte Carlo particles of the event and append them to the file
+         */
+        void run(Event*) override;
+
+        /**
+         * @brief Write the index of all events and close the file
+         */
+        void finalize() override;
+
+    private:
+        Messenger* messenger_;
+        GeometryManager* geo_manager_;
+
+        // Index of every detector in the file
+        std::map<std::string, std::uint32_t> detector_index_;
+
+        std::string file_name_;
+        std::mutex writer_mutex_;
+        std::unique_ptr<DepositReplayWriter> writer_;
+    };
+} // namespace allpix
@@ -29,6 +29,16 @@ using namespace allpix;
 CosmicsGeneratorActionG4::CosmicsGeneratorActionG4(const Configuration& config)
     : particle_gun_(std::make_unique<G4ParticleGun>()), config_(config) {
 
+    // Parse other configuration parameters:
+    reset_particle_time_ = config_.get<bool>("reset_particle_time");
+
+    // Showers are drawn from the pool if it has been generated, without setting up a CRY generator for this thread
+    shower_pool_ = DepositionCosmicsModule::shower_pool_;
+    if(shower_pool_ != nullptr) {
+        LOG(DEBUG) << "Drawing showers from pool of " << shower_pool_->size() << " showers";
+        return;
+    }
+
     LOG(DEBUG) << "Setting up CRY generator";
     LOG(DEBUG) << "CRY configuration: " << config_.get<std::string>("_cry_config");
     LOG(DEBUG) << "CRY data: " << config_.get<std::string>("data_path");
@@ -39,9 +49,6 @@ CosmicsGeneratorActionG4::CosmicsGeneratorActionG4(const Configuration& config)
     LOG(DEBUG) << "Configuring CRY random engine to use Geant4's event-seeded engine";
     RNGWrapper<CLHEP::HepRandomEngine>::set(CLHEP::HepRandom::getTheEngine(), &CLHEP::HepRandomEngine::flat);
     setup->setRandomFunction(RNGWrapper<CLHEP::HepRandomEngine>::rng);
-
-    // Parse other configuration parameters:
-    reset_particle_time_ = config_.get<bool>("reset_particle_time");
 }
 
 /**
@@ -49,42 +56,59 @@ CosmicsGeneratorActionG4::CosmicsGeneratorActionG4(const Configuration& config)
  */
 void CosmicsGeneratorActionG4::GeneratePrimaries(G4Event* event) {
 
-    // Let CRY generate the particles
-    std::vector<CRYParticle*> vect;
-    LOG(DEBUG) << "Absolute time simulated before shower: "
-               << Units::display(Units::get(cry_generator_->timeSimulated(), "s"), {"ns", "us", "ms"});
-    cry_generator_->genEvent(&vect);
-    LOG(DEBUG) << "CRY generated " << vect.size() << " particles";
-    LOG(INFO) << "Absolute time simulated by CRY after shower: "
-              << Units::display(Units::get(cry_generator_->timeSimulated(), "s"), {"ns", "us", "ms"});
-
-    // Update simulation time in the framework base units
-    DepositionCosmicsModule::cry_instance_time_simulated_ = cry_generator_->timeSimulated() * 1e9;
+    Shower generated_shower;
+    const Shower* shower = &generated_shower;
+    if(shower_pool_ != nullptr) {
+        // Draw a shower from the pool with the Geant4-internal engine which is seeded per-event
+        shower = &shower_pool_->draw(CLHEP::HepRandom::getTheEngine()->flat());
+        LOG(DEBUG) << "Drew shower with " << shower->size() << " particles from pool";
+
+        // Every shower of the pool corresponds to its share of the time simulated for the pool
+        DepositionCosmicsModule::cry_instance_time_simulated_ += shower_pool_->timePerShower();
+    } else {
+        // Let CRY generate the particles
+        std::vector<CRYParticle*> vect;
+        LOG(DEBUG) << "Absolute time simulated before shower: "
+                   << Units::display(Units::get(cry_generator_->timeSimulated(), "s"), {"ns", "us", "ms"});
+        cry_generator_->genEvent(&vect);
+        LOG(DEBUG) << "CRY generated " << vect.size() << " particles";
+        LOG(INFO) << "Absolute time simulated by CRY after shower: "
+                  << Units::display(Units::get(cry_generator_->timeSimulated(), "s"), {"ns", "us", "ms"});
+
+        // Update simulation time in the framework base units
+        DepositionCosmicsModule::cry_instance_time_simulated_ = cry_generator_->timeSimulated() * 1e9;
+
+        generated_shower.reserve(vect.size());
+        for(auto* particle : vect) {
+            generated_shower.push_back(ShowerParticle::from(*particle));
+            delete particle;
+        }
+    }
 
     // Event time frame starts with first particle arriving
     double event_starting_time = std::numeric_limits<double>::max();
     if(!reset_particle_time_) {
-        for(const auto& particle : vect) {
-            event_starting_time = std::min(event_starting_time, particle->t());
+        for(const auto& particle : *shower) {
+            event_starting_time = std::min(event_starting_time, particle.t);
         }
     }
 
-    for(const auto& particle : vect) {
+    for(const auto& particle : *shower) {
         auto* pdg_table = G4ParticleTable::GetParticleTable();
-        particle_gun_->SetParticleDefinition(pdg_table->FindParticle(particle->PDGid()));
-        particle_gun_->SetParticleEnergy(particle->ke() * CLHEP::MeV);
+        particle_gun_->SetParticleDefinition(pdg_table->FindParticle(particle.pdg_id));
+        particle_gun_->SetParticleEnergy(particle.ke * CLHEP::MeV);
         particle_gun_->SetParticlePosition(
-            G4ThreeVector(particle->x() * CLHEP::m, particle->y() * CLHEP::m, particle->z() * CLHEP::m));
-        particle_gun_->SetParticleMomentumDirection(G4ThreeVector(particle->u(), particle->v(), particle->w()));
+            G4ThreeVector(particle.x * CLHEP::m, particle.y * CLHEP::m, particle.z * CLHEP::m));
+        particle_gun_->SetParticleMomentumDirection(G4ThreeVector(particle.u, particle.v, particle.w));
 
-        double time = (reset_particle_time_ ? 0. : particle->t() - event_starting_time);
+        double time = (reset_particle_time_ ? 0. : particle.t - event_starting_time);
         particle_gun_->SetParticleTime(time);
         particle_gun_->GeneratePrimaryVertex(event);
 
-        LOG(DEBUG) << "  " << CRYUtils::partName(particle->id()) << ": charge=" << particle->charge() << std::setprecision(4)
-                   << " energy=" << Units::display(particle->ke(), {"MeV", "GeV"}) << " pos="
-                   << Units::display(G4ThreeVector(particle->x() * 1e3, particle->y() * 1e3, particle->z() * 1e3), {"m"})
-                   << " dir. cos=" << G4ThreeVector(particle->u(), particle->v(), particle->w())
+        LOG(DEBUG) << "  " << CRYUtils::partName(particle.id) << ": charge=" << particle.charge << std::setprecision(4)
+                   << " energy=" << Units::display(particle.ke, {"MeV", "GeV"}) << " pos="
+                   << Units::display(G4ThreeVector(particle.x * 1e3, particle.y * 1e3, particle.z * 1e3), {"m"})
+                   << " dir. cos=" << G4ThreeVector(particle.u, particle.v, particle.w)
                    << " t=" << Units::display(Units::get(time, "s"), {"ns", "us", "ms"});
     }
 }
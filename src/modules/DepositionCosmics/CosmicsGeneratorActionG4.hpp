@@ -24,6 +24,7 @@
 #include <CRYSetup.h>
 #include <CRYUtils.h>
 
+#include "CosmicsShowerPool.hpp"
 #include "core/config/Configuration.hpp"
 
 namespace allpix {
@@ -46,6 +47,7 @@ namespace allpix {
     private:
         std::unique_ptr<G4ParticleGun> particle_gun_;
         std::unique_ptr<CRYGenerator> cry_generator_;
+        std::shared_ptr<const CosmicsShowerPool> shower_pool_;
 
         bool reset_particle_time_{};
         const Configuration& config_;
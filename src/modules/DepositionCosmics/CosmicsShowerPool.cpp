@@ -0,0 +1,157 @@
+/**
+ * @file
+ * @brief Implements the pool of pre-generated CRY showers
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "CosmicsShowerPool.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+
+#include "core/module/exceptions.h"
+#include "core/utils/log.h"
+#include "core/utils/text.h"
+#include "core/utils/unit_constants.h"
+#include "tools/liang_barsky.h"
+
+using namespace allpix;
+
+namespace {
+    // Maximum number of generated showers per accepted shower before the generation of the pool is stopped
+    constexpr size_t max_generated_per_shower = 100000;
+} // namespace
+
+ShowerParticle ShowerParticle::from(CRYParticle& particle) {
+    return {particle.id(),
+            particle.PDGid(),
+            particle.charge(),
+            particle.ke(),
+            particle.x(),
+            particle.y(),
+            particle.z(),
+            particle.u(),
+            particle.v(),
+            particle.w(),
+            particle.t()};
+}
+
+CosmicsShowerPool CosmicsShowerPool::generate(CRYGenerator& generator,
+                                              size_t size,
+                                              const ROOT::Math::XYZPoint& box_min,
+                                              const ROOT::Math::XYZPoint& box_max) {
+    auto box_center = box_min + (box_max - box_min) / 2;
+    auto box_size = box_max - box_min;
+
+    // Accept a particle if its line intersects the box in the direction of flight
+    auto accepted = [&](const ShowerParticle& particle) {
+        ROOT::Math::XYZPoint position(particle.x * units::m, particle.y * units::m, particle.z * units::m);
+        auto intersection = LiangBarsky::intersectionDistances(ROOT::Math::XYZVector(particle.u, particle.v, particle.w),
+                                                               position - static_cast<ROOT::Math::XYZVector>(box_center),
+                                                               box_size);
+        return intersection.has_value() && intersection->second >= 0;
+    };
+
+    CosmicsShowerPool pool;
+    pool.showers_.reserve(size);
+    std::vector<CRYParticle*> particles;
+    while(pool.showers_.size() < size) {
+        if(pool.generated_ >= size * max_generated_per_shower) {
+            LOG(WARNING) << "Stopping generation of shower pool after " << pool.generated_ << " showers with only "
+                         << pool.showers_.size() << " showers accepted";
+            break;
+        }
+
+        particles.clear();
+        generator.genEvent(&particles);
+        ++pool.generated_;
+
+        Shower shower;
+        shower.reserve(particles.size());
+        for(auto* particle : particles) {
+            shower.push_back(ShowerParticle::from(*particle));
+            delete particle;
+        }
+
+        if(std::any_of(shower.begin(), shower.end(), accepted)) {
+            pool.showers_.push_back(std::move(shower));
+            LOG_PROGRESS(INFO, "SHOWER_POOL") << "Accepted " << pool.showers_.size() << " of " << pool.generated_
+                                              << " generated showers";
+        }
+    }
+
+    // CRY simulates time in seconds
+    pool.time_simulated_ = generator.timeSimulated() * units::s;
+    return pool;
+}
+
+std::pair<CosmicsShowerPool, std::string> CosmicsShowerPool::read(const std::filesystem::path& path) {
+    std::ifstream file(path);
+    if(!file) {
+        throw ModuleError("Could not open shower pool file " + path.string());
+    }
+
+    CosmicsShowerPool pool;
+    std::string token, cry_config;
+    size_t size = 0;
+    if(!(file >> token) || token != "cry_config" || !std::getline(file, cry_config) || !(file >> token) ||
+       token != "generated" || !(file >> pool.generated_ >> token) || token != "time_simulated" ||
+       !(file >> pool.time_simulated_ >> token) || token != "showers" || !(file >> size)) {
+        throw ModuleError("Shower pool file " + path.string() + " has an invalid header");
+    }
+
+    pool.showers_.resize(size);
+    for(auto& shower : pool.showers_) {
+        size_t particles = 0;
+        if(!(file >> particles)) {
+            throw ModuleError("Shower pool file " + path.string() + " ends before all showers are read");
+        }
+        shower.resize(particles);
+        for(auto& particle : shower) {
+            int id = 0;
+            if(!(file >> id >> particle.pdg_id >> particle.charge >> particle.ke >> particle.x >> particle.y >>
+                 particle.z >> particle.u >> particle.v >> particle.w >> particle.t)) {
+                throw ModuleError("Shower pool file " + path.string() + " contains an invalid particle");
+            }
+            particle.id = static_cast<CRYParticle::CRYId>(id);
+        }
+    }
+
+    if(pool.showers_.empty()) {
+        throw ModuleError("Shower pool file " + path.string() + " does not contain any showers");
+    }
+    return {std::move(pool), trim(cry_config)};
+}
+
+void CosmicsShowerPool::write(const std::filesystem::path& path, const std::string& cry_config) const {
+    std::ofstream file(path);
+    if(!file) {
+        throw ModuleError("Could not create shower pool file " + path.string());
+    }
+
+    file << std::setprecision(std::numeric_limits<double>::max_digits10);
+    file << "cry_config " << cry_config << '\n';
+    file << "generated " << generated_ << '\n';
+    file << "time_simulated " << time_simulated_ << '\n';
+    file << "showers " << showers_.size() << '\n';
+    for(const auto& shower : showers_) {
+        file << shower.size() << '\n';
+        for(const auto& particle : shower) {
+            file << static_cast<int>(particle.id) << ' ' << particle.pdg_id << ' ' << particle.charge << ' ' << particle.ke
+                 << ' ' << particle.x << ' ' << particle.y << ' ' << particle.z << ' ' << particle.u << ' ' << particle.v
+                 << ' ' << particle.w << ' ' << particle.t << '\n';
+        }
+    }
+}
+
+const Shower& CosmicsShowerPool::draw(double random) const {
+    auto index = static_cast<size_t>(random * static_cast<double>(showers_.size()));
+    return showers_[std::min(index, showers_.size() - 1)];
+}
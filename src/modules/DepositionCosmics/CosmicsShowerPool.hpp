@@ -0,0 +1,120 @@
+/**
+ * @file
+ * @brief Defines a pool of pre-generated CRY showers
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef ALLPIX_COSMICS_DEPOSITION_MODULE_SHOWER_POOL_H
+#define ALLPIX_COSMICS_DEPOSITION_MODULE_SHOWER_POOL_H
+
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <Math/Point3D.h>
+
+#include <CRYGenerator.h>
+#include <CRYParticle.h>
+
+namespace allpix {
+    /**
+     * @brief Particle of a CRY shower, stored in the units of CRY
+     */
+    struct ShowerParticle {
+        CRYParticle::CRYId id{};
+        int pdg_id{};
+        int charge{};
+        // Kinetic energy in MeV
+        double ke{};
+        // Position in m
+        double x{}, y{}, z{};
+        // Direction cosines
+        double u{}, v{}, w{};
+        // Time in s
+        double t{};
+
+        /**
+         * @brief Copy the properties of a particle generated by CRY
+         */
+        static ShowerParticle from(CRYParticle& particle);
+    };
+
+    using Shower = std::vector<ShowerParticle>;
+
+    /**
+     * @brief Pool of CRY showers accepted by a box around the setup, from which showers can be drawn in every event
+     *
+     * A shower is accepted if the straight line of at least one of its particles intersects the acceptance box. The time
+     * simulated by CRY for all generated showers, including the rejected ones, is recorded to normalize the rate of the
+     * showers drawn from the pool.
+     */
+    class CosmicsShowerPool {
+    public:
+        /**
+         * @brief Generate a new pool of showers
+         * @param generator CRY generator to generate the showers with, including its configured random function
+         * @param size Number of accepted showers to generate
+         * @param box_min Minimum corner of the acceptance box in global coordinates
+         * @param box_max Maximum corner of the acceptance box in global coordinates
+         * @return Pool of showers, which can contain less showers if the limit of generated showers is reached
+         */
+        static CosmicsShowerPool generate(CRYGenerator& generator,
+                                          size_t size,
+                                          const ROOT::Math::XYZPoint& box_min,
+                                          const ROOT::Math::XYZPoint& box_max);
+
+        /**
+         * @brief Read a pool of showers from a file written by \ref write
+         * @param path Path of the file
+         * @return Pool of showers together with the CRY configuration it was generated with
+         */
+        static std::pair<CosmicsShowerPool, std::string> read(const std::filesystem::path& path);
+
+        /**
+         * @brief Write the pool of showers to a file
+         * @param path Path of the file
+         * @param cry_config CRY configuration the pool was generated with
+         */
+        void write(const std::filesystem::path& path, const std::string& cry_config) const;
+
+        /**
+         * @brief Draw a shower from the pool
+         * @param random Uniformly distributed random number in [0, 1)
+         * @return Shower selected by the random number
+         */
+        const Shower& draw(double random) const;
+
+        /**
+         * @brief Get the number of showers in the pool
+         */
+        size_t size() const { return showers_.size(); }
+
+        /**
+         * @brief Get the number of showers generated by CRY to fill the pool, including the rejected ones
+         */
+        size_t generated() const { return generated_; }
+
+        /**
+         * @brief Get the time simulated by CRY to fill the pool in the framework units
+         */
+        double timeSimulated() const { return time_simulated_; }
+
+        /**
+         * @brief Get the simulated time corresponding to the rate of a single shower of the pool
+         */
+        double timePerShower() const { return time_simulated_ / static_cast<double>(showers_.size()); }
+
+    private:
+        std::vector<Shower> showers_;
+        size_t generated_{};
+        double time_simulated_{};
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_COSMICS_DEPOSITION_MODULE_SHOWER_POOL_H */
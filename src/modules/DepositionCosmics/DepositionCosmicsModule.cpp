@@ -11,17 +11,22 @@
 
 #include "DepositionCosmicsModule.hpp"
 #include "CosmicsGeneratorActionG4.hpp"
+#include "RNGWrapper.hpp"
 
 #include "tools/geant4/MTRunManager.hpp"
 #include "tools/geant4/RunManager.hpp"
 #include "tools/geant4/geant4.h"
 
+#include <CLHEP/Random/MixMaxRng.h>
 #include <G4Box.hh>
 #include <G4LogicalVolume.hh>
 
 #include "../DepositionGeant4/ActionInitializationG4.hpp"
 
+#include <algorithm>
+#include <climits>
 #include <filesystem>
+#include <limits>
 #include <sstream>
 #include <string>
 #include <utility>
@@ -31,6 +36,7 @@
 using namespace allpix;
 
 thread_local double DepositionCosmicsModule::cry_instance_time_simulated_ = 0;
+std::shared_ptr<const CosmicsShowerPool> DepositionCosmicsModule::shower_pool_;
 
 DepositionCosmicsModule::DepositionCosmicsModule(Configuration& config, Messenger* messenger, GeometryManager* geo_manager)
     : DepositionGeant4Module(config, messenger, geo_manager) {
@@ -52,6 +58,8 @@ DepositionCosmicsModule::DepositionCosmicsModule(Configuration& config, Messenge
     config_.setDefault("latitude", 53.0);
     config_.setDefault("date", "12-31-2020");
     config_.setDefault("reset_particle_time", false);
+    config_.setDefault<size_t>("shower_pool_size", 0);
+    config_.setDefault("shower_pool_margin", Units::get(10, "cm"));
 
     // Force source type and position:
     config_.set("source_type", "cosmics");
@@ -170,11 +178,98 @@ DepositionCosmicsModule::DepositionCosmicsModule(Configuration& config, Messenge
 }
 
 void DepositionCosmicsModule::initialize_g4_action() {
+    if(config_.get<size_t>("shower_pool_size") > 0 || config_.has("shower_pool_file")) {
+        initialize_shower_pool();
+    }
+
     auto* action_initialization =
         new ActionInitializationG4<CosmicsGeneratorActionG4, GeneratorActionInitializationMaster>(config_);
     run_manager_g4_->SetUserInitialization(action_initialization);
 }
 
+void DepositionCosmicsModule::initialize_shower_pool() {
+    auto cry_config = config_.get<std::string>("_cry_config");
+
+    // Read an existing pool if available
+    if(config_.has("shower_pool_file")) {
+        auto path = config_.getPath("shower_pool_file");
+        if(std::filesystem::is_regular_file(path)) {
+            auto [pool, pool_cry_config] = CosmicsShowerPool::read(path);
+            if(pool_cry_config != trim(cry_config)) {
+                LOG(WARNING) << "Shower pool was generated with a different CRY configuration:" << std::endl
+                             << pool_cry_config;
+            }
+            shower_pool_ = std::make_shared<const CosmicsShowerPool>(std::move(pool));
+            LOG(STATUS) << "Read pool of " << shower_pool_->size() << " showers from " << path;
+        }
+    }
+
+    if(shower_pool_ == nullptr) {
+        auto pool_size = config_.get<size_t>("shower_pool_size");
+        if(pool_size == 0) {
+            throw InvalidValueError(config_, "shower_pool_size", "size required to generate a new shower pool");
+        }
+
+        // Acceptance box enclosing all detectors with the configured margin
+        auto margin = config_.get<double>("shower_pool_margin");
+        auto box_min = ROOT::Math::XYZPoint(std::numeric_limits<double>::max(),
+                                            std::numeric_limits<double>::max(),
+                                            std::numeric_limits<double>::max());
+        auto box_max = ROOT::Math::XYZPoint(std::numeric_limits<double>::lowest(),
+                                            std::numeric_limits<double>::lowest(),
+                                            std::numeric_limits<double>::lowest());
+        for(const auto& detector : geo_manager_->getDetectors()) {
+            auto model = detector->getModel();
+            for(int corner = 0; corner < 8; ++corner) {
+                auto point = model->getModelCenter();
+                point.SetX(point.x() + ((corner & 1) != 0 ? 0.5 : -0.5) * model->getSize().x());
+                point.SetY(point.y() + ((corner & 2) != 0 ? 0.5 : -0.5) * model->getSize().y());
+                point.SetZ(point.z() + ((corner & 4) != 0 ? 0.5 : -0.5) * model->getSize().z());
+                point = detector->getGlobalPosition(point);
+                box_min.SetXYZ(
+                    std::min(box_min.x(), point.x()), std::min(box_min.y(), point.y()), std::min(box_min.z(), point.z()));
+                box_max.SetXYZ(
+                    std::max(box_max.x(), point.x()), std::max(box_max.y(), point.y()), std::max(box_max.z(), point.z()));
+            }
+        }
+        box_min -= ROOT::Math::XYZVector(margin, margin, margin);
+        box_max += ROOT::Math::XYZVector(margin, margin, margin);
+        LOG(DEBUG) << "Accepting showers reaching box between " << Units::display(box_min, {"mm", "cm", "m"}) << " and "
+                   << Units::display(box_max, {"mm", "cm", "m"});
+
+        // Generate the pool with a dedicated engine, seeded from the framework seed unless configured explicitly
+        config_.setDefault<uint64_t>("shower_pool_seed",
+                                     getConfigManager()->getGlobalConfiguration().get<uint64_t>("random_seed"));
+        CLHEP::MixMaxRng engine(static_cast<long>(config_.get<uint64_t>("shower_pool_seed") % LONG_MAX));
+        RNGWrapper<CLHEP::HepRandomEngine>::set(&engine, &CLHEP::HepRandomEngine::flat);
+
+        auto* setup = new CRYSetup(cry_config, config_.get<std::string>("data_path"));
+        setup->setRandomFunction(RNGWrapper<CLHEP::HepRandomEngine>::rng);
+        CRYGenerator generator(setup);
+
+        LOG(STATUS) << "Generating pool of " << pool_size << " showers";
+        auto pool = CosmicsShowerPool::generate(generator, pool_size, box_min, box_max);
+        if(pool.size() == 0) {
+            throw ModuleError("No generated shower reached the acceptance box of the setup");
+        }
+
+        if(config_.has("shower_pool_file")) {
+            auto path = config_.getPath("shower_pool_file");
+            pool.write(path, cry_config);
+            LOG(STATUS) << "Wrote shower pool to " << path;
+        }
+        shower_pool_ = std::make_shared<const CosmicsShowerPool>(std::move(pool));
+    }
+
+    // Record the normalization of the pool
+    auto acceptance = static_cast<double>(shower_pool_->size()) / static_cast<double>(shower_pool_->generated());
+    LOG(STATUS) << "Shower pool contains " << shower_pool_->size() << " of " << shower_pool_->generated()
+                << " generated showers, acceptance fraction " << acceptance << ", simulated time per shower "
+                << Units::display(shower_pool_->timePerShower(), {"us", "ms", "s"});
+    config_.set("shower_pool_acceptance", acceptance);
+    config_.set("shower_pool_time_simulated", shower_pool_->timeSimulated());
+}
+
 void DepositionCosmicsModule::finalizeThread() {
     // Call base class thread finalization:
     DepositionGeant4Module::finalizeThread();
@@ -13,7 +13,9 @@
 #define ALLPIX_COSMICS_DEPOSITION_MODULE_H
 
 #include "../DepositionGeant4/DepositionGeant4Module.hpp"
+#include "CosmicsShowerPool.hpp"
 
+#include <memory>
 #include <mutex>
 
 namespace allpix {
@@ -51,7 +53,13 @@ namespace allpix {
     private:
         void initialize_g4_action() override;
 
+        /**
+         * @brief Read the shower pool from file or generate it with the acceptance box of all detectors
+         */
+        void initialize_shower_pool();
+
         static thread_local double cry_instance_time_simulated_;
+        static std::shared_ptr<const CosmicsShowerPool> shower_pool_;
         std::mutex stats_mutex_;
         double total_time_simulated_{};
     };
@@ -12,23 +12,40 @@
 
 #include "DepositionGeant4Module.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
 #include <limits>
+#include <map>
+#include <set>
+#include <sstream>
 #include <string>
+#include <system_error>
 #include <utility>
+#include <vector>
 
 #include <G4Box.hh>
 #include <G4EmParameters.hh>
 #include <G4HadronicParameters.hh>
 #include <G4HadronicProcessStore.hh>
 #include <G4LogicalVolume.hh>
+#include <G4Material.hh>
 #include <G4NuclearLevelData.hh>
+#include <G4PVPlacement.hh>
 #include <G4PhysListFactory.hh>
 #include <G4ProcessTable.hh>
+#include <G4ProductionCuts.hh>
 #include <G4RadioactiveDecayPhysics.hh>
+#include <G4Region.hh>
 #include <G4StepLimiterPhysics.hh>
 #include <G4UImanager.hh>
 #include <G4UserLimits.hh>
+#include <G4VPhysicalVolume.hh>
+#include <G4Version.hh>
 
+#include "G4CachedMagneticField.hh"
 #include "G4FieldManager.hh"
 #include "G4TransportationManager.hh"
 #include "G4UniformMagField.hh"
@@ -37,7 +54,9 @@
 #include "core/geometry/GeometryManager.hpp"
 #include "core/geometry/RadialStripDetectorModel.hpp"
 #include "core/module/exceptions.h"
+#include "core/utils/distributions.h"
 #include "core/utils/log.h"
+#include "core/utils/unit_constants.h"
 #include "objects/DepositedCharge.hpp"
 #include "physics/MaterialProperties.hpp"
 #include "tools/ROOT.h"
@@ -50,7 +69,9 @@
 #include "ActionInitializationG4.hpp"
 #include "GeneratorActionG4.hpp"
 #include "SDAndFieldConstruction.hpp"
+#include "MagneticFieldG4.hpp"
 #include "SensitiveDetectorActionG4.hpp"
+#include "SensitiveDetectorRouterG4.hpp"
 #include "SetTrackInfoUserHookG4.hpp"
 
 #define G4_NUM_SEEDS 10
@@ -59,6 +80,7 @@ using namespace allpix;
 
 thread_local std::unique_ptr<TrackInfoManager> DepositionGeant4Module::track_info_manager_ = nullptr;
 thread_local std::vector<SensitiveDetectorActionG4*> DepositionGeant4Module::sensors_;
+thread_local bool DepositionGeant4Module::worker_initialized_ = false;
 
 /**
  * Includes the particle source point to the geometry using \ref GeometryManager::addPoint.
@@ -70,6 +92,11 @@ DepositionGeant4Module::DepositionGeant4Module(Configuration& config, Messenger*
     // Waive any sequence requirement: base module not sequential, but derived modules might be
     waive_sequence_requirement();
 
+    // Declare the messages dispatched by this module
+    declare_output<MCTrackMessage>();
+    declare_output<MCParticleMessage>();
+    declare_output<DepositedChargeMessage>();
+
     // Set default physics list
     config_.setDefault("physics_list", "FTFP_BERT_LIV");
     config_.setDefault("pai_model", "pai");
@@ -82,11 +109,50 @@ DepositionGeant4Module::DepositionGeant4Module(Configuration& config, Messenger*
     config_.setDefault<double>("cutoff_time", 2.21e+11);
     // By default, only record MCTracks connected to MCParticles in the sensitive volume
     config_.setDefault<bool>("record_all_tracks", false);
+    config_.setDefault<bool>("record_ancestor_tracks", false);
+
+    // By default, no secondaries are pruned from the Monte Carlo truth
+    config_.setDefault<double>("truth_energy_threshold", 0.);
+    if(config_.get<double>("truth_energy_threshold") < 0) {
+        throw InvalidValueError(config_, "truth_energy_threshold", "energy threshold cannot be negative");
+    }
 
     // Defaults for energy deposition in implants
     config_.setDefault<bool>("deposit_in_frontside_implants", true);
     config_.setDefault<bool>("deposit_in_backside_implants", false);
 
+    // By default, all generated primaries are simulated
+    config_.setDefault<bool>("acceptance_filter", false);
+    config_.setDefault<unsigned int>("acceptance_max_attempts", 1000);
+    if(config_.get<bool>("acceptance_filter") && config_.get<unsigned int>("acceptance_max_attempts") == 0) {
+        throw InvalidValueError(config_, "acceptance_max_attempts", "at least one attempt is required");
+    }
+
+    // By default, the Geant4 workers of all threads are initialized before the first event
+    config_.setDefault<bool>("lazy_thread_initialization", false);
+
+    // By default, all interactions of an event are simulated by the thread processing the event
+    config_.setDefault<unsigned int>("tasks_per_event", 1);
+
+    // By default, non-constant magnetic fields are reused within one millimeter
+    config_.setDefault<double>("magnetic_field_cache_distance", Units::get(1.0, "mm"));
+    if(config_.get<double>("magnetic_field_cache_distance") < 0) {
+        throw InvalidValueError(config_, "magnetic_field_cache_distance", "cache distance cannot be negative");
+    }
+
+    // By default, every step with charge creates a separate deposit
+    config_.setDefault<bool>("merge_deposits", false);
+    config_.setDefault<double>("merge_deposits_size", Units::get(5.0, "um"));
+    config_.setDefault<double>("merge_deposits_time", Units::get(0.1, "ns"));
+    if(config_.get<bool>("merge_deposits")) {
+        if(config_.get<double>("merge_deposits_size") <= 0) {
+            throw InvalidValueError(config_, "merge_deposits_size", "voxel size has to be positive");
+        }
+        if(config_.get<double>("merge_deposits_time") < 0) {
+            throw InvalidValueError(config_, "merge_deposits_time", "time window cannot be negative");
+        }
+    }
+
     // Create user limits for maximum step length and maximum event time in the sensor
     user_limits_ =
         std::make_unique<G4UserLimits>(config_.get<double>("max_step_length"), DBL_MAX, config_.get<double>("cutoff_time"));
@@ -124,7 +190,30 @@ void DepositionGeant4Module::initialize() {
     MTRunManager* run_manager_mt = nullptr;
 
     number_of_particles_ = config_.get<unsigned int>("number_of_particles", 1);
+
+    // In time frame mode, the number of interactions within the time window of the source is drawn for every event
+    if(config_.has("interaction_rate")) {
+        if(config_.has("number_of_particles")) {
+            throw InvalidCombinationError(config_,
+                                          {"interaction_rate", "number_of_particles"},
+                                          "the number of interactions per event is given by the interaction rate");
+        }
+        auto rate = config_.get<double>("interaction_rate");
+        auto time_window = config_.get<double>("source_time_window", 0.);
+        if(rate <= 0) {
+            throw InvalidValueError(config_, "interaction_rate", "interaction rate has to be positive");
+        }
+        if(time_window <= 0 || config_.get<GeneratorActionG4::SourceType>("source_type") ==
+                                   GeneratorActionG4::SourceType::MACRO) {
+            throw InvalidValueError(
+                config_, "interaction_rate", "time frame mode requires a particle source with positive source_time_window");
+        }
+        mean_interactions_ = rate * time_window;
+        LOG(INFO) << "Simulating time frames of " << Units::display(time_window, {"ns", "us"}) << " with on average "
+                  << mean_interactions_ << " interactions";
+    }
     output_plots_ = config_.get<bool>("output_plots");
+    tasks_per_event_ = std::max(1u, config_.get<unsigned int>("tasks_per_event"));
 
     // Load the G4 run manager (which is owned by the geometry builder)
     if(multithreadingEnabled()) {
@@ -154,12 +243,17 @@ void DepositionGeant4Module::initialize() {
             throw InvalidValueError(config_, "pai_model", "model has to be either 'pai' or 'paiphoton'");
         }
 
+        std::set<const G4LogicalVolume*> pai_volumes;
         for(auto& detector : geo_manager_->getDetectors()) {
             // Get logical volume
             auto logical_volume = geo_manager_->getExternalObject<G4LogicalVolume>(detector->getName(), "sensor_log");
             if(logical_volume == nullptr) {
                 throw ModuleError("Detector " + detector->getName() + " has no sensitive device (broken Geant4 geometry)");
             }
+            // Logical volumes shared with other detectors can only be the root of a single region
+            if(!pai_volumes.insert(logical_volume.get()).second) {
+                continue;
+            }
             // Create region
             auto* region = new G4Region(detector->getName() + "_sensor_region");
             region->AddRootLogicalVolume(logical_volume.get());
@@ -304,6 +398,23 @@ void DepositionGeant4Module::initialize() {
         world_log_volume->GetRegion()->SetUserLimits(user_limits_world_.get());
     }
 
+    // Combine passive volumes into a region with reduced detail of the particle tracking if requested
+    if(config_.has("passive_regions")) {
+        construct_passive_region(min_charge_creation_energy);
+    }
+
+    // Retrieve the physics tables from the cache if they have been stored for this physics configuration before
+    std::filesystem::path physics_table_cache;
+    bool physics_tables_retrieved = false;
+    if(config_.has("physics_table_cache")) {
+        physics_table_cache = physics_table_directory(physics_list, production_cut);
+        if(std::filesystem::is_directory(physics_table_cache)) {
+            LOG(INFO) << "Retrieving Geant4 physics tables from " << physics_table_cache;
+            physicsList->SetPhysicsTableRetrieved(physics_table_cache.string());
+            physics_tables_retrieved = true;
+        }
+    }
+
     // Initialize the physics list
     LOG(TRACE) << "Initializing physics processes";
     run_manager_g4_->SetUserInitialization(physicsList);
@@ -320,15 +431,23 @@ void DepositionGeant4Module::initialize() {
     // Initialize the full run manager to ensure correct state flags
     run_manager_g4_->Initialize();
 
+    // Store the physics tables built during the initialization for subsequent runs
+    if(!physics_table_cache.empty() && !physics_tables_retrieved) {
+        store_physics_tables(physicsList, physics_table_cache);
+    }
+
     // Build particle generator
     // User hook to store additional information at track initialization and termination as well as custom track ids
     LOG(TRACE) << "Constructing particle source";
+    if(config_.get<bool>("acceptance_filter")) {
+        GeneratorActionG4::setAcceptanceDetectors(geo_manager_->getDetectors());
+    }
     initialize_g4_action();
 
     // Construct the sensitive detectors and fields.
     if(run_manager_mt == nullptr) {
         // Create the info track manager for the main thread before creating the Sensitive detectors.
-        track_info_manager_ = std::make_unique<TrackInfoManager>(config_.get<bool>("record_all_tracks"));
+        track_info_manager_ = create_track_info_manager();
         construct_sensitive_detectors_and_fields();
     } else {
         // In MT-mode we register a builder that will be called for each thread to construct the SD when needed.
@@ -340,6 +459,101 @@ void DepositionGeant4Module::initialize() {
     G4cout << G4endl;
 }
 
+void DepositionGeant4Module::construct_passive_region(double min_kinetic_energy_world) {
+    auto* region = new G4Region("passive_region");
+    for(const auto& name : config_.getArray<std::string>("passive_regions")) {
+        auto logical_volume = geo_manager_->getExternalObject<G4LogicalVolume>(name, "passive_material_log");
+        if(logical_volume == nullptr) {
+            throw InvalidValueError(config_, "passive_regions", "no passive material with name '" + name + "' found");
+        }
+
+        // Daughter volumes inherit the region, which would also reduce the tracking detail in sensors
+        for(auto& detector : geo_manager_->getDetectors()) {
+            auto wrapper = geo_manager_->getExternalObject<G4PVPlacement>(detector->getName(), "wrapper_phys");
+            if(wrapper != nullptr && logical_volume->IsAncestor(wrapper.get())) {
+                throw InvalidValueError(config_,
+                                        "passive_regions",
+                                        "passive material '" + name + "' contains detector " + detector->getName());
+            }
+        }
+        region->AddRootLogicalVolume(logical_volume.get());
+        LOG(DEBUG) << "Added passive material " << name << " to region " << region->GetName();
+    }
+
+    if(config_.has("passive_range_cut")) {
+        auto range_cut = config_.get<double>("passive_range_cut");
+        auto* cuts = new G4ProductionCuts();
+        cuts->SetProductionCut(range_cut);
+        region->SetProductionCuts(cuts);
+        LOG(INFO) << "Setting G4 production cut in passive materials to " << Units::display(range_cut, {"mm", "um"});
+    }
+
+    // Keep the limits of the world volume, which would otherwise not apply to the passive materials
+    user_limits_passive_ = std::make_unique<G4UserLimits>(*user_limits_world_);
+    if(config_.has("passive_min_kinetic_energy")) {
+        auto min_kinetic_energy = config_.get<double>("passive_min_kinetic_energy");
+        user_limits_passive_->SetUserMinEkine(std::max(min_kinetic_energy, min_kinetic_energy_world));
+        LOG(INFO) << "Killing tracks in passive materials below kinetic energy of "
+                  << Units::display(min_kinetic_energy, {"keV", "MeV"});
+    }
+    region->SetUserLimits(user_limits_passive_.get());
+}
+
+std::filesystem::path DepositionGeant4Module::physics_table_directory(const std::string& physics_list,
+                                                                    double production_cut) const {
+    // Describe everything the physics tables depend on. Geant4 checks the material-cuts couples of retrieved tables itself
+    std::stringstream description;
+    description << std::setprecision(std::numeric_limits<double>::max_digits10) << G4VERSION_NUMBER << " " << physics_list
+                << " " << production_cut;
+    if(config_.get<bool>("enable_pai", false)) {
+        description << " " << config_.get<std::string>("pai_model");
+    }
+    for(const auto* material : *G4Material::GetMaterialTable()) {
+        description << " " << material->GetName() << ":" << material->GetDensity();
+    }
+    for(const auto& detector : geo_manager_->getDetectors()) {
+        description << " " << detector->getName();
+    }
+    if(config_.has("passive_regions") && config_.has("passive_range_cut")) {
+        description << " " << config_.get<std::string>("passive_regions") << ":" << config_.get<double>("passive_range_cut");
+    }
+
+    // Use the stable FNV-1a hash to allow sharing the cache between builds
+    uint64_t hash = 14695981039346656037ULL;
+    for(auto character : description.str()) {
+        hash = (hash ^ static_cast<unsigned char>(character)) * 1099511628211ULL;
+    }
+    std::stringstream name;
+    name << physics_list << "_" << std::hex << std::setw(16) << std::setfill('0') << hash;
+    LOG(DEBUG) << "Physics table cache key " << name.str() << " for configuration " << description.str();
+
+    return config_.getPath("physics_table_cache") / name.str();
+}
+
+void DepositionGeant4Module::store_physics_tables(G4VModularPhysicsList* physics_list,
+                                                  const std::filesystem::path& directory) {
+    // Write the tables to a temporary directory which is renamed once complete, such that concurrent jobs sharing the
+    // cache never retrieve incomplete tables
+    auto temporary = directory;
+    temporary += ".tmp" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    std::error_code error;
+    std::filesystem::create_directories(temporary, error);
+    if(error || !physics_list->StorePhysicsTable(temporary.string())) {
+        LOG(WARNING) << "Could not store Geant4 physics tables in " << directory;
+        std::filesystem::remove_all(temporary, error);
+        return;
+    }
+
+    std::filesystem::rename(temporary, directory, error);
+    if(error) {
+        // Another job stored the tables for the same configuration in the meantime
+        LOG(DEBUG) << "Geant4 physics tables already stored in " << directory;
+        std::filesystem::remove_all(temporary, error);
+        return;
+    }
+    LOG(INFO) << "Stored Geant4 physics tables in " << directory;
+}
+
 void DepositionGeant4Module::initialize_g4_action() {
     auto* action_initialization =
         new ActionInitializationG4<GeneratorActionG4, GeneratorActionInitializationMaster>(config_);
@@ -347,6 +561,16 @@ void DepositionGeant4Module::initialize_g4_action() {
 }
 
 void DepositionGeant4Module::initializeThread() {
+    // Threads which never process an event of this module do not need to set up Geant4
+    if(config_.get<bool>("lazy_thread_initialization")) {
+        LOG(DEBUG) << "Deferring initialization of run manager to the first event of the thread";
+        return;
+    }
+
+    initialize_worker();
+}
+
+void DepositionGeant4Module::initialize_worker() {
 
     LOG(DEBUG) << "Initializing run manager";
 
@@ -357,7 +581,7 @@ void DepositionGeant4Module::initializeThread() {
         // In MT-mode the sensitive detectors will be created with the calls to BeamOn. So we construct the
         // track manager for each calling thread here.
         if(track_info_manager_ == nullptr) {
-            track_info_manager_ = std::make_unique<TrackInfoManager>(config_.get<bool>("record_all_tracks"));
+            track_info_manager_ = create_track_info_manager();
         }
 
         run_manager_mt->InitializeForThread();
@@ -366,9 +590,15 @@ void DepositionGeant4Module::initializeThread() {
     // Set selected tracking verbosity, defaulting to zero. Higher levels can be useful for tracing individual Geant4 events
     G4RunManagerKernel::GetRunManagerKernel()->GetTrackingManager()->SetVerboseLevel(
         config_.get<int>("geant4_tracking_verbosity", 0));
+
+    worker_initialized_ = true;
 }
 
 void DepositionGeant4Module::run(Event* event) {
+    // Initialize the worker run manager of this thread on its first event if the initialization has been deferred
+    if(!worker_initialized_) {
+        initialize_worker();
+    }
 
     // Seed the sensitive detectors RNG
     for(auto& sensor : sensors_) {
@@ -381,20 +611,30 @@ void DepositionGeant4Module::run(Event* event) {
     auto seed2 = event->getRandomNumber();
     LOG(DEBUG) << "Seeding Geant4 event with seeds " << seed1 << " " << seed2;
 
+    // Every Geant4 event is one interaction, placed at a random time within the time frame in time frame mode
+    auto interactions = number_of_particles_;
+    if(mean_interactions_ > 0) {
+        allpix::poisson_distribution<unsigned int> interaction_distribution(mean_interactions_);
+        interactions = interaction_distribution(event->getRandomEngine());
+        LOG(DEBUG) << "Simulating " << interactions << " interactions in time frame";
+    }
+
+    // Several interactions can be split into sub-events simulated by idle threads
+    auto split = (tasks_per_event_ > 1 && interactions > 1);
     try {
-        if(multithreadingEnabled()) {
-            auto* run_manager_mt = static_cast<MTRunManager*>(run_manager_g4_);
-            run_manager_mt->Run(static_cast<int>(number_of_particles_), seed1, seed2);
-        } else {
-            auto* run_manager = static_cast<RunManager*>(run_manager_g4_);
-            run_manager->Run(static_cast<int>(number_of_particles_), seed1, seed2);
+        if(split) {
+            run_sub_events(event, interactions);
+        } else if(interactions > 0) {
+            run_interactions(interactions, seed1, seed2);
         }
 
         uint64_t last_event_num = last_event_num_.load();
         last_event_num_.compare_exchange_strong(last_event_num, event->number);
 
-        track_info_manager_->createMCTracks();
-        track_info_manager_->dispatchMessage(this, messenger_, event);
+        if(record_tracks_) {
+            track_info_manager_->createMCTracks();
+            track_info_manager_->dispatchMessage(this, messenger_, event);
+        }
 
         // Dispatch the necessary messages
         for(auto& sensor : sensors_) {
@@ -402,10 +642,10 @@ void DepositionGeant4Module::run(Event* event) {
 
             // Fill output plots if requested:
             if(output_plots_) {
-                double charge = static_cast<double>(Units::convert(sensor->getDepositedCharge(), "ke"));
+                double charge = sensor->getDepositedCharge() / units::ke;
                 charge_per_event_[sensor->getName()]->Fill(charge);
 
-                double deposited_energy = static_cast<double>(Units::convert(sensor->getDepositedEnergy(), "keV"));
+                double deposited_energy = sensor->getDepositedEnergy() / units::keV;
                 energy_per_event_[sensor->getName()]->Fill(deposited_energy);
 
                 for(const auto& track_position : sensor->getTrackIncidentPositions()) {
@@ -414,11 +654,13 @@ void DepositionGeant4Module::run(Event* event) {
             }
         }
     } catch(AbortEventException& e) {
-        // Clear charge deposits of all sensors
+        // Clear charge deposits of all sensors, sub-events have already been aborted by the thread simulating them
         for(auto& sensor : sensors_) {
             sensor->clearEventInfo();
         }
-        run_manager_g4_->AbortRun();
+        if(!split) {
+            run_manager_g4_->AbortRun();
+        }
         track_info_manager_->resetTrackInfoManager();
         throw;
     }
@@ -426,7 +668,83 @@ void DepositionGeant4Module::run(Event* event) {
     track_info_manager_->resetTrackInfoManager();
 }
 
+void DepositionGeant4Module::run_interactions(unsigned int interactions, uint64_t seed1, uint64_t seed2) {
+    if(multithreadingEnabled()) {
+        auto* run_manager_mt = static_cast<MTRunManager*>(run_manager_g4_);
+        run_manager_mt->Run(static_cast<int>(interactions), seed1, seed2);
+    } else {
+        auto* run_manager = static_cast<RunManager*>(run_manager_g4_);
+        run_manager->Run(static_cast<int>(interactions), seed1, seed2);
+    }
+}
+
+/**
+ * Every sub-event simulates a contiguous part of the interactions on the thread executing its task, with the worker run
+ * manager and sensors of this thread seeded from the random stream of the task. The tracks and deposits are then moved out
+ * of the thread-local sensors and track manager, and merged into those of the calling thread in the order of the sub-events.
+ * The results therefore depend on the number of tasks, but not on the number of threads or the order of execution.
+ */
+void DepositionGeant4Module::run_sub_events(Event* event, unsigned int interactions) {
+    struct SubEvent {
+        TrackInfoManager::SubEventTracks tracks;
+        std::vector<SensitiveDetectorActionG4::SubEventInfo> sensors;
+    };
+
+    auto num_tasks = std::min(tasks_per_event_, interactions);
+    LOG(DEBUG) << "Splitting " << interactions << " interactions into " << num_tasks << " sub-events";
+
+    std::vector<SubEvent> sub_events(num_tasks);
+    event->parallelFor(num_tasks, [&](size_t task, RandomNumberGenerator& random_generator) {
+        // Threads helping with the event might not have simulated any event of this module before
+        if(!worker_initialized_) {
+            initialize_worker();
+        }
+
+        for(auto& sensor : sensors_) {
+            sensor->seed(random_generator());
+        }
+        auto seed1 = random_generator();
+        auto seed2 = random_generator();
+        auto task_interactions =
+            static_cast<unsigned int>(interactions / num_tasks + (task < interactions % num_tasks ? 1 : 0));
+        LOG(DEBUG) << "Simulating " << task_interactions << " interactions in sub-event " << task;
+
+        try {
+            run_interactions(task_interactions, seed1, seed2);
+        } catch(AbortEventException&) {
+            for(auto& sensor : sensors_) {
+                sensor->clearEventInfo();
+            }
+            run_manager_g4_->AbortRun();
+            track_info_manager_->resetTrackInfoManager();
+            throw;
+        }
+
+        auto& sub_event = sub_events[task];
+        sub_event.tracks = track_info_manager_->takeSubEventTracks(record_tracks_);
+        for(auto& sensor : sensors_) {
+            sub_event.sensors.push_back(sensor->takeSubEventInfo());
+        }
+    });
+
+    // The sensors of all threads are created in the order of the detectors
+    for(auto& sub_event : sub_events) {
+        auto offset = track_info_manager_->addSubEventTracks(std::move(sub_event.tracks));
+        for(size_t i = 0; i < sensors_.size(); ++i) {
+            sensors_[i]->addSubEventInfo(std::move(sub_event.sensors[i]), offset);
+        }
+    }
+}
+
 void DepositionGeant4Module::finalize() {
+    if(config_.get<bool>("acceptance_filter")) {
+        auto [generated, accepted] = GeneratorActionG4::getAcceptanceStatistics();
+        LOG(INFO) << "Acceptance filter accepted " << accepted << " of " << generated
+                  << " generated primary vertices, acceptance fraction "
+                  << (generated > 0 ? static_cast<double>(accepted) / static_cast<double>(generated) : 0.)
+                  << ". Rates per event have to be scaled with this fraction";
+    }
+
     if(output_plots_) {
         // Write histograms
         LOG(TRACE) << "Writing output plots to file";
@@ -461,29 +779,60 @@ void DepositionGeant4Module::finalizeThread() {
     }
 }
 
+std::unique_ptr<TrackInfoManager> DepositionGeant4Module::create_track_info_manager() const {
+    return std::make_unique<TrackInfoManager>(
+        config_.get<bool>("record_all_tracks"),
+        config_.get<unsigned int>("truth_max_generation", std::numeric_limits<unsigned int>::max()),
+        config_.get<double>("truth_energy_threshold"),
+        config_.get<bool>("record_ancestor_tracks"));
+}
+
 void DepositionGeant4Module::construct_sensitive_detectors_and_fields() {
     if(geo_manager_->hasMagneticField()) {
         MagneticFieldType magnetic_field_type_ = geo_manager_->getMagneticFieldType();
 
+        // Constant fields are passed directly, other fields are evaluated through the geometry manager
+        G4MagneticField* magField = nullptr;
         if(magnetic_field_type_ == MagneticFieldType::CONSTANT) {
             ROOT::Math::XYZVector b_field = geo_manager_->getMagneticField(ROOT::Math::XYZPoint(0., 0., 0.));
-            G4MagneticField* magField = new G4UniformMagField(G4ThreeVector(b_field.x(), b_field.y(), b_field.z()));
-            G4FieldManager* globalFieldMgr = G4TransportationManager::GetTransportationManager()->GetFieldManager();
-            globalFieldMgr->SetDetectorField(magField);
-            globalFieldMgr->CreateChordFinder(magField);
+            magField = new G4UniformMagField(G4ThreeVector(b_field.x(), b_field.y(), b_field.z()));
         } else {
-            throw ModuleError("Magnetic field enabled, but not constant. This can't be handled by this module yet.");
+            magField = new MagneticFieldG4(geo_manager_);
+
+            // The stepper evaluates the field several times per step, reuse the last value for nearby points
+            auto cache_distance = config_.get<double>("magnetic_field_cache_distance");
+            if(cache_distance > 0) {
+                LOG(DEBUG) << "Caching magnetic field evaluations within " << Units::display(cache_distance, {"mm", "um"});
+                magField = new G4CachedMagneticField(magField, cache_distance);
+            }
         }
+        G4FieldManager* globalFieldMgr = G4TransportationManager::GetTransportationManager()->GetFieldManager();
+        globalFieldMgr->SetDetectorField(magField);
+        globalFieldMgr->CreateChordFinder(magField);
+    }
+
+    // Only create the Monte-Carlo tracks if they are received directly or referenced by the received Monte-Carlo particles
+    record_tracks_ = messenger_->hasReceiver<MCTrackMessage>(this);
+    for(auto& detector : geo_manager_->getDetectors()) {
+        record_tracks_ = record_tracks_ || messenger_->hasReceiver<MCParticleMessage>(this, detector);
+    }
+    if(!record_tracks_) {
+        LOG(INFO) << "Not creating Monte-Carlo tracks because there is no listener for them";
     }
 
+    // Count the detectors sharing the logical volume of their sensor, as built with geometry instancing
+    std::map<const G4LogicalVolume*, unsigned int> sensor_instances;
+    for(auto& detector : geo_manager_->getDetectors()) {
+        sensor_instances[geo_manager_->getExternalObject<G4LogicalVolume>(detector->getName(), "sensor_log").get()]++;
+    }
+    std::map<const G4LogicalVolume*, SensitiveDetectorRouterG4*> routers;
+
     // Loop through all detectors and set the sensitive detector action that handles the particle passage
     bool useful_deposition = false;
     for(auto& detector : geo_manager_->getDetectors()) {
         // Do not add sensitive detector for detectors that have no listeners for the deposited charges
-        if(!messenger_->hasReceiver(this,
-                                    std::make_shared<DepositedChargeMessage>(std::vector<DepositedCharge>(), detector)) &&
-           !messenger_->hasReceiver(this, std::make_shared<MCParticleMessage>(std::vector<MCParticle>(), detector)) &&
-           !messenger_->hasReceiver(this, std::make_shared<MCTrackMessage>(std::vector<MCTrack>()))) {
+        if(!messenger_->hasReceiver<DepositedChargeMessage>(this, detector) &&
+           !messenger_->hasReceiver<MCParticleMessage>(this, detector) && !record_tracks_) {
             LOG(INFO) << "Not depositing charges in " << detector->getName()
                       << " because there is no listener for its output";
             continue;
@@ -506,6 +855,10 @@ void DepositionGeant4Module::construct_sensitive_detectors_and_fields() {
         // Get model of the sensitive device
         auto* sensitive_detector_action = new SensitiveDetectorActionG4(
             detector, track_info_manager_.get(), charge_creation_energy, fano_factor, cutoff_time);
+        if(config_.get<bool>("merge_deposits")) {
+            sensitive_detector_action->enableDepositMerging(config_.get<double>("merge_deposits_size"),
+                                                            config_.get<double>("merge_deposits_time"));
+        }
         auto logical_volume = geo_manager_->getExternalObject<G4LogicalVolume>(detector->getName(), "sensor_log");
         if(logical_volume == nullptr) {
             throw ModuleError("Detector " + detector->getName() + " has no sensitive device (broken Geant4 geometry)");
@@ -514,8 +867,18 @@ void DepositionGeant4Module::construct_sensitive_detectors_and_fields() {
         // Apply the user limits to this element
         logical_volume->SetUserLimits(user_limits_.get());
 
-        // Add the sensitive detector action
-        logical_volume->SetSensitiveDetector(sensitive_detector_action);
+        // Add the sensitive detector action, shared sensors select the action of the detector from its wrapper placement
+        G4VSensitiveDetector* sensitive_detector = sensitive_detector_action;
+        if(sensor_instances[logical_volume.get()] > 1) {
+            auto& router = routers[logical_volume.get()];
+            if(router == nullptr) {
+                router = new SensitiveDetectorRouterG4("SensitiveDetectorRouter_" + logical_volume->GetName());
+            }
+            auto wrapper = geo_manager_->getExternalObject<G4PVPlacement>(detector->getName(), "wrapper_phys");
+            router->addDetector(wrapper.get(), sensitive_detector_action);
+            sensitive_detector = router;
+        }
+        logical_volume->SetSensitiveDetector(sensitive_detector);
 
         // Add the sensitive detector action to fronmtside implant volumes
         std::regex regex;
@@ -528,7 +891,7 @@ void DepositionGeant4Module::construct_sensitive_detectors_and_fields() {
         }
         for(const auto& implant : geo_manager_->getExternalObjects<G4LogicalVolume>(detector->getName(), regex)) {
             implant->SetUserLimits(user_limits_.get());
-            implant->SetSensitiveDetector(sensitive_detector_action);
+            implant->SetSensitiveDetector(sensitive_detector);
         }
 
         sensors_.push_back(sensitive_detector_action);
@@ -13,6 +13,7 @@
 #define ALLPIX_SIMPLE_DEPOSITION_MODULE_H
 
 #include <atomic>
+#include <filesystem>
 #include <memory>
 #include <string>
 
@@ -34,6 +35,7 @@
 
 class G4UserLimits;
 class G4RunManager;
+class G4VModularPhysicsList;
 
 namespace allpix {
     /**
@@ -64,7 +66,7 @@ namespace allpix {
         void initialize() override;
 
         /**
-         * @brief Prepare thread-local instances of worker run managers
+         * @brief Prepare thread-local instances of worker run managers, unless deferred to the first event of the thread
          */
         void initializeThread() override;
 
@@ -93,19 +95,71 @@ namespace allpix {
         virtual void initialize_g4_action();
 
     private:
+        /**
+         * @brief Initialize the worker run manager of the calling thread including its geometry and physics
+         */
+        void initialize_worker();
+
+        /**
+         * @brief Simulate the given number of interactions with the worker run manager of the calling thread
+         * @param interactions Number of interactions, each being a separate Geant4 event
+         * @param seed1 First seed of the Geant4 random engine
+         * @param seed2 Second seed of the Geant4 random engine
+         */
+        void run_interactions(unsigned int interactions, uint64_t seed1, uint64_t seed2);
+
+        /**
+         * @brief Split the interactions of an event into sub-events, which are simulated in parallel tasks of the event
+         * @param event Event to simulate the interactions for
+         * @param interactions Number of interactions of the event
+         */
+        void run_sub_events(Event* event, unsigned int interactions);
+
         /**
          * @brief Construct the sensitive detectors and magnetic fields.
          */
         void construct_sensitive_detectors_and_fields();
 
+        /**
+         * @brief Create the track manager with the configured recording and pruning of the Monte Carlo truth
+         * @return Track manager for the calling thread
+         */
+        std::unique_ptr<TrackInfoManager> create_track_info_manager() const;
+
         /**
          * @brief Record statistics for the module run.
          */
         void record_module_statistics();
 
+        /**
+         * @brief Combine the configured passive materials into a region with own production cuts and kinetic energy limit
+         * @param min_kinetic_energy_world Minimum kinetic energy of tracks in the world volume
+         */
+        void construct_passive_region(double min_kinetic_energy_world);
+
+        /**
+         * @brief Get the directory of the physics table cache for the current physics configuration
+         * @param physics_list Name of the physics list
+         * @param production_cut Range cut-off threshold for the production of secondaries
+         * @return Path to the directory, named after a hash of the physics list, range cut, PAI settings and materials
+         */
+        std::filesystem::path physics_table_directory(const std::string& physics_list, double production_cut) const;
+
+        /**
+         * @brief Store the physics tables built during initialization in the cache
+         * @param physics_list Geant4 physics list which built the tables
+         * @param directory Directory of the physics table cache for the current physics configuration
+         */
+        static void store_physics_tables(G4VModularPhysicsList* physics_list, const std::filesystem::path& directory);
+
         // Configuration parameters:
         bool output_plots_{};
+        bool record_tracks_{};
         unsigned int number_of_particles_{};
+        // Mean number of interactions per event in time frame mode, zero if disabled
+        double mean_interactions_{};
+        // Maximum number of sub-events the interactions of an event are split into
+        unsigned int tasks_per_event_{};
 
         // The track manager which this module uses to assign custom track IDs and manage & create MCTracks
         static thread_local std::unique_ptr<TrackInfoManager> track_info_manager_;
@@ -113,12 +167,16 @@ namespace allpix {
         // Handling of the charge deposition in all the sensitive devices
         static thread_local std::vector<SensitiveDetectorActionG4*> sensors_;
 
+        // Whether the worker run manager of the thread has been initialized
+        static thread_local bool worker_initialized_;
+
         // Number of the last event
         std::atomic_uint64_t last_event_num_{0};
 
         // Class holding the limits for the step size
         std::unique_ptr<G4UserLimits> user_limits_;
         std::unique_ptr<G4UserLimits> user_limits_world_;
+        std::unique_ptr<G4UserLimits> user_limits_passive_;
 
         // Vector of histogram pointers for debugging plots
         std::map<std::string, Histogram<TH1D>> charge_per_event_;
@@ -12,6 +12,9 @@
 
 #include "GeneratorActionG4.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <limits>
 #include <memory>
 #include <regex>
@@ -20,6 +23,8 @@
 #include <G4IonTable.hh>
 #include <G4ParticleDefinition.hh>
 #include <G4ParticleTable.hh>
+#include <G4PrimaryParticle.hh>
+#include <G4PrimaryVertex.hh>
 #include <G4RunManager.hh>
 #include <G4UImanager.hh>
 #include <Math/Vector2D.h>
@@ -86,12 +91,20 @@ std::map<std::string, std::tuple<int, int, int, double>> GeneratorActionG4::isot
     {"cs137", std::make_tuple(55, 137, 0, 0.)},
 };
 
+std::vector<std::shared_ptr<Detector>> GeneratorActionG4::acceptance_detectors_;
+std::atomic<uint64_t> GeneratorActionG4::acceptance_generated_{0};
+std::atomic<uint64_t> GeneratorActionG4::acceptance_accepted_{0};
+
 GeneratorActionG4::GeneratorActionG4(const Configuration& config)
     : particle_source_(std::make_unique<G4GeneralParticleSource>()), config_(config) {
 
     // Set verbosity of source to off
     particle_source_->SetVerbosity(0);
 
+    if(config_.get<bool>("acceptance_filter")) {
+        acceptance_max_attempts_ = config_.get<unsigned int>("acceptance_max_attempts");
+    }
+
     // Get source specific parameters
     auto source_type = config_.get<SourceType>("source_type");
 
@@ -357,7 +370,79 @@ void GeneratorActionG4::GeneratePrimaries(G4Event* event) {
         single_source->SetParticleTime(event_time);
     }
 
-    particle_source_->GeneratePrimaryVertex(event);
+    if(acceptance_max_attempts_ == 0) {
+        particle_source_->GeneratePrimaryVertex(event);
+        return;
+    }
+
+    // Re-sample the primaries until they can reach a sensor, each event then represents all attempts
+    for(unsigned int attempt = 1;; ++attempt) {
+        G4Event trial(event->GetEventID());
+        particle_source_->GeneratePrimaryVertex(&trial);
+        acceptance_generated_++;
+
+        auto accepted = is_accepted(trial);
+        if(accepted || attempt == acceptance_max_attempts_) {
+            if(accepted) {
+                acceptance_accepted_++;
+            } else {
+                LOG(DEBUG) << "No primary reaching a sensor found in " << attempt << " attempts, keeping last attempt";
+            }
+
+            // The trial event owns its vertices, copy them into the event with the number of attempts as weight
+            for(G4int i = 0; i < trial.GetNumberOfPrimaryVertex(); ++i) {
+                auto* vertex = new G4PrimaryVertex(*trial.GetPrimaryVertex(i));
+                vertex->SetWeight(vertex->GetWeight() * attempt);
+                event->AddPrimaryVertex(vertex);
+            }
+            LOG(DEBUG) << "Generated primaries after " << attempt << " attempts of the acceptance filter";
+            return;
+        }
+    }
+}
+
+bool GeneratorActionG4::is_accepted(const G4Event& event) {
+    for(G4int i = 0; i < event.GetNumberOfPrimaryVertex(); ++i) {
+        const auto* vertex = event.GetPrimaryVertex(i);
+        auto position = static_cast<ROOT::Math::XYZPoint>(vertex->GetPosition());
+        for(const auto* primary = vertex->GetPrimary(); primary != nullptr; primary = primary->GetNext()) {
+            // The decay products of particles at rest can be emitted in any direction
+            if(primary->GetKineticEnergy() <= 0) {
+                return true;
+            }
+
+            auto direction = static_cast<ROOT::Math::XYZVector>(primary->GetMomentumDirection());
+            for(const auto& detector : acceptance_detectors_) {
+                // Intersect the straight line with the sensor box in local coordinates
+                auto model = detector->getModel();
+                auto start = detector->getLocalPosition(position);
+                auto local_direction = detector->getLocalPosition(position + direction) - start;
+                auto center = model->getSensorCenter();
+                auto half_size = model->getSensorSize() / 2.;
+
+                std::array<double, 3> origin{start.x() - center.x(), start.y() - center.y(), start.z() - center.z()};
+                std::array<double, 3> slope{local_direction.x(), local_direction.y(), local_direction.z()};
+                std::array<double, 3> half{half_size.x(), half_size.y(), half_size.z()};
+                double near = 0, far = std::numeric_limits<double>::max();
+                for(size_t axis = 0; axis < 3 && near <= far; ++axis) {
+                    if(std::fabs(slope[axis]) < std::numeric_limits<double>::epsilon()) {
+                        if(std::fabs(origin[axis]) > half[axis]) {
+                            far = -1;
+                        }
+                        continue;
+                    }
+                    auto first = (-half[axis] - origin[axis]) / slope[axis];
+                    auto second = (half[axis] - origin[axis]) / slope[axis];
+                    near = std::max(near, std::min(first, second));
+                    far = std::min(far, std::max(first, second));
+                }
+                if(near <= far) {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
 }
 
 GeneratorActionInitializationMaster::GeneratorActionInitializationMaster(const Configuration& config)
@@ -12,7 +12,11 @@
 #ifndef ALLPIX_SIMPLE_DEPOSITION_MODULE_GENERATOR_ACTION_H
 #define ALLPIX_SIMPLE_DEPOSITION_MODULE_GENERATOR_ACTION_H
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include <G4GeneralParticleSource.hh>
 #include <G4ParticleDefinition.hh>
@@ -22,6 +26,7 @@
 #include <G4VUserPrimaryGeneratorAction.hh>
 
 #include "core/config/Configuration.hpp"
+#include "core/geometry/Detector.hpp"
 
 namespace allpix {
     /**
@@ -60,7 +65,31 @@ namespace allpix {
          */
         void GeneratePrimaries(G4Event*) override;
 
+        /**
+         * @brief Set the detectors used by the acceptance filter of all generator actions
+         * @param detectors Detectors whose sensors primaries have to reach on a straight line to be accepted
+         * @warning Must be called before the generation of the first event
+         */
+        static void setAcceptanceDetectors(std::vector<std::shared_ptr<Detector>> detectors) {
+            acceptance_detectors_ = std::move(detectors);
+        }
+
+        /**
+         * @brief Get the statistics of the acceptance filter summed over all generator actions
+         * @return Pair of the number of generated primary vertices and the number of accepted primary vertices
+         */
+        static std::pair<uint64_t, uint64_t> getAcceptanceStatistics() {
+            return {acceptance_generated_.load(), acceptance_accepted_.load()};
+        }
+
     private:
+        /**
+         * @brief Check if any primary of an event can reach the sensor of any acceptance detector on a straight line
+         * @param event Event with the generated primary vertices
+         * @return True if the event is accepted
+         */
+        static bool is_accepted(const G4Event& event);
+
         std::unique_ptr<G4GeneralParticleSource> particle_source_;
 
         static std::map<std::string, std::tuple<int, int, int, double>> isotopes_;
@@ -73,6 +102,12 @@ namespace allpix {
 
         double time_{0.0};
         double time_window_{0.0};
+
+        // Acceptance filter, disabled for a maximum number of attempts of zero
+        unsigned int acceptance_max_attempts_{};
+        static std::vector<std::shared_ptr<Detector>> acceptance_detectors_;
+        static std::atomic<uint64_t> acceptance_generated_;
+        static std::atomic<uint64_t> acceptance_accepted_;
     };
 
     /**
@@ -0,0 +1,23 @@
+/**
+ * @file
+ * @brief Implements the Geant4 representation of the magnetic field of the geometry
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "MagneticFieldG4.hpp"
+
+using namespace allpix;
+
+MagneticFieldG4::MagneticFieldG4(const GeometryManager* geo_manager) : geo_manager_(geo_manager) {}
+
+void MagneticFieldG4::GetFieldValue(const G4double point[4], G4double* field) const {
+    auto b_field = geo_manager_->getMagneticField(ROOT::Math::XYZPoint(point[0], point[1], point[2]));
+    field[0] = b_field.x();
+    field[1] = b_field.y();
+    field[2] = b_field.z();
+}
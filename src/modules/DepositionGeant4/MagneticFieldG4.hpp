@@ -0,0 +1,47 @@
+/**
+ * @file
+ * @brief Defines the Geant4 representation of the magnetic field of the geometry
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef ALLPIX_DEPOSITION_MODULE_MAGNETIC_FIELD_H
+#define ALLPIX_DEPOSITION_MODULE_MAGNETIC_FIELD_H
+
+#include <G4MagneticField.hh>
+
+#include "core/geometry/GeometryManager.hpp"
+
+namespace allpix {
+    /**
+     * @brief Evaluates the magnetic field function of the geometry manager for Geant4
+     *
+     * The field is evaluated by the stepper many times per step, such that non-constant fields should be wrapped in a
+     * G4CachedMagneticField reusing the last value for nearby points. Constant fields are better represented directly by a
+     * G4UniformMagField.
+     */
+    class MagneticFieldG4 : public G4MagneticField {
+    public:
+        /**
+         * @brief Constructs the field
+         * @param geo_manager Pointer to the geometry manager holding the magnetic field function
+         */
+        explicit MagneticFieldG4(const GeometryManager* geo_manager);
+
+        /**
+         * @brief Get the magnetic field at a point
+         * @param point Global position and time of the point
+         * @param field Components of the field at the point
+         */
+        void GetFieldValue(const G4double point[4], G4double* field) const override;
+
+    private:
+        const GeometryManager* geo_manager_;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_DEPOSITION_MODULE_MAGNETIC_FIELD_H */
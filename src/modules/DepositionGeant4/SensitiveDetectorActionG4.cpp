@@ -13,6 +13,8 @@
 #include "SensitiveDetectorActionG4.hpp"
 #include "TrackInfoG4.hpp"
 
+#include <array>
+#include <cmath>
 #include <memory>
 
 #include "G4DecayTable.hh"
@@ -88,6 +90,23 @@ G4bool SensitiveDetectorActionG4::ProcessHits(G4Step* step, G4TouchableHistory*)
     }
     auto trackID = userTrackInfo->getID();
 
+    // Pruned tracks are collapsed into the MCParticle of their nearest ancestor seen in this sensor. Since Geant4 tracks
+    // secondaries only after their parent, the ancestors have been seen already. Pruned tracks without such ancestor are
+    // recorded as separate MCParticle
+    auto collapsed = false;
+    if(track_info_manager_->isPruned(trackID)) {
+        auto alias = track_alias_.find(trackID);
+        if(alias == track_alias_.end()) {
+            auto ancestor = track_info_manager_->getParentID(trackID);
+            while(ancestor != 0 && track_begin_.find(ancestor) == track_begin_.end()) {
+                ancestor = track_info_manager_->getParentID(ancestor);
+            }
+            alias = track_alias_.emplace(trackID, (ancestor == 0 ? trackID : ancestor)).first;
+        }
+        collapsed = (alias->second != trackID);
+        trackID = alias->second;
+    }
+
     // If this track originates in the sensor add parent ID. Otherwise set the ID to zero (primary particle) since it might
     // have a parent connected from a previous crossing of the sensor, i.e. backscattering from an interaction in non-sensor
     // material. While these particles are connected via MCTracks, we treat them as primaries to the sensor since they
@@ -107,8 +126,10 @@ G4bool SensitiveDetectorActionG4::ProcessHits(G4Step* step, G4TouchableHistory*)
         track_kinetic_energy_start_.emplace(trackID, track->GetKineticEnergy());
     }
 
-    // Update current end point with the current last step
-    track_end_[trackID] = detector_->getLocalPosition(static_cast<ROOT::Math::XYZPoint>(postStep->GetPosition()));
+    // Update current end point with the current last step, collapsed tracks only contribute their charge
+    if(!collapsed) {
+        track_end_[trackID] = detector_->getLocalPosition(static_cast<ROOT::Math::XYZPoint>(postStep->GetPosition()));
+    }
     track_charge_[trackID] += charge;
 
     // Add new deposit if the charge is more than zero
@@ -116,6 +137,30 @@ G4bool SensitiveDetectorActionG4::ProcessHits(G4Step* step, G4TouchableHistory*)
         return false;
     }
 
+    // Merge with the previous deposit if it belongs to the same track and lies within the same voxel and time window
+    if(merging_size_ > 0) {
+        std::array<long long, 3> voxel{static_cast<long long>(std::floor(deposit_position.x() / merging_size_)),
+                                       static_cast<long long>(std::floor(deposit_position.y() / merging_size_)),
+                                       static_cast<long long>(std::floor(deposit_position.z() / merging_size_))};
+        if(!deposit_to_id_.empty() && deposit_to_id_.back() == trackID && voxel == merging_voxel_ &&
+           std::fabs(step_time - merging_start_time_) <= merging_time_) {
+            auto previous_charge = static_cast<double>(deposit_charge_.back());
+            auto total_charge = previous_charge + static_cast<double>(charge);
+            deposit_position_.back() = ROOT::Math::XYZPoint(
+                (static_cast<ROOT::Math::XYZVector>(deposit_position_.back()) * previous_charge +
+                 static_cast<ROOT::Math::XYZVector>(deposit_position) * static_cast<double>(charge)) /
+                total_charge);
+            deposit_time_.back() = (deposit_time_.back() * previous_charge + step_time * charge) / total_charge;
+            deposit_charge_.back() += charge;
+            deposit_energy_.back() += edep;
+            LOG(TRACE) << "Merged deposit of " << charge << " charges with previous deposit of track " << trackID;
+            merged_steps_++;
+            return true;
+        }
+        merging_voxel_ = voxel;
+        merging_start_time_ = step_time;
+    }
+
     // Store relevant quantities to create charge deposits:
     deposit_position_.push_back(deposit_position);
     deposit_charge_.push_back(charge);
@@ -159,6 +204,63 @@ void SensitiveDetectorActionG4::clearEventInfo() {
 
     deposit_to_id_.clear();
     id_to_particle_.clear();
+    track_alias_.clear();
+    merged_steps_ = 0;
+}
+
+SensitiveDetectorActionG4::SubEventInfo SensitiveDetectorActionG4::takeSubEventInfo() {
+    SubEventInfo info;
+    info.deposit_position = std::move(deposit_position_);
+    info.deposit_charge = std::move(deposit_charge_);
+    info.deposit_energy = std::move(deposit_energy_);
+    info.deposit_time = std::move(deposit_time_);
+    info.deposit_to_id = std::move(deposit_to_id_);
+    info.track_begin = std::move(track_begin_);
+    info.track_end = std::move(track_end_);
+    info.track_parents = std::move(track_parents_);
+    info.track_pdg = std::move(track_pdg_);
+    info.track_time = std::move(track_time_);
+    info.track_charge = std::move(track_charge_);
+    info.track_total_energy_start = std::move(track_total_energy_start_);
+    info.track_kinetic_energy_start = std::move(track_kinetic_energy_start_);
+    info.merged_steps = merged_steps_;
+
+    // Moved-from containers are valid but unspecified, clear them for the next event
+    clearEventInfo();
+    return info;
+}
+
+/**
+ * The track ids of every sub-event start from one, they are shifted by the offset assigned by the track manager when adding
+ * the tracks of the sub-event. Primaries of the sensor keep the parent id zero.
+ */
+void SensitiveDetectorActionG4::addSubEventInfo(SubEventInfo info, int track_id_offset) {
+    auto shift = [track_id_offset](int track_id) { return (track_id == 0 ? 0 : track_id + track_id_offset); };
+    auto merge = [&shift](auto& target, auto& source) {
+        for(auto& [track_id, value] : source) {
+            target.emplace(shift(track_id), std::move(value));
+        }
+    };
+
+    deposit_position_.insert(deposit_position_.end(), info.deposit_position.begin(), info.deposit_position.end());
+    deposit_charge_.insert(deposit_charge_.end(), info.deposit_charge.begin(), info.deposit_charge.end());
+    deposit_energy_.insert(deposit_energy_.end(), info.deposit_energy.begin(), info.deposit_energy.end());
+    deposit_time_.insert(deposit_time_.end(), info.deposit_time.begin(), info.deposit_time.end());
+    for(auto track_id : info.deposit_to_id) {
+        deposit_to_id_.push_back(shift(track_id));
+    }
+
+    merge(track_begin_, info.track_begin);
+    merge(track_end_, info.track_end);
+    merge(track_pdg_, info.track_pdg);
+    merge(track_time_, info.track_time);
+    merge(track_charge_, info.track_charge);
+    merge(track_total_energy_start_, info.track_total_energy_start);
+    merge(track_kinetic_energy_start_, info.track_kinetic_energy_start);
+    for(auto& [track_id, parent_id] : info.track_parents) {
+        track_parents_.emplace(shift(track_id), shift(parent_id));
+    }
+    merged_steps_ += info.merged_steps;
 }
 
 void SensitiveDetectorActionG4::dispatchMessages(Module* module, Messenger* messenger, Event* event) {
@@ -167,10 +269,13 @@ void SensitiveDetectorActionG4::dispatchMessages(Module* module, Messenger* mess
     incident_track_position_.clear();
     incident_track_position_.reserve(track_begin_.size());
 
-    // Calculate time reference:
-    auto time_reference = std::min_element(track_time_.begin(), track_time_.end(), [](const auto& l, const auto& r) {
-                              return l.second < r.second;
-                          })->second;
+    // Calculate time reference, no particle might have reached the sensor in this event:
+    double time_reference = 0;
+    if(!track_time_.empty()) {
+        time_reference = std::min_element(track_time_.begin(), track_time_.end(), [](const auto& l, const auto& r) {
+                             return l.second < r.second;
+                         })->second;
+    }
     LOG(TRACE) << "Earliest MCParticle arrived at " << Units::display(time_reference, {"ns", "ps"}) << " global";
 
     // Create the mc particles
@@ -262,6 +367,10 @@ void SensitiveDetectorActionG4::dispatchMessages(Module* module, Messenger* mess
         }
 
         LOG(INFO) << "Deposited " << charges << " charges in sensor of detector " << detector_->getName();
+        if(merging_size_ > 0) {
+            LOG(DEBUG) << "Merged " << (merged_steps_ + deposit_position_.size()) << " steps into "
+                       << deposit_position_.size() << " deposits in sensor of detector " << detector_->getName();
+        }
 
         // Create a new charge deposit message
         auto deposit_message = std::make_shared<DepositedChargeMessage>(std::move(deposits), detector_);
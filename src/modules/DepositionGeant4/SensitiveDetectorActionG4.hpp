@@ -12,7 +12,10 @@
 #ifndef ALLPIX_SIMPLE_DEPOSITION_MODULE_SENSITIVE_DETECTOR_ACTION_H
 #define ALLPIX_SIMPLE_DEPOSITION_MODULE_SENSITIVE_DETECTOR_ACTION_H
 
+#include <array>
+#include <map>
 #include <memory>
+#include <vector>
 
 #include <G4VSensitiveDetector.hh>
 #include <G4WrapperProcess.hh>
@@ -34,6 +37,29 @@ namespace allpix {
      */
     class SensitiveDetectorActionG4 : public G4VSensitiveDetector {
     public:
+        /**
+         * @brief Track and deposit information of a sensor collected in a sub-event, i.e. a part of the interactions of an
+         * event simulated by another thread
+         */
+        struct SubEventInfo {
+            std::vector<ROOT::Math::XYZPoint> deposit_position;
+            std::vector<unsigned int> deposit_charge;
+            std::vector<double> deposit_energy;
+            std::vector<double> deposit_time;
+            std::vector<int> deposit_to_id;
+
+            std::map<int, ROOT::Math::XYZPoint> track_begin;
+            std::map<int, ROOT::Math::XYZPoint> track_end;
+            std::map<int, int> track_parents;
+            std::map<int, int> track_pdg;
+            std::map<int, double> track_time;
+            std::map<int, unsigned int> track_charge;
+            std::map<int, double> track_total_energy_start;
+            std::map<int, double> track_kinetic_energy_start;
+
+            unsigned int merged_steps{};
+        };
+
         /**
          * @brief Constructs the action handling for every sensitive detector
          * @param detector Detector this sensitive device is bound to
@@ -84,6 +110,19 @@ namespace allpix {
          */
         void clearEventInfo();
 
+        /**
+         * @brief Move the track and deposit information of the current event out of this sensor
+         * @return Information collected since the last event, the sensor is cleared for the next event
+         */
+        SubEventInfo takeSubEventInfo();
+
+        /**
+         * @brief Add the track and deposit information collected by the sensor of another thread to the current event
+         * @param info Information of the sub-event, as taken from the sensor of the same detector
+         * @param track_id_offset Offset of the track ids of the sub-event within the event, see \ref TrackInfoManager
+         */
+        void addSubEventInfo(SubEventInfo info, int track_id_offset);
+
         /**
          * @brief Get the name of the sensitive device bound to this action
          */
@@ -94,6 +133,20 @@ namespace allpix {
          */
         void seed(uint64_t random_seed) { random_generator_.seed(random_seed); }
 
+        /**
+         * @brief Enable the merging of consecutive deposits of the same track
+         * @param size Edge length of the voxels within which deposits are merged
+         * @param time Maximum time difference to the first merged deposit
+         *
+         * Consecutive deposits of the same track are merged into one deposit if they are located within the same cubic
+         * voxel of the local coordinate system and within the time window after the first merged deposit. The merged
+         * deposit carries the sum of the charge and energy, and the charge-weighted mean position and time.
+         */
+        void enableDepositMerging(double size, double time) {
+            merging_size_ = size;
+            merging_time_ = time;
+        }
+
         /**
          * @brief Process a single step of a particle passage through this sensor
          * @param step Information about the step
@@ -118,6 +171,13 @@ namespace allpix {
         double fano_factor_;
         double cutoff_time_;
 
+        // Deposit merging, disabled for a voxel size of zero
+        double merging_size_{};
+        double merging_time_{};
+        std::array<long long, 3> merging_voxel_{};
+        double merging_start_time_{};
+        unsigned int merged_steps_{};
+
         /**
          * Random number generator for e/h pair creation fluctuation
          * @note It is okay to keep a separate random number generator here because instances of this class are thread_local
@@ -160,6 +220,8 @@ namespace allpix {
         std::vector<int> deposit_to_id_;
         // Map from track id to mc particle index
         std::map<int, size_t> id_to_particle_;
+        // Map from pruned track id to the id of the track it is collapsed into
+        std::map<int, int> track_alias_;
     };
 } // namespace allpix
 
@@ -0,0 +1,42 @@
+/**
+ * @file
+ * @brief Implements the routing of steps in sensitive devices shared by several detectors
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "SensitiveDetectorRouterG4.hpp"
+
+#include "G4SDManager.hh"
+#include "G4Step.hh"
+#include "G4VTouchable.hh"
+
+using namespace allpix;
+
+SensitiveDetectorRouterG4::SensitiveDetectorRouterG4(const std::string& name) : G4VSensitiveDetector(name) {
+    // Add the router to the internal sensitive detector manager
+    G4SDManager* sd_man_g4 = G4SDManager::GetSDMpointer();
+    sd_man_g4->AddNewDetector(this);
+}
+
+void SensitiveDetectorRouterG4::addDetector(const G4VPhysicalVolume* wrapper, SensitiveDetectorActionG4* action) {
+    actions_.emplace(wrapper, action);
+}
+
+G4bool SensitiveDetectorRouterG4::ProcessHits(G4Step* step, G4TouchableHistory* history) {
+    // Walk up the volume hierarchy until the wrapper volume of one of the detectors is found
+    const auto* touchable = step->GetPreStepPoint()->GetTouchable();
+    for(G4int depth = 0; depth <= touchable->GetHistoryDepth(); ++depth) {
+        auto action = actions_.find(touchable->GetVolume(depth));
+        if(action != actions_.end()) {
+            return action->second->ProcessHits(step, history);
+        }
+    }
+
+    // Detectors without listeners for their output have no action
+    return false;
+}
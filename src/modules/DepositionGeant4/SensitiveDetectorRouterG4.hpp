@@ -0,0 +1,58 @@
+/**
+ * @file
+ * @brief Defines the routing of steps in sensitive devices shared by several detectors
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef ALLPIX_DEPOSITION_MODULE_SENSITIVE_DETECTOR_ROUTER_H
+#define ALLPIX_DEPOSITION_MODULE_SENSITIVE_DETECTOR_ROUTER_H
+
+#include <map>
+#include <string>
+
+#include <G4VPhysicalVolume.hh>
+#include <G4VSensitiveDetector.hh>
+
+#include "SensitiveDetectorActionG4.hpp"
+
+namespace allpix {
+    /**
+     * @brief Forwards the steps in a sensitive device shared by several detectors to the action of the correct detector
+     *
+     * If the geometry is built with instancing, all detectors of the same model share the logical volume of their sensor
+     * and only differ by the placement of their wrapper volume. Since Geant4 attaches sensitive detectors to logical
+     * volumes, the detector a step belongs to is resolved from the wrapper placement found in the touchable history.
+     */
+    class SensitiveDetectorRouterG4 : public G4VSensitiveDetector {
+    public:
+        /**
+         * @brief Constructs the router for a shared sensitive device
+         * @param name Unique name of the sensitive device
+         */
+        explicit SensitiveDetectorRouterG4(const std::string& name);
+
+        /**
+         * @brief Add a detector sharing the sensitive device
+         * @param wrapper Placement of the wrapper volume of the detector
+         * @param action Action handling the steps in the sensor of this detector
+         */
+        void addDetector(const G4VPhysicalVolume* wrapper, SensitiveDetectorActionG4* action);
+
+        /**
+         * @brief Forward a single step to the action of the detector the step is located in
+         * @param step Information about the step
+         * @param history Parameter not used
+         */
+        G4bool ProcessHits(G4Step* step, G4TouchableHistory* history) override;
+
+    private:
+        std::map<const G4VPhysicalVolume*, SensitiveDetectorActionG4*> actions_;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_DEPOSITION_MODULE_SENSITIVE_DETECTOR_ROUTER_H */
@@ -14,6 +14,21 @@
 
 using namespace allpix;
 
+namespace {
+    G4ThreadLocal G4Allocator<TrackInfoG4>* track_info_allocator = nullptr;
+} // namespace
+
+void* TrackInfoG4::operator new(size_t) {
+    if(track_info_allocator == nullptr) {
+        track_info_allocator = new G4Allocator<TrackInfoG4>;
+    }
+    return track_info_allocator->MallocSingle();
+}
+
+void TrackInfoG4::operator delete(void* track_info) {
+    track_info_allocator->FreeSingle(static_cast<TrackInfoG4*>(track_info));
+}
+
 TrackInfoG4::TrackInfoG4(int custom_track_id, int parent_track_id, const G4Track* const aTrack)
     : custom_track_id_(custom_track_id), parent_track_id_(parent_track_id),
       particle_id_(aTrack->GetDynamicParticle()->GetPDGcode()), start_time_(aTrack->GetGlobalTime()),
@@ -15,6 +15,7 @@
 
 #include <map>
 
+#include "G4Allocator.hh"
 #include "G4Track.hh"
 #include "G4VUserTrackInformation.hh"
 
@@ -35,6 +36,21 @@ namespace allpix {
          */
         TrackInfoG4(int custom_track_id, int parent_track_id, const G4Track* const aTrack);
 
+        /**
+         * @brief Allocate the track info from a thread-local pool instead of the heap
+         * @return Pointer to the allocated memory
+         *
+         * Track infos are created and destroyed for every track, the pool reuses their memory for all tracks of a thread.
+         * They have to be destroyed by the same thread which created them.
+         */
+        void* operator new(size_t);
+
+        /**
+         * @brief Return the memory of the track info to the thread-local pool
+         * @param track_info Pointer to the memory of the track info
+         */
+        void operator delete(void* track_info);
+
         /**
          * @brief Getter for custom id of track
          * @return The custom track id
@@ -11,52 +11,155 @@
 
 #include "TrackInfoManager.hpp"
 
+#include <stdexcept>
+#include <string>
+
 using namespace allpix;
 
-TrackInfoManager::TrackInfoManager(bool record_all) : counter_(1), record_all_(record_all) {}
+TrackInfoManager::TrackInfoManager(bool record_all,
+                                   unsigned int max_generation,
+                                   double energy_threshold,
+                                   bool record_ancestors)
+    : counter_(1), record_all_(record_all), max_generation_(max_generation), energy_threshold_(energy_threshold),
+      record_ancestors_(record_ancestors),
+      keep_pending_(record_ancestors || energy_threshold > 0 || max_generation != std::numeric_limits<unsigned int>::max()) {
+}
 
 std::unique_ptr<TrackInfoG4> TrackInfoManager::makeTrackInfo(const G4Track* const track) {
     auto custom_id = counter_++;
     auto G4ParentID = track->GetParentID();
-    auto parent_track_id = G4ParentID == 0 ? G4ParentID : g4_to_custom_id_.at(G4ParentID);
-    g4_to_custom_id_[track->GetTrackID()] = custom_id;
-    track_id_to_parent_id_[custom_id] = parent_track_id;
+    auto parent_track_id = 0;
+    if(G4ParentID != 0) {
+        auto parent_index = static_cast<size_t>(G4ParentID);
+        if(parent_index >= g4_to_custom_id_.size() || g4_to_custom_id_[parent_index] == 0) {
+            throw std::out_of_range("unknown parent track with Geant4 id " + std::to_string(G4ParentID));
+        }
+        parent_track_id = g4_to_custom_id_[parent_index];
+    }
+
+    // Geant4 ids restart for every Geant4 event, a known id is therefore overwritten like in a map
+    auto g4_index = static_cast<size_t>(track->GetTrackID());
+    if(g4_index >= g4_to_custom_id_.size()) {
+        g4_to_custom_id_.resize(g4_index + 1);
+    }
+    g4_to_custom_id_[g4_index] = custom_id;
+
+    // Custom ids are assigned consecutively starting from one
+    auto index = static_cast<size_t>(custom_id);
+    if(index >= track_id_to_parent_id_.size()) {
+        track_id_to_parent_id_.resize(index + 1);
+        track_id_to_generation_.resize(index + 1);
+        track_id_to_kept_id_.resize(index + 1);
+    }
+    track_id_to_parent_id_[index] = parent_track_id;
+
+    // Secondaries are pruned beyond the maximum generation, below the energy threshold or if their parent is pruned, such
+    // that pruned tracks never have descendants which are kept
+    auto parent_index = static_cast<size_t>(parent_track_id);
+    auto generation = (parent_track_id == 0 ? 0 : track_id_to_generation_[parent_index] + 1);
+    auto pruned = parent_track_id != 0 && (track_id_to_kept_id_[parent_index] != parent_track_id ||
+                                           generation > max_generation_ || track->GetKineticEnergy() < energy_threshold_);
+    track_id_to_generation_[index] = generation;
+    track_id_to_kept_id_[index] = (pruned ? track_id_to_kept_id_[parent_index] : custom_id);
     return std::make_unique<TrackInfoG4>(custom_id, parent_track_id, track);
 }
 
 void TrackInfoManager::setTrackInfoToBeStored(int track_id) {
-    auto element = std::find(to_store_track_ids_.begin(), to_store_track_ids_.end(), track_id);
-    // If track id is not present we add it, otherwise skip as we only need each track once
-    if(element == to_store_track_ids_.end()) {
-        to_store_track_ids_.emplace_back(track_id);
+    // Every track only needs to be flagged once, pruned tracks flag the ancestor they are collapsed into
+    auto index = static_cast<size_t>(track_id_to_kept_id_.at(static_cast<size_t>(track_id)));
+    if(index >= to_store_track_ids_.size()) {
+        to_store_track_ids_.resize(index + 1);
     }
+    to_store_track_ids_[index] = 1;
 }
 
 void TrackInfoManager::storeTrackInfo(std::unique_ptr<TrackInfoG4> the_track_info) {
     auto track_id = the_track_info->getID();
-    auto element = std::find(to_store_track_ids_.begin(), to_store_track_ids_.end(), track_id);
+    auto index = static_cast<size_t>(track_id);
+    auto to_store = (index < to_store_track_ids_.size() && to_store_track_ids_[index] != 0);
 
-    if(record_all_ || element != to_store_track_ids_.end()) {
+    if(isPruned(track_id)) {
+        LOG(DEBUG) << "Not storing pruned MCTrack with ID " << track_id;
+    } else if(record_all_ || to_store) {
         LOG(DEBUG) << "Storing MCTrack with ID " << track_id;
         stored_track_infos_.push_back(std::move(the_track_info));
+    } else if(keep_pending_) {
+        // Keep the track until the end of the event, since its descendants are only tracked after the track itself and
+        // pruned descendants flag it to be stored
+        if(index >= pending_track_infos_.size()) {
+            pending_track_infos_.resize(index + 1);
+        }
+        pending_track_infos_[index] = std::move(the_track_info);
     } else {
         LOG(DEBUG) << "Not storing MCTrack with ID " << track_id;
     }
 
-    if(element != to_store_track_ids_.end()) {
-        to_store_track_ids_.erase(element);
+    if(to_store) {
+        to_store_track_ids_[index] = 0;
     }
 }
 
+bool TrackInfoManager::isPruned(int track_id) const {
+    return track_id_to_kept_id_.at(static_cast<size_t>(track_id)) != track_id;
+}
+
+int TrackInfoManager::getParentID(int track_id) const { return track_id_to_parent_id_.at(static_cast<size_t>(track_id)); }
+
 void TrackInfoManager::resetTrackInfoManager() {
     counter_ = 1;
     stored_tracks_.clear();
     to_store_track_ids_.clear();
     g4_to_custom_id_.clear();
     track_id_to_parent_id_.clear();
+    track_id_to_generation_.clear();
+    track_id_to_kept_id_.clear();
     stored_track_infos_.clear();
+    pending_track_infos_.clear();
     stored_track_ids_.clear();
     id_to_track_.clear();
+    sub_event_tracks_.clear();
+    sub_event_track_ids_.clear();
+}
+
+TrackInfoManager::SubEventTracks TrackInfoManager::takeSubEventTracks(bool create_tracks) {
+    if(create_tracks) {
+        createMCTracks();
+    }
+
+    SubEventTracks sub_event;
+    sub_event.track_count = counter_ - 1;
+    sub_event.parent_ids = std::move(track_id_to_parent_id_);
+    sub_event.kept_ids = std::move(track_id_to_kept_id_);
+    sub_event.tracks = std::move(stored_tracks_);
+    sub_event.track_ids = std::move(stored_track_ids_);
+
+    resetTrackInfoManager();
+    return sub_event;
+}
+
+/**
+ * The ids of the sub-event are appended to the ids assigned so far, such that they remain dense. The parent relations and
+ * the pruning of the sub-event are kept, with primaries of the sub-event remaining primaries.
+ */
+int TrackInfoManager::addSubEventTracks(SubEventTracks sub_event) {
+    auto offset = counter_ - 1;
+    auto size = static_cast<size_t>(counter_ + sub_event.track_count);
+    track_id_to_parent_id_.resize(size);
+    track_id_to_generation_.resize(size);
+    track_id_to_kept_id_.resize(size);
+    for(int id = 1; id <= sub_event.track_count; ++id) {
+        auto index = static_cast<size_t>(id);
+        auto parent_id = sub_event.parent_ids[index];
+        track_id_to_parent_id_[index + static_cast<size_t>(offset)] = (parent_id == 0 ? 0 : parent_id + offset);
+        track_id_to_kept_id_[index + static_cast<size_t>(offset)] = sub_event.kept_ids[index] + offset;
+    }
+    counter_ += sub_event.track_count;
+
+    for(size_t ix = 0; ix < sub_event.tracks.size(); ++ix) {
+        sub_event_tracks_.push_back(std::move(sub_event.tracks[ix]));
+        sub_event_track_ids_.push_back(sub_event.track_ids[ix] + offset);
+    }
+    return offset;
 }
 
 void TrackInfoManager::dispatchMessage(Module* module, Messenger* messenger, Event* event) {
@@ -73,13 +176,33 @@ void TrackInfoManager::dispatchMessage(Module* module, Messenger* messenger, Eve
 }
 
 MCTrack const* TrackInfoManager::findMCTrack(int track_id) const {
-    auto it = id_to_track_.find(track_id);
-    return (it == id_to_track_.end()) ? nullptr : it->second;
+    auto index = static_cast<size_t>(track_id);
+    return (track_id < 0 || index >= id_to_track_.size()) ? nullptr : id_to_track_[index];
 }
 
 void TrackInfoManager::createMCTracks() {
+    // Add the tracks flagged to be stored after they finished, by pruned descendants
+    for(size_t id = 0; id < pending_track_infos_.size(); ++id) {
+        if(pending_track_infos_[id] != nullptr && id < to_store_track_ids_.size() && to_store_track_ids_[id] != 0) {
+            stored_track_infos_.push_back(std::move(pending_track_infos_[id]));
+        }
+    }
+
+    // Add the ancestors of all stored tracks, the loop also visits the ancestors appended to the vector
+    if(record_ancestors_) {
+        for(size_t ix = 0; ix < stored_track_infos_.size(); ++ix) {
+            auto track_index = static_cast<size_t>(stored_track_infos_[ix]->getID());
+            auto parent_index = static_cast<size_t>(track_id_to_parent_id_[track_index]);
+            if(parent_index < pending_track_infos_.size() && pending_track_infos_[parent_index] != nullptr) {
+                stored_track_infos_.push_back(std::move(pending_track_infos_[parent_index]));
+            }
+        }
+    }
+    pending_track_infos_.clear();
+
     // Reserve size so we don't move the vector around and change addresses:
-    stored_tracks_.reserve(stored_track_infos_.size());
+    stored_tracks_.reserve(stored_track_infos_.size() + sub_event_tracks_.size());
+    id_to_track_.assign(static_cast<size_t>(counter_), nullptr);
 
     for(auto& track_info : stored_track_infos_) {
         stored_tracks_.emplace_back(track_info->getStartPoint(),
@@ -96,15 +219,30 @@ void TrackInfoManager::createMCTracks() {
                                     track_info->getTotalEnergyInitial(),
                                     track_info->getTotalEnergyFinal());
 
-        id_to_track_[track_info->getID()] = &stored_tracks_.back();
+        id_to_track_[static_cast<size_t>(track_info->getID())] = &stored_tracks_.back();
         stored_track_ids_.emplace_back(track_info->getID());
     }
+    for(size_t ix = 0; ix < sub_event_tracks_.size(); ++ix) {
+        stored_tracks_.push_back(std::move(sub_event_tracks_[ix]));
+        id_to_track_[static_cast<size_t>(sub_event_track_ids_[ix])] = &stored_tracks_.back();
+        stored_track_ids_.emplace_back(sub_event_track_ids_[ix]);
+    }
+    sub_event_tracks_.clear();
+    sub_event_track_ids_.clear();
+
+    // Pruned tracks refer to the track of the ancestor they are collapsed into, which always has a lower id
+    for(size_t id = 1; id < id_to_track_.size(); ++id) {
+        auto kept_id = static_cast<size_t>(track_id_to_kept_id_[id]);
+        if(kept_id != id) {
+            id_to_track_[id] = id_to_track_[kept_id];
+        }
+    }
 }
 
 void TrackInfoManager::set_all_track_parents() {
     for(size_t ix = 0; ix < stored_track_ids_.size(); ++ix) {
         auto track_id = stored_track_ids_[ix];
-        auto parent_id = track_id_to_parent_id_[track_id];
+        auto parent_id = track_id_to_parent_id_[static_cast<size_t>(track_id)];
         stored_tracks_[ix].setParent(findMCTrack(parent_id));
     }
 }
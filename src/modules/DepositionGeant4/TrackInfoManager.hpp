@@ -13,7 +13,8 @@
 #ifndef TrackInfoManager_H
 #define TrackInfoManager_H 1
 
-#include <map>
+#include <limits>
+#include <vector>
 
 #include "G4Track.hh"
 #include "TrackInfoG4.hpp"
@@ -29,9 +30,33 @@ namespace allpix {
     class TrackInfoManager {
     public:
         /**
-         * @brief Default constructor
+         * @brief Tracks of a sub-event, i.e. a part of the interactions of an event simulated by another thread
          */
-        explicit TrackInfoManager(bool record_all);
+        struct SubEventTracks {
+            // Number of track ids assigned in the sub-event, starting from one
+            int track_count{};
+            // Custom id to custom parent id and to the id of the nearest ancestor which is not pruned
+            std::vector<int> parent_ids;
+            std::vector<int> kept_ids;
+            // Created MCTracks and their ids, only filled if the tracks are recorded
+            std::vector<MCTrack> tracks;
+            std::vector<int> track_ids;
+        };
+
+        /**
+         * @brief Constructor configuring which tracks are recorded
+         * @param record_all Record all tracks instead of only those connected to the sensors
+         * @param max_generation Maximum generation of secondaries kept, with primaries being generation zero
+         * @param energy_threshold Minimum initial kinetic energy of secondaries kept
+         * @param record_ancestors Record all ancestors of the tracks connected to the sensors
+         *
+         * Secondaries beyond the maximum generation or below the energy threshold, as well as all their descendants, are
+         * pruned: no MCTrack is created for them and they are collapsed into their nearest ancestor which is kept.
+         */
+        explicit TrackInfoManager(bool record_all,
+                                  unsigned int max_generation = std::numeric_limits<unsigned int>::max(),
+                                  double energy_threshold = 0,
+                                  bool record_ancestors = false);
 
         /**
          * @brief Factory method for TrackInfoG4 instances
@@ -59,6 +84,20 @@ namespace allpix {
          */
         void setTrackInfoToBeStored(int track_id);
 
+        /**
+         * @brief Check whether a track has been pruned from the recorded tracks
+         * @param track_id The id of the track
+         * @return True if the track is collapsed into one of its ancestors
+         */
+        bool isPruned(int track_id) const;
+
+        /**
+         * @brief Get the id of the parent of a track
+         * @param track_id The id of the track
+         * @return The id of the parent track, zero for primary tracks
+         */
+        int getParentID(int track_id) const;
+
         /**
          * @brief Reset of the TrackInfoManager instance
          *
@@ -76,6 +115,23 @@ namespace allpix {
          */
         void dispatchMessage(Module* module, Messenger* messenger, Event* event);
 
+        /**
+         * @brief Move the tracks of the current event out of this track manager, which is reset for the next event
+         * @param create_tracks Whether the MCTrack objects should be created, see \ref createMCTracks
+         * @return Tracks of the sub-event
+         *
+         * The track infos are released by the calling thread, which allocated them from its pool.
+         */
+        SubEventTracks takeSubEventTracks(bool create_tracks);
+
+        /**
+         * @brief Add the tracks of a sub-event simulated by another thread to the current event
+         * @param sub_event Tracks of the sub-event
+         * @return Offset to be added to the track ids of the sub-event
+         * @warning Must be called before \ref createMCTracks, which adds the MCTracks of the sub-events
+         */
+        int addSubEventTracks(SubEventTracks sub_event);
+
         /**
          * @brief Populate the #stored_tracks_ with MCTrack objects
          * @warning Must only be called once Geant4 finished stepping through all the G4Track objects
@@ -86,7 +142,8 @@ namespace allpix {
         /**
          * @brief Returns a pointer to the MCTrack object in the #stored_tracks_ or a nullptr if not found
          * @param track_id The id of the track for which to retrieve the pointer
-         * @return Const pointer to the MCTrack object or a nullptr if track_id is not found
+         * @return Const pointer to the MCTrack object or a nullptr if track_id is not found. For pruned tracks, the MCTrack
+         * of the ancestor they are collapsed into is returned
          * @warning Results are invalidated by any reallocation iof the internal #stored_tracks_ vector
          */
         MCTrack const* findMCTrack(int track_id) const;
@@ -105,20 +162,40 @@ namespace allpix {
         // Store configuration whether all tracks or only those connected to sensor should be stored
         bool record_all_{};
 
-        // Geant4 id to custom id translation
-        std::map<int, int> g4_to_custom_id_{};
+        // Pruning configuration of the secondaries and whether the ancestors of stored tracks should be stored as well
+        unsigned int max_generation_{};
+        double energy_threshold_{};
+        bool record_ancestors_{};
+        // Whether tracks not registered to be stored are kept until the end of the event, see #pending_track_infos_
+        bool keep_pending_{};
+
+        // Track ids are dense within an event, all lookups by track id are therefore stored in vectors indexed by the id.
+        // The vectors are cleared but keep their capacity between events, reserving the size of the previous events
+
+        // Geant4 id to custom id translation, zero for unknown ids
+        std::vector<int> g4_to_custom_id_;
         // Custom id to custom parent id tracking
-        std::map<int, int> track_id_to_parent_id_{};
-        // List of track ids to be stored if they are provided via #storeTrackInfo
-        std::vector<int> to_store_track_ids_;
+        std::vector<int> track_id_to_parent_id_;
+        // Custom id to generation of the track, zero for primaries
+        std::vector<unsigned int> track_id_to_generation_;
+        // Custom id to the id of the nearest ancestor which is not pruned, the track id itself if it is not pruned
+        std::vector<int> track_id_to_kept_id_;
+        // Flags of the track ids to be stored if they are provided via #storeTrackInfo
+        std::vector<char> to_store_track_ids_;
         // The TrackInfoG4 instances which are handed over to this track manager
         std::vector<std::unique_ptr<TrackInfoG4>> stored_track_infos_;
+        // The TrackInfoG4 instances not registered to be stored, indexed by id and kept until the end of the event if the
+        // ancestors of stored tracks are recorded or tracks are pruned
+        std::vector<std::unique_ptr<TrackInfoG4>> pending_track_infos_;
+        // The MCTracks of sub-events simulated by other threads with their custom ids, added by #createMCTracks
+        std::vector<MCTrack> sub_event_tracks_;
+        std::vector<int> sub_event_track_ids_;
         // The MCTrack vector which is dispatched via #dispatchMessage
         std::vector<MCTrack> stored_tracks_;
         // Ids ins same order as tracks stored in #stored_tracks_
         std::vector<int> stored_track_ids_;
-        // Id to index in #stored_tracks_ for easier handling
-        std::map<int, MCTrack const*> id_to_track_;
+        // Id to pointer into #stored_tracks_ for easier handling, nullptr for tracks not stored
+        std::vector<MCTrack const*> id_to_track_;
     };
 } // namespace allpix
 #endif /* TrackInfoManager_H */
@@ -21,6 +21,7 @@
 
 // Reader modules:
 #include "PrimariesReaderGenie.hpp"
+#include "PrimariesReaderPrefetch.hpp"
 
 #if ALLPIX_GENERATOR_HEPMC
 #include "PrimariesReaderHepMC.hpp"
@@ -40,6 +41,7 @@ DepositionGeneratorModule::DepositionGeneratorModule(Configuration& config,
     waive_sequence_requirement(false);
 
     file_model_ = config_.get<PrimariesReader::FileModel>("model");
+    config_.setDefault<size_t>("prefetch_events", 0);
 
     // Force source type and position:
     config_.set("source_type", "generator");
@@ -55,11 +57,12 @@ DepositionGeneratorModule::DepositionGeneratorModule(Configuration& config,
 void DepositionGeneratorModule::initialize() {
 
     // Generate file reader instance of appropriate type
+    std::unique_ptr<PrimariesReader> reader;
     if(file_model_ == PrimariesReader::FileModel::GENIE) {
-        reader_ = std::make_shared<PrimariesReaderGenie>(config_);
+        reader = std::make_unique<PrimariesReaderGenie>(config_);
     } else if(file_model_ >= PrimariesReader::FileModel::HEPMC) {
 #if ALLPIX_GENERATOR_HEPMC
-        reader_ = std::make_shared<PrimariesReaderHepMC>(config_);
+        reader = std::make_unique<PrimariesReaderHepMC>(config_);
 #else
         throw InvalidValueError(config_, "model", "Framework has been built without support for HepMC data file model");
 #endif
@@ -67,6 +70,15 @@ void DepositionGeneratorModule::initialize() {
         throw InvalidValueError(config_, "model", "Unsupported data file model");
     }
 
+    // Read upcoming events in the background if requested
+    auto prefetch_events = config_.get<size_t>("prefetch_events");
+    if(prefetch_events > 0) {
+        LOG(DEBUG) << "Prefetching up to " << prefetch_events << " events from the data file";
+        reader_ = std::make_shared<PrimariesReaderPrefetch>(std::move(reader), prefetch_events);
+    } else {
+        reader_ = std::move(reader);
+    }
+
     // Call upstream initialization method
     DepositionGeant4Module::initialize();
 }
@@ -24,6 +24,7 @@ namespace allpix {
      */
     class PrimariesReader {
         friend class DepositionGeneratorModule;
+        friend class PrimariesReaderPrefetch;
 
     public:
         /**
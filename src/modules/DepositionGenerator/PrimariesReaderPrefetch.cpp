@@ -0,0 +1,101 @@
+/**
+ * @file
+ * @brief Implements the reader prefetching the primary particles of upcoming events in a background thread
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "PrimariesReaderPrefetch.hpp"
+
+#include <algorithm>
+#include <string>
+
+#include "core/module/exceptions.h"
+#include "core/utils/log.h"
+
+using namespace allpix;
+
+PrimariesReaderPrefetch::PrimariesReaderPrefetch(std::unique_ptr<PrimariesReader> reader, size_t capacity)
+    : reader_(std::move(reader)), capacity_(std::max<size_t>(1, capacity)) {}
+
+PrimariesReaderPrefetch::~PrimariesReaderPrefetch() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    condition_.notify_all();
+    if(thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+std::vector<PrimariesReader::Particle> PrimariesReaderPrefetch::getParticles() {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    // Start reading in the background with the first requested event
+    if(!thread_.joinable()) {
+        LOG(DEBUG) << "Starting to prefetch up to " << capacity_ << " events from event " << eventNum();
+        thread_ = std::thread(&PrimariesReaderPrefetch::prefetch, this, eventNum());
+    }
+
+    // Wait for the requested event, dropping all earlier events which have not been requested
+    while(true) {
+        while(!buffer_.empty() && buffer_.front().event_num < eventNum()) {
+            buffer_.pop_front();
+            condition_.notify_all();
+        }
+        if(!buffer_.empty() || exception_) {
+            break;
+        }
+        condition_.wait(lock);
+    }
+
+    // All events have been read before the exception of the reader was thrown
+    if(buffer_.empty()) {
+        std::rethrow_exception(exception_);
+    }
+    if(buffer_.front().event_num != eventNum()) {
+        throw ModuleError("Primary particles of event " + std::to_string(eventNum()) +
+                          " requested after reading of subsequent events");
+    }
+
+    auto particles = std::move(buffer_.front().particles);
+    buffer_.pop_front();
+    lock.unlock();
+    condition_.notify_all();
+    return particles;
+}
+
+void PrimariesReaderPrefetch::prefetch(uint64_t first_event) {
+    for(auto event_num = first_event;; ++event_num) {
+        // Wait for space in the buffer
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            condition_.wait(lock, [this]() { return stop_ || buffer_.size() < capacity_; });
+            if(stop_) {
+                return;
+            }
+        }
+
+        // Read the event without holding the lock
+        reader_->set_event_num(event_num);
+        try {
+            auto particles = reader_->getParticles();
+            std::lock_guard<std::mutex> lock(mutex_);
+            buffer_.push_back({event_num, std::move(particles)});
+        } catch(...) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            exception_ = std::current_exception();
+        }
+        condition_.notify_all();
+
+        // Events after an exception of the reader, such as the end of the file, are never read
+        if(exception_) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,90 @@
+/**
+ * @file
+ * @brief Defines a reader prefetching the primary particles of upcoming events in a background thread
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef ALLPIX_PRIMARIES_DEPOSITION_MODULE_READER_PREFETCH_H
+#define ALLPIX_PRIMARIES_DEPOSITION_MODULE_READER_PREFETCH_H
+
+#include "PrimariesReader.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace allpix {
+    /**
+     * @brief Reads the particles of upcoming events with another reader in a background thread
+     *
+     * The wrapped reader is called for consecutive event numbers, starting with the event number of the first request, and
+     * the particles are stored in a bounded buffer keyed by the event number. Requests wait until the particles of their
+     * event are available, and the background thread pauses while the buffer is full. Exceptions thrown by the wrapped
+     * reader, such as the end of the input file, are rethrown for the event at which they occurred and all later events.
+     */
+    class PrimariesReaderPrefetch : public PrimariesReader {
+    public:
+        /**
+         * Constructor taking ownership of the wrapped reader
+         * @param reader    Reader of the file model to read the particles with
+         * @param capacity  Maximum number of prefetched events in the buffer
+         */
+        PrimariesReaderPrefetch(std::unique_ptr<PrimariesReader> reader, size_t capacity);
+
+        /**
+         * Destructor stopping and joining the background thread
+         */
+        ~PrimariesReaderPrefetch() override;
+
+        /// @{
+        /**
+         * @brief Copying and moving is not allowed due to the background thread
+         */
+        PrimariesReaderPrefetch(const PrimariesReaderPrefetch&) = delete;
+        PrimariesReaderPrefetch& operator=(const PrimariesReaderPrefetch&) = delete;
+        PrimariesReaderPrefetch(PrimariesReaderPrefetch&&) = delete;
+        PrimariesReaderPrefetch& operator=(PrimariesReaderPrefetch&&) = delete;
+        /// @}
+
+        /**
+         * Overwritten method to obtain the prefetched primary particles for the current event. This method needs to be
+         * called sequentially for increasing event numbers.
+         * @return Vector of primary particles
+         */
+        std::vector<Particle> getParticles() override;
+
+    private:
+        /**
+         * @brief Loop of the background thread reading the events starting from the given event number
+         */
+        void prefetch(uint64_t first_event);
+
+        // Particles of a prefetched event
+        struct Entry {
+            uint64_t event_num;
+            std::vector<Particle> particles;
+        };
+
+        std::unique_ptr<PrimariesReader> reader_;
+        size_t capacity_;
+
+        std::mutex mutex_;
+        std::condition_variable condition_;
+        std::deque<Entry> buffer_;
+        bool stop_{false};
+        // Exception thrown by the wrapped reader, after which no further events are read
+        std::exception_ptr exception_;
+        std::thread thread_;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_PRIMARIES_DEPOSITION_MODULE_READER_PREFETCH_H */
@@ -25,14 +25,44 @@
 #include <filesystem>
 #include <fstream>
 #include <iterator>
+#include <tuple>
 
 using namespace allpix;
 
+namespace {
+    // Generate two unit vectors, orthogonal to the given direction
+    // Adapted from TVector3::Orthogonal()
+    std::pair<ROOT::Math::XYZVector, ROOT::Math::XYZVector> orthogonal_pair(const ROOT::Math::XYZVector& v) {
+        // Additional convenience variables for components' absolute values
+        double abs_x = v.X() < 0.0 ? -v.X() : v.X();
+        double abs_y = v.Y() < 0.0 ? -v.Y() : v.Y();
+        double abs_z = v.Z() < 0.0 ? -v.Z() : v.Z();
+
+        ROOT::Math::XYZVector v1, v2;
+
+        if(abs_x < abs_y) {
+            v1 = (abs_x < abs_z ? ROOT::Math::XYZVector(0, v.Z(), -v.Y()) : ROOT::Math::XYZVector(v.Y(), -v.X(), 0));
+        } else {
+            v1 = (abs_y < abs_z ? ROOT::Math::XYZVector(-v.Z(), 0, v.X()) : ROOT::Math::XYZVector(v.Y(), -v.X(), 0));
+        }
+
+        v2 = v.Cross(v1);
+        return std::make_pair(v1.Unit(), v2.Unit());
+    }
+
+    // Number of photons sampled and tracked together
+    constexpr size_t photon_block_size = 1024;
+} // namespace
+
 DepositionLaserModule::DepositionLaserModule(Configuration& config, Messenger* messenger, GeometryManager* geo_manager)
     : Module(config), geo_manager_(geo_manager), messenger_(messenger) {
 
     allow_multithreading();
 
+    // Declare the messages dispatched by this module
+    declare_output<MCParticleMessage>();
+    declare_output<DepositedChargeMessage>();
+
     //
     // Read beam parameters from config
     //
@@ -42,6 +72,7 @@ DepositionLaserModule::DepositionLaserModule(Configuration& config, Messenger* m
 
     // Make beam_direction a unity vector, so t-values produced by clipping algorithm are in actual length units
     beam_direction_ = config_.get<ROOT::Math::XYZVector>("beam_direction").Unit();
+    beam_orthogonal_ = orthogonal_pair(beam_direction_);
     LOG(DEBUG) << "Beam direction: " << beam_direction_;
 
     beam_geometry_ = config_.get<BeamGeometry>("beam_geometry");
@@ -87,6 +118,34 @@ DepositionLaserModule::DepositionLaserModule(Configuration& config, Messenger* m
         LOG(DEBUG) << "Photons will be generated as " << number_of_photons_ << " groups of " << group_photons_;
     }
 
+    config_.setDefault<size_t>("tasks_per_event", 1);
+    tasks_per_event_ = std::max<size_t>(1, config_.get<size_t>("tasks_per_event"));
+
+    config_.setDefault<DepositionMode>("deposition_mode", DepositionMode::PHOTONS);
+    deposition_mode_ = config_.get<DepositionMode>("deposition_mode");
+    if(deposition_mode_ == DepositionMode::ABSORPTION_PROFILE) {
+        if(beam_geometry_ != BeamGeometry::CYLINDRICAL) {
+            throw InvalidCombinationError(config_,
+                                          {"deposition_mode", "beam_geometry"},
+                                          "Absorption profile deposition is only supported for a cylindrical beam");
+        }
+        if(beam_waist_ <= 0) {
+            throw InvalidValueError(config_, "beam_waist", "Beam waist should be nonzero for absorption profile deposition");
+        }
+        config_.setDefault<size_t>("profile_cells", 20);
+        config_.setDefault<size_t>("profile_depth_steps", 50);
+        profile_cells_ = config_.get<size_t>("profile_cells");
+        profile_depth_steps_ = config_.get<size_t>("profile_depth_steps");
+        if(profile_cells_ == 0) {
+            throw InvalidValueError(config_, "profile_cells", "Number of cells should be a nonzero value");
+        }
+        if(profile_depth_steps_ == 0) {
+            throw InvalidValueError(config_, "profile_depth_steps", "Number of depth steps should be a nonzero value");
+        }
+        LOG(DEBUG) << "Depositing absorption profile on " << profile_cells_ << "x" << profile_cells_ << " cells with "
+                   << profile_depth_steps_ << " depth steps";
+    }
+
     config_.setDefault<double>("pulse_duration", 0.5);
     pulse_duration_ = config_.get<double>("pulse_duration");
     LOG(DEBUG) << "Pulse duration: " << Units::display(pulse_duration_, "ns");
@@ -200,13 +259,23 @@ void DepositionLaserModule::initialize() {
             LOG(WARNING) << "Detector " << detector->getName() << " has unsupported material and will be ignored";
         }
     }
-    // Check for incompatible passive objects, warn user if there are any
+    // Check for incompatible passive objects, warn user if there are any, and store the transformations of all boxes
     auto passive_configs = geo_manager_->getPassiveElements();
     for(const auto& item : passive_configs) {
         auto shape = item.get<std::string>("type");
         if(shape != "box") {
             LOG(WARNING) << item.getName() << " passive object has unsupported type (" << shape << ") and will be ignored";
+            continue;
         }
+
+        auto [passive_position, passive_orientation] = geo_manager_->getPassiveElementOrientation(item.getName());
+        ROOT::Math::Rotation3D rotation_center(passive_orientation);
+        ROOT::Math::Translation3D translation_center(static_cast<ROOT::Math::XYZVector>(passive_position));
+        ROOT::Math::Transform3D transform_center(rotation_center, translation_center);
+        passive_boxes_.push_back({item.getName(),
+                                  transform_center.Inverse(),
+                                  rotation_center.Inverse(),
+                                  item.get<ROOT::Math::XYZVector>("size")});
     }
 
     // Create Histograms
@@ -273,6 +342,14 @@ void DepositionLaserModule::run(Event* event) {
     std::map<std::shared_ptr<Detector>, std::vector<MCParticle>> mc_particles;
     std::map<std::shared_ptr<Detector>, std::vector<DepositedCharge>> deposited_charges;
 
+    if(deposition_mode_ == DepositionMode::ABSORPTION_PROFILE) {
+        LOG(INFO) << "Event " << event->number << ": depositing absorption profile of "
+                  << number_of_photons_ * group_photons_ << " photons";
+        deposit_absorption_profile(mc_particles, deposited_charges);
+        dispatch_deposits(event, mc_particles, deposited_charges);
+        return;
+    }
+
     // Lambda generator to yield pulse shape
     auto yield_starting_time = [&]() {
         int cut_sigmas = 4;
@@ -298,41 +375,41 @@ void DepositionLaserModule::run(Event* event) {
     // To correctly offset local time for each detector
     std::map<std::shared_ptr<Detector>, double> local_time_offsets;
 
+    // Generate and track all photons, storing the hit of every photon
+    LOG(INFO) << "Event " << event->number << ": tracking " << number_of_photons_ << " photons";
+    std::vector<std::optional<PhotonHit>> photon_hits(number_of_photons_);
+    auto num_tasks = std::min(tasks_per_event_, number_of_photons_);
+    if(num_tasks > 1) {
+        // Split the photons into contiguous chunks which are tracked independently with their own random stream
+        auto chunk_size = (number_of_photons_ + num_tasks - 1) / num_tasks;
+        event->parallelFor(num_tasks, [&](size_t task, RandomNumberGenerator& random_generator) {
+            auto first = std::min(number_of_photons_, task * chunk_size);
+            track_photons(first, std::min(number_of_photons_, first + chunk_size), random_generator, photon_hits);
+        });
+    } else {
+        track_photons(0, number_of_photons_, event->getRandomEngine(), photon_hits);
+    }
+
     // Loop over photons in a single laser pulse
     // In time order
     for(size_t i_photon = 0; i_photon < number_of_photons_; ++i_photon) {
 
-        LOG_PROGRESS(INFO, "photon_counter")
-            << "Event " << event->number << ": photon " << i_photon + 1 << " of " << number_of_photons_;
+        // If this photon did not hit any of the detectors, skip this iteration
+        if(!photon_hits[i_photon]) {
+            continue;
+        }
 
-        // Starting point and direction for this exact photon
-        auto [starting_point, photon_direction] = generate_photon_geometry(event);
+        PhotonHit hit = photon_hits[i_photon].value();
 
         // Get starting time in the pulse
         double starting_time = starting_times[i_photon];
         LOG(DEBUG) << "    Starting timestamp: " << Units::display(starting_time, "ns");
 
-        // Generate penetration depth
-        double penetration_depth =
-            allpix::exponential_distribution<double>(1 / absorption_length_)(event->getRandomEngine());
-        LOG(DEBUG) << "    Penetration depth: " << Units::display(penetration_depth, "um");
-
-        // Perform tracking
-        std::optional<PhotonHit> hit_opt = track(starting_point, photon_direction, penetration_depth);
-
-        // If this photon did not hit any of the detectors, skip this iteration
-        if(!hit_opt) {
-            continue;
-        }
-
-        PhotonHit hit = hit_opt.value();
-
         // If this was the first hit in this detector in this event,
         // remember entry timestamp as local t=0 for this detector.
         // It is assumed that photon that is created earlier also hits earlier
-        if(local_time_offsets.count(hit.detector) == 0) {
-            local_time_offsets[hit.detector] = starting_time + hit.time_to_entry;
-        }
+        auto local_time_offset =
+            local_time_offsets.try_emplace(hit.detector, starting_time + hit.time_to_entry).first->second;
 
         // Create and store corresponding MCParticle and DepositedCharge
         auto entry_local = hit.detector->getLocalPosition(hit.entry_global);
@@ -340,8 +417,8 @@ void DepositionLaserModule::run(Event* event) {
 
         double time_entry_global = starting_time + hit.time_to_entry;
         double time_hit_global = starting_time + hit.time_to_hit;
-        double time_entry_local = time_entry_global - local_time_offsets[hit.detector];
-        double time_hit_local = time_hit_global - local_time_offsets[hit.detector];
+        double time_entry_local = time_entry_global - local_time_offset;
+        double time_hit_local = time_hit_global - local_time_offset;
 
         LOG(DEBUG) << "    Hit in " << hit.detector->getName();
         LOG(DEBUG) << "        global: " << Units::display(hit.hit_global, {"mm"}) << Units::display(time_hit_global, "ns");
@@ -351,46 +428,40 @@ void DepositionLaserModule::run(Event* event) {
             h_deposited_charge_shapes_[hit.detector]->Fill(hit_local.X(), hit_local.Y(), hit_local.Z());
         }
 
-        // If that is a first hit in this detector, create map entries
-        if(mc_particles.count(hit.detector) == 0) {
-            mc_particles[hit.detector] = std::vector<MCParticle>();
-        }
-        if(deposited_charges.count(hit.detector) == 0) {
-            deposited_charges[hit.detector] = std::vector<DepositedCharge>();
-        }
+        // Get the containers of this detector, created with the first hit in it
+        auto& detector_particles = mc_particles[hit.detector];
+        auto& detector_charges = deposited_charges[hit.detector];
 
         // Construct all necessary objects in-place
         // allpix::MCParticle
-        mc_particles[hit.detector].emplace_back(entry_local,
-                                                hit.entry_global,
-                                                hit_local,
-                                                hit.hit_global,
-                                                22, // gamma
-                                                time_entry_local,
-                                                time_entry_global);
+        detector_particles.emplace_back(entry_local,
+                                        hit.entry_global,
+                                        hit_local,
+                                        hit.hit_global,
+                                        22, // gamma
+                                        time_entry_local,
+                                        time_entry_global);
         // Count electrons and holes:
-        mc_particles[hit.detector].back().setTotalDepositedCharge(2);
+        detector_particles.back().setTotalDepositedCharge(2);
 
         // allpix::DepositedCharge for electron
-        deposited_charges[hit.detector].emplace_back(hit_local,
-                                                     hit.hit_global,
-                                                     CarrierType::ELECTRON,
-                                                     group_photons_, // value
-                                                     time_hit_local,
-                                                     time_hit_global);
+        detector_charges.emplace_back(hit_local,
+                                      hit.hit_global,
+                                      CarrierType::ELECTRON,
+                                      group_photons_, // value
+                                      time_hit_local,
+                                      time_hit_global);
 
         // allpix::DepositedCharge for hole
-        deposited_charges[hit.detector].emplace_back(hit_local,
-                                                     hit.hit_global,
-                                                     CarrierType::HOLE,
-                                                     group_photons_, // value
-                                                     time_hit_local,
-                                                     time_hit_global);
+        detector_charges.emplace_back(hit_local,
+                                      hit.hit_global,
+                                      CarrierType::HOLE,
+                                      group_photons_, // value
+                                      time_hit_local,
+                                      time_hit_global);
 
     } // loop over photons
 
-    LOG(INFO) << "Registered hits in " << mc_particles.size() << " detectors";
-
     // After all the containers are filled, assign MCParticle links in DepositedCharges
 
     for(const auto& [detector, data] : mc_particles) {
@@ -400,6 +471,15 @@ void DepositionLaserModule::run(Event* event) {
         }
     }
 
+    dispatch_deposits(event, mc_particles, deposited_charges);
+}
+
+void DepositionLaserModule::dispatch_deposits(
+    Event* event,
+    std::map<std::shared_ptr<Detector>, std::vector<MCParticle>>& mc_particles,
+    std::map<std::shared_ptr<Detector>, std::vector<DepositedCharge>>& deposited_charges) {
+    LOG(INFO) << "Registered hits in " << mc_particles.size() << " detectors";
+
     // Dispatch messages
     for(auto& [detector, data] : mc_particles) {
         LOG(INFO) << "    " << detector->getName() << ": " << data.size() << " hits";
@@ -426,40 +506,155 @@ void DepositionLaserModule::finalize() {
     }
 }
 
-std::pair<ROOT::Math::XYZPoint, ROOT::Math::XYZVector> DepositionLaserModule::generate_photon_geometry(Event* event) {
-    // Lambda to generate two unit vectors, orthogonal to beam direction
-    // Adapted from TVector3::Orthogonal()
-    auto orthogonal_pair = [](const ROOT::Math::XYZVector& v) {
-        // Additional convenience variables for components' absolute values
-        double abs_x = v.X() < 0.0 ? -v.X() : v.X();
-        double abs_y = v.Y() < 0.0 ? -v.Y() : v.Y();
-        double abs_z = v.Z() < 0.0 ? -v.Z() : v.Z();
-
-        ROOT::Math::XYZVector v1, v2;
+void DepositionLaserModule::track_photons(size_t first,
+                                          size_t last,
+                                          RandomNumberGenerator& random_generator,
+                                          std::vector<std::optional<PhotonHit>>& photon_hits) {
+    std::vector<ROOT::Math::XYZPoint> starting_points(photon_block_size);
+    std::vector<ROOT::Math::XYZVector> photon_directions(photon_block_size);
+    std::vector<double> penetration_depths(photon_block_size);
+    allpix::exponential_distribution<double> penetration(1 / absorption_length_);
+
+    for(size_t block_first = first; block_first < last; block_first += photon_block_size) {
+        auto block_size = std::min(photon_block_size, last - block_first);
+
+        // Starting points, directions and penetration depths of all photons of the block
+        for(size_t i = 0; i < block_size; ++i) {
+            std::tie(starting_points[i], photon_directions[i]) = generate_photon_geometry(random_generator);
+            penetration_depths[i] = penetration(random_generator);
+            LOG(DEBUG) << "    Penetration depth: " << Units::display(penetration_depths[i], "um");
+        }
 
-        if(abs_x < abs_y) {
-            v1 = (abs_x < abs_z ? ROOT::Math::XYZVector(0, v.Z(), -v.Y()) : ROOT::Math::XYZVector(v.Y(), -v.X(), 0));
-        } else {
-            v1 = (abs_y < abs_z ? ROOT::Math::XYZVector(-v.Z(), 0, v.X()) : ROOT::Math::XYZVector(v.Y(), -v.X(), 0));
+        // Perform tracking
+        for(size_t i = 0; i < block_size; ++i) {
+            photon_hits[block_first + i] = track(starting_points[i], photon_directions[i], penetration_depths[i]);
         }
+    }
+}
 
-        v2 = v.Cross(v1);
-        return std::make_pair(v1.Unit(), v2.Unit());
+void DepositionLaserModule::deposit_absorption_profile(
+    std::map<std::shared_ptr<Detector>, std::vector<MCParticle>>& mc_particles,
+    std::map<std::shared_ptr<Detector>, std::vector<DepositedCharge>>& deposited_charges) {
+    double c = TMath::C() * 100; // speed of light in mm/ns
+    const auto& [v1, v2] = beam_orthogonal_;
+
+    // Beam waist is equal to 2*sigma, the grid covers the profile up to 4 sigma from the beam axis
+    double sigma = beam_waist_ / 2;
+    double cell_size = 8 * sigma / static_cast<double>(profile_cells_);
+    auto cell_low_edge = [&](size_t cell) {
+        return (static_cast<double>(cell) - static_cast<double>(profile_cells_) / 2) * cell_size;
     };
+    auto profile_fraction = [&](size_t cell) {
+        auto low = cell_low_edge(cell);
+        return 0.5 * (std::erf((low + cell_size) / (sigma * M_SQRT2)) - std::erf(low / (sigma * M_SQRT2)));
+    };
+
+    // The charges are deposited at the center of the pulse, which is positioned at 4 standard deviations
+    double pulse_center = 4 * pulse_duration_;
+    auto total_photons = static_cast<double>(number_of_photons_ * group_photons_);
+
+    // Trace the center of every cell of the beam profile
+    std::vector<std::pair<PhotonPath, double>> paths;
+    std::map<std::shared_ptr<Detector>, double> local_time_offsets;
+    for(size_t i = 0; i < profile_cells_; ++i) {
+        for(size_t j = 0; j < profile_cells_; ++j) {
+            auto photons = total_photons * profile_fraction(i) * profile_fraction(j);
+            auto position =
+                source_position_ + v1 * (cell_low_edge(i) + cell_size / 2) + v2 * (cell_low_edge(j) + cell_size / 2);
+            auto path = trace(position, beam_direction_);
+            if(!path) {
+                continue;
+            }
+
+            // Local t=0 of every detector is the moment the pulse center enters it first
+            auto time_entry_global = pulse_center + path->time_to_entry;
+            auto [offset, inserted] = local_time_offsets.try_emplace(path->detector, time_entry_global);
+            if(!inserted) {
+                offset->second = std::min(offset->second, time_entry_global);
+            }
+            paths.emplace_back(std::move(path.value()), photons);
+        }
+    }
+
+    // Deposit the absorbed fraction of the photons of every cell in steps along the refracted ray
+    std::map<std::shared_ptr<Detector>, std::vector<size_t>> particle_indices;
+    std::vector<unsigned int> step_charges(profile_depth_steps_);
+    for(const auto& [path, photons] : paths) {
+        auto step = path.crossing_distance / static_cast<double>(profile_depth_steps_);
+        unsigned int cell_charge = 0;
+        for(size_t k = 0; k < profile_depth_steps_; ++k) {
+            auto absorbed = std::exp(-static_cast<double>(k) * step / absorption_length_) *
+                            -std::expm1(-step / absorption_length_);
+            step_charges[k] = static_cast<unsigned int>(std::lround(photons * absorbed));
+            cell_charge += step_charges[k];
+        }
+        if(cell_charge == 0) {
+            continue;
+        }
 
+        // One particle for the photons of the cell, linked to all charges it deposited
+        auto local_time_offset = local_time_offsets[path.detector];
+        auto& detector_particles = mc_particles[path.detector];
+        auto& detector_charges = deposited_charges[path.detector];
+        auto& detector_indices = particle_indices[path.detector];
+
+        auto exit_global = path.entry_global + path.direction * path.crossing_distance;
+        detector_particles.emplace_back(path.detector->getLocalPosition(path.entry_global),
+                                        path.entry_global,
+                                        path.detector->getLocalPosition(exit_global),
+                                        exit_global,
+                                        22, // gamma
+                                        pulse_center + path.time_to_entry - local_time_offset,
+                                        pulse_center + path.time_to_entry);
+        detector_particles.back().setTotalDepositedCharge(2 * cell_charge);
+
+        for(size_t k = 0; k < profile_depth_steps_; ++k) {
+            if(step_charges[k] == 0) {
+                continue;
+            }
+
+            auto depth = (static_cast<double>(k) + 0.5) * step;
+            auto deposit_global = path.entry_global + path.direction * depth;
+            auto deposit_local = path.detector->getLocalPosition(deposit_global);
+            double time_global = pulse_center + path.time_to_entry + depth / c * refractive_index_;
+            double time_local = time_global - local_time_offset;
+
+            if(output_plots_) {
+                h_deposited_charge_shapes_[path.detector]->Fill(
+                    deposit_local.X(), deposit_local.Y(), deposit_local.Z(), step_charges[k]);
+            }
+
+            for(auto type : {CarrierType::ELECTRON, CarrierType::HOLE}) {
+                detector_charges.emplace_back(deposit_local, deposit_global, type, step_charges[k], time_local, time_global);
+                detector_indices.push_back(detector_particles.size() - 1);
+            }
+        }
+    }
+
+    // After all the containers are filled, assign MCParticle links in DepositedCharges
+    for(auto& [detector, charges] : deposited_charges) {
+        const auto& indices = particle_indices[detector];
+        for(size_t i = 0; i < charges.size(); ++i) {
+            charges[i].setMCParticle(&mc_particles[detector][indices[i]]);
+        }
+    }
+}
+
+std::pair<ROOT::Math::XYZPoint, ROOT::Math::XYZVector>
+DepositionLaserModule::generate_photon_geometry(RandomNumberGenerator& random_generator) {
     // Lambda to generate a smearing vector
     auto beam_pos_smearing = [&](auto size) {
-        auto [v1, v2] = orthogonal_pair(beam_direction_);
+        const auto& [v1, v2] = beam_orthogonal_;
 
         // Beam waist is equal to 2*sigma
-        double dx = allpix::normal_distribution<double>(0, size / 2.)(event->getRandomEngine());
-        double dy = allpix::normal_distribution<double>(0, size / 2.)(event->getRandomEngine());
+        double dx = allpix::normal_distribution<double>(0, size / 2.)(random_generator);
+        double dy = allpix::normal_distribution<double>(0, size / 2.)(random_generator);
         return v1 * dx + v2 * dy;
     };
 
     // Lambda to get scalar orthogonal components w.r.t. beam_direction
     auto orthogonal_components = [&](const ROOT::Math::XYZVector& v) {
-        auto [v1, v2] = orthogonal_pair(beam_direction_);
+        const auto& [v1, v2] = beam_orthogonal_;
         return std::make_pair(v.Dot(v1), v.Dot(v2));
     };
 
@@ -474,13 +669,13 @@ std::pair<ROOT::Math::XYZPoint, ROOT::Math::XYZVector> DepositionLaserModule::ge
         auto focal_position = source_position_ + beam_direction_ * focal_distance_ + beam_pos_smearing(beam_waist_);
 
         // Generate angles
-        double phi = allpix::uniform_real_distribution<double>(0, 2 * TMath::Pi())(event->getRandomEngine());
+        double phi = allpix::uniform_real_distribution<double>(0, 2 * TMath::Pi())(random_generator);
         double cos_theta =
-            allpix::uniform_real_distribution<double>(cos(beam_convergence_angle_), 1)(event->getRandomEngine());
+            allpix::uniform_real_distribution<double>(cos(beam_convergence_angle_), 1)(random_generator);
 
         // Rotate direction by given angles
         // First, define and apply theta rotation
-        ROOT::Math::XYZVector theta_axis = orthogonal_pair(beam_direction_).first;
+        const auto& theta_axis = beam_orthogonal_.first;
         ROOT::Math::AxisAngle theta_rotation(theta_axis, acos(cos_theta));
         photon_direction = theta_rotation(beam_direction_);
 
@@ -529,9 +724,8 @@ std::pair<ROOT::Math::XYZPoint, ROOT::Math::XYZVector> DepositionLaserModule::ge
     return {starting_point, photon_direction};
 }
 
-std::optional<DepositionLaserModule::PhotonHit> DepositionLaserModule::track(const ROOT::Math::XYZPoint& position,
-                                                                             const ROOT::Math::XYZVector& direction,
-                                                                             double penetration_depth) const {
+std::optional<DepositionLaserModule::PhotonPath> DepositionLaserModule::trace(const ROOT::Math::XYZPoint& position,
+                                                                              const ROOT::Math::XYZVector& direction) const {
 
     // Lambda for angle calculation
     auto angle = [](const ROOT::Math::XYZVector& v1, const ROOT::Math::XYZVector& v2) {
@@ -540,31 +734,23 @@ std::optional<DepositionLaserModule::PhotonHit> DepositionLaserModule::track(con
 
     double c = TMath::C() * 100; // speed of light in mm/ns
 
-    std::vector<std::shared_ptr<Detector>> detectors = geo_manager_->getDetectors();
-    std::vector<std::pair<std::shared_ptr<Detector>, std::pair<double, double>>> intersection_segments;
-
-    for(auto& detector : detectors) {
-        if(detector->getModel()->getSensorMaterial() != SensorMaterial::SILICON && !is_user_optics_) {
+    // Find the first sensitive detector along the photon path
+    std::shared_ptr<Detector> detector;
+    double t0 = 0;
+    for(const auto& intersection : geo_manager_->getIntersectedDetectors(position, direction)) {
+        if(intersection.detector->getModel()->getSensorMaterial() != SensorMaterial::SILICON && !is_user_optics_) {
             continue;
         }
-        auto intersection = intersect_with_sensor(detector, position, direction);
-        if(intersection) {
-            intersection_segments.emplace_back(detector, intersection.value());
-        }
+        detector = intersection.detector;
+        t0 = intersection.entry;
+        break;
     }
 
-    if(intersection_segments.empty()) {
+    if(detector == nullptr) {
         LOG(DEBUG) << "No intersections with sensitive detectors";
         return std::nullopt;
     }
 
-    auto it_first_detector = std::min_element(begin(intersection_segments),
-                                              end(intersection_segments),
-                                              [](const auto& p1, const auto& p2) { return p1.second < p2.second; });
-
-    auto detector = it_first_detector->first;
-    double t0 = it_first_detector->second.first;
-
     auto intersect_passive = intersect_with_passives(position, direction);
     if(intersect_passive) {
         if(intersect_passive.value().first < t0) {
@@ -597,43 +783,38 @@ std::optional<DepositionLaserModule::PhotonHit> DepositionLaserModule::track(con
 
     LOG(DEBUG) << "        crossing_distance: " << Units::display(crossing_distance, {"um", "mm"});
 
-    if(crossing_distance < penetration_depth) {
+    return PhotonPath{detector, position + direction * t0, new_direction, crossing_distance, t0 / c};
+}
+
+std::optional<DepositionLaserModule::PhotonHit> DepositionLaserModule::track(const ROOT::Math::XYZPoint& position,
+                                                                             const ROOT::Math::XYZVector& direction,
+                                                                             double penetration_depth) const {
+    auto path = trace(position, direction);
+    if(!path) {
+        return std::nullopt;
+    }
+
+    if(path->crossing_distance < penetration_depth) {
         LOG(DEBUG) << "    Photon is not absorbed";
         return std::nullopt;
     }
 
+    double c = TMath::C() * 100; // speed of light in mm/ns
+
     // Construct a hit
 
-    return PhotonHit{detector,
-                     position + direction * t0,
-                     position + direction * t0 + new_direction * penetration_depth,
-                     t0 / c,
-                     t0 / c + penetration_depth / c * refractive_index_};
+    return PhotonHit{path->detector,
+                     path->entry_global,
+                     path->entry_global + path->direction * penetration_depth,
+                     path->time_to_entry,
+                     path->time_to_entry + penetration_depth / c * refractive_index_};
 }
 
 std::optional<std::pair<double, double>>
 DepositionLaserModule::intersect_with_sensor(const std::shared_ptr<const Detector>& detector,
                                              const ROOT::Math::XYZPoint& position_global,
                                              const ROOT::Math::XYZVector& direction_global) const {
-    // Obtain total sensor size
-    auto sensor = detector->getModel()->getSensorSize();
-
-    // Transform original position and direction to a sensor-related coordinate system,
-
-    // Construct transformation from the sensor system to the global one
-    // * The rotation into the global coordinate system
-    // * The shift from the origin to the detector position
-    ROOT::Math::Rotation3D rotation_center(detector->getOrientation());
-    ROOT::Math::Translation3D translation_center(static_cast<ROOT::Math::XYZVector>(detector->getPosition()));
-    ROOT::Math::Transform3D transform_center(rotation_center, translation_center);
-
-    // Apply inverse of that transformation
-    auto position_local = transform_center.Inverse()(position_global);
-
-    // Direction vector can directly be rotated
-    auto direction_local = detector->getOrientation().Inverse()(direction_global);
-
-    return LiangBarsky::intersectionDistances(direction_local, position_local, sensor);
+    return detector->getSensorIntersection(position_global, direction_global);
 }
 
 std::optional<std::pair<double, std::string>>
@@ -641,24 +822,12 @@ DepositionLaserModule::intersect_with_passives(const ROOT::Math::XYZPoint& posit
                                                const ROOT::Math::XYZVector& direction_global) const {
 
     std::optional<std::pair<double, std::string>> result{};
-    auto passive_configs = geo_manager_->getPassiveElements();
-
-    for(const auto& item : passive_configs) {
-        auto shape = item.get<std::string>("type");
-        if(shape != "box") {
-            continue;
-        }
 
-        auto [passive_position, passive_orientation] = geo_manager_->getPassiveElementOrientation(item.getName());
-        auto passive_size = item.get<ROOT::Math::XYZVector>("size");
+    for(const auto& box : passive_boxes_) {
+        auto position_local = box.to_local(position_global);
+        auto direction_local = box.rotation_to_local(direction_global);
 
-        ROOT::Math::Rotation3D rotation_center(passive_orientation);
-        ROOT::Math::Translation3D translation_center(static_cast<ROOT::Math::XYZVector>(passive_position));
-        ROOT::Math::Transform3D transform_center(rotation_center, translation_center);
-        auto position_local = transform_center.Inverse()(position_global);
-        auto direction_local = rotation_center.Inverse()(direction_global);
-
-        auto intersect = LiangBarsky::intersectionDistances(direction_local, position_local, passive_size);
+        auto intersect = LiangBarsky::intersectionDistances(direction_local, position_local, box.size);
 
         if(!intersect) {
             continue;
@@ -667,11 +836,11 @@ DepositionLaserModule::intersect_with_passives(const ROOT::Math::XYZPoint& posit
         double distance = intersect.value().first;
 
         if(!result) {
-            result = {distance, item.getName()};
+            result = {distance, box.name};
         }
 
         if(distance < result.value().first) {
-            result = {distance, item.getName()};
+            result = {distance, box.name};
         }
     }
 
@@ -683,17 +852,10 @@ ROOT::Math::XYZVector DepositionLaserModule::intersection_normal_vector(const st
     // Obtain total sensor size
     auto sensor = detector->getModel()->getSensorSize();
 
-    // Transform original position and direction to a sensor-related coordinate system,
-
-    // Construct transformation from the sensor system to the global one
-    // * The rotation into the global coordinate system
-    // * The shift from the origin to the detector position
-    ROOT::Math::Rotation3D rotation_center(detector->getOrientation());
-    ROOT::Math::Translation3D translation_center(static_cast<ROOT::Math::XYZVector>(detector->getPosition()));
-    ROOT::Math::Transform3D transform_center(rotation_center, translation_center);
-
-    // Apply inverse of that transformation
-    auto position_local = transform_center.Inverse()(position_global);
+    // Transform the position to the coordinate system of the sensor, centered at the sensor center and rotated with the
+    // detector
+    auto position_local = detector->getLocalPosition(position_global) -
+                          static_cast<ROOT::Math::XYZVector>(detector->getModel()->getSensorCenter());
 
     std::vector<double> distances_to_faces = {std::abs(position_local.X() - sensor.X() / 2),
                                               std::abs(position_local.X() + sensor.X() / 2),
@@ -714,5 +876,5 @@ ROOT::Math::XYZVector DepositionLaserModule::intersection_normal_vector(const st
     auto iter_min = std::min_element(begin(distances_to_faces), end(distances_to_faces));
     size_t index_min = static_cast<size_t>(std::abs(iter_min - begin(distances_to_faces))); // avoid implicit conversion
 
-    return rotation_center(normals_to_faces[index_min]);
+    return detector->getOrientation()(normals_to_faces[index_min]);
 }
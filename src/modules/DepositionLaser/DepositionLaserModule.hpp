@@ -17,12 +17,18 @@
 #include <optional>
 #include <string>
 #include <utility>
+#include <vector>
+
+#include <Math/Rotation3D.h>
+#include <Math/Transform3D.h>
 
 #include "core/config/Configuration.hpp"
 #include "core/geometry/GeometryManager.hpp"
 #include "core/messenger/Messenger.hpp"
 #include "core/module/Event.hpp"
 #include "core/module/Module.hpp"
+#include "objects/DepositedCharge.hpp"
+#include "objects/MCParticle.hpp"
 
 #include "TH1D.h"
 #include "TH2D.h"
@@ -43,6 +49,11 @@ namespace allpix {
             CONVERGING,
         };
 
+        enum class DepositionMode {
+            PHOTONS,
+            ABSORPTION_PROFILE,
+        };
+
         // Data to return from tracking algorithms
         struct PhotonHit { // NOLINT
             std::shared_ptr<Detector> detector;
@@ -52,6 +63,23 @@ namespace allpix {
             double time_to_hit;
         };
 
+        // Path of a ray through the first sensor it enters, after refraction at the sensor surface
+        struct PhotonPath { // NOLINT
+            std::shared_ptr<Detector> detector;
+            ROOT::Math::XYZPoint entry_global;
+            ROOT::Math::XYZVector direction;
+            double crossing_distance;
+            double time_to_entry;
+        };
+
+        // Passive box with its transformation to local coordinates, precomputed to avoid configuration lookups per photon
+        struct PassiveBox {
+            std::string name;
+            ROOT::Math::Transform3D to_local;
+            ROOT::Math::Rotation3D rotation_to_local;
+            ROOT::Math::XYZVector size;
+        };
+
     public:
         /**
          * @brief Constructor for this unique module
@@ -103,10 +131,17 @@ namespace allpix {
 
         /**
          * @brief Generate starting position and direction for a single photon, obeying the set beam geometry
-         * @param event is passed to get proper RNGs
+         * @param random_generator Random number engine to be used
          * Also fills histograms
          */
-        std::pair<ROOT::Math::XYZPoint, ROOT::Math::XYZVector> generate_photon_geometry(Event* event);
+        std::pair<ROOT::Math::XYZPoint, ROOT::Math::XYZVector>
+        generate_photon_geometry(RandomNumberGenerator& random_generator);
+
+        /**
+         * @brief Trace a ray to the first sensor it enters and refract it at the sensor surface
+         * @return Path through the sensor, or nothing if no sensor is hit or the ray is absorbed by a passive object before
+         */
+        std::optional<PhotonPath> trace(const ROOT::Math::XYZPoint& position, const ROOT::Math::XYZVector& direction) const;
 
         /**
          * @brief Track a photon, starting at the given point
@@ -115,6 +150,41 @@ namespace allpix {
         std::optional<PhotonHit>
         track(const ROOT::Math::XYZPoint& position, const ROOT::Math::XYZVector& direction, double penetration_depth) const;
 
+        /**
+         * @brief Generate and track the photons of a range of the pulse in blocks
+         * @param first Index of the first photon
+         * @param last Index past the last photon
+         * @param random_generator Random number engine to be used
+         * @param photon_hits Hits of all photons of the pulse, filled for the given range
+         *
+         * The starting points, directions and penetration depths of a block of photons are sampled into separate arrays
+         * before the block is tracked, drawing the random numbers in the same order as for a single photon.
+         */
+        void track_photons(size_t first,
+                           size_t last,
+                           RandomNumberGenerator& random_generator,
+                           std::vector<std::optional<PhotonHit>>& photon_hits);
+
+        /**
+         * @brief Deposit the charge of the full pulse on a grid instead of tracking individual photons
+         * @param mc_particles Particles of all detectors, one for every cell of the beam profile entering a sensor
+         * @param deposited_charges Charges of all detectors, one electron and hole pair for every depth step of a cell
+         *
+         * The Gaussian beam profile is integrated over every cell of a grid transverse to the beam, and the photons of a
+         * cell are traced along its center. The charge deposited in every depth step of the refracted ray is given by the
+         * exponential absorption profile integrated over the step.
+         */
+        void
+        deposit_absorption_profile(std::map<std::shared_ptr<Detector>, std::vector<MCParticle>>& mc_particles,
+                                   std::map<std::shared_ptr<Detector>, std::vector<DepositedCharge>>& deposited_charges);
+
+        /**
+         * @brief Dispatch the messages with the particles and linked charges of all detectors
+         */
+        void dispatch_deposits(Event* event,
+                               std::map<std::shared_ptr<Detector>, std::vector<MCParticle>>& mc_particles,
+                               std::map<std::shared_ptr<Detector>, std::vector<DepositedCharge>>& deposited_charges);
+
         // General module members
         GeometryManager* geo_manager_;
         Messenger* messenger_;
@@ -122,6 +192,7 @@ namespace allpix {
         // Laser parameters
         ROOT::Math::XYZPoint source_position_{};
         ROOT::Math::XYZVector beam_direction_{};
+        std::pair<ROOT::Math::XYZVector, ROOT::Math::XYZVector> beam_orthogonal_{};
         double beam_waist_;
 
         BeamGeometry beam_geometry_{};
@@ -136,6 +207,13 @@ namespace allpix {
         bool is_user_optics_{false};
 
         size_t group_photons_;
+        size_t tasks_per_event_{1};
+
+        DepositionMode deposition_mode_{DepositionMode::PHOTONS};
+        size_t profile_cells_{};
+        size_t profile_depth_steps_{};
+
+        std::vector<PassiveBox> passive_boxes_;
 
         // Histograms
         bool output_plots_;
@@ -0,0 +1,229 @@
+/**
+ * @file
+ * @brief Implementation of module overlaying deposited charges from a library of background events onto every event
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "DepositionOverlayModule.hpp"
+
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "core/config/exceptions.h"
+#include "core/messenger/exceptions.h"
+#include "core/module/exceptions.h"
+#include "core/utils/distributions.h"
+#include "core/utils/log.h"
+
+using namespace allpix;
+
+namespace {
+    // Get a point from a column of consecutive coordinates
+    ROOT::Math::XYZPoint get_point(const std::vector<double>& column, size_t index) {
+        return {column[3 * index], column[3 * index + 1], column[3 * index + 2]};
+    }
+} // namespace
+
+DepositionOverlayModule::DepositionOverlayModule(Configuration& config,
+                                                 Messenger* messenger,
+                                                 std::shared_ptr<Detector> detector)
+    : Module(config, detector), messenger_(messenger), detector_(std::move(detector)) {
+    // Enable multithreading of this module if multithreading is enabled
+    allow_multithreading();
+
+    // The deposits of the signal are optional, such that also pure background events can be simulated
+    messenger_->bindSingle<DepositedChargeMessage>(this, MsgFlags::NONE);
+    messenger_->bindSingle<MCParticleMessage>(this, MsgFlags::NONE);
+
+    // Declare the messages dispatched by this module
+    declare_output<MCParticleMessage>();
+    declare_output<DepositedChargeMessage>();
+
+    config_.setDefault<double>("time_offset", 0.);
+    config_.setDefault<double>("time_window", 0.);
+}
+
+void DepositionOverlayModule::initialize() {
+    auto file_path = config_.getPathWithExtension("file_name", "replay", true);
+    try {
+        reader_ = std::make_unique<DepositReplayReader>(file_path);
+    } catch(std::runtime_error& e) {
+        throw InvalidValueError(config_, "file_name", "could not read background library: " + std::string(e.what()));
+    }
+
+    if(reader_->getEventCount() == 0) {
+        throw InvalidValueError(config_, "file_name", "background library does not contain any events");
+    }
+    const auto& detectors = reader_->getDetectors();
+    auto detector = std::find(detectors.begin(), detectors.end(), detector_->getName());
+    if(detector == detectors.end()) {
+        throw InvalidValueError(
+            config_, "file_name", "background library does not contain detector " + detector_->getName());
+    }
+    library_detector_ = static_cast<std::uint32_t>(detector - detectors.begin());
+
+    time_offset_ = config_.get<double>("time_offset");
+    time_window_ = config_.get<double>("time_window");
+    if(time_window_ < 0) {
+        throw InvalidValueError(config_, "time_window", "time window cannot be negative");
+    }
+
+    // The number of overlaid events is given either directly or by the rate within the time window
+    if(config_.count({"mean_overlays", "overlay_rate"}) != 1) {
+        throw InvalidCombinationError(
+            config_, {"mean_overlays", "overlay_rate"}, "exactly one of the parameters has to be specified");
+    }
+    if(config_.has("overlay_rate")) {
+        if(time_window_ <= 0) {
+            throw InvalidValueError(config_, "overlay_rate", "overlay rate requires a positive time window");
+        }
+        mean_overlays_ = config_.get<double>("overlay_rate") * time_window_;
+    } else {
+        mean_overlays_ = config_.get<double>("mean_overlays");
+    }
+    if(mean_overlays_ <= 0) {
+        throw InvalidValueError(config_,
+                                (config_.has("overlay_rate") ? "overlay_rate" : "mean_overlays"),
+                                "mean number of overlaid events has to be positive");
+    }
+
+    LOG(INFO) << "Overlaying on average " << mean_overlays_ << " of " << reader_->getEventCount()
+              << " background events onto every event";
+}
+
+void DepositionOverlayModule::run(Event* event) {
+    // Fetch the deposits and particles of the signal, if any
+    std::shared_ptr<DepositedChargeMessage> deposit_message;
+    std::shared_ptr<MCParticleMessage> particle_message;
+    try {
+        deposit_message = messenger_->fetchMessage<DepositedChargeMessage>(this, event);
+    } catch(MessageNotFoundException&) {
+    }
+    try {
+        particle_message = messenger_->fetchMessage<MCParticleMessage>(this, event);
+    } catch(MessageNotFoundException&) {
+    }
+
+    // Copy the signal particles and remember their new position to restore the relations
+    std::vector<MCParticle> mc_particles;
+    std::map<const MCParticle*, size_t> signal_particles;
+    if(particle_message != nullptr) {
+        for(const auto& particle : particle_message->getData()) {
+            signal_particles.emplace(&particle, mc_particles.size());
+            mc_particles.push_back(particle);
+        }
+        for(auto& particle : mc_particles) {
+            const auto* parent = particle.getParent();
+            particle.setParent(parent != nullptr && signal_particles.count(parent) != 0
+                                   ? &mc_particles[signal_particles.at(parent)]
+                                   : nullptr);
+        }
+    }
+
+    // Draw the background events and decode their records of this detector
+    allpix::poisson_distribution<unsigned int> overlay_distribution(mean_overlays_);
+    allpix::uniform_int_distribution<size_t> event_distribution(0, reader_->getEventCount() - 1);
+    allpix::uniform_real_distribution<double> offset_distribution(time_offset_, time_offset_ + time_window_);
+    auto overlays = overlay_distribution(event->getRandomEngine());
+
+    std::vector<std::pair<DepositReplayRecord, double>> records;
+    for(unsigned int n = 0; n < overlays; ++n) {
+        auto background_event = reader_->getEvent(event_distribution(event->getRandomEngine()));
+        auto offset = offset_distribution(event->getRandomEngine());
+        try {
+            for(auto& record : reader_->read(background_event)) {
+                if(record.detector == library_detector_) {
+                    records.emplace_back(std::move(record), offset);
+                }
+            }
+        } catch(std::runtime_error& e) {
+            throw ModuleError("Could not read event " + std::to_string(background_event) +
+                              " from background library: " + std::string(e.what()));
+        }
+        LOG(DEBUG) << "Overlaying background event " << background_event << " with time offset "
+                   << Units::display(offset, {"ns", "ps"});
+    }
+
+    // Append the background particles, shifted by the time offset of their event
+    std::vector<size_t> record_particles;
+    for(const auto& [record, offset] : records) {
+        record_particles.push_back(mc_particles.size());
+        for(size_t i = 0; i < record.getParticleCount(); ++i) {
+            mc_particles.emplace_back(get_point(record.particle_local_start, i),
+                                      get_point(record.particle_global_start, i),
+                                      get_point(record.particle_local_end, i),
+                                      get_point(record.particle_global_end, i),
+                                      record.particle_id[i],
+                                      record.particle_local_time[i] + offset,
+                                      record.particle_global_time[i] + offset);
+            mc_particles.back().setTotalEnergyStart(record.particle_total_energy[i]);
+            mc_particles.back().setKineticEnergyStart(record.particle_kinetic_energy[i]);
+            mc_particles.back().setTotalDepositedCharge(record.particle_charge[i]);
+        }
+    }
+    for(size_t r = 0; r < records.size(); ++r) {
+        const auto& record = records[r].first;
+        for(size_t i = 0; i < record.getParticleCount(); ++i) {
+            if(record.particle_parent[i] >= 0) {
+                mc_particles[record_particles[r] + i].setParent(
+                    &mc_particles[record_particles[r] + static_cast<size_t>(record.particle_parent[i])]);
+            }
+        }
+    }
+
+    // The particles are referenced by the deposits, such that the message has to be created first
+    auto mc_particle_message = std::make_shared<MCParticleMessage>(std::move(mc_particles), detector_);
+    const auto& particles = mc_particle_message->getData();
+
+    std::vector<DepositedCharge> deposits;
+    if(deposit_message != nullptr) {
+        for(const auto& deposit : deposit_message->getData()) {
+            deposits.push_back(deposit);
+            const auto* particle = deposit.getMCParticle();
+            deposits.back().setMCParticle(particle != nullptr && signal_particles.count(particle) != 0
+                                              ? &particles[signal_particles.at(particle)]
+                                              : nullptr);
+        }
+    }
+    auto signal_deposits = deposits.size();
+    for(size_t r = 0; r < records.size(); ++r) {
+        const auto& [record, offset] = records[r];
+        for(size_t i = 0; i < record.getDepositCount(); ++i) {
+            const MCParticle* mc_particle = nullptr;
+            if(record.deposit_particle[i] >= 0) {
+                mc_particle = &particles[record_particles[r] + static_cast<size_t>(record.deposit_particle[i])];
+            }
+            deposits.emplace_back(get_point(record.deposit_local_position, i),
+                                  get_point(record.deposit_global_position, i),
+                                  static_cast<CarrierType>(record.deposit_type[i]),
+                                  record.deposit_charge[i],
+                                  record.deposit_local_time[i] + offset,
+                                  record.deposit_global_time[i] + offset,
+                                  mc_particle);
+        }
+    }
+
+    LOG(DEBUG) << "Overlaid " << overlays << " background events with " << (deposits.size() - signal_deposits)
+               << " deposits onto " << signal_deposits << " deposits";
+    total_overlays_ += overlays;
+    total_deposits_ += deposits.size() - signal_deposits;
+
+    messenger_->dispatchMessage(this, mc_particle_message, event);
+    if(!deposits.empty()) {
+        auto message = std::make_shared<DepositedChargeMessage>(std::move(deposits), detector_);
+        messenger_->dispatchMessage(this, message, event);
+    }
+}
+
+void DepositionOverlayModule::finalize() {
+    LOG(INFO) << "Overlaid " << total_overlays_ << " background events with a total of " << total_deposits_
+              << " deposits";
+}
@@ -0,0 +1,81 @@
+/**
+ * @file
+ * @brief Definition of module overlaying deposited charges from a library of background events onto every event
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "core/config/Configuration.hpp"
+#include "core/geometry/Detector.hpp"
+#include "core/messenger/Messenger.hpp"
+#include "core/module/Event.hpp"
+#include "core/module/Module.hpp"
+
+#include "objects/DepositedCharge.hpp"
+#include "objects/MCParticle.hpp"
+
+#include "tools/deposit_replay.h"
+
+namespace allpix {
+    /**
+     * @ingroup Modules
+     * @brief Module to overlay the deposited charges of randomly chosen background events onto the deposits of every event
+     * @note This module supports multithreading
+     *
+     * The background events are read from a replay file written by the DepositReplayWriter module. For every event, the
+     * number of overlaid background events is drawn from a Poisson distribution and every background event is shifted by
+     * a random time offset. The deposits and Monte Carlo particles of the background events are dispatched together with
+     * those received for the detector in a single message each.
+     */
+    class DepositionOverlayModule : public Module {
+    public:
+        /**
+         * @brief Constructor for this detector-specific module
+         * @param config Configuration object for this module as retrieved from the steering file
+         * @param messenger Pointer to the messenger object to allow binding to messages on the bus
+         * @param detector Pointer to the detector for this module instance
+         */
+        DepositionOverlayModule(Configuration& config, Messenger* messenger, std::shared_ptr<Detector> detector);
+
+        /**
+         * @brief Open the background library and find the records of the detector
+         */
+        void initialize() override;
+
+        /**
+         * @brief Overlay the deposits of the background events onto the received deposits
+         */
+        void run(Event*) override;
+
+        /**
+         * @brief Print statistics of the overlaid background events
+         */
+        void finalize() override;
+
+    private:
+        Messenger* messenger_;
+        std::shared_ptr<Detector> detector_;
+
+        std::unique_ptr<DepositReplayReader> reader_;
+        // Index of the detector in the background library
+        std::uint32_t library_detector_{};
+
+        // Mean number of overlaid events and range of their time offsets
+        double mean_overlays_{};
+        double time_offset_{};
+        double time_window_{};
+
+        // Statistics
+        std::atomic_size_t total_overlays_{};
+        std::atomic_size_t total_deposits_{};
+    };
+} // namespace allpix
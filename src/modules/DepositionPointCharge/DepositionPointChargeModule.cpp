@@ -19,6 +19,7 @@
 #include "core/module/Event.hpp"
 #include "core/utils/distributions.h"
 #include "core/utils/log.h"
+#include "core/utils/unit_constants.h"
 #include "objects/DepositedCharge.hpp"
 #include "objects/MCParticle.hpp"
 #include "tools/liang_barsky.h"
@@ -32,6 +33,10 @@ DepositionPointChargeModule::DepositionPointChargeModule(Configuration& config,
     // Enable multithreading of this module if multithreading is enabled
     allow_multithreading();
 
+    // Declare the messages dispatched by this module
+    declare_output<MCParticleMessage>();
+    declare_output<DepositedChargeMessage>();
+
     // Allow to use similar syntax as in DepositionGeant4:
     config_.setAlias("position", "source_position");
 
@@ -102,11 +107,23 @@ void DepositionPointChargeModule::initialize() {
         carriers_ = config_.get<unsigned int>("number_of_charges");
     }
 
+    // Read the number of scan points deposited in every event
+    config_.setDefault("points_per_event", 1);
+    points_per_event_ = config_.get<unsigned int>("points_per_event");
+    if(points_per_event_ == 0) {
+        throw InvalidValueError(config_, "points_per_event", "number of points per event needs to be larger than zero");
+    }
+    if(points_per_event_ > 1 && model_ != DepositionModel::SCAN) {
+        throw InvalidValueError(
+            config_, "points_per_event", "multiple points per event are only supported by the scan model");
+    }
+
     // Set up the different scan methods
     if(model_ == DepositionModel::SCAN) {
-        // Get the config manager and retrieve total number of events:
+        // Get the config manager and retrieve total number of events, every event contains one or multiple scan points:
         ConfigManager* conf_manager = getConfigManager();
-        auto events = conf_manager->getGlobalConfiguration().get<unsigned int>("number_of_events");
+        auto events = conf_manager->getGlobalConfiguration().get<unsigned int>("number_of_events") * points_per_event_;
+        auto events_name = (points_per_event_ > 1 ? "Number of scan points" : "Number of events");
         scan_coordinates_ = config_.getArray<std::string>("scan_coordinates", {"x", "y", "z"});
 
         scan_x_ = std::find(scan_coordinates_.begin(), scan_coordinates_.end(), "x") != scan_coordinates_.end();
@@ -150,7 +167,7 @@ void DepositionPointChargeModule::initialize() {
         if(no_of_coordinates_ == 2) {
             root_ = static_cast<unsigned int>(std::lround(std::sqrt(events)));
             if(events != root_ * root_) {
-                LOG(WARNING) << "Number of events is not a square, pixel cell volume cannot fully be covered in scan. "
+                LOG(WARNING) << events_name << " is not a square, pixel cell volume cannot fully be covered in scan. "
                              << "Closest square is " << root_ * root_;
             }
             // Throw if we don't have a valid combination. Need 2 valid entries; x y, x z, or y z
@@ -162,7 +179,7 @@ void DepositionPointChargeModule::initialize() {
         } else if(no_of_coordinates_ == 3) {
             root_ = static_cast<unsigned int>(std::lround(std::cbrt(events)));
             if(events != root_ * root_ * root_) {
-                LOG(WARNING) << "Number of events is not a cube, pixel cell volume cannot fully be covered in scan. "
+                LOG(WARNING) << events_name << " is not a cube, pixel cell volume cannot fully be covered in scan. "
                              << "Closest cube is " << root_ * root_ * root_;
             }
         }
@@ -171,6 +188,41 @@ void DepositionPointChargeModule::initialize() {
                                        detector_model_->getPixelSize().y() / (scan_y_ ? root_ : 1.0),
                                        detector_model_->getSensorSize().z() / (scan_z_ ? root_ : 1.0));
         LOG(INFO) << "Voxel size for scan of pixel volume: " << Units::display(voxel_, {"um", "mm"});
+
+        // Center the volume to be scanned in the center of the sensor,
+        // reference point is lower left corner of one pixel volume
+        scan_reference_ = position_ + detector_model_->getMatrixSize() / 2.0 + voxel_ / 2.0 -
+                          ROOT::Math::XYZVector(detector_model_->getPixelSize().x() / 2.0,
+                                                detector_model_->getPixelSize().y() / 2.0,
+                                                detector_model_->getSensorSize().z() / 2.0);
+        LOG(DEBUG) << "Reference: " << Units::display(scan_reference_, {"um", "mm"});
+
+        // Distribute the points of one event over a grid of pixel cells around the scanned pixel volume
+        if(points_per_event_ > 1) {
+            config_.setDefault("point_spacing", 2);
+            point_spacing_ = config_.get<unsigned int>("point_spacing");
+            if(point_spacing_ == 0) {
+                throw InvalidValueError(config_, "point_spacing", "spacing of the points needs to be at least one pixel");
+            }
+            cells_x_ = (detector_model_->getNPixels().x() - 1) / point_spacing_ + 1;
+            cells_y_ = (detector_model_->getNPixels().y() - 1) / point_spacing_ + 1;
+
+            // Check that the pixel cells of all points are within the matrix
+            auto cell_center = scan_reference_ - voxel_ / 2.0 +
+                               ROOT::Math::XYZVector(
+                                   detector_model_->getPixelSize().x() / 2.0, detector_model_->getPixelSize().y() / 2.0, 0);
+            for(unsigned int point = 0; point < points_per_event_; ++point) {
+                if(point >= cells_x_ * cells_y_ || !detector_model_->isWithinMatrix(cell_center + CellOffset(point))) {
+                    throw InvalidValueError(config_,
+                                            "points_per_event",
+                                            "pixel matrix does not provide a separate cell for every point of an event "
+                                            "with a spacing of " +
+                                                std::to_string(point_spacing_) + " pixels");
+                }
+            }
+            LOG(INFO) << "Depositing " << points_per_event_ << " scan points per event in pixel cells spaced by "
+                      << point_spacing_ << " pixels";
+        }
     }
 
     if(output_plots_) {
@@ -211,74 +263,102 @@ void DepositionPointChargeModule::initialize() {
 }
 
 void DepositionPointChargeModule::run(Event* event) {
+    // Vector of deposited charges and their "MCParticle", one particle per point deposited in this event
+    std::vector<DepositedCharge> charges;
+    std::vector<MCParticle> mcparticles;
+    mcparticles.reserve(points_per_event_);
+
+    for(unsigned int point = 0; point < points_per_event_; ++point) {
+        ROOT::Math::XYZPoint position;
+
+        if(model_ == DepositionModel::FIXED) {
+            // Fixed position as read from the configuration:
+            position = position_;
+        } else if(model_ == DepositionModel::SCAN) {
+            // Every point of the event is placed in its own pixel cell with the following scan position
+            auto index = (event->number - 1) * points_per_event_ + point;
+            position = scan_reference_ + ScanOffset(index);
+            if(points_per_event_ > 1) {
+                position += CellOffset(point);
+            }
+            LOG(DEBUG) << "Deposition position in local coordinates: " << Units::display(position, {"um", "mm"});
+        } else {
+            // Calculate random offset from configured position
+            auto shift = [&](auto size) {
+                double dx = allpix::normal_distribution<double>(0, size)(event->getRandomEngine());
+                double dy = allpix::normal_distribution<double>(0, size)(event->getRandomEngine());
+                double dz = allpix::normal_distribution<double>(0, size)(event->getRandomEngine());
+                return ROOT::Math::XYZVector(dx, dy, dz);
+            };
+
+            // Spot around the configured position
+            position = position_ + shift(spot_size_);
+        }
 
-    ROOT::Math::XYZPoint position;
-
-    if(model_ == DepositionModel::FIXED) {
-        // Fixed position as read from the configuration:
-        position = position_;
-    } else if(model_ == DepositionModel::SCAN) {
-        // Center the volume to be scanned in the center of the sensor,
-        // reference point is lower left corner of one pixel volume
-        auto ref = position_ + detector_model_->getMatrixSize() / 2.0 + voxel_ / 2.0 -
-                   ROOT::Math::XYZVector(detector_model_->getPixelSize().x() / 2.0,
-                                         detector_model_->getPixelSize().y() / 2.0,
-                                         detector_model_->getSensorSize().z() / 2.0);
-        LOG(DEBUG) << "Reference: " << Units::display(ref, {"um", "mm"});
-        if(no_of_coordinates_ == 3) {
-            position =
-                ROOT::Math::XYZPoint(voxel_.x() * static_cast<double>((event->number - 1) % root_),
-                                     voxel_.y() * static_cast<double>(((event->number - 1) / root_) % root_),
-                                     voxel_.z() * static_cast<double>(((event->number - 1) / root_ / root_) % root_)) +
-                ref;
+        // Create charge carriers at requested position
+        if(type_ == SourceType::MIP) {
+            DepositLine(position, mcparticles, charges);
         } else {
-            position = ref;
-            if(scan_x_) {
-                position.SetX(voxel_.x() * static_cast<double>((event->number - 1) % root_) + ref.x());
-                if(scan_y_) {
-                    position.SetY(voxel_.y() * static_cast<double>(((event->number - 1) / root_) % root_) + ref.y());
-                } else if(scan_z_) {
-                    position.SetZ(voxel_.z() * static_cast<double>(((event->number - 1) / root_) % root_) + ref.z());
-                }
-            } else if(scan_y_) {
-                position.SetY(voxel_.y() * static_cast<double>((event->number - 1) % root_) + ref.y());
-                if(scan_z_) {
-                    position.SetZ(voxel_.z() * static_cast<double>(((event->number - 1) / root_) % root_) + ref.z());
-                }
-            } else {
-                position.SetZ(voxel_.z() * static_cast<double>((event->number - 1) % root_) + ref.z());
+            DepositPoint(position, mcparticles, charges);
+            if(output_plots_) {
+                auto [xpixel, ypixel] = detector_model_->getPixelIndex(position);
+                auto inPixelPos = position - detector_model_->getPixelCenter(xpixel, ypixel);
+                auto in_pixel_um_x = inPixelPos.x() / units::um;
+                auto in_pixel_um_y = inPixelPos.y() / units::um;
+                auto in_pixel_um_z = position.z() / units::um;
+                deposition_position_xy->Fill(in_pixel_um_x, in_pixel_um_y);
+                deposition_position_xz->Fill(in_pixel_um_x, in_pixel_um_z);
+                deposition_position_yz->Fill(in_pixel_um_y, in_pixel_um_z);
             }
         }
-        LOG(DEBUG) << "Deposition position in local coordinates: " << Units::display(position, {"um", "mm"});
-    } else {
-        // Calculate random offset from configured position
-        auto shift = [&](auto size) {
-            double dx = allpix::normal_distribution<double>(0, size)(event->getRandomEngine());
-            double dy = allpix::normal_distribution<double>(0, size)(event->getRandomEngine());
-            double dz = allpix::normal_distribution<double>(0, size)(event->getRandomEngine());
-            return ROOT::Math::XYZVector(dx, dy, dz);
-        };
-
-        // Spot around the configured position
-        position = position_ + shift(spot_size_);
     }
 
-    // Create charge carriers at requested position
-    if(type_ == SourceType::MIP) {
-        DepositLine(event, position);
-    } else {
-        DepositPoint(event, position);
-        if(output_plots_) {
-            auto [xpixel, ypixel] = detector_model_->getPixelIndex(position);
-            auto inPixelPos = position - detector_model_->getPixelCenter(xpixel, ypixel);
-            auto in_pixel_um_x = static_cast<double>(Units::convert(inPixelPos.x(), "um"));
-            auto in_pixel_um_y = static_cast<double>(Units::convert(inPixelPos.y(), "um"));
-            auto in_pixel_um_z = static_cast<double>(Units::convert(position.z(), "um"));
-            deposition_position_xy->Fill(in_pixel_um_x, in_pixel_um_y);
-            deposition_position_xz->Fill(in_pixel_um_x, in_pixel_um_z);
-            deposition_position_yz->Fill(in_pixel_um_y, in_pixel_um_z);
+    // Do not dispatch messages if no point was within the sensor
+    if(mcparticles.empty()) {
+        return;
+    }
+
+    // Dispatch the messages to the framework
+    auto mcparticle_message = std::make_shared<MCParticleMessage>(std::move(mcparticles), detector_);
+    messenger_->dispatchMessage(this, std::move(mcparticle_message), event);
+
+    auto deposit_message = std::make_shared<DepositedChargeMessage>(std::move(charges), detector_);
+    messenger_->dispatchMessage(this, std::move(deposit_message), event);
+}
+
+ROOT::Math::XYZVector DepositionPointChargeModule::ScanOffset(uint64_t index) const {
+    if(no_of_coordinates_ == 3) {
+        return {voxel_.x() * static_cast<double>(index % root_),
+                voxel_.y() * static_cast<double>((index / root_) % root_),
+                voxel_.z() * static_cast<double>((index / root_ / root_) % root_)};
+    }
+
+    ROOT::Math::XYZVector offset;
+    if(scan_x_) {
+        offset.SetX(voxel_.x() * static_cast<double>(index % root_));
+        if(scan_y_) {
+            offset.SetY(voxel_.y() * static_cast<double>((index / root_) % root_));
+        } else if(scan_z_) {
+            offset.SetZ(voxel_.z() * static_cast<double>((index / root_) % root_));
         }
+    } else if(scan_y_) {
+        offset.SetY(voxel_.y() * static_cast<double>(index % root_));
+        if(scan_z_) {
+            offset.SetZ(voxel_.z() * static_cast<double>((index / root_) % root_));
+        }
+    } else {
+        offset.SetZ(voxel_.z() * static_cast<double>(index % root_));
     }
+    return offset;
+}
+
+ROOT::Math::XYZVector DepositionPointChargeModule::CellOffset(unsigned int point) const {
+    // Cells are arranged on a grid centered around the scanned pixel volume
+    auto cell_x = static_cast<int>(point % cells_x_) - static_cast<int>(cells_x_ / 2);
+    auto cell_y = static_cast<int>(point / cells_x_) - static_cast<int>(cells_y_ / 2);
+    return {static_cast<double>(cell_x * static_cast<int>(point_spacing_)) * detector_model_->getPixelSize().x(),
+            static_cast<double>(cell_y * static_cast<int>(point_spacing_)) * detector_model_->getPixelSize().y(),
+            0};
 }
 
 void DepositionPointChargeModule::finalize() {
@@ -293,11 +373,9 @@ void DepositionPointChargeModule::finalize() {
     }
 }
 
-void DepositionPointChargeModule::DepositPoint(Event* event, const ROOT::Math::XYZPoint& position) {
-    // Vector of deposited charges and their "MCParticle"
-    std::vector<DepositedCharge> charges;
-    std::vector<MCParticle> mcparticles;
-
+void DepositionPointChargeModule::DepositPoint(const ROOT::Math::XYZPoint& position,
+                                               std::vector<MCParticle>& mcparticles,
+                                               std::vector<DepositedCharge>& charges) {
     LOG(DEBUG) << "Position (local coordinates): " << Units::display(position, {"um", "mm"});
     // Cross-check calculated position to be within sensor:
     if(!detector_model_->isWithinSensor(position)) {
@@ -318,20 +396,11 @@ void DepositionPointChargeModule::DepositPoint(Event* event, const ROOT::Math::X
     charges.emplace_back(position, position_global, CarrierType::HOLE, carriers_, 0., 0., &(mcparticles.back()));
     LOG(DEBUG) << "Deposited " << carriers_ << " charge carriers of both types at global position "
                << Units::display(position_global, {"um", "mm"}) << " in detector " << detector_->getName();
-
-    // Dispatch the messages to the framework
-    auto mcparticle_message = std::make_shared<MCParticleMessage>(std::move(mcparticles), detector_);
-    messenger_->dispatchMessage(this, std::move(mcparticle_message), event);
-
-    auto deposit_message = std::make_shared<DepositedChargeMessage>(std::move(charges), detector_);
-    messenger_->dispatchMessage(this, std::move(deposit_message), event);
 }
 
-void DepositionPointChargeModule::DepositLine(Event* event, const ROOT::Math::XYZPoint& position) {
-    // Vector of deposited charges and their "MCParticle"
-    std::vector<DepositedCharge> charges;
-    std::vector<MCParticle> mcparticles;
-
+void DepositionPointChargeModule::DepositLine(const ROOT::Math::XYZPoint& position,
+                                              std::vector<MCParticle>& mcparticles,
+                                              std::vector<DepositedCharge>& charges) {
     // Cross-check calculated position to be within sensor:
     if(!detector_model_->isWithinSensor(position)) {
         LOG(DEBUG) << "Requested position is outside active sensor volume.";
@@ -371,9 +440,9 @@ void DepositionPointChargeModule::DepositLine(Event* event, const ROOT::Math::XY
         if(output_plots_) {
             auto [xpixel, ypixel] = detector_model_->getPixelIndex(position_local);
             auto inPixelPos = position_local - detector_model_->getPixelCenter(xpixel, ypixel);
-            auto in_pixel_um_x = static_cast<double>(Units::convert(inPixelPos.x(), "um"));
-            auto in_pixel_um_y = static_cast<double>(Units::convert(inPixelPos.y(), "um"));
-            auto in_pixel_um_z = static_cast<double>(Units::convert(position_local.z(), "um"));
+            auto in_pixel_um_x = inPixelPos.x() / units::um;
+            auto in_pixel_um_y = inPixelPos.y() / units::um;
+            auto in_pixel_um_z = position_local.z() / units::um;
             deposition_position_xy->Fill(in_pixel_um_x, in_pixel_um_y);
             deposition_position_xz->Fill(in_pixel_um_x, in_pixel_um_z);
             deposition_position_yz->Fill(in_pixel_um_y, in_pixel_um_z);
@@ -381,13 +450,6 @@ void DepositionPointChargeModule::DepositLine(Event* event, const ROOT::Math::XY
 
         position_local += step_size_ * mip_direction_;
     }
-
-    // Dispatch the messages to the framework
-    auto mcparticle_message = std::make_shared<MCParticleMessage>(std::move(mcparticles), detector_);
-    messenger_->dispatchMessage(this, std::move(mcparticle_message), event);
-
-    auto deposit_message = std::make_shared<DepositedChargeMessage>(std::move(charges), detector_);
-    messenger_->dispatchMessage(this, std::move(deposit_message), event);
 }
 
 std::tuple<ROOT::Math::XYZPoint, ROOT::Math::XYZPoint>
@@ -9,11 +9,15 @@
  * SPDX-License-Identifier: MIT
  */
 
+#include <cstdint>
 #include <string>
+#include <vector>
 
 #include <TH2D.h>
 
 #include "core/module/Module.hpp"
+#include "objects/DepositedCharge.hpp"
+#include "objects/MCParticle.hpp"
 
 namespace allpix {
     /**
@@ -65,19 +69,41 @@ namespace allpix {
         void finalize() override;
 
     private:
+        /**
+         * @brief Helper function to calculate the position of a point of the scan
+         * @param index Index of the point in the scan, counting all points of all events
+         * @return Position of the point in local coordinates, relative to the reference of the scanned pixel volume
+         */
+        ROOT::Math::XYZVector ScanOffset(uint64_t index) const;
+
+        /**
+         * @brief Helper function to calculate the offset of the pixel cell a point of a multi-point event is deposited in
+         * @param point Index of the point within the event
+         * @return Offset of the pixel cell with respect to the scanned pixel volume
+         */
+        ROOT::Math::XYZVector CellOffset(unsigned int point) const;
+
         /**
          * @brief Helper function to deposit charges at a single point
-         * @param event Pointer to current event
-         * @param position
+         * @param position Position of the deposit in local coordinates
+         * @param mcparticles Vector of MCParticles to add the particle of the deposit to
+         * @param charges Vector of deposited charges to add the charge carriers to
+         * @warning The MCParticle vector needs to have sufficient capacity to not invalidate the references of the charges
          */
-        void DepositPoint(Event*, const ROOT::Math::XYZPoint& position);
+        void DepositPoint(const ROOT::Math::XYZPoint& position,
+                          std::vector<MCParticle>& mcparticles,
+                          std::vector<DepositedCharge>& charges);
 
         /**
          * @brief Helper function to deposit charges along a line
-         * @param event Pointer to current event
-         * @param position
+         * @param position Position the line passes through in local coordinates
+         * @param mcparticles Vector of MCParticles to add the particle of the deposit to
+         * @param charges Vector of deposited charges to add the charge carriers to
+         * @warning The MCParticle vector needs to have sufficient capacity to not invalidate the references of the charges
          */
-        void DepositLine(Event*, const ROOT::Math::XYZPoint& position);
+        void DepositLine(const ROOT::Math::XYZPoint& position,
+                         std::vector<MCParticle>& mcparticles,
+                         std::vector<DepositedCharge>& charges);
 
         /**
          * @brief Finds and returns the points where a line with mip_direction through a given point intersects the sensor
@@ -104,6 +130,12 @@ namespace allpix {
         ROOT::Math::XYZVector mip_direction_{};
         std::vector<std::string> scan_coordinates_{};
         size_t no_of_coordinates_;
+        ROOT::Math::XYZPoint scan_reference_{};
+
+        // Multiple scan points per event, each deposited in a separate pixel cell
+        unsigned int points_per_event_{};
+        unsigned int point_spacing_{};
+        unsigned int cells_x_{}, cells_y_{};
 
         bool scan_x_;
         bool scan_y_;
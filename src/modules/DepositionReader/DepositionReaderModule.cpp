@@ -11,12 +11,19 @@
 
 #include "DepositionReaderModule.hpp"
 
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <future>
 #include <string>
 #include <utility>
 
 #include "core/utils/distributions.h"
 #include "core/utils/log.h"
+#include "core/utils/unit_constants.h"
 #include "physics/MaterialProperties.hpp"
+#include "tools/input_files.h"
 
 using namespace allpix;
 
@@ -25,6 +32,10 @@ DepositionReaderModule::DepositionReaderModule(Configuration& config, Messenger*
     // Enable multithreading of this module if multithreading is enabled
     allow_multithreading();
 
+    // Declare the messages dispatched by this module
+    declare_output<MCParticleMessage>();
+    declare_output<DepositedChargeMessage>();
+
     config_.setDefault<size_t>("detector_name_chars", 0);
     config_.setDefault<std::string>("unit_length", "mm");
     config_.setDefault<std::string>("unit_time", "ns");
@@ -32,6 +43,8 @@ DepositionReaderModule::DepositionReaderModule(Configuration& config, Messenger*
     config_.setDefault<bool>("require_sequential_events", true);
     config_.setDefault<bool>("assign_timestamps", true);
     config_.setDefault<bool>("create_mcparticles", true);
+    config_.setDefault<bool>("indexed", false);
+    config_.setDefault<int64_t>("tree_cache_size", 32 * 1024 * 1024);
 
     config_.setDefaultArray<std::string>("branch_names",
                                          {"event",
@@ -58,6 +71,12 @@ DepositionReaderModule::DepositionReaderModule(Configuration& config, Messenger*
     require_sequential_events_ = config_.get<bool>("require_sequential_events");
     time_available_ = config_.get<bool>("assign_timestamps");
     create_mcparticles_ = config.get<bool>("create_mcparticles");
+    indexed_ = config_.get<bool>("indexed");
+
+    // Events can be read in any order from the index
+    if(indexed_) {
+        waive_sequence_requirement();
+    }
 
     output_plots_ = config_.get<bool>("output_plots");
 }
@@ -71,23 +90,59 @@ void DepositionReaderModule::initialize() {
         LOG(WARNING) << "No MCParticle objects will be produced";
     }
 
+    // Resolve the input files, multiple files are combined through the event index
+    auto files = get_input_files(config_, "file_name", file_model_ == FileModel::CSV ? "csv" : "root");
+    if(files.size() > 1 && !indexed_) {
+        throw InvalidCombinationError(
+            config_, {"file_name", "indexed"}, "multiple input files can only be read with indexed reading");
+    }
+
     // Check which file type we want to read:
     if(file_model_ == FileModel::CSV) {
         // Open the file with the objects
-        auto file_path = config_.getPathWithExtension("file_name", "csv", true);
-        input_file_ = std::make_unique<std::ifstream>(file_path);
-        if(!input_file_->is_open()) {
-            throw InvalidValueError(config_, "file_name", "could not open input file");
+        if(indexed_) {
+            for(const auto& file_path : files) {
+                try {
+                    input_files_mapped_.push_back(std::make_unique<MappedFile>(file_path));
+                } catch(std::runtime_error& e) {
+                    throw InvalidValueError(config_, "file_name", "could not open input file: " + std::string(e.what()));
+                }
+            }
+
+            // Index all files in parallel and number their events in the order of the files
+            std::vector<std::future<EventIndex>> indices;
+            for(size_t file = 0; file < input_files_mapped_.size(); ++file) {
+                indices.push_back(std::async(std::launch::async, [this, file]() { return index_csv(file); }));
+            }
+            uint64_t first_event = 0;
+            for(auto& index : indices) {
+                merge_index(index.get(), first_event);
+            }
+            LOG(INFO) << "Indexed " << event_index_.size() << " events with deposits in "
+                      << (files.size() > 1 ? std::to_string(files.size()) + " input files" : "input file");
+        } else {
+            input_file_ = std::make_unique<std::ifstream>(files.front());
+            if(!input_file_->is_open()) {
+                throw InvalidValueError(config_, "file_name", "could not open input file");
+            }
         }
     } else if(file_model_ == FileModel::ROOT) {
-        auto file_path = config_.getPathWithExtension("file_name", "root", true);
-        input_file_root_ = std::make_unique<TFile>(file_path.c_str(), "READ");
-        if(!input_file_root_->IsOpen()) {
-            throw InvalidValueError(config_, "file_name", "could not open input file");
-        }
-        input_file_root_->cd();
         auto tree = config_.get<std::string>("tree_name");
-        tree_reader_ = std::make_shared<TTreeReader>(tree.c_str(), input_file_root_.get());
+        if(files.size() > 1) {
+            // Read the trees of all files as a single sequence of entries
+            input_chain_ = std::make_unique<TChain>(tree.c_str());
+            for(const auto& file_path : files) {
+                input_chain_->Add(file_path.c_str());
+            }
+            tree_reader_ = std::make_shared<TTreeReader>(input_chain_.get());
+        } else {
+            input_file_root_ = std::make_unique<TFile>(files.front().c_str(), "READ");
+            if(!input_file_root_->IsOpen()) {
+                throw InvalidValueError(config_, "file_name", "could not open input file");
+            }
+            input_file_root_->cd();
+            tree_reader_ = std::make_shared<TTreeReader>(tree.c_str(), input_file_root_.get());
+        }
         if(tree_reader_->GetEntryStatus() == TTreeReader::kEntryNoTree) {
             throw InvalidValueError(config_, "tree_name", "could not open tree");
         }
@@ -163,6 +218,10 @@ void DepositionReaderModule::initialize() {
             check_tree_reader(track_id_);
             check_tree_reader(parent_id_);
         }
+
+        if(indexed_) {
+            index_root(files);
+        }
     }
 
     // If requested, prepare output plots
@@ -226,32 +285,39 @@ void DepositionReaderModule::run(Event* event) {
     std::map<std::shared_ptr<Detector>, std::map<int, size_t>> track_id_to_mcparticle;
 
     LOG(DEBUG) << "Start reading event " << event_num;
-    int64_t curr_event_id = -1;
     bool end_of_run = false;
     std::string eof_message;
 
-    while(true) {
-        bool read_status = false;
-        ROOT::Math::XYZPoint global_position;
-        std::string volume;
-        double energy = NAN, time = NAN;
-        int pdg_code = 0, track_id = 0, parent_id = 0;
-
-        try {
-            if(file_model_ == FileModel::CSV) {
-                read_status = read_csv(event_num, volume, global_position, time, energy, pdg_code, track_id, parent_id);
-            } else if(file_model_ == FileModel::ROOT) {
-                read_status = read_root(
-                    event_num, curr_event_id, volume, global_position, time, energy, pdg_code, track_id, parent_id);
+    // Read all deposits of the event before processing them
+    std::vector<Deposit> deposits_read;
+    if(indexed_) {
+        deposits_read = read_indexed(event_num);
+    } else {
+        int64_t curr_event_id = -1;
+        while(true) {
+            bool read_status = false;
+            Deposit deposit;
+
+            try {
+                if(file_model_ == FileModel::CSV) {
+                    read_status = read_csv(event_num, deposit);
+                } else if(file_model_ == FileModel::ROOT) {
+                    read_status = read_root(event_num, curr_event_id, deposit);
+                }
+            } catch(EndOfRunException& e) {
+                end_of_run = true;
+                eof_message = e.what();
             }
-        } catch(EndOfRunException& e) {
-            end_of_run = true;
-            eof_message = e.what();
-        }
 
-        if(!read_status || end_of_run) {
-            break;
+            if(!read_status || end_of_run) {
+                break;
+            }
+            deposits_read.push_back(std::move(deposit));
         }
+    }
+
+    for(auto& deposit : deposits_read) {
+        auto& [volume, global_position, time, energy, pdg_code, track_id, parent_id] = deposit;
 
         // Trim detector name if requested:
         if(volume_chars_ != 0) {
@@ -260,8 +326,8 @@ void DepositionReaderModule::run(Event* event) {
         }
 
         auto detectors = geo_manager_->getDetectors();
-        auto pos = std::find_if(detectors.begin(), detectors.end(), [volume](const std::shared_ptr<Detector>& d) {
-            return d->getName() == volume;
+        auto pos = std::find_if(detectors.begin(), detectors.end(), [&deposit](const std::shared_ptr<Detector>& d) {
+            return d->getName() == deposit.volume;
         });
         if(pos == detectors.end()) {
             LOG(TRACE) << "Ignored detector \"" << volume << "\", not found in current simulation";
@@ -318,7 +384,7 @@ void DepositionReaderModule::run(Event* event) {
         }
 
         particles_to_deposits[detector].push_back(track_id);
-    };
+    }
 
     LOG(INFO) << "Finished reading event " << event;
 
@@ -411,7 +477,7 @@ void DepositionReaderModule::run(Event* event) {
 
             // Fill output plots if requested:
             if(output_plots_) {
-                double charge = static_cast<double>(Units::convert(total_deposits, "ke"));
+                double charge = total_deposits / units::ke;
                 charge_per_event_[detector]->Fill(charge);
             }
         }
@@ -432,15 +498,7 @@ void DepositionReaderModule::finalize() {
         }
     }
 }
-bool DepositionReaderModule::read_root(uint64_t event_num,
-                                       int64_t& curr_event_id,
-                                       std::string& volume,
-                                       ROOT::Math::XYZPoint& position,
-                                       double& time,
-                                       double& energy,
-                                       int& pdg_code,
-                                       int& track_id,
-                                       int& parent_id) {
+bool DepositionReaderModule::read_root(uint64_t event_num, int64_t& curr_event_id, Deposit& deposit) {
 
     auto status = tree_reader_->GetEntryStatus();
     if(status == TTreeReader::kEntryNotFound || status == TTreeReader::kEntryBeyondEnd) {
@@ -469,37 +527,34 @@ bool DepositionReaderModule::read_root(uint64_t event_num,
         }
     }
 
+    read_root_entry(deposit);
+
+    // Return and advance to next tree entry:
+    tree_reader_->Next();
+    return true;
+}
+
+void DepositionReaderModule::read_root_entry(Deposit& deposit) {
     // Read detector name
-    volume = std::string(static_cast<char*>(volume_->GetAddress()));
+    deposit.volume = std::string(static_cast<char*>(volume_->GetAddress()));
 
     // Read other information, interpret in framework units:
-    position = ROOT::Math::XYZPoint(
+    deposit.position = ROOT::Math::XYZPoint(
         Units::get(*px_->Get(), unit_length_), Units::get(*py_->Get(), unit_length_), Units::get(*pz_->Get(), unit_length_));
 
     // Attempt to read time only if available:
-    time = (time_available_ ? Units::get(*time_->Get(), unit_time_) : 0);
-    energy = Units::get(*edep_->Get(), unit_energy_);
+    deposit.time = (time_available_ ? Units::get(*time_->Get(), unit_time_) : 0);
+    deposit.energy = Units::get(*edep_->Get(), unit_energy_);
 
     // Read PDG code and track ids
-    pdg_code = (*pdg_code_->Get());
+    deposit.pdg_code = (*pdg_code_->Get());
     if(create_mcparticles_) {
-        track_id = (*track_id_->Get());
-        parent_id = (*parent_id_->Get());
+        deposit.track_id = (*track_id_->Get());
+        deposit.parent_id = (*parent_id_->Get());
     }
-
-    // Return and advance to next tree entry:
-    tree_reader_->Next();
-    return true;
 }
 
-bool DepositionReaderModule::read_csv(uint64_t event_num,
-                                      std::string& volume,
-                                      ROOT::Math::XYZPoint& position,
-                                      double& time,
-                                      double& energy,
-                                      int& pdg_code,
-                                      int& track_id,
-                                      int& parent_id) {
+bool DepositionReaderModule::read_csv(uint64_t event_num, Deposit& deposit) {
 
     std::string line, tmp;
     do { // NOLINT
@@ -529,6 +584,7 @@ bool DepositionReaderModule::read_csv(uint64_t event_num,
 
     std::istringstream ls(line);
     double px = NAN, py = NAN, pz = NAN;
+    auto& [volume, position, time, energy, pdg_code, track_id, parent_id] = deposit;
 
     std::getline(ls, tmp, ',');
     std::istringstream(tmp) >> pdg_code;
@@ -566,3 +622,237 @@ bool DepositionReaderModule::read_csv(uint64_t event_num,
 
     return true;
 }
+
+DepositionReaderModule::EventIndex DepositionReaderModule::index_csv(size_t file) const {
+    const auto* data = input_files_mapped_[file]->data();
+    auto size = input_files_mapped_[file]->size();
+
+    // Deposits preceding the first event header belong to the first event
+    EventIndex index;
+    uint64_t event_id = 0;
+    for(size_t pos = 0; pos < size;) {
+        const auto* newline = static_cast<const char*>(std::memchr(data + pos, '\n', size - pos));
+        auto end = (newline == nullptr ? size : static_cast<size_t>(newline - data));
+        auto next = std::min(end + 1, size);
+
+        auto first = pos;
+        while(first < end && std::isspace(static_cast<unsigned char>(data[first])) != 0) {
+            ++first;
+        }
+        if(first < end && data[first] == 'E') {
+            // Skip the label of the event header and read the event number following it
+            const auto* number = std::find_if(
+                data + first, data + end, [](char c) { return std::isspace(static_cast<unsigned char>(c)) != 0; });
+            while(number < data + end && std::isspace(static_cast<unsigned char>(*number)) != 0) {
+                ++number;
+            }
+            auto [ptr, ec] = std::from_chars(number, data + end, event_id);
+            if(ec != std::errc()) {
+                auto header = allpix::trim(std::string(data + first, end - first));
+                throw InvalidValueError(config_, "file_name", "invalid event header \"" + header + "\"");
+            }
+            LOG(TRACE) << "Found header of event " << event_id << " at offset " << pos;
+        } else if(first < end && data[first] != '#') {
+            // Merge consecutive deposit lines into a single range
+            auto& ranges = index[event_id];
+            if(!ranges.empty() && ranges.back().end == pos) {
+                ranges.back().end = next;
+            } else {
+                ranges.push_back({file, pos, next});
+            }
+        }
+        pos = next;
+    }
+    return index;
+}
+
+DepositionReaderModule::EventIndex DepositionReaderModule::index_tree(TTreeReader& reader, TTreeReaderValue<int>& event) {
+    // The tree reader only reads branches on access, such that only the event branch is read here
+    EventIndex index;
+    for(Long64_t entry = 0; reader.SetEntry(entry) == TTreeReader::kEntryValid; ++entry) {
+        auto& ranges = index[static_cast<uint64_t>(*event.Get())];
+        auto position = static_cast<uint64_t>(entry);
+        if(!ranges.empty() && ranges.back().end == position) {
+            ++ranges.back().end;
+        } else {
+            ranges.push_back({0, position, position + 1});
+        }
+    }
+    return index;
+}
+
+void DepositionReaderModule::index_root(const std::vector<std::filesystem::path>& files) {
+    uint64_t first_event = 0;
+    if(files.size() == 1) {
+        merge_index(index_tree(*tree_reader_, *event_), first_event);
+    } else {
+        // Index the trees of all files in parallel, each through its own reader of the event branch
+        auto tree_name = config_.get<std::string>("tree_name");
+        std::string branch_name = event_->GetBranchName();
+        std::vector<std::future<std::pair<EventIndex, uint64_t>>> indices;
+        for(const auto& file_path : files) {
+            indices.push_back(std::async(std::launch::async, [this, file_path, tree_name, branch_name]() {
+                TFile file(file_path.c_str(), "READ");
+                TTreeReader reader(tree_name.c_str(), &file);
+                if(!file.IsOpen() || reader.GetTree() == nullptr) {
+                    throw InvalidValueError(config_, "file_name", "could not open tree in input file " + file_path.string());
+                }
+                TTreeReaderValue<int> event(reader, branch_name.c_str());
+                auto index = index_tree(reader, event);
+                return std::make_pair(std::move(index), static_cast<uint64_t>(reader.GetTree()->GetEntries()));
+            }));
+        }
+
+        // Shift the entries of every tree to their position in the chain of all trees
+        uint64_t first_entry = 0;
+        for(auto& future : indices) {
+            auto [index, entries] = future.get();
+            for(auto& event : index) {
+                for(auto& range : event.second) {
+                    range.begin += first_entry;
+                    range.end += first_entry;
+                }
+            }
+            merge_index(std::move(index), first_event);
+            first_entry += entries;
+        }
+    }
+
+    // Events are read as contiguous blocks of entries, which are prefetched through the tree cache
+    auto* tree = tree_reader_->GetTree();
+    tree->SetCacheSize(config_.get<int64_t>("tree_cache_size"));
+    LOG(INFO) << "Indexed " << event_index_.size() << " events with deposits in tree " << tree->GetName();
+}
+
+void DepositionReaderModule::merge_index(EventIndex index, uint64_t& first_event) {
+    if(index.empty()) {
+        return;
+    }
+    auto last_event = index.rbegin()->first;
+    for(auto& [event_id, ranges] : index) {
+        auto& merged = event_index_[first_event + event_id];
+        merged.insert(merged.end(), ranges.begin(), ranges.end());
+    }
+    first_event += last_event + 1;
+}
+
+std::optional<double> DepositionReaderModule::estimate_event_cost(uint64_t event_num) const {
+    if(!indexed_) {
+        return std::nullopt;
+    }
+
+    // Deposits are parsed and propagated in proportion to the size of the input data of the event
+    double cost = 0;
+    auto ranges = event_index_.find(event_num - 1);
+    if(ranges != event_index_.end()) {
+        for(const auto& range : ranges->second) {
+            cost += static_cast<double>(range.end - range.begin);
+        }
+    }
+    return cost;
+}
+
+std::vector<DepositionReaderModule::Deposit> DepositionReaderModule::read_indexed(uint64_t event_num) {
+    // Event numbers of the input data start at zero, the ones of the framework at one
+    if(event_index_.empty() || event_num - 1 > event_index_.rbegin()->first) {
+        auto events = (event_index_.empty() ? 0 : event_index_.rbegin()->first + 1);
+        throw EndOfRunException("Requesting end of run, input file only contains data for " + std::to_string(events) +
+                                " events");
+    }
+
+    std::vector<Deposit> deposits;
+    auto ranges = event_index_.find(event_num - 1);
+    if(ranges == event_index_.end()) {
+        LOG(DEBUG) << "No deposits found for event " << event_num;
+        return deposits;
+    }
+
+    if(file_model_ == FileModel::CSV) {
+        // The mapped files are only read, such that all events can be parsed concurrently
+        for(const auto& range : ranges->second) {
+            const auto* data = input_files_mapped_[range.file]->data();
+            const auto* end = data + range.end;
+            for(const auto* pos = data + range.begin; pos < end;) {
+                const auto* line_end = std::find(pos, end, '\n');
+                while(pos < line_end && std::isspace(static_cast<unsigned char>(*pos)) != 0) {
+                    ++pos;
+                }
+                if(pos < line_end && *pos != '#') {
+                    Deposit deposit;
+                    if(!parse_csv_line(pos, line_end, deposit)) {
+                        throw InvalidValueError(config_,
+                                                "file_name",
+                                                "invalid deposit \"" + allpix::trim(std::string(pos, line_end)) + "\"");
+                    }
+                    deposits.push_back(std::move(deposit));
+                }
+                pos = line_end + 1;
+            }
+        }
+    } else if(file_model_ == FileModel::ROOT) {
+        // The tree reader can only be used from a single thread at a time
+        std::lock_guard<std::mutex> lock(tree_mutex_);
+        for(const auto& range : ranges->second) {
+            for(auto entry = range.begin; entry < range.end; ++entry) {
+                auto status = tree_reader_->SetEntry(static_cast<Long64_t>(entry));
+                if(status != TTreeReader::kEntryValid) {
+                    throw EndOfRunException("Problem reading from tree, error: " + std::to_string(static_cast<int>(status)));
+                }
+                Deposit deposit;
+                read_root_entry(deposit);
+                deposits.push_back(std::move(deposit));
+            }
+        }
+    }
+    LOG(TRACE) << "Read " << deposits.size() << " deposits of event " << event_num << " from index";
+    return deposits;
+}
+
+bool DepositionReaderModule::parse_csv_line(const char* begin, const char* end, Deposit& deposit) const {
+    const auto* pos = begin;
+    auto skip_whitespace = [&pos, end]() {
+        while(pos != end && std::isspace(static_cast<unsigned char>(*pos)) != 0) {
+            ++pos;
+        }
+    };
+
+    // Parse the next field as number and advance past its separator
+    auto parse_number = [&pos, end, &skip_whitespace](auto& value) {
+        skip_whitespace();
+        // Explicit positive signs are not accepted by from_chars
+        if(pos != end && *pos == '+') {
+            ++pos;
+        }
+        auto [ptr, ec] = std::from_chars(pos, end, value);
+        if(ec != std::errc()) {
+            return false;
+        }
+        pos = ptr;
+        skip_whitespace();
+        if(pos != end && *pos++ != ',') {
+            return false;
+        }
+        return true;
+    };
+
+    double px = NAN, py = NAN, pz = NAN;
+    if(!parse_number(deposit.pdg_code) || (time_available_ && !parse_number(deposit.time)) ||
+       !parse_number(deposit.energy) || !parse_number(px) || !parse_number(py) || !parse_number(pz)) {
+        return false;
+    }
+
+    const auto* separator = std::find(pos, end, ',');
+    deposit.volume = allpix::trim(std::string(pos, separator));
+    pos = (separator == end ? end : separator + 1);
+
+    if(create_mcparticles_ && (!parse_number(deposit.track_id) || !parse_number(deposit.parent_id))) {
+        return false;
+    }
+
+    // Convert to framework units
+    deposit.position =
+        ROOT::Math::XYZPoint(Units::get(px, unit_length_), Units::get(py, unit_length_), Units::get(pz, unit_length_));
+    deposit.time = (time_available_ ? Units::get(deposit.time, unit_time_) : 0);
+    deposit.energy = Units::get(deposit.energy, unit_energy_);
+    return true;
+}
@@ -14,10 +14,17 @@
  * Refer to the User's Manual for more details.
  */
 
+#include <filesystem>
 #include <fstream>
 #include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include <TChain.h>
 #include <TFile.h>
 #include <TH1D.h>
 #include <TTreeReader.h>
@@ -28,6 +35,7 @@
 #include "core/messenger/Messenger.hpp"
 #include "core/module/Module.hpp"
 #include "objects/DepositedCharge.hpp"
+#include "tools/mapped_file.h"
 
 namespace allpix {
     /**
@@ -48,6 +56,19 @@ namespace allpix {
             CSV,  ///< Comma-separated value files
         };
 
+        /**
+         * @brief Energy deposit as read from the input file, in framework units
+         */
+        struct Deposit {
+            std::string volume;
+            ROOT::Math::XYZPoint position;
+            double time{};
+            double energy{};
+            int pdg_code{};
+            int track_id{};
+            int parent_id{};
+        };
+
     public:
         /**
          * @brief Constructor for this unique module
@@ -77,9 +98,26 @@ namespace allpix {
         GeometryManager* geo_manager_;
         Messenger* messenger_;
 
-        // File containing the input data
+        // File containing the input data, multiple files are only read indexed
         std::unique_ptr<std::ifstream> input_file_;
+        std::vector<std::unique_ptr<MappedFile>> input_files_mapped_;
         std::unique_ptr<TFile> input_file_root_;
+        std::unique_ptr<TChain> input_chain_;
+
+        /**
+         * @brief Range of the input belonging to an event
+         */
+        struct InputRange {
+            size_t file{};         ///< Position of the mapped CSV file, unused for ROOT trees
+            std::uint64_t begin{}; ///< Byte offset in the CSV file or entry number in the chain of ROOT trees
+            std::uint64_t end{};   ///< End of the range, exclusive
+        };
+        using EventIndex = std::map<uint64_t, std::vector<InputRange>>;
+
+        // Ranges of the input belonging to every event, with the events of multiple files numbered in the order of the files
+        EventIndex event_index_;
+        // Mutex protecting the tree reader when reading events from the index
+        std::mutex tree_mutex_;
 
         // Helper to create and check tree branches
         template <typename T> void create_tree_reader(std::shared_ptr<T>& branch_ptr, const std::string& name);
@@ -105,25 +143,67 @@ namespace allpix {
         std::string unit_length_{}, unit_time_{}, unit_energy_{};
         bool output_plots_{};
 
-        bool require_sequential_events_{}, create_mcparticles_{}, time_available_{};
-
-        bool read_csv(uint64_t event_num,
-                      std::string& volume,
-                      ROOT::Math::XYZPoint& position,
-                      double& time,
-                      double& energy,
-                      int& pdg_code,
-                      int& track_id,
-                      int& parent_id);
-        bool read_root(uint64_t event_num,
-                       int64_t& curr_event_id,
-                       std::string& volume,
-                       ROOT::Math::XYZPoint& position,
-                       double& time,
-                       double& energy,
-                       int& pdg_code,
-                       int& track_id,
-                       int& parent_id);
+        bool require_sequential_events_{}, create_mcparticles_{}, time_available_{}, indexed_{};
+
+        bool read_csv(uint64_t event_num, Deposit& deposit);
+        bool read_root(uint64_t event_num, int64_t& curr_event_id, Deposit& deposit);
+
+        /**
+         * @brief Read the deposit of the current entry of the tree reader
+         * @param deposit Deposit to be filled
+         */
+        void read_root_entry(Deposit& deposit);
+
+        /**
+         * @brief Build the index of the events in a memory-mapped CSV file
+         * @param file Position of the mapped file
+         * @return Index of the events with the event numbers of the file
+         */
+        EventIndex index_csv(size_t file) const;
+
+        /**
+         * @brief Build the index of the events in a ROOT tree
+         * @param reader Tree reader of the tree
+         * @param event Event number branch of the tree
+         * @return Index of the events with the event numbers and entry numbers of the tree
+         */
+        static EventIndex index_tree(TTreeReader& reader, TTreeReaderValue<int>& event);
+
+        /**
+         * @brief Build the index of the events in the ROOT trees of all files and set up the tree cache for random access
+         * @param files Paths of the input files
+         */
+        void index_root(const std::vector<std::filesystem::path>& files);
+
+        /**
+         * @brief Add the index of a file to the index of all events, numbering its events after those of previous files
+         * @param index Index of the file
+         * @param first_event Event number of the first event of the file, advanced past its last event
+         */
+        void merge_index(EventIndex index, uint64_t& first_event);
+
+        /**
+         * @brief Read all deposits of an event from the index, independent of the events read before
+         * @param event_num Event number of the framework
+         * @return List of deposits of the event
+         * @throws EndOfRunException If the event is beyond the last event of the input file
+         */
+        std::vector<Deposit> read_indexed(uint64_t event_num);
+
+        /**
+         * @brief Estimate the cost of an event from the size of its indexed input data
+         * @return Number of entries for ROOT trees or bytes for CSV files of the event, empty if the input is not indexed
+         */
+        std::optional<double> estimate_event_cost(uint64_t event_num) const override;
+
+        /**
+         * @brief Parse a single deposit from a line of a CSV file without stream overhead
+         * @param begin Begin of the line, without leading whitespace
+         * @param end End of the line
+         * @param deposit Deposit to be filled
+         * @return True if the line could be parsed
+         */
+        bool parse_csv_line(const char* begin, const char* end, Deposit& deposit) const;
 
         // Vector of histogram pointers for debugging plots
         std::map<std::shared_ptr<Detector>, Histogram<TH1D>> charge_per_event_;
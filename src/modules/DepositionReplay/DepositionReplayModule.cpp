@@ -0,0 +1,130 @@
+/**
+ * @file
+ * @brief Implementation of module replaying deposited charges and Monte Carlo particles from compact replay files
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "DepositionReplayModule.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "core/config/exceptions.h"
+#include "core/module/exceptions.h"
+#include "core/utils/log.h"
+
+using namespace allpix;
+
+namespace {
+    // Get a point from a column of consecutive coordinates
+    ROOT::Math::XYZPoint get_point(const std::vector<double>& column, size_t index) {
+        return {column[3 * index], column[3 * index + 1], column[3 * index + 2]};
+    }
+} // namespace
+
+DepositionReplayModule::DepositionReplayModule(Configuration& config, Messenger* messenger, GeometryManager* geo_manager)
+    : Module(config), messenger_(messenger), geo_manager_(geo_manager) {
+    // Enable multithreading of this module if multithreading is enabled
+    allow_multithreading();
+
+    // Declare the messages dispatched by this module
+    declare_output<MCParticleMessage>();
+    declare_output<DepositedChargeMessage>();
+}
+
+void DepositionReplayModule::initialize() {
+    auto file_path = config_.getPathWithExtension("file_name", "replay", true);
+    try {
+        reader_ = std::make_unique<DepositReplayReader>(file_path);
+    } catch(std::runtime_error& e) {
+        throw InvalidValueError(config_, "file_name", "could not read replay file: " + std::string(e.what()));
+    }
+
+    for(const auto& name : reader_->getDetectors()) {
+        if(geo_manager_->hasDetector(name)) {
+            detectors_.push_back(geo_manager_->getDetector(name));
+        } else {
+            LOG(WARNING) << "Detector " << name << " of the replay file is not part of the geometry, ignoring its deposits";
+            detectors_.emplace_back();
+        }
+    }
+    LOG(INFO) << "Opened replay file with " << reader_->getEventCount() << " events of " << detectors_.size()
+              << " detectors";
+}
+
+void DepositionReplayModule::run(Event* event) {
+    if(event->number > reader_->getLastEvent()) {
+        throw EndOfRunException("Requesting end of run because replay file only contains data for " +
+                                std::to_string(reader_->getLastEvent()) + " events");
+    }
+
+    std::vector<DepositReplayRecord> records;
+    try {
+        records = reader_->read(event->number);
+    } catch(std::runtime_error& e) {
+        throw ModuleError("Could not read event " + std::to_string(event->number) +
+                          " from replay file: " + std::string(e.what()));
+    }
+
+    for(const auto& record : records) {
+        const auto& detector = detectors_[record.detector];
+        if(detector == nullptr) {
+            continue;
+        }
+
+        std::vector<MCParticle> mc_particles;
+        mc_particles.reserve(record.getParticleCount());
+        for(size_t i = 0; i < record.getParticleCount(); ++i) {
+            mc_particles.emplace_back(get_point(record.particle_local_start, i),
+                                      get_point(record.particle_global_start, i),
+                                      get_point(record.particle_local_end, i),
+                                      get_point(record.particle_global_end, i),
+                                      record.particle_id[i],
+                                      record.particle_local_time[i],
+                                      record.particle_global_time[i]);
+            mc_particles.back().setTotalEnergyStart(record.particle_total_energy[i]);
+            mc_particles.back().setKineticEnergyStart(record.particle_kinetic_energy[i]);
+            mc_particles.back().setTotalDepositedCharge(record.particle_charge[i]);
+        }
+        for(size_t i = 0; i < record.getParticleCount(); ++i) {
+            if(record.particle_parent[i] >= 0) {
+                mc_particles[i].setParent(&mc_particles[static_cast<size_t>(record.particle_parent[i])]);
+            }
+        }
+
+        // The particles are referenced by the deposits, such that the message has to be created first
+        auto mc_particle_message = std::make_shared<MCParticleMessage>(std::move(mc_particles), detector);
+        if((record.flags & DepositReplayRecord::has_particles) != 0) {
+            messenger_->dispatchMessage(this, mc_particle_message, event);
+        }
+
+        if((record.flags & DepositReplayRecord::has_deposits) != 0) {
+            std::vector<DepositedCharge> deposits;
+            deposits.reserve(record.getDepositCount());
+            for(size_t i = 0; i < record.getDepositCount(); ++i) {
+                const MCParticle* mc_particle = nullptr;
+                if(record.deposit_particle[i] >= 0) {
+                    mc_particle = &mc_particle_message->getData()[static_cast<size_t>(record.deposit_particle[i])];
+                }
+                deposits.emplace_back(get_point(record.deposit_local_position, i),
+                                      get_point(record.deposit_global_position, i),
+                                      static_cast<CarrierType>(record.deposit_type[i]),
+                                      record.deposit_charge[i],
+                                      record.deposit_local_time[i],
+                                      record.deposit_global_time[i],
+                                      mc_particle);
+            }
+
+            LOG(DEBUG) << "Replaying " << deposits.size() << " deposits and " << record.getParticleCount()
+                       << " MCParticles in detector " << detector->getName();
+            auto deposit_message = std::make_shared<DepositedChargeMessage>(std::move(deposits), detector);
+            messenger_->dispatchMessage(this, deposit_message, event);
+        }
+    }
+}
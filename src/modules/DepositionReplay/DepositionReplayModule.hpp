@@ -0,0 +1,65 @@
+/**
+ * @file
+ * @brief Definition of module replaying deposited charges and Monte Carlo particles from compact replay files
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <memory>
+#include <vector>
+
+#include "core/config/Configuration.hpp"
+#include "core/geometry/GeometryManager.hpp"
+#include "core/messenger/Messenger.hpp"
+#include "core/module/Event.hpp"
+#include "core/module/Module.hpp"
+
+#include "objects/DepositedCharge.hpp"
+#include "objects/MCParticle.hpp"
+
+#include "tools/deposit_replay.h"
+
+namespace allpix {
+    /**
+     * @ingroup Modules
+     * @brief Module to replay the deposited charges and Monte Carlo particles stored by the DepositReplayWriter module
+     * @note This module supports multithreading
+     *
+     * The replay file is mapped into memory and every event is decoded independently of all other events, such that events
+     * can be replayed in any order. The messages of deposited charges and Monte Carlo particles are dispatched exactly as
+     * they have been stored, which allows repeating the simulation of the subsequent modules with different parameters
+     * without repeating the simulation of the energy deposition.
+     */
+    class DepositionReplayModule : public Module {
+    public:
+        /**
+         * @brief Constructor for this unique module
+         * @param config Configuration object for this module as retrieved from the steering file
+         * @param messenger Pointer to the messenger object to allow binding to messages on the bus
+         * @param geo_manager Pointer to the geometry manager, containing the detectors
+         */
+        DepositionReplayModule(Configuration& config, Messenger* messenger, GeometryManager* geo_manager);
+
+        /**
+         * @brief Open the replay file and assign its detectors to the detectors of the geometry
+         */
+        void initialize() override;
+
+        /**
+         * @brief Dispatch the deposited charges and Monte Carlo particles stored for the event
+         */
+        void run(Event*) override;
+
+    private:
+        Messenger* messenger_;
+        GeometryManager* geo_manager_;
+
+        std::unique_ptr<DepositReplayReader> reader_;
+        // Detector of the geometry for every detector of the file, empty for detectors not present in the geometry
+        std::vector<std::shared_ptr<Detector>> detectors_;
+    };
+} // namespace allpix
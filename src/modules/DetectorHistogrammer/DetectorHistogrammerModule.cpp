@@ -12,20 +12,86 @@
 #include "DetectorHistogrammerModule.hpp"
 
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "core/geometry/HexagonalPixelDetectorModel.hpp"
 #include "core/geometry/RadialStripDetectorModel.hpp"
 #include "core/messenger/Messenger.hpp"
 #include "core/utils/distributions.h"
 #include "core/utils/log.h"
+#include "core/utils/unit_constants.h"
 
 #include "tools/ROOT.h"
+#include "tools/pixel_clustering.h"
 
 using namespace allpix;
 
+namespace {
+    /**
+     * @brief Spatial binning of the cluster positions in cells of the size of the matching cut
+     *
+     * Clusters within the matching cut of a position can only be found in the cell of the position and its eight
+     * neighbors, such that each particle is only compared to the clusters nearby.
+     */
+    class ClusterGrid {
+    public:
+        ClusterGrid(const std::vector<ROOT::Math::XYZPoint>& positions, ROOT::Math::XYVector cut)
+            : positions_(positions), cut_(std::move(cut)) {
+            if(cut_.x() <= 0 || cut_.y() <= 0) {
+                return;
+            }
+            for(size_t i = 0; i < positions_.size(); ++i) {
+                cells_[key(cell(positions_[i].x(), cut_.x()), cell(positions_[i].y(), cut_.y()))].push_back(i);
+            }
+        }
+
+        /**
+         * @brief Check whether any cluster is located within the matching cut of a position
+         * @param position Local position to match
+         * @return True if a cluster is within the cut in both coordinates
+         */
+        bool matches(const ROOT::Math::XYZPoint& position) const {
+            if(cells_.empty()) {
+                return false;
+            }
+            auto cell_x = cell(position.x(), cut_.x());
+            auto cell_y = cell(position.y(), cut_.y());
+            for(int64_t dx = -1; dx <= 1; ++dx) {
+                for(int64_t dy = -1; dy <= 1; ++dy) {
+                    auto clusters = cells_.find(key(cell_x + dx, cell_y + dy));
+                    if(clusters == cells_.end()) {
+                        continue;
+                    }
+                    for(auto i : clusters->second) {
+                        if(std::fabs(positions_[i].x() - position.x()) < cut_.x() &&
+                           std::fabs(positions_[i].y() - position.y()) < cut_.y()) {
+                            return true;
+                        }
+                    }
+                }
+            }
+            return false;
+        }
+
+    private:
+        static int64_t cell(double coordinate, double size) { return static_cast<int64_t>(std::floor(coordinate / size)); }
+        static uint64_t key(int64_t x, int64_t y) {
+            return (static_cast<uint64_t>(x) << 32) ^ (static_cast<uint64_t>(y) & 0xFFFFFFFF);
+        }
+
+        const std::vector<ROOT::Math::XYZPoint>& positions_;
+        ROOT::Math::XYVector cut_;
+        std::unordered_map<uint64_t, std::vector<size_t>> cells_;
+    };
+} // namespace
+
 DetectorHistogrammerModule::DetectorHistogrammerModule(Configuration& config,
                                                        Messenger* messenger,
                                                        std::shared_ptr<Detector> detector)
@@ -49,14 +115,21 @@ DetectorHistogrammerModule::DetectorHistogrammerModule(Configuration& config,
                                                static_cast<int>(Units::convert(model->getPixelSize().y(), "um"))));
     config_.setDefault<DisplacementVector2D<Cartesian2D<int>>>("granularity_local", {1, 1});
     config_.setDefault<double>("max_cluster_charge", Units::get(50., "ke"));
+    config_.setDefault<bool>("output_plots", true);
 
     matching_cut_ = config_.get<XYVector>("matching_cut");
     track_resolution_ = config_.get<XYVector>("track_resolution");
+    output_plots_ = config_.get<bool>("output_plots");
 }
 
 void DetectorHistogrammerModule::initialize() {
     using namespace ROOT::Math;
 
+    if(!output_plots_) {
+        LOG(INFO) << "Creation of plots disabled, not histogramming detector " << detector_->getName();
+        return;
+    }
+
     // Fetch detector model
     auto model = detector_->getModel();
     auto pitch_x = static_cast<double>(Units::convert(model->getPixelSize().x(), "um"));
@@ -411,6 +484,10 @@ void DetectorHistogrammerModule::initialize() {
 void DetectorHistogrammerModule::run(Event* event) {
     using namespace ROOT::Math;
 
+    if(!output_plots_) {
+        return;
+    }
+
     std::shared_ptr<PixelHitMessage> pixels_message{nullptr};
     auto mcparticle_message = messenger_->fetchMessage<MCParticleMessage>(this, event);
 
@@ -434,8 +511,8 @@ void DetectorHistogrammerModule::run(Event* event) {
             hit_map->Fill(pixel_idx.x(), pixel_idx.y());
             hit_map_global->Fill(global_pos.x(), global_pos.y());
             hit_map_local->Fill(local_pos.x(), local_pos.y());
-            charge_map->Fill(pixel_idx.x(), pixel_idx.y(), static_cast<double>(Units::convert(pixel_hit.getSignal(), "ke")));
-            pixel_charge->Fill(static_cast<double>(Units::convert(pixel_hit.getSignal(), "ke")));
+            charge_map->Fill(pixel_idx.x(), pixel_idx.y(), pixel_hit.getSignal() / units::ke);
+            pixel_charge->Fill(pixel_hit.getSignal() / units::ke);
             // For radial_strip models also fill the polar hit map
             if(radial_model != nullptr) {
                 auto hit_pos = radial_model->getPositionPolar(pixel_hit.getPixel().getLocalCenter());
@@ -462,21 +539,29 @@ void DetectorHistogrammerModule::run(Event* event) {
     auto primary_particles = getPrimaryParticles(mcparticle_message);
     LOG(DEBUG) << "Found " << primary_particles.size() << " primary particles in this event";
 
+    // Calculate the cluster positions once for the residuals and the matching to the particles
+    std::vector<ROOT::Math::XYZPoint> cluster_positions;
+    cluster_positions.reserve(clusters.size());
+    for(const auto& clus : clusters) {
+        cluster_positions.push_back(clus.getPosition());
+    }
+
     // Evaluate the clusters
     double charge_sum = 0;
-    for(const auto& clus : clusters) {
+    for(size_t cluster_idx = 0; cluster_idx < clusters.size(); ++cluster_idx) {
+        const auto& clus = clusters[cluster_idx];
         // Fill cluster histograms
         cluster_size->Fill(static_cast<double>(clus.getSize()));
         auto clusSizesXY = clus.getSizeXY();
         cluster_size_x->Fill(clusSizesXY.first);
         cluster_size_y->Fill(clusSizesXY.second);
 
-        auto clusterPos = clus.getPosition();
+        const auto& clusterPos = cluster_positions[cluster_idx];
         auto [cluster_x, cluster_y] = model->getPixelIndex(clusterPos);
         LOG(DEBUG) << "Cluster at indices " << cluster_x << ", " << cluster_y << "(" << clusterPos
                    << " local coordinates) with charge " << Units::display(clus.getCharge(), "ke");
         cluster_map->Fill(cluster_x, cluster_y);
-        cluster_charge->Fill(static_cast<double>(Units::convert(clus.getCharge(), "ke")));
+        cluster_charge->Fill(clus.getCharge() / units::ke);
         charge_sum += clus.getCharge();
 
         auto cluster_particles = clus.getMCParticles();
@@ -506,8 +591,8 @@ void DetectorHistogrammerModule::run(Event* event) {
             LOG(TRACE) << "MCParticle in pixel at " << Units::display(inPixelPos, {"mm", "um"});
 
             // Calculate residual with cluster position:
-            auto residual_um_x = static_cast<double>(Units::convert(particlePos.x() - clusterPos.x(), "um"));
-            auto residual_um_y = static_cast<double>(Units::convert(particlePos.y() - clusterPos.y(), "um"));
+            auto residual_um_x = (particlePos.x() - clusterPos.x()) / units::um;
+            auto residual_um_y = (particlePos.y() - clusterPos.y()) / units::um;
             auto residual_um_r = std::sqrt(residual_um_x * residual_um_x + residual_um_y * residual_um_y);
 
             // If model is radial_strip, calculate polar residuals and in-pixel positions
@@ -518,10 +603,9 @@ void DetectorHistogrammerModule::run(Event* event) {
                 auto cluster_polar = radial_model->getPositionPolar(clusterPos);
 
                 // Calculate r and phi residuals
-                residual_um_r = static_cast<double>(Units::convert(particle_polar.r() - cluster_polar.r(), "um"));
+                residual_um_r = (particle_polar.r() - cluster_polar.r()) / units::um;
 
-                auto residual_mrad_phi =
-                    static_cast<double>(Units::convert(particle_polar.phi() - cluster_polar.phi(), "mrad"));
+                auto residual_mrad_phi = (particle_polar.phi() - cluster_polar.phi()) / units::mrad;
                 residual_phi->Fill(residual_mrad_phi);
 
                 // Recalculate in-pixel positions
@@ -529,8 +613,8 @@ void DetectorHistogrammerModule::run(Event* event) {
                 inPixelPos = {particle_polar.r() * sin(delta_phi), particle_polar.r() * cos(delta_phi) - strip_polar.r(), 0};
             }
 
-            auto inPixel_um_x = static_cast<double>(Units::convert(inPixelPos.x(), "um"));
-            auto inPixel_um_y = static_cast<double>(Units::convert(inPixelPos.y(), "um"));
+            auto inPixel_um_x = inPixelPos.x() / units::um;
+            auto inPixel_um_y = inPixelPos.y() / units::um;
 
             cluster_size_map->Fill(inPixel_um_x, inPixel_um_y, static_cast<double>(clus.getSize()));
             cluster_size_map_local->Fill(particlePos.x(), particlePos.y(), static_cast<double>(clus.getSize()));
@@ -539,13 +623,13 @@ void DetectorHistogrammerModule::run(Event* event) {
 
             // Charge maps:
             cluster_charge_map->Fill(
-                inPixel_um_x, inPixel_um_y, static_cast<double>(Units::convert(clus.getCharge(), "ke")));
+                inPixel_um_x, inPixel_um_y, clus.getCharge() / units::ke);
 
             // Retrieve the seed pixel:
             const auto* seed_pixel = clus.getSeedPixelHit();
             seed_charge_map->Fill(
-                inPixel_um_x, inPixel_um_y, static_cast<double>(Units::convert(seed_pixel->getSignal(), "ke")));
-            cluster_seed_charge->Fill(static_cast<double>(Units::convert(seed_pixel->getSignal(), "ke")));
+                inPixel_um_x, inPixel_um_y, seed_pixel->getSignal() / units::ke);
+            cluster_seed_charge->Fill(seed_pixel->getSignal() / units::ke);
 
             residual_x->Fill(residual_um_x);
             residual_y->Fill(residual_um_y);
@@ -565,9 +649,10 @@ void DetectorHistogrammerModule::run(Event* event) {
     }
 
     // Store total charge in event:
-    total_charge->Fill(static_cast<double>(Units::convert(charge_sum, "ke")));
+    total_charge->Fill(charge_sum / units::ke);
 
-    // Calculate efficiency: search for matching clusters for all primary MCParticles
+    // Calculate efficiency: search for matching clusters nearby for all primary MCParticles
+    ClusterGrid cluster_grid(cluster_positions, matching_cut_);
     for(auto& particle : primary_particles) {
         // Calculate 2D local position of particle:
         auto particlePos = particle->getLocalReferencePoint() + track_smearing(track_resolution_);
@@ -596,16 +681,11 @@ void DetectorHistogrammerModule::run(Event* event) {
             inPixelPos = {particle_polar.r() * sin(delta_phi), particle_polar.r() * cos(delta_phi) - strip_polar.r(), 0};
         }
 
-        auto inPixel_um_x = static_cast<double>(Units::convert(inPixelPos.x(), "um"));
-        auto inPixel_um_y = static_cast<double>(Units::convert(inPixelPos.y(), "um"));
-
-        auto matched_cluster = std::find_if(clusters.begin(), clusters.end(), [this, &particlePos](const Cluster& clus) {
-            return (std::fabs(clus.getPosition().x() - particlePos.x()) < matching_cut_.x()) &&
-                   (std::fabs(clus.getPosition().y() - particlePos.y()) < matching_cut_.y());
-        });
+        auto inPixel_um_x = inPixelPos.x() / units::um;
+        auto inPixel_um_y = inPixelPos.y() / units::um;
 
         // Do we have a match?
-        bool matched = matched_cluster != clusters.end();
+        bool matched = cluster_grid.matches(particlePos);
         LOG(DEBUG) << "Particle at " << Units::display(particlePos, {"mm", "um"})
                    << (matched ? " has a matching cluster" : " has no matching cluster");
 
@@ -622,6 +702,10 @@ void DetectorHistogrammerModule::run(Event* event) {
 }
 
 void DetectorHistogrammerModule::finalize() {
+    if(!output_plots_) {
+        return;
+    }
+
     // Print statistics
     if(total_hits_ != 0) {
         LOG(INFO) << "Plotted " << total_hits_ << " hits in total";
@@ -822,46 +906,17 @@ void DetectorHistogrammerModule::finalize() {
  */
 std::vector<Cluster> DetectorHistogrammerModule::doClustering(std::shared_ptr<PixelHitMessage>& pixels_message) const {
     std::vector<Cluster> clusters;
-    std::map<const PixelHit*, bool> usedPixel;
-
-    auto pixel_it = pixels_message->getData().begin();
-    for(; pixel_it != pixels_message->getData().end(); pixel_it++) {
-        const PixelHit* pixel_hit = &(*pixel_it);
-
-        // Check if the pixel has been used:
-        if(usedPixel[pixel_hit]) {
-            continue;
-        }
-
-        // Create new cluster
-        Cluster cluster(pixel_hit);
-        usedPixel[pixel_hit] = true;
-        LOG(TRACE) << "Creating new cluster with seed: " << pixel_hit->getPixel().getIndex();
-
-        auto touching = [&](const PixelHit* pixel) {
-            for(const auto& cluster_pixel : cluster.getPixelHits()) {
-                if(detector_->getModel()->areNeighbors(cluster_pixel->getIndex(), pixel->getIndex(), 1)) {
-                    return true;
-                }
-            }
-            return false;
-        };
-
-        // Keep adding pixels to the cluster:
-        for(auto other_pixel = pixel_it + 1; other_pixel != pixels_message->getData().end(); other_pixel++) {
-            const PixelHit* neighbor = &(*other_pixel);
-
-            // Check if neighbor has been used or if it touches the current cluster:
-            if(usedPixel[neighbor] || !touching(neighbor)) {
-                continue;
-            }
 
-            cluster.addPixelHit(neighbor);
-            LOG(TRACE) << "Adding pixel: " << neighbor->getPixel().getIndex();
-            usedPixel[neighbor] = true;
-            other_pixel = pixel_it;
+    // Group the hits into connected components of neighboring pixels
+    PixelClustering clustering(detector_->getModel());
+    for(const auto& pixel_hits : clustering.cluster(pixels_message->getData())) {
+        Cluster cluster(pixel_hits.front());
+        LOG(TRACE) << "Creating new cluster with seed: " << pixel_hits.front()->getPixel().getIndex();
+        for(auto pixel_hit = std::next(pixel_hits.begin()); pixel_hit != pixel_hits.end(); ++pixel_hit) {
+            cluster.addPixelHit(*pixel_hit);
+            LOG(TRACE) << "Adding pixel: " << (*pixel_hit)->getPixel().getIndex();
         }
-        clusters.push_back(cluster);
+        clusters.push_back(std::move(cluster));
     }
     return clusters;
 }
@@ -89,6 +89,9 @@ namespace allpix {
         // Reference track resolution
         ROOT::Math::XYVector track_resolution_{};
 
+        // Flag to create and fill the histograms
+        bool output_plots_{true};
+
         // Histograms to output
         Histogram<TH2D> hit_map, hit_map_global, hit_map_local, hit_map_local_mc, charge_map, cluster_map, polar_hit_map;
         Histogram<TProfile2D> cluster_size_map_local, cluster_size_map, cluster_size_x_map, cluster_size_y_map;
@@ -46,8 +46,6 @@ void DopingProfileReaderModule::initialize() {
         auto field_mapping = config_.get<FieldMapping>("field_mapping");
         LOG(DEBUG) << "Doping concentration maps to " << magic_enum::enum_name(field_mapping);
 
-        auto field_data = read_field();
-
         // By default, set field scale from physical extent read from field file:
         std::array<double, 2> field_scale{{1.0, 1.0}};
         // Read the field scales from the configuration if the key is set:
@@ -69,13 +67,27 @@ void DopingProfileReaderModule::initialize() {
         }
         LOG(DEBUG) << "Doping profile has offset of " << offset << " fractions of the field size";
 
-        detector_->setDopingProfileGrid(field_data.getData(),
-                                        field_data.getDimensions(),
-                                        field_data.getSize(),
-                                        field_mapping,
-                                        field_scale,
-                                        {{offset.x(), offset.y()}},
-                                        thickness_domain);
+        // Select the interpolation between the grid points, defaulting to the value of the nearest grid point
+        auto interpolation = config_.get<FieldInterpolation>("field_interpolation", FieldInterpolation::NEAREST);
+        LOG(DEBUG) << "Doping profile is interpolated using " << magic_enum::enum_name(interpolation) << " interpolation";
+
+        // Read the field data with the requested precision and set the grid
+        auto set_grid = [&](const auto& field_data) {
+            detector_->setDopingProfileGrid(field_data.getValues(),
+                                            field_data.getDimensions(),
+                                            field_data.getSize(),
+                                            field_mapping,
+                                            field_scale,
+                                            {{offset.x(), offset.y()}},
+                                            thickness_domain,
+                                            interpolation);
+        };
+        if(config_.get<bool>("single_precision", false)) {
+            LOG(DEBUG) << "Doping profile is stored with single precision";
+            set_grid(read_field(field_parser_single_));
+        } else {
+            set_grid(read_field(field_parser_));
+        }
 
     } else if(field_model == DopingProfile::CONSTANT) {
         LOG(TRACE) << "Adding constant doping concentration";
@@ -122,16 +134,21 @@ void DopingProfileReaderModule::initialize() {
 }
 
 /**
- * The field read from the INIT format are shared between module instantiations using the static FieldParser.
+ * The field read from the INIT format are shared between module instantiations using the static FieldParser, and
+ * between detectors and modules using the process-wide FieldStore.
  */
-FieldParser<double> DopingProfileReaderModule::field_parser_(FieldQuantity::SCALAR);
-FieldData<double> DopingProfileReaderModule::read_field() {
+FieldParser<double> DopingProfileReaderModule::field_parser_(FieldQuantity::SCALAR, true);
+FieldParser<float> DopingProfileReaderModule::field_parser_single_(FieldQuantity::SCALAR, true);
+template <typename T> FieldData<T> DopingProfileReaderModule::read_field(FieldParser<T>& field_parser) {
 
     try {
         LOG(TRACE) << "Fetching doping concentration map from mesh file";
 
-        // Get field from file
-        auto field_data = field_parser_.getByFileName(config_.getPath("file_name", true), "/cm/cm/cm");
+        // Get field from file, shared with all detectors and modules reading the same file through the field store
+        auto file_name = config_.getPath("file_name", true);
+        auto field_data = FieldStore<T>::getInstance().get(FieldStore<T>::key(file_name, "/cm/cm/cm"), [&]() {
+            return field_parser.getByFileName(file_name, "/cm/cm/cm");
+        });
 
         LOG(INFO) << "Set doping concentration map with " << field_data.getDimensions().at(0) << "x"
                   << field_data.getDimensions().at(1) << "x" << field_data.getDimensions().at(2) << " cells";
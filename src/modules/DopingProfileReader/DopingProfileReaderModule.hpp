@@ -13,6 +13,7 @@
 #include "core/geometry/DetectorModel.hpp"
 #include "core/messenger/Messenger.hpp"
 #include "tools/field_parser.h"
+#include "tools/field_store.h"
 
 #include "core/module/Module.hpp"
 
@@ -53,10 +54,12 @@ namespace allpix {
 
         /**
          * @brief Read field from a file in init or apf format
+         * @param field_parser Parser for the requested precision of the field values
          * @return Data of the field read from file
          */
-        FieldData<double> read_field();
+        template <typename T> FieldData<T> read_field(FieldParser<T>& field_parser);
         static FieldParser<double> field_parser_;
+        static FieldParser<float> field_parser_single_;
 
         /**
          * @brief Create output plots of the doping profile
@@ -11,12 +11,18 @@
 
 #include "ElectricFieldReaderModule.hpp"
 
+#include <algorithm>
+#include <filesystem>
 #include <fstream>
 #include <limits>
 #include <memory>
+#include <map>
 #include <new>
+#include <optional>
+#include <set>
 #include <stdexcept>
 #include <string>
+#include <tuple>
 #include <utility>
 
 #include <Math/Vector3D.h>
@@ -73,7 +79,6 @@ void ElectricFieldReaderModule::initialize() {
         // Read field mapping from configuration
         auto field_mapping = config_.get<FieldMapping>("field_mapping");
         LOG(DEBUG) << "Electric field maps to " << magic_enum::enum_name(field_mapping);
-        auto field_data = read_field();
 
         // By default, set field scale from physical extent read from field file:
         std::array<double, 2> field_scale{{1.0, 1.0}};
@@ -96,13 +101,56 @@ void ElectricFieldReaderModule::initialize() {
         }
         LOG(DEBUG) << "Electric field has offset of " << offset << " fractions of the field size";
 
-        detector_->setElectricFieldGrid(field_data.getData(),
-                                        field_data.getDimensions(),
-                                        field_data.getSize(),
-                                        field_mapping,
-                                        field_scale,
-                                        {{offset.x(), offset.y()}},
-                                        thickness_domain);
+        // Select the interpolation between the grid points, defaulting to the value of the nearest grid point
+        auto interpolation = config_.get<FieldInterpolation>("field_interpolation", FieldInterpolation::NEAREST);
+        LOG(DEBUG) << "Electric field is interpolated using " << magic_enum::enum_name(interpolation) << " interpolation";
+
+        // Read the field data with the requested precision and set the grid
+        auto set_grid = [&](const auto& field_data) {
+            detector_->setElectricFieldGrid(field_data.getValues(),
+                                            field_data.getDimensions(),
+                                            field_data.getSize(),
+                                            field_mapping,
+                                            field_scale,
+                                            {{offset.x(), offset.y()}},
+                                            thickness_domain,
+                                            interpolation);
+        };
+        if(config_.get<bool>("single_precision", false)) {
+            LOG(DEBUG) << "Electric field is stored with single precision";
+            set_grid(read_field(field_parser_single_));
+        } else {
+            set_grid(read_field(field_parser_));
+        }
+
+        // Store the field in a sparse hierarchical grid, coarsening regions where the field varies little
+        if(config_.get<bool>("adaptive_grid", false)) {
+            auto tolerance = config_.get<double>("adaptive_tolerance", 1e-3);
+            if(tolerance < 0) {
+                throw InvalidValueError(config_, "adaptive_tolerance", "tolerance cannot be negative");
+            }
+            auto values = detector_->makeElectricFieldAdaptive(tolerance);
+            LOG(INFO) << "Stored electric field in sparse hierarchical grid with " << values << " values";
+        }
+
+        // Store the electric field in bricks of neighboring cells to improve the locality of the lookups
+        if(config_.get<bool>("tiled_grid", false)) {
+            if(config_.get<bool>("adaptive_grid", false)) {
+                throw InvalidCombinationError(
+                    config_, {"adaptive_grid", "tiled_grid"}, "the sparse hierarchical grid is already stored in bricks");
+            }
+            auto values = detector_->makeElectricFieldTiled();
+            LOG(INFO) << "Stored electric field in tiled grid of 8x8x8 cells with " << values << " values";
+        }
+
+        // Back the grid with huge pages to reduce the misses of the translation lookaside buffer for large grids
+        if(config_.get<bool>("huge_pages", false)) {
+            if(detector_->useHugePagesForElectricField()) {
+                LOG(DEBUG) << "Electric field is stored in memory backed by transparent huge pages";
+            } else {
+                LOG(WARNING) << "Transparent huge pages are not available, electric field is stored in regular pages";
+            }
+        }
     } else if(field_model == ElectricField::CONSTANT) {
         LOG(TRACE) << "Adding constant electric field";
         auto field_z = config_.get<double>("bias_voltage") / getDetector()->getModel()->getSensorSize().z();
@@ -135,6 +183,18 @@ void ElectricFieldReaderModule::initialize() {
         detector_->setElectricFieldFunction(field_function, thickness_domain, field_type);
     }
 
+    // Sample the field function onto a grid if requested, constant fields are not sampled
+    if(config_.get<bool>("tabulate", false) && field_model != ElectricField::MESH &&
+       field_model != ElectricField::CONSTANT) {
+        auto bins = config_.getArray<size_t>("tabulate_bins", {100, 100, 100});
+        if(bins.size() != 3 || std::find(bins.begin(), bins.end(), 0) != bins.end()) {
+            throw InvalidValueError(config_, "tabulate_bins", "three non-zero numbers of bins in x, y and z are required");
+        }
+        LOG(INFO) << "Sampling electric field function onto grid with " << bins[0] << "x" << bins[1] << "x" << bins[2]
+                  << " bins";
+        detector_->tabulateElectricField({{bins[0], bins[1], bins[2]}});
+    }
+
     // Produce histograms if needed
     if(config_.get<bool>("output_plots", false)) {
         create_output_plots();
@@ -268,19 +328,22 @@ std::pair<FieldFunction<ROOT::Math::XYZVector>, FieldType> ElectricFieldReaderMo
 
 /**
  * The field data read from files are shared between module instantiations using the static
- * FieldParser's getByFileName method.
+ * FieldParser's getByFileName method, and between detectors and modules using the process-wide FieldStore.
  */
-FieldParser<double> ElectricFieldReaderModule::field_parser_(FieldQuantity::VECTOR);
-FieldData<double> ElectricFieldReaderModule::read_field() {
-
+FieldParser<double> ElectricFieldReaderModule::field_parser_(FieldQuantity::VECTOR, true);
+FieldParser<float> ElectricFieldReaderModule::field_parser_single_(FieldQuantity::VECTOR, true);
+template <typename T> FieldData<T> ElectricFieldReaderModule::read_field(FieldParser<T>& field_parser) {
+    // Field maps tagged with bias voltage and fluence are interpolated, otherwise a single map is read
+    const std::string key = (config_.has("file_names") ? "file_names" : "file_name");
     try {
         LOG(TRACE) << "Fetching electric field from mesh file";
 
-        // Get field from file
-        auto field_data = field_parser_.getByFileName(config_.getPath("file_name", true), "V/cm");
+        auto field_data = (key == "file_names" ? interpolate_fields(field_parser)
+                                               : load_field(field_parser, config_.getPath("file_name", true)));
 
         // Warn at field values larger than 1MV/cm / 10 MV/mm. Simple lookup per vector component, not total field magnitude
-        auto max_field = *std::max_element(std::begin(*field_data.getData()), std::end(*field_data.getData()));
+        auto values = field_data.getValues();
+        auto max_field = *std::max_element(values.begin(), values.end());
         if(max_field > 10) {
             LOG(WARNING) << "Very high electric field of " << Units::display(max_field, "kV/cm")
                          << ", this is most likely not desired.";
@@ -292,12 +355,120 @@ FieldData<double> ElectricFieldReaderModule::read_field() {
         // Return the field data
         return field_data;
     } catch(std::invalid_argument& e) {
-        throw InvalidValueError(config_, "file_name", e.what());
+        throw InvalidValueError(config_, key, e.what());
     } catch(std::runtime_error& e) {
-        throw InvalidValueError(config_, "file_name", e.what());
+        throw InvalidValueError(config_, key, e.what());
     } catch(std::bad_alloc& e) {
-        throw InvalidValueError(config_, "file_name", "file too large");
+        throw InvalidValueError(config_, key, "file too large");
+    }
+}
+
+template <typename T>
+FieldData<T> ElectricFieldReaderModule::load_field(FieldParser<T>& field_parser, const std::filesystem::path& file_name) {
+    // Get field from file, optionally through a cache directory holding previously parsed fields
+    std::filesystem::path cache_directory;
+    if(config_.has("cache_directory")) {
+        cache_directory = config_.getPath("cache_directory");
+    }
+    // Fields with identical file and units are shared between all detectors and modules through the field store
+    return FieldStore<T>::getInstance().get(FieldStore<T>::key(file_name, "V/cm"), [&]() {
+        return field_parser.getByFileName(file_name, "V/cm", cache_directory);
+    });
+}
+
+/**
+ * The maps have to cover a grid of bias voltages and fluences. The field is interpolated bilinearly between the four maps
+ * surrounding the requested point, or linearly between two maps if the point matches the bias voltage or fluence of a map.
+ * A map of the requested point is used directly without copying its values.
+ */
+template <typename T> FieldData<T> ElectricFieldReaderModule::interpolate_fields(FieldParser<T>& field_parser) {
+    auto file_names = config_.getPathArray("file_names", true);
+    auto field_points = config_.getMatrix<double>("field_points");
+    if(field_points.size() != file_names.size()) {
+        throw InvalidCombinationError(
+            config_, {"file_names", "field_points"}, "a bias voltage and a fluence are required for every field map");
+    }
+    std::set<double> biases;
+    std::set<double> fluences;
+    for(const auto& point : field_points) {
+        if(point.size() != 2) {
+            throw InvalidValueError(config_, "field_points", "every field point requires a bias voltage and a fluence");
+        }
+        biases.insert(point[0]);
+        fluences.insert(point[1]);
+    }
+
+    // Find the neighboring values on both axes of the grid together with the weight of the upper value
+    auto bracket = [](const std::set<double>& values, double value) -> std::optional<std::tuple<double, double, double>> {
+        if(value < *values.begin() || value > *values.rbegin()) {
+            return std::nullopt;
+        }
+        auto upper = values.lower_bound(value);
+        if(*upper == value) {
+            return std::make_tuple(value, value, 0.);
+        }
+        auto lower = *std::prev(upper);
+        return std::make_tuple(lower, *upper, (value - lower) / (*upper - lower));
+    };
+    auto bias = config_.get<double>("bias_voltage");
+    auto fluence = config_.get<double>("fluence", 0.);
+    auto bias_bracket = bracket(biases, bias);
+    if(!bias_bracket) {
+        throw InvalidValueError(config_, "bias_voltage", "bias voltage is outside of the range of the field maps");
+    }
+    auto fluence_bracket = bracket(fluences, fluence);
+    if(!fluence_bracket) {
+        throw InvalidValueError(config_, "fluence", "fluence is outside of the range of the field maps");
+    }
+
+    // Collect the weights of the surrounding maps, skipping maps without contribution
+    std::map<size_t, double> weights;
+    auto [bias_low, bias_high, bias_weight] = bias_bracket.value();
+    auto [fluence_low, fluence_high, fluence_weight] = fluence_bracket.value();
+    for(const auto& [corner_bias, weight_bias] : {std::pair(bias_low, 1 - bias_weight), std::pair(bias_high, bias_weight)}) {
+        for(const auto& [corner_fluence, weight_fluence] :
+            {std::pair(fluence_low, 1 - fluence_weight), std::pair(fluence_high, fluence_weight)}) {
+            auto weight = weight_bias * weight_fluence;
+            if(weight == 0) {
+                continue;
+            }
+            const std::vector<double> corner{corner_bias, corner_fluence};
+            auto point = std::find(field_points.begin(), field_points.end(), corner);
+            if(point == field_points.end()) {
+                throw InvalidValueError(config_,
+                                        "field_points",
+                                        "no field map for bias voltage " + Units::display(corner_bias, "V") +
+                                            " and fluence " + Units::display(corner_fluence, "neq/cm/cm") +
+                                            ", the field points have to form a grid");
+            }
+            weights[static_cast<size_t>(std::distance(field_points.begin(), point))] += weight;
+        }
+    }
+
+    // Use a map of the requested point directly
+    if(weights.size() == 1) {
+        LOG(DEBUG) << "Using field map " << file_names.at(weights.begin()->first) << " of the requested point";
+        return load_field(field_parser, file_names.at(weights.begin()->first));
+    }
+
+    std::optional<FieldData<T>> reference;
+    std::shared_ptr<std::vector<T>> values;
+    for(const auto& [index, weight] : weights) {
+        auto field_data = load_field(field_parser, file_names.at(index));
+        auto field_values = field_data.getValues();
+        if(!reference) {
+            reference = field_data;
+            values = std::make_shared<std::vector<T>>(field_values.size(), T());
+        } else if(field_data.getDimensions() != reference->getDimensions() || field_data.getSize() != reference->getSize()) {
+            throw InvalidValueError(config_, "file_names", "field maps to interpolate differ in their dimensions or size");
+        }
+        for(size_t i = 0; i < field_values.size(); ++i) {
+            (*values)[i] += static_cast<T>(weight * field_values[i]);
+        }
     }
+    LOG(INFO) << "Interpolated electric field at bias voltage " << Units::display(bias, "V") << " and fluence "
+              << Units::display(fluence, "neq/cm/cm") << " between " << weights.size() << " field maps";
+    return FieldData<T>(reference->getHeader(), reference->getDimensions(), reference->getSize(), values);
 }
 
 void ElectricFieldReaderModule::create_output_plots() {
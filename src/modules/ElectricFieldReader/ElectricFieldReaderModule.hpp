@@ -9,6 +9,7 @@
  * SPDX-License-Identifier: MIT
  */
 
+#include <filesystem>
 #include <map>
 #include <memory>
 #include <string>
@@ -18,6 +19,7 @@
 #include "core/geometry/GeometryManager.hpp"
 #include "core/messenger/Messenger.hpp"
 #include "tools/field_parser.h"
+#include "tools/field_store.h"
 
 #include "core/module/Module.hpp"
 
@@ -82,10 +84,28 @@ namespace allpix {
 
         /**
          * @brief Read field from a file in init or apf format
+         * @param field_parser Parser for the requested precision of the field values
          * @return Data of the field read from file
          */
-        FieldData<double> read_field();
+        template <typename T> FieldData<T> read_field(FieldParser<T>& field_parser);
+
+        /**
+         * @brief Load a field map, shared with other detectors and modules using the same file
+         * @param field_parser Parser for the requested precision of the field values
+         * @param file_name Path of the field file
+         * @return Data of the field read from file or from the field store
+         */
+        template <typename T>
+        FieldData<T> load_field(FieldParser<T>& field_parser, const std::filesystem::path& file_name);
+
+        /**
+         * @brief Interpolate the field at the configured bias voltage and fluence between field maps of neighboring points
+         * @param field_parser Parser for the requested precision of the field values
+         * @return Data of the interpolated field
+         */
+        template <typename T> FieldData<T> interpolate_fields(FieldParser<T>& field_parser);
         static FieldParser<double> field_parser_;
+        static FieldParser<float> field_parser_single_;
 
         /**
          * @brief Create output plots of the electric field profile
@@ -0,0 +1,153 @@
+/**
+ * @file
+ * @brief Encoding of sparse hit frames as run-length or bitmap masks of the hit pixels
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef ALLPIX_FRAME_ENCODING_H
+#define ALLPIX_FRAME_ENCODING_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace allpix {
+    /**
+     * @brief Sparse frame of the hit pixels of a detector in one event
+     *
+     * Pixels are identified by their linear index in the matrix, i.e. column + row * columns. The mask of the hit pixels is
+     * either stored as run-length encoding, a sequence of pairs of the number of pixels without hit preceding a run and the
+     * number of hit pixels in the run, or as bitmap with one bit per pixel of the matrix, starting with the lowest bit of
+     * the first byte. The values of the hit pixels are stored in order of their index. The class does not depend on the
+     * framework, such that programs reading the frames can include it to decode them.
+     */
+    class FrameEncoding {
+    public:
+        /**
+         * @brief Encodings of the mask of the hit pixels
+         */
+        enum class Mask : std::uint8_t {
+            RLE = 0,    ///< Run-length encoding of the hit pixels
+            BITMAP = 1, ///< One bit for every pixel of the matrix
+        };
+
+        /**
+         * @brief Value of a single pixel hit to be encoded
+         */
+        struct Hit {
+            std::uint32_t index;
+            float signal;
+            float time;
+        };
+
+        /**
+         * @brief Encoded frame
+         */
+        struct Frame {
+            Mask mask{Mask::RLE};
+            std::vector<std::uint32_t> runs;
+            std::vector<std::uint8_t> bitmap;
+            std::vector<float> signal;
+            std::vector<float> time;
+        };
+
+        /**
+         * @brief Encode the hits of a frame, merging hits of the same pixel
+         * @param hits Hits of the frame in any order, sorted in place
+         * @param pixels Number of pixels of the matrix, all hit indices have to be below
+         * @param mask Encoding of the mask of the hit pixels
+         * @param automatic True to select the encoding with the smaller mask instead
+         * @param frame Frame to store the encoded hits in, reusing its memory
+         *
+         * Signals of hits in the same pixel are summed, and the earliest time is kept.
+         */
+        static void encode(std::vector<Hit>& hits, std::uint32_t pixels, Mask mask, bool automatic, Frame& frame) {
+            std::sort(hits.begin(), hits.end(), [](const Hit& lhs, const Hit& rhs) { return lhs.index < rhs.index; });
+
+            frame.runs.clear();
+            frame.bitmap.clear();
+            frame.signal.clear();
+            frame.time.clear();
+
+            // Merge the hits of the same pixel and count the runs of consecutive pixels
+            std::vector<std::uint32_t> indices;
+            indices.reserve(hits.size());
+            size_t runs = 0;
+            for(const auto& hit : hits) {
+                if(!indices.empty() && indices.back() == hit.index) {
+                    frame.signal.back() += hit.signal;
+                    frame.time.back() = std::min(frame.time.back(), hit.time);
+                    continue;
+                }
+                if(indices.empty() || indices.back() + 1 != hit.index) {
+                    ++runs;
+                }
+                indices.push_back(hit.index);
+                frame.signal.push_back(hit.signal);
+                frame.time.push_back(hit.time);
+            }
+
+            // Every run takes two words, while the bitmap takes one bit per pixel
+            if(automatic) {
+                mask = (runs * 2 * sizeof(std::uint32_t) <= (pixels + 7) / 8 ? Mask::RLE : Mask::BITMAP);
+            }
+            frame.mask = mask;
+
+            if(mask == Mask::RLE) {
+                frame.runs.reserve(2 * runs);
+                std::uint32_t next = 0;
+                for(auto index : indices) {
+                    if(!frame.runs.empty() && index == next) {
+                        ++frame.runs.back();
+                    } else {
+                        frame.runs.push_back(index - next);
+                        frame.runs.push_back(1);
+                    }
+                    next = index + 1;
+                }
+            } else {
+                frame.bitmap.assign((pixels + 7) / 8, 0);
+                for(auto index : indices) {
+                    frame.bitmap[index / 8] |= static_cast<std::uint8_t>(1u << (index % 8));
+                }
+            }
+        }
+
+        /**
+         * @brief Decode the indices of the hit pixels of a frame
+         * @param mask Encoding of the mask
+         * @param runs Run-length encoded mask, used for the RLE encoding
+         * @param bitmap Bitmap of the hit pixels, used for the BITMAP encoding
+         * @return Indices of the hit pixels in order, matching the order of the values of the frame
+         */
+        static std::vector<std::uint32_t>
+        decode(Mask mask, const std::vector<std::uint32_t>& runs, const std::vector<std::uint8_t>& bitmap) {
+            std::vector<std::uint32_t> indices;
+            if(mask == Mask::RLE) {
+                std::uint32_t index = 0;
+                for(size_t i = 0; i + 1 < runs.size(); i += 2) {
+                    index += runs[i];
+                    for(std::uint32_t n = 0; n < runs[i + 1]; ++n) {
+                        indices.push_back(index++);
+                    }
+                }
+            } else {
+                for(size_t byte = 0; byte < bitmap.size(); ++byte) {
+                    for(unsigned int bit = 0; bit < 8; ++bit) {
+                        if((bitmap[byte] >> bit) & 1u) {
+                            indices.push_back(static_cast<std::uint32_t>(byte * 8 + bit));
+                        }
+                    }
+                }
+            }
+            return indices;
+        }
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_FRAME_ENCODING_H */
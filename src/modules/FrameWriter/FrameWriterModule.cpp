@@ -0,0 +1,219 @@
+/**
+ * @file
+ * @brief Implementation of module writing the pixel hits of every event as compressed sparse frames
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "FrameWriterModule.hpp"
+
+#include <array>
+#include <string>
+#include <utility>
+
+#include <Compression.h>
+
+#include "core/config/exceptions.h"
+#include "core/messenger/exceptions.h"
+#include "core/utils/log.h"
+
+using namespace allpix;
+
+FrameWriterModule::FrameWriterModule(Configuration& config, Messenger* messenger, GeometryManager* geo_mgr)
+    : SequentialModule(config), messenger_(messenger), geo_mgr_(geo_mgr) {
+    // Enable multithreading of this module if multithreading is enabled
+    allow_multithreading();
+
+    config_.setDefault<std::string>("file_name", "frames");
+    config_.setDefault<Encoding>("encoding", Encoding::AUTO);
+    config_.setDefault<bool>("store_time", true);
+    config_.setDefault<bool>("global_time", false);
+    config_.setDefault<int>("compression_level", ROOT::RCompressionSetting::ELevel::kDefaultZSTD);
+
+    encoding_ = config_.get<Encoding>("encoding");
+    store_time_ = config_.get<bool>("store_time");
+    global_time_ = config_.get<bool>("global_time");
+
+    // Every event is written, events without pixel hits are stored as empty frames
+    messenger_->bindMulti<PixelHitMessage>(this, MsgFlags::NONE);
+}
+
+void FrameWriterModule::initialize() {
+    // Select the detectors to write, all detectors by default
+    std::vector<std::shared_ptr<Detector>> detectors;
+    if(config_.has("detectors")) {
+        for(const auto& name : config_.getArray<std::string>("detectors")) {
+            if(!geo_mgr_->hasDetector(name)) {
+                throw InvalidValueError(config_, "detectors", "detector " + name + " not defined");
+            }
+            detectors.push_back(geo_mgr_->getDetector(name));
+        }
+    } else {
+        detectors = geo_mgr_->getDetectors();
+    }
+
+    // The branches refer to the frames, which are thus all created before booking the branches
+    frames_.resize(detectors.size());
+    for(size_t i = 0; i < detectors.size(); ++i) {
+        auto& frame = frames_[i];
+        auto npixels = detectors[i]->getModel()->getNPixels();
+        frame.detector = detectors[i];
+        frame.columns = npixels.x();
+        frame.pixels = npixels.x() * npixels.y();
+        detector_frames_[detectors[i]->getName()] = &frame;
+    }
+
+    auto level = config_.get<int>("compression_level");
+    if(level < 0 || level > 9) {
+        throw InvalidValueError(config_, "compression_level", "compression level should be between 0 and 9");
+    }
+
+    // Create the output file, the masks and values of sparse frames compress well with Zstandard
+    output_file_name_ = createOutputFile(config_.get<std::string>("file_name"), "root");
+    output_file_ = std::make_unique<TFile>(output_file_name_.c_str(), "RECREATE");
+    if(!output_file_->IsOpen()) {
+        throw InvalidValueError(config_, "file_name", "could not create output file");
+    }
+    output_file_->SetCompressionSettings(ROOT::CompressionSettings(ROOT::RCompressionSetting::EAlgorithm::kZSTD, level));
+    output_file_->cd();
+
+    write_geometry();
+
+    frames_tree_ = new TTree("Frames", "Sparse frames of the hit pixels");
+    frames_tree_->Branch("event", &event_number_);
+    for(auto& frame : frames_) {
+        const auto& name = frame.detector->getName();
+        frames_tree_->Branch((name + "_mask").c_str(), &frame.mask, (name + "_mask/b").c_str());
+        frames_tree_->Branch((name + "_runs").c_str(), &frame.frame.runs);
+        frames_tree_->Branch((name + "_bitmap").c_str(), &frame.frame.bitmap);
+        frames_tree_->Branch((name + "_signal").c_str(), &frame.frame.signal);
+        if(store_time_) {
+            frames_tree_->Branch((name + "_time").c_str(), &frame.frame.time);
+        }
+    }
+}
+
+void FrameWriterModule::write_geometry() {
+    std::string name, type;
+    UInt_t columns{}, rows{};
+    double pitch_x{}, pitch_y{}, thickness{};
+    std::array<double, 3> position{};
+    std::array<double, 9> rotation{};
+    std::vector<float> center_x, center_y;
+
+    // Every entry holds a detector with the local centers of all pixels, ordered by their index in the frames
+    auto* tree = new TTree("Geometry", "Geometry of the pixel matrices");
+    tree->Branch("name", &name);
+    tree->Branch("type", &type);
+    tree->Branch("columns", &columns);
+    tree->Branch("rows", &rows);
+    tree->Branch("pitch_x", &pitch_x);
+    tree->Branch("pitch_y", &pitch_y);
+    tree->Branch("thickness", &thickness);
+    tree->Branch("position", position.data(), "position[3]/D");
+    tree->Branch("rotation", rotation.data(), "rotation[9]/D");
+    tree->Branch("center_x", &center_x);
+    tree->Branch("center_y", &center_y);
+
+    for(const auto& frame : frames_) {
+        const auto& detector = frame.detector;
+        auto model = detector->getModel();
+        name = detector->getName();
+        type = detector->getType();
+        columns = frame.columns;
+        rows = (frame.columns > 0 ? frame.pixels / frame.columns : 0);
+        pitch_x = model->getPixelSize().x();
+        pitch_y = model->getPixelSize().y();
+        thickness = model->getSensorSize().z();
+        detector->getPosition().GetCoordinates(position.begin());
+        detector->getOrientation().GetComponents(rotation.begin());
+
+        center_x.resize(frame.pixels);
+        center_y.resize(frame.pixels);
+        for(UInt_t y = 0; y < rows; ++y) {
+            for(UInt_t x = 0; x < columns; ++x) {
+                auto center = model->getPixelCenter(static_cast<int>(x), static_cast<int>(y));
+                center_x[x + y * columns] = static_cast<float>(center.x());
+                center_y[x + y * columns] = static_cast<float>(center.y());
+            }
+        }
+        tree->Fill();
+    }
+    tree->Write();
+}
+
+void FrameWriterModule::run(Event* event) {
+    std::vector<std::shared_ptr<PixelHitMessage>> messages;
+    try {
+        messages = messenger_->fetchMultiMessage<PixelHitMessage>(this, event);
+    } catch(const MessageNotFoundException&) {
+        LOG(TRACE) << "No pixel hits received, writing empty frames";
+    }
+
+    for(auto& frame : frames_) {
+        frame.hits.clear();
+    }
+    for(const auto& message : messages) {
+        auto frame_iter = detector_frames_.find(message->getDetector()->getName());
+        if(frame_iter == detector_frames_.end()) {
+            continue;
+        }
+        auto& frame = *frame_iter->second;
+        for(const auto& hit : message->getData()) {
+            auto index = hit.getIndex();
+            auto columns = static_cast<int>(frame.columns);
+            auto rows = static_cast<int>(frame.columns > 0 ? frame.pixels / frame.columns : 0);
+            if(index.x() < 0 || index.y() < 0 || index.x() >= columns || index.y() >= rows) {
+                LOG(DEBUG) << "Pixel " << index << " outside of the matrix of detector " << frame.detector->getName()
+                           << ", not writing hit";
+                invalid_cnt_++;
+                continue;
+            }
+            frame.hits.push_back({static_cast<std::uint32_t>(index.x() + index.y() * columns),
+                                  static_cast<float>(hit.getSignal()),
+                                  static_cast<float>(global_time_ ? hit.getGlobalTime() : hit.getLocalTime())});
+        }
+    }
+
+    for(auto& frame : frames_) {
+        FrameEncoding::encode(frame.hits,
+                              frame.pixels,
+                              encoding_ == Encoding::BITMAP ? FrameEncoding::Mask::BITMAP : FrameEncoding::Mask::RLE,
+                              encoding_ == Encoding::AUTO,
+                              frame.frame);
+        frame.mask = static_cast<std::uint8_t>(frame.frame.mask);
+        hit_cnt_ += frame.frame.signal.size();
+        LOG(TRACE) << "Encoded " << frame.frame.signal.size() << " hit pixels of detector " << frame.detector->getName()
+                   << " with " << (frame.frame.mask == FrameEncoding::Mask::RLE ? "run-length" : "bitmap") << " mask";
+    }
+
+    event_number_ = event->number;
+    frames_tree_->Fill();
+    write_cnt_ += frames_.size();
+}
+
+void FrameWriterModule::finalize() {
+    if(invalid_cnt_ > 0) {
+        LOG(WARNING) << "Skipped " << invalid_cnt_ << " pixel hits outside of the pixel matrix";
+    }
+
+    output_file_->cd();
+    frames_tree_->Write();
+    if(hit_cnt_ > 0) {
+        LOG(INFO) << "Frames take "
+                  << static_cast<double>(frames_tree_->GetZipBytes()) / static_cast<double>(hit_cnt_)
+                  << " bytes per hit pixel after compression";
+    }
+    auto entries = frames_tree_->GetEntries();
+    output_file_->Close();
+    output_file_.reset();
+    frames_tree_ = nullptr;
+
+    LOG(STATUS) << "Wrote " << write_cnt_ << " frames with " << hit_cnt_ << " hit pixels in " << entries
+                << " events to file:" << std::endl
+                << output_file_name_;
+}
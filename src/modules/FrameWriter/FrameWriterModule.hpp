@@ -0,0 +1,110 @@
+/**
+ * @file
+ * @brief Definition of module writing the pixel hits of every event as compressed sparse frames
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <TFile.h>
+#include <TTree.h>
+
+#include "core/config/Configuration.hpp"
+#include "core/geometry/GeometryManager.hpp"
+#include "core/messenger/Messenger.hpp"
+#include "core/module/Event.hpp"
+#include "core/module/Module.hpp"
+
+#include "objects/PixelHit.hpp"
+
+#include "FrameEncoding.hpp"
+
+namespace allpix {
+    /**
+     * @ingroup Modules
+     * @brief Module to write the pixel hits of every event and detector as sparse frames with a mask of the hit pixels
+     * @note This module supports multithreading
+     *
+     * Stores the signal and time of the hit pixels of every detector together with a run-length or bitmap encoded mask,
+     * instead of storing complete objects. The geometry of the pixel matrices is written once per run. The frames of all
+     * detectors are filled in order of the event numbers to a single tree with one entry per event.
+     */
+    class FrameWriterModule : public SequentialModule {
+    public:
+        /**
+         * @brief Encodings of the masks of the hit pixels
+         */
+        enum class Encoding {
+            AUTO,   ///< Select the smaller encoding for every frame
+            RLE,    ///< Run-length encoding of the hit pixels
+            BITMAP, ///< One bit for every pixel of the matrix
+        };
+
+        /**
+         * @brief Constructor for this unique module
+         * @param config Configuration object for this module as retrieved from the steering file
+         * @param messenger Pointer to the messenger object to allow binding to messages on the bus
+         * @param geo_mgr Pointer to the geometry manager, containing the detectors
+         */
+        FrameWriterModule(Configuration& config, Messenger* messenger, GeometryManager* geo_mgr);
+
+        /**
+         * @brief Create the output file, write the geometry of the detectors and book the branches of the frames
+         */
+        void initialize() override;
+
+        /**
+         * @brief Encode the pixel hits of every detector and fill the frames of the event
+         */
+        void run(Event* event) override;
+
+        /**
+         * @brief Write the frames to the output file
+         */
+        void finalize() override;
+
+    private:
+        /**
+         * @brief Write the geometry of the pixel matrices of all detectors
+         */
+        void write_geometry();
+
+        Messenger* messenger_;
+        GeometryManager* geo_mgr_;
+
+        Encoding encoding_{Encoding::AUTO};
+        bool store_time_{true};
+        bool global_time_{false};
+
+        // Frame of every detector written to the branches of the tree, the branches refer to the members
+        struct DetectorFrame {
+            std::shared_ptr<Detector> detector;
+            std::uint32_t columns{};
+            std::uint32_t pixels{};
+            std::vector<FrameEncoding::Hit> hits;
+            FrameEncoding::Frame frame;
+            std::uint8_t mask{};
+        };
+        std::vector<DetectorFrame> frames_;
+        std::map<std::string, DetectorFrame*> detector_frames_;
+
+        std::string output_file_name_;
+        std::unique_ptr<TFile> output_file_;
+        TTree* frames_tree_{nullptr};
+        ULong64_t event_number_{};
+
+        // Statistics of the written frames
+        std::uint64_t write_cnt_{};
+        std::uint64_t hit_cnt_{};
+        std::uint64_t invalid_cnt_{};
+    };
+} // namespace allpix
@@ -12,13 +12,18 @@
 
 #include "GenericPropagationModule.hpp"
 
+#include <algorithm>
 #include <cmath>
+#include <iterator>
 #include <limits>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 #include <Eigen/Core>
 
@@ -30,10 +35,12 @@
 #include "core/utils/distributions.h"
 #include "core/utils/log.h"
 #include "core/utils/unit.h"
+#include "core/utils/unit_constants.h"
 #include "tools/ROOT.h"
 #include "tools/runge_kutta.h"
 
 #include "objects/DepositedCharge.hpp"
+#include "objects/PixelCharge.hpp"
 #include "objects/PropagatedCharge.hpp"
 
 using namespace allpix;
@@ -48,10 +55,15 @@ GenericPropagationModule::GenericPropagationModule(Configuration& config,
     : Module(config, detector), messenger_(messenger), detector_(std::move(detector)) {
     // Save detector model
     model_ = detector_->getModel();
+    geometry_ = GeometryKernel(model_);
 
     // Require deposits message for single detector
     messenger_->bindSingle<DepositedChargeMessage>(this, MsgFlags::REQUIRED);
 
+    // Declare the messages dispatched by this module
+    declare_output<PropagatedChargeMessage>();
+    declare_output<PixelChargeMessage>();
+
     // Set default value for config variables
     config_.setDefault<double>("spatial_precision", Units::get(0.25, "nm"));
     config_.setDefault<double>("timestep_start", Units::get(0.01, "ns"));
@@ -60,6 +72,8 @@ GenericPropagationModule::GenericPropagationModule(Configuration& config,
     config_.setDefault<double>("integration_time", Units::get(25, "ns"));
     config_.setDefault<unsigned int>("charge_per_step", 10);
     config_.setDefault<unsigned int>("max_charge_groups", 1000);
+    config_.setDefault<unsigned int>("tasks_per_event", 1);
+    config_.setDefault<unsigned int>("propagation_batch_size", 1);
     config_.setDefault<double>("temperature", 293.15);
 
     // Models:
@@ -77,6 +91,8 @@ GenericPropagationModule::GenericPropagationModule(Configuration& config,
                              config_.get<bool>("output_linegraphs") || config_.get<bool>("output_animations"));
     config_.setDefault<bool>("output_animations_color_markers", false);
     config_.setDefault<double>("output_plots_step", config_.get<double>("timestep_max"));
+    config_.setDefault<double>("output_linegraphs_tolerance", 0.);
+    config_.setDefault<bool>("output_linegraphs_deferred", false);
     config_.setDefault<bool>("output_plots_use_pixel_units", false);
     config_.setDefault<bool>("output_plots_align_pixels", false);
     config_.setDefault<double>("output_plots_theta", 0.0f);
@@ -94,6 +110,27 @@ GenericPropagationModule::GenericPropagationModule(Configuration& config,
 
     config_.setDefault<bool>("ignore_magnetic_field", false);
 
+    // Set default value for the precomputation of the drift velocity
+    config_.setDefault<bool>("precompute_velocity", false);
+
+    // Set default value for the analytic drift through regions of uniform velocity
+    config_.setDefault<bool>("analytic_drift", false);
+
+    // Set default value for sampling the survival time against recombination and trapping once per charge carrier
+    config_.setDefault<bool>("sample_survival_time", false);
+
+    // Set default values for the adaptive grouping of charge carriers
+    config_.setDefault<bool>("adaptive_charge_grouping", false);
+    config_.setDefault<unsigned int>("max_charge_per_step", 10 * config_.get<unsigned int>("charge_per_step"));
+
+    // Set default value for the grouping of charge carriers in events exceeding their time budget
+    config_.setDefault<unsigned int>("degraded_charge_per_step", 10 * config_.get<unsigned int>("charge_per_step"));
+
+    // Set defaults for the direct transfer of the propagated charges to the pixels
+    config_.setDefault<bool>("transfer_charges", false);
+    config_.setDefault<double>("max_depth_distance", Units::get(5.0, "um"));
+    config_.setDefault<bool>("collect_from_implant", false);
+
     // Set defaults for charge carrier multiplication
     config_.setDefault<std::string>("multiplication_model", "none");
     config_.setDefault<double>("multiplication_threshold", 1e-2);
@@ -105,6 +142,8 @@ GenericPropagationModule::GenericPropagationModule(Configuration& config,
     timestep_max_ = config_.get<double>("timestep_max");
     timestep_start_ = config_.get<double>("timestep_start");
     integration_time_ = config_.get<double>("integration_time");
+    deposit_culling_.configure(config_, model_);
+    deposit_ordering_.configure(config_, model_);
     target_spatial_precision_ = config_.get<double>("spatial_precision");
     output_plots_ = config_.get<bool>("output_plots");
     output_linegraphs_ = config_.get<bool>("output_linegraphs");
@@ -113,21 +152,49 @@ GenericPropagationModule::GenericPropagationModule(Configuration& config,
     output_linegraphs_trapped_ = config_.get<bool>("output_linegraphs_trapped");
     output_animations_ = config_.get<bool>("output_animations");
     output_plots_step_ = config_.get<double>("output_plots_step");
+    output_linegraphs_tolerance_ = config_.get<double>("output_linegraphs_tolerance");
+    output_linegraphs_deferred_ = config_.get<bool>("output_linegraphs_deferred");
+    if(config_.has("output_linegraphs_events")) {
+        auto events = config_.getArray<uint64_t>("output_linegraphs_events");
+        output_linegraphs_events_.insert(events.begin(), events.end());
+    }
     propagate_electrons_ = config_.get<bool>("propagate_electrons");
     propagate_holes_ = config_.get<bool>("propagate_holes");
     charge_per_step_ = config_.get<unsigned int>("charge_per_step");
     max_charge_groups_ = config_.get<unsigned int>("max_charge_groups");
+    tasks_per_event_ = std::max(1u, config_.get<unsigned int>("tasks_per_event"));
+    precompute_velocity_ = config_.get<bool>("precompute_velocity");
+    analytic_drift_ = config_.get<bool>("analytic_drift");
+    sample_survival_time_ = config_.get<bool>("sample_survival_time");
+    adaptive_charge_grouping_ = config_.get<bool>("adaptive_charge_grouping");
+    max_charge_per_step_ = config_.get<unsigned int>("max_charge_per_step");
+    degraded_charge_per_step_ = config_.get<unsigned int>("degraded_charge_per_step");
+    transfer_charges_ = config_.get<bool>("transfer_charges");
+    max_depth_distance_ = config_.get<double>("max_depth_distance");
+    collect_from_implant_ = config_.get<bool>("collect_from_implant");
     max_multiplication_level_ = config.get<unsigned int>("max_multiplication_level");
+    integration_method_ = config_.get<IntegrationMethod>("integration_method", IntegrationMethod::RKF5);
+    precision_ = config_.get<Precision>("precision", Precision::DOUBLE);
+
+    if(output_linegraphs_tolerance_ < 0) {
+        throw InvalidValueError(config_, "output_linegraphs_tolerance", "tolerance cannot be negative");
+    }
+    if(output_linegraphs_tolerance_ > 0 && output_animations_) {
+        throw InvalidCombinationError(config_,
+                                      {"output_linegraphs_tolerance", "output_animations"},
+                                      "animations require the points of the drift paths at every plot step");
+    }
 
-    // Enable multithreading of this module if multithreading is enabled and no per-event output plots are requested:
+    // Enable multithreading of this module if multithreading is enabled and no per-event output plots are requested, or
+    // if the creation of the per-event output plots is deferred to the end of the run:
     // FIXME: Review if this is really the case or we can still use multithreading
-    if(!(output_animations_ || output_linegraphs_)) {
+    if(!(output_animations_ || output_linegraphs_) || output_linegraphs_deferred_) {
         allow_multithreading();
     } else {
         LOG(WARNING) << "Per-event line graphs or animations requested, disabling parallel event processing";
     }
 
-    boltzmann_kT_ = Units::get(8.6173333e-5, "eV/K") * temperature_;
+    boltzmann_kT_ = 8.6173333e-5 * units::eV_per_K * temperature_;
 
     // Parameter for charge transport in magnetic field (approximated from graphs:
     // http://www.ioffe.ru/SVA/NSM/Semicond/Si/electric.html) FIXME
@@ -137,6 +204,72 @@ GenericPropagationModule::GenericPropagationModule(Configuration& config,
 
 void GenericPropagationModule::initialize() {
 
+    // Register the statistics of the propagation as metrics
+    register_counter(total_deposits_, "deposits", "Deposits of charge carriers");
+    register_counter(deposits_exceeding_max_groups_,
+                     "deposits_exceeding_max_groups",
+                     "Deposits with more charge carriers than allowed by the maximum number of charge groups");
+    register_counter(
+        degraded_events_, "degraded_events", "Events propagated in coarser sets for exceeding their time budget");
+    register_counter(total_propagated_charges_, "propagated_charges", "Charge carriers propagated to the sensor surface");
+    register_counter(total_recombined_charges_, "recombined_charges", "Charge carriers recombined during the propagation");
+    register_counter(total_trapped_charges_, "trapped_charges", "Charge carriers trapped during the propagation");
+    register_counter(total_steps_, "steps", "Integration steps of all charge carrier groups");
+    register_counter(
+        total_rejected_steps_, "rejected_steps", "Integration steps rejected for exceeding the spatial precision");
+    register_counter(total_time_picoseconds_, "drift_time_picoseconds", "Drift time of all propagated charge carriers");
+    register_counter(deposit_culling_.culled_outside_matrix,
+                     "culled_outside_matrix",
+                     "Deposits outside the pixel matrix culled before the propagation");
+    register_counter(deposit_culling_.culled_late,
+                     "culled_late",
+                     "Deposits beyond the maximum deposit time culled before the propagation");
+    register_counter(deposit_culling_.culled_low_charge,
+                     "culled_low_charge",
+                     "Deposits below the minimum deposit charge culled before the propagation");
+    if(transfer_charges_) {
+        register_counter(total_transferred_charges_, "transferred_charges", "Charge carriers transferred to the pixels");
+    }
+    auto total_charges = [this]() {
+        return static_cast<double>(total_propagated_charges_.value() + total_recombined_charges_.value() +
+                                   total_trapped_charges_.value());
+    };
+    register_gauge("steps_per_charge", "Average number of integration steps per charge carrier", [this, total_charges]() {
+        return static_cast<double>(total_steps_.value()) / std::max(1., total_charges());
+    });
+    register_gauge("recombined_fraction", "Fraction of the charge carriers recombined", [this, total_charges]() {
+        return static_cast<double>(total_recombined_charges_.value()) / std::max(1., total_charges());
+    });
+    register_gauge("trapped_fraction", "Fraction of the charge carriers trapped", [this, total_charges]() {
+        return static_cast<double>(total_trapped_charges_.value()) / std::max(1., total_charges());
+    });
+
+    // Only store the propagated charges if they are received by another module or transferred to the pixels directly
+    dispatch_charges_ = messenger_->hasReceiver<PropagatedChargeMessage>(this, detector_);
+    store_charges_ = dispatch_charges_ || transfer_charges_;
+    if(!dispatch_charges_) {
+        LOG(INFO) << "No receiver for the propagated charges, not storing them";
+    }
+
+    if(transfer_charges_) {
+        if(collect_from_implant_) {
+            if(model_->getImplants().empty()) {
+                throw InvalidValueError(config_,
+                                        "collect_from_implant",
+                                        "Detector model does not have implants defined, but collection requested from "
+                                        "implants");
+            }
+            if(detector_->getElectricFieldType() == FieldType::LINEAR) {
+                throw InvalidValueError(config_,
+                                        "collect_from_implant",
+                                        "charge collection from implant region should not be used with linear electric "
+                                        "fields");
+            }
+        }
+        LOG(INFO) << "Transferring propagated charges to the pixels directly, collecting from "
+                  << (collect_from_implant_ ? "implants" : "full sensor surface");
+    }
+
     // Check for electric field and output warning for slow propagation if not defined
     if(!detector_->hasElectricField()) {
         LOG(WARNING) << "This detector does not have an electric field.";
@@ -160,6 +293,25 @@ void GenericPropagationModule::initialize() {
         }
     }
 
+    // Resample the electric field and the doping profile onto a combined grid spanning a single pixel cell if requested
+    if(config_.get<bool>("combine_fields", false)) {
+        if(model_->getPixelType() != Pixel::Type::RECTANGLE) {
+            throw InvalidValueError(config_, "combine_fields", "combining the fields requires rectangular pixels");
+        }
+        auto bins = config_.getArray<size_t>("combined_field_bins", {100, 100, 100});
+        if(bins.size() != 3 || std::find(bins.begin(), bins.end(), 0) != bins.end()) {
+            throw InvalidValueError(
+                config_, "combined_field_bins", "three non-zero numbers of bins in x, y and z are required");
+        }
+        try {
+            detector_->combineElectricFieldAndDoping({{bins[0], bins[1], bins[2]}});
+        } catch(std::invalid_argument& e) {
+            throw InvalidValueError(config_, "combine_fields", e.what());
+        }
+        LOG(INFO) << "Combined electric field and doping profile on a grid with " << bins[0] << "x" << bins[1] << "x"
+                  << bins[2] << " bins";
+    }
+
     // Check for magnetic field
     has_magnetic_field_ = detector_->hasMagneticField();
     if(has_magnetic_field_) {
@@ -328,24 +480,398 @@ void GenericPropagationModule::initialize() {
 
     // Prepare trapping model
     detrapping_ = Detrapping(config_);
+
+    // Configure the batched propagation of charge carrier sets
+    batch_size_ = std::max(1u, config_.get<unsigned int>("propagation_batch_size"));
+    if(batch_size_ > max_batch_size_) {
+        throw InvalidValueError(config_,
+                                "propagation_batch_size",
+                                "batches can hold at most " + std::to_string(max_batch_size_) + " charge carrier sets");
+    }
+    if(batch_size_ > 1) {
+        if(!multiplication_.is<NoImpactIonization>() || output_linegraphs_ || analytic_drift_ ||
+           integration_method_ != IntegrationMethod::RKF5) {
+            LOG(WARNING) << "Batched propagation does not support charge multiplication, line graphs, analytic drift or "
+                            "integration methods other than RKF5, propagating charge carrier sets individually";
+            batch_size_ = 1;
+        } else {
+            LOG(INFO) << "Propagating charge carrier sets in batches of " << batch_size_;
+        }
+    }
+    if(precision_ == Precision::FLOAT) {
+        if(batch_size_ > 1) {
+            LOG(INFO) << "Integrating batched charge carrier sets in single precision";
+        } else {
+            LOG(WARNING) << "Single precision is only used for batched propagation, integrating in double precision";
+            precision_ = Precision::DOUBLE;
+        }
+    }
+
+    // Precompute the drift velocity maps for static fields if requested
+    if(precompute_velocity_) {
+        // The maps span a single pixel cell and require all fields to repeat in every pixel
+        if(model_->getPixelType() != Pixel::Type::RECTANGLE) {
+            throw InvalidValueError(
+                config_, "precompute_velocity", "precomputing the drift velocity requires rectangular pixels");
+        }
+        if((detector_->getElectricFieldType() == FieldType::GRID &&
+            detector_->getElectricFieldMapping() == FieldMapping::SENSOR) ||
+           (detector_->getDopingProfileType() == FieldType::GRID &&
+            detector_->getDopingProfileMapping() == FieldMapping::SENSOR)) {
+            throw InvalidValueError(config_,
+                                    "precompute_velocity",
+                                    "precomputing the drift velocity requires fields mapped to the pixel cell");
+        }
+
+        auto bins = config_.getArray<size_t>("velocity_map_bins", {100, 100, 100});
+        if(bins.size() != 3 || std::find(bins.begin(), bins.end(), 0) != bins.end()) {
+            throw InvalidValueError(
+                config_, "velocity_map_bins", "three non-zero numbers of bins in x, y and z are required");
+        }
+        LOG(INFO) << "Precomputing drift velocity maps with " << bins[0] << "x" << bins[1] << "x" << bins[2] << " bins";
+        if(propagate_electrons_ || !multiplication_.is<NoImpactIonization>()) {
+            electron_velocity_map_ = create_velocity_map(CarrierType::ELECTRON, {{bins[0], bins[1], bins[2]}});
+        }
+        if(propagate_holes_ || !multiplication_.is<NoImpactIonization>()) {
+            hole_velocity_map_ = create_velocity_map(CarrierType::HOLE, {{bins[0], bins[1], bins[2]}});
+        }
+    }
+
+    // Find the regions of uniform drift velocity for the analytic drift if requested
+    if(analytic_drift_) {
+        // The velocity is sampled in a single pixel cell and requires all fields to repeat in every pixel cell
+        if(model_->getPixelType() != Pixel::Type::RECTANGLE) {
+            throw InvalidValueError(config_, "analytic_drift", "the analytic drift requires rectangular pixels");
+        }
+        if((detector_->getElectricFieldType() == FieldType::GRID &&
+            detector_->getElectricFieldMapping() == FieldMapping::SENSOR) ||
+           (detector_->getDopingProfileType() == FieldType::GRID &&
+            detector_->getDopingProfileMapping() == FieldMapping::SENSOR)) {
+            throw InvalidValueError(
+                config_, "analytic_drift", "the analytic drift requires fields mapped to the pixel cell");
+        }
+
+        auto bins = config_.getArray<size_t>("analytic_drift_bins", {10, 10, 100});
+        if(bins.size() != 3 || std::find(bins.begin(), bins.end(), 0) != bins.end()) {
+            throw InvalidValueError(
+                config_, "analytic_drift_bins", "three non-zero numbers of sampling points in x, y and z are required");
+        }
+        auto tolerance = config_.get<double>("analytic_drift_tolerance", 0.01);
+        if(tolerance <= 0) {
+            throw InvalidValueError(config_, "analytic_drift_tolerance", "tolerance has to be positive");
+        }
+
+        for(auto type : {CarrierType::ELECTRON, CarrierType::HOLE}) {
+            if(!(type == CarrierType::ELECTRON ? propagate_electrons_ : propagate_holes_) &&
+               multiplication_.is<NoImpactIonization>()) {
+                continue;
+            }
+            auto& regions = (type == CarrierType::ELECTRON ? electron_uniform_regions_ : hole_uniform_regions_);
+            regions = find_uniform_regions(type, {{bins[0], bins[1], bins[2]}}, tolerance);
+
+            // Validate the analytic drift by integrating the drift numerically across each region from the pixel center
+            double thickness = 0, max_deviation = 0;
+            auto reference = model_->getPixelCenter(0, 0);
+            for(const auto& region : regions) {
+                thickness += region.z_max - region.z_min;
+                auto drift_time =
+                    std::min((region.z_max - region.z_min) / std::fabs(region.velocity.z()), integration_time_);
+                Eigen::Vector3d start(
+                    reference.x(), reference.y(), (region.velocity.z() > 0 ? region.z_min : region.z_max));
+
+                constexpr int validation_steps = 1000;
+                auto runge_kutta = make_runge_kutta(
+                    tableau::StaticRK5{},
+                    [&](double, const Eigen::Vector3d& cur_pos) -> Eigen::Vector3d { return drift_velocity(type, cur_pos); },
+                    drift_time / validation_steps,
+                    start);
+                runge_kutta.step(validation_steps);
+                max_deviation =
+                    std::max(max_deviation, (runge_kutta.getValue() - (start + region.velocity * drift_time)).norm());
+            }
+            LOG(INFO) << "Found " << regions.size() << " regions of uniform " << type << " drift velocity covering "
+                      << Units::display(thickness, {"um", "mm"}) << " of the sensor thickness, maximum deviation of "
+                      << "the analytic drift from the numerical integration "
+                      << Units::display(max_deviation, {"nm", "um"});
+        }
+    }
+
+    // Estimate the lateral diffusion of the charge carriers for the adaptive charge grouping if requested
+    if(adaptive_charge_grouping_) {
+        if(max_charge_per_step_ < charge_per_step_) {
+            throw InvalidValueError(config_,
+                                    "max_charge_per_step",
+                                    "maximum number of charge carriers per step has to be at least charge_per_step");
+        }
+        for(auto type : {CarrierType::ELECTRON, CarrierType::HOLE}) {
+            if(!(type == CarrierType::ELECTRON ? propagate_electrons_ : propagate_holes_)) {
+                continue;
+            }
+            auto& spread = (type == CarrierType::ELECTRON ? electron_diffusion_spread_ : hole_diffusion_spread_);
+            spread = estimate_diffusion_spread(type, 100);
+            size_t reaching = 0;
+            double max_spread = 0;
+            for(auto sigma : spread) {
+                if(std::isfinite(sigma)) {
+                    ++reaching;
+                    max_spread = std::max(max_spread, sigma);
+                }
+            }
+            LOG(INFO) << "Estimated lateral diffusion of " << type << "s reaching the sensor surface from " << reaching
+                      << " of " << spread.size() << " layers, up to " << Units::display(max_spread, {"um", "mm"});
+        }
+    }
 }
 
-void GenericPropagationModule::run(Event* event) {
-    auto deposits_message = messenger_->fetchMessage<DepositedChargeMessage>(this, event);
+/**
+ * The drift velocity, mobility and diffusion constant are sampled along the axis through the center of the first pixel. The
+ * charge carriers of every layer drift along z in the direction of the velocity at its center, and the variance of the
+ * lateral diffusion accumulates the diffusion of every layer crossed until the surface is reached, weighted with the time
+ * required to cross it. Charge carriers reversing their direction of motion along the way do not reach the surface.
+ */
+std::vector<double> GenericPropagationModule::estimate_diffusion_spread(const CarrierType& type, size_t bins) const {
+    auto reference = model_->getPixelCenter(0, 0);
+    auto z_min = model_->getSensorCenter().z() - model_->getSensorSize().z() / 2.0;
+    auto layer_height = model_->getSensorSize().z() / static_cast<double>(bins);
+
+    // Sample the velocity along z and the variance of the lateral diffusion accumulated while crossing every layer
+    std::vector<double> velocity(bins), variance(bins);
+    for(size_t k = 0; k < bins; ++k) {
+        Eigen::Vector3d position(reference.x(), reference.y(), z_min + (static_cast<double>(k) + 0.5) * layer_height);
+        auto [efield, doping] = detector_->getElectricFieldAndDoping(static_cast<ROOT::Math::XYZPoint>(position));
+        velocity[k] = drift_velocity(type, position).z();
+        auto diffusion_constant = boltzmann_kT_ * mobility_(type, std::sqrt(efield.Mag2()), doping);
+        variance[k] = (velocity[k] != 0 ? 2. * diffusion_constant * layer_height / std::fabs(velocity[k])
+                                        : std::numeric_limits<double>::infinity());
+    }
 
-    // Create vector of propagated charges to output
-    std::vector<PropagatedCharge> propagated_charges;
+    // Accumulate the variance towards the upper and the lower surface of the sensor
+    std::vector<double> upwards(bins), downwards(bins);
+    for(size_t k = bins; k-- > 0;) {
+        upwards[k] =
+            (velocity[k] > 0 ? variance[k] + (k + 1 < bins ? upwards[k + 1] : 0.) : std::numeric_limits<double>::infinity());
+    }
+    for(size_t k = 0; k < bins; ++k) {
+        downwards[k] =
+            (velocity[k] < 0 ? variance[k] + (k > 0 ? downwards[k - 1] : 0.) : std::numeric_limits<double>::infinity());
+    }
 
-    // List of points to plot to plot for output plots
-    LineGraph::OutputPlotPoints output_plot_points;
+    std::vector<double> spread(bins);
+    for(size_t k = 0; k < bins; ++k) {
+        spread[k] = std::sqrt(velocity[k] > 0 ? upwards[k] : downwards[k]);
+    }
+    return spread;
+}
 
-    // Loop over all deposits for propagation
-    LOG(TRACE) << "Propagating charges in sensor";
-    unsigned int propagated_charges_count = 0;
-    unsigned int recombined_charges_count = 0;
-    unsigned int trapped_charges_count = 0;
-    unsigned int step_count = 0;
-    long double total_time = 0;
+/**
+ * The sensitivity of the charge sharing to the grouping is estimated as the probability of a charge carrier to diffuse
+ * across the closest pixel boundary, given by the complementary error function of the distance to the boundary relative to
+ * the lateral diffusion spread. It is one at the boundary and vanishes deep inside the pixel. The number of charge carriers
+ * propagated together is scaled with the inverse of the sensitivity and limited by the maximum number of charge carriers.
+ */
+unsigned int GenericPropagationModule::adaptive_charge_per_step(const DepositedCharge& deposit,
+                                                                unsigned int charge_per_step) const {
+    const auto& spread =
+        (deposit.getType() == CarrierType::ELECTRON ? electron_diffusion_spread_ : hole_diffusion_spread_);
+    auto position = deposit.getLocalPosition();
+    auto depth = (position.z() - model_->getSensorCenter().z()) / model_->getSensorSize().z() + 0.5;
+    auto layer = std::min(spread.size() - 1, static_cast<size_t>(std::max(0., depth) * static_cast<double>(spread.size())));
+
+    // Distance to the closest boundary of the pixel the deposit is in, estimated from the pixel pitch
+    auto [xpixel, ypixel] = geometry_.getPixelIndex(position);
+    auto center = model_->getPixelCenter(xpixel, ypixel);
+    auto pitch = model_->getPixelSize();
+    auto distance = std::max(0.,
+                             std::min(pitch.x() / 2 - std::fabs(position.x() - center.x()),
+                                      pitch.y() / 2 - std::fabs(position.y() - center.y())));
+
+    auto sensitivity = (distance > 0 ? std::erfc(distance / (std::sqrt(2.) * spread[layer])) : 1.);
+    auto max_charge_per_step = std::max(charge_per_step, max_charge_per_step_);
+    return static_cast<unsigned int>(std::min(static_cast<double>(max_charge_per_step),
+                                              static_cast<double>(charge_per_step) / sensitivity));
+}
+
+/**
+ * The velocity is sampled at the centers of a grid of points in every layer of a single pixel cell, excluding the layers
+ * covered by implants. Consecutive layers are combined into a region as long as every component of the velocity at all
+ * points of the region deviates by at most the tolerance from the center of its range, relative to the magnitude of the
+ * velocity of the region. Only regions spanning more than a single layer are kept.
+ */
+std::vector<GenericPropagationModule::UniformRegion>
+GenericPropagationModule::find_uniform_regions(const CarrierType& type, std::array<size_t, 3> bins, double tolerance) const {
+    // Restrict the regions to the sensor bulk outside of the implants
+    auto sensor_min = model_->getSensorCenter().z() - model_->getSensorSize().z() / 2.0;
+    auto sensor_max = model_->getSensorCenter().z() + model_->getSensorSize().z() / 2.0;
+    auto z_min = sensor_min, z_max = sensor_max;
+    for(const auto& implant : model_->getImplants()) {
+        if(implant.getType() == DetectorModel::Implant::Type::FRONTSIDE) {
+            z_max = std::min(z_max, sensor_max - implant.getSize().z());
+        } else {
+            z_min = std::max(z_min, sensor_min + implant.getSize().z());
+        }
+    }
+    if(z_max <= z_min) {
+        return {};
+    }
+
+    // Sample the range of the velocity components in every layer
+    auto reference = model_->getPixelCenter(0, 0);
+    auto pitch = model_->getPixelSize();
+    auto layer_height = (z_max - z_min) / static_cast<double>(bins[2]);
+    std::vector<Eigen::Vector3d> layer_min(bins[2], Eigen::Vector3d::Constant(std::numeric_limits<double>::max()));
+    std::vector<Eigen::Vector3d> layer_max(bins[2], Eigen::Vector3d::Constant(std::numeric_limits<double>::lowest()));
+    for(size_t k = 0; k < bins[2]; ++k) {
+        auto z = z_min + (static_cast<double>(k) + 0.5) * layer_height;
+        for(size_t i = 0; i < bins[0]; ++i) {
+            auto x = reference.x() + ((static_cast<double>(i) + 0.5) / static_cast<double>(bins[0]) - 0.5) * pitch.x();
+            for(size_t j = 0; j < bins[1]; ++j) {
+                auto y = reference.y() + ((static_cast<double>(j) + 0.5) / static_cast<double>(bins[1]) - 0.5) * pitch.y();
+                auto velocity = drift_velocity(type, Eigen::Vector3d(x, y, z));
+                layer_min[k] = layer_min[k].cwiseMin(velocity);
+                layer_max[k] = layer_max[k].cwiseMax(velocity);
+            }
+        }
+    }
+
+    // Combine consecutive layers as long as the velocity stays uniform
+    auto is_uniform = [tolerance](const Eigen::Vector3d& min, const Eigen::Vector3d& max) {
+        auto magnitude = ((min + max) / 2.).norm();
+        return magnitude > 0 && ((max - min) / 2.).maxCoeff() <= tolerance * magnitude;
+    };
+    std::vector<UniformRegion> regions;
+    size_t first = 0;
+    while(first < bins[2]) {
+        Eigen::Vector3d min = layer_min[first], max = layer_max[first];
+        if(!is_uniform(min, max)) {
+            ++first;
+            continue;
+        }
+        auto last = first + 1;
+        while(last < bins[2] && is_uniform(min.cwiseMin(layer_min[last]), max.cwiseMax(layer_max[last]))) {
+            min = min.cwiseMin(layer_min[last]);
+            max = max.cwiseMax(layer_max[last]);
+            ++last;
+        }
+        if(last - first > 1) {
+            regions.push_back({z_min + static_cast<double>(first) * layer_height,
+                               z_min + static_cast<double>(last) * layer_height,
+                               (min + max) / 2.});
+        }
+        first = last;
+    }
+    return regions;
+}
+
+/**
+ * The velocity is sampled relative to the center of the first pixel, the map is then replicated for every pixel of the
+ * matrix. The mobility, temperature, doping and the magnetic field are static, such that the velocity only depends on the
+ * position.
+ */
+DetectorField<ROOT::Math::XYZVector> GenericPropagationModule::create_velocity_map(const CarrierType& type,
+                                                                                   std::array<size_t, 3> bins) const {
+    auto reference = model_->getPixelCenter(0, 0);
+    auto thickness_domain = std::make_pair(model_->getSensorCenter().z() - model_->getSensorSize().z() / 2.0,
+                                           model_->getSensorCenter().z() + model_->getSensorSize().z() / 2.0);
+
+    DetectorField<ROOT::Math::XYZVector> velocity_map(model_);
+    velocity_map.setFunction(
+        [this, type, reference](const ROOT::Math::XYZPoint& pos) {
+            auto velocity = drift_velocity(type, Eigen::Vector3d(reference.x() + pos.x(), reference.y() + pos.y(), pos.z()));
+            return ROOT::Math::XYZVector(velocity.x(), velocity.y(), velocity.z());
+        },
+        thickness_domain);
+    velocity_map.tabulate(bins, {{model_->getPixelSize().x(), model_->getPixelSize().y()}});
+    return velocity_map;
+}
+
+Eigen::Vector3d GenericPropagationModule::drift_velocity(const CarrierType& type, const Eigen::Vector3d& pos) const {
+    auto [raw_field, doping] = detector_->getElectricFieldAndDoping(static_cast<ROOT::Math::XYZPoint>(pos));
+    Eigen::Vector3d efield(raw_field.x(), raw_field.y(), raw_field.z());
+
+    if(!has_magnetic_field_) {
+        return drift_velocity(type, efield, doping, Eigen::Vector3d::Zero());
+    }
+
+    auto magnetic_field = detector_->getMagneticField(static_cast<ROOT::Math::XYZPoint>(pos));
+    return drift_velocity(type, efield, doping, Eigen::Vector3d(magnetic_field.x(), magnetic_field.y(), magnetic_field.z()));
+}
+
+Eigen::Vector3d GenericPropagationModule::drift_velocity(const CarrierType& type,
+                                                         const Eigen::Vector3d& efield,
+                                                         double doping,
+                                                         const Eigen::Vector3d& bfield) const {
+    return lorentz_drift(type, mobility_(type, efield.norm(), doping), efield, bfield);
+}
+
+Eigen::Vector3d GenericPropagationModule::lorentz_drift(const CarrierType& type,
+                                                        double mob,
+                                                        const Eigen::Vector3d& efield,
+                                                        const Eigen::Vector3d& bfield) const {
+    if(!has_magnetic_field_) {
+        return static_cast<int>(type) * mob * efield;
+    }
+
+    auto exb = efield.cross(bfield);
+
+    Eigen::Vector3d term1;
+    double hallFactor = (type == CarrierType::ELECTRON ? electron_Hall_ : hole_Hall_);
+    term1 = static_cast<int>(type) * mob * hallFactor * exb;
+
+    Eigen::Vector3d term2 = mob * mob * hallFactor * hallFactor * efield.dot(bfield) * bfield;
+
+    auto rnorm = 1 + mob * mob * hallFactor * hallFactor * bfield.dot(bfield);
+    return static_cast<int>(type) * mob * (efield + term1 + term2) / rnorm;
+}
+
+/**
+ * The fields are looked up for blocks of positions at once, and the type of the mobility model is resolved once per block
+ * such that the model is evaluated without virtual dispatch for every single position.
+ */
+void GenericPropagationModule::drift_velocity(const CarrierType& type,
+                                              const double* x,
+                                              const double* y,
+                                              const double* z,
+                                              size_t count,
+                                              const std::array<double*, 3>& velocity) const {
+    std::array<double, max_batch_size_> efield_x{}, efield_y{}, efield_z{}, doping{}, mob{};
+    std::array<double, max_batch_size_> bfield_x{}, bfield_y{}, bfield_z{};
+    for(size_t first = 0; first < count; first += max_batch_size_) {
+        auto block = std::min(max_batch_size_, count - first);
+        detector_->getElectricFieldAndDoping(x + first,
+                                             y + first,
+                                             z + first,
+                                             block,
+                                             {efield_x.data(), efield_y.data(), efield_z.data()},
+                                             doping.data());
+        if(has_magnetic_field_) {
+            detector_->getMagneticField(
+                x + first, y + first, z + first, block, {bfield_x.data(), bfield_y.data(), bfield_z.data()});
+        }
+
+        // Evaluate the mobility model for the whole block with a single dispatch
+        mobility_.visit([&](const auto& mobility) {
+            for(size_t i = 0; i < block; ++i) {
+                mob[i] = mobility(type, Eigen::Vector3d(efield_x[i], efield_y[i], efield_z[i]).norm(), doping[i]);
+            }
+        });
+
+        for(size_t i = 0; i < block; ++i) {
+            auto result = lorentz_drift(type,
+                                        mob[i],
+                                        Eigen::Vector3d(efield_x[i], efield_y[i], efield_z[i]),
+                                        Eigen::Vector3d(bfield_x[i], bfield_y[i], bfield_z[i]));
+            velocity[0][first + i] = result.x();
+            velocity[1][first + i] = result.y();
+            velocity[2][first + i] = result.z();
+        }
+    }
+}
+
+void GenericPropagationModule::run(Event* event) {
+    auto deposits_message = messenger_->fetchMessage<DepositedChargeMessage>(this, event);
+
+    // Select all deposits to be propagated, reusing the memory of the previous events
+    auto& deposits = scratch<std::vector<const DepositedCharge*>>();
     for(const auto& deposit : deposits_message->getData()) {
 
         if((deposit.getType() == CarrierType::ELECTRON && !propagate_electrons_) ||
@@ -363,64 +889,188 @@ void GenericPropagationModule::run(Event* event) {
             continue;
         }
 
-        total_deposits_++;
+        // Drop deposits which are not worth propagating
+        if(deposit_culling_.cull(deposit)) {
+            LOG(DEBUG) << "Culling " << deposit.getCharge() << " charge carriers deposited on "
+                       << Units::display(deposit.getLocalPosition(), {"mm", "um"}) << " at "
+                       << Units::display(deposit.getGlobalTime(), "ns") << " global";
+            continue;
+        }
+
+        deposits.push_back(&deposit);
+    }
 
-        // Loop over all charges in the deposit
-        unsigned int charges_remaining = deposit.getCharge();
+    // Propagate neighboring deposits consecutively to access the same regions of the field maps
+    if(deposit_ordering_.enabled()) {
+        deposit_ordering_.sort(deposits);
+        LOG(DEBUG) << "Sorted " << deposits.size() << " deposits by carrier type and position";
+    }
 
-        LOG(DEBUG) << "Set of charge carriers (" << deposit.getType() << ") on "
-                   << Units::display(deposit.getLocalPosition(), {"mm", "um"});
+    // Propagated charges, plot points and statistics of a contiguous range of deposits, with the propagated charges kept
+    // as plain data until they are dispatched
+    struct PropagationResult {
+        std::vector<PropagatedChargeData> propagated_charges;
+        LineGraph::OutputPlotPoints output_plot_points;
+        unsigned int propagated_charges_count{};
+        unsigned int recombined_charges_count{};
+        unsigned int trapped_charges_count{};
+        unsigned int step_count{};
+        unsigned int rejected_step_count{};
+        long double total_time{};
+    };
 
-        auto charge_per_step = charge_per_step_;
-        if(max_charge_groups_ > 0 && deposit.getCharge() / charge_per_step > max_charge_groups_) {
-            charge_per_step = static_cast<unsigned int>(ceil(static_cast<double>(deposit.getCharge()) / max_charge_groups_));
-            deposits_exceeding_max_groups_++;
-            LOG(INFO) << "Deposited charge: " << deposit.getCharge()
-                      << ", which exceeds the maximum number of charge groups allowed. Increasing charge_per_step to "
-                      << charge_per_step << " for this deposit.";
-        }
-        while(charges_remaining > 0) {
-            // Define number of charges to be propagated and remove charges of this step from the total
-            if(charge_per_step > charges_remaining) {
-                charge_per_step = charges_remaining;
+    // Record the drift paths for line graphs only for the selected events
+    auto record_plot_points = output_linegraphs_ && (output_linegraphs_events_.empty() ||
+                                                     output_linegraphs_events_.find(event->number) !=
+                                                         output_linegraphs_events_.end());
+
+    // Propagate the remaining deposits of events exceeding their time budget in coarser sets without line graphs
+    std::atomic_bool degraded{false};
+
+    auto propagate_deposits =
+        [&](size_t first, size_t last, RandomNumberGenerator& random_generator, PropagationResult& result) {
+            // Sets of charges collected per carrier type for the batched propagation
+            std::vector<ChargeGroup> electron_groups, hole_groups;
+            auto* output_plot_points = (record_plot_points ? &result.output_plot_points : nullptr);
+
+            for(size_t i = first; i < last; ++i) {
+                const auto& deposit = *deposits[i];
+                ++total_deposits_;
+
+                if(!degraded && event->isOverBudget()) {
+                    degraded = true;
+                }
+                if(degraded) {
+                    output_plot_points = nullptr;
+                }
+
+                // Loop over all charges in the deposit
+                unsigned int charges_remaining = deposit.getCharge();
+
+                LOG(DEBUG) << "Set of charge carriers (" << deposit.getType() << ") on "
+                           << Units::display(deposit.getLocalPosition(), {"mm", "um"});
+
+                auto charge_per_step = (degraded ? std::max(charge_per_step_, degraded_charge_per_step_) : charge_per_step_);
+                if(max_charge_groups_ > 0 && deposit.getCharge() / charge_per_step > max_charge_groups_) {
+                    charge_per_step =
+                        static_cast<unsigned int>(ceil(static_cast<double>(deposit.getCharge()) / max_charge_groups_));
+                    ++deposits_exceeding_max_groups_;
+                    LOG(INFO) << "Deposited charge: " << deposit.getCharge()
+                              << ", which exceeds the maximum number of charge groups allowed. "
+                              << "Increasing charge_per_step to " << charge_per_step << " for this deposit.";
+                }
+                if(adaptive_charge_grouping_) {
+                    charge_per_step = adaptive_charge_per_step(deposit, charge_per_step);
+                    LOG(DEBUG) << "Propagating sets of " << charge_per_step << " charge carriers for this deposit";
+                }
+                while(charges_remaining > 0) {
+                    // Define number of charges to be propagated and remove charges of this step from the total
+                    if(charge_per_step > charges_remaining) {
+                        charge_per_step = charges_remaining;
+                    }
+                    charges_remaining -= charge_per_step;
+
+                    // Defer the propagation to the batched propagation if enabled
+                    if(batch_size_ > 1) {
+                        auto& groups = (deposit.getType() == CarrierType::ELECTRON ? electron_groups : hole_groups);
+                        groups.push_back({&deposit, charge_per_step});
+                        continue;
+                    }
+
+                    // Propagate a single charge deposit
+                    auto [recombined, trapped, propagated, steps, rejected, time] = propagate(random_generator,
+                                                                                    deposit,
+                                                                                    deposit.getLocalPosition(),
+                                                                                    deposit.getType(),
+                                                                                    charge_per_step,
+                                                                                    deposit.getLocalTime(),
+                                                                                    deposit.getGlobalTime(),
+                                                                                    0,
+                                                                                    result.propagated_charges,
+                                                                                    output_plot_points);
+
+                    // Update statistical information
+                    result.recombined_charges_count += recombined;
+                    result.trapped_charges_count += trapped;
+                    result.propagated_charges_count += propagated;
+                    result.step_count += steps;
+                    result.rejected_step_count += rejected;
+                    result.total_time += time;
+                }
             }
-            charges_remaining -= charge_per_step;
 
-            // Propagate a single charge deposit
-            auto [recombined, trapped, propagated, steps, time] = propagate(event,
-                                                                            deposit,
-                                                                            deposit.getLocalPosition(),
-                                                                            deposit.getType(),
-                                                                            charge_per_step,
-                                                                            deposit.getLocalTime(),
-                                                                            deposit.getGlobalTime(),
-                                                                            0,
-                                                                            propagated_charges,
-                                                                            output_plot_points);
+            // Propagate the collected sets of charges in batches
+            for(auto type : {CarrierType::ELECTRON, CarrierType::HOLE}) {
+                const auto& groups = (type == CarrierType::ELECTRON ? electron_groups : hole_groups);
+                if(groups.empty()) {
+                    continue;
+                }
+                auto [recombined, trapped, propagated, steps, rejected, time] =
+                    (precision_ == Precision::FLOAT
+                         ? propagate_batch<float>(random_generator, type, groups, result.propagated_charges)
+                         : propagate_batch<double>(random_generator, type, groups, result.propagated_charges));
+                result.recombined_charges_count += recombined;
+                result.trapped_charges_count += trapped;
+                result.propagated_charges_count += propagated;
+                result.step_count += steps;
+                result.rejected_step_count += rejected;
+                result.total_time += time;
+            }
+        };
 
-            // Update statistical information
-            recombined_charges_count += recombined;
-            trapped_charges_count += trapped;
-            propagated_charges_count += propagated;
-            step_count += steps;
-            total_time += time;
+    // Loop over all deposits for propagation
+    LOG(TRACE) << "Propagating charges in sensor";
+    PropagationResult total;
+    auto num_tasks = std::min<size_t>(tasks_per_event_, deposits.size());
+    if(num_tasks > 1) {
+        // Split the deposits into contiguous chunks which are propagated independently with their own random stream
+        std::vector<PropagationResult> results(num_tasks);
+        auto chunk_size = (deposits.size() + num_tasks - 1) / num_tasks;
+        event->parallelFor(num_tasks, [&](size_t task, RandomNumberGenerator& random_generator) {
+            auto first = std::min(deposits.size(), task * chunk_size);
+            auto last = std::min(deposits.size(), first + chunk_size);
+            propagate_deposits(first, last, random_generator, results[task]);
+        });
+
+        // Merge the results in task order to keep the output independent of the execution order
+        for(auto& result : results) {
+            std::move(result.propagated_charges.begin(),
+                      result.propagated_charges.end(),
+                      std::back_inserter(total.propagated_charges));
+            std::move(result.output_plot_points.begin(),
+                      result.output_plot_points.end(),
+                      std::back_inserter(total.output_plot_points));
+            total.propagated_charges_count += result.propagated_charges_count;
+            total.recombined_charges_count += result.recombined_charges_count;
+            total.trapped_charges_count += result.trapped_charges_count;
+            total.step_count += result.step_count;
+            total.rejected_step_count += result.rejected_step_count;
+            total.total_time += result.total_time;
         }
+    } else {
+        propagate_deposits(0, deposits.size(), event->getRandomEngine(), total);
     }
 
-    // Output plots if required
-    if(output_linegraphs_) {
-        LineGraph::Create(event->number, this, config_, output_plot_points, CarrierState::UNKNOWN);
-        if(output_linegraphs_collected_) {
-            LineGraph::Create(event->number, this, config_, output_plot_points, CarrierState::HALTED);
-        }
-        if(output_linegraphs_recombined_) {
-            LineGraph::Create(event->number, this, config_, output_plot_points, CarrierState::RECOMBINED);
-        }
-        if(output_linegraphs_trapped_) {
-            LineGraph::Create(event->number, this, config_, output_plot_points, CarrierState::TRAPPED);
-        }
-        if(output_animations_) {
-            LineGraph::Animate(event->number, this, config_, output_plot_points);
+    auto propagated_charges_count = total.propagated_charges_count;
+    auto recombined_charges_count = total.recombined_charges_count;
+    auto trapped_charges_count = total.trapped_charges_count;
+    auto step_count = total.step_count;
+    auto rejected_step_count = total.rejected_step_count;
+    auto total_time = total.total_time;
+
+    if(degraded) {
+        LOG(INFO) << "Event exceeded its time budget, propagated remaining deposits in sets of "
+                  << std::max(charge_per_step_, degraded_charge_per_step_) << " charge carriers without line graphs";
+        ++degraded_events_;
+    }
+
+    // Output plots if required, or keep the points until the end of the run if the plots are deferred
+    if(record_plot_points && !degraded) {
+        if(output_linegraphs_deferred_) {
+            std::lock_guard<std::mutex> lock(deferred_plot_points_mutex_);
+            deferred_plot_points_.emplace(event->number, std::move(total.output_plot_points));
+        } else {
+            create_output_plots(event->number, total.output_plot_points);
         }
     }
 
@@ -430,9 +1080,15 @@ void GenericPropagationModule::run(Event* event) {
               << Units::display(average_time, "ns") << std::endl
               << "Recombined " << recombined_charges_count << " charges during transport" << std::endl
               << "Trapped " << trapped_charges_count << " charges during transport";
+    if(integration_method_ == IntegrationMethod::DOPRI5) {
+        LOG(INFO) << "Rejected " << rejected_step_count << " integration steps exceeding the spatial precision";
+    }
     total_propagated_charges_ += propagated_charges_count;
+    total_recombined_charges_ += recombined_charges_count;
+    total_trapped_charges_ += trapped_charges_count;
     total_steps_ += step_count;
-    total_time_picoseconds_ += static_cast<long unsigned int>(total_time * 1e3);
+    total_rejected_steps_ += rejected_step_count;
+    total_time_picoseconds_ += static_cast<uint64_t>(total_time * 1e3);
 
     if(output_plots_) {
         auto total = (propagated_charges_count + recombined_charges_count + trapped_charges_count);
@@ -440,29 +1096,112 @@ void GenericPropagationModule::run(Event* event) {
         trapped_histo_->Fill(static_cast<double>(trapped_charges_count) / (total == 0 ? 1 : total));
     }
 
+    // Convert the data of the propagated charges to objects only once for the message, if any module receives them
+    std::vector<PropagatedCharge> propagated_charges;
+    if(dispatch_charges_) {
+        propagated_charges.reserve(total.propagated_charges.size());
+        for(const auto& propagated_charge : total.propagated_charges) {
+            propagated_charges.emplace_back(propagated_charge);
+        }
+    }
+
     // Create a new message with propagated charges
-    auto propagated_charge_message = std::make_shared<PropagatedChargeMessage>(std::move(propagated_charges), detector_);
+    auto propagated_charge_message = event->makeShared<PropagatedChargeMessage>(std::move(propagated_charges), detector_);
+
+    // Sum the propagated charges per pixel, referencing the dispatched objects if they exist
+    if(transfer_charges_) {
+        transfer_charges(event, total.propagated_charges, propagated_charge_message->getData());
+    }
 
     // Dispatch the message with propagated charges
     messenger_->dispatchMessage(this, std::move(propagated_charge_message), event);
 }
 
+/**
+ * The selection of the charges follows the SimpleTransfer module: only sets of charges near the sensor surface or within a
+ * front-side implant are transferred to their nearest pixel within the pixel matrix. Without propagated charge objects, the
+ * pixel charges only reference the Monte Carlo particles which created the deposits of the transferred charges.
+ */
+void GenericPropagationModule::transfer_charges(Event* event,
+                                                const std::vector<PropagatedChargeData>& charges,
+                                                const std::vector<PropagatedCharge>& propagated_charges) {
+    struct PixelSum {
+        long charge{};
+        std::vector<const PropagatedCharge*> propagated_charges;
+        std::set<const MCParticle*> mc_particles;
+    };
+    std::map<Pixel::Index, PixelSum> pixel_map;
+
+    unsigned int transferred_charges_count = 0;
+    for(size_t i = 0; i < charges.size(); ++i) {
+        const auto& charge = charges[i];
+        const auto& position = charge.getLocalPosition();
+
+        if(collect_from_implant_) {
+            // Ignore if outside a front-side implant
+            auto implant = model_->isWithinImplant(position);
+            if(!implant.has_value() || implant->getType() != DetectorModel::Implant::Type::FRONTSIDE) {
+                continue;
+            }
+        } else if(std::fabs(position.z() - (model_->getSensorCenter().z() + model_->getSensorSize().z() / 2.0)) >
+                  max_depth_distance_) {
+            // Ignore if not close to the sensor surface
+            continue;
+        }
+
+        // Ignore if the nearest pixel is out of the pixel grid
+        auto [xpixel, ypixel] = model_->getPixelIndex(position);
+        if(!model_->isWithinMatrix(xpixel, ypixel)) {
+            continue;
+        }
+
+        auto& sum = pixel_map[Pixel::Index(xpixel, ypixel)];
+        sum.charge += static_cast<int>(charge.getType()) * static_cast<long>(charge.getCharge());
+        if(!propagated_charges.empty()) {
+            sum.propagated_charges.push_back(&propagated_charges[i]);
+        } else if(charge.getDepositedCharge() != nullptr) {
+            sum.mc_particles.insert(charge.getDepositedCharge()->getMCParticle());
+        }
+        transferred_charges_count += charge.getCharge();
+    }
+
+    std::vector<PixelCharge> pixel_charges;
+    pixel_charges.reserve(pixel_map.size());
+    for(const auto& [pixel_index, sum] : pixel_map) {
+        auto pixel = detector_->getPixel(pixel_index.x(), pixel_index.y());
+        if(!propagated_charges.empty()) {
+            pixel_charges.emplace_back(pixel, sum.charge, sum.propagated_charges);
+        } else {
+            pixel_charges.emplace_back(
+                pixel, sum.charge, std::vector<const MCParticle*>(sum.mc_particles.begin(), sum.mc_particles.end()));
+        }
+        LOG(DEBUG) << "Set of " << sum.charge << " charges combined at " << pixel_index;
+    }
+
+    LOG(INFO) << "Transferred " << transferred_charges_count << " charges to " << pixel_charges.size() << " pixels";
+    total_transferred_charges_ += transferred_charges_count;
+
+    auto pixel_message = event->makeShared<PixelChargeMessage>(std::move(pixel_charges), detector_);
+    messenger_->dispatchMessage(this, std::move(pixel_message), event);
+}
+
 /**
  * Propagation is simulated using a parameterization for the electron mobility. This is used to calculate the electron
  * velocity at every point with help of the electric field map of the detector. An Runge-Kutta integration is applied in
  * multiple steps, adding a random diffusion to the propagating charge every step.
  */
-std::tuple<unsigned int, unsigned int, unsigned int, unsigned int, long double>
-GenericPropagationModule::propagate(Event* event,
-                                    const DepositedCharge& deposit,
-                                    const ROOT::Math::XYZPoint& pos,
-                                    const CarrierType& type,
-                                    unsigned int charge,
-                                    const double initial_time_local,
-                                    const double initial_time_global,
-                                    const unsigned int level,
-                                    std::vector<PropagatedCharge>& propagated_charges,
-                                    LineGraph::OutputPlotPoints& output_plot_points) const {
+template <class Tableau>
+std::tuple<unsigned int, unsigned int, unsigned int, unsigned int, unsigned int, long double>
+GenericPropagationModule::propagate_with(RandomNumberGenerator& random_generator,
+                                         const DepositedCharge& deposit,
+                                         const ROOT::Math::XYZPoint& pos,
+                                         const CarrierType& type,
+                                         unsigned int charge,
+                                         const double initial_time_local,
+                                         const double initial_time_global,
+                                         const unsigned int level,
+                                         std::vector<PropagatedChargeData>& propagated_charges,
+                                         LineGraph::OutputPlotPoints* output_plot_points) const {
 
     if(level > max_multiplication_level_) {
         LOG(WARNING) << "Found impact ionization shower with level larger than " << max_multiplication_level_
@@ -477,15 +1216,17 @@ GenericPropagationModule::propagate(Event* event,
     unsigned int recombined_charges_count = 0;
     unsigned int trapped_charges_count = 0;
     unsigned int steps = 0;
+    unsigned int rejected_steps = 0;
     long double total_time = 0;
 
     // Add point of deposition to the output plots if requested
-    if(output_linegraphs_) {
-        output_plot_points.emplace_back(
+    size_t output_plot_index = 0;
+    if(output_plot_points != nullptr) {
+        output_plot_points->emplace_back(
             std::make_tuple(deposit.getGlobalTime(), charge, deposit.getType(), CarrierState::MOTION),
             std::vector<ROOT::Math::XYZPoint>());
+        output_plot_index = output_plot_points->size() - 1;
     }
-    auto output_plot_index = output_plot_points.size() - 1;
 
     // Store initial charge
     const unsigned int initial_charge = charge;
@@ -497,53 +1238,46 @@ GenericPropagationModule::propagate(Event* event,
 
         // Compute the independent diffusion in three
         allpix::normal_distribution<double> gauss_distribution(0, diffusion_std_dev);
-        auto x = gauss_distribution(event->getRandomEngine());
-        auto y = gauss_distribution(event->getRandomEngine());
-        auto z = gauss_distribution(event->getRandomEngine());
+        auto x = gauss_distribution(random_generator);
+        auto y = gauss_distribution(random_generator);
+        auto z = gauss_distribution(random_generator);
         return {x, y, z};
     };
 
     // Survival or detrap probability of this charge carrier package, evaluated at every step
     allpix::uniform_real_distribution<double> uniform_distribution(0, 1);
 
-    // Define lambda functions to compute the charge carrier velocity with or without magnetic field
-    std::function<Eigen::Vector3d(double, const Eigen::Vector3d&)> carrier_velocity_noB =
-        [&](double, const Eigen::Vector3d& cur_pos) -> Eigen::Vector3d {
-        auto raw_field = detector_->getElectricField(static_cast<ROOT::Math::XYZPoint>(cur_pos));
-        Eigen::Vector3d efield(raw_field.x(), raw_field.y(), raw_field.z());
-        auto doping = detector_->getDopingConcentration(static_cast<ROOT::Math::XYZPoint>(cur_pos));
+    // Remaining survival of the charge carrier package against recombination and trapping in units of its lifetimes, if the
+    // survival time is sampled once instead of evaluating the survival probability at every step
+    double recombination_survival = 0, trapping_survival = 0;
+    if(sample_survival_time_) {
+        recombination_survival = -std::log(uniform_distribution(random_generator));
+        trapping_survival = -std::log(uniform_distribution(random_generator));
+    }
 
-        return static_cast<int>(type) * mobility_(type, efield.norm(), doping) * efield;
+    // Define lambda function to compute the charge carrier velocity from the precomputed map or from the fields
+    const auto& velocity_map = (type == CarrierType::ELECTRON ? electron_velocity_map_ : hole_velocity_map_);
+    auto carrier_velocity = [&](double, const Eigen::Vector3d& cur_pos) -> Eigen::Vector3d {
+        if(precompute_velocity_) {
+            auto velocity = velocity_map.get(static_cast<ROOT::Math::XYZPoint>(cur_pos));
+            return {velocity.x(), velocity.y(), velocity.z()};
+        }
+        return drift_velocity(type, cur_pos);
     };
 
-    std::function<Eigen::Vector3d(double, const Eigen::Vector3d&)> carrier_velocity_withB =
-        [&](double, const Eigen::Vector3d& cur_pos) -> Eigen::Vector3d {
-        auto raw_field = detector_->getElectricField(static_cast<ROOT::Math::XYZPoint>(cur_pos));
-        Eigen::Vector3d efield(raw_field.x(), raw_field.y(), raw_field.z());
-
-        Eigen::Vector3d velocity;
-        auto magnetic_field = detector_->getMagneticField(static_cast<ROOT::Math::XYZPoint>(cur_pos));
-        Eigen::Vector3d bfield(magnetic_field.x(), magnetic_field.y(), magnetic_field.z());
-
-        auto doping = detector_->getDopingConcentration(static_cast<ROOT::Math::XYZPoint>(cur_pos));
-
-        auto mob = mobility_(type, efield.norm(), doping);
-        auto exb = efield.cross(bfield);
+    // Regions of uniform drift velocity which are crossed analytically, empty unless requested
+    const auto& uniform_regions = (type == CarrierType::ELECTRON ? electron_uniform_regions_ : hole_uniform_regions_);
 
-        Eigen::Vector3d term1;
-        double hallFactor = (type == CarrierType::ELECTRON ? electron_Hall_ : hole_Hall_);
-        term1 = static_cast<int>(type) * mob * hallFactor * exb;
+    // Create the runge kutta solver with a tableau known at compile time, such that the stages and the velocity calculation
+    // can be inlined
+    auto runge_kutta = make_runge_kutta(Tableau{}, carrier_velocity, timestep_start_, position);
 
-        Eigen::Vector3d term2 = mob * mob * hallFactor * hallFactor * efield.dot(bfield) * bfield;
-
-        auto rnorm = 1 + mob * mob * hallFactor * hallFactor * bfield.dot(bfield);
-        return static_cast<int>(type) * mob * (efield + term1 + term2) / rnorm;
-    };
-
-    // Create the runge kutta solver with an RKF5 tableau, using different velocity calculators depending on the magnetic
-    // field
-    auto runge_kutta = make_runge_kutta(
-        tableau::RK5, (has_magnetic_field_ ? carrier_velocity_withB : carrier_velocity_noB), timestep_start_, position);
+    // Parameters of the PI control of the timestep for the Dormand-Prince method, following Hairer, Norsett and Wanner,
+    // Solving Ordinary Differential Equations I, Section II.4
+    constexpr bool step_control = std::is_same_v<Tableau, tableau::StaticDOPRI5>;
+    constexpr double safety = 0.9, previous_error_exponent = 0.04, error_exponent = 0.2 - 0.75 * previous_error_exponent;
+    constexpr double minimum_scale = 0.2, maximum_scale = 10.;
+    double previous_error_ratio = 1e-4;
 
     // Continue propagation until the deposit is outside the sensor
     Eigen::Vector3d last_position = position;
@@ -553,11 +1287,12 @@ GenericPropagationModule::propagate(Event* event,
     auto state = CarrierState::MOTION;
     while(state == CarrierState::MOTION && (initial_time_local + runge_kutta.getTime()) < integration_time_) {
         // Update output plots if necessary (depending on the plot step)
-        if(output_linegraphs_) {
+        if(output_plot_points != nullptr) {
             auto time_idx = static_cast<size_t>(runge_kutta.getTime() / output_plots_step_);
-            while(next_idx <= time_idx) {
-                output_plot_points.at(output_plot_index).second.push_back(static_cast<ROOT::Math::XYZPoint>(position));
-                next_idx = output_plot_points.at(output_plot_index).second.size();
+            for(; next_idx <= time_idx; ++next_idx) {
+                LineGraph::AddPoint(output_plot_points->at(output_plot_index).second,
+                                    static_cast<ROOT::Math::XYZPoint>(position),
+                                    output_linegraphs_tolerance_);
             }
         }
 
@@ -567,14 +1302,54 @@ GenericPropagationModule::propagate(Event* event,
         last_efield = efield;
 
         // Get electric field at current (pre-step) position
-        efield = detector_->getElectricField(static_cast<ROOT::Math::XYZPoint>(position));
-        auto doping = detector_->getDopingConcentration(static_cast<ROOT::Math::XYZPoint>(position));
-
-        // Execute a Runge Kutta step
-        auto step = runge_kutta.step();
+        auto field_and_doping = detector_->getElectricFieldAndDoping(static_cast<ROOT::Math::XYZPoint>(position));
+        efield = field_and_doping.field;
+        auto doping = field_and_doping.doping;
+
+        // Cross a region of uniform drift velocity analytically if this takes longer than the maximum timestep, up to its
+        // boundary along z or the end of the integration time
+        const UniformRegion* region = nullptr;
+        for(const auto& candidate : uniform_regions) {
+            if(position.z() >= candidate.z_min && position.z() < candidate.z_max) {
+                region = &candidate;
+                break;
+            }
+        }
+        double analytic_time = 0;
+        if(region != nullptr) {
+            auto distance = (region->velocity.z() > 0 ? region->z_max - position.z() : position.z() - region->z_min);
+            analytic_time = std::min(distance / std::fabs(region->velocity.z()),
+                                     integration_time_ - (initial_time_local + runge_kutta.getTime()));
+        }
+        auto analytic_step = (analytic_time > timestep_max_);
+
+        typename decltype(runge_kutta)::Step step;
+        bool step_rejected = false;
+        if(analytic_step) {
+            step.value = region->velocity * analytic_time;
+            step.error.setZero();
+            runge_kutta.setValue(position + step.value);
+            runge_kutta.advanceTime(analytic_time);
+        } else {
+            // Execute a Runge Kutta step, repeating it with a smaller timestep while its error exceeds the target precision
+            step = runge_kutta.attempt();
+            if constexpr(step_control) {
+                auto error_ratio = step.error.norm() / target_spatial_precision_;
+                while(error_ratio > 1. && runge_kutta.getTimeStep() > timestep_min_) {
+                    ++rejected_steps;
+                    step_rejected = true;
+                    auto factor = std::min(1. / minimum_scale, std::pow(error_ratio, error_exponent) / safety);
+                    runge_kutta.setTimeStep(std::max(timestep_min_, runge_kutta.getTimeStep() / factor));
+                    step = runge_kutta.attempt();
+                    error_ratio = step.error.norm() / target_spatial_precision_;
+                }
+            }
+            runge_kutta.accept();
+        }
+        ++steps;
 
         // Get the current result and timestep
-        auto timestep = runge_kutta.getTimeStep();
+        auto timestep = (analytic_step ? analytic_time : runge_kutta.getTimeStep());
         position = runge_kutta.getValue();
         LOG(TRACE) << "Step from " << Units::display(static_cast<ROOT::Math::XYZPoint>(last_position), {"um"}) << " to "
                    << Units::display(static_cast<ROOT::Math::XYZPoint>(position), {"um"});
@@ -585,37 +1360,52 @@ GenericPropagationModule::propagate(Event* event,
         runge_kutta.setValue(position);
 
         // Check if we are still in the sensor and not in an implant:
-        if(!model_->isWithinSensor(static_cast<ROOT::Math::XYZPoint>(position)) ||
-           model_->isWithinImplant(static_cast<ROOT::Math::XYZPoint>(position))) {
+        if(!geometry_.isWithinSensor(static_cast<ROOT::Math::XYZPoint>(position)) ||
+           geometry_.isWithinImplant(static_cast<ROOT::Math::XYZPoint>(position))) {
             state = CarrierState::HALTED;
         }
 
         // Physics effects:
 
         // Check if charge carrier is still alive:
-        if(state == CarrierState::MOTION &&
-           recombination_(type,
-                          detector_->getDopingConcentration(static_cast<ROOT::Math::XYZPoint>(position)),
-                          uniform_distribution(event->getRandomEngine()),
-                          timestep)) {
-            state = CarrierState::RECOMBINED;
+        if(state == CarrierState::MOTION) {
+            auto doping = detector_->getDopingConcentration(static_cast<ROOT::Math::XYZPoint>(position));
+            if(sample_survival_time_) {
+                recombination_survival -= timestep / recombination_.lifetime(type, doping);
+                if(recombination_survival <= 0) {
+                    state = CarrierState::RECOMBINED;
+                }
+            } else if(recombination_(type, doping, uniform_distribution(random_generator), timestep)) {
+                state = CarrierState::RECOMBINED;
+            }
         }
 
         // Check if the charge carrier has been trapped:
-        if(state == CarrierState::MOTION &&
-           trapping_(type, uniform_distribution(event->getRandomEngine()), timestep, std::sqrt(efield.Mag2()))) {
+        auto trapped = false;
+        if(state == CarrierState::MOTION) {
+            if(sample_survival_time_) {
+                trapping_survival -= timestep / trapping_.lifetime(type, std::sqrt(efield.Mag2()));
+                trapped = (trapping_survival <= 0);
+            } else {
+                trapped = trapping_(type, uniform_distribution(random_generator), timestep, std::sqrt(efield.Mag2()));
+            }
+        }
+        if(trapped) {
             if(output_plots_) {
-                trapping_time_histo_->Fill(static_cast<double>(Units::convert(runge_kutta.getTime(), "ns")), charge);
+                trapping_time_histo_->Fill(runge_kutta.getTime() / units::ns, charge);
             }
 
-            auto detrap_time = detrapping_(type, uniform_distribution(event->getRandomEngine()), std::sqrt(efield.Mag2()));
+            auto detrap_time = detrapping_(type, uniform_distribution(random_generator), std::sqrt(efield.Mag2()));
             if((initial_time_local + runge_kutta.getTime() + detrap_time) < integration_time_) {
                 LOG(DEBUG) << "De-trapping charge carrier after " << Units::display(detrap_time, {"ns", "us"});
                 // De-trap and advance in time if still below integration time
                 runge_kutta.advanceTime(detrap_time);
+                if(sample_survival_time_) {
+                    trapping_survival = -std::log(uniform_distribution(random_generator));
+                }
 
                 if(output_plots_) {
-                    detrapping_time_histo_->Fill(static_cast<double>(Units::convert(detrap_time, "ns")), charge);
+                    detrapping_time_histo_->Fill(detrap_time / units::ns, charge);
                 }
             } else {
                 // Mark as trapped otherwise
@@ -647,7 +1437,7 @@ GenericPropagationModule::propagate(Event* event,
             double log_prob = 1. / std::log1p(-1. / local_gain);
             for(unsigned int i_carrier = 0; i_carrier < charge; ++i_carrier) {
                 n_secondaries +=
-                    static_cast<unsigned int>(std::log(uniform_distribution(event->getRandomEngine())) * log_prob);
+                    static_cast<unsigned int>(std::log(uniform_distribution(random_generator)) * log_prob);
             }
 
             auto inverted_type = invertCarrierType(type);
@@ -667,8 +1457,8 @@ GenericPropagationModule::propagate(Event* event,
                     multiplication_depth_histo_->Fill(carrier_pos.z(), n_secondaries);
                 }
 
-                auto [recombined, trapped, propagated, psteps, ptime] =
-                    propagate(event,
+                auto [recombined, trapped, propagated, psteps, prejected, ptime] =
+                    propagate(random_generator,
                               deposit,
                               carrier_pos,
                               inverted_type,
@@ -684,6 +1474,7 @@ GenericPropagationModule::propagate(Event* event,
                 trapped_charges_count += trapped;
                 propagated_charges_count += propagated;
                 steps += psteps;
+                rejected_steps += prejected;
                 total_time += ptime * charge;
 
                 LOG(DEBUG) << "Continuing propagation of charge carrier set (" << type << ") at "
@@ -699,21 +1490,37 @@ GenericPropagationModule::propagate(Event* event,
 
         // Update step length histogram
         if(output_plots_) {
-            step_length_histo_->Fill(static_cast<double>(Units::convert(step.value.norm(), "um")));
-            uncertainty_histo_->Fill(static_cast<double>(Units::convert(step.error.norm(), "nm")));
+            step_length_histo_->Fill(step.value.norm() / units::um);
+            uncertainty_histo_->Fill(step.error.norm() / units::nm);
+        }
+
+        // Keep the timestep of the numerical integration after crossing a region analytically
+        if(analytic_step) {
+            charge += n_secondaries;
+            continue;
         }
 
         // Adapt step size to match target precision
         double uncertainty = step.error.norm();
 
-        // Lower timestep when reaching the sensor edge
-        if(std::fabs(model_->getSensorSize().z() / 2.0 - position.z()) < 2 * step.value.z()) {
-            timestep *= 0.75;
+        if constexpr(step_control) {
+            // Scale the timestep from the error of this and the previous step, without growing it after a rejection
+            auto error_ratio = std::max(uncertainty / target_spatial_precision_, 1e-4);
+            auto factor = std::pow(error_ratio, error_exponent) /
+                          std::pow(previous_error_ratio, previous_error_exponent) / safety;
+            factor = std::min(1. / minimum_scale, std::max(1. / maximum_scale, factor));
+            timestep /= (step_rejected ? std::max(factor, 1.) : factor);
+            previous_error_ratio = error_ratio;
         } else {
-            if(uncertainty > target_spatial_precision_) {
+            // Lower timestep when reaching the sensor edge
+            if(std::fabs(model_->getSensorSize().z() / 2.0 - position.z()) < 2 * step.value.z()) {
                 timestep *= 0.75;
-            } else if(2 * uncertainty < target_spatial_precision_) {
-                timestep *= 1.5;
+            } else {
+                if(uncertainty > target_spatial_precision_) {
+                    timestep *= 0.75;
+                } else if(2 * uncertainty < target_spatial_precision_) {
+                    timestep *= 1.5;
+                }
             }
         }
         // Limit the timestep to certain minimum and maximum step sizes
@@ -729,20 +1536,20 @@ GenericPropagationModule::propagate(Event* event,
 
     // Find proper final position in the sensor
     auto time = runge_kutta.getTime();
-    if(state == CarrierState::HALTED && !model_->isWithinSensor(static_cast<ROOT::Math::XYZPoint>(position))) {
+    if(state == CarrierState::HALTED && !geometry_.isWithinSensor(static_cast<ROOT::Math::XYZPoint>(position))) {
         auto intercept = model_->getSensorIntercept(static_cast<ROOT::Math::XYZPoint>(last_position),
                                                     static_cast<ROOT::Math::XYZPoint>(position));
         position = Eigen::Vector3d(intercept.x(), intercept.y(), intercept.z());
     }
 
     // Set final state of charge carrier for plotting:
-    if(output_linegraphs_) {
+    if(output_plot_points != nullptr) {
         // If drift time is larger than integration time or the charge carriers have been collected at the backside, reset:
-        if(!model_->isWithinImplant(static_cast<ROOT::Math::XYZPoint>(position)) &&
+        if(!geometry_.isWithinImplant(static_cast<ROOT::Math::XYZPoint>(position)) &&
            (time >= integration_time_ || last_position.z() < -model_->getSensorSize().z() * 0.45)) {
-            std::get<3>(output_plot_points.at(output_plot_index).first) = CarrierState::UNKNOWN;
+            std::get<3>(output_plot_points->at(output_plot_index).first) = CarrierState::UNKNOWN;
         } else {
-            std::get<3>(output_plot_points.at(output_plot_index).first) = state;
+            std::get<3>(output_plot_points->at(output_plot_index).first) = state;
         }
     }
 
@@ -784,7 +1591,7 @@ GenericPropagationModule::propagate(Event* event,
                    << Units::display(time, "ns") << " time, removing";
         recombined_charges_count += charge;
         if(output_plots_) {
-            recombination_time_histo_->Fill(static_cast<double>(Units::convert(time, "ns")), charge);
+            recombination_time_histo_->Fill(time / units::ns, charge);
         }
     } else if(state == CarrierState::TRAPPED) {
         LOG(DEBUG) << " Trapped " << charge << " at " << Units::display(local_position, {"mm", "um"}) << " in "
@@ -792,35 +1599,426 @@ GenericPropagationModule::propagate(Event* event,
         trapped_charges_count += charge;
     }
     propagated_charges_count += charge;
-    ++steps;
     total_time += time * charge;
 
     LOG(DEBUG) << " Propagated " << charge << " to " << Units::display(local_position, {"mm", "um"}) << " in "
                << Units::display(time, "ns") << " time, gain " << gain << ", final state: " << allpix::to_string(state);
 
     // Create a new propagated charge and add it to the list
-    auto global_position = detector_->getGlobalPosition(local_position);
-    PropagatedCharge propagated_charge(local_position,
-                                       global_position,
-                                       deposit.getType(),
-                                       charge,
-                                       deposit.getLocalTime() + time,
-                                       deposit.getGlobalTime() + time,
-                                       state,
-                                       &deposit);
-
-    propagated_charges.push_back(std::move(propagated_charge));
+    if(store_charges_) {
+        auto global_position = detector_->getGlobalPosition(local_position);
+        propagated_charges.emplace_back(local_position,
+                                        global_position,
+                                        deposit.getType(),
+                                        charge,
+                                        deposit.getLocalTime() + time,
+                                        deposit.getGlobalTime() + time,
+                                        state,
+                                        &deposit);
+    }
 
     if(output_plots_) {
-        drift_time_histo_->Fill(static_cast<double>(Units::convert(time, "ns")), charge);
+        drift_time_histo_->Fill(time / units::ns, charge);
         group_size_histo_->Fill(charge);
     }
 
     // Return statistics counters about this and all daughter propagated charge carrier groups and their final states
-    return std::make_tuple(recombined_charges_count, trapped_charges_count, propagated_charges_count, steps, total_time);
+    return std::make_tuple(
+        recombined_charges_count, trapped_charges_count, propagated_charges_count, steps, rejected_steps, total_time);
+}
+
+/**
+ * The integration method is resolved once per set of charges, selecting the instantiation of the propagation for its
+ * tableau.
+ */
+std::tuple<unsigned int, unsigned int, unsigned int, unsigned int, unsigned int, long double>
+GenericPropagationModule::propagate(RandomNumberGenerator& random_generator,
+                                    const DepositedCharge& deposit,
+                                    const ROOT::Math::XYZPoint& pos,
+                                    const CarrierType& type,
+                                    unsigned int charge,
+                                    const double initial_time_local,
+                                    const double initial_time_global,
+                                    const unsigned int level,
+                                    std::vector<PropagatedChargeData>& propagated_charges,
+                                    LineGraph::OutputPlotPoints* output_plot_points) const {
+    auto propagate_method = (integration_method_ == IntegrationMethod::DOPRI5
+                                 ? &GenericPropagationModule::propagate_with<tableau::StaticDOPRI5>
+                                 : &GenericPropagationModule::propagate_with<tableau::StaticRK5>);
+    return (this->*propagate_method)(random_generator,
+                                     deposit,
+                                     pos,
+                                     type,
+                                     charge,
+                                     initial_time_local,
+                                     initial_time_global,
+                                     level,
+                                     propagated_charges,
+                                     output_plot_points);
+}
+
+/**
+ * The batch follows the same integration as \ref propagate for every set of charges: a Runge-Kutta step with a RKF5 tableau
+ * using the drift velocity, followed by diffusion, the checks for leaving the sensor, recombination and trapping, and the
+ * adaptation of the timestep of the set. The state of all sets is held in separate arrays per quantity, and every stage of
+ * the integration looks up the velocity of all sets at once. Random numbers are drawn in the order of the sets in the batch,
+ * and sets which stopped moving are replaced by the next waiting set to keep the batch filled.
+ *
+ * With single precision, the velocities of the integration stages, the steps with their error estimates and the diffusion
+ * are stored and combined as floats, while the positions are accumulated in double precision from these increments. The
+ * fields and models are evaluated in double precision, such that only the results of the velocity lookups are rounded.
+ */
+template <typename T>
+std::tuple<unsigned int, unsigned int, unsigned int, unsigned int, unsigned int, long double>
+GenericPropagationModule::propagate_batch(RandomNumberGenerator& random_generator,
+                                          const CarrierType& type,
+                                          const std::vector<ChargeGroup>& groups,
+                                          std::vector<PropagatedChargeData>& propagated_charges) const {
+    using Lanes = std::array<double, max_batch_size_>;
+    using StepLanes = std::array<T, max_batch_size_>;
+    using Tableau = tableau::StaticRK5;
+    constexpr int stages = Tableau::stages;
+
+    unsigned int propagated_charges_count = 0;
+    unsigned int recombined_charges_count = 0;
+    unsigned int trapped_charges_count = 0;
+    unsigned int steps = 0;
+    long double total_time = 0;
+
+    // State of the sets of charges in the batch
+    Lanes x{}, y{}, z{}, last_x{}, last_y{}, last_z{}, time{}, timestep{};
+    std::array<const ChargeGroup*, max_batch_size_> group{};
+    std::array<CarrierState, max_batch_size_> state{};
+
+    // Intermediate values of a single step
+    Lanes efield_x{}, efield_y{}, efield_z{}, efield_mag{}, doping{}, stage_x{}, stage_y{}, stage_z{};
+    StepLanes step_x{}, step_y{}, step_z{}, error_x{}, error_y{}, error_z{};
+    std::array<StepLanes, stages> k_x{}, k_y{}, k_z{};
+    std::array<T, 3 * max_batch_size_> diffusion{};
+
+    // Velocities looked up in double precision before rounding them to the precision of the integration
+    Lanes velocity_x{}, velocity_y{}, velocity_z{};
+    std::array<bool, max_batch_size_> within{}, trapped{};
+
+    // Look up the velocity from the precomputed map or calculate it from the fields
+    const auto& velocity_map = (type == CarrierType::ELECTRON ? electron_velocity_map_ : hole_velocity_map_);
+    auto carrier_velocity = [&](size_t count, int stage) {
+        std::array<double*, 3> velocity{velocity_x.data(), velocity_y.data(), velocity_z.data()};
+        if constexpr(std::is_same_v<T, double>) {
+            velocity = {k_x[stage].data(), k_y[stage].data(), k_z[stage].data()};
+        }
+        if(precompute_velocity_) {
+            velocity_map.get(stage_x.data(), stage_y.data(), stage_z.data(), count, velocity);
+        } else {
+            drift_velocity(type, stage_x.data(), stage_y.data(), stage_z.data(), count, velocity);
+        }
+        if constexpr(!std::is_same_v<T, double>) {
+            for(size_t lane = 0; lane < count; ++lane) {
+                k_x[stage][lane] = static_cast<T>(velocity_x[lane]);
+                k_y[stage][lane] = static_cast<T>(velocity_y[lane]);
+                k_z[stage][lane] = static_cast<T>(velocity_z[lane]);
+            }
+        }
+    };
+
+    allpix::uniform_real_distribution<double> uniform_distribution(0, 1);
+    allpix::normal_batch_distribution<T> normal_batch;
+
+    // Remaining survival against recombination and trapping in units of the lifetimes if the survival time is sampled once
+    Lanes recombination_survival{}, trapping_survival{};
+
+    // Move the state of a set of charges to another position in the batch
+    auto move_lane = [&](size_t from, size_t to) {
+        x[to] = x[from];
+        y[to] = y[from];
+        z[to] = z[from];
+        last_x[to] = last_x[from];
+        last_y[to] = last_y[from];
+        last_z[to] = last_z[from];
+        time[to] = time[from];
+        timestep[to] = timestep[from];
+        group[to] = group[from];
+        state[to] = state[from];
+        recombination_survival[to] = recombination_survival[from];
+        trapping_survival[to] = trapping_survival[from];
+    };
+
+    // Store the final state of a set of charges
+    auto finish_lane = [&](size_t lane) {
+        const auto& deposit = *group[lane]->deposit;
+        auto charge = group[lane]->charge;
+        auto local_position = ROOT::Math::XYZPoint(x[lane], y[lane], z[lane]);
+
+        // Find proper final position in the sensor
+        if(state[lane] == CarrierState::HALTED && !geometry_.isWithinSensor(local_position)) {
+            local_position =
+                model_->getSensorIntercept(ROOT::Math::XYZPoint(last_x[lane], last_y[lane], last_z[lane]), local_position);
+        }
+
+        if(state[lane] == CarrierState::RECOMBINED) {
+            LOG(DEBUG) << " Recombined " << charge << " at " << Units::display(local_position, {"mm", "um"}) << " in "
+                       << Units::display(time[lane], "ns") << " time, removing";
+            recombined_charges_count += charge;
+            if(output_plots_) {
+                recombination_time_histo_->Fill(time[lane] / units::ns, charge);
+            }
+        } else if(state[lane] == CarrierState::TRAPPED) {
+            LOG(DEBUG) << " Trapped " << charge << " at " << Units::display(local_position, {"mm", "um"}) << " in "
+                       << Units::display(time[lane], "ns") << " time, removing";
+            trapped_charges_count += charge;
+        }
+        propagated_charges_count += charge;
+        total_time += time[lane] * charge;
+
+        LOG(DEBUG) << " Propagated " << charge << " to " << Units::display(local_position, {"mm", "um"}) << " in "
+                   << Units::display(time[lane], "ns") << " time, final state: " << allpix::to_string(state[lane]);
+
+        if(store_charges_) {
+            auto global_position = detector_->getGlobalPosition(local_position);
+            propagated_charges.emplace_back(local_position,
+                                            global_position,
+                                            deposit.getType(),
+                                            charge,
+                                            deposit.getLocalTime() + time[lane],
+                                            deposit.getGlobalTime() + time[lane],
+                                            state[lane],
+                                            &deposit);
+        }
+
+        if(output_plots_) {
+            drift_time_histo_->Fill(time[lane] / units::ns, charge);
+            group_size_histo_->Fill(charge);
+        }
+    };
+
+    size_t active = 0;
+    size_t next_group = 0;
+    while(true) {
+        // Fill the batch with waiting sets of charges, starting at the position of their deposit
+        while(active < batch_size_ && next_group < groups.size()) {
+            const auto& position = groups[next_group].deposit->getLocalPosition();
+            x[active] = last_x[active] = position.x();
+            y[active] = last_y[active] = position.y();
+            z[active] = last_z[active] = position.z();
+            time[active] = 0;
+            timestep[active] = timestep_start_;
+            group[active] = &groups[next_group];
+            state[active] = CarrierState::MOTION;
+            if(sample_survival_time_) {
+                recombination_survival[active] = -std::log(uniform_distribution(random_generator));
+                trapping_survival[active] = -std::log(uniform_distribution(random_generator));
+            }
+            ++active;
+            ++next_group;
+        }
+
+        // Remove the sets which stopped moving or reached the integration time, replacing them by the last set
+        for(size_t lane = 0; lane < active;) {
+            if(state[lane] == CarrierState::MOTION &&
+               (group[lane]->deposit->getLocalTime() + time[lane]) < integration_time_) {
+                ++lane;
+                continue;
+            }
+            finish_lane(lane);
+            move_lane(--active, lane);
+        }
+        if(active < batch_size_ && next_group < groups.size()) {
+            continue;
+        }
+        if(active == 0) {
+            break;
+        }
+
+        // Get electric field and doping at the current (pre-step) positions
+        steps += static_cast<unsigned int>(active);
+        std::copy_n(x.begin(), active, last_x.begin());
+        std::copy_n(y.begin(), active, last_y.begin());
+        std::copy_n(z.begin(), active, last_z.begin());
+        detector_->getElectricFieldAndDoping(
+            x.data(), y.data(), z.data(), active, {efield_x.data(), efield_y.data(), efield_z.data()}, doping.data());
+        for(size_t lane = 0; lane < active; ++lane) {
+            efield_mag[lane] = std::sqrt(efield_x[lane] * efield_x[lane] + efield_y[lane] * efield_y[lane] +
+                                         efield_z[lane] * efield_z[lane]);
+        }
+
+        // Execute a Runge-Kutta step for all sets, evaluating the velocity of every stage for the full batch
+        std::fill_n(step_x.begin(), active, T(0));
+        std::fill_n(step_y.begin(), active, T(0));
+        std::fill_n(step_z.begin(), active, T(0));
+        std::fill_n(error_x.begin(), active, T(0));
+        std::fill_n(error_y.begin(), active, T(0));
+        std::fill_n(error_z.begin(), active, T(0));
+        for(int stage = 0; stage < stages; ++stage) {
+            for(size_t lane = 0; lane < active; ++lane) {
+                T offset_x = 0, offset_y = 0, offset_z = 0;
+                for(int j = 0; j < stage; ++j) {
+                    auto factor = static_cast<T>(timestep[lane] * Tableau::coefficients[stage][j]);
+                    offset_x += factor * k_x[j][lane];
+                    offset_y += factor * k_y[j][lane];
+                    offset_z += factor * k_z[j][lane];
+                }
+                stage_x[lane] = x[lane] + offset_x;
+                stage_y[lane] = y[lane] + offset_y;
+                stage_z[lane] = z[lane] + offset_z;
+            }
+            carrier_velocity(active, stage);
+            for(size_t lane = 0; lane < active; ++lane) {
+                auto factor = static_cast<T>(timestep[lane] * Tableau::coefficients[stages][stage]);
+                auto error_factor = static_cast<T>(timestep[lane] * Tableau::coefficients[stages + 1][stage]);
+                step_x[lane] += factor * k_x[stage][lane];
+                step_y[lane] += factor * k_y[stage][lane];
+                step_z[lane] += factor * k_z[stage][lane];
+                error_x[lane] += error_factor * k_x[stage][lane];
+                error_y[lane] += error_factor * k_y[stage][lane];
+                error_z[lane] += error_factor * k_z[stage][lane];
+            }
+        }
+
+        // Apply the step and the diffusion
+        normal_batch(random_generator, diffusion.data(), 3 * active);
+        mobility_.visit([&](const auto& mobility) {
+            for(size_t lane = 0; lane < active; ++lane) {
+                error_x[lane] = step_x[lane] - error_x[lane];
+                error_y[lane] = step_y[lane] - error_y[lane];
+                error_z[lane] = step_z[lane] - error_z[lane];
+                time[lane] += timestep[lane];
+
+                double diffusion_constant = boltzmann_kT_ * mobility(type, efield_mag[lane], doping[lane]);
+                double diffusion_std_dev = std::sqrt(2. * diffusion_constant * timestep[lane]);
+                x[lane] += step_x[lane];
+                y[lane] += step_y[lane];
+                z[lane] += step_z[lane];
+                x[lane] += diffusion_std_dev * diffusion[3 * lane];
+                y[lane] += diffusion_std_dev * diffusion[3 * lane + 1];
+                z[lane] += diffusion_std_dev * diffusion[3 * lane + 2];
+            }
+        });
+
+        // Check if the sets are still in the sensor and not in an implant
+        geometry_.isWithinSensor(x.data(), y.data(), z.data(), active, within.data());
+        for(size_t lane = 0; lane < active; ++lane) {
+            if(!within[lane] || geometry_.isWithinImplant(ROOT::Math::XYZPoint(x[lane], y[lane], z[lane]))) {
+                state[lane] = CarrierState::HALTED;
+            }
+        }
+
+        // Physics effects, using the doping concentration at the new positions for the recombination. The recombination and
+        // trapping models are dispatched once for all sets, drawing the random numbers of all recombination checks first
+        detector_->getDopingConcentration(x.data(), y.data(), z.data(), active, doping.data());
+        if(sample_survival_time_) {
+            for(size_t lane = 0; lane < active; ++lane) {
+                if(state[lane] == CarrierState::MOTION) {
+                    recombination_survival[lane] -= timestep[lane] / recombination_.lifetime(type, doping[lane]);
+                    if(recombination_survival[lane] <= 0) {
+                        state[lane] = CarrierState::RECOMBINED;
+                    }
+                }
+            }
+            for(size_t lane = 0; lane < active; ++lane) {
+                if(state[lane] == CarrierState::MOTION) {
+                    trapping_survival[lane] -= timestep[lane] / trapping_.lifetime(type, efield_mag[lane]);
+                }
+                trapped[lane] = (state[lane] == CarrierState::MOTION && trapping_survival[lane] <= 0);
+            }
+        } else {
+            recombination_.visit([&](const auto& recombination) {
+                for(size_t lane = 0; lane < active; ++lane) {
+                    if(state[lane] == CarrierState::MOTION &&
+                       recombination(type, doping[lane], uniform_distribution(random_generator), timestep[lane])) {
+                        state[lane] = CarrierState::RECOMBINED;
+                    }
+                }
+            });
+            trapping_.visit([&](const auto& trapping) {
+                for(size_t lane = 0; lane < active; ++lane) {
+                    trapped[lane] =
+                        (state[lane] == CarrierState::MOTION &&
+                         trapping(type, uniform_distribution(random_generator), timestep[lane], efield_mag[lane]));
+                }
+            });
+        }
+        for(size_t lane = 0; lane < active; ++lane) {
+            auto charge = group[lane]->charge;
+
+            // Check if the charge carrier has been trapped:
+            if(trapped[lane]) {
+                if(output_plots_) {
+                    trapping_time_histo_->Fill(time[lane] / units::ns, charge);
+                }
+
+                auto detrap_time = detrapping_(type, uniform_distribution(random_generator), efield_mag[lane]);
+                if((group[lane]->deposit->getLocalTime() + time[lane] + detrap_time) < integration_time_) {
+                    LOG(DEBUG) << "De-trapping charge carrier after " << Units::display(detrap_time, {"ns", "us"});
+                    time[lane] += detrap_time;
+                    if(sample_survival_time_) {
+                        trapping_survival[lane] = -std::log(uniform_distribution(random_generator));
+                    }
+                    if(output_plots_) {
+                        detrapping_time_histo_->Fill(detrap_time / units::ns, charge);
+                    }
+                } else {
+                    state[lane] = CarrierState::TRAPPED;
+                }
+            }
+
+            auto step_length =
+                std::sqrt(step_x[lane] * step_x[lane] + step_y[lane] * step_y[lane] + step_z[lane] * step_z[lane]);
+            auto uncertainty =
+                std::sqrt(error_x[lane] * error_x[lane] + error_y[lane] * error_y[lane] + error_z[lane] * error_z[lane]);
+            if(output_plots_) {
+                step_length_histo_->Fill(step_length / units::um);
+                uncertainty_histo_->Fill(uncertainty / units::nm);
+            }
+
+            // Adapt step size to match target precision, lowering it when reaching the sensor edge
+            if(std::fabs(model_->getSensorSize().z() / 2.0 - z[lane]) < 2 * step_z[lane]) {
+                timestep[lane] *= 0.75;
+            } else {
+                if(uncertainty > target_spatial_precision_) {
+                    timestep[lane] *= 0.75;
+                } else if(2 * uncertainty < target_spatial_precision_) {
+                    timestep[lane] *= 1.5;
+                }
+            }
+            if(timestep[lane] > timestep_max_) {
+                timestep[lane] = timestep_max_;
+            } else if(timestep[lane] < timestep_min_) {
+                timestep[lane] = timestep_min_;
+            }
+        }
+    }
+
+    // Return statistics counters about the propagated charge carrier sets and their final states, no steps are rejected
+    return std::make_tuple(recombined_charges_count, trapped_charges_count, propagated_charges_count, steps, 0u, total_time);
+}
+
+void GenericPropagationModule::create_output_plots(uint64_t event_num,
+                                                   const LineGraph::OutputPlotPoints& output_plot_points) {
+    LineGraph::Create(event_num, this, config_, output_plot_points, CarrierState::UNKNOWN);
+    if(output_linegraphs_collected_) {
+        LineGraph::Create(event_num, this, config_, output_plot_points, CarrierState::HALTED);
+    }
+    if(output_linegraphs_recombined_) {
+        LineGraph::Create(event_num, this, config_, output_plot_points, CarrierState::RECOMBINED);
+    }
+    if(output_linegraphs_trapped_) {
+        LineGraph::Create(event_num, this, config_, output_plot_points, CarrierState::TRAPPED);
+    }
+    if(output_animations_) {
+        LineGraph::Animate(event_num, this, config_, output_plot_points);
+    }
 }
 
 void GenericPropagationModule::finalize() {
+    // Create the deferred line graphs in the order of the events
+    if(!deferred_plot_points_.empty()) {
+        LOG(INFO) << "Creating deferred line graphs for " << deferred_plot_points_.size() << " events";
+        for(const auto& [event_num, output_plot_points] : deferred_plot_points_) {
+            create_output_plots(event_num, output_plot_points);
+        }
+        deferred_plot_points_.clear();
+    }
+
     if(output_plots_) {
         group_size_histo_->Get()->GetXaxis()->SetRange(1, group_size_histo_->Get()->GetNbinsX() + 1);
 
@@ -849,10 +2047,23 @@ void GenericPropagationModule::finalize() {
         }
     }
 
-    long double average_time = static_cast<long double>(total_time_picoseconds_) / 1e3 /
-                               std::max(1u, static_cast<unsigned int>(total_propagated_charges_));
-    LOG(INFO) << "Propagated total of " << total_propagated_charges_ << " charges in " << total_steps_
+    long double average_time = static_cast<long double>(total_time_picoseconds_.value()) / 1e3 /
+                               std::max(uint64_t(1), total_propagated_charges_.value());
+    LOG(INFO) << "Propagated total of " << total_propagated_charges_.value() << " charges in " << total_steps_.value()
               << " steps in average time of " << Units::display(average_time, "ns");
-    LOG(INFO) << deposits_exceeding_max_groups_ * 100.0 / total_deposits_ << "% of deposits have charge exceeding the "
+    deposit_culling_.report();
+    if(transfer_charges_) {
+        LOG(INFO) << "Transferred total of " << total_transferred_charges_.value() << " charges to the pixels";
+    }
+    if(integration_method_ == IntegrationMethod::DOPRI5) {
+        LOG(INFO) << "Rejected total of " << total_rejected_steps_.value()
+                  << " integration steps exceeding the spatial precision";
+    }
+    if(degraded_events_.value() > 0) {
+        LOG(INFO) << "Propagated " << degraded_events_.value() << " events exceeding their time budget in coarser sets";
+    }
+    LOG(INFO) << static_cast<double>(deposits_exceeding_max_groups_.value()) * 100.0 /
+                     static_cast<double>(total_deposits_.value())
+              << "% of deposits have charge exceeding the "
               << max_charge_groups_ << " charge groups allowed, with a charge_per_step value of " << charge_per_step_ << ".";
 }
@@ -9,23 +9,33 @@
  * SPDX-License-Identifier: MIT
  */
 
+#include <array>
 #include <atomic>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <string>
+#include <tuple>
 #include <vector>
 
+#include <Eigen/Core>
 #include <Math/Point3D.h>
+#include <Math/Vector3D.h>
 #include <TFile.h>
 #include <TH1D.h>
 #include <TProfile.h>
 
 #include "core/config/Configuration.hpp"
+#include "core/geometry/DetectorField.hpp"
 #include "core/geometry/DetectorModel.hpp"
+#include "core/geometry/GeometryKernel.hpp"
 #include "core/messenger/Messenger.hpp"
 #include "core/module/Event.hpp"
 #include "core/module/Module.hpp"
 
 #include "objects/DepositedCharge.hpp"
+#include "objects/PixelCharge.hpp"
 #include "objects/PropagatedCharge.hpp"
 
 #include "physics/Detrapping.hpp"
@@ -35,6 +45,8 @@
 #include "physics/Trapping.hpp"
 
 #include "tools/ROOT.h"
+#include "tools/deposit_culling.h"
+#include "tools/deposit_ordering.h"
 #include "tools/line_graphs.h"
 
 namespace allpix {
@@ -50,6 +62,22 @@ namespace allpix {
      * each other and are treated fully separate, allowing for a speed-up by propagating the charges in multiple threads.
      */
     class GenericPropagationModule : public Module {
+        /**
+         * @brief Methods for the integration of the charge carrier motion
+         */
+        enum class IntegrationMethod {
+            RKF5,   ///< Runge-Kutta-Fehlberg method, scaling the timestep by fixed factors
+            DOPRI5, ///< Dormand-Prince method with PI control of the timestep and rejection of inaccurate steps
+        };
+
+        /**
+         * @brief Floating point precision of the integration of batched sets of charges
+         */
+        enum class Precision {
+            DOUBLE, ///< Integrate all quantities in double precision
+            FLOAT,  ///< Evaluate the integration stages and the diffusion in single precision
+        };
+
     public:
         /**
          * @brief Constructor for this detector-specific module
@@ -78,10 +106,11 @@ namespace allpix {
         Messenger* messenger_;
         std::shared_ptr<const Detector> detector_;
         std::shared_ptr<DetectorModel> model_;
+        GeometryKernel geometry_;
 
         /**
          * @brief Propagate a single set of charges through the sensor
-         * @param event               Pointer to current event
+         * @param random_generator    Reference to the random number engine to be used
          * @param deposit             Reference to the original deposited charge object
          * @param pos                 Position of the deposit in the sensor
          * @param type                Type of the carrier to propagate
@@ -89,13 +118,15 @@ namespace allpix {
          * @param initial_time_local  Initial local time with respect to the start of the event
          * @param initial_time_global Initial global time with respect to the start of the event
          * @param level               Current level depth of the generated shower
-         * @param propagated_charges  Reference to vector with all produced final PropagatedCharge objects
-         * @param output_plot_points Reference to vector to hold points for line graph output plots
+         * @param propagated_charges  Reference to vector with the data of all produced final sets of charges
+         * @param output_plot_points  Pointer to vector to hold points for line graph output plots, nullptr if no points
+         *                            should be recorded
          *
-         * @return Total recombined, trapped and propagated charge for statistics purposes
+         * @return Total recombined, trapped and propagated charge, accepted and rejected steps and propagation time for
+         * statistics purposes
          */
-        std::tuple<unsigned int, unsigned int, unsigned int, unsigned int, long double>
-        propagate(Event* event,
+        std::tuple<unsigned int, unsigned int, unsigned int, unsigned int, unsigned int, long double>
+        propagate(RandomNumberGenerator& random_generator,
                   const DepositedCharge& deposit,
                   const ROOT::Math::XYZPoint& pos,
                   const CarrierType& type,
@@ -103,18 +134,199 @@ namespace allpix {
                   const double initial_time_local,
                   const double initial_time_global,
                   const unsigned int level,
-                  std::vector<PropagatedCharge>& propagated_charges,
-                  LineGraph::OutputPlotPoints& output_plot_points) const;
+                  std::vector<PropagatedChargeData>& propagated_charges,
+                  LineGraph::OutputPlotPoints* output_plot_points) const;
+
+        /**
+         * @brief Propagate a single set of charges through the sensor using the integration method of a tableau
+         * @tparam Tableau Runge-Kutta tableau known at compile time, see \ref tableau::StaticTableau
+         *
+         * See \ref propagate for the parameters and the return value
+         */
+        template <class Tableau>
+        std::tuple<unsigned int, unsigned int, unsigned int, unsigned int, unsigned int, long double>
+        propagate_with(RandomNumberGenerator& random_generator,
+                       const DepositedCharge& deposit,
+                       const ROOT::Math::XYZPoint& pos,
+                       const CarrierType& type,
+                       unsigned int charge,
+                       const double initial_time_local,
+                       const double initial_time_global,
+                       const unsigned int level,
+                       std::vector<PropagatedChargeData>& propagated_charges,
+                       LineGraph::OutputPlotPoints* output_plot_points) const;
+
+        /**
+         * @brief Set of charges of a single deposit waiting to be propagated by \ref propagate_batch
+         */
+        struct ChargeGroup {
+            const DepositedCharge* deposit;
+            unsigned int charge;
+        };
+
+        /**
+         * @brief Propagate multiple sets of charges of the same type through the sensor in lockstep
+         * @tparam T                 Floating point type of the integration stages, the steps and the diffusion
+         * @param random_generator   Reference to the random number engine to be used
+         * @param type               Type of the carriers to propagate
+         * @param groups             Sets of charges to propagate, starting at the position and time of their deposit
+         * @param propagated_charges Reference to vector with the data of all produced final sets of charges
+         *
+         * @return Total recombined, trapped and propagated charge, accepted and rejected steps and propagation time for
+         * statistics purposes
+         *
+         * Up to \ref batch_size_ sets are advanced together with their state held in structure-of-arrays layout, such that
+         * the field lookups, the integration and the diffusion of all sets are evaluated as loops over the batch. Sets
+         * which stop moving are removed from the batch and replaced by the next waiting set. Charge multiplication is not
+         * supported. The positions, times and timesteps of the sets are always kept in double precision.
+         */
+        template <typename T>
+        std::tuple<unsigned int, unsigned int, unsigned int, unsigned int, unsigned int, long double>
+        propagate_batch(RandomNumberGenerator& random_generator,
+                        const CarrierType& type,
+                        const std::vector<ChargeGroup>& groups,
+                        std::vector<PropagatedChargeData>& propagated_charges) const;
+
+        /**
+         * @brief Calculate the drift velocity of a charge carrier from the electric and magnetic fields
+         * @param type Type of the charge carrier
+         * @param pos  Position in local coordinates
+         * @return Drift velocity of the charge carrier
+         */
+        Eigen::Vector3d drift_velocity(const CarrierType& type, const Eigen::Vector3d& pos) const;
+
+        /**
+         * @brief Calculate the drift velocity of a charge carrier from the fields at its position
+         * @param type   Type of the charge carrier
+         * @param efield Electric field at the position of the charge carrier
+         * @param doping Doping concentration at the position of the charge carrier
+         * @param bfield Magnetic field at the position of the charge carrier, ignored without magnetic field
+         * @return Drift velocity of the charge carrier
+         */
+        Eigen::Vector3d drift_velocity(const CarrierType& type,
+                                       const Eigen::Vector3d& efield,
+                                       double doping,
+                                       const Eigen::Vector3d& bfield) const;
+
+        /**
+         * @brief Calculate the drift velocity of a charge carrier from its mobility, including the Hall effect
+         * @param type     Type of the charge carrier
+         * @param mobility Mobility of the charge carrier
+         * @param efield   Electric field at the position of the charge carrier
+         * @param bfield   Magnetic field at the position of the charge carrier, ignored without magnetic field
+         * @return Drift velocity of the charge carrier
+         */
+        Eigen::Vector3d lorentz_drift(const CarrierType& type,
+                                      double mobility,
+                                      const Eigen::Vector3d& efield,
+                                      const Eigen::Vector3d& bfield) const;
+
+        /**
+         * @brief Calculate the drift velocity of charge carriers at multiple positions
+         * @param type     Type of the charge carriers
+         * @param x        Pointer to the x coordinates of the positions in local coordinates
+         * @param y        Pointer to the y coordinates of the positions in local coordinates
+         * @param z        Pointer to the z coordinates of the positions in local coordinates
+         * @param count    Number of positions
+         * @param velocity Pointers to the storage of the x, y and z components of the drift velocity at all positions
+         */
+        void drift_velocity(const CarrierType& type,
+                            const double* x,
+                            const double* y,
+                            const double* z,
+                            size_t count,
+                            const std::array<double*, 3>& velocity) const;
+
+        /**
+         * @brief Sample the drift velocity of a carrier type onto a grid spanning a single pixel cell
+         * @param type Type of the charge carrier
+         * @param bins Number of grid cells in x, y and z
+         * @return Field holding the sampled drift velocity
+         */
+        DetectorField<ROOT::Math::XYZVector> create_velocity_map(const CarrierType& type, std::array<size_t, 3> bins) const;
+
+        /**
+         * @brief Slab of the sensor in which the drift velocity is uniform
+         */
+        struct UniformRegion {
+            double z_min;
+            double z_max;
+            Eigen::Vector3d velocity;
+        };
+
+        /**
+         * @brief Find the slabs of the sensor in which the drift velocity of a carrier type is uniform within a tolerance
+         * @param type      Type of the charge carrier
+         * @param bins      Number of points in x, y and z at which the velocity is sampled in a single pixel cell
+         * @param tolerance Maximum deviation of each velocity component from the velocity of the slab, relative to its
+         *                  magnitude
+         * @return Regions of uniform velocity, ordered in z
+         */
+        std::vector<UniformRegion>
+        find_uniform_regions(const CarrierType& type, std::array<size_t, 3> bins, double tolerance) const;
+
+        /**
+         * @brief Estimate the lateral spread by diffusion of charge carriers drifting from every layer of the sensor
+         * @param type Type of the charge carrier
+         * @param bins Number of layers in z
+         * @return Standard deviation of the lateral diffusion of charge carriers from the center of every layer until they
+         *         reach the sensor surface, infinite for layers from which they do not reach a surface
+         */
+        std::vector<double> estimate_diffusion_spread(const CarrierType& type, size_t bins) const;
+
+        /**
+         * @brief Determine the number of charge carriers propagated together for a deposit in the adaptive charge grouping
+         * @param deposit         Deposited charge
+         * @param charge_per_step Number of charge carriers propagated together for deposits at pixel boundaries
+         * @return Number of charge carriers propagated together for the deposit
+         */
+        unsigned int adaptive_charge_per_step(const DepositedCharge& deposit, unsigned int charge_per_step) const;
+
+        /**
+         * @brief Create the requested line graphs and animations of the drift paths of an event
+         * @param event_num          Number of the event
+         * @param output_plot_points Points of the drift paths recorded for the event
+         */
+        void create_output_plots(uint64_t event_num, const LineGraph::OutputPlotPoints& output_plot_points);
+
+        /**
+         * @brief Sum the propagated charges of an event per pixel and dispatch them as pixel charges
+         * @param event              Event the charges were propagated in
+         * @param charges            Data of all propagated sets of charges
+         * @param propagated_charges Dispatched propagated charges in the order of their data, empty if not dispatched
+         */
+        void transfer_charges(Event* event,
+                              const std::vector<PropagatedChargeData>& charges,
+                              const std::vector<PropagatedCharge>& propagated_charges);
 
         // Local copies of configuration parameters to avoid costly lookup:
         double temperature_{}, timestep_min_{}, timestep_max_{}, timestep_start_{}, integration_time_{},
-            target_spatial_precision_{}, output_plots_step_{};
+            target_spatial_precision_{}, output_plots_step_{}, output_linegraphs_tolerance_{};
         bool output_plots_{}, output_linegraphs_{}, output_linegraphs_collected_{}, output_linegraphs_recombined_{},
-            output_linegraphs_trapped_{}, output_animations_{};
+            output_linegraphs_trapped_{}, output_animations_{}, output_linegraphs_deferred_{};
+        std::set<uint64_t> output_linegraphs_events_;
+
+        // Points of the drift paths of all events kept until the end of the run if the line graphs are deferred
+        std::mutex deferred_plot_points_mutex_;
+        std::map<uint64_t, LineGraph::OutputPlotPoints> deferred_plot_points_;
         bool propagate_electrons_{}, propagate_holes_{};
+        bool store_charges_{};
+        bool dispatch_charges_{};
+
+        // Direct transfer of the propagated charges to the pixels
+        bool transfer_charges_{};
+        bool collect_from_implant_{};
+        double max_depth_distance_{};
         unsigned int charge_per_step_{};
         unsigned int max_charge_groups_{};
+        unsigned int tasks_per_event_{};
         unsigned int max_multiplication_level_{};
+        IntegrationMethod integration_method_{};
+
+        // Number of charge carrier sets propagated together, at most max_batch_size_
+        static constexpr size_t max_batch_size_ = 64;
+        unsigned int batch_size_{};
+        Precision precision_{};
 
         // Models for electron and hole mobility and lifetime
         Mobility mobility_;
@@ -133,11 +345,39 @@ namespace allpix {
         // Magnetic field
         bool has_magnetic_field_;
 
+        // Drift velocity maps of electrons and holes, precomputed for static fields if requested
+        bool precompute_velocity_{};
+        DetectorField<ROOT::Math::XYZVector> electron_velocity_map_;
+        DetectorField<ROOT::Math::XYZVector> hole_velocity_map_;
+
+        // Sample the survival time against recombination and trapping once per charge carrier instead of at every step
+        bool sample_survival_time_{};
+
+        // Regions of uniform drift velocity of electrons and holes, crossed with the analytic drift if requested
+        bool analytic_drift_{};
+        std::vector<UniformRegion> electron_uniform_regions_;
+        std::vector<UniformRegion> hole_uniform_regions_;
+
+        // Lateral diffusion spread of electrons and holes per layer of the sensor, used for the adaptive charge grouping
+        bool adaptive_charge_grouping_{};
+        unsigned int max_charge_per_step_{};
+
+        // Number of charge carriers propagated together in events exceeding their time budget
+        unsigned int degraded_charge_per_step_{};
+        std::vector<double> electron_diffusion_spread_;
+        std::vector<double> hole_diffusion_spread_;
+
         // Statistical information
-        std::atomic<unsigned int> total_propagated_charges_{};
-        std::atomic<unsigned int> total_steps_{};
-        std::atomic<long unsigned int> total_time_picoseconds_{};
-        std::atomic<unsigned int> total_deposits_{}, deposits_exceeding_max_groups_{};
+        Counter total_propagated_charges_, total_recombined_charges_, total_trapped_charges_;
+        Counter total_steps_, total_rejected_steps_;
+        Counter total_time_picoseconds_;
+        Counter total_deposits_, deposits_exceeding_max_groups_;
+        Counter degraded_events_;
+        Counter total_transferred_charges_;
+
+        // Selection of the deposits passed on to the propagation
+        DepositCulling deposit_culling_;
+        DepositOrdering deposit_ordering_;
         Histogram<TH1D> step_length_histo_;
         Histogram<TH1D> drift_time_histo_;
         Histogram<TH1D> uncertainty_histo_;
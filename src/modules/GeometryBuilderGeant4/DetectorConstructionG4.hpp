@@ -13,6 +13,7 @@
 #define ALLPIX_MODULE_DETECTOR_CONSTRUCTION_H
 
 #include <memory>
+#include <string>
 #include <utility>
 
 #include "G4LogicalVolume.hh"
@@ -30,8 +31,9 @@ namespace allpix {
         /**
          * @brief Constructs geometry construction module
          * @param geo_manager Pointer to the geometry manager, containing the detectors
+         * @param instancing Build the volumes once per detector model and place them for all detectors of this model
          */
-        explicit DetectorConstructionG4(GeometryManager* geo_manager);
+        DetectorConstructionG4(GeometryManager* geo_manager, bool instancing = false);
 
         /**
          * @brief Constructs the world geometry with all detectors
@@ -40,7 +42,22 @@ namespace allpix {
         void build(const std::shared_ptr<G4LogicalVolume>& world_log);
 
     private:
+        /**
+         * @brief Build the logical volumes of a detector model and their placements inside the wrapper volume
+         * @param name Name of the detector the volumes are registered for
+         * @param model Model of the detector
+         */
+        void build_model(const std::string& name, const std::shared_ptr<DetectorModel>& model);
+
+        /**
+         * @brief Register the volumes built for another detector of the same model also for the given detector
+         * @param prototype Name of the detector the volumes have been built for
+         * @param name Name of the detector the volumes are shared with
+         */
+        void share_model(const std::string& prototype, const std::string& name);
+
         GeometryManager* geo_manager_;
+        bool instancing_;
 
         // Storage of internal objects
         std::vector<std::shared_ptr<G4VSolid>> solids_;
@@ -17,6 +17,7 @@
 #include <string>
 #include <utility>
 
+#include <G4AffineTransform.hh>
 #include <G4Box.hh>
 #include <G4LogicalVolume.hh>
 #include <G4NavigationHistory.hh>
@@ -46,7 +47,8 @@ using namespace allpix;
 
 GeometryConstructionG4::GeometryConstructionG4(GeometryManager* geo_manager, Configuration& config)
     : geo_manager_(geo_manager), config_(config) {
-    detector_builder_ = std::make_unique<DetectorConstructionG4>(geo_manager_);
+    detector_builder_ =
+        std::make_unique<DetectorConstructionG4>(geo_manager_, config_.get<bool>("geometry_instancing", false));
     passive_builder_ = std::make_unique<PassiveMaterialConstructionG4>(geo_manager_);
     passive_builder_->registerVolumes();
 }
@@ -184,8 +186,13 @@ void GeometryConstructionG4::verify_transforms() const {
         auto local = detector->getLocalPosition(static_cast<ROOT::Math::XYZPoint>(global));
 
         // Obtain physical sensor volume, its transformation to the world volume and apply to global test vector:
+        // The transformation is composed from the wrapper placement since the sensor volume might be shared by detectors
+        auto wrapper = geo_manager_->getExternalObject<G4PVPlacement>(detector->getName(), "wrapper_phys");
         auto sensor = geo_manager_->getExternalObject<G4PVPlacement>(detector->getName(), "sensor_phys");
-        auto coord_g4 = get_world_transform(sensor.get()).TransformPoint(global);
+        G4AffineTransform sensor_transform;
+        sensor_transform.InverseProduct(get_world_transform(wrapper.get()),
+                                        G4AffineTransform(sensor->GetRotation(), sensor->GetTranslation()));
+        auto coord_g4 = sensor_transform.TransformPoint(global);
 
         // Apply translation to correct for volume origin not corresponding to volume center
         coord_g4 -= *geo_manager_->getExternalObject<G4ThreeVector>(detector->getName(), "model_translation");
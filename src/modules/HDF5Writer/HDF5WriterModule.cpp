@@ -0,0 +1,447 @@
+/**
+ * @file
+ * @brief Implementation of HDF5 data file writer module
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "HDF5WriterModule.hpp"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "core/config/exceptions.h"
+#include "core/messenger/exceptions.h"
+#include "core/module/exceptions.h"
+#include "core/utils/log.h"
+
+using namespace allpix;
+
+namespace {
+    // Chunks are limited to the default size of the HDF5 chunk cache
+    constexpr size_t max_chunk_bytes = 1024 * 1024;
+
+    /**
+     * @brief Write a one-dimensional attribute
+     * @param location Object to attach the attribute to
+     * @param name Name of the attribute
+     * @param type HDF5 type of the values
+     * @param values Values of the attribute
+     */
+    template <typename T>
+    void write_attribute(hid_t location, const std::string& name, hid_t type, const std::vector<T>& values) {
+        hsize_t dims = values.size();
+        auto space = H5Screate_simple(1, &dims, nullptr);
+        auto attribute = H5Acreate2(location, name.c_str(), type, space, H5P_DEFAULT, H5P_DEFAULT);
+        auto status = (attribute < 0 ? -1 : H5Awrite(attribute, type, values.data()));
+        if(attribute >= 0) {
+            H5Aclose(attribute);
+        }
+        H5Sclose(space);
+        if(status < 0) {
+            throw ModuleError("Cannot write HDF5 attribute " + name);
+        }
+    }
+} // namespace
+
+HDF5WriterModule::Dataset::Dataset(hid_t location,
+                                   const std::string& name,
+                                   hid_t type,
+                                   std::vector<hsize_t> row_dims,
+                                   hsize_t chunk_rows,
+                                   unsigned int compression)
+    : type_(H5Tcopy(type)), row_dims_(std::move(row_dims)) {
+    row_size_ = H5Tget_size(type_);
+    for(auto dim : row_dims_) {
+        row_size_ *= dim;
+    }
+    chunk_rows_ = std::max<hsize_t>(1, std::min<hsize_t>(chunk_rows, max_chunk_bytes / row_size_));
+
+    // The first dimension of every dataset are its rows, which are extended when writing
+    std::vector<hsize_t> dims{0};
+    std::vector<hsize_t> max_dims{H5S_UNLIMITED};
+    std::vector<hsize_t> chunk_dims{chunk_rows_};
+    dims.insert(dims.end(), row_dims_.begin(), row_dims_.end());
+    max_dims.insert(max_dims.end(), row_dims_.begin(), row_dims_.end());
+    chunk_dims.insert(chunk_dims.end(), row_dims_.begin(), row_dims_.end());
+    auto rank = static_cast<int>(dims.size());
+
+    auto space = H5Screate_simple(rank, dims.data(), max_dims.data());
+    auto properties = H5Pcreate(H5P_DATASET_CREATE);
+    H5Pset_chunk(properties, rank, chunk_dims.data());
+    if(compression > 0) {
+        H5Pset_shuffle(properties);
+        H5Pset_deflate(properties, compression);
+    }
+    id_ = H5Dcreate2(location, name.c_str(), type_, space, H5P_DEFAULT, properties, H5P_DEFAULT);
+    H5Pclose(properties);
+    H5Sclose(space);
+    if(id_ < 0) {
+        H5Tclose(type_);
+        throw ModuleError("Cannot create HDF5 dataset " + name);
+    }
+}
+
+HDF5WriterModule::Dataset::~Dataset() {
+    H5Dclose(id_);
+    H5Tclose(type_);
+}
+
+void HDF5WriterModule::Dataset::append(const void* data, size_t rows) {
+    const auto* bytes = static_cast<const char*>(data);
+    staged_.insert(staged_.end(), bytes, bytes + rows * row_size_);
+
+    // Only write full chunks, such that every chunk is compressed and written once
+    auto staged_rows = staged_.size() / row_size_;
+    if(staged_rows >= chunk_rows_) {
+        write(staged_rows - staged_rows % chunk_rows_);
+    }
+}
+
+void HDF5WriterModule::Dataset::flush() { write(staged_.size() / row_size_); }
+
+void HDF5WriterModule::Dataset::write(hsize_t rows) {
+    if(rows == 0) {
+        return;
+    }
+
+    std::vector<hsize_t> extent{rows_ + rows};
+    std::vector<hsize_t> start{rows_};
+    std::vector<hsize_t> count{rows};
+    extent.insert(extent.end(), row_dims_.begin(), row_dims_.end());
+    start.resize(extent.size(), 0);
+    count.insert(count.end(), row_dims_.begin(), row_dims_.end());
+    if(H5Dset_extent(id_, extent.data()) < 0) {
+        throw ModuleError("Cannot extend HDF5 dataset");
+    }
+
+    auto file_space = H5Dget_space(id_);
+    H5Sselect_hyperslab(file_space, H5S_SELECT_SET, start.data(), nullptr, count.data(), nullptr);
+    auto memory_space = H5Screate_simple(static_cast<int>(count.size()), count.data(), nullptr);
+    auto status = H5Dwrite(id_, type_, memory_space, file_space, H5P_DEFAULT, staged_.data());
+    H5Sclose(memory_space);
+    H5Sclose(file_space);
+    if(status < 0) {
+        throw ModuleError("Cannot write rows to HDF5 dataset");
+    }
+
+    staged_.erase(staged_.begin(), staged_.begin() + static_cast<std::ptrdiff_t>(rows * row_size_));
+    rows_ += rows;
+}
+
+HDF5WriterModule::HDF5WriterModule(Configuration& config, Messenger* messenger, GeometryManager* geo_mgr)
+    : Module(config), messenger_(messenger), geo_mgr_(geo_mgr) {
+    // Enable multithreading of this module if multithreading is enabled
+    allow_multithreading();
+
+    config_.setDefault<std::string>("file_name", "data");
+    config_.setDefaultArray<DatasetType>("datasets", {DatasetType::HITS});
+    config_.setDefault<hsize_t>("chunk_size", 1024);
+    config_.setDefault<unsigned int>("compression", 4);
+    config_.setDefault<size_t>("waveform_bins", 256);
+    config_.setDefault<size_t>("max_buffered_events", 128);
+
+    auto datasets = config_.getArray<DatasetType>("datasets");
+    datasets_.insert(datasets.begin(), datasets.end());
+    waveform_bins_ = config_.get<size_t>("waveform_bins");
+    if(waveform_bins_ == 0) {
+        throw InvalidValueError(config_, "waveform_bins", "number of waveform bins should be larger than zero");
+    }
+    max_buffered_events_ = config_.get<size_t>("max_buffered_events");
+    if(max_buffered_events_ == 0) {
+        throw InvalidValueError(config_, "max_buffered_events", "number of buffered events should be larger than zero");
+    }
+
+    // Bind messages optionally, the module has to run for every event to keep the order
+    if(datasets_.count(DatasetType::HITS) > 0 || datasets_.count(DatasetType::IMAGES) > 0) {
+        messenger_->bindMulti<PixelHitMessage>(this, MsgFlags::NONE);
+    }
+    if(datasets_.count(DatasetType::WAVEFORMS) > 0) {
+        messenger_->bindMulti<PixelPulseMessage>(this, MsgFlags::NONE);
+    }
+}
+
+HDF5WriterModule::~HDF5WriterModule() { close_file(); }
+
+void HDF5WriterModule::initialize() {
+    // Select the detectors to write
+    std::vector<std::shared_ptr<Detector>> detectors;
+    if(config_.has("detectors")) {
+        for(const auto& name : config_.getArray<std::string>("detectors")) {
+            if(!geo_mgr_->hasDetector(name)) {
+                throw InvalidValueError(config_, "detectors", "detector " + name + " is not defined");
+            }
+            detectors.push_back(geo_mgr_->getDetector(name));
+        }
+    } else {
+        detectors = geo_mgr_->getDetectors();
+    }
+
+    auto chunk_size = config_.get<hsize_t>("chunk_size");
+    if(chunk_size == 0) {
+        throw InvalidValueError(config_, "chunk_size", "chunk size should be larger than zero");
+    }
+    auto compression = config_.get<unsigned int>("compression");
+    if(compression > 9) {
+        throw InvalidValueError(config_, "compression", "compression level should be between 0 and 9");
+    }
+
+    // Create output file
+    output_file_name_ = createOutputFile(config_.get<std::string>("file_name"), "h5", true);
+    file_ = H5Fcreate(output_file_name_.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+    if(file_ < 0) {
+        throw InvalidValueError(config_, "file_name", "cannot create HDF5 file");
+    }
+
+    // Layout of the table rows
+    auto event_type = H5Tcreate(H5T_COMPOUND, sizeof(EventRow));
+    H5Tinsert(event_type, "event", HOFFSET(EventRow, event), H5T_NATIVE_UINT64);
+    H5Tinsert(event_type, "seed", HOFFSET(EventRow, seed), H5T_NATIVE_UINT64);
+    auto hit_type = H5Tcreate(H5T_COMPOUND, sizeof(HitRow));
+    H5Tinsert(hit_type, "event", HOFFSET(HitRow, event), H5T_NATIVE_UINT64);
+    H5Tinsert(hit_type, "column", HOFFSET(HitRow, column), H5T_NATIVE_INT32);
+    H5Tinsert(hit_type, "row", HOFFSET(HitRow, row), H5T_NATIVE_INT32);
+    H5Tinsert(hit_type, "signal", HOFFSET(HitRow, signal), H5T_NATIVE_DOUBLE);
+    H5Tinsert(hit_type, "local_time", HOFFSET(HitRow, local_time), H5T_NATIVE_DOUBLE);
+    H5Tinsert(hit_type, "global_time", HOFFSET(HitRow, global_time), H5T_NATIVE_DOUBLE);
+    auto pulse_type = H5Tcreate(H5T_COMPOUND, sizeof(PulseRow));
+    H5Tinsert(pulse_type, "event", HOFFSET(PulseRow, event), H5T_NATIVE_UINT64);
+    H5Tinsert(pulse_type, "column", HOFFSET(PulseRow, column), H5T_NATIVE_INT32);
+    H5Tinsert(pulse_type, "row", HOFFSET(PulseRow, row), H5T_NATIVE_INT32);
+    H5Tinsert(pulse_type, "charge", HOFFSET(PulseRow, charge), H5T_NATIVE_DOUBLE);
+
+    // Create the event table and the datasets of every detector
+    events_ = std::make_unique<Dataset>(file_, "events", event_type, std::vector<hsize_t>(), chunk_size, compression);
+    for(auto& detector : detectors) {
+        DetectorOutput output;
+        output.detector = detector;
+        output.group = H5Gcreate2(file_, detector->getName().c_str(), H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+        if(output.group < 0) {
+            throw ModuleError("Cannot create HDF5 group for detector " + detector->getName());
+        }
+        auto npixels = detector->getModel()->getNPixels();
+        write_attribute(
+            output.group, "number_of_pixels", H5T_NATIVE_UINT, std::vector<unsigned int>{npixels.x(), npixels.y()});
+
+        if(datasets_.count(DatasetType::HITS) > 0) {
+            output.hits =
+                std::make_unique<Dataset>(output.group, "hits", hit_type, std::vector<hsize_t>(), chunk_size, compression);
+        }
+        if(datasets_.count(DatasetType::IMAGES) > 0) {
+            // Images are stored with the column as first and the row as second dimension
+            output.images = std::make_unique<Dataset>(output.group,
+                                                      "images",
+                                                      H5T_NATIVE_FLOAT,
+                                                      std::vector<hsize_t>{npixels.x(), npixels.y()},
+                                                      chunk_size,
+                                                      compression);
+        }
+        if(datasets_.count(DatasetType::WAVEFORMS) > 0) {
+            output.pulses = std::make_unique<Dataset>(
+                output.group, "pulses", pulse_type, std::vector<hsize_t>(), chunk_size, compression);
+            output.waveforms = std::make_unique<Dataset>(output.group,
+                                                         "waveforms",
+                                                         H5T_NATIVE_FLOAT,
+                                                         std::vector<hsize_t>{waveform_bins_},
+                                                         chunk_size,
+                                                         compression);
+        }
+
+        detector_index_[detector->getName()] = outputs_.size();
+        outputs_.push_back(std::move(output));
+    }
+    H5Tclose(event_type);
+    H5Tclose(hit_type);
+    H5Tclose(pulse_type);
+    LOG(DEBUG) << "Created datasets of " << outputs_.size() << " detectors in file " << output_file_name_;
+
+    next_event_ = getConfigManager()->getGlobalConfiguration().get<uint64_t>("skip_events", 0) + 1;
+}
+
+std::unique_ptr<HDF5WriterModule::PreparedEvent> HDF5WriterModule::prepare_event(Event* event) {
+    auto prepared = std::make_unique<PreparedEvent>();
+    prepared->event = {event->number, event->getSeed()};
+    prepared->detectors.resize(outputs_.size());
+
+    // Every event has an image, also if no hits have been received
+    if(datasets_.count(DatasetType::IMAGES) > 0) {
+        for(size_t i = 0; i < outputs_.size(); ++i) {
+            auto npixels = outputs_[i].detector->getModel()->getNPixels();
+            prepared->detectors[i].image.resize(static_cast<size_t>(npixels.x()) * npixels.y(), 0);
+        }
+    }
+
+    std::vector<std::shared_ptr<PixelHitMessage>> hit_messages;
+    if(datasets_.count(DatasetType::HITS) > 0 || datasets_.count(DatasetType::IMAGES) > 0) {
+        try {
+            hit_messages = messenger_->fetchMultiMessage<PixelHitMessage>(this, event);
+        } catch(const MessageNotFoundException&) {
+            LOG(TRACE) << "No pixel hits received";
+        }
+    }
+    for(const auto& message : hit_messages) {
+        auto index = detector_index_.find(message->getDetector()->getName());
+        if(index == detector_index_.end()) {
+            continue;
+        }
+        auto& detector = prepared->detectors[index->second];
+        auto npixels = message->getDetector()->getModel()->getNPixels();
+
+        for(const auto& hit : message->getData()) {
+            auto pixel_index = hit.getIndex();
+            if(datasets_.count(DatasetType::HITS) > 0) {
+                detector.hits.push_back({event->number,
+                                         pixel_index.x(),
+                                         pixel_index.y(),
+                                         hit.getSignal(),
+                                         hit.getLocalTime(),
+                                         hit.getGlobalTime()});
+            }
+            if(!detector.image.empty() && pixel_index.x() >= 0 && pixel_index.y() >= 0 &&
+               static_cast<unsigned int>(pixel_index.x()) < npixels.x() &&
+               static_cast<unsigned int>(pixel_index.y()) < npixels.y()) {
+                detector.image[static_cast<size_t>(pixel_index.x()) * npixels.y() + static_cast<size_t>(pixel_index.y())] +=
+                    static_cast<float>(hit.getSignal());
+            }
+        }
+    }
+
+    std::vector<std::shared_ptr<PixelPulseMessage>> pulse_messages;
+    if(datasets_.count(DatasetType::WAVEFORMS) > 0) {
+        try {
+            pulse_messages = messenger_->fetchMultiMessage<PixelPulseMessage>(this, event);
+        } catch(const MessageNotFoundException&) {
+            LOG(TRACE) << "No pixel pulses received";
+        }
+    }
+    for(const auto& message : pulse_messages) {
+        auto index = detector_index_.find(message->getDetector()->getName());
+        if(index == detector_index_.end()) {
+            continue;
+        }
+        auto& detector = prepared->detectors[index->second];
+
+        for(const auto& pulse : message->getData()) {
+            auto pixel_index = pulse.getIndex();
+            detector.pulses.push_back(
+                {event->number, pixel_index.x(), pixel_index.y(), static_cast<double>(pulse.getCharge())});
+            detector.binning = pulse.getBinning();
+
+            // Waveforms start at time zero, compacted pulses are expanded and longer pulses are truncated
+            auto offset = detector.waveforms.size();
+            detector.waveforms.resize(offset + waveform_bins_, 0);
+            for(size_t bin = pulse.getOffset(); bin < std::min(waveform_bins_, pulse.getOffset() + pulse.size()); ++bin) {
+                detector.waveforms[offset + bin] = static_cast<float>(pulse[bin - pulse.getOffset()]);
+            }
+        }
+    }
+
+    return prepared;
+}
+
+void HDF5WriterModule::run(Event* event) {
+    // Rows are prepared in parallel, only appending them to the datasets is serialized
+    auto prepared = prepare_event(event);
+
+    std::lock_guard<std::mutex> lock(buffer_mutex_);
+    buffer_.emplace(event->number, std::move(prepared));
+
+    // Commit all events next in order, or the earliest buffered event if the buffer is full
+    while(!buffer_.empty() && (buffer_.begin()->first <= next_event_ || buffer_.size() > max_buffered_events_)) {
+        commit_buffered_event();
+    }
+}
+
+void HDF5WriterModule::commit_buffered_event() {
+    auto event_number = buffer_.begin()->first;
+    auto prepared = std::move(buffer_.begin()->second);
+    buffer_.erase(buffer_.begin());
+
+    if(event_number > next_event_) {
+        LOG(DEBUG) << "Events " << next_event_ << " to " << (event_number - 1)
+                   << " have not been received, continuing with event " << event_number;
+    } else if(event_number < next_event_) {
+        LOG(WARNING) << "Event " << event_number << " received after the buffer of " << max_buffered_events_
+                     << " events has been exceeded, writing it out of order";
+    }
+    next_event_ = std::max(next_event_, event_number + 1);
+
+    commit_event(*prepared);
+}
+
+void HDF5WriterModule::commit_event(const PreparedEvent& prepared) {
+    LOG(TRACE) << "Appending rows of event " << prepared.event.event;
+    events_->append(&prepared.event, 1);
+
+    for(size_t i = 0; i < outputs_.size(); ++i) {
+        auto& output = outputs_[i];
+        const auto& detector = prepared.detectors[i];
+        if(output.hits != nullptr) {
+            output.hits->append(detector.hits.data(), detector.hits.size());
+            hit_cnt_ += detector.hits.size();
+        }
+        if(output.images != nullptr) {
+            output.images->append(detector.image.data(), 1);
+        }
+        if(output.pulses != nullptr && !detector.pulses.empty()) {
+            if(output.binning == 0) {
+                output.binning = detector.binning;
+            } else if(output.binning != detector.binning) {
+                LOG_ONCE(WARNING) << "Pulses of detector " << output.detector->getName()
+                                  << " have different binnings, waveforms cannot be compared";
+            }
+            output.pulses->append(detector.pulses.data(), detector.pulses.size());
+            output.waveforms->append(detector.waveforms.data(), detector.pulses.size());
+            pulse_cnt_ += detector.pulses.size();
+        }
+    }
+    ++event_cnt_;
+}
+
+void HDF5WriterModule::finalize() {
+    // Commit the remaining buffered events and write all staged rows
+    while(!buffer_.empty()) {
+        commit_buffered_event();
+    }
+    events_->flush();
+    for(auto& output : outputs_) {
+        for(auto* dataset : {output.hits.get(), output.images.get(), output.pulses.get(), output.waveforms.get()}) {
+            if(dataset != nullptr) {
+                dataset->flush();
+            }
+        }
+        if(output.waveforms != nullptr) {
+            write_attribute(output.waveforms->id(), "binning", H5T_NATIVE_DOUBLE, std::vector<double>{output.binning});
+        }
+    }
+    close_file();
+
+    // Print statistics
+    LOG(STATUS) << "Wrote " << hit_cnt_ << " hits and " << pulse_cnt_ << " pulses of " << event_cnt_
+                << " events to file:" << std::endl
+                << output_file_name_;
+}
+
+void HDF5WriterModule::close_file() {
+    events_.reset();
+    for(auto& output : outputs_) {
+        output.hits.reset();
+        output.images.reset();
+        output.pulses.reset();
+        output.waveforms.reset();
+        if(output.group >= 0) {
+            H5Gclose(output.group);
+        }
+    }
+    outputs_.clear();
+    if(file_ >= 0) {
+        H5Fclose(file_);
+        file_ = H5I_INVALID_HID;
+    }
+}
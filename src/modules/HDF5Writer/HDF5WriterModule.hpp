@@ -0,0 +1,277 @@
+/**
+ * @file
+ * @brief Definition of HDF5 data file writer module
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <hdf5.h>
+
+#include "core/config/Configuration.hpp"
+#include "core/geometry/GeometryManager.hpp"
+#include "core/messenger/Messenger.hpp"
+#include "core/module/Event.hpp"
+#include "core/module/Module.hpp"
+
+#include "objects/PixelHit.hpp"
+#include "objects/PixelPulse.hpp"
+
+namespace allpix {
+    /**
+     * @ingroup Modules
+     * @brief Module to write pixel hits and pulses to fixed-layout datasets in an HDF5 file
+     * @note This module supports multithreading
+     *
+     * Writes a group for every detector with chunked and compressed datasets of the pixel hits, dense images of the pixel
+     * signals of every event and the waveforms of the pixel pulses. The rows of an event are prepared by the worker threads
+     * in parallel and appended to the datasets in order of the event numbers.
+     */
+    class HDF5WriterModule : public Module {
+    public:
+        /**
+         * @brief Types of datasets written for every detector
+         */
+        enum class DatasetType {
+            HITS,      ///< Table of all pixel hits
+            IMAGES,    ///< Dense image of the pixel hit signals of every event
+            WAVEFORMS, ///< Waveforms of all pixel pulses with a fixed number of bins
+        };
+
+        /**
+         * @brief Constructor for this unique module
+         * @param config Configuration object for this module as retrieved from the steering file
+         * @param messenger Pointer to the messenger object to allow binding to messages on the bus
+         * @param geo_mgr Pointer to the geometry manager, containing the detectors
+         */
+        HDF5WriterModule(Configuration& config, Messenger* messenger, GeometryManager* geo_mgr);
+
+        /**
+         * @brief Close all datasets and the file if they are still open
+         */
+        ~HDF5WriterModule() override;
+
+        /// @{
+        /**
+         * @brief Disallow copy and move
+         */
+        HDF5WriterModule(const HDF5WriterModule&) = delete;
+        HDF5WriterModule& operator=(const HDF5WriterModule&) = delete;
+        HDF5WriterModule(HDF5WriterModule&&) = delete;
+        HDF5WriterModule& operator=(HDF5WriterModule&&) = delete;
+        /// @}
+
+        /**
+         * @brief Create the output file and the datasets of all detectors
+         */
+        void initialize() override;
+
+        /**
+         * @brief Prepare the rows of the event and append them to the datasets in order
+         */
+        void run(Event* event) override;
+
+        /**
+         * @brief Write the remaining rows and close the file
+         */
+        void finalize() override;
+
+    private:
+        /**
+         * @brief Row of the event table
+         */
+        struct EventRow {
+            uint64_t event;
+            uint64_t seed;
+        };
+
+        /**
+         * @brief Row of the hit table
+         */
+        struct HitRow {
+            uint64_t event;
+            int32_t column;
+            int32_t row;
+            double signal;
+            double local_time;
+            double global_time;
+        };
+
+        /**
+         * @brief Row of the table of pixels with a waveform
+         */
+        struct PulseRow {
+            uint64_t event;
+            int32_t column;
+            int32_t row;
+            double charge;
+        };
+
+        /**
+         * @brief Extendible dataset with rows of fixed layout, written in chunks
+         *
+         * Appended rows are staged in memory and written to the file whenever a full chunk of rows is available.
+         */
+        class Dataset {
+        public:
+            /**
+             * @brief Create a new dataset without rows
+             * @param location Group to create the dataset in
+             * @param name Name of the dataset
+             * @param type HDF5 type of a single element
+             * @param row_dims Dimensions of a single row, empty for tables
+             * @param chunk_rows Number of rows per chunk
+             * @param compression Level of the deflate compression, zero to disable the compression
+             */
+            Dataset(hid_t location,
+                    const std::string& name,
+                    hid_t type,
+                    std::vector<hsize_t> row_dims,
+                    hsize_t chunk_rows,
+                    unsigned int compression);
+
+            /**
+             * @brief Close the dataset
+             * @warning Staged rows which have not been flushed are lost
+             */
+            ~Dataset();
+
+            /// @{
+            /**
+             * @brief Disallow copy and move
+             */
+            Dataset(const Dataset&) = delete;
+            Dataset& operator=(const Dataset&) = delete;
+            Dataset(Dataset&&) = delete;
+            Dataset& operator=(Dataset&&) = delete;
+            /// @}
+
+            /**
+             * @brief Append rows to the dataset
+             * @param data Pointer to the elements of the rows
+             * @param rows Number of rows
+             */
+            void append(const void* data, size_t rows);
+
+            /**
+             * @brief Write all staged rows to the file
+             */
+            void flush();
+
+            /**
+             * @brief Get the HDF5 identifier of the dataset
+             */
+            hid_t id() const { return id_; }
+
+        private:
+            /**
+             * @brief Write the first staged rows to the file
+             * @param rows Number of rows to write
+             */
+            void write(hsize_t rows);
+
+            hid_t id_{H5I_INVALID_HID};
+            hid_t type_{H5I_INVALID_HID};
+            std::vector<hsize_t> row_dims_;
+            size_t row_size_{};
+            hsize_t chunk_rows_{};
+            hsize_t rows_{};
+            std::vector<char> staged_;
+        };
+
+        /**
+         * @brief Group and datasets of a single detector
+         */
+        struct DetectorOutput {
+            std::shared_ptr<Detector> detector;
+            hid_t group{H5I_INVALID_HID};
+            std::unique_ptr<Dataset> hits;
+            std::unique_ptr<Dataset> images;
+            std::unique_ptr<Dataset> pulses;
+            std::unique_ptr<Dataset> waveforms;
+            double binning{};
+        };
+
+        /**
+         * @brief Rows of a single detector prepared for an event
+         */
+        struct PreparedDetector {
+            std::vector<HitRow> hits;
+            std::vector<float> image;
+            std::vector<PulseRow> pulses;
+            std::vector<float> waveforms;
+            double binning{};
+        };
+
+        /**
+         * @brief Rows prepared for an event, with the detectors in the order of the outputs
+         */
+        struct PreparedEvent {
+            EventRow event;
+            std::vector<PreparedDetector> detectors;
+        };
+
+        /**
+         * @brief Convert the hits and pulses of an event to the rows of the datasets
+         * @param event Event to prepare the rows for
+         * @return Prepared rows of the event
+         */
+        std::unique_ptr<PreparedEvent> prepare_event(Event* event);
+
+        /**
+         * @brief Append the prepared rows of an event to the datasets
+         * @param prepared Prepared rows of the event
+         * @warning Requires the buffer mutex to be held
+         */
+        void commit_event(const PreparedEvent& prepared);
+
+        /**
+         * @brief Commit the earliest buffered event
+         * @warning Requires the buffer mutex to be held
+         */
+        void commit_buffered_event();
+
+        /**
+         * @brief Close all datasets, groups and the file
+         */
+        void close_file();
+
+        Messenger* messenger_;
+        GeometryManager* geo_mgr_;
+
+        // Datasets to write
+        std::set<DatasetType> datasets_;
+        size_t waveform_bins_{};
+
+        // Output data file to write
+        std::string output_file_name_{};
+        hid_t file_{H5I_INVALID_HID};
+        std::unique_ptr<Dataset> events_;
+        std::vector<DetectorOutput> outputs_;
+        std::map<std::string, size_t> detector_index_;
+
+        // Events prepared in parallel and buffered until they can be committed in order
+        size_t max_buffered_events_{};
+        std::mutex buffer_mutex_;
+        std::map<uint64_t, std::unique_ptr<PreparedEvent>> buffer_;
+        uint64_t next_event_{};
+
+        // Statistical information about the written rows
+        std::atomic<unsigned long> event_cnt_{};
+        std::atomic<unsigned long> hit_cnt_{};
+        std::atomic<unsigned long> pulse_cnt_{};
+    };
+} // namespace allpix
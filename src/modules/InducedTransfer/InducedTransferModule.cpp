@@ -11,8 +11,13 @@
 
 #include "InducedTransferModule.hpp"
 
+#include <algorithm>
+#include <limits>
+#include <map>
 #include <string>
+#include <tuple>
 #include <utility>
+#include <vector>
 
 #include "core/module/Event.hpp"
 #include "core/utils/log.h"
@@ -32,9 +37,13 @@ InducedTransferModule::InducedTransferModule(Configuration& config, Messenger* m
     // Set default value for config variables and store value
     config_.setDefault<unsigned int>("distance", 1);
     distance_ = config_.get<unsigned int>("distance");
+    neighbor_stencil_ = model_->getNeighborStencil(distance_);
 
     // Require propagated deposits for single detector
     messenger_->bindSingle<PropagatedChargeMessage>(this, MsgFlags::REQUIRED);
+
+    // Declare the messages dispatched by this module
+    declare_output<PixelChargeMessage>();
 }
 
 void InducedTransferModule::initialize() {
@@ -52,7 +61,11 @@ void InducedTransferModule::run(Event* event) {
     LOG(TRACE) << "Calculating induced charge on pixels";
     bool found_electrons = false, found_holes = false;
 
-    std::map<Pixel::Index, std::vector<std::pair<double, const PropagatedCharge*>>> pixel_map;
+    // Induced charge of every propagated charge on every neighboring pixel, in the order of the propagated charges
+    auto& inductions = scratch<std::vector<std::tuple<Pixel::Index, double, const PropagatedCharge*>>>();
+    auto& neighbors = scratch<std::vector<Pixel::Index>>();
+    auto& ramo_end = scratch<std::vector<double>>(1);
+    auto& ramo_start = scratch<std::vector<double>>(2);
     for(const auto& propagated_charge : propagated_message->getData()) {
 
         // Make sure we're not double-counting by adding induced current information to an existing pulse:
@@ -82,23 +95,56 @@ void InducedTransferModule::run(Event* event) {
                    << Units::display(position_end, {"um", "mm"}) << ", "
                    << Units::display(propagated_charge.getGlobalTime() - deposited_charge->getGlobalTime(), "ns");
 
-        // Loop over NxN pixels:
+        // Look up the potential of all NxN pixels at once for both positions
         auto idx = Pixel::Index(xpixel, ypixel);
-        for(const auto& pixel_index : model_->getNeighbors(idx, distance_)) {
-            auto ramo_end = detector_->getWeightingPotential(position_end, pixel_index);
-            auto ramo_start = detector_->getWeightingPotential(position_start, pixel_index);
-
+        neighbors.clear();
+        model_->forEachNeighbor(idx, neighbor_stencil_, [&](const Pixel::Index& pixel_index) {
+            neighbors.push_back(pixel_index);
+        });
+        ramo_end.resize(neighbors.size());
+        ramo_start.resize(neighbors.size());
+        detector_->getWeightingPotential(position_end, neighbors.data(), neighbors.size(), ramo_end.data());
+        detector_->getWeightingPotential(position_start, neighbors.data(), neighbors.size(), ramo_start.data());
+
+        for(size_t i = 0; i < neighbors.size(); ++i) {
             // Induced charge on electrode is q_int = q * (phi(x1) - phi(x0))
-            auto induced =
-                static_cast<double>(propagated_charge.getSign() * propagated_charge.getCharge()) * (ramo_end - ramo_start);
-            LOG(TRACE) << "Pixel " << pixel_index << " dPhi = " << (ramo_end - ramo_start) << ", induced "
+            auto induced = static_cast<double>(propagated_charge.getSign() * propagated_charge.getCharge()) *
+                           (ramo_end[i] - ramo_start[i]);
+            LOG(TRACE) << "Pixel " << neighbors[i] << " dPhi = " << (ramo_end[i] - ramo_start[i]) << ", induced "
                        << propagated_charge.getType() << " q = " << Units::display(induced, "e");
 
-            // Add the pixel the list of hit pixels
-            pixel_map[pixel_index].emplace_back(induced, &propagated_charge);
+            inductions.emplace_back(neighbors[i], induced, &propagated_charge);
         }
     }
 
+    // Accumulate the induced charge in a dense buffer covering all pixels with induced charge, ordered like the pixel map.
+    // Widely separated pixels, for which the buffer would be much larger than the number of inductions, use the map
+    int min_x = std::numeric_limits<int>::max(), min_y = std::numeric_limits<int>::max();
+    int max_x = std::numeric_limits<int>::min(), max_y = std::numeric_limits<int>::min();
+    for(const auto& induction : inductions) {
+        const auto& pixel_index = std::get<0>(induction);
+        min_x = std::min(min_x, pixel_index.x());
+        max_x = std::max(max_x, pixel_index.x());
+        min_y = std::min(min_y, pixel_index.y());
+        max_y = std::max(max_y, pixel_index.y());
+    }
+    auto width = (max_x >= min_x ? static_cast<size_t>(max_x - min_x) + 1 : 0);
+    auto height = (max_y >= min_y ? static_cast<size_t>(max_y - min_y) + 1 : 0);
+    auto dense = (width * height <= std::max<size_t>(4096, 4 * inductions.size()));
+
+    auto& pixel_buffer = scratch<std::vector<PixelSum>>();
+    std::map<Pixel::Index, PixelSum> pixel_map;
+    if(dense) {
+        pixel_buffer.resize(width * height);
+    }
+    for(const auto& [pixel_index, induced, propagated_charge] : inductions) {
+        auto& sum = (dense ? pixel_buffer[static_cast<size_t>(pixel_index.x() - min_x) * height +
+                                          static_cast<size_t>(pixel_index.y() - min_y)]
+                           : pixel_map[pixel_index]);
+        sum.charge += induced;
+        sum.propagated_charges.push_back(propagated_charge);
+    }
+
     // Send an error message if this even only contained one of the two carrier types
     if(!found_electrons || !found_holes) {
         LOG_ONCE(ERROR) << "Did not find charge carriers of type \"" << (found_electrons ? "holes" : "electrons")
@@ -109,19 +155,24 @@ void InducedTransferModule::run(Event* event) {
     // Create pixel charges
     LOG(TRACE) << "Combining charges at same pixel";
     std::vector<PixelCharge> pixel_charges;
-    for(auto& pixel_index_charge : pixel_map) {
-        double charge = 0;
-        std::vector<const PropagatedCharge*> prop_charges;
-        for(auto& prop_pair : pixel_index_charge.second) {
-            charge += prop_pair.first;
-            prop_charges.push_back(prop_pair.second);
-        }
-
+    auto create_pixel_charge = [&](const Pixel::Index& pixel_index, const PixelSum& sum) {
         // Get pixel object from detector
-        auto pixel = detector_->getPixel(pixel_index_charge.first.x(), pixel_index_charge.first.y());
-
-        pixel_charges.emplace_back(pixel, std::round(charge), prop_charges);
-        LOG(DEBUG) << "Set of " << charge << " charges combined at " << pixel.getIndex();
+        auto pixel = detector_->getPixel(pixel_index.x(), pixel_index.y());
+
+        pixel_charges.emplace_back(pixel, std::round(sum.charge), sum.propagated_charges);
+        LOG(DEBUG) << "Set of " << sum.charge << " charges combined at " << pixel.getIndex();
+    };
+    if(dense) {
+        for(size_t i = 0; i < pixel_buffer.size(); ++i) {
+            if(!pixel_buffer[i].propagated_charges.empty()) {
+                create_pixel_charge(Pixel::Index(min_x + static_cast<int>(i / height), min_y + static_cast<int>(i % height)),
+                                    pixel_buffer[i]);
+            }
+        }
+    } else {
+        for(const auto& [pixel_index, sum] : pixel_map) {
+            create_pixel_charge(pixel_index, sum);
+        }
     }
 
     // Dispatch message of pixel charges
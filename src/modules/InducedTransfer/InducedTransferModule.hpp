@@ -10,6 +10,7 @@
  */
 
 #include <string>
+#include <vector>
 
 #include "core/config/Configuration.hpp"
 #include "core/geometry/DetectorModel.hpp"
@@ -59,5 +60,12 @@ namespace allpix {
 
         // Distance of pixels taken into account for induction
         unsigned int distance_;
+        NeighborStencil neighbor_stencil_;
+
+        // Induced charge and history accumulated at a pixel
+        struct PixelSum {
+            double charge{};
+            std::vector<const PropagatedCharge*> propagated_charges;
+        };
     };
 } // namespace allpix
@@ -11,12 +11,14 @@
 
 #include "LCIOWriterModule.hpp"
 
+#include <algorithm>
 #include <fstream>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "core/messenger/Messenger.hpp"
+#include "core/messenger/exceptions.h"
 #include "core/utils/log.h"
 
 #include <Math/RotationZYX.h>
@@ -106,17 +108,28 @@ LCIOWriterModule::LCIOWriterModule(Configuration& config, Messenger* messenger,
     pixel_type_ = config_.get<int>("pixel_type");
     detector_name_ = config_.get<std::string>("detector_name");
     dump_mc_truth_ = config_.get<bool>("dump_mc_truth");
+
+    // Build the events in parallel and write them in order by a dedicated thread
+    asynchronous_writing_ = config_.get<bool>("asynchronous_writing", false);
+    max_buffered_events_ = config_.get<size_t>("max_buffered_events", 128);
+    if(max_buffered_events_ == 0) {
+        throw InvalidValueError(config_, "max_buffered_events", "number of buffered events should be larger than zero");
+    }
+    if(asynchronous_writing_) {
+        waive_sequence_requirement();
+    }
     // There are two ways to configure this module - either by providing a "output_collection_name" or a
     // "detector_assignment". Throws an error if both are provided and defaults back to "output_collection_name" if none are
     // provided
     auto has_short_config = config_.has("output_collection_name");
     auto has_long_config = config_.has("detector_assignment");
 
-    // Bind pixel hits message
-    messenger_->bindMulti<PixelHitMessage>(this, MsgFlags::REQUIRED);
-    messenger_->bindMulti<MCParticleMessage>(this, MsgFlags::REQUIRED);
+    // Bind pixel hits message, with asynchronous writing the module has to run for every event to keep the order
+    auto flags = (asynchronous_writing_ ? MsgFlags::NONE : MsgFlags::REQUIRED);
+    messenger_->bindMulti<PixelHitMessage>(this, flags);
+    messenger_->bindMulti<MCParticleMessage>(this, flags);
     if(dump_mc_truth_) {
-        messenger_->bindSingle<MCTrackMessage>(this, MsgFlags::REQUIRED);
+        messenger_->bindSingle<MCTrackMessage>(this, flags);
     }
 
     if(has_short_config && has_long_config) {
@@ -249,10 +262,110 @@ void LCIOWriterModule::initialize() {
     run->setRunNumber(1);
     run->setDetectorName(detector_name_);
     lcWriter_->writeRunHeader(run.get());
+
+    if(asynchronous_writing_) {
+        next_event_ = getConfigManager()->getGlobalConfiguration().get<uint64_t>("skip_events", 0) + 1;
+        LOG(DEBUG) << "Starting writer thread, buffering up to " << max_buffered_events_ << " events";
+        writer_thread_ = std::thread(&LCIOWriterModule::write_events, this);
+    }
+}
+
+LCIOWriterModule::~LCIOWriterModule() {
+    if(writer_thread_.joinable()) {
+        stop_writer();
+    }
+}
+
+void LCIOWriterModule::queue_event(uint64_t event_number, std::unique_ptr<LCEventImpl> event) {
+    std::unique_lock<std::mutex> lock(buffer_mutex_);
+    buffer_condition_.wait(lock, [&]() { return writer_error_ != nullptr || buffer_.size() < max_buffered_events_; });
+    if(writer_error_ != nullptr) {
+        try {
+            std::rethrow_exception(writer_error_);
+        } catch(const std::exception& e) {
+            throw ModuleError("Cannot write LCIO event: " + std::string(e.what()));
+        }
+    }
+    buffer_.emplace(event_number, std::move(event));
+    lock.unlock();
+    buffer_condition_.notify_all();
+}
+
+void LCIOWriterModule::write_events() {
+    std::unique_lock<std::mutex> lock(buffer_mutex_);
+    try {
+        while(true) {
+            // Write the next event in order, or the earliest buffered event if the buffer is full or the run has ended
+            buffer_condition_.wait(lock, [this]() {
+                return stop_writer_ || (!buffer_.empty() && (buffer_.begin()->first <= next_event_ ||
+                                                             buffer_.size() >= max_buffered_events_));
+            });
+            if(buffer_.empty()) {
+                break;
+            }
+
+            auto event_number = buffer_.begin()->first;
+            auto event = std::move(buffer_.begin()->second);
+            buffer_.erase(buffer_.begin());
+            if(event_number > next_event_) {
+                LOG(DEBUG) << "Events " << next_event_ << " to " << (event_number - 1)
+                           << " have not been received, continuing with event " << event_number;
+            } else if(event_number < next_event_) {
+                LOG(WARNING) << "Event " << event_number << " received after the buffer of " << max_buffered_events_
+                             << " events has been exceeded, writing it out of order";
+            }
+            next_event_ = std::max(next_event_, event_number + 1);
+            lock.unlock();
+            buffer_condition_.notify_all();
+
+            // Serialize the event without holding the buffer
+            if(event != nullptr) {
+                lcWriter_->writeEvent(event.get());
+                write_cnt_++;
+            }
+            event.reset();
+
+            lock.lock();
+        }
+    } catch(...) {
+        if(!lock.owns_lock()) {
+            lock.lock();
+        }
+        writer_error_ = std::current_exception();
+        buffer_.clear();
+    }
+    lock.unlock();
+    buffer_condition_.notify_all();
+}
+
+void LCIOWriterModule::stop_writer() {
+    {
+        std::lock_guard<std::mutex> lock(buffer_mutex_);
+        stop_writer_ = true;
+    }
+    buffer_condition_.notify_all();
+    writer_thread_.join();
 }
 
 void LCIOWriterModule::run(Event* event) {
-    auto pixel_messages = messenger_->fetchMultiMessage<PixelHitMessage>(this, event);
+    std::vector<std::shared_ptr<PixelHitMessage>> pixel_messages;
+    try {
+        pixel_messages = messenger_->fetchMultiMessage<PixelHitMessage>(this, event);
+        if(asynchronous_writing_) {
+            // Messages are bound optionally, events without all required messages are skipped as without this mode
+            messenger_->fetchMultiMessage<MCParticleMessage>(this, event);
+            if(dump_mc_truth_) {
+                messenger_->fetchMessage<MCTrackMessage>(this, event);
+            }
+        }
+    } catch(const MessageNotFoundException&) {
+        if(!asynchronous_writing_) {
+            throw;
+        }
+        LOG(TRACE) << "Not all required messages are received, not writing event";
+        queue_event(event->number, nullptr);
+        return;
+    }
 
     auto evt = std::make_unique<LCEventImpl>(); // create the event
     evt->setRunNumber(1);
@@ -450,11 +563,28 @@ void LCIOWriterModule::run(Event* event) {
         evt->addCollection(output_col_vec[i], collection_names_vector_[i]);
     }
 
+    if(asynchronous_writing_) {
+        queue_event(event->number, std::move(evt));
+        return;
+    }
+
     lcWriter_->writeEvent(evt.get()); // write the event to the file
     write_cnt_++;
 }
 
 void LCIOWriterModule::finalize() {
+    // Write the remaining buffered events
+    if(writer_thread_.joinable()) {
+        stop_writer();
+        if(writer_error_ != nullptr) {
+            try {
+                std::rethrow_exception(writer_error_);
+            } catch(const std::exception& e) {
+                throw ModuleError("Cannot write LCIO event: " + std::string(e.what()));
+            }
+        }
+    }
+
     lcWriter_->close();
     // Print statistics
     LOG(STATUS) << "Wrote " << write_cnt_ << " events to file:" << std::endl << lcio_file_name_;
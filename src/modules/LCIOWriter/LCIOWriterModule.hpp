@@ -9,7 +9,15 @@
  * SPDX-License-Identifier: MIT
  */
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "core/config/Configuration.hpp"
@@ -20,6 +28,7 @@
 
 #include "objects/PixelHit.hpp"
 
+#include <IMPL/LCEventImpl.h>
 #include <IO/LCWriter.h>
 
 namespace allpix {
@@ -28,7 +37,8 @@ namespace allpix {
      * @ingroup Modules
      * @brief Module to write hit data to LCIO file
      *
-     * Create LCIO file, compatible to EUTelescope analysis framework.
+     * Create LCIO file, compatible to EUTelescope analysis framework. With asynchronous writing, the LCIO events are built
+     * by the worker threads in parallel and written in order of their event number by a dedicated writer thread.
      */
     class LCIOWriterModule : public SequentialModule {
     public:
@@ -40,6 +50,21 @@ namespace allpix {
          */
         LCIOWriterModule(Configuration& config, Messenger* messenger, GeometryManager* geo_manager);
 
+        /**
+         * @brief Stop the writer thread if it is still running
+         */
+        ~LCIOWriterModule() override;
+
+        /// @{
+        /**
+         * @brief Disallow copy and move
+         */
+        LCIOWriterModule(const LCIOWriterModule&) = delete;
+        LCIOWriterModule& operator=(const LCIOWriterModule&) = delete;
+        LCIOWriterModule(LCIOWriterModule&&) = delete;
+        LCIOWriterModule& operator=(LCIOWriterModule&&) = delete;
+        /// @}
+
         /**
          * @brief Initialize LCIO and GEAR output files
          */
@@ -56,6 +81,23 @@ namespace allpix {
         void finalize() override;
 
     private:
+        /**
+         * @brief Hand an event to the writer thread, waiting if too many events are buffered
+         * @param event_number Number of the event
+         * @param event LCIO event to write, or a null pointer if the event is not written
+         */
+        void queue_event(uint64_t event_number, std::unique_ptr<IMPL::LCEventImpl> event);
+
+        /**
+         * @brief Write the buffered events in order of their event number until stopped
+         */
+        void write_events();
+
+        /**
+         * @brief Stop the writer thread after writing all buffered events
+         */
+        void stop_writer();
+
         Messenger* messenger_;
         GeometryManager* geo_mgr_{};
         std::shared_ptr<IO::LCWriter> lcWriter_{};
@@ -72,5 +114,16 @@ namespace allpix {
         std::string lcio_file_name_;
         std::string geometry_file_name_;
         std::atomic<int> write_cnt_{0};
+
+        // Events built by the workers and buffered until they can be written in order by the writer thread
+        bool asynchronous_writing_{};
+        size_t max_buffered_events_{};
+        std::thread writer_thread_;
+        std::mutex buffer_mutex_;
+        std::condition_variable buffer_condition_;
+        std::map<uint64_t, std::unique_ptr<IMPL::LCEventImpl>> buffer_;
+        uint64_t next_event_{};
+        bool stop_writer_{};
+        std::exception_ptr writer_error_;
     };
 } // namespace allpix
@@ -15,11 +15,14 @@
 #include <functional>
 #include <limits>
 #include <string>
+#include <tuple>
 #include <utility>
 
 #include "core/messenger/Messenger.hpp"
 #include "core/utils/distributions.h"
 #include "core/utils/log.h"
+#include "core/utils/unit_constants.h"
+#include "physics/Tabulated.hpp"
 #include "objects/DepositedCharge.hpp"
 #include "objects/PropagatedCharge.hpp"
 
@@ -37,12 +40,18 @@ ProjectionPropagationModule::ProjectionPropagationModule(Configuration& config,
     // Require deposits message for single detector
     messenger_->bindSingle<DepositedChargeMessage>(this, MsgFlags::REQUIRED);
 
+    // Declare the messages dispatched by this module
+    declare_output<PropagatedChargeMessage>();
+
     // Set default value for config variables
     config_.setDefault<int>("charge_per_step", 10);
     config_.setDefault<unsigned int>("max_charge_groups", 1000);
     config_.setDefault<double>("integration_time", Units::get(25, "ns"));
     config_.setDefault<bool>("diffuse_deposit", false);
     config_.setDefault<std::string>("recombination_model", "none");
+    config_.setDefault<bool>("tabulate_drift", false);
+    config_.setDefault<double>("tabulation_precision", 1e-4);
+    config_.setDefault<bool>("pixel_integration", false);
 
     config_.setDefault<bool>("output_linegraphs", false);
     config_.setDefault<bool>("output_animations", false);
@@ -58,6 +67,8 @@ ProjectionPropagationModule::ProjectionPropagationModule(Configuration& config,
     diffuse_deposit_ = config_.get<bool>("diffuse_deposit");
     charge_per_step_ = config_.get<unsigned int>("charge_per_step");
     max_charge_groups_ = config_.get<unsigned int>("max_charge_groups");
+    tabulate_drift_ = config_.get<bool>("tabulate_drift");
+    pixel_integration_ = config_.get<bool>("pixel_integration");
 
     output_plots_ = config_.get<bool>("output_plots");
     output_linegraphs_ = config_.get<bool>("output_linegraphs");
@@ -80,7 +91,7 @@ ProjectionPropagationModule::ProjectionPropagationModule(Configuration& config,
     }
 
     auto temperature = config_.get<double>("temperature");
-    boltzmann_kT_ = Units::get(8.6173333e-5, "eV/K") * temperature;
+    boltzmann_kT_ = 8.6173333e-5 * units::eV_per_K * temperature;
 
     // Mobility fixed to Jacoboni:
     mobility_ = std::make_unique<JacoboniCanali>(model_->getSensorMaterial(), temperature);
@@ -126,6 +137,55 @@ void ProjectionPropagationModule::initialize() {
                "field is wrong!";
     }
 
+    if(pixel_integration_ && model_->getPixelType() != Pixel::Type::RECTANGLE) {
+        throw InvalidValueError(config_, "pixel_integration", "integration over pixels requires rectangular pixels");
+    }
+
+    // Tabulate the drift time and diffusion width over the depth of the depleted region, since the linear electric field
+    // and the constant doping concentration only depend on the depth
+    if(tabulate_drift_) {
+        auto precision = config_.get<double>("tabulation_precision");
+        if(precision <= 0) {
+            throw InvalidValueError(config_, "tabulation_precision", "precision has to be positive");
+        }
+
+        auto field_mag = [&](double z) { return std::sqrt(detector_->getElectricField({0, 0, z}).Mag2()); };
+        auto efield_mag_top = field_mag(top_z_);
+
+        // Find the depth range with electric field from a scan across the sensor thickness
+        auto thickness = model_->getSensorSize().z();
+        tabulated_range_ = {std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest()};
+        for(size_t i = 0; i <= 1000; ++i) {
+            auto z = -thickness / 2 + thickness * static_cast<double>(i) / 1000.;
+            if(field_mag(z) >= std::numeric_limits<double>::epsilon()) {
+                tabulated_range_[0] = std::min(tabulated_range_[0], z);
+                tabulated_range_[1] = std::max(tabulated_range_[1], z);
+            }
+        }
+
+        if(tabulated_range_[0] < tabulated_range_[1]) {
+            auto evaluate = [&](double z) {
+                return drift_diffusion(field_mag(z), efield_mag_top, detector_->getDopingConcentration({0, 0, z}), z);
+            };
+            drift_time_table_ = TabulatedFunction([&](double z) { return evaluate(z).first; },
+                                                  tabulated_range_,
+                                                  precision,
+                                                  TabulationParameters::max_points_1d);
+            diffusion_table_ = TabulatedFunction([&](double z) { return evaluate(z).second; },
+                                                 tabulated_range_,
+                                                 precision,
+                                                 TabulationParameters::max_points_1d);
+            LOG(INFO) << "Tabulated drift time and diffusion width between "
+                      << Units::display(tabulated_range_[0], {"um", "mm"}) << " and "
+                      << Units::display(tabulated_range_[1], {"um", "mm"}) << " with " << drift_time_table_.getSize()[0]
+                      << " and " << diffusion_table_.getSize()[0] << " points, maximum deviation "
+                      << std::max(drift_time_table_.getPrecision(), diffusion_table_.getPrecision());
+        } else {
+            LOG(WARNING) << "No electric field found across the sensor thickness, drift time is not tabulated";
+            tabulate_drift_ = false;
+        }
+    }
+
     if(output_plots_) {
         // Initialize output plots
         propagation_time_histo_ =
@@ -318,26 +378,13 @@ void ProjectionPropagationModule::run(Event* event) {
             LOG(TRACE) << "Electric field at carrier position / top of the sensor: "
                        << Units::display(efield_mag_top, "V/cm") << " , " << Units::display(efield_mag, "V/cm");
 
-            auto slope_efield = (efield_mag_top - efield_mag) / (std::abs(top_z_ - position.z()));
-
-            // Calculate the drift time
-            auto calc_drift_time = [&]() {
-                if(position.z() == top_z_) {
-                    return 0.;
-                }
-
-                double Ec = (type == CarrierType::ELECTRON ? electron_Ec_ : hole_Ec_);
-
-                return ((log(efield_mag_top) - log(efield_mag)) / slope_efield + std::abs(top_z_ - position.z()) / Ec) /
-                       (*mobility_)(type, 0, doping);
-            };
-            LOG(TRACE) << "Electric field is " << Units::display(efield_mag, "V/cm");
-
-            // Assume linear electric field over the depleted part of the sensor
-            double diffusion_constant =
-                boltzmann_kT_ * ((*mobility_)(type, efield_mag, doping) + (*mobility_)(type, efield_mag_top, doping)) / 2.;
-
-            double drift_time = calc_drift_time();
+            double drift_time = 0, diffusion_std_dev = 0;
+            if(tabulate_drift_ && position.z() >= tabulated_range_[0] && position.z() <= tabulated_range_[1]) {
+                drift_time = drift_time_table_(position.z());
+                diffusion_std_dev = diffusion_table_(position.z());
+            } else {
+                std::tie(drift_time, diffusion_std_dev) = drift_diffusion(efield_mag, efield_mag_top, doping, position.z());
+            }
             double propagation_time = drift_time + diffusion_time;
             LOG(TRACE) << "Drift time is " << Units::display(drift_time, "ns");
 
@@ -349,7 +396,6 @@ void ProjectionPropagationModule::run(Event* event) {
                 }
             }
 
-            double diffusion_std_dev = std::sqrt(2. * diffusion_constant * drift_time);
             LOG(TRACE) << "Diffusion width is " << Units::display(diffusion_std_dev, "um");
 
             // Check if charge carrier is still alive via its survival probability, evaluated once
@@ -362,6 +408,45 @@ void ProjectionPropagationModule::run(Event* event) {
                 continue;
             }
 
+            auto global_time = deposit.getGlobalTime() + propagation_time;
+            auto local_time = deposit.getLocalTime() + propagation_time;
+
+            // Distribute the charge carriers over the pixels instead of sampling a common diffusion
+            if(pixel_integration_) {
+                if(local_time > integration_time_) {
+                    LOG(DEBUG) << "Charge carriers propagation time not within integration time: "
+                               << Units::display(global_time, "ns") << " global / "
+                               << Units::display(local_time, {"ns", "ps"}) << " local";
+                    continue;
+                }
+
+                if(output_linegraphs_) {
+                    output_plot_points.back().second.emplace_back(position.x(), position.y(), top_z_);
+                }
+                if(output_plots_) {
+                    initial_position_histo_->Fill(initial_position.z() / units::um, charge_per_step);
+                    group_size_histo_->Fill(charge_per_step);
+                }
+
+                for(const auto& [pixel_position, charge] :
+                    integrate_pixels(event->getRandomEngine(), position, diffusion_std_dev, charge_per_step)) {
+                    propagated_charges.emplace_back(pixel_position,
+                                                    detector_->getGlobalPosition(pixel_position),
+                                                    deposit.getType(),
+                                                    charge,
+                                                    local_time,
+                                                    global_time,
+                                                    CarrierState::HALTED,
+                                                    &deposit);
+                    LOG(DEBUG) << "Propagated " << charge << " " << type << " to "
+                               << Units::display(pixel_position, {"mm", "um"}) << " in "
+                               << Units::display(global_time, "ns") << " global / "
+                               << Units::display(local_time, {"ns", "ps"}) << " local";
+                    projected_charge += charge;
+                }
+                continue;
+            }
+
             allpix::normal_distribution<double> gauss_distribution(0, diffusion_std_dev);
             double diffusion_x = gauss_distribution(event->getRandomEngine());
             double diffusion_y = gauss_distribution(event->getRandomEngine());
@@ -369,9 +454,6 @@ void ProjectionPropagationModule::run(Event* event) {
             // Find projected position
             auto local_position = ROOT::Math::XYZPoint(position.x() + diffusion_x, position.y() + diffusion_y, top_z_);
 
-            auto global_time = deposit.getGlobalTime() + propagation_time;
-            auto local_time = deposit.getLocalTime() + propagation_time;
-
             // Only add if within requested integration time:
             if(local_time > integration_time_) {
                 LOG(DEBUG) << "Charge carriers propagation time not within integration time: "
@@ -393,8 +475,7 @@ void ProjectionPropagationModule::run(Event* event) {
             }
 
             if(output_plots_) {
-                initial_position_histo_->Fill(static_cast<double>(Units::convert(initial_position.z(), "um")),
-                                              charge_per_step);
+                initial_position_histo_->Fill(initial_position.z() / units::um, charge_per_step);
                 group_size_histo_->Fill(charge_per_step);
             }
 
@@ -435,12 +516,93 @@ void ProjectionPropagationModule::run(Event* event) {
     }
 
     // Create a new message with propagated charges
-    auto propagated_charge_message = std::make_shared<PropagatedChargeMessage>(std::move(propagated_charges), detector_);
+    auto propagated_charge_message = event->makeShared<PropagatedChargeMessage>(std::move(propagated_charges), detector_);
 
     // Dispatch the message with propagated charges
     messenger_->dispatchMessage(this, std::move(propagated_charge_message), event);
 }
 
+std::pair<double, double> ProjectionPropagationModule::drift_diffusion(double efield_mag,
+                                                                       double efield_mag_top,
+                                                                       double doping,
+                                                                       double z) const {
+    auto type = propagate_type_;
+    auto slope_efield = (efield_mag_top - efield_mag) / (std::abs(top_z_ - z));
+
+    // Calculate the drift time
+    auto calc_drift_time = [&]() {
+        if(z == top_z_) {
+            return 0.;
+        }
+
+        double Ec = (type == CarrierType::ELECTRON ? electron_Ec_ : hole_Ec_);
+
+        return ((log(efield_mag_top) - log(efield_mag)) / slope_efield + std::abs(top_z_ - z) / Ec) /
+               (*mobility_)(type, 0, doping);
+    };
+    LOG(TRACE) << "Electric field is " << Units::display(efield_mag, "V/cm");
+
+    // Assume linear electric field over the depleted part of the sensor
+    double diffusion_constant =
+        boltzmann_kT_ * ((*mobility_)(type, efield_mag, doping) + (*mobility_)(type, efield_mag_top, doping)) / 2.;
+
+    double drift_time = calc_drift_time();
+    return {drift_time, std::sqrt(2. * diffusion_constant * drift_time)};
+}
+
+/**
+ * The Gaussian diffusion is separable, such that the probability of a charge carrier to reach a pixel is the product of the
+ * differences of the error function at the pixel edges along x and y. The charge carriers diffuse independently, so their
+ * numbers per pixel follow a multinomial distribution, which is sampled as a sequence of binomial distributions over the
+ * pixels within five standard deviations. Charge carriers beyond these pixels or outside of the pixel matrix are lost.
+ */
+std::vector<std::pair<ROOT::Math::XYZPoint, unsigned int>>
+ProjectionPropagationModule::integrate_pixels(RandomNumberGenerator& random_generator,
+                                              const ROOT::Math::XYZPoint& position,
+                                              double diffusion_std_dev,
+                                              unsigned int charge) const {
+    auto pitch = model_->getPixelSize();
+    auto [xpixel, ypixel] = model_->getPixelIndex(position);
+    auto range_x = static_cast<int>(std::ceil(5 * diffusion_std_dev / pitch.x()));
+    auto range_y = static_cast<int>(std::ceil(5 * diffusion_std_dev / pitch.y()));
+
+    // Fraction of the charge carriers within the pixel at the given offset from the pixel of the position along one axis
+    auto fraction = [&](int offset, double center, double size, double start) {
+        auto low = center + (offset - 0.5) * size - start;
+        auto high = low + size;
+        if(diffusion_std_dev <= 0) {
+            return (low <= 0 && 0 < high ? 1. : 0.);
+        }
+        return (std::erf(high / (M_SQRT2 * diffusion_std_dev)) - std::erf(low / (M_SQRT2 * diffusion_std_dev))) / 2.;
+    };
+
+    std::vector<std::pair<ROOT::Math::XYZPoint, unsigned int>> pixel_charges;
+    auto center = model_->getPixelCenter(xpixel, ypixel);
+    auto remaining = charge;
+    double remaining_probability = 1.;
+    for(int dx = -range_x; dx <= range_x && remaining > 0; ++dx) {
+        auto fraction_x = fraction(dx, center.x(), pitch.x(), position.x());
+        for(int dy = -range_y; dy <= range_y && remaining > 0; ++dy) {
+            auto probability = fraction_x * fraction(dy, center.y(), pitch.y(), position.y());
+            if(probability <= 0 || remaining_probability <= 0) {
+                continue;
+            }
+
+            allpix::binomial_distribution<int> binomial(static_cast<int>(remaining),
+                                                        std::min(1., probability / remaining_probability));
+            auto collected = static_cast<unsigned int>(binomial(random_generator));
+            remaining -= collected;
+            remaining_probability -= probability;
+
+            if(collected > 0 && model_->isWithinMatrix(xpixel + dx, ypixel + dy)) {
+                auto pixel_center = model_->getPixelCenter(xpixel + dx, ypixel + dy);
+                pixel_charges.emplace_back(ROOT::Math::XYZPoint(pixel_center.x(), pixel_center.y(), top_z_), collected);
+            }
+        }
+    }
+    return pixel_charges;
+}
+
 void ProjectionPropagationModule::finalize() {
     if(output_plots_) {
         group_size_histo_->Get()->GetXaxis()->SetRange(1, group_size_histo_->Get()->GetNbinsX() + 1);
@@ -31,6 +31,7 @@
 
 #include "tools/ROOT.h"
 #include "tools/line_graphs.h"
+#include "tools/tabulated_function.h"
 
 namespace allpix {
     /**
@@ -68,6 +69,29 @@ namespace allpix {
 
     private:
         Messenger* messenger_;
+
+        /**
+         * @brief Calculate the drift time to the top of the sensor and the width of the diffusion during the drift
+         * @param efield_mag Magnitude of the electric field at the position of the charge carriers
+         * @param efield_mag_top Magnitude of the electric field at the top of the sensor
+         * @param doping Doping concentration at the position of the charge carriers
+         * @param z Depth of the charge carriers
+         * @return Drift time and standard deviation of the lateral diffusion
+         */
+        std::pair<double, double> drift_diffusion(double efield_mag, double efield_mag_top, double doping, double z) const;
+
+        /**
+         * @brief Distribute a set of charge carriers over the pixels using the integral of the diffusion over every pixel
+         * @param random_generator Reference to the random number engine
+         * @param position Position of the charge carriers projected onto the top of the sensor before diffusion
+         * @param diffusion_std_dev Standard deviation of the lateral diffusion
+         * @param charge Number of charge carriers
+         * @return Pixel centers and number of charge carriers collected there
+         */
+        std::vector<std::pair<ROOT::Math::XYZPoint, unsigned int>> integrate_pixels(RandomNumberGenerator& random_generator,
+                                                                                  const ROOT::Math::XYZPoint& position,
+                                                                                  double diffusion_std_dev,
+                                                                                  unsigned int charge) const;
         std::shared_ptr<const Detector> detector_;
         std::shared_ptr<DetectorModel> model_;
 
@@ -77,6 +101,12 @@ namespace allpix {
         bool diffuse_deposit_;
         unsigned int charge_per_step_{};
         unsigned int max_charge_groups_{};
+        bool pixel_integration_{};
+
+        // Drift time and diffusion width tabulated over the depleted depth range
+        bool tabulate_drift_{};
+        std::array<double, 2> tabulated_range_{};
+        TabulatedFunction drift_time_table_, diffusion_table_;
 
         // Carrier type to be propagated
         CarrierType propagate_type_;
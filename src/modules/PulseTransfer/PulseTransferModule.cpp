@@ -12,18 +12,33 @@
 #include "PulseTransferModule.hpp"
 #include "core/module/Event.hpp"
 #include "core/utils/log.h"
+#include "core/utils/unit_constants.h"
 #include "objects/PixelCharge.hpp"
 #include "objects/exceptions.h"
 
-#include <set>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
 #include <string>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include <TAxis.h>
 #include <TGraph.h>
 
 using namespace allpix;
 
+namespace {
+    // Pulse of a pixel together with the indices of the propagated charges contributing to it
+    struct PixelPulseBuffer {
+        Pixel::Index index;
+        Pulse pulse;
+        std::vector<size_t> charges;
+    };
+} // namespace
+
 PulseTransferModule::PulseTransferModule(Configuration& config, Messenger* messenger, std::shared_ptr<Detector> detector)
     : Module(config, detector), messenger_(messenger), detector_(std::move(detector)) {
 
@@ -52,6 +67,9 @@ PulseTransferModule::PulseTransferModule(Configuration& config, Messenger* messe
     }
 
     messenger_->bindSingle<PropagatedChargeMessage>(this, MsgFlags::REQUIRED);
+
+    // Declare the messages dispatched by this module
+    declare_output<PixelChargeMessage>();
 }
 
 void PulseTransferModule::initialize() {
@@ -94,13 +112,30 @@ void PulseTransferModule::initialize() {
 void PulseTransferModule::run(Event* event) {
     auto propagated_message = messenger_->fetchMessage<PropagatedChargeMessage>(this, event);
 
-    // Create map for all pixels: pulse and propagated charges
-    std::map<Pixel::Index, Pulse> pixel_pulse_map;
-    std::map<Pixel::Index, std::set<const PropagatedCharge*>> pixel_charge_map;
+    const auto& propagated_charges = propagated_message->getData();
+
+    // Dense buffer for the pulses of all pixels receiving charge in this event, indexed by their pixel index
+    std::vector<PixelPulseBuffer> pixel_buffers;
+    std::unordered_map<uint64_t, size_t> pixel_slots;
+    auto get_pixel_buffer = [&](const Pixel::Index& index, size_t charge) -> PixelPulseBuffer& {
+        auto key = (static_cast<uint64_t>(static_cast<uint32_t>(index.x())) << 32) | static_cast<uint32_t>(index.y());
+        auto [slot, inserted] = pixel_slots.try_emplace(key, pixel_buffers.size());
+        if(inserted) {
+            pixel_buffers.push_back({index, Pulse(), {}});
+        }
+        auto& buffer = pixel_buffers[slot->second];
+
+        // For each pulse, store the index of the corresponding propagated charges to preserve history:
+        if(buffer.charges.empty() || buffer.charges.back() != charge) {
+            buffer.charges.push_back(charge);
+        }
+        return buffer;
+    };
 
-    LOG(DEBUG) << "Received " << propagated_message->getData().size() << " propagated charge objects.";
-    for(const auto& propagated_charge : propagated_message->getData()) {
-        auto pulses = propagated_charge.getPulses();
+    LOG(DEBUG) << "Received " << propagated_charges.size() << " propagated charge objects.";
+    for(size_t charge_index = 0; charge_index < propagated_charges.size(); ++charge_index) {
+        const auto& propagated_charge = propagated_charges[charge_index];
+        const auto& pulses = propagated_charge.getPulses();
 
         if(pulses.empty()) {
             LOG_ONCE(INFO) << "No pulse information available - producing pseudo-pulse from arrival time of charge carriers";
@@ -151,8 +186,11 @@ void PulseTransferModule::run(Event* event) {
 
             Pixel::Index pixel_index(xpixel, ypixel);
 
-            // Generate pseudo-pulse:
-            Pulse pulse(timestep_);
+            // Add the charge as pseudo-pulse directly to the pulse of the pixel:
+            auto& pulse = get_pixel_buffer(pixel_index, charge_index).pulse;
+            if(!pulse.isInitialized()) {
+                pulse = Pulse(timestep_);
+            }
             try {
                 pulse.addCharge(static_cast<double>(propagated_charge.getSign() * propagated_charge.getCharge()),
                                 propagated_charge.getLocalTime());
@@ -161,32 +199,28 @@ void PulseTransferModule::run(Event* event) {
                            << "Ignoring pulse contribution at time "
                            << Units::display(propagated_charge.getLocalTime(), {"ms", "us", "ns"});
             }
-            pixel_pulse_map[pixel_index] += pulse;
-
-            // For each pulse, store the corresponding propagated charges to preserve history:
-            pixel_charge_map[pixel_index].emplace(&propagated_charge);
         } else {
             LOG(TRACE) << "Found pulse information";
             LOG_ONCE(INFO) << "Pulses available - settings \"timestep\", \"max_depth_distance\" and "
                               "\"collect_from_implant\" have no effect";
 
-            for(auto& [pixel_index, pulse] : pulses) {
+            for(const auto& [pixel_index, pulse] : pulses) {
                 // Accumulate all pulses from input message data:
-                pixel_pulse_map[pixel_index] += pulse;
-
-                // For each pulse, store the corresponding propagated charges to preserve history:
-                pixel_charge_map[pixel_index].emplace(&propagated_charge);
+                get_pixel_buffer(pixel_index, charge_index).pulse += pulse;
             }
         }
     }
 
-    // Create vector of pixel pulses to return for this detector
+    // Create vector of pixel pulses to return for this detector, ordered by their pixel index
+    std::sort(pixel_buffers.begin(), pixel_buffers.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.index < rhs.index;
+    });
     std::vector<PixelCharge> pixel_charges;
-    pixel_charges.reserve(pixel_pulse_map.size());
-    Pulse total_pulse;
-    for(auto& [index, pulse] : pixel_pulse_map) {
+    pixel_charges.reserve(pixel_buffers.size());
+    double total_charge = 0;
+    for(auto& [index, pulse, charges] : pixel_buffers) {
         // Sum all pulses for informational output:
-        total_pulse += pulse;
+        total_charge += std::accumulate(pulse.begin(), pulse.end(), 0.0);
 
         // Fill pixel charge histogram
         if(output_plots_) {
@@ -212,8 +246,11 @@ void PulseTransferModule::run(Event* event) {
         }
 
         // Store the pulse:
-        std::vector<const PropagatedCharge*> pixel_charge_vec(pixel_charge_map[index].begin(),
-                                                              pixel_charge_map[index].end());
+        std::vector<const PropagatedCharge*> pixel_charge_vec;
+        pixel_charge_vec.reserve(charges.size());
+        for(auto charge : charges) {
+            pixel_charge_vec.push_back(&propagated_charges[charge]);
+        }
         LOG(DEBUG) << "Charge on pixel " << index << " has " << pixel_charge_vec.size() << " ancestors";
         pixel_charges.emplace_back(detector_->getPixel(index), std::move(pulse), std::move(pixel_charge_vec));
     }
@@ -232,22 +269,24 @@ void PulseTransferModule::run(Event* event) {
                                     -0.5,
                                     static_cast<int>(size.y()) - 0.5);
 
-        for(auto& [index, pulse] : pixel_pulse_map) {
-            charge_map->Fill(index.x(), index.y(), pulse.getCharge());
+        for(const auto& pixel_charge : pixel_charges) {
+            auto index = pixel_charge.getIndex();
+            charge_map->Fill(index.x(), index.y(), static_cast<double>(pixel_charge.getCharge()));
         }
         getROOTDirectory()->WriteTObject(charge_map, name.c_str());
     }
 
     // Create a new message with pixel pulses and dispatch:
-    auto pixel_charge_message = std::make_shared<PixelChargeMessage>(std::move(pixel_charges), detector_);
+    auto pixel_charge_message = event->makeShared<PixelChargeMessage>(std::move(pixel_charges), detector_);
     messenger_->dispatchMessage(this, pixel_charge_message, event);
 
     // Fill pixel charge histogram
     if(output_plots_) {
-        h_total_induced_charge_->Fill(total_pulse.getCharge() / 1e3);
+        h_total_induced_charge_->Fill(static_cast<int>(std::lround(total_charge)) / 1e3);
     }
 
-    LOG(INFO) << "Total charge induced on all pixels: " << Units::display(total_pulse.getCharge(), "e");
+    LOG(INFO) << "Total charge induced on all pixels: "
+              << Units::display(static_cast<int>(std::lround(total_charge)), "e");
 }
 
 void PulseTransferModule::finalize() {
@@ -301,9 +340,7 @@ void PulseTransferModule::create_pulsegraphs(uint64_t event_num, const Pixel::In
 
     auto current_vec = pulse;
     // Convert charge bins to current in uA
-    std::for_each(current_vec.begin(), current_vec.end(), [step](auto& bin) {
-        bin = static_cast<double>(Units::convert(bin, "fC") / Units::convert(step, "ns"));
-    });
+    std::for_each(current_vec.begin(), current_vec.end(), [step](auto& bin) { bin = bin / units::fC / (step / units::ns); });
 
     // Generate graphs of induced current over time:
     name = "current_ev" + std::to_string(event_num) + "_px" + std::to_string(index.x()) + "-" + std::to_string(index.y());
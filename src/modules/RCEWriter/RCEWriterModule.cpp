@@ -363,7 +363,7 @@ void RCEWriterModule::initialize() {
 }
 
 void RCEWriterModule::run(Event* event) {
-    auto pixel_hit_messages = messenger_->fetchMultiMessage<PixelHitMessage>(this, event);
+    auto pixel_hit_messages = messenger_->fetchMultiMessageView<PixelHitMessage>(this, event);
 
     // fill per-event data
     timestamp_ = 0;
@@ -382,11 +382,11 @@ void RCEWriterModule::run(Event* event) {
 
     // Loop over the pixel hit messages
     for(const auto& hit_msg : pixel_hit_messages) {
-        const auto& detector_name = hit_msg->getDetector()->getName();
+        const auto& detector_name = hit_msg.getDetector()->getName();
         auto& sensor = sensors_[detector_name];
 
         // Loop over all the hits
-        for(const auto& hit : hit_msg->getData()) {
+        for(const auto& hit : hit_msg.getData()) {
             if(sensor_data::kMaxHits <= sensor.nhits_) {
                 LOG(ERROR) << "More than " << sensor_data::kMaxHits << " in detector " << detector_name;
                 continue;
@@ -0,0 +1,164 @@
+/**
+ * @file
+ * @brief Implementation of RNTuple data file reader module
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "RNTupleObjectReaderModule.hpp"
+
+#include <algorithm>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include <ROOT/RNTupleDescriptor.hxx>
+#include <ROOT/RNTupleView.hxx>
+
+#include "core/config/exceptions.h"
+#include "core/module/exceptions.h"
+#include "core/utils/log.h"
+
+using namespace allpix;
+
+RNTupleObjectReaderModule::RNTupleObjectReaderModule(Configuration& config,
+                                                     Messenger* messenger,
+                                                     GeometryManager* geo_mgr)
+    : Module(config), messenger_(messenger), geo_mgr_(geo_mgr) {
+    // Enable multithreading of this module if multithreading is enabled
+    allow_multithreading();
+}
+
+void RNTupleObjectReaderModule::initialize() {
+    // Read include and exclude list
+    if(config_.has("include") && config_.has("exclude")) {
+        throw InvalidCombinationError(
+            config_, {"exclude", "include"}, "include and exclude parameter are mutually exclusive");
+    } else if(config_.has("include")) {
+        auto inc_arr = config_.getArray<std::string>("include");
+        include_.insert(inc_arr.begin(), inc_arr.end());
+    } else if(config_.has("exclude")) {
+        auto exc_arr = config_.getArray<std::string>("exclude");
+        exclude_.insert(exc_arr.begin(), exc_arr.end());
+    }
+
+    // Open the file with the objects
+    auto input_file_name = config_.getPathWithExtension("file_name", "root", true);
+    try {
+        reader_ = ROOT::RNTupleReader::Open(config_.get<std::string>("ntuple_name", "Events"), input_file_name);
+    } catch(const std::exception& e) {
+        throw InvalidValueError(config_, "file_name", "cannot read RNTuple: " + std::string(e.what()));
+    }
+
+    // Collect the column names of every object type
+    std::vector<std::pair<std::string, std::string>> type_columns;
+    FlatEvent({""}, {nullptr}).visit([&](const std::string& type_name, size_t, const std::string& column_name, auto&) {
+        type_columns.emplace_back(type_name, column_name);
+    });
+
+    // Find the detectors in the order of their fields, which is identical for all object types
+    for(const auto& field : reader_->GetDescriptor().GetTopLevelFields()) {
+        const auto& field_name = field.GetFieldName();
+        field_names_.insert(field_name);
+        for(const auto& [type_name, column_name] : type_columns) {
+            auto prefix = type_name + "_";
+            auto suffix = "_" + column_name;
+            if(field_name.size() <= prefix.size() + suffix.size() || field_name.compare(0, prefix.size(), prefix) != 0 ||
+               field_name.compare(field_name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+                continue;
+            }
+            auto detector_name = field_name.substr(prefix.size(), field_name.size() - prefix.size() - suffix.size());
+            if(std::find(detector_names_.begin(), detector_names_.end(), detector_name) == detector_names_.end()) {
+                detector_names_.push_back(detector_name);
+            }
+            break;
+        }
+    }
+    for(const auto& detector_name : detector_names_) {
+        if(detector_name == "global") {
+            detectors_.emplace_back();
+        } else if(geo_mgr_->hasDetector(detector_name)) {
+            detectors_.push_back(geo_mgr_->getDetector(detector_name));
+        } else {
+            LOG(WARNING) << "Detector " << detector_name << " of the input file is not part of the geometry, ignoring its "
+                         << "objects";
+            detectors_.emplace_back();
+        }
+    }
+    if(detector_names_.empty()) {
+        LOG(ERROR) << "Provided RNTuple does not contain any objects, module will not read any data";
+    }
+
+    // Index the entries of all events, which are not ordered for files written by multiple threads
+    if(field_names_.find("event") == field_names_.end()) {
+        throw InvalidValueError(config_, "file_name", "RNTuple does not contain the event numbers");
+    }
+    auto event_view = reader_->GetView<std::uint64_t>("event");
+    for(auto entry : reader_->GetEntryRange()) {
+        auto event = event_view(entry);
+        entries_[event] = entry;
+        last_event_ = std::max(last_event_, event);
+    }
+    LOG(INFO) << "Opened RNTuple with " << entries_.size() << " events of " << detector_names_.size() << " detectors";
+}
+
+RNTupleObjectReaderModule::ThreadInput& RNTupleObjectReaderModule::get_thread_input() {
+    auto& input = thread_inputs_[std::this_thread::get_id()];
+    if(input == nullptr) {
+        input = std::make_unique<ThreadInput>();
+        input->columns = std::make_unique<FlatEvent>(detector_names_, detectors_);
+
+        // Read only the fields of included object types into the columns of this thread
+        input->columns->visit(
+            [&](const std::string& type_name, size_t detector, const std::string& column_name, auto& column) {
+                auto field_name = FlatEvent::getColumnName(type_name, detector_names_[detector], column_name);
+                if((!include_.empty() && include_.find(type_name) == include_.end()) ||
+                   exclude_.find(type_name) != exclude_.end() || field_names_.find(field_name) == field_names_.end()) {
+                    return;
+                }
+                using C = std::decay_t<decltype(column)>;
+                auto view = std::make_shared<ROOT::RNTupleView<C>>(reader_->GetView<C>(field_name));
+                input->readers.emplace_back([view, &column](ROOT::NTupleSize_t entry) { column = (*view)(entry); });
+            });
+        LOG(DEBUG) << "Reading " << input->readers.size() << " fields for thread " << std::this_thread::get_id();
+    }
+    return *input;
+}
+
+void RNTupleObjectReaderModule::run(Event* event) {
+    if(event->number > last_event_) {
+        throw EndOfRunException("Requesting end of run because RNTuple only contains data for " +
+                                std::to_string(last_event_) + " events");
+    }
+    auto entry = entries_.find(event->number);
+    if(entry == entries_.end()) {
+        throw EndOfRunException("Requesting end of run because RNTuple does not contain data for event " +
+                                std::to_string(event->number));
+    }
+
+    // Only reading the fields is serialized, the objects are restored concurrently
+    std::unique_lock<std::mutex> lock(reader_mutex_);
+    auto& input = get_thread_input();
+    for(auto& reader : input.readers) {
+        reader(entry->second);
+    }
+    lock.unlock();
+
+    LOG(TRACE) << "Building messages from stored objects";
+    auto messages = input.columns->build();
+    input.columns->clear();
+
+    for(auto& message : messages) {
+        read_cnt_ += message->getObjectArray().size();
+        messenger_->dispatchMessage(this, message, event);
+    }
+}
+
+void RNTupleObjectReaderModule::finalize() {
+    // Print statistics
+    LOG(INFO) << "Read " << read_cnt_ << " objects from " << field_names_.size() << " fields";
+}
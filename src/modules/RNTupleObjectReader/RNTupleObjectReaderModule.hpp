@@ -0,0 +1,106 @@
+/**
+ * @file
+ * @brief Definition of RNTuple data file reader module
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <ROOT/RNTupleReader.hxx>
+
+#include "core/config/Configuration.hpp"
+#include "core/geometry/GeometryManager.hpp"
+#include "core/messenger/Messenger.hpp"
+#include "core/module/Event.hpp"
+#include "core/module/Module.hpp"
+
+#include "tools/flat_objects.h"
+
+namespace allpix {
+    /**
+     * @ingroup Modules
+     * @brief Module to read data stored in an RNTuple back to allpix messages
+     * @note This module supports multithreading
+     *
+     * Reads the fields in the data format of the \ref RNTupleObjectWriterModule. Only the fields of the included object
+     * types are read. The objects and the relations between them are restored and dispatched as messages.
+     */
+    class RNTupleObjectReaderModule : public Module {
+    public:
+        /**
+         * @brief Constructor for this unique module
+         * @param config Configuration object for this module as retrieved from the steering file
+         * @param messenger Pointer to the messenger object to allow binding to messages on the bus
+         * @param geo_mgr Pointer to the geometry manager, containing the detectors
+         */
+        RNTupleObjectReaderModule(Configuration& config, Messenger* messenger, GeometryManager* geo_mgr);
+
+        /**
+         * @brief Open the file containing the stored output data and index its events
+         */
+        void initialize() override;
+
+        /**
+         * @brief Read the fields of the current event and dispatch the restored objects as messages
+         */
+        void run(Event*) override;
+
+        /**
+         * @brief Output summary
+         */
+        void finalize() override;
+
+    private:
+        /**
+         * @brief Columns and field readers of a single thread
+         */
+        struct ThreadInput {
+            std::unique_ptr<FlatEvent> columns;
+            std::vector<std::function<void(ROOT::NTupleSize_t)>> readers;
+        };
+
+        /**
+         * @brief Get the input of the calling thread, creating it for the first event of the thread
+         * @warning Requires the reader mutex to be held
+         */
+        ThreadInput& get_thread_input();
+
+        Messenger* messenger_;
+        GeometryManager* geo_mgr_;
+
+        // Object names to include or exclude from reading
+        std::set<std::string> include_;
+        std::set<std::string> exclude_;
+
+        // Names and detectors of the columns in the file
+        std::vector<std::string> detector_names_;
+        std::vector<std::shared_ptr<const Detector>> detectors_;
+        std::set<std::string> field_names_;
+
+        // Reader of the file and the entry of every event number
+        std::mutex reader_mutex_;
+        std::unique_ptr<ROOT::RNTupleReader> reader_;
+        std::unordered_map<std::uint64_t, ROOT::NTupleSize_t> entries_;
+        std::uint64_t last_event_{};
+
+        // Inputs of every worker thread
+        std::map<std::thread::id, std::unique_ptr<ThreadInput>> thread_inputs_;
+
+        // Statistics for total amount of objects read
+        std::atomic<unsigned long> read_cnt_{};
+    };
+} // namespace allpix
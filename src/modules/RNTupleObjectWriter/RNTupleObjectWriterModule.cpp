@@ -0,0 +1,179 @@
+/**
+ * @file
+ * @brief Implementation of RNTuple data file writer module
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "RNTupleObjectWriterModule.hpp"
+
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <ROOT/RField.hxx>
+#include <ROOT/RNTupleModel.hxx>
+#include <ROOT/RNTupleWriteOptions.hxx>
+
+#include "core/config/exceptions.h"
+#include "core/messenger/exceptions.h"
+#include "core/module/exceptions.h"
+#include "core/utils/log.h"
+#include "core/utils/type.h"
+
+using namespace allpix;
+
+RNTupleObjectWriterModule::RNTupleObjectWriterModule(Configuration& config,
+                                                     Messenger* messenger,
+                                                     GeometryManager* geo_mgr)
+    : Module(config), messenger_(messenger), geo_mgr_(geo_mgr) {
+    // Enable multithreading of this module if multithreading is enabled
+    allow_multithreading();
+
+    config_.setDefault<std::string>("file_name", "data");
+
+    // Bind to all messages with filter
+    messenger_->registerFilter(this, &RNTupleObjectWriterModule::filter);
+}
+
+void RNTupleObjectWriterModule::initialize() {
+    // Read include and exclude list
+    if(config_.has("include") && config_.has("exclude")) {
+        throw InvalidCombinationError(
+            config_, {"exclude", "include"}, "include and exclude parameter are mutually exclusive");
+    } else if(config_.has("include")) {
+        auto inc_arr = config_.getArray<std::string>("include");
+        include_.insert(inc_arr.begin(), inc_arr.end());
+    } else if(config_.has("exclude")) {
+        auto exc_arr = config_.getArray<std::string>("exclude");
+        exclude_.insert(exc_arr.begin(), exc_arr.end());
+    }
+
+    // All fields have to be known before writing, create columns for all detectors and objects without detector
+    detector_names_.emplace_back("global");
+    detectors_.emplace_back();
+    for(const auto& detector : geo_mgr_->getDetectors()) {
+        detector_names_.push_back(detector->getName());
+        detectors_.push_back(detector);
+    }
+
+    auto model = ROOT::RNTupleModel::CreateBare();
+    model->AddField(std::make_unique<ROOT::RField<std::uint64_t>>("event"));
+    model->AddField(std::make_unique<ROOT::RField<std::uint64_t>>("seed"));
+    size_t field_count = 0;
+    FlatEvent columns(detector_names_, detectors_);
+    columns.visit([&](const std::string& type_name, size_t detector, const std::string& column_name, auto& column) {
+        if(!is_included(type_name)) {
+            return;
+        }
+        using C = std::decay_t<decltype(column)>;
+        model->AddField(std::make_unique<ROOT::RField<C>>(
+            FlatEvent::getColumnName(type_name, detector_names_[detector], column_name)));
+        ++field_count;
+    });
+    LOG(DEBUG) << "Created " << field_count << " fields for objects of " << detector_names_.size() << " detectors";
+
+    // Create output file
+    output_file_name_ = createOutputFile(config_.get<std::string>("file_name"), "root", true);
+    ROOT::RNTupleWriteOptions options;
+    if(config_.has("compression")) {
+        options.SetCompression(config_.get<std::uint32_t>("compression"));
+    }
+    try {
+        writer_ = ROOT::Experimental::RNTupleParallelWriter::Recreate(
+            std::move(model), config_.get<std::string>("ntuple_name", "Events"), output_file_name_, options);
+    } catch(const std::exception& e) {
+        throw InvalidValueError(config_, "file_name", "cannot create RNTuple: " + std::string(e.what()));
+    }
+}
+
+bool RNTupleObjectWriterModule::is_included(const std::string& type_name) const {
+    return (include_.empty() || include_.find(type_name) != include_.end()) && exclude_.find(type_name) == exclude_.end();
+}
+
+bool RNTupleObjectWriterModule::filter(const std::shared_ptr<BaseMessage>& message,
+                                       const std::string& message_name) const { // NOLINT
+    try {
+        auto object_array = message->getObjectArray();
+        if(object_array.empty()) {
+            return false;
+        }
+        const Object& first_object = object_array[0];
+        std::string class_name = allpix::demangle(typeid(first_object).name());
+
+        // Check if this message should be kept
+        if(!is_included(class_name)) {
+            LOG(TRACE) << "RNTuple object writer ignored message with object " << class_name
+                       << " because it has been excluded or not explicitly included";
+            return false;
+        }
+    } catch(MessageWithoutObjectException& e) {
+        const BaseMessage* inst = message.get();
+        LOG(WARNING) << "RNTuple object writer cannot process message of type" << allpix::demangle(typeid(*inst).name())
+                     << " with name " << message_name;
+        return false;
+    }
+
+    return true;
+}
+
+RNTupleObjectWriterModule::ThreadOutput& RNTupleObjectWriterModule::get_thread_output() {
+    std::lock_guard<std::mutex> lock(thread_outputs_mutex_);
+    auto& output = thread_outputs_[std::this_thread::get_id()];
+    if(output == nullptr) {
+        LOG(DEBUG) << "Creating fill context for thread " << std::this_thread::get_id();
+        output = std::make_unique<ThreadOutput>();
+        output->context = writer_->CreateFillContext();
+        output->entry = output->context->CreateEntry();
+        output->columns = std::make_unique<FlatEvent>(detector_names_, detectors_);
+
+        // Bind the columns of this thread to the fields of its entry
+        output->entry->BindRawPtr("event", &output->event);
+        output->entry->BindRawPtr("seed", &output->seed);
+        output->columns->visit(
+            [&](const std::string& type_name, size_t detector, const std::string& column_name, auto& column) {
+                if(is_included(type_name)) {
+                    output->entry->BindRawPtr(FlatEvent::getColumnName(type_name, detector_names_[detector], column_name),
+                                              &column);
+                }
+            });
+    }
+    return *output;
+}
+
+void RNTupleObjectWriterModule::run(Event* event) {
+    auto& output = get_thread_output();
+
+    // Fetch filtered messages
+    std::vector<std::shared_ptr<BaseMessage>> messages;
+    for(auto& pair : messenger_->fetchFilteredMessages(this, event)) {
+        messages.push_back(std::move(pair.first));
+    }
+
+    output.event = event->number;
+    output.seed = event->getSeed();
+    auto objects = output.columns->fill(messages);
+    LOG(TRACE) << "Writing " << objects << " objects to entry";
+
+    // The entry is serialized and compressed concurrently with the other threads, only writing clusters is serialized
+    output.context->Fill(*output.entry);
+    output.columns->clear();
+
+    write_cnt_ += objects;
+    ++event_cnt_;
+}
+
+void RNTupleObjectWriterModule::finalize() {
+    // Destroy the fill contexts before the writer to write their remaining entries
+    thread_outputs_.clear();
+    writer_.reset();
+
+    // Print statistics
+    LOG(STATUS) << "Wrote " << write_cnt_ << " objects of " << event_cnt_ << " events to file:" << std::endl
+                << output_file_name_;
+}
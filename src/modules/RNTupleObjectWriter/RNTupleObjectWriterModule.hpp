@@ -0,0 +1,121 @@
+/**
+ * @file
+ * @brief Definition of RNTuple data file writer module
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+#include <ROOT/REntry.hxx>
+#include <ROOT/RNTupleFillContext.hxx>
+#include <ROOT/RNTupleParallelWriter.hxx>
+
+#include "core/config/Configuration.hpp"
+#include "core/geometry/GeometryManager.hpp"
+#include "core/messenger/Messenger.hpp"
+#include "core/module/Event.hpp"
+#include "core/module/Module.hpp"
+
+#include "tools/flat_objects.h"
+
+namespace allpix {
+    /**
+     * @ingroup Modules
+     * @brief Module to write object data to an RNTuple in file for persistent storage
+     * @note This module supports multithreading
+     *
+     * Listens to all objects dispatched in the framework and stores them as flat columns of fundamental types, with a
+     * separate set of fields for every combination of object type and detector. Relations between objects are stored as
+     * indices among the objects of the related type in the event. Every worker thread fills its own entries, which are
+     * compressed in parallel and written to the file in clusters.
+     */
+    class RNTupleObjectWriterModule : public Module {
+    public:
+        /**
+         * @brief Constructor for this unique module
+         * @param config Configuration object for this module as retrieved from the steering file
+         * @param messenger Pointer to the messenger object to allow binding to messages on the bus
+         * @param geo_mgr Pointer to the geometry manager, containing the detectors
+         */
+        RNTupleObjectWriterModule(Configuration& config, Messenger* messenger, GeometryManager* geo_mgr);
+
+        /**
+         * @brief Receive a single message containing objects of arbitrary type
+         * @param message Message dispatched in the framework
+         * @param name Name of the message
+         */
+        bool filter(const std::shared_ptr<BaseMessage>& message, const std::string& name) const;
+
+        /**
+         * @brief Create the fields of all object types and detectors and open the file to write the objects to
+         */
+        void initialize() override;
+
+        /**
+         * @brief Write the objects of the event to the fields bound to the calling thread
+         */
+        void run(Event* event) override;
+
+        /**
+         * @brief Write the remaining entries of all threads and close the file
+         */
+        void finalize() override;
+
+    private:
+        /**
+         * @brief Entry and columns filled by a single thread
+         */
+        struct ThreadOutput {
+            std::shared_ptr<ROOT::Experimental::RNTupleFillContext> context;
+            std::unique_ptr<ROOT::REntry> entry;
+            std::unique_ptr<FlatEvent> columns;
+            std::uint64_t event{};
+            std::uint64_t seed{};
+        };
+
+        /**
+         * @brief Get the output of the calling thread, creating it for the first event of the thread
+         */
+        ThreadOutput& get_thread_output();
+
+        /**
+         * @brief Check if objects of a type should be written
+         * @param type_name Name of the object type without namespace
+         */
+        bool is_included(const std::string& type_name) const;
+
+        Messenger* messenger_;
+        GeometryManager* geo_mgr_;
+
+        // Object names to include or exclude from writing
+        std::set<std::string> include_;
+        std::set<std::string> exclude_;
+
+        // Names and detectors of the columns, starting with the objects not bound to a detector
+        std::vector<std::string> detector_names_;
+        std::vector<std::shared_ptr<const Detector>> detectors_;
+
+        // Output data file to write
+        std::string output_file_name_{};
+        std::unique_ptr<ROOT::Experimental::RNTupleParallelWriter> writer_;
+
+        // Outputs of every worker thread
+        std::mutex thread_outputs_mutex_;
+        std::map<std::thread::id, std::unique_ptr<ThreadOutput>> thread_outputs_;
+
+        // Statistical information about number of objects
+        std::atomic<unsigned long> write_cnt_{};
+        std::atomic<unsigned long> event_cnt_{};
+    };
+} // namespace allpix
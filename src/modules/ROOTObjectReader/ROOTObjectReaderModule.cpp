@@ -11,7 +11,9 @@
 
 #include "ROOTObjectReaderModule.hpp"
 
+#include <algorithm>
 #include <climits>
+#include <future>
 #include <string>
 #include <utility>
 
@@ -19,7 +21,9 @@
 #include <TKey.h>
 #include <TObjArray.h>
 #include <TProcessID.h>
+#include <TROOT.h>
 #include <TTree.h>
+#include <TTreeIndex.h>
 
 #include "core/messenger/Messenger.hpp"
 #include "core/utils/log.h"
@@ -30,6 +34,7 @@
 #include "objects/objects.h"
 
 #include "tools/ROOT.h"
+#include "tools/input_files.h"
 
 using namespace allpix;
 
@@ -42,8 +47,8 @@ ROOTObjectReaderModule::ROOTObjectReaderModule(Configuration& config, Messenger*
 /**
  * @note Objects cannot be stored in smart pointers due to internal ROOT logic
  */
-ROOTObjectReaderModule::~ROOTObjectReaderModule() {
-    for(const auto& message_inf : message_info_array_) {
+ROOTObjectReaderModule::Input::~Input() {
+    for(const auto& message_inf : message_info_array) {
         delete message_inf.objects;
     }
 }
@@ -119,15 +124,125 @@ void ROOTObjectReaderModule::initialize() {
         exclude_.insert(exc_arr.begin(), exc_arr.end());
     }
 
+    // Read the list of detectors to read the objects of, objects not assigned to a detector are always read
+    if(config_.has("include_detectors")) {
+        auto det_arr = config_.getArray<std::string>("include_detectors");
+        include_detectors_.insert(det_arr.begin(), det_arr.end());
+    }
+
+    // Decompress the baskets of the branches in parallel
+    auto implicit_mt_threads = config_.get<unsigned int>("implicit_mt_threads", 0);
+    if(implicit_mt_threads > 0) {
+#ifdef R__USE_IMT
+        LOG(DEBUG) << "Enabling ROOT implicit multithreading with " << implicit_mt_threads << " threads";
+        ROOT::EnableImplicitMT(implicit_mt_threads);
+        implicit_mt_ = true;
+#else
+        throw InvalidValueError(config_, "implicit_mt_threads", "ROOT has been built without implicit multithreading");
+#endif
+    }
+
     // Initialize the call map from the tuple of available objects
     message_creator_map_ = gen_creator_map<allpix::OBJECTS>();
 
-    // Open the file with the objects
-    auto input_file_name = config_.getPathWithExtension("file_name", "root", true);
-    input_file_ = std::make_unique<TFile>(input_file_name.c_str());
+    // Read the settings of the tree cache, which are applied to the trees of every input
+    if(config_.has("cache_size")) {
+        cache_size_ = config_.get<Long64_t>("cache_size");
+        cache_learn_entries_ = config_.get<int>("cache_learn_entries", 10);
+    }
+
+    // Open all files with the objects in parallel
+    input_files_ = get_input_files(config_, "file_name", "root");
+    for(size_t n = 0; n < input_files_.size(); ++n) {
+        inputs_.push_back(std::make_unique<Input>());
+    }
+    std::vector<std::future<void>> openings;
+    for(size_t n = 0; n < input_files_.size(); ++n) {
+        openings.push_back(std::async(std::launch::async, [this, n]() { open_trees(*inputs_[n], input_files_[n]); }));
+    }
+    for(auto& opening : openings) {
+        opening.get();
+    }
+
+    // Cross-check the core random seed stored in the files with the one configured:
+    auto& global_config = getConfigManager()->getGlobalConfiguration();
+    auto config_seed = global_config.get<uint64_t>("random_seed_core");
+    for(const auto& input : inputs_) {
+        if(input->trees.empty()) {
+            LOG(ERROR) << "Provided ROOT file does not contain any trees, module will not read any data";
+        }
+
+        std::string* str = nullptr;
+        input->file->GetObject("config/Allpix/random_seed_core", str);
+
+        if(str == nullptr) {
+            // check if missing random seed core in config file should be ignored
+            if(config_.get<bool>("ignore_seed_mismatch", false)) {
+                LOG(WARNING) << "No random seed for core set in the input data file, cross-check with configured value - "
+                             << "this might lead to unexpected behavior. Random seed core from the input data is used.";
+            } else {
+                throw InvalidValueError(global_config,
+                                        "random_seed_core",
+                                        "no random seed for core set in the input data file, cross-check with configured "
+                                        "value impossible - this might lead to unexpected behavior.");
+            }
+        } else if(config_seed != allpix::from_string<uint64_t>(*str)) {
+            // check if mismatch between random seed core in config and in input file should be ignored
+            if(config_.get<bool>("ignore_seed_mismatch", false)) {
+                LOG(WARNING) << "Mismatch between core random seed in configuration file and input data"
+                             << " - this might lead to unexpected behavior.";
+            } else {
+                throw InvalidValueError(global_config,
+                                        "random_seed_core",
+                                        "mismatch between core random seed in configuration file and input data - this "
+                                        "might lead to unexpected behavior. Set to value configured in the input data "
+                                        "file: " +
+                                            (*str));
+            }
+        }
+
+        // Cross-check version, print warning only in case of a mismatch:
+        std::string* version_str = nullptr;
+        input->file->GetObject("config/Allpix/version", version_str);
+        if(version_str != nullptr && allpix::from_string<std::string>(*version_str) != ALLPIX_PROJECT_VERSION) {
+            LOG(WARNING) << "Reading data produced with different version " << (*version_str)
+                         << " - this might lead to unexpected behavior.";
+        }
+    }
+
+    // Read the entries of the events from a separate handle on the files in every thread
+    parallel_reading_ = config_.get<bool>("parallel_reading", false);
+    if(parallel_reading_) {
+        // Relations stored as TRefs register the objects with the ROOT process while reading them
+        relations_by_index_ = std::all_of(inputs_.begin(), inputs_.end(), [](const auto& input) {
+            std::string* relations_str = nullptr;
+            input->file->GetObject("config/ROOTObjectWriter/relations", relations_str);
+            return relations_str != nullptr && allpix::from_string<std::string>(*relations_str) == "index";
+        });
+        LOG(DEBUG) << "Reading events in parallel with one file handle per thread"
+                   << (relations_by_index_ ? "" : ", relations stored as TRefs are restored under the ROOT process lock");
+    }
+
+    // Number the events of all files consecutively in the order of the files
+    first_events_.push_back(0);
+    for(auto& input : inputs_) {
+        bind_branches(*input);
+        first_events_.push_back(first_events_.back() + get_events(*input));
+    }
+    if(inputs_.size() > 1) {
+        LOG(INFO) << "Reading " << first_events_.back() << " events from " << inputs_.size() << " input files";
+    }
+}
+
+void ROOTObjectReaderModule::open_trees(Input& input, const std::filesystem::path& file_name) const {
+    LOG(DEBUG) << "Opening input file " << file_name;
+    input.file = std::make_unique<TFile>(file_name.c_str());
+    if(input.file->IsZombie()) {
+        throw ModuleError("Cannot open input file " + file_name.string());
+    }
 
     // Read all the trees in the file
-    TList* keys = input_file_->GetListOfKeys();
+    TList* keys = input.file->GetListOfKeys();
     std::set<std::string> tree_names;
 
     for(auto&& object : *keys) {
@@ -135,9 +250,13 @@ void ROOTObjectReaderModule::initialize() {
         if(std::string(key.GetClassName()) == "TTree") {
             auto* tree = static_cast<TTree*>(key.ReadObjectAny(nullptr));
 
-            // Exclude the Event tree
+            // Exclude the Event tree, but use its index of the event numbers if present
             if(strcmp(tree->GetName(), "Event") == 0) {
                 LOG(TRACE) << "Skipping Event tree in reading";
+                if(input.event_tree == nullptr && dynamic_cast<TTreeIndex*>(tree->GetTreeIndex()) != nullptr) {
+                    LOG(DEBUG) << "Reading events by the event number index of the Event tree";
+                    input.event_tree = tree;
+                }
                 continue;
             }
 
@@ -158,69 +277,22 @@ void ROOTObjectReaderModule::initialize() {
                 continue;
             }
 
-            trees_.push_back(tree);
+            input.trees.push_back(tree);
         }
     }
+}
 
-    if(trees_.empty()) {
-        LOG(ERROR) << "Provided ROOT file does not contain any trees, module will not read any data";
-    }
-
-    // Cross-check the core random seed stored in the file with the one configured:
-    auto& global_config = getConfigManager()->getGlobalConfiguration();
-    auto config_seed = global_config.get<uint64_t>("random_seed_core");
-
-    std::string* str = nullptr;
-    input_file_->GetObject("config/Allpix/random_seed_core", str);
-
-    if(str == nullptr) {
-        // check if missing random seed core in config file should be ignored
-        if(config_.get<bool>("ignore_seed_mismatch", false)) {
-            LOG(WARNING) << "No random seed for core set in the input data file, cross-check with configured value - "
-                         << "this might lead to unexpected behavior. Random seed core from the input data is used.";
-        } else {
-            throw InvalidValueError(global_config,
-                                    "random_seed_core",
-                                    "no random seed for core set in the input data file, cross-check with configured value "
-                                    "impossible - this might lead to unexpected behavior.");
-        }
-    } else if(config_seed != allpix::from_string<uint64_t>(*str)) {
-        // check if mismatch between random seed core in config and in input file should be ignored
-        if(config_.get<bool>("ignore_seed_mismatch", false)) {
-            LOG(WARNING) << "Mismatch between core random seed in configuration file and input data"
-                         << " - this might lead to unexpected behavior.";
-        } else {
-            throw InvalidValueError(global_config,
-                                    "random_seed_core",
-                                    "mismatch between core random seed in configuration file and input data - this "
-                                    "might lead to unexpected behavior. Set to value configured in the input data file: " +
-                                        (*str));
-        }
-    }
-
-    // Cross-check version, print warning only in case of a mismatch:
-    std::string* version_str = nullptr;
-    input_file_->GetObject("config/Allpix/version", version_str);
-    if(version_str != nullptr && allpix::from_string<std::string>(*version_str) != ALLPIX_PROJECT_VERSION) {
-        LOG(WARNING) << "Reading data produced with different version " << (*version_str)
-                     << " - this might lead to unexpected behavior.";
-    }
-
+void ROOTObjectReaderModule::bind_branches(Input& input) const {
     // Loop over all found trees
-    for(auto& tree : trees_) {
+    for(auto& tree : input.trees) {
         // Loop over the list of branches and create the set of receiver objects
         TObjArray* branches = tree->GetListOfBranches();
         for(int i = 0; i < branches->GetEntries(); i++) {
             auto* branch = static_cast<TBranch*>(branches->At(i));
 
-            // Add a new vector of objects and bind it to the branch
-            message_info message_inf;
-            message_inf.objects = new std::vector<Object*>;
-            message_info_array_.emplace_back(message_inf);
-            branch->SetAddress(&(message_info_array_.back().objects));
-
-            // Fill the rest of the message information
+            // Fill the message information
             // FIXME: we want to index this in a different way
+            message_info message_inf;
             std::string branch_name = branch->GetName();
             auto split = allpix::split<std::string>(branch_name, "_");
 
@@ -254,24 +326,95 @@ void ROOTObjectReaderModule::initialize() {
             }
 
             if(name_idx != INT_MAX) {
-                message_info_array_.back().name = split[name_idx];
+                message_inf.name = split[name_idx];
             }
             if(det_idx != INT_MAX) {
                 if(split[det_idx] != "global") {
-                    message_info_array_.back().detector = geo_mgr_->getDetector(split[det_idx]);
+                    // Disable the branches of detectors not included, such that their baskets are never read
+                    if(!include_detectors_.empty() && include_detectors_.find(split[det_idx]) == include_detectors_.end()) {
+                        LOG(TRACE) << "Disabling branch " << branch_name << " of " << tree->GetName()
+                                   << " objects because its detector has not been included";
+                        tree->SetBranchStatus(branch_name.c_str(), false);
+                        tree->SetBranchStatus((branch_name + ".*").c_str(), false);
+                        continue;
+                    }
+                    message_inf.detector = geo_mgr_->getDetector(split[det_idx]);
                 }
             }
+
+            // Identify the objects of the branch for relations stored without TRefs
+            message_inf.message_id = RelationIndex::getMessageId(std::string(tree->GetName()) + "/" + branch_name);
+
+            // Add a new vector of objects and bind it to the branch
+            message_inf.objects = new std::vector<Object*>;
+            input.message_info_array.emplace_back(message_inf);
+            branch->SetAddress(&(input.message_info_array.back().objects));
+        }
+
+        // Prefetch the baskets of the branches read during the first entries
+        if(cache_size_ >= 0) {
+            tree->SetCacheSize(cache_size_);
+            tree->SetCacheLearnEntries(cache_learn_entries_);
         }
     }
 }
 
+ROOTObjectReaderModule::Input& ROOTObjectReaderModule::get_thread_input(size_t file) {
+    std::lock_guard<std::mutex> lock(thread_inputs_mutex_);
+    auto& inputs = thread_inputs_[std::this_thread::get_id()];
+    inputs.resize(input_files_.size());
+    auto& input = inputs[file];
+    if(input == nullptr) {
+        LOG(DEBUG) << "Opening input file " << input_files_[file] << " for thread " << std::this_thread::get_id();
+        input = std::make_unique<Input>();
+        open_trees(*input, input_files_[file]);
+        bind_branches(*input);
+    }
+    return *input;
+}
+
+Long64_t ROOTObjectReaderModule::get_events(const Input& input) {
+    if(input.event_tree != nullptr) {
+        return input.event_tree->GetTreeIndex()->GetN();
+    }
+    return (input.trees.empty() ? 0 : input.trees.front()->GetEntries());
+}
+
 void ROOTObjectReaderModule::run(Event* event) {
-    auto root_lock = root_process_lock();
+    std::unique_lock<std::mutex> root_lock;
+    if(!parallel_reading_ || !relations_by_index_) {
+        root_lock = root_process_lock();
+    }
+
+    // Find the file holding the event, the events of multiple files are numbered in the order of the files
+    size_t file = 0;
+    auto event_num = static_cast<Long64_t>(event->number) - 1;
+    if(inputs_.size() > 1) {
+        if(event_num >= first_events_.back()) {
+            throw EndOfRunException("Requesting end of run because input files only contain data for " +
+                                    std::to_string(first_events_.back()) + " events");
+        }
+        file = static_cast<size_t>(std::upper_bound(first_events_.begin(), first_events_.end(), event_num) -
+                                   first_events_.begin() - 1);
+        event_num -= first_events_[file];
+    }
+    auto& input = (parallel_reading_ ? get_thread_input(file) : *inputs_[file]);
 
     // Beware: ROOT uses signed entry counters for its trees
-    auto event_num = static_cast<int64_t>(event->number);
-    --event_num;
-    for(auto& tree : trees_) {
+    if(input.event_tree != nullptr) {
+        if(inputs_.size() > 1) {
+            // Events of every file are read in the order of their event numbers
+            event_num = static_cast<TTreeIndex*>(input.event_tree->GetTreeIndex())->GetIndex()[event_num];
+        } else {
+            // Files merged from multiple threads store the events out of order
+            event_num = input.event_tree->GetEntryNumberWithIndex(static_cast<Long64_t>(event->number));
+            if(event_num < 0) {
+                throw EndOfRunException("Requesting end of run because TTree does not contain data for event " +
+                                        std::to_string(event->number));
+            }
+        }
+    }
+    for(auto& tree : input.trees) {
         if(event_num >= tree->GetEntries()) {
             throw EndOfRunException("Requesting end of run because TTree only contains data for " +
                                     std::to_string(event_num) + " events");
@@ -281,7 +424,7 @@ void ROOTObjectReaderModule::run(Event* event) {
     LOG(TRACE) << "Building messages from stored objects";
 
     // Loop through all branches to construct messages
-    for(auto& message_inf : message_info_array_) {
+    for(auto& message_inf : input.message_info_array) {
         auto* objects = message_inf.objects;
 
         // Skip empty objects in current event
@@ -305,7 +448,20 @@ void ROOTObjectReaderModule::run(Event* event) {
         message_inf.message = iter->second(*objects, message_inf.detector);
     }
 
-    for(auto& message_inf : message_info_array_) {
+    // Index the objects of all messages to resolve relations stored by their position instead of as TRefs
+    RelationIndex relation_index;
+    for(auto& message_inf : input.message_info_array) {
+        if(message_inf.message) {
+            std::vector<Object*> objects;
+            for(Object& object : message_inf.message->getObjectArray()) {
+                objects.push_back(&object);
+            }
+            relation_index.add(message_inf.message_id, objects);
+        }
+    }
+    RelationIndex::Scope relation_scope(relation_index);
+
+    for(auto& message_inf : input.message_info_array) {
         // We might not have every message, so just continue
         if(!message_inf.message) {
             continue;
@@ -325,11 +481,18 @@ void ROOTObjectReaderModule::run(Event* event) {
 }
 
 void ROOTObjectReaderModule::finalize() {
-    int branch_count = 0;
-    for(auto& tree : trees_) {
-        branch_count += tree->GetListOfBranches()->GetEntries();
+    // Close the inputs of the worker threads
+    if(parallel_reading_) {
+        LOG(DEBUG) << "Closing " << thread_inputs_.size() << " thread inputs";
+        thread_inputs_.clear();
     }
 
-    // Print statistics
-    LOG(INFO) << "Read " << read_cnt_ << " objects from " << branch_count << " branches";
+    // Print statistics, branches disabled for excluded detectors are not counted
+    LOG(INFO) << "Read " << read_cnt_ << " objects from " << inputs_.front()->message_info_array.size() << " branches";
+
+#ifdef R__USE_IMT
+    if(implicit_mt_) {
+        ROOT::DisableImplicitMT();
+    }
+#endif
 }
@@ -9,9 +9,16 @@
  * SPDX-License-Identifier: MIT
  */
 
+#include <filesystem>
 #include <functional>
+#include <list>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <set>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <TFile.h>
 #include <TTree.h>
@@ -31,7 +38,9 @@ namespace allpix {
      * @brief Module to read data stored in ROOT file back to allpix messages
      *
      * Reads the tree of objects in the data format of the \ref ROOTObjectWriterModule. Converts all the stored objects that
-     * are supported back to messages containing those objects and dispatches those messages.
+     * are supported back to messages containing those objects and dispatches those messages. Multiple input files are read
+     * as a single sequence of events in the order of the files. With parallel reading, every worker thread reads the entries
+     * of its events from its own handle on the files.
      */
     class ROOTObjectReaderModule : public Module {
     public:
@@ -46,11 +55,6 @@ namespace allpix {
          * @param geo_mgr Pointer to the geometry manager, containing the detectors
          */
         ROOTObjectReaderModule(Configuration& config, Messenger* messenger, GeometryManager* geo_mgr);
-        /**
-         * @brief Destructor deletes the internal objects read from ROOT Tree
-         */
-        ~ROOTObjectReaderModule() override;
-
         /**
          * @brief Open the ROOT file containing the stored output data
          */
@@ -77,21 +81,88 @@ namespace allpix {
             std::vector<Object*>* objects;
             std::shared_ptr<Detector> detector;
             std::string name;
+            std::uint32_t message_id{};
             std::shared_ptr<BaseMessage> message;
         };
 
+        /**
+         * @brief Handle on an input file with the trees and the objects bound to their branches
+         */
+        struct Input {
+            Input() = default;
+            Input(const Input&) = delete;
+            Input& operator=(const Input&) = delete;
+            Input(Input&&) = delete;
+            Input& operator=(Input&&) = delete;
+            /**
+             * @brief Destructor deletes the internal objects read from ROOT Tree
+             */
+            ~Input();
+
+            // File containing the objects
+            std::unique_ptr<TFile> file;
+
+            // Object trees in the file
+            std::vector<TTree*> trees;
+
+            // Event tree, if it contains an index of the event numbers
+            TTree* event_tree{nullptr};
+
+            // List of objects and message information converted from the trees
+            std::list<message_info> message_info_array;
+        };
+
+        /**
+         * @brief Open an input file and select the trees to read
+         * @param input Input to open
+         * @param file_name Path of the input file
+         */
+        void open_trees(Input& input, const std::filesystem::path& file_name) const;
+
+        /**
+         * @brief Bind the objects of the enabled branches of all selected trees
+         * @param input Input with the selected trees
+         */
+        void bind_branches(Input& input) const;
+
+        /**
+         * @brief Get the input of the calling thread for a file, opening the file on the first event read from it
+         * @param file Position of the file in the list of input files
+         * @return Input of the calling thread
+         */
+        Input& get_thread_input(size_t file);
+
+        /**
+         * @brief Get the number of events stored in an input file
+         */
+        static Long64_t get_events(const Input& input);
+
         // Object names to include or exclude from reading
         std::set<std::string> include_;
         std::set<std::string> exclude_;
 
-        // File containing the objects
-        std::unique_ptr<TFile> input_file_;
+        // Detector names to read objects of, all detectors are read if empty
+        std::set<std::string> include_detectors_;
+
+        // If ROOT implicit multithreading has been enabled by this module
+        bool implicit_mt_{};
+
+        // Settings of the tree cache, the ROOT default is used if the size is negative
+        Long64_t cache_size_{-1};
+        int cache_learn_entries_{};
+
+        // Inputs shared by all threads, only used for reading without parallel reading
+        std::vector<std::filesystem::path> input_files_;
+        std::vector<std::unique_ptr<Input>> inputs_;
 
-        // Object trees in the file
-        std::vector<TTree*> trees_;
+        // Number of events stored in all files preceding every input file, and in all files as last element
+        std::vector<Long64_t> first_events_;
 
-        // List of objects and message information converted from the trees
-        std::list<message_info> message_info_array_;
+        // Inputs of the worker threads with parallel reading
+        bool parallel_reading_{};
+        bool relations_by_index_{};
+        std::mutex thread_inputs_mutex_;
+        std::map<std::thread::id, std::vector<std::unique_ptr<Input>>> thread_inputs_;
 
         // Statistics for total amount of objects stored
         std::atomic<unsigned long> read_cnt_{};
@@ -11,15 +11,21 @@
 
 #include "ROOTObjectWriterModule.hpp"
 
+#include <filesystem>
 #include <fstream>
+#include <iomanip>
+#include <sstream>
 #include <string>
 #include <utility>
 
+#include <Compression.h>
 #include <TBranchElement.h>
 #include <TClass.h>
+#include <TFileMerger.h>
 #include <TProcessID.h>
 
 #include "core/config/ConfigReader.hpp"
+#include "core/module/exceptions.h"
 #include "core/utils/log.h"
 #include "core/utils/type.h"
 
@@ -35,29 +41,145 @@ ROOTObjectWriterModule::ROOTObjectWriterModule(Configuration& config, Messenger*
     // Enable multithreading of this module if multithreading is enabled
     allow_multithreading();
 
+    // Write the events of every thread separately and merge them at the end of the run
+    parallel_output_ = config_.get<bool>("parallel_output", false);
+    if(parallel_output_) {
+        waive_sequence_requirement();
+    }
+
+    // Store relations as the position of the related objects instead of TRefs, avoiding the ROOT process lock
+    relations_ = config_.get<RelationStorage>("relations", RelationStorage::TREF);
+
+    // Write the objects as flat columns without references, which cannot be read back by the ROOTObjectReader
+    flat_output_ = config_.get<bool>("flat_output", false);
+    if(flat_output_ && parallel_output_) {
+        throw InvalidCombinationError(
+            config_, {"flat_output", "parallel_output"}, "flat output cannot be written in parallel");
+    }
+
+    // Continue the output in a new file once the current file reaches the maximum size or number of events
+    max_file_size_ = config_.get<Long64_t>("max_file_size", 0);
+    if(max_file_size_ < 0) {
+        throw InvalidValueError(config_, "max_file_size", "maximum file size should not be negative");
+    }
+    max_file_events_ = config_.get<uint64_t>("max_file_events", 0);
+    rotate_files_ = (max_file_size_ > 0 || max_file_events_ > 0);
+    if(rotate_files_ && parallel_output_) {
+        throw InvalidCombinationError(config_,
+                                      {"max_file_size", "max_file_events", "parallel_output"},
+                                      "output files cannot be rotated with parallel output");
+    }
+
+    // Write the files to local scratch space and transfer them to the output directory once they are closed
+    staging_.configure(config_);
+
     // Bind to all messages with filter
     messenger_->registerFilter(this, &ROOTObjectWriterModule::filter);
 }
 /**
  * @note Objects cannot be stored in smart pointers due to internal ROOT logic
  */
-ROOTObjectWriterModule::~ROOTObjectWriterModule() {
+ROOTObjectWriterModule::TreeOutput::~TreeOutput() {
     // Delete all object pointers
-    for(auto& index_data : write_list_) {
+    for(auto& index_data : write_list) {
         delete index_data.second;
     }
 }
 
-void ROOTObjectWriterModule::initialize() {
-    // Create output file
-    output_file_name_ = createOutputFile(config_.get<std::string>("file_name", "data"), "root", true);
-    output_file_ = std::make_unique<TFile>(output_file_name_.c_str(), "RECREATE");
-    output_file_->cd();
+std::unique_ptr<ROOTObjectWriterModule::TreeOutput>
+ROOTObjectWriterModule::create_output(const std::string& file_name) const {
+    auto output = std::make_unique<TreeOutput>();
+    output->file_name = file_name;
+    output->file = std::make_unique<TFile>(file_name.c_str(), "RECREATE");
+    if(compression_settings_.has_value()) {
+        output->file->SetCompressionSettings(compression_settings_.value());
+    }
+    output->file->cd();
 
     // Create tree to hold Event information
-    trees_.emplace("Event", std::make_unique<TTree>("Event", "Tree of event info"));
-    trees_["Event"]->Branch("ID", &current_event_);
-    trees_["Event"]->Branch("seed", &current_seed_);
+    output->trees.emplace("Event", std::make_unique<TTree>("Event", "Tree of event info"));
+    configure_tree(output->trees["Event"].get());
+    output->trees["Event"]->Branch("ID", &output->current_event);
+    output->trees["Event"]->Branch("seed", &output->current_seed);
+    return output;
+}
+
+void ROOTObjectWriterModule::configure_tree(TTree* tree) const {
+    if(auto_flush_.has_value()) {
+        tree->SetAutoFlush(auto_flush_.value());
+    }
+    if(auto_save_.has_value()) {
+        tree->SetAutoSave(auto_save_.value());
+    }
+}
+
+void ROOTObjectWriterModule::initialize() {
+    // Read the compression settings, ROOT defaults are kept if not configured
+    if(config_.has("compression_algorithm") || config_.has("compression_level")) {
+        auto algorithm = ROOT::RCompressionSetting::EAlgorithm::kUseGlobal;
+        if(config_.has("compression_algorithm")) {
+            auto configured_algorithm = config_.get<CompressionAlgorithm>("compression_algorithm");
+            if(configured_algorithm == CompressionAlgorithm::ZLIB) {
+                algorithm = ROOT::RCompressionSetting::EAlgorithm::kZLIB;
+            } else if(configured_algorithm == CompressionAlgorithm::LZMA) {
+                algorithm = ROOT::RCompressionSetting::EAlgorithm::kLZMA;
+            } else if(configured_algorithm == CompressionAlgorithm::LZ4) {
+                algorithm = ROOT::RCompressionSetting::EAlgorithm::kLZ4;
+            } else {
+                algorithm = ROOT::RCompressionSetting::EAlgorithm::kZSTD;
+            }
+        }
+        // Use the ROOT default level of the algorithm if not configured
+        auto default_level = ROOT::RCompressionSetting::ELevel::kDefaultZLIB;
+        if(algorithm == ROOT::RCompressionSetting::EAlgorithm::kLZMA) {
+            default_level = ROOT::RCompressionSetting::ELevel::kDefaultLZMA;
+        } else if(algorithm == ROOT::RCompressionSetting::EAlgorithm::kLZ4) {
+            default_level = ROOT::RCompressionSetting::ELevel::kDefaultLZ4;
+        } else if(algorithm == ROOT::RCompressionSetting::EAlgorithm::kZSTD) {
+            default_level = ROOT::RCompressionSetting::ELevel::kDefaultZSTD;
+        }
+        auto level = config_.get<int>("compression_level", default_level);
+        if(level < 0 || level > 9) {
+            throw InvalidValueError(config_, "compression_level", "compression level should be between 0 and 9");
+        }
+        compression_settings_ = ROOT::CompressionSettings(algorithm, level);
+    }
+
+    // Read the basket sizes, configurable per object type with keys of the form basket_size_<type>
+    basket_size_ = config_.get<int>("basket_size", 32000);
+    if(basket_size_ <= 0) {
+        throw InvalidValueError(config_, "basket_size", "basket size should be larger than zero");
+    }
+    const std::string basket_size_prefix = "basket_size_";
+    for(const auto& key_value : config_.getAll()) {
+        if(key_value.first.compare(0, basket_size_prefix.size(), basket_size_prefix) != 0) {
+            continue;
+        }
+        auto basket_size = config_.get<int>(key_value.first);
+        if(basket_size <= 0) {
+            throw InvalidValueError(config_, key_value.first, "basket size should be larger than zero");
+        }
+        type_basket_sizes_[key_value.first.substr(basket_size_prefix.size())] = basket_size;
+    }
+
+    if(config_.has("auto_flush")) {
+        auto_flush_ = config_.get<Long64_t>("auto_flush");
+    }
+    if(config_.has("auto_save")) {
+        auto_save_ = config_.get<Long64_t>("auto_save");
+    }
+
+    // Create output file, with parallel output it is only created when merging the files of all threads
+    if(rotate_files_) {
+        output_file_name_ = create_indexed_file(0);
+        output_file_names_.push_back(output_file_name_);
+    } else {
+        output_file_name_ = createOutputFile(config_.get<std::string>("file_name", "data"), "root", true);
+    }
+    staged_file_name_ = staging_.stage(rotate_files_ ? output_file_names_.back() : output_file_name_);
+    if(!parallel_output_) {
+        output_ = create_output(staged_file_name_);
+    }
 
     // Check if the given type of object is contained in the inclusion or exclusion filter rules:
     auto check_object_filter = [](const std::string& object, const std::set<std::string>& arr, bool inclusive) {
@@ -92,6 +214,71 @@ void ROOTObjectWriterModule::initialize() {
                      << std::endl
                      << "It is advised to use the include and exclude parameters to select object types specifically.";
     }
+
+    // All flat columns have to be known before writing, create them for all detectors and objects without detector
+    if(flat_output_) {
+        std::vector<std::string> detector_names{"global"};
+        std::vector<std::shared_ptr<const Detector>> detectors{nullptr};
+        for(const auto& detector : geo_mgr_->getDetectors()) {
+            detector_names.push_back(detector->getName());
+            detectors.push_back(detector);
+        }
+        flat_columns_ = std::make_unique<FlatEvent>(detector_names, detectors);
+        create_flat_branches(*output_);
+    }
+
+    // Read the reduced precision of floating point columns, with keys of the form precision_<type>_<column> for an
+    // absolute step and mantissa_bits_<type>_<column> for the number of mantissa bits to keep
+    const std::string precision_prefix = "precision_";
+    const std::string mantissa_prefix = "mantissa_bits_";
+    for(const auto& key_value : config_.getAll()) {
+        const auto& key = key_value.first;
+        auto is_precision = (key.compare(0, precision_prefix.size(), precision_prefix) == 0);
+        auto is_mantissa = (key.compare(0, mantissa_prefix.size(), mantissa_prefix) == 0);
+        if(!is_precision && !is_mantissa) {
+            continue;
+        }
+        if(!flat_output_) {
+            throw InvalidCombinationError(
+                config_, {key, "flat_output"}, "reduced precision of stored values is only supported for flat output");
+        }
+
+        FlatPrecision precision;
+        if(is_precision) {
+            precision.step = config_.get<double>(key);
+            if(precision.step <= 0) {
+                throw InvalidValueError(config_, key, "precision should be larger than zero");
+            }
+        } else {
+            precision.mantissa_bits = config_.get<int>(key);
+            if(precision.mantissa_bits < 0 || precision.mantissa_bits > 52) {
+                throw InvalidValueError(config_, key, "number of mantissa bits should be between 0 and 52");
+            }
+        }
+        auto name = key.substr((is_precision ? precision_prefix : mantissa_prefix).size());
+        auto columns = flat_columns_->setPrecision(name, precision);
+        if(columns == 0) {
+            throw InvalidValueError(config_, key, "no floating point column " + name + " of any object type");
+        }
+        LOG(DEBUG) << "Storing " << columns << " columns of " << name << " with reduced precision";
+    }
+}
+
+void ROOTObjectWriterModule::create_flat_branches(TreeOutput& output) {
+    output.file->cd();
+    auto& event_tree = output.trees["Event"];
+    const auto& detector_names = flat_columns_->getDetectorNames();
+    flat_columns_->visit([&](const std::string& type_name, size_t detector, const std::string& column_name, auto& column) {
+        if((!include_.empty() && include_.find(type_name) == include_.cend()) ||
+           (!exclude_.empty() && exclude_.find(type_name) != exclude_.cend())) {
+            return;
+        }
+        auto basket_size = type_basket_sizes_.find(type_name);
+        event_tree->Branch(FlatEvent::getColumnName(type_name, detector_names[detector], column_name).c_str(),
+                           &column,
+                           (basket_size == type_basket_sizes_.end() ? basket_size_ : basket_size->second));
+    });
+    LOG(DEBUG) << "Created event tree with " << event_tree->GetListOfBranches()->GetEntries() << " branches";
 }
 
 bool ROOTObjectWriterModule::filter(const std::shared_ptr<BaseMessage>& message,
@@ -129,27 +316,108 @@ bool ROOTObjectWriterModule::filter(const std::shared_ptr<BaseMessage>& message,
     return true;
 }
 
+void ROOTObjectWriterModule::create_branch(TreeOutput& output,
+                                           const std::tuple<std::type_index, std::string, std::string>& index,
+                                           const BranchInfo& branch) const {
+    const auto& class_name = branch.class_name;
+    const auto& branch_name = branch.branch_name;
+
+    // Add vector of objects to write to the write list
+    output.write_list[index] = new std::vector<Object*>();
+    auto* addr = &output.write_list[index];
+
+    // Identify the objects of this list by the name of their tree and branch, as done by the ROOTObjectReader
+    auto message_id = RelationIndex::getMessageId(class_name + "/" + branch_name);
+    for(const auto& other : output.message_ids) {
+        if(relations_ == RelationStorage::INDEX && other.second == message_id) {
+            throw ModuleError("Identifier of branch " + branch_name + " of " + class_name +
+                              " collides with another branch, relations cannot be stored by index");
+        }
+    }
+    output.message_ids[index] = message_id;
+
+    auto new_tree = (output.trees.find(class_name) == output.trees.end());
+    if(new_tree) {
+        // Create new tree
+        output.file->cd();
+        output.trees.emplace(class_name,
+                             std::make_unique<TTree>(class_name.c_str(), (std::string("Tree of ") + class_name).c_str()));
+        configure_tree(output.trees[class_name].get());
+    }
+
+    auto basket_size = type_basket_sizes_.find(class_name);
+    output.trees[class_name]->Bronch(branch_name.c_str(),
+                                     (std::string("std::vector<") + branch.class_name_with_namespace + "*>").c_str(),
+                                     addr,
+                                     (basket_size == type_basket_sizes_.end() ? basket_size_ : basket_size->second));
+
+    // Prefill new tree or new branch with empty records for all events that were missed since the start
+    auto last_event = output.trees["Event"]->GetEntries();
+    if(last_event > 0) {
+        if(new_tree) {
+            LOG(DEBUG) << "Pre-filling new tree of " << class_name << " with " << last_event << " empty events";
+            for(Long64_t i = 0; i < last_event; ++i) {
+                output.trees[class_name]->Fill();
+            }
+        } else {
+            LOG(DEBUG) << "Pre-filling new branch " << branch_name << " of " << class_name << " with " << last_event
+                       << " empty events";
+            auto* tree_branch = output.trees[class_name]->GetBranch(branch_name.c_str());
+            for(Long64_t i = 0; i < last_event; ++i) {
+                tree_branch->Fill();
+            }
+        }
+    }
+}
+
+ROOTObjectWriterModule::TreeOutput& ROOTObjectWriterModule::get_thread_output() {
+    auto& output = thread_outputs_[std::this_thread::get_id()];
+    if(output == nullptr) {
+        // Place the files of the threads next to the output file, named after the order the threads started
+        auto file_name = std::filesystem::path(staged_file_name_);
+        file_name.replace_extension("thread" + std::to_string(thread_outputs_.size() - 1) + ".root");
+        LOG(DEBUG) << "Creating output file " << file_name.string() << " for thread " << std::this_thread::get_id();
+        output = create_output(file_name.string());
+    }
+    return *output;
+}
+
 void ROOTObjectWriterModule::run(Event* event) {
+    if(flat_output_) {
+        write_flat(event);
+        return;
+    }
+
     auto root_lock = root_process_lock();
 
     // Retrieve current object count:
     auto object_count = TProcessID::GetObjectCount();
 
     // Fetch filtered messages
-    auto messages = messenger_->fetchFilteredMessages(this, event);
-
-    // Mark objects to be stored:
-    for(auto& pair : messages) {
-        auto& message = pair.first;
-        auto object_array = message->getObjectArray();
-        for(Object& object : object_array) {
-            object.markForStorage();
+    const auto& messages = messenger_->fetchFilteredMessagesView(this, event);
+
+    // Mark objects to be stored, relations stored by index do not require TRefs
+    if(relations_ == RelationStorage::TREF) {
+        for(auto& pair : messages) {
+            auto& message = pair.first;
+            auto object_array = message->getObjectArray();
+            for(Object& object : object_array) {
+                object.markForStorage();
+            }
         }
     }
 
+    // Continue in the next file once the current file is full, such that no empty file is left at the end of the run
+    if(rotate_files_ && output_full()) {
+        rotate_output();
+    }
+
+    // With parallel output, the outputs of the threads and the list of branches are protected by the ROOT process lock
+    auto& output = (parallel_output_ ? get_thread_output() : *output_);
+
     // Add event data
-    current_event_ = event->number;
-    current_seed_ = event->getSeed();
+    output.current_event = event->number;
+    output.current_seed = event->getSeed();
 
     // Generate trees and index data
     for(auto& pair : messages) {
@@ -170,90 +438,219 @@ void ROOTObjectWriterModule::run(Event* event) {
 
         // Create a new branch of the correct type if this message was not received before
         auto index_tuple = std::make_tuple(type_idx, detector_name, message_name);
-        if(write_list_.find(index_tuple) == write_list_.end()) {
+        if(output.write_list.find(index_tuple) == output.write_list.end()) {
+            BranchInfo branch;
+            branch.class_name = allpix::demangle(typeid(first_object).name());
+            branch.class_name_with_namespace = allpix::demangle(typeid(first_object).name(), true);
 
-            std::string class_name = allpix::demangle(typeid(first_object).name());
-            std::string class_name_with_namespace = allpix::demangle(typeid(first_object).name(), true);
-
-            // Add vector of objects to write to the write list
-            write_list_[index_tuple] = new std::vector<Object*>();
-            auto* addr = &write_list_[index_tuple];
-
-            auto new_tree = (trees_.find(class_name) == trees_.end());
-            if(new_tree) {
-                // Create new tree
-                output_file_->cd();
-                trees_.emplace(class_name,
-                               std::make_unique<TTree>(class_name.c_str(), (std::string("Tree of ") + class_name).c_str()));
-            }
-
-            std::string branch_name = detector_name.empty() ? "global" : detector_name;
+            branch.branch_name = detector_name.empty() ? "global" : detector_name;
             if(!message_name.empty()) {
-                branch_name += "_";
-                branch_name += message_name;
+                branch.branch_name += "_";
+                branch.branch_name += message_name;
             }
 
-            trees_[class_name]->Bronch(
-                branch_name.c_str(), (std::string("std::vector<") + class_name_with_namespace + "*>").c_str(), addr);
-
-            // Prefill new tree or new branch with empty records for all events that were missed since the start
-            auto last_event = trees_["Event"]->GetEntries();
-            if(last_event > 0) {
-                if(new_tree) {
-                    LOG(DEBUG) << "Pre-filling new tree of " << class_name << " with " << last_event << " empty events";
-                    for(Long64_t i = 0; i < last_event; ++i) {
-                        trees_[class_name]->Fill();
-                    }
-                } else {
-                    LOG(DEBUG) << "Pre-filling new branch " << branch_name << " of " << class_name << " with " << last_event
-                               << " empty events";
-                    auto* branch = trees_[class_name]->GetBranch(branch_name.c_str());
-                    for(Long64_t i = 0; i < last_event; ++i) {
-                        branch->Fill();
-                    }
-                }
-            }
+            create_branch(output, index_tuple, branch);
+            branches_.emplace(index_tuple, std::move(branch));
         }
 
         // Fill the branch vector
         for(Object& object : object_array) {
             // Trigger the creation of TRefs for cross-object references to be able to store them to file.
-            object.petrifyHistory();
+            if(relations_ == RelationStorage::TREF) {
+                object.petrifyHistory();
+            }
             ++write_cnt_;
-            write_list_[index_tuple]->push_back(&object);
+            output.write_list[index_tuple]->push_back(&object);
         }
     }
 
+    // With parallel output or relations stored by index, the references have been created such that the other threads
+    // can continue with their events while the objects of this event are serialized and compressed
+    if(parallel_output_ || relations_ == RelationStorage::INDEX) {
+        TProcessID::SetObjectCount(object_count);
+        root_lock.unlock();
+    }
+
+    // Store the relations by the identifier of the list and the position of the related objects
+    if(relations_ == RelationStorage::INDEX) {
+        for(auto& index_data : output.write_list) {
+            output.relation_index.add(output.message_ids[index_data.first], *index_data.second);
+        }
+        RelationIndex::Scope relation_scope(output.relation_index);
+        for(auto& index_data : output.write_list) {
+            for(auto* object : *index_data.second) {
+                object->petrifyHistory();
+            }
+        }
+        output.relation_index.clear();
+    }
+
     LOG(TRACE) << "Writing new objects to tree";
-    output_file_->cd();
+    output.file->cd();
 
     // Fill the tree with the current received messages
-    for(auto& tree : trees_) {
+    for(auto& tree : output.trees) {
         tree.second->Fill();
     }
+    if(output.event_count++ == 0) {
+        output.first_event = event->number;
+    }
 
     // Clear the current message list
-    for(auto& index_data : write_list_) {
+    for(auto& index_data : output.write_list) {
         index_data.second->clear();
     }
 
     // We can reset the TObject count after processing this event because the TRef creation is only done here locally
     // in one worker thread instead of framework wide.
-    TProcessID::SetObjectCount(object_count);
+    if(root_lock.owns_lock()) {
+        TProcessID::SetObjectCount(object_count);
+    }
 }
 
-void ROOTObjectWriterModule::finalize() {
-    LOG(TRACE) << "Writing objects to file";
-    output_file_->cd();
+void ROOTObjectWriterModule::write_flat(Event* event) {
+    // Flat columns do not hold references, such that no objects have to be petrified
+    std::vector<std::shared_ptr<BaseMessage>> messages;
+    for(auto& pair : messenger_->fetchFilteredMessages(this, event)) {
+        messages.push_back(std::move(pair.first));
+    }
+
+    if(rotate_files_ && output_full()) {
+        rotate_output();
+    }
+
+    output_->current_event = event->number;
+    output_->current_seed = event->getSeed();
+    write_cnt_ += flat_columns_->fill(messages);
+
+    LOG(TRACE) << "Writing flat columns to tree";
+    output_->file->cd();
+    output_->trees["Event"]->Fill();
+    flat_columns_->clear();
+    if(output_->event_count++ == 0) {
+        output_->first_event = event->number;
+    }
+}
+
+std::string ROOTObjectWriterModule::create_indexed_file(size_t index) {
+    // Number all files when rotating, also the first one
+    auto file_stem = std::filesystem::path(config_.get<std::string>("file_name", "data")).replace_extension();
+    std::stringstream file_name;
+    file_name << file_stem.string() << "_" << std::setfill('0') << std::setw(4) << index;
+    return createOutputFile(file_name.str(), "root", true);
+}
+
+bool ROOTObjectWriterModule::output_full() const {
+    // Only the baskets already flushed to the file are included in its size
+    return (max_file_events_ > 0 && output_->event_count >= max_file_events_) ||
+           (max_file_size_ > 0 && output_->file->GetEND() >= max_file_size_);
+}
+
+void ROOTObjectWriterModule::rotate_output() {
+    close_output(*output_);
+    staging_.transfer(staged_file_name_, output_file_names_.back());
+
+    output_file_names_.push_back(create_indexed_file(output_file_names_.size()));
+    LOG(INFO) << "Continuing output in file " << output_file_names_.back();
+
+    // The branches of the objects are created again for the first event with these objects in the new file
+    staged_file_name_ = staging_.stage(output_file_names_.back());
+    output_ = create_output(staged_file_name_);
+    if(flat_output_) {
+        create_flat_branches(*output_);
+    }
+}
+
+void ROOTObjectWriterModule::checkpoint() {
+    LOG(TRACE) << "Saving trees for checkpoint";
+    if(parallel_output_) {
+        // The files of the threads are only merged at the end of the run, save them to be able to merge them manually
+        for(auto& thread_output : thread_outputs_) {
+            thread_output.second->file->cd();
+            for(auto& tree : thread_output.second->trees) {
+                tree.second->AutoSave("SaveSelf");
+            }
+        }
+        return;
+    }
+
+    output_->file->cd();
+    for(auto& tree : output_->trees) {
+        tree.second->AutoSave("SaveSelf");
+    }
+}
+
+int ROOTObjectWriterModule::merge_thread_outputs() {
+    // Write an output with only the event tree if no events have been processed
+    if(thread_outputs_.empty()) {
+        get_thread_output();
+    }
+
+    LOG(TRACE) << "Merging output files of " << thread_outputs_.size() << " threads";
+    TFileMerger merger(false, false);
+    auto compression = compression_settings_.value_or(ROOT::RCompressionSetting::EDefaults::kUseCompiledDefault);
+    if(!merger.OutputFile(staged_file_name_.c_str(), "RECREATE", compression)) {
+        throw ModuleError("Cannot create output file " + staged_file_name_);
+    }
 
     int branch_count = 0;
-    for(auto& tree : trees_) {
-        // Update statistics
-        branch_count += tree.second->GetListOfBranches()->GetEntries();
+    std::vector<std::string> thread_files;
+    for(auto& thread_output : thread_outputs_) {
+        auto& output = *thread_output.second;
+
+        // Add the branches only created by other threads, such that the trees of all files are identical
+        for(const auto& branch : branches_) {
+            if(output.write_list.find(branch.first) == output.write_list.end()) {
+                create_branch(output, branch.first, branch.second);
+            }
+        }
+
+        branch_count = 0;
+        for(auto& tree : output.trees) {
+            branch_count += tree.second->GetListOfBranches()->GetEntries();
+        }
+
+        output.file->cd();
+        output.file->Write();
+        for(auto& tree : output.trees) {
+            tree_bytes_[tree.first].first += tree.second->GetTotBytes();
+            tree_bytes_[tree.first].second += tree.second->GetZipBytes();
+        }
+        output.trees.clear();
+        output.file->Close();
+        merger.AddFile(output.file_name.c_str(), false);
+        thread_files.push_back(output.file_name);
+    }
+    thread_outputs_.clear();
+
+    // Copy the compressed baskets of all files without serializing the objects again
+    if(!merger.Merge()) {
+        throw ModuleError("Cannot merge output files of the threads into " + output_file_name_);
     }
+    for(const auto& thread_file : thread_files) {
+        std::filesystem::remove(thread_file);
+    }
+
+    // The events are stored in the order they have been processed by the threads, restore the order by an index
+    output_ = std::make_unique<TreeOutput>();
+    output_->file_name = staged_file_name_;
+    output_->file = std::make_unique<TFile>(staged_file_name_.c_str(), "UPDATE");
+    TTree* event_tree = nullptr;
+    output_->file->GetObject("Event", event_tree);
+    if(event_tree == nullptr) {
+        throw ModuleError("Merged output file " + output_file_name_ + " does not contain the event tree");
+    }
+    output_->file->cd();
+    event_tree->BuildIndex("ID");
+    event_tree->Write("", TObject::kOverwrite);
+    delete event_tree;
+
+    return branch_count;
+}
 
+void ROOTObjectWriterModule::write_metadata(TreeOutput& output) {
     // Create main config directory
-    TDirectory* config_dir = output_file_->mkdir("config");
+    TDirectory* config_dir = output.file->mkdir("config");
     config_dir->cd();
 
     // Get the config manager
@@ -291,8 +688,8 @@ void ROOTObjectWriterModule::finalize() {
     }
 
     // Save the detectors to the output file
-    auto* detectors_dir = output_file_->mkdir("detectors");
-    auto* models_dir = output_file_->mkdir("models");
+    auto* detectors_dir = output.file->mkdir("detectors");
+    auto* models_dir = output.file->mkdir("models");
     for(auto& detector : geo_mgr_->getDetectors()) {
         detectors_dir->cd();
         LOG(TRACE) << "Writing detector configuration for: " << detector->getName();
@@ -327,10 +724,72 @@ void ROOTObjectWriterModule::finalize() {
         }
     }
 
+    // Store the range of events of every file when rotating
+    if(rotate_files_) {
+        auto* file_dir = output.file->mkdir("file_info");
+        file_dir->cd();
+        auto file_index = std::to_string(output_file_names_.size() - 1);
+        auto first_event = std::to_string(output.first_event);
+        auto last_event = std::to_string(output.event_count > 0 ? output.current_event : output.first_event);
+        auto number_of_events = std::to_string(output.event_count);
+        file_dir->WriteObject(&file_index, "file_index");
+        file_dir->WriteObject(&first_event, "first_event");
+        file_dir->WriteObject(&last_event, "last_event");
+        file_dir->WriteObject(&number_of_events, "number_of_events");
+    }
+}
+
+void ROOTObjectWriterModule::close_output(TreeOutput& output) {
+    LOG(TRACE) << "Writing metadata and trees to file " << output.file_name;
+    write_metadata(output);
+
     // Finish writing to output file
-    output_file_->Write();
+    output.file->cd();
+    output.file->Write();
+    for(auto& tree : output.trees) {
+        tree_bytes_[tree.first].first += tree.second->GetTotBytes();
+        tree_bytes_[tree.first].second += tree.second->GetZipBytes();
+    }
+    output.trees.clear();
+    output.file->Close();
+}
+
+void ROOTObjectWriterModule::finalize() {
+    int branch_count = 0;
+    if(parallel_output_) {
+        branch_count = merge_thread_outputs();
+    } else {
+        LOG(TRACE) << "Writing objects to file";
+        output_->file->cd();
+
+        for(auto& tree : output_->trees) {
+            // Update statistics
+            branch_count += tree.second->GetListOfBranches()->GetEntries();
+        }
+    }
+
+    close_output(*output_);
+
+    // Wait for the transfer of all staged files, such that they are complete in the output directory at the end of the run
+    if(staging_.enabled()) {
+        staging_.transfer(staged_file_name_, rotate_files_ ? output_file_names_.back() : output_file_name_);
+        LOG(TRACE) << "Waiting for the transfer of staged output files";
+        staging_.wait();
+    }
 
     // Print statistics
-    LOG(STATUS) << "Wrote " << write_cnt_ << " objects to " << branch_count << " branches in file:" << std::endl
-                << output_file_name_;
+    for(const auto& [tree_name, bytes] : tree_bytes_) {
+        LOG(INFO) << "Tree " << tree_name << " holds " << bytes.first << " bytes, compressed to " << bytes.second
+                  << " bytes in file";
+    }
+    if(rotate_files_) {
+        std::stringstream file_list;
+        for(const auto& file_name : output_file_names_) {
+            file_list << std::endl << file_name;
+        }
+        LOG(STATUS) << "Wrote " << write_cnt_ << " objects to " << output_file_names_.size() << " files:" << file_list.str();
+    } else {
+        LOG(STATUS) << "Wrote " << write_cnt_ << " objects to " << branch_count << " branches in file:" << std::endl
+                    << output_file_name_;
+    }
 }
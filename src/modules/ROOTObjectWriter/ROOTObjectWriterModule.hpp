@@ -11,7 +11,11 @@
 
 #include <atomic>
 #include <map>
+#include <memory>
+#include <optional>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <TFile.h>
 #include <TTree.h>
@@ -22,6 +26,11 @@
 #include "core/module/Event.hpp"
 #include "core/module/Module.hpp"
 
+#include "objects/Object.hpp"
+
+#include "tools/file_staging.h"
+#include "tools/flat_objects.h"
+
 namespace allpix {
     /**
      * @ingroup Modules
@@ -30,9 +39,39 @@ namespace allpix {
      * Listens to all objects dispatched in the framework. Creates a tree as soon as a new type of object is encountered and
      * saves the data in those objects to tree for every event. The tree name is the class name of the object. A separate
      * branch is created for every combination of detector name and message name that outputs this object.
+     *
+     * With parallel output enabled, every worker thread fills and compresses its own trees in a separate file. These
+     * files are merged into the output file at the end of the run, indexed by the event number.
+     *
+     * With flat output enabled, the objects are instead stored as flat columns of fundamental types in the event tree,
+     * with relations between objects stored as indices among the objects of the related type in the event.
+     *
+     * With a maximum file size or number of events configured, the output is continued in a new file with a sequential
+     * index once the current file is full. Every file holds the configuration, the detector setup and its range of events.
+     *
+     * With staging enabled, the files are written to local scratch space and transferred to the output directory in the
+     * background once they are closed, i.e. during the run for rotated files.
      */
     class ROOTObjectWriterModule : public SequentialModule {
     public:
+        /**
+         * @brief Algorithms for the compression of the output file
+         */
+        enum class CompressionAlgorithm {
+            ZLIB, ///< Compression with zlib
+            LZMA, ///< Compression with LZMA, slow with high compression ratio
+            LZ4,  ///< Compression with LZ4, fast with low compression ratio
+            ZSTD, ///< Compression with Zstandard
+        };
+
+        /**
+         * @brief Storage of the relations between objects
+         */
+        enum class RelationStorage {
+            TREF,  ///< Relations stored as ROOT TRefs
+            INDEX, ///< Relations stored as message identifier and position of the related object
+        };
+
         /**
          * @brief Constructor for this unique module
          * @param config Configuration object for this module as retrieved from the steering file
@@ -40,10 +79,6 @@ namespace allpix {
          * @param geo_mgr Pointer to the geometry manager, containing the detectors
          */
         ROOTObjectWriterModule(Configuration& config, Messenger* messenger, GeometryManager* geo_mgr);
-        /**
-         * @brief Destructor deletes the internal objects used to build the ROOT Tree
-         */
-        ~ROOTObjectWriterModule() override;
 
         /**
          * @brief Receive a single message containing objects of arbitrary type
@@ -62,6 +97,11 @@ namespace allpix {
          */
         void run(Event* event) override;
 
+        /**
+         * @brief Save the trees to the file, such that it can be recovered with all events up to the checkpoint
+         */
+        void checkpoint() override;
+
         /**
          * @brief Add the main configuration and the detector setup to the data file and write it, also write statistics
          * information.
@@ -76,21 +116,162 @@ namespace allpix {
         std::set<std::string> include_;
         std::set<std::string> exclude_;
 
-        // Output data file to write
-        std::unique_ptr<TFile> output_file_;
+        /**
+         * @brief Output file with the trees of all events written to it
+         */
+        struct TreeOutput {
+            /**
+             * @brief Destructor deletes the object lists used to build the ROOT trees
+             */
+            ~TreeOutput();
+
+            std::unique_ptr<TFile> file;
+            std::string file_name;
+
+            // Current event
+            uint64_t current_event{0};
+
+            // Current random seed
+            uint64_t current_seed{0};
+
+            // First event and number of events written to this output
+            uint64_t first_event{0};
+            uint64_t event_count{0};
+
+            // List of trees that are stored in data file
+            std::map<std::string, std::unique_ptr<TTree>> trees;
+
+            // List of objects of a particular type, bound to a specific detector and having a particular name
+            std::map<std::tuple<std::type_index, std::string, std::string>, std::vector<Object*>*> write_list;
+
+            // Identifiers of the object lists for relations stored in a relation index
+            std::map<std::tuple<std::type_index, std::string, std::string>, std::uint32_t> message_ids;
+
+            // Index of the objects of the current event, for relations stored without TRefs
+            RelationIndex relation_index;
+        };
+
+        /**
+         * @brief Information to create a branch for a particular object list
+         */
+        struct BranchInfo {
+            std::string class_name;
+            std::string class_name_with_namespace;
+            std::string branch_name;
+        };
+
+        /**
+         * @brief Create an output file with the tree holding the event information
+         * @param file_name Name of the file to create
+         */
+        std::unique_ptr<TreeOutput> create_output(const std::string& file_name) const;
+
+        /**
+         * @brief Apply the configured flushing and saving of baskets to a newly created tree
+         * @param tree Tree to configure
+         */
+        void configure_tree(TTree* tree) const;
+
+        /**
+         * @brief Create the branch of an object list, pre-filled with empty records for all events already written
+         * @param output Output to create the branch in
+         * @param index Type, detector name and message name of the object list
+         * @param branch Information about the branch to create
+         */
+        void create_branch(TreeOutput& output,
+                           const std::tuple<std::type_index, std::string, std::string>& index,
+                           const BranchInfo& branch) const;
+
+        /**
+         * @brief Create the flat columns of all object types and detectors in the event tree of an output
+         * @param output Output to create the columns in
+         */
+        void create_flat_branches(TreeOutput& output);
+
+        /**
+         * @brief Write the configuration and the detector setup to an output file
+         * @param output Output to write the metadata to
+         */
+        void write_metadata(TreeOutput& output);
+
+        /**
+         * @brief Write the metadata and the trees of an output, collect the tree statistics and close its file
+         * @param output Output to close
+         */
+        void close_output(TreeOutput& output);
+
+        /**
+         * @brief Create the output file with the given index in the sequence of rotated files
+         * @param index Index of the file in the sequence
+         * @return Path of the created file
+         */
+        std::string create_indexed_file(size_t index);
+
+        /**
+         * @brief Check if the output file reached the maximum file size or number of events
+         */
+        bool output_full() const;
+
+        /**
+         * @brief Close the current output file and continue in the output file with the next index
+         */
+        void rotate_output();
+
+        /**
+         * @brief Get the output of the calling thread, creating it for the first event of the thread
+         * @warning Requires the ROOT process lock to be held
+         */
+        TreeOutput& get_thread_output();
+
+        /**
+         * @brief Complete the trees of all threads with the branches of all other threads and merge them into the output
+         * @return Number of branches in the merged trees
+         */
+        int merge_thread_outputs();
+
+        /**
+         * @brief Write the objects of an event as flat columns to the event tree
+         * @param event Event to write
+         */
+        void write_flat(Event* event);
+
+        // Name of the output data file to write
         std::string output_file_name_{};
 
-        // Current event
-        uint64_t current_event_{0};
+        // Staging of the output files in local scratch space, and name of the file currently written
+        FileStaging staging_;
+        std::string staged_file_name_{};
+
+        // Rotation of the output file at a maximum file size in bytes or number of events, and names of all files written
+        bool rotate_files_{};
+        Long64_t max_file_size_{};
+        uint64_t max_file_events_{};
+        std::vector<std::string> output_file_names_;
+
+        // Compression, basket size and flushing settings of the output trees, ROOT defaults are used if not configured
+        std::optional<int> compression_settings_;
+        int basket_size_{};
+        std::map<std::string, int> type_basket_sizes_;
+        std::optional<Long64_t> auto_flush_;
+        std::optional<Long64_t> auto_save_;
+
+        // Number of uncompressed and compressed bytes per tree, collected when writing the file
+        std::map<std::string, std::pair<Long64_t, Long64_t>> tree_bytes_;
+
+        // Output of all events, or the merged output of all threads with parallel output
+        std::unique_ptr<TreeOutput> output_;
 
-        // Current random seed
-        uint64_t current_seed_{0};
+        // Outputs of every worker thread and information of the branches created by any of them, for parallel output
+        bool parallel_output_{};
+        std::map<std::thread::id, std::unique_ptr<TreeOutput>> thread_outputs_;
+        std::map<std::tuple<std::type_index, std::string, std::string>, BranchInfo> branches_;
 
-        // List of trees that are stored in data file
-        std::map<std::string, std::unique_ptr<TTree>> trees_;
+        // Storage of the relations between objects
+        RelationStorage relations_{RelationStorage::TREF};
 
-        // List of objects of a particular type, bound to a specific detector and having a particular name
-        std::map<std::tuple<std::type_index, std::string, std::string>, std::vector<Object*>*> write_list_;
+        // Columns of the objects of all detectors, for flat output
+        bool flat_output_{};
+        std::unique_ptr<FlatEvent> flat_columns_;
 
         // Statistical information about number of objects
         std::atomic<unsigned long> write_cnt_{};
@@ -0,0 +1,144 @@
+/**
+ * @file
+ * @brief Implementation of module propagating charge deposits with a library of the averaged pixel response
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "ResponseLibraryPropagationModule.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "core/config/exceptions.h"
+#include "core/module/exceptions.h"
+#include "core/utils/distributions.h"
+#include "core/utils/log.h"
+#include "core/utils/unit.h"
+
+using namespace allpix;
+
+ResponseLibraryPropagationModule::ResponseLibraryPropagationModule(Configuration& config,
+                                                                   Messenger* messenger,
+                                                                   std::shared_ptr<Detector> detector)
+    : Module(config, detector), messenger_(messenger), detector_(std::move(detector)) {
+    // Enable multithreading of this module if multithreading is enabled
+    allow_multithreading();
+
+    // Save detector model
+    model_ = detector_->getModel();
+
+    // Require deposits message for single detector
+    messenger_->bindSingle<DepositedChargeMessage>(this, MsgFlags::REQUIRED);
+
+    // Declare the messages dispatched by this module
+    declare_output<PropagatedChargeMessage>();
+}
+
+void ResponseLibraryPropagationModule::initialize() {
+    if(model_->getPixelType() != Pixel::Type::RECTANGLE) {
+        throw ModuleError("The response library requires rectangular pixels");
+    }
+
+    auto file_name = config_.getPath("file_name", true);
+    try {
+        library_ = ResponseLibrary(file_name);
+    } catch(const std::invalid_argument& e) {
+        throw InvalidValueError(config_, "file_name", e.what());
+    }
+
+    // The library only describes the detector model it has been generated for
+    auto pitch = library_.getPitch();
+    auto thickness = library_.getThickness();
+    auto matches = [](double library, double model) { return std::fabs(library - model) <= 1e-6 * std::fabs(model); };
+    if(!matches(pitch[0], model_->getPixelSize().x()) || !matches(pitch[1], model_->getPixelSize().y()) ||
+       !matches(thickness, model_->getSensorSize().z())) {
+        throw InvalidValueError(config_,
+                                "file_name",
+                                "response library has been generated for a pixel pitch of " +
+                                    Units::display(pitch[0], {"um"}) + "x" + Units::display(pitch[1], {"um"}) +
+                                    " and a thickness of " + Units::display(thickness, {"um"}) +
+                                    ", which does not match the detector model");
+    }
+
+    auto bins = library_.getBins();
+    LOG(INFO) << "Read response library with " << bins[0] << "x" << bins[1] << "x" << bins[2] << " cells and "
+              << library_.getNeighbors() << " pixels per cell";
+}
+
+void ResponseLibraryPropagationModule::run(Event* event) {
+    auto deposits_message = messenger_->fetchMessage<DepositedChargeMessage>(this, event);
+
+    std::vector<PropagatedCharge> propagated_charges;
+    auto distance = static_cast<int>(library_.getDistance());
+    auto top_z = model_->getSensorCenter().z() + model_->getSensorSize().z() / 2;
+    auto bottom_z = model_->getSensorCenter().z() - model_->getSensorSize().z() / 2;
+    for(const auto& deposit : deposits_message->getData()) {
+        // Every electron-hole pair is deposited as one electron and one hole, the library describes the response per pair
+        if(deposit.getType() != CarrierType::ELECTRON) {
+            continue;
+        }
+
+        auto position = deposit.getLocalPosition();
+        auto pairs = static_cast<double>(deposit.getCharge());
+        total_deposited_ += deposit.getCharge();
+
+        auto [xpixel, ypixel] = model_->getPixelIndex(position);
+        auto center = model_->getPixelCenter(xpixel, ypixel);
+        auto cell = library_.getCell(position.x() - center.x(), position.y() - center.y(), position.z() - bottom_z);
+
+        for(int dy = -distance; dy <= distance; ++dy) {
+            for(int dx = -distance; dx <= distance; ++dx) {
+                const auto& response = library_.getResponse(cell, dx, dy);
+                if(response.mean == 0 || !model_->isWithinMatrix(xpixel + dx, ypixel + dy)) {
+                    continue;
+                }
+
+                // Sample the collected charge, which cannot change sign or exceed the deposited charge
+                allpix::normal_distribution<double> charge_distribution(pairs * response.mean,
+                                                                        std::sqrt(pairs * response.variance));
+                auto charge = std::round(charge_distribution(event->getRandomEngine()));
+                charge = std::clamp(response.mean > 0 ? charge : -charge, 0., pairs);
+                if(charge == 0) {
+                    continue;
+                }
+
+                // Place the charge on the surface at the center of the collecting pixel
+                auto pixel_center = model_->getPixelCenter(xpixel + dx, ypixel + dy);
+                auto local_position = ROOT::Math::XYZPoint(pixel_center.x(), pixel_center.y(), top_z);
+                auto type = (response.mean > 0 ? CarrierType::HOLE : CarrierType::ELECTRON);
+                propagated_charges.emplace_back(local_position,
+                                                detector_->getGlobalPosition(local_position),
+                                                type,
+                                                static_cast<unsigned int>(charge),
+                                                deposit.getLocalTime() + response.time,
+                                                deposit.getGlobalTime() + response.time,
+                                                CarrierState::HALTED,
+                                                &deposit);
+                total_propagated_ += static_cast<long long>(type) * static_cast<long long>(charge);
+
+                LOG(DEBUG) << "Sampled " << charge << " " << type << " collected at pixel (" << xpixel + dx << ","
+                           << ypixel + dy << ") from deposit at " << Units::display(position, {"mm", "um"});
+            }
+        }
+    }
+
+    LOG(DEBUG) << "Total count of propagated charge carriers: " << propagated_charges.size();
+
+    // Create a new message with propagated charges and dispatch it
+    auto propagated_charge_message = event->makeShared<PropagatedChargeMessage>(std::move(propagated_charges), detector_);
+    messenger_->dispatchMessage(this, std::move(propagated_charge_message), event);
+}
+
+void ResponseLibraryPropagationModule::finalize() {
+    LOG(INFO) << "Sampled a net collected charge of " << total_propagated_ << "e from " << total_deposited_
+              << " deposited electron-hole pairs";
+}
@@ -0,0 +1,75 @@
+/**
+ * @file
+ * @brief Definition of module propagating charge deposits with a library of the averaged pixel response
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "core/config/Configuration.hpp"
+#include "core/geometry/GeometryManager.hpp"
+#include "core/messenger/Messenger.hpp"
+#include "core/module/Event.hpp"
+#include "core/module/Module.hpp"
+
+#include "objects/DepositedCharge.hpp"
+#include "objects/PropagatedCharge.hpp"
+
+#include "tools/response_library.h"
+
+namespace allpix {
+    /**
+     * @ingroup Modules
+     * @brief Module to propagate deposited charges by sampling a precomputed library of the pixel response
+     * @note This module supports multithreading
+     *
+     * Instead of propagating the charge carriers through the sensor, the charge collected on the pixels surrounding every
+     * deposit is sampled from the mean and variance of the response stored in a \ref ResponseLibrary for the in-pixel
+     * position and depth of the deposit. The collected charge is placed at the center of the collecting pixel on the
+     * surface of the sensor, such that it is assigned to this pixel by the transfer modules.
+     */
+    class ResponseLibraryPropagationModule : public Module {
+    public:
+        /**
+         * @brief Constructor for this detector-specific module
+         * @param config Configuration object for this module as retrieved from the steering file
+         * @param messenger Pointer to the messenger object to allow binding to messages on the bus
+         * @param detector Pointer to the detector for this module instance
+         */
+        ResponseLibraryPropagationModule(Configuration& config, Messenger* messenger, std::shared_ptr<Detector> detector);
+
+        /**
+         * @brief Read the library and check that it matches the detector model
+         */
+        void initialize() override;
+
+        /**
+         * @brief Sample the charge collected on the pixels for all deposits
+         */
+        void run(Event*) override;
+
+        /**
+         * @brief Report the total number of charge carriers sampled from the library
+         */
+        void finalize() override;
+
+    private:
+        Messenger* messenger_;
+
+        std::shared_ptr<Detector> detector_;
+        std::shared_ptr<DetectorModel> model_;
+
+        ResponseLibrary library_;
+
+        // Statistical information
+        std::atomic<unsigned long long> total_deposited_{};
+        std::atomic<long long> total_propagated_{};
+    };
+} // namespace allpix
@@ -0,0 +1,176 @@
+/**
+ * @file
+ * @brief Implementation of module writing libraries of the averaged pixel response to charge deposits
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "ResponseLibraryWriterModule.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "core/config/exceptions.h"
+#include "core/messenger/exceptions.h"
+#include "core/module/exceptions.h"
+#include "core/utils/log.h"
+#include "core/utils/unit.h"
+
+#include "tools/ROOT.h"
+
+using namespace allpix;
+
+ResponseLibraryWriterModule::ResponseLibraryWriterModule(Configuration& config,
+                                                         Messenger* messenger,
+                                                         std::shared_ptr<Detector> detector)
+    : Module(config, detector), messenger_(messenger), detector_(std::move(detector)) {
+    // Enable multithreading of this module if multithreading is enabled
+    allow_multithreading();
+
+    // Save detector model
+    model_ = detector_->getModel();
+
+    // Set default values for config variables
+    config_.setDefault<std::string>("file_name", "response_library");
+    config_.setDefault<ROOT::Math::XYZVector>("bins", ROOT::Math::XYZVector(10, 10, 10));
+    config_.setDefault<unsigned int>("distance", 1);
+
+    auto bins = config_.get<ROOT::Math::XYZVector>("bins");
+    bins_ = {static_cast<size_t>(bins.x()), static_cast<size_t>(bins.y()), static_cast<size_t>(bins.z())};
+    if(bins_[0] == 0 || bins_[1] == 0 || bins_[2] == 0) {
+        throw InvalidValueError(config_, "bins", "number of cells has to be positive along all axes");
+    }
+    distance_ = config_.get<unsigned int>("distance");
+
+    // Require deposited charges and the resulting pixel charges for single detector, events without pixel charges
+    // contribute no collected charge
+    messenger_->bindSingle<DepositedChargeMessage>(this, MsgFlags::REQUIRED);
+    messenger_->bindSingle<PixelChargeMessage>(this);
+}
+
+void ResponseLibraryWriterModule::initialize() {
+    if(model_->getPixelType() != Pixel::Type::RECTANGLE) {
+        throw ModuleError("The response library requires rectangular pixels");
+    }
+
+    file_name_ = createOutputFile(config_.get<std::string>("file_name"), "txt");
+
+    auto pitch = model_->getPixelSize();
+    library_ = ResponseLibrary(bins_, {{pitch.x(), pitch.y()}}, model_->getSensorSize().z(), distance_);
+    cell_sums_.resize(bins_[0] * bins_[1] * bins_[2]);
+    response_sums_.resize(cell_sums_.size() * library_.getNeighbors());
+}
+
+void ResponseLibraryWriterModule::run(Event* event) {
+    auto deposits_message = messenger_->fetchMessage<DepositedChargeMessage>(this, event);
+    const auto& deposits = deposits_message->getData();
+    if(deposits.empty()) {
+        return;
+    }
+
+    // The library describes the response to deposits at a single position, other events are skipped
+    auto position = deposits.front().getLocalPosition();
+    double pairs = 0;
+    double hole_pairs = 0;
+    for(const auto& deposit : deposits) {
+        if((deposit.getLocalPosition() - position).Mag2() > 0) {
+            LOG_ONCE(WARNING) << "Charge deposited at more than one position, skipping events which cannot be assigned to "
+                                 "a single cell of the library";
+            skipped_events_++;
+            return;
+        }
+        (deposit.getType() == CarrierType::ELECTRON ? pairs : hole_pairs) += deposit.getCharge();
+    }
+    pairs = (pairs > 0 ? pairs : hole_pairs);
+
+    // Find the cell of the deposit relative to the center of its pixel
+    auto [xpixel, ypixel] = model_->getPixelIndex(position);
+    auto center = model_->getPixelCenter(xpixel, ypixel);
+    auto depth = position.z() - (model_->getSensorCenter().z() - model_->getSensorSize().z() / 2);
+    auto cell = library_.getCell(position.x() - center.x(), position.y() - center.y(), depth);
+    LOG(DEBUG) << "Deposit of " << pairs << " electron-hole pairs at " << Units::display(position, {"um", "mm"})
+               << " assigned to cell " << cell;
+
+    // Collect the charge of all pixels within the neighbor distance before accumulating it for this cell
+    std::vector<std::pair<double, double>> responses(library_.getNeighbors());
+    try {
+        auto pixels_message = messenger_->fetchMessage<PixelChargeMessage>(this, event);
+        for(const auto& pixel_charge : pixels_message->getData()) {
+            auto dx = pixel_charge.getIndex().x() - xpixel;
+            auto dy = pixel_charge.getIndex().y() - ypixel;
+            auto distance = static_cast<int>(distance_);
+            if(std::abs(dx) > distance || std::abs(dy) > distance) {
+                continue;
+            }
+            auto& response = responses[static_cast<size_t>((dy + distance) * (2 * distance + 1) + dx + distance)];
+            response.first += pixel_charge.getCharge();
+            response.second += pixel_charge.getCharge() * (pixel_charge.getLocalTime() - deposits.front().getLocalTime());
+        }
+    } catch(const MessageNotFoundException&) {
+    }
+
+    std::lock_guard<std::mutex> lock{sums_mutex_};
+    auto& cell_sums = cell_sums_[cell];
+    cell_sums.events++;
+    cell_sums.pairs += pairs;
+    cell_sums.pairs_squared += pairs * pairs;
+    for(size_t neighbor = 0; neighbor < responses.size(); ++neighbor) {
+        auto [charge, charge_time] = responses[neighbor];
+        auto& sums = response_sums_[cell * responses.size() + neighbor];
+        sums.charge += charge;
+        sums.charge_squared += charge * charge;
+        sums.charge_pairs += charge * pairs;
+        sums.charge_time += charge_time;
+    }
+}
+
+void ResponseLibraryWriterModule::finalize() {
+    size_t filled_cells = 0;
+    auto neighbors = library_.getNeighbors();
+    auto distance = static_cast<int>(distance_);
+    for(size_t cell = 0; cell < cell_sums_.size(); ++cell) {
+        const auto& cell_sums = cell_sums_[cell];
+        if(cell_sums.pairs <= 0) {
+            continue;
+        }
+        filled_cells++;
+
+        // Estimate mean and variance per pair, assuming that the collected charge scales with the number of pairs
+        for(size_t neighbor = 0; neighbor < neighbors; ++neighbor) {
+            const auto& sums = response_sums_[cell * neighbors + neighbor];
+            auto& response = library_.getResponse(cell,
+                                                  static_cast<int>(neighbor % (2 * distance_ + 1)) - distance,
+                                                  static_cast<int>(neighbor / (2 * distance_ + 1)) - distance);
+            response.mean = sums.charge / cell_sums.pairs;
+            response.variance = std::max(0.,
+                                         (sums.charge_squared - 2 * response.mean * sums.charge_pairs +
+                                          response.mean * response.mean * cell_sums.pairs_squared) /
+                                             cell_sums.pairs);
+            response.time = (sums.charge != 0 ? sums.charge_time / sums.charge : 0.);
+        }
+    }
+
+    if(filled_cells < cell_sums_.size()) {
+        LOG(WARNING) << "Only " << filled_cells << " of " << cell_sums_.size()
+                     << " cells of the response library received deposits, consider scanning more positions";
+    }
+    if(skipped_events_ > 0) {
+        LOG(WARNING) << "Skipped " << skipped_events_ << " events with charge deposited at more than one position";
+    }
+
+    try {
+        library_.write(file_name_);
+    } catch(const std::invalid_argument& e) {
+        throw ModuleError("Cannot write response library to " + file_name_ + ": " + e.what());
+    }
+    LOG(STATUS) << "Wrote response library with " << filled_cells << " of " << cell_sums_.size() << " cells filled to file "
+                << file_name_;
+}
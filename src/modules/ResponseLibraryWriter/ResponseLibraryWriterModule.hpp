@@ -0,0 +1,98 @@
+/**
+ * @file
+ * @brief Definition of module writing libraries of the averaged pixel response to charge deposits
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "core/config/Configuration.hpp"
+#include "core/geometry/GeometryManager.hpp"
+#include "core/messenger/Messenger.hpp"
+#include "core/module/Event.hpp"
+#include "core/module/Module.hpp"
+
+#include "objects/DepositedCharge.hpp"
+#include "objects/PixelCharge.hpp"
+
+#include "tools/response_library.h"
+
+namespace allpix {
+    /**
+     * @ingroup Modules
+     * @brief Module to generate a library of the pixel response from the results of a full simulation
+     * @note This module supports multithreading
+     *
+     * The module compares the charge deposited in every event with the charge collected on the pixels surrounding the
+     * deposit, and accumulates the collected charge per in-pixel position and depth of the deposit. At the end of the run,
+     * the mean and variance of the charge collected per deposited electron-hole pair as well as the mean collection time
+     * are written to a \ref ResponseLibrary, which can be used by the ResponseLibraryPropagation module.
+     */
+    class ResponseLibraryWriterModule : public Module {
+    public:
+        /**
+         * @brief Constructor for this detector-specific module
+         * @param config Configuration object for this module as retrieved from the steering file
+         * @param messenger Pointer to the messenger object to allow binding to messages on the bus
+         * @param detector Pointer to the detector for this module instance
+         */
+        ResponseLibraryWriterModule(Configuration& config, Messenger* messenger, std::shared_ptr<Detector> detector);
+
+        /**
+         * @brief Prepare the accumulation of the response and the output file
+         */
+        void initialize() override;
+
+        /**
+         * @brief Accumulate the response of the pixels to the deposit of the event
+         */
+        void run(Event*) override;
+
+        /**
+         * @brief Write the library of the averaged response
+         */
+        void finalize() override;
+
+    private:
+        Messenger* messenger_;
+
+        std::shared_ptr<Detector> detector_;
+        std::shared_ptr<DetectorModel> model_;
+
+        // Configuration parameters
+        std::array<size_t, 3> bins_{};
+        size_t distance_{};
+        std::string file_name_;
+
+        // Sums over all events of a cell
+        struct CellSums {
+            unsigned long long events{};
+            double pairs{};
+            double pairs_squared{};
+        };
+        // Sums over all events of a cell for a single neighbor pixel
+        struct ResponseSums {
+            double charge{};
+            double charge_squared{};
+            double charge_pairs{};
+            double charge_time{};
+        };
+        std::mutex sums_mutex_;
+        std::vector<CellSums> cell_sums_;
+        std::vector<ResponseSums> response_sums_;
+        ResponseLibrary library_;
+
+        // Statistical information
+        std::atomic<unsigned long long> skipped_events_{};
+    };
+} // namespace allpix
@@ -11,13 +11,16 @@
 
 #include "SimpleTransferModule.hpp"
 
+#include <algorithm>
 #include <fstream>
 #include <limits>
+#include <map>
 #include <memory>
 #include <new>
 #include <stdexcept>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "core/config/exceptions.h"
 #include "core/utils/log.h"
@@ -33,6 +36,9 @@ SimpleTransferModule::SimpleTransferModule(Configuration& config, Messenger* mes
     // Enable multithreading of this module if multithreading is enabled
     allow_multithreading();
 
+    // Declare the messages dispatched by this module
+    declare_output<PixelChargeMessage>();
+
     // Set default value for the maximum depth distance to transfer
     config_.setDefault("max_depth_distance", Units::get(5.0, "um"));
 
@@ -54,8 +60,13 @@ SimpleTransferModule::SimpleTransferModule(Configuration& config, Messenger* mes
     // Cache flag for output plots:
     output_plots_ = config_.get<bool>("output_plots");
 
-    // Require propagated deposits for single detector
-    messenger_->bindSingle<PropagatedChargeMessage>(this, MsgFlags::REQUIRED);
+    // Require propagated deposits for single detector, or for any of the detectors of the model if handling all of them
+    multiple_detectors_ = allow_multi_detector();
+    if(multiple_detectors_) {
+        messenger_->bindMulti<PropagatedChargeMessage>(this, MsgFlags::REQUIRED);
+    } else {
+        messenger_->bindSingle<PropagatedChargeMessage>(this, MsgFlags::REQUIRED);
+    }
 }
 
 void SimpleTransferModule::initialize() {
@@ -67,13 +78,21 @@ void SimpleTransferModule::initialize() {
                                     "collect_from_implant",
                                     "Detector model does not have implants defined, but collection requested from implants");
         }
-        if(detector_->getElectricFieldType() == FieldType::LINEAR) {
-            throw ModuleError("Charge collection from implant region should not be used with linear electric fields.");
+        for(const auto& detector : getDetectors()) {
+            if(detector->getElectricFieldType() == FieldType::LINEAR) {
+                throw ModuleError("Charge collection from implant region should not be used with linear electric fields.");
+            }
         }
         LOG(INFO) << "Collecting charges from implants";
     } else if(!model->getImplants().empty()) {
-        LOG(WARNING) << "Detector " << detector_->getName() << " of type " << model->getType()
-                     << " has implants defined but collecting charge carriers from full sensor surface";
+        for(const auto& detector : getDetectors()) {
+            LOG(WARNING) << "Detector " << detector->getName() << " of type " << model->getType()
+                         << " has implants defined but collecting charge carriers from full sensor surface";
+        }
+    }
+
+    if(multiple_detectors_) {
+        LOG(INFO) << "Transferring charges of " << getDetectors().size() << " detectors of type " << model->getType();
     }
 
     if(output_plots_) {
@@ -88,13 +107,24 @@ void SimpleTransferModule::initialize() {
 }
 
 void SimpleTransferModule::run(Event* event) {
-    auto propagated_message = messenger_->fetchMessage<PropagatedChargeMessage>(this, event);
+    // Only detectors with propagated charges in this event are processed
+    if(multiple_detectors_) {
+        for(const auto& propagated_message : messenger_->fetchMultiMessage<PropagatedChargeMessage>(this, event)) {
+            transfer(*propagated_message, event);
+        }
+    } else {
+        transfer(*messenger_->fetchMessage<PropagatedChargeMessage>(this, event), event);
+    }
+}
+
+void SimpleTransferModule::transfer(const PropagatedChargeMessage& propagated_message, Event* event) {
+    auto detector = propagated_message.getDetector();
 
     // Find corresponding pixels for all propagated charges
-    LOG(TRACE) << "Transferring charges to pixels";
+    LOG(TRACE) << "Transferring charges to pixels of detector " << detector->getName();
     unsigned int transferred_charges_count = 0;
-    std::map<Pixel::Index, std::vector<const PropagatedCharge*>> pixel_map;
-    for(const auto& propagated_charge : propagated_message->getData()) {
+    auto& transfers = scratch<std::vector<std::pair<Pixel::Index, const PropagatedCharge*>>>();
+    for(const auto& propagated_charge : propagated_message.getData()) {
         auto position = propagated_charge.getLocalPosition();
 
         if(collect_from_implant_) {
@@ -146,31 +176,65 @@ void SimpleTransferModule::run(Event* event) {
                    << pixel_index;
 
         // Add the pixel the list of hit pixels
-        pixel_map[pixel_index].emplace_back(&propagated_charge);
+        transfers.emplace_back(pixel_index, &propagated_charge);
+    }
+
+    // Accumulate the charge in a dense buffer covering all hit pixels, ordered like the pixel map. Widely separated pixels,
+    // for which the buffer would be much larger than the number of propagated charges, use the map
+    int min_x = std::numeric_limits<int>::max(), min_y = std::numeric_limits<int>::max();
+    int max_x = std::numeric_limits<int>::min(), max_y = std::numeric_limits<int>::min();
+    for(const auto& transfer : transfers) {
+        min_x = std::min(min_x, transfer.first.x());
+        max_x = std::max(max_x, transfer.first.x());
+        min_y = std::min(min_y, transfer.first.y());
+        max_y = std::max(max_y, transfer.first.y());
+    }
+    auto width = (max_x >= min_x ? static_cast<size_t>(max_x - min_x) + 1 : 0);
+    auto height = (max_y >= min_y ? static_cast<size_t>(max_y - min_y) + 1 : 0);
+    auto dense = (width * height <= std::max<size_t>(4096, 4 * transfers.size()));
+
+    auto& pixel_buffer = scratch<std::vector<PixelSum>>();
+    std::map<Pixel::Index, PixelSum> pixel_map;
+    if(dense) {
+        pixel_buffer.resize(width * height);
+    }
+    for(const auto& [pixel_index, propagated_charge] : transfers) {
+        auto& sum = (dense ? pixel_buffer[static_cast<size_t>(pixel_index.x() - min_x) * height +
+                                          static_cast<size_t>(pixel_index.y() - min_y)]
+                           : pixel_map[pixel_index]);
+        sum.charge += propagated_charge->getSign() * propagated_charge->getCharge();
+        sum.propagated_charges.push_back(propagated_charge);
     }
 
     // Create pixel charges
     LOG(TRACE) << "Combining charges at same pixel";
     std::vector<PixelCharge> pixel_charges;
-    for(auto& pixel_index_charge : pixel_map) {
-        long charge = 0;
-        for(auto& propagated_charge : pixel_index_charge.second) {
-            charge += propagated_charge->getSign() * propagated_charge->getCharge();
-        }
-
+    auto create_pixel_charge = [&](const Pixel::Index& pixel_index, const PixelSum& sum) {
         // Get pixel object from detector
-        auto pixel = detector_->getPixel(pixel_index_charge.first.x(), pixel_index_charge.first.y());
-
-        pixel_charges.emplace_back(pixel, charge, pixel_index_charge.second);
-        LOG(DEBUG) << "Set of " << charge << " charges combined at " << pixel.getIndex();
+        auto pixel = detector->getPixel(pixel_index.x(), pixel_index.y());
+
+        pixel_charges.emplace_back(pixel, sum.charge, sum.propagated_charges);
+        LOG(DEBUG) << "Set of " << sum.charge << " charges combined at " << pixel.getIndex();
+    };
+    if(dense) {
+        for(size_t i = 0; i < pixel_buffer.size(); ++i) {
+            if(!pixel_buffer[i].propagated_charges.empty()) {
+                create_pixel_charge(Pixel::Index(min_x + static_cast<int>(i / height), min_y + static_cast<int>(i % height)),
+                                    pixel_buffer[i]);
+            }
+        }
+    } else {
+        for(const auto& [pixel_index, sum] : pixel_map) {
+            create_pixel_charge(pixel_index, sum);
+        }
     }
 
     // Writing summary and update statistics
-    LOG(INFO) << "Transferred " << transferred_charges_count << " charges to " << pixel_map.size() << " pixels";
+    LOG(INFO) << "Transferred " << transferred_charges_count << " charges to " << pixel_charges.size() << " pixels";
     total_transferred_charges_ += transferred_charges_count;
 
     // Dispatch message of pixel charges
-    auto pixel_message = std::make_shared<PixelChargeMessage>(pixel_charges, detector_);
+    auto pixel_message = event->makeShared<PixelChargeMessage>(pixel_charges, detector);
     messenger_->dispatchMessage(this, pixel_message, event);
 }
 
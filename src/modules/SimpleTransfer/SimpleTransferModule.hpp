@@ -64,6 +64,13 @@ namespace allpix {
         void finalize() override;
 
     private:
+        /**
+         * @brief Transfer the propagated charges of a detector to its pixels and dispatch them
+         * @param propagated_message Message with the propagated charges of the detector
+         * @param event Pointer to the event
+         */
+        void transfer(const PropagatedChargeMessage& propagated_message, Event* event);
+
         Messenger* messenger_;
 
         std::shared_ptr<Detector> detector_;
@@ -71,6 +78,9 @@ namespace allpix {
 
         Histogram<TH1D> drift_time_histo;
 
+        // Flag whether this instance handles all detectors of the model
+        bool multiple_detectors_{};
+
         // Configuration parameters:
         double max_depth_distance_{};
         bool collect_from_implant_{};
@@ -80,5 +90,11 @@ namespace allpix {
 
         // Statistical information
         std::atomic<unsigned int> total_transferred_charges_{};
+
+        // Charge and history accumulated at a pixel
+        struct PixelSum {
+            long charge{};
+            std::vector<const PropagatedCharge*> propagated_charges;
+        };
     };
 } // namespace allpix
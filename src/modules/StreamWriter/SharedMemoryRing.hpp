@@ -0,0 +1,277 @@
+/**
+ * @file
+ * @brief Definition of a single-producer single-consumer ring buffer of messages in POSIX shared memory
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef ALLPIX_SHARED_MEMORY_RING_H
+#define ALLPIX_SHARED_MEMORY_RING_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace allpix {
+    /**
+     * @brief Ring buffer of messages in a named POSIX shared memory segment
+     *
+     * The segment holds a control block followed by the data area. Every message is stored as its size in bytes followed
+     * by its content, wrapping around at the end of the data area. The positions of the producer and the consumer are
+     * monotonically increasing byte counters, such that the buffer is empty if they are equal. The producer blocks while
+     * the buffer does not have sufficient space for the next message, and the consumer blocks while it is empty. The stream
+     * is closed by the producer once the last message has been written.
+     *
+     * The class does not depend on the framework, such that consumer processes can include it to attach to the segment
+     * created by the StreamWriter module. Only a single producer and a single consumer are supported.
+     */
+    class SharedMemoryRing {
+    public:
+        /**
+         * @brief Create a new segment as producer, replacing any existing segment of the same name
+         * @param name Name of the shared memory segment
+         * @param capacity Size of the data area in bytes
+         * @throws std::runtime_error If the segment cannot be created
+         */
+        static std::unique_ptr<SharedMemoryRing> create(const std::string& name, std::uint64_t capacity) {
+            auto path = segment_path(name);
+            shm_unlink(path.c_str());
+            auto fd = shm_open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+            if(fd < 0) {
+                throw std::runtime_error("cannot create shared memory segment " + path + ": " + std::strerror(errno));
+            }
+            auto size = data_offset + capacity;
+            if(ftruncate(fd, static_cast<off_t>(size)) != 0) {
+                auto error = std::string(std::strerror(errno));
+                close(fd);
+                shm_unlink(path.c_str());
+                throw std::runtime_error("cannot allocate " + std::to_string(size) + " bytes of shared memory: " + error);
+            }
+
+            auto ring = std::unique_ptr<SharedMemoryRing>(new SharedMemoryRing(path, fd, size, true));
+            ring->control_->capacity = capacity;
+            ring->control_->head.store(0);
+            ring->control_->tail.store(0);
+            ring->control_->closed.store(0);
+            ring->control_->consumers.store(0);
+            ring->control_->version = version;
+            // The magic number is written last, marking the segment as ready to be attached to
+            std::atomic_thread_fence(std::memory_order_release);
+            ring->control_->magic = magic;
+            return ring;
+        }
+
+        /**
+         * @brief Attach to an existing segment as consumer
+         * @param name Name of the shared memory segment
+         * @throws std::runtime_error If the segment does not exist or has not been created by a producer
+         */
+        static std::unique_ptr<SharedMemoryRing> attach(const std::string& name) {
+            auto path = segment_path(name);
+            auto fd = shm_open(path.c_str(), O_RDWR, 0);
+            if(fd < 0) {
+                throw std::runtime_error("cannot open shared memory segment " + path + ": " + std::strerror(errno));
+            }
+            struct stat status {};
+            if(fstat(fd, &status) != 0 || static_cast<std::uint64_t>(status.st_size) < data_offset) {
+                close(fd);
+                throw std::runtime_error("shared memory segment " + path + " is not initialized");
+            }
+
+            // The consumer is counted on construction and released on destruction, also if the segment is rejected
+            auto ring = std::unique_ptr<SharedMemoryRing>(
+                new SharedMemoryRing(path, fd, static_cast<std::uint64_t>(status.st_size), false));
+            ring->control_->consumers.fetch_add(1);
+            if(ring->control_->magic != magic || ring->control_->version != version ||
+               data_offset + ring->control_->capacity != ring->size_) {
+                throw std::runtime_error("shared memory segment " + path + " does not hold a compatible ring buffer");
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return ring;
+        }
+
+        ~SharedMemoryRing() {
+            if(!owner_) {
+                control_->consumers.fetch_sub(1);
+            }
+            munmap(control_, size_);
+            close(fd_);
+            if(owner_) {
+                shm_unlink(path_.c_str());
+            }
+        }
+
+        SharedMemoryRing(const SharedMemoryRing&) = delete;
+        SharedMemoryRing& operator=(const SharedMemoryRing&) = delete;
+
+        /**
+         * @brief Write a message, waiting for the consumer to free sufficient space
+         * @param data Content of the message
+         * @param size Size of the message in bytes
+         * @param timeout Maximum time to wait for free space, zero to wait indefinitely
+         * @return True if the message has been written, false if the timeout expired
+         * @throws std::runtime_error If the message is larger than the buffer
+         */
+        bool write(const char* data, std::uint64_t size, std::chrono::nanoseconds timeout = {}) {
+            auto record = sizeof(std::uint64_t) + size;
+            if(record > control_->capacity) {
+                throw std::runtime_error("message of " + std::to_string(size) + " bytes exceeds the buffer size of " +
+                                         std::to_string(control_->capacity) + " bytes");
+            }
+
+            auto head = control_->head.load(std::memory_order_relaxed);
+            if(!wait(timeout, [&]() {
+                   return control_->capacity - (head - control_->tail.load(std::memory_order_acquire)) >= record;
+               })) {
+                return false;
+            }
+
+            copy_in(head, reinterpret_cast<const char*>(&size), sizeof(size));
+            copy_in(head + sizeof(size), data, size);
+            control_->head.store(head + record, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief Read the next message, waiting for the producer to write it
+         * @param message Buffer to store the content of the message in
+         * @param timeout Maximum time to wait for a message, zero to wait indefinitely
+         * @return True if a message has been read, false if the stream has ended or the timeout expired
+         */
+        bool read(std::vector<char>& message, std::chrono::nanoseconds timeout = {}) {
+            auto tail = control_->tail.load(std::memory_order_relaxed);
+            // The stream has ended if it is closed and no message is left after the close has been observed
+            if(!wait(timeout, [&]() {
+                   return control_->head.load(std::memory_order_acquire) != tail ||
+                          control_->closed.load(std::memory_order_acquire) != 0;
+               }) ||
+               control_->head.load(std::memory_order_acquire) == tail) {
+                return false;
+            }
+
+            std::uint64_t size = 0;
+            copy_out(tail, reinterpret_cast<char*>(&size), sizeof(size));
+            message.resize(size);
+            copy_out(tail + sizeof(size), message.data(), size);
+            control_->tail.store(tail + sizeof(size) + size, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief Mark the end of the stream, after which the consumer reads the remaining messages
+         */
+        void close_stream() { control_->closed.store(1, std::memory_order_release); }
+
+        /**
+         * @brief Wait until the consumer has read all messages
+         * @param timeout Maximum time to wait, zero to wait indefinitely
+         * @return True if all messages have been read, false if the timeout expired
+         */
+        bool drain(std::chrono::nanoseconds timeout = {}) {
+            return wait(timeout, [&]() {
+                return control_->tail.load(std::memory_order_acquire) == control_->head.load(std::memory_order_acquire);
+            });
+        }
+
+        /**
+         * @brief Get the number of consumers currently attached to the segment
+         */
+        unsigned int consumers() const { return control_->consumers.load(); }
+
+        /**
+         * @brief Get the size of the data area in bytes
+         */
+        std::uint64_t capacity() const { return control_->capacity; }
+
+    private:
+        // Identification of the segment layout, the magic number reads "APSR" in memory
+        static constexpr std::uint32_t magic = 0x52535041;
+        static constexpr std::uint32_t version = 1;
+
+        // Control block at the start of the segment, the positions are kept on separate cache lines
+        struct Control {
+            std::uint32_t magic;
+            std::uint32_t version;
+            std::uint64_t capacity;
+            std::atomic<std::uint32_t> closed;
+            std::atomic<std::uint32_t> consumers;
+            alignas(64) std::atomic<std::uint64_t> head;
+            alignas(64) std::atomic<std::uint64_t> tail;
+        };
+        static_assert(std::atomic<std::uint64_t>::is_always_lock_free && std::atomic<std::uint32_t>::is_always_lock_free,
+                      "atomics in shared memory have to be lock-free");
+        static constexpr std::uint64_t data_offset = (sizeof(Control) + 63) / 64 * 64;
+
+        SharedMemoryRing(std::string path, int fd, std::uint64_t size, bool owner)
+            : path_(std::move(path)), fd_(fd), size_(size), owner_(owner) {
+            auto* address = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+            if(address == MAP_FAILED) {
+                auto error = std::string(std::strerror(errno));
+                close(fd_);
+                if(owner_) {
+                    shm_unlink(path_.c_str());
+                }
+                throw std::runtime_error("cannot map shared memory segment " + path_ + ": " + error);
+            }
+            control_ = static_cast<Control*>(address);
+            data_ = static_cast<char*>(address) + data_offset;
+        }
+
+        // Segment names have to start with a single slash
+        static std::string segment_path(const std::string& name) { return (name.front() == '/' ? name : "/" + name); }
+
+        // Poll the condition with a sleep growing up to one millisecond
+        template <typename Condition> static bool wait(std::chrono::nanoseconds timeout, Condition condition) {
+            auto deadline = std::chrono::steady_clock::now() + timeout;
+            auto sleep = std::chrono::microseconds(1);
+            while(!condition()) {
+                if(timeout.count() > 0 && std::chrono::steady_clock::now() > deadline) {
+                    return false;
+                }
+                std::this_thread::sleep_for(sleep);
+                sleep = std::min(sleep * 2, std::chrono::microseconds(1000));
+            }
+            return true;
+        }
+
+        void copy_in(std::uint64_t position, const char* source, std::uint64_t size) {
+            auto offset = position % control_->capacity;
+            auto first = std::min(size, control_->capacity - offset);
+            std::memcpy(data_ + offset, source, first);
+            std::memcpy(data_, source + first, size - first);
+        }
+        void copy_out(std::uint64_t position, char* destination, std::uint64_t size) const {
+            auto offset = position % control_->capacity;
+            auto first = std::min(size, control_->capacity - offset);
+            std::memcpy(destination, data_ + offset, first);
+            std::memcpy(destination + first, data_, size - first);
+        }
+
+        std::string path_;
+        int fd_;
+        std::uint64_t size_;
+        bool owner_;
+        Control* control_{nullptr};
+        char* data_{nullptr};
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_SHARED_MEMORY_RING_H */
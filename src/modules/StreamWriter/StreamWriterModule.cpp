@@ -0,0 +1,344 @@
+/**
+ * @file
+ * @brief Implementation of module streaming pixel hits to online consumers via shared memory or ZeroMQ
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "StreamWriterModule.hpp"
+
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#if ALLPIX_STREAM_ZMQ
+#include <cerrno>
+
+#include <zmq.h>
+#endif
+
+#include "core/config/exceptions.h"
+#include "core/messenger/exceptions.h"
+#include "core/module/exceptions.h"
+#include "core/utils/log.h"
+#include "core/utils/unit.h"
+
+using namespace allpix;
+
+namespace {
+    // Identification of the message format, the magic number reads "APSQ" in memory
+    constexpr std::uint32_t magic = 0x51535041;
+    constexpr std::uint16_t format_version = 1;
+
+    // Types of the messages of a stream
+    constexpr std::uint16_t message_run = 1;
+    constexpr std::uint16_t message_event = 2;
+    constexpr std::uint16_t message_end = 3;
+
+    // Flags of an event message
+    constexpr std::uint16_t flag_truth = 1;
+
+    /**
+     * @brief Append a value in the byte order of the host
+     */
+    template <typename T> void put(std::vector<char>& buffer, T value) {
+        auto size = buffer.size();
+        buffer.resize(size + sizeof(T));
+        std::memcpy(buffer.data() + size, &value, sizeof(T));
+    }
+
+    /**
+     * @brief Overwrite a value appended before, used for counts only known after serializing the counted entries
+     */
+    template <typename T> void put_at(std::vector<char>& buffer, size_t position, T value) {
+        std::memcpy(buffer.data() + position, &value, sizeof(T));
+    }
+
+    /**
+     * @brief Append a string preceded by its length
+     */
+    void put_string(std::vector<char>& buffer, const std::string& value) {
+        put<std::uint16_t>(buffer, static_cast<std::uint16_t>(value.size()));
+        buffer.insert(buffer.end(), value.begin(), value.end());
+    }
+
+    /**
+     * @brief Append a point as three single precision coordinates
+     */
+    void put_point(std::vector<char>& buffer, const ROOT::Math::XYZPoint& point) {
+        put<float>(buffer, static_cast<float>(point.x()));
+        put<float>(buffer, static_cast<float>(point.y()));
+        put<float>(buffer, static_cast<float>(point.z()));
+    }
+} // namespace
+
+StreamWriterModule::StreamWriterModule(Configuration& config, Messenger* messenger, GeometryManager* geo_mgr)
+    : SequentialModule(config), messenger_(messenger), geo_mgr_(geo_mgr) {
+    // Enable multithreading of this module if multithreading is enabled
+    allow_multithreading();
+    // Streaming to the consumers is not visible to the framework
+    declare_side_effects();
+
+    config_.setDefault<Transport>("transport", Transport::SHM);
+    config_.setDefault<std::string>("shm_name", "allpix_stream");
+    config_.setDefault<std::uint64_t>("buffer_size", 64 * 1024 * 1024);
+    config_.setDefault<std::string>("endpoint", "tcp://*:5555");
+    config_.setDefault<int>("high_water_mark", 1000);
+    config_.setDefault<bool>("include_truth", false);
+    config_.setDefault<double>("timeout", 0);
+    config_.setDefault<bool>("wait_for_consumer", false);
+
+    transport_ = config_.get<Transport>("transport");
+#if !ALLPIX_STREAM_ZMQ
+    if(transport_ == Transport::ZMQ) {
+        throw InvalidValueError(config_, "transport", "module has been built without ZeroMQ support");
+    }
+#endif
+    include_truth_ = config_.get<bool>("include_truth");
+    auto timeout = config_.get<double>("timeout");
+    if(timeout < 0) {
+        throw InvalidValueError(config_, "timeout", "timeout cannot be negative");
+    }
+    timeout_ = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double, std::nano>(timeout));
+
+    // Events without pixel hits are streamed as well, such that the consumer receives every event
+    messenger_->bindMulti<PixelHitMessage>(this, MsgFlags::NONE);
+    if(include_truth_) {
+        messenger_->bindMulti<MCParticleMessage>(this, MsgFlags::NONE);
+    }
+}
+
+StreamWriterModule::~StreamWriterModule() {
+#if ALLPIX_STREAM_ZMQ
+    if(zmq_socket_ != nullptr) {
+        zmq_close(zmq_socket_);
+    }
+    if(zmq_context_ != nullptr) {
+        zmq_ctx_term(zmq_context_);
+    }
+#endif
+}
+
+void StreamWriterModule::initialize() {
+    if(transport_ == Transport::SHM) {
+        auto name = config_.get<std::string>("shm_name");
+        if(name.empty() || name.find('/', 1) != std::string::npos) {
+            throw InvalidValueError(config_, "shm_name", "name of the segment cannot be empty or contain slashes");
+        }
+        auto buffer_size = config_.get<std::uint64_t>("buffer_size");
+        if(buffer_size < 1024) {
+            throw InvalidValueError(config_, "buffer_size", "buffer has to hold at least 1 KiB");
+        }
+        try {
+            ring_ = SharedMemoryRing::create(name, buffer_size);
+        } catch(std::runtime_error& e) {
+            throw InvalidValueError(config_, "shm_name", e.what());
+        }
+        LOG(INFO) << "Streaming events through shared memory segment " << name << " of " << buffer_size << " bytes";
+    }
+#if ALLPIX_STREAM_ZMQ
+    else if(transport_ == Transport::ZMQ) {
+        auto endpoint = config_.get<std::string>("endpoint");
+        auto high_water_mark = config_.get<int>("high_water_mark");
+        if(high_water_mark <= 0) {
+            throw InvalidValueError(config_, "high_water_mark", "number of queued messages has to be positive");
+        }
+
+        // Sending blocks once the queue of the socket is full, which provides the backpressure into the event loop
+        zmq_context_ = zmq_ctx_new();
+        zmq_socket_ = zmq_socket(zmq_context_, ZMQ_PUSH);
+        int linger = 0;
+        zmq_setsockopt(zmq_socket_, ZMQ_SNDHWM, &high_water_mark, sizeof(high_water_mark));
+        zmq_setsockopt(zmq_socket_, ZMQ_LINGER, &linger, sizeof(linger));
+        if(timeout_.count() > 0) {
+            auto timeout = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(timeout_).count());
+            zmq_setsockopt(zmq_socket_, ZMQ_SNDTIMEO, &timeout, sizeof(timeout));
+        }
+        if(zmq_bind(zmq_socket_, endpoint.c_str()) != 0) {
+            throw InvalidValueError(config_, "endpoint", "cannot bind socket: " + std::string(zmq_strerror(zmq_errno())));
+        }
+        LOG(INFO) << "Streaming events through ZeroMQ socket bound to " << endpoint;
+    }
+#endif
+
+    // The run description lists the detectors in the order their index refers to in the event messages
+    auto detectors = geo_mgr_->getDetectors();
+    std::vector<char> buffer;
+    begin_message(buffer, message_run);
+    put<std::uint16_t>(buffer, static_cast<std::uint16_t>(detectors.size()));
+    for(const auto& detector : detectors) {
+        auto model = detector->getModel();
+        auto index = static_cast<std::uint16_t>(detector_index_.size());
+        detector_index_[detector->getName()] = index;
+        put_string(buffer, detector->getName());
+        put_string(buffer, detector->getType());
+        put<std::uint32_t>(buffer, model->getNPixels().x());
+        put<std::uint32_t>(buffer, model->getNPixels().y());
+        put<float>(buffer, static_cast<float>(model->getPixelSize().x()));
+        put<float>(buffer, static_cast<float>(model->getPixelSize().y()));
+    }
+    send(buffer);
+}
+
+void StreamWriterModule::run(Event* event) {
+    std::vector<std::shared_ptr<PixelHitMessage>> hit_messages;
+    try {
+        hit_messages = messenger_->fetchMultiMessage<PixelHitMessage>(this, event);
+    } catch(const MessageNotFoundException&) {
+        LOG(TRACE) << "No pixel hits received, streaming empty event";
+    }
+
+    // The particles are matched to the hits through the detector they have been dispatched for
+    std::map<std::string, const std::vector<MCParticle>*> particles;
+    if(include_truth_) {
+        try {
+            for(const auto& message : messenger_->fetchMultiMessage<MCParticleMessage>(this, event)) {
+                particles[message->getDetector()->getName()] = &message->getData();
+            }
+        } catch(const MessageNotFoundException&) {
+            LOG(TRACE) << "No Monte Carlo particles received";
+        }
+    }
+
+    buffer_.clear();
+    begin_message(buffer_, message_event);
+    put<std::uint64_t>(buffer_, event->number);
+    put<std::uint16_t>(buffer_, include_truth_ ? flag_truth : 0);
+    put<std::uint16_t>(buffer_, static_cast<std::uint16_t>(hit_messages.size()));
+
+    std::uint64_t hits = 0;
+    for(const auto& message : hit_messages) {
+        const auto& detector = message->getDetector()->getName();
+        const auto& pixel_hits = message->getData();
+        put<std::uint16_t>(buffer_, detector_index_.at(detector));
+        put<std::uint32_t>(buffer_, static_cast<std::uint32_t>(pixel_hits.size()));
+        for(const auto& hit : pixel_hits) {
+            auto index = hit.getIndex();
+            put<std::int32_t>(buffer_, index.x());
+            put<std::int32_t>(buffer_, index.y());
+            put<float>(buffer_, static_cast<float>(hit.getSignal()));
+            put<float>(buffer_, static_cast<float>(hit.getLocalTime()));
+            put<float>(buffer_, static_cast<float>(hit.getGlobalTime()));
+        }
+        hits += pixel_hits.size();
+
+        if(!include_truth_) {
+            continue;
+        }
+
+        // Particles of the detector followed by the indices of the particles linked to every hit
+        std::unordered_map<const MCParticle*, std::uint32_t> particle_index;
+        auto detector_particles = particles.find(detector);
+        if(detector_particles == particles.end()) {
+            put<std::uint32_t>(buffer_, 0);
+        } else {
+            const auto& mc_particles = *detector_particles->second;
+            put<std::uint32_t>(buffer_, static_cast<std::uint32_t>(mc_particles.size()));
+            for(const auto& particle : mc_particles) {
+                auto index = static_cast<std::uint32_t>(particle_index.size());
+                particle_index[&particle] = index;
+                put<std::int32_t>(buffer_, particle.getParticleID());
+                put_point(buffer_, particle.getLocalStartPoint());
+                put_point(buffer_, particle.getLocalEndPoint());
+                put<float>(buffer_, static_cast<float>(particle.getGlobalTime()));
+            }
+        }
+        for(const auto& hit : pixel_hits) {
+            auto count_position = buffer_.size();
+            std::uint16_t count = 0;
+            put<std::uint16_t>(buffer_, count);
+            for(const auto* particle : hit.getMCParticles()) {
+                auto index = particle_index.find(particle);
+                if(index != particle_index.end() && count < std::numeric_limits<std::uint16_t>::max()) {
+                    put<std::uint32_t>(buffer_, index->second);
+                    ++count;
+                }
+            }
+            put_at<std::uint16_t>(buffer_, count_position, count);
+        }
+    }
+
+    send(buffer_);
+    sent_events_++;
+    sent_hits_ += hits;
+    LOG(DEBUG) << "Streamed " << hits << " pixel hits in message of " << buffer_.size() << " bytes";
+}
+
+void StreamWriterModule::finalize() {
+    std::vector<char> buffer;
+    begin_message(buffer, message_end);
+    put<std::uint64_t>(buffer, sent_events_);
+    send(buffer);
+
+    if(ring_ != nullptr) {
+        ring_->close_stream();
+        if(config_.get<bool>("wait_for_consumer")) {
+            LOG(INFO) << "Waiting for the consumer to read all messages";
+            auto start = std::chrono::steady_clock::now();
+            if(!ring_->drain(timeout_)) {
+                LOG(WARNING) << "Consumer has not read all messages within the timeout";
+            }
+            blocked_time_ += std::chrono::steady_clock::now() - start;
+        }
+        // Consumers which are still attached keep the segment until they detach
+        ring_.reset();
+    }
+#if ALLPIX_STREAM_ZMQ
+    if(zmq_socket_ != nullptr) {
+        // Closing the socket delivers the queued messages, the linger period is limited by the timeout
+        int linger = (config_.get<bool>("wait_for_consumer")
+                          ? (timeout_.count() > 0
+                                 ? static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(timeout_).count())
+                                 : -1)
+                          : 0);
+        zmq_setsockopt(zmq_socket_, ZMQ_LINGER, &linger, sizeof(linger));
+        zmq_close(zmq_socket_);
+        zmq_socket_ = nullptr;
+        zmq_ctx_term(zmq_context_);
+        zmq_context_ = nullptr;
+    }
+#endif
+
+    auto blocked = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(blocked_time_).count());
+    LOG(STATUS) << "Streamed " << sent_hits_ << " pixel hits of " << sent_events_ << " events in " << sent_bytes_
+                << " bytes, waited " << Units::display(blocked, {"us", "ms", "s"}) << " for the consumer";
+}
+
+void StreamWriterModule::begin_message(std::vector<char>& buffer, std::uint16_t type) {
+    put<std::uint32_t>(buffer, magic);
+    put<std::uint16_t>(buffer, format_version);
+    put<std::uint16_t>(buffer, type);
+}
+
+void StreamWriterModule::send(const std::vector<char>& buffer) {
+    auto start = std::chrono::steady_clock::now();
+    bool sent = true;
+    if(ring_ != nullptr) {
+        try {
+            sent = ring_->write(buffer.data(), buffer.size(), timeout_);
+        } catch(std::runtime_error& e) {
+            throw ModuleError("Cannot stream message: " + std::string(e.what()) + ", increase the buffer_size");
+        }
+    }
+#if ALLPIX_STREAM_ZMQ
+    if(zmq_socket_ != nullptr) {
+        sent = (zmq_send(zmq_socket_, buffer.data(), buffer.size(), 0) >= 0);
+        if(!sent && zmq_errno() != EAGAIN) {
+            throw ModuleError("Cannot stream message: " + std::string(zmq_strerror(zmq_errno())));
+        }
+    }
+#endif
+    blocked_time_ += std::chrono::steady_clock::now() - start;
+    if(!sent) {
+        throw ModuleError("Consumer has not accepted message within " +
+                          Units::display(static_cast<double>(timeout_.count()), {"ms", "s"}));
+    }
+    sent_bytes_ += buffer.size();
+}
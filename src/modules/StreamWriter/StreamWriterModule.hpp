@@ -0,0 +1,109 @@
+/**
+ * @file
+ * @brief Definition of module streaming pixel hits to online consumers via shared memory or ZeroMQ
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/config/Configuration.hpp"
+#include "core/geometry/GeometryManager.hpp"
+#include "core/messenger/Messenger.hpp"
+#include "core/module/Event.hpp"
+#include "core/module/Module.hpp"
+
+#include "objects/MCParticle.hpp"
+#include "objects/PixelHit.hpp"
+
+#include "SharedMemoryRing.hpp"
+
+namespace allpix {
+    /**
+     * @ingroup Modules
+     * @brief Module to stream the pixel hits of every event to an online consumer
+     * @note This module supports multithreading
+     *
+     * Serializes the pixel hits and optionally the Monte Carlo truth of every event into a compact binary message and
+     * publishes it either through a ring buffer in shared memory or a ZeroMQ socket. Messages are sent in order of the event
+     * numbers. If the consumer does not keep up, sending blocks and thereby stalls the event loop.
+     */
+    class StreamWriterModule : public SequentialModule {
+    public:
+        /**
+         * @brief Transports to publish the messages through
+         */
+        enum class Transport {
+            SHM, ///< Ring buffer in a POSIX shared memory segment
+            ZMQ, ///< ZeroMQ PUSH socket
+        };
+
+        /**
+         * @brief Constructor for this unique module
+         * @param config Configuration object for this module as retrieved from the steering file
+         * @param messenger Pointer to the messenger object to allow binding to messages on the bus
+         * @param geo_mgr Pointer to the geometry manager, containing the detectors
+         */
+        StreamWriterModule(Configuration& config, Messenger* messenger, GeometryManager* geo_mgr);
+        ~StreamWriterModule() override;
+
+        /**
+         * @brief Open the transport and publish the description of the detectors
+         */
+        void initialize() override;
+
+        /**
+         * @brief Serialize the pixel hits of the event and publish them
+         */
+        void run(Event* event) override;
+
+        /**
+         * @brief Publish the end of the stream and close the transport
+         */
+        void finalize() override;
+
+    private:
+        /**
+         * @brief Append the common header of all messages
+         */
+        static void begin_message(std::vector<char>& buffer, std::uint16_t type);
+
+        /**
+         * @brief Send a message, blocking until it has been accepted by the transport
+         * @throws ModuleError If the message could not be sent within the configured timeout
+         */
+        void send(const std::vector<char>& buffer);
+
+        Messenger* messenger_;
+        GeometryManager* geo_mgr_;
+
+        Transport transport_{Transport::SHM};
+        bool include_truth_{false};
+        std::chrono::nanoseconds timeout_{};
+
+        // Index of every detector in the run description, used to identify the detectors in the event messages
+        std::map<std::string, std::uint16_t> detector_index_;
+
+        std::unique_ptr<SharedMemoryRing> ring_;
+        void* zmq_context_{nullptr};
+        void* zmq_socket_{nullptr};
+
+        // Reused serialization buffer, the events are processed sequentially
+        std::vector<char> buffer_;
+
+        // Statistics of the stream
+        std::uint64_t sent_events_{};
+        std::uint64_t sent_hits_{};
+        std::uint64_t sent_bytes_{};
+        std::chrono::steady_clock::duration blocked_time_{};
+    };
+} // namespace allpix
@@ -0,0 +1,342 @@
+/**
+ * @file
+ * @brief Implementation of module accumulating summary statistics of the pixel hits and clusters instead of writing them
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "SummaryWriterModule.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <tuple>
+#include <utility>
+
+#include <TH1D.h>
+#include <TH2D.h>
+#include <TTree.h>
+
+#include "core/config/exceptions.h"
+#include "core/messenger/exceptions.h"
+#include "core/utils/log.h"
+#include "core/utils/unit.h"
+
+#include "tools/ROOT.h"
+#include "tools/pixel_clustering.h"
+
+using namespace allpix;
+
+namespace {
+    // Key of a pixel index in the sparse map of the pixels
+    std::uint64_t pixel_key(int x, int y) {
+        return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(x)) << 32) | static_cast<std::uint32_t>(y);
+    }
+    std::pair<int, int> pixel_index(std::uint64_t key) {
+        return {static_cast<int>(static_cast<std::uint32_t>(key >> 32)), static_cast<int>(static_cast<std::uint32_t>(key))};
+    }
+} // namespace
+
+SummaryWriterModule::SummaryWriterModule(Configuration& config, Messenger* messenger, std::shared_ptr<Detector> detector)
+    : Module(config, detector), messenger_(messenger), detector_(std::move(detector)) {
+    // Enable multithreading of this module if multithreading is enabled
+    allow_multithreading();
+
+    // Save detector model
+    model_ = detector_->getModel();
+
+    // Set default values for config variables
+    config_.setDefault<std::string>("file_name", "summary");
+    config_.setDefault<bool>("pixel_spectra", false);
+    config_.setDefault<bool>("efficiency", false);
+    config_.setDefault<unsigned int>("spectrum_bins", 100);
+    config_.setDefault<double>("max_signal", Units::get(50., "ke"));
+    config_.setDefault<unsigned int>("max_cluster_size", 20);
+    config_.setDefault<ROOT::Math::XYVector>("matching_cut", model_->getPixelSize() * 3);
+
+    pixel_spectra_ = config_.get<bool>("pixel_spectra");
+    efficiency_ = config_.get<bool>("efficiency");
+    spectrum_bins_ = config_.get<unsigned int>("spectrum_bins");
+    if(spectrum_bins_ == 0) {
+        throw InvalidValueError(config_, "spectrum_bins", "number of bins has to be positive");
+    }
+    max_signal_ = config_.get<double>("max_signal");
+    if(max_signal_ <= 0) {
+        throw InvalidValueError(config_, "max_signal", "upper edge of the spectra has to be positive");
+    }
+    max_cluster_size_ = config_.get<unsigned int>("max_cluster_size");
+    if(max_cluster_size_ == 0) {
+        throw InvalidValueError(config_, "max_cluster_size", "maximum cluster size has to be positive");
+    }
+    matching_cut_ = config_.get<ROOT::Math::XYVector>("matching_cut");
+
+    // Require the pixel hits of the detector, the particles are only required for the efficiency
+    messenger_->bindSingle<PixelHitMessage>(this, efficiency_ ? MsgFlags::NONE : MsgFlags::REQUIRED);
+    if(efficiency_) {
+        messenger_->bindSingle<MCParticleMessage>(this, MsgFlags::REQUIRED);
+    }
+}
+
+void SummaryWriterModule::initialize() {
+    file_name_ = createOutputFile(config_.get<std::string>("file_name"), "root");
+    output_file_ = std::make_unique<TFile>(file_name_.c_str(), "RECREATE");
+    if(output_file_->IsZombie()) {
+        throw ModuleError("Cannot create output file " + file_name_);
+    }
+}
+
+SummaryWriterModule::ThreadSummary& SummaryWriterModule::get_thread_summary() {
+    std::lock_guard<std::mutex> lock(thread_summaries_mutex_);
+    auto& summary = thread_summaries_[std::this_thread::get_id()];
+    if(summary == nullptr) {
+        LOG(DEBUG) << "Creating summary for thread " << std::this_thread::get_id();
+        summary = std::make_unique<ThreadSummary>();
+        summary->cluster_sizes.resize(max_cluster_size_ + 1);
+        summary->cluster_spectrum.resize(spectrum_bins_);
+    }
+    return *summary;
+}
+
+size_t SummaryWriterModule::get_spectrum_bin(double signal) const {
+    auto bin = std::floor(std::max(signal, 0.) / max_signal_ * static_cast<double>(spectrum_bins_));
+    return std::min(static_cast<size_t>(bin), spectrum_bins_ - 1);
+}
+
+void SummaryWriterModule::run(Event* event) {
+    auto& summary = get_thread_summary();
+    events_++;
+
+    std::shared_ptr<PixelHitMessage> pixels_message;
+    try {
+        pixels_message = messenger_->fetchMessage<PixelHitMessage>(this, event);
+    } catch(const MessageNotFoundException&) {
+        // Events without hits only contribute to the efficiency
+    }
+
+    // Accumulate the statistics of the hit pixels
+    std::vector<ROOT::Math::XYZPoint> cluster_positions;
+    if(pixels_message != nullptr) {
+        for(const auto& pixel_hit : pixels_message->getData()) {
+            auto index = pixel_hit.getIndex();
+            auto& pixel = summary.pixels[pixel_key(index.x(), index.y())];
+            auto signal = pixel_hit.getSignal();
+            pixel.hits++;
+            pixel.signal += signal;
+            pixel.signal_squared += signal * signal;
+            if(pixel_spectra_) {
+                pixel.spectrum.resize(spectrum_bins_);
+                pixel.spectrum[get_spectrum_bin(signal)]++;
+            }
+        }
+
+        // Accumulate the statistics of the clusters of neighboring pixels
+        PixelClustering clustering(model_);
+        for(const auto& cluster : clustering.cluster(pixels_message->getData())) {
+            double signal = 0;
+            ROOT::Math::XYZVector position;
+            for(const auto* pixel_hit : cluster) {
+                signal += pixel_hit->getSignal();
+                position += pixel_hit->getSignal() * ROOT::Math::XYZVector(pixel_hit->getPixel().getLocalCenter());
+            }
+            summary.clusters++;
+            summary.cluster_sizes[std::min(cluster.size(), max_cluster_size_)]++;
+            summary.cluster_spectrum[get_spectrum_bin(signal)]++;
+            summary.cluster_signal += signal;
+            summary.cluster_signal_squared += signal * signal;
+            if(efficiency_) {
+                // Fall back to the seed pixel for clusters without signal
+                cluster_positions.emplace_back(signal != 0 ? ROOT::Math::XYZPoint(position / signal)
+                                                           : cluster.front()->getPixel().getLocalCenter());
+            }
+        }
+    }
+
+    // Count the primary particles and the particles matched to a cluster for the pixel of their impact position
+    if(efficiency_) {
+        auto mcparticle_message = messenger_->fetchMessage<MCParticleMessage>(this, event);
+        for(const auto& particle : mcparticle_message->getData()) {
+            if(particle.getParent() != nullptr) {
+                continue;
+            }
+            auto position = particle.getLocalReferencePoint();
+            auto [xpixel, ypixel] = model_->getPixelIndex(position);
+            if(!model_->isWithinMatrix(xpixel, ypixel)) {
+                continue;
+            }
+            auto& pixel = summary.pixels[pixel_key(xpixel, ypixel)];
+            pixel.particles++;
+            if(std::any_of(cluster_positions.begin(), cluster_positions.end(), [&](const auto& cluster_position) {
+                   return std::fabs(cluster_position.x() - position.x()) <= matching_cut_.x() &&
+                          std::fabs(cluster_position.y() - position.y()) <= matching_cut_.y();
+               })) {
+                pixel.matched++;
+            }
+        }
+    }
+}
+
+void SummaryWriterModule::merge(ThreadSummary& target, const ThreadSummary& source) {
+    for(const auto& [key, source_pixel] : source.pixels) {
+        auto& pixel = target.pixels[key];
+        pixel.hits += source_pixel.hits;
+        pixel.signal += source_pixel.signal;
+        pixel.signal_squared += source_pixel.signal_squared;
+        pixel.spectrum.resize(std::max(pixel.spectrum.size(), source_pixel.spectrum.size()));
+        for(size_t bin = 0; bin < source_pixel.spectrum.size(); ++bin) {
+            pixel.spectrum[bin] += source_pixel.spectrum[bin];
+        }
+        pixel.particles += source_pixel.particles;
+        pixel.matched += source_pixel.matched;
+    }
+    for(size_t size = 0; size < source.cluster_sizes.size(); ++size) {
+        target.cluster_sizes[size] += source.cluster_sizes[size];
+    }
+    for(size_t bin = 0; bin < source.cluster_spectrum.size(); ++bin) {
+        target.cluster_spectrum[bin] += source.cluster_spectrum[bin];
+    }
+    target.clusters += source.clusters;
+    target.cluster_signal += source.cluster_signal;
+    target.cluster_signal_squared += source.cluster_signal_squared;
+}
+
+void SummaryWriterModule::finalize() {
+    // Merge the statistics of all threads
+    ThreadSummary summary;
+    summary.cluster_sizes.resize(max_cluster_size_ + 1);
+    summary.cluster_spectrum.resize(spectrum_bins_);
+    for(const auto& thread_summary : thread_summaries_) {
+        merge(summary, *thread_summary.second);
+    }
+    LOG(DEBUG) << "Merged summaries of " << thread_summaries_.size() << " threads";
+    thread_summaries_.clear();
+
+    output_file_->cd();
+    auto title = [&](const std::string& name, const std::string& axes = "") {
+        return name + " (" + detector_->getName() + ")" + axes;
+    };
+    auto npixels = model_->getNPixels();
+    auto max_signal = static_cast<double>(Units::convert(max_signal_, "ke"));
+
+    // Sorted list of the pixels with non-zero statistics and their sums, from which the merged results of several runs
+    // can be calculated
+    int x = 0, y = 0;
+    ULong64_t hits = 0, particles = 0, matched = 0;
+    double signal = 0, signal_squared = 0;
+    std::vector<std::uint32_t> spectrum;
+    auto* pixels_tree = new TTree("pixels", title("Pixel summary").c_str());
+    pixels_tree->Branch("x", &x);
+    pixels_tree->Branch("y", &y);
+    pixels_tree->Branch("hits", &hits);
+    pixels_tree->Branch("signal", &signal);
+    pixels_tree->Branch("signal_squared", &signal_squared);
+    if(pixel_spectra_) {
+        pixels_tree->Branch("spectrum", &spectrum);
+    }
+    if(efficiency_) {
+        pixels_tree->Branch("particles", &particles);
+        pixels_tree->Branch("matched", &matched);
+    }
+
+    auto* hit_map = new TH2D("hit_map",
+                             title("Hit map", ";x (pixels);y (pixels);hits").c_str(),
+                             static_cast<int>(npixels.x()),
+                             -0.5,
+                             npixels.x() - 0.5,
+                             static_cast<int>(npixels.y()),
+                             -0.5,
+                             npixels.y() - 0.5);
+    auto* signal_map = static_cast<TH2D*>(hit_map->Clone("signal_map"));
+    signal_map->SetTitle(title("Mean signal", ";x (pixels);y (pixels);signal [ke]").c_str());
+    auto* efficiency_map = static_cast<TH2D*>(hit_map->Clone("efficiency_map"));
+    efficiency_map->SetTitle(title("Efficiency", ";x (pixels);y (pixels);efficiency").c_str());
+    auto* pixel_spectrum = new TH1D("pixel_signal",
+                                    title("Pixel signal", ";signal [ke];pixels").c_str(),
+                                    static_cast<int>(spectrum_bins_),
+                                    0,
+                                    max_signal);
+
+    std::vector<std::uint64_t> keys;
+    keys.reserve(summary.pixels.size());
+    for(const auto& pixel : summary.pixels) {
+        keys.push_back(pixel.first);
+    }
+    std::sort(keys.begin(), keys.end(), [](auto lhs, auto rhs) { return pixel_index(lhs) < pixel_index(rhs); });
+    for(auto key : keys) {
+        const auto& pixel = summary.pixels[key];
+        std::tie(x, y) = pixel_index(key);
+        hits = pixel.hits;
+        signal = pixel.signal;
+        signal_squared = pixel.signal_squared;
+        spectrum = pixel.spectrum;
+        spectrum.resize(pixel_spectra_ ? spectrum_bins_ : 0);
+        particles = pixel.particles;
+        matched = pixel.matched;
+        pixels_tree->Fill();
+
+        auto bin = hit_map->FindBin(x, y);
+        hit_map->SetBinContent(bin, static_cast<double>(pixel.hits));
+        if(pixel.hits > 0) {
+            signal_map->SetBinContent(bin, Units::convert(pixel.signal / static_cast<double>(pixel.hits), "ke"));
+        }
+        if(pixel.particles > 0) {
+            efficiency_map->SetBinContent(bin, static_cast<double>(pixel.matched) / static_cast<double>(pixel.particles));
+        }
+        for(size_t n = 0; n < pixel.spectrum.size(); ++n) {
+            pixel_spectrum->AddBinContent(static_cast<int>(n + 1), pixel.spectrum[n]);
+        }
+    }
+    hit_map->SetEntries(static_cast<double>(keys.size()));
+
+    auto* cluster_size = new TH1D("cluster_size",
+                                  title("Cluster size", ";cluster size [pixels];clusters").c_str(),
+                                  static_cast<int>(max_cluster_size_),
+                                  0.5,
+                                  max_cluster_size_ + 0.5);
+    for(size_t size = 1; size < summary.cluster_sizes.size(); ++size) {
+        cluster_size->SetBinContent(static_cast<int>(size), static_cast<double>(summary.cluster_sizes[size]));
+    }
+    cluster_size->SetEntries(static_cast<double>(summary.clusters));
+    auto* cluster_spectrum = new TH1D("cluster_signal",
+                                      title("Cluster signal", ";signal [ke];clusters").c_str(),
+                                      static_cast<int>(spectrum_bins_),
+                                      0,
+                                      max_signal);
+    for(size_t bin = 0; bin < summary.cluster_spectrum.size(); ++bin) {
+        cluster_spectrum->SetBinContent(static_cast<int>(bin + 1), static_cast<double>(summary.cluster_spectrum[bin]));
+    }
+    cluster_spectrum->SetEntries(static_cast<double>(summary.clusters));
+
+    pixels_tree->Write();
+    hit_map->Write();
+    signal_map->Write();
+    if(pixel_spectra_) {
+        pixel_spectrum->Write();
+    }
+    cluster_size->Write();
+    cluster_spectrum->Write();
+    if(efficiency_) {
+        efficiency_map->Write();
+    }
+    output_file_->Close();
+    output_file_.reset();
+
+    if(efficiency_) {
+        std::uint64_t total_particles = 0, total_matched = 0;
+        for(const auto& pixel : summary.pixels) {
+            total_particles += pixel.second.particles;
+            total_matched += pixel.second.matched;
+        }
+        LOG(INFO) << "Matched " << total_matched << " of " << total_particles << " primary particles to clusters";
+    }
+    if(summary.clusters > 0) {
+        auto mean = summary.cluster_signal / static_cast<double>(summary.clusters);
+        LOG(INFO) << "Mean cluster signal is " << Units::display(mean, "ke");
+    }
+    LOG(STATUS) << "Wrote summary of " << summary.pixels.size() << " pixels and " << summary.clusters << " clusters in "
+                << events_ << " events to file:" << std::endl
+                << file_name_;
+}
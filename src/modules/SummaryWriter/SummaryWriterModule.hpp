@@ -0,0 +1,129 @@
+/**
+ * @file
+ * @brief Definition of module accumulating summary statistics of the pixel hits and clusters instead of writing them
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <TFile.h>
+
+#include "core/config/Configuration.hpp"
+#include "core/geometry/GeometryManager.hpp"
+#include "core/messenger/Messenger.hpp"
+#include "core/module/Event.hpp"
+#include "core/module/Module.hpp"
+
+#include "objects/MCParticle.hpp"
+#include "objects/PixelHit.hpp"
+
+namespace allpix {
+    /**
+     * @ingroup Modules
+     * @brief Module to accumulate summary statistics of the pixel hits and clusters of a detector
+     * @note This module supports multithreading
+     *
+     * Instead of storing the objects of every event, the module accumulates the number of hits, the sum and the sum of
+     * squares of the signal, and optionally a spectrum of the signal for every pixel, together with the distributions of the
+     * size and the signal of the clusters. Optionally, the number of primary particles and the number of particles matched
+     * to a cluster are counted for the pixel of their impact position. The statistics are accumulated by every worker thread
+     * in its own sparse structure of the pixels which were hit, such that no locking is required between events and the
+     * module does not require the events to be processed in sequence. The structures of all threads are merged and written
+     * to a ROOT file at the end of the run.
+     */
+    class SummaryWriterModule : public Module {
+    public:
+        /**
+         * @brief Constructor for this detector-specific module
+         * @param config Configuration object for this module as retrieved from the steering file
+         * @param messenger Pointer to the messenger object to allow binding to messages on the bus
+         * @param detector Pointer to the detector for this module instance
+         */
+        SummaryWriterModule(Configuration& config, Messenger* messenger, std::shared_ptr<Detector> detector);
+
+        /**
+         * @brief Open the output file
+         */
+        void initialize() override;
+
+        /**
+         * @brief Accumulate the statistics of the pixel hits and clusters of the event
+         */
+        void run(Event*) override;
+
+        /**
+         * @brief Merge the statistics of all threads and write them to the output file
+         */
+        void finalize() override;
+
+    private:
+        // Statistics of a single pixel
+        struct PixelSummary {
+            std::uint64_t hits{};
+            double signal{};
+            double signal_squared{};
+            std::vector<std::uint32_t> spectrum;
+            std::uint64_t particles{};
+            std::uint64_t matched{};
+        };
+
+        // Statistics accumulated by a single thread, pixels are indexed by the key of their index
+        struct ThreadSummary {
+            std::unordered_map<std::uint64_t, PixelSummary> pixels;
+            std::vector<std::uint64_t> cluster_sizes;
+            std::vector<std::uint64_t> cluster_spectrum;
+            std::uint64_t clusters{};
+            double cluster_signal{};
+            double cluster_signal_squared{};
+        };
+
+        /**
+         * @brief Get the statistics of the calling thread, creating them on its first event
+         */
+        ThreadSummary& get_thread_summary();
+
+        /**
+         * @brief Get the bin of the signal spectra for a signal, with the last bin collecting the overflow
+         */
+        size_t get_spectrum_bin(double signal) const;
+
+        /**
+         * @brief Add the statistics of one thread to another
+         */
+        static void merge(ThreadSummary& target, const ThreadSummary& source);
+
+        Messenger* messenger_;
+
+        std::shared_ptr<Detector> detector_;
+        std::shared_ptr<DetectorModel> model_;
+
+        // Configuration parameters
+        bool pixel_spectra_{};
+        bool efficiency_{};
+        size_t spectrum_bins_{};
+        double max_signal_{};
+        size_t max_cluster_size_{};
+        ROOT::Math::XYVector matching_cut_;
+        std::string file_name_;
+        std::unique_ptr<TFile> output_file_;
+
+        std::mutex thread_summaries_mutex_;
+        std::map<std::thread::id, std::unique_ptr<ThreadSummary>> thread_summaries_;
+
+        // Statistical information
+        std::atomic<unsigned long long> events_{};
+    };
+} // namespace allpix
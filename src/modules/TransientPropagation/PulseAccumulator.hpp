@@ -0,0 +1,171 @@
+/**
+ * @file
+ * @brief Definition of the accumulator of pulses induced by a set of charge carriers
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef ALLPIX_TRANSIENT_PROPAGATION_PULSE_ACCUMULATOR_H
+#define ALLPIX_TRANSIENT_PROPAGATION_PULSE_ACCUMULATOR_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "objects/Pixel.hpp"
+#include "objects/Pulse.hpp"
+
+namespace allpix {
+    /**
+     * @brief Accumulator of the pulses induced by a set of charge carriers on the pixels of the induction matrix
+     *
+     * The pulses are stored in a pool of slots, which are found from the pixel index through a small hash table with open
+     * addressing. Adding charge to a pulse therefore neither searches a tree nor allocates a temporary pulse. The table and
+     * the pool are reused for all sets of charge carriers propagated with the same accumulator, while the pulses themselves
+     * are moved into the output once the propagation of a set has finished.
+     */
+    class PulseAccumulator {
+    public:
+        /**
+         * @brief Prepare the accumulator for a new set of charge carriers, discarding all pulses
+         * @param time_bin Length in time of a single bin of the pulses
+         * @param total_time Expected total length of the pulses used to pre-allocate memory
+         */
+        void reset(double time_bin, double total_time) {
+            time_bin_ = time_bin;
+            total_time_ = total_time;
+            used_ = 0;
+            table_.assign(std::max(table_.size(), min_table_size_), 0);
+        }
+
+        /**
+         * @brief Add induced charge to the pulse of a pixel, creating the pulse if it does not exist yet
+         * @param pixel  Index of the pixel
+         * @param charge Induced charge
+         * @param time   Time when the charge has been induced
+         * @throws PulseBadAllocException if memory allocation failed
+         */
+        void addCharge(const Pixel::Index& pixel, double charge, double time) { find(pixel).addCharge(charge, time); }
+
+        /**
+         * @brief Add charge induced during a time interval to the pulse of a pixel, creating the pulse if it does not exist
+         * @param pixel  Index of the pixel
+         * @param charge Induced charge
+         * @param begin  Begin of the time interval
+         * @param end    End of the time interval
+         * @throws PulseBadAllocException if memory allocation failed
+         *
+         * The charge is distributed over all bins overlapping with the interval in proportion to their overlap, such that
+         * the total charge added to the pulse equals the induced charge independent of the length of the interval.
+         */
+        void addCharge(const Pixel::Index& pixel, double charge, double begin, double end) {
+            auto& pulse = find(pixel);
+            if(end <= begin) {
+                pulse.addCharge(charge, end);
+                return;
+            }
+            // Bins are centered around multiples of the bin width, see Pulse::addCharge
+            for(auto bin = std::lround(begin / time_bin_); bin <= std::lround(end / time_bin_); ++bin) {
+                auto center = static_cast<double>(bin) * time_bin_;
+                auto overlap = std::min(end, center + time_bin_ / 2) - std::max(begin, center - time_bin_ / 2);
+                if(overlap > 0) {
+                    pulse.addCharge(charge * overlap / (end - begin), center);
+                }
+            }
+        }
+
+        /**
+         * @brief Get the total charge of all pulses
+         * @return Sum of the charge of all bins of the pulses of all pixels
+         */
+        double getTotalCharge() const {
+            double charge = 0;
+            for(size_t i = 0; i < used_; ++i) {
+                for(auto bin : slots_[i].second) {
+                    charge += bin;
+                }
+            }
+            return charge;
+        }
+
+        /**
+         * @brief Move the pulses into a map of pixel indices and prepare the accumulator for a new set of charge carriers
+         * @param compact Remove the leading and trailing bins without charge from the pulses, see \ref Pulse::compact
+         * @return Map of pulses induced at electrodes identified by their index
+         */
+        std::map<Pixel::Index, Pulse> release(bool compact = false) {
+            std::map<Pixel::Index, Pulse> pulses;
+            for(size_t i = 0; i < used_; ++i) {
+                if(compact) {
+                    slots_[i].second.compact();
+                }
+                pulses.emplace(slots_[i].first, std::move(slots_[i].second));
+            }
+            reset(time_bin_, total_time_);
+            return pulses;
+        }
+
+    private:
+        Pulse& find(const Pixel::Index& pixel) {
+            auto mask = table_.size() - 1;
+            for(auto i = hash(pixel) & mask;; i = (i + 1) & mask) {
+                auto& entry = table_[i];
+                if(entry == 0) {
+                    // Keep the table at most half full to keep the probe sequences short
+                    if(2 * (used_ + 1) > table_.size()) {
+                        rehash(2 * table_.size());
+                        return find(pixel);
+                    }
+                    if(used_ == slots_.size()) {
+                        slots_.emplace_back();
+                    }
+                    auto& slot = slots_[used_];
+                    slot.first = pixel;
+                    slot.second = Pulse(time_bin_, total_time_);
+                    entry = static_cast<std::uint32_t>(++used_);
+                    return slot.second;
+                }
+                if(slots_[entry - 1].first == pixel) {
+                    return slots_[entry - 1].second;
+                }
+            }
+        }
+
+        void rehash(size_t size) {
+            table_.assign(size, 0);
+            auto mask = size - 1;
+            for(size_t slot = 0; slot < used_; ++slot) {
+                auto i = hash(slots_[slot].first) & mask;
+                while(table_[i] != 0) {
+                    i = (i + 1) & mask;
+                }
+                table_[i] = static_cast<std::uint32_t>(slot + 1);
+            }
+        }
+
+        static size_t hash(const Pixel::Index& pixel) {
+            return static_cast<size_t>(static_cast<std::uint32_t>(pixel.x()) * 73856093U ^
+                                       static_cast<std::uint32_t>(pixel.y()) * 19349663U);
+        }
+
+        // Slot of every pixel plus one, zero for empty entries. The size of the table is a power of two
+        std::vector<std::uint32_t> table_;
+        std::vector<std::pair<Pixel::Index, Pulse>> slots_;
+        size_t used_{};
+
+        double time_bin_{};
+        double total_time_{};
+
+        static constexpr size_t min_table_size_ = 64;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_TRANSIENT_PROPAGATION_PULSE_ACCUMULATOR_H */
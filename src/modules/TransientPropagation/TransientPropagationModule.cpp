@@ -10,16 +10,24 @@
  */
 
 #include "TransientPropagationModule.hpp"
+#include "PulseAccumulator.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <Eigen/Core>
 
 #include "core/utils/distributions.h"
 #include "core/utils/log.h"
+#include "core/utils/unit_constants.h"
 #include "objects/exceptions.h"
 #include "tools/runge_kutta.h"
 
@@ -33,30 +41,48 @@ TransientPropagationModule::TransientPropagationModule(Configuration& config,
 
     // Save detector model
     model_ = detector_->getModel();
+    geometry_ = GeometryKernel(model_);
 
     // Require deposits message for single detector:
     messenger_->bindSingle<DepositedChargeMessage>(this, MsgFlags::REQUIRED);
 
+    // Declare the messages dispatched by this module
+    declare_output<PropagatedChargeMessage>();
+
     // Set default value for config variables
     config_.setDefault<double>("timestep", Units::get(0.01, "ns"));
     config_.setDefault<double>("integration_time", Units::get(25, "ns"));
     config_.setDefault<unsigned int>("charge_per_step", 10);
     config_.setDefault<unsigned int>("max_charge_groups", 1000);
+    config_.setDefault<unsigned int>("tasks_per_event", 1);
 
     // Models:
     config_.setDefault<std::string>("mobility_model", "jacoboni");
     config_.setDefault<std::string>("recombination_model", "none");
     config_.setDefault<std::string>("trapping_model", "none");
     config_.setDefault<std::string>("detrapping_model", "none");
+    config_.setDefault<bool>("sample_survival_time", false);
 
     config_.setDefault<double>("temperature", 293.15);
     config_.setDefault<unsigned int>("distance", 1);
+    config_.setDefault<bool>("compact_pulses", false);
+    config_.setDefault<double>("pulse_rejection_threshold", 0.);
+    config_.setDefault<double>("pulse_rejection_noise", 0.);
+    config_.setDefault<double>("pulse_rejection_sigmas", 5.);
     config_.setDefault<bool>("ignore_magnetic_field", false);
     config_.setDefault<double>("surface_reflectivity", 0.0);
+    config_.setDefault<bool>("adaptive_timestep", false);
+    config_.setDefault<double>("timestep_max", 10 * config_.get<double>("timestep"));
+    config_.setDefault<double>("max_step_length", Units::get(1., "um"));
+    config_.setDefault<double>("max_potential_change", 0.005);
+    config_.setDefault<double>("output_pulse_binning", config_.get<double>("timestep"));
+    config_.setDefault<double>("induction_cutoff", 0.);
 
     // Set defaults for charge carrier multiplication
     config_.setDefault<double>("multiplication_threshold", 1e-2);
     config_.setDefault<unsigned int>("max_multiplication_level", 5);
+    config_.setDefault<bool>("multiplication_queue", false);
+    config_.setDefault<unsigned int>("max_multiplication_groups", 0);
     config_.setDefault<std::string>("multiplication_model", "none");
 
     config_.setDefault<bool>("output_linegraphs", false);
@@ -68,6 +94,8 @@ TransientPropagationModule::TransientPropagationModule(Configuration& config,
                              config_.get<bool>("output_linegraphs") || config_.get<bool>("output_animations"));
     config_.setDefault<bool>("output_animations_color_markers", false);
     config_.setDefault<double>("output_plots_step", config_.get<double>("timestep"));
+    config_.setDefault<double>("output_linegraphs_tolerance", 0.);
+    config_.setDefault<bool>("output_linegraphs_deferred", false);
     config_.setDefault<bool>("output_plots_use_pixel_units", false);
     config_.setDefault<bool>("output_plots_align_pixels", false);
     config_.setDefault<double>("output_plots_theta", 0.0f);
@@ -76,25 +104,92 @@ TransientPropagationModule::TransientPropagationModule(Configuration& config,
     // Copy some variables from configuration to avoid lookups:
     temperature_ = config_.get<double>("temperature");
     timestep_ = config_.get<double>("timestep");
+    adaptive_timestep_ = config_.get<bool>("adaptive_timestep");
+    timestep_max_ = config_.get<double>("timestep_max");
+    max_step_length_ = config_.get<double>("max_step_length");
+    max_potential_change_ = config_.get<double>("max_potential_change");
+    if(adaptive_timestep_) {
+        if(timestep_max_ < timestep_) {
+            throw InvalidValueError(config_, "timestep_max", "maximum timestep cannot be smaller than the timestep");
+        }
+        if(max_step_length_ <= 0 || max_potential_change_ <= 0) {
+            throw InvalidValueError(config_,
+                                    (max_step_length_ <= 0 ? "max_step_length" : "max_potential_change"),
+                                    "value has to be positive");
+        }
+        LOG(INFO) << "Adapting the timestep between " << Units::display(timestep_, {"ns", "ps"}) << " and "
+                  << Units::display(timestep_max_, {"ns", "ps"});
+    }
+    induction_cutoff_ = config_.get<double>("induction_cutoff");
+    if(induction_cutoff_ < 0) {
+        throw InvalidValueError(config_, "induction_cutoff", "cutoff cannot be negative");
+    }
+    if(induction_cutoff_ > 0) {
+        LOG(INFO) << "Stopping the propagation of charge carriers once the charge they can still induce is below "
+                  << Units::display(induction_cutoff_, "e");
+    }
+    pulse_binning_ = config_.get<double>("output_pulse_binning");
+    if(pulse_binning_ < timestep_) {
+        throw InvalidValueError(config_, "output_pulse_binning", "pulse binning cannot be finer than the timestep");
+    }
+    if(pulse_binning_ > timestep_) {
+        LOG(INFO) << "Accumulating the induced charge into pulses with a binning of "
+                  << Units::display(pulse_binning_, {"ns", "ps"});
+    }
     integration_time_ = config_.get<double>("integration_time");
+    deposit_culling_.configure(config_, model_);
+    deposit_ordering_.configure(config_, model_);
     distance_ = config_.get<unsigned int>("distance");
+    neighbor_stencil_ = model_->getNeighborStencil(distance_);
     charge_per_step_ = config_.get<unsigned int>("charge_per_step");
     max_charge_groups_ = config_.get<unsigned int>("max_charge_groups");
-    boltzmann_kT_ = Units::get(8.6173333e-5, "eV/K") * temperature_;
+    tasks_per_event_ = std::max(1u, config_.get<unsigned int>("tasks_per_event"));
+    boltzmann_kT_ = 8.6173333e-5 * units::eV_per_K * temperature_;
     surface_reflectivity_ = config_.get<double>("surface_reflectivity");
+    sample_survival_time_ = config_.get<bool>("sample_survival_time");
+    compact_pulses_ = config_.get<bool>("compact_pulses");
+    pulse_rejection_threshold_ = config_.get<double>("pulse_rejection_threshold");
+    pulse_rejection_noise_ = config_.get<double>("pulse_rejection_noise");
+    pulse_rejection_sigmas_ = config_.get<double>("pulse_rejection_sigmas");
+    if(pulse_rejection_threshold_ < 0) {
+        throw InvalidValueError(config_, "pulse_rejection_threshold", "threshold cannot be negative");
+    }
+    if(pulse_rejection_noise_ < 0 || pulse_rejection_sigmas_ < 0) {
+        throw InvalidValueError(config_,
+                                (pulse_rejection_noise_ < 0 ? "pulse_rejection_noise" : "pulse_rejection_sigmas"),
+                                "value cannot be negative");
+    }
 
     max_multiplication_level_ = config.get<unsigned int>("max_multiplication_level");
+    multiplication_queue_ = config_.get<bool>("multiplication_queue");
+    max_multiplication_groups_ = config_.get<unsigned int>("max_multiplication_groups");
 
     output_plots_ = config_.get<bool>("output_plots");
     output_linegraphs_ = config_.get<bool>("output_linegraphs");
     output_linegraphs_collected_ = config_.get<bool>("output_linegraphs_collected");
     output_linegraphs_recombined_ = config_.get<bool>("output_linegraphs_recombined");
     output_linegraphs_trapped_ = config_.get<bool>("output_linegraphs_trapped");
+    output_animations_ = config_.get<bool>("output_animations");
     output_plots_step_ = config_.get<double>("output_plots_step");
+    output_linegraphs_tolerance_ = config_.get<double>("output_linegraphs_tolerance");
+    output_linegraphs_deferred_ = config_.get<bool>("output_linegraphs_deferred");
+    if(config_.has("output_linegraphs_events")) {
+        auto events = config_.getArray<uint64_t>("output_linegraphs_events");
+        output_linegraphs_events_.insert(events.begin(), events.end());
+    }
+    if(output_linegraphs_tolerance_ < 0) {
+        throw InvalidValueError(config_, "output_linegraphs_tolerance", "tolerance cannot be negative");
+    }
+    if(output_linegraphs_tolerance_ > 0 && output_animations_) {
+        throw InvalidCombinationError(config_,
+                                      {"output_linegraphs_tolerance", "output_animations"},
+                                      "animations require the points of the drift paths at every plot step");
+    }
 
-    // Enable multithreading of this module if multithreading is enabled and no per-event output plots are requested:
+    // Enable multithreading of this module if multithreading is enabled and no per-event output plots are requested, or
+    // if the creation of the per-event output plots is deferred to the end of the run:
     // FIXME: Review if this is really the case or we can still use multithreading
-    if(!(config_.get<bool>("output_animations") || output_linegraphs_)) {
+    if(!(output_animations_ || output_linegraphs_) || output_linegraphs_deferred_) {
         allow_multithreading();
     } else {
         LOG(WARNING) << "Per-event line graphs or animations requested, disabling parallel event processing";
@@ -108,6 +203,34 @@ TransientPropagationModule::TransientPropagationModule(Configuration& config,
 
 void TransientPropagationModule::initialize() {
 
+    // Register the statistics of the propagation as metrics
+    register_counter(total_deposits_, "deposits", "Deposits of charge carriers");
+    register_counter(deposits_exceeding_max_groups_,
+                     "deposits_exceeding_max_groups",
+                     "Deposits with more charge carriers than allowed by the maximum number of charge groups");
+    register_counter(total_propagated_charges_, "propagated_charges", "Charge carriers reaching the end of the propagation");
+    register_counter(total_recombined_charges_, "recombined_charges", "Charge carriers recombined during the propagation");
+    register_counter(total_trapped_charges_, "trapped_charges", "Charge carriers trapped during the propagation");
+    register_counter(deposit_culling_.culled_outside_matrix,
+                     "culled_outside_matrix",
+                     "Deposits outside the pixel matrix culled before the propagation");
+    register_counter(deposit_culling_.culled_late,
+                     "culled_late",
+                     "Deposits beyond the maximum deposit time culled before the propagation");
+    register_counter(deposit_culling_.culled_low_charge,
+                     "culled_low_charge",
+                     "Deposits below the minimum deposit charge culled before the propagation");
+    auto total_charges = [this]() {
+        return static_cast<double>(total_propagated_charges_.value() + total_recombined_charges_.value() +
+                                   total_trapped_charges_.value());
+    };
+    register_gauge("recombined_fraction", "Fraction of the charge carriers recombined", [this, total_charges]() {
+        return static_cast<double>(total_recombined_charges_.value()) / std::max(1., total_charges());
+    });
+    register_gauge("trapped_fraction", "Fraction of the charge carriers trapped", [this, total_charges]() {
+        return static_cast<double>(total_trapped_charges_.value()) / std::max(1., total_charges());
+    });
+
     // Check for electric field
     if(!detector_->hasElectricField()) {
         LOG(WARNING) << "This detector does not have an electric field.";
@@ -121,6 +244,25 @@ void TransientPropagationModule::initialize() {
         LOG(ERROR) << "This module will likely produce unphysical results when applying linear electric fields.";
     }
 
+    // Resample the electric field and the doping profile onto a combined grid spanning a single pixel cell if requested
+    if(config_.get<bool>("combine_fields", false)) {
+        if(model_->getPixelType() != Pixel::Type::RECTANGLE) {
+            throw InvalidValueError(config_, "combine_fields", "combining the fields requires rectangular pixels");
+        }
+        auto bins = config_.getArray<size_t>("combined_field_bins", {100, 100, 100});
+        if(bins.size() != 3 || std::find(bins.begin(), bins.end(), 0) != bins.end()) {
+            throw InvalidValueError(
+                config_, "combined_field_bins", "three non-zero numbers of bins in x, y and z are required");
+        }
+        try {
+            detector_->combineElectricFieldAndDoping({{bins[0], bins[1], bins[2]}});
+        } catch(std::invalid_argument& e) {
+            throw InvalidValueError(config_, "combine_fields", e.what());
+        }
+        LOG(INFO) << "Combined electric field and doping profile on a grid with " << bins[0] << "x" << bins[1] << "x"
+                  << bins[2] << " bins";
+    }
+
     // Prepare mobility model
     mobility_ = Mobility(config_, model_->getSensorMaterial(), detector_->hasDopingProfile());
 
@@ -137,7 +279,7 @@ void TransientPropagationModule::initialize() {
     multiplication_ = ImpactIonization(config_);
 
     // Check multiplication and step size larger than a picosecond:
-    if(!multiplication_.is<NoImpactIonization>() && timestep_ > 0.001) {
+    if(!multiplication_.is<NoImpactIonization>() && (adaptive_timestep_ ? timestep_max_ : timestep_) > 0.001) {
         LOG(WARNING) << "Charge multiplication enabled with maximum timestep larger than 1ps" << std::endl
                      << "This might lead to unphysical gain values.";
     }
@@ -153,6 +295,12 @@ void TransientPropagationModule::initialize() {
         }
     }
 
+    // Only calculate the induced pulses if the propagated charges are received by another module
+    calculate_pulses_ = messenger_->hasReceiver<PropagatedChargeMessage>(this, detector_);
+    if(!calculate_pulses_) {
+        LOG(INFO) << "No receiver for the propagated charges, not calculating the induced pulses";
+    }
+
     if(output_plots_) {
 
         auto pitch_x = static_cast<double>(Units::convert(model_->getPixelSize().x(), "um"));
@@ -395,17 +543,8 @@ void TransientPropagationModule::initialize() {
 void TransientPropagationModule::run(Event* event) {
     auto deposits_message = messenger_->fetchMessage<DepositedChargeMessage>(this, event);
 
-    // Create vector of propagated charges to output
-    std::vector<PropagatedCharge> propagated_charges;
-    unsigned int propagated_charges_count = 0;
-    unsigned int recombined_charges_count = 0;
-    unsigned int trapped_charges_count = 0;
-
-    // List of points to plot to plot for output plots
-    LineGraph::OutputPlotPoints output_plot_points;
-
-    // Loop over all deposits for propagation
-    LOG(TRACE) << "Propagating charges in sensor";
+    // Select all deposits to be propagated, reusing the memory of the previous events
+    auto& deposits = scratch<std::vector<const DepositedCharge*>>();
     for(const auto& deposit : deposits_message->getData()) {
 
         // Only process if within requested integration time:
@@ -416,68 +555,198 @@ void TransientPropagationModule::run(Event* event) {
             continue;
         }
 
-        total_deposits_++;
+        // Drop deposits which are not worth propagating
+        if(deposit_culling_.cull(deposit)) {
+            LOG(DEBUG) << "Culling " << deposit.getCharge() << " charge carriers deposited on "
+                       << Units::display(deposit.getLocalPosition(), {"mm", "um"}) << " at "
+                       << Units::display(deposit.getGlobalTime(), "ns") << " global";
+            continue;
+        }
+
+        deposits.push_back(&deposit);
+    }
 
-        // Loop over all charges in the deposit
-        unsigned int charges_remaining = deposit.getCharge();
+    // Propagate neighboring deposits consecutively to access the same regions of the field maps
+    if(deposit_ordering_.enabled()) {
+        deposit_ordering_.sort(deposits);
+        LOG(DEBUG) << "Sorted " << deposits.size() << " deposits by carrier type and position";
+    }
 
-        LOG(DEBUG) << "Set of charge carriers (" << deposit.getType() << ") on "
-                   << Units::display(deposit.getLocalPosition(), {"mm", "um"});
+    // Propagated charges, plot points, deferred secondaries and statistics of a contiguous range of deposits
+    struct PropagationResult {
+        std::vector<PropagatedCharge> propagated_charges;
+        LineGraph::OutputPlotPoints output_plot_points;
+        std::vector<SecondaryCharges> secondaries;
+        unsigned int propagated_charges_count{};
+        unsigned int recombined_charges_count{};
+        unsigned int trapped_charges_count{};
+    };
 
-        auto charge_per_step = charge_per_step_;
-        if(max_charge_groups_ > 0 && deposit.getCharge() / charge_per_step > max_charge_groups_) {
-            charge_per_step = static_cast<unsigned int>(ceil(static_cast<double>(deposit.getCharge()) / max_charge_groups_));
-            deposits_exceeding_max_groups_++;
-            LOG(INFO) << "Deposited charge: " << deposit.getCharge()
-                      << ", which exceeds the maximum number of charge groups allowed. Increasing charge_per_step to "
-                      << charge_per_step << " for this deposit.";
-        }
-        while(charges_remaining > 0) {
-            // Define number of charges to be propagated and remove charges of this step from the total
-            if(charge_per_step > charges_remaining) {
-                charge_per_step = charges_remaining;
+    // Record the drift paths for line graphs only for the selected events
+    auto record_plot_points = output_linegraphs_ && (output_linegraphs_events_.empty() ||
+                                                     output_linegraphs_events_.find(event->number) !=
+                                                         output_linegraphs_events_.end());
+
+    auto propagate_deposits =
+        [&](size_t first, size_t last, RandomNumberGenerator& random_generator, PropagationResult& result) {
+            auto* output_plot_points = (record_plot_points ? &result.output_plot_points : nullptr);
+            for(size_t i = first; i < last; ++i) {
+                const auto& deposit = *deposits[i];
+                ++total_deposits_;
+
+                // Loop over all charges in the deposit
+                unsigned int charges_remaining = deposit.getCharge();
+
+                LOG(DEBUG) << "Set of charge carriers (" << deposit.getType() << ") on "
+                           << Units::display(deposit.getLocalPosition(), {"mm", "um"});
+
+                auto charge_per_step = charge_per_step_;
+                if(max_charge_groups_ > 0 && deposit.getCharge() / charge_per_step > max_charge_groups_) {
+                    charge_per_step =
+                        static_cast<unsigned int>(ceil(static_cast<double>(deposit.getCharge()) / max_charge_groups_));
+                    ++deposits_exceeding_max_groups_;
+                    LOG(INFO) << "Deposited charge: " << deposit.getCharge()
+                              << ", which exceeds the maximum number of charge groups allowed. "
+                              << "Increasing charge_per_step to " << charge_per_step << " for this deposit.";
+                }
+                while(charges_remaining > 0) {
+                    // Define number of charges to be propagated and remove charges of this step from the total
+                    if(charge_per_step > charges_remaining) {
+                        charge_per_step = charges_remaining;
+                    }
+                    charges_remaining -= charge_per_step;
+
+                    // Get position and propagate through sensor
+                    auto [recombined, trapped, propagated] = propagate(random_generator,
+                                                                       deposit,
+                                                                       deposit.getLocalPosition(),
+                                                                       deposit.getType(),
+                                                                       charge_per_step,
+                                                                       deposit.getLocalTime(),
+                                                                       deposit.getGlobalTime(),
+                                                                       0,
+                                                                       result.propagated_charges,
+                                                                       output_plot_points,
+                                                                       result.secondaries);
+
+                    // Update statistics:
+                    result.recombined_charges_count += recombined;
+                    result.trapped_charges_count += trapped;
+                    result.propagated_charges_count += propagated;
+                }
             }
-            charges_remaining -= charge_per_step;
+        };
+
+    // Propagate a number of items either sequentially or split into tasks, adding the results to the total
+    PropagationResult total;
+    auto propagate_tasks = [&](size_t count, const auto& propagate_items) {
+        auto num_tasks = std::min<size_t>(tasks_per_event_, count);
+        if(num_tasks <= 1) {
+            propagate_items(0, count, event->getRandomEngine(), total);
+            return;
+        }
 
-            // Get position and propagate through sensor
-            auto [recombined, trapped, propagated] = propagate(event,
-                                                               deposit,
-                                                               deposit.getLocalPosition(),
-                                                               deposit.getType(),
-                                                               charge_per_step,
-                                                               deposit.getLocalTime(),
-                                                               deposit.getGlobalTime(),
-                                                               0,
-                                                               propagated_charges,
-                                                               output_plot_points);
+        // Split the items into contiguous chunks which are propagated independently with their own random stream
+        std::vector<PropagationResult> results(num_tasks);
+        auto chunk_size = (count + num_tasks - 1) / num_tasks;
+        event->parallelFor(num_tasks, [&](size_t task, RandomNumberGenerator& random_generator) {
+            auto first = std::min(count, task * chunk_size);
+            auto last = std::min(count, first + chunk_size);
+            propagate_items(first, last, random_generator, results[task]);
+        });
+
+        // Merge the results in task order to keep the output independent of the execution order
+        for(auto& result : results) {
+            std::move(result.propagated_charges.begin(),
+                      result.propagated_charges.end(),
+                      std::back_inserter(total.propagated_charges));
+            std::move(result.output_plot_points.begin(),
+                      result.output_plot_points.end(),
+                      std::back_inserter(total.output_plot_points));
+            std::move(result.secondaries.begin(), result.secondaries.end(), std::back_inserter(total.secondaries));
+            total.propagated_charges_count += result.propagated_charges_count;
+            total.recombined_charges_count += result.recombined_charges_count;
+            total.trapped_charges_count += result.trapped_charges_count;
+        }
+    };
 
-            // Update statistics:
-            recombined_charges_count += recombined;
-            trapped_charges_count += trapped;
-            propagated_charges_count += propagated;
+    // Loop over all deposits for propagation
+    LOG(TRACE) << "Propagating charges in sensor";
+    propagate_tasks(deposits.size(), propagate_deposits);
+
+    // Propagate the charge carriers generated by impact ionization generation by generation, if deferred
+    auto generation = std::move(total.secondaries);
+    total.secondaries.clear();
+    while(!generation.empty()) {
+        LOG(DEBUG) << "Propagating " << generation.size() << " sets of charge carriers generated by impact ionization";
+
+        // Keep every set with a probability retaining the maximum number of sets on average, and scale the charge of the
+        // kept sets by the inverse probability to conserve the expected charge
+        if(max_multiplication_groups_ > 0 && generation.size() > max_multiplication_groups_) {
+            auto probability = static_cast<double>(max_multiplication_groups_) / static_cast<double>(generation.size());
+            allpix::uniform_real_distribution<double> uniform_distribution(0, 1);
+            std::vector<SecondaryCharges> kept;
+            for(auto& secondary : generation) {
+                if(uniform_distribution(event->getRandomEngine()) >= probability) {
+                    continue;
+                }
+                secondary.charge = static_cast<unsigned int>(
+                    std::floor(secondary.charge / probability + uniform_distribution(event->getRandomEngine())));
+                kept.push_back(secondary);
+            }
+            LOG(DEBUG) << "Keeping " << kept.size() << " of " << generation.size()
+                       << " sets of charge carriers generated by impact ionization, weighting their charge by "
+                       << 1. / probability;
+            generation = std::move(kept);
         }
+
+        auto propagate_secondaries =
+            [&](size_t first, size_t last, RandomNumberGenerator& random_generator, PropagationResult& result) {
+                auto* output_plot_points = (record_plot_points ? &result.output_plot_points : nullptr);
+                for(size_t i = first; i < last; ++i) {
+                    const auto& secondary = generation[i];
+                    auto [recombined, trapped, propagated] = propagate(random_generator,
+                                                                       *secondary.deposit,
+                                                                       secondary.position,
+                                                                       secondary.type,
+                                                                       secondary.charge,
+                                                                       secondary.initial_time_local,
+                                                                       secondary.initial_time_global,
+                                                                       secondary.level,
+                                                                       result.propagated_charges,
+                                                                       output_plot_points,
+                                                                       result.secondaries);
+                    result.recombined_charges_count += recombined;
+                    result.trapped_charges_count += trapped;
+                    result.propagated_charges_count += propagated;
+                }
+            };
+        propagate_tasks(generation.size(), propagate_secondaries);
+        generation = std::move(total.secondaries);
+        total.secondaries.clear();
     }
 
-    // Output plots if required
-    if(output_linegraphs_) {
-        LineGraph::Create(event->number, this, config_, output_plot_points, CarrierState::UNKNOWN);
-        if(output_linegraphs_collected_) {
-            LineGraph::Create(event->number, this, config_, output_plot_points, CarrierState::HALTED);
-        }
-        if(output_linegraphs_recombined_) {
-            LineGraph::Create(event->number, this, config_, output_plot_points, CarrierState::RECOMBINED);
-        }
-        if(output_linegraphs_trapped_) {
-            LineGraph::Create(event->number, this, config_, output_plot_points, CarrierState::TRAPPED);
-        }
-        if(config_.get<bool>("output_animations")) {
-            LineGraph::Animate(event->number, this, config_, output_plot_points);
+    auto& propagated_charges = total.propagated_charges;
+    auto propagated_charges_count = total.propagated_charges_count;
+    auto recombined_charges_count = total.recombined_charges_count;
+    auto trapped_charges_count = total.trapped_charges_count;
+
+    // Output plots if required, or keep the points until the end of the run if the plots are deferred
+    if(record_plot_points) {
+        if(output_linegraphs_deferred_) {
+            std::lock_guard<std::mutex> lock(deferred_plot_points_mutex_);
+            deferred_plot_points_.emplace(event->number, std::move(total.output_plot_points));
+        } else {
+            create_output_plots(event->number, total.output_plot_points);
         }
     }
 
     LOG(INFO) << "Propagated " << propagated_charges_count << " charges" << std::endl
               << "Recombined " << recombined_charges_count << " charges during transport" << std::endl
               << "Trapped " << trapped_charges_count << " charges during transport";
+    total_propagated_charges_ += propagated_charges_count;
+    total_recombined_charges_ += recombined_charges_count;
+    total_trapped_charges_ += trapped_charges_count;
 
     if(output_plots_) {
         auto total = (propagated_charges_count + recombined_charges_count + trapped_charges_count);
@@ -485,8 +754,46 @@ void TransientPropagationModule::run(Event* event) {
         trapped_histo_->Fill(static_cast<double>(trapped_charges_count) / (total == 0 ? 1 : total));
     }
 
+    // Discard the pulses of pixels which cannot cross the threshold. The sum of the absolute charge in all bins is an upper
+    // bound for the absolute integrated charge of the summed pulse of the pixel at any time
+    if(pulse_rejection_threshold_ > 0 && calculate_pulses_) {
+        std::map<Pixel::Index, double> pixel_bounds;
+        for(const auto& propagated_charge : propagated_charges) {
+            for(const auto& [pixel_index, pulse] : propagated_charge.getPulses()) {
+                auto& bound = pixel_bounds[pixel_index];
+                for(auto bin : pulse) {
+                    bound += std::fabs(bin);
+                }
+            }
+        }
+
+        auto limit = pulse_rejection_threshold_ - pulse_rejection_sigmas_ * pulse_rejection_noise_;
+        size_t rejected = 0;
+        for(const auto& pixel : pixel_bounds) {
+            rejected += (pixel.second < limit ? 1 : 0);
+        }
+        if(rejected > 0) {
+            for(auto& propagated_charge : propagated_charges) {
+                auto pulses = propagated_charge.releasePulses();
+                for(auto it = pulses.begin(); it != pulses.end();) {
+                    it = (pixel_bounds[it->first] < limit ? pulses.erase(it) : std::next(it));
+                }
+                propagated_charge.setPulses(std::move(pulses));
+            }
+
+            // Propagated charges without remaining pulses would be treated as charges without pulse information
+            propagated_charges.erase(std::remove_if(propagated_charges.begin(),
+                                                    propagated_charges.end(),
+                                                    [](const auto& charge) { return charge.getPulses().empty(); }),
+                                     propagated_charges.end());
+        }
+        LOG(DEBUG) << "Discarded pulses of " << rejected << " of " << pixel_bounds.size()
+                   << " pixels which cannot cross the threshold, keeping " << propagated_charges.size()
+                   << " propagated charges";
+    }
+
     // Create a new message with propagated charges
-    auto propagated_charge_message = std::make_shared<PropagatedChargeMessage>(std::move(propagated_charges), detector_);
+    auto propagated_charge_message = event->makeShared<PropagatedChargeMessage>(std::move(propagated_charges), detector_);
 
     // Dispatch the message with propagated charges
     messenger_->dispatchMessage(this, std::move(propagated_charge_message), event);
@@ -498,7 +805,7 @@ void TransientPropagationModule::run(Event* event) {
  * multiple steps, adding a random diffusion to the propagating charge every step.
  */
 std::tuple<unsigned int, unsigned int, unsigned int>
-TransientPropagationModule::propagate(Event* event,
+TransientPropagationModule::propagate(RandomNumberGenerator& random_generator,
                                       const DepositedCharge& deposit,
                                       const ROOT::Math::XYZPoint& pos,
                                       const CarrierType& type,
@@ -507,7 +814,8 @@ TransientPropagationModule::propagate(Event* event,
                                       const double initial_time_global,
                                       const unsigned int level,
                                       std::vector<PropagatedCharge>& propagated_charges,
-                                      LineGraph::OutputPlotPoints& output_plot_points) const {
+                                      LineGraph::OutputPlotPoints* output_plot_points,
+                                      std::vector<SecondaryCharges>& secondaries) const {
 
     if(level > max_multiplication_level_) {
         LOG(WARNING) << "Found impact ionization shower with level larger than " << max_multiplication_level_
@@ -516,18 +824,34 @@ TransientPropagationModule::propagate(Event* event,
     }
 
     Eigen::Vector3d position(pos.x(), pos.y(), pos.z());
-    std::map<Pixel::Index, Pulse> pixel_map;
+
+    // Accumulators of the induced pulses, one per level of impact ionization since further sets of charge carriers are
+    // propagated within the propagation of this one. They are reused for all sets propagated by this thread.
+    static thread_local std::vector<std::unique_ptr<PulseAccumulator>> pulse_accumulators;
+    if(pulse_accumulators.size() <= level) {
+        pulse_accumulators.resize(level + 1);
+    }
+    if(pulse_accumulators[level] == nullptr) {
+        pulse_accumulators[level] = std::make_unique<PulseAccumulator>();
+    }
+    auto& pulses = *pulse_accumulators[level];
+    pulses.reset(pulse_binning_, integration_time_);
+
+    // Steps not matching the pulse binning distribute their induced charge over all bins they overlap with
+    auto distribute_charge = adaptive_timestep_ || pulse_binning_ > timestep_;
+    double induced_charge = 0;
 
     unsigned int propagated_charges_count = 0;
     unsigned int recombined_charges_count = 0;
     unsigned int trapped_charges_count = 0;
 
     // Add point of deposition to the output plots if requested
-    if(output_linegraphs_) {
-        output_plot_points.emplace_back(std::make_tuple(deposit.getGlobalTime(), charge, type, CarrierState::MOTION),
-                                        std::vector<ROOT::Math::XYZPoint>());
+    size_t output_plot_index = 0;
+    if(output_plot_points != nullptr) {
+        output_plot_points->emplace_back(std::make_tuple(deposit.getGlobalTime(), charge, type, CarrierState::MOTION),
+                                         std::vector<ROOT::Math::XYZPoint>());
+        output_plot_index = output_plot_points->size() - 1;
     }
-    auto output_plot_index = output_plot_points.size() - 1;
 
     // Store initial charge
     const unsigned int initial_charge = charge;
@@ -539,37 +863,39 @@ TransientPropagationModule::propagate(Event* event,
 
         // Compute the independent diffusion in three
         allpix::normal_distribution<double> gauss_distribution(0, diffusion_std_dev);
-        auto x = gauss_distribution(event->getRandomEngine());
-        auto y = gauss_distribution(event->getRandomEngine());
-        auto z = gauss_distribution(event->getRandomEngine());
+        auto x = gauss_distribution(random_generator);
+        auto y = gauss_distribution(random_generator);
+        auto z = gauss_distribution(random_generator);
         return {x, y, z};
     };
 
     // Survival probability of this charge carrier package, evaluated at every step
     allpix::uniform_real_distribution<double> uniform_distribution(0, 1);
 
+    // Remaining survival of the charge carrier package against recombination and trapping in units of its lifetimes, if the
+    // survival time is sampled once instead of evaluating the survival probability at every step
+    double recombination_survival = 0, trapping_survival = 0;
+    if(sample_survival_time_) {
+        recombination_survival = -std::log(uniform_distribution(random_generator));
+        trapping_survival = -std::log(uniform_distribution(random_generator));
+    }
+
     // Define lambda functions to compute the charge carrier velocity with or without magnetic field
-    std::function<Eigen::Vector3d(double, const Eigen::Vector3d&)> carrier_velocity_noB =
-        [&](double, const Eigen::Vector3d& cur_pos) -> Eigen::Vector3d {
-        auto raw_field = detector_->getElectricField(static_cast<ROOT::Math::XYZPoint>(cur_pos));
+    auto carrier_velocity_noB = [&](double, const Eigen::Vector3d& cur_pos) -> Eigen::Vector3d {
+        auto [raw_field, doping] = detector_->getElectricFieldAndDoping(static_cast<ROOT::Math::XYZPoint>(cur_pos));
         Eigen::Vector3d efield(raw_field.x(), raw_field.y(), raw_field.z());
 
-        auto doping = detector_->getDopingConcentration(static_cast<ROOT::Math::XYZPoint>(cur_pos));
-
         return static_cast<int>(type) * mobility_(type, efield.norm(), doping) * efield;
     };
 
-    std::function<Eigen::Vector3d(double, const Eigen::Vector3d&)> carrier_velocity_withB =
-        [&](double, const Eigen::Vector3d& cur_pos) -> Eigen::Vector3d {
-        auto raw_field = detector_->getElectricField(static_cast<ROOT::Math::XYZPoint>(cur_pos));
+    auto carrier_velocity_withB = [&](double, const Eigen::Vector3d& cur_pos) -> Eigen::Vector3d {
+        auto [raw_field, doping] = detector_->getElectricFieldAndDoping(static_cast<ROOT::Math::XYZPoint>(cur_pos));
         Eigen::Vector3d efield(raw_field.x(), raw_field.y(), raw_field.z());
 
         Eigen::Vector3d velocity;
         auto magnetic_field = detector_->getMagneticField(static_cast<ROOT::Math::XYZPoint>(cur_pos));
         Eigen::Vector3d bfield(magnetic_field.x(), magnetic_field.y(), magnetic_field.z());
 
-        auto doping = detector_->getDopingConcentration(static_cast<ROOT::Math::XYZPoint>(cur_pos));
-
         auto mob = mobility_(type, efield.norm(), doping);
         auto exb = efield.cross(bfield);
 
@@ -583,22 +909,45 @@ TransientPropagationModule::propagate(Event* event,
         return static_cast<int>(type) * mob * (efield + term1 + term2) / rnorm;
     };
 
-    // Create the runge kutta solver with an RK4 tableau, no error estimation required since we're not adapting step size
-    auto runge_kutta = make_runge_kutta(
-        tableau::RK4, (has_magnetic_field_ ? carrier_velocity_withB : carrier_velocity_noB), timestep_, position);
+    auto carrier_velocity = [&](double t, const Eigen::Vector3d& cur_pos) -> Eigen::Vector3d {
+        return has_magnetic_field_ ? carrier_velocity_withB(t, cur_pos) : carrier_velocity_noB(t, cur_pos);
+    };
+
+    // Create the runge kutta solver with an RK4 tableau, the step size is adapted from the step length and the change of the
+    // weighting potentials instead of an error estimate if requested
+    auto runge_kutta = make_runge_kutta(tableau::StaticRK4{}, carrier_velocity, timestep_, position);
 
     // Continue propagation until the deposit is outside the sensor
     Eigen::Vector3d last_position = position;
     ROOT::Math::XYZVector efield{}, last_efield{};
+
+    // Weighting potentials of the pixels at the current position, and at the previous position for the pixels in the
+    // induction matrix of the previous step. The latter are reused instead of evaluating the potential there again.
+    std::vector<std::pair<Pixel::Index, double>> potentials, last_potentials;
     size_t next_idx = 0;
     auto state = CarrierState::MOTION;
+    double step_length = 0, potential_change = 0;
+    double last_potential_max = std::numeric_limits<double>::max();
+    unsigned int steps = 0;
     while(state == CarrierState::MOTION && (initial_time_local + runge_kutta.getTime()) < integration_time_) {
+        // Scale the timestep such that neither the drift length nor the largest change of the weighting potentials of the
+        // previous step exceed their limits, growing by at most a factor of two per step
+        if(adaptive_timestep_ && step_length > 0) {
+            auto scale = std::min(2., max_step_length_ / step_length);
+            if(potential_change > 0) {
+                scale = std::min(scale, max_potential_change_ / potential_change);
+            }
+            runge_kutta.setTimeStep(std::clamp(runge_kutta.getTimeStep() * scale, timestep_, timestep_max_));
+        }
+        auto timestep = runge_kutta.getTimeStep();
+
         // Update output plots if necessary (depending on the plot step)
-        if(output_linegraphs_) { // Set final state of charge carrier for plotting:
+        if(output_plot_points != nullptr) {
             auto time_idx = static_cast<size_t>(runge_kutta.getTime() / output_plots_step_);
-            while(next_idx <= time_idx) {
-                output_plot_points.at(output_plot_index).second.push_back(static_cast<ROOT::Math::XYZPoint>(position));
-                next_idx = output_plot_points.at(output_plot_index).second.size();
+            for(; next_idx <= time_idx; ++next_idx) {
+                LineGraph::AddPoint(output_plot_points->at(output_plot_index).second,
+                                    static_cast<ROOT::Math::XYZPoint>(position),
+                                    output_linegraphs_tolerance_);
             }
         }
 
@@ -607,23 +956,27 @@ TransientPropagationModule::propagate(Event* event,
         last_efield = efield;
 
         // Get electric field at current (pre-step) position
-        efield = detector_->getElectricField(static_cast<ROOT::Math::XYZPoint>(position));
-        auto doping = detector_->getDopingConcentration(static_cast<ROOT::Math::XYZPoint>(position));
+        auto field_and_doping = detector_->getElectricFieldAndDoping(static_cast<ROOT::Math::XYZPoint>(position));
+        efield = field_and_doping.field;
+        auto doping = field_and_doping.doping;
 
         // Execute a Runge Kutta step
         auto step = runge_kutta.step();
+        ++steps;
 
         // Get the current result
         position = runge_kutta.getValue();
+        step_length = step.value.norm();
+        potential_change = 0;
 
         // Apply diffusion step
-        auto diffusion = carrier_diffusion(std::sqrt(efield.Mag2()), doping, timestep_);
+        auto diffusion = carrier_diffusion(std::sqrt(efield.Mag2()), doping, timestep);
         position += diffusion;
 
         // If charge carrier reaches implant, interpolate surface position for higher accuracy:
-        if(auto implant = model_->isWithinImplant(static_cast<ROOT::Math::XYZPoint>(position))) {
+        if(auto implant = geometry_.isWithinImplant(static_cast<ROOT::Math::XYZPoint>(position))) {
             LOG(TRACE) << "Carrier in implant: " << Units::display(static_cast<ROOT::Math::XYZPoint>(position), {"nm"});
-            auto new_position = model_->getImplantIntercept(implant.value(),
+            auto new_position = model_->getImplantIntercept(*implant,
                                                             static_cast<ROOT::Math::XYZPoint>(last_position),
                                                             static_cast<ROOT::Math::XYZPoint>(position));
             position = Eigen::Vector3d(new_position.x(), new_position.y(), new_position.z());
@@ -631,9 +984,9 @@ TransientPropagationModule::propagate(Event* event,
         }
 
         // Check for overshooting outside the sensor and correct for it:
-        if(!model_->isWithinSensor(static_cast<ROOT::Math::XYZPoint>(position))) {
+        if(!geometry_.isWithinSensor(static_cast<ROOT::Math::XYZPoint>(position))) {
             // Reflect off the sensor surface with a certain probability, otherwise halt motion:
-            if(uniform_distribution(event->getRandomEngine()) > surface_reflectivity_) {
+            if(uniform_distribution(random_generator) > surface_reflectivity_) {
                 LOG(TRACE) << "Carrier outside sensor: "
                            << Units::display(static_cast<ROOT::Math::XYZPoint>(position), {"nm"});
                 state = CarrierState::HALTED;
@@ -651,13 +1004,13 @@ TransientPropagationModule::propagate(Event* event,
                            << Units::display(static_cast<ROOT::Math::XYZPoint>(position), {"um", "nm"});
 
                 // Re-check if we ended in an implant - corner case.
-                if(model_->isWithinImplant(static_cast<ROOT::Math::XYZPoint>(position))) {
+                if(geometry_.isWithinImplant(static_cast<ROOT::Math::XYZPoint>(position))) {
                     LOG(TRACE) << "Ended in implant after reflection - halting";
                     state = CarrierState::HALTED;
                 }
 
                 // Re-check if we are within the sensor - reflection at sensor side walls:
-                if(!model_->isWithinSensor(static_cast<ROOT::Math::XYZPoint>(position))) {
+                if(!geometry_.isWithinSensor(static_cast<ROOT::Math::XYZPoint>(position))) {
                     position = Eigen::Vector3d(intercept.x(), intercept.y(), intercept.z());
                     state = CarrierState::HALTED;
                 }
@@ -670,32 +1023,49 @@ TransientPropagationModule::propagate(Event* event,
 
         // Update step length histogram
         if(output_plots_) {
-            step_length_histo_->Fill(static_cast<double>(Units::convert(step.value.norm(), "um")));
+            step_length_histo_->Fill(step.value.norm() / units::um);
         }
 
         // Physics effects:
 
         // Check if charge carrier is still alive:
-        if(state == CarrierState::MOTION &&
-           recombination_(type, doping, uniform_distribution(event->getRandomEngine()), timestep_)) {
-            state = CarrierState::RECOMBINED;
+        if(state == CarrierState::MOTION) {
+            if(sample_survival_time_) {
+                recombination_survival -= timestep / recombination_.lifetime(type, doping);
+                if(recombination_survival <= 0) {
+                    state = CarrierState::RECOMBINED;
+                }
+            } else if(recombination_(type, doping, uniform_distribution(random_generator), timestep)) {
+                state = CarrierState::RECOMBINED;
+            }
         }
 
         // Check if the charge carrier has been trapped:
-        if(state == CarrierState::MOTION &&
-           trapping_(type, uniform_distribution(event->getRandomEngine()), timestep_, std::sqrt(efield.Mag2()))) {
+        auto trapped = false;
+        if(state == CarrierState::MOTION) {
+            if(sample_survival_time_) {
+                trapping_survival -= timestep / trapping_.lifetime(type, std::sqrt(efield.Mag2()));
+                trapped = (trapping_survival <= 0);
+            } else {
+                trapped = trapping_(type, uniform_distribution(random_generator), timestep, std::sqrt(efield.Mag2()));
+            }
+        }
+        if(trapped) {
             if(output_plots_) {
                 trapping_time_histo_->Fill(runge_kutta.getTime(), charge);
             }
 
-            auto detrap_time = detrapping_(type, uniform_distribution(event->getRandomEngine()), std::sqrt(efield.Mag2()));
+            auto detrap_time = detrapping_(type, uniform_distribution(random_generator), std::sqrt(efield.Mag2()));
             if((initial_time_local + runge_kutta.getTime() + detrap_time) < integration_time_) {
                 // De-trap and advance in time if still below integration time
                 LOG(TRACE) << "De-trapping charge carrier after " << Units::display(detrap_time, {"ns", "us"});
                 runge_kutta.advanceTime(detrap_time);
+                if(sample_survival_time_) {
+                    trapping_survival = -std::log(uniform_distribution(random_generator));
+                }
 
                 if(output_plots_) {
-                    detrapping_time_histo_->Fill(static_cast<double>(Units::convert(detrap_time, "ns")), charge);
+                    detrapping_time_histo_->Fill(detrap_time / units::ns, charge);
                 }
             } else {
                 // Mark as trapped otherwise
@@ -722,7 +1092,7 @@ TransientPropagationModule::propagate(Event* event,
             double log_prob = 1. / std::log1p(-1. / local_gain);
             for(unsigned int i_carrier = 0; i_carrier < charge; ++i_carrier) {
                 n_secondaries +=
-                    static_cast<unsigned int>(std::log(uniform_distribution(event->getRandomEngine())) * log_prob);
+                    static_cast<unsigned int>(std::log(uniform_distribution(random_generator)) * log_prob);
             }
             if(n_secondaries != 0) {
                 // Generate new charge carriers of the opposite type
@@ -736,24 +1106,36 @@ TransientPropagationModule::propagate(Event* event,
                     multiplication_depth_histo_->Fill(carrier_pos.z(), n_secondaries);
                 }
 
-                auto [recombined, trapped, propagated] = propagate(event,
-                                                                   deposit,
-                                                                   carrier_pos,
-                                                                   inverted_type,
-                                                                   n_secondaries,
-                                                                   initial_time_local + runge_kutta.getTime(),
-                                                                   initial_time_global + runge_kutta.getTime(),
-                                                                   level + 1,
-                                                                   propagated_charges,
-                                                                   output_plot_points);
-
-                // Update statistics:
-                recombined_charges_count += recombined;
-                trapped_charges_count += trapped;
-                propagated_charges_count += propagated;
-
-                LOG(DEBUG) << "Continuing propagation of charge carrier set (" << type << ") at "
-                           << Units::display(carrier_pos, {"mm", "um"});
+                if(multiplication_queue_) {
+                    // Defer the propagation of the new charge carriers to the next generation of the shower
+                    secondaries.push_back({&deposit,
+                                           carrier_pos,
+                                           inverted_type,
+                                           n_secondaries,
+                                           initial_time_local + runge_kutta.getTime(),
+                                           initial_time_global + runge_kutta.getTime(),
+                                           level + 1});
+                } else {
+                    auto [recombined, trapped, propagated] = propagate(random_generator,
+                                                                       deposit,
+                                                                       carrier_pos,
+                                                                       inverted_type,
+                                                                       n_secondaries,
+                                                                       initial_time_local + runge_kutta.getTime(),
+                                                                       initial_time_global + runge_kutta.getTime(),
+                                                                       level + 1,
+                                                                       propagated_charges,
+                                                                       output_plot_points,
+                                                                       secondaries);
+
+                    // Update statistics:
+                    recombined_charges_count += recombined;
+                    trapped_charges_count += trapped;
+                    propagated_charges_count += propagated;
+
+                    LOG(DEBUG) << "Continuing propagation of charge carrier set (" << type << ") at "
+                               << Units::display(carrier_pos, {"mm", "um"});
+                }
             }
 
             auto gain = static_cast<double>(charge + n_secondaries) / initial_charge;
@@ -763,20 +1145,25 @@ TransientPropagationModule::propagate(Event* event,
             }
         }
 
+        // Skip the signal calculation if neither the pulses nor the plots of the induced charge are used
+        if(!calculate_pulses_ && !output_plots_) {
+            charge += n_secondaries;
+            continue;
+        }
+
         // Signal calculation:
 
         // Find the nearest pixel - before and after the step
-        auto [xpixel, ypixel] = model_->getPixelIndex(static_cast<ROOT::Math::XYZPoint>(position));
-        auto [last_xpixel, last_ypixel] = model_->getPixelIndex(static_cast<ROOT::Math::XYZPoint>(last_position));
+        auto [xpixel, ypixel] = geometry_.getPixelIndex(static_cast<ROOT::Math::XYZPoint>(position));
+        auto [last_xpixel, last_ypixel] = geometry_.getPixelIndex(static_cast<ROOT::Math::XYZPoint>(last_position));
         auto idx = Pixel::Index(xpixel, ypixel);
-        auto neighbors = model_->getNeighbors(idx, distance_);
+        auto last_idx = Pixel::Index(last_xpixel, last_ypixel);
 
         // If the charge carrier crossed pixel boundaries, ensure that we always calculate the induced current for both of
         // them by extending the induction matrix temporarily. Otherwise we end up doing "double-counting" because we would
         // only jump "into" a pixel but never "out". At the border of the induction matrix, this would create an imbalance.
-        if(last_xpixel != xpixel || last_ypixel != ypixel) {
-            auto last_idx = Pixel::Index(last_xpixel, last_ypixel);
-            neighbors.merge(model_->getNeighbors(last_idx, distance_));
+        auto crossed_boundary = (last_xpixel != xpixel || last_ypixel != ypixel);
+        if(crossed_boundary) {
             LOG(TRACE) << "Carrier crossed boundary from pixel " << Pixel::Index(last_xpixel, last_ypixel) << " to pixel "
                        << Pixel::Index(xpixel, ypixel);
         }
@@ -785,9 +1172,29 @@ TransientPropagationModule::propagate(Event* event,
                    << Units::display(static_cast<ROOT::Math::XYZPoint>(position), {"um", "mm"}) << ", "
                    << Units::display(initial_time_local + runge_kutta.getTime(), "ns");
 
-        for(const auto& pixel_index : neighbors) {
+        // The potentials at the end of the previous step have been evaluated at the position before this step
+        last_potentials.swap(potentials);
+        potentials.clear();
+        auto last_potential = [&](const Pixel::Index& pixel_index) {
+            // Pixels are visited in the same order as in the previous step unless the carrier changed pixel
+            auto next = potentials.size();
+            if(next < last_potentials.size() && last_potentials[next].first == pixel_index) {
+                return last_potentials[next].second;
+            }
+            auto cached = std::find_if(last_potentials.begin(), last_potentials.end(), [&](const auto& potential) {
+                return potential.first == pixel_index;
+            });
+            if(cached != last_potentials.end()) {
+                return cached->second;
+            }
+            return detector_->getWeightingPotential(static_cast<ROOT::Math::XYZPoint>(last_position), pixel_index);
+        };
+
+        auto induce = [&](const Pixel::Index& pixel_index) {
             auto ramo = detector_->getWeightingPotential(static_cast<ROOT::Math::XYZPoint>(position), pixel_index);
-            auto last_ramo = detector_->getWeightingPotential(static_cast<ROOT::Math::XYZPoint>(last_position), pixel_index);
+            auto last_ramo = last_potential(pixel_index);
+            potentials.emplace_back(pixel_index, ramo);
+            potential_change = std::max(potential_change, std::fabs(ramo - last_ramo));
 
             // Induced charge on electrode is q_int = q * (phi(x1) - phi(x0))
             auto induced = charge * (ramo - last_ramo) * static_cast<std::underlying_type<CarrierType>::type>(type);
@@ -800,14 +1207,21 @@ TransientPropagationModule::propagate(Event* event,
             LOG(TRACE) << "Pixel " << pixel_index << " dPhi = " << (ramo - last_ramo) << ", induced " << type
                        << " q = " << Units::display(induced, "e");
 
-            // Create pulse if it doesn't exist. Store induced charge in the returned pulse iterator
-            auto pixel_map_iterator = pixel_map.emplace(pixel_index, Pulse(timestep_, integration_time_));
-            try {
-                pixel_map_iterator.first->second.addCharge(induced, initial_time_local + runge_kutta.getTime());
-            } catch(const PulseBadAllocException& e) {
-                LOG(ERROR) << e.what() << std::endl
-                           << "Ignoring pulse contribution at time "
-                           << Units::display(initial_time_local + runge_kutta.getTime(), {"ms", "us", "ns"});
+            // Store induced charge in the pulse of the pixel, which is created if it doesn't exist
+            if(calculate_pulses_) {
+                try {
+                    auto time = initial_time_local + runge_kutta.getTime();
+                    induced_charge += induced;
+                    if(distribute_charge) {
+                        pulses.addCharge(pixel_index, induced, time - timestep, time);
+                    } else {
+                        pulses.addCharge(pixel_index, induced, time);
+                    }
+                } catch(const PulseBadAllocException& e) {
+                    LOG(ERROR) << e.what() << std::endl
+                               << "Ignoring pulse contribution at time "
+                               << Units::display(initial_time_local + runge_kutta.getTime(), {"ms", "us", "ns"});
+                }
             }
 
             if(output_plots_) {
@@ -843,9 +1257,44 @@ TransientPropagationModule::propagate(Event* event,
                     }
                 }
             }
+        };
+
+        if(neighbor_stencil_.offsets.empty()) {
+            auto neighbors = model_->getNeighbors(idx, distance_);
+            if(crossed_boundary) {
+                neighbors.merge(model_->getNeighbors(last_idx, distance_));
+            }
+            for(const auto& pixel_index : neighbors) {
+                induce(pixel_index);
+            }
+        } else {
+            // Visit the neighbors of the previous pixel only if they have not been visited as neighbors of the current one
+            model_->forEachNeighbor(idx, neighbor_stencil_, induce);
+            if(crossed_boundary) {
+                model_->forEachNeighbor(last_idx, neighbor_stencil_, [&](const Pixel::Index& pixel_index) {
+                    if(!model_->areNeighbors(idx, pixel_index, distance_)) {
+                        induce(pixel_index);
+                    }
+                });
+            }
         }
         // Increase charge at the end of the step in case of impact ionization
         charge += n_secondaries;
+
+        // Stop the propagation once the carrier moves away from all electrodes of the induction matrix and the charge it
+        // can still induce while the weighting potentials fall off further is below the cutoff
+        if(induction_cutoff_ > 0 && state == CarrierState::MOTION && !potentials.empty()) {
+            double potential_max = 0;
+            for(const auto& potential : potentials) {
+                potential_max = std::max(potential_max, std::fabs(potential.second));
+            }
+            if(potential_max <= last_potential_max && charge * potential_max < induction_cutoff_) {
+                LOG(TRACE) << "Stopping propagation at weighting potential " << potential_max << ", remaining induced "
+                           << "charge below " << Units::display(induction_cutoff_, "e");
+                break;
+            }
+            last_potential_max = potential_max;
+        }
     }
 
     if(output_plots_ && !multiplication_.is<NoImpactIonization>()) {
@@ -873,12 +1322,21 @@ TransientPropagationModule::propagate(Event* event,
     }
 
     // Set final state of charge carrier for plotting:
-    if(output_linegraphs_) {
+    if(output_plot_points != nullptr) {
         // If drift time is larger than integration time or the charge carriers have been collected at the backside, reset:
         if(runge_kutta.getTime() >= integration_time_ || last_position.z() < -model_->getSensorSize().z() * 0.45) {
-            std::get<3>(output_plot_points.at(output_plot_index).first) = CarrierState::UNKNOWN;
+            std::get<3>(output_plot_points->at(output_plot_index).first) = CarrierState::UNKNOWN;
         } else {
-            std::get<3>(output_plot_points.at(output_plot_index).first) = state;
+            std::get<3>(output_plot_points->at(output_plot_index).first) = state;
+        }
+    }
+
+    // The induced charge is distributed over the pulse bins without loss, unless bins could not be allocated
+    if(distribute_charge) {
+        auto pulse_charge = pulses.getTotalCharge();
+        if(std::fabs(pulse_charge - induced_charge) > 1e-6 * std::max(1., std::fabs(induced_charge))) {
+            LOG(WARNING) << "Charge of the induced pulses of " << Units::display(pulse_charge, "e")
+                         << " differs from the induced charge of " << Units::display(induced_charge, "e");
         }
     }
 
@@ -888,7 +1346,7 @@ TransientPropagationModule::propagate(Event* event,
     PropagatedCharge propagated_charge(local_position,
                                        global_position,
                                        type,
-                                       std::move(pixel_map),
+                                       pulses.release(compact_pulses_),
                                        initial_time_local + runge_kutta.getTime(),
                                        initial_time_global + runge_kutta.getTime(),
                                        state,
@@ -898,6 +1356,14 @@ TransientPropagationModule::propagate(Event* event,
                << Units::display(local_position, {"mm", "um"}) << " in " << Units::display(runge_kutta.getTime(), "ns")
                << " time, induced " << Units::display(propagated_charge.getCharge(), {"e"})
                << ", final state: " << allpix::to_string(state);
+    if(adaptive_timestep_ && steps > 0) {
+        LOG(DEBUG) << " Integrated " << steps << " steps with an average timestep of "
+                   << Units::display(runge_kutta.getTime() / static_cast<double>(steps), {"ns", "ps"});
+    }
+    for(const auto& [pixel_index, pulse] : propagated_charge.getPulses()) {
+        LOG(TRACE) << "Stored pulse of pixel " << pixel_index << " with " << pulse.size() << " bins of "
+                   << Units::display(pulse.getBinning(), {"ps", "ns"}) << " starting at bin " << pulse.getOffset();
+    }
 
     propagated_charges.push_back(std::move(propagated_charge));
 
@@ -913,7 +1379,7 @@ TransientPropagationModule::propagate(Event* event,
     }
 
     if(output_plots_) {
-        drift_time_histo_->Fill(static_cast<double>(Units::convert(runge_kutta.getTime(), "ns")), charge);
+        drift_time_histo_->Fill(runge_kutta.getTime() / units::ns, charge);
         group_size_histo_->Fill(initial_charge);
     }
 
@@ -921,8 +1387,37 @@ TransientPropagationModule::propagate(Event* event,
     return std::make_tuple(recombined_charges_count, trapped_charges_count, propagated_charges_count);
 }
 
+void TransientPropagationModule::create_output_plots(uint64_t event_num,
+                                                     const LineGraph::OutputPlotPoints& output_plot_points) {
+    LineGraph::Create(event_num, this, config_, output_plot_points, CarrierState::UNKNOWN);
+    if(output_linegraphs_collected_) {
+        LineGraph::Create(event_num, this, config_, output_plot_points, CarrierState::HALTED);
+    }
+    if(output_linegraphs_recombined_) {
+        LineGraph::Create(event_num, this, config_, output_plot_points, CarrierState::RECOMBINED);
+    }
+    if(output_linegraphs_trapped_) {
+        LineGraph::Create(event_num, this, config_, output_plot_points, CarrierState::TRAPPED);
+    }
+    if(output_animations_) {
+        LineGraph::Animate(event_num, this, config_, output_plot_points);
+    }
+}
+
 void TransientPropagationModule::finalize() {
-    LOG(INFO) << deposits_exceeding_max_groups_ * 100.0 / total_deposits_ << "% of deposits have charge exceeding the "
+    // Create the deferred line graphs in the order of the events
+    if(!deferred_plot_points_.empty()) {
+        LOG(INFO) << "Creating deferred line graphs for " << deferred_plot_points_.size() << " events";
+        for(const auto& [event_num, output_plot_points] : deferred_plot_points_) {
+            create_output_plots(event_num, output_plot_points);
+        }
+        deferred_plot_points_.clear();
+    }
+
+    deposit_culling_.report();
+    LOG(INFO) << static_cast<double>(deposits_exceeding_max_groups_.value()) * 100.0 /
+                     static_cast<double>(total_deposits_.value())
+              << "% of deposits have charge exceeding the "
               << max_charge_groups_ << " charge groups allowed, with a charge_per_step value of " << charge_per_step_ << ".";
     if(output_plots_) {
         group_size_histo_->Get()->GetXaxis()->SetRange(1, group_size_histo_->Get()->GetNbinsX() + 1);
@@ -9,6 +9,9 @@
  * SPDX-License-Identifier: MIT
  */
 
+#include <map>
+#include <mutex>
+#include <set>
 #include <string>
 
 #include <Math/DisplacementVector2D.h>
@@ -18,6 +21,7 @@
 
 #include "core/config/Configuration.hpp"
 #include "core/geometry/DetectorModel.hpp"
+#include "core/geometry/GeometryKernel.hpp"
 #include "core/messenger/Messenger.hpp"
 #include "core/module/Event.hpp"
 #include "core/module/Module.hpp"
@@ -33,6 +37,8 @@
 #include "physics/Trapping.hpp"
 
 #include "tools/ROOT.h"
+#include "tools/deposit_culling.h"
+#include "tools/deposit_ordering.h"
 #include "tools/line_graphs.h"
 
 namespace allpix {
@@ -76,10 +82,24 @@ namespace allpix {
         // General module members
         std::shared_ptr<const Detector> detector_;
         std::shared_ptr<DetectorModel> model_;
+        GeometryKernel geometry_;
+
+        /**
+         * @brief Set of charge carriers generated by impact ionization, propagated with the next generation of the shower
+         */
+        struct SecondaryCharges {
+            const DepositedCharge* deposit;
+            ROOT::Math::XYZPoint position;
+            CarrierType type;
+            unsigned int charge;
+            double initial_time_local;
+            double initial_time_global;
+            unsigned int level;
+        };
 
         /**
          * @brief Propagate a single set of charges through the sensor
-         * @param event               Pointer to current event
+         * @param random_generator    Reference to the random number engine to be used
          * @param deposit             Reference to the original deposited charge object
          * @param pos                 Position of the deposit in the sensor
          * @param type                Type of the carrier to propagate
@@ -88,12 +108,15 @@ namespace allpix {
          * @param initial_time_global Initial global time with respect to the start of the event
          * @param level               Current level depth of the generated shower
          * @param propagated_charges  Reference to vector with all produced final PropagatedCharge objects
-         * @param output_plot_points Reference to vector to hold points for line graph output plots
+         * @param output_plot_points  Pointer to vector to hold points for line graph output plots, nullptr if no points
+         *                            should be recorded
+         * @param secondaries         Reference to vector collecting the charge carriers generated by impact ionization if
+         *                            their propagation is deferred to the next generation of the shower
          *
          * @return Total recombined, trapped and propagated charge for statistics purposes
          */
         std::tuple<unsigned int, unsigned int, unsigned int>
-        propagate(Event* event,
+        propagate(RandomNumberGenerator& random_generator,
                   const DepositedCharge& deposit,
                   const ROOT::Math::XYZPoint& pos,
                   const CarrierType& type,
@@ -102,17 +125,41 @@ namespace allpix {
                   const double initial_time_global,
                   const unsigned int level,
                   std::vector<PropagatedCharge>& propagated_charges,
-                  LineGraph::OutputPlotPoints& output_plot_points) const;
+                  LineGraph::OutputPlotPoints* output_plot_points,
+                  std::vector<SecondaryCharges>& secondaries) const;
+
+        /**
+         * @brief Create the requested line graphs and animations of the drift paths of an event
+         * @param event_num          Number of the event
+         * @param output_plot_points Points of the drift paths recorded for the event
+         */
+        void create_output_plots(uint64_t event_num, const LineGraph::OutputPlotPoints& output_plot_points);
 
         // Local copies of configuration parameters to avoid costly lookup:
-        double temperature_{}, timestep_{}, integration_time_{}, output_plots_step_{};
+        double temperature_{}, timestep_{}, integration_time_{}, output_plots_step_{}, output_linegraphs_tolerance_{};
+        bool adaptive_timestep_{};
+        double timestep_max_{}, max_step_length_{}, max_potential_change_{};
+        double pulse_binning_{};
+        double induction_cutoff_{};
         bool output_plots_{}, output_linegraphs_{}, output_linegraphs_collected_{}, output_linegraphs_recombined_{},
-            output_linegraphs_trapped_{};
+            output_linegraphs_trapped_{}, output_animations_{}, output_linegraphs_deferred_{};
+        std::set<uint64_t> output_linegraphs_events_;
+
+        // Points of the drift paths of all events kept until the end of the run if the line graphs are deferred
+        std::mutex deferred_plot_points_mutex_;
+        std::map<uint64_t, LineGraph::OutputPlotPoints> deferred_plot_points_;
+        bool calculate_pulses_{};
+        bool compact_pulses_{};
+        double pulse_rejection_threshold_{}, pulse_rejection_noise_{}, pulse_rejection_sigmas_{};
         unsigned int distance_{};
+        NeighborStencil neighbor_stencil_;
         unsigned int charge_per_step_{};
         unsigned int max_charge_groups_{};
+        unsigned int tasks_per_event_{};
 
         unsigned int max_multiplication_level_{};
+        bool multiplication_queue_{};
+        unsigned int max_multiplication_groups_{};
 
         // Models for electron and hole mobility and lifetime
         Mobility mobility_;
@@ -121,6 +168,9 @@ namespace allpix {
         Trapping trapping_;
         Detrapping detrapping_;
 
+        // Sample the survival time against recombination and trapping once per charge carrier instead of at every step
+        bool sample_survival_time_{};
+
         // Precalculated value for Boltzmann constant:
         double boltzmann_kT_;
 
@@ -134,8 +184,13 @@ namespace allpix {
         // Magnetic field
         bool has_magnetic_field_{};
 
-        // Deposit statistics
-        std::atomic<unsigned int> total_deposits_{}, deposits_exceeding_max_groups_{};
+        // Statistical information
+        Counter total_deposits_, deposits_exceeding_max_groups_;
+        Counter total_propagated_charges_, total_recombined_charges_, total_trapped_charges_;
+
+        // Selection of the deposits passed on to the propagation
+        DepositCulling deposit_culling_;
+        DepositOrdering deposit_ordering_;
 
         // Output plots
         Histogram<TH1D> potential_difference_, induced_charge_histo_, induced_charge_e_histo_, induced_charge_h_histo_;
@@ -16,6 +16,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <memory>
+#include <set>
 #include <string>
 #include <thread>
 #include <utility>
@@ -58,6 +59,8 @@ VisualizationGeant4Module::VisualizationGeant4Module(Configuration& config, Mess
     config_.setDefault("simple_view", true);
 
     mode_ = config_.get<ViewingMode>("mode");
+    accumulate_ = config_.getParameter<bool>("accumulate");
+    accumulate_time_step_ = config_.getParameter<unsigned long>("accumulate_time_step", Units::get(100ul, "ms"));
 }
 /**
  * Without applying this workaround the visualization (sometimes without content) is also shown when an exception occurred in
@@ -403,10 +406,9 @@ void VisualizationGeant4Module::set_visualization_attributes() {
 }
 
 void VisualizationGeant4Module::run(Event*) {
-    if(!config_.get<bool>("accumulate")) {
+    if(!accumulate_) {
         vis_manager_g4_->GetCurrentViewer()->ShowView();
-        std::this_thread::sleep_for(
-            std::chrono::nanoseconds(config_.get<unsigned long>("accumulate_time_step", Units::get(100ul, "ms"))));
+        std::this_thread::sleep_for(std::chrono::nanoseconds(*accumulate_time_step_));
     }
 }
 
@@ -432,6 +434,7 @@ void VisualizationGeant4Module::add_visualization_volumes() {
     // Only place the pixel matrix for the visualization if we have no simple view
     if(!config_.get<bool>("simple_view")) {
         // Loop through detectors
+        std::set<const G4LogicalVolume*> sensors_with_pixels;
         for(auto& detector : geo_manager_->getDetectors()) {
             auto sensor_log = geo_manager_->getExternalObject<G4LogicalVolume>(detector->getName(), "sensor_log");
             auto pixel_log = geo_manager_->getExternalObject<G4LogicalVolume>(detector->getName(), "pixel_log");
@@ -442,6 +445,11 @@ void VisualizationGeant4Module::add_visualization_volumes() {
                 continue;
             }
 
+            // Sensor volumes shared by detectors of the same model only receive their pixels once
+            if(!sensors_with_pixels.insert(sensor_log.get()).second) {
+                continue;
+            }
+
             // Place the pixels if all objects are available
             std::shared_ptr<G4PVParameterised> pixel_param_phys = std::make_shared<G4PVParameterised>(
                 "pixel_" + detector->getName() + "_param",
@@ -11,7 +11,9 @@
 
 #include "WeightingPotentialReaderModule.hpp"
 
+#include <algorithm>
 #include <cmath>
+#include <filesystem>
 #include <fstream>
 #include <limits>
 #include <memory>
@@ -62,7 +64,6 @@ void WeightingPotentialReaderModule::initialize() {
                 config_, "field_mapping", "the weighting potential needs to be centered around an electrode");
         }
         LOG(DEBUG) << "Weighting potential maps to " << magic_enum::enum_name(field_mapping);
-        auto field_data = read_field();
 
         // By default, set field scale from physical extent read from field file:
         std::array<double, 2> field_scale{{1.0, 1.0}};
@@ -74,14 +75,65 @@ void WeightingPotentialReaderModule::initialize() {
             field_scale = {{scales.x(), scales.y()}};
         }
 
-        // Set the field grid, provide scale factors as fraction of the pixel pitch for correct scaling:
-        detector_->setWeightingPotentialGrid(field_data.getData(),
-                                             field_data.getDimensions(),
-                                             field_data.getSize(),
-                                             field_mapping,
-                                             field_scale,
-                                             {0.0, 0.0},
-                                             thickness_domain);
+        // Select the interpolation between the grid points, defaulting to the value of the nearest grid point
+        auto interpolation = config_.get<FieldInterpolation>("field_interpolation", FieldInterpolation::NEAREST);
+        LOG(DEBUG) << "Weighting potential is interpolated using " << magic_enum::enum_name(interpolation)
+                   << " interpolation";
+
+        // Store only a single quadrant of symmetric potentials if requested
+        auto fold = config_.get<bool>("fold_potential", false);
+        if(fold && field_mapping != FieldMapping::PIXEL_FULL) {
+            throw InvalidValueError(config_, "fold_potential", "folding requires a potential spanning the full pixel plane");
+        }
+
+        // Read the field data with the requested precision and set the grid, provide scale factors as fraction of the
+        // pixel pitch for correct scaling:
+        auto set_grid = [&](const auto& data) {
+            const auto& field_data = (fold ? fold_field(data) : data);
+            detector_->setWeightingPotentialGrid(field_data.getValues(),
+                                                 field_data.getDimensions(),
+                                                 field_data.getSize(),
+                                                 (fold ? FieldMapping::PIXEL_QUADRANT_I : field_mapping),
+                                                 field_scale,
+                                                 {0.0, 0.0},
+                                                 thickness_domain,
+                                                 interpolation);
+        };
+        if(config_.get<bool>("single_precision", false)) {
+            LOG(DEBUG) << "Weighting potential is stored with single precision";
+            set_grid(read_field(field_parser_single_));
+        } else {
+            set_grid(read_field(field_parser_));
+        }
+
+        // Store the potential in a sparse hierarchical grid, coarsening regions where the potential varies little
+        if(config_.get<bool>("adaptive_grid", false)) {
+            auto tolerance = config_.get<double>("adaptive_tolerance", 1e-3);
+            if(tolerance < 0) {
+                throw InvalidValueError(config_, "adaptive_tolerance", "tolerance cannot be negative");
+            }
+            auto values = detector_->makeWeightingPotentialAdaptive(tolerance);
+            LOG(INFO) << "Stored weighting potential in sparse hierarchical grid with " << values << " values";
+        }
+
+        // Store the weighting potential in bricks of neighboring cells to improve the locality of the lookups
+        if(config_.get<bool>("tiled_grid", false)) {
+            if(config_.get<bool>("adaptive_grid", false)) {
+                throw InvalidCombinationError(
+                    config_, {"adaptive_grid", "tiled_grid"}, "the sparse hierarchical grid is already stored in bricks");
+            }
+            auto values = detector_->makeWeightingPotentialTiled();
+            LOG(INFO) << "Stored weighting potential in tiled grid of 8x8x8 cells with " << values << " values";
+        }
+
+        // Back the grid with huge pages to reduce the misses of the translation lookaside buffer for large grids
+        if(config_.get<bool>("huge_pages", false)) {
+            if(detector_->useHugePagesForWeightingPotential()) {
+                LOG(DEBUG) << "Weighting potential is stored in memory backed by transparent huge pages";
+            } else {
+                LOG(WARNING) << "Transparent huge pages are not available, weighting potential is stored in regular pages";
+            }
+        }
     } else if(field_model == WeightingPotential::PAD) {
         LOG(TRACE) << "Adding weighting potential from pad in plane condenser";
 
@@ -101,6 +153,24 @@ void WeightingPotentialReaderModule::initialize() {
 
         auto function = get_pad_potential_function({implant.x(), implant.y()}, thickness_domain);
         detector_->setWeightingPotentialFunction(function, thickness_domain, FieldType::CUSTOM);
+
+        // Sample the potential function onto a grid around the reference pixel if requested
+        if(config_.get<bool>("tabulate", false)) {
+            auto bins = config_.getArray<size_t>("tabulate_bins", {100, 100, 100});
+            if(bins.size() != 3 || std::find(bins.begin(), bins.end(), 0) != bins.end()) {
+                throw InvalidValueError(
+                    config_, "tabulate_bins", "three non-zero numbers of bins in x, y and z are required");
+            }
+            auto size = config_.get<ROOT::Math::XYVector>(
+                "tabulate_size", {3 * model->getPixelSize().x(), 3 * model->getPixelSize().y()});
+            if(size.x() <= 0 || size.y() <= 0) {
+                throw InvalidValueError(config_, "tabulate_size", "size of the grid has to be positive");
+            }
+            LOG(INFO) << "Sampling weighting potential function onto grid of size "
+                      << Units::display(size, {"um", "mm"}) << " with " << bins[0] << "x" << bins[1] << "x" << bins[2]
+                      << " bins";
+            detector_->tabulateWeightingPotential({{bins[0], bins[1], bins[2]}}, {{size.x(), size.y()}});
+        }
     }
 
     // Produce histograms if needed
@@ -264,20 +334,31 @@ void WeightingPotentialReaderModule::create_output_plots() {
 
 /**
  * The field data read from files are shared between module instantiations
- * using the static FieldParser's getByFileName method.
+ * using the static FieldParser's getByFileName method, and between detectors and modules using the process-wide
+ * FieldStore.
  */
-FieldParser<double> WeightingPotentialReaderModule::field_parser_(FieldQuantity::SCALAR);
-FieldData<double> WeightingPotentialReaderModule::read_field() {
+FieldParser<double> WeightingPotentialReaderModule::field_parser_(FieldQuantity::SCALAR, true);
+FieldParser<float> WeightingPotentialReaderModule::field_parser_single_(FieldQuantity::SCALAR, true);
+template <typename T> FieldData<T> WeightingPotentialReaderModule::read_field(FieldParser<T>& field_parser) {
     using namespace ROOT::Math;
 
     try {
         LOG(TRACE) << "Fetching weighting potential from init file";
 
-        // Get field from file
-        auto field_data = field_parser_.getByFileName(config_.getPath("file_name", true));
+        // Get field from file, optionally through a cache directory holding previously parsed fields
+        std::filesystem::path cache_directory;
+        if(config_.has("cache_directory")) {
+            cache_directory = config_.getPath("cache_directory");
+        }
+        // Fields with identical file are shared between all detectors and modules through the field store
+        auto file_name = config_.getPath("file_name", true);
+        auto field_data = FieldStore<T>::getInstance().get(FieldStore<T>::key(file_name, ""), [&]() {
+            return field_parser.getByFileName(file_name, "", cache_directory);
+        });
 
         // Check maximum/minimum values of the potential:
-        auto elements = std::minmax_element(field_data.getData()->begin(), field_data.getData()->end());
+        auto values = field_data.getValues();
+        auto elements = std::minmax_element(values.begin(), values.end());
         if(*elements.first < 0 || *elements.second > 1) {
             throw InvalidValueError(config_,
                                     "file_name",
@@ -315,3 +396,56 @@ FieldData<double> WeightingPotentialReaderModule::read_field() {
         throw InvalidValueError(config_, "file_name", "file too large");
     }
 }
+
+/**
+ * The potential is compared to its mirror images in x and y, deviations larger than the configured tolerance are
+ * rejected. Only the quadrant with positive coordinates is kept, the lookup restores the other quadrants by mirroring it
+ * at the pixel center.
+ */
+template <typename T> FieldData<T> WeightingPotentialReaderModule::fold_field(const FieldData<T>& field_data) {
+    // Folded potentials are shared between all detectors and modules folding the same file with the same tolerance
+    auto tolerance = config_.get<double>("fold_tolerance", 1e-3);
+    auto key = FieldStore<T>::key(config_.getPath("file_name", true), "", "fold " + std::to_string(tolerance));
+    return FieldStore<T>::getInstance().get(key, [&]() -> FieldData<T> {
+        auto [x_bins, y_bins, z_bins] = field_data.getDimensions();
+        if(x_bins % 2 != 0 || y_bins % 2 != 0) {
+            throw InvalidValueError(config_, "fold_potential", "folding requires an even number of bins in x and y");
+        }
+
+        auto values = field_data.getValues();
+        auto index = [&, y_bins = y_bins, z_bins = z_bins](size_t x, size_t y, size_t z) {
+            return (x * y_bins + y) * z_bins + z;
+        };
+
+        auto folded = std::make_shared<std::vector<T>>(x_bins / 2 * y_bins / 2 * z_bins);
+        double deviation = 0;
+        for(size_t x = x_bins / 2; x < x_bins; ++x) {
+            for(size_t y = y_bins / 2; y < y_bins; ++y) {
+                for(size_t z = 0; z < z_bins; ++z) {
+                    auto value = values[index(x, y, z)];
+                    auto mirror_x = values[index(x_bins - 1 - x, y, z)];
+                    auto mirror_y = values[index(x, y_bins - 1 - y, z)];
+                    auto mirror_xy = values[index(x_bins - 1 - x, y_bins - 1 - y, z)];
+                    deviation = std::max({deviation,
+                                          std::fabs(static_cast<double>(value - mirror_x)),
+                                          std::fabs(static_cast<double>(value - mirror_y)),
+                                          std::fabs(static_cast<double>(value - mirror_xy))});
+                    (*folded)[((x - x_bins / 2) * (y_bins / 2) + (y - y_bins / 2)) * z_bins + z] = value;
+                }
+            }
+        }
+
+        // The potential is normalized to the range from zero to one, the tolerance is therefore absolute:
+        if(deviation > tolerance) {
+            throw InvalidValueError(config_,
+                                    "fold_potential",
+                                    "weighting potential is not symmetric in x and y, found deviation of " +
+                                        std::to_string(deviation) + " from its mirror image");
+        }
+
+        auto size = field_data.getSize();
+        LOG(INFO) << "Folded weighting potential onto quadrant with " << x_bins / 2 << "x" << y_bins / 2 << "x" << z_bins
+                  << " cells";
+        return {field_data.getHeader(), {{x_bins / 2, y_bins / 2, z_bins}}, {{size[0] / 2, size[1] / 2, size[2]}}, folded};
+    });
+}
@@ -18,6 +18,7 @@
 #include "core/geometry/GeometryManager.hpp"
 #include "core/messenger/Messenger.hpp"
 #include "tools/field_parser.h"
+#include "tools/field_store.h"
 
 #include "core/module/Module.hpp"
 
@@ -62,10 +63,19 @@ namespace allpix {
 
         /**
          * @brief Read field from a file in init or apf format
+         * @param field_parser Parser for the requested precision of the field values
          * @return Data of the field read from file
          */
-        FieldData<double> read_field();
+        template <typename T> FieldData<T> read_field(FieldParser<T>& field_parser);
         static FieldParser<double> field_parser_;
+        static FieldParser<float> field_parser_single_;
+
+        /**
+         * @brief Fold a weighting potential symmetric in x and y onto the quadrant with positive coordinates
+         * @param field_data Data of the potential spanning the full pixel plane
+         * @return Data of the potential in the quadrant
+         */
+        template <typename T> FieldData<T> fold_field(const FieldData<T>& field_data);
 
         /**
          * @brief Create output plots of the weighting potential profile
@@ -12,6 +12,9 @@
 #ifndef ALLPIX_MC_PARTICLE_H
 #define ALLPIX_MC_PARTICLE_H
 
+#include <memory>
+#include <vector>
+
 #include <Math/Point3D.h>
 #include <TRef.h>
 
@@ -205,6 +208,14 @@ namespace allpix {
      * @brief Typedef for message carrying MC particles
      */
     using MCParticleMessage = Message<MCParticle>;
+
+    /**
+     * @brief Shared immutable set of Monte-Carlo particles contributing to an object, ordered by their address
+     *
+     * Objects derived from each other in the same event refer to the same set instead of copying and de-duplicating the
+     * references to the particles again.
+     */
+    using MCParticleHistory = std::shared_ptr<const std::vector<const MCParticle*>>;
 } // namespace allpix
 
 #endif /* ALLPIX_MC_PARTICLE_H */
@@ -13,6 +13,48 @@
 
 using namespace allpix;
 
+thread_local const RelationIndex* RelationIndex::active_ = nullptr;
+
+std::uint32_t RelationIndex::getMessageId(const std::string& name) {
+    // FNV-1a hash of the name, stable across runs and platforms
+    std::uint32_t hash = 2166136261U;
+    for(auto character : name) {
+        hash ^= static_cast<std::uint8_t>(character);
+        hash *= 16777619U;
+    }
+    // Zero is reserved for objects which are not indexed
+    return (hash == 0 ? 1 : hash);
+}
+
+void RelationIndex::add(std::uint32_t message_id, const std::vector<Object*>& objects) {
+    auto& message = messages_[message_id];
+    for(auto* object : objects) {
+        identifiers_.emplace(object, std::make_pair(message_id, static_cast<std::int32_t>(message.size())));
+        message.push_back(object);
+    }
+}
+
+std::pair<std::uint32_t, std::int32_t> RelationIndex::find(const Object* object) const {
+    auto iter = identifiers_.find(object);
+    if(iter == identifiers_.end()) {
+        return {0, -1};
+    }
+    return iter->second;
+}
+
+Object* RelationIndex::get(std::uint32_t message_id, std::int32_t index) const {
+    auto iter = messages_.find(message_id);
+    if(iter == messages_.end() || index < 0 || static_cast<size_t>(index) >= iter->second.size()) {
+        return nullptr;
+    }
+    return iter->second[static_cast<size_t>(index)];
+}
+
+void RelationIndex::clear() {
+    identifiers_.clear();
+    messages_.clear();
+}
+
 std::ostream& allpix::operator<<(std::ostream& out, const Object& obj) {
     obj.print(out);
     return out;
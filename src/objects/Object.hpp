@@ -18,14 +18,108 @@
 #define ALLPIX_OBJECT_H
 
 #include <atomic>
+#include <cstdint>
 #include <iostream>
 #include <mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <TObject.h>
 #include <TRef.h>
 
 namespace allpix {
     template <typename T> class Message;
+    class Object;
+
+    /**
+     * @ingroup Objects
+     * @brief Index of the objects of an event, to store relations between objects without the global TRef table of ROOT
+     *
+     * Objects are identified by the identifier of their message and their position in the message. While an index is
+     * active in the calling thread, petrifying the history of an object stores the identifiers of all related objects in
+     * the index instead of creating TRefs, and loading the history resolves stored identifiers to the objects in the index.
+     * The type of the related object is given by the type of the relation.
+     */
+    class RelationIndex {
+    public:
+        /**
+         * @brief Activates an index for the calling thread for the lifetime of this object
+         */
+        class Scope {
+        public:
+            /**
+             * @brief Activate an index
+             * @param index Index to activate
+             */
+            explicit Scope(const RelationIndex& index) : previous_(active_) { active_ = &index; }
+            /**
+             * @brief Restore the previously active index
+             */
+            ~Scope() { active_ = previous_; }
+
+            /// @{
+            /**
+             * @brief Disallow copy and move
+             */
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+            Scope(Scope&&) = delete;
+            Scope& operator=(Scope&&) = delete;
+            /// @}
+
+        private:
+            const RelationIndex* previous_;
+        };
+
+        /**
+         * @brief Get a stable identifier of a message from its name
+         * @param name Unique name of the message, e.g. the object type combined with detector and message name
+         * @return Identifier of the message, never zero
+         */
+        static std::uint32_t getMessageId(const std::string& name);
+
+        /**
+         * @brief Get the index active for the calling thread
+         * @return Pointer to the active index or a null pointer if relations are stored as TRefs
+         */
+        static const RelationIndex* getActive() { return active_; }
+
+        /**
+         * @brief Add the objects of a message to the index
+         * @param message_id Identifier of the message
+         * @param objects Objects of the message
+         */
+        void add(std::uint32_t message_id, const std::vector<Object*>& objects);
+
+        /**
+         * @brief Find the identifier of an object
+         * @param object Object to find
+         * @return Identifier of the message and position of the object, or zero and -1 if the object is not indexed
+         */
+        std::pair<std::uint32_t, std::int32_t> find(const Object* object) const;
+
+        /**
+         * @brief Get an object by its identifier
+         * @param message_id Identifier of the message
+         * @param index Position of the object in the message
+         * @return Pointer to the object or a null pointer if the object is not indexed
+         */
+        Object* get(std::uint32_t message_id, std::int32_t index) const;
+
+        /**
+         * @brief Remove all objects from the index
+         */
+        void clear();
+
+    private:
+        static thread_local const RelationIndex* active_;
+
+        std::unordered_map<const Object*, std::pair<std::uint32_t, std::int32_t>> identifiers_;
+        std::unordered_map<std::uint32_t, std::vector<Object*>> messages_;
+    };
 
     /**
      * @ingroup Objects
@@ -137,15 +231,20 @@ namespace allpix {
             /**
              * @brief Function to construct TRef object for wrapped pointer for persistent storage
              *
+             * If a \ref RelationIndex is active, the identifier of the object in the index is stored instead of a TRef.
+             *
              * @note A TRef is only constructed if the object the wrapped pointer is referring to has been marked for storage
              */
             void store() {
-                if(markedForStorage()) {
+                const auto* index = RelationIndex::getActive();
+                if(index != nullptr) {
+                    std::tie(message_id_, index_) = index->find(get());
+                } else if(markedForStorage()) {
                     ref_ = get();
                 }
             }
 
-            ClassDef(BaseWrapper, 1); // NOLINT
+            ClassDef(BaseWrapper, 2); // NOLINT
 
         protected:
             /**
@@ -161,6 +260,10 @@ namespace allpix {
 
             mutable T* ptr_{}; //! transient value
             TRef ref_{};
+
+            // Identifier of the object in the relation index, if not stored as TRef
+            std::uint32_t message_id_{};
+            std::int32_t index_{-1};
         };
 
         template <class T> class PointerWrapper : public BaseWrapper<T> {
@@ -212,12 +315,20 @@ namespace allpix {
             /**
              * @brief Implementation of base class lazy loading mechanism with thread-safe call_once
              * @return Pointer to object
+             *
+             * Relations stored in a \ref RelationIndex are resolved from the index active when loading the pointer.
              */
             T* get() const override {
-                // Lazy loading of pointer from TRef
+                // Lazy loading of pointer from relation index or TRef
                 if(!this->loaded_) {
                     std::call_once(load_flag_, [&]() {
-                        this->ptr_ = static_cast<T*>(this->ref_.GetObject());
+                        const auto* index = RelationIndex::getActive();
+                        if(this->index_ >= 0) {
+                            this->ptr_ = (index == nullptr ? nullptr
+                                                           : dynamic_cast<T*>(index->get(this->message_id_, this->index_)));
+                        } else {
+                            this->ptr_ = static_cast<T*>(this->ref_.GetObject());
+                        }
                         this->loaded_ = true;
                     });
                 }
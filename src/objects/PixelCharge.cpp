@@ -11,30 +11,50 @@
 
 #include "PixelCharge.hpp"
 
-#include <set>
+#include <algorithm>
+#include <memory>
+#include <utility>
 #include "objects/exceptions.h"
 
 using namespace allpix;
 
 PixelCharge::PixelCharge(Pixel pixel, long charge, const std::vector<const PropagatedCharge*>& propagated_charges)
     : pixel_(std::move(pixel)), charge_(charge) {
-    // Unique set of MC particles
-    std::set<const MCParticle*> unique_particles;
     // Store all propagated charges and their MC particles
+    std::vector<const MCParticle*> mc_particles;
+    mc_particles.reserve(propagated_charges.size());
+    propagated_charges_.reserve(propagated_charges.size());
     for(const auto& propagated_charge : propagated_charges) {
         propagated_charges_.emplace_back(propagated_charge);
-        unique_particles.insert(propagated_charge->mc_particle_.get());
+        mc_particles.push_back(propagated_charge->mc_particle_.get());
     }
-    // Store the MC particle references
-    for(const auto& mc_particle : unique_particles) {
+    set_mc_particles(std::move(mc_particles));
+
+    // No pulse provided, set full charge in first bin:
+    pulse_.addCharge(static_cast<double>(charge), 0);
+}
+
+PixelCharge::PixelCharge(Pixel pixel, long charge, const std::vector<const MCParticle*>& mc_particles)
+    : pixel_(std::move(pixel)), charge_(charge) {
+    set_mc_particles(mc_particles);
+
+    // No pulse provided, set full charge in first bin:
+    pulse_.addCharge(static_cast<double>(charge), 0);
+}
+
+void PixelCharge::set_mc_particles(std::vector<const MCParticle*> mc_particles) {
+    // Unique set of MC particles, shared with the objects derived from this pixel charge
+    std::sort(mc_particles.begin(), mc_particles.end(), std::less<>());
+    mc_particles.erase(std::unique(mc_particles.begin(), mc_particles.end()), mc_particles.end());
+    for(const auto& mc_particle : mc_particles) {
         // Local and global time are set as the earliest time found among the MCParticles:
         if(mc_particle != nullptr) {
             const auto* primary = mc_particle->getPrimary();
             local_time_ = std::min(local_time_, primary->getLocalTime());
             global_time_ = std::min(global_time_, primary->getGlobalTime());
         }
-        mc_particles_.emplace_back(mc_particle);
     }
+    mc_history_ = std::make_shared<const std::vector<const MCParticle*>>(std::move(mc_particles));
 
     // If no appropriate reference time has been found, set them to zero:
     if(local_time_ > std::numeric_limits<double>::max()) {
@@ -43,9 +63,6 @@ PixelCharge::PixelCharge(Pixel pixel, long charge, const std::vector<const Propa
     if(global_time_ > std::numeric_limits<double>::max()) {
         global_time_ = 0.;
     }
-
-    // No pulse provided, set full charge in first bin:
-    pulse_.addCharge(static_cast<double>(charge), 0);
 }
 
 // WARNING PixelCharge always returns a positive "collected" charge...
@@ -64,6 +81,8 @@ unsigned long PixelCharge::getAbsoluteCharge() const { return static_cast<unsign
 
 const Pulse& PixelCharge::getPulse() const { return pulse_; }
 
+Pulse PixelCharge::releasePulse() { return std::exchange(pulse_, Pulse()); }
+
 double PixelCharge::getGlobalTime() const { return global_time_; }
 
 double PixelCharge::getLocalTime() const { return local_time_; }
@@ -91,6 +110,12 @@ std::vector<const PropagatedCharge*> PixelCharge::getPropagatedCharges() const {
  * MCParticles can only be fetched if the full history of objects are in scope and stored
  */
 std::vector<const MCParticle*> PixelCharge::getMCParticles() const {
+    if(mc_history_) {
+        if(std::find(mc_history_->begin(), mc_history_->end(), nullptr) != mc_history_->end()) {
+            throw MissingReferenceException(typeid(*this), typeid(MCParticle));
+        }
+        return *mc_history_;
+    }
 
     std::vector<const MCParticle*> mc_particles;
     for(const auto& mc_particle : mc_particles_) {
@@ -111,12 +136,7 @@ std::vector<const MCParticle*> PixelCharge::getMCParticles() const {
  */
 std::vector<const MCParticle*> PixelCharge::getPrimaryMCParticles() const {
     std::vector<const MCParticle*> primary_particles;
-    for(const auto& mc_particle : mc_particles_) {
-        auto* particle = mc_particle.get();
-        if(particle == nullptr) {
-            throw MissingReferenceException(typeid(*this), typeid(MCParticle));
-        }
-
+    for(const auto* particle : getMCParticles()) {
         // Check for possible parents:
         if(particle->getParent() != nullptr) {
             continue;
@@ -128,6 +148,21 @@ std::vector<const MCParticle*> PixelCharge::getPrimaryMCParticles() const {
     return primary_particles;
 }
 
+MCParticleHistory PixelCharge::get_mc_history() const {
+    if(mc_history_) {
+        return mc_history_;
+    }
+
+    std::vector<const MCParticle*> mc_particles;
+    mc_particles.reserve(mc_particles_.size());
+    for(const auto& mc_particle : mc_particles_) {
+        mc_particles.push_back(mc_particle.get());
+    }
+    std::sort(mc_particles.begin(), mc_particles.end(), std::less<>());
+    mc_particles.erase(std::unique(mc_particles.begin(), mc_particles.end()), mc_particles.end());
+    return std::make_shared<const std::vector<const MCParticle*>>(std::move(mc_particles));
+}
+
 void PixelCharge::print(std::ostream& out) const {
     auto local_center_location = pixel_.getLocalCenter();
     auto global_center_location = pixel_.getGlobalCenter();
@@ -149,6 +184,9 @@ void PixelCharge::loadHistory() {
     std::for_each(mc_particles_.begin(), mc_particles_.end(), [](auto& n) { n.get(); });
 }
 void PixelCharge::petrifyHistory() {
+    if(mc_history_ && mc_particles_.empty()) {
+        mc_particles_.assign(mc_history_->begin(), mc_history_->end());
+    }
     std::for_each(propagated_charges_.begin(), propagated_charges_.end(), [](auto& n) { n.store(); });
     std::for_each(mc_particles_.begin(), mc_particles_.end(), [](auto& n) { n.store(); });
 }
@@ -15,6 +15,7 @@
 #include <Math/DisplacementVector2D.h>
 #include <TRef.h>
 #include <algorithm>
+#include <set>
 
 #include "MCParticle.hpp"
 #include "Object.hpp"
@@ -42,6 +43,14 @@ namespace allpix {
                     long charge,
                     const std::vector<const PropagatedCharge*>& propagated_charges = std::vector<const PropagatedCharge*>());
 
+        /**
+         * @brief Construct a set of charges at a pixel without references to the propagated charges
+         * @param pixel Object holding the information of the pixel
+         * @param charge Amount of charge stored at this pixel
+         * @param mc_particles Monte-Carlo particles contributing to the charge, duplicates are ignored
+         */
+        PixelCharge(Pixel pixel, long charge, const std::vector<const MCParticle*>& mc_particles);
+
         /**
          * @brief Construct a set of charges at a pixel
          * @param pixel Object holding the information of the pixel
@@ -101,6 +110,12 @@ namespace allpix {
          */
         const Pulse& getPulse() const;
 
+        /**
+         *  @brief Move the recorded charge pulse out of this object, leaving an uninitialized pulse behind
+         *  @return Full charge pulse
+         */
+        Pulse releasePulse();
+
         /**
          * @brief Get time after start of event in global reference frame
          * @return Time from start event
@@ -132,6 +147,18 @@ namespace allpix {
         void petrifyHistory() override;
 
     private:
+        /**
+         * @brief Store the contributing Monte-Carlo particles and take the earliest time of their primaries
+         * @param mc_particles Contributing Monte-Carlo particles, duplicates are removed
+         */
+        void set_mc_particles(std::vector<const MCParticle*> mc_particles);
+
+        /**
+         * @brief Get the shared set of contributing Monte-Carlo particles for objects derived from this pixel charge
+         * @return Set of particles, created from the stored references if the object has been read from file
+         */
+        MCParticleHistory get_mc_history() const;
+
         Pixel pixel_;
         long charge_{};
         Pulse pulse_{};
@@ -141,6 +168,8 @@ namespace allpix {
 
         std::vector<PointerWrapper<PropagatedCharge>> propagated_charges_;
         std::vector<PointerWrapper<MCParticle>> mc_particles_;
+        // References to the particles are only created from the shared set once the object is stored
+        MCParticleHistory mc_history_; //! transient value
     };
 
     /**
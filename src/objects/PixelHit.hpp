@@ -128,6 +128,8 @@ namespace allpix {
         PointerWrapper<PixelCharge> pixel_charge_;
         PointerWrapper<PixelPulse> pixel_pulse_;
         std::vector<PointerWrapper<MCParticle>> mc_particles_;
+        // Set of particles shared with the pixel charge, references are only created once the object is stored
+        MCParticleHistory mc_history_; //! transient value
     };
 
     /**
@@ -11,7 +11,7 @@
 
 #include "PixelPulse.hpp"
 
-#include <set>
+#include <algorithm>
 
 #include "DepositedCharge.hpp"
 #include "PropagatedCharge.hpp"
@@ -28,15 +28,8 @@ PixelPulse::PixelPulse(Pixel pixel, const Pulse& pulse, const PixelCharge* pixel
         local_time_ = pixel_charge->getLocalTime();
         global_time_ = pixel_charge->getGlobalTime();
 
-        // Get the unique set of MC particles
-        std::set<const MCParticle*> unique_particles;
-        for(const auto& mc_particle : pixel_charge->mc_particles_) {
-            unique_particles.insert(mc_particle.get());
-        }
-        // Store the MC particle references
-        for(const auto& mc_particle : unique_particles) {
-            mc_particles_.emplace_back(mc_particle);
-        }
+        // Share the unique set of MC particles of the pixel charge
+        mc_history_ = pixel_charge->get_mc_history();
     }
 }
 
@@ -67,6 +60,12 @@ const PixelCharge* PixelPulse::getPixelCharge() const {
  * MCParticles can only be fetched if the full history of objects are in scope and stored
  */
 std::vector<const MCParticle*> PixelPulse::getMCParticles() const {
+    if(mc_history_) {
+        if(std::find(mc_history_->begin(), mc_history_->end(), nullptr) != mc_history_->end()) {
+            throw MissingReferenceException(typeid(*this), typeid(MCParticle));
+        }
+        return *mc_history_;
+    }
 
     std::vector<const MCParticle*> mc_particles;
     for(const auto& mc_particle : mc_particles_) {
@@ -87,12 +86,7 @@ std::vector<const MCParticle*> PixelPulse::getMCParticles() const {
  */
 std::vector<const MCParticle*> PixelPulse::getPrimaryMCParticles() const {
     std::vector<const MCParticle*> primary_particles;
-    for(const auto& mc_particle : mc_particles_) {
-        auto* particle = mc_particle.get();
-        if(particle == nullptr) {
-            throw MissingReferenceException(typeid(*this), typeid(MCParticle));
-        }
-
+    for(const auto* particle : getMCParticles()) {
         // Check for possible parents:
         if(particle->getParent() != nullptr) {
             continue;
@@ -114,6 +108,9 @@ void PixelPulse::loadHistory() {
     std::for_each(mc_particles_.begin(), mc_particles_.end(), [](auto& n) { n.get(); });
 }
 void PixelPulse::petrifyHistory() {
+    if(mc_history_ && mc_particles_.empty()) {
+        mc_particles_.assign(mc_history_->begin(), mc_history_->end());
+    }
     pixel_charge_.store();
     std::for_each(mc_particles_.begin(), mc_particles_.end(), [](auto& n) { n.store(); });
 }
@@ -11,6 +11,7 @@
 
 #include <magic_enum/magic_enum.hpp>
 #include <numeric>
+#include <utility>
 
 #include "PropagatedCharge.hpp"
 
@@ -34,6 +35,16 @@ PropagatedCharge::PropagatedCharge(ROOT::Math::XYZPoint local_position,
     }
 }
 
+PropagatedCharge::PropagatedCharge(const PropagatedChargeData& data)
+    : PropagatedCharge(data.getLocalPosition(),
+                       data.getGlobalPosition(),
+                       data.getType(),
+                       data.getCharge(),
+                       data.getLocalTime(),
+                       data.getGlobalTime(),
+                       data.getState(),
+                       data.getDepositedCharge()) {}
+
 PropagatedCharge::PropagatedCharge(ROOT::Math::XYZPoint local_position,
                                    ROOT::Math::XYZPoint global_position,
                                    CarrierType type,
@@ -84,7 +95,15 @@ const MCParticle* PropagatedCharge::getMCParticle() const {
     return mc_particle;
 }
 
-std::map<Pixel::Index, Pulse> PropagatedCharge::getPulses() const { return pulses_; }
+const std::map<Pixel::Index, Pulse>& PropagatedCharge::getPulses() const { return pulses_; }
+
+std::map<Pixel::Index, Pulse> PropagatedCharge::releasePulses() {
+    auto pulses = std::move(pulses_);
+    pulses_.clear();
+    return pulses;
+}
+
+void PropagatedCharge::setPulses(std::map<Pixel::Index, Pulse> pulses) { pulses_ = std::move(pulses); }
 
 CarrierState PropagatedCharge::getState() const { return state_; }
 
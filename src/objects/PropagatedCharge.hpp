@@ -33,6 +33,62 @@ namespace allpix {
         HALTED, ///< The carrier has come to a halt because it, for example, has reached the sensor surface or an implant
     };
 
+    /**
+     * @brief Plain in-memory representation of a set of propagated charges
+     *
+     * Holds the same information as a \ref PropagatedCharge without pulses, but without the bookkeeping of a ROOT object
+     * and its relations. Modules can use it to collect large numbers of sets of charges in the hot path of the propagation
+     * and convert them to PropagatedCharge objects only once when dispatching them.
+     */
+    class PropagatedChargeData {
+    public:
+        /**
+         * @brief Construct the data of a set of propagated charges
+         * @param local_position Local position of the propagated set of charges in the sensor
+         * @param global_position Global position of the propagated set of charges in the sensor
+         * @param type Type of the carrier to propagate
+         * @param charge Total charge propagated
+         * @param local_time Time of propagation arrival after energy deposition, local reference frame
+         * @param global_time Total time of propagation arrival after event start, global reference frame
+         * @param state State of the charge carrier when reaching its position
+         * @param deposited_charge Optional pointer to related deposited charge
+         */
+        PropagatedChargeData(const ROOT::Math::XYZPoint& local_position,
+                             const ROOT::Math::XYZPoint& global_position,
+                             CarrierType type,
+                             unsigned int charge,
+                             double local_time,
+                             double global_time,
+                             CarrierState state = CarrierState::UNKNOWN,
+                             const DepositedCharge* deposited_charge = nullptr)
+            : local_position_(local_position), global_position_(global_position), local_time_(local_time),
+              global_time_(global_time), deposited_charge_(deposited_charge), charge_(charge), type_(type), state_(state) {}
+
+        /// @{
+        /**
+         * @brief Get the properties of the set of charges, identical to the ones of the \ref PropagatedCharge
+         */
+        const ROOT::Math::XYZPoint& getLocalPosition() const { return local_position_; }
+        const ROOT::Math::XYZPoint& getGlobalPosition() const { return global_position_; }
+        CarrierType getType() const { return type_; }
+        unsigned int getCharge() const { return charge_; }
+        double getLocalTime() const { return local_time_; }
+        double getGlobalTime() const { return global_time_; }
+        CarrierState getState() const { return state_; }
+        const DepositedCharge* getDepositedCharge() const { return deposited_charge_; }
+        /// @}
+
+    private:
+        ROOT::Math::XYZPoint local_position_;
+        ROOT::Math::XYZPoint global_position_;
+        double local_time_{};
+        double global_time_{};
+        const DepositedCharge* deposited_charge_{};
+        unsigned int charge_{};
+        CarrierType type_{};
+        CarrierState state_{CarrierState::UNKNOWN};
+    };
+
     /**
      * @ingroup Objects
      * @brief Set of charges propagated through the sensor
@@ -61,6 +117,12 @@ namespace allpix {
                          CarrierState state = CarrierState::UNKNOWN,
                          const DepositedCharge* deposited_charge = nullptr);
 
+        /**
+         * @brief Construct a set of propagated charges from its plain in-memory representation
+         * @param data Data of the set of propagated charges
+         */
+        explicit PropagatedCharge(const PropagatedChargeData& data);
+
         /**
          * @brief Construct a set of propagated charges
          * @param local_position Local position of the propagated set of charges in the sensor
@@ -95,9 +157,21 @@ namespace allpix {
 
         /**
          * @brief Get related induced pulses
+         * @return Constant reference to the map with induced pulses if available
+         */
+        const std::map<Pixel::Index, Pulse>& getPulses() const;
+
+        /**
+         * @brief Move the related induced pulses out of this object, leaving it without pulses
          * @return Map with induced pulses if available
          */
-        std::map<Pixel::Index, Pulse> getPulses() const;
+        std::map<Pixel::Index, Pulse> releasePulses();
+
+        /**
+         * @brief Replace the related induced pulses
+         * @param pulses Map with induced pulses
+         */
+        void setPulses(std::map<Pixel::Index, Pulse> pulses);
 
         /**
          * @brief Get state of the charge carrier
@@ -13,7 +13,10 @@
 
 #include "objects/exceptions.h"
 
+#include <algorithm>
 #include <cmath>
+#include <functional>
+#include <iterator>
 #include <numeric>
 
 using namespace allpix;
@@ -34,11 +37,15 @@ void Pulse::addCharge(double charge, double time) {
     auto bin = (initialized_ ? static_cast<size_t>(std::lround(time / bin_)) : 0);
 
     try {
-        // Adapt pulse storage vector:
-        if(bin >= this->size()) {
-            this->resize(bin + 1);
+        // Adapt pulse storage vector, in front of the stored bins for compacted pulses:
+        if(bin < offset_) {
+            this->insert(this->begin(), offset_ - bin, 0.);
+            offset_ = bin;
         }
-        this->at(bin) += charge;
+        if(bin - offset_ >= this->size()) {
+            this->resize(bin - offset_ + 1);
+        }
+        this->at(bin - offset_) += charge;
     } catch(const std::bad_alloc& e) {
         PulseBadAllocException(bin + 1, time, e.what());
     }
@@ -53,6 +60,27 @@ double Pulse::getBinning() const { return bin_; }
 
 bool Pulse::isInitialized() const { return initialized_; }
 
+size_t Pulse::getOffset() const { return offset_; }
+
+void Pulse::compact() {
+    auto first = std::find_if(this->begin(), this->end(), [](auto bin) { return bin != 0.; });
+    if(first == this->end()) {
+        this->clear();
+        offset_ = 0;
+        return;
+    }
+    auto last = std::find_if(this->rbegin(), this->rend(), [](auto bin) { return bin != 0.; });
+    this->erase(last.base(), this->end());
+    offset_ += static_cast<size_t>(std::distance(this->begin(), first));
+    this->erase(this->begin(), first);
+    this->shrink_to_fit();
+}
+
+void Pulse::expand() {
+    this->insert(this->begin(), offset_, 0.);
+    offset_ = 0;
+}
+
 Pulse& Pulse::operator+=(const Pulse& rhs) {
     // Allow to initialize uninitialized pulse
     if(!this->initialized_) {
@@ -65,15 +93,19 @@ Pulse& Pulse::operator+=(const Pulse& rhs) {
         throw IncompatibleDatatypesException(typeid(*this), typeid(rhs), "different time binning");
     }
 
-    // If new pulse is longer, extend:
-    if(this->size() < rhs.size()) {
-        this->resize(rhs.size());
+    // If new pulse starts earlier or ends later, extend:
+    if(rhs.offset_ < this->offset_) {
+        this->insert(this->begin(), this->offset_ - rhs.offset_, 0.);
+        this->offset_ = rhs.offset_;
     }
-
-    // Add up the individual bins:
-    for(size_t bin = 0; bin < rhs.size(); bin++) {
-        this->at(bin) += rhs.at(bin);
+    auto shift = rhs.offset_ - this->offset_;
+    if(this->size() < rhs.size() + shift) {
+        this->resize(rhs.size() + shift);
     }
 
+    // Add up the individual bins in a single loop over the aligned ranges:
+    auto target = this->begin() + static_cast<std::ptrdiff_t>(shift);
+    std::transform(rhs.begin(), rhs.end(), target, target, std::plus<>());
+
     return *this;
 }
@@ -12,6 +12,7 @@
 #ifndef ALLPIX_PULSE_H
 #define ALLPIX_PULSE_H
 
+#include <cstddef>
 #include <vector>
 
 #include <TObject.h>
@@ -21,6 +22,11 @@ namespace allpix {
      * @ingroup Objects
      * @brief Pulse holding induced charges as a function of time
      * @warning This object is special and is not meant to be written directly to a tree (not inheriting from \ref Object)
+     *
+     * The pulse stores the bins starting from the bin returned by \ref getOffset, which is zero unless the pulse has been
+     * compacted using \ref compact. Compacted pulses omit all leading and trailing bins without charge. Adding charge and
+     * adding pulses take the offset into account, and summing compacted pulses into a pulse without offset yields the full
+     * pulse again.
      */
     class Pulse : public std::vector<double> {
     public:
@@ -68,20 +74,39 @@ namespace allpix {
          */
         bool isInitialized() const;
 
+        /**
+         * @brief Function to retrieve the first stored bin of the pulse
+         * @return Index of the time bin stored first, all earlier bins are empty
+         */
+        size_t getOffset() const;
+
+        /**
+         * @brief Remove all leading and trailing bins without charge from the stored range of bins
+         */
+        void compact();
+
+        /**
+         * @brief Restore all leading bins without charge such that the stored bins start at time zero
+         */
+        void expand();
+
         /**
          * @brief compound assignment operator to sum different pulses
          * @throws IncompatibleDatatypesException If the binning of the pulses does not match
+         *
+         * The offset of the sum is the smaller offset of both pulses.
          */
         Pulse& operator+=(const Pulse& rhs);
 
         /**
          * @brief Default constructor for ROOT I/O
          */
-        ClassDef(Pulse, 3); // NOLINT
+        ClassDef(Pulse, 4); // NOLINT
 
     private:
         double bin_{};
         bool initialized_{};
+        size_t offset_{};
     };
 
 } // namespace allpix
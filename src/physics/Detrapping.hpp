@@ -14,6 +14,7 @@
 
 #include <TFormula.h>
 
+#include "ModelDispatch.hpp"
 #include "exceptions.h"
 
 #include "core/config/Configuration.hpp"
@@ -120,6 +121,19 @@ namespace allpix {
             return model_->operator()(std::forward<ARGS>(args)...);
         }
 
+        /**
+         * @brief Call a function with the detrapping model, resolving the type of the model only once
+         * @param function Function called with a reference to the model which can be called as this wrapper
+         * @return Result of the function
+         *
+         * Calls to the model within the function are dispatched statically for all known model types instead of through
+         * the virtual function call operator, see \ref ModelTypes. This allows hoisting the dispatch out of loops over many
+         * evaluations of the model.
+         */
+        template <typename F> decltype(auto) visit(F&& function) const {
+            return ModelTypes<NoDetrapping, ConstantDetrapping>::visit(*model_, std::forward<F>(function));
+        }
+
     private:
         std::unique_ptr<DetrappingModel> model_{};
     };
@@ -17,12 +17,17 @@
 
 #include <TFormula.h>
 
+#include "ModelDispatch.hpp"
+#include "Tabulated.hpp"
 #include "exceptions.h"
 
 #include "core/config/Configuration.hpp"
 #include "core/utils/log.h"
 #include "core/utils/unit.h"
+#include "core/utils/unit_constants.h"
 #include "objects/SensorCharge.hpp"
+#include "tools/compiled_formula.h"
+#include "tools/fast_math.h"
 
 namespace allpix {
 
@@ -54,12 +59,14 @@ namespace allpix {
             if(std::fabs(efield_mag) < threshold_) {
                 return 1.;
             }
-            return std::exp(step * gain_factor(type, efield_mag));
+            return fast_math::exp(step * gain_factor(type, efield_mag));
         };
 
     protected:
         virtual double gain_factor(const CarrierType& type, double efield_mag) const = 0;
         double threshold_{std::numeric_limits<double>::max()};
+
+        friend class Tabulated<ImpactIonizationModel>;
     };
 
     /**
@@ -88,17 +95,17 @@ namespace allpix {
     class Massey : virtual public ImpactIonizationModel {
     public:
         Massey(double temperature, double threshold)
-            : ImpactIonizationModel(threshold), electron_a_(Units::get(4.43e5, "/cm")),
-              electron_b_(Units::get(9.66e5, "V/cm") + Units::get(4.99e2, "V/cm/K") * temperature),
-              hole_a_(Units::get(1.13e6, "/cm")),
-              hole_b_(Units::get(1.71e6, "V/cm") + Units::get(1.09e3, "V/cm/K") * temperature) {}
+            : ImpactIonizationModel(threshold), electron_a_(4.43e5 * units::per_cm),
+              electron_b_(9.66e5 * units::V_per_cm + 4.99e2 * units::V_per_cm_K * temperature),
+              hole_a_(1.13e6 * units::per_cm),
+              hole_b_(1.71e6 * units::V_per_cm + 1.09e3 * units::V_per_cm_K * temperature) {}
 
     private:
         double gain_factor(const CarrierType& type, double efield_mag) const override {
             if(type == CarrierType::ELECTRON) {
-                return electron_a_ * std::exp(-1. * electron_b_ / efield_mag);
+                return electron_a_ * fast_math::exp(-1. * electron_b_ / efield_mag);
             } else {
-                return hole_a_ * std::exp(-1. * hole_b_ / efield_mag);
+                return hole_a_ * fast_math::exp(-1. * hole_b_ / efield_mag);
             }
         };
 
@@ -122,10 +129,10 @@ namespace allpix {
     public:
         MasseyOptimized(double temperature, double threshold)
             : ImpactIonizationModel(threshold), Massey(temperature, threshold) {
-            electron_a_ = Units::get(1.186e6, "/cm");
-            electron_b_ = Units::get(1.020e6, "V/cm") + Units::get(1.043e3, "V/cm/K") * temperature;
-            hole_a_ = Units::get(2.250e6, "/cm");
-            hole_b_ = Units::get(1.851e6, "V/cm") + Units::get(1.828e3, "V/cm/K") * temperature;
+            electron_a_ = 1.186e6 * units::per_cm;
+            electron_b_ = 1.020e6 * units::V_per_cm + 1.043e3 * units::V_per_cm_K * temperature;
+            hole_a_ = 2.250e6 * units::per_cm;
+            hole_b_ = 1.851e6 * units::V_per_cm + 1.828e3 * units::V_per_cm_K * temperature;
         };
     };
 
@@ -143,21 +150,20 @@ namespace allpix {
     public:
         VanOverstraetenDeMan(double temperature, double threshold)
             : ImpactIonizationModel(threshold),
-              gamma_(std::tanh(Units::get(0.063, "eV") / (2. * Units::get(8.6173333e-5, "eV/K") * 300.)) /
-                     std::tanh(Units::get(0.063, "eV") / (2. * Units::get(8.6173333e-5, "eV/K") * temperature))),
-              e_zero_(Units::get(4.0e5, "V/cm")), electron_a_(Units::get(7.03e5, "/cm")),
-              electron_b_(Units::get(1.231e6, "V/cm")), hole_a_low_(Units::get(1.582e6, "/cm")),
-              hole_a_high_(Units::get(6.71e5, "/cm")), hole_b_low_(Units::get(2.036e6, "V/cm")),
-              hole_b_high_(Units::get(1.693e6, "V/cm")) {}
+              gamma_(std::tanh(0.063 * units::eV / (2. * 8.6173333e-5 * units::eV_per_K * 300.)) /
+                     std::tanh(0.063 * units::eV / (2. * 8.6173333e-5 * units::eV_per_K * temperature))),
+              e_zero_(4.0e5 * units::V_per_cm), electron_a_(7.03e5 * units::per_cm), electron_b_(1.231e6 * units::V_per_cm),
+              hole_a_low_(1.582e6 * units::per_cm), hole_a_high_(6.71e5 * units::per_cm),
+              hole_b_low_(2.036e6 * units::V_per_cm), hole_b_high_(1.693e6 * units::V_per_cm) {}
 
     private:
         double gain_factor(const CarrierType& type, double efield_mag) const override {
             if(type == CarrierType::ELECTRON) {
-                return gamma_ * electron_a_ * std::exp(-(gamma_ * electron_b_ / efield_mag));
+                return gamma_ * electron_a_ * fast_math::exp(-(gamma_ * electron_b_ / efield_mag));
             } else {
                 auto a = (std::abs(efield_mag) > e_zero_ ? hole_a_high_ : hole_a_low_);
                 auto b = (std::abs(efield_mag) > e_zero_ ? hole_b_high_ : hole_b_low_);
-                return gamma_ * a * std::exp(-(gamma_ * b / efield_mag));
+                return gamma_ * a * fast_math::exp(-(gamma_ * b / efield_mag));
             }
         };
 
@@ -189,15 +195,15 @@ namespace allpix {
     public:
         VanOverstraetenDeManOptimized(double temperature, double threshold)
             : ImpactIonizationModel(threshold), VanOverstraetenDeMan(temperature, threshold) {
-            gamma_ = std::tanh(Units::get(0.0758, "eV") / (2. * Units::get(8.6173333e-5, "eV/K") * 300.)) /
-                     std::tanh(Units::get(0.0758, "eV") / (2. * Units::get(8.6173333e-5, "eV/K") * temperature));
-            electron_a_ = Units::get(1.149e6, "/cm");
-            electron_b_ = Units::get(1.325e6, "V/cm");
-            hole_a_low_ = Units::get(2.519e6, "/cm");
-            hole_b_low_ = Units::get(2.428e6, "V/cm");
+            gamma_ = std::tanh(0.0758 * units::eV / (2. * 8.6173333e-5 * units::eV_per_K * 300.)) /
+                     std::tanh(0.0758 * units::eV / (2. * 8.6173333e-5 * units::eV_per_K * temperature));
+            electron_a_ = 1.149e6 * units::per_cm;
+            electron_b_ = 1.325e6 * units::V_per_cm;
+            hole_a_low_ = 2.519e6 * units::per_cm;
+            hole_b_low_ = 2.428e6 * units::V_per_cm;
             // The publication uses the same parameters for low and high electric field regions:
-            hole_a_high_ = Units::get(2.519e6, "/cm");
-            hole_b_high_ = Units::get(2.428e6, "V/cm");
+            hole_a_high_ = 2.519e6 * units::per_cm;
+            hole_b_high_ = 2.428e6 * units::V_per_cm;
         };
     };
 
@@ -211,17 +217,18 @@ namespace allpix {
     class OkutoCrowell : virtual public ImpactIonizationModel {
     public:
         OkutoCrowell(double temperature, double threshold)
-            : ImpactIonizationModel(threshold), electron_ac_(Units::get(0.426, "/V") * (1. + 3.05e-4 * (temperature - 300))),
-              electron_bd_(Units::get(4.81e5, "V/cm") * (1. + 6.86e-4 * (temperature - 300))),
-              hole_ac_(Units::get(0.243, "/V") * (1. + 5.35e-4 * (temperature - 300))),
-              hole_bd_(Units::get(6.53e5, "V/cm") * (1. + 5.67e-4 * (temperature - 300))) {}
+            : ImpactIonizationModel(threshold), electron_ac_(0.426 * units::per_V * (1. + 3.05e-4 * (temperature - 300))),
+              electron_bd_(4.81e5 * units::V_per_cm * (1. + 6.86e-4 * (temperature - 300))),
+              hole_ac_(0.243 * units::per_V * (1. + 5.35e-4 * (temperature - 300))),
+              hole_bd_(6.53e5 * units::V_per_cm * (1. + 5.67e-4 * (temperature - 300))) {}
 
     private:
         double gain_factor(const CarrierType& type, double efield_mag) const override {
             if(type == CarrierType::ELECTRON) {
-                return electron_ac_ * efield_mag * std::exp(-1 * electron_bd_ * electron_bd_ / efield_mag / efield_mag);
+                return electron_ac_ * efield_mag *
+                       fast_math::exp(-1 * electron_bd_ * electron_bd_ / efield_mag / efield_mag);
             } else {
-                return hole_ac_ * efield_mag * std::exp(-1 * hole_bd_ * hole_bd_ / efield_mag / efield_mag);
+                return hole_ac_ * efield_mag * fast_math::exp(-1 * hole_bd_ * hole_bd_ / efield_mag / efield_mag);
             }
         };
 
@@ -244,10 +251,10 @@ namespace allpix {
     public:
         OkutoCrowellOptimized(double temperature, double threshold)
             : ImpactIonizationModel(threshold), OkutoCrowell(temperature, threshold) {
-            electron_ac_ = Units::get(0.289, "/V") * (1. + 9.03e-4 * (temperature - 300));
-            electron_bd_ = Units::get(4.01e5, "V/cm") * (1. + 1.11e-3 * (temperature - 300));
-            hole_ac_ = Units::get(0.202, "/V") * (1. - 2.20e-3 * (temperature - 300));
-            hole_bd_ = Units::get(6.40e5, "V/cm") * (1. + 8.25e-4 * (temperature - 300));
+            electron_ac_ = 0.289 * units::per_V * (1. + 9.03e-4 * (temperature - 300));
+            electron_bd_ = 4.01e5 * units::V_per_cm * (1. + 1.11e-3 * (temperature - 300));
+            hole_ac_ = 0.202 * units::per_V * (1. - 2.20e-3 * (temperature - 300));
+            hole_bd_ = 6.40e5 * units::V_per_cm * (1. + 8.25e-4 * (temperature - 300));
         };
     };
 
@@ -261,24 +268,24 @@ namespace allpix {
     public:
         Bologna(double temperature, double threshold)
             : ImpactIonizationModel(threshold),
-              electron_a_(Units::get(4.3383, "V") + Units::get(-2.42e-12, "V") * std::pow(temperature, 4.1233)),
-              electron_b_(Units::get(0.235, "V")),
-              electron_c_(Units::get(1.6831e4, "V/cm") + Units::get(4.3796, "V/cm") * temperature +
-                          Units::get(0.13005, "V/cm") * std::pow(temperature, 2)),
-              electron_d_(Units::get(1.2337e6, "V/cm") + Units::get(1.2039e3, "V/cm") * temperature +
-                          Units::get(0.56703, "V/cm") * std::pow(temperature, 2)),
-              hole_a_(Units::get(2.376, "V") + Units::get(1.033e-2, "V") * temperature),
-              hole_b_(Units::get(0.17714, "V") * std::exp(Units::get(-2.178e-3, "/K") * temperature)),
-              hole_c_(Units::get(9.47e-3, "V/cm") * std::pow(temperature, 2.4924)),
-              hole_d_(Units::get(1.4043e6, "V/cm") + Units::get(2.9744e3, "V/cm") * temperature +
-                      Units::get(1.4829, "V/cm") * std::pow(temperature, 2)) {}
+              electron_a_(4.3383 * units::V - 2.42e-12 * units::V * std::pow(temperature, 4.1233)),
+              electron_b_(0.235 * units::V),
+              electron_c_(1.6831e4 * units::V_per_cm + 4.3796 * units::V_per_cm * temperature +
+                          0.13005 * units::V_per_cm * std::pow(temperature, 2)),
+              electron_d_(1.2337e6 * units::V_per_cm + 1.2039e3 * units::V_per_cm * temperature +
+                          0.56703 * units::V_per_cm * std::pow(temperature, 2)),
+              hole_a_(2.376 * units::V + 1.033e-2 * units::V * temperature),
+              hole_b_(0.17714 * units::V * std::exp(-2.178e-3 * units::per_K * temperature)),
+              hole_c_(9.47e-3 * units::V_per_cm * std::pow(temperature, 2.4924)),
+              hole_d_(1.4043e6 * units::V_per_cm + 2.9744e3 * units::V_per_cm * temperature +
+                      1.4829 * units::V_per_cm * std::pow(temperature, 2)) {}
 
     private:
         double gain_factor(const CarrierType& type, double efield_mag) const override {
             if(type == CarrierType::ELECTRON) {
-                return efield_mag / (electron_a_ + electron_b_ * std::exp(electron_d_ / (efield_mag + electron_c_)));
+                return efield_mag / (electron_a_ + electron_b_ * fast_math::exp(electron_d_ / (efield_mag + electron_c_)));
             } else {
-                return efield_mag / (hole_a_ + hole_b_ * std::exp(hole_d_ / (efield_mag + hole_c_)));
+                return efield_mag / (hole_a_ + hole_b_ * fast_math::exp(hole_d_ / (efield_mag + hole_c_)));
             }
         };
 
@@ -299,21 +306,21 @@ namespace allpix {
     class CustomGain : public ImpactIonizationModel {
     public:
         CustomGain(const Configuration& config, double threshold) : ImpactIonizationModel(threshold) {
-            electron_gain_ = configure_gain(config, CarrierType::ELECTRON);
-            hole_gain_ = configure_gain(config, CarrierType::HOLE);
+            electron_gain_ = std::make_unique<CompiledFormula>(configure_gain(config, CarrierType::ELECTRON));
+            hole_gain_ = std::make_unique<CompiledFormula>(configure_gain(config, CarrierType::HOLE));
         };
 
         double gain_factor(const CarrierType& type, double efield_mag) const override {
             if(type == CarrierType::ELECTRON) {
-                return electron_gain_->Eval(efield_mag);
+                return (*electron_gain_)(efield_mag);
             } else {
-                return hole_gain_->Eval(efield_mag);
+                return (*hole_gain_)(efield_mag);
             }
         };
 
     private:
-        std::unique_ptr<TFormula> electron_gain_;
-        std::unique_ptr<TFormula> hole_gain_;
+        std::unique_ptr<CompiledFormula> electron_gain_;
+        std::unique_ptr<CompiledFormula> hole_gain_;
 
         std::unique_ptr<TFormula> configure_gain(const Configuration& config, const CarrierType type) {
             std::string name = (type == CarrierType::ELECTRON ? "electrons" : "holes");
@@ -344,6 +351,42 @@ namespace allpix {
         };
     };
 
+    /**
+     * @ingroup Models
+     * @brief Tabulated impact ionization model
+     *
+     * The gain factor of the model is tabulated in the electric field magnitude from the threshold field of the model to the
+     * maximum tabulated field.
+     */
+    template <> class Tabulated<ImpactIonizationModel> : public ImpactIonizationModel {
+    public:
+        /**
+         * @brief Tabulate an impact ionization model
+         * @param model Impact ionization model to be tabulated
+         * @param parameters Ranges and precision of the tables
+         */
+        Tabulated(const ImpactIonizationModel& model, const TabulationParameters& parameters)
+            : ImpactIonizationModel(model.threshold_) {
+            auto tabulate = [&](const CarrierType& type) {
+                return TabulatedFunction([&](double efield_mag) { return model.gain_factor(type, efield_mag); },
+                                         {{std::fabs(threshold_), parameters.getFieldRange()[1]}},
+                                         parameters.getPrecision(),
+                                         TabulationParameters::max_points_1d);
+            };
+            electron_gain_ = tabulate(CarrierType::ELECTRON);
+            hole_gain_ = tabulate(CarrierType::HOLE);
+            parameters.report("impact ionization", electron_gain_, hole_gain_);
+        }
+
+    private:
+        double gain_factor(const CarrierType& type, double efield_mag) const override {
+            return (type == CarrierType::ELECTRON ? electron_gain_ : hole_gain_)(efield_mag);
+        };
+
+        TabulatedFunction electron_gain_;
+        TabulatedFunction hole_gain_;
+    };
+
     /**
      * @brief Wrapper class and factory for impact ionization models.
      *
@@ -392,6 +435,16 @@ namespace allpix {
                     throw InvalidModelError(model);
                 }
                 LOG(INFO) << "Selected impact ionization model \"" << model << "\"";
+
+                // Replace the model by its tabulation if requested
+                if(model != "none" && config.get<bool>("tabulate_multiplication", false)) {
+                    TabulationParameters parameters(config);
+                    if(std::fabs(threshold) >= parameters.getFieldRange()[1]) {
+                        throw InvalidValueError(
+                            config, "tabulation_max_field", "maximum field has to exceed the multiplication threshold");
+                    }
+                    model_ = std::make_unique<Tabulated<ImpactIonizationModel>>(*model_, parameters);
+                }
             } catch(const ModelError& e) {
                 throw InvalidValueError(config, "multiplication_model", e.what());
             }
@@ -405,6 +458,28 @@ namespace allpix {
             return model_->operator()(std::forward<ARGS>(args)...);
         }
 
+        /**
+         * @brief Call a function with the impact ionization model, resolving the type of the model only once
+         * @param function Function called with a reference to the model which can be called as this wrapper
+         * @return Result of the function
+         *
+         * Calls to the model within the function are dispatched statically for all known model types instead of through
+         * the virtual function call operator, see \ref ModelTypes. This allows hoisting the dispatch out of loops over many
+         * evaluations of the model.
+         */
+        template <typename F> decltype(auto) visit(F&& function) const {
+            return ModelTypes<NoImpactIonization,
+                              Massey,
+                              MasseyOptimized,
+                              VanOverstraetenDeMan,
+                              VanOverstraetenDeManOptimized,
+                              OkutoCrowell,
+                              OkutoCrowellOptimized,
+                              Bologna,
+                              CustomGain,
+                              Tabulated<ImpactIonizationModel>>::visit(*model_, std::forward<F>(function));
+        }
+
         /**
          * @brief Helper method to determine if this model is of a given type
          * The template parameter needs to be specified speicifcally, i.e.
@@ -14,13 +14,18 @@
 
 #include <TFormula.h>
 
+#include "ModelDispatch.hpp"
+#include "Tabulated.hpp"
 #include "exceptions.h"
 
 #include "core/config/Configuration.hpp"
 #include "core/geometry/DetectorModel.hpp"
 #include "core/utils/log.h"
 #include "core/utils/unit.h"
+#include "core/utils/unit_constants.h"
 #include "objects/SensorCharge.hpp"
+#include "tools/compiled_formula.h"
+#include "tools/fast_math.h"
 #include "tools/tabulated_pow.h"
 
 namespace allpix {
@@ -61,12 +66,12 @@ namespace allpix {
     class JacoboniCanali : virtual public MobilityModel {
     public:
         explicit JacoboniCanali(SensorMaterial material, double temperature)
-            : electron_Vm_(Units::get(1.53e9 * std::pow(temperature, -0.87), "cm/s")),
+            : electron_Vm_(1.53e9 * std::pow(temperature, -0.87) * units::cm_per_s),
               electron_Beta_(2.57e-2 * std::pow(temperature, 0.66)),
-              hole_Vm_(Units::get(1.62e8 * std::pow(temperature, -0.52), "cm/s")),
+              hole_Vm_(1.62e8 * std::pow(temperature, -0.52) * units::cm_per_s),
               hole_Beta_(0.46 * std::pow(temperature, 0.17)),
-              electron_Ec_(Units::get(1.01 * std::pow(temperature, 1.55), "V/cm")),
-              hole_Ec_(Units::get(1.24 * std::pow(temperature, 1.68), "V/cm")) {
+              electron_Ec_(1.01 * std::pow(temperature, 1.55) * units::V_per_cm),
+              hole_Ec_(1.24 * std::pow(temperature, 1.68) * units::V_per_cm) {
             if(material != SensorMaterial::SILICON) {
                 LOG(WARNING) << "Sensor material " << allpix::to_string(material) << " not valid for this model.";
             }
@@ -76,9 +81,11 @@ namespace allpix {
             // Compute carrier mobility from constants and electric field magnitude
             if(type == CarrierType::ELECTRON) {
                 return electron_Vm_ / electron_Ec_ /
-                       std::pow(1. + std::pow(efield_mag / electron_Ec_, electron_Beta_), 1.0 / electron_Beta_);
+                       fast_math::pow(1. + fast_math::pow(efield_mag / electron_Ec_, electron_Beta_),
+                                      1.0 / electron_Beta_);
             } else {
-                return hole_Vm_ / hole_Ec_ / std::pow(1. + std::pow(efield_mag / hole_Ec_, hole_Beta_), 1.0 / hole_Beta_);
+                return hole_Vm_ / hole_Ec_ /
+                       fast_math::pow(1. + fast_math::pow(efield_mag / hole_Ec_, hole_Beta_), 1.0 / hole_Beta_);
             }
         };
 
@@ -102,7 +109,7 @@ namespace allpix {
     class Canali : virtual public JacoboniCanali {
     public:
         explicit Canali(SensorMaterial material, double temperature) : JacoboniCanali(material, temperature) {
-            electron_Vm_ = Units::get(1.43e9 * std::pow(temperature, -0.87), "cm/s");
+            electron_Vm_ = 1.43e9 * std::pow(temperature, -0.87) * units::cm_per_s;
         }
     };
 
@@ -117,11 +124,11 @@ namespace allpix {
     public:
         explicit CanaliFast(SensorMaterial material, double temperature)
             : JacoboniCanali(material, temperature), Canali(material, temperature),
-              pow_e_beta(0., Units::get(1000., "kV/cm") / electron_Ec_, electron_Beta_),
+              pow_e_beta(0., 1000. * units::kV_per_cm / electron_Ec_, electron_Beta_),
               pow_e_inv_beta(
-                  1., 1. + std::pow(Units::get(1000., "kV/cm") / electron_Ec_, electron_Beta_), 1.0 / electron_Beta_),
-              pow_h_beta(0., Units::get(1000., "kV/cm") / hole_Ec_, hole_Beta_),
-              pow_h_inv_beta(1., 1 + std::pow(Units::get(1000., "kV/cm") / hole_Ec_, hole_Beta_), 1.0 / hole_Beta_) {
+                  1., 1. + std::pow(1000. * units::kV_per_cm / electron_Ec_, electron_Beta_), 1.0 / electron_Beta_),
+              pow_h_beta(0., 1000. * units::kV_per_cm / hole_Ec_, hole_Beta_),
+              pow_h_inv_beta(1., 1 + std::pow(1000. * units::kV_per_cm / hole_Ec_, hole_Beta_), 1.0 / hole_Beta_) {
 
             LOG(INFO) << "This mobility model uses a tabulated pow implementation and might be less accurate";
 
@@ -163,12 +170,12 @@ namespace allpix {
     class Hamburg : public MobilityModel {
     public:
         explicit Hamburg(SensorMaterial material, double temperature)
-            : electron_mu0_(Units::get(1530 * std::pow(temperature / 300, -2.42), "cm*cm/V/s")),
-              electron_vsat_(Units::get(1.03e7 * std::pow(temperature / 300, -0.226), "cm/s")),
-              hole_mu0_(Units::get(464 * std::pow(temperature / 300, -2.20), "cm*cm/V/s")),
-              hole_param_b_(Units::get(9.57e-8 * std::pow(temperature / 300, -0.101), "s/cm")),
-              hole_param_c_(Units::get(-3.31e-13, "s/V")),
-              hole_E0_(Units::get(2640 * std::pow(temperature / 300, 0.526), "V/cm")) {
+            : electron_mu0_(1530 * std::pow(temperature / 300, -2.42) * units::cm2_per_V_s),
+              electron_vsat_(1.03e7 * std::pow(temperature / 300, -0.226) * units::cm_per_s),
+              hole_mu0_(464 * std::pow(temperature / 300, -2.20) * units::cm2_per_V_s),
+              hole_param_b_(9.57e-8 * std::pow(temperature / 300, -0.101) * units::s_per_cm),
+              hole_param_c_(-3.31e-13 * units::s_per_V),
+              hole_E0_(2640 * std::pow(temperature / 300, 0.526) * units::V_per_cm) {
             if(material != SensorMaterial::SILICON) {
                 LOG(WARNING) << "Sensor material " << allpix::to_string(material) << " not valid for this model.";
             }
@@ -210,12 +217,12 @@ namespace allpix {
     class HamburgHighField : public Hamburg {
     public:
         explicit HamburgHighField(SensorMaterial material, double temperature) : Hamburg(material, temperature) {
-            electron_mu0_ = Units::get(1430 * std::pow(temperature / 300, -1.99), "cm*cm/V/s");
-            electron_vsat_ = Units::get(1.05e7 * std::pow(temperature / 300, -0.302), "cm/s");
-            hole_mu0_ = Units::get(457 * std::pow(temperature / 300, -2.80), "cm*cm/V/s");
-            hole_param_b_ = Units::get(9.57e-8 * std::pow(temperature / 300, -0.155), "s/cm"),
-            hole_param_c_ = Units::get(-3.24e-13, "s/V");
-            hole_E0_ = Units::get(2970 * std::pow(temperature / 300, 0.563), "V/cm");
+            electron_mu0_ = 1430 * std::pow(temperature / 300, -1.99) * units::cm2_per_V_s;
+            electron_vsat_ = 1.05e7 * std::pow(temperature / 300, -0.302) * units::cm_per_s;
+            hole_mu0_ = 457 * std::pow(temperature / 300, -2.80) * units::cm2_per_V_s;
+            hole_param_b_ = 9.57e-8 * std::pow(temperature / 300, -0.155) * units::s_per_cm,
+            hole_param_c_ = -3.24e-13 * units::s_per_V;
+            hole_E0_ = 2970 * std::pow(temperature / 300, 0.563) * units::V_per_cm;
         }
     };
 
@@ -229,25 +236,24 @@ namespace allpix {
     class Masetti : virtual public MobilityModel {
     public:
         Masetti(SensorMaterial material, double temperature, bool doping, Dopant dopant_n)
-            : electron_mu0_(Units::get(68.5, "cm*cm/V/s")),
-              electron_mumax_(Units::get(1414, "cm*cm/V/s") * std::pow(temperature / 300, -2.5)),
-              electron_cr_(Units::get(9.20e16, "/cm/cm/cm")), electron_mu1_(Units::get(56.1, "cm*cm/V/s")),
-              electron_cs_(Units::get(3.41e20, "/cm/cm/cm")), hole_mu0_(Units::get(44.9, "cm*cm/V/s")),
-              hole_pc_(Units::get(9.23e16, "/cm/cm/cm")),
-              hole_mumax_(Units::get(470.5, "cm*cm/V/s") * std::pow(temperature / 300, -2.2)),
-              hole_cr_(Units::get(2.23e17, "/cm/cm/cm")), hole_mu1_(Units::get(29.0, "cm*cm/V/s")),
-              hole_cs_(Units::get(6.1e20, "/cm/cm/cm")) {
+            : electron_mu0_(68.5 * units::cm2_per_V_s),
+              electron_mumax_(1414 * units::cm2_per_V_s * std::pow(temperature / 300, -2.5)),
+              electron_cr_(9.20e16 * units::per_cm3), electron_mu1_(56.1 * units::cm2_per_V_s),
+              electron_cs_(3.41e20 * units::per_cm3), hole_mu0_(44.9 * units::cm2_per_V_s),
+              hole_pc_(9.23e16 * units::per_cm3),
+              hole_mumax_(470.5 * units::cm2_per_V_s * std::pow(temperature / 300, -2.2)),
+              hole_cr_(2.23e17 * units::per_cm3), hole_mu1_(29.0 * units::cm2_per_V_s), hole_cs_(6.1e20 * units::per_cm3) {
             if(!doping) {
                 throw ModelUnsuitable("No doping profile available");
             }
             if(dopant_n == Dopant::ARSENIC) {
                 LOG(INFO) << "Selected arsenic as n-dopant.";
-                electron_mu0_ = Units::get(52.2, "cm*cm/V/s");
-                electron_mumax_ = Units::get(1417, "cm*cm/V/s") * std::pow(temperature / 300, -2.5);
-                electron_cr_ = Units::get(9.68e16, "/cm/cm/cm");
+                electron_mu0_ = 52.2 * units::cm2_per_V_s;
+                electron_mumax_ = 1417 * units::cm2_per_V_s * std::pow(temperature / 300, -2.5);
+                electron_cr_ = 9.68e16 * units::per_cm3;
                 electron_alpha_ = 0.68;
-                electron_mu1_ = Units::get(43.4, "cm*cm/V/s");
-                electron_cs_ = Units::get(3.43e20, "/cm/cm/cm");
+                electron_mu1_ = 43.4 * units::cm2_per_V_s;
+                electron_cs_ = 3.43e20 * units::per_cm3;
                 electron_beta_ = 2.0;
             }
             if(material != SensorMaterial::SILICON) {
@@ -259,12 +265,12 @@ namespace allpix {
             if(type == CarrierType::ELECTRON) {
                 return electron_mu0_ +
                        (electron_mumax_ - electron_mu0_) /
-                           (1. + std::pow(std::fabs(doping) / electron_cr_, electron_alpha_)) -
-                       electron_mu1_ / (1. + std::pow(electron_cs_ / std::fabs(doping), electron_beta_));
+                           (1. + fast_math::pow(std::fabs(doping) / electron_cr_, electron_alpha_)) -
+                       electron_mu1_ / (1. + fast_math::pow(electron_cs_ / std::fabs(doping), electron_beta_));
             } else {
-                return hole_mu0_ * std::exp(-hole_pc_ / std::fabs(doping)) +
-                       hole_mumax_ / (1. + std::pow(std::fabs(doping) / hole_cr_, hole_alpha_)) -
-                       hole_mu1_ / (1. + std::pow(hole_cs_ / std::fabs(doping), hole_beta_));
+                return hole_mu0_ * fast_math::exp(-hole_pc_ / std::fabs(doping)) +
+                       hole_mumax_ / (1. + fast_math::pow(std::fabs(doping) / hole_cr_, hole_alpha_)) -
+                       hole_mu1_ / (1. + fast_math::pow(hole_cs_ / std::fabs(doping), hole_beta_));
             }
         };
 
@@ -302,10 +308,11 @@ namespace allpix {
             double masetti = Masetti::operator()(type, efield_mag, doping);
 
             if(type == CarrierType::ELECTRON) {
-                return masetti /
-                       std::pow(1. + std::pow(masetti * efield_mag / electron_Vm_, electron_Beta_), 1. / electron_Beta_);
+                return masetti / fast_math::pow(1. + fast_math::pow(masetti * efield_mag / electron_Vm_, electron_Beta_),
+                                                1. / electron_Beta_);
             } else {
-                return masetti / std::pow(1. + std::pow(masetti * efield_mag / hole_Vm_, hole_Beta_), 1. / hole_Beta_);
+                return masetti /
+                       fast_math::pow(1. + fast_math::pow(masetti * efield_mag / hole_Vm_, hole_Beta_), 1. / hole_Beta_);
             }
         };
     };
@@ -320,12 +327,12 @@ namespace allpix {
     class Arora : public MobilityModel {
     public:
         Arora(SensorMaterial material, double temperature, bool doping)
-            : electron_mumin_(Units::get(88 * std::pow(temperature / 300, -0.57), "cm*cm/V/s")),
-              electron_mu0_(Units::get(7.4e8 * std::pow(temperature, -2.33), "cm*cm/V/s")),
-              electron_nref_(Units::get(1.26e17 * std::pow(temperature / 300, 2.4), "/cm/cm/cm")),
-              hole_mumin_(Units::get(54.3 * std::pow(temperature / 300, -0.57), "cm*cm/V/s")),
-              hole_mu0_(Units::get(1.36e8 * std::pow(temperature, -2.23), "cm*cm/V/s")),
-              hole_nref_(Units::get(2.35e17 * std::pow(temperature / 300, 2.4), "/cm/cm/cm")),
+            : electron_mumin_(88 * std::pow(temperature / 300, -0.57) * units::cm2_per_V_s),
+              electron_mu0_(7.4e8 * std::pow(temperature, -2.33) * units::cm2_per_V_s),
+              electron_nref_(1.26e17 * std::pow(temperature / 300, 2.4) * units::per_cm3),
+              hole_mumin_(54.3 * std::pow(temperature / 300, -0.57) * units::cm2_per_V_s),
+              hole_mu0_(1.36e8 * std::pow(temperature, -2.23) * units::cm2_per_V_s),
+              hole_nref_(2.35e17 * std::pow(temperature / 300, 2.4) * units::per_cm3),
               alpha_(0.88 * std::pow(temperature / 300, -0.146)) {
             if(!doping) {
                 throw ModelUnsuitable("No doping profile available");
@@ -337,9 +344,9 @@ namespace allpix {
 
         double operator()(const CarrierType& type, double, double doping) const override {
             if(type == CarrierType::ELECTRON) {
-                return electron_mumin_ + electron_mu0_ / (1 + std::pow(std::fabs(doping) / electron_nref_, alpha_));
+                return electron_mumin_ + electron_mu0_ / (1 + fast_math::pow(std::fabs(doping) / electron_nref_, alpha_));
             } else {
-                return hole_mumin_ + hole_mu0_ / (1 + std::pow(std::fabs(doping) / hole_nref_, alpha_));
+                return hole_mumin_ + hole_mu0_ / (1 + fast_math::pow(std::fabs(doping) / hole_nref_, alpha_));
             }
         };
 
@@ -363,8 +370,8 @@ namespace allpix {
     class RuchKino : virtual public MobilityModel {
     public:
         explicit RuchKino(SensorMaterial material)
-            : E0_gaas_(Units::get(3100.0, "V/cm")), mu_e_gaas_(Units::get(7600.0, "cm*cm/V/s")),
-              Ec_gaas_(Units::get(1360.0, "V/cm")), mu_h_gaas_(Units::get(320.0, "cm*cm/V/s")) {
+            : E0_gaas_(3100.0 * units::V_per_cm), mu_e_gaas_(7600.0 * units::cm2_per_V_s),
+              Ec_gaas_(1360.0 * units::V_per_cm), mu_h_gaas_(320.0 * units::cm2_per_V_s) {
             if(material != SensorMaterial::GALLIUM_ARSENIDE) {
                 LOG(WARNING) << "Sensor material " << allpix::to_string(material) << " not valid for this model.";
             }
@@ -416,29 +423,29 @@ namespace allpix {
     public:
         Quay(SensorMaterial material, double temperature) {
             if(material == SensorMaterial::SILICON) {
-                electron_Vsat_ = vsat(Units::get(1.02e7, "cm/s"), 0.74, temperature);
-                hole_Vsat_ = vsat(Units::get(0.72e7, "cm/s"), 0.37, temperature);
+                electron_Vsat_ = vsat(1.02e7 * units::cm_per_s, 0.74, temperature);
+                hole_Vsat_ = vsat(0.72e7 * units::cm_per_s, 0.37, temperature);
 
                 // parameters for mobility at zero field defined in Jacoboni et al
                 // https://doi.org/10.1016/0038-1101(77)90054-5
-                electron_Ec_ = electron_Vsat_ / (Units::get(1.43e9, "cm*cm*K/V/s") / std::pow(temperature, 2.42));
-                hole_Ec_ = hole_Vsat_ / (Units::get(1.35e8, "cm*cm*K/V/s") / std::pow(temperature, 2.20));
+                electron_Ec_ = electron_Vsat_ / (1.43e9 * units::cm2_K_per_V_s / std::pow(temperature, 2.42));
+                hole_Ec_ = hole_Vsat_ / (1.35e8 * units::cm2_K_per_V_s / std::pow(temperature, 2.20));
             } else if(material == SensorMaterial::GERMANIUM) {
-                electron_Vsat_ = vsat(Units::get(0.7e7, "cm/s"), 0.45, temperature);
-                hole_Vsat_ = vsat(Units::get(0.63e7, "cm/s"), 0.39, temperature);
+                electron_Vsat_ = vsat(0.7e7 * units::cm_per_s, 0.45, temperature);
+                hole_Vsat_ = vsat(0.63e7 * units::cm_per_s, 0.39, temperature);
 
                 // Parameters for mobility at zero field defined in Omar et al for electrons
                 // https://doi.org/10.1016/0038-1101(87)90063-3 and in Landolt-Bornstein - Group III Condensed Matter
                 // https://doi.org/10.1007/b80447 for holes
-                electron_Ec_ = electron_Vsat_ / (Units::get(5.66e7, "cm*cm*K/V/s") / std::pow(temperature, 1.68));
-                hole_Ec_ = hole_Vsat_ / (Units::get(1.05e9, "cm*cm*K/V/s") / std::pow(temperature, 2.33));
+                electron_Ec_ = electron_Vsat_ / (5.66e7 * units::cm2_K_per_V_s / std::pow(temperature, 1.68));
+                hole_Ec_ = hole_Vsat_ / (1.05e9 * units::cm2_K_per_V_s / std::pow(temperature, 2.33));
 
             } else if(material == SensorMaterial::GALLIUM_ARSENIDE) {
-                electron_Vsat_ = vsat(Units::get(0.72e7, "cm/s"), 0.44, temperature);
-                hole_Vsat_ = vsat(Units::get(0.9e7, "cm/s"), 0.59, temperature);
+                electron_Vsat_ = vsat(0.72e7 * units::cm_per_s, 0.44, temperature);
+                hole_Vsat_ = vsat(0.9e7 * units::cm_per_s, 0.59, temperature);
 
-                electron_Ec_ = electron_Vsat_ / (Units::get(2.5e6, "cm*cm*K/V/s") / std::pow(temperature, 1.));
-                hole_Ec_ = hole_Vsat_ / (Units::get(6.3e7, "cm*cm*K/V/s") / std::pow(temperature, 2.1));
+                electron_Ec_ = electron_Vsat_ / (2.5e6 * units::cm2_K_per_V_s / std::pow(temperature, 1.));
+                hole_Ec_ = hole_Vsat_ / (6.3e7 * units::cm2_K_per_V_s / std::pow(temperature, 2.1));
             } else {
                 throw ModelUnsuitable("Sensor material " + allpix::to_string(material) + " not valid for this model.");
             }
@@ -472,10 +479,10 @@ namespace allpix {
     class Levinshtein : public MobilityModel {
     public:
         Levinshtein(SensorMaterial material, double temperature, bool doping)
-            : electron_mumin_(Units::get(55, "cm*cm/V/s")), electron_mumax_(Units::get(1000, "cm*cm/V/s")),
-              electron_nref_(Units::get(2e17, "/cm/cm/cm")), electron_t_alpha_(std::pow(temperature / 300, 2.)),
-              electron_t_beta_(std::pow(temperature / 300, 0.7)), hole_mumin_(Units::get(3, "cm*cm/V/s")),
-              hole_mumax_(Units::get(170, "cm*cm/V/s")), hole_nref_(Units::get(3e17, "/cm/cm/cm")),
+            : electron_mumin_(55 * units::cm2_per_V_s), electron_mumax_(1000 * units::cm2_per_V_s),
+              electron_nref_(2e17 * units::per_cm3), electron_t_alpha_(std::pow(temperature / 300, 2.)),
+              electron_t_beta_(std::pow(temperature / 300, 0.7)), hole_mumin_(3 * units::cm2_per_V_s),
+              hole_mumax_(170 * units::cm2_per_V_s), hole_nref_(3e17 * units::per_cm3),
               hole_t_alpha_(std::pow(temperature / 300, 5.)) {
             if(!doping) {
                 throw ModelUnsuitable("No doping profile available");
@@ -487,14 +494,14 @@ namespace allpix {
 
         double operator()(const CarrierType& type, double temperature, double doping) const override {
             if(type == CarrierType::ELECTRON) {
-                double B =
-                    (electron_mumin_ + electron_mumax_ * std::pow(electron_nref_ / std::fabs(doping), electron_gamma_)) /
-                    (electron_mumax_ - electron_mumin_);
+                double B = (electron_mumin_ +
+                            electron_mumax_ * fast_math::pow(electron_nref_ / std::fabs(doping), electron_gamma_)) /
+                           (electron_mumax_ - electron_mumin_);
                 return electron_mumax_ / (1 / (B * electron_t_beta_) + electron_t_alpha_);
             } else {
-                double B = (hole_mumin_ + hole_mumax_ * std::pow(hole_nref_ / std::fabs(doping), hole_gamma_)) /
+                double B = (hole_mumin_ + hole_mumax_ * fast_math::pow(hole_nref_ / std::fabs(doping), hole_gamma_)) /
                            (hole_mumax_ - hole_mumin_);
-                return hole_mumax_ / (1 / B + std::pow(temperature / 300, hole_t_alpha_));
+                return hole_mumax_ / (1 / B + fast_math::pow(temperature / 300, hole_t_alpha_));
             }
         };
 
@@ -537,21 +544,22 @@ namespace allpix {
     class Custom : public MobilityModel {
     public:
         Custom(const Configuration& config, bool doping) {
-            electron_mobility_ = configure_mobility(config, CarrierType::ELECTRON, doping);
-            hole_mobility_ = configure_mobility(config, CarrierType::HOLE, doping);
+            electron_mobility_ =
+                std::make_unique<CompiledFormula>(configure_mobility(config, CarrierType::ELECTRON, doping));
+            hole_mobility_ = std::make_unique<CompiledFormula>(configure_mobility(config, CarrierType::HOLE, doping));
         };
 
         double operator()(const CarrierType& type, double efield_mag, double doping) const override {
             if(type == CarrierType::ELECTRON) {
-                return electron_mobility_->Eval(efield_mag, doping);
+                return (*electron_mobility_)(efield_mag, doping);
             } else {
-                return hole_mobility_->Eval(efield_mag, doping);
+                return (*hole_mobility_)(efield_mag, doping);
             }
         };
 
     private:
-        std::unique_ptr<TFormula> electron_mobility_;
-        std::unique_ptr<TFormula> hole_mobility_;
+        std::unique_ptr<CompiledFormula> electron_mobility_;
+        std::unique_ptr<CompiledFormula> hole_mobility_;
 
         std::unique_ptr<TFormula> configure_mobility(const Configuration& config, const CarrierType type, bool doping) {
             std::string name = (type == CarrierType::ELECTRON ? "electrons" : "holes");
@@ -586,6 +594,57 @@ namespace allpix {
         };
     };
 
+    /**
+     * @ingroup Models
+     * @brief Tabulated mobility model
+     *
+     * The mobility of the model is tabulated in the electric field magnitude and, if a doping profile is available, in the
+     * doping concentration.
+     */
+    template <> class Tabulated<MobilityModel> : public MobilityModel {
+    public:
+        /**
+         * @brief Tabulate a mobility model
+         * @param model Mobility model to be tabulated
+         * @param parameters Ranges and precision of the tables
+         * @param doping Boolean to indicate presence of doping profile information
+         */
+        Tabulated(const MobilityModel& model, const TabulationParameters& parameters, bool doping)
+            : parameters_(parameters), doping_(doping) {
+            auto tabulate = [&](const CarrierType& type) {
+                if(!doping_) {
+                    return TabulatedFunction([&](double efield_mag) { return model(type, efield_mag, 0.); },
+                                             parameters_.getFieldRange(),
+                                             parameters_.getPrecision(),
+                                             TabulationParameters::max_points_1d);
+                }
+                return TabulatedFunction(
+                    [&](double efield_mag, double coordinate) {
+                        return model(type, efield_mag, parameters_.getDoping(coordinate));
+                    },
+                    parameters_.getFieldRange(),
+                    parameters_.getDopingRange(),
+                    parameters_.getPrecision(),
+                    TabulationParameters::max_points_2d);
+            };
+            electron_mobility_ = tabulate(CarrierType::ELECTRON);
+            hole_mobility_ = tabulate(CarrierType::HOLE);
+            parameters_.report("mobility", electron_mobility_, hole_mobility_);
+        }
+
+        double operator()(const CarrierType& type, double efield_mag, double doping) const override {
+            const auto& table = (type == CarrierType::ELECTRON ? electron_mobility_ : hole_mobility_);
+            return (doping_ ? table(efield_mag, parameters_.getDopingCoordinate(doping)) : table(efield_mag));
+        };
+
+    private:
+        TabulationParameters parameters_;
+        bool doping_;
+
+        TabulatedFunction electron_mobility_;
+        TabulatedFunction hole_mobility_;
+    };
+
     /**
      * @brief Wrapper class and factory for mobility models.
      *
@@ -643,6 +702,11 @@ namespace allpix {
                     throw InvalidModelError(model);
                 }
                 LOG(INFO) << "Selected mobility model \"" << model << "\"";
+
+                // Replace the model by its tabulation if requested
+                if(config.get<bool>("tabulate_mobility", false)) {
+                    model_ = std::make_unique<Tabulated<MobilityModel>>(*model_, TabulationParameters(config), doping);
+                }
             } catch(const ModelError& e) {
                 throw InvalidValueError(config, "mobility_model", e.what());
             }
@@ -656,6 +720,32 @@ namespace allpix {
             return model_->operator()(std::forward<ARGS>(args)...);
         }
 
+        /**
+         * @brief Call a function with the mobility model, resolving the type of the model only once
+         * @param function Function called with a reference to the model which can be called as this wrapper
+         * @return Result of the function
+         *
+         * Calls to the model within the function are dispatched statically for all known model types instead of through
+         * the virtual function call operator, see \ref ModelTypes. This allows hoisting the dispatch out of loops over many
+         * evaluations of the model.
+         */
+        template <typename F> decltype(auto) visit(F&& function) const {
+            return ModelTypes<JacoboniCanali,
+                              Canali,
+                              CanaliFast,
+                              Hamburg,
+                              HamburgHighField,
+                              Masetti,
+                              MasettiCanali,
+                              Arora,
+                              RuchKino,
+                              Quay,
+                              Levinshtein,
+                              ConstantMobility,
+                              Custom,
+                              Tabulated<MobilityModel>>::visit(*model_, std::forward<F>(function));
+        }
+
     private:
         std::unique_ptr<MobilityModel> model_{};
     };
@@ -0,0 +1,79 @@
+/**
+ * @file
+ * @brief Static dispatch of calls to physics models
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef ALLPIX_MODEL_DISPATCH_H
+#define ALLPIX_MODEL_DISPATCH_H
+
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+
+namespace allpix {
+
+    /**
+     * @ingroup Models
+     * @brief Reference to a physics model of known type, calling its function call operator without virtual dispatch
+     *
+     * The call is qualified with the type of the model, such that the compiler can inline the arithmetic of the model.
+     */
+    template <class Model> class StaticModel {
+    public:
+        /**
+         * @brief Construct a reference to a model
+         * @param model Model of exactly this type
+         */
+        explicit StaticModel(const Model& model) : model_(model) {}
+
+        /**
+         * Function call operator forwarded to the function call operator of the model type
+         * @return Result of the model
+         */
+        template <class... ARGS> decltype(auto) operator()(ARGS&&... args) const {
+            return model_.Model::operator()(std::forward<ARGS>(args)...);
+        }
+
+    private:
+        const Model& model_;
+    };
+
+    /**
+     * @ingroup Models
+     * @brief List of model types known to a model wrapper, resolving the type of a model to call functions statically
+     */
+    template <class... Models> struct ModelTypes {
+        /**
+         * @brief Call a function with the model, resolving its type once for all model evaluations within the function
+         * @param model Model to be resolved
+         * @param function Function to be called with a \ref StaticModel reference if the type of the model is among the
+         *                 known types, or with the model itself otherwise
+         * @return Result of the function
+         */
+        template <class Base, typename F> static decltype(auto) visit(const Base& model, F&& function) {
+            return visit_type<Base, F, Models...>(model, std::forward<F>(function));
+        }
+
+    private:
+        template <class Base, typename F> static decltype(auto) visit_type(const Base& model, F&& function) {
+            return std::forward<F>(function)(model);
+        }
+        template <class Base, typename F, class Model, class... Rest>
+        static decltype(auto) visit_type(const Base& model, F&& function) {
+            static_assert(std::is_base_of_v<Base, Model>, "model type has to derive from the model interface");
+            if(typeid(model) == typeid(Model)) {
+                // A cast from a virtual base class requires the dynamic cast
+                return std::forward<F>(function)(StaticModel<Model>(dynamic_cast<const Model&>(model)));
+            }
+            return visit_type<Base, F, Rest...>(model, std::forward<F>(function));
+        }
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_MODEL_DISPATCH_H */
@@ -12,14 +12,21 @@
 #ifndef ALLPIX_RECOMBINATION_MODELS_H
 #define ALLPIX_RECOMBINATION_MODELS_H
 
+#include <limits>
+
 #include <TFormula.h>
 
+#include "ModelDispatch.hpp"
+#include "Tabulated.hpp"
 #include "exceptions.h"
 
 #include "core/config/Configuration.hpp"
 #include "core/utils/log.h"
 #include "core/utils/unit.h"
+#include "core/utils/unit_constants.h"
 #include "objects/SensorCharge.hpp"
+#include "tools/compiled_formula.h"
+#include "tools/fast_math.h"
 
 namespace allpix {
 
@@ -49,6 +56,14 @@ namespace allpix {
          * @return Recombination status, true if charge carrier has recombined, false if it still is alive
          */
         virtual bool operator()(const CarrierType& type, double doping, double survival_prob, double timestep) const = 0;
+
+        /**
+         * Lifetime of the given carrier type at the given doping concentration
+         * @param type Type of charge carrier (electron or hole)
+         * @param doping (Effective) doping concentration
+         * @return Lifetime of the charge carrier, infinite if it does not recombine
+         */
+        virtual double lifetime(const CarrierType& type, double doping) const = 0;
     };
 
     /**
@@ -59,6 +74,8 @@ namespace allpix {
     class None : virtual public RecombinationModel {
     public:
         bool operator()(const CarrierType&, double, double, double) const override { return false; };
+
+        double lifetime(const CarrierType&, double) const override { return std::numeric_limits<double>::infinity(); }
     };
 
     /**
@@ -74,8 +91,8 @@ namespace allpix {
     class ShockleyReadHall : virtual public RecombinationModel {
     public:
         ShockleyReadHall(double temperature, bool doping)
-            : electron_lifetime_reference_(Units::get(1e-5, "s")), electron_doping_reference_(Units::get(1e16, "/cm/cm/cm")),
-              hole_lifetime_reference_(Units::get(4.0e-4, "s")), hole_doping_reference_(Units::get(7.1e15, "/cm/cm/cm")),
+            : electron_lifetime_reference_(1e-5 * units::s), electron_doping_reference_(1e16 * units::per_cm3),
+              hole_lifetime_reference_(4.0e-4 * units::s), hole_doping_reference_(7.1e15 * units::per_cm3),
               temperature_scaling_(std::pow(300 / temperature, 1.5)) {
             if(!doping) {
                 throw ModelUnsuitable("No doping profile available");
@@ -83,11 +100,10 @@ namespace allpix {
         }
 
         bool operator()(const CarrierType& type, double doping, double survival_prob, double timestep) const override {
-            return survival_prob < (1 - std::exp(-1. * timestep / lifetime(type, doping)));
+            return survival_prob < (1 - fast_math::exp(-1. * timestep / ShockleyReadHall::lifetime(type, doping)));
         };
 
-    protected:
-        double lifetime(const CarrierType& type, double doping) const {
+        double lifetime(const CarrierType& type, double doping) const override {
             return (type == CarrierType::ELECTRON ? electron_lifetime_reference_ : hole_lifetime_reference_) /
                    (1 + std::fabs(doping) /
                             (type == CarrierType::ELECTRON ? electron_doping_reference_ : hole_doping_reference_)) *
@@ -111,7 +127,7 @@ namespace allpix {
      */
     class Auger : virtual public RecombinationModel {
     public:
-        explicit Auger(bool doping) : auger_coefficient_(Units::get(3.8e-31, "cm*cm*cm*cm*cm*cm*/s")) {
+        explicit Auger(bool doping) : auger_coefficient_(3.8e-31 * units::cm6_per_s) {
             if(!doping) {
                 throw ModelUnsuitable("No doping profile available");
             }
@@ -121,11 +137,15 @@ namespace allpix {
             // Auger only applies to minority charge carriers, if we have a majority carrier always return false (alive):
             auto minorityType = (doping > 0 ? CarrierType::HOLE : CarrierType::ELECTRON);
             return (minorityType != type ? false
-                                         : (survival_prob < (1 - std::exp(-1. * timestep / lifetime(type, doping)))));
+                                         : (survival_prob <
+                                            (1 - fast_math::exp(-1. * timestep / Auger::lifetime(type, doping)))));
         };
 
-    protected:
-        double lifetime(const CarrierType&, double doping) const { return 1. / (auger_coefficient_ * doping * doping); }
+        double lifetime(const CarrierType& type, double doping) const override {
+            auto minorityType = (doping > 0 ? CarrierType::HOLE : CarrierType::ELECTRON);
+            return (minorityType != type ? std::numeric_limits<double>::infinity()
+                                         : 1. / (auger_coefficient_ * doping * doping));
+        }
 
     private:
         double auger_coefficient_;
@@ -149,9 +169,17 @@ namespace allpix {
                 // If we have a minority charge carrier, combine the lifetimes:
                 auto combined_lifetime =
                     1. / (1. / ShockleyReadHall::lifetime(type, doping) + 1. / Auger::lifetime(type, doping));
-                return survival_prob < (1 - std::exp(-1. * timestep / combined_lifetime));
+                return survival_prob < (1 - fast_math::exp(-1. * timestep / combined_lifetime));
             }
         };
+
+        double lifetime(const CarrierType& type, double doping) const override {
+            auto minorityType = (doping > 0 ? CarrierType::HOLE : CarrierType::ELECTRON);
+            if(minorityType != type) {
+                return ShockleyReadHall::lifetime(type, doping);
+            }
+            return 1. / (1. / ShockleyReadHall::lifetime(type, doping) + 1. / Auger::lifetime(type, doping));
+        }
     };
 
     /**
@@ -164,10 +192,14 @@ namespace allpix {
             : electron_lifetime_(electron_lifetime), hole_lifetime_(hole_lifetime) {}
 
         bool operator()(const CarrierType& type, double, double survival_prob, double timestep) const override {
-            return survival_prob <
-                   (1 - std::exp(-1. * timestep / (type == CarrierType::ELECTRON ? electron_lifetime_ : hole_lifetime_)));
+            auto lifetime = (type == CarrierType::ELECTRON ? electron_lifetime_ : hole_lifetime_);
+            return survival_prob < (1 - fast_math::exp(-1. * timestep / lifetime));
         };
 
+        double lifetime(const CarrierType& type, double) const override {
+            return (type == CarrierType::ELECTRON ? electron_lifetime_ : hole_lifetime_);
+        }
+
     private:
         double electron_lifetime_;
         double hole_lifetime_;
@@ -180,19 +212,24 @@ namespace allpix {
     class CustomRecombination : virtual public RecombinationModel {
     public:
         CustomRecombination(const Configuration& config, bool doping) {
-            electron_lifetime_ = configure_lifetime(config, CarrierType::ELECTRON, doping);
-            hole_lifetime_ = configure_lifetime(config, CarrierType::HOLE, doping);
+            electron_lifetime_ =
+                std::make_unique<CompiledFormula>(configure_lifetime(config, CarrierType::ELECTRON, doping));
+            hole_lifetime_ = std::make_unique<CompiledFormula>(configure_lifetime(config, CarrierType::HOLE, doping));
         };
 
         bool operator()(const CarrierType& type, double doping, double survival_prob, double timestep) const override {
-            return survival_prob < (1 - std::exp(-1. * timestep /
-                                                 (type == CarrierType::ELECTRON ? electron_lifetime_->Eval(doping)
-                                                                                : hole_lifetime_->Eval(doping))));
+            return survival_prob < (1 - fast_math::exp(-1. * timestep /
+                                                 (type == CarrierType::ELECTRON ? (*electron_lifetime_)(doping)
+                                                                                : (*hole_lifetime_)(doping))));
         };
 
+        double lifetime(const CarrierType& type, double doping) const override {
+            return (type == CarrierType::ELECTRON ? (*electron_lifetime_)(doping) : (*hole_lifetime_)(doping));
+        }
+
     private:
-        std::unique_ptr<TFormula> electron_lifetime_;
-        std::unique_ptr<TFormula> hole_lifetime_;
+        std::unique_ptr<CompiledFormula> electron_lifetime_;
+        std::unique_ptr<CompiledFormula> hole_lifetime_;
 
         std::unique_ptr<TFormula> configure_lifetime(const Configuration& config, const CarrierType type, bool doping) {
             std::string name = (type == CarrierType::ELECTRON ? "electrons" : "holes");
@@ -227,6 +264,50 @@ namespace allpix {
         };
     };
 
+    /**
+     * @ingroup Models
+     * @brief Tabulated recombination model
+     *
+     * The inverse of the lifetime of the model is tabulated in the doping concentration, such that infinite lifetimes of
+     * carriers which do not recombine are represented by a vanishing rate.
+     */
+    template <> class Tabulated<RecombinationModel> : public RecombinationModel {
+    public:
+        /**
+         * @brief Tabulate a recombination model
+         * @param model Recombination model to be tabulated
+         * @param parameters Ranges and precision of the tables
+         */
+        Tabulated(const RecombinationModel& model, const TabulationParameters& parameters) : parameters_(parameters) {
+            auto tabulate = [&](const CarrierType& type) {
+                return TabulatedFunction(
+                    [&](double coordinate) { return 1. / model.lifetime(type, parameters_.getDoping(coordinate)); },
+                    parameters_.getDopingRange(),
+                    parameters_.getPrecision(),
+                    TabulationParameters::max_points_1d);
+            };
+            electron_rate_ = tabulate(CarrierType::ELECTRON);
+            hole_rate_ = tabulate(CarrierType::HOLE);
+            parameters_.report("recombination", electron_rate_, hole_rate_);
+        }
+
+        bool operator()(const CarrierType& type, double doping, double survival_prob, double timestep) const override {
+            return survival_prob < (1 - fast_math::exp(-1. * timestep * rate(type, doping)));
+        };
+
+        double lifetime(const CarrierType& type, double doping) const override { return 1. / rate(type, doping); }
+
+    private:
+        double rate(const CarrierType& type, double doping) const {
+            return (type == CarrierType::ELECTRON ? electron_rate_ : hole_rate_)(parameters_.getDopingCoordinate(doping));
+        }
+
+        TabulationParameters parameters_;
+
+        TabulatedFunction electron_rate_;
+        TabulatedFunction hole_rate_;
+    };
+
     /**
      * @brief Wrapper class and factory for recombination models.
      *
@@ -268,6 +349,11 @@ namespace allpix {
                     throw InvalidModelError(model);
                 }
                 LOG(INFO) << "Selected recombination model \"" << model << "\"";
+
+                // Replace the model by its tabulation if requested
+                if(model != "none" && config.get<bool>("tabulate_recombination", false)) {
+                    model_ = std::make_unique<Tabulated<RecombinationModel>>(*model_, TabulationParameters(config));
+                }
             } catch(const ModelError& e) {
                 throw InvalidValueError(config, "recombination_model", e.what());
             }
@@ -281,6 +367,33 @@ namespace allpix {
             return model_->operator()(std::forward<ARGS>(args)...);
         }
 
+        /**
+         * Lifetime forwarded to the recombination model
+         * @return Lifetime of the charge carrier
+         */
+        template <class... ARGS> double lifetime(ARGS&&... args) const {
+            return model_->lifetime(std::forward<ARGS>(args)...);
+        }
+
+        /**
+         * @brief Call a function with the recombination model, resolving the type of the model only once
+         * @param function Function called with a reference to the model which can be called as this wrapper
+         * @return Result of the function
+         *
+         * Calls to the model within the function are dispatched statically for all known model types instead of through
+         * the virtual function call operator, see \ref ModelTypes. This allows hoisting the dispatch out of loops over many
+         * evaluations of the model.
+         */
+        template <typename F> decltype(auto) visit(F&& function) const {
+            return ModelTypes<None,
+                              ShockleyReadHall,
+                              Auger,
+                              ShockleyReadHallAuger,
+                              ConstantLifetime,
+                              CustomRecombination,
+                              Tabulated<RecombinationModel>>::visit(*model_, std::forward<F>(function));
+        }
+
     private:
         std::unique_ptr<RecombinationModel> model_{};
     };
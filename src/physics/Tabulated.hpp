@@ -0,0 +1,137 @@
+/**
+ * @file
+ * @brief Definition of the tabulation of physics models
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef ALLPIX_TABULATED_MODELS_H
+#define ALLPIX_TABULATED_MODELS_H
+
+#include <array>
+#include <cmath>
+#include <string>
+
+#include "core/config/Configuration.hpp"
+#include "core/config/exceptions.h"
+#include "core/utils/log.h"
+#include "core/utils/unit.h"
+#include "core/utils/unit_constants.h"
+#include "tools/tabulated_function.h"
+
+namespace allpix {
+
+    /**
+     * @ingroup Models
+     * @brief Adapter evaluating a physics model from tables sampled during initialization
+     *
+     * The adapter implements the interface of the physics model it is specialized for, and replaces the evaluation of the
+     * model by an interpolation of the tables. It is specialized for every type of physics model next to the definition of
+     * its interface.
+     */
+    template <class Model> class Tabulated;
+
+    /**
+     * @ingroup Models
+     * @brief Ranges and precision of the tables of tabulated physics models
+     *
+     * The electric field is tabulated linearly from zero to the maximum field. The doping concentration is tabulated in the
+     * inverse hyperbolic sine of the doping concentration divided by a reference concentration, which resolves small and
+     * large concentrations of both signs equally well and is continuous across zero.
+     */
+    class TabulationParameters {
+    public:
+        /**
+         * @brief Read the tabulation parameters from the configuration
+         * @param config Configuration of the calling module
+         */
+        explicit TabulationParameters(const Configuration& config)
+            : precision_(config.get<double>("tabulation_precision", 1e-4)),
+              max_field_(config.get<double>("tabulation_max_field", 1000. * units::kV_per_cm)),
+              max_doping_(config.get<double>("tabulation_max_doping", 1e20 * units::per_cm3)) {
+            if(precision_ <= 0) {
+                throw InvalidValueError(config, "tabulation_precision", "precision has to be positive");
+            }
+            if(max_field_ <= 0) {
+                throw InvalidValueError(config, "tabulation_max_field", "maximum electric field has to be positive");
+            }
+            if(max_doping_ <= doping_reference_) {
+                throw InvalidValueError(config,
+                                        "tabulation_max_doping",
+                                        "maximum doping concentration has to be above " +
+                                            Units::display(doping_reference_, "/cm/cm/cm"));
+            }
+        }
+
+        /**
+         * @brief Get the maximum relative deviation of the tables from the models
+         */
+        double getPrecision() const { return precision_; }
+
+        /**
+         * @brief Get the range of tabulated electric field magnitudes
+         */
+        std::array<double, 2> getFieldRange() const { return {{0., max_field_}}; }
+
+        /**
+         * @brief Get the range of tabulated doping coordinates, see \ref getDopingCoordinate
+         */
+        std::array<double, 2> getDopingRange() const {
+            return {{-getDopingCoordinate(max_doping_), getDopingCoordinate(max_doping_)}};
+        }
+
+        /**
+         * @brief Get the coordinate of a doping concentration in the tables
+         * @param doping (Effective) doping concentration
+         * @return Coordinate of the doping concentration
+         */
+        double getDopingCoordinate(double doping) const { return std::asinh(doping / doping_reference_); }
+
+        /**
+         * @brief Get the doping concentration at a coordinate of the tables
+         * @param coordinate Coordinate of the doping concentration
+         * @return (Effective) doping concentration
+         */
+        double getDoping(double coordinate) const { return std::sinh(coordinate) * doping_reference_; }
+
+        /**
+         * @brief Report the size and precision of the tables of a model
+         * @param name Name of the type of physics model
+         * @param electron Table for electrons
+         * @param hole Table for holes
+         */
+        void report(const std::string& name, const TabulatedFunction& electron, const TabulatedFunction& hole) const {
+            for(const auto* table : {&electron, &hole}) {
+                auto size = table->getSize();
+                auto carrier = (table == &electron ? "electrons" : "holes");
+                LOG(INFO) << "Tabulated " << name << " model for " << carrier << " with " << size[0]
+                          << (size[1] > 1 ? "x" + std::to_string(size[1]) : std::string()) << " points, maximum deviation "
+                          << table->getPrecision();
+                if(table->getPrecision() > precision_) {
+                    LOG(WARNING) << "Tabulated " << name << " model for " << carrier << " deviates by up to "
+                                 << table->getPrecision() << " from the model, exceeding the requested precision of "
+                                 << precision_;
+                }
+            }
+        }
+
+        /// Maximum number of points along the axis of a table of a single variable
+        static constexpr size_t max_points_1d = 65537;
+        /// Maximum number of points along each axis of a table of two variables
+        static constexpr size_t max_points_2d = 513;
+
+    private:
+        double precision_;
+        double max_field_;
+        double max_doping_;
+
+        double doping_reference_{1e10 * units::per_cm3};
+    };
+
+} // namespace allpix
+
+#endif /* ALLPIX_TABULATED_MODELS_H */
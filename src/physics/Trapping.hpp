@@ -12,14 +12,21 @@
 #ifndef ALLPIX_TRAPPING_MODELS_H
 #define ALLPIX_TRAPPING_MODELS_H
 
+#include <limits>
+
 #include <TFormula.h>
 
+#include "ModelDispatch.hpp"
+#include "Tabulated.hpp"
 #include "exceptions.h"
 
 #include "core/config/Configuration.hpp"
 #include "core/utils/log.h"
 #include "core/utils/unit.h"
+#include "core/utils/unit_constants.h"
 #include "objects/SensorCharge.hpp"
+#include "tools/compiled_formula.h"
+#include "tools/fast_math.h"
 
 namespace allpix {
 
@@ -48,10 +55,20 @@ namespace allpix {
          * @return Trapping status of the charge carrier
          */
         virtual bool operator()(const CarrierType& type, double probability, double timestep, double) const {
-            return probability <
-                   (1 - std::exp(-1. * timestep / (type == CarrierType::ELECTRON ? tau_eff_electron_ : tau_eff_hole_)));
+            return probability < (1 - fast_math::exp(-1. * timestep /
+                                                     (type == CarrierType::ELECTRON ? tau_eff_electron_ : tau_eff_hole_)));
         };
 
+        /**
+         * Effective trapping time of the given carrier type
+         * @param type Type of charge carrier (electron or hole)
+         * additional possible parameter: efield_mag Magnitude of the electric field
+         * @return Effective trapping time of the charge carrier
+         */
+        virtual double lifetime(const CarrierType& type, double) const {
+            return (type == CarrierType::ELECTRON ? tau_eff_electron_ : tau_eff_hole_);
+        }
+
     protected:
         double tau_eff_electron_{std::numeric_limits<double>::max()};
         double tau_eff_hole_{std::numeric_limits<double>::max()};
@@ -64,6 +81,8 @@ namespace allpix {
     class NoTrapping : virtual public TrappingModel {
     public:
         bool operator()(const CarrierType&, double, double, double) const override { return false; };
+
+        double lifetime(const CarrierType&, double) const override { return std::numeric_limits<double>::infinity(); }
     };
 
     /**
@@ -89,8 +108,8 @@ namespace allpix {
     class Ljubljana : virtual public TrappingModel {
     public:
         Ljubljana(double temperature, double fluence) {
-            tau_eff_electron_ = 1. / Units::get(5.6e-16 * std::pow(temperature / 263, -0.86), "cm*cm/ns") / fluence;
-            tau_eff_hole_ = 1. / Units::get(7.7e-16 * std::pow(temperature / 263, -1.52), "cm*cm/ns") / fluence;
+            tau_eff_electron_ = 1. / (5.6e-16 * std::pow(temperature / 263, -0.86) * units::cm2_per_ns) / fluence;
+            tau_eff_hole_ = 1. / (7.7e-16 * std::pow(temperature / 263, -1.52) * units::cm2_per_ns) / fluence;
         }
     };
 
@@ -104,8 +123,8 @@ namespace allpix {
     class Dortmund : virtual public TrappingModel {
     public:
         explicit Dortmund(double fluence) {
-            tau_eff_electron_ = 1. / Units::get(5.13e-16, "cm*cm/ns") / fluence;
-            tau_eff_hole_ = 1. / Units::get(5.04e-16, "cm*cm/ns") / fluence;
+            tau_eff_electron_ = 1. / (5.13e-16 * units::cm2_per_ns) / fluence;
+            tau_eff_hole_ = 1. / (5.04e-16 * units::cm2_per_ns) / fluence;
         }
     };
 
@@ -121,8 +140,8 @@ namespace allpix {
     class CMSTracker : virtual public TrappingModel {
     public:
         explicit CMSTracker(double fluence) {
-            tau_eff_electron_ = 1. / (Units::get(1.71e-16, "cm*cm/ns") * fluence + Units::get(0.114, "/ns"));
-            tau_eff_hole_ = 1. / (Units::get(2.79e-16, "cm*cm/ns") * fluence + Units::get(0.093, "/ns"));
+            tau_eff_electron_ = 1. / (1.71e-16 * units::cm2_per_ns * fluence + 0.114 * units::per_ns);
+            tau_eff_hole_ = 1. / (2.79e-16 * units::cm2_per_ns * fluence + 0.093 * units::per_ns);
         }
     };
 
@@ -136,7 +155,7 @@ namespace allpix {
     class Mandic : virtual public TrappingModel {
     public:
         explicit Mandic(double fluence) {
-            tau_eff_electron_ = 0.054 * pow(fluence / Units::get(1e16, "/cm/cm"), -0.62);
+            tau_eff_electron_ = 0.054 * pow(fluence / (1e16 * units::per_cm2), -0.62);
             tau_eff_hole_ = tau_eff_electron_ * (4.9 / 6.2);
         }
     };
@@ -148,19 +167,24 @@ namespace allpix {
     class CustomTrapping : virtual public TrappingModel {
     public:
         explicit CustomTrapping(const Configuration& config) {
-            tf_tau_eff_electron_ = configure_tau_eff(config, CarrierType::ELECTRON);
-            tf_tau_eff_hole_ = configure_tau_eff(config, CarrierType::HOLE);
+            tf_tau_eff_electron_ = std::make_unique<CompiledFormula>(configure_tau_eff(config, CarrierType::ELECTRON));
+            tf_tau_eff_hole_ = std::make_unique<CompiledFormula>(configure_tau_eff(config, CarrierType::HOLE));
         };
 
         bool operator()(const CarrierType& type, double probability, double timestep, double efield_mag) const override {
-            return probability < (1 - std::exp(-1. * timestep /
-                                               (type == CarrierType::ELECTRON ? tf_tau_eff_electron_->Eval(efield_mag)
-                                                                              : tf_tau_eff_hole_->Eval(efield_mag))));
+            return probability < (1 - fast_math::exp(-1. * timestep /
+                                               (type == CarrierType::ELECTRON ? (*tf_tau_eff_electron_)(efield_mag)
+                                                                              : (*tf_tau_eff_hole_)(efield_mag))));
         };
 
+        double lifetime(const CarrierType& type, double efield_mag) const override {
+            return (type == CarrierType::ELECTRON ? (*tf_tau_eff_electron_)(efield_mag)
+                                                  : (*tf_tau_eff_hole_)(efield_mag));
+        }
+
     private:
-        std::unique_ptr<TFormula> tf_tau_eff_electron_;
-        std::unique_ptr<TFormula> tf_tau_eff_hole_;
+        std::unique_ptr<CompiledFormula> tf_tau_eff_electron_;
+        std::unique_ptr<CompiledFormula> tf_tau_eff_hole_;
 
         std::unique_ptr<TFormula> configure_tau_eff(const Configuration& config, const CarrierType type) {
             std::string name = (type == CarrierType::ELECTRON ? "electrons" : "holes");
@@ -190,6 +214,45 @@ namespace allpix {
         };
     };
 
+    /**
+     * @ingroup Models
+     * @brief Tabulated trapping model
+     *
+     * The inverse of the effective trapping time of the model is tabulated in the electric field magnitude.
+     */
+    template <> class Tabulated<TrappingModel> : public TrappingModel {
+    public:
+        /**
+         * @brief Tabulate a trapping model
+         * @param model Trapping model to be tabulated
+         * @param parameters Ranges and precision of the tables
+         */
+        Tabulated(const TrappingModel& model, const TabulationParameters& parameters) {
+            auto tabulate = [&](const CarrierType& type) {
+                return TabulatedFunction([&](double efield_mag) { return 1. / model.lifetime(type, efield_mag); },
+                                         parameters.getFieldRange(),
+                                         parameters.getPrecision(),
+                                         TabulationParameters::max_points_1d);
+            };
+            electron_rate_ = tabulate(CarrierType::ELECTRON);
+            hole_rate_ = tabulate(CarrierType::HOLE);
+            parameters.report("trapping", electron_rate_, hole_rate_);
+        }
+
+        bool operator()(const CarrierType& type, double probability, double timestep, double efield_mag) const override {
+            const auto& rate = (type == CarrierType::ELECTRON ? electron_rate_ : hole_rate_);
+            return probability < (1 - fast_math::exp(-1. * timestep * rate(efield_mag)));
+        };
+
+        double lifetime(const CarrierType& type, double efield_mag) const override {
+            return 1. / (type == CarrierType::ELECTRON ? electron_rate_ : hole_rate_)(efield_mag);
+        }
+
+    private:
+        TabulatedFunction electron_rate_;
+        TabulatedFunction hole_rate_;
+    };
+
     /**
      * @brief Wrapper class and factory for trapping models.
      *
@@ -241,6 +304,11 @@ namespace allpix {
                     throw InvalidModelError(model);
                 }
                 LOG(INFO) << "Selected trapping model \"" << model << "\"";
+
+                // Replace the model by its tabulation if requested
+                if(model != "none" && config.get<bool>("tabulate_trapping", false)) {
+                    model_ = std::make_unique<Tabulated<TrappingModel>>(*model_, TabulationParameters(config));
+                }
             } catch(const ModelError& e) {
                 throw InvalidValueError(config, "trapping_model", e.what());
             }
@@ -254,6 +322,34 @@ namespace allpix {
             return model_->operator()(std::forward<ARGS>(args)...);
         }
 
+        /**
+         * Lifetime forwarded to the trapping model
+         * @return Lifetime of the charge carrier
+         */
+        template <class... ARGS> double lifetime(ARGS&&... args) const {
+            return model_->lifetime(std::forward<ARGS>(args)...);
+        }
+
+        /**
+         * @brief Call a function with the trapping model, resolving the type of the model only once
+         * @param function Function called with a reference to the model which can be called as this wrapper
+         * @return Result of the function
+         *
+         * Calls to the model within the function are dispatched statically for all known model types instead of through
+         * the virtual function call operator, see \ref ModelTypes. This allows hoisting the dispatch out of loops over many
+         * evaluations of the model.
+         */
+        template <typename F> decltype(auto) visit(F&& function) const {
+            return ModelTypes<NoTrapping,
+                              ConstantTrapping,
+                              Ljubljana,
+                              Dortmund,
+                              CMSTracker,
+                              Mandic,
+                              CustomTrapping,
+                              Tabulated<TrappingModel>>::visit(*model_, std::forward<F>(function));
+        }
+
     private:
         std::unique_ptr<TrappingModel> model_{};
     };
@@ -12,10 +12,18 @@
 #ifndef ALLPIX_ROOT_H
 #define ALLPIX_ROOT_H
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
 #include <ostream>
+#include <set>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <utility>
+#include <vector>
 
 #include <Math/DisplacementVector2D.h>
 #include <Math/DisplacementVector3D.h>
@@ -157,6 +165,172 @@ namespace allpix {
         return os << "(" << vec.x() << "," << vec.y() << ")";
     }
 
+    /**
+     * @brief Settings for the filling of the ThreadedHistograms by the module executed on the calling thread
+     *
+     * The settings are applied by the framework before executing a module, such that plots can be sampled and buffered for
+     * all modules without changes to the modules themselves.
+     */
+    class HistogramFilling {
+    public:
+        /**
+         * @brief Check if the fills of the histograms are skipped for the current event
+         */
+        static bool isSkipped() { return skipped_; }
+
+        /**
+         * @brief Set if the fills of the histograms are skipped for the current event
+         * @param skipped True to skip all fills
+         */
+        static void setSkipped(bool skipped) { skipped_ = skipped; }
+
+        /**
+         * @brief Get the number of entries buffered by the thread local instances of newly created histograms
+         */
+        static int getBufferSize() { return buffer_size_; }
+
+        /**
+         * @brief Set the number of entries buffered by the thread local instances of newly created histograms
+         * @param buffer_size Number of buffered entries, zero to fill the histograms directly
+         */
+        static void setBufferSize(int buffer_size) { buffer_size_ = buffer_size; }
+
+    private:
+        static inline thread_local bool skipped_{false};
+        static inline thread_local int buffer_size_{0};
+    };
+
+    /**
+     * @brief Base of all threaded histograms, merging the thread local instances of all histograms concurrently
+     *
+     * Every threaded histogram registers itself on construction. The thread local instances of all registered histograms
+     * can then be merged together by a pairwise tree reduction, where every level of the reduction merges pairs of instances
+     * of all histograms in parallel.
+     */
+    class ThreadedHistogramBase {
+    public:
+        ThreadedHistogramBase() {
+            std::lock_guard<std::mutex> lock(registry_mutex_);
+            registry_.insert(this);
+        }
+        virtual ~ThreadedHistogramBase() {
+            std::lock_guard<std::mutex> lock(registry_mutex_);
+            registry_.erase(this);
+        }
+
+        /// @{
+        /**
+         * @brief Disallow copy and move, the histograms are registered by their address
+         */
+        ThreadedHistogramBase(const ThreadedHistogramBase&) = delete;
+        ThreadedHistogramBase& operator=(const ThreadedHistogramBase&) = delete;
+        ThreadedHistogramBase(ThreadedHistogramBase&&) = delete;
+        ThreadedHistogramBase& operator=(ThreadedHistogramBase&&) = delete;
+        /// @}
+
+        /**
+         * @brief Merge the thread local instances of all registered histograms which have not been merged yet
+         * @param threads Number of threads to merge the histograms with
+         *
+         * Histograms which are filled afterwards by the main thread are still complete, instances created by other threads
+         * after merging are not included anymore.
+         */
+        static void mergeAll(unsigned int threads) {
+            std::lock_guard<std::mutex> lock(registry_mutex_);
+            std::vector<ThreadedHistogramBase*> histograms;
+            size_t max_slots = 0;
+            for(auto* histogram : registry_) {
+                if(!histogram->is_merged()) {
+                    histograms.push_back(histogram);
+                    max_slots = std::max(max_slots, histogram->get_slot_count());
+                }
+            }
+
+            // Run a list of tasks on the given number of threads, rethrowing the first exception of any task
+            auto run_tasks = [threads](size_t num_tasks, const auto& task_function) {
+                std::atomic<size_t> next_task{0};
+                std::exception_ptr exception;
+                std::mutex exception_mutex;
+                auto worker = [&]() {
+                    for(auto task = next_task++; task < num_tasks; task = next_task++) {
+                        try {
+                            task_function(task);
+                        } catch(...) {
+                            std::lock_guard<std::mutex> exception_lock(exception_mutex);
+                            if(!exception) {
+                                exception = std::current_exception();
+                            }
+                        }
+                    }
+                };
+                std::vector<std::thread> workers;
+                for(size_t i = 1; i < std::min<size_t>(threads, num_tasks); ++i) {
+                    workers.emplace_back(worker);
+                }
+                worker();
+                for(auto& thread : workers) {
+                    thread.join();
+                }
+                if(exception) {
+                    std::rethrow_exception(exception);
+                }
+            };
+
+            // Empty the buffers of all instances before merging
+            run_tasks(histograms.size(), [&](size_t task) { histograms[task]->prepare_merge(); });
+
+            // Merge pairs of instances with increasing distance until all are merged into the first instance
+            for(size_t stride = 1; stride < max_slots; stride *= 2) {
+                std::vector<std::pair<ThreadedHistogramBase*, size_t>> pairs;
+                for(auto* histogram : histograms) {
+                    for(size_t target = 0; target + stride < histogram->get_slot_count(); target += 2 * stride) {
+                        pairs.emplace_back(histogram, target);
+                    }
+                }
+                run_tasks(pairs.size(), [&](size_t task) {
+                    auto [histogram, target] = pairs[task];
+                    histogram->merge_slots(target, target + stride);
+                });
+            }
+
+            for(auto* histogram : histograms) {
+                histogram->set_merged();
+            }
+        }
+
+    protected:
+        /**
+         * @brief Check if the thread local instances have been merged
+         */
+        virtual bool is_merged() const = 0;
+
+        /**
+         * @brief Mark the thread local instances as merged into the first instance
+         */
+        virtual void set_merged() = 0;
+
+        /**
+         * @brief Get the number of thread local instances, including the ones not created
+         */
+        virtual size_t get_slot_count() const = 0;
+
+        /**
+         * @brief Prepare the thread local instances for merging
+         */
+        virtual void prepare_merge() = 0;
+
+        /**
+         * @brief Merge a thread local instance into another one and delete it
+         * @param target Index of the instance to merge into
+         * @param source Index of the instance to merge
+         */
+        virtual void merge_slots(size_t target, size_t source) = 0;
+
+    private:
+        static inline std::mutex registry_mutex_;
+        static inline std::set<ThreadedHistogramBase*> registry_;
+    };
+
     /**
      * @brief A re-implementation of ROOT::TThreadedObject
      *
@@ -165,16 +339,30 @@ namespace allpix {
      * does not depend on ROOT implementation changes that have happened to the original class between minor ROOT versions.
      * This class scales to an arbitrary number of thread, irrespective of the underlying ROOT version.
      *
-     * Enables filling histograms in parallel and makes sure an empty instance will exist if not filled.
+     * Enables filling histograms in parallel and makes sure an empty instance will exist if not filled. Fills are skipped
+     * for events not sampled for plotting, and the thread local instances buffer their entries if a buffer size is set in
+     * \ref HistogramFilling while creating the histogram. Buffered entries are filled into the bins in batches when the
+     * buffer is full and before merging.
+     *
+     * Thread local instances are only created by the threads filling the histogram. They are either merged sequentially
+     * when the histogram is written, or together with all other histograms by \ref ThreadedHistogramBase::mergeAll.
      */
-    template <typename T, typename std::enable_if<std::is_base_of<TH1, T>::value>::type* = nullptr> class ThreadedHistogram {
+    template <typename T, typename std::enable_if<std::is_base_of<TH1, T>::value>::type* = nullptr>
+    class ThreadedHistogram : public ThreadedHistogramBase {
     public:
-        template <class... ARGS> explicit ThreadedHistogram(ARGS&&... args) { this->init(std::forward<ARGS>(args)...); }
+        template <class... ARGS>
+        explicit ThreadedHistogram(ARGS&&... args) : buffer_size_(HistogramFilling::getBufferSize()) {
+            this->init(std::forward<ARGS>(args)...);
+        }
 
         /**
          * @brief An easy way to fill a histogram
+         * @return Bin number of the fill as returned by ROOT, or -1 if the fill is skipped or buffered
          */
         template <class... ARGS> Int_t Fill(ARGS&&... args) { // NOLINT
+            if(HistogramFilling::isSkipped()) {
+                return -1;
+            }
             return this->Get()->Fill(std::forward<ARGS>(args)...);
         }
 
@@ -182,7 +370,11 @@ namespace allpix {
          * @brief An easy way to set bin contents
          */
         template <class... ARGS> void SetBinContent(ARGS&&... args) { // NOLINT
-            this->Get()->SetBinContent(std::forward<ARGS>(args)...);
+            auto object = this->Get();
+            if(buffer_size_ > 0) {
+                object->BufferEmpty();
+            }
+            object->SetBinContent(std::forward<ARGS>(args)...);
         }
 
         /**
@@ -199,7 +391,18 @@ namespace allpix {
             auto idx = ThreadPool::threadNum();
             auto& object = objects_[idx];
             if(!object) {
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6, 22, 0)
+                // The directory of a thread is only created once the thread fills the histogram
+                if(directories_[idx] == nullptr) {
+                    static std::mutex directory_mutex;
+                    std::lock_guard<std::mutex> lock(directory_mutex);
+                    directories_[idx] = ROOT::Internal::TThreadedObjectUtils::DirCreator<T>::Create();
+                }
+#endif
                 object.reset(ROOT::Internal::TThreadedObjectUtils::Cloner<T>::Clone(model_.get(), directories_[idx]));
+                if(buffer_size_ > 0) {
+                    object->SetBuffer(buffer_size_);
+                }
             }
             return object;
         }
@@ -214,11 +417,41 @@ namespace allpix {
             if(is_merged_) {
                 return objects_[0];
             }
+            prepare_merge();
             mergeFunction(objects_[0], objects_);
             is_merged_ = true;
             return objects_[0];
         }
 
+    protected:
+        bool is_merged() const override { return is_merged_; }
+        void set_merged() override { is_merged_ = true; }
+        size_t get_slot_count() const override { return objects_.size(); }
+
+        void prepare_merge() override {
+            // Fill the remaining buffered entries of all threads and stop buffering
+            if(buffer_size_ > 0) {
+                for(auto& object : objects_) {
+                    if(object) {
+                        object->BufferEmpty(1);
+                    }
+                }
+            }
+        }
+
+        void merge_slots(size_t target, size_t source) override {
+            if(!objects_[source]) {
+                return;
+            }
+            if(!objects_[target]) {
+                objects_[target] = std::move(objects_[source]);
+                return;
+            }
+            std::vector<std::shared_ptr<T>> pair{objects_[target], objects_[source]};
+            ROOT::TThreadedObjectUtils::MergeTObjects<T>(objects_[target], pair);
+            objects_[source].reset();
+        }
+
     private:
         /**
          * @brief Initialize the threaded histogram
@@ -233,11 +466,9 @@ namespace allpix {
 #if ROOT_VERSION_CODE < ROOT_VERSION(6, 22, 0)
             directories_ = ROOT::Internal::TThreadedObjectUtils::DirCreator<T>::Create(num_slots);
 #else
-            // create at least one directory (we need it for the model), plus others as needed by the size of objects
-            directories_.emplace_back(ROOT::Internal::TThreadedObjectUtils::DirCreator<T>::Create());
-            for(auto i = 1u; i < num_slots; ++i) {
-                directories_.emplace_back(ROOT::Internal::TThreadedObjectUtils::DirCreator<T>::Create());
-            }
+            // create at least one directory (we need it for the model), the others are created by the threads filling
+            directories_.resize(num_slots, nullptr);
+            directories_[0] = ROOT::Internal::TThreadedObjectUtils::DirCreator<T>::Create();
 #endif
 
             TDirectory::TContext ctxt(directories_[0]);
@@ -245,12 +476,16 @@ namespace allpix {
 
             // initialize at least the base object
             objects_[0].reset(ROOT::Internal::TThreadedObjectUtils::Cloner<T>::Clone(model_.get(), directories_[0]));
+            if(buffer_size_ > 0) {
+                objects_[0]->SetBuffer(buffer_size_);
+            }
         }
 
         std::unique_ptr<T> model_;
         std::vector<std::shared_ptr<T>> objects_;
         std::vector<TDirectory*> directories_;
         bool is_merged_{false};
+        int buffer_size_{};
     };
 
     /**
@@ -0,0 +1,117 @@
+/**
+ * @file
+ * @brief Utility to evaluate ROOT::TFormula expressions through natively compiled functions
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef ALLPIX_COMPILED_FORMULA_H
+#define ALLPIX_COMPILED_FORMULA_H
+
+#include <atomic>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include <TFormula.h>
+#include <TInterpreter.h>
+#include <TVirtualMutex.h>
+
+namespace allpix {
+    /**
+     * @brief Class to evaluate a configured ROOT::TFormula via a function compiled at initialization
+     *
+     * The expression of the formula is declared to Cling as a free C++ function, with the values of all formula parameters
+     * inserted as constants at full precision. The compiler can thereby fold the parameters into the expression, and the
+     * evaluation does not go through the parameter arrays and the dispatch of TFormula::Eval. The function is compiled once
+     * when the object is constructed and afterwards called directly via its address, which is thread-safe as the function
+     * has no state.
+     *
+     * If the expression cannot be compiled, e.g. because a parameter is not finite, the formula is evaluated via
+     * TFormula::Eval instead. Parameters of the formula must not be changed after construction.
+     */
+    class CompiledFormula {
+    public:
+        /**
+         * @brief Compile a formula with all parameters already set
+         * @param formula Valid formula to take ownership of
+         */
+        explicit CompiledFormula(std::unique_ptr<TFormula> formula) : formula_(std::move(formula)) { compile(); }
+
+        /**
+         * @brief Evaluate the formula
+         * @param x First variable of the formula
+         * @param y Second variable of the formula
+         * @param z Third variable of the formula
+         * @param t Fourth variable of the formula
+         * @return Value of the formula
+         */
+        double operator()(double x, double y = 0, double z = 0, double t = 0) const {
+            if(function_ != nullptr) {
+                const double variables[] = {x, y, z, t};
+                return function_(variables);
+            }
+            return formula_->Eval(x, y, z, t);
+        }
+
+        /**
+         * @brief Check whether the formula is evaluated via a compiled function
+         * @return True if the expression was compiled, false if it is evaluated via TFormula::Eval
+         */
+        bool isCompiled() const { return function_ != nullptr; }
+
+        /**
+         * @brief Get the underlying formula
+         * @return Reference to the formula
+         */
+        const TFormula& getFormula() const { return *formula_; }
+
+    private:
+        using Function = double (*)(const double*);
+
+        void compile() {
+            std::string expression = formula_->GetExpFormula("CLING").Data();
+            if(expression.empty() || gInterpreter == nullptr) {
+                return;
+            }
+
+            // Inline the parameters, the declaration is not valid C++ for parameters which are not finite
+            std::ostringstream code;
+            code << std::setprecision(std::numeric_limits<double>::max_digits10);
+            static std::atomic_uint counter{0};
+            std::string name = "allpix_compiled_formula_" + std::to_string(counter++);
+            code << "double " << name << "(const double* x) {";
+            if(formula_->GetNpar() > 0) {
+                code << " constexpr double p[] = {";
+                for(int n = 0; n < formula_->GetNpar(); ++n) {
+                    auto parameter = formula_->GetParameter(n);
+                    if(!std::isfinite(parameter)) {
+                        return;
+                    }
+                    code << (n > 0 ? ", " : "") << parameter;
+                }
+                code << "};";
+            }
+            code << " return " << expression << "; }";
+
+            R__LOCKGUARD(gInterpreterMutex);
+            if(!gInterpreter->Declare(code.str().c_str())) {
+                return;
+            }
+            auto address = gInterpreter->Calc(("(long)&" + name).c_str());
+            function_ = reinterpret_cast<Function>(address); // NOLINT
+        }
+
+        std::unique_ptr<TFormula> formula_;
+        Function function_{nullptr};
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_COMPILED_FORMULA_H */
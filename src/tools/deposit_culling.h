@@ -0,0 +1,110 @@
+/**
+ * @file
+ * @brief Utility to cull deposited charges which are not worth propagating before the drift simulation
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef ALLPIX_DEPOSIT_CULLING_H
+#define ALLPIX_DEPOSIT_CULLING_H
+
+#include <limits>
+#include <memory>
+
+#include "core/config/Configuration.hpp"
+#include "core/config/exceptions.h"
+#include "core/geometry/DetectorModel.hpp"
+#include "core/module/Metrics.hpp"
+#include "core/utils/log.h"
+#include "objects/DepositedCharge.hpp"
+
+namespace allpix {
+
+    /**
+     * @brief Selection of the deposits passed on to the drift simulation of a propagation module
+     *
+     * Deposits are culled if they are located outside the pixel matrix, e.g. in the guard rings at the edges of the sensor,
+     * if they are created later than a maximum global time, or if they carry less than a minimum charge. All criteria are
+     * configured via the module configuration and are disabled by default. The culled deposits are counted per criterion,
+     * the counters have to be registered with the module before the first event.
+     */
+    class DepositCulling {
+    public:
+        /**
+         * @brief Read the culling criteria from the module configuration
+         * @param config Configuration of the propagation module
+         * @param model Model of the detector the deposits are located in
+         */
+        void configure(Configuration& config, std::shared_ptr<const DetectorModel> model) {
+            config.setDefault<bool>("cull_outside_matrix", false);
+            config.setDefault<unsigned int>("min_deposit_charge", 0);
+
+            model_ = std::move(model);
+            outside_matrix_ = config.get<bool>("cull_outside_matrix");
+            max_time_ = config.get<double>("max_deposit_time", std::numeric_limits<double>::max());
+            min_charge_ = config.get<unsigned int>("min_deposit_charge");
+            if(max_time_ < 0) {
+                throw InvalidValueError(config, "max_deposit_time", "maximum time of deposits cannot be negative");
+            }
+        }
+
+        /**
+         * @brief Check whether any of the culling criteria is enabled
+         */
+        bool enabled() const {
+            return outside_matrix_ || max_time_ < std::numeric_limits<double>::max() || min_charge_ > 0;
+        }
+
+        /**
+         * @brief Check whether a deposit should be dropped before the propagation and count it
+         * @param deposit Deposited charge to check
+         * @return True if the deposit is culled, false if it should be propagated
+         */
+        bool cull(const DepositedCharge& deposit) {
+            if(deposit.getCharge() < min_charge_) {
+                culled_low_charge.add();
+                return true;
+            }
+            if(deposit.getGlobalTime() > max_time_) {
+                culled_late.add();
+                return true;
+            }
+            if(outside_matrix_ && !model_->isWithinMatrix(deposit.getLocalPosition())) {
+                culled_outside_matrix.add();
+                return true;
+            }
+            return false;
+        }
+
+        /**
+         * @brief Print the number of deposits culled per criterion
+         */
+        void report() const {
+            if(!enabled()) {
+                return;
+            }
+            auto culled = culled_outside_matrix.value() + culled_late.value() + culled_low_charge.value();
+            LOG(INFO) << "Culled total of " << culled << " deposits before the propagation, "
+                      << culled_outside_matrix.value() << " outside the pixel matrix, " << culled_late.value()
+                      << " beyond the maximum deposit time and " << culled_low_charge.value()
+                      << " below the minimum deposit charge";
+        }
+
+        // Number of culled deposits per criterion
+        Counter culled_outside_matrix;
+        Counter culled_late;
+        Counter culled_low_charge;
+
+    private:
+        std::shared_ptr<const DetectorModel> model_;
+        bool outside_matrix_{false};
+        double max_time_{std::numeric_limits<double>::max()};
+        unsigned int min_charge_{0};
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_DEPOSIT_CULLING_H */
@@ -0,0 +1,115 @@
+/**
+ * @file
+ * @brief Utility to order deposited charges along a space-filling curve before the drift simulation
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef ALLPIX_DEPOSIT_ORDERING_H
+#define ALLPIX_DEPOSIT_ORDERING_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "core/config/Configuration.hpp"
+#include "core/geometry/DetectorModel.hpp"
+#include "objects/DepositedCharge.hpp"
+
+namespace allpix {
+
+    /**
+     * @brief Spatial ordering of the deposits passed on to the drift simulation of a propagation module
+     *
+     * Deposits are received in the order of the simulated particle tracks. If enabled, they are sorted by carrier type and
+     * by the Morton code of their local position within the sensor, such that consecutively propagated deposits are close
+     * to each other and access neighboring regions of the field maps. The order of the propagated charges dispatched by the
+     * module then follows the order of the sorted deposits. The sorting is stable and only depends on the deposits, such
+     * that simulations stay reproducible.
+     */
+    class DepositOrdering {
+    public:
+        /**
+         * @brief Read the ordering settings from the module configuration
+         * @param config Configuration of the propagation module
+         * @param model Model of the detector the deposits are located in
+         */
+        void configure(Configuration& config, const std::shared_ptr<const DetectorModel>& model) {
+            config.setDefault<bool>("sort_deposits", false);
+            enabled_ = config.get<bool>("sort_deposits");
+
+            auto size = model->getSensorSize();
+            origin_ = model->getSensorCenter() - size / 2.0;
+            scale_ = {resolution / size.x(), resolution / size.y(), resolution / size.z()};
+        }
+
+        /**
+         * @brief Check whether the deposits are sorted
+         */
+        bool enabled() const { return enabled_; }
+
+        /**
+         * @brief Sort the selected deposits by carrier type and along the Morton curve of their position
+         * @param deposits Deposits to be propagated, sorted in place
+         */
+        void sort(std::vector<const DepositedCharge*>& deposits) const {
+            if(!enabled_ || deposits.size() < 2) {
+                return;
+            }
+
+            std::vector<std::pair<std::uint64_t, const DepositedCharge*>> keys;
+            keys.reserve(deposits.size());
+            for(const auto* deposit : deposits) {
+                keys.emplace_back(key(*deposit), deposit);
+            }
+            std::stable_sort(
+                keys.begin(), keys.end(), [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+            for(size_t i = 0; i < keys.size(); ++i) {
+                deposits[i] = keys[i].second;
+            }
+        }
+
+    private:
+        // Number of cells of the Morton grid along every axis
+        static constexpr double resolution = (1u << 21) - 1;
+
+        /**
+         * @brief Spread the lowest 21 bits of a number such that two zero bits follow every bit
+         */
+        static std::uint64_t spread(std::uint64_t value) {
+            value &= 0x1FFFFF;
+            value = (value | value << 32) & 0x1F00000000FFFF;
+            value = (value | value << 16) & 0x1F0000FF0000FF;
+            value = (value | value << 8) & 0x100F00F00F00F00F;
+            value = (value | value << 4) & 0x10C30C30C30C30C3;
+            value = (value | value << 2) & 0x1249249249249249;
+            return value;
+        }
+
+        /**
+         * @brief Calculate the sorting key from the carrier type in the highest bit and the Morton code of the position
+         */
+        std::uint64_t key(const DepositedCharge& deposit) const {
+            auto cell = [](double position, double scale) {
+                return static_cast<std::uint64_t>(std::clamp(position * scale, 0., resolution));
+            };
+            auto position = deposit.getLocalPosition() - origin_;
+            auto code = spread(cell(position.x(), scale_.x())) | spread(cell(position.y(), scale_.y())) << 1 |
+                        spread(cell(position.z(), scale_.z())) << 2;
+            return (deposit.getType() == CarrierType::HOLE ? std::uint64_t(1) << 63 : 0) | code;
+        }
+
+        bool enabled_{false};
+        ROOT::Math::XYZPoint origin_;
+        ROOT::Math::XYZVector scale_;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_DEPOSIT_ORDERING_H */
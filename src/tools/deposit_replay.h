@@ -0,0 +1,437 @@
+/**
+ * @file
+ * @brief Utility to store and read compact files of deposited charges and Monte Carlo particles for replaying events
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef ALLPIX_DEPOSIT_REPLAY_H
+#define ALLPIX_DEPOSIT_REPLAY_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "tools/mapped_file.h"
+
+namespace allpix {
+    /**
+     * @brief Deposited charges and Monte Carlo particles of a single detector in an event, stored column by column
+     *
+     * Points are stored as three consecutive coordinates. Relations between particles and to the particle of a deposit are
+     * stored as index into the particles of the same detector, or as -1 for unknown particles.
+     */
+    struct DepositReplayRecord {
+        /// Flag indicating that the event contained a message of deposited charges for the detector
+        static constexpr std::uint8_t has_deposits = 1;
+        /// Flag indicating that the event contained a message of Monte Carlo particles for the detector
+        static constexpr std::uint8_t has_particles = 2;
+
+        std::uint32_t detector{};
+        std::uint8_t flags{};
+
+        std::vector<double> particle_local_start;
+        std::vector<double> particle_global_start;
+        std::vector<double> particle_local_end;
+        std::vector<double> particle_global_end;
+        std::vector<std::int32_t> particle_id;
+        std::vector<double> particle_local_time;
+        std::vector<double> particle_global_time;
+        std::vector<double> particle_total_energy;
+        std::vector<double> particle_kinetic_energy;
+        std::vector<std::uint32_t> particle_charge;
+        std::vector<std::int32_t> particle_parent;
+
+        std::vector<double> deposit_local_position;
+        std::vector<double> deposit_global_position;
+        std::vector<std::int8_t> deposit_type;
+        std::vector<std::uint32_t> deposit_charge;
+        std::vector<double> deposit_local_time;
+        std::vector<double> deposit_global_time;
+        std::vector<std::int32_t> deposit_particle;
+
+        /**
+         * @brief Get the number of Monte Carlo particles of the record
+         */
+        size_t getParticleCount() const { return particle_id.size(); }
+
+        /**
+         * @brief Get the number of deposited charges of the record
+         */
+        size_t getDepositCount() const { return deposit_charge.size(); }
+    };
+
+    /**
+     * @brief Layout of the compact deposit replay files
+     *
+     * The files start with a header holding magic bytes, the format version, a byte order mark and the names of all
+     * detectors. Events follow as independent blocks with the event number and the records of all detectors, every record
+     * storing its columns as contiguous arrays in native byte order. The file ends with an index of the offsets of all
+     * event blocks, sorted by event number, followed by the offset of the index and the magic bytes. Events can therefore
+     * be written in any order and read by random access after mapping the file into memory.
+     */
+    class DepositReplayFormat {
+    public:
+        /// Magic bytes at the beginning and end of the file
+        static constexpr std::array<char, 8> magic{{'A', 'P', 'R', 'E', 'P', '\0', '\r', '\n'}};
+        /// Version of the file format
+        static constexpr std::uint32_t version = 1;
+        /// Byte order mark to detect files written on machines with different byte order
+        static constexpr std::uint32_t byte_order = 0x01020304;
+
+        /**
+         * @brief Entry of the index of event blocks
+         */
+        struct IndexEntry {
+            std::uint64_t event{};
+            std::uint64_t offset{};
+            std::uint64_t size{};
+        };
+        static_assert(std::is_trivially_copyable_v<IndexEntry>, "index entry has to be trivially copyable");
+
+        /**
+         * @brief Encode the records of an event into a block, independent of the file it is written to
+         * @param event Event number
+         * @param records Records of all detectors in the event
+         * @return Encoded event block
+         */
+        static std::string encodeEvent(std::uint64_t event, const std::vector<DepositReplayRecord>& records) {
+            std::string block;
+            append(block, event);
+            append(block, static_cast<std::uint32_t>(records.size()));
+            for(const auto& record : records) {
+                append(block, record.detector);
+                append(block, record.flags);
+                append(block, static_cast<std::uint32_t>(record.getParticleCount()));
+                append(block, static_cast<std::uint32_t>(record.getDepositCount()));
+
+                append_column(block, record.particle_local_start, 3 * record.getParticleCount());
+                append_column(block, record.particle_global_start, 3 * record.getParticleCount());
+                append_column(block, record.particle_local_end, 3 * record.getParticleCount());
+                append_column(block, record.particle_global_end, 3 * record.getParticleCount());
+                append_column(block, record.particle_id, record.getParticleCount());
+                append_column(block, record.particle_local_time, record.getParticleCount());
+                append_column(block, record.particle_global_time, record.getParticleCount());
+                append_column(block, record.particle_total_energy, record.getParticleCount());
+                append_column(block, record.particle_kinetic_energy, record.getParticleCount());
+                append_column(block, record.particle_charge, record.getParticleCount());
+                append_column(block, record.particle_parent, record.getParticleCount());
+
+                append_column(block, record.deposit_local_position, 3 * record.getDepositCount());
+                append_column(block, record.deposit_global_position, 3 * record.getDepositCount());
+                append_column(block, record.deposit_type, record.getDepositCount());
+                append_column(block, record.deposit_charge, record.getDepositCount());
+                append_column(block, record.deposit_local_time, record.getDepositCount());
+                append_column(block, record.deposit_global_time, record.getDepositCount());
+                append_column(block, record.deposit_particle, record.getDepositCount());
+            }
+            return block;
+        }
+
+        /**
+         * @brief Decode the records of an event from a block
+         * @param pos Begin of the event block
+         * @param end End of the event block
+         * @return Pair of the event number and the records of all detectors in the event
+         * @throws std::runtime_error If the block is truncated or inconsistent
+         */
+        static std::pair<std::uint64_t, std::vector<DepositReplayRecord>> decodeEvent(const char* pos, const char* end) {
+            auto event = read<std::uint64_t>(pos, end);
+            auto count = static_cast<size_t>(read<std::uint32_t>(pos, end));
+            if(count > static_cast<size_t>(end - pos)) {
+                throw std::runtime_error("unexpected end of data");
+            }
+            std::vector<DepositReplayRecord> records(count);
+            for(auto& record : records) {
+                record.detector = read<std::uint32_t>(pos, end);
+                record.flags = read<std::uint8_t>(pos, end);
+                auto particles = static_cast<size_t>(read<std::uint32_t>(pos, end));
+                auto deposits = static_cast<size_t>(read<std::uint32_t>(pos, end));
+
+                read_column(pos, end, record.particle_local_start, 3 * particles);
+                read_column(pos, end, record.particle_global_start, 3 * particles);
+                read_column(pos, end, record.particle_local_end, 3 * particles);
+                read_column(pos, end, record.particle_global_end, 3 * particles);
+                read_column(pos, end, record.particle_id, particles);
+                read_column(pos, end, record.particle_local_time, particles);
+                read_column(pos, end, record.particle_global_time, particles);
+                read_column(pos, end, record.particle_total_energy, particles);
+                read_column(pos, end, record.particle_kinetic_energy, particles);
+                read_column(pos, end, record.particle_charge, particles);
+                read_column(pos, end, record.particle_parent, particles);
+
+                read_column(pos, end, record.deposit_local_position, 3 * deposits);
+                read_column(pos, end, record.deposit_global_position, 3 * deposits);
+                read_column(pos, end, record.deposit_type, deposits);
+                read_column(pos, end, record.deposit_charge, deposits);
+                read_column(pos, end, record.deposit_local_time, deposits);
+                read_column(pos, end, record.deposit_global_time, deposits);
+                read_column(pos, end, record.deposit_particle, deposits);
+
+                // Relations have to point to particles of the same record
+                auto valid = [particles](std::int32_t index) {
+                    return index >= -1 && index < static_cast<std::int64_t>(particles);
+                };
+                if(!std::all_of(record.particle_parent.begin(), record.particle_parent.end(), valid) ||
+                   !std::all_of(record.deposit_particle.begin(), record.deposit_particle.end(), valid)) {
+                    throw std::runtime_error("invalid relation to Monte Carlo particle");
+                }
+            }
+            return {event, std::move(records)};
+        }
+
+        /**
+         * @brief Append a trivially copyable value to a buffer
+         */
+        template <typename T> static void append(std::string& buffer, const T& value) {
+            static_assert(std::is_trivially_copyable_v<T>, "only trivially copyable values can be stored");
+            buffer.append(reinterpret_cast<const char*>(&value), sizeof(T)); // NOLINT
+        }
+
+        /**
+         * @brief Read a trivially copyable value from a range of characters
+         * @throws std::runtime_error If the range is too short
+         */
+        template <typename T> static T read(const char*& pos, const char* end) {
+            static_assert(std::is_trivially_copyable_v<T>, "only trivially copyable values can be read");
+            if(static_cast<size_t>(end - pos) < sizeof(T)) {
+                throw std::runtime_error("unexpected end of data");
+            }
+            T value;
+            std::memcpy(&value, pos, sizeof(T));
+            pos += sizeof(T);
+            return value;
+        }
+
+    private:
+        template <typename T> static void append_column(std::string& buffer, const std::vector<T>& column, size_t size) {
+            if(column.size() != size) {
+                throw std::invalid_argument("column size does not match the number of objects");
+            }
+            buffer.append(reinterpret_cast<const char*>(column.data()), size * sizeof(T)); // NOLINT
+        }
+
+        template <typename T>
+        static void read_column(const char*& pos, const char* end, std::vector<T>& column, size_t size) {
+            if(static_cast<size_t>(end - pos) / sizeof(T) < size) {
+                throw std::runtime_error("unexpected end of data");
+            }
+            column.resize(size);
+            std::memcpy(column.data(), pos, size * sizeof(T));
+            pos += size * sizeof(T);
+        }
+    };
+
+    /**
+     * @brief Writer of deposit replay files
+     *
+     * Events are encoded by the caller with \ref DepositReplayFormat::encodeEvent, which can happen concurrently, and
+     * appended to the file in any order. The writer itself is not thread-safe.
+     */
+    class DepositReplayWriter {
+    public:
+        /**
+         * @brief Create a file and write its header
+         * @param path Path of the file
+         * @param detectors Names of the detectors, referred to by their index in the records
+         * @throws std::invalid_argument If the file cannot be written
+         */
+        DepositReplayWriter(const std::filesystem::path& path, const std::vector<std::string>& detectors)
+            : file_(path, std::ios::binary) {
+            std::string header(DepositReplayFormat::magic.begin(), DepositReplayFormat::magic.end());
+            DepositReplayFormat::append(header, DepositReplayFormat::version);
+            DepositReplayFormat::append(header, DepositReplayFormat::byte_order);
+            DepositReplayFormat::append(header, static_cast<std::uint32_t>(detectors.size()));
+            for(const auto& name : detectors) {
+                DepositReplayFormat::append(header, static_cast<std::uint32_t>(name.size()));
+                header += name;
+            }
+            write(header);
+        }
+
+        /**
+         * @brief Append an encoded event block to the file
+         * @param event Event number
+         * @param block Event block as returned by \ref DepositReplayFormat::encodeEvent
+         * @throws std::invalid_argument If the block cannot be written
+         */
+        void append(std::uint64_t event, const std::string& block) {
+            index_.push_back({event, offset_, block.size()});
+            write(block);
+        }
+
+        /**
+         * @brief Write the index of all events and close the file
+         * @return Number of events written
+         * @throws std::invalid_argument If the index cannot be written
+         */
+        size_t close() {
+            std::sort(index_.begin(), index_.end(), [](const auto& a, const auto& b) { return a.event < b.event; });
+            auto index_offset = offset_;
+            std::string index;
+            DepositReplayFormat::append(index, static_cast<std::uint64_t>(index_.size()));
+            for(const auto& entry : index_) {
+                DepositReplayFormat::append(index, entry);
+            }
+            DepositReplayFormat::append(index, index_offset);
+            index.append(DepositReplayFormat::magic.begin(), DepositReplayFormat::magic.end());
+            write(index);
+            file_.close();
+            return index_.size();
+        }
+
+        /**
+         * @brief Get the number of bytes written to the file
+         */
+        std::uint64_t getSize() const { return offset_; }
+
+    private:
+        void write(const std::string& data) {
+            file_.write(data.data(), static_cast<std::streamsize>(data.size()));
+            if(!file_) {
+                throw std::invalid_argument("file cannot be written");
+            }
+            offset_ += data.size();
+        }
+
+        std::ofstream file_;
+        std::uint64_t offset_{};
+        std::vector<DepositReplayFormat::IndexEntry> index_;
+    };
+
+    /**
+     * @brief Reader of deposit replay files, providing thread-safe random access to the events of a memory-mapped file
+     */
+    class DepositReplayReader {
+    public:
+        /**
+         * @brief Map a file into memory and read its header and index
+         * @param path Path of the file
+         * @throws std::runtime_error If the file cannot be mapped or is not a valid deposit replay file
+         */
+        explicit DepositReplayReader(const std::filesystem::path& path) : file_(path) {
+            const auto* begin = file_.data();
+            const auto* end = begin + file_.size();
+
+            // Read the header with the detector names
+            const auto* pos = begin;
+            check_magic(pos, end);
+            if(DepositReplayFormat::read<std::uint32_t>(pos, end) != DepositReplayFormat::version) {
+                throw std::runtime_error("unsupported version of the file format");
+            }
+            if(DepositReplayFormat::read<std::uint32_t>(pos, end) != DepositReplayFormat::byte_order) {
+                throw std::runtime_error("file has been written with different byte order");
+            }
+            detectors_.resize(DepositReplayFormat::read<std::uint32_t>(pos, end));
+            for(auto& name : detectors_) {
+                auto length = DepositReplayFormat::read<std::uint32_t>(pos, end);
+                if(static_cast<size_t>(end - pos) < length) {
+                    throw std::runtime_error("unexpected end of data");
+                }
+                name.assign(pos, length);
+                pos += length;
+            }
+            const auto* data_begin = pos;
+
+            // Read the index from the end of the file
+            constexpr auto trailer_size = sizeof(std::uint64_t) + DepositReplayFormat::magic.size();
+            if(file_.size() < trailer_size || static_cast<size_t>(end - data_begin) < trailer_size) {
+                throw std::runtime_error("file does not contain an index, it might not have been closed properly");
+            }
+            pos = end - trailer_size;
+            auto index_offset = DepositReplayFormat::read<std::uint64_t>(pos, end);
+            check_magic(pos, end);
+            if(index_offset < static_cast<std::uint64_t>(data_begin - begin) || index_offset > file_.size() - trailer_size) {
+                throw std::runtime_error("invalid offset of the index");
+            }
+            pos = begin + index_offset;
+            const auto* index_end = end - trailer_size;
+            auto events = DepositReplayFormat::read<std::uint64_t>(pos, index_end);
+            if(static_cast<size_t>(index_end - pos) / sizeof(DepositReplayFormat::IndexEntry) < events) {
+                throw std::runtime_error("index is truncated");
+            }
+            index_.resize(static_cast<size_t>(events));
+            for(auto& entry : index_) {
+                entry = DepositReplayFormat::read<DepositReplayFormat::IndexEntry>(pos, index_end);
+                if(entry.offset < static_cast<std::uint64_t>(data_begin - begin) || entry.offset > index_offset ||
+                   entry.size > index_offset - entry.offset) {
+                    throw std::runtime_error("invalid offset of event " + std::to_string(entry.event));
+                }
+            }
+        }
+
+        /**
+         * @brief Get the names of the detectors, referred to by their index in the records
+         */
+        const std::vector<std::string>& getDetectors() const { return detectors_; }
+
+        /**
+         * @brief Get the number of events stored in the file
+         */
+        size_t getEventCount() const { return index_.size(); }
+
+        /**
+         * @brief Get the event number of an event of the file
+         * @param index Position of the event in the file, ordered by event number
+         * @return Event number
+         */
+        std::uint64_t getEvent(size_t index) const { return index_.at(index).event; }
+
+        /**
+         * @brief Get the highest event number stored in the file, or zero for files without events
+         */
+        std::uint64_t getLastEvent() const { return index_.empty() ? 0 : index_.back().event; }
+
+        /**
+         * @brief Read the records of an event
+         * @param event Event number
+         * @return Records of all detectors in the event, empty if the event is not stored in the file
+         * @throws std::runtime_error If the event block is invalid
+         */
+        std::vector<DepositReplayRecord> read(std::uint64_t event) const {
+            auto entry = std::lower_bound(
+                index_.begin(), index_.end(), event, [](const auto& index, std::uint64_t ev) { return index.event < ev; });
+            if(entry == index_.end() || entry->event != event) {
+                return {};
+            }
+            const auto* pos = file_.data() + entry->offset;
+            auto [block_event, records] = DepositReplayFormat::decodeEvent(pos, pos + entry->size);
+            if(block_event != event) {
+                throw std::runtime_error("index does not match event block of event " + std::to_string(event));
+            }
+            for(const auto& record : records) {
+                if(record.detector >= detectors_.size()) {
+                    throw std::runtime_error("invalid detector index in event " + std::to_string(event));
+                }
+            }
+            return std::move(records);
+        }
+
+    private:
+        static void check_magic(const char*& pos, const char* end) {
+            if(static_cast<size_t>(end - pos) < DepositReplayFormat::magic.size() ||
+               !std::equal(DepositReplayFormat::magic.begin(), DepositReplayFormat::magic.end(), pos)) {
+                throw std::runtime_error("file is not a deposit replay file");
+            }
+            pos += DepositReplayFormat::magic.size();
+        }
+
+        MappedFile file_;
+        std::vector<std::string> detectors_;
+        std::vector<DepositReplayFormat::IndexEntry> index_;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_DEPOSIT_REPLAY_H */
@@ -0,0 +1,168 @@
+/**
+ * @file
+ * @brief Utility providing polynomial approximations of exponential, logarithm and power functions
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef ALLPIX_FAST_MATH_H
+#define ALLPIX_FAST_MATH_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+namespace allpix {
+    /**
+     * @brief Polynomial approximations of the transcendental functions evaluated by the physics models
+     *
+     * The approximations are based on the rational functions of the Cephes library, as also used by VDT. The argument is
+     * reduced to a small interval by splitting off a power of two, which is applied by manipulating the exponent bits of the
+     * result. The relative error is bounded by a few units in the last place over the full range of double precision, i.e.
+     * below 1e-15 for the exponential and logarithm. Powers are calculated as exp(y * log(x)), such that their relative
+     * error grows with the magnitude of y * log(x), and stays below 1e-13 for |y * log(x)| < 100.
+     *
+     * The functions do not branch, such that loops calling them can be vectorized by the compiler as long as floating point
+     * exceptions are not required to be preserved, i.e. with -fno-trapping-math. Denormal arguments and results are not
+     * supported, they are flushed to zero. The approximations are used by the physics models if the framework is built
+     * with ALLPIX_FAST_MATH, otherwise the functions of the standard library are called.
+     */
+    namespace fast_math {
+        /**
+         * @brief Approximation of the exponential function
+         * @param x Argument
+         * @return Approximated value of exp(x)
+         */
+        inline double exp_approx(double x) {
+            constexpr double limit = 708.;
+            auto initial = x;
+
+            // Reduce the argument to x - n * ln(2), with ln(2) split in two parts for precision. The integer n is rounded by
+            // adding 1.5 * 2^52, which leaves its value in the lowest bits of the mantissa.
+            constexpr double shift = 6755399441055744.;
+            auto shifted = std::min(std::max(1.4426950408889634073599 * x, -1022.), 1023.) + shift;
+            auto n = shifted - shift;
+            x -= n * 6.93145751953125e-1;
+            x -= n * 1.42860682030941723212e-6;
+
+            auto xx = x * x;
+            auto px = ((1.26177193074810590878e-4 * xx + 3.02994407707441961300e-2) * xx + 9.99999999999999999910e-1) * x;
+            auto qx = ((3.00198505138664455042e-6 * xx + 2.52448340349684104192e-3) * xx + 2.27265548208155028766e-1) * xx +
+                      2.00000000000000000009e0;
+            auto result = 1. + 2. * px / (qx - px);
+
+            // Multiply by 2^n, built from the exponent bits
+            std::uint64_t bits;
+            std::memcpy(&bits, &shifted, sizeof(bits));
+            bits = (bits + 1023) << 52;
+            double power;
+            std::memcpy(&power, &bits, sizeof(power));
+            result *= power;
+
+            result = (initial > limit ? std::numeric_limits<double>::infinity() : result);
+            return (initial < -limit ? 0. : result);
+        }
+
+        /**
+         * @brief Approximation of the natural logarithm
+         * @param x Argument
+         * @return Approximated value of log(x), NaN for negative arguments and -inf for zero
+         */
+        inline double log_approx(double x) {
+            auto initial = x;
+
+            // Split into mantissa in [0.5, 1) and exponent
+            std::uint64_t bits;
+            std::memcpy(&bits, &x, sizeof(bits));
+            // The exponent bits are converted to a floating point number by inserting them into the mantissa of 2^52
+            std::uint64_t exponent_bits = ((bits >> 52) & 0x7FF) | 0x4330000000000000ULL;
+            double exponent;
+            std::memcpy(&exponent, &exponent_bits, sizeof(exponent));
+            exponent -= 4503599627370496. + 1022.;
+            bits = (bits & 0x800FFFFFFFFFFFFFULL) | 0x3FE0000000000000ULL;
+            std::memcpy(&x, &bits, sizeof(x));
+
+            // Move the mantissa to [sqrt(0.5), sqrt(2)) and subtract one
+            auto below = (x < 0.70710678118654752440);
+            exponent -= (below ? 1. : 0.);
+            x = (below ? x + x : x) - 1.;
+
+            auto xx = x * x;
+            auto px = ((((1.01875663804580931796e-4 * x + 4.97494994976747001425e-1) * x + 4.70579119878881725854e0) * x +
+                        1.44989225341610930846e1) *
+                           x +
+                       1.79368678507819816313e1) *
+                          x +
+                      7.70838733755885391666e0;
+            auto qx = ((((x + 1.12873587189167450590e1) * x + 4.52279145837532221105e1) * x + 8.29875266912776603211e1) * x +
+                       7.11544750618563894466e1) *
+                          x +
+                      2.31251620126765340583e1;
+            auto result = px / qx * xx * x;
+            result += exponent * -2.121944400546905827679e-4;
+            result += -0.5 * xx;
+            result = x + result;
+            result += exponent * 0.693359375;
+
+            result = (initial > std::numeric_limits<double>::max() ? initial : result);
+            result = (initial < std::numeric_limits<double>::min() ? -std::numeric_limits<double>::infinity() : result);
+            return (initial >= 0. ? result : std::numeric_limits<double>::quiet_NaN());
+        }
+
+        /**
+         * @brief Approximation of the power function for positive bases
+         * @param x Base, has to be positive
+         * @param y Exponent
+         * @return Approximated value of pow(x, y)
+         */
+        inline double pow_approx(double x, double y) { return exp_approx(y * log_approx(x)); }
+
+        /**
+         * @brief Exponential function used by the physics models
+         * @param x Argument
+         * @return Value of exp(x)
+         */
+        inline double exp(double x) {
+#ifdef ALLPIX_FAST_MATH
+            return exp_approx(x);
+#else
+            return std::exp(x);
+#endif
+        }
+
+        /**
+         * @brief Natural logarithm used by the physics models
+         * @param x Argument
+         * @return Value of log(x)
+         */
+        inline double log(double x) {
+#ifdef ALLPIX_FAST_MATH
+            return log_approx(x);
+#else
+            return std::log(x);
+#endif
+        }
+
+        /**
+         * @brief Power function for positive bases used by the physics models
+         * @param x Base, has to be positive
+         * @param y Exponent
+         * @return Value of pow(x, y)
+         */
+        inline double pow(double x, double y) {
+#ifdef ALLPIX_FAST_MATH
+            return pow_approx(x, y);
+#else
+            return std::pow(x, y);
+#endif
+        }
+    } // namespace fast_math
+} // namespace allpix
+
+#endif /* ALLPIX_FAST_MATH_H */
@@ -0,0 +1,131 @@
+/**
+ * @file
+ * @brief Utility to convolve sampled signals with a fixed kernel using the fast Fourier transform
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef ALLPIX_FFT_CONVOLUTION_H
+#define ALLPIX_FFT_CONVOLUTION_H
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace allpix {
+    /**
+     * @brief Class to convolve signals with a fixed kernel using the overlap-add method
+     *
+     * The kernel is transformed once when constructing the object. Signals are split into blocks which are convolved with
+     * the kernel through a radix-2 fast Fourier transform of twice the kernel length, and the results of the blocks are
+     * added up. The convolution of a signal of length N with a kernel of length M therefore requires O(N log M) operations
+     * instead of O(N M) for the direct summation. The result agrees with the direct summation up to rounding errors.
+     */
+    class FFTConvolution {
+    public:
+        /**
+         * @brief Construct an empty convolution, to be assigned before use
+         */
+        FFTConvolution() = default;
+
+        /**
+         * @brief Prepare the convolution with a kernel
+         * @param kernel Samples of the kernel, at least one sample is required
+         */
+        explicit FFTConvolution(const std::vector<double>& kernel) {
+            size_ = 1;
+            while(size_ < 2 * std::max<size_t>(kernel.size(), 1)) {
+                size_ *= 2;
+            }
+            block_ = size_ - std::max<size_t>(kernel.size(), 1) + 1;
+
+            // Twiddle factors of the transform, the inverse transform uses their complex conjugates
+            twiddles_.resize(size_ / 2);
+            for(size_t i = 0; i < twiddles_.size(); ++i) {
+                twiddles_[i] = std::polar(1., -2. * M_PI * static_cast<double>(i) / static_cast<double>(size_));
+            }
+
+            kernel_.assign(size_, 0.);
+            std::copy(kernel.begin(), kernel.end(), kernel_.begin());
+            transform(kernel_, false);
+        }
+
+        /**
+         * @brief Convolve a signal with the kernel
+         * @param signal Samples of the signal
+         * @param count  Number of samples of the result to compute, starting at the first sample of the signal
+         * @return Samples of the convolution of the signal with the kernel
+         */
+        std::vector<double> operator()(const std::vector<double>& signal, size_t count) const {
+            std::vector<double> result(count, 0.);
+            std::vector<std::complex<double>> buffer(size_);
+
+            // Samples of the signal beyond the requested range do not contribute
+            auto length = std::min(signal.size(), count);
+            for(size_t start = 0; start < length; start += block_) {
+                auto end = std::min(start + block_, length);
+                std::fill(buffer.begin(), buffer.end(), 0.);
+                std::copy(signal.begin() + static_cast<std::ptrdiff_t>(start),
+                          signal.begin() + static_cast<std::ptrdiff_t>(end),
+                          buffer.begin());
+
+                transform(buffer, false);
+                for(size_t i = 0; i < size_; ++i) {
+                    buffer[i] *= kernel_[i];
+                }
+                transform(buffer, true);
+
+                // The linear convolution of the block fits into the transform without wrapping around
+                for(size_t i = 0; i < size_ && start + i < count; ++i) {
+                    result[start + i] += buffer[i].real() / static_cast<double>(size_);
+                }
+            }
+            return result;
+        }
+
+    private:
+        /**
+         * @brief Iterative in-place radix-2 transform, the inverse transform is not normalized
+         */
+        void transform(std::vector<std::complex<double>>& data, bool inverse) const {
+            // Reorder the samples by bit-reversed index
+            for(size_t i = 1, j = 0; i < size_; ++i) {
+                auto bit = size_ >> 1;
+                for(; (j & bit) != 0; bit >>= 1) {
+                    j ^= bit;
+                }
+                j ^= bit;
+                if(i < j) {
+                    std::swap(data[i], data[j]);
+                }
+            }
+
+            // Combine the transforms of increasing length
+            for(size_t length = 2; length <= size_; length *= 2) {
+                auto stride = size_ / length;
+                for(size_t first = 0; first < size_; first += length) {
+                    for(size_t i = 0; i < length / 2; ++i) {
+                        auto twiddle = (inverse ? std::conj(twiddles_[i * stride]) : twiddles_[i * stride]);
+                        auto odd = data[first + i + length / 2] * twiddle;
+                        data[first + i + length / 2] = data[first + i] - odd;
+                        data[first + i] += odd;
+                    }
+                }
+            }
+        }
+
+        size_t size_{1};
+        size_t block_{1};
+        std::vector<std::complex<double>> twiddles_;
+        std::vector<std::complex<double>> kernel_;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_FFT_CONVOLUTION_H */
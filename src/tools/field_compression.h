@@ -0,0 +1,182 @@
+/**
+ * @file
+ * @brief Utility to losslessly compress and decompress blocks of field values
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef ALLPIX_FIELD_COMPRESSION_H
+#define ALLPIX_FIELD_COMPRESSION_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace allpix {
+
+    /**
+     * @brief Unsigned integer type with the size of a floating-point field value
+     */
+    template <typename T>
+    using field_value_bits = std::conditional_t<sizeof(T) == sizeof(std::uint64_t), std::uint64_t, std::uint32_t>;
+
+    /**
+     * @brief Predict the bit pattern of a field value by linear extrapolation from the same component at the two previous
+     * grid points
+     * @param values Pointer to the first value
+     * @param index  Index of the value to be predicted
+     * @param stride Distance between consecutive values of the same field component
+     * @return Predicted bit pattern
+     */
+    template <typename T> field_value_bits<T> predict_field_value(const T* values, size_t index, size_t stride) {
+        field_value_bits<T> previous = 0, before = 0;
+        if(index >= stride) {
+            std::memcpy(&previous, &values[index - stride], sizeof(previous));
+        }
+        if(index >= 2 * stride) {
+            std::memcpy(&before, &values[index - 2 * stride], sizeof(before));
+            return 2 * previous - before;
+        }
+        return previous;
+    }
+
+    /**
+     * @brief Get the position of the first value of every field component when ordering values by component
+     * @param count  Number of values
+     * @param stride Distance between consecutive values of the same field component
+     * @return Position of the first value of each component
+     */
+    inline std::vector<size_t> field_component_offsets(size_t count, size_t stride) {
+        std::vector<size_t> offsets(stride, 0);
+        for(size_t component = 1; component < stride; ++component) {
+            offsets[component] = offsets[component - 1] + (count + stride - component) / stride;
+        }
+        return offsets;
+    }
+
+    /**
+     * @brief Compress a block of floating-point field values
+     * @param values Pointer to the first value
+     * @param count  Number of values
+     * @param stride Distance between consecutive values of the same field component
+     * @return Compressed bytes
+     *
+     * The bit pattern of every value is predicted from the same component at the previous grid points, and only the
+     * difference to the prediction is stored with its sign in the lowest bit, which leaves mostly zero high bits for smooth
+     * or uniform fields. The resulting words are split into byte planes ordered by field component, such that the zero high
+     * bytes follow each other, and the planes are run-length encoded. Each control byte below 128 is followed by that
+     * number plus one literal bytes, each control byte from 128 is followed by a single byte repeated that number minus 125
+     * times. The compression is lossless.
+     */
+    template <typename T> std::vector<char> compress_field_values(const T* values, size_t count, size_t stride) {
+        using U = field_value_bits<T>;
+        static_assert(sizeof(U) == sizeof(T), "field values have to be of 32 or 64 bit size");
+
+        // Decorrelate the values and split them into byte planes
+        std::vector<unsigned char> planes(count * sizeof(U));
+        auto offsets = field_component_offsets(count, stride);
+        for(size_t i = 0; i < count; ++i) {
+            U bits = 0;
+            std::memcpy(&bits, &values[i], sizeof(U));
+            U residual = bits - predict_field_value(values, i, stride);
+            U word = (residual << 1U) ^ (0U - (residual >> (8 * sizeof(U) - 1)));
+            for(size_t byte = 0; byte < sizeof(U); ++byte) {
+                planes[byte * count + offsets[i % stride] + i / stride] = static_cast<unsigned char>(word >> (8 * byte));
+            }
+        }
+
+        // Run-length encode the byte planes
+        std::vector<char> output;
+        size_t literal_start = 0;
+        auto flush_literals = [&](size_t end) {
+            while(literal_start < end) {
+                auto length = std::min<size_t>(end - literal_start, 128);
+                output.push_back(static_cast<char>(length - 1));
+                output.insert(output.end(), planes.begin() + static_cast<std::ptrdiff_t>(literal_start),
+                              planes.begin() + static_cast<std::ptrdiff_t>(literal_start + length));
+                literal_start += length;
+            }
+        };
+        size_t pos = 0;
+        while(pos < planes.size()) {
+            size_t run = 1;
+            while(pos + run < planes.size() && planes[pos + run] == planes[pos] && run < 130) {
+                ++run;
+            }
+            if(run >= 3) {
+                flush_literals(pos);
+                output.push_back(static_cast<char>(run + 125));
+                output.push_back(static_cast<char>(planes[pos]));
+                pos += run;
+                literal_start = pos;
+            } else {
+                pos += run;
+            }
+        }
+        flush_literals(planes.size());
+        return output;
+    }
+
+    /**
+     * @brief Decompress a block of floating-point field values compressed with \ref compress_field_values
+     * @param data   Pointer to the compressed bytes
+     * @param size   Number of compressed bytes
+     * @param values Pointer to the storage for the decompressed values
+     * @param count  Number of values
+     * @param stride Distance between consecutive values of the same field component
+     * @throws std::runtime_error if the compressed data is corrupted
+     */
+    template <typename T>
+    void decompress_field_values(const char* data, size_t size, T* values, size_t count, size_t stride) {
+        using U = field_value_bits<T>;
+        static_assert(sizeof(U) == sizeof(T), "field values have to be of 32 or 64 bit size");
+
+        // Decode the byte planes
+        std::vector<unsigned char> planes(count * sizeof(U));
+        size_t pos = 0, out = 0;
+        while(pos < size) {
+            auto control = static_cast<unsigned char>(data[pos++]);
+            if(control < 128) {
+                size_t length = control + 1U;
+                if(pos + length > size || out + length > planes.size()) {
+                    throw std::runtime_error("corrupted compressed field data");
+                }
+                std::memcpy(&planes[out], data + pos, length);
+                pos += length;
+                out += length;
+            } else {
+                size_t length = control - 125U;
+                if(pos >= size || out + length > planes.size()) {
+                    throw std::runtime_error("corrupted compressed field data");
+                }
+                std::memset(&planes[out], data[pos++], length);
+                out += length;
+            }
+        }
+        if(out != planes.size()) {
+            throw std::runtime_error("corrupted compressed field data");
+        }
+
+        // Merge the byte planes and undo the prediction
+        auto offsets = field_component_offsets(count, stride);
+        for(size_t i = 0; i < count; ++i) {
+            U word = 0;
+            for(size_t byte = 0; byte < sizeof(U); ++byte) {
+                word |= static_cast<U>(planes[byte * count + offsets[i % stride] + i / stride]) << (8 * byte);
+            }
+            U residual = (word >> 1U) ^ (0U - (word & 1U));
+            U bits = residual + predict_field_value(values, i, stride);
+            std::memcpy(&values[i], &bits, sizeof(U));
+        }
+    }
+} // namespace allpix
+
+#endif /* ALLPIX_FIELD_COMPRESSION_H */
@@ -13,14 +13,30 @@
 #define ALLPIX_FIELD_PARSER_H
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <charconv>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <future>
+#include <iomanip>
 #include <iostream>
 #include <map>
+#include <mutex>
+#include <sstream>
+#include <string_view>
+#include <thread>
+#include <type_traits>
 
 #include "core/utils/log.h"
+#include "core/utils/shared_array.h"
 #include "core/utils/unit.h"
+#include "tools/field_compression.h"
+#include "tools/mapped_file.h"
 
 #include <cereal/archives/portable_binary.hpp>
 
@@ -33,6 +49,9 @@
 // Mime type version for APF files
 #define APF_MIME_TYPE_VERSION 1
 
+// Format version for APF v2 files
+#define APF2_FORMAT_VERSION 2
+
 namespace allpix {
 
     /**
@@ -51,11 +70,41 @@ namespace allpix {
         UNKNOWN = 0, ///< Unknown file format
         INIT,        ///< Legacy file format, values stored in plain-text ASCII
         APF,         ///< Binary Allpix Squared format serialized using the cereal library
+        APF2,        ///< Binary Allpix Squared format version 2 with fixed header and raw payload which can be memory-mapped
+        APFZ,        ///< Compressed Allpix Squared format with APF v2 header and independently decodable chunks of values
     };
 
+    /**
+     * @brief Fixed-size header at the beginning of APF v2 files
+     *
+     * The header is followed by the human readable header string of the field data and by padding up to the data offset,
+     * which is a multiple of the page size. Starting at the data offset, the field values are stored as raw flat array in
+     * native byte order, such that they can be memory-mapped without any conversion.
+     *
+     * Compressed files use the same header with different magic bytes. Their payload at the data offset starts with the
+     * number of values per chunk and the number of chunks, followed by the offsets of all chunks and of the end of the last
+     * chunk relative to the data offset, and the chunks compressed with \ref compress_field_values.
+     */
+    struct APF2Header {
+        std::array<char, 8> magic{{'A', 'P', 'F', '2', '\0', '\r', '\n', '\0'}}; ///< Magic bytes identifying the format
+        std::uint32_t version{APF2_FORMAT_VERSION};                         ///< Format version, also detects byte order
+        std::uint32_t value_size{};                                         ///< Size of a single value in bytes
+        std::uint64_t components{};                                         ///< Number of values per field point
+        std::array<std::uint64_t, 3> dimensions{};                          ///< Number of bins in each dimension
+        std::array<double, 3> size{};                                       ///< Physical extent in internal units
+        std::uint64_t header_length{};                                      ///< Length of the header string
+        std::uint64_t data_offset{};                                        ///< Offset of the values from the file start
+
+        /// Alignment of the data offset, matching the common page size
+        static constexpr std::uint64_t alignment = 4096;
+        /// Magic bytes identifying compressed files
+        static constexpr std::array<char, 8> compressed_magic{{'A', 'P', 'F', 'Z', '\0', '\r', '\n', '\0'}};
+    };
+    static_assert(std::is_trivially_copyable_v<APF2Header>, "APF v2 header has to be trivially copyable");
+
     /**
      * Class to hold raw, three-dimensional field data with N components, containing
-     * * The actual field data as shared pointer to vector
+     * * The actual field data as shared pointer to vector, or as shared array viewing e.g. a memory-mapped file
      * * An array specifying the number of bins in each dimension
      * * An array containing the physical extent of the field in each dimension, as specified in the file
      */
@@ -75,10 +124,20 @@ namespace allpix {
          */
         FieldData(std::string header,
                   std::array<size_t, 3> dimensions,
-                  std::array<T, 3> size,
+                  std::array<double, 3> size,
                   std::shared_ptr<std::vector<T>> data)
             : header_(std::move(header)), dimensions_(dimensions), size_(size), data_(std::move(data)){};
 
+        /**
+         * @brief Constructor for field data held in storage other than a vector, such as a memory-mapped file
+         * @param header     Human readable header string to identify file content, program version used for generation etc.
+         * @param dimensions Number of bins of the field in each coordinate
+         * @param size       Physical extent of the field in each dimension, given in internal units
+         * @param values     Shared array of the flat field data
+         */
+        FieldData(std::string header, std::array<size_t, 3> dimensions, std::array<double, 3> size, SharedArray<T> values)
+            : header_(std::move(header)), dimensions_(dimensions), size_(size), values_(std::move(values)){};
+
         /**
          * @brief Function to obtain the header (human readbale content description) of the field data
          * @return header string
@@ -95,14 +154,20 @@ namespace allpix {
          * @brief Member to get the physical extent of the field in each dimension as parsed from the input in internal units
          * @return array with physical size in x, y and z
          */
-        std::array<T, 3> getSize() const { return size_; }
+        std::array<double, 3> getSize() const { return size_; }
 
         /**
          * @brief Member to access the actual field data
-         * @return shared pointer to the flat vector of field data
+         * @return shared pointer to the flat vector of field data, null if the data is not held in a vector
          */
         std::shared_ptr<std::vector<T>> getData() const { return data_; }
 
+        /**
+         * @brief Member to access the actual field data independent of its storage
+         * @return shared array of the flat field data
+         */
+        SharedArray<T> getValues() const { return data_ != nullptr ? SharedArray<T>(data_) : values_; }
+
         /**
          * @brief get the dimensionality of the configured field in the x-y plane, e.g whether it is defined in 1D, 2D or 3D.
          * @return Dimensionality of the field
@@ -117,8 +182,9 @@ namespace allpix {
     private:
         std::string header_;
         std::array<size_t, 3> dimensions_{};
-        std::array<T, 3> size_{};
+        std::array<double, 3> size_{};
         std::shared_ptr<std::vector<T>> data_;
+        SharedArray<T> values_;
 
         friend class cereal::access;
 
@@ -155,12 +221,16 @@ namespace cereal::detail {
 
 namespace allpix {
 
+    template <typename T> class FieldWriter;
+
     /**
      * @brief Class to parse Allpix Squared field data from files
      *
      * This class can be used to deserialize and parse FieldData objects from files of different format. The FieldData
      * objects read from file are cached, and a cache hit will be returned when trying to re-read a file with the same
-     * canonical path.
+     * canonical path. Parsers with single precision (float) convert the field values while reading the file, such that only
+     * the single precision values are kept in memory. Optionally, the values of APF v2 files of matching precision are
+     * memory-mapped read-only instead of being read, such that all processes reading the same file share its pages.
      */
     template <typename T = double> class FieldParser {
     public:
@@ -168,36 +238,77 @@ namespace allpix {
          * Construct a FieldParser
          * @param quantity Quantity of individual field points, vector (three values per point) or scalar (one value per
          * point)
+         * @param map_files Memory-map the values of APF v2 files instead of reading them where possible
          */
-        explicit FieldParser(const FieldQuantity quantity)
-            : N_(static_cast<std::underlying_type<FieldQuantity>::type>(quantity)){};
+        explicit FieldParser(const FieldQuantity quantity, bool map_files = false)
+            : N_(static_cast<std::underlying_type<FieldQuantity>::type>(quantity)), map_files_(map_files){};
         ~FieldParser() = default;
 
         /**
          * @brief Parse a file and retrieve the field data.
          * @param file_name  File name (as canonical path) of the input file to be parsed
          * @param units      Optional units to convert the field from after reading from file. Only used by some formats.
+         * @param cache_directory Optional directory to cache the parsed field in, in APF v2 format
          * @return           Field data object read from file or internal cache
          *
          * @throws std::runtime_error if the file format is unknown or invalid field dimensions are detected
          * @throws std::filesystem::filesystem_error if the provided path does not exist
          *
-         * The type of the field data file to be read is deducted automatically from the file content
+         * The type of the field data file to be read is deducted automatically from the file content. If a cache directory
+         * is given, the parsed field is stored there and files with identical content parsed with the same units and
+         * precision are read from the cache directory in later runs instead.
          */
-        FieldData<T> getByFileName(const std::filesystem::path& file_name, const std::string& units = std::string()) {
+        FieldData<T> getByFileName(const std::filesystem::path& file_name,
+                                   const std::string& units = std::string(),
+                                   const std::filesystem::path& cache_directory = std::filesystem::path()) {
 
             auto path = std::filesystem::canonical(file_name);
 
-            // Search in cache
-            auto iter = field_map_.find(path);
-            if(iter != field_map_.end()) {
+            // Search in cache, files requested concurrently are only parsed by the first caller
+            std::promise<FieldData<T>> promise;
+            std::shared_future<FieldData<T>> cached;
+            {
+                std::lock_guard<std::mutex> lock{field_map_mutex_};
+                auto iter = field_map_.find(path);
+                if(iter != field_map_.end()) {
+                    cached = iter->second;
+                } else {
+                    field_map_.emplace(path, promise.get_future().share());
+                }
+            }
+            if(cached.valid()) {
                 LOG(INFO) << "Using cached field data";
-                return iter->second;
+                return cached.get();
+            }
+
+            try {
+                auto field_data = (cache_directory.empty() ? parse_file(path, units)
+                                                           : parse_cached_file(path, units, cache_directory));
+                promise.set_value(field_data);
+                return field_data;
+            } catch(...) {
+                // Do not cache failures, such that waiting callers receive the error but later requests retry
+                promise.set_exception(std::current_exception());
+                std::lock_guard<std::mutex> lock{field_map_mutex_};
+                field_map_.erase(path);
+                throw;
             }
+        }
+
+    private:
+        /**
+         * @brief Parse a file of automatically deduced format
+         * @param path Canonical path of the file
+         * @param units Optional units to convert the field from after reading from file
+         * @return Field data object read from file
+         */
+        FieldData<T> parse_file(const std::filesystem::path& path, const std::string& units) {
 
             // Deduce the file format
             auto file_type = guess_file_type(path);
-            LOG(DEBUG) << "Assuming file type \"" << (file_type == FileType::APF ? "APF" : "INIT") << "\"";
+            static const std::map<FileType, std::string> file_type_names{
+                {FileType::INIT, "INIT"}, {FileType::APF, "APF"}, {FileType::APF2, "APF2"}, {FileType::APFZ, "APFZ"}};
+            LOG(DEBUG) << "Assuming file type \"" << file_type_names.at(file_type) << "\"";
 
             FieldData<T> field_data;
             switch(file_type) {
@@ -214,16 +325,88 @@ namespace allpix {
                 }
                 field_data = parse_apf_file(path);
                 break;
+            case FileType::APF2:
+                if(!units.empty()) {
+                    LOG(DEBUG) << "Units will be ignored, APF2 file content is interpreted in internal units.";
+                }
+                field_data = parse_apf2_file(path);
+                break;
+            case FileType::APFZ:
+                if(!units.empty()) {
+                    LOG(DEBUG) << "Units will be ignored, APFZ file content is interpreted in internal units.";
+                }
+                field_data = parse_apfz_file(path);
+                break;
             default:
                 throw std::runtime_error("unknown file format");
             }
 
-            // Store the parsed field data for further reference:
-            field_map_[path] = field_data;
             return field_data;
         }
 
-    private:
+        /**
+         * @brief Parse a file through a cache directory holding previously parsed fields in APF v2 format
+         * @param path Canonical path of the file
+         * @param units Optional units to convert the field from after reading from file
+         * @param cache_directory Directory to look up and store the parsed field in
+         * @return Field data object read from the cache directory or from file
+         *
+         * Fields are cached under a key combining the hash of the file content, the units, the number of components and
+         * the precision of the parser. Cache files are written to a temporary file first and renamed, such that concurrent
+         * processes never read incomplete files. Failures to write the cache are not fatal.
+         */
+        FieldData<T> parse_cached_file(const std::filesystem::path& path,
+                                       const std::string& units,
+                                       const std::filesystem::path& cache_directory) {
+            if(guess_file_type(path) == FileType::APF2) {
+                LOG(DEBUG) << "Field file is stored in APF2 format, caching not required";
+                return parse_file(path, units);
+            }
+
+            // Look up the field in the cache directory
+            auto cache_file = cache_directory / ("field_" + cache_key(path, units) + ".apf2");
+            if(std::filesystem::exists(cache_file)) {
+                try {
+                    auto field_data = parse_apf2_file(cache_file);
+                    LOG(INFO) << "Using field data cached in " << cache_file;
+                    return field_data;
+                } catch(std::runtime_error& e) {
+                    LOG(WARNING) << "Ignoring invalid cache file " << cache_file << ": " << e.what();
+                }
+            }
+
+            auto field_data = parse_file(path, units);
+            try {
+                std::filesystem::create_directories(cache_directory);
+                auto temporary_file = cache_file;
+                temporary_file += ".tmp" + std::to_string(::getpid());
+                FieldWriter<T>(static_cast<FieldQuantity>(N_)).writeFile(field_data, temporary_file, FileType::APF2);
+                std::filesystem::rename(temporary_file, cache_file);
+                LOG(INFO) << "Cached field data in " << cache_file;
+            } catch(std::exception& e) {
+                LOG(WARNING) << "Could not cache field data: " << e.what();
+            }
+            return field_data;
+        }
+
+        /**
+         * @brief Compute the key of a field in the cache directory
+         * @param path Canonical path of the file
+         * @param units Units to convert the field from after reading from file
+         * @return Hexadecimal key of the field
+         */
+        std::string cache_key(const std::filesystem::path& path, const std::string& units) const {
+            MappedFile mapping(path);
+            auto hash = std::hash<std::string_view>()(std::string_view(mapping.data(), mapping.size()));
+            auto settings = std::hash<std::string>()(units + "/" + std::to_string(N_) + "/" + std::to_string(sizeof(T)) +
+                                                     "/" + std::to_string(APF2_FORMAT_VERSION));
+            hash ^= settings + 0x9e3779b97f4a7c15 + (hash << 6) + (hash >> 2);
+
+            std::ostringstream key;
+            key << std::hex << std::setw(16) << std::setfill('0') << hash;
+            return key.str();
+        }
+
         /**
          * @brief Check if the file is a binary file
          * @param path The path to the file to be checked check
@@ -247,9 +430,20 @@ namespace allpix {
          * @param path Path to the file to be tested
          * @return Type of the file
          *
-         * This function checks if the file contains binary data to interpret it as APF formator INIT format otherwise.
+         * This function checks for the magic bytes of the APF v2 and compressed formats first, and otherwise if the file
+         * contains binary data to interpret it as APF format or INIT format otherwise.
          */
         FileType guess_file_type(const std::filesystem::path& path) const {
+            std::ifstream file(path, std::ios::binary);
+            std::array<char, 8> magic{};
+            if(file.read(magic.data(), magic.size())) {
+                if(magic == APF2Header().magic) {
+                    return FileType::APF2;
+                }
+                if(magic == APF2Header::compressed_magic) {
+                    return FileType::APFZ;
+                }
+            }
             return (file_is_binary(path) ? FileType::APF : FileType::INIT);
         }
 
@@ -261,7 +455,7 @@ namespace allpix {
          */
         FieldData<T> parse_apf_file(const std::filesystem::path& file_name) {
             std::ifstream file(file_name, std::ios::binary);
-            FieldData<T> field_data;
+            FieldData<double> field_data;
 
             // Parse the file with cereal, scope ensures flushing:
             try {
@@ -277,7 +471,216 @@ namespace allpix {
                 throw std::runtime_error("invalid data");
             }
 
-            return field_data;
+            // APF files always store double precision, convert if a different precision is requested
+            if constexpr(std::is_same_v<T, double>) {
+                return field_data;
+            } else {
+                auto data = field_data.getData();
+                auto field = std::make_shared<std::vector<T>>(data->begin(), data->end());
+                return FieldData<T>(field_data.getHeader(), dimensions, field_data.getSize(), std::move(field));
+            }
+        }
+
+        /**
+         * @brief Function to read FieldData from an APF v2 file. This does not convert any units, i.e. all values stored in
+         * APF v2 files are given in framework-internal base units. If mapping is enabled and the values are stored with the
+         * precision of this parser, the file is memory-mapped read-only and the field data views the mapped values directly.
+         * @param file_name  File name (as canonical path) of the input file to be parsed
+         */
+        FieldData<T> parse_apf2_file(const std::filesystem::path& file_name) {
+            std::ifstream file(file_name, std::ios::binary);
+            std::string header_string;
+            auto header = read_apf2_header(file, header_string);
+
+            std::array<size_t, 3> dimensions{};
+            std::copy(header.dimensions.begin(), header.dimensions.end(), dimensions.begin());
+            auto count = static_cast<size_t>(header.dimensions[0] * header.dimensions[1] * header.dimensions[2] * N_);
+
+            // Check that the file holds all values
+            auto file_size = std::filesystem::file_size(file_name);
+            if(!file || header.data_offset < sizeof(header) + header.header_length ||
+               file_size < header.data_offset + count * header.value_size) {
+                throw std::runtime_error("unexpected end of file");
+            }
+
+            if(map_files_ && header.value_size == sizeof(T)) {
+                try {
+                    auto mapping = std::make_shared<const MappedFile>(file_name);
+                    LOG(DEBUG) << "Mapped " << count << " values into memory";
+                    const auto* values = reinterpret_cast<const T*>(mapping->data() + header.data_offset); // NOLINT
+                    return FieldData<T>(
+                        header_string, dimensions, header.size, SharedArray<T>(std::move(mapping), values, count));
+                } catch(std::runtime_error& e) {
+                    LOG(WARNING) << "Could not map file, reading it instead: " << e.what();
+                }
+            }
+
+            // Read the values, converting them if stored with a different precision
+            file.seekg(static_cast<std::streamoff>(header.data_offset));
+            auto field = (header.value_size == sizeof(float) ? read_values<float>(file, count)
+                                                             : read_values<double>(file, count));
+            if(!file) {
+                throw std::runtime_error("unexpected end of file");
+            }
+            return FieldData<T>(header_string, dimensions, header.size, std::move(field));
+        }
+
+        /**
+         * @brief Function to read FieldData from a compressed APFZ file. This does not convert any units, i.e. all values
+         * stored in APFZ files are given in framework-internal base units. The chunks are read and decompressed in parallel
+         * by multiple threads, each streaming its chunks from the file directly into the field.
+         * @param file_name  File name (as canonical path) of the input file to be parsed
+         */
+        FieldData<T> parse_apfz_file(const std::filesystem::path& file_name) {
+            std::ifstream file(file_name, std::ios::binary);
+            std::string header_string;
+            auto header = read_apf2_header(file, header_string);
+
+            std::array<size_t, 3> dimensions{};
+            std::copy(header.dimensions.begin(), header.dimensions.end(), dimensions.begin());
+            auto count = static_cast<size_t>(header.dimensions[0] * header.dimensions[1] * header.dimensions[2] * N_);
+
+            // Read the chunk index
+            std::array<std::uint64_t, 2> chunking{};
+            file.seekg(static_cast<std::streamoff>(header.data_offset));
+            file.read(reinterpret_cast<char*>(chunking.data()), sizeof(chunking)); // NOLINT
+            auto [chunk_values, chunk_count] = chunking;
+            if(!file || chunk_values == 0 || chunk_count != (count + chunk_values - 1) / chunk_values) {
+                throw std::runtime_error("invalid chunk index");
+            }
+            std::vector<std::uint64_t> offsets(chunk_count + 1);
+            file.read(reinterpret_cast<char*>(offsets.data()), // NOLINT
+                      static_cast<std::streamsize>(offsets.size() * sizeof(std::uint64_t)));
+            auto file_size = std::filesystem::file_size(file_name);
+            if(!file || !std::is_sorted(offsets.begin(), offsets.end()) ||
+               file_size < header.data_offset + offsets.back()) {
+                throw std::runtime_error("invalid chunk index");
+            }
+
+            auto field = std::make_shared<std::vector<T>>(count);
+            auto decode = [&](auto tag, std::ifstream& stream, size_t chunk, std::vector<char>& buffer) {
+                using S = decltype(tag);
+                auto first = chunk * chunk_values;
+                auto length = std::min<size_t>(chunk_values, count - first);
+                buffer.resize(offsets[chunk + 1] - offsets[chunk]);
+                stream.seekg(static_cast<std::streamoff>(header.data_offset + offsets[chunk]));
+                stream.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                if(!stream) {
+                    throw std::runtime_error("unexpected end of file");
+                }
+                if constexpr(std::is_same_v<S, T>) {
+                    decompress_field_values(buffer.data(), buffer.size(), field->data() + first, length, N_);
+                } else {
+                    // Convert values stored with a different precision
+                    std::vector<S> values(length);
+                    decompress_field_values(buffer.data(), buffer.size(), values.data(), length, N_);
+                    std::copy(values.begin(), values.end(), field->begin() + static_cast<std::ptrdiff_t>(first));
+                }
+            };
+
+            // Decode the chunks in parallel, every thread streams from its own file handle
+            auto threads_count = parallel_threads(chunk_count);
+            LOG(DEBUG) << "Decoding " << chunk_count << " chunks of compressed field data using " << threads_count
+                       << " threads";
+            std::vector<std::ifstream> streams(threads_count);
+            std::vector<std::vector<char>> buffers(threads_count);
+            run_parallel(chunk_count, threads_count, [&](size_t thread, size_t chunk) {
+                if(!streams[thread].is_open()) {
+                    streams[thread].open(file_name, std::ios::binary);
+                }
+                if(header.value_size == sizeof(float)) {
+                    decode(float(), streams[thread], chunk, buffers[thread]);
+                } else {
+                    decode(double(), streams[thread], chunk, buffers[thread]);
+                }
+            });
+
+            return FieldData<T>(header_string, dimensions, header.size, std::move(field));
+        }
+
+        /**
+         * @brief Helper function to determine the number of threads to process tasks in parallel
+         * @param tasks Number of tasks
+         * @return Number of threads, one per available processor but at most one per task
+         */
+        static size_t parallel_threads(size_t tasks) {
+            return std::max<size_t>(std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1U), tasks), 1);
+        }
+
+        /**
+         * @brief Helper function to process tasks in parallel, every thread picks the next task not yet taken
+         * @param tasks         Number of tasks
+         * @param threads_count Number of threads to use
+         * @param process       Function called with the index of the thread and the index of the task
+         * @throws The first exception thrown by any of the tasks, after all threads have stopped
+         */
+        template <typename F> static void run_parallel(size_t tasks, size_t threads_count, F process) {
+            std::atomic<size_t> next_task{0};
+            std::vector<std::exception_ptr> exceptions(threads_count);
+            std::vector<std::thread> threads;
+            for(size_t i = 0; i < threads_count; ++i) {
+                threads.emplace_back([&, i]() {
+                    try {
+                        for(auto task = next_task++; task < tasks; task = next_task++) {
+                            process(i, task);
+                        }
+                    } catch(...) {
+                        exceptions[i] = std::current_exception();
+                        next_task = tasks;
+                    }
+                });
+            }
+            for(auto& thread : threads) {
+                thread.join();
+            }
+            for(auto& exception : exceptions) {
+                if(exception) {
+                    std::rethrow_exception(exception);
+                }
+            }
+        }
+
+        /**
+         * @brief Helper function to read and validate the header of APF v2 and compressed files
+         * @param file          Stream positioned at the beginning of the file
+         * @param header_string Human readable header string read from the file
+         * @return Fixed-size header of the file
+         */
+        APF2Header read_apf2_header(std::istream& file, std::string& header_string) const {
+            APF2Header header;
+            if(!file.read(reinterpret_cast<char*>(&header), sizeof(header))) { // NOLINT
+                throw std::runtime_error("unexpected end of file");
+            }
+            if(header.version != APF2_FORMAT_VERSION) {
+                throw std::runtime_error("unknown format version or byte order " + std::to_string(header.version));
+            }
+            if(header.value_size != sizeof(float) && header.value_size != sizeof(double)) {
+                throw std::runtime_error("unsupported value size " + std::to_string(header.value_size));
+            }
+            if(header.components != N_) {
+                throw std::runtime_error("invalid data");
+            }
+
+            // Read the header string
+            header_string.assign(header.header_length, '\0');
+            file.read(header_string.data(), static_cast<std::streamsize>(header_string.size()));
+            return header;
+        }
+
+        /**
+         * @brief Helper function to read raw values from a stream and convert them to the precision of the parser
+         * @param stream Stream positioned at the first value
+         * @param count  Number of values to read
+         * @return Shared pointer to the vector of values
+         */
+        template <typename S> static std::shared_ptr<std::vector<T>> read_values(std::istream& stream, size_t count) {
+            std::vector<S> values(count);
+            stream.read(reinterpret_cast<char*>(values.data()), static_cast<std::streamsize>(count * sizeof(S))); // NOLINT
+            if constexpr(std::is_same_v<S, T>) {
+                return std::make_shared<std::vector<T>>(std::move(values));
+            } else {
+                return std::make_shared<std::vector<T>>(values.begin(), values.end());
+            }
         }
 
         /**
@@ -306,7 +709,8 @@ namespace allpix {
         /**
          * @brief Function to read FieldData from INIT-formatted ASCII files. Values are interpreted in the units provided by
          * the argument and converted to the framework-internal base units. The size of the field given in the file is always
-         * interpreted as micrometers.
+         * interpreted as micrometers. The data block is memory-mapped, split into blocks of full lines and parsed in
+         * parallel, with every line holding the indices and the components of one field point.
          * @param file_name  File name (as canonical path) of the input file to be parsed
          * @param units      Units to convert the values of the field data from
          */
@@ -338,48 +742,111 @@ namespace allpix {
             if(file.fail()) {
                 throw std::runtime_error("invalid data or unexpected end of file");
             }
-            auto field = std::make_shared<std::vector<double>>();
+            auto data_start = static_cast<size_t>(file.tellg());
+
+            auto field = std::make_shared<std::vector<T>>();
             auto vertices = xsize * ysize * zsize;
             field->resize(vertices * N_);
 
-            // Loop through all the field data
-            for(size_t i = 0; i < vertices; ++i) {
-                if(vertices >= 100 && i % (vertices / 100) == 0) {
-                    LOG_PROGRESS(INFO, "read_init") << "Reading field data: " << (100 * i / vertices) << "%";
-                }
-
-                if(file.eof()) {
-                    throw std::runtime_error("unexpected end of file");
-                }
+            // Map the file and split the data block into ranges of full lines
+            MappedFile mapping(file_name);
+            const char* data_end = mapping.data() + mapping.size();
+            auto ranges = std::max<size_t>((mapping.size() - data_start) / init_block_size_, 1);
+            std::vector<const char*> bounds(ranges + 1, data_end);
+            bounds[0] = mapping.data() + data_start;
+            for(size_t range = 1; range < ranges; ++range) {
+                const auto* target = std::max(bounds[0] + range * init_block_size_, bounds[range - 1]);
+                bounds[range] = std::find(target, data_end, '\n');
+            }
 
-                // Get index of field
-                size_t xind = 0, yind = 0, zind = 0;
-                file >> xind >> yind >> zind;
+            // Parse the ranges in parallel, every line holds the indices of a field point followed by the field components
+            auto factor = Units::get(units);
+            std::atomic<size_t> parsed_vertices{0};
+            auto threads_count = parallel_threads(ranges);
+            LOG(DEBUG) << "Parsing field data in " << ranges << " blocks using " << threads_count << " threads";
+            run_parallel(ranges, threads_count, [&](size_t thread, size_t range) {
+                const auto* pos = bounds[range];
+                const auto* range_end = bounds[range + 1];
+                size_t parsed = 0;
+                while(skip_whitespace(pos, range_end) != range_end) {
+                    // Get index of field
+                    size_t xind = 0, yind = 0, zind = 0;
+                    parse_number(pos, range_end, xind);
+                    parse_number(pos, range_end, yind);
+                    parse_number(pos, range_end, zind);
+                    if(xind == 0 || yind == 0 || zind == 0 || xind > xsize || yind > ysize || zind > zsize) {
+                        throw std::runtime_error("invalid data");
+                    }
 
-                if(file.fail() || xind > xsize || yind > ysize || zind > zsize) {
-                    throw std::runtime_error("invalid data");
+                    // Loop through components of field and set the field at a position
+                    auto index = (xind - 1) * ysize * zsize * N_ + (yind - 1) * zsize * N_ + (zind - 1) * N_;
+                    for(size_t j = 0; j < N_; ++j) {
+                        double input = NAN;
+                        parse_number(pos, range_end, input);
+                        (*field)[index + j] = static_cast<T>(input * factor);
+                    }
+                    ++parsed;
                 }
-                xind--;
-                yind--;
-                zind--;
-
-                // Loop through components of field
-                for(size_t j = 0; j < N_; ++j) {
-                    double input = NAN;
-                    file >> input;
 
-                    // Set the field at a position
-                    (*field)[xind * ysize * zsize * N_ + yind * zsize * N_ + zind * N_ + j] = Units::get(input, units);
+                auto total = (parsed_vertices += parsed);
+                if(thread == 0 && vertices >= 100) {
+                    auto progress = std::min<size_t>(100 * total / vertices, 100);
+                    LOG_PROGRESS(INFO, "read_init") << "Reading field data: " << progress << "%";
                 }
+            });
+            if(parsed_vertices != vertices) {
+                throw std::runtime_error("invalid data, found " + std::to_string(parsed_vertices.load()) +
+                                         " field points while expecting " + std::to_string(vertices));
             }
             LOG_PROGRESS(INFO, "read_init") << "Reading field data: finished.";
 
-            return FieldData<T>(
-                header, std::array<size_t, 3>{{xsize, ysize, zsize}}, std::array<T, 3>{{xpixsz, ypixsz, thickness}}, field);
+            return FieldData<T>(header,
+                                std::array<size_t, 3>{{xsize, ysize, zsize}},
+                                std::array<double, 3>{{xpixsz, ypixsz, thickness}},
+                                field);
+        }
+
+        /**
+         * @brief Helper function to skip whitespace characters
+         * @param pos Position to start from, advanced to the first non-whitespace character
+         * @param end End of the range
+         * @return Position of the first non-whitespace character or end of the range
+         */
+        static const char* skip_whitespace(const char*& pos, const char* end) {
+            while(pos != end && std::isspace(static_cast<unsigned char>(*pos)) != 0) {
+                ++pos;
+            }
+            return pos;
+        }
+
+        /**
+         * @brief Helper function to parse a number from a range of characters without locale or stream overhead
+         * @param pos   Position to start from, advanced past the number
+         * @param end   End of the range
+         * @param value Parsed value
+         * @throws std::runtime_error if no number is found or the number is not followed by whitespace
+         */
+        template <typename V> static void parse_number(const char*& pos, const char* end, V& value) {
+            if(skip_whitespace(pos, end) == end) {
+                throw std::runtime_error("unexpected end of file");
+            }
+            // Explicit positive signs are not accepted by from_chars
+            if(*pos == '+') {
+                ++pos;
+            }
+            auto [ptr, ec] = std::from_chars(pos, end, value);
+            if(ec != std::errc() || (ptr != end && std::isspace(static_cast<unsigned char>(*ptr)) == 0)) {
+                throw std::runtime_error("invalid data");
+            }
+            pos = ptr;
         }
 
         size_t N_;
-        std::map<std::filesystem::path, FieldData<T>> field_map_;
+        bool map_files_;
+        std::map<std::filesystem::path, std::shared_future<FieldData<T>>> field_map_;
+        std::mutex field_map_mutex_;
+        // Approximate size of the blocks of INIT files parsed in parallel
+        static constexpr size_t init_block_size_ = 1 << 22;
     };
 
     /**
@@ -416,7 +883,7 @@ namespace allpix {
             auto path = std::filesystem::weakly_canonical(file_name);
 
             auto dimensions = field_data.getDimensions();
-            if(field_data.getData()->size() != N_ * dimensions[0] * dimensions[1] * dimensions[2]) {
+            if(field_data.getValues().size() != N_ * dimensions[0] * dimensions[1] * dimensions[2]) {
                 throw std::runtime_error("invalid field dimensions");
             }
 
@@ -433,6 +900,18 @@ namespace allpix {
                 }
                 write_apf_file(field_data, path);
                 break;
+            case FileType::APF2:
+                if(!units.empty()) {
+                    LOG(WARNING) << "Units will be ignored, APF2 file content is written in internal units.";
+                }
+                write_apf2_file(field_data, path);
+                break;
+            case FileType::APFZ:
+                if(!units.empty()) {
+                    LOG(WARNING) << "Units will be ignored, APFZ file content is written in internal units.";
+                }
+                write_apfz_file(field_data, path);
+                break;
             default:
                 throw std::runtime_error("unknown file format");
             }
@@ -449,15 +928,108 @@ namespace allpix {
         void write_apf_file(const FieldData<T>& field_data, const std::filesystem::path& file_name) {
             std::ofstream file(file_name, std::ios::binary);
 
+            // Field data not held in a vector, e.g. memory-mapped from file, is copied for serialization
+            auto values = field_data.getValues();
+            auto data = (field_data.getData() != nullptr ? field_data.getData()
+                                                         : std::make_shared<std::vector<T>>(values.begin(), values.end()));
+
             // Write the file with cereal:
             try {
                 cereal::PortableBinaryOutputArchive archive(file);
-                archive(field_data);
+                archive(FieldData<T>(field_data.getHeader(), field_data.getDimensions(), field_data.getSize(), data));
             } catch(cereal::Exception& e) {
                 throw std::runtime_error(e.what());
             }
         }
 
+        /**
+         * @brief Function to write FieldData into an APF v2 file. This does not convert any units, i.e. all values stored in
+         * APF v2 files are given in framework-internal base units. The values are written in native byte order with the
+         * precision of this writer.
+         * @param field_data Field data object to store
+         * @param file_name  File name (as canonical path) of the output file to be created
+         */
+        void write_apf2_file(const FieldData<T>& field_data, const std::filesystem::path& file_name) {
+            std::ofstream file(file_name, std::ios::binary);
+
+            LOG(TRACE) << "Writing APF2 file \"" << file_name << "\"";
+            write_apf2_header(file, field_data, APF2Header().magic);
+
+            auto values = field_data.getValues();
+            file.write(reinterpret_cast<const char*>(values.data()), // NOLINT
+                       static_cast<std::streamsize>(values.size() * sizeof(T)));
+            if(!file) {
+                throw std::runtime_error("could not write file");
+            }
+        }
+
+        /**
+         * @brief Function to write FieldData into a compressed APFZ file. This does not convert any units, i.e. all values
+         * stored in APFZ files are given in framework-internal base units. The values are split into chunks which are
+         * compressed independently, such that they can be decompressed in parallel when reading the file.
+         * @param field_data Field data object to store
+         * @param file_name  File name (as canonical path) of the output file to be created
+         */
+        void write_apfz_file(const FieldData<T>& field_data, const std::filesystem::path& file_name) {
+            std::ofstream file(file_name, std::ios::binary);
+
+            LOG(TRACE) << "Writing APFZ file \"" << file_name << "\"";
+            write_apf2_header(file, field_data, APF2Header::compressed_magic);
+
+            auto values = field_data.getValues();
+            std::array<std::uint64_t, 2> chunking{{chunk_values_, (values.size() + chunk_values_ - 1) / chunk_values_}};
+            std::vector<std::uint64_t> offsets(chunking[1] + 1);
+            offsets[0] = sizeof(chunking) + offsets.size() * sizeof(std::uint64_t);
+
+            // Compress all chunks and write the chunk index before the chunks
+            std::vector<std::vector<char>> chunks(chunking[1]);
+            for(size_t chunk = 0; chunk < chunks.size(); ++chunk) {
+                auto first = chunk * chunk_values_;
+                chunks[chunk] = compress_field_values(
+                    values.data() + first, std::min<size_t>(chunk_values_, values.size() - first), N_);
+                offsets[chunk + 1] = offsets[chunk] + chunks[chunk].size();
+            }
+            LOG(DEBUG) << "Compressed " << values.size() * sizeof(T) << " bytes of field data to "
+                       << offsets.back() - offsets.front() << " bytes in " << chunks.size() << " chunks";
+
+            file.write(reinterpret_cast<const char*>(chunking.data()), sizeof(chunking)); // NOLINT
+            file.write(reinterpret_cast<const char*>(offsets.data()),                      // NOLINT
+                       static_cast<std::streamsize>(offsets.size() * sizeof(std::uint64_t)));
+            for(const auto& chunk : chunks) {
+                file.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+            }
+            if(!file) {
+                throw std::runtime_error("could not write file");
+            }
+        }
+
+        /**
+         * @brief Helper function to write the header of APF v2 and compressed files, padded up to the data offset
+         * @param file       Stream positioned at the beginning of the file
+         * @param field_data Field data object to store
+         * @param magic      Magic bytes identifying the format
+         */
+        void write_apf2_header(std::ostream& file, const FieldData<T>& field_data, const std::array<char, 8>& magic) const {
+            auto header_string = field_data.getHeader();
+            auto dimensions = field_data.getDimensions();
+
+            APF2Header header;
+            header.magic = magic;
+            header.value_size = sizeof(T);
+            header.components = N_;
+            std::copy(dimensions.begin(), dimensions.end(), header.dimensions.begin());
+            header.size = field_data.getSize();
+            header.header_length = header_string.size();
+            // Align the values to the page size such that they can be mapped directly
+            auto header_end = sizeof(header) + header_string.size();
+            header.data_offset = (header_end + APF2Header::alignment - 1) / APF2Header::alignment * APF2Header::alignment;
+
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header)); // NOLINT
+            file << header_string;
+            std::string padding(header.data_offset - header_end, '\0');
+            file << padding;
+        }
+
         /**
          * @brief Function to write FieldData objects out to INIT-formatted ASCII files. Values are converted from the
          * framework-internal base units in which the data is stored in FieldData into the units provided by the units
@@ -488,8 +1060,8 @@ namespace allpix {
             file << "0.0" << std::endl;                                                   // Unused
 
             // Write the data block:
-            auto data = field_data.getData();
-            auto max_points = data->size() / N_;
+            auto data = field_data.getValues();
+            auto max_points = data.size() / N_;
 
             for(size_t xind = 0; xind < dimensions[0]; ++xind) {
                 for(size_t yind = 0; yind < dimensions[1]; ++yind) {
@@ -500,8 +1072,8 @@ namespace allpix {
                         // Vector or scalar field:
                         for(size_t j = 0; j < N_; j++) {
                             file << " "
-                                 << Units::convert(data->at(xind * dimensions[1] * dimensions[2] * N_ +
-                                                            yind * dimensions[2] * N_ + zind * N_ + j),
+                                 << Units::convert(data[xind * dimensions[1] * dimensions[2] * N_ +
+                                                        yind * dimensions[2] * N_ + zind * N_ + j],
                                                    units);
                         }
                         // End this line
@@ -516,6 +1088,8 @@ namespace allpix {
         }
 
         size_t N_;
+        // Number of values per chunk of compressed files
+        static constexpr size_t chunk_values_ = 1 << 20;
     };
 } // namespace allpix
 
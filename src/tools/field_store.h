@@ -0,0 +1,126 @@
+/**
+ * @file
+ * @brief Process-wide store of field data shared between detectors and modules
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef ALLPIX_FIELD_STORE_H
+#define ALLPIX_FIELD_STORE_H
+
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "core/utils/log.h"
+#include "core/utils/shared_array.h"
+#include "tools/field_parser.h"
+
+namespace allpix {
+
+    /**
+     * @brief Process-wide store of field data, shared by all detectors and modules requesting the same field
+     *
+     * Fields are identified by a key combining the canonical path of the field file, the units it is parsed with and the
+     * parameters of any transformation applied to the parsed data, see \ref key. The store only holds weak references to
+     * the fields: all field data returned by the store, and all \ref SharedArray "shared arrays" of their values held by
+     * detector fields, reference a common owner, such that a field is released as soon as its last user is destroyed and
+     * is only created again when requested after that.
+     */
+    template <typename T = double> class FieldStore {
+    public:
+        /**
+         * @brief Get the store of the process for fields with values of type T
+         * @return Reference to the store
+         */
+        static FieldStore& getInstance() {
+            static FieldStore store;
+            return store;
+        }
+
+        /**
+         * @brief Build the key identifying a field in the store
+         * @param file_name Path of the file the field is read from
+         * @param units Units the field values are parsed with
+         * @param transformation Description of the transformation applied to the parsed field, including its parameters
+         * @return Key of the field
+         * @throws std::filesystem::filesystem_error if the provided path does not exist
+         */
+        static std::string key(const std::filesystem::path& file_name,
+                               const std::string& units,
+                               const std::string& transformation = std::string()) {
+            return std::filesystem::canonical(file_name).string() + "|" + units + "|" + transformation;
+        }
+
+        /**
+         * @brief Get a field from the store or create it if no field with this key is in use
+         * @param key Key identifying the field, see \ref key
+         * @param create Function creating the field if it is not found in the store
+         * @return Field data referencing the shared storage of the field values
+         * @note Fields are created while the store is locked, such that concurrent requests for the same field wait for
+         * the first one. Exceptions thrown by the creation function are passed on and nothing is stored.
+         */
+        FieldData<T> get(const std::string& key, const std::function<FieldData<T>()>& create) {
+            std::lock_guard<std::mutex> lock{mutex_};
+
+            auto iter = fields_.find(key);
+            if(iter != fields_.end()) {
+                if(auto field = iter->second.lock()) {
+                    LOG(INFO) << "Using field data shared with " << (field.use_count() - 1) << " other users";
+                    return share(field);
+                }
+                fields_.erase(iter);
+            }
+
+            // Drop the entries of all fields released in the meantime
+            for(auto it = fields_.begin(); it != fields_.end();) {
+                it = (it->second.expired() ? fields_.erase(it) : std::next(it));
+            }
+
+            auto field = std::make_shared<const FieldData<T>>(create());
+            fields_.emplace(key, field);
+            return share(field);
+        }
+
+        /**
+         * @brief Get the number of fields currently in use
+         * @return Number of fields held by at least one user
+         */
+        size_t size() const {
+            std::lock_guard<std::mutex> lock{mutex_};
+            size_t alive = 0;
+            for(const auto& [key, field] : fields_) {
+                alive += (field.expired() ? 0 : 1);
+            }
+            return alive;
+        }
+
+    private:
+        FieldStore() = default;
+
+        /**
+         * @brief Create field data viewing the values of a stored field, keeping the stored field alive
+         * @param field Field held by the store
+         * @return Field data referencing the stored field as owner of its values
+         */
+        static FieldData<T> share(const std::shared_ptr<const FieldData<T>>& field) {
+            auto values = field->getValues();
+            return {field->getHeader(),
+                    field->getDimensions(),
+                    field->getSize(),
+                    SharedArray<T>(field, values.data(), values.size())};
+        }
+
+        mutable std::mutex mutex_;
+        std::map<std::string, std::weak_ptr<const FieldData<T>>> fields_;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_FIELD_STORE_H */
@@ -0,0 +1,206 @@
+/**
+ * @file
+ * @brief Utility to write output files to local scratch space and transfer them to their destination asynchronously
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef ALLPIX_FILE_STAGING_H
+#define ALLPIX_FILE_STAGING_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+#include "core/config/Configuration.hpp"
+#include "core/module/exceptions.h"
+#include "core/utils/log.h"
+
+namespace allpix {
+
+    /**
+     * @brief Staging of the output files of a writer module in a local scratch directory
+     *
+     * If enabled, files are written to a directory unique to the process within the staging directory, which defaults to
+     * the TMPDIR of the job. Finished files are transferred to their destination in the output directory in a separate
+     * thread, such that the writer continues with the next file while the previous one is copied. Files are moved if the
+     * staging directory is located on the same filesystem as the destination. Otherwise, they are copied next to the
+     * destination and only renamed to it once the CRC-32 checksum of the copy matches the one of the staged file, such that
+     * the destination never holds an incomplete file. Staged files are removed after a successful transfer and kept in the
+     * staging directory otherwise.
+     */
+    class FileStaging {
+    public:
+        /**
+         * @brief Read the staging settings from the module configuration
+         * @param config Configuration of the writer module
+         */
+        void configure(Configuration& config) {
+            config.setDefault<bool>("stage_output", false);
+            enabled_ = config.get<bool>("stage_output");
+            if(!enabled_) {
+                return;
+            }
+
+            std::filesystem::path directory;
+            if(config.has("staging_directory")) {
+                directory = config.getPath("staging_directory");
+            } else {
+                const char* tmpdir = std::getenv("TMPDIR");
+                directory = (tmpdir != nullptr && *tmpdir != '\0' ? std::filesystem::path(tmpdir)
+                                                                  : std::filesystem::temp_directory_path());
+            }
+
+            // Separate the files of different processes and writers sharing the scratch space of a node
+            static std::atomic_uint counter{0};
+            directory_ = directory / ("allpix_" + std::to_string(getpid()) + "_" + std::to_string(counter++));
+            std::error_code error;
+            std::filesystem::create_directories(directory_, error);
+            if(error) {
+                throw InvalidValueError(config,
+                                        "staging_directory",
+                                        "cannot create staging directory " + directory_.string() + ": " + error.message());
+            }
+            LOG(DEBUG) << "Staging output files in " << directory_;
+        }
+
+        /**
+         * @brief Check whether output files are staged
+         */
+        bool enabled() const { return enabled_; }
+
+        /**
+         * @brief Get the path to write a file to before it is transferred to its destination
+         * @param destination Final path of the file
+         * @return Path of the file in the staging directory, or the destination if staging is disabled
+         */
+        std::string stage(const std::string& destination) const {
+            if(!enabled_) {
+                return destination;
+            }
+            return (directory_ / std::filesystem::path(destination).filename()).string();
+        }
+
+        /**
+         * @brief Transfer a closed file from the staging directory to its destination in the background
+         * @param staged Path of the file in the staging directory
+         * @param destination Final path of the file
+         */
+        void transfer(const std::string& staged, const std::string& destination) {
+            if(!enabled_) {
+                return;
+            }
+            LOG(DEBUG) << "Transferring staged file " << staged << " to " << destination;
+            transfers_.push_back(std::async(std::launch::async, [staged, destination]() {
+                move_file(staged, destination);
+            }));
+        }
+
+        /**
+         * @brief Wait for all transfers to complete and remove the staging directory
+         * @throws ModuleError If any of the files could not be transferred
+         */
+        void wait() {
+            std::string errors;
+            for(auto& transfer : transfers_) {
+                try {
+                    transfer.get();
+                } catch(ModuleError& e) {
+                    errors += (errors.empty() ? "" : "\n") + std::string(e.what());
+                }
+            }
+            transfers_.clear();
+            if(!errors.empty()) {
+                throw ModuleError(errors);
+            }
+
+            // Only remove the directory if empty, files left behind by failed transfers are not deleted
+            if(enabled_) {
+                std::error_code error;
+                std::filesystem::remove(directory_, error);
+            }
+        }
+
+    private:
+        /**
+         * @brief Calculate the CRC-32 checksum of a file
+         */
+        static std::uint32_t checksum(const std::filesystem::path& file) {
+            static const auto table = []() {
+                std::array<std::uint32_t, 256> entries{};
+                for(std::uint32_t n = 0; n < entries.size(); ++n) {
+                    auto value = n;
+                    for(int bit = 0; bit < 8; ++bit) {
+                        value = (value & 1u ? 0xEDB88320u ^ (value >> 1) : value >> 1);
+                    }
+                    entries[n] = value;
+                }
+                return entries;
+            }();
+
+            std::ifstream stream(file, std::ios::binary);
+            if(!stream.good()) {
+                throw ModuleError("Cannot read file " + file.string() + " to calculate its checksum");
+            }
+            std::vector<char> buffer(1 << 20);
+            std::uint32_t crc = 0xFFFFFFFFu;
+            while(stream) {
+                stream.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                for(std::streamsize i = 0; i < stream.gcount(); ++i) {
+                    crc = table[(crc ^ static_cast<unsigned char>(buffer[static_cast<size_t>(i)])) & 0xFFu] ^ (crc >> 8);
+                }
+            }
+            return crc ^ 0xFFFFFFFFu;
+        }
+
+        /**
+         * @brief Move a file to its destination, copying and verifying it if it is located on another filesystem
+         */
+        static void move_file(const std::filesystem::path& staged, const std::filesystem::path& destination) {
+            std::error_code error;
+            std::filesystem::rename(staged, destination, error);
+            if(!error) {
+                return;
+            }
+
+            auto partial = destination;
+            partial += ".part";
+            try {
+                std::filesystem::copy_file(staged, partial, std::filesystem::copy_options::overwrite_existing);
+            } catch(std::filesystem::filesystem_error& e) {
+                throw ModuleError("Copying staged file " + staged.string() + " to " + partial.string() + " failed: " +
+                                  e.what());
+            }
+            if(checksum(staged) != checksum(partial)) {
+                std::filesystem::remove(partial, error);
+                throw ModuleError("Checksum of the copy of staged file " + staged.string() + " to " + destination.string() +
+                                  " does not match, staged file is kept");
+            }
+            std::filesystem::rename(partial, destination, error);
+            if(error) {
+                throw ModuleError("Renaming copy of staged file to " + destination.string() + " failed: " + error.message());
+            }
+            std::filesystem::remove(staged, error);
+        }
+
+        bool enabled_{false};
+        std::filesystem::path directory_;
+        std::vector<std::future<void>> transfers_;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_FILE_STAGING_H */
@@ -0,0 +1,827 @@
+/**
+ * @file
+ * @brief Utility to convert simulation objects to flat columns of fundamental types and back
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef ALLPIX_FLAT_OBJECTS_H
+#define ALLPIX_FLAT_OBJECTS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <Math/Point3D.h>
+
+#include "core/geometry/Detector.hpp"
+#include "core/messenger/Message.hpp"
+#include "core/utils/type.h"
+
+#include "objects/exceptions.h"
+#include "objects/objects.h"
+
+namespace allpix {
+    /**
+     * @brief Index of the objects of an event among all objects of their type
+     *
+     * Relations between objects are stored as the index of the related object among all objects of its type in the event,
+     * counting the objects of all detectors in the order their columns are filled. Relations to objects which are not
+     * stored are represented by -1.
+     */
+    class FlatObjectIndex {
+    public:
+        /**
+         * @brief Add objects to the index, following the objects of the same type added before
+         * @param objects List of objects
+         */
+        template <typename T> void add(const std::vector<T>& objects) {
+            auto& count = std::get<Count<T>>(counts_).value;
+            for(const auto& object : objects) {
+                index_[&object] = count++;
+            }
+        }
+
+        /**
+         * @brief Get the index of an object
+         * @param object Pointer to the object, might be a null pointer
+         * @return Index of the object or -1 if the object is not part of the index
+         */
+        std::int32_t get(const Object* object) const {
+            auto iter = index_.find(object);
+            return (iter == index_.end() ? -1 : iter->second);
+        }
+
+        /**
+         * @brief Remove all objects from the index
+         */
+        void clear() {
+            index_.clear();
+            counts_ = {};
+        }
+
+    private:
+        template <typename T> struct Count {
+            std::int32_t value{};
+        };
+        template <typename> struct Counts;
+        template <typename... T> struct Counts<std::tuple<T...>> {
+            using type = std::tuple<Count<T>...>;
+        };
+
+        std::unordered_map<const Object*, std::int32_t> index_;
+        typename Counts<OBJECTS>::type counts_;
+    };
+
+    /**
+     * @brief Objects of an event by their index among all objects of their type, to restore the relations between them
+     */
+    class FlatObjectLinks {
+    public:
+        /**
+         * @brief Add objects to the links, following the objects of the same type added before
+         * @param objects List of objects
+         */
+        template <typename T> void add(std::vector<T>& objects) {
+            auto& links = std::get<std::vector<T*>>(links_);
+            for(auto& object : objects) {
+                links.push_back(&object);
+            }
+        }
+
+        /**
+         * @brief Get an object by its index
+         * @param index Index of the object among all objects of its type
+         * @return Pointer to the object or a null pointer if no object with this index is known
+         */
+        template <typename T> T* get(std::int32_t index) const {
+            const auto& links = std::get<std::vector<T*>>(links_);
+            if(index < 0 || static_cast<size_t>(index) >= links.size()) {
+                return nullptr;
+            }
+            return links[static_cast<size_t>(index)];
+        }
+
+    private:
+        template <typename> struct Links;
+        template <typename... T> struct Links<std::tuple<T...>> {
+            using type = std::tuple<std::vector<T*>...>;
+        };
+
+        typename Links<OBJECTS>::type links_;
+    };
+
+    /**
+     * @brief Columns of the three coordinates of points
+     */
+    struct FlatPointColumns {
+        std::vector<double> x;
+        std::vector<double> y;
+        std::vector<double> z;
+
+        void append(const ROOT::Math::XYZPoint& point) {
+            x.push_back(point.x());
+            y.push_back(point.y());
+            z.push_back(point.z());
+        }
+        ROOT::Math::XYZPoint get(size_t i) const { return {x[i], y[i], z[i]}; }
+        template <typename F> void visit(const std::string& name, F&& f) {
+            f(name + "_x", x);
+            f(name + "_y", y);
+            f(name + "_z", z);
+        }
+    };
+
+    /**
+     * @brief Columns of lists of relations of every object, stored as the number of relations per object followed by the
+     * indices of all relations of the objects in a single column
+     */
+    struct FlatRelationColumns {
+        std::vector<std::uint32_t> count;
+        std::vector<std::int32_t> index;
+
+        template <typename T> void append(const std::vector<const T*>& objects, const FlatObjectIndex& object_index) {
+            count.push_back(static_cast<std::uint32_t>(objects.size()));
+            for(const auto* object : objects) {
+                index.push_back(object_index.get(object));
+            }
+        }
+        template <typename F> void visit(const std::string& name, F&& f) {
+            f(name + "_count", count);
+            f(name, index);
+        }
+    };
+
+    /**
+     * @brief Get a relation of an object, ignoring relations to objects which are not available
+     */
+    template <typename F> const Object* get_relation(F&& getter) {
+        try {
+            return getter();
+        } catch(const MissingReferenceException&) {
+            return nullptr;
+        }
+    }
+
+    /**
+     * @brief Flat columns of objects of a single type, specialized for every type of object
+     *
+     * Every specialization provides the visit method to iterate over all columns with their names, the append method to
+     * add an object, the build method to create the objects of a detector from the columns and the link method to restore
+     * relations between objects of the same type after all objects have been created.
+     */
+    template <typename T> struct FlatColumns;
+
+    template <> struct FlatColumns<MCTrack> {
+        FlatPointColumns start;
+        FlatPointColumns end;
+        std::vector<std::string> start_volume;
+        std::vector<std::string> end_volume;
+        std::vector<std::string> creation_process_name;
+        std::vector<std::int32_t> creation_process_type;
+        std::vector<std::int32_t> particle_id;
+        std::vector<double> start_time;
+        std::vector<double> end_time;
+        std::vector<double> kinetic_energy_initial;
+        std::vector<double> kinetic_energy_final;
+        std::vector<double> total_energy_initial;
+        std::vector<double> total_energy_final;
+        std::vector<std::int32_t> parent;
+
+        template <typename F> void visit(F&& f) {
+            start.visit("start", f);
+            end.visit("end", f);
+            f("start_volume", start_volume);
+            f("end_volume", end_volume);
+            f("creation_process_name", creation_process_name);
+            f("creation_process_type", creation_process_type);
+            f("particle_id", particle_id);
+            f("start_time", start_time);
+            f("end_time", end_time);
+            f("kinetic_energy_initial", kinetic_energy_initial);
+            f("kinetic_energy_final", kinetic_energy_final);
+            f("total_energy_initial", total_energy_initial);
+            f("total_energy_final", total_energy_final);
+            f("parent", parent);
+        }
+        size_t size() const { return particle_id.size(); }
+        void append(const MCTrack& track, const FlatObjectIndex& index) {
+            start.append(track.getStartPoint());
+            end.append(track.getEndPoint());
+            start_volume.push_back(track.getOriginatingVolumeName());
+            end_volume.push_back(track.getTerminatingVolumeName());
+            creation_process_name.push_back(track.getCreationProcessName());
+            creation_process_type.push_back(track.getCreationProcessType());
+            particle_id.push_back(track.getParticleID());
+            start_time.push_back(track.getGlobalStartTime());
+            end_time.push_back(track.getGlobalEndTime());
+            kinetic_energy_initial.push_back(track.getKineticEnergyInitial());
+            kinetic_energy_final.push_back(track.getKineticEnergyFinal());
+            total_energy_initial.push_back(track.getTotalEnergyInitial());
+            total_energy_final.push_back(track.getTotalEnergyFinal());
+            parent.push_back(index.get(track.getParent()));
+        }
+        std::vector<MCTrack> build(const std::shared_ptr<const Detector>&, const FlatObjectLinks&) const {
+            std::vector<MCTrack> tracks;
+            tracks.reserve(size());
+            for(size_t i = 0; i < size(); ++i) {
+                tracks.emplace_back(start.get(i),
+                                    end.get(i),
+                                    start_volume[i],
+                                    end_volume[i],
+                                    creation_process_name[i],
+                                    creation_process_type[i],
+                                    particle_id[i],
+                                    start_time[i],
+                                    end_time[i],
+                                    kinetic_energy_initial[i],
+                                    kinetic_energy_final[i],
+                                    total_energy_initial[i],
+                                    total_energy_final[i]);
+            }
+            return tracks;
+        }
+        void link(std::vector<MCTrack>& tracks, const FlatObjectLinks& links) const {
+            for(size_t i = 0; i < tracks.size(); ++i) {
+                tracks[i].setParent(links.get<MCTrack>(parent[i]));
+            }
+        }
+    };
+
+    template <> struct FlatColumns<MCParticle> {
+        FlatPointColumns local_start;
+        FlatPointColumns global_start;
+        FlatPointColumns local_end;
+        FlatPointColumns global_end;
+        std::vector<std::int32_t> particle_id;
+        std::vector<double> local_time;
+        std::vector<double> global_time;
+        std::vector<double> total_energy_start;
+        std::vector<double> kinetic_energy_start;
+        std::vector<std::uint32_t> total_deposited_charge;
+        std::vector<std::int32_t> parent;
+        std::vector<std::int32_t> track;
+
+        template <typename F> void visit(F&& f) {
+            local_start.visit("local_start", f);
+            global_start.visit("global_start", f);
+            local_end.visit("local_end", f);
+            global_end.visit("global_end", f);
+            f("particle_id", particle_id);
+            f("local_time", local_time);
+            f("global_time", global_time);
+            f("total_energy_start", total_energy_start);
+            f("kinetic_energy_start", kinetic_energy_start);
+            f("total_deposited_charge", total_deposited_charge);
+            f("parent", parent);
+            f("track", track);
+        }
+        size_t size() const { return particle_id.size(); }
+        void append(const MCParticle& particle, const FlatObjectIndex& index) {
+            local_start.append(particle.getLocalStartPoint());
+            global_start.append(particle.getGlobalStartPoint());
+            local_end.append(particle.getLocalEndPoint());
+            global_end.append(particle.getGlobalEndPoint());
+            particle_id.push_back(particle.getParticleID());
+            local_time.push_back(particle.getLocalTime());
+            global_time.push_back(particle.getGlobalTime());
+            total_energy_start.push_back(particle.getTotalEnergyStart());
+            kinetic_energy_start.push_back(particle.getKineticEnergyStart());
+            total_deposited_charge.push_back(particle.getTotalDepositedCharge());
+            parent.push_back(index.get(particle.getParent()));
+            track.push_back(index.get(particle.getTrack()));
+        }
+        std::vector<MCParticle> build(const std::shared_ptr<const Detector>&, const FlatObjectLinks& links) const {
+            std::vector<MCParticle> particles;
+            particles.reserve(size());
+            for(size_t i = 0; i < size(); ++i) {
+                particles.emplace_back(local_start.get(i),
+                                       global_start.get(i),
+                                       local_end.get(i),
+                                       global_end.get(i),
+                                       particle_id[i],
+                                       local_time[i],
+                                       global_time[i]);
+                particles.back().setTotalEnergyStart(total_energy_start[i]);
+                particles.back().setKineticEnergyStart(kinetic_energy_start[i]);
+                particles.back().setTotalDepositedCharge(total_deposited_charge[i]);
+                particles.back().setTrack(links.get<MCTrack>(track[i]));
+            }
+            return particles;
+        }
+        void link(std::vector<MCParticle>& particles, const FlatObjectLinks& links) const {
+            for(size_t i = 0; i < particles.size(); ++i) {
+                particles[i].setParent(links.get<MCParticle>(parent[i]));
+            }
+        }
+    };
+
+    template <> struct FlatColumns<DepositedCharge> {
+        FlatPointColumns local;
+        FlatPointColumns global;
+        std::vector<std::int32_t> type;
+        std::vector<std::uint32_t> charge;
+        std::vector<double> local_time;
+        std::vector<double> global_time;
+        std::vector<std::int32_t> mc_particle;
+
+        template <typename F> void visit(F&& f) {
+            local.visit("local", f);
+            global.visit("global", f);
+            f("type", type);
+            f("charge", charge);
+            f("local_time", local_time);
+            f("global_time", global_time);
+            f("mc_particle", mc_particle);
+        }
+        size_t size() const { return charge.size(); }
+        void append(const DepositedCharge& deposit, const FlatObjectIndex& index) {
+            local.append(deposit.getLocalPosition());
+            global.append(deposit.getGlobalPosition());
+            type.push_back(static_cast<std::int32_t>(deposit.getType()));
+            charge.push_back(deposit.getCharge());
+            local_time.push_back(deposit.getLocalTime());
+            global_time.push_back(deposit.getGlobalTime());
+            mc_particle.push_back(index.get(get_relation([&]() { return deposit.getMCParticle(); })));
+        }
+        std::vector<DepositedCharge> build(const std::shared_ptr<const Detector>&, const FlatObjectLinks& links) const {
+            std::vector<DepositedCharge> deposits;
+            deposits.reserve(size());
+            for(size_t i = 0; i < size(); ++i) {
+                deposits.emplace_back(local.get(i),
+                                      global.get(i),
+                                      static_cast<CarrierType>(type[i]),
+                                      charge[i],
+                                      local_time[i],
+                                      global_time[i],
+                                      links.get<MCParticle>(mc_particle[i]));
+            }
+            return deposits;
+        }
+        void link(std::vector<DepositedCharge>&, const FlatObjectLinks&) const {}
+    };
+
+    /**
+     * @note The induced pulses of propagated charges are not stored. The Monte Carlo particle of a propagated charge is
+     * stored for analysis, but restored from its deposited charge.
+     */
+    template <> struct FlatColumns<PropagatedCharge> {
+        FlatPointColumns local;
+        FlatPointColumns global;
+        std::vector<std::int32_t> type;
+        std::vector<std::uint32_t> charge;
+        std::vector<double> local_time;
+        std::vector<double> global_time;
+        std::vector<std::int32_t> state;
+        std::vector<std::int32_t> deposited_charge;
+        std::vector<std::int32_t> mc_particle;
+
+        template <typename F> void visit(F&& f) {
+            local.visit("local", f);
+            global.visit("global", f);
+            f("type", type);
+            f("charge", charge);
+            f("local_time", local_time);
+            f("global_time", global_time);
+            f("state", state);
+            f("deposited_charge", deposited_charge);
+            f("mc_particle", mc_particle);
+        }
+        size_t size() const { return charge.size(); }
+        void append(const PropagatedCharge& propagated, const FlatObjectIndex& index) {
+            local.append(propagated.getLocalPosition());
+            global.append(propagated.getGlobalPosition());
+            type.push_back(static_cast<std::int32_t>(propagated.getType()));
+            charge.push_back(propagated.getCharge());
+            local_time.push_back(propagated.getLocalTime());
+            global_time.push_back(propagated.getGlobalTime());
+            state.push_back(static_cast<std::int32_t>(propagated.getState()));
+            deposited_charge.push_back(index.get(get_relation([&]() { return propagated.getDepositedCharge(); })));
+            mc_particle.push_back(index.get(get_relation([&]() { return propagated.getMCParticle(); })));
+        }
+        std::vector<PropagatedCharge> build(const std::shared_ptr<const Detector>&, const FlatObjectLinks& links) const {
+            std::vector<PropagatedCharge> propagated_charges;
+            propagated_charges.reserve(size());
+            for(size_t i = 0; i < size(); ++i) {
+                propagated_charges.emplace_back(local.get(i),
+                                                global.get(i),
+                                                static_cast<CarrierType>(type[i]),
+                                                charge[i],
+                                                local_time[i],
+                                                global_time[i],
+                                                static_cast<CarrierState>(state[i]),
+                                                links.get<DepositedCharge>(deposited_charge[i]));
+            }
+            return propagated_charges;
+        }
+        void link(std::vector<PropagatedCharge>&, const FlatObjectLinks&) const {}
+    };
+
+    /**
+     * @note The Monte Carlo particles and times of pixel charges are restored from their propagated charges, and are
+     * thus only available if the propagated charges are stored. The Monte Carlo particles are stored for analysis.
+     */
+    template <> struct FlatColumns<PixelCharge> {
+        std::vector<std::int32_t> pixel_x;
+        std::vector<std::int32_t> pixel_y;
+        std::vector<std::int64_t> charge;
+        std::vector<double> local_time;
+        std::vector<double> global_time;
+        std::vector<double> pulse_binning;
+        std::vector<std::uint64_t> pulse_offset;
+        std::vector<std::uint32_t> pulse_count;
+        std::vector<double> pulse;
+        FlatRelationColumns propagated_charges;
+        FlatRelationColumns mc_particles;
+
+        template <typename F> void visit(F&& f) {
+            f("pixel_x", pixel_x);
+            f("pixel_y", pixel_y);
+            f("charge", charge);
+            f("local_time", local_time);
+            f("global_time", global_time);
+            f("pulse_binning", pulse_binning);
+            f("pulse_offset", pulse_offset);
+            f("pulse_count", pulse_count);
+            f("pulse", pulse);
+            propagated_charges.visit("propagated_charges", f);
+            mc_particles.visit("mc_particles", f);
+        }
+        size_t size() const { return charge.size(); }
+        void append(const PixelCharge& pixel_charge, const FlatObjectIndex& index) {
+            pixel_x.push_back(pixel_charge.getIndex().x());
+            pixel_y.push_back(pixel_charge.getIndex().y());
+            charge.push_back(pixel_charge.getCharge());
+            local_time.push_back(pixel_charge.getLocalTime());
+            global_time.push_back(pixel_charge.getGlobalTime());
+
+            // Uninitialized pulses without binning are stored with a binning of zero
+            const auto& charge_pulse = pixel_charge.getPulse();
+            pulse_binning.push_back(charge_pulse.isInitialized() ? charge_pulse.getBinning() : 0.);
+            pulse_offset.push_back(charge_pulse.getOffset());
+            pulse_count.push_back(static_cast<std::uint32_t>(charge_pulse.size()));
+            pulse.insert(pulse.end(), charge_pulse.begin(), charge_pulse.end());
+
+            propagated_charges.append(
+                get_relation_list([&]() { return pixel_charge.getPropagatedCharges(); }), index);
+            mc_particles.append(get_relation_list([&]() { return pixel_charge.getMCParticles(); }), index);
+        }
+        std::vector<PixelCharge> build(const std::shared_ptr<const Detector>& detector,
+                                       const FlatObjectLinks& links) const {
+            std::vector<PixelCharge> pixel_charges;
+            pixel_charges.reserve(size());
+            size_t pulse_index = 0;
+            size_t relation_index = 0;
+            for(size_t i = 0; i < size(); ++i) {
+                Pulse charge_pulse;
+                auto binning = pulse_binning[i];
+                if(binning > 0) {
+                    charge_pulse = Pulse(binning);
+                }
+                for(size_t bin = 0; bin < pulse_count[i]; ++bin) {
+                    charge_pulse.addCharge(pulse[pulse_index++],
+                                           static_cast<double>(pulse_offset[i] + bin) * std::max(binning, 0.));
+                }
+
+                std::vector<const PropagatedCharge*> related;
+                for(size_t j = 0; j < propagated_charges.count[i]; ++j) {
+                    const auto* propagated_charge = links.get<PropagatedCharge>(propagated_charges.index[relation_index++]);
+                    if(propagated_charge != nullptr) {
+                        related.push_back(propagated_charge);
+                    }
+                }
+                pixel_charges.emplace_back(
+                    get_pixel(detector, pixel_x[i], pixel_y[i]), std::move(charge_pulse), related);
+            }
+            return pixel_charges;
+        }
+        void link(std::vector<PixelCharge>&, const FlatObjectLinks&) const {}
+
+        /**
+         * @brief Get the pixel of a detector, or a pixel without position if the detector is not known
+         */
+        static Pixel get_pixel(const std::shared_ptr<const Detector>& detector, std::int32_t x, std::int32_t y) {
+            if(detector == nullptr) {
+                return Pixel(Pixel::Index(x, y), Pixel::Type::RECTANGLE, {}, {}, {});
+            }
+            return detector->getPixel(x, y);
+        }
+
+        /**
+         * @brief Get a list of relations of an object, ignoring the list if any related object is not available
+         */
+        template <typename F> static auto get_relation_list(F&& getter) -> decltype(getter()) {
+            try {
+                return getter();
+            } catch(const MissingReferenceException&) {
+                return {};
+            }
+        }
+    };
+
+    /**
+     * @note The Monte Carlo particles of pixel hits are restored from their pixel charges, and are stored for analysis.
+     */
+    template <> struct FlatColumns<PixelHit> {
+        std::vector<std::int32_t> pixel_x;
+        std::vector<std::int32_t> pixel_y;
+        std::vector<double> signal;
+        std::vector<double> local_time;
+        std::vector<double> global_time;
+        std::vector<std::int32_t> pixel_charge;
+        FlatRelationColumns mc_particles;
+
+        template <typename F> void visit(F&& f) {
+            f("pixel_x", pixel_x);
+            f("pixel_y", pixel_y);
+            f("signal", signal);
+            f("local_time", local_time);
+            f("global_time", global_time);
+            f("pixel_charge", pixel_charge);
+            mc_particles.visit("mc_particles", f);
+        }
+        size_t size() const { return signal.size(); }
+        void append(const PixelHit& hit, const FlatObjectIndex& index) {
+            pixel_x.push_back(hit.getIndex().x());
+            pixel_y.push_back(hit.getIndex().y());
+            signal.push_back(hit.getSignal());
+            local_time.push_back(hit.getLocalTime());
+            global_time.push_back(hit.getGlobalTime());
+            pixel_charge.push_back(index.get(get_relation([&]() { return hit.getPixelCharge(); })));
+            mc_particles.append(FlatColumns<PixelCharge>::get_relation_list([&]() { return hit.getMCParticles(); }),
+                                index);
+        }
+        std::vector<PixelHit> build(const std::shared_ptr<const Detector>& detector, const FlatObjectLinks& links) const {
+            std::vector<PixelHit> hits;
+            hits.reserve(size());
+            for(size_t i = 0; i < size(); ++i) {
+                hits.emplace_back(FlatColumns<PixelCharge>::get_pixel(detector, pixel_x[i], pixel_y[i]),
+                                  local_time[i],
+                                  global_time[i],
+                                  signal[i],
+                                  links.get<PixelCharge>(pixel_charge[i]));
+            }
+            return hits;
+        }
+        void link(std::vector<PixelHit>&, const FlatObjectLinks&) const {}
+    };
+
+    /**
+     * @brief Reduced precision of a floating point column, applied to its values before they are stored
+     *
+     * Values can be rounded to multiples of an absolute step, which is reduced to the largest power of two not above the
+     * configured step, such that the error is at most half the configured step. For values of limited magnitude, such as
+     * positions within a sensor, the low bits of the mantissa are then zero. Alternatively or in addition, the mantissa
+     * can be rounded to a number of bits, with a relative error of at most 2^-(bits+1), similar to storing the values as
+     * float for 23 bits or as half precision for 10 bits. The values stay doubles, the zeroed bits are removed by the
+     * compression of the file.
+     */
+    struct FlatPrecision {
+        double step{0};
+        int mantissa_bits{-1};
+
+        void apply(std::vector<double>& column) const {
+            for(auto& value : column) {
+                if(step > 0) {
+                    value = std::nearbyint(value / step) * step;
+                }
+                if(mantissa_bits >= 0 && mantissa_bits < 52) {
+                    std::uint64_t bits = 0;
+                    std::memcpy(&bits, &value, sizeof(bits));
+                    // Leave infinite values and NaN unchanged, carries into the exponent round up correctly
+                    if(((bits >> 52) & 0x7FF) != 0x7FF) {
+                        auto dropped = static_cast<unsigned int>(52 - mantissa_bits);
+                        bits += std::uint64_t(1) << (dropped - 1);
+                        bits &= ~((std::uint64_t(1) << dropped) - 1);
+                        std::memcpy(&value, &bits, sizeof(value));
+                    }
+                }
+            }
+        }
+    };
+
+    /**
+     * @brief Flat columns of all objects of an event, separated by the type of the objects and their detector
+     *
+     * The columns of every type of object are kept for every detector and for objects not bound to any detector. Objects
+     * of messages with the same type and detector are stored in the same columns, such that messages names are lost.
+     */
+    class FlatEvent {
+    public:
+        /**
+         * @brief Construct the columns of an event
+         * @param detector_names Names of the detectors, the objects not bound to a detector use the name "global"
+         * @param detectors Detectors of the columns, a null pointer for objects not bound to a detector or for detectors
+         *                  which are not part of the geometry
+         */
+        FlatEvent(std::vector<std::string> detector_names, std::vector<std::shared_ptr<const Detector>> detectors)
+            : detector_names_(std::move(detector_names)), detectors_(std::move(detectors)) {
+            for_each_type([&](auto& columns) { columns.resize(detector_names_.size()); });
+        }
+
+        /// @{
+        /**
+         * @brief Copying and moving is not allowed, the column precisions refer to the columns of the event
+         */
+        FlatEvent(const FlatEvent&) = delete;
+        FlatEvent& operator=(const FlatEvent&) = delete;
+        FlatEvent(FlatEvent&&) = delete;
+        FlatEvent& operator=(FlatEvent&&) = delete;
+        ~FlatEvent() = default;
+        /// @}
+
+        /**
+         * @brief Reduce the precision of floating point columns of all detectors before they are stored
+         * @param name Object type and column name of the form <type>_<column>, where the column can also be the name of a
+         *             point to select the columns of its three coordinates
+         * @param precision Precision to apply to the values of the columns
+         * @return Number of columns selected
+         */
+        size_t setPrecision(const std::string& name, FlatPrecision precision) {
+            if(precision.step > 0) {
+                precision.step = std::exp2(std::floor(std::log2(precision.step)));
+            }
+            size_t count = 0;
+            visit([&](const std::string& type_name, size_t, const std::string& column_name, auto& column) {
+                if constexpr(std::is_same_v<std::decay_t<decltype(column)>, std::vector<double>>) {
+                    auto full_name = type_name + "_" + column_name;
+                    if(full_name == name || full_name == name + "_x" || full_name == name + "_y" ||
+                       full_name == name + "_z") {
+                        precisions_.emplace_back(&column, precision);
+                        ++count;
+                    }
+                }
+            });
+            return count;
+        }
+
+        /**
+         * @brief Get the name of an object type as used for the columns
+         */
+        template <typename T> static std::string getTypeName() { return allpix::demangle(typeid(T).name()); }
+
+        /**
+         * @brief Get the full name of a column, combining the object type, the detector name and the column name
+         */
+        static std::string getColumnName(const std::string& type_name,
+                                         const std::string& detector_name,
+                                         const std::string& column_name) {
+            return type_name + "_" + detector_name + "_" + column_name;
+        }
+
+        /**
+         * @brief Iterate over all columns
+         * @param f Function called with the name of the object type, the detector index and the name and the column
+         */
+        template <typename F> void visit(F&& f) {
+            for_each_type([&](auto& columns) {
+                using T = typename std::decay_t<decltype(columns)>::value_type::object_type;
+                for(size_t detector = 0; detector < columns.size(); ++detector) {
+                    columns[detector].visit([&](const std::string& name, auto& column) {
+                        f(getTypeName<T>(), detector, name, column);
+                    });
+                }
+            });
+        }
+
+        /**
+         * @brief Get the names of the detectors of the columns
+         */
+        const std::vector<std::string>& getDetectorNames() const { return detector_names_; }
+
+        /**
+         * @brief Fill the columns from the messages of an event
+         * @param messages Messages with objects, messages of other types or unknown detectors are ignored
+         * @return Number of objects stored
+         */
+        size_t fill(const std::vector<std::shared_ptr<BaseMessage>>& messages) {
+            // Assign the indices of all objects first, to be able to store relations to objects of any detector
+            std::vector<std::pair<size_t, std::shared_ptr<BaseMessage>>> detector_messages;
+            for(const auto& message : messages) {
+                auto name = (message->getDetector() == nullptr ? "global" : message->getDetector()->getName());
+                auto iter = std::find(detector_names_.begin(), detector_names_.end(), name);
+                if(iter != detector_names_.end()) {
+                    detector_messages.emplace_back(static_cast<size_t>(iter - detector_names_.begin()), message);
+                }
+            }
+
+            size_t count = 0;
+            for_each_type([&](auto& columns) {
+                using T = typename std::decay_t<decltype(columns)>::value_type::object_type;
+                for(size_t detector = 0; detector < columns.size(); ++detector) {
+                    for(const auto& [message_detector, message] : detector_messages) {
+                        auto typed_message = std::dynamic_pointer_cast<Message<T>>(message);
+                        if(message_detector == detector && typed_message != nullptr) {
+                            index_.add(typed_message->getData());
+                        }
+                    }
+                }
+            });
+            for_each_type([&](auto& columns) {
+                using T = typename std::decay_t<decltype(columns)>::value_type::object_type;
+                for(size_t detector = 0; detector < columns.size(); ++detector) {
+                    for(const auto& [message_detector, message] : detector_messages) {
+                        auto typed_message = std::dynamic_pointer_cast<Message<T>>(message);
+                        if(message_detector == detector && typed_message != nullptr) {
+                            for(const auto& object : typed_message->getData()) {
+                                columns[detector].columns.append(object, index_);
+                            }
+                            count += typed_message->getData().size();
+                        }
+                    }
+                }
+            });
+            index_.clear();
+
+            for(const auto& [column, precision] : precisions_) {
+                precision.apply(*column);
+            }
+            return count;
+        }
+
+        /**
+         * @brief Create the messages of all objects in the columns
+         * @return Messages of all detectors which are part of the geometry and contain objects
+         */
+        std::vector<std::shared_ptr<BaseMessage>> build() const {
+            // The objects are kept in their vectors until all relations have been restored, moving a vector into its
+            // message keeps the objects in place
+            FlatObjectLinks links;
+            std::vector<std::shared_ptr<BaseMessage>> messages;
+            for_each_type([&](const auto& columns) {
+                using T = typename std::decay_t<decltype(columns)>::value_type::object_type;
+                std::vector<std::vector<T>> objects;
+                objects.reserve(columns.size());
+                for(size_t detector = 0; detector < columns.size(); ++detector) {
+                    objects.push_back(columns[detector].columns.build(detectors_[detector], links));
+                    links.add(objects.back());
+                }
+                for(size_t detector = 0; detector < columns.size(); ++detector) {
+                    columns[detector].columns.link(objects[detector], links);
+                }
+                for(size_t detector = 0; detector < columns.size(); ++detector) {
+                    if(objects[detector].empty()) {
+                        continue;
+                    }
+                    if(detector_names_[detector] == "global") {
+                        messages.push_back(std::make_shared<Message<T>>(std::move(objects[detector])));
+                    } else if(detectors_[detector] != nullptr) {
+                        messages.push_back(std::make_shared<Message<T>>(std::move(objects[detector]), detectors_[detector]));
+                    }
+                }
+            });
+            return messages;
+        }
+
+        /**
+         * @brief Remove the objects of all columns
+         */
+        void clear() {
+            for_each_type([](auto& columns) {
+                for(auto& detector_columns : columns) {
+                    detector_columns.visit([](const std::string&, auto& column) { column.clear(); });
+                }
+            });
+        }
+
+    private:
+        // Columns of a type of object, tagged with the object type
+        template <typename T> struct TypeColumns {
+            using object_type = T;
+            FlatColumns<T> columns;
+
+            template <typename F> void visit(F&& f) { columns.visit(f); }
+        };
+        template <typename> struct Columns;
+        template <typename... T> struct Columns<std::tuple<T...>> {
+            using type = std::tuple<std::vector<TypeColumns<T>>...>;
+        };
+
+        template <typename F> void for_each_type(F&& f) {
+            std::apply([&](auto&... columns) { (f(columns), ...); }, columns_);
+        }
+        template <typename F> void for_each_type(F&& f) const {
+            std::apply([&](const auto&... columns) { (f(columns), ...); }, columns_);
+        }
+
+        std::vector<std::string> detector_names_;
+        std::vector<std::shared_ptr<const Detector>> detectors_;
+        typename Columns<OBJECTS>::type columns_;
+        FlatObjectIndex index_;
+        std::vector<std::pair<std::vector<double>*, FlatPrecision>> precisions_;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_FLAT_OBJECTS_H */
@@ -32,6 +32,10 @@ namespace allpix {
      * manager doesn't operate its own event loop and assumes it is part of the client event loop and the results
      * of each event are independent from each other. Also, this  manager doesn't maintain any threads, it only
      * maintains the worker managers which are allocated on a per thread basis.
+     *
+     * The task-based G4TaskRunManager is not used as base class, since it schedules events and sub-events on its own thread
+     * pool. Sub-events are instead simulated in tasks of the framework event, with the worker manager of the thread
+     * executing the task, and their results are merged by the module.
      */
     class MTRunManager : public G4MTRunManager {
         friend class WorkerRunManager;
@@ -0,0 +1,68 @@
+/**
+ * @file
+ * @brief Utility to resolve lists of input files and wildcard patterns of reader modules
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef ALLPIX_INPUT_FILES_H
+#define ALLPIX_INPUT_FILES_H
+
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <glob.h>
+
+#include "core/config/Configuration.hpp"
+#include "core/config/exceptions.h"
+
+namespace allpix {
+
+    /**
+     * @brief Resolve the input files configured for a reader module
+     * @param config Configuration of the reader module
+     * @param key Key holding a single file name or a list of file names
+     * @param extension Extension appended to file names and patterns without one
+     * @return Absolute paths of all input files, in the configured order
+     * @throws InvalidValueError If a file does not exist or a pattern does not match any file
+     *
+     * Relative paths are resolved relative to the configuration file. Every entry may contain the wildcards `*`, `?` and
+     * `[...]` in its file name or directories, and is replaced by all matching files in lexicographical order, such that the
+     * order of the files is reproducible.
+     */
+    inline std::vector<std::filesystem::path>
+    get_input_files(const Configuration& config, const std::string& key, const std::string& extension) {
+        std::vector<std::filesystem::path> files;
+        for(auto path : config.getPathArray(key)) {
+            path.replace_extension(extension);
+            if(path.string().find_first_of("*?[") == std::string::npos) {
+                std::error_code error;
+                auto canonical = std::filesystem::canonical(path, error);
+                if(error) {
+                    throw InvalidValueError(config, key, "path " + path.string() + " not found");
+                }
+                files.push_back(canonical);
+                continue;
+            }
+
+            glob_t matches{};
+            auto status = glob(path.c_str(), 0, nullptr, &matches);
+            for(size_t i = 0; status == 0 && i < matches.gl_pathc; ++i) {
+                files.emplace_back(matches.gl_pathv[i]);
+            }
+            globfree(&matches);
+            if(status != 0) {
+                throw InvalidValueError(config, key, "no input file matching " + path.string() + " found");
+            }
+        }
+        return files;
+    }
+} // namespace allpix
+
+#endif /* ALLPIX_INPUT_FILES_H */
@@ -33,6 +33,21 @@ namespace allpix {
         using OutputPlotPoints = std::vector<
             std::pair<std::tuple<double, unsigned int, CarrierType, CarrierState>, std::vector<ROOT::Math::XYZPoint>>>;
 
+        /**
+         * @brief Add a point to the drift path of a set of charge carriers unless it is too close to the previous point
+         *
+         * @param points Points of the drift path recorded so far
+         * @param point Point to add to the drift path
+         * @param tolerance Minimum distance to the previously recorded point, the first point is always recorded
+         */
+        static void AddPoint(std::vector<ROOT::Math::XYZPoint>& points, // NOLINT
+                             const ROOT::Math::XYZPoint& point,
+                             double tolerance) {
+            if(points.empty() || tolerance <= 0 || (point - points.back()).Mag2() >= tolerance * tolerance) {
+                points.push_back(point);
+            }
+        }
+
         /**
          * @brief Generate line graphs of charge carrier drift paths
          *
@@ -0,0 +1,79 @@
+/**
+ * @file
+ * @brief Utility to map files read-only into memory
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef ALLPIX_MAPPED_FILE_H
+#define ALLPIX_MAPPED_FILE_H
+
+#include <cstddef>
+#include <filesystem>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace allpix {
+    /**
+     * @brief Read-only memory mapping of an entire file, unmapped on destruction
+     */
+    class MappedFile {
+    public:
+        /**
+         * @brief Map a file into memory
+         * @param path Path of the file to be mapped
+         * @throws std::runtime_error if the file cannot be opened or mapped
+         */
+        explicit MappedFile(const std::filesystem::path& path) {
+            auto fd = ::open(path.c_str(), O_RDONLY); // NOLINT
+            if(fd < 0) {
+                throw std::runtime_error("cannot open file for mapping");
+            }
+            struct stat status {};
+            if(::fstat(fd, &status) != 0 || status.st_size <= 0) {
+                ::close(fd);
+                throw std::runtime_error("cannot determine file size for mapping");
+            }
+            size_ = static_cast<size_t>(status.st_size);
+            data_ = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+            // The mapping stays valid after closing the file descriptor
+            ::close(fd);
+            if(data_ == MAP_FAILED) { // NOLINT
+                throw std::runtime_error("cannot map file into memory");
+            }
+        }
+        ~MappedFile() { ::munmap(data_, size_); }
+
+        /// @{
+        /**
+         * @brief Disallow copy and move, the mapping is owned by a single object
+         */
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        /// @}
+
+        /**
+         * @brief Get pointer to the first byte of the mapped file
+         */
+        const char* data() const { return static_cast<const char*>(data_); }
+
+        /**
+         * @brief Get the size of the mapped file in bytes
+         */
+        size_t size() const { return size_; }
+
+    private:
+        void* data_{nullptr};
+        size_t size_{0};
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_MAPPED_FILE_H */
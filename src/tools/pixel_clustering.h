@@ -0,0 +1,120 @@
+/**
+ * @file
+ * @brief Utility to group objects of neighboring pixels into clusters
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef ALLPIX_PIXEL_CLUSTERING_H
+#define ALLPIX_PIXEL_CLUSTERING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <numeric>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "core/geometry/DetectorModel.hpp"
+#include "objects/Pixel.hpp"
+
+namespace allpix {
+
+    /**
+     * @brief Clustering of the objects of a detector by the connected components of their neighboring pixels
+     *
+     * The objects are looked up by their pixel index in a hash map, and the objects of all neighboring pixels of every
+     * object are merged into the same cluster with a union-find structure. The time of the clustering is thus linear in the
+     * number of objects, independent of the size of the clusters. Pixels are neighbors as defined by the detector model
+     * for a distance of one pixel, such that the clustering is identical for all types of pixel matrices.
+     */
+    class PixelClustering {
+    public:
+        /**
+         * @brief Construct the clustering for the pixel matrix of a detector model
+         * @param model Detector model defining the neighbors of the pixels
+         */
+        explicit PixelClustering(std::shared_ptr<const DetectorModel> model)
+            : model_(std::move(model)), stencil_(model_->getNeighborStencil(1)) {}
+
+        /**
+         * @brief Group objects with a pixel index into clusters of neighboring pixels
+         * @param objects Objects to cluster, providing their pixel index with a getIndex method
+         * @return Clusters of pointers to the objects, ordered by their first object and with the objects of every cluster
+         * in the order of the input
+         */
+        template <typename T> std::vector<std::vector<const T*>> cluster(const std::vector<T>& objects) const {
+            // Union-find structure over the positions of the objects, the root of every set is its first object
+            std::vector<size_t> parent(objects.size());
+            std::iota(parent.begin(), parent.end(), 0);
+            auto find = [&](size_t i) {
+                while(parent[i] != i) {
+                    parent[i] = parent[parent[i]];
+                    i = parent[i];
+                }
+                return i;
+            };
+            auto unite = [&](size_t i, size_t j) {
+                auto root_i = find(i);
+                auto root_j = find(j);
+                if(root_i < root_j) {
+                    parent[root_j] = root_i;
+                } else if(root_j < root_i) {
+                    parent[root_i] = root_j;
+                }
+            };
+
+            // Index the objects by their pixel, objects of the same pixel always belong to the same cluster
+            std::unordered_map<std::uint64_t, size_t> pixels;
+            pixels.reserve(objects.size());
+            for(size_t i = 0; i < objects.size(); ++i) {
+                auto inserted = pixels.emplace(get_key(objects[i].getIndex()), i);
+                if(!inserted.second) {
+                    unite(inserted.first->second, i);
+                }
+            }
+
+            // Merge the clusters of all neighboring pixels
+            for(size_t i = 0; i < objects.size(); ++i) {
+                model_->forEachNeighbor(objects[i].getIndex(), stencil_, [&](const Pixel::Index& neighbor) {
+                    auto pixel = pixels.find(get_key(neighbor));
+                    if(pixel != pixels.end()) {
+                        unite(i, pixel->second);
+                    }
+                });
+            }
+
+            // Collect the objects of every cluster, created in the order of their first object
+            std::vector<std::vector<const T*>> clusters;
+            std::vector<size_t> cluster_index(objects.size());
+            for(size_t i = 0; i < objects.size(); ++i) {
+                auto root = find(i);
+                if(root == i) {
+                    cluster_index[i] = clusters.size();
+                    clusters.emplace_back();
+                }
+                clusters[cluster_index[root]].push_back(&objects[i]);
+            }
+            return clusters;
+        }
+
+    private:
+        /**
+         * @brief Get the key of a pixel index in the hash map
+         */
+        static std::uint64_t get_key(const Pixel::Index& index) {
+            return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(index.x())) << 32) |
+                   static_cast<std::uint32_t>(index.y());
+        }
+
+        std::shared_ptr<const DetectorModel> model_;
+        NeighborStencil stencil_;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_PIXEL_CLUSTERING_H */
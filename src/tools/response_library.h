@@ -0,0 +1,186 @@
+/**
+ * @file
+ * @brief Utility to store and read libraries of the averaged pixel response to charge deposits
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef ALLPIX_RESPONSE_LIBRARY_H
+#define ALLPIX_RESPONSE_LIBRARY_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace allpix {
+    /**
+     * @brief Library of the response of a pixel and its neighbors to charge deposited within the pixel cell
+     *
+     * The pixel cell is divided into a regular grid of in-pixel positions and depths. For every cell of this grid, the
+     * library holds for every pixel within the configured distance from the pixel of the deposit the mean charge collected
+     * per deposited electron-hole pair, the variance of the collected charge per deposited pair and the charge-weighted
+     * mean collection time. The variance is stored per pair such that deposits of any size can be sampled, assuming
+     * independent charge carriers.
+     *
+     * The library is stored as a plain text file: leading comment lines starting with #, a header with the number of cells
+     * along x, y and z, the pixel pitch and the sensor thickness in framework-internal units and the neighbor distance,
+     * followed by one line per cell with the mean, variance and time for every neighbor pixel. Cells are ordered with the x
+     * index running fastest, neighbor pixels with the x offset running fastest.
+     */
+    class ResponseLibrary {
+    public:
+        /**
+         * @brief Response of a single neighbor pixel in a cell of the library
+         */
+        struct Response {
+            double mean{};
+            double variance{};
+            double time{};
+        };
+
+        /**
+         * @brief Construct an empty library, to be read from file before use
+         */
+        ResponseLibrary() = default;
+
+        /**
+         * @brief Construct a library without entries
+         * @param bins Number of cells along x, y and z
+         * @param pitch Pixel pitch along x and y
+         * @param thickness Thickness of the sensor
+         * @param distance Distance of the neighbor pixels stored with every cell
+         */
+        ResponseLibrary(std::array<size_t, 3> bins, std::array<double, 2> pitch, double thickness, size_t distance)
+            : bins_(bins), pitch_(pitch), thickness_(thickness), distance_(distance),
+              responses_(bins[0] * bins[1] * bins[2] * getNeighbors()) {}
+
+        /**
+         * @brief Read a library from file
+         * @param path Path to the file
+         * @throws std::invalid_argument If the file cannot be read or does not contain a valid library
+         */
+        explicit ResponseLibrary(const std::string& path) {
+            std::ifstream file(path);
+            if(!file.good()) {
+                throw std::invalid_argument("file cannot be read");
+            }
+
+            // Skip the comment lines preceding the header
+            std::string comment;
+            while(file.peek() == '#' && std::getline(file, comment)) {
+            }
+            file >> bins_[0] >> bins_[1] >> bins_[2] >> pitch_[0] >> pitch_[1] >> thickness_ >> distance_;
+            if(!file || bins_[0] * bins_[1] * bins_[2] == 0 || pitch_[0] <= 0 || pitch_[1] <= 0 || thickness_ <= 0) {
+                throw std::invalid_argument("invalid header of the response library");
+            }
+
+            responses_.resize(bins_[0] * bins_[1] * bins_[2] * getNeighbors());
+            for(auto& response : responses_) {
+                file >> response.mean >> response.variance >> response.time;
+            }
+            if(!file) {
+                throw std::invalid_argument("response library contains fewer entries than expected");
+            }
+        }
+
+        /**
+         * @brief Write the library to file
+         * @param path Path to the file
+         * @throws std::invalid_argument If the file cannot be written
+         */
+        void write(const std::string& path) const {
+            std::ofstream file(path);
+            file << "# Allpix Squared pixel response library: bins x y z, pitch x y, thickness, neighbor distance\n";
+            file << bins_[0] << " " << bins_[1] << " " << bins_[2] << " " << pitch_[0] << " " << pitch_[1] << " "
+                 << thickness_ << " " << distance_ << "\n";
+            file << std::setprecision(std::numeric_limits<double>::max_digits10);
+            for(size_t cell = 0; cell < responses_.size() / getNeighbors(); ++cell) {
+                for(size_t neighbor = 0; neighbor < getNeighbors(); ++neighbor) {
+                    const auto& response = responses_[cell * getNeighbors() + neighbor];
+                    file << (neighbor == 0 ? "" : " ") << response.mean << " " << response.variance << " " << response.time;
+                }
+                file << "\n";
+            }
+            if(!file) {
+                throw std::invalid_argument("file cannot be written");
+            }
+        }
+
+        /**
+         * @brief Get the cell of the library for a position of a deposit
+         * @param offset_x Offset of the deposit from the center of its pixel along x
+         * @param offset_y Offset of the deposit from the center of its pixel along y
+         * @param depth Depth of the deposit measured from the lower surface of the sensor
+         * @return Index of the cell, positions outside of the pixel cell are assigned to the closest cell
+         */
+        size_t getCell(double offset_x, double offset_y, double depth) const {
+            auto bin = [](double fraction, size_t bins) {
+                auto index = std::floor(fraction * static_cast<double>(bins));
+                return static_cast<size_t>(std::clamp(index, 0., static_cast<double>(bins - 1)));
+            };
+            return (bin(depth / thickness_, bins_[2]) * bins_[1] + bin(offset_y / pitch_[1] + 0.5, bins_[1])) * bins_[0] +
+                   bin(offset_x / pitch_[0] + 0.5, bins_[0]);
+        }
+
+        /**
+         * @brief Get the response of a neighbor pixel in a cell
+         * @param cell Index of the cell
+         * @param dx Offset of the neighbor pixel index along x
+         * @param dy Offset of the neighbor pixel index along y
+         * @return Reference to the response
+         */
+        const Response& getResponse(size_t cell, int dx, int dy) const { return responses_[index(cell, dx, dy)]; }
+        Response& getResponse(size_t cell, int dx, int dy) { return responses_[index(cell, dx, dy)]; }
+
+        /**
+         * @brief Get the number of cells along x, y and z
+         */
+        std::array<size_t, 3> getBins() const { return bins_; }
+
+        /**
+         * @brief Get the pixel pitch the library has been generated for
+         */
+        std::array<double, 2> getPitch() const { return pitch_; }
+
+        /**
+         * @brief Get the sensor thickness the library has been generated for
+         */
+        double getThickness() const { return thickness_; }
+
+        /**
+         * @brief Get the distance of the neighbor pixels stored with every cell
+         */
+        size_t getDistance() const { return distance_; }
+
+        /**
+         * @brief Get the number of neighbor pixels stored with every cell, including the pixel of the deposit
+         */
+        size_t getNeighbors() const { return (2 * distance_ + 1) * (2 * distance_ + 1); }
+
+    private:
+        size_t index(size_t cell, int dx, int dy) const {
+            auto width = static_cast<int>(2 * distance_ + 1);
+            auto distance = static_cast<int>(distance_);
+            return cell * getNeighbors() + static_cast<size_t>((dy + distance) * width + dx + distance);
+        }
+
+        std::array<size_t, 3> bins_{};
+        std::array<double, 2> pitch_{};
+        double thickness_{};
+        size_t distance_{};
+        std::vector<Response> responses_;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_RESPONSE_LIBRARY_H */
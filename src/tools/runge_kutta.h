@@ -12,7 +12,11 @@
 #ifndef ALLPIX_RUNGE_KUTTA_H
 #define ALLPIX_RUNGE_KUTTA_H
 
+#include <array>
+#include <cstddef>
 #include <functional>
+#include <type_traits>
+#include <utility>
 
 #include <Eigen/Core>
 #include <Eigen/Geometry>
@@ -217,8 +221,295 @@ namespace allpix {
             37.0/378, 0, 250.0/621, 125.0/594, 0, 512.0/1771,
             2825.0/27648, 0, 18575.0/48384, 13525.0/55296, 277.0/14336, 1.0/4).finished());
     }
+
+    namespace tableau {
+        /**
+         * @brief Base of the Runge-Kutta tableaus with coefficients known at compile time
+         *
+         * Derived tableaus provide the number of stages and the coefficients in the same layout as the tableau matrices:
+         * the stage coefficients in the first rows, followed by the weights of the solution and of the embedded solution.
+         * Tableaus with the first-same-as-last property, whose last stage is evaluated at the solution of the step, set the
+         * fsal flag.
+         */
+        struct StaticTableau {
+            static constexpr bool fsal = false;
+        };
+
+        /**
+         * @brief Kutta's third order method with coefficients known at compile time
+         * @warning Without error function
+         */
+        struct StaticRK3 : StaticTableau {
+            static constexpr int stages = 3;
+            static constexpr double coefficients[stages + 2][stages] = {
+                {0, 0, 0},
+                {1.0/2, 0, 0},
+                {-1, 2, 0},
+                {1.0/6, 2.0/3, 1.0/6},
+                {0, 0, 0}};
+        };
+        /**
+         * @brief Classic original Runge-Kutta method with coefficients known at compile time
+         * @warning Without error function
+         */
+        struct StaticRK4 : StaticTableau {
+            static constexpr int stages = 4;
+            static constexpr double coefficients[stages + 2][stages] = {
+                {0, 0, 0, 0},
+                {1.0/2, 0, 0, 0},
+                {0, 1.0/2, 0, 0},
+                {0, 0, 1, 0},
+                {1.0/6, 1.0/3, 1.0/3, 1.0/6},
+                {0, 0, 0, 0}};
+        };
+        /**
+         * @brief Runge-Kutta-Fehlberg method with coefficients known at compile time
+         * Values from https://ntrs.nasa.gov/citations/19680027281, p.13, Table III
+         */
+        struct StaticRK5 : StaticTableau {
+            static constexpr int stages = 6;
+            static constexpr double coefficients[stages + 2][stages] = {
+                {0, 0, 0, 0, 0, 0},
+                {1.0/4, 0, 0, 0, 0, 0},
+                {3.0/32, 9.0/32, 0, 0, 0, 0},
+                {1932.0/2197, -7200.0/2197, 7296.0/2197, 0, 0, 0},
+                {439.0/216, -8, 3680.0/513, -845.0/4104, 0, 0},
+                {-8.0/27, 2, -3544.0/2565, 1859.0/4104, -11.0/40, 0},
+                {16.0/135, 0, 6656.0/12825, 28561.0/56430, -9.0/50, 2.0/55},
+                {25.0/216, 0, 1408.0/2565, 2197.0/4104, -1.0/5, 0}};
+        };
+        /**
+         * @brief Runge-Kutta-Cash-Karp method with coefficients known at compile time
+         */
+        struct StaticRKCK : StaticTableau {
+            static constexpr int stages = 6;
+            static constexpr double coefficients[stages + 2][stages] = {
+                {0, 0, 0, 0, 0, 0},
+                {1.0/5, 0, 0, 0, 0, 0},
+                {3.0/40, 9.0/40, 0, 0, 0, 0},
+                {3.0/10, -9.0/10, 6.0/5, 0, 0, 0},
+                {-11.0/54, 5.0/2, -70.0/27, 35.0/27, 0, 0},
+                {1631.0/55296, 175.0/512, 575.0/13824, 44275.0/110592, 253.0/4096, 0},
+                {37.0/378, 0, 250.0/621, 125.0/594, 0, 512.0/1771},
+                {2825.0/27648, 0, 18575.0/48384, 13525.0/55296, 277.0/14336, 1.0/4}};
+        };
+        /**
+         * @brief Dormand-Prince method of fifth order with embedded fourth order error estimate
+         * Values from J.R. Dormand, P.J. Prince, J. Comput. Appl. Math. 6 (1980) 19, Table 2
+         */
+        struct StaticDOPRI5 : StaticTableau {
+            static constexpr int stages = 7;
+            static constexpr bool fsal = true;
+            static constexpr double coefficients[stages + 2][stages] = {
+                {0, 0, 0, 0, 0, 0, 0},
+                {1.0/5, 0, 0, 0, 0, 0, 0},
+                {3.0/40, 9.0/40, 0, 0, 0, 0, 0},
+                {44.0/45, -56.0/15, 32.0/9, 0, 0, 0, 0},
+                {19372.0/6561, -25360.0/2187, 64448.0/6561, -212.0/729, 0, 0, 0},
+                {9017.0/3168, -355.0/33, 46732.0/5247, 49.0/176, -5103.0/18656, 0, 0},
+                {35.0/384, 0, 500.0/1113, 125.0/192, -2187.0/6784, 11.0/84, 0},
+                {35.0/384, 0, 500.0/1113, 125.0/192, -2187.0/6784, 11.0/84, 0},
+                {5179.0/57600, 0, 7571.0/16695, 393.0/640, -92097.0/339200, 187.0/2100, 1.0/40}};
+        };
+    }
     // clang-format on
 
+    /**
+     * @brief Class to perform Runge-Kutta integration with a tableau and a step function known at compile time
+     *
+     * Provides the same interface as \ref RungeKutta, but the step function is stored with its own type instead of a
+     * std::function and the coefficients are taken from a tableau type derived from \ref tableau::StaticTableau. The
+     * stages are expanded at compile time, terms with vanishing coefficients are omitted, and the step function can be
+     * inlined into the integration.
+     *
+     * A step can be attempted without being applied, such that it can be repeated with a smaller time step if its error is
+     * too large. The first stage only depends on the current value and time and is reused for repeated attempts. For
+     * tableaus with the first-same-as-last property, the last stage of an accepted step is reused as first stage of the
+     * next step, unless the value or time is changed in between.
+     */
+    template <typename T, class Tableau, class Function, int D = 3> class StaticRungeKutta {
+        static_assert(std::is_base_of_v<tableau::StaticTableau, Tableau>, "tableau has to be known at compile time");
+        static constexpr int S = Tableau::stages;
+        using Vector = Eigen::Matrix<T, D, 1>;
+
+    public:
+        /**
+         * @brief Utility type to return both the value and the error at every step
+         */
+        using Step = typename RungeKutta<T, S, D>::Step;
+
+        /**
+         * @brief Construct a Runge-Kutta integrator
+         * @param function Step function to perform integration
+         * @param step_size Time step of the integration
+         * @param initial_y Start values of the vector to perform integration on
+         * @param initial_t Initial time at the start of the integration
+         */
+        StaticRungeKutta(Function function, T step_size, Vector initial_y, T initial_t = 0)
+            : function_(std::move(function)), h_(std::move(step_size)), y_(std::move(initial_y)),
+              t_(std::move(initial_t)) {
+            error_.setZero();
+        }
+
+        /**
+         * @brief Changes the time step
+         * @param step_size New time step of the integration
+         */
+        void setTimeStep(T step_size) { h_ = std::move(step_size); }
+        /**
+         * @brief Return the time step
+         * @return Current time step of the integration
+         */
+        T getTimeStep() const { return h_; }
+
+        /**
+         * @brief Changes the current value during integration
+         * @note Can be used to add additional processes during the integration
+         */
+        void setValue(Vector y) {
+            y_ = std::move(y);
+            first_stage_valid_ = false;
+        }
+
+        /**
+         * @brief Get the value to integrate
+         * @return Current value
+         */
+        Vector getValue() const { return y_; }
+        /**
+         * @brief Get the total integration error
+         * @return Total integrated error
+         */
+        Vector getError() const { return error_; }
+        /**
+         * @brief Get the time during integration
+         * @return Current time
+         */
+        T getTime() const { return t_; }
+        /**
+         * @brief Advance the time of the integration
+         * @param t Time step to advance the integration by
+         */
+        void advanceTime(double t) {
+            t_ += t;
+            first_stage_valid_ = false;
+        }
+
+        /**
+         * @brief Execute a single time step of the integration
+         * @return Combination of the current value and the error in this single step
+         */
+        Step step() {
+            auto result = attempt();
+            accept();
+            return result;
+        }
+
+        /**
+         * @brief Compute a single time step of the integration without applying it
+         * @return Combination of the value and the error of the attempted step
+         */
+        Step attempt() { return attempt_stages(std::make_index_sequence<S>{}); }
+
+        /**
+         * @brief Apply the last attempted step to the value and time of the integration
+         */
+        void accept() {
+            if constexpr(Tableau::fsal) {
+                // Continue from the argument of the last stage, such that it can be reused as first stage
+                y_ = last_argument_;
+                first_stage_ = last_stage_;
+                first_stage_valid_ = true;
+            } else {
+                y_ += attempt_.value;
+                first_stage_valid_ = false;
+            }
+            t_ += h_;
+            error_ += attempt_.error;
+        }
+
+        /**
+         * @brief Execute multiple time steps of the integration
+         * @param amount Number of steps to combine
+         * @return Combination of the current value and the total error in all the steps
+         */
+        Step step(int amount) {
+            Step result;
+            result.value.setZero();
+            result.error.setZero();
+            for(int i = 0; i < amount; ++i) {
+                Step single = step();
+                result.value += single.value;
+                result.error += single.error;
+            }
+            return result;
+        }
+
+    private:
+        // Add the term of a previous stage to the argument of a stage, if its coefficient does not vanish
+        template <size_t I, size_t J> void add_term(Vector& value, const Vector& k) const {
+            if constexpr(Tableau::coefficients[I][J] != 0) {
+                value += (h_ * static_cast<T>(Tableau::coefficients[I][J])) * k;
+            }
+        }
+
+        // Evaluate the step function for a single stage from all previous stages
+        template <size_t I, size_t... J> void compute_stage(std::array<Vector, S>& k, std::index_sequence<J...>) {
+            if constexpr(I == 0) {
+                if(!first_stage_valid_) {
+                    first_stage_ = function_(t_, y_);
+                    first_stage_valid_ = true;
+                }
+                k[I] = first_stage_;
+            } else {
+                constexpr T node = (static_cast<T>(0) + ... + static_cast<T>(Tableau::coefficients[I][J]));
+                Vector yt = y_;
+                (add_term<I, J>(yt, k[J]), ...);
+                k[I] = function_(t_ + h_ * node, yt);
+                if constexpr(Tableau::fsal && I + 1 == S) {
+                    last_argument_ = yt;
+                }
+            }
+        }
+
+        template <size_t... I> Step attempt_stages(std::index_sequence<I...>) {
+            // Compute all stages in order
+            std::array<Vector, S> k;
+            (compute_stage<I>(k, std::make_index_sequence<I>{}), ...);
+            if constexpr(Tableau::fsal) {
+                last_stage_ = k[S - 1];
+            }
+
+            // Combine the stages to the step and the embedded step
+            Vector ys = Vector::Zero();
+            Vector yse = Vector::Zero();
+            (add_term<S, I>(ys, k[I]), ...);
+            (add_term<S + 1, I>(yse, k[I]), ...);
+
+            // Store step information until the step is accepted
+            attempt_.value = ys;
+            attempt_.error = ys - yse;
+            return attempt_;
+        }
+
+        Function function_;
+        // Step size
+        T h_;
+
+        // Vector to integrate
+        Vector y_;
+        // Total error vector
+        Vector error_;
+        // Current time
+        T t_;
+
+        // Last attempted step
+        Step attempt_;
+        // First stage at the current value and time, and the argument and value of the last stage of the last attempt
+        Vector first_stage_, last_argument_, last_stage_;
+        bool first_stage_valid_{false};
+    };
+
     /**
      * @brief Utility function to create RungeKutta class using template deduction
      * @param tableau One of the possible Runge-Kutta tableaus (see \ref allpix::tableau)
@@ -229,6 +520,27 @@ namespace allpix {
     RungeKutta<T, S, D> make_runge_kutta(const Eigen::Matrix<T, S + 2, S>& tableau, Args&&... args) {
         return RungeKutta<T, S, D>(tableau, std::forward<Args>(args)...);
     }
+
+    /**
+     * @brief Utility function to create StaticRungeKutta class using template deduction
+     * @param tableau One of the tableaus known at compile time (see \ref allpix::tableau::StaticTableau)
+     * @param function Step function to perform integration
+     * @param step_size Time step of the integration
+     * @param initial_y Start values of the vector to perform integration on
+     * @param initial_t Initial time at the start of the integration
+     * @return Instantiation of \ref StaticRungeKutta class for the tableau and the type of the step function
+     */
+    template <class Tableau,
+              class Function,
+              typename T,
+              int D,
+              typename = std::enable_if_t<std::is_base_of_v<tableau::StaticTableau, Tableau>>>
+    StaticRungeKutta<T, Tableau, std::decay_t<Function>, D> make_runge_kutta(
+        const Tableau& tableau, Function&& function, T step_size, Eigen::Matrix<T, D, 1> initial_y, T initial_t = 0) {
+        (void)tableau;
+        return StaticRungeKutta<T, Tableau, std::decay_t<Function>, D>(
+            std::forward<Function>(function), std::move(step_size), std::move(initial_y), std::move(initial_t));
+    }
 } // namespace allpix
 
 #endif /* ALLPIX_RUNGE_KUTTA_H */
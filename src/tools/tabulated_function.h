@@ -0,0 +1,160 @@
+/**
+ * @file
+ * @brief Utility to tabulate functions of one or two variables with a bounded interpolation error
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef ALLPIX_TABULATED_FUNCTION_H
+#define ALLPIX_TABULATED_FUNCTION_H
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace allpix {
+    /**
+     * @brief Class to tabulate a function of one or two variables on a regular grid within a defined range
+     *
+     * The function is sampled at the grid points and interpolated linearly in between. Starting from a coarse grid, the
+     * number of points along each axis is doubled until the interpolation at the centers between neighboring grid points
+     * along this axis deviates by at most the requested precision from the function. The deviation is taken relative to the
+     * absolute function value, but at least to a millionth of the largest absolute tabulated value to allow for functions
+     * crossing zero. The refinement of an axis stops at the maximum number of points, and the precision which was actually
+     * reached is available from \ref getPrecision.
+     *
+     * As for \ref TabulatedPow, only the derived grid cell is clamped to the tabulated range, such that values outside of
+     * the range are extrapolated linearly from the closest cell.
+     */
+    class TabulatedFunction {
+    public:
+        /**
+         * @brief Construct an empty table, to be assigned before use
+         */
+        TabulatedFunction() = default;
+
+        /**
+         * @brief Tabulate a function of two variables
+         * @param function   Function to be tabulated, called with the two variables
+         * @param x_range    Minimum and maximum of the first variable
+         * @param y_range    Minimum and maximum of the second variable, the function is tabulated in the first variable
+         *                   only if both are equal
+         * @param precision  Maximum relative deviation of the interpolation from the function
+         * @param max_points Maximum number of grid points along each axis
+         */
+        template <typename F>
+        TabulatedFunction(
+            F function, std::array<double, 2> x_range, std::array<double, 2> y_range, double precision, size_t max_points)
+            : x_min_(x_range[0]), y_min_(y_range[0]) {
+            assert(x_range[0] < x_range[1] && y_range[0] <= y_range[1] && max_points >= 3);
+
+            auto two_dimensional = (y_range[0] < y_range[1]);
+            size_t nx = 17, ny = (two_dimensional ? 17 : 1);
+            while(true) {
+                nx_ = nx;
+                ny_ = ny;
+                dx_ = (x_range[1] - x_range[0]) / static_cast<double>(nx_ - 1);
+                dy_ = (two_dimensional ? (y_range[1] - y_range[0]) / static_cast<double>(ny_ - 1) : 1.);
+
+                // Sample the function at the grid points
+                table_.resize(nx_ * ny_);
+                double max_value = 0;
+                for(size_t j = 0; j < ny_; ++j) {
+                    for(size_t i = 0; i < nx_; ++i) {
+                        table_[j * nx_ + i] = function(x_coordinate(i), y_coordinate(j));
+                        max_value = std::max(max_value, std::fabs(table_[j * nx_ + i]));
+                    }
+                }
+
+                // Compare the interpolation with the function at the centers between grid points along each axis
+                auto deviation = [&](double x, double y) {
+                    auto value = function(x, y);
+                    return std::fabs((*this)(x, y) - value) / std::max(std::fabs(value), 1e-6 * max_value);
+                };
+                double deviation_x = 0, deviation_y = 0;
+                for(size_t j = 0; j < ny_; ++j) {
+                    for(size_t i = 0; i + 1 < nx_; ++i) {
+                        deviation_x = std::max(deviation_x, deviation(x_coordinate(i) + dx_ / 2, y_coordinate(j)));
+                    }
+                }
+                for(size_t j = 0; j + 1 < ny_; ++j) {
+                    for(size_t i = 0; i < nx_; ++i) {
+                        deviation_y = std::max(deviation_y, deviation(x_coordinate(i), y_coordinate(j) + dy_ / 2));
+                    }
+                }
+                precision_ = std::max(deviation_x, deviation_y);
+
+                // Refine the axes which exceed the precision, as long as they have not reached the maximum size
+                auto refine_x = (deviation_x > precision && 2 * nx_ - 1 <= max_points);
+                auto refine_y = (deviation_y > precision && 2 * ny_ - 1 <= max_points);
+                if(!refine_x && !refine_y) {
+                    break;
+                }
+                nx = (refine_x ? 2 * nx_ - 1 : nx_);
+                ny = (refine_y ? 2 * ny_ - 1 : ny_);
+            }
+        }
+
+        /**
+         * @brief Tabulate a function of a single variable
+         * @param function   Function to be tabulated, called with the variable
+         * @param range      Minimum and maximum of the variable
+         * @param precision  Maximum relative deviation of the interpolation from the function
+         * @param max_points Maximum number of grid points
+         */
+        template <typename F>
+        TabulatedFunction(F function, std::array<double, 2> range, double precision, size_t max_points)
+            : TabulatedFunction([&](double x, double) { return function(x); }, range, {0., 0.}, precision, max_points) {}
+
+        /**
+         * @brief Get the interpolated function value
+         * @param x Value of the first variable
+         * @param y Value of the second variable, ignored for functions of a single variable
+         * @return Interpolated function value
+         */
+        inline double operator()(double x, double y = 0) const noexcept {
+            double pos_x = (x - x_min_) / dx_;
+            auto idx_x = static_cast<size_t>(std::clamp(pos_x, 0., static_cast<double>(nx_ - 2)));
+            double tmp_x = pos_x - static_cast<double>(idx_x);
+            if(ny_ == 1) {
+                return table_[idx_x] * (1 - tmp_x) + tmp_x * table_[idx_x + 1];
+            }
+
+            double pos_y = (y - y_min_) / dy_;
+            auto idx_y = static_cast<size_t>(std::clamp(pos_y, 0., static_cast<double>(ny_ - 2)));
+            double tmp_y = pos_y - static_cast<double>(idx_y);
+            const auto* row = &table_[idx_y * nx_ + idx_x];
+            return (row[0] * (1 - tmp_x) + tmp_x * row[1]) * (1 - tmp_y) +
+                   (row[nx_] * (1 - tmp_x) + tmp_x * row[nx_ + 1]) * tmp_y;
+        }
+
+        /**
+         * @brief Get the maximum relative deviation of the interpolation from the function found during the tabulation
+         */
+        double getPrecision() const { return precision_; }
+
+        /**
+         * @brief Get the number of grid points along both axes
+         */
+        std::array<size_t, 2> getSize() const { return {{nx_, ny_}}; }
+
+    private:
+        double x_coordinate(size_t i) const { return x_min_ + dx_ * static_cast<double>(i); }
+        double y_coordinate(size_t j) const { return y_min_ + dy_ * static_cast<double>(j); }
+
+        std::vector<double> table_;
+        size_t nx_{2}, ny_{1};
+        double x_min_{}, y_min_{};
+        double dx_{1.}, dy_{1.};
+        double precision_{};
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_TABULATED_FUNCTION_H */
@@ -26,12 +26,13 @@ template <typename T> static void print_info(allpix::FieldData<T> field_data, si
               << std::endl;
     std::cout << "Dimensions: " << field_data.getDimensions()[0] << " x " << field_data.getDimensions()[1] << " x "
               << field_data.getDimensions()[2] << " cells" << std::endl;
-    std::cout << "Field vector with " << field_data.getData()->size() << " entries" << std::endl;
+    auto values = field_data.getValues();
+    std::cout << "Field vector with " << values.size() << " entries" << std::endl;
 
     if(n > 0) {
         std::cout << "First " << n << " entries of field data:" << std::endl;
-        for(size_t i = 0; i < field_data.getData()->size() && i < n; i++) {
-            std::cout << Units::display(field_data.getData()->at(i), units) << " ";
+        for(size_t i = 0; i < values.size() && i < n; i++) {
+            std::cout << Units::display(values[i], units) << " ";
         }
         std::cout << std::endl;
     }
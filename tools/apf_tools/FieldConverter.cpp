@@ -1,6 +1,6 @@
 /**
  * @file
- * @brief Small converter for field data INIT <-> APF
+ * @brief Converter for field data between the INIT, APF, APF2 and APFZ formats, with resampling and symmetry folding
  *
  * @copyright Copyright (c) 2019-2024 CERN and the Allpix Squared authors.
  * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
@@ -10,15 +10,195 @@
  */
 
 #include <algorithm>
+#include <array>
+#include <cmath>
 #include <fstream>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "core/utils/log.h"
+#include "core/utils/text.h"
 #include "tools/field_parser.h"
 #include "tools/units.h"
 
 using namespace allpix;
 
+namespace {
+    /**
+     * @brief Field values at the centers of a regular grid of cells, with the z index running fastest
+     */
+    struct Grid {
+        std::array<size_t, 3> bins;
+        size_t components;
+        std::vector<double> values;
+
+        const double* cell(size_t x, size_t y, size_t z) const {
+            return &values[((x * bins[1] + y) * bins[2] + z) * components];
+        }
+        double* cell(size_t x, size_t y, size_t z) { return &values[((x * bins[1] + y) * bins[2] + z) * components]; }
+    };
+
+    /**
+     * @brief Interpolate the grid trilinearly between the cell centers, clamped to the outermost cells
+     * @param grid     Grid to interpolate
+     * @param position Position relative to the extent of the grid, in the range [0, 1] in every coordinate
+     * @param result   Interpolated value with all components of the grid
+     *
+     * This is the same interpolation as applied to field grids by the framework.
+     */
+    void interpolate(const Grid& grid, const std::array<double, 3>& position, double* result) {
+        std::array<size_t, 3> low{}, high{};
+        std::array<double, 3> frac{};
+        for(size_t dim = 0; dim < 3; ++dim) {
+            if(grid.bins[dim] == 1) {
+                continue;
+            }
+            auto center = position[dim] * static_cast<double>(grid.bins[dim]) - 0.5;
+            auto index = static_cast<int>(std::floor(center));
+            auto max_index = static_cast<int>(grid.bins[dim]) - 1;
+            frac[dim] = center - index;
+            low[dim] = static_cast<size_t>(std::clamp(index, 0, max_index));
+            high[dim] = static_cast<size_t>(std::clamp(index + 1, 0, max_index));
+        }
+
+        std::fill(result, result + grid.components, 0.);
+        for(size_t corner = 0; corner < 8; ++corner) {
+            auto weight = ((corner & 4U) != 0 ? frac[0] : 1. - frac[0]) * ((corner & 2U) != 0 ? frac[1] : 1. - frac[1]) *
+                          ((corner & 1U) != 0 ? frac[2] : 1. - frac[2]);
+            if(weight == 0.) {
+                continue;
+            }
+            const auto* cell = grid.cell(((corner & 4U) != 0 ? high[0] : low[0]),
+                                         ((corner & 2U) != 0 ? high[1] : low[1]),
+                                         ((corner & 1U) != 0 ? high[2] : low[2]));
+            for(size_t i = 0; i < grid.components; ++i) {
+                result[i] += weight * cell[i];
+            }
+        }
+    }
+
+    /**
+     * @brief Fold the grid onto its upper half along x and/or y by averaging it with its mirror image
+     * @param grid   Grid to fold, with an even number of bins along the folded coordinates
+     * @param fold_x Fold along x, keeping the half with positive x
+     * @param fold_y Fold along y, keeping the half with positive y
+     * @return Folded grid
+     *
+     * The x and y components of vector fields change their sign when mirrored along the respective coordinate.
+     */
+    Grid fold(const Grid& grid, bool fold_x, bool fold_y) {
+        const std::array<bool, 2> folded{{fold_x, fold_y}};
+        for(size_t dim = 0; dim < 2; ++dim) {
+            if(folded[dim] && (grid.bins[dim] % 2 != 0 || grid.bins[dim] < 2)) {
+                throw std::invalid_argument("cannot fold field along " + std::string(dim == 0 ? "x" : "y") + " with " +
+                                            std::to_string(grid.bins[dim]) + " bins, an even number of bins is required");
+            }
+        }
+
+        Grid result{{fold_x ? grid.bins[0] / 2 : grid.bins[0], fold_y ? grid.bins[1] / 2 : grid.bins[1], grid.bins[2]},
+                    grid.components,
+                    {}};
+        result.values.resize(result.bins[0] * result.bins[1] * result.bins[2] * result.components);
+
+        // Average all mirror images of every cell of the kept part
+        auto mirrors = (fold_x ? 2U : 1U) * (fold_y ? 2U : 1U);
+        for(size_t x = 0; x < result.bins[0]; ++x) {
+            for(size_t y = 0; y < result.bins[1]; ++y) {
+                for(size_t z = 0; z < result.bins[2]; ++z) {
+                    auto* value = result.cell(x, y, z);
+                    for(unsigned int mirror = 0; mirror < mirrors; ++mirror) {
+                        auto mirror_x = fold_x && (mirror & 1U) != 0;
+                        auto mirror_y = fold_y && (mirror & (fold_x ? 2U : 1U)) != 0;
+                        auto source_x = (fold_x ? (mirror_x ? result.bins[0] - 1 - x : result.bins[0] + x) : x);
+                        auto source_y = (fold_y ? (mirror_y ? result.bins[1] - 1 - y : result.bins[1] + y) : y);
+                        const auto* source = grid.cell(source_x, source_y, z);
+                        for(size_t i = 0; i < grid.components; ++i) {
+                            auto flip = (grid.components == 3 && ((i == 0 && mirror_x) || (i == 1 && mirror_y)));
+                            value[i] += (flip ? -source[i] : source[i]) / mirrors;
+                        }
+                    }
+                }
+            }
+        }
+        return result;
+    }
+
+    /**
+     * @brief Resample the grid with a different number of bins by interpolating between the cell centers
+     * @param grid Grid to resample
+     * @param bins Number of bins of the resampled grid
+     * @return Resampled grid with the same extent
+     */
+    Grid resample(const Grid& grid, const std::array<size_t, 3>& bins) {
+        Grid result{bins, grid.components, {}};
+        result.values.resize(bins[0] * bins[1] * bins[2] * grid.components);
+        for(size_t x = 0; x < bins[0]; ++x) {
+            for(size_t y = 0; y < bins[1]; ++y) {
+                for(size_t z = 0; z < bins[2]; ++z) {
+                    std::array<double, 3> position{{(static_cast<double>(x) + 0.5) / static_cast<double>(bins[0]),
+                                                    (static_cast<double>(y) + 0.5) / static_cast<double>(bins[1]),
+                                                    (static_cast<double>(z) + 0.5) / static_cast<double>(bins[2])}};
+                    interpolate(grid, position, result.cell(x, y, z));
+                }
+            }
+        }
+        return result;
+    }
+
+    /**
+     * @brief Report the deviation of the converted field from the original field at all original cell centers
+     * @param original  Original grid
+     * @param converted Converted grid, folded along the given coordinates
+     * @param fold_x    Converted grid is folded along x
+     * @param fold_y    Converted grid is folded along y
+     */
+    void report_deviation(const Grid& original, const Grid& converted, bool fold_x, bool fold_y) {
+        std::vector<double> value(original.components);
+        double max_norm = 0, max_deviation = 0, sum_deviation2 = 0;
+        for(size_t x = 0; x < original.bins[0]; ++x) {
+            for(size_t y = 0; y < original.bins[1]; ++y) {
+                for(size_t z = 0; z < original.bins[2]; ++z) {
+                    std::array<double, 3> position{{(static_cast<double>(x) + 0.5) / static_cast<double>(original.bins[0]),
+                                                    (static_cast<double>(y) + 0.5) / static_cast<double>(original.bins[1]),
+                                                    (static_cast<double>(z) + 0.5) / static_cast<double>(original.bins[2])}};
+
+                    // Map the position onto the folded part of the converted grid
+                    auto mirror_x = fold_x && position[0] < 0.5;
+                    auto mirror_y = fold_y && position[1] < 0.5;
+                    if(fold_x) {
+                        position[0] = std::fabs(2 * position[0] - 1);
+                    }
+                    if(fold_y) {
+                        position[1] = std::fabs(2 * position[1] - 1);
+                    }
+                    interpolate(converted, position, value.data());
+
+                    const auto* reference = original.cell(x, y, z);
+                    double norm2 = 0, deviation2 = 0;
+                    for(size_t i = 0; i < original.components; ++i) {
+                        auto flip = (original.components == 3 && ((i == 0 && mirror_x) || (i == 1 && mirror_y)));
+                        auto difference = (flip ? -value[i] : value[i]) - reference[i];
+                        norm2 += reference[i] * reference[i];
+                        deviation2 += difference * difference;
+                    }
+                    max_norm = std::max(max_norm, std::sqrt(norm2));
+                    max_deviation = std::max(max_deviation, std::sqrt(deviation2));
+                    sum_deviation2 += deviation2;
+                }
+            }
+        }
+
+        auto cells = static_cast<double>(original.bins[0] * original.bins[1] * original.bins[2]);
+        auto rms_deviation = std::sqrt(sum_deviation2 / cells);
+        auto relative = [max_norm](double deviation) { return (max_norm > 0 ? 100. * deviation / max_norm : 0.); };
+        LOG(STATUS) << "Deviation from the original field at its " << cells << " cell centers:" << std::endl
+                    << "  maximum: " << max_deviation << " (" << relative(max_deviation) << "% of the largest value)"
+                    << std::endl
+                    << "  RMS:     " << rms_deviation << " (" << relative(rms_deviation) << "% of the largest value)";
+    }
+} // namespace
+
 /**
  * @brief Main function running the application
  */
@@ -46,6 +226,11 @@ int main(int argc, const char* argv[]) {
         std::string file_output;
         std::string units;
         bool scalar = false;
+        bool single = false;
+        std::vector<size_t> bins;
+        bool fold_x = false;
+        bool fold_y = false;
+        bool report = false;
         for(int i = 1; i < argc; i++) {
             if(strcmp(argv[i], "-h") == 0) {
                 print_help = true;
@@ -59,7 +244,11 @@ int main(int argc, const char* argv[]) {
             } else if(strcmp(argv[i], "--to") == 0 && (i + 1 < argc)) {
                 std::string format = std::string(argv[++i]);
                 std::transform(format.begin(), format.end(), format.begin(), ::tolower);
-                format_to = (format == "init" ? FileType::INIT : format == "apf" ? FileType::APF : FileType::UNKNOWN);
+                format_to = (format == "init"   ? FileType::INIT
+                             : format == "apf"  ? FileType::APF
+                             : format == "apf2" ? FileType::APF2
+                             : format == "apfz" ? FileType::APFZ
+                                                : FileType::UNKNOWN);
             } else if(strcmp(argv[i], "--input") == 0 && (i + 1 < argc)) {
                 file_input = std::string(argv[++i]);
             } else if(strcmp(argv[i], "--output") == 0 && (i + 1 < argc)) {
@@ -68,6 +257,22 @@ int main(int argc, const char* argv[]) {
                 units = std::string(argv[++i]);
             } else if(strcmp(argv[i], "--scalar") == 0) {
                 scalar = true;
+            } else if(strcmp(argv[i], "--single") == 0) {
+                single = true;
+            } else if(strcmp(argv[i], "--resample") == 0 && (i + 1 < argc)) {
+                bins = split<size_t>(std::string(argv[++i]));
+            } else if(strcmp(argv[i], "--fold") == 0 && (i + 1 < argc)) {
+                std::string axes = std::string(argv[++i]);
+                std::transform(axes.begin(), axes.end(), axes.begin(), ::tolower);
+                fold_x = (axes.find('x') != std::string::npos);
+                fold_y = (axes.find('y') != std::string::npos);
+                if(axes.find_first_not_of("xy") != std::string::npos || (!fold_x && !fold_y)) {
+                    LOG(ERROR) << "Invalid folding axes \"" << axes << "\", expected x, y or xy";
+                    print_help = true;
+                    return_code = 1;
+                }
+            } else if(strcmp(argv[i], "--report") == 0) {
+                report = true;
             } else {
                 LOG(ERROR) << "Unrecognized command line argument \"" << argv[i] << "\"";
                 print_help = true;
@@ -88,6 +293,12 @@ int main(int argc, const char* argv[]) {
             std::cout << "  --units <units>  units the field is provided in" << std::endl << std::endl;
             std::cout << "Options:" << std::endl;
             std::cout << "  --scalar         Convert scalar field. Default is vector field" << std::endl;
+            std::cout << "  --single         Store values with single precision, only for APF2 and APFZ output" << std::endl;
+            std::cout << "  --resample <bins> Interpolate the field to a grid with the given number of bins in x, y and z" << std::endl;
+            std::cout << "  --fold <axes>    Average the field with its mirror image along x, y or xy and only store the"
+                      << std::endl;
+            std::cout << "                   half or quadrant with positive coordinates" << std::endl;
+            std::cout << "  --report         Report the deviation of the output from the input field" << std::endl;
             std::cout << std::endl;
             std::cout << "For more help, please see <https://cern.ch/allpix-squared>" << std::endl;
             return return_code;
@@ -98,9 +309,67 @@ int main(int argc, const char* argv[]) {
         FieldParser<double> field_parser(quantity);
         LOG(STATUS) << "Reading input file from " << file_input;
         auto field_data = field_parser.getByFileName(file_input, units);
-        FieldWriter<double> field_writer(quantity);
+
+        if(!bins.empty() && bins.size() != 3) {
+            throw std::invalid_argument("resampling requires the number of bins in x, y and z");
+        }
+        if(std::find(bins.begin(), bins.end(), 0) != bins.end()) {
+            throw std::invalid_argument("resampling requires at least one bin in every coordinate");
+        }
+
+        if(!bins.empty() || fold_x || fold_y || report) {
+            auto values = field_data.getValues();
+            Grid original{field_data.getDimensions(), static_cast<size_t>(quantity), {values.begin(), values.end()}};
+            auto size = field_data.getSize();
+
+            // Fold first such that the resampled bins refer to the stored part of the field
+            auto converted = original;
+            if(fold_x || fold_y) {
+                converted = fold(converted, fold_x, fold_y);
+                size[0] /= (fold_x ? 2 : 1);
+                size[1] /= (fold_y ? 2 : 1);
+                LOG(STATUS) << "Folded field along " << (fold_x ? "x" : "") << (fold_y ? "y" : "") << ", use field mapping "
+                            << (fold_x && fold_y ? "PIXEL_QUADRANT_I" : fold_x ? "PIXEL_HALF_RIGHT" : "PIXEL_HALF_TOP")
+                            << " for the output file";
+            }
+            if(!bins.empty()) {
+                converted = resample(converted, {{bins[0], bins[1], bins[2]}});
+                LOG(STATUS) << "Resampled field to " << bins[0] << "x" << bins[1] << "x" << bins[2] << " bins";
+            }
+
+            // Apply the precision of the output before comparing to the original field
+            if(single && (format_to == FileType::APF2 || format_to == FileType::APFZ)) {
+                for(auto& value : converted.values) {
+                    value = static_cast<double>(static_cast<float>(value));
+                }
+            }
+            if(report) {
+                report_deviation(original, converted, fold_x, fold_y);
+            }
+
+            field_data = FieldData<double>(field_data.getHeader(),
+                                           converted.bins,
+                                           size,
+                                           std::make_shared<std::vector<double>>(std::move(converted.values)));
+        }
+
         LOG(STATUS) << "Writing output file to " << file_output;
-        field_writer.writeFile(field_data, file_output, format_to, (format_to == FileType::INIT ? units : ""));
+        if(single && (format_to == FileType::APF2 || format_to == FileType::APFZ)) {
+            // Convert the values to single precision, such that single precision parsers read them without conversion
+            auto values = field_data.getValues();
+            FieldData<float> field_data_single(field_data.getHeader(),
+                                               field_data.getDimensions(),
+                                               field_data.getSize(),
+                                               std::make_shared<std::vector<float>>(values.begin(), values.end()));
+            FieldWriter<float> field_writer(quantity);
+            field_writer.writeFile(field_data_single, file_output, format_to);
+        } else {
+            if(single) {
+                LOG(WARNING) << "Single precision is only supported for APF2 and APFZ output, writing double precision";
+            }
+            FieldWriter<double> field_writer(quantity);
+            field_writer.writeFile(field_data, file_output, format_to, (format_to == FileType::INIT ? units : ""));
+        }
     } catch(std::exception& e) {
         LOG(FATAL) << "Fatal internal error" << std::endl << e.what() << std::endl << "Cannot continue.";
         return_code = 127;
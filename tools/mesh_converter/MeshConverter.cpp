@@ -9,6 +9,8 @@
  */
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cfloat>
 #include <chrono>
 #include <climits>
@@ -16,6 +18,7 @@
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <string>
 #include <utility>
@@ -36,6 +39,7 @@
 #include "tools/units.h"
 
 #include "MeshElement.hpp"
+#include "MeshLocator.hpp"
 #include "MeshParser.hpp"
 #include "combinations/combinations.h"
 #include "octree/Octree.hpp"
@@ -212,6 +216,7 @@ int main(int argc, char** argv) {
         const auto allow_decay = config.get<bool>("allow_coplanar_interpolation", false);
         const auto radius_step = config.get<double>("radius_step", 0.5);
         const auto volume_cut = config.get<double>("volume_cut", 10e-9);
+        const auto use_mesh_elements = config.get<bool>("use_mesh_elements", false);
 
         // Swapping elements
         auto rot = config.getArray<std::string>("xyz", {"x", "y", "z"});
@@ -353,8 +358,23 @@ int main(int argc, char** argv) {
         unibn::Octree<Point> octree;
         octree.initialize(points);
 
+        // Initializing the point location in the mesh elements if requested
+        std::unique_ptr<MeshLocator> locator;
+        if(interpolate && use_mesh_elements) {
+            auto elements = parser->getElements(grid_file, regions);
+            if(elements.empty()) {
+                throw allpix::InvalidValueError(
+                    config, "use_mesh_elements", "input mesh does not provide any tetrahedra or triangles");
+            }
+            std::array<double, 3> origin{{minx, miny, minz}};
+            std::array<double, 3> step{{xstep, ystep, zstep}};
+            std::array<unsigned int, 3> grid_divisions{{divisions.x(), divisions.y(), divisions.z()}};
+            locator = std::make_unique<MeshLocator>(&points, &field, elements, dimension, origin, step, grid_divisions);
+        }
+        std::atomic<unsigned int> mesh_points_outside{0};
+
         unsigned int mesh_points_done = 0;
-        auto mesh_section = [&](double x, double y) {
+        auto mesh_section = [&](unsigned int i, unsigned int j, double x, double y) {
             Log::setReportingLevel(log_level);
 
             // New mesh slice
@@ -374,6 +394,18 @@ int main(int argc, char** argv) {
                     continue;
                 }
 
+                // Interpolate within the mesh element containing the point, use the neighbor search only outside of all
+                // mesh elements
+                if(locator != nullptr) {
+                    if(locator->interpolate({{i, j, k}}, q, e)) {
+                        new_mesh.push_back(e);
+                        z += zstep;
+                        continue;
+                    }
+                    LOG(DEBUG) << "No mesh element contains " << q << ", using neighbor search";
+                    mesh_points_outside++;
+                }
+
                 bool valid = false;
                 bool allow_zero_volume = false;
                 size_t prev_neighbours = 0;
@@ -488,7 +520,7 @@ int main(int argc, char** argv) {
         for(unsigned int i = 0; i < divisions.x(); ++i) {
             double y = miny + ystep / 2.0;
             for(unsigned int j = 0; j < divisions.y(); ++j) {
-                mesh_futures.push_back(pool.submit(mesh_section, x, y));
+                mesh_futures.push_back(pool.submit(mesh_section, i, j, x, y));
                 y += ystep;
             }
             x += xstep;
@@ -500,6 +532,10 @@ int main(int argc, char** argv) {
             e_field_new_mesh.insert(e_field_new_mesh.end(), mesh_slice.begin(), mesh_slice.end());
         }
         pool.destroy();
+        if(mesh_points_outside > 0) {
+            LOG(WARNING) << mesh_points_outside << " grid points are not contained in any mesh element and have been "
+                         << "interpolated using the neighbor search";
+        }
 
         end = std::chrono::system_clock::now();
         elapsed_seconds = std::chrono::duration_cast<std::chrono::seconds>(end - start).count();
@@ -0,0 +1,121 @@
+/**
+ * @file
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "MeshLocator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include "core/utils/log.h"
+
+using namespace mesh_converter;
+
+MeshLocator::MeshLocator(const std::vector<Point>* points,
+                         const std::vector<Point>* field,
+                         const std::vector<std::vector<size_t>>& elements,
+                         size_t dimension,
+                         const std::array<double, 3>& origin,
+                         const std::array<double, 3>& step,
+                         const std::array<unsigned int, 3>& divisions)
+    : points_(points), field_(field), dimension_(dimension), divisions_(divisions) {
+    if(elements.size() > std::numeric_limits<unsigned int>::max()) {
+        throw std::runtime_error("Too many mesh elements for the point location");
+    }
+
+    // Store the vertices of all elements
+    vertices_.reserve(elements.size());
+    for(const auto& element : elements) {
+        if(element.size() != dimension_ + 1) {
+            throw std::runtime_error("Mesh element with " + std::to_string(element.size()) + " vertices is not a simplex");
+        }
+        std::array<size_t, 4> vertices{};
+        std::copy(element.begin(), element.end(), vertices.begin());
+        vertices_.push_back(vertices);
+    }
+
+    // Range of the grid points within the bounding box of an element, the first coordinate is ignored in 2D
+    auto get_range = [&](const std::array<size_t, 4>& vertices, size_t coordinate) {
+        if(dimension_ == 2 && coordinate == 0) {
+            return std::make_pair(0, 0);
+        }
+        auto lo = std::numeric_limits<double>::max();
+        auto hi = std::numeric_limits<double>::lowest();
+        for(size_t v = 0; v < dimension_ + 1; ++v) {
+            const auto& point = (*points_)[vertices[v]];
+            auto value = (coordinate == 0 ? point.x : coordinate == 1 ? point.y : point.z);
+            lo = std::min(lo, value);
+            hi = std::max(hi, value);
+        }
+        auto first = std::max(0., std::ceil((lo - origin[coordinate]) / step[coordinate] - 0.5));
+        auto last = std::min(static_cast<double>(divisions_[coordinate]) - 1,
+                             std::floor((hi - origin[coordinate]) / step[coordinate] - 0.5));
+        return std::make_pair(static_cast<int>(first), static_cast<int>(last));
+    };
+    auto for_each_grid_point = [&](const std::array<size_t, 4>& vertices, auto&& function) {
+        auto [i_first, i_last] = get_range(vertices, 0);
+        auto [j_first, j_last] = get_range(vertices, 1);
+        auto [k_first, k_last] = get_range(vertices, 2);
+        for(auto i = i_first; i <= i_last; ++i) {
+            for(auto j = j_first; j <= j_last; ++j) {
+                for(auto k = k_first; k <= k_last; ++k) {
+                    function(get_slot(
+                        static_cast<unsigned int>(i), static_cast<unsigned int>(j), static_cast<unsigned int>(k)));
+                }
+            }
+        }
+    };
+
+    // Count the elements of every grid point first to assign the elements in place afterwards
+    offsets_.assign(static_cast<size_t>(divisions_[0]) * divisions_[1] * divisions_[2] + 1, 0);
+    for(const auto& vertices : vertices_) {
+        for_each_grid_point(vertices, [&](size_t slot) { offsets_[slot + 1]++; });
+    }
+    for(size_t slot = 1; slot < offsets_.size(); ++slot) {
+        offsets_[slot] += offsets_[slot - 1];
+    }
+    elements_.resize(offsets_.back());
+    auto fill = offsets_;
+    for(size_t element = 0; element < vertices_.size(); ++element) {
+        for_each_grid_point(vertices_[element],
+                            [&](size_t slot) { elements_[fill[slot]++] = static_cast<unsigned int>(element); });
+    }
+    LOG(INFO) << "Assigned " << vertices_.size() << " mesh elements to " << (offsets_.size() - 1) << " grid points with "
+              << elements_.size() << " assignments";
+}
+
+bool MeshLocator::interpolate(const std::array<unsigned int, 3>& index, Point& q, Point& result) const {
+    auto slot = get_slot(index[0], index[1], index[2]);
+    for(auto idx = offsets_[slot]; idx < offsets_[slot + 1]; ++idx) {
+        const auto& vertices = vertices_[elements_[idx]];
+
+        std::array<Point, 4> grid_elements;
+        std::array<Point, 4> field_elements;
+        for(size_t v = 0; v < dimension_ + 1; ++v) {
+            grid_elements[v] = (*points_)[vertices[v]];
+            field_elements[v] = (*field_)[vertices[v]];
+        }
+
+        MeshElement element(dimension_, grid_elements, field_elements);
+        if(!element.isValid(0, q)) {
+            continue;
+        }
+        auto observable = element.getObservable(q);
+        if(!observable.isFinite()) {
+            LOG(TRACE) << "Interpolated result not a finite number at " << q << ", skipping degenerate element";
+            continue;
+        }
+        LOG(DEBUG) << element.print(q);
+        result = observable;
+        return true;
+    }
+    return false;
+}
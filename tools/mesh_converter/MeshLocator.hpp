@@ -0,0 +1,79 @@
+/**
+ * @file
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef ALLPIX_MESHLOCATOR_H
+#define ALLPIX_MESHLOCATOR_H
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include "MeshElement.hpp"
+
+namespace mesh_converter {
+
+    /**
+     * @brief Point location of the points of a regular grid in the simplex elements of a mesh
+     *
+     * Every element of the mesh is assigned to all points of the regular grid within its bounding box, such that only the
+     * few elements overlapping a grid point have to be tested for containing the point. The assignment is stored in a
+     * compressed layout with a single list of elements and the offsets of every grid point in this list.
+     */
+    class MeshLocator {
+    public:
+        /**
+         * @brief Constructor assigning the mesh elements to the points of the regular grid
+         * @param points     Pointer to mesh point vector
+         * @param field      Pointer to field vector
+         * @param elements   Simplex mesh elements with the indices of their vertices in the mesh points
+         * @param dimension  Dimension of the mesh, the first coordinate is not used for two-dimensional meshes
+         * @param origin     Lower corner of the regular grid
+         * @param step       Distance between two points of the regular grid in every coordinate
+         * @param divisions  Number of points of the regular grid in every coordinate
+         */
+        MeshLocator(const std::vector<Point>* points,
+                    const std::vector<Point>* field,
+                    const std::vector<std::vector<size_t>>& elements,
+                    size_t dimension,
+                    const std::array<double, 3>& origin,
+                    const std::array<double, 3>& step,
+                    const std::array<unsigned int, 3>& divisions);
+
+        /**
+         * @brief Interpolate the field barycentrically in the mesh element containing a point of the regular grid
+         * @param index  Index of the grid point in every coordinate
+         * @param q      Position of the grid point
+         * @param result Interpolated field, only set if a containing element was found
+         * @return True if a mesh element containing the grid point was found, false otherwise
+         */
+        bool interpolate(const std::array<unsigned int, 3>& index, Point& q, Point& result) const;
+
+    private:
+        /**
+         * @brief Get the index of a grid point in the offsets of the element list
+         */
+        size_t get_slot(unsigned int i, unsigned int j, unsigned int k) const {
+            return (static_cast<size_t>(i) * divisions_[1] + j) * divisions_[2] + k;
+        }
+
+        const std::vector<Point>* points_;
+        const std::vector<Point>* field_;
+        size_t dimension_;
+        std::array<unsigned int, 3> divisions_;
+
+        // Vertices of all elements, the elements overlapping every grid point and their offsets for every grid point
+        std::vector<std::array<size_t, 4>> vertices_;
+        std::vector<unsigned int> elements_;
+        std::vector<size_t> offsets_;
+    };
+
+} // namespace mesh_converter
+
+#endif // ALLPIX_MESHLOCATOR_H
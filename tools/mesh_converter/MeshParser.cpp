@@ -8,7 +8,12 @@
  * SPDX-License-Identifier: MIT
  */
 
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <exception>
 #include <iomanip>
+#include <thread>
 
 #include "MeshParser.hpp"
 
@@ -32,7 +37,7 @@ std::vector<Point> MeshParser::getMesh(const std::string& file, const std::vecto
     // Populate mesh map once:
     if(mesh_map_[file].empty()) {
         LOG(STATUS) << "Reading mesh grid from file \"" << file << "\"";
-        mesh_map_[file] = read_meshes(file);
+        mesh_map_[file] = read_meshes(file, element_map_[file]);
         LOG(INFO) << "Grid sizes for all regions:";
         for(auto& reg : mesh_map_[file]) {
             LOG(INFO) << "\t" << std::left << std::setw(25) << reg.first << " " << reg.second.size();
@@ -59,13 +64,47 @@ std::vector<Point> MeshParser::getMesh(const std::string& file, const std::vecto
     return points;
 }
 
+std::vector<std::vector<size_t>> MeshParser::getElements(const std::string& file,
+                                                        const std::vector<std::string>& regions) {
+    if(element_map_[file].empty()) {
+        throw std::runtime_error("No mesh elements available for grid file \"" + file + "\"");
+    }
+
+    // Append the elements of all regions, shifting their vertex indices by the points of the preceding regions:
+    std::vector<std::vector<size_t>> elements;
+    size_t offset = 0;
+    for(const auto& region : regions) {
+        auto region_elements = element_map_[file].find(region);
+        if(region_elements != element_map_[file].end()) {
+            for(auto element : region_elements->second) {
+                for(auto& vertex : element) {
+                    vertex += offset;
+                }
+                elements.push_back(std::move(element));
+            }
+        }
+        offset += mesh_map_[file][region].size();
+    }
+    LOG(DEBUG) << "Grid with " << elements.size() << " mesh elements";
+
+    return elements;
+}
+
 std::vector<Point>
 MeshParser::getField(const std::string& file, const std::string& observable, const std::vector<std::string>& regions) {
 
-    // Populate field map once:
-    if(field_map_[file].empty()) {
+    // Populate field map once for every observable, parsers may only read the requested observable:
+    auto& cached_fields = field_map_[file];
+    auto cached = std::any_of(cached_fields.begin(), cached_fields.end(), [&](const auto& region_fields) {
+        return region_fields.second.find(observable) != region_fields.second.end();
+    });
+    if(!cached) {
         LOG(STATUS) << "Reading field from file \"" << file << "\"";
-        field_map_[file] = read_fields(file, observable);
+        for(auto& [region, fields] : read_fields(file, observable)) {
+            for(auto& [name, values] : fields) {
+                cached_fields[region][name] = std::move(values);
+            }
+        }
         LOG(INFO) << "Field sizes for all regions and observables:";
         for(auto& reg : field_map_[file]) {
             LOG(INFO) << " " << reg.first << ":";
@@ -97,3 +136,100 @@ MeshParser::getField(const std::string& file, const std::string& observable, con
 
     return field;
 }
+
+std::streamoff MeshParser::get_file_size(std::ifstream& file) {
+    file.seekg(0, std::ios::end);
+    auto file_size = static_cast<std::streamoff>(file.tellg());
+    file.clear();
+    file.seekg(0, std::ios::beg);
+    return file_size;
+}
+
+long long MeshParser::get_progress(std::ifstream& file, std::streamoff file_size) {
+    auto position = static_cast<std::streamoff>(file.tellg());
+    if(file_size <= 0 || position < 0) {
+        return 100;
+    }
+    return static_cast<long long>(100 * position / file_size);
+}
+
+void MeshParser::parse_numbers(const std::string& block, std::vector<double>& values) {
+    auto is_space = [](char c) { return std::isspace(static_cast<unsigned char>(c)) != 0; };
+
+    // Split the block into ranges of full numbers
+    const char* block_begin = block.data();
+    const char* block_end = block_begin + block.size();
+    auto ranges = std::max<size_t>(block.size() / parse_block_size_, 1);
+    std::vector<const char*> bounds(ranges + 1, block_end);
+    bounds[0] = block_begin;
+    for(size_t range = 1; range < ranges; ++range) {
+        const auto* target = std::max(block_begin + range * parse_block_size_, bounds[range - 1]);
+        bounds[range] = std::find_if(target, block_end, is_space);
+    }
+
+    // Parse the ranges in parallel, every thread handling every n-th range
+    std::vector<std::vector<double>> range_values(ranges);
+    auto parse_range = [&](size_t range) {
+        const auto* pos = bounds[range];
+        const auto* end = bounds[range + 1];
+        auto& parsed = range_values[range];
+        parsed.reserve(static_cast<size_t>(end - pos) / 8);
+        while(true) {
+            pos = std::find_if_not(pos, end, is_space);
+            if(pos == end) {
+                break;
+            }
+            // Explicit positive signs are not accepted by from_chars
+            if(*pos == '+') {
+                ++pos;
+            }
+            double value = 0;
+            auto [ptr, ec] = std::from_chars(pos, end, value);
+            if(ec != std::errc() || (ptr != end && !is_space(*ptr))) {
+                throw std::runtime_error("invalid number in data block");
+            }
+            parsed.push_back(value);
+            pos = ptr;
+        }
+    };
+
+    auto threads_count = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1U), ranges);
+    if(threads_count == 1) {
+        for(size_t range = 0; range < ranges; ++range) {
+            parse_range(range);
+        }
+    } else {
+        std::vector<std::exception_ptr> exceptions(threads_count);
+        std::vector<std::thread> threads;
+        threads.reserve(threads_count);
+        for(size_t thread = 0; thread < threads_count; ++thread) {
+            threads.emplace_back([&, thread]() {
+                try {
+                    for(size_t range = thread; range < ranges; range += threads_count) {
+                        parse_range(range);
+                    }
+                } catch(...) {
+                    exceptions[thread] = std::current_exception();
+                }
+            });
+        }
+        for(auto& thread : threads) {
+            thread.join();
+        }
+        for(auto& exception : exceptions) {
+            if(exception) {
+                std::rethrow_exception(exception);
+            }
+        }
+    }
+
+    // Append the numbers of all ranges in order
+    size_t total = 0;
+    for(const auto& parsed : range_values) {
+        total += parsed.size();
+    }
+    values.reserve(values.size() + total);
+    for(const auto& parsed : range_values) {
+        values.insert(values.end(), parsed.begin(), parsed.end());
+    }
+}
@@ -14,6 +14,7 @@
 #include "MeshElement.hpp"
 #include "core/config/Configuration.hpp"
 
+#include <fstream>
 #include <map>
 #include <memory>
 #include <string>
@@ -23,6 +24,7 @@ namespace mesh_converter {
 
     using MeshMap = std::map<std::string, std::vector<Point>>;
     using FieldMap = std::map<std::string, std::map<std::string, std::vector<Point>>>;
+    using ElementMap = std::map<std::string, std::vector<std::vector<size_t>>>;
 
     /**
      * @brief Parser class to read different data formats
@@ -39,6 +41,14 @@ namespace mesh_converter {
         std::vector<Point>
         getField(const std::string& file, const std::string& observable, const std::vector<std::string>& regions);
 
+        /**
+         * @brief Get the simplex mesh elements of the given regions
+         * @param  file    Canonical path of the grid file, which has to be read with \ref getMesh before
+         * @param  regions Regions to get the mesh elements for
+         * @return         Mesh elements with the indices of their vertices in the points returned by \ref getMesh
+         */
+        std::vector<std::vector<size_t>> getElements(const std::string& file, const std::vector<std::string>& regions);
+
     protected:
         /**
          * @brief Default constructor
@@ -48,9 +58,10 @@ namespace mesh_converter {
         /**
          * @brief Method to read grids of mesh points from the given file
          * @param  file_name Canonical path of the input file
+         * @param  elements  Map to store the simplex mesh elements of all regions in, if provided by the file format
          * @return           Map with mesh points for all regions found in the file
          */
-        virtual MeshMap read_meshes(const std::string& file_name) = 0;
+        virtual MeshMap read_meshes(const std::string& file_name, ElementMap& elements) = 0;
 
         /**
          * @brief Method to read fields from the given file
@@ -60,11 +71,39 @@ namespace mesh_converter {
          */
         virtual FieldMap read_fields(const std::string& file_name, const std::string& observable) = 0;
 
+        /**
+         * @brief Get the size of a file and reset it to the start
+         * @param  file File to get the size of
+         * @return      Size of the file in bytes
+         */
+        static std::streamoff get_file_size(std::ifstream& file);
+
+        /**
+         * @brief Get the parsing progress of a file from the current position
+         * @param  file      File being parsed
+         * @param  file_size Size of the file in bytes
+         * @return           Progress in percent
+         */
+        static long long get_progress(std::ifstream& file, std::streamoff file_size);
+
+        /**
+         * @brief Parse a block of numbers separated by whitespace in parallel
+         * @param  block  Characters of the block
+         * @param  values Vector to append the parsed numbers to, in the order of the block
+         * @throws std::runtime_error if the block contains characters which are not part of a number
+         */
+        static void parse_numbers(const std::string& block, std::vector<double>& values);
+
     private:
         // Cache of parsed meshes for all regions
         std::map<std::string, MeshMap> mesh_map_;
+        // Cache of parsed mesh elements for all regions
+        std::map<std::string, ElementMap> element_map_;
         // Cache of parsed fields for all regions
         std::map<std::string, FieldMap> field_map_;
+
+        // Approximate size of the ranges of a block of numbers parsed in parallel
+        static constexpr size_t parse_block_size_ = 1 << 22;
     };
 
 } // namespace mesh_converter
@@ -10,6 +10,7 @@
 
 #include "DFISEParser.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
 #include <exception>
@@ -26,17 +27,15 @@
 
 using namespace mesh_converter;
 
-MeshMap DFISEParser::read_meshes(const std::string& file_name) {
+MeshMap DFISEParser::read_meshes(const std::string& file_name, ElementMap& region_elements) {
     std::ifstream file(file_name);
     if(!file) {
         throw std::runtime_error("file cannot be accessed");
     }
 
-    // Get the total number of lines to parse and reset file to the start:
-    auto num_lines = std::count(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>(), '\n');
-    file.clear();
-    file.seekg(0, std::ios::beg);
-    LOG(DEBUG) << "Grid file contains " << num_lines << " lines to parse";
+    // Get the size of the file to report the parsing progress without reading the file twice:
+    auto file_size = get_file_size(file);
+    LOG(DEBUG) << "Grid file contains " << file_size << " bytes to parse";
 
     DFSection main_section = DFSection::HEADER;
     DFSection sub_section = DFSection::NONE;
@@ -46,7 +45,12 @@ MeshMap DFISEParser::read_meshes(const std::string& file_name) {
     std::vector<std::vector<long unsigned int>> faces;
     std::vector<std::vector<long unsigned int>> elements;
 
-    std::map<std::string, std::vector<long unsigned int>> regions_vertices;
+    // Vertices used by the elements of every region, marked once per vertex instead of collecting all element vertices
+    std::map<std::string, std::vector<char>> regions_vertices;
+    std::map<std::string, std::vector<long unsigned int>> regions_element_indices;
+
+    // Characters of the vertex block, parsed at once when the block is closed
+    std::string vertex_block;
 
     std::string region;
     long unsigned int dimension = 1;
@@ -58,8 +62,8 @@ MeshMap DFISEParser::read_meshes(const std::string& file_name) {
         std::getline(file, line);
 
         // Log the parsing progress:
-        if(num_lines > 0 && num_lines_parsed % 1000 == 0) {
-            LOG_PROGRESS(STATUS, "gridlines") << "Parsing grid file: " << (100 * num_lines_parsed / num_lines) << "%";
+        if(num_lines_parsed % 1000 == 0) {
+            LOG_PROGRESS(STATUS, "gridlines") << "Parsing grid file: " << get_progress(file, file_size) << "%";
         }
         num_lines_parsed++;
 
@@ -129,11 +133,24 @@ MeshMap DFISEParser::read_meshes(const std::string& file_name) {
         // Look for close of section
         if(line.find('}') != std::string::npos) {
             switch(main_section) {
-            case DFSection::VERTICES:
+            case DFSection::VERTICES: {
+                // Parse all vertex points of the block
+                std::vector<double> coordinates;
+                parse_numbers(vertex_block, coordinates);
+                vertex_block.clear();
+                vertex_block.shrink_to_fit();
+                vertices.reserve(coordinates.size() / dimension);
+                for(size_t i = 0; i + dimension <= coordinates.size(); i += dimension) {
+                    if(dimension == 3) {
+                        vertices.emplace_back(coordinates[i], coordinates[i + 1], coordinates[i + 2]);
+                    } else {
+                        vertices.emplace_back(coordinates[i], coordinates[i + 1]);
+                    }
+                }
                 if(vertices.size() != data_count) {
                     throw std::runtime_error("incorrect number of vertices");
                 }
-                break;
+            } break;
             case DFSection::EDGES:
                 if(edges.size() != data_count) {
                     throw std::runtime_error("incorrect number of vertices");
@@ -198,19 +215,9 @@ MeshMap DFISEParser::read_meshes(const std::string& file_name) {
         case DFSection::INFO:
             break;
         case DFSection::VERTICES: {
-            // Read vertex points
-            if(dimension == 3) {
-                double x = 0, y = 0, z = 0;
-                while(sstr >> x >> y >> z) {
-                    vertices.emplace_back(x, y, z);
-                }
-            }
-            if(dimension == 2) {
-                double y = 0, z = 0;
-                while(sstr >> y >> z) {
-                    vertices.emplace_back(y, z);
-                }
-            }
+            // Collect vertex points to parse the block at once
+            vertex_block += line;
+            vertex_block += '\n';
         } break;
         case DFSection::EDGES: {
             // Read edges
@@ -334,6 +341,9 @@ MeshMap DFISEParser::read_meshes(const std::string& file_name) {
                 }
             }
 
+            // Only keep every vertex of the element once
+            std::sort(element.begin(), element.end());
+            element.erase(std::unique(element.begin(), element.end()), element.end());
             elements.push_back(element);
             break;
         }
@@ -347,8 +357,12 @@ MeshMap DFISEParser::read_meshes(const std::string& file_name) {
                     throw std::runtime_error("element index is higher than number of elements");
                 }
 
-                regions_vertices[region].insert(
-                    regions_vertices[region].end(), elements[elem_idx].begin(), elements[elem_idx].end());
+                auto& region_vertices = regions_vertices[region];
+                region_vertices.resize(vertices.size(), 0);
+                for(auto& vertex_idx : elements[elem_idx]) {
+                    region_vertices[vertex_idx] = 1;
+                }
+                regions_element_indices[region].push_back(elem_idx);
             }
 
         } break;
@@ -360,11 +374,12 @@ MeshMap DFISEParser::read_meshes(const std::string& file_name) {
 
     std::map<std::string, std::vector<Point>> ret_map;
     for(auto& name_region_vertices : regions_vertices) {
-        auto region_vertices = name_region_vertices.second;
-
-        std::sort(region_vertices.begin(), region_vertices.end());
-        auto iter = std::unique(region_vertices.begin(), region_vertices.end());
-        region_vertices.erase(iter, region_vertices.end());
+        std::vector<long unsigned int> region_vertices;
+        for(long unsigned int vertex_idx = 0; vertex_idx < name_region_vertices.second.size(); ++vertex_idx) {
+            if(name_region_vertices.second[vertex_idx] != 0) {
+                region_vertices.push_back(vertex_idx);
+            }
+        }
 
         std::vector<Point> ret_vector;
         ret_vector.reserve(region_vertices.size());
@@ -373,22 +388,43 @@ MeshMap DFISEParser::read_meshes(const std::string& file_name) {
         }
 
         ret_map[name_region_vertices.first] = ret_vector;
+
+        // Store the simplices of the region with the vertex indices in the region, other element types are skipped
+        auto& simplices = region_elements[name_region_vertices.first];
+        size_t skipped_elements = 0;
+        for(auto& elem_idx : regions_element_indices[name_region_vertices.first]) {
+            const auto& element = elements[elem_idx];
+            if(element.size() != dimension + 1) {
+                skipped_elements++;
+                continue;
+            }
+
+            std::vector<size_t> simplex;
+            simplex.reserve(element.size());
+            for(auto& vertex_idx : element) {
+                simplex.push_back(static_cast<size_t>(
+                    std::lower_bound(region_vertices.begin(), region_vertices.end(), vertex_idx) - region_vertices.begin()));
+            }
+            simplices.push_back(std::move(simplex));
+        }
+        if(skipped_elements > 0) {
+            LOG(DEBUG) << "Skipped " << skipped_elements << " mesh elements of region " << name_region_vertices.first
+                       << " which are not " << (dimension == 3 ? "tetrahedra" : "triangles");
+        }
     }
 
     return ret_map;
 }
 
-FieldMap DFISEParser::read_fields(const std::string& file_name, const std::string&) {
+FieldMap DFISEParser::read_fields(const std::string& file_name, const std::string& requested_observable) {
     std::ifstream file(file_name);
     if(!file) {
         throw std::runtime_error("file cannot be accessed");
     }
 
-    // Get the total number of lines to parse and reset file to the start:
-    auto num_lines = std::count(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>(), '\n');
-    file.clear();
-    file.seekg(0, std::ios::beg);
-    LOG(DEBUG) << "Field data file contains " << num_lines << " lines to parse";
+    // Get the size of the file to report the parsing progress without reading the file twice:
+    auto file_size = get_file_size(file);
+    LOG(DEBUG) << "Field data file contains " << file_size << " bytes to parse";
 
     DFSection main_section = DFSection::HEADER;
     DFSection sub_section = DFSection::NONE;
@@ -396,6 +432,8 @@ FieldMap DFISEParser::read_fields(const std::string& file_name, const std::strin
     // std::map<std::string, std::vector<Point>> region_electric_field_map;
     std::map<std::string, std::map<std::string, std::vector<Point>>> region_electric_field_map;
     std::vector<double> region_electric_field_num;
+    // Characters of the current value block, parsed at once when the block is closed
+    std::string values_block;
 
     std::string region;
     std::string observable;
@@ -409,8 +447,8 @@ FieldMap DFISEParser::read_fields(const std::string& file_name, const std::strin
         line = allpix::trim(line);
 
         // Log the parsing progress:
-        if(num_lines > 0 && num_lines_parsed % 1000 == 0) {
-            LOG_PROGRESS(STATUS, "fieldlines") << "Parsing field data file: " << (100 * num_lines_parsed / num_lines) << "%";
+        if(num_lines_parsed % 1000 == 0) {
+            LOG_PROGRESS(STATUS, "fieldlines") << "Parsing field data file: " << get_progress(file, file_size) << "%";
         }
         num_lines_parsed++;
 
@@ -450,7 +488,11 @@ FieldMap DFISEParser::read_fields(const std::string& file_name, const std::strin
                     std::string data_type = header_data.substr(1, header_data.size() - 2);
                     LOG(DEBUG) << "Opening dataset of type " << data_type;
 
-                    if(data_type == "ElectricField") {
+                    // Skip all datasets of other observables than the requested one
+                    if(!requested_observable.empty() && data_type != requested_observable) {
+                        LOG(DEBUG) << "Skipping dataset of type " << data_type;
+                        main_section = DFSection::IGNORED;
+                    } else if(data_type == "ElectricField") {
                         main_section = DFSection::ELECTRIC_FIELD;
                     } else if(data_type == "ElectrostaticPotential") {
                         main_section = DFSection::ELECTROSTATIC_POTENTIAL;
@@ -578,6 +620,11 @@ FieldMap DFISEParser::read_fields(const std::string& file_name, const std::strin
 
         // Look for close of section
         if(line.find('}') != std::string::npos) {
+            // Parse the collected values of the block
+            if(!values_block.empty()) {
+                parse_numbers(values_block, region_electric_field_num);
+                values_block.clear();
+            }
 
             if(main_section == DFSection::ELECTROSTATIC_POTENTIAL && sub_section == DFSection::VALUES) {
                 if(data_count != region_electric_field_num.size()) {
@@ -675,11 +722,9 @@ FieldMap DFISEParser::read_fields(const std::string& file_name, const std::strin
             main_section == DFSection::DOPING_CONCENTRATION || main_section == DFSection::DONOR_CONCENTRATION ||
             main_section == DFSection::ACCEPTOR_CONCENTRATION) &&
            sub_section == DFSection::VALUES) {
-            std::stringstream sstr(line);
-            double num = NAN;
-            while(sstr >> num) {
-                region_electric_field_num.push_back(num);
-            }
+            // Collect values to parse the block at once
+            values_block += line;
+            values_block += '\n';
         }
     }
     LOG_PROGRESS(STATUS, "fieldlines") << "Parsing field data file: done.";
@@ -27,18 +27,16 @@
 
 using namespace mesh_converter;
 
-MeshMap SilvacoParser::read_meshes(const std::string& file_name) {
+MeshMap SilvacoParser::read_meshes(const std::string& file_name, ElementMap&) {
 
     std::ifstream file(file_name);
     if(!file) {
         throw std::runtime_error("file cannot be accessed");
     }
 
-    // Get the total number of lines to parse and reset file to the start:
-    auto num_lines = std::count(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>(), '\n');
-    file.clear();
-    file.seekg(0, std::ios::beg);
-    LOG(DEBUG) << "Grid file contains " << num_lines << " lines to parse";
+    // Get the size of the file to report the parsing progress without reading the file twice:
+    auto file_size = get_file_size(file);
+    LOG(DEBUG) << "Grid file contains " << file_size << " bytes to parse";
 
     std::vector<Point> vertices;
 
@@ -50,8 +48,8 @@ MeshMap SilvacoParser::read_meshes(const std::string& file_name) {
         std::getline(file, line);
 
         // Log the parsing progress:
-        if(num_lines > 0 && num_lines_parsed % 1000 == 0) {
-            LOG_PROGRESS(STATUS, "gridlines") << "Parsing grid file: " << (100 * num_lines_parsed / num_lines) << "%";
+        if(num_lines_parsed % 1000 == 0) {
+            LOG_PROGRESS(STATUS, "gridlines") << "Parsing grid file: " << get_progress(file, file_size) << "%";
         }
         num_lines_parsed++;
 
@@ -99,11 +97,9 @@ FieldMap SilvacoParser::read_fields(const std::string& file_name, const std::str
         throw std::runtime_error("file cannot be accessed");
     }
 
-    // Get the total number of lines to parse and reset file to the start:
-    auto num_lines = std::count(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>(), '\n');
-    file.clear();
-    file.seekg(0, std::ios::beg);
-    LOG(DEBUG) << "Field data file contains " << num_lines << " lines to parse";
+    // Get the size of the file to report the parsing progress without reading the file twice:
+    auto file_size = get_file_size(file);
+    LOG(DEBUG) << "Field data file contains " << file_size << " bytes to parse";
 
     // std::map<std::string, std::vector<Point>> region_electric_field_map;
     std::map<std::string, std::map<std::string, std::vector<Point>>> region_electric_field_map;
@@ -119,8 +115,8 @@ FieldMap SilvacoParser::read_fields(const std::string& file_name, const std::str
         line = allpix::trim(line);
 
         // Log the parsing progress:
-        if(num_lines > 0 && num_lines_parsed % 1000 == 0) {
-            LOG_PROGRESS(STATUS, "fieldlines") << "Parsing field data file: " << (100 * num_lines_parsed / num_lines) << "%";
+        if(num_lines_parsed % 1000 == 0) {
+            LOG_PROGRESS(STATUS, "fieldlines") << "Parsing field data file: " << get_progress(file, file_size) << "%";
         }
         num_lines_parsed++;
 
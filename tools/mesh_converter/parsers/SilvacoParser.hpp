@@ -23,7 +23,7 @@ namespace mesh_converter {
 
     private:
         // Read the grid
-        MeshMap read_meshes(const std::string& file_name) override;
+        MeshMap read_meshes(const std::string& file_name, ElementMap& elements) override;
 
         // Read the electric field
         FieldMap read_fields(const std::string& file_name, const std::string& observable) override;
@@ -0,0 +1,198 @@
+/**
+ * @file
+ * @brief Numerical calculation of weighting potentials of planar electrodes with a Fourier transform
+ *
+ * @copyright Copyright (c) 2024 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef ALLPIX_WEIGHTINGPOTENTIAL_FFT_H
+#define ALLPIX_WEIGHTINGPOTENTIAL_FFT_H
+
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace allpix {
+
+    /**
+     * @brief Weighting potential of planar electrodes on the front side of a sensor, solved with a Fourier transform
+     *
+     * The Laplace equation is solved in a sensor slab with the potential of the electrode surface prescribed by the
+     * electrode layout and a grounded back side. Transversely, the surface is sampled on a periodic grid of a power-of-two
+     * size larger than the requested field, such that the periodic images of the electrode are at least one field size
+     * away. Every transverse Fourier mode \f$k\f$ of the surface potential decays as \f$\sinh(k (d - w)) / \sinh(k d)\f$
+     * with the distance \f$w\f$ from the electrode surface, and the potential of every plane is obtained with an inverse
+     * transform.
+     */
+    class FFTPotential {
+    public:
+        /**
+         * @brief Transform the electrode layout into its Fourier modes
+         * @param bins      Number of transverse grid points of the requested field in x and y
+         * @param pitch     Distance between two grid points in x and y
+         * @param origin    Position of the first grid point of the requested field in x and y
+         * @param thickness Thickness of the sensor
+         * @param electrode Fraction of the area around a surface position which is covered by the electrode
+         */
+        FFTPotential(std::pair<size_t, size_t> bins,
+                     std::pair<double, double> pitch,
+                     std::pair<double, double> origin,
+                     double thickness,
+                     const std::function<double(double, double)>& electrode)
+            : bins_(std::move(bins)), thickness_(thickness) {
+            size_x_ = padded_size(bins_.first);
+            size_y_ = padded_size(bins_.second);
+            offset_x_ = (size_x_ - bins_.first) / 2;
+            offset_y_ = (size_y_ - bins_.second) / 2;
+
+            // Sample the potential of the electrode surface on the padded periodic grid
+            modes_.resize(size_x_ * size_y_);
+            for(size_t i = 0; i < size_x_; ++i) {
+                auto x = origin.first + pitch.first * (static_cast<double>(i) - static_cast<double>(offset_x_));
+                for(size_t j = 0; j < size_y_; ++j) {
+                    auto y = origin.second + pitch.second * (static_cast<double>(j) - static_cast<double>(offset_y_));
+                    modes_[i * size_y_ + j] = electrode(x, y);
+                }
+            }
+            transform(modes_, false);
+
+            // Wave numbers of the modes, with negative frequencies in the upper half
+            auto wave_numbers = [](size_t size, double spacing) {
+                std::vector<double> k(size);
+                for(size_t i = 0; i < size; ++i) {
+                    auto frequency = static_cast<double>(i);
+                    if(i > size / 2) {
+                        frequency -= static_cast<double>(size);
+                    }
+                    k[i] = 2 * M_PI * frequency / (static_cast<double>(size) * spacing);
+                }
+                return k;
+            };
+            kx_ = wave_numbers(size_x_, pitch.first);
+            ky_ = wave_numbers(size_y_, pitch.second);
+        }
+
+        /**
+         * @brief Calculate the weighting potential in a plane of the requested field
+         * @param distance Distance of the plane from the electrode surface
+         * @return Potential at the grid points of the plane, with the y index running fastest
+         */
+        std::vector<double> getPlane(double distance) const {
+            // Attenuate every mode with the distance from the electrode, written with exponentials to avoid overflows
+            std::vector<std::complex<double>> plane(modes_.size());
+            for(size_t i = 0; i < size_x_; ++i) {
+                for(size_t j = 0; j < size_y_; ++j) {
+                    auto k = std::sqrt(kx_[i] * kx_[i] + ky_[j] * ky_[j]);
+                    double attenuation = 0;
+                    if(k * thickness_ < 1e-12) {
+                        attenuation = (thickness_ - distance) / thickness_;
+                    } else {
+                        attenuation = std::exp(-k * distance) * -std::expm1(-2 * k * (thickness_ - distance)) /
+                                      -std::expm1(-2 * k * thickness_);
+                    }
+                    plane[i * size_y_ + j] = modes_[i * size_y_ + j] * attenuation;
+                }
+            }
+            transform(plane, true);
+
+            // Extract the requested field from the padded grid
+            std::vector<double> potential;
+            potential.reserve(bins_.first * bins_.second);
+            for(size_t i = 0; i < bins_.first; ++i) {
+                for(size_t j = 0; j < bins_.second; ++j) {
+                    potential.push_back(plane[(i + offset_x_) * size_y_ + j + offset_y_].real());
+                }
+            }
+            return potential;
+        }
+
+    private:
+        /**
+         * @brief Get the power-of-two size of the periodic grid for a number of grid points
+         */
+        static size_t padded_size(size_t bins) {
+            size_t size = 1;
+            while(size < 2 * bins) {
+                size <<= 1;
+            }
+            return size;
+        }
+
+        /**
+         * @brief Two-dimensional Fourier transform of the periodic grid
+         * @param data    Values of the grid with the y index running fastest
+         * @param inverse Calculate the inverse transform including the normalization
+         */
+        void transform(std::vector<std::complex<double>>& data, bool inverse) const {
+            // Transform all rows along y
+            for(size_t i = 0; i < size_x_; ++i) {
+                transform_line(&data[i * size_y_], size_y_, 1, inverse);
+            }
+            // Transform all columns along x
+            for(size_t j = 0; j < size_y_; ++j) {
+                transform_line(&data[j], size_x_, size_y_, inverse);
+            }
+            if(inverse) {
+                auto norm = 1. / static_cast<double>(size_x_ * size_y_);
+                for(auto& value : data) {
+                    value *= norm;
+                }
+            }
+        }
+
+        /**
+         * @brief Iterative radix-2 Fourier transform of a line of the grid
+         * @param data    Pointer to the first value of the line
+         * @param size    Number of values of the line, a power of two
+         * @param stride  Distance between two values of the line
+         * @param inverse Calculate the inverse transform without normalization
+         */
+        static void transform_line(std::complex<double>* data, size_t size, size_t stride, bool inverse) {
+            auto at = [&](size_t i) -> std::complex<double>& { return data[i * stride]; };
+
+            // Bit-reversal permutation
+            for(size_t i = 1, j = 0; i < size; ++i) {
+                auto bit = size >> 1;
+                for(; (j & bit) != 0; bit >>= 1) {
+                    j ^= bit;
+                }
+                j ^= bit;
+                if(i < j) {
+                    std::swap(at(i), at(j));
+                }
+            }
+
+            // Butterflies of doubling length
+            for(size_t length = 2; length <= size; length <<= 1) {
+                auto angle = (inverse ? 2 : -2) * M_PI / static_cast<double>(length);
+                std::complex<double> step(std::cos(angle), std::sin(angle));
+                for(size_t start = 0; start < size; start += length) {
+                    std::complex<double> twiddle(1, 0);
+                    for(size_t k = 0; k < length / 2; ++k) {
+                        auto even = at(start + k);
+                        auto odd = at(start + k + length / 2) * twiddle;
+                        at(start + k) = even + odd;
+                        at(start + k + length / 2) = even - odd;
+                        twiddle *= step;
+                    }
+                }
+            }
+        }
+
+        std::pair<size_t, size_t> bins_;
+        double thickness_;
+        size_t size_x_{}, size_y_{};
+        size_t offset_x_{}, offset_y_{};
+        std::vector<std::complex<double>> modes_;
+        std::vector<double> kx_, ky_;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_WEIGHTINGPOTENTIAL_FFT_H */
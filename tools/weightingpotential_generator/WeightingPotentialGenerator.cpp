@@ -11,6 +11,7 @@
 #include <csignal>
 #include <filesystem>
 #include <fstream>
+#include <memory>
 
 #include "core/config/ConfigReader.hpp"
 #include "core/config/Configuration.hpp"
@@ -22,6 +23,8 @@
 #include "tools/field_parser.h"
 #include "tools/units.h"
 
+#include "FFTPotential.hpp"
+
 #include <Math/Point2D.h>
 #include <Math/Point3D.h>
 #include <Math/Vector2D.h>
@@ -77,6 +80,8 @@ int main(int argc, char** argv) {
         XYVectorInt matrix(3, 3);
         XYZVectorInt binning;
         auto file_type = allpix::FileType::APF;
+        std::string method = "analytic";
+        unsigned int num_threads = 0;
 
         for(int i = 1; i < argc; i++) {
             if(strcmp(argv[i], "-h") == 0) {
@@ -89,6 +94,10 @@ int main(int argc, char** argv) {
                 matrix = allpix::from_string<XYVectorInt>(std::string(argv[++i]));
             } else if(strcmp(argv[i], "--model") == 0 && (i + 1 < argc)) {
                 model_path = std::filesystem::canonical(std::string(argv[++i]));
+            } else if(strcmp(argv[i], "--method") == 0 && (i + 1 < argc)) {
+                method = std::string(argv[++i]);
+            } else if(strcmp(argv[i], "--threads") == 0 && (i + 1 < argc)) {
+                num_threads = allpix::from_string<unsigned int>(std::string(argv[++i]));
             } else if(strcmp(argv[i], "--output") == 0 && (i + 1 < argc)) {
                 output_file_prefix = std::string(argv[++i]);
             } else if(strcmp(argv[i], "-v") == 0 && (i + 1 < argc)) {
@@ -121,6 +130,11 @@ int main(int argc, char** argv) {
                 << "\t --matrix  <int vector>  2D vector with size of the pixel array in x and y the potential should be "
                    "calculated for"
                 << std::endl;
+            std::cout
+                << "\t --method  <method>      Method to calculate the potential with, \"analytic\" (default) or \"fft\""
+                << std::endl;
+            std::cout << "\t --threads <int>         Number of threads, defaults to the number of available cores"
+                      << std::endl;
             std::cout << "\t --output  <file name>   Name of the file the potential should be stored in" << std::endl;
             std::cout
                 << "\t --init                  Switch to enable writing the potential in the INIT format instead of APF"
@@ -140,17 +154,28 @@ int main(int argc, char** argv) {
         allpix::ConfigReader reader(file, model_path);
         auto model = allpix::DetectorModel::factory(model_path, reader);
 
+        if(method != "analytic" && method != "fft") {
+            throw std::invalid_argument("Unknown method \"" + method + "\", only \"analytic\" and \"fft\" are supported");
+        }
+
         // Get pixel implant size from the detector model:
         auto implants = model->getImplants();
-        if(implants.size() > 1) {
+        if(method == "analytic" && implants.size() > 1) {
             throw std::invalid_argument("Detector model contains more than one implant, not supported for pad potential");
         }
+        for(const auto& pixel_implant : implants) {
+            if(method == "fft" && pixel_implant.getType() != allpix::DetectorModel::Implant::Type::FRONTSIDE) {
+                throw std::invalid_argument("Generator can only be used with frontside implants");
+            }
+        }
 
         auto implant = (implants.empty() ? ROOT::Math::XYZVector(model->getPixelSize().x(), model->getPixelSize().y(), 0)
                                          : implants.front().getSize());
         // This module currently only works with pad definition, i.e. 2D implant definition:
-        if(implant.z() > std::numeric_limits<double>::epsilon()) {
-            throw std::invalid_argument("Generator can only be used with 2D implants, but non-zero thickness found");
+        for(const auto& pixel_implant : implants) {
+            if(pixel_implant.getSize().z() > std::numeric_limits<double>::epsilon()) {
+                throw std::invalid_argument("Generator can only be used with 2D implants, but non-zero thickness found");
+            }
         }
 
         // Calculate thickness domain
@@ -177,10 +202,13 @@ int main(int argc, char** argv) {
         LOG(INFO) << "Field size: " << allpix::Units::display(fieldsize, {"um", "mm"});
         LOG(INFO) << "Binning: " << binning.x() << " " << binning.y() << " " << binning.z();
         LOG(INFO) << "Output file: " << output_file_name;
+        LOG(INFO) << "Method: " << method;
         auto start = std::chrono::system_clock::now();
 
         // Start potential generation on many threads:
-        auto num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+        if(num_threads == 0) {
+            num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+        }
         ThreadPool::registerThreadCount(num_threads);
         LOG(STATUS) << "Starting weighting potential generation with " << num_threads << " threads.";
         auto weighting_potential = std::make_shared<std::vector<double>>();
@@ -232,6 +260,58 @@ int main(int argc, char** argv) {
             return slice;
         };
 
+        // Numerical solution for arbitrary electrode layouts, sampled from the implants of the central pixel
+        std::unique_ptr<allpix::FFTPotential> fft_potential;
+        if(method == "fft") {
+            auto pitch = std::make_pair(fieldsize.x() / static_cast<double>(binning.x()),
+                                        fieldsize.y() / static_cast<double>(binning.y()));
+            auto origin = std::make_pair(pitch.first - fieldsize.x() / 2, pitch.second - fieldsize.y() / 2);
+
+            auto electrode = [&, pitch](double x, double y) {
+                // Without implants, the electrode covers the full pixel
+                auto covered = [&](double px, double py) {
+                    if(implants.empty()) {
+                        return std::fabs(px) <= pixel_pitch.x() / 2 && std::fabs(py) <= pixel_pitch.y() / 2;
+                    }
+                    for(const auto& pixel_implant : implants) {
+                        auto size = pixel_implant.getSize();
+                        auto pos = pixel_implant.getOrientation()(ROOT::Math::XYZVector(px, py, 0) -
+                                                                  pixel_implant.getOffset());
+                        if(pixel_implant.getShape() == allpix::DetectorModel::Implant::Shape::RECTANGLE) {
+                            if(std::fabs(pos.x()) <= size.x() / 2 && std::fabs(pos.y()) <= size.y() / 2) {
+                                return true;
+                            }
+                        } else if(pos.x() * pos.x() / (size.x() * size.x() / 4) +
+                                      pos.y() * pos.y() / (size.y() * size.y() / 4) <=
+                                  1) {
+                            return true;
+                        }
+                    }
+                    return false;
+                };
+
+                // Supersample the grid cell around the position to obtain the covered fraction
+                constexpr int samples = 4;
+                int inside = 0;
+                for(int i = 0; i < samples; ++i) {
+                    for(int j = 0; j < samples; ++j) {
+                        inside += static_cast<int>(covered(x + pitch.first * ((i + 0.5) / samples - 0.5),
+                                                           y + pitch.second * ((j + 0.5) / samples - 0.5)));
+                    }
+                }
+                return static_cast<double>(inside) / (samples * samples);
+            };
+
+            fft_potential = std::make_unique<allpix::FFTPotential>(
+                std::make_pair(binning.x(), binning.y()), pitch, origin, fieldsize.z(), electrode);
+        }
+
+        // Calculate a plane of constant z with the Fourier method
+        auto generate_plane = [&](size_t index_z) {
+            auto z = fieldsize.z() / static_cast<double>(binning.z()) * static_cast<double>(index_z) - fieldsize.z() / 2;
+            return fft_potential->getPlane(thickness_domain.second - z);
+        };
+
         // clang-format off
         auto init_function = [log_level = allpix::Log::getReportingLevel(), log_format = allpix::Log::getFormat()]() {
             // clang-format on
@@ -243,18 +323,39 @@ int main(int argc, char** argv) {
         ThreadPool pool(num_threads, num_threads * 1024, init_function);
         std::vector<std::shared_future<std::vector<double>>> wp_futures;
 
-        // Loop over x coordinate, add tasks for each coordinate to the queue
-        for(size_t x = 1; x <= binning.x(); x++) {
-            wp_futures.push_back(pool.submit(generate_section, x));
-        }
+        if(method == "fft") {
+            // Loop over z coordinate, add tasks for each plane to the queue
+            for(size_t z = 1; z <= binning.z(); z++) {
+                wp_futures.push_back(pool.submit(generate_plane, z));
+            }
+
+            // Reorder the planes into the x-y-z order of the field:
+            weighting_potential->resize(binning.x() * binning.y() * binning.z());
+            unsigned int planes_done = 0;
+            for(size_t z = 0; z < wp_futures.size(); z++) {
+                auto plane = wp_futures[z].get();
+                for(size_t xy = 0; xy < plane.size(); xy++) {
+                    (*weighting_potential)[xy * binning.z() + z] = plane[xy];
+                }
+                LOG_PROGRESS(INFO, "generation")
+                    << "Generating potential: " << (100 * planes_done / wp_futures.size()) << "%";
+                planes_done++;
+            }
+        } else {
+            // Loop over x coordinate, add tasks for each coordinate to the queue
+            for(size_t x = 1; x <= binning.x(); x++) {
+                wp_futures.push_back(pool.submit(generate_section, x));
+            }
 
-        // Merge the result vectors:
-        unsigned int slices_done = 0;
-        for(auto& wp_future : wp_futures) {
-            auto slice = wp_future.get();
-            weighting_potential->insert(weighting_potential->end(), slice.begin(), slice.end());
-            LOG_PROGRESS(INFO, "generation") << "Generating potential: " << (100 * slices_done / wp_futures.size()) << "%";
-            slices_done++;
+            // Merge the result vectors:
+            unsigned int slices_done = 0;
+            for(auto& wp_future : wp_futures) {
+                auto slice = wp_future.get();
+                weighting_potential->insert(weighting_potential->end(), slice.begin(), slice.end());
+                LOG_PROGRESS(INFO, "generation")
+                    << "Generating potential: " << (100 * slices_done / wp_futures.size()) << "%";
+                slices_done++;
+            }
         }
         LOG_PROGRESS(INFO, "generation") << "Generating potential: 100%";
         pool.destroy();